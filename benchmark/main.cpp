@@ -8,10 +8,20 @@
 
 #define BLOCKSCI_WITHOUT_SINGLETON
 
+#include "micro_benchmarks.hpp"
+#include "workloads.hpp"
+
 #include <blocksci/blocksci.hpp>
 #include <range/v3/view/slice.hpp>
 #include <clipp.h>
+#include <benchmark/benchmark.h>
+
+#include <fcntl.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <functional>
+#include <memory>
 #include <numeric>
 #include <iostream>
 
@@ -20,115 +30,247 @@ using namespace blocksci;
 int64_t countBlocks(BlockRange &chain);
 int64_t calculateMaxOutputSingleThreaded(BlockRange &chain);
 int64_t calculateMaxOutputMultithreaded(BlockRange &chain);
+int64_t calculateMaxOutputColumnsSingleThreaded(BlockRange &chain);
+int64_t calculateMaxOutputColumnsMultithreaded(BlockRange &chain);
+int64_t calculateValueByTypeColumnsMultithreaded(BlockRange &chain);
 int64_t calculateMaxInputSingleThreaded(BlockRange &chain);
 int64_t calculateMaxInputMultithreaded(BlockRange &chain);
 int64_t calculateMaxFeeSingleThreaded(BlockRange &chain);
 int64_t calculateMaxFeeMultithreaded(BlockRange &chain);
+int64_t calculateMaxFeeColumnsMultithreaded(BlockRange &chain);
 uint32_t calculateNonzeroLocktimeSingleThreaded(BlockRange &chain);
 uint32_t calculateNonzeroLocktimeMultithreaded(BlockRange &chain);
 uint32_t calculateVersionGreaterOneSingleThreaded(BlockRange &chain);
 uint32_t calculateVersionGreaterOneMultithreaded(BlockRange &chain);
 uint32_t calculateUniqueLocktimeChangeSingleThreaded(BlockRange &chain);
 uint32_t calculateUniqueLocktimeChangeMultithreaded(BlockRange &chain);
+uint32_t calculateUniqueLocktimeChangeCursorMultithreaded(BlockRange &chain);
 uint32_t calculateZeroConfOutputSingleThreaded(BlockRange &chain);
 uint32_t calculateZeroConfOutputMultithreaded(BlockRange &chain);
+uint32_t calculateZeroConfTxesPackageFlags(BlockRange &chain);
 
 int64_t calculateSatoshiDiceTotalOutputValue(BlockRange &chain, uint32_t addressNum, AddressType::Enum type);
 
 uint32_t calculateNonzeroLocktimeRandom(Blockchain &chain, const std::vector<uint32_t> &indexes);
 int64_t calculateMaxFeeRandom(Blockchain &chain, const std::vector<uint32_t> &indexes);
+int64_t calculateMaxFeeRandomBatched(Blockchain &chain, const std::vector<uint32_t> &indexes);
+
+/** Whole-chain query, returning its result so that it is reported next to the timing */
+using ChainQuery = std::function<double(Blockchain &chain)>;
+
+/** Where the whole-chain queries run
+ *
+ * Warm queries share one open chain whose data was read once before the benchmarks started. Cold queries open the
+ * chain again for every iteration after evicting its data files from the page cache. Eviction only works for pages
+ * that aren't mapped, so in cold mode no chain stays open between the iterations and the micro benchmarks are skipped.
+ */
+struct QuerySetup {
+    std::string configLocation;
+    int endBlock = 0;
+    uint32_t repetitions = 1;
+    Blockchain *warmChain = nullptr;
+    std::vector<std::string> coldFiles;
+};
+
+void evictFromPageCache(const std::vector<std::string> &files) {
+    for (auto &file : files) {
+        auto fd = open(file.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            close(fd);
+        }
+    }
+}
 
-template <typename Func, typename... Args>
-auto timeFunc(std::string name, Func func, uint32_t iterations, Args&& ...args) -> decltype(func(args...));
+void registerQuery(const std::string &name, ChainQuery query, const QuerySetup &setup) {
+    auto benchmarkName = name + (setup.warmChain ? "/warm" : "/cold");
+    benchmark::RegisterBenchmark(benchmarkName.c_str(), [query, &setup](benchmark::State &state) {
+        double result = 0;
+        for (auto _ : state) {
+            if (setup.warmChain) {
+                result = query(*setup.warmChain);
+            } else {
+                state.PauseTiming();
+                evictFromPageCache(setup.coldFiles);
+                {
+                    Blockchain chain(setup.configLocation, setup.endBlock);
+                    state.ResumeTiming();
+                    result = query(chain);
+                    state.PauseTiming();
+                }
+                state.ResumeTiming();
+            }
+        }
+        state.counters["result"] = result;
+    })->Unit(benchmark::kMillisecond)->UseRealTime()->Iterations(1)->Repetitions(static_cast<int>(setup.repetitions));
+}
 
 int main(int argc, char * argv[]) {
+    // Consumes the --benchmark_* flags, eg. --benchmark_format=json, --benchmark_out=<file> or --benchmark_filter=<regex>
+    benchmark::Initialize(&argc, argv);
+
     bool includeRandom = false;
     bool includeTraversal = false;
+    bool includeNuma = false;
+    bool cold = false;
     std::string configLocation;
     int endBlock = 0;
-    uint32_t iterations = 1;
+    uint32_t repetitions = 1;
+    size_t workloadSize = 1000000;
+    double zipfExponent = 0.99;
+    double meanBlockAge = 1000;
+    std::string tagFile;
+    std::string clusterDirectory;
 
     auto cli = (
         clipp::value("config file location", configLocation),
-        clipp::option("-r", "--with-random").set(includeRandom).doc("Include random order benchmarks"),
+        clipp::option("-r", "--with-random").set(includeRandom).doc("Include random order benchmarks, both uniform and with the skewed workloads"),
+        clipp::option("--workload-size") & clipp::value("Number of transactions visited by each skewed workload", workloadSize),
+        clipp::option("--zipf-exponent") & clipp::value("Exponent of the Zipfian workload, defaults to 0.99", zipfExponent),
+        clipp::option("--mean-block-age") & clipp::value("Mean age in blocks of the transactions of the recent workload, defaults to 1000", meanBlockAge),
+        clipp::option("--tags") & clipp::value("File of popular addresses, one per line optionally followed by a comma and a tag, that the address and cluster centric workloads start from", tagFile),
+        clipp::option("--clusters") & clipp::value("Clustering directory, enables the cluster centric workload", clusterDirectory),
         clipp::option("-t", "--with-traversal").set(includeTraversal).doc("Include graph traversal benchmarks"),
+        clipp::option("-n", "--with-numa").set(includeNuma).doc("Compare the multithreaded benchmarks with and without NUMA aware threads"),
+        clipp::option("-c", "--cold").set(cold).doc("Run the whole chain queries against a cold page cache, skipping the micro benchmarks"),
         clipp::option("-m", "--max-block") & clipp::value("Run benchmark up to the given block", endBlock),
-        clipp::option("-i", "--iterations") & clipp::value("Number of iterations for each benchmark", iterations)
+        clipp::option("-i", "--iterations") & clipp::value("Number of repetitions of each whole chain query, reported with their mean, median and standard deviation", repetitions)
     );
     auto res = parse(argc, argv, cli);
     if (res.any_error()) {
         std::cout << "Invalid command line parameter\n" << clipp::make_man_page(cli, argv[0]);
+        std::cout << "\nGoogle Benchmark options such as --benchmark_format=json and --benchmark_out=<file> are accepted as well\n";
         return 0;
     }
 
-    Blockchain chain(configLocation, endBlock);
-    
-    std::cout << "Heating up cache." << std::endl;
-
-    timeFunc("loadingTxData", calculateMaxFeeMultithreaded, 1, chain);
-    timeFunc("loadingVersionNo", calculateVersionGreaterOneSingleThreaded, 1, chain);
-
-    auto totalBlocks = timeFunc("countBlocks", countBlocks, 1, chain);
-    std::cout << "Running benchmark over " << totalBlocks << " blocks." << std::endl;
+    auto chain = std::make_unique<Blockchain>(configLocation, endBlock);
+
+    // Record whether the run starts against a warm or a cold page cache
+    uint64_t residentBytes = 0;
+    uint64_t totalBytes = 0;
+    QuerySetup setup;
+    setup.configLocation = configLocation;
+    setup.endBlock = endBlock;
+    setup.repetitions = std::max(repetitions, uint32_t{1});
+    for (auto &file : chain->pageCacheResidency()) {
+        residentBytes += file.residentBytes;
+        totalBytes += file.size;
+        setup.coldFiles.push_back(file.path);
+    }
+    auto totalBlocks = countBlocks(*chain);
+    benchmark::AddCustomContext("blocksci_config", configLocation);
+    benchmark::AddCustomContext("blocksci_blocks", std::to_string(totalBlocks));
+    benchmark::AddCustomContext("blocksci_page_cache", cold ? "cold" : "warm");
+    benchmark::AddCustomContext("blocksci_initially_resident_bytes", std::to_string(residentBytes) + " of " + std::to_string(totalBytes));
+
+    bool withOutputColumns = hasOutputColumns(chain->getAccess());
+    bool withTxFeeColumns = hasTxFeeColumns(chain->getAccess());
+    bool withTxPackages = hasTxPackages(chain->getAccess());
+    auto satoshiDiceAddress = getAddressFromString("1dice97ECuByXAvqXpaYzSaQuPVvrtmz6", chain->getAccess());
+    auto defaultParallelism = chain->parallelism();
+
+    // The workloads are generated up front, so that cold runs don't need a chain or clustering to stay open
+    auto indexes = std::make_shared<std::vector<uint32_t>>();
+    std::vector<std::pair<std::string, std::shared_ptr<std::vector<uint32_t>>>> workloads;
+    if (includeRandom && totalBlocks > 0) {
+        uint32_t maxTxNum = (*chain)[totalBlocks - 1].endTxIndex();
+        *indexes = uniformWorkload(maxTxNum, 42);
+        workloads.emplace_back("Zipfian", std::make_shared<std::vector<uint32_t>>(zipfianWorkload(maxTxNum, workloadSize, zipfExponent, 42)));
+        workloads.emplace_back("Recent", std::make_shared<std::vector<uint32_t>>(recentWorkload(*chain, workloadSize, meanBlockAge, 42)));
+        auto addresses = popularAddresses(*chain, tagFile, 100, 1000);
+        workloads.emplace_back("AddressCentric", std::make_shared<std::vector<uint32_t>>(addressWorkload(addresses, workloadSize)));
+        if (!clusterDirectory.empty()) {
+            ClusterManager clusters(clusterDirectory, chain->getAccess());
+            workloads.emplace_back("ClusterCentric", std::make_shared<std::vector<uint32_t>>(clusterWorkload(clusters, addresses, workloadSize)));
+        }
+        for (auto &workload : workloads) {
+            benchmark::AddCustomContext("blocksci_workload_" + workload.first, std::to_string(distinctTxCount(*workload.second)) + " distinct of " + std::to_string(workload.second->size()) + " transactions");
+        }
+    }
 
-    std::cout << std::endl << "Benchmarks:" << std::endl;
+    if (cold) {
+        chain.reset();
+    } else {
+        // Heat up the cache
+        calculateMaxFeeMultithreaded(*chain);
+        calculateVersionGreaterOneSingleThreaded(*chain);
+        setup.warmChain = chain.get();
+        registerMicroBenchmarks(*chain);
+    }
 
     // Sequential transaction graph iteration
-    auto locktime1 = timeFunc("nonzeroLocktimeSingleThreaded", calculateNonzeroLocktimeSingleThreaded, iterations, chain);
-    auto locktime2 = timeFunc("nonzeroLocktimeMultithreaded", calculateNonzeroLocktimeMultithreaded, iterations, chain);
-    auto maxOutput1 = timeFunc("maxOutputSingleThreaded", calculateMaxOutputSingleThreaded, iterations, chain);
-    auto maxOutput2 = timeFunc("maxOutputMultithreaded", calculateMaxOutputMultithreaded, iterations, chain);
-    auto maxInput1 = timeFunc("maxInputSingleThreaded", calculateMaxInputSingleThreaded, iterations, chain);
-    auto maxInput2 = timeFunc("maxInputMultithreaded", calculateMaxInputMultithreaded, iterations, chain);
-    auto maxFee1 = timeFunc("maxFeeSingleThreaded", calculateMaxFeeSingleThreaded, iterations, chain);
-    auto maxFee2 = timeFunc("maxFeeMultithreaded", calculateMaxFeeMultithreaded, iterations, chain);
-
-    auto version1 = timeFunc("versionGreaterOneSingleThreaded", calculateVersionGreaterOneSingleThreaded, iterations, chain);
-    auto version2 = timeFunc("versionGreaterOneMultithreaded", calculateVersionGreaterOneMultithreaded, iterations, chain);
+    registerQuery("nonzeroLocktimeSingleThreaded", [](Blockchain &c) { return calculateNonzeroLocktimeSingleThreaded(c); }, setup);
+    registerQuery("nonzeroLocktimeMultithreaded", [](Blockchain &c) { return calculateNonzeroLocktimeMultithreaded(c); }, setup);
+    registerQuery("maxOutputSingleThreaded", [](Blockchain &c) { return calculateMaxOutputSingleThreaded(c); }, setup);
+    registerQuery("maxOutputMultithreaded", [](Blockchain &c) { return calculateMaxOutputMultithreaded(c); }, setup);
+    if (withOutputColumns) {
+        registerQuery("maxOutputColumnsSingleThreaded", [](Blockchain &c) { return calculateMaxOutputColumnsSingleThreaded(c); }, setup);
+        registerQuery("maxOutputColumnsMultithreaded", [](Blockchain &c) { return calculateMaxOutputColumnsMultithreaded(c); }, setup);
+        registerQuery("valueByTypeColumnsMultithreaded", [](Blockchain &c) { return calculateValueByTypeColumnsMultithreaded(c); }, setup);
+    }
+    registerQuery("maxInputSingleThreaded", [](Blockchain &c) { return calculateMaxInputSingleThreaded(c); }, setup);
+    registerQuery("maxInputMultithreaded", [](Blockchain &c) { return calculateMaxInputMultithreaded(c); }, setup);
+    registerQuery("maxFeeSingleThreaded", [](Blockchain &c) { return calculateMaxFeeSingleThreaded(c); }, setup);
+    registerQuery("maxFeeMultithreaded", [](Blockchain &c) { return calculateMaxFeeMultithreaded(c); }, setup);
+    if (withTxFeeColumns) {
+        registerQuery("maxFeeColumnsMultithreaded", [](Blockchain &c) { return calculateMaxFeeColumnsMultithreaded(c); }, setup);
+    }
+    registerQuery("versionGreaterOneSingleThreaded", [](Blockchain &c) { return calculateVersionGreaterOneSingleThreaded(c); }, setup);
+    registerQuery("versionGreaterOneMultithreaded", [](Blockchain &c) { return calculateVersionGreaterOneMultithreaded(c); }, setup);
 
     // Graph traversal queries
-    uint32_t uniqueLocktimeSingle = 0;
-    uint32_t uniqueLocktimeMulti = 0;
-    uint32_t zeroconfSingle = 0;
-    uint32_t zeroconfMulti = 0;
-
-    if(includeTraversal) {
-        uniqueLocktimeSingle = timeFunc("uniqueLocktimeChangeSingleThreaded", calculateUniqueLocktimeChangeSingleThreaded, iterations, chain);
-        uniqueLocktimeMulti = timeFunc("uniqueLocktimeChangeMultithreaded", calculateUniqueLocktimeChangeMultithreaded, iterations, chain);
-        zeroconfSingle = timeFunc("zeroConfOutputSingleThreaded", calculateZeroConfOutputSingleThreaded, iterations, chain);
-        zeroconfMulti = timeFunc("zeroConfOutputMultithreaded", calculateZeroConfOutputMultithreaded, iterations, chain);
+    if (includeTraversal) {
+        registerQuery("uniqueLocktimeChangeSingleThreaded", [](Blockchain &c) { return calculateUniqueLocktimeChangeSingleThreaded(c); }, setup);
+        registerQuery("uniqueLocktimeChangeMultithreaded", [](Blockchain &c) { return calculateUniqueLocktimeChangeMultithreaded(c); }, setup);
+        registerQuery("uniqueLocktimeChangeCursorMultithreaded", [](Blockchain &c) { return calculateUniqueLocktimeChangeCursorMultithreaded(c); }, setup);
+        registerQuery("zeroConfOutputSingleThreaded", [](Blockchain &c) { return calculateZeroConfOutputSingleThreaded(c); }, setup);
+        registerQuery("zeroConfOutputMultithreaded", [](Blockchain &c) { return calculateZeroConfOutputMultithreaded(c); }, setup);
     }
-
-    int64_t maxSatoshiDiceOutput = -1;
-    auto satoshiDiceAddress = getAddressFromString("1dice97ECuByXAvqXpaYzSaQuPVvrtmz6", chain.getAccess());
-    if(satoshiDiceAddress) {
-        maxSatoshiDiceOutput = timeFunc("satoshiDiceTotalOutputValueSingleThreaded", calculateSatoshiDiceTotalOutputValue, iterations, chain, satoshiDiceAddress->scriptNum, satoshiDiceAddress->type);
+    if (withTxPackages) {
+        registerQuery("zeroConfTxesPackageFlags", [](Blockchain &c) { return calculateZeroConfTxesPackageFlags(c); }, setup);
     }
 
-    if (includeRandom) {
-        uint32_t maxTxNum = chain[totalBlocks - 1].endTxIndex();
-        std::vector<uint32_t> indexes(maxTxNum);
-        std::iota(indexes.begin(), indexes.end(), 0);
-        std::random_shuffle(indexes.begin(), indexes.end());
+    if (satoshiDiceAddress) {
+        auto scriptNum = satoshiDiceAddress->scriptNum;
+        auto type = satoshiDiceAddress->type;
+        registerQuery("satoshiDiceTotalOutputValueSingleThreaded", [scriptNum, type](Blockchain &c) { return calculateSatoshiDiceTotalOutputValue(c, scriptNum, type); }, setup);
+    }
 
-        timeFunc("maxFeeRandom", calculateMaxFeeRandom, iterations, chain, indexes);
-        timeFunc("nonzeroLocktimeRandom", calculateNonzeroLocktimeRandom, iterations, chain, indexes);
+    if (!indexes->empty()) {
+        registerQuery("maxFeeRandom", [indexes](Blockchain &c) { return calculateMaxFeeRandom(c, *indexes); }, setup);
+        registerQuery("maxFeeRandomBatched", [indexes](Blockchain &c) { return calculateMaxFeeRandomBatched(c, *indexes); }, setup);
+        registerQuery("nonzeroLocktimeRandom", [indexes](Blockchain &c) { return calculateNonzeroLocktimeRandom(c, *indexes); }, setup);
     }
 
-    // Print results
-    std::cout << std::endl << "Results:" << std::endl;;
-    std::cout << "Nonzero Locktime = (" << locktime1 << ", " << locktime2 << ")" << std::endl;
-    std::cout << "Max Output = (" << maxOutput1 << ", " << maxOutput2 << ")" << std::endl;
-    std::cout << "Max Input = (" << maxInput1 << ", " << maxInput2 << ")" << std::endl;
-    std::cout << "Max Fee = (" << maxFee1 << ", " << maxFee2 << ")" << std::endl;
-    std::cout << "Version > 1 = (" << version1 << ", " << version2 << ")" << std::endl;
-    if(maxSatoshiDiceOutput >= 0) {
-        std::cout << "SatoshiDice Output Value = (" << maxSatoshiDiceOutput << ")" << std::endl;
+    // Skewed random access, cold with --cold
+    for (auto &workload : workloads) {
+        auto txNums = workload.second;
+        if (!txNums->empty()) {
+            registerQuery("maxFee" + workload.first, [txNums](Blockchain &c) { return calculateMaxFeeRandom(c, *txNums); }, setup);
+            registerQuery("maxFee" + workload.first + "Batched", [txNums](Blockchain &c) { return calculateMaxFeeRandomBatched(c, *txNums); }, setup);
+        }
     }
-    if(includeTraversal) {
-        std::cout << "Zeroconf Outputs = (" << zeroconfSingle << ", " << zeroconfMulti << ")" << std::endl;
-        std::cout << "Unique Change = (" << uniqueLocktimeSingle << ", " << uniqueLocktimeMulti << ")" << std::endl;
+
+    if (includeNuma) {
+        for (bool numaAware : {false, true}) {
+            auto config = defaultParallelism;
+            config.numaAware = numaAware;
+            std::string suffix = numaAware ? "Numa" : "NoNuma";
+            auto withParallelism = [config, defaultParallelism](auto query) {
+                return [config, defaultParallelism, query](Blockchain &c) {
+                    c.setParallelism(config);
+                    auto result = query(c);
+                    c.setParallelism(defaultParallelism);
+                    return static_cast<double>(result);
+                };
+            };
+            registerQuery("nonzeroLocktimeMultithreaded" + suffix, withParallelism(calculateNonzeroLocktimeMultithreaded), setup);
+            registerQuery("maxOutputMultithreaded" + suffix, withParallelism(calculateMaxOutputMultithreaded), setup);
+            registerQuery("maxFeeMultithreaded" + suffix, withParallelism(calculateMaxFeeMultithreaded), setup);
+        }
     }
+
+    benchmark::RunSpecifiedBenchmarks();
     return 0;
 }
 
@@ -166,6 +308,37 @@ int64_t calculateMaxOutputMultithreaded(BlockRange &chain) {
     return chain.mapReduce<int64_t>(extract, combine);
 }
 
+int64_t calculateMaxOutputColumnsSingleThreaded(BlockRange &chain) {
+    return outputColumns(chain).maxValue();
+}
+
+int64_t calculateMaxOutputColumnsMultithreaded(BlockRange &chain) {
+    auto extract = [](BlockRange blocks) {
+        return outputColumns(blocks).maxValue();
+    };
+    
+    auto combine = [](int64_t &a, int64_t &b) -> int64_t & { a = std::max(a,b); return a; };
+    
+    return chain.mapReduce<int64_t>(extract, combine);
+}
+
+int64_t calculateValueByTypeColumnsMultithreaded(BlockRange &chain) {
+    using TypeTotals = std::array<int64_t, AddressType::size>;
+    auto extract = [](BlockRange blocks) {
+        return outputColumns(blocks).valueByType();
+    };
+    
+    auto combine = [](TypeTotals &a, TypeTotals &b) -> TypeTotals & {
+        for (size_t i = 0; i < a.size(); i++) {
+            a[i] += b[i];
+        }
+        return a;
+    };
+    
+    auto totals = chain.mapReduce<TypeTotals>(extract, combine);
+    return std::accumulate(totals.begin(), totals.end(), int64_t{0});
+}
+
 int64_t calculateMaxInputSingleThreaded(BlockRange &chain) {
     int64_t curMax = 0;
     for (auto block : chain) {
@@ -212,6 +385,16 @@ int64_t calculateMaxFeeMultithreaded(BlockRange &chain) {
     return chain.mapReduce<int64_t>(extract, combine);
 }
 
+int64_t calculateMaxFeeColumnsMultithreaded(BlockRange &chain) {
+    auto extract = [](BlockRange blocks) {
+        return txFeeColumns(blocks).maxFee();
+    };
+    
+    auto combine = [](int64_t &a, int64_t &b) -> int64_t & { a = std::max(a,b); return a; };
+    
+    return chain.mapReduce<int64_t>(extract, combine);
+}
+
 int64_t calculateMaxFeeRandom(Blockchain &chain, const std::vector<uint32_t> &indexes) {
     int64_t maxValue = 0;
     for (auto index : indexes) {
@@ -221,6 +404,18 @@ int64_t calculateMaxFeeRandom(Blockchain &chain, const std::vector<uint32_t> &in
     return maxValue;
 }
 
+int64_t calculateMaxFeeRandomBatched(Blockchain &chain, const std::vector<uint32_t> &indexes) {
+    constexpr size_t batchSize = 4096;
+    int64_t maxValue = 0;
+    for (size_t i = 0; i < indexes.size(); i += batchSize) {
+        std::vector<uint32_t> batch(indexes.begin() + static_cast<int64_t>(i), indexes.begin() + static_cast<int64_t>(std::min(i + batchSize, indexes.size())));
+        for (auto &tx : getTransactions(batch, chain.getAccess())) {
+            maxValue = std::max(maxValue, fee(tx));
+        }
+    }
+    return maxValue;
+}
+
 uint32_t calculateNonzeroLocktimeSingleThreaded(BlockRange &chain) {
     uint32_t count = 0;
     for (auto block : chain) {
@@ -307,6 +502,24 @@ uint32_t calculateZeroConfOutputMultithreaded(BlockRange &chain) {
     return chain.mapReduce<uint32_t>(extract, combine);
 }
 
+/** Number of txes spending an output of the same block, a scan of chain/tx_package_flags.dat */
+uint32_t calculateZeroConfTxesPackageFlags(BlockRange &chain) {
+    auto flags = static_cast<const uint8_t *>(columnData(ChainColumn::TxPackageFlags, chain.getAccess()).data);
+    auto extract = [flags](BlockRange blocks) {
+        uint32_t count = 0;
+        for (auto block : blocks) {
+            for (auto txNum = block.firstTxIndex(); txNum < block.endTxIndex(); txNum++) {
+                count += static_cast<uint32_t>((flags[txNum] & TxPackageFlag::SpendsSameBlock) != 0);
+            }
+        }
+        return count;
+    };
+
+    auto combine = [](uint32_t &a, uint32_t &b) -> uint32_t & { a += b; return a; };
+
+    return chain.mapReduce<uint32_t>(extract, combine);
+}
+
 int64_t calculateSatoshiDiceTotalOutputValue(BlockRange &chain, uint32_t addressNum, AddressType::Enum type) {
     auto address = Address{addressNum, type, chain.getAccess()};
     int64_t total = 0;
@@ -356,38 +569,23 @@ uint32_t calculateUniqueLocktimeChangeMultithreaded(BlockRange &chain) {
     return chain.mapReduce<uint32_t>(extract, combine);
 }
 
-
-
-template <typename Func, typename... Args>
-auto timeFunc(std::string name, Func func, uint32_t iterations, Args&& ...args) -> decltype(func(args...)) {
-    std::vector<double> times;
-    int64_t ret = 0;
-
-    std::cout << "Time in secs for " << name << ": ";
-    for(uint32_t i = 0; i < iterations; ++i) {
-        auto begin = std::chrono::steady_clock::now();
-        ret = func(std::forward<Args>(args)...);
-        auto endTime = std::chrono::steady_clock::now();
-        double timeSecs = std::chrono::duration_cast<std::chrono::microseconds>(endTime - begin).count() / 1000000.0;
-        times.push_back(timeSecs);
-    }
-
-    // compute average over all measurements
-    double average = accumulate(times.begin(), times.end(), 0.0)/times.size();
-    std::cout << average;
-
-    // print individual observations
-    if(iterations > 1) {
-        std::cout << " [";
-        for(uint32_t i = 0; i < iterations; ++i) {
-            std::cout << times[i];
-            if (i < iterations - 1) {
-                std::cout << ", ";
+/** Same as calculateUniqueLocktimeChangeMultithreaded, walking the outputs with an OutputCursor */
+uint32_t calculateUniqueLocktimeChangeCursorMultithreaded(BlockRange &chain) {
+    auto extract = [](const Transaction &tx) {
+        auto outputCount = 0;
+        bool locktimeBehavior = tx.locktime() > 0;
+        for (OutputCursor output{tx}; output.valid(); output.next()) {
+            if (output.isSpent()) {
+                auto spendingTx = output.getSpendingTx();
+                if ((spendingTx->locktime() > 0) == locktimeBehavior) {
+                    outputCount += 1;
+                }
             }
         }
-        std::cout << "]";
-    }
-    std::cout << std::endl;
-    
-    return ret;
+        return static_cast<uint32_t>(outputCount == 1);
+    };
+
+    auto combine = [](uint32_t &a, uint32_t &b) -> uint32_t & { a += b; return a; };
+
+    return chain.mapReduce<uint32_t>(extract, combine);
 }
@@ -0,0 +1,171 @@
+//
+//  map_benchmarks.cpp
+//  blocksci_map_benchmark
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#define BLOCKSCI_WITHOUT_SINGLETON
+
+#include <basic_types.hpp>
+#include <key_hash.hpp>
+#include <utxo.hpp>
+
+#include <benchmark/benchmark.h>
+#include <google/dense_hash_map>
+
+#ifdef BLOCKSCI_WITH_ABSL
+#include <absl/container/flat_hash_map.h>
+#endif
+
+#ifdef BLOCKSCI_WITH_ROBIN_HOOD
+#include <robin_hood.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* Compares the hash maps and key hashes that could back the UTXO and address maps of the parser
+ *
+ * Every benchmark inserts n keys, looks all of them up, looks up n missing keys and erases half of the keys like
+ * spending the outputs. The keys are either uniformly random hashes or clustered hashes whose word read by std::hash
+ * only takes a few values, which is what ground vanity hashes look like to it.
+ */
+
+using blocksci::uint160;
+using blocksci::uint256;
+
+namespace {
+    constexpr uint32_t keySeed = 8675309;
+    constexpr uint64_t clusterCount = 64;
+
+    enum class KeyPattern { Random, Clustered };
+
+    template <typename Hash>
+    Hash randomHash(std::mt19937_64 &generator, KeyPattern pattern, size_t stdHashWord) {
+        Hash hash;
+        for (size_t i = 0; i < hash.size(); i += sizeof(uint64_t)) {
+            auto word = generator();
+            std::memcpy(hash.begin() + i, &word, std::min(sizeof(word), hash.size() - i));
+        }
+        if (pattern == KeyPattern::Clustered) {
+            auto word = generator() % clusterCount;
+            std::memcpy(hash.begin() + stdHashWord * sizeof(uint64_t), &word, sizeof(word));
+        }
+        return hash;
+    }
+
+    /** Outputs of random transactions with one to four outputs each, the first n are inserted and the rest are misses */
+    std::vector<RawOutputPointer> outputKeys(size_t n, KeyPattern pattern) {
+        std::mt19937_64 generator(keySeed);
+        std::vector<RawOutputPointer> keys;
+        keys.reserve(2 * n);
+        while (keys.size() < 2 * n) {
+            auto txHash = randomHash<uint256>(generator, pattern, 2);
+            auto outputCount = 1 + generator() % 4;
+            for (uint16_t i = 0; i < outputCount && keys.size() < 2 * n; i++) {
+                keys.emplace_back(txHash, i);
+            }
+        }
+        return keys;
+    }
+
+    std::vector<uint160> addressKeys(size_t n, KeyPattern pattern) {
+        std::mt19937_64 generator(keySeed);
+        std::vector<uint160> keys;
+        keys.reserve(2 * n);
+        for (size_t i = 0; i < 2 * n; i++) {
+            keys.push_back(randomHash<uint160>(generator, pattern, 1));
+        }
+        return keys;
+    }
+
+    template <typename Key>
+    struct EmptyKeys;
+
+    template <>
+    struct EmptyKeys<RawOutputPointer> {
+        static RawOutputPointer empty() { return {uint256{}, 0}; }
+        static RawOutputPointer deleted() { return {uint256{}, 1}; }
+    };
+
+    template <>
+    struct EmptyKeys<uint160> {
+        static uint160 filled(unsigned char byte) {
+            uint160 key;
+            std::memset(key.begin(), byte, key.size());
+            return key;
+        }
+        static uint160 empty() { return filled(0xFE); }
+        static uint160 deleted() { return filled(0xFF); }
+    };
+
+    template <typename Key, typename Value, typename Hash>
+    struct DenseHashMap : google::dense_hash_map<Key, Value, Hash> {
+        DenseHashMap() {
+            this->set_empty_key(EmptyKeys<Key>::empty());
+            this->set_deleted_key(EmptyKeys<Key>::deleted());
+        }
+    };
+
+    template <typename Map, typename Key, typename Value>
+    void benchmarkMap(benchmark::State &state, const std::vector<Key> &keys, Value value) {
+        auto n = keys.size() / 2;
+        size_t found = 0;
+        for (auto _ : state) {
+            Map map;
+            map.reserve(n);
+            for (size_t i = 0; i < n; i++) {
+                map.insert(std::make_pair(keys[i], value));
+            }
+            for (size_t i = 0; i < n; i++) {
+                found += map.find(keys[i]) != map.end();
+            }
+            for (size_t i = n; i < 2 * n; i++) {
+                found += map.find(keys[i]) != map.end();
+            }
+            for (size_t i = 0; i < n; i += 2) {
+                map.erase(keys[i]);
+            }
+            benchmark::DoNotOptimize(found);
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * (n * 3 + n / 2)));
+    }
+
+    template <typename Key, typename Value>
+    void registerMaps(const char *name, std::vector<Key> (*makeKeys)(size_t, KeyPattern), Value value) {
+        for (auto pattern : {KeyPattern::Random, KeyPattern::Clustered}) {
+            for (size_t n : {size_t{1} << 16, size_t{1} << 22}) {
+                auto keys = std::make_shared<std::vector<Key>>(makeKeys(n, pattern));
+                std::string suffix = std::string(pattern == KeyPattern::Random ? "/random/" : "/clustered/") + std::to_string(n);
+                auto add = [&](const std::string &mapName, auto benchmarkFunc) {
+                    benchmark::RegisterBenchmark((std::string(name) + "/" + mapName + suffix).c_str(), [keys, value, benchmarkFunc](benchmark::State &state) {
+                        benchmarkFunc(state, *keys, value);
+                    })->Unit(benchmark::kMillisecond);
+                };
+                add("dense_hash_map/std_hash", benchmarkMap<DenseHashMap<Key, Value, std::hash<Key>>, Key, Value>);
+                add("dense_hash_map/mix_hash", benchmarkMap<DenseHashMap<Key, Value, ParserKeyHash<Key>>, Key, Value>);
+                add("unordered_map/std_hash", benchmarkMap<std::unordered_map<Key, Value, std::hash<Key>>, Key, Value>);
+                #ifdef BLOCKSCI_WITH_ABSL
+                add("flat_hash_map/mix_hash", benchmarkMap<absl::flat_hash_map<Key, Value, ParserKeyHash<Key>>, Key, Value>);
+                #endif
+                #ifdef BLOCKSCI_WITH_ROBIN_HOOD
+                add("robin_hood/mix_hash", benchmarkMap<robin_hood::unordered_flat_map<Key, Value, ParserKeyHash<Key>>, Key, Value>);
+                #endif
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    registerMaps("UTXOState", outputKeys, UTXO{5000, 1, blocksci::AddressType::PUBKEYHASH});
+    registerMaps("AddressMap", addressKeys, uint32_t{1});
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
@@ -0,0 +1,257 @@
+//
+//  micro_benchmarks.cpp
+//  blocksci_benchmark
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#define BLOCKSCI_WITHOUT_SINGLETON
+
+#include "micro_benchmarks.hpp"
+
+#include <blocksci/blocksci.hpp>
+#include <blocksci/core/raw_address.hpp>
+
+#include <internal/address_index.hpp>
+#include <internal/chain_access.hpp>
+#include <internal/concurrent_disjoint_sets.hpp>
+#include <internal/data_access.hpp>
+#include <internal/hash.hpp>
+#include <internal/hash_index.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using namespace blocksci;
+
+namespace {
+    /** Upper bound on the number of transactions, inputs and addresses the lookups cycle through */
+    constexpr size_t sampleSize = size_t{1} << 16;
+
+    /** Fixed seed so that every run and every build looks up the same elements */
+    constexpr std::mt19937::result_type sampleSeed = 42;
+
+    std::vector<uint32_t> sequentialTxNums(const ChainAccess &chainAccess) {
+        std::vector<uint32_t> txNums(std::min(sampleSize, chainAccess.txCount()));
+        std::iota(txNums.begin(), txNums.end(), 0);
+        return txNums;
+    }
+
+    std::vector<uint32_t> randomTxNums(const ChainAccess &chainAccess) {
+        std::mt19937 generator(sampleSeed);
+        std::uniform_int_distribution<uint32_t> distribution(0, static_cast<uint32_t>(chainAccess.txCount() - 1));
+        std::vector<uint32_t> txNums(std::min(sampleSize, chainAccess.txCount()));
+        for (auto &txNum : txNums) {
+            txNum = distribution(generator);
+        }
+        return txNums;
+    }
+
+    std::vector<InputPointer> randomInputs(DataAccess &access) {
+        std::vector<InputPointer> inputs;
+        for (auto txNum : randomTxNums(access.getChain())) {
+            Transaction tx(txNum, access);
+            for (uint16_t i = 0; i < tx.inputCount() && inputs.size() < sampleSize; i++) {
+                inputs.emplace_back(txNum, i);
+            }
+        }
+        std::shuffle(inputs.begin(), inputs.end(), std::mt19937(sampleSeed));
+        return inputs;
+    }
+
+    std::vector<RawAddress> randomAddresses(DataAccess &access) {
+        std::vector<RawAddress> addresses;
+        std::unordered_set<RawAddress> seen;
+        for (auto txNum : randomTxNums(access.getChain())) {
+            Transaction tx(txNum, access);
+            for (auto output : tx.outputs()) {
+                auto address = output.getAddress();
+                RawAddress rawAddress{address.scriptNum, address.type};
+                if (seen.insert(rawAddress).second) {
+                    addresses.push_back(rawAddress);
+                }
+            }
+        }
+        if (addresses.size() > sampleSize) {
+            addresses.resize(sampleSize);
+        }
+        return addresses;
+    }
+
+    /** Run lookup on the elements of sample in order, starting over at the end, and count one item per lookup */
+    template <typename T, typename Func>
+    void cycleThrough(benchmark::State &state, const std::vector<T> &sample, Func lookup) {
+        size_t i = 0;
+        for (auto _ : state) {
+            lookup(sample[i]);
+            if (++i == sample.size()) {
+                i = 0;
+            }
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    }
+
+    void registerChainBenchmarks(Blockchain &chain) {
+        auto &access = chain.getAccess();
+        auto &chainAccess = access.getChain();
+        if (chainAccess.txCount() == 0) {
+            return;
+        }
+
+        auto sequential = sequentialTxNums(chainAccess);
+        auto random = randomTxNums(chainAccess);
+
+        // ChainAccess::getTx is a plain IndexedFileMapper::getData on tx_index.dat and tx_data.dat
+        benchmark::RegisterBenchmark("IndexedFileMapper::getData/sequential", [&chainAccess, sequential](benchmark::State &state) {
+            cycleThrough(state, sequential, [&](uint32_t txNum) {
+                benchmark::DoNotOptimize(chainAccess.getTx(txNum));
+            });
+        });
+        benchmark::RegisterBenchmark("IndexedFileMapper::getData/random", [&chainAccess, random](benchmark::State &state) {
+            cycleThrough(state, random, [&](uint32_t txNum) {
+                benchmark::DoNotOptimize(chainAccess.getTx(txNum));
+            });
+        });
+
+        benchmark::RegisterBenchmark("ChainAccess::getBlockHeight/random", [&chainAccess, random](benchmark::State &state) {
+            cycleThrough(state, random, [&](uint32_t txNum) {
+                benchmark::DoNotOptimize(chainAccess.getBlockHeight(txNum));
+            });
+        });
+
+        benchmark::RegisterBenchmark("Transaction/sequential", [&access, sequential](benchmark::State &state) {
+            cycleThrough(state, sequential, [&](uint32_t txNum) {
+                Transaction tx(txNum, access);
+                benchmark::DoNotOptimize(tx);
+            });
+        });
+        benchmark::RegisterBenchmark("Transaction/random", [&access, random](benchmark::State &state) {
+            cycleThrough(state, random, [&](uint32_t txNum) {
+                Transaction tx(txNum, access);
+                benchmark::DoNotOptimize(tx);
+            });
+        });
+
+        auto inputs = randomInputs(access);
+        if (!inputs.empty()) {
+            benchmark::RegisterBenchmark("Input::getSpentTx/random", [&access, inputs](benchmark::State &state) {
+                cycleThrough(state, inputs, [&](const InputPointer &pointer) {
+                    auto spentTx = Input(pointer, access).getSpentTx();
+                    benchmark::DoNotOptimize(spentTx);
+                });
+            });
+        }
+
+        std::vector<uint256> txHashes;
+        txHashes.reserve(random.size());
+        for (auto txNum : random) {
+            txHashes.push_back(*chainAccess.getTxHash(txNum));
+        }
+        benchmark::RegisterBenchmark("HashIndex::getTxIndex/random", [&access, txHashes](benchmark::State &state) {
+            auto &hashIndex = access.getHashIndex();
+            cycleThrough(state, txHashes, [&](const uint256 &txHash) {
+                benchmark::DoNotOptimize(hashIndex.getTxIndex(txHash));
+            });
+        });
+        benchmark::RegisterBenchmark("HashIndex::getTxIndexes/random", [&access, txHashes](benchmark::State &state) {
+            auto &hashIndex = access.getHashIndex();
+            for (auto _ : state) {
+                benchmark::DoNotOptimize(hashIndex.getTxIndexes(txHashes));
+            }
+            state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * txHashes.size()));
+        })->Unit(benchmark::kMillisecond);
+
+        auto addresses = randomAddresses(access);
+        if (!addresses.empty()) {
+            benchmark::RegisterBenchmark("AddressIndex::getOutputPointers/random", [&access, addresses](benchmark::State &state) {
+                auto &addressIndex = access.getAddressIndex();
+                int64_t outputCount = 0;
+                cycleThrough(state, addresses, [&](const RawAddress &address) {
+                    for (auto pointer : addressIndex.getOutputPointers(address)) {
+                        benchmark::DoNotOptimize(pointer);
+                        outputCount++;
+                    }
+                });
+                state.counters["outputs"] = benchmark::Counter(static_cast<double>(outputCount), benchmark::Counter::kIsRate);
+            });
+        }
+    }
+
+    /** Random pairs over elementCount elements, roughly what the change and multi-input heuristics hand to the clusterer */
+    std::vector<std::pair<uint32_t, uint32_t>> randomPairs(uint32_t elementCount) {
+        std::mt19937 generator(sampleSeed);
+        std::uniform_int_distribution<uint32_t> distribution(0, elementCount - 1);
+        std::vector<std::pair<uint32_t, uint32_t>> pairs(elementCount);
+        for (auto &pair : pairs) {
+            pair = {distribution(generator), distribution(generator)};
+        }
+        return pairs;
+    }
+
+    void benchmarkDisjointSetsUnite(benchmark::State &state) {
+        auto elementCount = static_cast<uint32_t>(state.range(0));
+        auto pairs = randomPairs(elementCount);
+        for (auto _ : state) {
+            state.PauseTiming();
+            ConcurrentDisjointSets sets(elementCount);
+            state.ResumeTiming();
+            for (auto &pair : pairs) {
+                sets.unite(pair.first, pair.second);
+            }
+            benchmark::ClobberMemory();
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * pairs.size()));
+    }
+
+    void benchmarkDisjointSetsFind(benchmark::State &state) {
+        auto elementCount = static_cast<uint32_t>(state.range(0));
+        auto pairs = randomPairs(elementCount);
+        ConcurrentDisjointSets sets(elementCount);
+        for (size_t i = 0; i < pairs.size() / 2; i++) {
+            sets.unite(pairs[i].first, pairs[i].second);
+        }
+        for (auto _ : state) {
+            for (uint32_t i = 0; i < elementCount; i++) {
+                benchmark::DoNotOptimize(sets.find(i));
+            }
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * elementCount));
+    }
+
+    void benchmarkDoubleSha256(benchmark::State &state) {
+        std::vector<char> message(static_cast<size_t>(state.range(0)), 'b');
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(doubleSha256(message.data(), message.size()));
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * message.size()));
+    }
+
+    void benchmarkDoubleSha256Batch(benchmark::State &state) {
+        constexpr size_t batchSize = 64;
+        std::vector<char> message(static_cast<size_t>(state.range(0)), 'b');
+        std::vector<HashInput> inputs(batchSize, HashInput{{message.data(), nullptr, nullptr}, {message.size(), 0, 0}});
+        std::vector<uint256> hashes(batchSize);
+        for (auto _ : state) {
+            doubleSha256Batch(inputs.data(), inputs.size(), hashes.data());
+            benchmark::ClobberMemory();
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * batchSize * message.size()));
+    }
+}
+
+void registerMicroBenchmarks(Blockchain &chain) {
+    registerChainBenchmarks(chain);
+
+    benchmark::RegisterBenchmark("DisjointSets::unite", benchmarkDisjointSetsUnite)->Arg(1 << 16)->Arg(1 << 22)->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark("DisjointSets::find", benchmarkDisjointSetsFind)->Arg(1 << 16)->Arg(1 << 22)->Unit(benchmark::kMillisecond);
+
+    // Block header, typical transaction and a large transaction
+    benchmark::RegisterBenchmark("doubleSha256", benchmarkDoubleSha256)->Arg(80)->Arg(250)->Arg(4096);
+    benchmark::RegisterBenchmark("doubleSha256Batch", benchmarkDoubleSha256Batch)->Arg(80)->Arg(250)->Arg(4096);
+}
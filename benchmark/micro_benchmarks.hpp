@@ -0,0 +1,19 @@
+//
+//  micro_benchmarks.hpp
+//  blocksci_benchmark
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef micro_benchmarks_hpp
+#define micro_benchmarks_hpp
+
+namespace blocksci {
+    class Blockchain;
+}
+
+/** Register the benchmarks of the individual hot paths of queries (data file lookups, tx and input construction,
+ * index lookups, union-find and hashing) against the given chain, which has to outlive the benchmark run */
+void registerMicroBenchmarks(blocksci::Blockchain &chain);
+
+#endif /* micro_benchmarks_hpp */
@@ -0,0 +1,24 @@
+#!/bin/bash
+# Parse a synthetic chain end to end and write the wall time and the final parser telemetry as JSON
+#
+# Usage: parser-benchmark.sh <work directory> <output.json> [synthesize-chain options, eg. --txes 10000000]
+# The block files are synthesized once per work directory and reused by later runs, the parsed data is not.
+set -e
+
+work_dir=$1
+output=$2
+shift 2
+
+mkdir -p "$work_dir"
+config="$work_dir/config.json"
+if [ ! -d "$work_dir/coin/blocks" ]; then
+    blocksci_parser "$config" synthesize-chain "$work_dir/coin" "$work_dir/data" "$@"
+fi
+rm -rf "$work_dir/data"
+mkdir -p "$work_dir/data"
+
+start=$(date +%s.%N)
+blocksci_parser "$config" update
+end=$(date +%s.%N)
+
+printf '{"seconds": %s, "telemetry": %s}\n' "$(echo "$end - $start" | bc)" "$(cat "$work_dir/data/parser_telemetry.json")" > "$output"
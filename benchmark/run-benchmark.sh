@@ -0,0 +1,22 @@
+#!/bin/bash
+# Run blocksci_benchmark and write its results as JSON
+#
+# Usage: run-benchmark.sh <blocksci_benchmark> <output.json> [blocksci config] [benchmark options]
+# Without a config the regtest chain in test/files/btc is parsed into a temporary directory first.
+set -e
+
+benchmark_binary=$1
+output=$2
+config=$3
+shift 3 || shift $#
+
+if [ -z "$config" ]; then
+    chain_dir=$(mktemp -d)
+    trap 'rm -rf "$chain_dir"' EXIT
+    self_dir=$(cd "$(dirname "$0")" && pwd)
+    config="$chain_dir/config.json"
+    blocksci_parser "$config" generate-config bitcoin_regtest "$chain_dir" --disk "$self_dir/../test/files/btc/regtest/"
+    blocksci_parser "$config" update
+fi
+
+"$benchmark_binary" "$config" "$@" --benchmark_out="$output" --benchmark_out_format=json
@@ -0,0 +1,213 @@
+//
+//  workloads.cpp
+//  blocksci_benchmark
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "workloads.hpp"
+
+#include <blocksci/blocksci.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace blocksci;
+
+namespace {
+    /** Zipf distribution over 1..n with rejection-inversion sampling (Hörmann and Derflinger), which needs no table and
+     * no O(n) normalization, so it works for the hundreds of millions of transactions of the main chain */
+    class ZipfDistribution {
+        double exponent;
+        double n;
+        double hIntegralX1;
+        double hIntegralN;
+        double s;
+
+        static double helper1(double x) {
+            return std::abs(x) > 1e-8 ? std::log1p(x) / x : 1 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+        }
+
+        static double helper2(double x) {
+            return std::abs(x) > 1e-8 ? std::expm1(x) / x : 1 + x * 0.5 * (1 + x * (1.0 / 3.0) * (1 + 0.25 * x));
+        }
+
+        double h(double x) const {
+            return std::exp(-exponent * std::log(x));
+        }
+
+        double hIntegral(double x) const {
+            auto logX = std::log(x);
+            return helper2((1 - exponent) * logX) * logX;
+        }
+
+        double hIntegralInverse(double x) const {
+            auto t = std::max(x * (1 - exponent), -1.0);
+            return std::exp(helper1(t) * x);
+        }
+
+    public:
+        ZipfDistribution(uint32_t n_, double exponent_) : exponent(exponent_), n(n_) {
+            hIntegralX1 = hIntegral(1.5) - 1;
+            hIntegralN = hIntegral(n + 0.5);
+            s = 2 - hIntegralInverse(hIntegral(2.5) - h(2));
+        }
+
+        /** Rank between 1 and n, 1 being the most popular */
+        template <typename Generator>
+        uint32_t operator()(Generator &generator) {
+            std::uniform_real_distribution<double> uniform(0, 1);
+            while (true) {
+                auto u = hIntegralN + uniform(generator) * (hIntegralX1 - hIntegralN);
+                auto x = hIntegralInverse(u);
+                auto k = std::min(std::max(std::floor(x + 0.5), 1.0), n);
+                if (k - x <= s || u >= hIntegral(k + 0.5) - h(k)) {
+                    return static_cast<uint32_t>(k);
+                }
+            }
+        }
+    };
+
+    /** Append the txNums of pointers to workload until it has length entries, returns false once it is full */
+    template <typename Range>
+    bool appendTxNums(std::vector<uint32_t> &workload, Range &&pointers, size_t length) {
+        for (const auto &pointer : pointers) {
+            if (workload.size() >= length) {
+                return false;
+            }
+            workload.push_back(pointer.txNum);
+        }
+        return workload.size() < length;
+    }
+
+    /** Repeat the prefix of workload until it has length entries */
+    void repeatToLength(std::vector<uint32_t> &workload, size_t length) {
+        auto period = workload.size();
+        for (size_t i = 0; period > 0 && workload.size() < length; i++) {
+            workload.push_back(workload[i % period]);
+        }
+    }
+}
+
+std::vector<uint32_t> uniformWorkload(uint32_t txCount, uint32_t seed) {
+    std::vector<uint32_t> workload(txCount);
+    std::iota(workload.begin(), workload.end(), 0);
+    std::shuffle(workload.begin(), workload.end(), std::mt19937(seed));
+    return workload;
+}
+
+std::vector<uint32_t> zipfianWorkload(uint32_t txCount, size_t length, double exponent, uint32_t seed) {
+    std::vector<uint32_t> workload;
+    if (txCount == 0) {
+        return workload;
+    }
+    // Scatter the ranks over the chain with a multiplicative permutation, so that the popular transactions are not
+    // all stored next to each other. The multiplier is prime, so it is a permutation unless it divides txCount.
+    uint64_t multiplier = 2654435761;
+    if (txCount % multiplier == 0) {
+        multiplier = 1;
+    }
+    ZipfDistribution zipf(txCount, exponent);
+    std::mt19937_64 generator(seed);
+    workload.reserve(length);
+    for (size_t i = 0; i < length; i++) {
+        auto rank = zipf(generator) - 1;
+        workload.push_back(static_cast<uint32_t>((rank * multiplier) % txCount));
+    }
+    return workload;
+}
+
+std::vector<uint32_t> recentWorkload(Blockchain &chain, size_t length, double meanBlockAge, uint32_t seed) {
+    std::vector<uint32_t> workload;
+    auto blockCount = static_cast<int64_t>(chain.size());
+    if (blockCount == 0) {
+        return workload;
+    }
+    std::mt19937_64 generator(seed);
+    std::exponential_distribution<double> age(1 / meanBlockAge);
+    workload.reserve(length);
+    for (size_t i = 0; i < length; i++) {
+        auto blockAge = std::min(static_cast<int64_t>(age(generator)), blockCount - 1);
+        auto block = chain[static_cast<BlockHeight>(blockCount - 1 - blockAge)];
+        std::uniform_int_distribution<uint32_t> tx(block.firstTxIndex(), block.endTxIndex() - 1);
+        workload.push_back(tx(generator));
+    }
+    return workload;
+}
+
+std::vector<uint32_t> addressWorkload(const std::vector<Address> &addresses, size_t length) {
+    std::vector<uint32_t> workload;
+    workload.reserve(length);
+    for (auto &address : addresses) {
+        if (!appendTxNums(workload, address.getOutputPointers(), length)) {
+            break;
+        }
+    }
+    repeatToLength(workload, length);
+    return workload;
+}
+
+std::vector<uint32_t> clusterWorkload(const ClusterManager &clusters, const std::vector<Address> &addresses, size_t length) {
+    std::vector<uint32_t> workload;
+    workload.reserve(length);
+    std::unordered_set<uint32_t> visitedClusters;
+    for (auto &address : addresses) {
+        auto cluster = clusters.getCluster(address);
+        if (!visitedClusters.insert(cluster.clusterNum).second) {
+            continue;
+        }
+        if (!appendTxNums(workload, cluster.getOutputPointers(), length)) {
+            break;
+        }
+    }
+    repeatToLength(workload, length);
+    return workload;
+}
+
+std::vector<Address> popularAddresses(Blockchain &chain, const std::string &tagFile, size_t count, uint32_t recentBlocks) {
+    std::vector<Address> addresses;
+    if (!tagFile.empty()) {
+        std::ifstream file(tagFile);
+        if (!file) {
+            throw std::invalid_argument("Could not open tag file " + tagFile);
+        }
+        std::string line;
+        while (std::getline(file, line) && addresses.size() < count) {
+            auto addressString = line.substr(0, line.find(','));
+            if (auto address = getAddressFromString(addressString, chain.getAccess())) {
+                addresses.push_back(*address);
+            }
+        }
+        return addresses;
+    }
+
+    auto blockCount = static_cast<uint32_t>(chain.size());
+    auto firstBlock = blockCount - std::min(blockCount, recentBlocks);
+    std::unordered_map<Address, uint64_t> outputCounts;
+    for (auto height = firstBlock; height < blockCount; height++) {
+        RANGES_FOR(auto tx, chain[static_cast<BlockHeight>(height)]) {
+            for (auto output : tx.outputs()) {
+                outputCounts[output.getAddress()]++;
+            }
+        }
+    }
+    std::vector<std::pair<Address, uint64_t>> counted(outputCounts.begin(), outputCounts.end());
+    auto top = std::min(count, counted.size());
+    std::partial_sort(counted.begin(), counted.begin() + static_cast<int64_t>(top), counted.end(), [](const auto &a, const auto &b) {
+        return a.second > b.second;
+    });
+    for (size_t i = 0; i < top; i++) {
+        addresses.push_back(counted[i].first);
+    }
+    return addresses;
+}
+
+size_t distinctTxCount(const std::vector<uint32_t> &workload) {
+    return std::unordered_set<uint32_t>(workload.begin(), workload.end()).size();
+}
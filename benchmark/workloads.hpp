@@ -0,0 +1,47 @@
+//
+//  workloads.hpp
+//  blocksci_benchmark
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef workloads_hpp
+#define workloads_hpp
+
+#include <blocksci/address/address.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace blocksci {
+    class Blockchain;
+    class ClusterManager;
+}
+
+/** Sequences of txNums visited by the random access benchmarks
+ *
+ * Uniform visits every transaction once in a random order. The skewed workloads model real queries: Zipfian draws txNums
+ * with a Zipf distribution whose popular transactions are scattered over the whole chain, recent draws block ages from an
+ * exponential distribution so that most lookups hit the tip of the chain, address-centric visits the transactions
+ * paying the given popular addresses one address after the other and cluster-centric does the same for the whole
+ * clusters of these addresses. The skewed workloads have `length` entries, the address and cluster centric ones
+ * start over with the first address when they run out of transactions.
+ */
+std::vector<uint32_t> uniformWorkload(uint32_t txCount, uint32_t seed);
+std::vector<uint32_t> zipfianWorkload(uint32_t txCount, size_t length, double exponent, uint32_t seed);
+std::vector<uint32_t> recentWorkload(blocksci::Blockchain &chain, size_t length, double meanBlockAge, uint32_t seed);
+std::vector<uint32_t> addressWorkload(const std::vector<blocksci::Address> &addresses, size_t length);
+std::vector<uint32_t> clusterWorkload(const blocksci::ClusterManager &clusters, const std::vector<blocksci::Address> &addresses, size_t length);
+
+/** Addresses the address and cluster centric workloads start from, most popular first
+ *
+ * Reads them from tagFile, which holds one address per line optionally followed by a comma and its tag, in the order of
+ * the file. Without a tag file these are the count addresses receiving the most outputs in the last recentBlocks blocks.
+ */
+std::vector<blocksci::Address> popularAddresses(blocksci::Blockchain &chain, const std::string &tagFile, size_t count, uint32_t recentBlocks);
+
+/** Number of distinct txNums of a workload, reported next to its timing */
+size_t distinctTxCount(const std::vector<uint32_t> &workload);
+
+#endif /* workloads_hpp */
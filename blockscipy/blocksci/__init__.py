@@ -18,13 +18,11 @@ import re
 import heapq
 import operator
 import time
-from functools import reduce
+from functools import lru_cache, reduce
+from collections import deque, namedtuple
 
 import psutil
-from multiprocess import Pool
-import dateparser
-from dateutil.relativedelta import relativedelta
-import pandas as pd
+import multiprocess
 
 from ._blocksci import *
 from ._blocksci import _traverse
@@ -32,6 +30,13 @@ from .currency import *
 from .blockchain_info import *
 from .opreturn import label_application
 from .pickler import *
+from .query_cache import QueryCache
+from .distributed import DistributedChain, DEFAULT_PORT
+from .explain import explain, chain_stats, QueryPlan
+from .proxy_cache import cached_proxy, clear_proxy_cache
+from .lazy_import import lazy_import
+
+pd = lazy_import("pandas")
 
 VERSION = "0.7.0"
 
@@ -64,8 +69,44 @@ if time.tzname != ('UTC', 'UTC'):
 
 
 
-def mapreduce_block_ranges(chain, map_func, reduce_func, init=MISSING_PARAM, start=None, end=None, cpu_count=psutil.cpu_count()):
+_worker_state = {}
+
+
+def _init_worker(config_location, max_block, map_func):
+    """Runs once in each process of the mapreduce_block_ranges pool
+
+    Forked processes inherit the imported module and map_func instead of unpickling them, only the chain is opened again
+    since RocksDB handles don't survive a fork. Its indexes are opened on first use, so this just maps the data files.
+    """
+    _worker_state["chain"] = Blockchain(config_location, max_block)
+    _worker_state["map_func"] = map_func
+
+
+def _run_worker_segment(segment):
+    file = io.BytesIO()
+    pickler = Pickler(file)
+    mapped = _worker_state["map_func"](_worker_state["chain"][segment[0]:segment[1]])
+    pickler.dump(mapped)
+    file.seek(0)
+    return file
+
+
+def _worker_context():
+    if "fork" in multiprocess.get_all_start_methods():
+        return multiprocess.get_context("fork")
+    return multiprocess.get_context()
+
+
+def mapreduce_block_ranges(chain, map_func, reduce_func, init=MISSING_PARAM, start=None, end=None, cpu_count=psutil.cpu_count(), weight="tx", lazy_lists=False):
     """Initialized multithreaded map reduce function over a stream of block ranges
+
+    The blocks are split into one range per process balancing the given weight: "tx" for the number of
+    transactions, "inouts" for the number of inputs plus outputs or a function returning the cost of a block.
+
+    Every process opens the chain once and pickles its result. Lists of BlockSci objects are sent as arrays of their
+    indexes and, with lazy_lists, handed to reduce_func as BlockSci ranges instead of lists. Maps that can be written
+    as an integer or boolean proxy run much faster in process with chain.map_reduce(proxy, reducer), and group_by
+    with a count, sum, min, max, mean or distinct count per key with chain.group_aggregate(key, value, aggregate).
     """
     if start is None:
         start = 0
@@ -77,25 +118,15 @@ def mapreduce_block_ranges(chain, map_func, reduce_func, init=MISSING_PARAM, sta
         end = blocks[-1].height
 
     if cpu_count == 1:
-        return mapFunc(chain[start:end])
-
-    raw_segments = chain._segment_indexes(start, end, cpu_count)
-    segments = [(raw_segment, chain.config_location, len(chain)) for raw_segment in raw_segments]
-
-    def real_map_func(input):
-        local_chain = Blockchain(input[1], input[2])
-        file = io.BytesIO()
-        pickler = Pickler(file)
-        mapped = map_func(local_chain[input[0][0]:input[0][1]])
-        pickler.dump(mapped)
-        file.seek(0)
-        return file
-
-    with Pool(cpu_count - 1) as p:
-        results_future = p.map_async(real_map_func, segments[1:])
+        return map_func(chain[start:end])
+
+    raw_segments = chain._segment_indexes(start, end, cpu_count, weight)
+
+    with _worker_context().Pool(cpu_count - 1, _init_worker, (chain.config_location, len(chain), map_func)) as p:
+        results_future = p.map_async(_run_worker_segment, raw_segments[1:])
         first = map_func(chain[raw_segments[0][0]:raw_segments[0][1]])
         results = results_future.get()
-        results = [Unpickler(res, chain).load() for res in results]
+        results = [Unpickler(res, chain, lazy_lists).load() for res in results]
     results.insert(0, first)
     if isinstance(init, type(MISSING_PARAM)):
         return reduce(reduce_func, results)
@@ -103,8 +134,8 @@ def mapreduce_block_ranges(chain, map_func, reduce_func, init=MISSING_PARAM, sta
         return reduce(reduce_func, results, init)
 
 
-def mapreduce_blocks(chain, map_func, reduce_func, init=MISSING_PARAM, start=None, end=None, cpu_count=psutil.cpu_count()):
-    """Initialized multithreaded map reduce function over a stream of blocks
+def mapreduce_blocks(chain, map_func, reduce_func, init=MISSING_PARAM, start=None, end=None, cpu_count=psutil.cpu_count(), weight="tx"):
+    """Initialized multithreaded map reduce function over a stream of blocks, see mapreduce_block_ranges for weight
     """
     def map_range_func(blocks):
         if isinstance(init, type(MISSING_PARAM)):
@@ -122,12 +153,13 @@ def mapreduce_blocks(chain, map_func, reduce_func, init=MISSING_PARAM, start=Non
         init,
         start,
         end,
-        cpu_count
+        cpu_count,
+        weight
     )
 
 
-def mapreduce_txes(chain, map_func, reduce_func, init=MISSING_PARAM, start=None, end=None, cpu_count=psutil.cpu_count()):
-    """Initialized multithreaded map reduce function over a stream of transactions
+def mapreduce_txes(chain, map_func, reduce_func, init=MISSING_PARAM, start=None, end=None, cpu_count=psutil.cpu_count(), weight="tx"):
+    """Initialized multithreaded map reduce function over a stream of transactions, see mapreduce_block_ranges for weight
     """
     def map_range_func(blocks):
         if isinstance(init, type(MISSING_PARAM)):
@@ -148,7 +180,8 @@ def mapreduce_txes(chain, map_func, reduce_func, init=MISSING_PARAM, start=None,
         init,
         start,
         end,
-        cpu_count
+        cpu_count,
+        weight
     )
 
 
@@ -243,6 +276,114 @@ def filter_txes_legacy(
     )
 
 
+def _chain_table(table):
+    if isinstance(table, str):
+        try:
+            return getattr(chain_table, table)
+        except AttributeError:
+            raise ValueError("Unknown table {}, expected blocks, txes, inputs or outputs".format(table))
+    return table
+
+
+def _table_data(self, table, columns, start, end, hex_hashes=False):
+    start = 0 if start is None else start
+    end = -1 if end is None else end
+    data = self._table_columns(_chain_table(table), list(columns or []), start, end)
+    return _hex_hash_columns(data) if hex_hashes else data
+
+
+def _hex_hash_columns(data):
+    for name, values in data.items():
+        if values.dtype.kind == "S":
+            data[name] = hashes_to_hex(values)
+    return data
+
+
+def _arrow_arrays(data):
+    import pyarrow as pa
+
+    arrays = []
+    for values in data.values():
+        if values.dtype.kind == "S":
+            arrays.append(pa.array(values, type=pa.binary(values.dtype.itemsize)))
+        else:
+            arrays.append(pa.array(values))
+    return arrays
+
+
+def to_arrow(self, table="outputs", columns=None, start=None, end=None, hex_hashes=False):
+    """Return a pyarrow Table with one row per block, tx, input or output in the
+    blocks [start, end) of the chain.
+
+    All requested columns (all of Blockchain.table_columns(table) by default)
+    are computed natively in one parallel pass. Numeric columns are handed to
+    Arrow without copying, hash columns become fixed size binary columns. They
+    hold the raw 32 bytes of the hashes, or with hex_hashes=True the 64 chars of
+    str(hash), converted in bulk by hashes_to_hex.
+    """
+    import pyarrow as pa
+
+    data = _table_data(self, table, columns, start, end, hex_hashes)
+    return pa.Table.from_arrays(_arrow_arrays(data), names=list(data.keys()))
+
+
+def to_pandas(self, table="outputs", columns=None, start=None, end=None, hex_hashes=False):
+    """Return a pandas DataFrame with the same columns as to_arrow"""
+    return pd.DataFrame(_table_data(self, table, columns, start, end, hex_hashes))
+
+
+def iter_batches(self, table="outputs", columns=None, batch_size=1 << 20, start=None, end=None, arrow=False, prefetch=2, hex_hashes=False):
+    """Iterate over the rows of the blocks [start, end) of the chain in batches,
+    without holding the whole table in memory.
+
+    Yields dicts of numpy arrays with the same columns as to_arrow, or pyarrow
+    RecordBatches with arrow=True. A batch holds the rows of whole blocks, as
+    many as fit into batch_size rows and at least one block. A background
+    thread builds up to prefetch batches ahead without the GIL, so producing
+    the next batch overlaps with processing the current one.
+    """
+    start = 0 if start is None else start
+    end = -1 if end is None else end
+    stream = self._table_batches(_chain_table(table), list(columns or []), batch_size, prefetch, start, end)
+    if hex_hashes:
+        stream = (_hex_hash_columns(data) for data in stream)
+    if not arrow:
+        return stream
+    return _arrow_batches(stream)
+
+
+def _arrow_batches(stream):
+    import pyarrow as pa
+
+    for data in stream:
+        yield pa.RecordBatch.from_arrays(_arrow_arrays(data), names=list(data.keys()))
+
+
+def block_stats(self, start=None, end=None):
+    """Return a pandas DataFrame indexed by height with the per block statistics
+    the parser stores in chain/block_stats.dat: transaction, input and output
+    counts, fees, input and output values, size, weight, the number of segwit
+    transactions and the number of outputs of every address type.
+
+    The integer columns alias the memory mapped file without a chain scan, so
+    eg. the fees per day are
+    chain.block_stats().groupby(pd.Grouper(key="time", freq="D")).total_fee.sum()
+    """
+    data = self.column(chain_column.block_stats)
+    start = 0 if start is None else start
+    end = len(data["tx_count"]) if end is None else end
+    df = pd.DataFrame({name: values[start:end] for name, values in data.items()},
+                      index=pd.RangeIndex(start, end, name="height"), copy=False)
+    df["time"] = pd.to_datetime(df["timestamp"], unit="s")
+    df["average_fee_rate"] = df["total_fee"] / df["fee_virtual_size"].where(df["fee_virtual_size"] > 0)
+    df["segwit_share"] = df["segwit_tx_count"] / df["tx_count"].where(df["tx_count"] > 0)
+    return df
+
+
+Blockchain.to_arrow = to_arrow
+Blockchain.to_pandas = to_pandas
+Blockchain.iter_batches = iter_batches
+Blockchain.block_stats = block_stats
 Blockchain.map_blocks = map_blocks
 Blockchain.filter_blocks = filter_blocks
 Blockchain.filter_blocks_legacy = filter_blocks_legacy
@@ -264,14 +405,10 @@ def block_range(self, start, end=None) -> BlockRange:
     """
     Return the range of blocks mined between the given dates
     """
-    if self.block_times is None:
-        self.block_times = pd.DataFrame([block.time for block in self], columns=["date"])
-        self.block_times["height"] = self.block_times.index
-        self.block_times.index = self.block_times["date"]
-        del self.block_times["date"]
-
     start_date = pd.to_datetime(start)
     if end is None:
+        import dateparser
+        from dateutil.relativedelta import relativedelta
         res = dateparser.DateDataParser().get_date_data(start)
         if res['period'] == 'month':
             end = start_date + relativedelta(months=1)
@@ -282,10 +419,7 @@ def block_range(self, start, end=None) -> BlockRange:
     else:
         end = pd.to_datetime(end)
 
-    oldest = self.block_times[self.block_times.index >= start_date].iloc[0][0]
-    newest = self.block_times[self.block_times.index <= end].iloc[-1][0] + 1
-
-    return self[oldest:newest]
+    return self._range_between_times(start_date.to_pydatetime(), end.to_pydatetime())
 
 
 old_init = Blockchain.__init__
@@ -312,6 +446,8 @@ def new_init(self, loc, max_block=0):
 
 
 def most_valuable_addresses(self, nlargest=100):
+    if self.has_address_stats():
+        return self.top_addresses(nlargest, address_stats_field.balance)
     current_address_vals = self.blocks.outputs.where(lambda o: ~o.is_spent) \
     .group_by( \
         lambda output: output.address, \
@@ -319,10 +455,100 @@ def most_valuable_addresses(self, nlargest=100):
     )
     return heapq.nlargest(nlargest, current_address_vals.items(), key=operator.itemgetter(1))
 
+BlockRollback = namedtuple("BlockRollback", "height")
+BlockRollback.__doc__ = "Yielded by Blockchain.follow when a reorg replaced the blocks from height on, which are yielded again next"
+
+
+def follow(self, start=None, poll_interval=5.0, reorg_depth=100):
+    """Generator yielding every block from start on (by default the next new block), waiting for the parser to append more
+
+    While waiting it only compares the data generation and the size of the block file every poll_interval seconds.
+    New blocks are picked up by reloading the chain, which invalidates the objects yielded before. If a reorg replaced
+    one of the last reorg_depth yielded blocks, a BlockRollback with the first replaced height is yielded and the
+    following blocks start again from that height.
+    """
+    height = len(self) if start is None else start
+    yielded = deque(maxlen=reorg_depth)
+    while True:
+        while height < len(self):
+            block = self[height]
+            yielded.append((height, str(block.hash)))
+            yield block
+            height += 1
+        generation = self.data_generation()
+        while self.data_generation() == generation and self.disk_block_count() == len(self):
+            time.sleep(poll_interval)
+        self.reload()
+        fork = height
+        while yielded and (yielded[-1][0] >= len(self) or str(self[yielded[-1][0]].hash) != yielded[-1][1]):
+            fork = yielded.pop()[0]
+        if fork < height:
+            height = fork
+            yield BlockRollback(fork)
+
 Blockchain.__init__ = new_init
 Blockchain.range = block_range
 Blockchain.heights_to_dates = heights_to_dates
 Blockchain.most_valuable_addresses = most_valuable_addresses
+Blockchain.follow = follow
+
+
+class AccessProfile:
+    """Context manager measuring the hot-path data accesses of the code it wraps, see Blockchain.profile"""
+
+    def __init__(self, chain, report=True):
+        self._chain = chain
+        self._report = report
+        self._start = None
+        self.stats = None
+
+    def __enter__(self):
+        self.stats = None
+        self._start = self._chain.stats()
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        self.stats = self._chain.stats() - self._start
+        if self._report:
+            print(self.stats)
+        return False
+
+
+def profile(self, report=True):
+    """Measure the accesses (tx decodes, script loads, index lookups etc.) made inside a with block
+
+    The counts are only collected by builds configured with -DBLOCKSCI_INSTRUMENTATION=ON and include the accesses of
+    all threads of the process. After the block the AccessStats delta is available as the stats attribute and printed
+    if report is set:
+
+        with chain.profile() as p:
+            chain.blocks.txes.fee.sum()
+        p.stats["tx_decode"].count
+    """
+    return AccessProfile(self, report)
+
+Blockchain.profile = profile
+
+def query_cache(self, directory=None):
+    """Open the persistent QueryCache of this chain, stored in directory (by default inside the data directory)"""
+    return QueryCache(self, directory)
+
+Blockchain.query_cache = query_cache
+
+def distributed(self, hosts, authkey=None, port=DEFAULT_PORT, shard_tx_count=None):
+    """Run map reduce jobs on the workers of several hosts holding replicas of this chain's data directory
+
+    hosts are host names or host:port pairs running `python -m blocksci.distributed`, authkey is their shared secret
+    (by default $BLOCKSCI_DISTRIBUTED_AUTHKEY). Every shard of shard_tx_count transactions (about 8 million by
+    default) is sent to the same host on every query to make use of its page cache:
+
+        chain.distributed(["node1", "node2"]).map_reduce(lambda blocks: sum(block.tx_count for block in blocks), operator.add)
+    """
+    return DistributedChain(self, hosts, authkey, port, shard_tx_count)
+
+Blockchain.distributed = distributed
+
+Blockchain.explain = explain
 
 def traverse(proxy_func, val):
     return _traverse(proxy_func(val._self_proxy), val)
@@ -348,33 +574,51 @@ def setup_optional_proxy_map_funcs():
         getattr(proxy, cl).map = optional_map_func
 
 def setup_sequence_map_funcs():
+    # The proxy of a range class is the same for all its instances, so the built proxies are cached per class
     def range_map_func(r, func):
-        p = func(r._self_proxy.nested_proxy)
-        return apply_map(r._self_proxy, p)(r)
+        def build():
+            return apply_map(r._self_proxy, func(r._self_proxy.nested_proxy))
+        return cached_proxy("map", type(r), (func,), build)(r)
 
     def range_where_func(r, func):
-        p = func(r._self_proxy.nested_proxy)
-        return r._self_proxy._where(p)(r)
+        source = getattr(r, "_pushdown_source", None)
+        if source is not None and source[3] in ("tx", "output"):
+            # Predicates on fee, block_height, value, address_type and address are answered from columns and indexes
+            predicate = cached_proxy("where_predicate", type(r), (func,), lambda: func(r._self_proxy.nested_proxy))
+            if isinstance(predicate, proxy.boolProxy):
+                chain, start, stop, table = source
+                result = chain._where_pushdown(predicate, table, start, stop)
+                if result is not None:
+                    return result
+
+        def build():
+            return r._self_proxy._where(func(r._self_proxy.nested_proxy))
+        return cached_proxy("where", type(r), (func,), build)(r)
 
     def range_max_func(r, func):
-        p = func(r._self_proxy.nested_proxy)
-        return r._self_proxy._max(p)(r)
+        def build():
+            return r._self_proxy._max(func(r._self_proxy.nested_proxy))
+        return cached_proxy("max", type(r), (func,), build)(r)
 
     def range_min_func(r, func):
-        p = func(r._self_proxy.nested_proxy)
-        return r._self_proxy._min(p)(r)
+        def build():
+            return r._self_proxy._min(func(r._self_proxy.nested_proxy))
+        return cached_proxy("min", type(r), (func,), build)(r)
 
     def range_any_func(r, func):
-        p = func(r._self_proxy.nested_proxy)
-        return r._self_proxy._any(p)(r)
+        def build():
+            return r._self_proxy._any(func(r._self_proxy.nested_proxy))
+        return cached_proxy("any", type(r), (func,), build)(r)
 
     def range_all_func(r, func):
-        p = func(r._self_proxy.nested_proxy)
-        return r._self_proxy._all(p)(r)
+        def build():
+            return r._self_proxy._all(func(r._self_proxy.nested_proxy))
+        return cached_proxy("all", type(r), (func,), build)(r)
 
     def range_group_by_func(r, grouper_func, evaler_func):
-        grouper = grouper_func(r._self_proxy.nested_proxy)
-        evaler = evaler_func(r._self_proxy.nested_proxy.range_proxy)
+        def build():
+            return grouper_func(r._self_proxy.nested_proxy), evaler_func(r._self_proxy.nested_proxy.range_proxy)
+        grouper, evaler = cached_proxy("group_by", type(r), (grouper_func, evaler_func), build)
         return r._group_by(grouper, evaler)
 
     iterator_and_range_cls = [x for x in globals() if ('Iterator' in x or 'Range' in x) and x[0].isupper()]
@@ -447,12 +691,31 @@ def _get_properties_methods(obj):
     return (attr for attr in dir(obj) if attr not in non_copying_methods and
             isinstance(getattr(obj, attr, None), property))
 
+# Property whose docstring is only built when it is first read, e.g. by help(). The docstrings of the patched
+# properties name the type they return, which would take building the proxy of every property on import.
+class _LazyDocProperty(property):
+    def __init__(self, fget, doc_func):
+        self._doc_func = doc_func
+        self._doc = None
+        super().__init__(fget)
+
+    def _get_doc(self):
+        if self._doc is None:
+            self._doc = self._doc_func()
+        return self._doc
+
+    def _set_doc(self, doc):
+        pass
+
+    __doc__ = property(_get_doc, _set_doc)
+
 # https://gist.github.com/carlsmith/b2e6ba538ca6f58689b4c18f46fef11c
 def replace(string, substitutions):
     substrings = sorted(substitutions, key=len, reverse=True)
     regex = re.compile('|'.join(map(re.escape, substrings)))
     return regex.sub(lambda match: substitutions[match.group(0)], string)
 
+@lru_cache(maxsize=None)
 def fix_all_doc_def(doc):
     doc = replace(doc, {
         "blocksci.proxy.intIteratorProxy": "numpy.ndarray[int]",
@@ -466,6 +729,7 @@ def fix_all_doc_def(doc):
     doc = re.sub(r"(blocksci\.proxy\.)([a-zA-Z]+)(IteratorProxy)", r"blocksci.\2Iterator", doc)
     return doc
 
+@lru_cache(maxsize=None)
 def fix_self_doc_def(doc):
     doc = fix_all_doc_def(doc)
     doc = replace(doc, {
@@ -485,6 +749,7 @@ def fix_self_doc_def(doc):
     doc = re.sub(r"(blocksci\.proxy\.)([a-zA-Z]+)(Proxy)", r"blocksci.\2", doc)
     return doc
 
+@lru_cache(maxsize=None)
 def fix_sequence_doc_def(doc):
     doc = fix_all_doc_def(doc)
     doc = replace(doc, {
@@ -499,6 +764,7 @@ def fix_sequence_doc_def(doc):
     doc = re.sub(r"(blocksci\.proxy\.)([a-zA-Z]+)(RangeProxy)", r"blocksci.\2Iterator", doc)
     return doc
 
+@lru_cache(maxsize=None)
 def fix_iterator_doc_def(doc):
     doc = fix_sequence_doc_def(doc)
     doc = replace(doc, {
@@ -510,6 +776,7 @@ def fix_iterator_doc_def(doc):
     doc = re.sub(r"(blocksci\.proxy\.)([a-zA-Z]+)(Proxy)", r"blocksci\.\2Iterator", doc)
     return doc
 
+@lru_cache(maxsize=None)
 def fix_range_doc_def(doc):
     doc = fix_sequence_doc_def(doc)
     doc = replace(doc, {
@@ -531,9 +798,9 @@ def setup_self_methods(main, proxy_obj_type=None, sample_proxy=None):
     existing_properties = set(dir(main))
 
     def self_property_creator(name):
-        prop = property(lambda s: getattr(s._self_proxy, name)(s))
-        prop.__doc__ = str(getattr(proxy_obj_type, name).__doc__) + "\n\n:type: :class:`" + getattr(sample_proxy, name).output_type_name + "`"
-        return prop
+        def doc():
+            return str(getattr(proxy_obj_type, name).__doc__) + "\n\n:type: :class:`" + getattr(sample_proxy, name).output_type_name + "`"
+        return _LazyDocProperty(lambda s: getattr(s._self_proxy, name)(s), doc)
 
     def self_method_creator(name):
         def method(s, *args):
@@ -562,13 +829,13 @@ def setup_iterator_methods(iterator, doc_func=fix_iterator_doc_def, nested_proxy
     def iterator_creator(name):
         def method(s):
             return apply_map(s._self_proxy, getattr(s._self_proxy.nested_proxy, name))(s)
-        prop = property(method)
-        prop.__doc__ = "For each item: " + \
-                       getattr(nested_proxy_cl, name).__doc__ + \
-                       "\n\n:type: :class:`" + \
-                       apply_map(sample_proxy, getattr(sample_proxy.nested_proxy, name)).output_type_name + \
-                       "`"
-        return prop
+        def doc():
+            return "For each item: " + \
+                   getattr(nested_proxy_cl, name).__doc__ + \
+                   "\n\n:type: :class:`" + \
+                   apply_map(sample_proxy, getattr(sample_proxy.nested_proxy, name)).output_type_name + \
+                   "`"
+        return _LazyDocProperty(method, doc)
 
     def iterator_method_creator(name):
         def method(rng, *args):
@@ -648,6 +915,7 @@ setup_self_methods(MultisigAddress)
 setup_self_methods(NonStandardAddress)
 setup_self_methods(OpReturn)
 setup_self_methods(WitnessUnknownAddress)
+setup_self_methods(WitnessTaprootAddress)
 
 setup_self_methods(cluster.Cluster)
 setup_self_methods(cluster.TaggedCluster)
@@ -698,6 +966,65 @@ setup_range_and_proxy_methods(cluster.TaggedClusterRange)
 setup_range_and_proxy_methods(cluster.TaggedAddressRange)
 
 
+def setup_where_pushdown():
+    """Make the ranges derived from chain.blocks or a slice of the chain remember the blocks they came from, which also
+    lets their iter_batches stream the matching table
+
+    A where over their txes or outputs passes the predicate to Blockchain._where_pushdown, which selects the matching
+    items from the fee and output columns and the address index instead of loading every item, if the predicate
+    compares fee, block_height, value, address_type or address with constants.
+    """
+    def tag(rng, chain, start, stop, table):
+        rng._pushdown_source = (chain, start, stop, table)
+        return rng
+
+    def derived_property(cls, name, parent_table, table):
+        prop = getattr(cls, name)
+
+        def getter(rng):
+            result = prop.fget(rng)
+            source = getattr(rng, "_pushdown_source", None)
+            if source is not None and source[3] == parent_table:
+                tag(result, source[0], source[1], source[2], table)
+            return result
+        setattr(cls, name, property(getter, doc=prop.__doc__))
+
+    blocks_prop = Blockchain.blocks
+    Blockchain.blocks = property(lambda chain: tag(blocks_prop.fget(chain), chain, 0, -1, "blocks"), doc=blocks_prop.__doc__)
+
+    chain_getitem = Blockchain.__getitem__
+
+    def getitem(chain, index):
+        result = chain_getitem(chain, index)
+        if isinstance(index, slice):
+            start, stop, _ = index.indices(len(chain))
+            tag(result, chain, start, max(start, stop), "blocks")
+        return result
+    getitem.__doc__ = chain_getitem.__doc__
+    Blockchain.__getitem__ = getitem
+
+    derived_property(BlockRange, "txes", "blocks", "tx")
+    derived_property(BlockRange, "outputs", "blocks", "output")
+    derived_property(BlockRange, "inputs", "blocks", "input")
+    derived_property(TxIterator, "outputs", "tx", "output")
+    derived_property(TxIterator, "inputs", "tx", "input")
+
+    source_tables = {"blocks": "blocks", "tx": "txes", "input": "inputs", "output": "outputs"}
+
+    def range_iter_batches(rng, columns=None, batch_size=1 << 20, arrow=False, prefetch=2, hex_hashes=False):
+        """Iterate over the rows of the items of the range in batches, see Blockchain.iter_batches"""
+        source = getattr(rng, "_pushdown_source", None)
+        if source is None:
+            raise ValueError("iter_batches needs a range derived from chain.blocks or a slice of the chain, such as chain[a:b].txes.outputs")
+        chain, start, stop, table = source
+        return chain.iter_batches(source_tables[table], columns, batch_size, start, stop, arrow, prefetch, hex_hashes)
+
+    for cls in (BlockRange, TxIterator, InputIterator, OutputIterator):
+        cls.iter_batches = range_iter_batches
+
+setup_where_pushdown()
+
+
 def txes_including_output_of_type(txes, typ):
     return txes.where(lambda tx: tx.outputs.any(lambda o: o.address_type == typ))
 
@@ -818,60 +1145,90 @@ heuristics.change_over_txes = change_over_txes
 heuristics.keyset_change_txes = keyset_change_txes
 
 
-first_miner_run = True
-
-
 class DummyClass:
     pass
 
 
 loaderDirectory = os.path.dirname(os.path.abspath(inspect.getsourcefile(DummyClass)))
 
+_ADDITIONAL_MINER_TAGS = {
+    "EclipseMC": "EclipseMC",
+    "poolserverj": "poolserverj",
+    "/stratumPool/": "stratumPool",
+    "/stratum/": "stratum",
+    "/nodeStratum/": "nodeStratum",
+    "BitLC": "BitLC",
+    "/TangPool/": "TangPool",
+    "/Tangpool/": "TangPool",
+    "pool.mkalinin.ru": "pool.mkalinin.ru",
+    "For Pierce and Paul": "Pierce and Paul",
+    "50btc.com": "50btc.com",
+    "七彩神仙鱼": "F2Pool"
+}
+
+_miner_matchers = {}
+
+
+def _load_miner_matcher(address_from_string, pools_file=None):
+    """Build a MinerMatcher from a Blockchain-Known-Pools style pools.json
+
+    The pool tags come first, followed by the tags of pools missing from the
+    file. Payout addresses that the chain has never seen are skipped.
+    """
+    import json
+    if pools_file is None:
+        pools_file = loaderDirectory + "/Blockchain-Known-Pools/pools.json"
+    with open(pools_file) as f:
+        pool_data = json.load(f)
+
+    ids = {}
+
+    def miner_id(name):
+        return ids.setdefault(name, len(ids) + 1)
+
+    tags = [(tag.encode("utf_8"), miner_id(info["name"])) for tag, info in pool_data["coinbase_tags"].items()]
+    tags += [(tag.encode("utf_8"), miner_id(name)) for tag, name in _ADDITIONAL_MINER_TAGS.items()]
+    payouts = []
+    for addr_string, info in pool_data["payout_addresses"].items():
+        address = address_from_string(addr_string)
+        if address is not None:
+            payouts.append((address, miner_id(info["name"])))
+    return MinerMatcher(list(ids), tags, payouts)
+
+
+def _miner_matcher(key, address_from_string, pools_file):
+    matcher = _miner_matchers.get((key, pools_file))
+    if matcher is None:
+        matcher = _load_miner_matcher(address_from_string, pools_file)
+        _miner_matchers[(key, pools_file)] = matcher
+    return matcher
+
 
 def get_miner(block) -> str:
     """
     Get the miner of the block based on the text in the coinbase transaction
+    and the addresses paid by it
+    """
+    access = block._access
+    matcher = _miner_matcher(id(access), access.address_from_string, None)
+    return matcher.name(matcher.miner_of(block))
+
+
+def miner_ids(self, pools_file=None):
+    """Return a pandas Series indexed by height with the miner of every block
+
+    The ids are kept in the derived column "miner_id", so only blocks added
+    since the last call are matched. The Series is categorical and can be
+    joined with block_stats(), eg. the fees earned by every miner are
+    chain.block_stats().join(chain.miner_ids()).groupby("miner").total_fee.sum()
     """
-    global first_miner_run
-    global tagged_addresses
-    global pool_data
-    global coinbase_tag_re
-    if first_miner_run:
-        import json
-        with open(loaderDirectory + "/Blockchain-Known-Pools/pools.json") as f:
-            pool_data = json.load(f)
-        addresses = [block._access.address_from_string(addr_string) for addr_string in pool_data["payout_addresses"]]
-        tagged_addresses = {pointer: pool_data["payout_addresses"][address] for address in addresses if address in pool_data["payout_addresses"]}
-        coinbase_tag_re = re.compile('|'.join(map(re.escape, pool_data["coinbase_tags"])))
-        first_miner_run = False
-    coinbase = block.coinbase_param.decode("utf_8", "replace")
-    tag_matches = re.findall(coinbase_tag_re, coinbase)
-    if tag_matches:
-        return pool_data["coinbase_tags"][tag_matches[0]]["name"]
-    for txout in block.coinbase_tx.outs:
-        if txout.address in tagged_addresses:
-            return tagged_addresses[txout.address]["name"]
-
-    additional_miners = {
-        "EclipseMC": "EclipseMC",
-        "poolserverj": "poolserverj",
-        "/stratumPool/": "stratumPool",
-        "/stratum/": "stratum",
-        "/nodeStratum/": "nodeStratum",
-        "BitLC": "BitLC",
-        "/TangPool/": "TangPool",
-        "/Tangpool/": "TangPool",
-        "pool.mkalinin.ru": "pool.mkalinin.ru",
-        "For Pierce and Paul": "Pierce and Paul",
-        "50btc.com": "50btc.com",
-        "七彩神仙鱼": "F2Pool"
-    }
-
-    for miner in additional_miners:
-        if miner in coinbase:
-            return additional_miners[miner]
-
-    return "Unknown"
+    matcher = _miner_matcher(id(self), self.address_from_string, pools_file)
+    matcher.register(self)
+    self.update_derived_columns()
+    ids = self.derived_column("miner_id")
+    return pd.Series(pd.Categorical.from_codes(ids, categories=matcher.names),
+                     index=pd.RangeIndex(0, len(ids), name="height"), name="miner")
 
 
 Block.miner = get_miner
+Blockchain.miner_ids = miner_ids
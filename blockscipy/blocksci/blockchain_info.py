@@ -1,5 +1,7 @@
-import requests
-import pandas as pd
+from .lazy_import import lazy_import
+
+requests = lazy_import("requests")
+pd = lazy_import("pandas")
 
 class BlockchainInfoData(object):
     def __init__(self, api_key, cache_blocks=False, cache_txs=False):
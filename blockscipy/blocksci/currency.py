@@ -1,14 +1,19 @@
 import datetime
-import requests
-import pandas as pd
 
-try:
-    from IPython.core.display import display
-    def _print_coindesk_info():
-        display('Exchange rates are provided by CoinDesk (https://www.coindesk.com/price/).')
-except ImportError:
-    def _print_coindesk_info():
-        print('Exchange rates are provided by CoinDesk (https://www.coindesk.com/price/).')
+from .lazy_import import lazy_import
+
+requests = lazy_import("requests")
+pd = lazy_import("pandas")
+
+
+def _print_coindesk_info():
+    message = 'Exchange rates are provided by CoinDesk (https://www.coindesk.com/price/).'
+    try:
+        from IPython.core.display import display
+    except ImportError:
+        print(message)
+    else:
+        display(message)
 
 
 class CurrencyConverter(object):
@@ -16,10 +21,10 @@ class CurrencyConverter(object):
     Imports Bitcoin exchange rates in a variety of currencies using the Coindesk API available at https://www.coindesk.com/price/.
     """
 
-    min_start = pd.to_datetime('2009-01-03').date()
+    min_start = datetime.date(2009, 1, 3)
     max_end = datetime.date.today() - datetime.timedelta(days=1)
     # the API has data starting at 2010-07-19
-    COINDESK_START = pd.to_datetime('2010-07-19').date()
+    COINDESK_START = datetime.date(2010, 7, 19)
 
     def __init__(self, currency='USD', start=min_start, end=max_end):
         _print_coindesk_info()
@@ -0,0 +1,235 @@
+"""Map reduce over several hosts that hold replicas of the same BlockSci data directory
+
+Every host runs a worker, which opens the chain and runs the map function on the blocks it is sent:
+
+    python -m blocksci.distributed --authkey <secret> [--port 7373] [--config /path/to/config.json]
+
+The coordinator splits the blocks into shards with fixed boundaries (see Blockchain._shard_plan) and sends each shard
+to the same host on every query, so a host keeps reading the same part of the chain and finds it in its page cache.
+A host that runs out of its own shards takes the last pending shard of the busiest host. Each worker splits its
+shards over its own cores with mapreduce_block_ranges and sends back the reduced result of the shard. Results
+travel as BlockSci pickles, so BlockSci objects, numpy arrays, data frames and the sketches are all fine.
+"""
+
+import argparse
+import io
+import os
+import threading
+import traceback
+from collections import deque
+from multiprocessing.connection import Client, Listener
+
+import dill
+import psutil
+
+from .pickler import Pickler, Unpickler
+
+DEFAULT_PORT = 7373
+AUTHKEY_VARIABLE = "BLOCKSCI_DISTRIBUTED_AUTHKEY"
+
+_MISSING = object()
+
+
+def _authkey(authkey):
+    if authkey is None:
+        authkey = os.environ.get(AUTHKEY_VARIABLE)
+    if not authkey:
+        # Workers run the functions they receive, so they must never accept unauthenticated connections
+        raise ValueError("An authkey is required, pass it or set {}".format(AUTHKEY_VARIABLE))
+    return authkey.encode() if isinstance(authkey, str) else authkey
+
+
+def _parse_host(host, default_port):
+    if ":" in host:
+        name, port = host.rsplit(":", 1)
+        return name, int(port)
+    return host, default_port
+
+
+def _tip_hash(chain, max_block):
+    return str(chain[max_block - 1].hash) if max_block > 0 else ""
+
+
+class _Worker:
+    def __init__(self, config=None, cpu_count=None):
+        self.config = config
+        self.cpu_count = cpu_count
+        self.chains = {}
+        self.lock = threading.Lock()
+
+    def chain(self, config, max_block, tip_hash):
+        import blocksci
+        key = (self.config or config, max_block)
+        with self.lock:
+            if key not in self.chains:
+                chain = blocksci.Blockchain(key[0], max_block)
+                if _tip_hash(chain, max_block) != tip_hash:
+                    raise RuntimeError("The data directory of this host is at a different chain state than the coordinator's")
+                self.chains[key] = chain
+            return self.chains[key]
+
+    def run(self, job):
+        import blocksci
+        chain = self.chain(job["config"], job["max_block"], job["tip_hash"])
+        map_func, reduce_func = dill.loads(job["functions"])
+        cpu_count = job["cpu_count"] or self.cpu_count or psutil.cpu_count()
+        result = blocksci.mapreduce_block_ranges(chain, map_func, reduce_func, start=job["start"], end=job["stop"], cpu_count=cpu_count, weight=job["weight"])
+        file = io.BytesIO()
+        Pickler(file).dump(result)
+        return file.getvalue()
+
+    def serve_connection(self, connection):
+        with connection:
+            while True:
+                try:
+                    job = dill.loads(connection.recv_bytes())
+                except EOFError:
+                    return
+                try:
+                    reply = ("ok", self.run(job))
+                except Exception:
+                    reply = ("error", traceback.format_exc())
+                connection.send_bytes(dill.dumps(reply))
+
+
+def serve(port=DEFAULT_PORT, authkey=None, config=None, cpu_count=None, host="0.0.0.0"):
+    """Run a worker accepting shards from coordinators until interrupted
+
+    config overrides the data directory sent by the coordinator, for replicas stored at a different path.
+    """
+    worker = _Worker(config, cpu_count)
+    with Listener((host, port), authkey=_authkey(authkey)) as listener:
+        while True:
+            connection = listener.accept()
+            threading.Thread(target=worker.serve_connection, args=(connection,), daemon=True).start()
+
+
+class DistributedChain:
+    """Runs map reduce jobs of a chain on the workers of several hosts, created by Blockchain.distributed"""
+
+    def __init__(self, chain, hosts, authkey=None, port=DEFAULT_PORT, shard_tx_count=None):
+        if not hosts:
+            raise ValueError("At least one host is required")
+        self.chain = chain
+        self.addresses = [_parse_host(host, port) for host in hosts]
+        self.hosts = ["{}:{}".format(*address) for address in self.addresses]
+        self.authkey = _authkey(authkey)
+        self.shard_tx_count = shard_tx_count
+
+    def _plan(self, start, end):
+        start = 0 if start is None else start
+        end = len(self.chain) if end is None else end
+        if self.shard_tx_count is None:
+            return self.chain._shard_plan(start, end, self.hosts)
+        return self.chain._shard_plan(start, end, self.hosts, self.shard_tx_count)
+
+    def shards(self, start=None, end=None):
+        """(shard, host, start, stop) of the shards covering the blocks, host being the one preferred for the shard"""
+        return [(shard, self.hosts[host], shard_start, shard_stop) for shard, host, shard_start, shard_stop in self._plan(start, end)]
+
+    def map_reduce(self, map_func, reduce_func, init=_MISSING, start=None, end=None, weight="tx", cpu_count=None, lazy_lists=False):
+        """Distributed version of Blockchain.mapreduce_block_ranges
+
+        map_func is called with a BlockRange on the workers and must be picklable by dill, like reduce_func, which
+        combines the results of the segments on each worker and the results of the shards here, in block order.
+        cpu_count is the number of processes per worker, by default all of its cores.
+        """
+        max_block = len(self.chain)
+        plan = self._plan(start, end)
+        if not plan:
+            if init is _MISSING:
+                raise ValueError("Cannot map reduce an empty block range without init")
+            return init
+
+        functions = dill.dumps((map_func, reduce_func), recurse=True)
+        job_base = {
+            "config": self.chain.config_location,
+            "max_block": max_block,
+            "tip_hash": _tip_hash(self.chain, max_block),
+            "functions": functions,
+            "cpu_count": cpu_count,
+            "weight": weight,
+        }
+        queues = [deque() for _ in self.hosts]
+        for shard, host, shard_start, shard_stop in plan:
+            queues[host].append((shard, shard_start, shard_stop))
+
+        lock = threading.Lock()
+        results = {}
+        failures = []
+        # Set once a map or reduce function failed on a worker, which would fail on every other host as well
+        aborted = threading.Event()
+
+        def next_shard(host):
+            with lock:
+                if aborted.is_set():
+                    return None
+                if queues[host]:
+                    return queues[host].popleft()
+                # Stealing from the back leaves the busiest host the shards it is about to start
+                busiest = max(range(len(queues)), key=lambda i: len(queues[i]))
+                if queues[busiest]:
+                    return queues[busiest].pop()
+                return None
+
+        def run_host(host):
+            try:
+                connection = Client(self.addresses[host], authkey=self.authkey)
+            except (OSError, EOFError) as e:
+                with lock:
+                    failures.append("{}: {}".format(self.hosts[host], e))
+                return
+            with connection:
+                while True:
+                    shard = next_shard(host)
+                    if shard is None:
+                        return
+                    job = dict(job_base, start=shard[1], stop=shard[2])
+                    try:
+                        connection.send_bytes(dill.dumps(job))
+                        status, payload = dill.loads(connection.recv_bytes())
+                    except (OSError, EOFError) as e:
+                        # Leave the shard to the other hosts
+                        with lock:
+                            queues[host].appendleft(shard)
+                            failures.append("{}: {}".format(self.hosts[host], e))
+                        return
+                    with lock:
+                        if status == "ok":
+                            results[shard[0]] = payload
+                        else:
+                            failures.append("{}: {}".format(self.hosts[host], payload))
+                            aborted.set()
+                            return
+
+        threads = [threading.Thread(target=run_host, args=(host,), daemon=True) for host in range(len(self.hosts))]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+
+        if len(results) < len(plan):
+            raise RuntimeError("Distributed map reduce failed:\n" + "\n".join(failures))
+
+        values = [Unpickler(io.BytesIO(results[shard]), self.chain, lazy_lists).load() for shard, _, _, _ in plan]
+        if init is not _MISSING:
+            values.insert(0, init)
+        accum = values[0]
+        for value in values[1:]:
+            accum = reduce_func(accum, value)
+        return accum
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Run a BlockSci worker for distributed map reduce")
+    parser.add_argument("--port", type=int, default=DEFAULT_PORT)
+    parser.add_argument("--host", default="0.0.0.0", help="Interface to listen on")
+    parser.add_argument("--authkey", default=None, help="Shared secret of the coordinators, defaults to ${}".format(AUTHKEY_VARIABLE))
+    parser.add_argument("--config", default=None, help="Config file of the local replica, defaults to the coordinator's path")
+    parser.add_argument("--cpu-count", type=int, default=None, help="Processes per shard, defaults to all cores")
+    args = parser.parse_args()
+    serve(args.port, args.authkey, args.config, args.cpu_count, args.host)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,384 @@
+from collections import namedtuple
+
+from ._blocksci import address_type, chain_column
+
+# Rough single threaded cost of producing one row with each access pattern on a warm page cache, in nanoseconds.
+# inline reads a field of an object that is already decoded, sequential walks a data file in order, random decodes
+# a record at an unrelated position of a data file and index seeks into a RocksDB index.
+ACCESS_NANOSECONDS = {
+    "inline": 5,
+    "sequential": 25,
+    "random": 1000,
+    "index": 10000,
+}
+
+# Plans whose estimate exceeds this many seconds are flagged by QueryPlan.warnings
+EXPENSIVE_SECONDS = 600
+
+# Cost of the properties and methods of each kind of object: (result kind, fan-out, access, files, note)
+#
+# The result kind is None for plain values. The fan-out is the number of results per row, either a number or the name
+# of a chain statistic. Plain values which aggregate over the items of the row (like Block.fee) have a fan-out too,
+# which is then their work per row instead of their number of results. Attributes missing here are treated as inline
+# reads of the object itself.
+_Cost = namedtuple("_Cost", ["kind", "fanout", "access", "files", "note"])
+
+_BLOCK_FILES = ["block"]
+_TX_FILES = ["tx_index", "tx_data"]
+_ADDRESS_INDEX = ["address_index"]
+_SCRIPT_FILES = ["scripts"]
+
+_TX_AGGREGATES = {
+    "fee": "txes_per_block", "revenue": "txes_per_block", "input_value": "inputs_per_block",
+    "output_value": "outputs_per_block", "input_count": "txes_per_block", "output_count": "txes_per_block",
+    "size_bytes": "txes_per_block", "base_size": "txes_per_block", "total_size": "txes_per_block",
+    "virtual_size": "txes_per_block", "weight": "txes_per_block",
+}
+
+COSTS = {
+    ("Block", "txes"): _Cost("Tx", "txes_per_block", "sequential", _TX_FILES, ""),
+    ("Block", "inputs"): _Cost("Input", "inputs_per_block", "sequential", _TX_FILES + ["input_spent_out_num"], ""),
+    ("Block", "outputs"): _Cost("Output", "outputs_per_block", "sequential", _TX_FILES, ""),
+    ("Block", "coinbase_tx"): _Cost("Tx", 1, "sequential", _TX_FILES, ""),
+    ("Block", "next_block"): _Cost("Block", 1, "inline", _BLOCK_FILES, ""),
+    ("Block", "prev_block"): _Cost("Block", 1, "inline", _BLOCK_FILES, ""),
+    ("Block", "time_seen"): _Cost(None, 1, "random", ["mempool"], "mempool recorder data"),
+    ("Block", "timestamp_seen"): _Cost(None, 1, "random", ["mempool"], "mempool recorder data"),
+
+    ("Tx", "inputs"): _Cost("Input", "inputs_per_tx", "sequential", ["tx_data", "input_spent_out_num", "sequence"], ""),
+    ("Tx", "ins"): _Cost("Input", "inputs_per_tx", "sequential", ["tx_data", "input_spent_out_num", "sequence"], ""),
+    ("Tx", "outputs"): _Cost("Output", "outputs_per_tx", "sequential", ["tx_data"], ""),
+    ("Tx", "outs"): _Cost("Output", "outputs_per_tx", "sequential", ["tx_data"], ""),
+    ("Tx", "block"): _Cost("Block", 1, "inline", _BLOCK_FILES, ""),
+    ("Tx", "block_time"): _Cost(None, 1, "inline", _BLOCK_FILES, ""),
+    ("Tx", "hash"): _Cost(None, 1, "sequential", ["tx_hashes"], ""),
+    ("Tx", "fee"): _Cost(None, 1, "sequential", ["tx_fee"], ""),
+    ("Tx", "input_value"): _Cost(None, "inputs_per_tx", "inline", ["tx_data"], ""),
+    ("Tx", "output_value"): _Cost(None, "outputs_per_tx", "inline", ["tx_data"], ""),
+    ("Tx", "op_return"): _Cost("Address", "outputs_per_tx", "inline", ["tx_data"], "scans the outputs"),
+    ("Tx", "includes_output_of_type"): _Cost(None, "outputs_per_tx", "inline", ["tx_data"], "scans the outputs"),
+    ("Tx", "observed_in_mempool"): _Cost(None, 1, "random", ["mempool"], "mempool recorder data"),
+    ("Tx", "time_seen"): _Cost(None, 1, "random", ["mempool"], "mempool recorder data"),
+    ("Tx", "timestamp_seen"): _Cost(None, 1, "random", ["mempool"], "mempool recorder data"),
+
+    ("Input", "spent_tx"): _Cost("Tx", 1, "random", _TX_FILES, "decodes the spent tx"),
+    ("Input", "spent_output"): _Cost("Output", 1, "random", _TX_FILES, "decodes the spent tx"),
+    ("Input", "spent_block_height"): _Cost(None, 1, "random", _BLOCK_FILES, "block lookup of the spent tx"),
+    ("Input", "age"): _Cost(None, 1, "random", _BLOCK_FILES, "block lookup of the spent tx"),
+    ("Input", "sequence_num"): _Cost(None, 1, "sequential", ["sequence"], ""),
+    ("Input", "tx"): _Cost("Tx", 1, "inline", _TX_FILES, ""),
+    ("Input", "block"): _Cost("Block", 1, "inline", _BLOCK_FILES, ""),
+    ("Input", "address"): _Cost("Address", 1, "inline", ["tx_data"], ""),
+
+    ("Output", "spending_tx"): _Cost("Tx", 1, "random", _TX_FILES, "decodes the spending tx, None if unspent"),
+    ("Output", "spending_input"): _Cost("Input", 1, "random", _TX_FILES + ["output_spending_input"], "decodes the spending tx, None if unspent"),
+    ("Output", "spending_block_height"): _Cost(None, 1, "sequential", ["output_spending_height"], ""),
+    ("Output", "tx"): _Cost("Tx", 1, "inline", _TX_FILES, ""),
+    ("Output", "block"): _Cost("Block", 1, "inline", _BLOCK_FILES, ""),
+    ("Output", "address"): _Cost("Address", 1, "inline", ["tx_data"], ""),
+
+    ("Address", "outputs"): _Cost("Output", "outputs_per_address", "index", _ADDRESS_INDEX + _TX_FILES, ""),
+    ("Address", "outs"): _Cost("Output", "outputs_per_address", "index", _ADDRESS_INDEX + _TX_FILES, ""),
+    ("Address", "inputs"): _Cost("Input", "outputs_per_address", "index", _ADDRESS_INDEX + _TX_FILES, "upper bound, only spent outputs have inputs"),
+    ("Address", "ins"): _Cost("Input", "outputs_per_address", "index", _ADDRESS_INDEX + _TX_FILES, "upper bound, only spent outputs have inputs"),
+    ("Address", "txes"): _Cost("Tx", "outputs_per_address", "index", _ADDRESS_INDEX + _TX_FILES, ""),
+    ("Address", "in_txes"): _Cost("Tx", "outputs_per_address", "index", _ADDRESS_INDEX + _TX_FILES, ""),
+    ("Address", "out_txes"): _Cost("Tx", "outputs_per_address", "index", _ADDRESS_INDEX + _TX_FILES, ""),
+    ("Address", "input_txes"): _Cost("Tx", "outputs_per_address", "index", _ADDRESS_INDEX + _TX_FILES, ""),
+    ("Address", "output_txes"): _Cost("Tx", "outputs_per_address", "index", _ADDRESS_INDEX + _TX_FILES, ""),
+    ("Address", "balance"): _Cost(None, "outputs_per_address", "index", _ADDRESS_INDEX + _TX_FILES, ""),
+    ("Address", "received_value"): _Cost(None, "outputs_per_address", "index", _ADDRESS_INDEX + _TX_FILES, ""),
+    ("Address", "sent_value"): _Cost(None, "outputs_per_address", "index", _ADDRESS_INDEX + _TX_FILES, ""),
+    ("Address", "output_count"): _Cost(None, "outputs_per_address", "index", _ADDRESS_INDEX, ""),
+    ("Address", "in_txes_count"): _Cost(None, "outputs_per_address", "index", _ADDRESS_INDEX + _TX_FILES, ""),
+    ("Address", "out_txes_count"): _Cost(None, "outputs_per_address", "index", _ADDRESS_INDEX + _TX_FILES, ""),
+    ("Address", "input_txes_count"): _Cost(None, "outputs_per_address", "index", _ADDRESS_INDEX + _TX_FILES, ""),
+    ("Address", "output_txes_count"): _Cost(None, "outputs_per_address", "index", _ADDRESS_INDEX + _TX_FILES, ""),
+    ("Address", "equiv"): _Cost("EquivAddress", 1, "random", _SCRIPT_FILES, ""),
+    ("Address", "first_tx"): _Cost("Tx", 1, "random", _SCRIPT_FILES + _TX_FILES, ""),
+    ("Address", "revealed_tx"): _Cost("Tx", 1, "random", _SCRIPT_FILES + _TX_FILES, ""),
+    ("Address", "address_num"): _Cost(None, 1, "inline", [], ""),
+    ("Address", "raw_type"): _Cost(None, 1, "inline", [], ""),
+    ("Address", "type"): _Cost(None, 1, "inline", [], ""),
+    ("Address", "full_type"): _Cost(None, 1, "random", _SCRIPT_FILES, ""),
+    ("Address", "stats_balance"): _Cost(None, 1, "random", ["address_stats"], ""),
+
+    ("EquivAddress", "addresses"): _Cost("Address", 1, "random", _SCRIPT_FILES, ""),
+    ("EquivAddress", "outputs"): _Cost("Output", "outputs_per_address", "index", _ADDRESS_INDEX + _TX_FILES, ""),
+    ("EquivAddress", "inputs"): _Cost("Input", "outputs_per_address", "index", _ADDRESS_INDEX + _TX_FILES, "upper bound, only spent outputs have inputs"),
+    ("EquivAddress", "txes"): _Cost("Tx", "outputs_per_address", "index", _ADDRESS_INDEX + _TX_FILES, ""),
+    ("EquivAddress", "balance"): _Cost(None, "outputs_per_address", "index", _ADDRESS_INDEX + _TX_FILES, ""),
+}
+
+for _name, _fanout in _TX_AGGREGATES.items():
+    COSTS[("Block", _name)] = _Cost(None, _fanout, "sequential", _TX_FILES, "aggregates over the txes")
+
+# Default cost of the attributes of each kind missing from COSTS
+_DEFAULT_ACCESS = {
+    "Block": ("inline", _BLOCK_FILES),
+    "Tx": ("inline", ["tx_data"]),
+    "Input": ("inline", ["tx_data"]),
+    "Output": ("inline", ["tx_data"]),
+    "Address": ("random", _SCRIPT_FILES),
+    "EquivAddress": ("random", _SCRIPT_FILES),
+}
+
+# Methods of sequences which run a nested expression for every item
+_NESTED_METHODS = {"map", "select", "where", "any", "all", "max", "min"}
+
+# Attributes of sequences which summarize them instead of applying to each item
+_SEQUENCE_METHODS = {"size", "count", "sum", "to_list"}
+
+PlanStage = namedtuple("PlanStage", ["depth", "operation", "input_kind", "output_kind", "files", "access", "rows", "seconds", "note"])
+
+
+def chain_stats(chain):
+    """Averages the cost estimates of explain are based on, derived from the sizes of the chain files"""
+    blocks = max(len(chain), 1)
+    txes = len(chain.column(chain_column.first_input))
+    inputs = len(chain.column(chain_column.input_spent_out_num))
+    outputs = len(chain.column(chain_column.output_value))
+    addresses = 0
+    for typ in address_type.__members__.values():
+        try:
+            addresses += chain.address_count(typ)
+        except (RuntimeError, ValueError):
+            pass
+    return {
+        "blocks": blocks,
+        "txes": txes,
+        "inputs": inputs,
+        "outputs": outputs,
+        "addresses": addresses,
+        "txes_per_block": txes / blocks,
+        "inputs_per_block": inputs / blocks,
+        "outputs_per_block": outputs / blocks,
+        "inputs_per_tx": inputs / max(txes, 1),
+        "outputs_per_tx": outputs / max(txes, 1),
+        "outputs_per_address": outputs / max(addresses, 1),
+    }
+
+
+class QueryPlan:
+    """Estimated pipeline of a query returned by Blockchain.explain
+
+    Every stage reports the objects it reads from, the data files and indexes it touches, whether it accesses them
+    sequentially, at random positions or through an index, the estimated number of rows it produces and its estimated
+    run time. Stages of nested expressions (eg. the predicate of where) have a larger depth.
+    """
+
+    def __init__(self, stages, stats):
+        self.stages = stages
+        self.stats = stats
+
+    @property
+    def rows(self):
+        """Estimated number of results of the query"""
+        top = [stage for stage in self.stages if stage.depth == 0]
+        return top[-1].rows if top else 0
+
+    @property
+    def seconds(self):
+        """Estimated single threaded run time of the whole query in seconds"""
+        return sum(stage.seconds for stage in self.stages)
+
+    @property
+    def random_accesses(self):
+        """Estimated number of random decodes and index seeks of the query"""
+        return sum(stage.rows for stage in self.stages if stage.access in ("random", "index"))
+
+    @property
+    def warnings(self):
+        """Stages which make the query expensive"""
+        found = []
+        if self.seconds > EXPENSIVE_SECONDS:
+            for stage in self.stages:
+                if stage.access in ("random", "index") and stage.seconds > EXPENSIVE_SECONDS / 10:
+                    found.append("{} performs about {:,.0f} {} accesses ({})".format(
+                        stage.operation, stage.rows, stage.access, _format_seconds(stage.seconds)))
+        return found
+
+    def to_frame(self):
+        """Return the stages as a pandas DataFrame"""
+        import pandas as pd
+        return pd.DataFrame(self.stages, columns=PlanStage._fields)
+
+    def __str__(self):
+        lines = []
+        for i, stage in enumerate(self.stages):
+            operation = "  " * stage.depth + stage.operation
+            line = "{:>2}. {:<44} {:<10} rows={:<14,.0f} {:>9}  {}".format(
+                i + 1, operation, stage.access, stage.rows, _format_seconds(stage.seconds), ", ".join(stage.files))
+            if stage.note:
+                line += "  [" + stage.note + "]"
+            lines.append(line)
+        lines.append("Estimated total: {:,.0f} rows, {:,.0f} random accesses, {}".format(
+            self.rows, self.random_accesses, _format_seconds(self.seconds)))
+        lines.extend("Warning: " + warning for warning in self.warnings)
+        return "\n".join(lines)
+
+    def __repr__(self):
+        return str(self)
+
+
+def _format_seconds(seconds):
+    if seconds < 1:
+        return "{:.0f}ms".format(seconds * 1000)
+    if seconds < 3600:
+        return "{:.0f}s".format(seconds)
+    return "{:.1f}h".format(seconds / 3600)
+
+
+class _Planner:
+    def __init__(self, stats):
+        self.stats = stats
+        self.stages = []
+
+    def fanout(self, value):
+        if isinstance(value, str):
+            return self.stats[value]
+        return value
+
+    def add(self, depth, operation, input_kind, output_kind, files, access, rows, work, note):
+        seconds = rows * work * ACCESS_NANOSECONDS[access] / 1e9
+        self.stages.append(PlanStage(depth, operation, input_kind, output_kind, list(files), access, rows, seconds, note))
+
+
+class _Expression:
+    """Stand-in for a BlockSci object or sequence which records the attributes accessed on it
+
+    rows is the estimated number of objects the expression produces when it is evaluated once per row of its source.
+    """
+
+    __hash__ = object.__hash__
+
+    def __init__(self, planner, kind, rows, sequence, depth):
+        self._planner = planner
+        self._kind = kind
+        self._rows = rows
+        self._sequence = sequence
+        self._depth = depth
+
+    def _value(self):
+        return _Expression(self._planner, None, self._rows, False, self._depth)
+
+    def __getattr__(self, name):
+        if name.startswith("_"):
+            raise AttributeError(name)
+        if name in _NESTED_METHODS:
+            return lambda func: self._nested(name, func)
+        if self._kind is None or (self._sequence and name in _SEQUENCE_METHODS):
+            return _Call(self._value())
+        return self._attribute(name)
+
+    def _attribute(self, name):
+        planner = self._planner
+        cost = COSTS.get((self._kind, name))
+        if cost is None:
+            access, files = _DEFAULT_ACCESS.get(self._kind, ("inline", []))
+            cost = _Cost(None, 1, access, files, "")
+        fanout = planner.fanout(cost.fanout)
+        rows = self._rows * fanout if cost.kind is not None else self._rows
+        work = 1 if cost.kind is not None else fanout
+        sequence = self._sequence or (cost.kind is not None and cost.fanout != 1)
+        planner.add(self._depth, "{}.{}".format(self._kind, name), self._kind, cost.kind, cost.files, cost.access, rows, work, cost.note)
+        return _Call(_Expression(planner, cost.kind, rows, sequence, self._depth))
+
+    def _nested(self, name, func):
+        planner = self._planner
+        item = _Expression(planner, self._kind, self._rows, False, self._depth + 1)
+        result = func(item)
+        planner.add(self._depth, "{}({})".format(name, self._kind), self._kind, self._kind, [], "inline", self._rows, 1,
+                    "row count is an upper bound" if name == "where" else "")
+        if name in ("map", "select") and isinstance(result, _Expression):
+            return _Expression(planner, result._kind, result._rows, True, self._depth)
+        if name == "where":
+            return _Expression(planner, self._kind, self._rows, True, self._depth)
+        return _Expression(planner, self._kind if name in ("max", "min") else None, self._rows, False, self._depth)
+
+    def __getitem__(self, index):
+        if isinstance(index, slice) and self._sequence:
+            return _Expression(self._planner, self._kind, self._rows, True, self._depth)
+        return _Expression(self._planner, self._kind, self._rows, False, self._depth)
+
+    def _compare(self, *args):
+        return self._value()
+
+    __eq__ = __ne__ = __lt__ = __le__ = __gt__ = __ge__ = _compare
+    __add__ = __radd__ = __sub__ = __rsub__ = __mul__ = __rmul__ = _compare
+    __truediv__ = __floordiv__ = __mod__ = __and__ = __or__ = __invert__ = __neg__ = _compare
+
+
+class _Call(_Expression):
+    """Result of an attribute which may be a method, calling it returns the same expression"""
+
+    def __init__(self, expression):
+        super().__init__(expression._planner, expression._kind, expression._rows, expression._sequence, expression._depth)
+
+    def __call__(self, *args, **kwargs):
+        return _Expression(self._planner, self._kind, self._rows, self._sequence, self._depth)
+
+
+class _ChainExpression:
+    """Stand-in for the Blockchain passed to the expression explained by explain"""
+
+    def __init__(self, planner):
+        self._planner = planner
+
+    def _scan(self, operation, kind, rows, files, access, sequence=True):
+        self._planner.add(0, operation, None, kind, files, access, rows, 1, "")
+        return _Expression(self._planner, kind, rows, sequence, 0)
+
+    @property
+    def blocks(self):
+        return self._scan("scan blocks", "Block", self._planner.stats["blocks"], _BLOCK_FILES, "sequential")
+
+    def block_range(self, start, end=None):
+        return self.blocks
+
+    def __getitem__(self, index):
+        if isinstance(index, slice):
+            count = len(range(*index.indices(int(self._planner.stats["blocks"]))))
+            return self._scan("scan blocks[{}:{}]".format("" if index.start is None else index.start, "" if index.stop is None else index.stop), "Block", count, _BLOCK_FILES, "sequential")
+        return self._scan("block {}".format(index), "Block", 1, _BLOCK_FILES, "inline", False)
+
+    def tx_with_index(self, index):
+        return self._scan("tx_with_index", "Tx", 1, _TX_FILES, "random", False)
+
+    def tx_with_hash(self, tx_hash):
+        return self._scan("tx_with_hash", "Tx", 1, ["hash_index"] + _TX_FILES, "index", False)
+
+    def address_from_string(self, address_string):
+        return self._scan("address_from_string", "Address", 1, ["hash_index"], "index", False)
+
+    def address_from_index(self, index, typ):
+        return self._scan("address_from_index", "Address", 1, _SCRIPT_FILES, "random", False)
+
+    def addresses(self, typ):
+        return self._scan("scan addresses({})".format(typ), "Address", self._planner.stats["addresses"], _SCRIPT_FILES, "sequential")
+
+
+def explain(self, expression, stats=None):
+    """Estimate the cost of a query without running it
+
+    The expression is a function of the chain, eg. ``lambda chain: chain.blocks.txes.inputs.spent_tx.outputs.address``,
+    or the same expression as a string, eg. ``"chain.blocks.txes.inputs.spent_tx.outputs.address"``. It is evaluated on
+    stand-ins that record every attribute access instead of reading the chain. Nested expressions passed to map, where,
+    any, all, max and min are explained as well.
+
+    The estimates come from the average fan-outs of chain_stats (eg. inputs per tx), which can be overridden with stats,
+    and the per row costs in ACCESS_NANOSECONDS. They assume a single thread and a warm page cache, and are meant to
+    catch queries performing millions of random decodes or index seeks before they run, not to predict run times.
+
+    Returns a QueryPlan, whose string form lists the stages.
+    """
+    chain_statistics = chain_stats(self)
+    if stats:
+        chain_statistics.update(stats)
+    planner = _Planner(chain_statistics)
+    root = _ChainExpression(planner)
+    if isinstance(expression, str):
+        eval(expression, {"__builtins__": {}}, {"chain": root})
+    else:
+        expression(root)
+    return QueryPlan(planner.stages, chain_statistics)
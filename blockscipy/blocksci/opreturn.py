@@ -6,7 +6,10 @@ Label op return data as related to a specific application
 
 import binascii
 import re
-import Crypto.Cipher.ARC4
+
+from .lazy_import import lazy_import
+
+ARC4 = lazy_import("Crypto.Cipher.ARC4")
 
 OP_RETURN_SERVICES = {
     "OA": "Open Assets", "id": "Blockstack",
@@ -102,7 +105,19 @@ def label_application(tx):
     #             return address_matches[txout.address]
     elif tx.ins:
         first_vin_txid = binascii.unhexlify(str(tx.ins[0].spent_tx.hash))
-        decoded = Crypto.Cipher.ARC4.new(first_vin_txid).decrypt(data)
+        decoded = ARC4.new(first_vin_txid).decrypt(data)
         if decoded.startswith(b'CNTRPRTY'):
             return "Counterparty"
     return "Unknown"
+
+
+def op_returns_with_application(chain, application):
+    """Find the OP_RETURN outputs of an application that is identified by a payload prefix
+
+    Uses the nulldata index (built with blocksci_parser build-nulldata-index) instead of scanning the chain.
+    """
+    prefixes = [prefix.encode("ascii") for prefix, name in OP_RETURN_SERVICES.items() if name == application]
+    prefixes += [prefix for prefix, name in BYTE_PREFIXES.items() if name == application]
+    # Outputs matching a longer prefix are already found through the shorter one
+    prefixes = [prefix for prefix in prefixes if not any(prefix != other and prefix.startswith(other) for other in prefixes)]
+    return [op_return for prefix in prefixes for op_return in chain.op_returns_with_prefix(prefix)]
@@ -1,4 +1,5 @@
 from ._blocksci import *
+from ._blocksci import _pack_objects
 import pickle
 import sqlite3
 from collections import namedtuple
@@ -7,9 +8,18 @@ from collections import namedtuple
 MemoRecord = namedtuple("MemoRecord", "key, task")
 
 class Pickler(pickle.Pickler):
-    """Custom Pickler for BlockSci objects"""
+    """Custom Pickler for BlockSci objects
+
+    Lists holding only Blocks, Txes, Inputs, Outputs or Addresses of one kind are packed natively into numpy arrays of
+    their indexes, so large results are written as a few buffers instead of one persistent ID per object.
+    """
 
     def persistent_id(self, obj):
+        if isinstance(obj, list):
+            packed = _pack_objects(obj)
+            if packed is not None:
+                return ("Packed", packed)
+            return None
         # Instead of pickling MemoRecord as a regular class instance, we emit a
         # persistent ID.
         if isinstance(obj, Block):
@@ -34,17 +44,23 @@ class Pickler(pickle.Pickler):
 
 
 class Unpickler(pickle.Unpickler):
-    """Custom Unpickler for BlockSci objects"""
+    """Custom Unpickler for BlockSci objects
+
+    With lazy_lists, packed lists are returned as BlockSci ranges that construct their objects on access.
+    """
 
-    def __init__(self, file, chain):
+    def __init__(self, file, chain, lazy_lists=False):
         super().__init__(file)
         self.chain = chain
+        self.lazy_lists = lazy_lists
 
     def persistent_load(self, pid):
         # This method is invoked whenever a persistent ID is encountered.
         # Here, pid is the tuple returned by DBPickler.
         type_tag, key_id = pid
-        if type_tag == "Block":
+        if type_tag == "Packed":
+            return self.chain._unpack_objects(key_id[0], key_id[1], self.lazy_lists)
+        elif type_tag == "Block":
             return self.chain[key_id]
         elif type_tag == "Tx":
             return self.chain.tx_with_index(key_id)
@@ -0,0 +1,58 @@
+from collections import OrderedDict
+
+# Maximum number of built proxies kept by cached_proxy, 0 disables the cache
+proxy_cache_size = 1024
+
+_proxy_cache = OrderedDict()
+_missing = object()
+
+
+def _expression_key(func):
+    """Key identifying the proxy func builds: its code together with every value it can read from outside
+
+    Returns None if one of those values is unhashable (and so might change without changing the key).
+    """
+    code = getattr(func, "__code__", None)
+    if code is None:
+        return None
+    try:
+        closure = tuple(cell.cell_contents for cell in func.__closure__ or ())
+    except ValueError:
+        # Closure cell which is not assigned yet
+        return None
+    func_globals = getattr(func, "__globals__", {})
+    referenced = tuple(func_globals.get(name, _missing) for name in code.co_names if name in func_globals)
+    key = (code, closure, func.__defaults__, func.__kwdefaults__ and tuple(sorted(func.__kwdefaults__.items())), referenced)
+    try:
+        hash(key)
+    except TypeError:
+        return None
+    return key
+
+
+def cached_proxy(operation, owner, funcs, build):
+    """Return build(), reusing the result of an earlier call for the same operation, owner and expression funcs
+
+    Used by the sequence methods like where and map, so that calling them repeatedly with the same lambda (eg. in a
+    loop) builds and type checks the proxy pipeline only once.
+    """
+    if proxy_cache_size <= 0:
+        return build()
+    keys = tuple(_expression_key(func) for func in funcs)
+    if any(key is None for key in keys):
+        return build()
+    key = (operation, owner, keys)
+    prox = _proxy_cache.get(key)
+    if prox is not None:
+        _proxy_cache.move_to_end(key)
+        return prox
+    prox = build()
+    _proxy_cache[key] = prox
+    while len(_proxy_cache) > proxy_cache_size:
+        _proxy_cache.popitem(last=False)
+    return prox
+
+
+def clear_proxy_cache():
+    """Remove all proxies built by cached_proxy"""
+    _proxy_cache.clear()
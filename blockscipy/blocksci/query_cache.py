@@ -0,0 +1,174 @@
+import hashlib
+import inspect
+import io
+import operator
+import os
+import sqlite3
+from collections import Counter
+
+from .lazy_import import lazy_import
+from .pickler import Pickler, Unpickler
+
+pd = lazy_import("pandas")
+
+
+def _extend(accum, new_val):
+    return list(accum) + list(new_val)
+
+
+def _count(accum, new_val):
+    return Counter(accum) + Counter(new_val)
+
+
+def _sum_dicts(accum, new_val):
+    merged = dict(accum)
+    for key, value in new_val.items():
+        merged[key] = merged[key] + value if key in merged else value
+    return merged
+
+
+def _concat_frames(accum, new_val):
+    return pd.concat([accum, new_val])
+
+
+# Built-in ways to merge the cached result of earlier blocks with the result for new blocks
+REDUCERS = {
+    "sum": operator.add,
+    "min": min,
+    "max": max,
+    "extend": _extend,
+    "count": _count,
+    "sum_dicts": _sum_dicts,
+    "concat_frames": _concat_frames,
+}
+
+
+def _function_key(func):
+    """Key of a query function: its qualified name and a hash of its source, so that editing it invalidates the cache"""
+    try:
+        source = inspect.getsource(func).encode()
+    except (OSError, TypeError):
+        code = getattr(func, "__code__", None)
+        if code is None:
+            raise ValueError("Can't derive a cache key for {!r}, pass key explicitly".format(func))
+        source = code.co_code
+    name = "{}.{}".format(getattr(func, "__module__", ""), getattr(func, "__qualname__", repr(func)))
+    return "{}:{}".format(name, hashlib.sha1(source).hexdigest())
+
+
+class QueryCache:
+    """Opt-in on-disk cache of expensive queries over block ranges
+
+    Results are stored in an sqlite database together with the block range they cover and the hash of its last block,
+    BlockSci objects in them are stored compactly through the persistent IDs of blocksci.Pickler. When the chain has
+    grown since a result was cached and a reducer is given, only the new blocks are computed and merged into the cached
+    result. Results whose last block was replaced by a reorg are recomputed.
+    """
+
+    def __init__(self, chain, directory=None):
+        if directory is None:
+            directory = os.path.join(chain.data_location, "query_cache")
+        os.makedirs(directory, exist_ok=True)
+        self.chain = chain
+        self.path = os.path.join(directory, "queries.sqlite")
+        self.db = sqlite3.connect(self.path)
+        with self.db:
+            self.db.execute(
+                "CREATE TABLE IF NOT EXISTS results "
+                "(key TEXT, start INTEGER, end INTEGER, tip_hash TEXT, result BLOB, PRIMARY KEY (key, start, end))"
+            )
+
+    def _tip_hash(self, end):
+        return str(self.chain[end - 1].hash) if end > 0 else ""
+
+    def _dump(self, result):
+        file = io.BytesIO()
+        Pickler(file).dump(result)
+        return file.getvalue()
+
+    def _load(self, blob):
+        return Unpickler(io.BytesIO(blob), self.chain).load()
+
+    def _store(self, key, start, end, result):
+        with self.db:
+            self.db.execute(
+                "INSERT OR REPLACE INTO results VALUES (?, ?, ?, ?, ?)",
+                (key, start, end, self._tip_hash(end), self._dump(result)),
+            )
+
+    def _cached(self, key, start, end):
+        """The cached result of the query from start with the largest end not after end whose tip is still in the chain"""
+        rows = self.db.execute(
+            "SELECT end, tip_hash, result FROM results WHERE key = ? AND start = ? AND end <= ? ORDER BY end DESC",
+            (key, start, end),
+        )
+        for cached_end, tip_hash, blob in rows:
+            if cached_end <= len(self.chain) and self._tip_hash(cached_end) == tip_hash:
+                return cached_end, self._load(blob)
+        return None
+
+    def query(self, func, start=0, end=None, reducer=None, key=None):
+        """Return func(chain[start:end]), reusing cached results
+
+        reducer merges the result for earlier blocks with the result for the blocks after them, either a function or the
+        name of one of REDUCERS. Without it, a cached result is only used for exactly the same range. key identifies
+        the query and defaults to the name and source hash of func, it is required for lambdas defined interactively.
+        """
+        if end is None or end > len(self.chain):
+            end = len(self.chain)
+        if end < 0:
+            end += len(self.chain)
+        if isinstance(reducer, str):
+            reducer = REDUCERS[reducer]
+        if key is None:
+            key = _function_key(func)
+
+        cached = self._cached(key, start, end)
+        if cached is not None:
+            cached_end, result = cached
+            if cached_end == end:
+                return result
+            if reducer is not None:
+                result = reducer(result, func(self.chain[cached_end:end]))
+                self._store(key, start, end, result)
+                return result
+
+        result = func(self.chain[start:end])
+        self._store(key, start, end, result)
+        return result
+
+    def map_reduce(self, proxy, key, reducer=None, start=0, end=None):
+        """Cached version of Blockchain.map_reduce, extended incrementally for the sum, min, max and concat reducers"""
+        from ._blocksci import reducer as native_reducer
+        import numpy as np
+
+        if reducer is None:
+            reducer = native_reducer.sum
+        merge = {
+            native_reducer.sum: operator.add,
+            native_reducer.min: lambda a, b: b if a is None else (a if b is None else min(a, b)),
+            native_reducer.max: lambda a, b: b if a is None else (a if b is None else max(a, b)),
+            native_reducer.concat: lambda a, b: np.concatenate([a, b]),
+            native_reducer.group_count: _count,
+        }[reducer]
+
+        def run(blocks):
+            if len(blocks) == 0:
+                return self.chain.map_reduce(proxy, reducer, 0, 0)
+            return self.chain.map_reduce(proxy, reducer, blocks[0].height, blocks[-1].height + 1)
+
+        return self.query(run, start, end, merge, key="map_reduce:{}:{}".format(key, reducer.name))
+
+    def invalidate(self, key=None):
+        """Remove the cached results of the query with the given key, or all results"""
+        with self.db:
+            if key is None:
+                self.db.execute("DELETE FROM results")
+            else:
+                self.db.execute("DELETE FROM results WHERE key = ?", (key,))
+
+    def keys(self):
+        return [row[0] for row in self.db.execute("SELECT DISTINCT key FROM results")]
+
+    def close(self):
+        self.db.close()
@@ -0,0 +1,47 @@
+"""Unpack the column capsules of raw_chain_column, raw_script_column and raw_cluster_column
+
+Cython and C code take the blocksci_column pointer out of the capsule with PyCapsule_GetPointer(capsule,
+"blocksci_column"). In Python describe returns its fields, for example to wrap a column for a Numba kernel:
+
+    column = describe(blocksci.raw_chain_column(chain, blocksci.chain_column.output_value))
+    pointer = ctypes.cast(column.data, ctypes.POINTER(ctypes.c_int64))
+    values = numpy.ctypeslib.as_array(pointer, (column.length,))
+
+The layout constants of the stored structs (RawBlock, RawTransaction, Inout) are in blocksci/column_abi.h.
+"""
+
+import ctypes
+from collections import namedtuple
+
+from ._blocksci import column_abi_version
+
+
+class ColumnDescriptor(ctypes.Structure):
+    """Mirror of blocksci_column in blocksci/column_abi.h"""
+    _fields_ = [
+        ("data", ctypes.c_void_p),
+        ("length", ctypes.c_uint64),
+        ("stride", ctypes.c_uint64),
+        ("element_size", ctypes.c_uint64),
+        ("first_index", ctypes.c_uint64),
+        ("abi_version", ctypes.c_uint32),
+        ("reserved", ctypes.c_uint32),
+    ]
+
+
+RawColumn = namedtuple("RawColumn", ["data", "length", "stride", "element_size", "first_index"])
+
+_get_pointer = ctypes.pythonapi.PyCapsule_GetPointer
+_get_pointer.restype = ctypes.c_void_p
+_get_pointer.argtypes = [ctypes.py_object, ctypes.c_char_p]
+
+
+def describe(capsule):
+    """Return the address (as an int), length, stride and element size in bytes and the index of the first element of
+    the column in a 'blocksci_column' capsule. The address stays valid while the capsule is alive and the chain isn't
+    reloaded."""
+    pointer = _get_pointer(capsule, b"blocksci_column")
+    descriptor = ColumnDescriptor.from_address(pointer)
+    if descriptor.abi_version != column_abi_version:
+        raise RuntimeError("Column ABI version {} does not match {}".format(descriptor.abi_version, column_abi_version))
+    return RawColumn(descriptor.data or 0, descriptor.length, descriptor.stride, descriptor.element_size, descriptor.first_index)
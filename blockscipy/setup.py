@@ -75,5 +75,8 @@ setup(
         'pandas>=0.22.0',
         'dateparser>=0.6.0',
         'requests>=2.19.1'
-    ]
+    ],
+    extras_require={
+        'arrow': ['pyarrow>=1.0.0']
+    }
 )
@@ -42,6 +42,7 @@ using BlocksciIteratorTypeVariant = mpark::variant<
 	RawIterator<blocksci::script::OpReturn>,
 	RawIterator<blocksci::script::Nonstandard>,
 	RawIterator<blocksci::script::WitnessUnknown>,
+	RawIterator<blocksci::script::WitnessTaproot>,
 	RawIterator<blocksci::AddressType::Enum>,
 	RawIterator<int64_t>,
 	RawIterator<bool>,
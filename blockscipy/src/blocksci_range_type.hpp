@@ -42,6 +42,7 @@ using BlocksciRangeTypeVariant = mpark::variant<
 	RawRange<blocksci::script::OpReturn>,
 	RawRange<blocksci::script::Nonstandard>,
 	RawRange<blocksci::script::WitnessUnknown>,
+	RawRange<blocksci::script::WitnessTaproot>,
 	RawRange<blocksci::AddressType::Enum>,
 	RawRange<int64_t>,
 	RawRange<bool>,
@@ -42,6 +42,7 @@ using BlocksciTypeVariant = mpark::variant<
 	blocksci::script::OpReturn,
 	blocksci::script::Nonstandard,
 	blocksci::script::WitnessUnknown,
+	blocksci::script::WitnessTaproot,
 	blocksci::AddressType::Enum,
 	int64_t,
 	bool,
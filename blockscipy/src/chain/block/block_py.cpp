@@ -14,7 +14,9 @@
 #include "self_apply_py.hpp"
 
 #include <blocksci/chain/access.hpp>
+#include <blocksci/chain/tx_package.hpp>
 
+#include <pybind11/numpy.h>
 #include <pybind11/operators.h>
 
 namespace py = pybind11;
@@ -78,6 +80,37 @@ void init_block(py::class_<Block> &cl) {
     })
     .def("net_address_type_value", py::overload_cast<const Block &>(netAddressTypeValue), "Returns a set of the net change in the utxo pool after this block split up by address type")
     .def("net_full_type_value", py::overload_cast<const Block &>(netFullTypeValue), "Returns a set of the net change in the utxo pool after this block split up by full type")
+    .def("package_parents", [](const Block &block, uint32_t position) {
+        return BlockPackages{block}.parents(position);
+    }, "Positions within the block of the txes whose outputs are spent by the tx at the given position", pybind11::arg("position"))
+    .def("package_children", [](const Block &block, uint32_t position) {
+        return BlockPackages{block}.children(position);
+    }, "Positions within the block of the txes spending outputs of the tx at the given position", pybind11::arg("position"))
+    .def("package_ancestors", [](const Block &block, uint32_t position) {
+        return BlockPackages{block}.ancestors(position);
+    }, "Positions of all in-block ancestors of the tx at the given position", pybind11::arg("position"))
+    .def("package_descendants", [](const Block &block, uint32_t position) {
+        return BlockPackages{block}.descendants(position);
+    }, "Positions of all in-block descendants of the tx at the given position", pybind11::arg("position"))
+    .def("ancestor_packages", [](const Block &block) {
+        std::vector<PackageFee> packages;
+        {
+            py::gil_scoped_release release;
+            packages = BlockPackages{block}.ancestorPackages();
+        }
+        py::array_t<int64_t> fees{packages.size()};
+        py::array_t<uint64_t> virtualSizes{packages.size()};
+        auto feesPtr = fees.mutable_data();
+        auto virtualSizesPtr = virtualSizes.mutable_data();
+        for (size_t i = 0; i < packages.size(); i++) {
+            feesPtr[i] = packages[i].fee;
+            virtualSizesPtr[i] = packages[i].virtualSize;
+        }
+        py::dict ret;
+        ret["fee"] = fees;
+        ret["virtual_size"] = virtualSizes;
+        return ret;
+    }, "Return a dict of numpy arrays with the fee and virtual size of every tx of the block together with its in-block ancestors (CPFP packages), indexed by position in the block. Reads the same-block spend files written by the parser.")
     ;
 
     cl
@@ -8,13 +8,69 @@
 
 #include "blockchain_py.hpp"
 #include "caster_py.hpp"
+#include "proxy.hpp"
+#include "proxy_batch.hpp"
+#include "proxy_pushdown.hpp"
 #include "sequence.hpp"
 
 #include <blocksci/address/address.hpp>
+#include <blocksci/address/address_stats.hpp>
+#include <blocksci/chain/address_scan.hpp>
 #include <blocksci/chain/blockchain.hpp>
 #include <blocksci/chain/access.hpp>
+#include <blocksci/chain/block_stats.hpp>
+#include <blocksci/chain/bulk_scan.hpp>
+#include <blocksci/chain/chain_table.hpp>
+#include <blocksci/chain/chain_view.hpp>
+#include <blocksci/chain/coin_age_columns.hpp>
+#include <blocksci/chain/column_data.hpp>
+#include <blocksci/chain/column_filter.hpp>
+#include <blocksci/chain/derived_column.hpp>
+#include <blocksci/chain/input.hpp>
+#include <blocksci/chain/mempool_snapshot.hpp>
+#include <blocksci/chain/mempool_time_columns.hpp>
+#include <blocksci/chain/miner_attribution.hpp>
+#include <blocksci/chain/output.hpp>
+#include <blocksci/chain/sampling.hpp>
+#include <blocksci/chain/shard_plan.hpp>
+#include <blocksci/chain/sketches.hpp>
+#include <blocksci/chain/tx_num_range.hpp>
+#include <blocksci/chain/tx_set.hpp>
+#include <blocksci/chain/work_pool.hpp>
+#include <blocksci/core/hex_codec.hpp>
+#include <blocksci/scripts/nulldata_script.hpp>
+#include <blocksci/scripts/script_pattern.hpp>
 #include <blocksci/scripts/script_range.hpp>
 #include <blocksci/cluster/cluster.hpp>
+#include <blocksci/core/input_signature.hpp>
+#include <blocksci/core/raw_block.hpp>
+#include <blocksci/core/tracing.hpp>
+
+#include <pybind11/chrono.h>
+#include <pybind11/numpy.h>
+
+#include <range/v3/view/filter.hpp>
+#include <range/v3/view/iota.hpp>
+#include <range/v3/view/transform.hpp>
+
+#include <algorithm>
+#include <any>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <unordered_map>
 
 namespace py = pybind11;
 
@@ -24,7 +80,765 @@ template <AddressType::Enum type>
 using PythonScriptRange = Range<ScriptAddress<type>>;
 using PythonScriptRangeVariant = to_variadic_t<to_address_tuple_t<PythonScriptRange>, mpark::variant>;
 
+/** How Blockchain.map_reduce combines the values of a proxy */
+enum class ProxyReducer {
+    Sum, Min, Max, Concat, GroupCount
+};
+
+/** What Blockchain.group_aggregate computes for the values of each group */
+enum class ProxyAggregate {
+    Count, Sum, Min, Max, Mean, DistinctApprox
+};
+
 namespace {
+    /** Scope running the parallel work of a single call at the given priority, keeping the other options of the
+     * enclosing scope. Null without a priority */
+    std::unique_ptr<WorkScope> callScope(const std::optional<WorkPriority> &priority) {
+        if (!priority) {
+            return nullptr;
+        }
+        auto options = WorkScope::currentOptions();
+        options.priority = *priority;
+        return std::make_unique<WorkScope>(options);
+    }
+    
+    /** Python context manager entering a WorkScope */
+    struct PythonWorkScope {
+        WorkOptions options;
+        std::unique_ptr<WorkScope> scope;
+    };
+    
+    SpendEdgeFilter spendEdgeFilter(int64_t minValue, const std::vector<AddressType::Enum> &types) {
+        if (types.empty()) {
+            SpendEdgeFilter filter;
+            filter.minValue = minValue;
+            return filter;
+        }
+        return SpendEdgeFilter::ofTypes(types, minValue);
+    }
+    
+    template <typename T>
+    py::array_t<T> toNumpy(const std::vector<T> &values) {
+        py::array_t<T> ret{values.size()};
+        std::copy(values.begin(), values.end(), ret.mutable_data());
+        return ret;
+    }
+    
+    /** Read only numpy array of count elements spaced stride bytes apart, aliasing data which base keeps alive */
+    py::array columnView(const py::dtype &dtype, uint64_t count, size_t stride, const void *data, py::handle base) {
+        py::array ret{dtype, {static_cast<py::ssize_t>(count)}, {static_cast<py::ssize_t>(stride)}, data, base};
+        ret.attr("setflags")(py::arg("write") = false);
+        return ret;
+    }
+    
+    py::dtype tableColumnDtype(TableColumnType type) {
+        switch (type) {
+            case TableColumnType::Int64: return py::dtype::of<int64_t>();
+            case TableColumnType::Int32: return py::dtype::of<int32_t>();
+            case TableColumnType::UInt32: return py::dtype::of<uint32_t>();
+            case TableColumnType::UInt16: return py::dtype::of<uint16_t>();
+            case TableColumnType::UInt8: return py::dtype::of<uint8_t>();
+            case TableColumnType::Bool: return py::dtype("?");
+            case TableColumnType::Hash: return py::dtype("S32");
+        }
+        throw std::invalid_argument("Unknown table column type");
+    }
+    
+    /** Numpy array taking over the buffer of the column without copying */
+    py::array tableColumnArray(ChainTableColumn &column) {
+        auto count = column.size();
+        auto data = new std::vector<uint8_t>(std::move(column.data));
+        py::capsule owner(data, [](void *ptr) { delete static_cast<std::vector<uint8_t> *>(ptr); });
+        return py::array{tableColumnDtype(column.type), {static_cast<py::ssize_t>(count)}, {static_cast<py::ssize_t>(tableColumnElementSize(column.type))}, data->data(), owner};
+    }
+    
+    py::dtype columnDtype(ChainColumn column) {
+        switch (column) {
+            case ChainColumn::TxData: return py::dtype::of<uint8_t>();
+            case ChainColumn::TxIndex: return py::dtype::of<int64_t>();
+            case ChainColumn::TxVersion: return py::dtype::of<int32_t>();
+            case ChainColumn::FirstInput: return py::dtype::of<uint64_t>();
+            case ChainColumn::FirstOutput: return py::dtype::of<uint64_t>();
+            case ChainColumn::InputSpentOutNum: return py::dtype::of<uint16_t>();
+            case ChainColumn::Sequence: return py::dtype::of<uint32_t>();
+            case ChainColumn::TxHashes: return py::dtype("S32");
+            case ChainColumn::OutputValue: return py::dtype::of<int64_t>();
+            case ChainColumn::OutputType: return py::dtype::of<uint8_t>();
+            case ChainColumn::OutputAddress: return py::dtype::of<uint32_t>();
+            case ChainColumn::OutputSpentTx: return py::dtype::of<uint32_t>();
+            case ChainColumn::OutputSpendingInput: return py::dtype::of<uint16_t>();
+            case ChainColumn::OutputSpendingHeight: return py::dtype::of<uint32_t>();
+            case ChainColumn::TxFee: return py::dtype::of<int64_t>();
+            case ChainColumn::TxVirtualSize: return py::dtype::of<uint32_t>();
+            case ChainColumn::InputSpentHeight: return py::dtype::of<uint32_t>();
+            case ChainColumn::InputSpentValue: return py::dtype::of<int64_t>();
+            case ChainColumn::TxPackageFlags: return py::dtype::of<uint8_t>();
+            default: throw std::invalid_argument("Column is not a flat array of numbers");
+        }
+    }
+    
+    /** One strided view per field of the RawBlock records of block.dat */
+    py::dict blockColumnViews(const ColumnData &blocks, py::handle base) {
+        auto data = static_cast<const char *>(blocks.data);
+        auto field = [&](const py::dtype &dtype, size_t offset) {
+            return columnView(dtype, blocks.count, sizeof(RawBlock), data == nullptr ? nullptr : data + offset, base);
+        };
+        py::dict ret;
+        ret["hash"] = field(py::dtype("S32"), offsetof(RawBlock, hash));
+        ret["coinbase_offset"] = field(py::dtype::of<uint64_t>(), offsetof(RawBlock, coinbaseOffset));
+        ret["first_tx_index"] = field(py::dtype::of<uint32_t>(), offsetof(RawBlock, firstTxIndex));
+        ret["tx_count"] = field(py::dtype::of<uint32_t>(), offsetof(RawBlock, txCount));
+        ret["input_count"] = field(py::dtype::of<uint32_t>(), offsetof(RawBlock, inputCount));
+        ret["output_count"] = field(py::dtype::of<uint32_t>(), offsetof(RawBlock, outputCount));
+        ret["height"] = field(py::dtype::of<uint32_t>(), offsetof(RawBlock, height));
+        ret["version"] = field(py::dtype::of<int32_t>(), offsetof(RawBlock, version));
+        ret["timestamp"] = field(py::dtype::of<uint32_t>(), offsetof(RawBlock, timestamp));
+        ret["bits"] = field(py::dtype::of<uint32_t>(), offsetof(RawBlock, bits));
+        ret["nonce"] = field(py::dtype::of<uint32_t>(), offsetof(RawBlock, nonce));
+        ret["real_size"] = field(py::dtype::of<uint32_t>(), offsetof(RawBlock, realSize));
+        ret["base_size"] = field(py::dtype::of<uint32_t>(), offsetof(RawBlock, baseSize));
+        return ret;
+    }
+    
+    /** One strided view per field of the BlockStats records of block_stats.dat, with one output count per address type */
+    py::dict blockStatsViews(const ColumnData &stats, py::handle base) {
+        auto data = static_cast<const char *>(stats.data);
+        auto field = [&](const py::dtype &dtype, size_t offset) {
+            return columnView(dtype, stats.count, sizeof(BlockStats), data == nullptr ? nullptr : data + offset, base);
+        };
+        py::dict ret;
+        ret["timestamp"] = field(py::dtype::of<uint32_t>(), offsetof(BlockStats, timestamp));
+        ret["tx_count"] = field(py::dtype::of<uint32_t>(), offsetof(BlockStats, txCount));
+        ret["input_count"] = field(py::dtype::of<uint32_t>(), offsetof(BlockStats, inputCount));
+        ret["output_count"] = field(py::dtype::of<uint32_t>(), offsetof(BlockStats, outputCount));
+        ret["total_fee"] = field(py::dtype::of<int64_t>(), offsetof(BlockStats, totalFee));
+        ret["total_output_value"] = field(py::dtype::of<int64_t>(), offsetof(BlockStats, totalOutputValue));
+        ret["total_input_value"] = field(py::dtype::of<int64_t>(), offsetof(BlockStats, totalInputValue));
+        ret["fee_virtual_size"] = field(py::dtype::of<uint64_t>(), offsetof(BlockStats, feeVirtualSize));
+        ret["segwit_tx_count"] = field(py::dtype::of<uint32_t>(), offsetof(BlockStats, segwitTxCount));
+        ret["size"] = field(py::dtype::of<uint32_t>(), offsetof(BlockStats, size));
+        ret["weight"] = field(py::dtype::of<uint32_t>(), offsetof(BlockStats, weight));
+        static constexpr std::array<const char *, AddressType::size> typeNames = {{
+            "nonstandard", "pubkey", "pubkeyhash", "multisig_pubkey", "scripthash", "multisig", "nulldata",
+            "witness_pubkeyhash", "witness_scripthash", "witness_unknown", "witness_taproot"
+        }};
+        for (size_t i = 0; i < AddressType::size; i++) {
+            ret[py::str(std::string{"outputs_"} + typeNames[i])] = field(py::dtype::of<uint32_t>(), offsetof(BlockStats, outputTypeCounts) + i * sizeof(uint32_t));
+        }
+        return ret;
+    }
+    
+    /** One strided view per field of the PendingTx records of a mempool snapshot */
+    py::dict pendingTxViews(const MempoolSnapshot &snapshot, py::handle base) {
+        auto data = reinterpret_cast<const char *>(snapshot.txes().begin());
+        auto field = [&](const py::dtype &dtype, size_t offset) {
+            return columnView(dtype, snapshot.size(), sizeof(PendingTx), data + offset, base);
+        };
+        py::dict ret;
+        ret["hash"] = field(py::dtype("S32"), offsetof(PendingTx, hash));
+        ret["fee"] = field(py::dtype::of<int64_t>(), offsetof(PendingTx, fee));
+        ret["ancestor_fee"] = field(py::dtype::of<int64_t>(), offsetof(PendingTx, ancestorFee));
+        ret["first_seen"] = field(py::dtype::of<int64_t>(), offsetof(PendingTx, firstSeen));
+        ret["fee_rate"] = field(py::dtype::of<double>(), offsetof(PendingTx, feeRate));
+        ret["vsize"] = field(py::dtype::of<uint32_t>(), offsetof(PendingTx, vsize));
+        ret["ancestor_size"] = field(py::dtype::of<uint32_t>(), offsetof(PendingTx, ancestorSize));
+        ret["ancestor_count"] = field(py::dtype::of<uint32_t>(), offsetof(PendingTx, ancestorCount));
+        ret["descendant_count"] = field(py::dtype::of<uint32_t>(), offsetof(PendingTx, descendantCount));
+        ret["projected_block"] = field(py::dtype::of<uint32_t>(), offsetof(PendingTx, projectedBlock));
+        return ret;
+    }
+    
+    /** One strided view per field of the AddressStats of every script of an address type */
+    py::dict addressStatsViews(const AddressStatsColumn &stats, py::handle base) {
+        auto data = reinterpret_cast<const char *>(stats.data);
+        auto field = [&](const py::dtype &dtype, size_t offset) {
+            return columnView(dtype, stats.count, sizeof(AddressStats), data == nullptr ? nullptr : data + offset, base);
+        };
+        py::dict ret;
+        ret["received"] = field(py::dtype::of<int64_t>(), offsetof(AddressStats, received));
+        ret["sent"] = field(py::dtype::of<int64_t>(), offsetof(AddressStats, sent));
+        ret["output_count"] = field(py::dtype::of<uint32_t>(), offsetof(AddressStats, outputCount));
+        ret["spent_output_count"] = field(py::dtype::of<uint32_t>(), offsetof(AddressStats, spentOutputCount));
+        ret["first_seen_height"] = field(py::dtype::of<int32_t>(), offsetof(AddressStats, firstSeenHeight));
+        ret["last_seen_height"] = field(py::dtype::of<int32_t>(), offsetof(AddressStats, lastSeenHeight));
+        return ret;
+    }
+    
+    /** One strided view per field of the InputSignature records of a range of inputs */
+    py::dict inputSignatureViews(const InputSignatureColumn &signatures, py::handle base) {
+        auto data = reinterpret_cast<const char *>(signatures.data);
+        auto field = [&](const py::dtype &dtype, size_t offset) {
+            return columnView(dtype, signatures.count, sizeof(InputSignature), data == nullptr ? nullptr : data + offset, base);
+        };
+        py::dict ret;
+        ret["r"] = field(py::dtype("S32"), offsetof(InputSignature, r));
+        ret["s"] = field(py::dtype("S32"), offsetof(InputSignature, s));
+        ret["pubkey"] = field(py::dtype("S33"), offsetof(InputSignature, pubkey));
+        ret["sighash"] = field(py::dtype::of<uint8_t>(), offsetof(InputSignature, sighash));
+        ret["flags"] = field(py::dtype::of<uint8_t>(), offsetof(InputSignature, flags));
+        ret["first_input"] = signatures.firstInput;
+        return ret;
+    }
+    
+    /** Timestamp and millisecond columns of the first seen times, viewing the recording if a single one covers all
+     * txes and copied otherwise, along with the observed flags and the combined times derived from them */
+    py::dict mempoolTimeViews(const MempoolTimeColumns &columns, py::handle base) {
+        py::dict ret;
+        py::array timestamps;
+        py::array milliseconds;
+        if (columns.isContiguous()) {
+            auto &segment = columns.segments.front();
+            timestamps = columnView(py::dtype::of<int64_t>(), columns.count, sizeof(int64_t), segment.timestamps, base);
+            milliseconds = columnView(py::dtype::of<uint16_t>(), columns.count, sizeof(uint16_t), segment.milliseconds, base);
+        } else {
+            py::array_t<int64_t> timestampsCopy{columns.count};
+            py::array_t<uint16_t> millisecondsCopy{columns.count};
+            columns.copyTo(timestampsCopy.mutable_data(), millisecondsCopy.mutable_data());
+            timestamps = timestampsCopy;
+            milliseconds = millisecondsCopy;
+        }
+        py::array_t<bool> observed{columns.count};
+        py::array timeSeen{py::dtype("M8[ms]"), {static_cast<py::ssize_t>(columns.count)}};
+        auto timestampsPtr = static_cast<const int64_t *>(timestamps.data());
+        auto millisecondsPtr = static_cast<const uint16_t *>(milliseconds.data());
+        auto observedPtr = observed.mutable_data();
+        auto timeSeenPtr = static_cast<int64_t *>(timeSeen.mutable_data());
+        for (uint32_t i = 0; i < columns.count; i++) {
+            observedPtr[i] = timestampsPtr[i] > 0;
+            // Same as Transaction::getTimeSeen, NaT for txes without a time
+            timeSeenPtr[i] = timestampsPtr[i] > 1 ? timestampsPtr[i] * 1000 + millisecondsPtr[i] : std::numeric_limits<int64_t>::min();
+        }
+        ret["timestamp"] = timestamps;
+        ret["milliseconds"] = milliseconds;
+        ret["observed"] = observed;
+        ret["time_seen"] = timeSeen;
+        ret["first_tx_index"] = columns.firstTxNum;
+        return ret;
+    }
+    
+    /** Values of a proxy combined over one chunk of the blocks, then over all chunks in block order */
+    template <typename T>
+    struct ProxyAccumulator {
+        ProxyReducer reducer;
+        int64_t sum = 0;
+        int64_t min = std::numeric_limits<int64_t>::max();
+        int64_t max = std::numeric_limits<int64_t>::min();
+        uint64_t count = 0;
+        std::vector<T> values;
+        std::unordered_map<int64_t, uint64_t> groups;
+        
+        explicit ProxyAccumulator(ProxyReducer reducer_) : reducer(reducer_) {}
+        
+        void add(T value) {
+            auto number = static_cast<int64_t>(value);
+            count++;
+            switch (reducer) {
+                case ProxyReducer::Sum: sum += number; break;
+                case ProxyReducer::Min: min = std::min(min, number); break;
+                case ProxyReducer::Max: max = std::max(max, number); break;
+                case ProxyReducer::Concat: values.push_back(value); break;
+                case ProxyReducer::GroupCount: groups[number]++; break;
+            }
+        }
+        
+        void merge(ProxyAccumulator &other) {
+            count += other.count;
+            sum += other.sum;
+            min = std::min(min, other.min);
+            max = std::max(max, other.max);
+            values.insert(values.end(), other.values.begin(), other.values.end());
+            for (auto &group : other.groups) {
+                groups[group.first] += group.second;
+            }
+        }
+        
+        py::object toPython() const {
+            switch (reducer) {
+                case ProxyReducer::Sum: return py::int_(sum);
+                case ProxyReducer::Min: return count > 0 ? py::object(py::int_(min)) : py::none();
+                case ProxyReducer::Max: return count > 0 ? py::object(py::int_(max)) : py::none();
+                case ProxyReducer::Concat: {
+                    py::array_t<T> ret{values.size()};
+                    std::copy(values.begin(), values.end(), ret.mutable_data());
+                    return std::move(ret);
+                }
+                case ProxyReducer::GroupCount: {
+                    py::dict ret;
+                    for (auto &group : groups) {
+                        ret[py::int_(group.first)] = group.second;
+                    }
+                    return std::move(ret);
+                }
+            }
+            return py::none();
+        }
+    };
+    
+    /** Evaluate the proxy on every transaction (or every block for block proxies) of the blocks on the work pool of the
+     * chain and reduce the values, all without the GIL. Integer and boolean proxies are computed entirely in C++ */
+    template <typename T>
+    py::object proxyMapReduce(Blockchain &chain, const Proxy<T> &proxy, ProxyReducer reducer, BlockHeight start, BlockHeight stop) {
+        if (stop < 0) {
+            stop = chain.size();
+        }
+        auto blocks = chain[{start, stop}];
+        auto blockSource = *proxy.getSourceType().type == typeid(Block);
+        if (!blockSource) {
+            createProxyTypeInfo<Transaction>().checkMatch(proxy.getSourceType());
+        }
+        ProxyAccumulator<T> result{reducer};
+        {
+            py::gil_scoped_release release;
+            auto chunks = blocks.segment(blocks.chunkCount());
+            std::vector<ProxyAccumulator<T>> chunkResults(chunks.size(), ProxyAccumulator<T>{reducer});
+            blocks.runChunks(static_cast<uint32_t>(chunks.size()), [&](uint32_t chunkNum) {
+                auto &chunk = chunks[chunkNum];
+                chunk.checkReorg();
+                chunk.adviseAccess(AccessHint::WillNeed);
+                auto &accumulator = chunkResults[chunkNum];
+                for (auto block : chunk) {
+                    if (blockSource) {
+                        accumulator.add(proxy(block));
+                    } else {
+                        for (auto tx : block) {
+                            accumulator.add(proxy(tx));
+                        }
+                    }
+                }
+            });
+            for (auto &chunkResult : chunkResults) {
+                result.merge(chunkResult);
+            }
+        }
+        return result.toPython();
+    }
+    
+    /** Key or value proxy of Blockchain.group_aggregate read as an integer
+     *
+     * Integers and booleans are used as is, address types as their number and addresses as their sketchAddressKey, so
+     * every group table is keyed by a plain int64_t and only the final keys are turned back into Python objects. */
+    struct GroupColumn {
+        enum class Kind {
+            Integer, Bool, AddressType, Address
+        };
+        
+        std::function<int64_t(std::any &)> value;
+        ProxyTypeInfo sourceType;
+        Kind kind;
+        
+        py::object toPython(int64_t number, DataAccess &access) const {
+            switch (kind) {
+                case Kind::Integer: return py::int_(number);
+                case Kind::Bool: return py::bool_(number != 0);
+                case Kind::AddressType: return py::cast(static_cast<AddressType::Enum>(number));
+                case Kind::Address: {
+                    auto key = static_cast<uint64_t>(number);
+                    return py::cast(Address{static_cast<uint32_t>(key >> 8), static_cast<AddressType::Enum>(key & 0xff), access});
+                }
+            }
+            return py::none();
+        }
+    };
+    
+    GroupColumn groupColumn(py::handle proxy) {
+        if (py::isinstance<Proxy<bool>>(proxy)) {
+            auto &boolProxy = proxy.cast<Proxy<bool> &>();
+            return {[func = boolProxy.func](std::any &object) -> int64_t { return func(object); }, boolProxy.getSourceType(), GroupColumn::Kind::Bool};
+        } else if (py::isinstance<Proxy<int64_t>>(proxy)) {
+            auto &intProxy = proxy.cast<Proxy<int64_t> &>();
+            return {intProxy.func, intProxy.getSourceType(), GroupColumn::Kind::Integer};
+        } else if (py::isinstance<Proxy<AddressType::Enum>>(proxy)) {
+            auto &typeProxy = proxy.cast<Proxy<AddressType::Enum> &>();
+            return {[func = typeProxy.func](std::any &object) -> int64_t { return static_cast<int64_t>(func(object)); }, typeProxy.getSourceType(), GroupColumn::Kind::AddressType};
+        } else if (py::isinstance<ProxyAddress>(proxy)) {
+            auto &addressProxy = proxy.cast<ProxyAddress &>();
+            return {[func = addressProxy.getGenericScript()](std::any &object) -> int64_t {
+                auto script = func(object);
+                return static_cast<int64_t>(sketchAddressKey(script.getScriptNum(), script.getType()));
+            }, addressProxy.getSourceType(), GroupColumn::Kind::Address};
+        }
+        throw std::invalid_argument("group_aggregate takes integer, boolean, address type or address proxies");
+    }
+    
+    /** Values of one group of Blockchain.group_aggregate */
+    struct GroupState {
+        uint64_t count = 0;
+        int64_t sum = 0;
+        int64_t min = std::numeric_limits<int64_t>::max();
+        int64_t max = std::numeric_limits<int64_t>::min();
+        std::unique_ptr<HyperLogLog> distinct;
+    };
+    
+    /** Hash table of the groups of one chunk of the blocks, then of all chunks merged into the largest table */
+    struct GroupAccumulator {
+        /** Precision of the sketch of each group for distinct_approx, 1KB per group with a standard error of 3.3% */
+        static constexpr uint8_t distinctPrecision = 10;
+        
+        ProxyAggregate aggregate;
+        std::unordered_map<int64_t, GroupState> groups;
+        
+        explicit GroupAccumulator(ProxyAggregate aggregate_) : aggregate(aggregate_) {}
+        
+        void add(int64_t key, int64_t value) {
+            auto &state = groups[key];
+            state.count++;
+            switch (aggregate) {
+                case ProxyAggregate::Count: break;
+                case ProxyAggregate::Sum: case ProxyAggregate::Mean: state.sum += value; break;
+                case ProxyAggregate::Min: state.min = std::min(state.min, value); break;
+                case ProxyAggregate::Max: state.max = std::max(state.max, value); break;
+                case ProxyAggregate::DistinctApprox: {
+                    if (!state.distinct) {
+                        state.distinct = std::make_unique<HyperLogLog>(distinctPrecision);
+                    }
+                    state.distinct->add(static_cast<uint64_t>(value));
+                    break;
+                }
+            }
+        }
+        
+        void merge(GroupAccumulator &other) {
+            for (auto &group : other.groups) {
+                auto &state = groups[group.first];
+                auto &otherState = group.second;
+                state.count += otherState.count;
+                state.sum += otherState.sum;
+                state.min = std::min(state.min, otherState.min);
+                state.max = std::max(state.max, otherState.max);
+                if (otherState.distinct) {
+                    if (state.distinct) {
+                        state.distinct->merge(*otherState.distinct);
+                    } else {
+                        state.distinct = std::move(otherState.distinct);
+                    }
+                }
+            }
+            other.groups.clear();
+        }
+        
+        py::object value(const GroupState &state) const {
+            switch (aggregate) {
+                case ProxyAggregate::Count: return py::int_(state.count);
+                case ProxyAggregate::Sum: return py::int_(state.sum);
+                case ProxyAggregate::Min: return py::int_(state.min);
+                case ProxyAggregate::Max: return py::int_(state.max);
+                case ProxyAggregate::Mean: return py::float_(static_cast<double>(state.sum) / static_cast<double>(state.count));
+                case ProxyAggregate::DistinctApprox: return py::int_(static_cast<uint64_t>(std::llround(state.distinct->estimate())));
+            }
+            return py::none();
+        }
+    };
+    
+    /** Group the objects of the source type of the key proxy in the blocks [start, stop) by its values and aggregate
+     * the values of the value proxy per group. Every chunk of the blocks fills its own hash table on the work pool
+     * without the GIL, and the tables are merged at the end */
+    py::dict proxyGroupAggregate(Blockchain &chain, py::handle keyProxy, py::handle valueProxy, ProxyAggregate aggregate, BlockHeight start, BlockHeight stop) {
+        if (stop < 0) {
+            stop = chain.size();
+        }
+        auto blocks = chain[{start, stop}];
+        auto key = groupColumn(keyProxy);
+        std::function<int64_t(std::any &)> value;
+        if (valueProxy.is_none()) {
+            if (aggregate != ProxyAggregate::Count) {
+                throw std::invalid_argument("group_aggregate needs a value proxy for aggregates other than count");
+            }
+        } else {
+            auto valueColumn = groupColumn(valueProxy);
+            if (*valueColumn.sourceType.type != *key.sourceType.type) {
+                throw std::invalid_argument("The key and value proxies of group_aggregate must have the same source type");
+            }
+            value = std::move(valueColumn.value);
+        }
+        const auto &source = *key.sourceType.type;
+        if (source != typeid(Block) && source != typeid(Transaction) && source != typeid(Input) && source != typeid(Output)) {
+            throw std::invalid_argument("group_aggregate can only group block, transaction, input or output proxies");
+        }
+        GroupAccumulator result{aggregate};
+        {
+            py::gil_scoped_release release;
+            auto chunks = blocks.segment(blocks.chunkCount());
+            std::vector<GroupAccumulator> chunkResults;
+            chunkResults.reserve(chunks.size());
+            for (size_t i = 0; i < chunks.size(); i++) {
+                chunkResults.emplace_back(aggregate);
+            }
+            blocks.runChunks(static_cast<uint32_t>(chunks.size()), [&](uint32_t chunkNum) {
+                auto &chunk = chunks[chunkNum];
+                chunk.checkReorg();
+                chunk.adviseAccess(AccessHint::WillNeed);
+                auto &accumulator = chunkResults[chunkNum];
+                auto add = [&](std::any object) {
+                    accumulator.add(key.value(object), value ? value(object) : 0);
+                };
+                for (auto block : chunk) {
+                    if (source == typeid(Block)) {
+                        add(block);
+                        continue;
+                    }
+                    for (auto tx : block) {
+                        if (source == typeid(Transaction)) {
+                            add(tx);
+                        } else if (source == typeid(Input)) {
+                            for (auto input : tx.inputs()) {
+                                add(input);
+                            }
+                        } else {
+                            for (auto output : tx.outputs()) {
+                                add(output);
+                            }
+                        }
+                    }
+                }
+            });
+            if (!chunkResults.empty()) {
+                auto largest = std::max_element(chunkResults.begin(), chunkResults.end(), [](const GroupAccumulator &a, const GroupAccumulator &b) {
+                    return a.groups.size() < b.groups.size();
+                });
+                result.groups = std::move(largest->groups);
+                largest->groups.clear();
+                for (auto &chunkResult : chunkResults) {
+                    result.merge(chunkResult);
+                }
+            }
+        }
+        py::dict ret;
+        auto &access = chain.getAccess();
+        for (auto &group : result.groups) {
+            ret[key.toPython(group.first, access)] = result.value(group.second);
+        }
+        return ret;
+    }
+    
+    py::dtype derivedColumnDtype(DerivedColumnType type) {
+        switch (type) {
+            case DerivedColumnType::Int64: return py::dtype::of<int64_t>();
+            case DerivedColumnType::UInt32: return py::dtype::of<uint32_t>();
+            case DerivedColumnType::UInt16: return py::dtype::of<uint16_t>();
+            case DerivedColumnType::UInt8: return py::dtype::of<uint8_t>();
+        }
+        throw std::invalid_argument("Unknown derived column type");
+    }
+    
+    /** Definition of a derived column storing the value of the proxy as a V for every object of its source type */
+    template <typename V, typename T>
+    DerivedColumnSpec proxyColumnSpec(const std::string &name, const Proxy<T> &proxy, std::vector<std::string> dependencies, uint32_t version) {
+        auto value = [proxy](auto object) { return static_cast<V>(proxy(object)); };
+        const auto &source = *proxy.getSourceType().type;
+        if (source == typeid(Block)) {
+            return DerivedColumnSpec::perBlock<V>(name, value, std::move(dependencies), version);
+        } else if (source == typeid(Transaction)) {
+            return DerivedColumnSpec::perTx<V>(name, value, std::move(dependencies), version);
+        } else if (source == typeid(Input)) {
+            return DerivedColumnSpec::perInput<V>(name, value, std::move(dependencies), version);
+        } else if (source == typeid(Output)) {
+            return DerivedColumnSpec::perOutput<V>(name, value, std::move(dependencies), version);
+        }
+        throw std::invalid_argument("Derived columns can only be computed from block, transaction, input or output proxies");
+    }
+    
+    template <typename T>
+    DerivedColumnSpec proxyColumnSpec(const std::string &name, const Proxy<T> &proxy, const std::string &dtype, std::vector<std::string> dependencies, uint32_t version) {
+        if (dtype == "int64") {
+            return proxyColumnSpec<int64_t>(name, proxy, std::move(dependencies), version);
+        } else if (dtype == "uint32") {
+            return proxyColumnSpec<uint32_t>(name, proxy, std::move(dependencies), version);
+        } else if (dtype == "uint16") {
+            return proxyColumnSpec<uint16_t>(name, proxy, std::move(dependencies), version);
+        } else if (dtype == "uint8") {
+            return proxyColumnSpec<uint8_t>(name, proxy, std::move(dependencies), version);
+        }
+        throw std::invalid_argument("Derived columns can be stored as int64, uint32, uint16 or uint8, not " + dtype);
+    }
+    
+    /** Views of one derived column opened by a derived_value proxy
+     *
+     * The column is opened on first use and reopened once the view is stale, so a proxy created before its column was
+     * built or updated (like the proxy of a dependent column) reads the current values. Views are kept until the proxy
+     * is gone since other threads may still read an older one. */
+    struct DerivedValueSource {
+        Blockchain *chain;
+        std::string name;
+        std::mutex mutex;
+        std::vector<std::unique_ptr<DerivedColumn>> views;
+        std::atomic<const DerivedColumn *> current{nullptr};
+        
+        DerivedValueSource(Blockchain &chain_, std::string name_) : chain(&chain_), name(std::move(name_)) {}
+        
+        const DerivedColumn &column() {
+            auto view = current.load(std::memory_order_acquire);
+            if (view == nullptr || view->isStale()) {
+                std::lock_guard<std::mutex> lock(mutex);
+                view = current.load(std::memory_order_acquire);
+                if (view == nullptr || view->isStale()) {
+                    views.push_back(std::make_unique<DerivedColumn>(chain->derivedColumn(name)));
+                    view = views.back().get();
+                    current.store(view, std::memory_order_release);
+                }
+            }
+            return *view;
+        }
+    };
+    
+    /** Proxy reading the stored value of a derived column for the object */
+    template <typename T>
+    Proxy<int64_t> derivedValueProxy(Blockchain &chain, const std::string &name, const Proxy<T> &object) {
+        auto source = std::make_shared<DerivedValueSource>(chain, name);
+        return {std::function<int64_t(std::any &)>{[source, object](std::any &v) {
+            auto &column = source->column();
+            auto value = column.value(object(v));
+            if (!value) {
+                throw std::out_of_range("Derived column " + column.name() + " does not cover the object yet, call update_derived_columns");
+            }
+            return *value;
+        }}, object.sourceType};
+    }
+    
+    /** Call write(i, object) for every object of the list, returning false at the first one that isn't a T */
+    template <typename T, typename F>
+    bool packEach(const py::list &objects, F &&write) {
+        py::detail::make_caster<T> caster;
+        for (size_t i = 0; i < objects.size(); i++) {
+            if (!caster.load(objects[i], false)) {
+                return false;
+            }
+            write(i, py::detail::cast_op<const T &>(caster));
+        }
+        return true;
+    }
+
+    py::object packInouts(const py::list &objects, bool inputs) {
+        auto count = objects.size();
+        py::array_t<uint32_t> txNums{count};
+        py::array_t<uint16_t> indexes{count};
+        auto txNumsPtr = txNums.mutable_data();
+        auto indexesPtr = indexes.mutable_data();
+        auto write = [&](size_t i, const auto &inout) {
+            txNumsPtr[i] = inout.pointer.txNum;
+            indexesPtr[i] = inout.pointer.inoutNum;
+        };
+        auto packed = inputs ? packEach<Input>(objects, write) : packEach<Output>(objects, write);
+        if (!packed) {
+            return py::none();
+        }
+        return py::make_tuple(inputs ? "Input" : "Output", py::make_tuple(txNums, indexes));
+    }
+
+    /** (tag, arrays) describing a list holding only blocks, transactions, inputs, outputs or addresses, None otherwise */
+    py::object packObjects(const py::list &objects) {
+        auto count = objects.size();
+        if (count == 0) {
+            return py::none();
+        }
+        py::handle first = objects[0];
+        if (py::isinstance<Block>(first)) {
+            py::array_t<int32_t> heights{count};
+            auto heightsPtr = heights.mutable_data();
+            if (packEach<Block>(objects, [&](size_t i, const Block &block) { heightsPtr[i] = block.height(); })) {
+                return py::make_tuple("Block", py::make_tuple(heights));
+            }
+        } else if (py::isinstance<Transaction>(first)) {
+            py::array_t<uint32_t> txNums{count};
+            auto txNumsPtr = txNums.mutable_data();
+            if (packEach<Transaction>(objects, [&](size_t i, const Transaction &tx) { txNumsPtr[i] = tx.txNum; })) {
+                return py::make_tuple("Tx", py::make_tuple(txNums));
+            }
+        } else if (py::isinstance<Output>(first)) {
+            return packInouts(objects, false);
+        } else if (py::isinstance<Input>(first)) {
+            return packInouts(objects, true);
+        } else {
+            py::array_t<uint32_t> scriptNums{count};
+            py::array_t<uint8_t> types{count};
+            auto scriptNumsPtr = scriptNums.mutable_data();
+            auto typesPtr = types.mutable_data();
+            if (packEach<Address>(objects, [&](size_t i, const Address &address) {
+                scriptNumsPtr[i] = address.scriptNum;
+                typesPtr[i] = static_cast<uint8_t>(address.type);
+            })) {
+                return py::make_tuple("Address", py::make_tuple(scriptNums, types));
+            }
+        }
+        return py::none();
+    }
+
+    template <typename T>
+    std::shared_ptr<const std::vector<T>> packedArray(py::handle array) {
+        auto values = py::array_t<T, py::array::c_style | py::array::forcecast>::ensure(array);
+        if (!values) {
+            throw std::invalid_argument("Packed object data must be a numpy array");
+        }
+        return std::make_shared<const std::vector<T>>(values.data(), values.data() + values.size());
+    }
+
+    /** Range lazily constructing element i as make(i) */
+    template <typename T, typename F>
+    RawRange<T> lazyPackedRange(size_t count, F make) {
+        return RawRange<T>{ranges::views::ints(size_t{0}, count) | ranges::views::transform(std::move(make))};
+    }
+
+    /** Lazy range of the outputs, keeping the pointers alive */
+    RawRange<Output> outputPointerRange(std::vector<OutputPointer> pointers, DataAccess &access) {
+        auto shared = std::make_shared<const std::vector<OutputPointer>>(std::move(pointers));
+        auto accessPtr = &access;
+        return lazyPackedRange<Output>(shared->size(), [shared, accessPtr](size_t i) { return Output{(*shared)[i], *accessPtr}; });
+    }
+    
+    /** The items selected by the filter of a pushed down predicate, checked with the predicate if the filter is inexact */
+    template <typename T>
+    py::object pushdownResult(RawRange<T> &&candidates, const Proxy<bool> &predicate, bool exact) {
+        if (exact) {
+            return py::cast(std::move(candidates));
+        }
+        if (auto kernel = batchKernelFor<T>(predicate)) {
+            return py::cast(RawIterator<T>{batch_filter_range<T>{RawIterator<T>{std::move(candidates)}, std::move(kernel)}});
+        }
+        return py::cast(RawIterator<T>{ranges::views::filter(std::move(candidates), [predicate](T item) {
+            return predicate(std::move(item));
+        })});
+    }
+
+    py::object unpackObjects(Blockchain &chain, const std::string &tag, const py::tuple &arrays, bool lazy) {
+        auto access = &chain.getAccess();
+        auto result = [&](auto &&range) -> py::object {
+            if (lazy) {
+                return py::cast(std::move(range));
+            }
+            py::list list;
+            for (auto && item : range) {
+                list.append(py::cast(item));
+            }
+            return list;
+        };
+        if (tag == "Block") {
+            auto heights = packedArray<int32_t>(arrays[0]);
+            return result(lazyPackedRange<Block>(heights->size(), [heights, access](size_t i) { return Block{(*heights)[i], *access}; }));
+        } else if (tag == "Tx") {
+            auto txNums = packedArray<uint32_t>(arrays[0]);
+            return result(lazyPackedRange<Transaction>(txNums->size(), [txNums, access](size_t i) { return Transaction{(*txNums)[i], *access}; }));
+        } else if (tag == "Output" || tag == "Input") {
+            auto txNums = packedArray<uint32_t>(arrays[0]);
+            auto indexes = packedArray<uint16_t>(arrays[1]);
+            if (indexes->size() != txNums->size()) {
+                throw std::invalid_argument("Packed " + tag + " arrays have different lengths");
+            }
+            if (tag == "Output") {
+                return result(lazyPackedRange<Output>(txNums->size(), [txNums, indexes, access](size_t i) { return Output{OutputPointer{(*txNums)[i], (*indexes)[i]}, *access}; }));
+            }
+            return result(lazyPackedRange<Input>(txNums->size(), [txNums, indexes, access](size_t i) { return Input{InputPointer{(*txNums)[i], (*indexes)[i]}, *access}; }));
+        } else if (tag == "Address") {
+            auto scriptNums = packedArray<uint32_t>(arrays[0]);
+            auto types = packedArray<uint8_t>(arrays[1]);
+            if (types->size() != scriptNums->size()) {
+                throw std::invalid_argument("Packed Address arrays have different lengths");
+            }
+            return result(lazyPackedRange<AnyScript>(scriptNums->size(), [scriptNums, types, access](size_t i) {
+                return Address{(*scriptNums)[i], static_cast<AddressType::Enum>((*types)[i]), *access}.getScript();
+            }));
+        }
+        throw std::invalid_argument("Unknown packed object type " + tag);
+    }
+    
     template<blocksci::AddressType::Enum type>
     struct PythonScriptRangeFunctor {
         static PythonScriptRangeVariant f(blocksci::DataAccess &access) {
@@ -68,10 +882,98 @@ void init_blockchain(py::class_<Blockchain> &cl) {
     cl
     .def(py::init<std::string>())
     .def(py::init<std::string, BlockHeight>())
+    .def(py::init([](std::string configPath, uint64_t snapshotVersion) {
+        return std::make_unique<Blockchain>(configPath, ChainSnapshot{snapshotVersion});
+    }), py::arg("config_path"), py::arg("snapshot_version"), "Open the chain as it was after the parser update that published the given snapshot (0 for the latest), pass snapshot_version by keyword. Scans see a consistent chain while the parser keeps appending blocks.")
     .def_property_readonly("data_location", &Blockchain::dataLocation, "Returns the location of the data directory that this Blockchain object represents.")
     .def_property_readonly("config_location", &Blockchain::configLocation, "Returns the location of the configuration file that this Blockchain object represents.")
     .def("reload", &Blockchain::reload, "Reload the blockchain to make new blocks visible (Invalidates current BlockSci objects).")
     .def("is_parser_running", &Blockchain::isParserRunning, "Returns whether the parser is currently operating on this chain's data directory.")
+    .def("disk_block_count", &Blockchain::diskBlockCount, "Number of blocks the parser has written to disk, larger than len(chain) once new blocks arrived since the last reload. Only stats a file, so it is cheap to poll.")
+    .def_property_readonly("snapshot_version", &Blockchain::snapshotVersion, "Snapshot the chain is pinned to, 0 if it loads everything on disk")
+    .def("latest_snapshot_version", &Blockchain::latestSnapshotVersion, "Version of the most recent snapshot the parser published, 0 if there is none")
+    .def("data_generation", &Blockchain::dataGeneration, "Counter the parser increments around every update of the data directory (0 for data written by older parsers)")
+    .def("check_reorg", &Blockchain::checkReorg, "Raise an exception if the chain was loaded with error_on_reorg and the last loaded block has been replaced (individual accessors don't check).")
+    .def("set_parallelism", [](Blockchain &chain, unsigned maxThreads, bool pinThreads, unsigned chunksPerThread, uint32_t minChunkTxCount, bool numaAware) {
+        ParallelConfig config;
+        config.maxThreads = maxThreads;
+        config.pinThreads = pinThreads;
+        config.numaAware = numaAware;
+        config.chunksPerThread = chunksPerThread;
+        config.minChunkTxCount = minChunkTxCount;
+        chain.setParallelism(config);
+    }, py::arg("max_threads") = 0, py::arg("pin_threads") = false, py::arg("chunks_per_thread") = 16, py::arg("min_chunk_tx_count") = 4096,
+        py::arg("numa_aware") = false,
+        "Set the number of threads (0 for one per hardware thread) and the chunking used by the parallel operations on this chain. With numa_aware the threads are spread over the NUMA nodes, each node processing a contiguous range of the chain. Must not be called while one of them is running.")
+    .def("make_resident", [](Blockchain &chain, bool lockTxData, NumaPlacement placement) {
+        auto stats = chain.makeResident(lockTxData, placement);
+        py::dict ret;
+        ret["resident_bytes"] = stats.residentBytes;
+        ret["huge_page_bytes"] = stats.hugePageBytes;
+        ret["locked_bytes"] = stats.lockedBytes;
+        return ret;
+    }, py::arg("lock_tx_data") = false, py::arg("placement") = NumaPlacement::Default,
+        "Copy the block and transaction index files into huge page backed memory (optionally locking the transaction data into memory and spreading the copies over the NUMA nodes according to placement) and return how much memory is held.")
+    .def("prefetch", [](Blockchain &chain, BlockHeight start, BlockHeight stop, unsigned int threadCount) {
+        if (stop < 0) {
+            stop = chain.size();
+        }
+        py::gil_scoped_release release;
+        chain[{start, stop}].prefetch(threadCount);
+    }, py::arg("start") = 0, py::arg("stop") = -1, py::arg("threads") = 0,
+        "Load the transaction data of the blocks [start, stop) in block order at batch priority on up to the given number of threads (0 for the limit of the enclosing WorkScope). For a chain stored in object storage this fills the local cache of tx_data.dat, so running it in a background thread ahead of a scan warms up a new node.")
+    .def("page_cache_residency", [](const Blockchain &chain) {
+        py::list ret;
+        for (auto &file : chain.pageCacheResidency()) {
+            py::dict entry;
+            entry["path"] = file.path;
+            entry["size"] = file.size;
+            entry["resident_bytes"] = file.residentBytes;
+            ret.append(entry);
+        }
+        return ret;
+    }, "Return the page cache residency of every data file of the chain, in warmup priority order.")
+    .def("memory_usage", [](const Blockchain &chain) {
+        MemoryUsage usage;
+        {
+            py::gil_scoped_release release;
+            usage = chain.memoryUsage();
+        }
+        py::dict files;
+        for (auto &file : usage.mappedFiles) {
+            files[py::str(file.path)] = file.residentBytes;
+        }
+        py::dict indexes;
+        indexes["memtable_bytes"] = usage.indexes.memtableBytes;
+        indexes["table_reader_bytes"] = usage.indexes.tableReaderBytes;
+        indexes["block_cache_bytes"] = usage.indexes.blockCacheBytes;
+        indexes["block_cache_capacity"] = usage.indexes.blockCacheCapacity;
+        py::dict ret;
+        ret["total_bytes"] = usage.totalBytes();
+        ret["mapped_resident_bytes"] = usage.mappedResidentBytes;
+        ret["mapped_files"] = files;
+        ret["resident_mode_bytes"] = usage.residentMode.residentBytes;
+        ret["indexes"] = indexes;
+        ret["chain_index_bytes"] = usage.chainIndexBytes;
+        ret["process_resident_bytes"] = usage.processResidentBytes;
+        return ret;
+    }, "Return a dict with the memory held by the chain: resident bytes of every mapped data file (mincore), the RocksDB memory of the open indexes, the in-memory chain indexes and resident mode copies. process_resident_bytes is the RSS of the whole process, including Python objects, and not part of total_bytes.")
+    .def_property("memory_budget", &Blockchain::memoryBudget, &Blockchain::setMemoryBudget,
+        "Bytes of memory (total_bytes of memory_usage) the chain may hold before enforce_memory_budget and reload release some, 0 for no limit. Defaults to the memoryBudgetMB config entry.")
+    .def("enforce_memory_budget", [](Blockchain &chain) {
+        MemoryBudgetResult result;
+        {
+            py::gil_scoped_release release;
+            result = chain.enforceMemoryBudget();
+        }
+        py::dict ret;
+        ret["budget"] = result.budget;
+        ret["usage_before"] = result.usageBefore;
+        ret["block_cache_released"] = result.blockCacheReleased;
+        ret["mapping_released"] = result.mappingReleased;
+        ret["dropped_columns"] = result.droppedColumns;
+        return ret;
+    }, "Shrink the RocksDB block caches, then drop the coldest chain data files from memory (madvise MADV_DONTNEED) until the chain fits into memory_budget. Returns a dict describing what was released.")
     .def("addresses", [](Blockchain &chain, AddressType::Enum type) {
         static constexpr auto table = make_dynamic_table<AddressType, PythonScriptRangeFunctor>();
         auto index = static_cast<size_t>(type);
@@ -87,12 +989,301 @@ void init_blockchain(py::class_<Blockchain> &cl) {
         +[](Blockchain &chain) -> Range<Block> {
         return ranges::any_view<Block, random_access_sized>{chain};
     }, "Returns a range of all the blocks in the chain")
+    .def("as_of", &Blockchain::asOf, pybind11::arg("height"), pybind11::keep_alive<0, 1>(),
+        "Return a ChainView of the chain as of the given number of blocks. Views share the open data files and indexes of the chain, so creating one per height of a time series is cheap compared to opening a Blockchain with a max block for each")
     .def("tx_with_index", [](Blockchain &chain, uint32_t index) {
         return Transaction{index, chain.getAccess()};
     }, "This functions gets the transaction with given index.", pybind11::arg("index"))
     .def("tx_with_hash", [](Blockchain &chain, const std::string &hash) {
         return Transaction{hash, chain.getAccess()};
     },"This functions gets the transaction with given hash.", pybind11::arg("tx_hash"))
+    .def("tx_indexes_with_hashes", [](Blockchain &chain, py::array_t<std::array<char, 64>, py::array::c_style> hexStrings) {
+        auto count = static_cast<size_t>(hexStrings.size());
+        std::vector<uint256> hashes(count);
+        std::vector<ranges::optional<uint32_t>> indexes;
+        size_t decoded;
+        {
+            py::gil_scoped_release release;
+            decoded = decodeHexBatch(reinterpret_cast<const char *>(hexStrings.data()), 64, 32, count, reinterpret_cast<unsigned char *>(hashes.data()));
+            if (decoded == count) {
+                indexes = getTxIndexes(hashes, chain.getAccess());
+            }
+        }
+        if (decoded != count) {
+            throw std::invalid_argument("Hash number " + std::to_string(decoded) + " is not a hex string of 64 digits");
+        }
+        py::array_t<int64_t> ret{indexes.size()};
+        auto retPtr = ret.mutable_data();
+        for (size_t i = 0; i < indexes.size(); i++) {
+            retPtr[i] = indexes[i] ? static_cast<int64_t>(*indexes[i]) : -1;
+        }
+        return ret;
+    }, "Same as tx_indexes_with_hashes for a numpy array of dtype S64, whose strings are decoded in bulk without creating Python objects", pybind11::arg("tx_hashes").noconvert())
+    .def("tx_indexes_with_hashes", [](Blockchain &chain, const std::vector<std::string> &hashes) {
+        std::vector<ranges::optional<uint32_t>> indexes;
+        {
+            py::gil_scoped_release release;
+            indexes = getTxIndexes(hashes, chain.getAccess());
+        }
+        py::array_t<int64_t> ret{indexes.size()};
+        auto retPtr = ret.mutable_data();
+        for (size_t i = 0; i < indexes.size(); i++) {
+            retPtr[i] = indexes[i] ? static_cast<int64_t>(*indexes[i]) : -1;
+        }
+        return ret;
+    }, "Look up the indexes of the transactions with the given hashes in one batch. Returns a numpy array that contains -1 for hashes without a matching transaction.", pybind11::arg("tx_hashes"))
+    .def("filter_tx_indexes", [](Blockchain &chain, Proxy<bool> &predicate, BlockHeight start, BlockHeight stop, std::optional<WorkPriority> priority) {
+        if (stop < 0) {
+            stop = chain.size();
+        }
+        auto blocks = chain[{start, stop}];
+        std::vector<uint32_t> txNums;
+        {
+            auto scope = callScope(priority);
+            py::gil_scoped_release release;
+            // The proxy may call back into Python
+            txNums = blocks.filterTxNums([&predicate](const Transaction &tx) {
+                py::gil_scoped_acquire acquire;
+                return predicate(tx);
+            });
+        }
+        py::array_t<uint32_t> ret{txNums.size()};
+        std::copy(txNums.begin(), txNums.end(), ret.mutable_data());
+        return ret;
+    }, "Return a sorted numpy array of the indexes of the transactions in the blocks [start, stop) for which the given transaction proxy evaluates to True, evaluated in parallel at the given work_priority (by default the one of the enclosing WorkScope)",
+        pybind11::arg("predicate"), pybind11::arg("start") = 0, pybind11::arg("stop") = -1, pybind11::arg("priority") = py::none())
+    .def("_where_pushdown", [](Blockchain &chain, Proxy<bool> &predicate, const std::string &table, BlockHeight start, BlockHeight stop) -> py::object {
+        auto pushdown = predicate.pushdown;
+        if (!pushdown || !pushdown->filter) {
+            return py::none();
+        }
+        if (stop < 0) {
+            stop = chain.size();
+        }
+        auto blocks = chain[{start, stop}];
+        auto access = &chain.getAccess();
+        if (table == "tx" && *pushdown->itemType == typeid(Transaction)) {
+            std::vector<uint32_t> txNums;
+            {
+                py::gil_scoped_release release;
+                txNums = txNumsMatching(blocks, *pushdown->filter);
+            }
+            auto shared = std::make_shared<const std::vector<uint32_t>>(std::move(txNums));
+            return pushdownResult(lazyPackedRange<Transaction>(shared->size(), [shared, access](size_t i) { return Transaction{(*shared)[i], *access}; }), predicate, pushdown->exact);
+        } else if (table == "output" && *pushdown->itemType == typeid(Output)) {
+            std::vector<OutputPointer> pointers;
+            {
+                py::gil_scoped_release release;
+                pointers = outputsMatching(blocks, *pushdown->filter);
+            }
+            return pushdownResult(outputPointerRange(std::move(pointers), *access), predicate, pushdown->exact);
+        }
+        return py::none();
+    }, "Answer a where over the txes (table tx) or outputs (table output) of the blocks [start, stop) from the tx fee and output columns and the address index if the predicate compares fee, block_height, value, address_type or address with constants. Returns None if it can't, used by the where of ranges derived from chain.blocks.",
+        pybind11::arg("predicate"), pybind11::arg("table"), pybind11::arg("start") = 0, pybind11::arg("stop") = -1)
+    .def("blocks_possibly_touching", [](Blockchain &chain, const std::vector<Address> &addresses, BlockHeight start, BlockHeight stop) {
+        if (stop < 0) {
+            stop = chain.size();
+        }
+        auto blocks = chain[{start, stop}];
+        std::vector<Block> matches;
+        {
+            py::gil_scoped_release release;
+            matches = blocks.blocksPossiblyTouching(addresses);
+        }
+        py::array_t<BlockHeight> ret{matches.size()};
+        auto retPtr = ret.mutable_data();
+        for (size_t i = 0; i < matches.size(); i++) {
+            retPtr[i] = matches[i].height();
+        }
+        return ret;
+    }, "Return a numpy array of the heights of the blocks in [start, stop) that may use one of the given addresses in an input or output. Only reads the per block address filters written by the parser's build-address-filters command, a small fraction of the returned blocks are false positives and blocks without a filter are always returned.",
+        pybind11::arg("addresses"), pybind11::arg("start") = 0, pybind11::arg("stop") = -1)
+    .def("scan_for_addresses", [](Blockchain &chain, const AddressSet &addresses, BlockHeight start, BlockHeight stop) {
+        if (stop < 0) {
+            stop = chain.size();
+        }
+        auto blocks = chain[{start, stop}];
+        std::vector<AddressMatch> matches;
+        {
+            py::gil_scoped_release release;
+            matches = scanForAddresses(blocks, addresses);
+        }
+        py::array_t<uint32_t> txIndexes{matches.size()};
+        py::array_t<uint16_t> inoutNums{matches.size()};
+        py::array_t<bool> isOutput{matches.size()};
+        auto txIndexesPtr = txIndexes.mutable_data();
+        auto inoutNumsPtr = inoutNums.mutable_data();
+        auto isOutputPtr = isOutput.mutable_data();
+        for (size_t i = 0; i < matches.size(); i++) {
+            txIndexesPtr[i] = matches[i].pointer.txNum;
+            inoutNumsPtr[i] = matches[i].pointer.inoutNum;
+            isOutputPtr[i] = matches[i].direction == InoutDirection::Output;
+        }
+        return py::make_tuple(txIndexes, inoutNums, isOutput);
+    }, "Find every input and output in the blocks [start, stop) that uses an address of the AddressSet. Returns a tuple of numpy arrays (tx_index, inout_num, is_output) sorted by transaction, scanned in parallel without the GIL. Blocks ruled out by the address filters of build-address-filters are skipped.",
+        pybind11::arg("addresses"), pybind11::arg("start") = 0, pybind11::arg("stop") = -1)
+    .def("map_reduce", [](Blockchain &chain, Proxy<int64_t> &proxy, ProxyReducer reducer, BlockHeight start, BlockHeight stop, std::optional<WorkPriority> priority) {
+        auto scope = callScope(priority);
+        return proxyMapReduce(chain, proxy, reducer, start, stop);
+    }, "Evaluate the given transaction or block proxy over the blocks [start, stop) in parallel threads, without pickling or the GIL, and combine the values with the reducer: the sum, the min or max (None without values), a numpy array of all values in chain order (concat) or a dict counting every value (group_count). The chunks run at the given work_priority, by default the one of the enclosing WorkScope.",
+        pybind11::arg("proxy"), pybind11::arg("reducer") = ProxyReducer::Sum, pybind11::arg("start") = 0, pybind11::arg("stop") = -1, pybind11::arg("priority") = py::none())
+    .def("map_reduce", [](Blockchain &chain, Proxy<bool> &proxy, ProxyReducer reducer, BlockHeight start, BlockHeight stop, std::optional<WorkPriority> priority) {
+        auto scope = callScope(priority);
+        return proxyMapReduce(chain, proxy, reducer, start, stop);
+    }, "Same as above for boolean proxies, where sum counts the values that are True",
+        pybind11::arg("proxy"), pybind11::arg("reducer") = ProxyReducer::Sum, pybind11::arg("start") = 0, pybind11::arg("stop") = -1, pybind11::arg("priority") = py::none())
+    .def("group_aggregate", [](Blockchain &chain, py::object key, py::object value, ProxyAggregate aggregate, BlockHeight start, BlockHeight stop, std::optional<WorkPriority> priority) {
+        auto scope = callScope(priority);
+        return proxyGroupAggregate(chain, key, value, aggregate, start, stop);
+    }, "Group every block, transaction, input or output (the source type of the proxies) of the blocks [start, stop) by the value of the key proxy and return a dict mapping each key to the aggregate of the values of the value proxy in its group: the count (value can be None then), sum, min, max, mean or the approximate number of distinct values (distinct_approx, within about 3%). Keys and values can be integer, boolean, address type or address proxies. Each chunk fills its own hash table in parallel threads without the GIL and the tables are merged at the end, so this replaces group_by with a simple aggregate. The chunks run at the given work_priority, by default the one of the enclosing WorkScope.",
+        pybind11::arg("key"), pybind11::arg("value") = py::none(), pybind11::arg("aggregate") = ProxyAggregate::Count, pybind11::arg("start") = 0, pybind11::arg("stop") = -1, pybind11::arg("priority") = py::none())
+    .def("column", [](py::object self, ChainColumn column) -> py::object {
+        auto &chain = self.cast<Blockchain &>();
+        auto data = columnData(column, chain.getAccess());
+        if (column == ChainColumn::Block) {
+            return blockColumnViews(data, self);
+        }
+        if (column == ChainColumn::BlockStats) {
+            return blockStatsViews(data, self);
+        }
+        return columnView(columnDtype(column), data.count, data.elementSize, data.data, self);
+    }, "Return a read only numpy array aliasing the memory mapped file of the given column for all loaded transactions, inputs or outputs, without copying. For chain_column.block and chain_column.block_stats a dict with one array per block field is returned instead. Hashes are raw 32 byte strings in internal byte order (reversed compared to their hex form). The arrays keep the Blockchain alive, but become invalid when it is reloaded.",
+        pybind11::arg("column"))
+    .def("_table_columns", [](Blockchain &chain, ChainTable table, const std::vector<std::string> &columns, BlockHeight start, BlockHeight stop) {
+        if (stop < 0) {
+            stop = chain.size();
+        }
+        auto blocks = chain[{start, stop}];
+        std::vector<ChainTableColumn> built;
+        {
+            py::gil_scoped_release release;
+            built = buildChainTable(blocks, table, columns);
+        }
+        py::dict ret;
+        for (auto &column : built) {
+            ret[py::str(column.name)] = tableColumnArray(column);
+        }
+        return ret;
+    }, "Return a dict of numpy arrays with the given columns (all if empty) of every row of the table in the blocks [start, stop), computed in one parallel pass. Used by to_arrow and to_pandas.",
+        pybind11::arg("table"), pybind11::arg("columns") = std::vector<std::string>{}, pybind11::arg("start") = 0, pybind11::arg("stop") = -1)
+    .def("_table_batches", [](Blockchain &chain, ChainTable table, const std::vector<std::string> &columns, uint64_t batchRows, size_t prefetch, BlockHeight start, BlockHeight stop) {
+        if (stop < 0) {
+            stop = chain.size();
+        }
+        return std::make_unique<ChainTableStream>(chain[{start, stop}], table, columns, batchRows, prefetch);
+    }, "Return an iterator over dicts of numpy arrays with the given columns (all if empty) of the rows of the table in the blocks [start, stop), built in batches of whole blocks of about batch_rows rows by a background thread. Used by iter_batches.",
+        py::keep_alive<0, 1>(), pybind11::arg("table"), pybind11::arg("columns") = std::vector<std::string>{}, pybind11::arg("batch_rows") = uint64_t{1} << 20, pybind11::arg("prefetch") = 2, pybind11::arg("start") = 0, pybind11::arg("stop") = -1)
+    .def_static("table_columns", &chainTableColumns, "Return the names of the columns to_arrow and to_pandas can produce for the table", pybind11::arg("table"))
+    .def("_unpack_objects", &unpackObjects, "Recreate a list packed by _pack_objects, as a lazy range or as a list", pybind11::arg("tag"), pybind11::arg("arrays"), pybind11::arg("lazy") = false)
+    .def("txes_with_indexes", [](Blockchain &chain, py::array_t<uint32_t, py::array::c_style | py::array::forcecast> indexes) {
+        std::vector<uint32_t> txNums(indexes.data(), indexes.data() + indexes.size());
+        py::gil_scoped_release release;
+        return TxNumRange{std::move(txNums), chain.getAccess()}.toTransactions();
+    }, "Return a list of the transactions with the given indexes, looked up in one batch", pybind11::arg("indexes"))
+    .def("track_tx_column_access", &Blockchain::setTrackTxColumnAccess, pybind11::arg("track") = true,
+        "Count how often transactions look up their version, hash and input columns from now on (resetting the counts), or stop counting with track=False. These columns are only read when first needed.")
+    .def("tx_column_access_stats", [](const Blockchain &chain) {
+        auto stats = chain.txColumnAccessStats();
+        py::dict ret;
+        ret["version"] = stats.version;
+        ret["hash"] = stats.hash;
+        ret["inputs"] = stats.inputs;
+        return ret;
+    }, "Return a dict with the number of lookups of each transaction column counted since track_tx_column_access was called")
+    .def("stats", &Blockchain::stats, "Return the hot-path access counters (tx decodes, block height lookups, script loads, index lookups and index iterator steps) of all threads of this process. Only collected by builds configured with -DBLOCKSCI_INSTRUMENTATION=ON, use profile() to measure a block of code.")
+    .def("ancestors", [](Blockchain &chain, const std::vector<uint32_t> &txIndexes, uint32_t depth, int64_t minValue, const std::vector<AddressType::Enum> &types) {
+        py::gil_scoped_release release;
+        return chain.ancestors(txIndexes, depth, spendEdgeFilter(minValue, types));
+    }, "Return a TxSet of the transactions within depth hops upstream of the transactions with the given indexes (following inputs to the transactions they spend), computed in parallel. Only edges spending outputs worth at least min_value of one of the given address types (all types if empty) are followed.",
+        pybind11::arg("tx_indexes"), pybind11::arg("depth"), pybind11::arg("min_value") = 0, pybind11::arg("address_types") = std::vector<AddressType::Enum>{})
+    .def("descendants", [](Blockchain &chain, const std::vector<uint32_t> &txIndexes, uint32_t depth, int64_t minValue, const std::vector<AddressType::Enum> &types) {
+        py::gil_scoped_release release;
+        return chain.descendants(txIndexes, depth, spendEdgeFilter(minValue, types));
+    }, "Return a TxSet of the transactions within depth hops downstream of the transactions with the given indexes (following outputs to the transactions spending them), filtered like ancestors.",
+        pybind11::arg("tx_indexes"), pybind11::arg("depth"), pybind11::arg("min_value") = 0, pybind11::arg("address_types") = std::vector<AddressType::Enum>{})
+    .def("utxo_set_at", [](Blockchain &chain, BlockHeight height) {
+        py::gil_scoped_release release;
+        return chain.utxoSetAt(height);
+    }, "Return an OutputSet of the outputs that are unspent right before the block at the given height is mined, computed in one parallel scan. Reads output_spent_tx.dat if the output columns have been built.",
+        pybind11::arg("height"))
+    .def("utxo_set_delta", [](Blockchain &chain, BlockHeight start, BlockHeight stop) {
+        py::gil_scoped_release release;
+        return chain.utxoSetDelta(start, stop);
+    }, "Return the UTXOSetDelta of the blocks [start, stop), which only reads these blocks. Applying the deltas of consecutive ranges to utxo_set_at(start) gives a series of UTXO sets.",
+        pybind11::arg("start"), pybind11::arg("stop"))
+    .def("coin_age", [](Blockchain &chain, BlockHeight start, BlockHeight stop) {
+        if (stop < 0) {
+            stop = chain.size();
+        }
+        auto blocks = chain[{start, stop}];
+        std::vector<BlockCoinAge> ages;
+        {
+            py::gil_scoped_release release;
+            ages = blockCoinAges(blocks);
+        }
+        py::array_t<int64_t> spentValue{ages.size()};
+        py::array_t<double> coinDaysDestroyed{ages.size()};
+        py::array_t<uint32_t> inputCount{ages.size()};
+        py::array_t<double> meanInputAge{ages.size()};
+        py::array_t<double> dormancy{ages.size()};
+        for (size_t i = 0; i < ages.size(); i++) {
+            spentValue.mutable_data()[i] = ages[i].spentValue;
+            coinDaysDestroyed.mutable_data()[i] = ages[i].coinDaysDestroyed;
+            inputCount.mutable_data()[i] = ages[i].inputCount;
+            meanInputAge.mutable_data()[i] = ages[i].meanInputAge();
+            dormancy.mutable_data()[i] = ages[i].dormancy();
+        }
+        py::dict ret;
+        ret["spent_value"] = spentValue;
+        ret["coin_days_destroyed"] = coinDaysDestroyed;
+        ret["input_count"] = inputCount;
+        ret["mean_input_age"] = meanInputAge;
+        ret["dormancy"] = dormancy;
+        return ret;
+    }, "Return a dict of numpy arrays with the coin age statistics of every block in [start, stop): the spent value in satoshi, the coin days destroyed, the number of inputs, the mean number of blocks since the spent outputs were mined and the dormancy (value weighted mean age in days of the spent coins). Reads the precomputed columns written by blocksci_parser build-output-columns, the per input heights and values are available through column(chain_column.input_spent_height) and column(chain_column.input_spent_value).",
+        pybind11::arg("start") = 0, pybind11::arg("stop") = -1)
+    .def("register_derived_column", [](Blockchain &chain, const std::string &name, Proxy<int64_t> &proxy, const std::string &dtype, std::vector<std::string> dependencies, uint32_t version) {
+        chain.registerDerivedColumn(proxyColumnSpec(name, proxy, dtype, std::move(dependencies), version));
+    }, "Register a derived column storing the value of the given block, transaction, input or output proxy for every such object of the chain, as the given dtype. Columns read by the proxy through derived_value must be listed as dependencies. Increase version whenever the proxy changes so stored values are recomputed. Registrations only last for this process, call update_derived_columns to compute the values.",
+        pybind11::arg("name"), pybind11::arg("proxy"), pybind11::arg("dtype") = "int64", pybind11::arg("dependencies") = std::vector<std::string>{}, pybind11::arg("version") = 1)
+    .def("register_derived_column", [](Blockchain &chain, const std::string &name, Proxy<bool> &proxy, const std::string &dtype, std::vector<std::string> dependencies, uint32_t version) {
+        chain.registerDerivedColumn(proxyColumnSpec(name, proxy, dtype, std::move(dependencies), version));
+    }, "Same as above for boolean proxies, stored as 0 or 1",
+        pybind11::arg("name"), pybind11::arg("proxy"), pybind11::arg("dtype") = "uint8", pybind11::arg("dependencies") = std::vector<std::string>{}, pybind11::arg("version") = 1)
+    .def("update_derived_columns", [](Blockchain &chain) {
+        py::gil_scoped_release release;
+        chain.updateDerivedColumns();
+    }, "Compute the registered derived columns for the blocks they don't cover yet, dependencies first and in parallel without the GIL. Columns whose version changed or whose blocks were reorged out are recomputed from the genesis block.")
+    .def("derived_column", [](Blockchain &chain, const std::string &name) {
+        auto column = std::make_unique<DerivedColumn>(chain.derivedColumn(name));
+        auto dtype = derivedColumnDtype(column->type());
+        auto count = column->size();
+        auto data = column->data();
+        auto stride = derivedColumnElementSize(column->type());
+        py::capsule owner(column.release(), [](void *ptr) { delete static_cast<DerivedColumn *>(ptr); });
+        return columnView(dtype, count, stride, data, owner);
+    }, "Return a read only numpy array aliasing the stored values of the derived column, indexed by block height, transaction index or blockchain-wide input or output number. The array becomes invalid when the column is updated.",
+        pybind11::arg("name"))
+    .def("derived_value", &derivedValueProxy<Block>, "Return a proxy reading the stored value of the derived column for the given block proxy, for use in proxies of other derived columns and in map_reduce",
+        pybind11::arg("name"), pybind11::arg("block"))
+    .def("derived_value", &derivedValueProxy<Transaction>, "Same as above for transaction proxies", pybind11::arg("name"), pybind11::arg("tx"))
+    .def("derived_value", &derivedValueProxy<Input>, "Same as above for input proxies", pybind11::arg("name"), pybind11::arg("input"))
+    .def("derived_value", &derivedValueProxy<Output>, "Same as above for output proxies", pybind11::arg("name"), pybind11::arg("output"))
+    .def("spend_subgraph", [](Blockchain &chain, const std::vector<uint32_t> &txIndexes, uint32_t depth, bool upstream, int64_t minValue, const std::vector<AddressType::Enum> &types) {
+        SpendSubgraph graph;
+        {
+            py::gil_scoped_release release;
+            graph = spendSubgraph(txIndexes, depth, upstream ? SpendDirection::Ancestors : SpendDirection::Descendants, spendEdgeFilter(minValue, types), chain.getAccess());
+        }
+        py::dict ret;
+        ret["tx_index"] = toNumpy(graph.txNums);
+        ret["depth"] = toNumpy(graph.depths);
+        ret["edge_offsets"] = toNumpy(graph.edgeOffsets);
+        ret["edge_targets"] = toNumpy(graph.edgeTargets);
+        return ret;
+    }, "Same traversal as ancestors (upstream=True) or descendants, returning the reached transactions as a CSR graph: a dict of numpy arrays with the sorted tx_index and depth of every transaction, and edge_offsets/edge_targets where the edges of transaction i lead to the positions edge_targets[edge_offsets[i]:edge_offsets[i + 1]].",
+        pybind11::arg("tx_indexes"), pybind11::arg("depth"), pybind11::arg("upstream") = true, pybind11::arg("min_value") = 0, pybind11::arg("address_types") = std::vector<AddressType::Enum>{})
     .def("address_from_index", [](Blockchain &chain, uint32_t index, AddressType::Enum type) {
         return Address{index, type, chain.getAccess()};
     }, "Construct an address object from an address num and type", pybind11::arg("index"), pybind11::arg("type"))
@@ -104,27 +1295,789 @@ void init_blockchain(py::class_<Blockchain> &cl) {
             return ranges::nullopt;
         }
     }, "Construct an address object from an address string", pybind11::arg("address_string"))
+    .def("address_indexes_from_strings", [](Blockchain &chain, const std::vector<std::string> &addressStrings) {
+        std::vector<ranges::optional<Address>> addresses;
+        {
+            py::gil_scoped_release release;
+            addresses = getAddressesFromStrings(addressStrings, chain.getAccess());
+        }
+        py::array_t<int64_t> indexes{addresses.size()};
+        py::array_t<uint8_t> types{addresses.size()};
+        auto indexesPtr = indexes.mutable_data();
+        auto typesPtr = types.mutable_data();
+        for (size_t i = 0; i < addresses.size(); i++) {
+            indexesPtr[i] = addresses[i] ? static_cast<int64_t>(addresses[i]->scriptNum) : -1;
+            typesPtr[i] = addresses[i] ? static_cast<uint8_t>(addresses[i]->type) : 0;
+        }
+        return py::make_tuple(indexes, types);
+    }, "Look up the addresses with the given address strings in one batch. Returns a tuple of numpy arrays of the address indexes and address types, the index is -1 for strings without a matching address.", pybind11::arg("address_strings"))
+    .def("addresses_from_strings", [](Blockchain &chain, const std::vector<std::string> &addressStrings, uint32_t threadCount) {
+        std::vector<ranges::optional<Address>> addresses;
+        {
+            py::gil_scoped_release release;
+            addresses = getAddressesFromStrings(addressStrings, chain.getAccess(), threadCount);
+        }
+        py::array_t<uint32_t> scriptNums{addresses.size()};
+        py::array_t<uint8_t> types{addresses.size()};
+        py::array_t<bool> found{addresses.size()};
+        auto scriptNumsPtr = scriptNums.mutable_data();
+        auto typesPtr = types.mutable_data();
+        auto foundPtr = found.mutable_data();
+        for (size_t i = 0; i < addresses.size(); i++) {
+            scriptNumsPtr[i] = addresses[i] ? addresses[i]->scriptNum : 0;
+            typesPtr[i] = addresses[i] ? static_cast<uint8_t>(addresses[i]->type) : 0;
+            foundPtr[i] = static_cast<bool>(addresses[i]);
+        }
+        return py::make_tuple(scriptNums, types, found);
+    }, "Look up the addresses with the given address strings (a list or numpy array of str or bytes), decoding them and querying the hash index on thread_count threads (0 for one per core). Returns a tuple of numpy arrays of the script nums, the address types and a mask which is False for strings without a matching address.",
+        pybind11::arg("address_strings"), pybind11::arg("thread_count") = 0)
+    .def("address_balances", [](Blockchain &chain, const std::vector<Address> &addresses, BlockHeight height, uint32_t threadCount) {
+        std::vector<int64_t> balances;
+        {
+            py::gil_scoped_release release;
+            balances = calculateBalances(addresses, height, threadCount);
+        }
+        return toNumpy(balances);
+    }, "Return a numpy array with the balance of each of the given addresses at the height (Defaults to the full chain), computed on thread_count threads (0 for one per hardware thread)",
+        pybind11::arg("addresses"), pybind11::arg("height") = -1, pybind11::arg("thread_count") = 0)
+    .def("address_output_counts", [](Blockchain &chain, AddressType::Enum type, uint32_t threadCount) {
+        std::vector<uint32_t> counts;
+        {
+            py::gil_scoped_release release;
+            counts = chain.addressOutputCounts(type, threadCount);
+        }
+        return toNumpy(counts);
+    }, "Return a numpy array with the number of outputs sent to each address of the given type, indexed by script num (entry 0 is unused). Scans the address index in parallel key ranges on thread_count threads (0 for one per hardware thread)",
+        pybind11::arg("address_type"), pybind11::arg("thread_count") = 0)
+    .def("match_transactions", [](Blockchain &chain, Blockchain &other, uint32_t threadCount) {
+        std::vector<std::pair<uint32_t, uint32_t>> matches;
+        {
+            py::gil_scoped_release release;
+            matches = chain.matchTransactions(other, threadCount);
+        }
+        std::vector<uint32_t> txNums;
+        std::vector<uint32_t> otherTxNums;
+        txNums.reserve(matches.size());
+        otherTxNums.reserve(matches.size());
+        for (auto &match : matches) {
+            txNums.push_back(match.first);
+            otherTxNums.push_back(match.second);
+        }
+        return py::make_tuple(toNumpy(txNums), toNumpy(otherTxNums));
+    }, "Return a tuple of numpy arrays with the tx indexes of the transactions with the same hash in this chain and in other, in hash order. Merges the hash sorted transactions of both chains on thread_count threads (0 for one per hardware thread), using the orders written by the build-tx-hash-order parser command where they exist",
+        pybind11::arg("other"), pybind11::arg("thread_count") = 0)
+    .def("output_value_histogram", [](Blockchain &chain, BlockHeight start, BlockHeight stop, ScanBackend backend) {
+        if (stop < 0) {
+            stop = chain.size();
+        }
+        auto blocks = chain[{start, stop}];
+        BulkScanOptions options;
+        options.backend = backend;
+        std::array<uint64_t, outputValueBucketCount> buckets;
+        {
+            py::gil_scoped_release release;
+            buckets = outputValueHistogram(blocks, options);
+        }
+        return toNumpy(std::vector<uint64_t>(buckets.begin(), buckets.end()));
+    }, "Return a numpy array with the number of outputs of the blocks [start, stop) by order of magnitude of their value: element 0 counts the outputs without value and element i those with a value in [2^(i-1), 2^i) satoshis. Scanned on the GPU if the backend allows it and BlockSci was built with CUDA.",
+        pybind11::arg("start") = 0, pybind11::arg("stop") = -1, pybind11::arg("backend") = ScanBackend::Auto)
+    .def("output_type_mix", [](Blockchain &chain, BlockHeight bucketBlocks, BlockHeight start, BlockHeight stop, ScanBackend backend) {
+        if (stop < 0) {
+            stop = chain.size();
+        }
+        auto blocks = chain[{start, stop}];
+        BulkScanOptions options;
+        options.backend = backend;
+        OutputTypeMix mix;
+        {
+            py::gil_scoped_release release;
+            mix = outputTypeMix(blocks, bucketBlocks, options);
+        }
+        auto bucketCount = static_cast<py::ssize_t>(mix.bucketStarts.size());
+        auto typeCount = static_cast<py::ssize_t>(AddressType::size);
+        py::array_t<uint64_t> counts{{bucketCount, typeCount}};
+        py::array_t<int64_t> values{{bucketCount, typeCount}};
+        auto countsPtr = counts.mutable_data();
+        auto valuesPtr = values.mutable_data();
+        for (size_t i = 0; i < mix.bucketStarts.size(); i++) {
+            std::copy(mix.counts[i].begin(), mix.counts[i].end(), countsPtr + i * AddressType::size);
+            std::copy(mix.values[i].begin(), mix.values[i].end(), valuesPtr + i * AddressType::size);
+        }
+        py::dict ret;
+        ret["bucket_start"] = toNumpy(mix.bucketStarts);
+        ret["count"] = counts;
+        ret["value"] = values;
+        return ret;
+    }, "Return a dict with the first height of each bucket of bucket_blocks blocks in [start, stop) (bucket_start) and two numpy arrays of shape (buckets, address types) with the number (count) and the total value (value) of the outputs of each address type in each bucket, columns indexed by the address_type values. Scanned on the GPU if the backend allows it and BlockSci was built with CUDA.",
+        pybind11::arg("bucket_blocks"), pybind11::arg("start") = 0, pybind11::arg("stop") = -1, pybind11::arg("backend") = ScanBackend::Auto)
+    .def("probe_output_addresses", [](Blockchain &chain, const std::vector<Address> &addresses, BlockHeight start, BlockHeight stop, ScanBackend backend) {
+        if (stop < 0) {
+            stop = chain.size();
+        }
+        auto blocks = chain[{start, stop}];
+        BulkScanOptions options;
+        options.backend = backend;
+        std::vector<OutputPointer> pointers;
+        {
+            py::gil_scoped_release release;
+            pointers = probeOutputAddresses(blocks, addresses, options);
+        }
+        auto &access = chain.getAccess();
+        py::list ret;
+        for (auto &pointer : pointers) {
+            ret.append(Output{pointer, access});
+        }
+        return ret;
+    }, "Return a list of the outputs of the blocks [start, stop) sent to any of the given addresses, in chain order. Every output is checked against a hash table of the addresses, on the GPU if the backend allows it and BlockSci was built with CUDA, which beats the address index for watch lists of many addresses.",
+        pybind11::arg("addresses"), pybind11::arg("start") = 0, pybind11::arg("stop") = -1, pybind11::arg("backend") = ScanBackend::Auto)
+    .def("fee_rate_quantiles", [](Blockchain &chain, const std::vector<double> &quantiles, BlockHeight start, BlockHeight stop, ScanBackend backend) {
+        if (stop < 0) {
+            stop = chain.size();
+        }
+        auto blocks = chain[{start, stop}];
+        BulkScanOptions options;
+        options.backend = backend;
+        std::vector<double> rates;
+        {
+            py::gil_scoped_release release;
+            rates = feeRateQuantiles(blocks, quantiles, options);
+        }
+        return toNumpy(rates);
+    }, "Return a numpy array with the fee rates in satoshis per virtual byte at the given quantiles (0 to 1) of the fee paying transactions of the blocks [start, stop), within 0.6% of the exact values. Scanned on the GPU if the backend allows it and BlockSci was built with CUDA.",
+        pybind11::arg("quantiles"), pybind11::arg("start") = 0, pybind11::arg("stop") = -1, pybind11::arg("backend") = ScanBackend::Auto)
+    .def_static("cuda_scan_available", &cudaScanAvailable, "Whether BlockSci was built with CUDA and a CUDA device is present, so that the bulk scans can run on the GPU")
+    .def("sample_txes", [](Blockchain &chain, uint64_t count, BlockHeight start, BlockHeight stop, uint64_t seed) {
+        py::gil_scoped_release release;
+        if (stop < 0) {
+            stop = chain.size();
+        }
+        auto blocks = chain[{start, stop}];
+        return TxSet{uniformTxSample(blocks, count, seed), chain.getAccess()};
+    }, "Return a TxSet of count transactions of the blocks [start, stop) drawn uniformly without replacement (all of them if there are fewer). The tx numbers are drawn directly, so the cost only depends on count. The same seed gives the same sample.",
+        pybind11::arg("count"), pybind11::arg("start") = 0, pybind11::arg("stop") = -1, pybind11::arg("seed") = 0)
+    .def("bernoulli_sample_txes", [](Blockchain &chain, double probability, BlockHeight start, BlockHeight stop, uint64_t seed) {
+        py::gil_scoped_release release;
+        if (stop < 0) {
+            stop = chain.size();
+        }
+        auto blocks = chain[{start, stop}];
+        return TxSet{bernoulliTxSample(blocks, probability, seed), chain.getAccess()};
+    }, "Return a TxSet in which every transaction of the blocks [start, stop) is included independently with the given probability, eg. 0.01 for a 1% sample. Skips over the gaps between sampled transactions, so the cost only depends on the sample size.",
+        pybind11::arg("probability"), pybind11::arg("start") = 0, pybind11::arg("stop") = -1, pybind11::arg("seed") = 0)
+    .def("sample_outputs", [](Blockchain &chain, uint64_t count, BlockHeight start, BlockHeight stop, uint64_t seed) {
+        if (stop < 0) {
+            stop = chain.size();
+        }
+        auto blocks = chain[{start, stop}];
+        std::vector<OutputPointer> pointers;
+        {
+            py::gil_scoped_release release;
+            pointers = uniformOutputSample(blocks, count, seed);
+        }
+        return outputPointerRange(std::move(pointers), chain.getAccess());
+    }, "Return a lazy range of count outputs of the blocks [start, stop) drawn uniformly without replacement, in chain order",
+        pybind11::arg("count"), pybind11::arg("start") = 0, pybind11::arg("stop") = -1, pybind11::arg("seed") = 0)
+    .def("bernoulli_sample_outputs", [](Blockchain &chain, double probability, BlockHeight start, BlockHeight stop, uint64_t seed) {
+        if (stop < 0) {
+            stop = chain.size();
+        }
+        auto blocks = chain[{start, stop}];
+        std::vector<OutputPointer> pointers;
+        {
+            py::gil_scoped_release release;
+            pointers = bernoulliOutputSample(blocks, probability, seed);
+        }
+        return outputPointerRange(std::move(pointers), chain.getAccess());
+    }, "Return a lazy range in chain order of the outputs of the blocks [start, stop), each included independently with the given probability",
+        pybind11::arg("probability"), pybind11::arg("start") = 0, pybind11::arg("stop") = -1, pybind11::arg("seed") = 0)
+    .def("stratified_sample_txes", [](Blockchain &chain, BlockHeight bucketBlocks, uint64_t perBucket, BlockHeight start, BlockHeight stop, uint64_t seed) {
+        if (stop < 0) {
+            stop = chain.size();
+        }
+        auto blocks = chain[{start, stop}];
+        StratifiedTxSample sample;
+        {
+            py::gil_scoped_release release;
+            sample = stratifiedTxSample(blocks, bucketBlocks, perBucket, seed);
+        }
+        py::dict ret;
+        ret["bucket_start"] = toNumpy(sample.bucketStarts);
+        ret["tx_index"] = toNumpy(sample.txNums);
+        ret["offsets"] = toNumpy(sample.offsets);
+        return ret;
+    }, "Draw up to per_bucket transactions uniformly from every bucket of bucket_blocks blocks of [start, stop), using the transaction counts of the blocks. Returns a dict of numpy arrays with the first height of every bucket (bucket_start) and the sorted tx indexes (tx_index), those of bucket i at [offsets[i], offsets[i + 1]).",
+        pybind11::arg("bucket_blocks"), pybind11::arg("per_bucket"), pybind11::arg("start") = 0, pybind11::arg("stop") = -1, pybind11::arg("seed") = 0)
+    .def("stratified_sample_outputs", [](Blockchain &chain, BlockHeight bucketBlocks, uint64_t perStratum, bool byAddressType, BlockHeight start, BlockHeight stop, uint64_t seed) {
+        if (stop < 0) {
+            stop = chain.size();
+        }
+        auto blocks = chain[{start, stop}];
+        StratifiedOutputSample sample;
+        {
+            py::gil_scoped_release release;
+            sample = stratifiedOutputSample(blocks, bucketBlocks, perStratum, byAddressType, seed);
+        }
+        py::array_t<uint32_t> txNums{sample.outputs.size()};
+        py::array_t<uint16_t> indexes{sample.outputs.size()};
+        auto txNumsPtr = txNums.mutable_data();
+        auto indexesPtr = indexes.mutable_data();
+        for (size_t i = 0; i < sample.outputs.size(); i++) {
+            txNumsPtr[i] = sample.outputs[i].txNum;
+            indexesPtr[i] = sample.outputs[i].inoutNum;
+        }
+        py::dict ret;
+        ret["bucket_start"] = toNumpy(sample.bucketStarts);
+        ret["tx_index"] = txNums;
+        ret["output_index"] = indexes;
+        ret["offsets"] = toNumpy(sample.offsets);
+        return ret;
+    }, "Draw up to per_stratum outputs uniformly from every bucket of bucket_blocks blocks of [start, stop), or with by_address_type from every address type within each bucket. Returns a dict of numpy arrays with the first height of every bucket (bucket_start) and the sampled outputs as tx_index and output_index, those of stratum i at [offsets[i], offsets[i + 1]). Stratum i is bucket i, or bucket i // len(address_type) and address type i % len(address_type) with by_address_type. Splitting by type scans the output types of the range in parallel, the other samples only cost their size.",
+        pybind11::arg("bucket_blocks"), pybind11::arg("per_stratum"), pybind11::arg("by_address_type") = false, pybind11::arg("start") = 0, pybind11::arg("stop") = -1, pybind11::arg("seed") = 0)
+    .def("address_strings", [](Blockchain &chain, AddressType::Enum type, uint32_t start, int64_t stop, uint32_t threadCount) {
+        auto &access = chain.getAccess();
+        auto width = addressStringLength(type, access);
+        if (width == 0) {
+            throw std::invalid_argument("Address type has no address strings");
+        }
+        uint32_t end = getScriptCount(type, access) + 1;
+        if (stop >= 0) {
+            end = std::min(end, static_cast<uint32_t>(stop));
+        }
+        start = std::max(start, 1u);
+        size_t count = start < end ? end - start : 0;
+        py::array ret{py::dtype("S" + std::to_string(width)), {static_cast<py::ssize_t>(count)}};
+        auto out = static_cast<char *>(ret.mutable_data());
+        {
+            py::gil_scoped_release release;
+            addressStrings(type, start, end, out, width, access, threadCount);
+        }
+        return ret;
+    }, "Return a numpy array of fixed width byte strings with the address strings of the addresses of the type with address_num in [start, stop) (Defaults to all addresses of the type), encoded in bulk on thread_count threads (0 for one per hardware thread). Only available for types with address strings (pubkey, pubkeyhash, multisig_pubkey, scripthash, witness_pubkeyhash, witness_scripthash and witness_taproot).",
+        pybind11::arg("address_type"), pybind11::arg("start") = 1, pybind11::arg("stop") = -1, pybind11::arg("thread_count") = 0)
+    .def("address_history", [](Blockchain &, const Address &address) {
+        AddressHistory history;
+        {
+            py::gil_scoped_release release;
+            history = address.getHistory();
+        }
+        py::array_t<uint32_t> outputTxNums{history.outputs.size()};
+        py::array_t<uint16_t> outputNums{history.outputs.size()};
+        auto outputTxNumsPtr = outputTxNums.mutable_data();
+        auto outputNumsPtr = outputNums.mutable_data();
+        for (size_t i = 0; i < history.outputs.size(); i++) {
+            outputTxNumsPtr[i] = history.outputs[i].txNum;
+            outputNumsPtr[i] = history.outputs[i].inoutNum;
+        }
+        py::array_t<uint32_t> inputTxNums{history.inputs.size()};
+        py::array_t<uint16_t> inputNums{history.inputs.size()};
+        auto inputTxNumsPtr = inputTxNums.mutable_data();
+        auto inputNumsPtr = inputNums.mutable_data();
+        for (size_t i = 0; i < history.inputs.size(); i++) {
+            inputTxNumsPtr[i] = history.inputs[i].txNum;
+            inputNumsPtr[i] = history.inputs[i].inoutNum;
+        }
+        py::dict ret;
+        ret["output_tx_index"] = outputTxNums;
+        ret["output_index"] = outputNums;
+        ret["input_tx_index"] = inputTxNums;
+        ret["input_index"] = inputNums;
+        ret["tx_index"] = toNumpy(history.txNums);
+        return ret;
+    }, "Return a dict of numpy arrays with the outputs sent to the address (output_tx_index, output_index), the inputs spending them (input_tx_index, input_index) and the indexes of all its txes (tx_index), each sorted by tx index. Resolves all spends in one pass, much faster than iterating address.inputs or address.txes for addresses with many outputs.",
+        pybind11::arg("address"))
+    .def("script_columns", [](Blockchain &chain, AddressType::Enum type, uint32_t threadCount) {
+        ScriptHeaderColumns columns;
+        {
+            py::gil_scoped_release release;
+            columns = scriptHeaderColumns(type, chain.getAccess(), threadCount);
+        }
+        py::dict ret;
+        ret["tx_first_seen"] = toNumpy(columns.txFirstSeen);
+        ret["tx_first_spent"] = toNumpy(columns.txFirstSpent);
+        ret["types_seen"] = toNumpy(columns.typesSeen);
+        return ret;
+    }, "Return a dict of numpy arrays (tx_first_seen, tx_first_spent, types_seen) with the script header fields of every script storing addresses of the type, read directly from the script file on thread_count threads (0 for one per hardware thread). Element i belongs to the script with address_num i + 1, tx_first_spent is the max uint32 for unspent scripts.",
+        pybind11::arg("address_type"), pybind11::arg("thread_count") = 0)
+    .def("multisig_pubkeys", [](Blockchain &chain, uint32_t threadCount) {
+        MultisigPubkeyColumns columns;
+        {
+            py::gil_scoped_release release;
+            columns = multisigPubkeyColumns(chain.getAccess(), threadCount);
+        }
+        py::dict ret;
+        ret["multisig_address_num"] = toNumpy(columns.multisigScriptNums);
+        ret["position"] = toNumpy(columns.positions);
+        ret["pubkey_address_num"] = toNumpy(columns.pubkeyScriptNums);
+        ret["required"] = toNumpy(columns.required);
+        ret["total"] = toNumpy(columns.total);
+        return ret;
+    }, "Return a dict of numpy arrays with the pubkeys of every multisig address as (multisig_address_num, position, pubkey_address_num) rows sorted by multisig and position, read on thread_count threads (0 for one per hardware thread). The pubkey address nums are the multisig_pubkey addresses of the keys. required and total hold m and n of every multisig, element i belonging to the multisig with address_num i + 1.",
+        pybind11::arg("thread_count") = 0)
+    .def("find_script_pattern", [](Blockchain &chain, const std::string &pattern, AddressType::Enum type, bool spend, uint32_t threadCount) {
+        ScriptPattern compiled{pattern};
+        ScriptPatternMatches matches;
+        {
+            py::gil_scoped_release release;
+            matches = findScriptPattern(compiled, type, spend ? ScriptPatternTarget::Spend : ScriptPatternTarget::Output, chain.getAccess(), threadCount);
+        }
+        py::dict ret;
+        ret["address_num"] = toNumpy(matches.scriptNums);
+        ret["tx_index"] = toNumpy(matches.txNums);
+        return ret;
+    }, "Match the scripts of all nonstandard or witness unknown addresses against an opcode pattern on thread_count threads (0 for one per hardware thread). The pattern is a whitespace separated list of opcode names, 0xNN opcode bytes, PUSH, PUSH(n), PUSH(n-m) and <hex> data pushes, ? for any operation and * for any sequence of operations, which has to match the whole script. Output scripts are matched by default, with spend set the input scripts (or the witness stack items) spending the addresses are matched instead. Returns a dict of numpy arrays with the sorted address nums of the matching addresses (address_num) and the tx index of the matched script (tx_index), the tx the address first appeared in or first spending it.",
+        pybind11::arg("pattern"), pybind11::arg("address_type") = AddressType::Enum::NONSTANDARD, pybind11::arg("spend") = false, pybind11::arg("thread_count") = 0)
+    .def("pending_transactions", &Blockchain::pendingTransactions, "Return the last mempool snapshot written by the mempool recorder, with the unconfirmed txes, their packages and the blocks they are projected to be mined in. Raises an exception if the recorder hasn't written a snapshot.")
+    .def("has_address_stats", [](Blockchain &chain) {
+        return hasAddressStats(chain.getAccess());
+    }, "Whether the precomputed address stats have been built (blocksci_parser build-address-stats)")
+    .def("address_stats", [](py::object self, AddressType::Enum type) {
+        auto &chain = self.cast<Blockchain &>();
+        return addressStatsViews(addressStatsColumn(type, chain.getAccess()), self);
+    }, "Return a dict of read only numpy arrays (received, sent, output_count, spent_output_count, first_seen_height, last_seen_height) viewing the precomputed stats of every address of the type without copying. Element i belongs to the address with address_num i + 1. The views are invalidated by reload.",
+        pybind11::arg("address_type"))
+    .def("top_addresses", [](Blockchain &chain, size_t k, AddressStatsField field, const std::vector<AddressType::Enum> &types) {
+        std::vector<std::pair<Address, int64_t>> ranked;
+        {
+            py::gil_scoped_release release;
+            ranked = topAddresses(chain.getAccess(), field, k, types);
+        }
+        pybind11::list ret;
+        for (auto &entry : ranked) {
+            ret.append(py::make_tuple(entry.first.getScript().wrapped, entry.second));
+        }
+        return ret;
+    }, "Return a list of (address, value) tuples of the k addresses with the largest value of the address stats field, over the given address types (Defaults to all types)",
+        pybind11::arg("k"), pybind11::arg("by") = AddressStatsField::Balance, pybind11::arg("address_types") = std::vector<AddressType::Enum>{})
+    .def("input_signatures", [](py::object self, BlockHeight start, BlockHeight stop) {
+        auto &chain = self.cast<Blockchain &>();
+        if (stop == -1) {
+            stop = static_cast<BlockHeight>(chain.size());
+        }
+        return inputSignatureViews(inputSignatureColumn(start, stop, chain.getAccess()), self);
+    }, "Return a dict of read only numpy arrays (r, s, pubkey, sighash, flags) viewing the signature and compressed public key revealed by every input of the blocks [start, stop) without copying, along with the input number of the first element (first_input). The signatures are recorded by the parser with extractSignatures enabled in its config, see input_signature_flag for the meaning of flags. The views are invalidated by reload.",
+        pybind11::arg("start") = 0, pybind11::arg("stop") = -1)
+    .def("mempool_times", [](py::object self, BlockHeight start, BlockHeight stop) {
+        auto &chain = self.cast<Blockchain &>();
+        if (stop == -1) {
+            stop = static_cast<BlockHeight>(chain.size());
+        }
+        auto blocks = chain[{start, stop}];
+        return mempoolTimeViews(mempoolTimeColumns(blocks), self);
+    }, "Return a dict of numpy arrays with the first seen times the mempool recorder recorded for every tx of the blocks [start, stop): the seconds since the epoch (timestamp, 0 if the tx wasn't observed and 1 if it was observed without a time), the milliseconds to add to them (milliseconds), whether the tx was observed (observed) and the combined time (time_seen, NaT without a time), along with the tx index of the first element (first_tx_index). timestamp and milliseconds view the recorder's files without copying if a single recording covers the blocks, those views are invalidated by reload.",
+        pybind11::arg("start") = 0, pybind11::arg("stop") = -1)
+    .def("witness_sizes", [](Blockchain &chain, BlockHeight start, BlockHeight stop, uint32_t threadCount) {
+        if (stop == -1) {
+            stop = static_cast<BlockHeight>(chain.size());
+        }
+        WitnessSizeColumn column;
+        {
+            py::gil_scoped_release release;
+            column = witnessSizeColumn(start, stop, chain.getAccess(), threadCount);
+        }
+        py::dict ret;
+        ret["item_count"] = toNumpy(column.itemCounts);
+        ret["size"] = toNumpy(column.serializedSizes);
+        ret["first_input"] = column.firstInput;
+        return ret;
+    }, "Return a dict of numpy arrays with the number of witness items (item_count) and the serialized witness size in bytes (size) of every input of the blocks [start, stop), along with the input number of the first element (first_input). The witnesses are recorded by the parser with recordWitnesses set to sizes or full in its config.",
+        pybind11::arg("start") = 0, pybind11::arg("stop") = -1, pybind11::arg("thread_count") = 0)
     .def("addresses_with_prefix", [](Blockchain &chain, const std::string &addressPrefix) {
+        std::vector<Address> addresses;
+        {
+            py::gil_scoped_release release;
+            addresses = getAddressesWithPrefix(addressPrefix, chain.getAccess());
+        }
         pybind11::list pyAddresses;
-        auto addresses = getAddressesWithPrefix(addressPrefix, chain.getAccess());
         for (auto &address : addresses) {
             pyAddresses.append(address.getScript().wrapped);
         }
         return pyAddresses;
     }, "Find all addresses beginning with the given prefix", pybind11::arg("prefix"))
-    .def("_segment_indexes", [](Blockchain &chain, BlockHeight start, BlockHeight stop, unsigned int cpuCount) {
-        auto segments = chain[{start, stop}].segment(cpuCount);
+    .def("_segment_indexes", [](Blockchain &chain, BlockHeight start, BlockHeight stop, unsigned int cpuCount, pybind11::object weight) {
+        auto blocks = chain[{start, stop}];
+        std::vector<BlockRange> segments;
+        if (pybind11::isinstance<pybind11::str>(weight)) {
+            auto weightName = weight.cast<std::string>();
+            if (weightName == "tx") {
+                segments = blocks.segment(cpuCount, SegmentWeight::TxCount);
+            } else if (weightName == "inouts") {
+                segments = blocks.segment(cpuCount, SegmentWeight::InoutCount);
+            } else {
+                throw std::invalid_argument("Unknown segment weight " + weightName + ", expected tx or inouts");
+            }
+        } else {
+            segments = blocks.segment(cpuCount, [&](const Block &block) {
+                return weight(block).cast<uint64_t>();
+            });
+        }
         std::vector<std::pair<BlockHeight, BlockHeight>> ret;
         ret.reserve(segments.size());
         for (auto segment : segments) {
             ret.emplace_back(segment.sl.start, segment.sl.stop);
         }
         return ret;
-    })
+    }, pybind11::arg("start"), pybind11::arg("stop"), pybind11::arg("cpu_count"), pybind11::arg("weight") = "tx")
+    .def("_shard_plan", [](Blockchain &chain, BlockHeight start, BlockHeight stop, const std::vector<std::string> &hosts, uint32_t shardTxCount) {
+        auto blocks = chain[{start, stop}];
+        std::vector<std::tuple<uint32_t, uint32_t, BlockHeight, BlockHeight>> ret;
+        for (auto &shard : planShards(blocks, hosts, shardTxCount)) {
+            ret.emplace_back(shard.shard, shard.host, shard.blocks.sl.start, shard.blocks.sl.stop);
+        }
+        return ret;
+    }, "Return the (shard, host index, start, stop) of the fixed shards covering the blocks and the host processing each",
+        pybind11::arg("start"), pybind11::arg("stop"), pybind11::arg("hosts"), pybind11::arg("shard_tx_count") = defaultShardTxCount)
+    .def("_range_between_times", [](Blockchain &chain, std::chrono::system_clock::time_point start, std::chrono::system_clock::time_point end) -> Range<Block> {
+        return ranges::any_view<Block, random_access_sized>{chain.range(start, end)};
+    }, "Return the blocks mined in the time range [start, end)", pybind11::arg("start"), pybind11::arg("end"))
+    .def("op_returns_with_prefix", [](Blockchain &chain, const std::string &prefix) {
+        return chain.nulldataWithPrefix(prefix);
+    }, "Find all OP_RETURN outputs whose data begins with the given bytes through the nulldata index (built with blocksci_parser build-nulldata-index)", pybind11::arg("prefix"), py::call_guard<py::gil_scoped_release>())
     ;
 }
 
 void init_data_access(py::module &m) {
+    m.def("_pack_objects", &packObjects, "Pack a list holding only Blocks, Txes, Inputs, Outputs or Addresses into a tag and numpy arrays of their indexes, or return None. Used by Pickler.", pybind11::arg("objects"));
+
+    py::enum_<ProxyReducer>(m, "reducer", "Ways Blockchain.map_reduce can combine the values of a proxy")
+    .value("sum", ProxyReducer::Sum)
+    .value("min", ProxyReducer::Min)
+    .value("max", ProxyReducer::Max)
+    .value("concat", ProxyReducer::Concat)
+    .value("group_count", ProxyReducer::GroupCount)
+    ;
+    
+    py::enum_<ProxyAggregate>(m, "aggregate", "Aggregates Blockchain.group_aggregate can compute for each group")
+    .value("count", ProxyAggregate::Count)
+    .value("sum", ProxyAggregate::Sum)
+    .value("min", ProxyAggregate::Min)
+    .value("max", ProxyAggregate::Max)
+    .value("mean", ProxyAggregate::Mean)
+    .value("distinct_approx", ProxyAggregate::DistinctApprox)
+    ;
+    
+    py::enum_<WorkPriority>(m, "work_priority", "Priority classes of the parallel work of all chains. Threads working on batch scans leave them at the next chunk while interactive or normal work is running, so point queries wrapped in an interactive WorkScope don't wait behind them.")
+    .value("interactive", WorkPriority::Interactive)
+    .value("normal", WorkPriority::Normal)
+    .value("batch", WorkPriority::Batch)
+    ;
+    
+    m.def("decompress_pubkeys", [](py::array keys, uint32_t threadCount) {
+        if (keys.dtype().kind() != 'S' || keys.itemsize() != 33 || keys.ndim() != 1) {
+            throw std::invalid_argument("Expected a one dimensional array of 33 byte compressed public keys (dtype S33)");
+        }
+        auto contiguous = py::array::ensure(keys, py::array::c_style);
+        std::vector<std::array<unsigned char, 65>> decompressed;
+        {
+            py::gil_scoped_release release;
+            decompressed = decompressPubkeys(static_cast<const unsigned char *>(contiguous.data()), static_cast<size_t>(contiguous.size()), threadCount);
+        }
+        py::array ret{py::dtype("S65"), {static_cast<py::ssize_t>(decompressed.size())}};
+        if (!decompressed.empty()) {
+            std::memcpy(ret.mutable_data(), decompressed.data(), decompressed.size() * 65);
+        }
+        return ret;
+    }, "Decompress a numpy array of 33 byte public keys (eg. the pubkey column of Blockchain.input_signatures) into their 65 byte serialization on thread_count threads (0 for one per hardware thread). Invalid keys decompress to zero bytes.",
+        pybind11::arg("keys"), pybind11::arg("thread_count") = 0);
+    
+    py::enum_<InputSignature::Flag>(m, "input_signature_flag", py::arithmetic(), "Bits of the flags column of Blockchain.input_signatures")
+    .value("has_signature", InputSignature::HasSignature)
+    .value("schnorr", InputSignature::Schnorr)
+    .value("has_pubkey", InputSignature::HasPubkey)
+    .value("uncompressed_pubkey", InputSignature::UncompressedPubkey)
+    .value("witness", InputSignature::Witness)
+    ;
+    
+    py::enum_<AddressStatsField>(m, "address_stats_field", "Values Blockchain.top_addresses can rank addresses by")
+    .value("balance", AddressStatsField::Balance)
+    .value("received", AddressStatsField::Received)
+    .value("sent", AddressStatsField::Sent)
+    .value("output_count", AddressStatsField::OutputCount)
+    ;
+    
+    py::enum_<ChainTable>(m, "chain_table", "Tables Blockchain.to_arrow and to_pandas can build")
+    .value("blocks", ChainTable::Blocks)
+    .value("txes", ChainTable::Transactions)
+    .value("inputs", ChainTable::Inputs)
+    .value("outputs", ChainTable::Outputs)
+    ;
+    
+    py::enum_<ChainColumn>(m, "chain_column", "Files of the chain directory")
+    .value("block", ChainColumn::Block)
+    .value("coinbase", ChainColumn::Coinbase)
+    .value("tx_data", ChainColumn::TxData)
+    .value("tx_index", ChainColumn::TxIndex)
+    .value("tx_version", ChainColumn::TxVersion)
+    .value("first_input", ChainColumn::FirstInput)
+    .value("first_output", ChainColumn::FirstOutput)
+    .value("input_spent_out_num", ChainColumn::InputSpentOutNum)
+    .value("sequence", ChainColumn::Sequence)
+    .value("tx_hashes", ChainColumn::TxHashes)
+    .value("output_value", ChainColumn::OutputValue)
+    .value("output_type", ChainColumn::OutputType)
+    .value("output_address", ChainColumn::OutputAddress)
+    .value("output_spent_tx", ChainColumn::OutputSpentTx)
+    .value("output_spending_input", ChainColumn::OutputSpendingInput)
+    .value("output_spending_height", ChainColumn::OutputSpendingHeight)
+    .value("tx_fee", ChainColumn::TxFee)
+    .value("tx_virtual_size", ChainColumn::TxVirtualSize)
+    .value("input_spent_height", ChainColumn::InputSpentHeight)
+    .value("input_spent_value", ChainColumn::InputSpentValue)
+    .value("block_stats", ChainColumn::BlockStats)
+    .value("tx_package_flags", ChainColumn::TxPackageFlags)
+    ;
+    
+    py::enum_<NumaPlacement>(m, "numa_placement", "NUMA memory policies of the copies made by Blockchain.make_resident")
+    .value("default", NumaPlacement::Default)
+    .value("interleave", NumaPlacement::Interleave)
+    .value("partition", NumaPlacement::Partition)
+    ;
+    
+    py::enum_<ScanBackend>(m, "scan_backend", "Hardware running the bulk scans of Blockchain such as output_value_histogram")
+    .value("auto", ScanBackend::Auto)
+    .value("cpu", ScanBackend::Cpu)
+    .value("cuda", ScanBackend::Cuda)
+    ;
+    
+    py::class_<AccessEventStats>(m, "AccessEventStats", "Counts and sampled latencies of one kind of data access, see Blockchain.stats")
+    .def_readonly("count", &AccessEventStats::count, "Number of accesses")
+    .def_readonly("timed_count", &AccessEventStats::timedCount, "Number of accesses whose latency was sampled, every 16th of each thread")
+    .def_readonly("total_ns", &AccessEventStats::totalNanoseconds, "Total latency of the sampled accesses in nanoseconds")
+    .def_property_readonly("mean_ns", &AccessEventStats::meanNanoseconds, "Mean latency of the sampled accesses in nanoseconds")
+    .def_property_readonly("estimated_total_ns", &AccessEventStats::estimatedTotalNanoseconds, "Time spent in all accesses, extrapolated from the sampled ones")
+    .def("quantile_ns", &AccessEventStats::quantileNanoseconds, "Upper bound of the latency histogram bucket holding the given quantile (0 to 1) of the sampled latencies", pybind11::arg("quantile"))
+    .def_property_readonly("histogram", [](const AccessEventStats &stats) {
+        return std::vector<uint64_t>(stats.latencyHistogram.begin(), stats.latencyHistogram.end());
+    }, "Latency histogram of the sampled accesses, entry i counts latencies in [2^i, 2^(i+1)) nanoseconds")
+    ;
+    
+    py::class_<AccessStats>(m, "AccessStats", "Hot-path access counters returned by Blockchain.stats, subtract two of them to get the accesses in between")
+    .def_readonly("enabled", &AccessStats::enabled, "Whether this build collects the counters (configured with -DBLOCKSCI_INSTRUMENTATION=ON)")
+    .def("__getitem__", [](const AccessStats &stats, const std::string &name) {
+        for (size_t i = 0; i < accessEventCount; i++) {
+            if (name == accessEventName(static_cast<AccessEvent>(i))) {
+                return stats.events[i];
+            }
+        }
+        throw py::key_error(name);
+    }, pybind11::arg("event"))
+    .def("keys", [](const AccessStats &) {
+        std::vector<std::string> names;
+        for (size_t i = 0; i < accessEventCount; i++) {
+            names.emplace_back(accessEventName(static_cast<AccessEvent>(i)));
+        }
+        return names;
+    }, "Names of the counted kinds of accesses")
+    .def("__sub__", &AccessStats::operator-)
+    .def("to_dict", [](const AccessStats &stats) {
+        py::dict ret;
+        for (size_t i = 0; i < accessEventCount; i++) {
+            auto &event = stats.events[i];
+            py::dict entry;
+            entry["count"] = event.count;
+            entry["timed_count"] = event.timedCount;
+            entry["mean_ns"] = event.meanNanoseconds();
+            entry["p50_ns"] = event.quantileNanoseconds(0.5);
+            entry["p99_ns"] = event.quantileNanoseconds(0.99);
+            entry["estimated_total_ns"] = event.estimatedTotalNanoseconds();
+            ret[accessEventName(static_cast<AccessEvent>(i))] = entry;
+        }
+        return ret;
+    }, "Return a dict with the count, mean, median and 99th percentile latency of every kind of access")
+    .def("__repr__", [](const AccessStats &stats) {
+        if (!stats.enabled) {
+            return std::string{"AccessStats(disabled, build with -DBLOCKSCI_INSTRUMENTATION=ON)"};
+        }
+        std::ostringstream ss;
+        ss << std::left << std::setw(22) << "access" << std::right << std::setw(14) << "count" << std::setw(12) << "mean ns" << std::setw(12) << "p50 ns" << std::setw(12) << "p99 ns" << std::setw(14) << "est. total ms";
+        for (size_t i = 0; i < accessEventCount; i++) {
+            auto &event = stats.events[i];
+            ss << "\n" << std::left << std::setw(22) << accessEventName(static_cast<AccessEvent>(i)) << std::right << std::setw(14) << event.count
+            << std::setw(12) << std::fixed << std::setprecision(0) << event.meanNanoseconds() << std::setw(12) << event.quantileNanoseconds(0.5)
+            << std::setw(12) << event.quantileNanoseconds(0.99) << std::setw(14) << std::setprecision(1) << event.estimatedTotalNanoseconds() / 1e6;
+        }
+        return ss.str();
+    })
+    ;
+    
+    py::class_<SpanRecorder>(m, "SpanRecorder", "Context manager recording the spans of the traced operations (index seeks and scans, cluster lookups, taint runs and map_reduce segments) of all chains while it is active")
+    .def(py::init<>())
+    .def("__enter__", [](SpanRecorder &recorder) -> SpanRecorder & {
+        setTraceSink(&recorder);
+        return recorder;
+    }, py::return_value_policy::reference)
+    .def("__exit__", [](SpanRecorder &recorder, py::args) {
+        if (traceSink() == &recorder) {
+            setTraceSink(nullptr);
+        }
+        return false;
+    })
+    .def("spans", [](const SpanRecorder &recorder) {
+        py::list ret;
+        for (auto &span : recorder.spans()) {
+            py::dict entry;
+            entry["operation"] = traceOperationName(span.operation);
+            entry["argument"] = span.argument;
+            entry["thread"] = span.thread;
+            entry["start_ns"] = span.startNanoseconds;
+            entry["duration_ns"] = span.durationNanoseconds;
+            ret.append(entry);
+        }
+        return ret;
+    }, "Return a list of dicts describing the finished spans in the order they began, start_ns is on the monotonic clock")
+    .def("clear", &SpanRecorder::clear, "Drop the recorded spans")
+    ;
+    
+    py::class_<PythonWorkScope>(m, "WorkScope", "Context manager setting the priority, the maximum number of threads per operation (0 for all) and the combined rate in MB/s at which the scans may read transaction data (0 for no limit) of the parallel work started by the current thread while it is active. Scopes nest, and the priority of a single map_reduce or filter_tx_indexes call can also be set with its priority argument.")
+    .def(py::init([](WorkPriority priority, unsigned maxThreads, double ioMegabytesPerSecond) {
+        if (ioMegabytesPerSecond < 0) {
+            throw std::invalid_argument("io_mb_per_s must not be negative");
+        }
+        PythonWorkScope scope;
+        scope.options.priority = priority;
+        scope.options.maxThreads = maxThreads;
+        scope.options.ioBytesPerSecond = static_cast<uint64_t>(ioMegabytesPerSecond * 1e6);
+        return scope;
+    }), pybind11::arg("priority") = WorkPriority::Normal, pybind11::arg("max_threads") = 0, pybind11::arg("io_mb_per_s") = 0.0)
+    .def("__enter__", [](PythonWorkScope &scope) -> PythonWorkScope & {
+        if (scope.scope) {
+            throw std::runtime_error("WorkScope is already active");
+        }
+        scope.scope = std::make_unique<WorkScope>(scope.options);
+        return scope;
+    }, py::return_value_policy::reference)
+    .def("__exit__", [](PythonWorkScope &scope, py::args) {
+        scope.scope.reset();
+        return false;
+    })
+    .def_property_readonly("priority", [](const PythonWorkScope &scope) { return scope.options.priority; })
+    .def_property_readonly("max_threads", [](const PythonWorkScope &scope) { return scope.options.maxThreads; })
+    .def_property_readonly("io_mb_per_s", [](const PythonWorkScope &scope) { return static_cast<double>(scope.options.ioBytesPerSecond) / 1e6; })
+    ;
+    
+    py::class_<MempoolSnapshot>(m, "MempoolSnapshot", "Memory mapped snapshot of the mempool written by the mempool recorder. Txes are ordered by the block they are projected to be mined in and within a block in template order, parents before children.")
+    .def("__len__", &MempoolSnapshot::size)
+    .def_property_readonly("timestamp", &MempoolSnapshot::timestamp, "Milliseconds since the epoch when the snapshot was taken")
+    .def_property_readonly("chain_tx_count", &MempoolSnapshot::chainTxCount, "Number of txes of the parsed chain when the snapshot was taken")
+    .def_property_readonly("projected_block_count", &MempoolSnapshot::projectedBlockCount, "Number of blocks needed to mine all pending txes")
+    .def("columns", [](py::object self) {
+        return pendingTxViews(self.cast<MempoolSnapshot &>(), self);
+    }, "Return a dict of read only numpy arrays aliasing the fields of every pending tx (hash, fee, ancestor_fee, first_seen, fee_rate, vsize, ancestor_size, ancestor_count, descendant_count, projected_block). Fees are in satoshi, fee_rate is the satoshi per vbyte of the package the tx is projected to be mined with.")
+    .def("find", [](const MempoolSnapshot &snapshot, const uint256 &hash) {
+        return snapshot.find(hash);
+    }, "Return the index of the pending tx with the given hash, or None if it isn't in the snapshot", pybind11::arg("hash"))
+    .def("parents", [](const MempoolSnapshot &snapshot, uint32_t index) {
+        auto parents = snapshot.parents(index);
+        return toNumpy(std::vector<uint32_t>(parents.begin(), parents.end()));
+    }, "Return the indexes of the unconfirmed txes the pending tx spends outputs of", pybind11::arg("index"))
+    .def("ancestors", &MempoolSnapshot::ancestors, "Return the sorted indexes of all unconfirmed ancestors of the pending tx", pybind11::arg("index"))
+    .def("inputs", [](const MempoolSnapshot &snapshot, uint32_t index) -> ranges::optional<py::list> {
+        if (!snapshot[index].inputsKnown()) {
+            return ranges::nullopt;
+        }
+        py::list ret;
+        for (auto &input : snapshot.inputs(index)) {
+            switch (input.source) {
+                case PendingInputSource::Chain:
+                    ret.append(py::make_tuple("chain", input.spentTx, input.outputNum));
+                    break;
+                case PendingInputSource::Mempool:
+                    ret.append(py::make_tuple("mempool", input.spentTx, input.outputNum));
+                    break;
+                case PendingInputSource::Unknown:
+                    ret.append(py::make_tuple("unknown", py::none(), input.outputNum));
+                    break;
+            }
+        }
+        return ret;
+    }, "Return the outputs spent by the pending tx as (source, tx, output_num) tuples, where tx is the tx index in the parsed chain for source 'chain' and the index in the snapshot for 'mempool'. Returns None if the recorder hasn't decoded the inputs yet.", pybind11::arg("index"))
+    .def("block_template", [](const MempoolSnapshot &snapshot, uint32_t block) {
+        auto txes = snapshot.projectedBlock(block);
+        auto first = static_cast<uint32_t>(txes.begin() - snapshot.txes().begin());
+        return py::make_tuple(first, first + static_cast<uint32_t>(txes.size()));
+    }, "Return the [start, stop) range of indexes of the txes projected to be mined in the given block, 0 being the next one", pybind11::arg("block") = 0)
+    .def("projected_block_fees", &MempoolSnapshot::projectedBlockFees, "Return the total fee of the txes projected to be mined in the given block", pybind11::arg("block") = 0)
+    .def("fee_rate_percentiles", &MempoolSnapshot::feeRatePercentiles, "Return the fee rates in satoshi per vbyte at the given percentiles (0 to 100) of the virtual size of the txes projected to be mined in the given block",
+        pybind11::arg("percentiles") = std::vector<double>{0, 10, 25, 50, 75, 90, 100}, pybind11::arg("block") = 0)
+    ;
+    
+    py::class_<AddressSet>(m, "AddressSet", "Set of addresses built for Blockchain.scan_for_addresses, holding millions of addresses in a few bytes each")
+    .def(py::init<const std::vector<Address> &>(), pybind11::arg("addresses"))
+    .def(py::init([](py::array_t<uint32_t, py::array::c_style | py::array::forcecast> scriptNums, py::array_t<uint8_t, py::array::c_style | py::array::forcecast> types) {
+        if (scriptNums.size() != types.size()) {
+            throw std::invalid_argument{"script_nums and types must have the same length"};
+        }
+        auto scriptNumsPtr = scriptNums.data();
+        auto typesPtr = types.data();
+        std::vector<RawAddress> addresses;
+        addresses.reserve(static_cast<size_t>(scriptNums.size()));
+        for (py::ssize_t i = 0; i < scriptNums.size(); i++) {
+            if (typesPtr[i] >= AddressType::size) {
+                throw std::invalid_argument{"Invalid address type " + std::to_string(typesPtr[i])};
+            }
+            addresses.emplace_back(scriptNumsPtr[i], static_cast<AddressType::Enum>(typesPtr[i]));
+        }
+        py::gil_scoped_release release;
+        return AddressSet{addresses};
+    }), "Build the set from numpy arrays of address numbers and address type values", pybind11::arg("script_nums"), pybind11::arg("types"))
+    .def("__len__", &AddressSet::size)
+    .def("__contains__", [](const AddressSet &addresses, const Address &address) {
+        return addresses.contains(address.scriptNum, address.type);
+    })
+    .def_property_readonly("memory_usage", &AddressSet::memoryUsage, "Bytes allocated by the set")
+    ;
+    
+    py::class_<ChainTableStream>(m, "_TableBatchStream", "Iterator over the batches of a table, see Blockchain.iter_batches")
+    .def("__iter__", [](ChainTableStream &stream) -> ChainTableStream & {
+        return stream;
+    }, py::return_value_policy::reference_internal)
+    .def("__next__", [](ChainTableStream &stream) {
+        ranges::optional<ChainTableBatch> batch;
+        {
+            // The producer fills the next batch while Python works on this one
+            py::gil_scoped_release release;
+            batch = stream.next();
+        }
+        if (!batch) {
+            throw py::stop_iteration();
+        }
+        py::dict ret;
+        for (auto &column : batch->columns) {
+            ret[py::str(column.name)] = tableColumnArray(column);
+        }
+        return ret;
+    })
+    ;
+    
+    py::class_<ChainView>(m, "ChainView", "The chain as of a height, created by Blockchain.as_of. Address and cluster queries drop the outputs, spends and addresses of later txes, but clusters can hold links made by later blocks")
+    .def("__len__", [](const ChainView &view) { return view.size(); })
+    .def_property_readonly("height", &ChainView::height, "Number of blocks in the view")
+    .def_property_readonly("tx_count", &ChainView::endTxNum, "Number of txes in the view, every tx index below is part of it")
+    .def_property_readonly("blocks", [](ChainView &view) -> Range<Block> {
+        return ranges::any_view<Block, random_access_sized>{BlockRange{view}};
+    }, pybind11::keep_alive<0, 1>(), "Returns a range of all the blocks in the view")
+    .def("contains_tx", &ChainView::containsTx, pybind11::arg("index"), "Whether the tx with the given index is part of the view")
+    .def("contains_address", &ChainView::containsAddress, pybind11::arg("address"), "Whether the address first appeared in a tx in the view")
+    .def("outputs", &ChainView::outputs, pybind11::arg("address"), "Outputs sent to the address by txes in the view")
+    .def("balance", &ChainView::balance, pybind11::arg("address"), "Balance of the address at the end of the view")
+    .def("balances", &ChainView::balances, pybind11::arg("addresses"), pybind11::arg("thread_count") = 0, py::call_guard<py::gil_scoped_release>(), "Balances of the addresses at the end of the view, computed in parallel")
+    .def("cluster_addresses", &ChainView::clusterAddresses, pybind11::arg("cluster"), "Addresses of the cluster that first appeared in a tx in the view")
+    .def("cluster_balance", &ChainView::clusterBalance, pybind11::arg("cluster"), py::call_guard<py::gil_scoped_release>(), "Balance of the cluster at the end of the view")
+    ;
+    
+    py::class_<MinerMatcher>(m, "MinerMatcher", "Attributes blocks to miners with an Aho-Corasick automaton over the coinbase tags and a lookup of the coinbase payout addresses")
+    .def(py::init<std::vector<std::string>, const std::vector<std::pair<std::string, uint32_t>> &, const std::vector<std::pair<Address, uint32_t>> &>(),
+        "Miners are numbered from 1 in the order of names, 0 stands for unknown. Tags are (bytes, miner id) pairs, of which the leftmost match in the coinbase wins, and payout addresses (Address, miner id) pairs which are checked when no tag matches.",
+        pybind11::arg("names"), pybind11::arg("coinbase_tags"), pybind11::arg("payout_addresses"))
+    .def("miner_of", &MinerMatcher::minerOf, "Id of the miner of the block, 0 if unknown", pybind11::arg("block"))
+    .def("name", &MinerMatcher::name, "Name of the miner with the given id", pybind11::arg("miner_id"))
+    .def_property_readonly("names", &MinerMatcher::names, "Names indexed by miner id, starting with Unknown")
+    .def_property_readonly("fingerprint", &MinerMatcher::fingerprint, "Hash of the definitions, used as the version of the miner id column")
+    .def("register", [](const MinerMatcher &matcher, Blockchain &chain, const std::string &columnName) {
+        chain.registerDerivedColumn(matcher.columnSpec(columnName));
+    }, "Register a derived column with the miner id of every block, which update_derived_columns computes in parallel and extends as the chain grows",
+        pybind11::arg("chain"), pybind11::arg("column_name") = "miner_id")
+    ;
+    
     py::class_<Access> (m, "_DataAccess", "Private class for accessing blockchain data")
     .def("tx_with_index", &Access::txWithIndex, "This functions gets the transaction with given index.")
     .def("tx_with_hash", &Access::txWithHash, "This functions gets the transaction with given hash.")
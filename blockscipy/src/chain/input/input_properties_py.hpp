@@ -21,6 +21,7 @@ struct AddInputMethods {
         func(property_tag, "sequence_num", &Input::sequenceNumber, "The sequence number of the input");
         func(property_tag, "spent_tx_index", &Input::spentTxIndex, "The index of the transaction that this input spent");
         func(property_tag, "spent_tx", &Input::getSpentTx, "The transaction that this input spent");
+        func(property_tag, "spent_block_height", &Input::getSpentBlockHeight, "The height of the block containing the output that this input spent");
         func(property_tag, "spent_output", &Input::getSpentOutput, "The output that this input spent");
         func(property_tag, "age", &Input::age, "The number of blocks between the spent output and this input");
         func(property_tag, "tx", &Input::transaction, "The transaction that contains this input");
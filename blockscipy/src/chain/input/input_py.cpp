@@ -30,6 +30,19 @@ void init_input(py::class_<Input> &cl) {
     .def_property_readonly("_access", [](const Input &input) {
         return Access{&input.getAccess()};
     })
+    .def_property_readonly("witness", [](const Input &input) -> ranges::optional<std::vector<py::bytes>> {
+        auto items = input.getWitnessItems();
+        if (!items) {
+            return ranges::nullopt;
+        }
+        std::vector<py::bytes> ret;
+        ret.reserve(items->size());
+        for (auto &item : *items) {
+            ret.emplace_back(reinterpret_cast<const char *>(item.data()), item.size());
+        }
+        return ret;
+    }, "The witness items of this input, None unless the parser recorded witnesses with recordWitnesses set to full")
+    .def_property_readonly("witness_item_lengths", &Input::getWitnessItemLengths, "The lengths of the witness items of this input, None unless the parser recorded witnesses")
     ;
 }
 
@@ -23,7 +23,7 @@ struct AddClusterMethods {
         func(property_tag, "index", +[](const Cluster &cluster) { return cluster.clusterNum; }, "The internal identifier of the cluster");
         func(method_tag, "address_count", &Cluster::getSize, "The number of addresses in the cluster");
         func(property_tag, "type_equiv_size", &Cluster::getTypeEquivSize, "The number of addresses in the cluster not counting type equivalent addresses");
-        func(method_tag, "balance", &Cluster::calculateBalance, "Calculates the balance held by this cluster at the height (Defaults to the full chain)", pybind11::arg("height") = -1);
+        func(method_tag, "balance", &Cluster::calculateBalance, "Calculates the balance held by this cluster at the height (Defaults to the full chain)", pybind11::arg("height") = -1, pybind11::call_guard<pybind11::gil_scoped_release>());
 
         func(method_tag, "out_txes_count", +[](Cluster &cluster) -> int64_t {
             pybind11::print("Warning: `out_txes_count` is deprecated. Use `output_txes_count` instead.");
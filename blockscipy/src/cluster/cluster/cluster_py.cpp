@@ -12,8 +12,11 @@
 #include "caster_py.hpp"
 #include "proxy_utils.hpp"
 #include "self_apply_py.hpp"
+#include "stdout_redirect.hpp"
 
+#include <blocksci/address/tag_store.hpp>
 #include <blocksci/cluster/cluster_manager.hpp>
+#include <blocksci/cluster/clustering_set.hpp>
 #include <blocksci/heuristics/change_address.hpp>
 
 #include <blocksci/chain/blockchain.hpp>
@@ -21,7 +24,7 @@
 
 #include <range/v3/range_for.hpp>
 
-#include <pybind11/iostream.h>
+#include <pybind11/numpy.h>
 #include <pybind11/operators.h>
 
 namespace py = pybind11;
@@ -38,7 +41,7 @@ int64_t totalOutWithoutSelfChurn(const blocksci::Block &block, blocksci::Cluster
             }
         }
         RANGES_FOR(auto output, tx.outputs()) {
-            if ((!output.isSpent() || output.getSpendingTx()->getBlockHeight() - block.height() > 3) && inputClusters.find(manager.getCluster(output.getAddress()).clusterNum) == inputClusters.end()) {
+            if ((!output.isSpent() || *output.getSpendingBlockHeight() - block.height() > 3) && inputClusters.find(manager.getCluster(output.getAddress()).clusterNum) == inputClusters.end()) {
                 total += output.getValue();
             }
         }
@@ -46,34 +49,336 @@ int64_t totalOutWithoutSelfChurn(const blocksci::Block &block, blocksci::Cluster
     return total;
 }
 
+/** Dict of numpy arrays with the columns of the flows, naming the source and destination columns as given */
+py::dict flowColumns(const std::vector<ClusterFlow> &flows, const char *sourceName, const char *destinationName) {
+        py::array_t<uint32_t> bucketStarts{flows.size()};
+        py::array_t<uint32_t> sources{flows.size()};
+        py::array_t<uint32_t> destinations{flows.size()};
+        py::array_t<int64_t> values{flows.size()};
+        py::array_t<uint32_t> txCounts{flows.size()};
+        auto bucketStartsPtr = bucketStarts.mutable_data();
+        auto sourcesPtr = sources.mutable_data();
+        auto destinationsPtr = destinations.mutable_data();
+        auto valuesPtr = values.mutable_data();
+        auto txCountsPtr = txCounts.mutable_data();
+        for (size_t i = 0; i < flows.size(); i++) {
+            bucketStartsPtr[i] = flows[i].bucketStart;
+            sourcesPtr[i] = flows[i].source;
+            destinationsPtr[i] = flows[i].destination;
+            valuesPtr[i] = flows[i].value;
+            txCountsPtr[i] = flows[i].txCount;
+        }
+        py::dict ret;
+        ret["bucket_start"] = bucketStarts;
+        ret[sourceName] = sources;
+        ret[destinationName] = destinations;
+        ret["value"] = values;
+        ret["tx_count"] = txCounts;
+        return ret;
+}
+
 void init_cluster_manager(pybind11::module &s) {
     s
     .def("total_without_self_churn", totalOutWithoutSelfChurn)
     ;
+    
+    py::enum_<ClusterStat>(s, "cluster_stat", "Enumeration of the statistics precomputed for every cluster")
+    .value("total_received", ClusterStat::TotalReceived)
+    .value("balance", ClusterStat::Balance)
+    .value("address_count", ClusterStat::AddressCount)
+    .value("tx_count", ClusterStat::TxCount)
+    .value("first_height", ClusterStat::FirstHeight)
+    .value("last_height", ClusterStat::LastHeight)
+    ;
 
     
+    py::enum_<ClusterExportFormat>(s, "cluster_export_format", "File formats clusterings can be exported to")
+    .value("arrow", ClusterExportFormat::Arrow)
+    .value("parquet", ClusterExportFormat::Parquet)
+    ;
+    
+    py::class_<ClusteringRules>(s, "ClusteringRules", "Filters and link rules applied by the clusterer in a single pass over the chain")
+    .def(py::init<>())
+    .def_readwrite("skip_coinjoin", &ClusteringRules::skipCoinJoin, "Skip transactions detected as CoinJoins")
+    .def_readwrite("skip_possible_coinjoin", &ClusteringRules::skipPossibleCoinJoin, "Skip transactions that is_possible_coinjoin detects with the possible_coinjoin parameters")
+    .def_readwrite("possible_coinjoin_min_base_fee", &ClusteringRules::possibleCoinJoinMinBaseFee)
+    .def_readwrite("possible_coinjoin_percentage_fee", &ClusteringRules::possibleCoinJoinPercentageFee)
+    .def_readwrite("possible_coinjoin_max_depth", &ClusteringRules::possibleCoinJoinMaxDepth)
+    .def_readwrite("link_inputs", &ClusteringRules::linkInputs, "Link all inputs of a transaction (multi-input heuristic)")
+    .def_readwrite("link_change", &ClusteringRules::linkChange, "Link the outputs selected by the change heuristic with the inputs")
+    .def_readwrite("link_scripthash_nested", &ClusteringRules::linkScripthashNested, "Link scripthash addresses with the address they wrap")
+    .def_readwrite("link_multisig_cosigners", &ClusteringRules::linkMultisigCosigners, "Link spent multisig addresses with the pubkeys of their signers")
+    .def_readwrite("link_fingerprint_change", &ClusteringRules::linkFingerprintChange, "Link the only output spent by a transaction with the same wallet fingerprint with the inputs")
+    ;
+    
     py::class_<ClusterManager>(s, "ClusterManager", "Class managing the cluster dat")
     .def(py::init([](std::string arg, blocksci::Blockchain &chain) {
        return ClusterManager(arg, chain.getAccess());
     }))
-    .def_static("create_clustering", [](const std::string &location, Blockchain &chain, BlockHeight start, BlockHeight stop, heuristics::ChangeHeuristic &heuristic, bool shouldOverwrite, bool ignoreCoinJoin) {
-        py::scoped_ostream_redirect stream(std::cout, py::module::import("sys").attr("stdout"));
+    .def_static("create_clustering", [](const std::string &location, Blockchain &chain, BlockHeight start, BlockHeight stop, heuristics::ChangeHeuristic &heuristic, bool shouldOverwrite, bool ignoreCoinJoin, uint32_t threadCount, const ClusteringRules *rules, uint64_t externalMemory, const std::string &tempDirectory) {
+        ThreadSafeStdoutRedirect output;
+        py::gil_scoped_release release;
+        if (stop == -1) {
+            stop = chain.size();
+        }
+        auto range = chain[{start, stop}];
+        auto clusteringRules = rules ? *rules : ClusteringRules::defaultRules(ignoreCoinJoin);
+        if (externalMemory > 0) {
+            ExternalClusteringOptions external;
+            external.memoryBudget = externalMemory;
+            external.tempDirectory = tempDirectory;
+            return ClusterManager::createClustering(range, heuristic, clusteringRules, external, location, shouldOverwrite, threadCount);
+        }
+        return ClusterManager::createClustering(range, heuristic, clusteringRules, location, shouldOverwrite, threadCount);
+    }, py::arg("location"), py::arg("chain"), py::arg("start") = 0, py::arg("stop") = -1,
+    py::arg("heuristic") = heuristics::ChangeHeuristic{heuristics::NoChange{}}, py::arg("should_overwrite") = false, py::arg("ignore_coinjoin") = true, py::arg("thread_count") = 0,
+    py::arg("rules") = nullptr, py::arg("external_memory") = 0, py::arg("temp_directory") = "",
+    "Cluster the blocks [start, stop), rules replaces ignore_coinjoin with a full set of ClusteringRules. A nonzero external_memory clusters out of core, buffering at most that many bytes in memory and keeping the rest in temporary files in temp_directory")
+    .def_static("update_clustering", [](const std::string &location, Blockchain &chain, BlockHeight start, BlockHeight stop, heuristics::ChangeHeuristic &heuristic, bool ignoreCoinJoin, uint32_t threadCount, const ClusteringRules *rules) {
+        ThreadSafeStdoutRedirect output;
+        py::gil_scoped_release release;
+        if (stop == -1) {
+            stop = chain.size();
+        }
+        auto range = chain[{start, stop}];
+        return ClusterManager::updateClustering(range, heuristic, rules ? *rules : ClusteringRules::defaultRules(ignoreCoinJoin), location, threadCount);
+    }, py::arg("location"), py::arg("chain"), py::arg("start"), py::arg("stop") = -1,
+    py::arg("heuristic") = heuristics::ChangeHeuristic{heuristics::NoChange{}}, py::arg("ignore_coinjoin") = true, py::arg("thread_count") = 0,
+    py::arg("rules") = nullptr,
+    "Extend an existing clustering with the blocks [start, stop), which must begin at or before the last clustered block")
+    .def_static("refine_clustering", [](const std::string &location, Blockchain &chain, BlockHeight start, BlockHeight stop, heuristics::ChangeHeuristic &heuristic, const ClusteringRules *rules, uint32_t maxRounds, bool shouldOverwrite, uint32_t threadCount) {
+        ThreadSafeStdoutRedirect output;
+        py::gil_scoped_release release;
         if (stop == -1) {
             stop = chain.size();
         }
         auto range = chain[{start, stop}];
-        return ClusterManager::createClustering(range, heuristic, location, shouldOverwrite, ignoreCoinJoin);
+        RefinementOptions options;
+        options.maxRounds = maxRounds;
+        return ClusterManager::refineClustering(range, heuristic, rules ? *rules : ClusteringRules{}, payeeClusterChange, location, options, shouldOverwrite, threadCount);
     }, py::arg("location"), py::arg("chain"), py::arg("start") = 0, py::arg("stop") = -1,
-    py::arg("heuristic") = heuristics::ChangeHeuristic{heuristics::NoChange{}}, py::arg("should_overwrite") = false, py::arg("ignore_coinjoin") = true)
+    py::arg("heuristic") = heuristics::ChangeHeuristic{heuristics::NoChange{}}, py::arg("rules") = nullptr, py::arg("max_rounds") = 32,
+    py::arg("should_overwrite") = false, py::arg("thread_count") = 0,
+    "Cluster the blocks [start, stop) like create_clustering, then repeatedly link the only output of a transaction that goes to a fresh address with its inputs when the other outputs go to known clusters, until a round finds no new link or max_rounds rounds ran. Every round after the first only revisits the transactions whose clusters grew in the one before. The result can't be extended with update_clustering")
+    .def_static("pack_addresses", [](const std::string &location, uint32_t minClusterSize, uint32_t threadCount) {
+        py::gil_scoped_release release;
+        ClusterManager::packClusterAddresses(location, minClusterSize, threadCount);
+    }, py::arg("location"), py::arg("min_cluster_size") = 256, py::arg("thread_count") = 0,
+    "Write a compressed copy of the addresses of the clusters of at least min_cluster_size addresses of the clustering at location, which ClusterManagers opened afterwards read those clusters from. Large clusters take about a quarter of the space and are decoded with SIMD instructions. update_clustering keeps the copy up to date.")
+    .def_property_readonly("uses_packed_addresses", &ClusterManager::usesPackedAddresses, "Whether the large clusters are read from the compressed copy written by pack_addresses")
     .def("cluster_with_address", [](const ClusterManager &cm, const Address &address) -> Cluster {
        return cm.getCluster(address);
     }, py::arg("address"), "Return the cluster containing the given address")
     .def("clusters", [](ClusterManager &cm) -> Range<Cluster> {
         return {cm.getClusters()};
     }, "Get a list of all clusters (The list is lazy so there is no cost to calling this method)")
-    .def("tagged_clusters", [](ClusterManager &cm, const std::unordered_map<blocksci::Address, std::string> &tags) -> Iterator<TaggedCluster> {
-        return cm.taggedClusters(tags);
-    }, py::arg("tagged_addresses"), "Given a dictionary of tags, return a list of TaggedCluster objects for any clusters containing tagged scripts")
+    .def("non_trivial_clusters", [](ClusterManager &cm) -> Range<Cluster> {
+        return {cm.getNonTrivialClusters()};
+    }, "Get a lazy list of the clusters with more than one address, skipping the clusters of a single address")
+    .def_property_readonly("non_trivial_cluster_count", &ClusterManager::getNonTrivialClusterCount, "Number of clusters with more than one address")
+    .def("clusters_with_addresses", [](const ClusterManager &cm, const std::vector<Address> &addresses, uint32_t threadCount) {
+        return cm.getClusters(addresses, threadCount);
+    }, py::arg("addresses"), py::arg("thread_count") = 0, py::call_guard<py::gil_scoped_release>(), "Return the cluster containing each of the given addresses, looked up in parallel")
+    .def("cluster_ids", [](const ClusterManager &cm, py::array_t<uint32_t, py::array::c_style | py::array::forcecast> scriptNums, py::array_t<uint8_t, py::array::c_style | py::array::forcecast> types, uint32_t threadCount) {
+        if (scriptNums.ndim() != 1 || types.ndim() != 1 || scriptNums.size() != types.size()) {
+            throw std::invalid_argument("script_nums and types must be one dimensional arrays of the same length");
+        }
+        auto count = static_cast<size_t>(scriptNums.size());
+        py::array_t<uint32_t> clusterNums{count};
+        auto scriptNumsPtr = scriptNums.data();
+        auto typesPtr = types.data();
+        auto clusterNumsPtr = clusterNums.mutable_data();
+        {
+            py::gil_scoped_release release;
+            cm.clusterIds(scriptNumsPtr, typesPtr, count, clusterNumsPtr, threadCount);
+        }
+        return clusterNums;
+    }, py::arg("script_nums"), py::arg("types"), py::arg("thread_count") = 0,
+    "Return a numpy array with the cluster number of every address given by the script_nums and address_type values in types, 2**32 - 1 for addresses the clustering doesn't cover. Gathers from the cluster index files in parallel without the GIL, eg. to label the output_address and output_type columns of the chain")
+    .def("tagged_clusters", [](ClusterManager &cm, const std::unordered_map<blocksci::Address, std::string> &tags, uint32_t threadCount) -> Iterator<TaggedCluster> {
+        return cm.taggedClusters(tags, threadCount);
+    }, py::arg("tagged_addresses"), py::arg("thread_count") = 0, py::call_guard<py::gil_scoped_release>(), "Given a dictionary of tags, return a list of TaggedCluster objects for any clusters containing tagged scripts")
+    .def("cluster_tag_ids", [](const ClusterManager &cm, const TagStore &tags, uint32_t threadCount) {
+        std::vector<uint32_t> clusterTags;
+        {
+            py::gil_scoped_release release;
+            clusterTags = cm.clusterTagIds(tags, threadCount);
+        }
+        py::array_t<uint32_t> ret{clusterTags.size()};
+        std::copy(clusterTags.begin(), clusterTags.end(), ret.mutable_data());
+        return ret;
+    }, py::arg("tags"), py::arg("thread_count") = 0,
+    "Return a numpy array with the tag id of every cluster in the TagStore, the tag of most of its tagged addresses or 2**32 - 1 for clusters without tagged addresses. Index it with cluster numbers, eg. those of cluster_ids")
+    .def_property_readonly("has_cluster_stats", &ClusterManager::hasClusterStats, "Whether the clustering has precomputed cluster statistics, clusterings created by older versions don't")
+    .def("top_clusters", &ClusterManager::topClusters, py::arg("stat"), py::arg("k"), py::call_guard<py::gil_scoped_release>(),
+    "Return the k clusters with the largest value of the given cluster_stat, largest first, using the precomputed statistics")
+    .def("clusters_sorted_by", &ClusterManager::getClustersSortedBy, py::arg("stat"), py::arg("descending") = true, py::call_guard<py::gil_scoped_release>(),
+    "Return all clusters ordered by the given cluster_stat, using the precomputed statistics")
+    .def("export_clusters", [](const ClusterManager &cm, const std::string &directory, ClusterExportFormat format, uint32_t batchSize, uint32_t batchesPerFile, uint32_t threadCount) {
+        ClusterExportOptions options;
+        options.format = format;
+        options.batchSize = batchSize;
+        options.batchesPerFile = batchesPerFile;
+        options.threadCount = threadCount;
+        py::gil_scoped_release release;
+        cm.exportClusters(directory, options);
+    }, py::arg("directory"), py::arg("format") = ClusterExportFormat::Parquet, py::arg("batch_size") = ClusterExportOptions{}.batchSize,
+    py::arg("batches_per_file") = ClusterExportOptions{}.batchesPerFile, py::arg("thread_count") = 0,
+    "Write the cluster of every address to directory/membership and the cluster statistics to directory/cluster_stats as Arrow or Parquet datasets")
+    .def("cluster_flows", [](const ClusterManager &cm, Blockchain &chain, BlockHeight start, BlockHeight stop, uint32_t bucketSeconds, uint32_t topK, ClusterStat rankBy, bool includeSelfFlows) {
+        ClusterFlowOptions options;
+        options.bucketSeconds = bucketSeconds;
+        options.topK = topK;
+        options.rankBy = rankBy;
+        options.includeSelfFlows = includeSelfFlows;
+        std::vector<ClusterFlow> flows;
+        {
+            py::gil_scoped_release release;
+            if (stop == -1) {
+                stop = chain.size();
+            }
+            auto range = chain[{start, stop}];
+            flows = cm.clusterFlows(range, options);
+        }
+        return flowColumns(flows, "source_cluster", "destination_cluster");
+    }, py::arg("chain"), py::arg("start") = 0, py::arg("stop") = -1, py::arg("bucket_seconds") = ClusterFlowOptions{}.bucketSeconds,
+    py::arg("top_k") = 0, py::arg("rank_by") = ClusterStat::TotalReceived, py::arg("include_self_flows") = false,
+    "Return a dict of numpy arrays with the value moved between clusters by the blocks [start, stop), summed per bucket of bucket_seconds of block time. With top_k only the top_k clusters by rank_by are kept and all others are merged into cluster 2**32 - 1. Computed in parallel without the GIL")
+    .def("export_cluster_flows", [](const ClusterManager &cm, const std::string &path, Blockchain &chain, BlockHeight start, BlockHeight stop, uint32_t bucketSeconds, uint32_t topK, ClusterStat rankBy, bool includeSelfFlows, ClusterExportFormat format) {
+        ClusterFlowOptions options;
+        options.bucketSeconds = bucketSeconds;
+        options.topK = topK;
+        options.rankBy = rankBy;
+        options.includeSelfFlows = includeSelfFlows;
+        options.format = format;
+        py::gil_scoped_release release;
+        if (stop == -1) {
+            stop = chain.size();
+        }
+        auto range = chain[{start, stop}];
+        cm.exportClusterFlows(range, path, options);
+    }, py::arg("path"), py::arg("chain"), py::arg("start") = 0, py::arg("stop") = -1, py::arg("bucket_seconds") = ClusterFlowOptions{}.bucketSeconds,
+    py::arg("top_k") = 0, py::arg("rank_by") = ClusterStat::TotalReceived, py::arg("include_self_flows") = false, py::arg("format") = ClusterExportFormat::Parquet,
+    "Write the cluster flows of cluster_flows to a single Arrow or Parquet file, where the clusters merged by top_k are null")
+    .def("tag_flows", [](const ClusterManager &cm, const TagStore &tags, Blockchain &chain, BlockHeight start, BlockHeight stop, uint32_t bucketSeconds, uint32_t topK, ClusterStat rankBy, bool includeSelfFlows) {
+        ClusterFlowOptions options;
+        options.bucketSeconds = bucketSeconds;
+        options.topK = topK;
+        options.rankBy = rankBy;
+        options.includeSelfFlows = includeSelfFlows;
+        std::vector<ClusterFlow> flows;
+        {
+            py::gil_scoped_release release;
+            if (stop == -1) {
+                stop = chain.size();
+            }
+            auto range = chain[{start, stop}];
+            flows = cm.tagFlows(range, tags, options);
+        }
+        return flowColumns(flows, "source_tag", "destination_tag");
+    }, py::arg("tags"), py::arg("chain"), py::arg("start") = 0, py::arg("stop") = -1, py::arg("bucket_seconds") = ClusterFlowOptions{}.bucketSeconds,
+    py::arg("top_k") = 0, py::arg("rank_by") = ClusterStat::TotalReceived, py::arg("include_self_flows") = false,
+    "Return the flows of cluster_flows between the tags of the clusters given by cluster_tag_ids instead of the clusters, as a dict of numpy arrays with source_tag and destination_tag columns. Untagged clusters are tag 2**32 - 1")
+    ;
+    
+    py::class_<TagStore>(s, "TagStore", "Memory mapped table of address tags with interned tag names, sorted by address type and script number so that tags are joined by binary search or merge. The file is shared by every process that opens it.")
+    .def(py::init<const std::string &>(), py::arg("path"), "Open the tag store at path")
+    .def_static("append", [](const std::string &path, const std::unordered_map<Address, std::string> &tags) {
+        return TagStore::append(path, tags);
+    }, py::arg("path"), py::arg("tags"), py::call_guard<py::gil_scoped_release>(),
+    "Add a dict of tags by address to the tag store at path, creating it if needed and replacing the previous tags of the addresses, and return the updated store. Stores opened before keep seeing the previous tags")
+    .def("__len__", &TagStore::size, "Number of tagged addresses")
+    .def_property_readonly("tag_count", &TagStore::tagCount, "Number of distinct tag names")
+    .def("tag_name", &TagStore::tagName, py::arg("tag_id"), "Name of the tag with the given id")
+    .def("find_tag", &TagStore::findTag, py::arg("name"), "Id of the tag with the given name or None")
+    .def("tag", [](const TagStore &tags, const Address &address) -> ranges::optional<std::string> {
+        auto tagId = tags.tagId(address);
+        if (tagId == TagStore::NoTag) {
+            return ranges::nullopt;
+        }
+        return tags.tagName(tagId);
+    }, py::arg("address"), "Tag of the address or None")
+    .def("tag_ids", [](const TagStore &tags, py::array_t<uint32_t, py::array::c_style | py::array::forcecast> scriptNums, py::array_t<uint8_t, py::array::c_style | py::array::forcecast> types, uint32_t threadCount) {
+        if (scriptNums.ndim() != 1 || types.ndim() != 1 || scriptNums.size() != types.size()) {
+            throw std::invalid_argument("script_nums and types must be one dimensional arrays of the same length");
+        }
+        auto count = static_cast<size_t>(scriptNums.size());
+        py::array_t<uint32_t> tagIds{count};
+        auto scriptNumsPtr = scriptNums.data();
+        auto typesPtr = types.data();
+        auto tagIdsPtr = tagIds.mutable_data();
+        {
+            py::gil_scoped_release release;
+            tags.tagIds(scriptNumsPtr, typesPtr, count, tagIdsPtr, threadCount);
+        }
+        return tagIds;
+    }, py::arg("script_nums"), py::arg("types"), py::arg("thread_count") = 0,
+    "Return a numpy array with the tag id of every address given by the script_nums and address_type values in types, 2**32 - 1 for untagged addresses. Sorted input is merged with the store, other input is looked up in parallel")
+    .def("output_tag_ids", [](const TagStore &tags, Blockchain &chain, BlockHeight start, BlockHeight stop) {
+        std::vector<uint32_t> tagIds;
+        {
+            py::gil_scoped_release release;
+            if (stop == -1) {
+                stop = chain.size();
+            }
+            auto range = chain[{start, stop}];
+            tagIds = tags.outputTagIds(range);
+        }
+        py::array_t<uint32_t> ret{tagIds.size()};
+        std::copy(tagIds.begin(), tagIds.end(), ret.mutable_data());
+        return ret;
+    }, py::arg("chain"), py::arg("start") = 0, py::arg("stop") = -1,
+    "Return a numpy array with the tag id of every output of the blocks [start, stop) in output number order, 2**32 - 1 for untagged outputs")
+    .def("to_dict", [](const TagStore &tags, Blockchain &chain) {
+        return tags.toMap(chain.getAccess());
+    }, py::arg("chain"), "Return a dict of the tags by address, as taken by tagged_clusters")
+    ;
+    
+    py::class_<ClusteringSet>(s, "ClusteringSet", "Several named clusterings of the same chain stored in one directory")
+    .def(py::init([](std::string directory, blocksci::Blockchain &chain) {
+       return ClusteringSet(directory, chain.getAccess());
+    }), py::arg("directory"), py::arg("chain"), "Open the clustering set in the directory, which is created if it doesn't exist")
+    .def_property_readonly("names", &ClusteringSet::getNames, "Names of the clusterings in the set")
+    .def("__contains__", &ClusteringSet::contains)
+    .def("create_clustering", [](ClusteringSet &set, const std::string &name, Blockchain &chain, BlockHeight start, BlockHeight stop, heuristics::ChangeHeuristic &heuristic, const ClusteringRules *rules, bool shouldOverwrite, uint32_t threadCount) {
+        ThreadSafeStdoutRedirect output;
+        py::gil_scoped_release release;
+        if (stop == -1) {
+            stop = chain.size();
+        }
+        auto range = chain[{start, stop}];
+        set.createClustering(name, range, heuristic, rules ? *rules : ClusteringRules{}, shouldOverwrite, threadCount);
+    }, py::arg("name"), py::arg("chain"), py::arg("start") = 0, py::arg("stop") = -1,
+    py::arg("heuristic") = heuristics::ChangeHeuristic{heuristics::NoChange{}}, py::arg("rules") = nullptr, py::arg("should_overwrite") = false, py::arg("thread_count") = 0,
+    "Cluster the blocks [start, stop) and add the clustering to the set under the given name")
+    .def("update_clustering", [](ClusteringSet &set, const std::string &name, Blockchain &chain, BlockHeight start, BlockHeight stop, heuristics::ChangeHeuristic &heuristic, const ClusteringRules *rules, uint32_t threadCount) {
+        ThreadSafeStdoutRedirect output;
+        py::gil_scoped_release release;
+        if (stop == -1) {
+            stop = chain.size();
+        }
+        auto range = chain[{start, stop}];
+        set.updateClustering(name, range, heuristic, rules ? *rules : ClusteringRules{}, threadCount);
+    }, py::arg("name"), py::arg("chain"), py::arg("start"), py::arg("stop") = -1,
+    py::arg("heuristic") = heuristics::ChangeHeuristic{heuristics::NoChange{}}, py::arg("rules") = nullptr, py::arg("thread_count") = 0,
+    "Extend the named clustering with the blocks [start, stop)")
+    .def("remove_clustering", &ClusteringSet::removeClustering, py::arg("name"), "Remove the named clustering and delete its files")
+    .def("manager", &ClusteringSet::getManager, py::arg("name"), "Open a ClusterManager on the named clustering")
+    .def("cluster_count", &ClusteringSet::clusterCount, py::arg("name"), "Number of clusters in the named clustering")
+    .def("cluster_num", &ClusteringSet::getClusterNum, py::arg("name"), py::arg("address"), "Number of the cluster containing the address in the named clustering")
+    .def("compare", [](const ClusteringSet &set, const std::string &a, const std::string &b, uint32_t threadCount) {
+        ClusteringComparison comparison;
+        {
+            py::gil_scoped_release release;
+            comparison = set.compare(a, b, threadCount);
+        }
+        py::dict result;
+        result["address_count"] = comparison.addressCount;
+        result["split_clusters"] = comparison.splitClusters;
+        result["merged_clusters"] = comparison.mergedClusters;
+        return result;
+    }, py::arg("a"), py::arg("b"), py::arg("thread_count") = 0,
+    "Compare two clusterings address by address. Returns a dict with the number of compared addresses, the clusters of a spread over several clusters of b and the clusters of b containing several clusters of a")
     ;
 }
 
@@ -97,6 +402,23 @@ void init_cluster(py::class_<Cluster> &cl) {
         return cluster.getOutputTransactions();
     }, "Returns a list of all transaction where this cluster was an output")
     .def("output_txes", &Cluster::getOutputTransactions, "Returns a list of all transaction where this cluster was an output")
+    .def("tx_set", &Cluster::getTxSet, py::arg("thread_count") = 0, py::call_guard<py::gil_scoped_release>(),
+    "Returns a TxSet of all transactions involving this cluster, found by scanning its addresses on thread_count threads (0 uses all cores). Much faster than txes for clusters with many addresses")
+    .def("output_tx_set", &Cluster::getOutputTxSet, py::arg("thread_count") = 0, py::call_guard<py::gil_scoped_release>(),
+    "Returns a TxSet of all transactions where this cluster was an output")
+    .def("input_tx_set", &Cluster::getInputTxSet, py::arg("thread_count") = 0, py::call_guard<py::gil_scoped_release>(),
+    "Returns a TxSet of all transactions where this cluster was an input")
+    .def("stats", [](const Cluster &cluster) {
+        auto stats = cluster.getStats();
+        py::dict result;
+        result["total_received"] = stats.totalReceived;
+        result["balance"] = stats.balance;
+        result["address_count"] = stats.addressCount;
+        result["tx_count"] = stats.txCount;
+        result["first_height"] = stats.firstHeight;
+        result["last_height"] = stats.lastHeight;
+        return result;
+    }, "Returns a dictionary of the statistics precomputed for this cluster over the blocks of the clustering: total_received, balance at the end of the clustering, address_count not counting type equivalent addresses, tx_count and the first_height and last_height of these transactions")
     ;
 }
 
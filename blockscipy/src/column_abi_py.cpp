@@ -0,0 +1,108 @@
+//
+//  column_abi_py.cpp
+//  blocksci_interface
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include <blocksci/column_abi.h>
+#include <blocksci/chain/blockchain.hpp>
+#include <blocksci/cluster/cluster_manager.hpp>
+#include <blocksci/core/address_types.hpp>
+
+#include <pybind11/pybind11.h>
+
+#include <stdexcept>
+#include <string>
+
+namespace py = pybind11;
+using namespace blocksci;
+
+namespace {
+    constexpr const char *columnCapsuleName = "blocksci_column";
+
+    /** Context of a column capsule, which hands out the address of column and keeps the chain or clustering alive */
+    struct CapsuleColumn {
+        blocksci_column column;
+        py::object owner;
+    };
+
+    py::object columnCapsule(int status, const blocksci_column &column, py::object owner) {
+        if (status != 0) {
+            throw std::runtime_error(blocksci_last_error());
+        }
+        auto capsuleColumn = new CapsuleColumn{column, std::move(owner)};
+        auto capsule = PyCapsule_New(&capsuleColumn->column, columnCapsuleName, [](PyObject *object) {
+            delete static_cast<CapsuleColumn *>(PyCapsule_GetContext(object));
+        });
+        if (capsule == nullptr) {
+            delete capsuleColumn;
+            throw py::error_already_set();
+        }
+        PyCapsule_SetContext(capsule, capsuleColumn);
+        return py::reinterpret_steal<py::object>(capsule);
+    }
+
+    int dedupTypeOf(AddressType::Enum type) {
+        auto dedupType = blocksci_dedup_type(static_cast<int>(type));
+        if (dedupType < 0) {
+            throw std::invalid_argument(blocksci_last_error());
+        }
+        return dedupType;
+    }
+
+    int scriptColumnNum(const std::string &name) {
+        if (name == "first_seen") {
+            return BLOCKSCI_SCRIPT_FIRST_SEEN;
+        } else if (name == "first_spent") {
+            return BLOCKSCI_SCRIPT_FIRST_SPENT;
+        } else if (name == "types_seen") {
+            return BLOCKSCI_SCRIPT_TYPES_SEEN;
+        }
+        throw std::invalid_argument("Unknown script column " + name + ", expected first_seen, first_spent or types_seen");
+    }
+
+    int clusterColumnNum(const std::string &name) {
+        if (name == "offsets") {
+            return BLOCKSCI_CLUSTER_OFFSETS;
+        } else if (name == "addresses") {
+            return BLOCKSCI_CLUSTER_ADDRESSES;
+        } else if (name == "index") {
+            return BLOCKSCI_CLUSTER_INDEX;
+        }
+        throw std::invalid_argument("Unknown cluster column " + name + ", expected offsets, addresses or index");
+    }
+} // namespace
+
+void init_column_abi(py::module &m) {
+    m.attr("column_abi_version") = py::int_(blocksci_column_abi_version());
+
+    m.def("raw_chain_column", [](py::object chain, ChainColumn column) {
+        blocksci_column result;
+        auto status = blocksci_chain_column(reinterpret_cast<blocksci_chain *>(&chain.cast<Blockchain &>()), static_cast<int>(column), &result);
+        return columnCapsule(status, result, chain);
+    }, "Return a PyCapsule named 'blocksci_column' holding a pointer to the blocksci_column descriptor (see blocksci/column_abi.h) of the chain column, for kernels in Numba, Cython or C that read it directly. The capsule keeps the chain alive, but the memory becomes invalid when the chain is reloaded. blocksci.raw_columns.describe unpacks it in Python.",
+        pybind11::arg("chain"), pybind11::arg("column"));
+
+    m.def("raw_script_column", [](py::object chain, AddressType::Enum type, const std::string &name) {
+        blocksci_column result;
+        auto status = blocksci_script_column(reinterpret_cast<blocksci_chain *>(&chain.cast<Blockchain &>()), dedupTypeOf(type), scriptColumnNum(name), &result);
+        return columnCapsule(status, result, chain);
+    }, "Same as raw_chain_column for the script header column first_seen, first_spent or types_seen of the scripts of the address type, element i describing script number i + 1",
+        pybind11::arg("chain"), pybind11::arg("address_type"), pybind11::arg("column"));
+
+    m.def("raw_cluster_column", [](py::object clustering, const std::string &name, AddressType::Enum type) {
+        blocksci_column result;
+        auto status = blocksci_cluster_column(reinterpret_cast<blocksci_clustering *>(&clustering.cast<ClusterManager &>()), clusterColumnNum(name), dedupTypeOf(type), &result);
+        return columnCapsule(status, result, clustering);
+    }, "Same as raw_chain_column for the offsets, addresses or the cluster index of a clustering. The address type selects the scripts whose cluster index is returned and is ignored by the other columns",
+        pybind11::arg("cluster_manager"), pybind11::arg("column"), pybind11::arg("address_type") = AddressType::PUBKEYHASH);
+
+    m.def("chain_handle", [](Blockchain &chain) {
+        return py::capsule(&chain, "blocksci_chain");
+    }, "Return a PyCapsule named 'blocksci_chain' holding the blocksci_chain pointer that the functions of blocksci/column_abi.h take. It does not keep the chain alive");
+
+    m.def("clustering_handle", [](ClusterManager &clustering) {
+        return py::capsule(&clustering, "blocksci_clustering");
+    }, "Return a PyCapsule named 'blocksci_clustering' holding the blocksci_clustering pointer that the functions of blocksci/column_abi.h take. It does not keep the cluster manager alive");
+}
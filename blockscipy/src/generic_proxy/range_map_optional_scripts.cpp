@@ -26,5 +26,6 @@ void applyProxyMapOptionalFuncsScripts(pybind11::class_<IteratorProxy, GenericPr
 	.def("_map_optional", mapOptional<script::OpReturn>)
 	.def("_map_optional", mapOptional<script::Nonstandard>)
 	.def("_map_optional", mapOptional<script::WitnessUnknown>)
+	.def("_map_optional", mapOptional<script::WitnessTaproot>)
 	;
 }
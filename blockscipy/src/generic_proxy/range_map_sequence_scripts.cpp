@@ -24,5 +24,6 @@ void applyProxyMapSequenceFuncsScripts(pybind11::class_<IteratorProxy, GenericPr
 	.def("_map_sequence", mapSequence<script::OpReturn>)
 	.def("_map_sequence", mapSequence<script::Nonstandard>)
 	.def("_map_sequence", mapSequence<script::WitnessUnknown>)
+	.def("_map_sequence", mapSequence<script::WitnessTaproot>)
 	;
 }
@@ -16,11 +16,52 @@
 #include <blocksci/chain/block.hpp>
 #include <blocksci/scripts/script_variant.hpp>
 
+#include <range/v3/view/iota.hpp>
 #include <range/v3/view/transform.hpp>
 
+#include <type_traits>
+
+/** Item types for which mapSimple evaluates batch kernels instead of wrapping every item in std::any */
+template <typename T>
+constexpr bool is_batch_mapped_v = std::is_same_v<T, blocksci::Block> || std::is_same_v<T, blocksci::Transaction> || std::is_same_v<T, blocksci::Input> || std::is_same_v<T, blocksci::Output>;
+
+/** seq mapped through the batch kernel of p2, if it has one for the items of seq
+ *
+ * Ranges are evaluated up front so the result stays random access, iterators lazily one batch at a time.
+ */
+template<ranges::category range_cat, typename R, typename Seq>
+ranges::optional<ranges::any_view<R, range_cat>> batchMapSequence(Seq &seq, const Proxy<R> &p2) {
+	if constexpr (has_batch_kernel<Proxy<R>>::value && std::is_default_constructible_v<R>) {
+		if (!p2.batch) {
+			return ranges::nullopt;
+		}
+		return mpark::visit([&](auto &rng) -> ranges::optional<ranges::any_view<R, range_cat>> {
+			using T = ranges::range_value_t<std::decay_t<decltype(rng)>>;
+			if constexpr (is_batch_mapped_v<T>) {
+				if (auto kernel = batchKernelFor<T>(p2)) {
+					if constexpr (range_cat == random_access_sized) {
+						auto values = batchMapAll<T>(rng, *kernel);
+						return ranges::any_view<R, range_cat>{ranges::views::ints(size_t{0}, values->size()) | ranges::views::transform([values](size_t i) -> R {
+							return (*values)[i];
+						})};
+					} else {
+						return ranges::any_view<R, range_cat>{batch_map_range<T, R>{RawIterator<T>{std::move(rng)}, std::move(kernel)}};
+					}
+				}
+			}
+			return ranges::nullopt;
+		}, seq.var);
+	} else {
+		return ranges::nullopt;
+	}
+}
+
 template<ranges::category range_cat, typename R>
 Proxy<ranges::any_view<R, range_cat>> mapSimple(proxy_sequence<range_cat> &p, Proxy<R> &p2) {
 	return liftGeneric(p, [p2](auto && seq) -> ranges::any_view<R, range_cat> {
+		if (auto mapped = batchMapSequence<range_cat>(seq, p2)) {
+			return std::move(*mapped);
+		}
 		return ranges::views::transform(std::forward<decltype(seq)>(seq).toAnySequence(), p2);
 	});
 }
@@ -55,6 +96,7 @@ void addProxyMapFuncsMethodsScripts(Class &cl) {
 	.def("_map", mapSimple<range_cat, script::OpReturn>)
 	.def("_map", mapSimple<range_cat, script::Nonstandard>)
 	.def("_map", mapSimple<range_cat, script::WitnessUnknown>)
+	.def("_map", mapSimple<range_cat, script::WitnessTaproot>)
 	;
 }
 
@@ -0,0 +1,89 @@
+//
+//  graph_export_py.cpp
+//  blocksci_interface
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include <blocksci/chain/blockchain.hpp>
+#include <blocksci/chain/graph_export.hpp>
+#include <blocksci/cluster/cluster_manager.hpp>
+
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+using namespace blocksci;
+
+void init_graph_export(py::module &m) {
+    py::enum_<GraphLevel>(m, "graph_level", "What the nodes of an exported transaction graph are")
+    .value("tx", GraphLevel::Transaction)
+    .value("address", GraphLevel::Address)
+    .value("cluster", GraphLevel::Cluster)
+    ;
+    
+    py::enum_<GraphExportFormat>(m, "graph_export_format", "File layouts transaction graphs can be exported to")
+    .value("edge_list", GraphExportFormat::EdgeList)
+    .value("csr", GraphExportFormat::CSR)
+    .value("weighted_csr", GraphExportFormat::WeightedCSR)
+    ;
+    
+    m.def("export_graph", [](Blockchain &chain, const std::string &directory, BlockHeight start, BlockHeight stop, GraphLevel level,
+                             GraphExportFormat format, const ClusterManager *clusters, bool includeSelfLoops, const std::string &tempDirectory) {
+        if (stop < 0) {
+            stop = chain.size();
+        }
+        auto blocks = chain[{start, stop}];
+        GraphExportOptions options;
+        options.level = level;
+        options.format = format;
+        options.includeSelfLoops = includeSelfLoops;
+        options.tempDirectory = tempDirectory;
+        GraphExportSummary summary;
+        {
+            py::gil_scoped_release release;
+            summary = exportGraph(blocks, directory, options, clusters);
+        }
+        py::dict ret;
+        ret["node_count"] = summary.nodeCount;
+        ret["edge_count"] = summary.edgeCount;
+        ret["path"] = summary.path;
+        return ret;
+    }, py::arg("chain"), py::arg("directory"), py::arg("start") = 0, py::arg("stop") = -1, py::arg("level") = GraphLevel::Transaction,
+        py::arg("format") = GraphExportFormat::CSR, py::arg("clusters") = nullptr, py::arg("include_self_loops") = false, py::arg("temp_directory") = "",
+        "Write the transaction graph of the blocks [start, stop) to directory/graph.csr or directory/graph.edges in parallel, contracted to "
+        "addresses or to the clusters of the given ClusterManager depending on level. Returns a dict with the node_count, edge_count and path of the file. "
+        "Both files start with an 88 byte header; an edge list holds (source uint32, target uint32, value int64) records, a CSR file uint64 offsets[node_count + 1], "
+        "uint32 targets and int64 values, with the values starting at the next multiple of 8 bytes.");
+    
+    m.def("export_cospend_graph", [](Blockchain &chain, const std::string &directory, BlockHeight start, BlockHeight stop, GraphLevel level,
+                                     const ClusterManager *clusters, bool skipCoinJoin, uint32_t maxCliqueNodes, uint64_t memoryLimit, const std::string &tempDirectory) {
+        if (stop < 0) {
+            stop = chain.size();
+        }
+        auto blocks = chain[{start, stop}];
+        CoSpendGraphOptions options;
+        options.level = level;
+        options.skipCoinJoin = skipCoinJoin;
+        options.maxCliqueNodes = maxCliqueNodes;
+        options.memoryLimit = memoryLimit;
+        options.tempDirectory = tempDirectory;
+        GraphExportSummary summary;
+        {
+            py::gil_scoped_release release;
+            summary = exportCoSpendGraph(blocks, directory, options, clusters);
+        }
+        py::dict ret;
+        ret["node_count"] = summary.nodeCount;
+        ret["edge_count"] = summary.edgeCount;
+        ret["path"] = summary.path;
+        return ret;
+    }, py::arg("chain"), py::arg("directory"), py::arg("start") = 0, py::arg("stop") = -1, py::arg("level") = GraphLevel::Address,
+        py::arg("clusters") = nullptr, py::arg("skip_coinjoin") = true, py::arg("max_clique_nodes") = 64, py::arg("memory_limit") = uint64_t{1} << 30,
+        py::arg("temp_directory") = "",
+        "Write the co-spend graph of the blocks [start, stop) to directory/cospend.csr, linking every two addresses (or clusters of the given ClusterManager "
+        "depending on level) spent together by a transaction once, weighted by the number of such transactions and the value the two spent in them. "
+        "Transactions spending from more than max_clique_nodes nodes link them all to one of them only. Edges are aggregated in parallel, spilled to "
+        "temp_directory beyond memory_limit bytes and merged at the end. Returns a dict with the node_count, edge_count and path of the file, which is "
+        "a CSR file with every edge stored for both of its nodes, followed by uint32 tx_counts[edge_count].");
+}
@@ -14,6 +14,10 @@
 #include <blocksci/chain/blockchain.hpp>
 #include <blocksci/chain/transaction.hpp>
 
+#include <pybind11/numpy.h>
+
+#include <limits>
+
 namespace py = pybind11;
 using namespace blocksci;
 using namespace blocksci::heuristics;
@@ -21,6 +25,44 @@ using namespace blocksci::heuristics;
 struct Heuristics {};
 struct Change {};
 
+namespace {
+    /** Hops of all chains as numpy columns, and the end of every chain */
+    py::tuple peelingChainTable(const std::vector<PeelingChain> &chains) {
+        size_t hopCount = 0;
+        for (auto &chain : chains) {
+            hopCount += chain.hops.size();
+        }
+        py::array_t<uint32_t> chainNums{hopCount};
+        py::array_t<uint32_t> txNums{hopCount};
+        py::array_t<int32_t> heights{hopCount};
+        py::array_t<uint16_t> outputNums{hopCount};
+        py::array_t<int64_t> values{hopCount};
+        py::array_t<int64_t> peeledValues{hopCount};
+        py::array_t<uint8_t> ends{chains.size()};
+        size_t row = 0;
+        for (size_t i = 0; i < chains.size(); i++) {
+            for (auto &hop : chains[i].hops) {
+                chainNums.mutable_data()[row] = static_cast<uint32_t>(i);
+                txNums.mutable_data()[row] = hop.txNum;
+                heights.mutable_data()[row] = hop.blockHeight;
+                outputNums.mutable_data()[row] = hop.outputNum;
+                values.mutable_data()[row] = hop.value;
+                peeledValues.mutable_data()[row] = hop.peeledValue;
+                row++;
+            }
+            ends.mutable_data()[i] = static_cast<uint8_t>(chains[i].end);
+        }
+        py::dict hops;
+        hops["chain"] = chainNums;
+        hops["tx_index"] = txNums;
+        hops["block_height"] = heights;
+        hops["output_index"] = outputNums;
+        hops["value"] = values;
+        hops["peeled_value"] = peeledValues;
+        return py::make_tuple(hops, ends);
+    }
+}
+
 void init_heuristics(py::module &m) {
 
     py::enum_<heuristics::CoinJoinResult>(m, "CoinJoinResult")
@@ -29,6 +71,12 @@ void init_heuristics(py::module &m) {
     .value("Timeout", heuristics::CoinJoinResult::Timeout)
     ;
 
+    py::enum_<heuristics::PeelingChainEnd>(m, "PeelingChainEnd")
+    .value("Unspent", heuristics::PeelingChainEnd::Unspent)
+    .value("NotPeeling", heuristics::PeelingChainEnd::NotPeeling)
+    .value("MaxHops", heuristics::PeelingChainEnd::MaxHops)
+    ;
+
     py::class_<Heuristics> cl(m, "heuristics");
 
     cl
@@ -62,12 +110,68 @@ void init_heuristics(py::module &m) {
     ;
 
     cl
-    .def_static("poison_tainted_outputs", heuristics::getPoisonTainted, py::arg("outputs"), py::arg("max_block_height") = -1, py::arg("taint_fee") = true, "Returns the list of current UTXOs poison tainted by this output")
-    .def_static("haircut_tainted_outputs", heuristics::getHaircutTainted, py::arg("outputs"), py::arg("max_block_height") = -1, py::arg("taint_fee") = true, "Returns the list of current UTXOs haircut tainted by this output")
+    .def_static("build_tx_feature_table", heuristics::buildTxFeatureTable, py::arg("chain"), py::arg("min_base_fee") = 0, py::arg("percentage_fee") = 0.01, py::arg("max_depth") = 10000, py::arg("thread_count") = 0, py::arg("show_progress") = false, py::call_guard<py::gil_scoped_release>(),
+        "Precompute the results of the CoinJoin, deanonymization, change-over and keyset change heuristics for every transaction, which makes them lookups afterwards. is_possible_coinjoin and is_coinjoin_extra use the table when called with the same parameters. Building again extends the table with the new transactions.")
+    .def_static("poison_tainted_outputs", heuristics::getPoisonTainted, py::arg("outputs"), py::arg("max_block_height") = -1, py::arg("taint_fee") = true, py::arg("show_progress") = false, py::call_guard<py::gil_scoped_release>(), "Returns the list of current UTXOs poison tainted by this output")
+    .def_static("haircut_tainted_outputs", heuristics::getHaircutTainted, py::arg("outputs"), py::arg("max_block_height") = -1, py::arg("taint_fee") = true, py::arg("show_progress") = false, py::call_guard<py::gil_scoped_release>(), "Returns the list of current UTXOs haircut tainted by this output")
+    .def_static("haircut_source_tainted_outputs", [](std::vector<Output> &outputs, BlockHeight maxBlockHeight, bool taintFee, uint32_t maxSources, double minProportion, uint32_t threadCount, bool showProgress) {
+        std::vector<std::pair<Output, heuristics::MultiTaint>> tainted;
+        {
+            py::gil_scoped_release release;
+            tainted = heuristics::getHaircutSourceTainted(outputs, maxBlockHeight, taintFee, {maxSources, minProportion, threadCount}, showProgress);
+        }
+        std::vector<std::pair<Output, std::vector<std::pair<uint32_t, int64_t>>>> ret;
+        ret.reserve(tainted.size());
+        for (auto &item : tainted) {
+            ret.emplace_back(item.first, std::move(item.second.seeds));
+        }
+        return ret;
+    }, py::arg("outputs"), py::arg("max_block_height") = -1, py::arg("taint_fee") = true, py::arg("max_sources") = 16, py::arg("min_proportion") = 1e-6, py::arg("thread_count") = 1, py::arg("show_progress") = false,
+        "Returns the list of current UTXOs haircut tainted by these outputs, each with a list of (source, tainted_value) pairs where source is the position of the tainting output. Only the max_sources largest shares of every output are tracked and shares below min_proportion of its value are dropped as dust.")
+    .def_static("poison_tainted_outputs_batch", heuristics::getPoisonTaintedBatch, py::arg("seed_sets"), py::arg("max_block_height") = -1, py::arg("taint_fee") = true, py::arg("thread_count") = 0, py::arg("show_progress") = false, py::call_guard<py::gil_scoped_release>(), "Runs one poison trace per list of outputs in a single sweep and returns the list of current UTXOs tainted by each")
+    .def_static("haircut_tainted_outputs_batch", heuristics::getHaircutTaintedBatch, py::arg("seed_sets"), py::arg("max_block_height") = -1, py::arg("taint_fee") = true, py::arg("thread_count") = 0, py::arg("show_progress") = false, py::call_guard<py::gil_scoped_release>(), "Runs one haircut trace per list of outputs in a single sweep and returns the list of current UTXOs tainted by each")
+    .def_static("follow_peeling_chains", [](const std::vector<Output> &starts, uint32_t maxHops, uint32_t threadCount) {
+        std::vector<PeelingChain> chains;
+        {
+            py::gil_scoped_release release;
+            chains = followPeelingChains(starts, maxHops, {}, threadCount);
+        }
+        return peelingChainTable(chains);
+    }, py::arg("outputs"), py::arg("max_hops") = std::numeric_limits<uint32_t>::max(), py::arg("thread_count") = 0,
+        "Follow the peeling chain starting with the spend of each output, continuing with the largest output of every transaction with one input and two outputs. Returns a dict of numpy arrays with one row per hop (chain, tx_index, block_height, output_index, value, peeled_value), where chain is the position of the starting output, and a numpy array with the PeelingChainEnd of every chain.")
+    .def_static("follow_peeling_chains", [](const std::vector<Output> &starts, uint32_t maxHops, Proxy<bool> &predicate, uint32_t threadCount) {
+        std::vector<PeelingChain> chains;
+        {
+            py::gil_scoped_release release;
+            // The proxy may call back into Python
+            chains = followPeelingChains(starts, maxHops, [predicate](const Transaction &tx) {
+                py::gil_scoped_acquire acquire;
+                return predicate(tx);
+            }, threadCount);
+        }
+        return peelingChainTable(chains);
+    }, py::arg("outputs"), py::arg("max_hops"), py::arg("predicate"), py::arg("thread_count") = 0,
+        "Same as above, but every transaction for which the given transaction proxy evaluates to True continues the chain")
+    .def_static("fifo_tainted_outputs", heuristics::getFifoTainted, py::arg("outputs"), py::arg("max_block_height") = -1, py::arg("taint_fee") = true, py::arg("show_progress") = false, py::call_guard<py::gil_scoped_release>(), "Returns the list of current UTXOs FIFO tainted by this output, with the taint of each as a list of (value, is_tainted) segments")
+    .def_static("lifo_tainted_outputs", heuristics::getLifoTainted, py::arg("outputs"), py::arg("max_block_height") = -1, py::arg("taint_fee") = true, py::arg("show_progress") = false, py::call_guard<py::gil_scoped_release>(), "Returns the list of current UTXOs LIFO tainted by this output, with the taint of each as a list of (value, is_tainted) segments")
     ;
 
     py::class_<Change> s2(cl, "change");
 
+    py::enum_<ChangeType::Enum>(s2, "change_type", py::arithmetic(), "Enumeration of the change heuristics that change.evaluate can evaluate")
+    .value("peeling_chain", ChangeType::PeelingChain)
+    .value("power_of_ten_value", ChangeType::PowerOfTen)
+    .value("optimal_change", ChangeType::OptimalChange)
+    .value("address_type", ChangeType::AddressType)
+    .value("locktime", ChangeType::Locktime)
+    .value("address_reuse", ChangeType::AddressReuse)
+    .value("client_change_address_behavior", ChangeType::ClientChangeAddressBehavior)
+    .value("legacy", ChangeType::Legacy)
+    .value("fixed_fee", ChangeType::FixedFee)
+    .value("none", ChangeType::None)
+    .value("spent", ChangeType::Spent)
+    ;
+
     py::class_<ChangeHeuristic>(s2, "ChangeHeuristic", "Class representing a change heuristic")
     .def(py::init([](Proxy<ranges::any_view<Output>> &heuristic) {
         std::function<ranges::any_view<Output>(const Transaction &tx)> changeFunc = [heuristic](const Transaction &tx) {
@@ -121,5 +225,16 @@ void init_heuristics(py::module &m) {
     
     .def_property_readonly_static("spent", [](pybind11::object &) { return ChangeHeuristic{Spent{}}; },
                                   "Return a ChangeHeuristic object that selects spent outputs. Useful in combination with heuristics that select unspent outputs as candidates.")
+    .def_static("evaluate", [](Blockchain &chain, const std::vector<ChangeType::Enum> &heuristics, BlockHeight start, BlockHeight stop, int digits, uint32_t threadCount) {
+        if (stop < 0) {
+            stop = chain.size();
+        }
+        auto blocks = chain[{start, stop}];
+        auto masks = evaluateChange(blocks, heuristics, digits, threadCount);
+        py::array_t<uint32_t> ret{masks.size()};
+        std::copy(masks.begin(), masks.end(), ret.mutable_data());
+        return ret;
+    }, py::arg("chain"), py::arg("heuristics"), py::arg("start") = 0, py::arg("stop") = -1, py::arg("digits") = 6, py::arg("thread_count") = 0,
+        "Evaluate the given list of change_type heuristics on all transactions of the blocks [start, stop) at once. Returns a numpy array with one mask per output, ordered by transaction and output, in which bit i is set if the i-th heuristic returns the output as a possible change output. Combine heuristics with bitwise operations on the masks.")
     ;
 }
@@ -0,0 +1,61 @@
+//
+//  hex_codec_py.cpp
+//  blocksci_interface
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include <blocksci/core/hex_codec.hpp>
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+
+#include <stdexcept>
+#include <string>
+
+namespace py = pybind11;
+using namespace blocksci;
+
+namespace {
+    /** Width in bytes of the hashes held by a numpy array of fixed size byte strings, each of which takes
+     * charsPerByte chars */
+    size_t hashWidth(const py::array &array, size_t charsPerByte) {
+        auto itemSize = static_cast<size_t>(array.itemsize());
+        if (array.dtype().kind() != 'S' || array.ndim() != 1 || (itemSize != 20 * charsPerByte && itemSize != 32 * charsPerByte)) {
+            throw std::invalid_argument("Expected a one dimensional array of dtype S" + std::to_string(20 * charsPerByte) + " or S" + std::to_string(32 * charsPerByte));
+        }
+        return itemSize / charsPerByte;
+    }
+} // namespace
+
+void init_hex_codec(py::module &m) {
+    m.def("hashes_to_hex", [](py::array hashes) {
+        auto width = hashWidth(hashes, 1);
+        auto count = static_cast<size_t>(hashes.shape(0));
+        py::array ret{py::dtype("S" + std::to_string(2 * width)), {static_cast<py::ssize_t>(count)}};
+        auto source = py::array::ensure(hashes, py::array::c_style);
+        {
+            py::gil_scoped_release release;
+            encodeHexBatch(static_cast<const unsigned char *>(source.data()), width, count, static_cast<char *>(ret.mutable_data()));
+        }
+        return ret;
+    }, "Convert an array of raw 20 or 32 byte hashes (dtype S20 or S32, like the hash columns of to_arrow) to an array of their hex strings (dtype S40 or S64) in the format of str(hash), using vectorized kernels",
+        py::arg("hashes"));
+
+    m.def("hashes_from_hex", [](py::array hexStrings) {
+        auto width = hashWidth(hexStrings, 2);
+        auto count = static_cast<size_t>(hexStrings.shape(0));
+        py::array ret{py::dtype("S" + std::to_string(width)), {static_cast<py::ssize_t>(count)}};
+        auto source = py::array::ensure(hexStrings, py::array::c_style);
+        size_t decoded;
+        {
+            py::gil_scoped_release release;
+            decoded = decodeHexBatch(static_cast<const char *>(source.data()), 2 * width, width, count, static_cast<unsigned char *>(ret.mutable_data()));
+        }
+        if (decoded != count) {
+            throw std::invalid_argument("Hash number " + std::to_string(decoded) + " is not a hex string of " + std::to_string(2 * width) + " digits");
+        }
+        return ret;
+    }, "Reverse of hashes_to_hex: convert an array of hex strings of 40 or 64 digits (dtype S40 or S64) to an array of raw hashes (dtype S20 or S32)",
+        py::arg("hex_strings"));
+}
@@ -65,6 +65,7 @@ TypenameLookup::TypenameLookup() {
     addTypeName<script::ScriptHash>(typeNames, docstringTypeNames, "ScriptHashAddress");
     addTypeName<script::WitnessScriptHash>(typeNames, docstringTypeNames, "WitnessScriptHashAddress");
     addTypeName<script::WitnessUnknown>(typeNames, docstringTypeNames, "WitnessUnknownAddress");
+    addTypeName<script::WitnessTaproot>(typeNames, docstringTypeNames, "WitnessTaprootAddress");
 
     addTypeName<EquivAddress>(typeNames, docstringTypeNames, "EquivAddress");
     addTypeName<Block>(typeNames, docstringTypeNames, "Block");
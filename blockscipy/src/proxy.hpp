@@ -17,6 +17,9 @@
 #include <range/v3/view/empty.hpp>
 #include <range/v3/view/single.hpp>
 
+#include <memory>
+#include <typeinfo>
+
 template<typename T>
 struct SequenceProxy {
 	virtual std::function<RawIterator<T>(std::any &)> getIteratorFunc() const = 0;
@@ -43,12 +46,37 @@ template <ranges::category range_cat>
 using proxy_sequence = typename SequenceProxyType<range_cat>::type;
 
 
+/** Number of items a ProxyBatchKernel is evaluated for at once by the range operations */
+constexpr size_t proxyBatchSize = 1024;
+
+/** Evaluates a simple proxy for a batch of items stored contiguously, instead of one std::any at a time
+ *
+ * Proxies built from the identity, constants and lift carry a kernel. Range operations like _where use it to run
+ * the whole expression over typed buffers of proxyBatchSize items, and fall back to func when it is missing.
+ */
+template <typename T>
+struct ProxyBatchKernel {
+	/** Type of the items, nullptr if the proxy ignores its input */
+	const std::type_info *itemType;
+
+	/** The proxy returns its input, so the items can be read as its values without calling eval */
+	bool identity;
+
+	/** Write the values of count items to out */
+	std::function<void(const void *items, size_t count, T *out)> eval;
+};
+
+/** Fields, constants and predicates a ColumnFilter can check, @see proxy_pushdown.hpp */
+struct ProxyPushdown;
+
 template<typename T>
 struct Proxy : public SimpleProxy {
 	using output_t = T;
 	
 	std::function<output_t(std::any &)> func;
 	ProxyTypeInfo sourceType;
+	std::shared_ptr<const ProxyBatchKernel<T>> batch;
+	std::shared_ptr<const ProxyPushdown> pushdown;
 
 	Proxy(std::function<output_t(std::any &)> && func_, const ProxyTypeInfo &sourceType_) : func(std::move(func_)), sourceType(sourceType_) {}
 
@@ -239,6 +267,7 @@ struct Proxy<blocksci::AnyScript> : public ProxyAddress {
 	
 	std::function<output_t(std::any &)> func;
 	ProxyTypeInfo sourceType;
+	std::shared_ptr<const ProxyPushdown> pushdown;
 
 	Proxy(std::function<output_t(std::any &)> && func_, const ProxyTypeInfo &sourceType_) : func(std::move(func_)), sourceType(sourceType_) {}
 
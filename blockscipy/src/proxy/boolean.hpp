@@ -10,6 +10,7 @@
 #define proxy_boolean_hpp
 
 #include "proxy.hpp"
+#include "proxy_pushdown.hpp"
 #include "proxy_type_check.hpp"
 
 template<typename Class>
@@ -20,16 +21,20 @@ void addProxyBooleanMethods(Class &cl) {
 	.def("__and__", [](P &p1, P &p2) -> P {
 		// Use this instead of lift to take advantage of short-circuit
 		p1.getSourceType().checkMatch(p2.getSourceType());
-		return {std::function<bool(std::any &)>{[p1, p2](std::any &v) -> bool {
+		P result{std::function<bool(std::any &)>{[p1, p2](std::any &v) -> bool {
 			return p1(v) && p2(v);
 		}}, p1.getSourceType()};
+		conjoinPushdown(result, p1, p2);
+		return result;
 	})
 	.def("__or__", [](P &p1, P &p2) -> P {
 		// Use this instead of lift to take advantage of short-circuit
 		p1.getSourceType().checkMatch(p2.getSourceType());
-		return {std::function<bool(std::any &)>{[p1, p2](std::any &v) -> bool {
+		P result{std::function<bool(std::any &)>{[p1, p2](std::any &v) -> bool {
 			return p1(v) || p2(v);
 		}}, p1.getSourceType()};
+		disjoinPushdown(result, p1, p2);
+		return result;
 	})
 	.def("__invert__", [](P &p) -> P {
 		return lift(p, [](auto && v) -> T {
@@ -10,30 +10,39 @@
 #define proxy_comparison_hpp
 
 #include "proxy.hpp"
+#include "proxy_pushdown.hpp"
 
 template<typename Class>
 void addProxyComparisonMethods(Class &cl) {
 	using P = typename Class::type;
 	cl
 	.def("__lt__", [](P &p1, P &p2) -> Proxy<bool> {
-		return lift(p1, p2, [](auto && v1, auto && v2) -> bool {
+		auto result = lift(p1, p2, [](auto && v1, auto && v2) -> bool {
 			return std::forward<decltype(v1)>(v1) < std::forward<decltype(v2)>(v2);
 		});
+		comparePushdown(result, p1, p2, PushdownComparison::Less);
+		return result;
 	})
 	.def("__le__", [](P &p1, P &p2) -> Proxy<bool> {
-		return lift(p1, p2, [](auto && v1, auto && v2) -> bool {
+		auto result = lift(p1, p2, [](auto && v1, auto && v2) -> bool {
 			return std::forward<decltype(v1)>(v1) <= std::forward<decltype(v2)>(v2);
 		});
+		comparePushdown(result, p1, p2, PushdownComparison::LessEqual);
+		return result;
 	})
 	.def("__gt__", [](P &p1, P &p2) -> Proxy<bool> {
-		return lift(p1, p2, [](auto && v1, auto && v2) -> bool {
+		auto result = lift(p1, p2, [](auto && v1, auto && v2) -> bool {
 			return std::forward<decltype(v1)>(v1) > std::forward<decltype(v2)>(v2);
 		});
+		comparePushdown(result, p1, p2, PushdownComparison::Greater);
+		return result;
 	})
 	.def("__ge__", [](P &p1, P &p2) -> Proxy<bool> {
-		return lift(p1, p2, [](auto && v1, auto && v2) -> bool {
+		auto result = lift(p1, p2, [](auto && v1, auto && v2) -> bool {
 			return std::forward<decltype(v1)>(v1) >= std::forward<decltype(v2)>(v2);
 		});
+		comparePushdown(result, p1, p2, PushdownComparison::GreaterEqual);
+		return result;
 	})
 	;
 }
@@ -10,15 +10,18 @@
 #define proxy_equality_hpp
 
 #include "proxy.hpp"
+#include "proxy_pushdown.hpp"
 
 template<typename Class>
 void addProxyEqualityMethods(Class &cl) {
 	using P = typename Class::type;
 	cl
 	.def("__eq__", [](P &p1, P &p2) -> Proxy<bool> {
-		return lift(p1, p2, [](auto && v1, auto && v2) -> bool {
+		auto result = lift(p1, p2, [](auto && v1, auto && v2) -> bool {
 			return std::forward<decltype(v1)>(v1) == std::forward<decltype(v2)>(v2);
 		});
+		comparePushdown(result, p1, p2, PushdownComparison::Equal);
+		return result;
 	})
 	.def("__ne__", [](P &p1, P &p2) -> Proxy<bool> {
 		return lift(p1, p2, [](auto && v1, auto && v2) -> bool {
@@ -23,5 +23,6 @@ void addProxyFlowFunctionsScripts(pybind11::module &m, pybind11::module &pm) {
 	addProxyFlowFunctions<script::OpReturn>(m, pm);
 	addProxyFlowFunctions<script::Nonstandard>(m, pm);
 	addProxyFlowFunctions<script::WitnessUnknown>(m, pm);
+	addProxyFlowFunctions<script::WitnessTaproot>(m, pm);
 
 }
@@ -23,5 +23,6 @@ void addProxyFunctionsScripts(pybind11::module &m, pybind11::module &pm) {
 	addProxyFunctions<script::OpReturn>(m, pm);
 	addProxyFunctions<script::Nonstandard>(m, pm);
 	addProxyFunctions<script::WitnessUnknown>(m, pm);
+	addProxyFunctions<script::WitnessTaproot>(m, pm);
 
 }
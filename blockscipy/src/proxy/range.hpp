@@ -22,6 +22,9 @@ void setupRangesProxy(AllProxyClasses<T, BaseSimple> &cls) {
 	cls.sequence
 	.def("_where", [](SequenceProxy<T> &p, Proxy<bool> &p2) -> Proxy<RawIterator<T>> {
 		return liftSequence(p, [p2](auto && seq) -> RawIterator<T> {
+			if (auto predicate = batchKernelFor<T>(p2)) {
+				return batch_filter_range<T>{std::forward<decltype(seq)>(seq), std::move(predicate)};
+			}
 			return ranges::views::filter(std::forward<decltype(seq)>(seq), [p2](T item) {
 				return p2(std::move(item));
 			});
@@ -31,6 +34,9 @@ void setupRangesProxy(AllProxyClasses<T, BaseSimple> &cls) {
 		// Copied and modified from range/v3/algorithm/max.hpp
 		// Testing whether input range was empty required modification
 		return liftSequence(p, [p2](auto && rng) -> ranges::optional<T> {
+			if (auto key = batchKernelFor<T>(p2)) {
+				return batchSelect<T>(rng, *key, [](int64_t a, int64_t b) { return a > b; });
+			}
 			auto begin = ranges::begin(rng);
             auto end = ranges::end(rng);
             if (begin == end) {
@@ -51,6 +57,9 @@ void setupRangesProxy(AllProxyClasses<T, BaseSimple> &cls) {
 		// Copied and modified from range/v3/algorithm/min.hpp
 		// Testing whether input range was empty required modification
 		return liftSequence(p, [p2](auto && rng) -> ranges::optional<T> {
+			if (auto key = batchKernelFor<T>(p2)) {
+				return batchSelect<T>(rng, *key, [](int64_t a, int64_t b) { return a < b; });
+			}
 			auto begin = ranges::begin(rng);
             auto end = ranges::end(rng);
             if (begin == end) {
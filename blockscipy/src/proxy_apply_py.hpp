@@ -9,6 +9,7 @@
 #define proxy_apply_py_hpp
 
 #include "proxy_utils.hpp"
+#include "proxy_pushdown.hpp"
 #include "func_converter.hpp"
 #include "method_tags.hpp"
 #include "blocksci_type_converter.hpp"
@@ -69,6 +70,18 @@ struct ApplyMethodsToProxyImpl {
     void applyProperty(const std::string &propertyName, std::function<result_type(Out &)> func, const std::string &description) {
         using converted_t = Converter<P, Out, result_type>;
         converted_t convertedFunc{func};
+        if constexpr (PushdownFields<Out>::value) {
+            // Mark the fields a where can answer from columns and indexes, see proxy_pushdown.hpp
+            if (auto field = PushdownFields<Out>::find(propertyName)) {
+                auto fieldFunc = [convertedFunc, field = *field](P &p) {
+                    auto lifted = convertedFunc(p);
+                    setFieldPushdown<Out>(lifted, p, field);
+                    return lifted;
+                };
+                applyPropertyImpl(propertyName, pybind11::cpp_function(std::move(fieldFunc), pybind11::return_value_policy::reference_internal), strdup(description.c_str()));
+                return;
+            }
+        }
         applyPropertyImpl(propertyName, pybind11::cpp_function(std::move(convertedFunc), pybind11::return_value_policy::reference_internal), strdup(description.c_str()));
     }
 
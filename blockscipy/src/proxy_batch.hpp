@@ -0,0 +1,292 @@
+//
+//  proxy_batch.hpp
+//  blocksci_interface
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef proxy_batch_hpp
+#define proxy_batch_hpp
+
+#include "proxy.hpp"
+
+#include <range/v3/view/facade.hpp>
+#include <range/v3/utility/optional.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+template <typename P, typename = void>
+struct has_batch_kernel : std::false_type {};
+
+template <typename P>
+struct has_batch_kernel<P, std::void_t<decltype(std::declval<P &>().batch)>> : std::true_type {};
+
+/** Contiguous storage for a batch of items, bools are kept as char since std::vector<bool> is packed */
+template <typename T>
+using batch_items_t = std::vector<std::conditional_t<std::is_same_v<T, bool>, char, T>>;
+
+template <typename T>
+void setIdentityBatch(Proxy<T> &p) {
+	if constexpr (has_batch_kernel<Proxy<T>>::value) {
+		p.batch = std::make_shared<const ProxyBatchKernel<T>>(ProxyBatchKernel<T>{&typeid(T), true, {}});
+	}
+}
+
+template <typename T>
+void setConstantBatch(Proxy<T> &p, const T &val) {
+	if constexpr (has_batch_kernel<Proxy<T>>::value && std::is_default_constructible_v<T>) {
+		p.batch = std::make_shared<const ProxyBatchKernel<T>>(ProxyBatchKernel<T>{nullptr, false, [val](const void *, size_t count, T *out) {
+			std::fill(out, out + count, val);
+		}});
+	}
+}
+
+/** Values of the kernel for count items, pointing either at the items themselves or into storage */
+template <typename T>
+const T *batchValues(const ProxyBatchKernel<T> &kernel, const void *items, size_t count, std::unique_ptr<T[]> &storage) {
+	if (kernel.identity) {
+		return static_cast<const T *>(items);
+	}
+	if constexpr (std::is_default_constructible_v<T>) {
+		storage = std::make_unique<T[]>(count);
+		kernel.eval(items, count, storage.get());
+		return storage.get();
+	} else {
+		// Only identity kernels are created for types which can't be buffered
+		throw std::logic_error("Proxy batch kernel has no buffer type");
+	}
+}
+
+/** Give lifted = lift(p, f) a kernel if p has one */
+template <typename R, typename P, typename F>
+void liftBatch(Proxy<R> &lifted, const P &p, const F &f) {
+	if constexpr (has_batch_kernel<Proxy<R>>::value && has_batch_kernel<P>::value && std::is_default_constructible_v<R>) {
+		using In = typename P::output_t;
+		auto inner = p.batch;
+		if (!inner || (!inner->identity && !std::is_default_constructible_v<In>)) {
+			return;
+		}
+		lifted.batch = std::make_shared<const ProxyBatchKernel<R>>(ProxyBatchKernel<R>{inner->itemType, false, [inner, f = f](const void *items, size_t count, R *out) {
+			std::unique_ptr<In[]> storage;
+			auto values = batchValues(*inner, items, count, storage);
+			for (size_t i = 0; i < count; i++) {
+				In value = values[i];
+				out[i] = f(std::move(value));
+			}
+		}});
+	}
+}
+
+/** Give lifted = lift(p1, p2, f) a kernel if both p1 and p2 have one reading the same items */
+template <typename R, typename P1, typename P2, typename F>
+void liftBatch(Proxy<R> &lifted, const P1 &p1, const P2 &p2, const F &f) {
+	if constexpr (has_batch_kernel<Proxy<R>>::value && has_batch_kernel<P1>::value && has_batch_kernel<P2>::value && std::is_default_constructible_v<R>) {
+		using In1 = typename P1::output_t;
+		using In2 = typename P2::output_t;
+		auto inner1 = p1.batch;
+		auto inner2 = p2.batch;
+		if (!inner1 || !inner2 || (!inner1->identity && !std::is_default_constructible_v<In1>) || (!inner2->identity && !std::is_default_constructible_v<In2>)) {
+			return;
+		}
+		if (inner1->itemType != nullptr && inner2->itemType != nullptr && *inner1->itemType != *inner2->itemType) {
+			return;
+		}
+		auto itemType = inner1->itemType != nullptr ? inner1->itemType : inner2->itemType;
+		lifted.batch = std::make_shared<const ProxyBatchKernel<R>>(ProxyBatchKernel<R>{itemType, false, [inner1, inner2, f = f](const void *items, size_t count, R *out) {
+			std::unique_ptr<In1[]> storage1;
+			std::unique_ptr<In2[]> storage2;
+			auto values1 = batchValues(*inner1, items, count, storage1);
+			auto values2 = batchValues(*inner2, items, count, storage2);
+			for (size_t i = 0; i < count; i++) {
+				In1 value1 = values1[i];
+				In2 value2 = values2[i];
+				out[i] = f(std::move(value1), std::move(value2));
+			}
+		}});
+	}
+}
+
+/** The kernel of p if it can evaluate a batch of items of type T, nullptr otherwise */
+template <typename T, typename R>
+std::shared_ptr<const ProxyBatchKernel<R>> batchKernelFor(const Proxy<R> &p) {
+	if (std::is_same_v<T, bool> || !p.batch) {
+		return nullptr;
+	}
+	if (p.batch->itemType != nullptr && *p.batch->itemType != typeid(T)) {
+		return nullptr;
+	}
+	return p.batch;
+}
+
+/** Input of the batch ranges, shared since copies of a range continue the same single pass over it */
+template <typename T>
+struct BatchSource {
+	RawIterator<T> rng;
+	ranges::iterator_t<RawIterator<T>> it;
+
+	explicit BatchSource(RawIterator<T> &&rng_) : rng(std::move(rng_)), it(ranges::begin(rng)) {}
+
+	/** Append up to proxyBatchSize of the next items */
+	void read(batch_items_t<T> &items) {
+		auto end = ranges::end(rng);
+		for (; it != end && items.size() < proxyBatchSize; ++it) {
+			items.push_back(*it);
+		}
+	}
+
+	bool done() {
+		return it == ranges::end(rng);
+	}
+};
+
+/** Lazily filters a sequence with a predicate kernel, evaluated for proxyBatchSize items at a time */
+template <typename T>
+class batch_filter_range : public ranges::view_facade<batch_filter_range<T>> {
+	friend ranges::range_access;
+
+	std::shared_ptr<BatchSource<T>> source;
+	std::shared_ptr<const ProxyBatchKernel<bool>> predicate;
+	std::vector<T> selected;
+	size_t pos = 0;
+
+	T read() const {
+		return selected[pos];
+	}
+
+	bool equal(ranges::default_sentinel_t) const {
+		return pos >= selected.size();
+	}
+
+	void next() {
+		if (++pos == selected.size()) {
+			fill();
+		}
+	}
+
+	void fill() {
+		selected.clear();
+		pos = 0;
+		batch_items_t<T> items;
+		items.reserve(proxyBatchSize);
+		std::unique_ptr<bool[]> storage;
+		while (selected.empty() && !source->done()) {
+			items.clear();
+			source->read(items);
+			auto keep = batchValues(*predicate, items.data(), items.size(), storage);
+			for (size_t i = 0; i < items.size(); i++) {
+				if (keep[i]) {
+					selected.push_back(std::move(items[i]));
+				}
+			}
+		}
+	}
+
+public:
+	batch_filter_range() = default;
+	batch_filter_range(RawIterator<T> &&rng, std::shared_ptr<const ProxyBatchKernel<bool>> predicate_) : source(std::make_shared<BatchSource<T>>(std::move(rng))), predicate(std::move(predicate_)) {
+		fill();
+	}
+};
+
+/** Lazily maps a sequence through a kernel, evaluated for proxyBatchSize items at a time */
+template <typename T, typename R>
+class batch_map_range : public ranges::view_facade<batch_map_range<T, R>> {
+	friend ranges::range_access;
+
+	std::shared_ptr<BatchSource<T>> source;
+	std::shared_ptr<const ProxyBatchKernel<R>> kernel;
+	std::vector<R> values;
+	size_t pos = 0;
+
+	R read() const {
+		return values[pos];
+	}
+
+	bool equal(ranges::default_sentinel_t) const {
+		return pos >= values.size();
+	}
+
+	void next() {
+		if (++pos == values.size()) {
+			fill();
+		}
+	}
+
+	void fill() {
+		values.clear();
+		pos = 0;
+		batch_items_t<T> items;
+		items.reserve(proxyBatchSize);
+		source->read(items);
+		std::unique_ptr<R[]> storage;
+		auto mapped = batchValues(*kernel, items.data(), items.size(), storage);
+		values.assign(mapped, mapped + items.size());
+	}
+
+public:
+	batch_map_range() = default;
+	batch_map_range(RawIterator<T> &&rng, std::shared_ptr<const ProxyBatchKernel<R>> kernel_) : source(std::make_shared<BatchSource<T>>(std::move(rng))), kernel(std::move(kernel_)) {
+		fill();
+	}
+};
+
+/** The values of the kernel for all items of a sized range, evaluated up front in batches of proxyBatchSize */
+template <typename T, typename R, typename Rng>
+std::shared_ptr<const std::vector<R>> batchMapAll(Rng &&rng, const ProxyBatchKernel<R> &kernel) {
+	auto values = std::make_shared<std::vector<R>>();
+	values->reserve(static_cast<size_t>(ranges::size(rng)));
+	batch_items_t<T> items;
+	items.reserve(proxyBatchSize);
+	std::unique_ptr<R[]> storage;
+	auto evaluate = [&]() {
+		auto mapped = batchValues(kernel, items.data(), items.size(), storage);
+		values->insert(values->end(), mapped, mapped + items.size());
+		items.clear();
+	};
+	for (auto && item : rng) {
+		items.push_back(std::forward<decltype(item)>(item));
+		if (items.size() == proxyBatchSize) {
+			evaluate();
+		}
+	}
+	if (!items.empty()) {
+		evaluate();
+	}
+	return values;
+}
+
+/** The first item whose key is best, with better(key, bestKey) deciding, evaluating proxyBatchSize keys at a time */
+template <typename T, typename Rng, typename Better>
+ranges::optional<T> batchSelect(Rng &&rng, const ProxyBatchKernel<int64_t> &key, Better better) {
+	ranges::optional<T> result;
+	int64_t bestKey = 0;
+	batch_items_t<T> items;
+	items.reserve(proxyBatchSize);
+	std::unique_ptr<int64_t[]> storage;
+	auto evaluate = [&]() {
+		auto keys = batchValues(key, items.data(), items.size(), storage);
+		for (size_t i = 0; i < items.size(); i++) {
+			if (!result || better(keys[i], bestKey)) {
+				result = std::move(items[i]);
+				bestKey = keys[i];
+			}
+		}
+		items.clear();
+	};
+	for (auto && item : rng) {
+		items.push_back(std::forward<decltype(item)>(item));
+		if (items.size() == proxyBatchSize) {
+			evaluate();
+		}
+	}
+	if (!items.empty()) {
+		evaluate();
+	}
+	return result;
+}
+
+#endif /* proxy_batch_hpp */
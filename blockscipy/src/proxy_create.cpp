@@ -37,6 +37,8 @@ Proxy<AnyScript> SimpleProxyCreator<AnyScript>::operator()() const {
 			return std::any_cast<Nonstandard>(t);
 		} else if (o == typeid(WitnessUnknown)) {
 			return std::any_cast<WitnessUnknown>(t);
+		} else if (o == typeid(WitnessTaproot)) {
+			return std::any_cast<WitnessTaproot>(t);
 		} else if (o == typeid(AnyScript)) {
 			return std::any_cast<AnyScript>(t);
 		} else {
@@ -9,15 +9,18 @@
 #define proxy_create_hpp
 
 #include "proxy.hpp"
+#include "proxy_batch.hpp"
 
 #include <blocksci/scripts/scripts_fwd.hpp>
 
 template <typename T>
 struct SimpleProxyCreator {
 	Proxy<T> operator()() const {
-		return {std::function<T(std::any &)>{[](std::any &t) -> T {
+		Proxy<T> proxy{std::function<T(std::any &)>{[](std::any &t) -> T {
 			return std::any_cast<T>(t);
 		}}, createProxyTypeInfo<T>()};
+		setIdentityBatch(proxy);
+		return proxy;
 	}
 };
 
@@ -0,0 +1,248 @@
+//
+//  proxy_pushdown.hpp
+//  blocksci_interface
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef proxy_pushdown_hpp
+#define proxy_pushdown_hpp
+
+#include "proxy.hpp"
+#include "proxy_batch.hpp"
+
+#include <blocksci/chain/chain_fwd.hpp>
+#include <blocksci/chain/column_filter.hpp>
+#include <blocksci/core/raw_address.hpp>
+#include <blocksci/scripts/script_variant.hpp>
+
+#include <range/v3/utility/optional.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+
+/** What a simple proxy is known to compute, so that a where over the txes or outputs of blocks can be answered from
+ * the columns and indexes of a ColumnFilter instead of loading every item
+ *
+ * Properties of the identity proxy that a ColumnFilter can check record the field they read and constants record
+ * their value. Comparing the two gives a predicate with a filter selecting exactly the items it is true for, & keeps
+ * the filters of both sides and | joins address equalities. Other proxies don't carry a pushdown.
+ */
+struct ProxyPushdown {
+	/** Type of the items the proxy reads, nullptr for constants */
+	const std::type_info *itemType = nullptr;
+
+	/** The proxy returns this column of its input */
+	ranges::optional<blocksci::ColumnFilter::Column> column;
+
+	/** The proxy returns the address of its input */
+	bool address = false;
+
+	/** The proxy ignores its input and returns this value */
+	ranges::optional<int64_t> constant;
+	ranges::optional<blocksci::RawAddress> constantAddress;
+
+	/** The predicate is true for the items selected by the filter */
+	ranges::optional<blocksci::ColumnFilter> filter;
+
+	/** The filter selects exactly the items the predicate is true for, otherwise a superset that has to be checked */
+	bool exact = true;
+};
+
+template <typename P, typename = void>
+struct has_pushdown : std::false_type {};
+
+template <typename P>
+struct has_pushdown<P, std::void_t<decltype(std::declval<P &>().pushdown)>> : std::true_type {};
+
+/** Field of the items of type T a property reads, if a ColumnFilter can check it */
+struct PushdownField {
+	ranges::optional<blocksci::ColumnFilter::Column> column;
+	bool address = false;
+};
+
+template <typename T>
+struct PushdownFields : std::false_type {
+	static ranges::optional<PushdownField> find(const std::string &) {
+		return ranges::nullopt;
+	}
+};
+
+template <>
+struct PushdownFields<blocksci::Transaction> : std::true_type {
+	static ranges::optional<PushdownField> find(const std::string &name) {
+		if (name == "fee") {
+			return PushdownField{blocksci::ColumnFilter::Column::TxFee, false};
+		} else if (name == "block_height") {
+			return PushdownField{blocksci::ColumnFilter::Column::Height, false};
+		}
+		return ranges::nullopt;
+	}
+};
+
+template <>
+struct PushdownFields<blocksci::Output> : std::true_type {
+	static ranges::optional<PushdownField> find(const std::string &name) {
+		if (name == "value") {
+			return PushdownField{blocksci::ColumnFilter::Column::OutputValue, false};
+		} else if (name == "address_type") {
+			return PushdownField{blocksci::ColumnFilter::Column::OutputAddressType, false};
+		} else if (name == "address") {
+			return PushdownField{ranges::nullopt, true};
+		}
+		return ranges::nullopt;
+	}
+};
+
+/** Record that lifted = p.field reads the field of its input, if p is the identity proxy of Out */
+template <typename Out, typename R, typename P>
+void setFieldPushdown(Proxy<R> &lifted, const P &p, const PushdownField &field) {
+	if constexpr (has_pushdown<Proxy<R>>::value && has_batch_kernel<P>::value) {
+		if (!p.batch || !p.batch->identity) {
+			return;
+		}
+		auto pushdown = std::make_shared<ProxyPushdown>();
+		pushdown->itemType = &typeid(Out);
+		pushdown->column = field.column;
+		pushdown->address = field.address;
+		lifted.pushdown = std::move(pushdown);
+	}
+}
+
+template <typename T>
+void setConstantPushdown(Proxy<T> &p, const T &val) {
+	if constexpr (has_pushdown<Proxy<T>>::value) {
+		auto pushdown = std::make_shared<ProxyPushdown>();
+		if constexpr (std::is_same_v<T, blocksci::AnyScript>) {
+			pushdown->constantAddress = blocksci::RawAddress{val.getScriptNum(), val.getType()};
+		} else if constexpr ((std::is_integral_v<T> && !std::is_same_v<T, bool>) || std::is_enum_v<T>) {
+			pushdown->constant = static_cast<int64_t>(val);
+		} else {
+			return;
+		}
+		p.pushdown = std::move(pushdown);
+	}
+}
+
+enum class PushdownComparison {
+	Less, LessEqual, Greater, GreaterEqual, Equal
+};
+
+/** Give result = p1 op p2 a filter if one side is a field and the other a constant */
+template <typename P>
+void comparePushdown(Proxy<bool> &result, const P &p1, const P &p2, PushdownComparison comparison) {
+	if constexpr (has_pushdown<P>::value) {
+		auto field = p1.pushdown;
+		auto constant = p2.pushdown;
+		if (field && constant && field->itemType == nullptr && constant->itemType != nullptr) {
+			std::swap(field, constant);
+			switch (comparison) {
+				case PushdownComparison::Less: comparison = PushdownComparison::Greater; break;
+				case PushdownComparison::LessEqual: comparison = PushdownComparison::GreaterEqual; break;
+				case PushdownComparison::Greater: comparison = PushdownComparison::Less; break;
+				case PushdownComparison::GreaterEqual: comparison = PushdownComparison::LessEqual; break;
+				case PushdownComparison::Equal: break;
+			}
+		}
+		if (!field || !constant || field->itemType == nullptr || constant->itemType != nullptr) {
+			return;
+		}
+
+		blocksci::ColumnFilter filter;
+		if (field->address) {
+			if (comparison != PushdownComparison::Equal || !constant->constantAddress) {
+				return;
+			}
+			filter.addresses = std::vector<blocksci::RawAddress>{*constant->constantAddress};
+		} else if (field->column && constant->constant) {
+			auto value = *constant->constant;
+			blocksci::ColumnFilter::Bound bound{*field->column};
+			switch (comparison) {
+				case PushdownComparison::Less:
+					if (value == std::numeric_limits<int64_t>::min()) {
+						return;
+					}
+					bound.max = value - 1;
+					break;
+				case PushdownComparison::LessEqual:
+					bound.max = value;
+					break;
+				case PushdownComparison::Greater:
+					if (value == std::numeric_limits<int64_t>::max()) {
+						return;
+					}
+					bound.min = value + 1;
+					break;
+				case PushdownComparison::GreaterEqual:
+					bound.min = value;
+					break;
+				case PushdownComparison::Equal:
+					bound.min = value;
+					bound.max = value;
+					break;
+			}
+			filter.bounds.push_back(bound);
+		} else {
+			return;
+		}
+
+		auto pushdown = std::make_shared<ProxyPushdown>();
+		pushdown->itemType = field->itemType;
+		pushdown->filter = std::move(filter);
+		result.pushdown = std::move(pushdown);
+	}
+}
+
+/** Give result = p1 & p2 the filters of both sides, a predicate without one only makes the filter inexact */
+inline void conjoinPushdown(Proxy<bool> &result, const Proxy<bool> &p1, const Proxy<bool> &p2) {
+	auto a = p1.pushdown && p1.pushdown->filter ? p1.pushdown : nullptr;
+	auto b = p2.pushdown && p2.pushdown->filter ? p2.pushdown : nullptr;
+	if (!a && !b) {
+		return;
+	}
+	auto pushdown = std::make_shared<ProxyPushdown>(a ? *a : *b);
+	if (!a || !b) {
+		pushdown->exact = false;
+	} else {
+		if (*a->itemType != *b->itemType) {
+			return;
+		}
+		auto &filter = *pushdown->filter;
+		auto &other = *b->filter;
+		filter.bounds.insert(filter.bounds.end(), other.bounds.begin(), other.bounds.end());
+		if (filter.addresses && other.addresses) {
+			std::vector<blocksci::RawAddress> both;
+			for (auto &address : *filter.addresses) {
+				if (std::find(other.addresses->begin(), other.addresses->end(), address) != other.addresses->end()) {
+					both.push_back(address);
+				}
+			}
+			filter.addresses = std::move(both);
+		} else if (other.addresses) {
+			filter.addresses = other.addresses;
+		}
+		pushdown->exact = a->exact && b->exact;
+	}
+	result.pushdown = std::move(pushdown);
+}
+
+/** Give result = p1 | p2 a filter if both sides select exactly the outputs of some addresses */
+inline void disjoinPushdown(Proxy<bool> &result, const Proxy<bool> &p1, const Proxy<bool> &p2) {
+	auto isAddressFilter = [](const std::shared_ptr<const ProxyPushdown> &pushdown) {
+		return pushdown && pushdown->filter && pushdown->exact && pushdown->filter->addresses && pushdown->filter->bounds.empty();
+	};
+	if (!isAddressFilter(p1.pushdown) || !isAddressFilter(p2.pushdown) || *p1.pushdown->itemType != *p2.pushdown->itemType) {
+		return;
+	}
+	auto pushdown = std::make_shared<ProxyPushdown>(*p1.pushdown);
+	auto &addresses = *pushdown->filter->addresses;
+	auto &other = *p2.pushdown->filter->addresses;
+	addresses.insert(addresses.end(), other.begin(), other.end());
+	result.pushdown = std::move(pushdown);
+}
+
+#endif /* proxy_pushdown_hpp */
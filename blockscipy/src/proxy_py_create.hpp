@@ -9,6 +9,8 @@
 #define proxy_py_create_hpp
 
 #include "proxy.hpp"
+#include "proxy_batch.hpp"
+#include "proxy_pushdown.hpp"
 #include "proxy_type_check.hpp"
 #include "method_types.hpp"
 
@@ -34,9 +36,12 @@ AllProxyClasses<T, SimpleBase> createProxyClasses(pybind11::module &m) {
     pybind11::class_<Proxy<RawRange<T>>, RangeProxy, SequenceProxy<T>> range(m, strdup(proxyName<Range<T>>().c_str()), pybind11::dynamic_attr());
 
     base.def(pybind11::init([](const T &val) -> Proxy<T> {
-        return {std::function<T(std::any &)>{[val](std::any &) -> T {
+        Proxy<T> proxy{std::function<T(std::any &)>{[val](std::any &) -> T {
             return val;
         }}, {nullptr, nullptr, ProxyType::Simple}};
+        setConstantBatch(proxy, val);
+        setConstantPushdown(proxy, val);
+        return proxy;
     }));
 
     iterator
@@ -36,7 +36,8 @@ namespace {
 			type == typeid(script::WitnessScriptHash) ||
 			type == typeid(script::OpReturn) ||
 			type == typeid(script::Nonstandard) ||
-			type == typeid(script::WitnessUnknown);
+			type == typeid(script::WitnessUnknown) ||
+			type == typeid(script::WitnessTaproot);
 	}
 }
 
@@ -9,25 +9,30 @@
 #define proxy_utils_hpp
 
 #include "proxy.hpp"
+#include "proxy_batch.hpp"
 #include "proxy_type_check.hpp"
 
 template <typename P1, typename P2, typename F>
 auto lift(P1 && p1, P2 && p2, F && f) -> Proxy<decltype(f(p1(std::declval<std::any &>()), p2(std::declval<std::any &>())))> {
 	p1.getSourceType().checkMatch(p2.getSourceType());
-	return {std::function<decltype(f(p1(std::declval<std::any &>()), p2(std::declval<std::any &>())))(std::any &)>{
+	Proxy<decltype(f(p1(std::declval<std::any &>()), p2(std::declval<std::any &>())))> lifted{std::function<decltype(f(p1(std::declval<std::any &>()), p2(std::declval<std::any &>())))(std::any &)>{
 		[p1, p2, f=f](std::any &v) {
 			return f(p1(v), p2(v));
 		}
 	}, p1.getSourceType()};
+	liftBatch(lifted, p1, p2, f);
+	return lifted;
 }
 
 template <typename P, typename F>
 auto lift(P && p, F && f) -> Proxy<decltype(f(p(std::declval<std::any &>())))> {
-	return {std::function<decltype(f(p(std::declval<std::any &>())))(std::any &)>{
+	Proxy<decltype(f(p(std::declval<std::any &>())))> lifted{std::function<decltype(f(p(std::declval<std::any &>())))(std::any &)>{
 		[p, f=f](std::any &v) {
 			return f(p(v));
 		}
 	}, p.getSourceType()};
+	liftBatch(lifted, p, f);
+	return lifted;
 }
 
 template <typename P, typename F>
@@ -32,6 +32,7 @@
 #include "scripts/nulldata/nulldata_py.hpp"
 #include "scripts/nonstandard/nonstandard_py.hpp"
 #include "scripts/witness_unknown/witness_unknown_py.hpp"
+#include "scripts/witness_taproot/witness_taproot_py.hpp"
 
 #include <blocksci/chain/blockchain.hpp>
 #include <blocksci/cluster/cluster.hpp>
@@ -45,6 +46,11 @@ using namespace blocksci;
 
 void init_blockchain(py::module &m);
 void init_heuristics(py::module &m);
+void init_sketches(py::module &m);
+void init_tx_sets(py::module &m);
+void init_graph_export(py::module &m);
+void init_column_abi(py::module &m);
+void init_hex_codec(py::module &m);
 
 template <typename Class>
 void addSelfProxy(Class &cl) {
@@ -97,6 +103,7 @@ PYBIND11_MODULE(_blocksci, m) {
     py::class_<script::Nonstandard> nonstandardCl(m, "NonStandardAddress", addressCl, "Extra data about non-standard address");
     py::class_<script::OpReturn> opReturnCl(m, "OpReturn", addressCl, "Extra data about op_return address");
     py::class_<script::WitnessUnknown> witnessUnknownCl(m, "WitnessUnknownAddress", addressCl, "Data about an unknown witness address");
+    py::class_<script::WitnessTaproot> witnessTaprootCl(m, "WitnessTaprootAddress", addressCl, "Extra data about pay to taproot address");
 
     py::class_<std::any> anyCl(m, "Any", "A generic class representing a BlockSci type");
 
@@ -127,6 +134,7 @@ PYBIND11_MODULE(_blocksci, m) {
     RangeClasses<script::OpReturn> nulldataRangeCls(createAddressRangeClasses<script::OpReturn>(m));
     RangeClasses<script::Nonstandard> nonstandardRangeCls(createAddressRangeClasses<script::Nonstandard>(m));
     RangeClasses<script::WitnessUnknown> witnessUnknownRangeCls(createAddressRangeClasses<script::WitnessUnknown>(m));
+    RangeClasses<script::WitnessTaproot> witnessTaprootRangeCls(createAddressRangeClasses<script::WitnessTaproot>(m));
     
     RangeClasses<Cluster> clusterRangeCls(createRangeClasses<Cluster>(clusterMod));
     RangeClasses<TaggedCluster> taggedClusterRangeCls(createRangeClasses<TaggedCluster>(clusterMod));
@@ -144,6 +152,7 @@ PYBIND11_MODULE(_blocksci, m) {
     addAnyInit<script::OpReturn>(anyCl);
     addAnyInit<script::Nonstandard>(anyCl);
     addAnyInit<script::WitnessUnknown>(anyCl);
+    addAnyInit<script::WitnessTaproot>(anyCl);
 
     addAnyInit<Block>(anyCl);
     addAnyInit<Transaction>(anyCl);
@@ -182,6 +191,11 @@ PYBIND11_MODULE(_blocksci, m) {
 
     init_address_type(m);
     init_heuristics(m);
+    init_sketches(m);
+    init_tx_sets(m);
+    init_graph_export(m);
+    init_column_abi(m);
+    init_hex_codec(m);
     init_data_access(m);
     init_blockchain(blockchainCl);
     init_uint160(uint160Cl);
@@ -250,6 +264,10 @@ PYBIND11_MODULE(_blocksci, m) {
             init_witness_unknown(witnessUnknownCl);
             addWitnessUnknownRangeMethods(witnessUnknownRangeCls);
         }
+        {
+            init_witness_taproot(witnessTaprootCl);
+            addWitnessTaprootRangeMethods(witnessTaprootRangeCls);
+        }
     }
     {
         init_cluster_manager(clusterMod);
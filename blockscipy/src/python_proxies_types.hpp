@@ -40,6 +40,7 @@ struct ScriptProxies {
     AllProxyClasses<blocksci::script::OpReturn, ProxyAddress> nulldata;
     AllProxyClasses<blocksci::script::Nonstandard, ProxyAddress> nonstandard;
     AllProxyClasses<blocksci::script::WitnessUnknown, ProxyAddress> witnessUnknown;
+    AllProxyClasses<blocksci::script::WitnessTaproot, ProxyAddress> witnessTaproot;
 
     ScriptProxies(pybind11::module &m);
 };
@@ -22,6 +22,7 @@
 #include "scripts/nulldata/nulldata_proxy_py.hpp"
 #include "scripts/nonstandard/nonstandard_proxy_py.hpp"
 #include "scripts/witness_unknown/witness_unknown_proxy_py.hpp"
+#include "scripts/witness_taproot/witness_taproot_proxy_py.hpp"
 
 #include <blocksci/chain/block.hpp>
 
@@ -40,7 +41,8 @@ scripthash(createProxyClasses<script::ScriptHash, ProxyAddress>(m)),
 witnessScripthash(createProxyClasses<script::WitnessScriptHash, ProxyAddress>(m)),
 nulldata(createProxyClasses<script::OpReturn, ProxyAddress>(m)),
 nonstandard(createProxyClasses<script::Nonstandard, ProxyAddress>(m)),
-witnessUnknown(createProxyClasses<script::WitnessUnknown, ProxyAddress>(m)) {}
+witnessUnknown(createProxyClasses<script::WitnessUnknown, ProxyAddress>(m)),
+witnessTaproot(createProxyClasses<script::WitnessTaproot, ProxyAddress>(m)) {}
 
 void setupScriptProxies(ScriptProxies &proxies) {
     init_proxy_address(proxies.genericAddress);
@@ -55,4 +57,5 @@ void setupScriptProxies(ScriptProxies &proxies) {
     addNonstandardProxyMethods(proxies.nonstandard);
     addNulldataProxyMethods(proxies.nulldata);
     addWitnessUnknownProxyMethods(proxies.witnessUnknown);
+    addWitnessTaprootProxyMethods(proxies.witnessTaproot);
 }
\ No newline at end of file
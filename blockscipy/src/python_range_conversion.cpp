@@ -11,6 +11,7 @@
 
 #include <blocksci/chain/block.hpp>
 #include <blocksci/core/bitcoin_uint256.hpp>
+#include <blocksci/core/hex_codec.hpp>
 #include <blocksci/address/equiv_address.hpp>
 #include <blocksci/scripts/script_variant.hpp>
 #include <blocksci/cluster/cluster.hpp>
@@ -22,6 +23,7 @@
 #include <range/v3/algorithm/copy.hpp>
 
 #include <chrono>
+#include <vector>
 
 using namespace blocksci;
 namespace py = pybind11;
@@ -37,20 +39,6 @@ struct NumpyConverter {
         return {std::chrono::duration_cast<std::chrono::nanoseconds>(val.time_since_epoch()).count()};
     }
 
-    std::array<char, 64> operator()(const blocksci::uint256 &val) {
-        auto hexStr = val.GetHex();
-        std::array<char, 64> ret;
-        std::copy_n(hexStr.begin(), 64, ret.begin());
-        return ret;
-    }
-
-    std::array<char, 40> operator()(const blocksci::uint160 &val) {
-        auto hexStr = val.GetHex();
-        std::array<char, 40> ret;
-        std::copy_n(hexStr.begin(), 40, ret.begin());
-        return ret;
-    }
-
     NumpyBool operator()(const bool &val) {
         return {val};
     }
@@ -63,17 +51,79 @@ convertRandomSizedNumpy(T && t) {
     auto rangeSize = static_cast<size_t>(ranges::size(numpy_converted));
     pybind11::array_t<ranges::range_value_type_t<decltype(numpy_converted)>> ret{rangeSize};
     auto retPtr = ret.mutable_data();
-    ranges::copy(numpy_converted, retPtr);
+    {
+        // Ranges of numeric values are computed without touching Python objects
+        py::gil_scoped_release release;
+        ranges::copy(numpy_converted, retPtr);
+    }
     return ret;
 }
 
 template <typename T>
 pybind11::array_t<decltype(NumpyConverter{}(std::declval<ranges::range_value_type_t<T>>()))>
 convertInputNumpy(T && t) {
-    auto ret = ranges::to_vector(ranges::views::transform(std::move(t), NumpyConverter{}));
+    std::vector<decltype(NumpyConverter{}(std::declval<ranges::range_value_type_t<T>>()))> ret;
+    {
+        py::gil_scoped_release release;
+        ret = ranges::to_vector(ranges::views::transform(std::move(t), NumpyConverter{}));
+    }
     return pybind11::array_t<typename decltype(ret)::value_type>{ret.size(), ret.data()};
 }
 
+/** Hashes are converted to hex in chunks by encodeHexBatch rather than one GetHex string at a time */
+constexpr size_t hexChunkSize = 4096;
+
+template <typename Hash>
+using HexArray = std::array<char, 2 * sizeof(Hash)>;
+
+template <typename Hash>
+void encodeHexChunk(std::vector<Hash> &chunk, char *out) {
+    static_assert(sizeof(Hash) == Hash::WIDTH, "Hashes are stored as plain bytes");
+    encodeHexBatch(reinterpret_cast<const unsigned char *>(chunk.data()), sizeof(Hash), chunk.size(), out);
+}
+
+template <typename T>
+pybind11::array_t<HexArray<ranges::range_value_type_t<T>>>
+convertRandomSizedHexNumpy(T && t) {
+    using Hash = ranges::range_value_type_t<T>;
+    auto rangeSize = static_cast<size_t>(ranges::size(t));
+    pybind11::array_t<HexArray<Hash>> ret{rangeSize};
+    auto retPtr = reinterpret_cast<char *>(ret.mutable_data());
+    {
+        py::gil_scoped_release release;
+        std::vector<Hash> chunk;
+        chunk.reserve(hexChunkSize);
+        RANGES_FOR(auto && hash, t) {
+            chunk.push_back(hash);
+            if (chunk.size() == hexChunkSize) {
+                encodeHexChunk(chunk, retPtr);
+                retPtr += sizeof(HexArray<Hash>) * chunk.size();
+                chunk.clear();
+            }
+        }
+        encodeHexChunk(chunk, retPtr);
+    }
+    return ret;
+}
+
+template <typename T>
+pybind11::array_t<HexArray<ranges::range_value_type_t<T>>>
+convertInputHexNumpy(T && t) {
+    using Hash = ranges::range_value_type_t<T>;
+    std::vector<Hash> hashes;
+    {
+        py::gil_scoped_release release;
+        hashes = ranges::to_vector(std::move(t));
+    }
+    pybind11::array_t<HexArray<Hash>> ret{hashes.size()};
+    auto retPtr = reinterpret_cast<char *>(ret.mutable_data());
+    {
+        py::gil_scoped_release release;
+        encodeHexChunk(hashes, retPtr);
+    }
+    return ret;
+}
+
 template <typename T>
 py::list convertRandomSizedPy(T && t) {
     auto rangeSize = static_cast<size_t>(ranges::size(t));
@@ -129,8 +179,8 @@ pybind11::array_t<int16_t> PythonConversionTypeConverter::operator()(RawIterator
 pybind11::array_t<uint16_t> PythonConversionTypeConverter::operator()(RawIterator<uint16_t> && t) { return convertInputNumpy(std::move(t)); }
 pybind11::array_t<NumpyBool> PythonConversionTypeConverter::operator()(RawIterator<bool> && t) { return convertInputNumpy(std::move(t)); }
 pybind11::array_t<NumpyDatetime> PythonConversionTypeConverter::operator()(RawIterator<std::chrono::system_clock::time_point> && t) { return convertInputNumpy(std::move(t)); }
-pybind11::array_t<std::array<char, 40>> PythonConversionTypeConverter::operator()(RawIterator<uint160> && t) { return convertInputNumpy(std::move(t)); }
-pybind11::array_t<std::array<char, 64>> PythonConversionTypeConverter::operator()(RawIterator<uint256> && t) { return convertInputNumpy(std::move(t)); }
+pybind11::array_t<std::array<char, 40>> PythonConversionTypeConverter::operator()(RawIterator<uint160> && t) { return convertInputHexNumpy(std::move(t)); }
+pybind11::array_t<std::array<char, 64>> PythonConversionTypeConverter::operator()(RawIterator<uint256> && t) { return convertInputHexNumpy(std::move(t)); }
 
 pybind11::array_t<int64_t> PythonConversionTypeConverter::operator()(RawRange<int64_t> && t) { return convertRandomSizedNumpy(std::move(t)); }
 pybind11::array_t<uint64_t> PythonConversionTypeConverter::operator()(RawRange<uint64_t> && t) { return convertRandomSizedNumpy(std::move(t)); }
@@ -140,5 +190,5 @@ pybind11::array_t<int16_t> PythonConversionTypeConverter::operator()(RawRange<in
 pybind11::array_t<uint16_t> PythonConversionTypeConverter::operator()(RawRange<uint16_t> && t) { return convertRandomSizedNumpy(std::move(t)); }
 pybind11::array_t<NumpyBool> PythonConversionTypeConverter::operator()(RawRange<bool> && t) { return convertRandomSizedNumpy(std::move(t)); }
 pybind11::array_t<NumpyDatetime> PythonConversionTypeConverter::operator()(RawRange<std::chrono::system_clock::time_point> && t) { return convertInputNumpy(std::move(t)); }
-pybind11::array_t<std::array<char, 40>> PythonConversionTypeConverter::operator()(RawRange<uint160> && t) { return convertRandomSizedNumpy(std::move(t)); }
-pybind11::array_t<std::array<char, 64>> PythonConversionTypeConverter::operator()(RawRange<uint256> && t) { return convertRandomSizedNumpy(std::move(t)); }
+pybind11::array_t<std::array<char, 40>> PythonConversionTypeConverter::operator()(RawRange<uint160> && t) { return convertRandomSizedHexNumpy(std::move(t)); }
+pybind11::array_t<std::array<char, 64>> PythonConversionTypeConverter::operator()(RawRange<uint256> && t) { return convertRandomSizedHexNumpy(std::move(t)); }
@@ -16,6 +16,7 @@
 #include "proxy/range.hpp"
 #include "caster_py.hpp"
 
+#include <blocksci/address/address_stats.hpp>
 #include <blocksci/address/equiv_address.hpp>
 #include <blocksci/chain/block.hpp>
 #include <blocksci/cluster/cluster.hpp>
@@ -54,7 +55,7 @@ struct AddAddressMethods {
             return static_cast<int64_t>(address.getType());
         }, "The type of address");
         func(method_tag, "equiv", &AnyScript::getEquivAddresses, "Returns a list of all addresses equivalent to this address", pybind11::arg("equiv_script") = true);
-        func(method_tag, "balance", &AnyScript::calculateBalance, "Calculates the balance held by this address at the height (Defaults to the full chain)", pybind11::arg("height") = -1);
+        func(method_tag, "balance", &AnyScript::calculateBalance, "Calculates the balance held by this address at the height (Defaults to the full chain)", pybind11::arg("height") = -1, pybind11::call_guard<pybind11::gil_scoped_release>());
 
         func(method_tag, "out_txes_count", +[](AnyScript &address) -> int64_t {
             pybind11::print("Warning: `out_txes_count` is deprecated. Use `output_txes_count` instead.");
@@ -76,6 +77,25 @@ struct AddAddressMethods {
         func(property_tag, "revealed_tx", &AnyScript::getTransactionRevealed, "The transaction where a type equivalent address was first revealed");
         func(property_tag, "has_been_spent", &AnyScript::hasBeenSpent, "Check if a type equivalent address has ever been spent");
 
+        func(property_tag, "received_value", +[](AnyScript &address) -> int64_t {
+            return address.getStats().received;
+        }, "Total value ever sent to this address, read from the precomputed address stats");
+        func(property_tag, "sent_value", +[](AnyScript &address) -> int64_t {
+            return address.getStats().sent;
+        }, "Total value ever spent from this address, read from the precomputed address stats");
+        func(property_tag, "stats_balance", +[](AnyScript &address) -> int64_t {
+            return address.getStats().balance();
+        }, "The balance of this address at the end of the chain covered by the precomputed address stats");
+        func(property_tag, "output_count", +[](AnyScript &address) -> int64_t {
+            return address.getStats().outputCount;
+        }, "The number of outputs sent to this address, read from the precomputed address stats");
+        func(property_tag, "first_seen_height", +[](AnyScript &address) -> int64_t {
+            return address.getStats().firstSeenHeight;
+        }, "Height of the block containing the first output sent to this address, read from the precomputed address stats");
+        func(property_tag, "last_seen_height", +[](AnyScript &address) -> int64_t {
+            return address.getStats().lastSeenHeight;
+        }, "Height of the last block sending to or spending from this address, read from the precomputed address stats");
+
         func(property_tag, "outs", +[](AnyScript &address) -> RawIterator<Output> {
             pybind11::print("Warning: `outs` is deprecated. Use `outputs` instead.");
             return address.getOutputs();
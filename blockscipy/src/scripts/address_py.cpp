@@ -36,12 +36,13 @@ void init_address_type(py::module &m) {
     .value("witness_pubkeyhash", AddressType::Enum::WITNESS_PUBKEYHASH)
     .value("witness_scripthash", AddressType::Enum::WITNESS_SCRIPTHASH)
     .value("witness_unknown", AddressType::Enum::WITNESS_UNKNOWN)
-    .def_property_readonly_static("types", [](py::object) -> std::array<AddressType::Enum, 10> {
+    .value("witness_taproot", AddressType::Enum::WITNESS_TAPROOT)
+    .def_property_readonly_static("types", [](py::object) -> std::array<AddressType::Enum, 11> {
         return {{AddressType::Enum::NONSTANDARD, AddressType::Enum::PUBKEY, AddressType::Enum::PUBKEYHASH, 
             AddressType::Enum::MULTISIG_PUBKEY, AddressType::Enum::SCRIPTHASH,
             AddressType::Enum::MULTISIG, AddressType::Enum::NULL_DATA,
             AddressType::Enum::WITNESS_PUBKEYHASH, AddressType::Enum::WITNESS_SCRIPTHASH,
-            AddressType::Enum::WITNESS_UNKNOWN}};
+            AddressType::Enum::WITNESS_UNKNOWN, AddressType::Enum::WITNESS_TAPROOT}};
         }, "A list of all possible address types")
     .def("__str__", [](AddressType::Enum val) {
         switch (val) {
@@ -65,6 +66,8 @@ void init_address_type(py::module &m) {
                 return "Pay to witness script hash";
             case AddressType::Enum::WITNESS_UNKNOWN:
                 return "Pay to witness unknown";
+            case AddressType::Enum::WITNESS_TAPROOT:
+                return "Pay to taproot";
             default:
                 return "Unknown Address Type";
         }
@@ -27,7 +27,7 @@ struct AddEquivAddressMethods {
         using namespace blocksci;
         namespace py = pybind11;
         func(property_tag, "is_script_equiv", &EquivAddress::isScriptEquiv, "Returns whether this equiv address is script equivalent or not");
-        func(method_tag, "balance", &EquivAddress::calculateBalance, "Calculates the balance held by these equivalent addresses at the height (Defaults to the full chain)", py::arg("height") = -1);
+        func(method_tag, "balance", &EquivAddress::calculateBalance, "Calculates the balance held by these equivalent addresses at the height (Defaults to the full chain)", py::arg("height") = -1, py::call_guard<py::gil_scoped_release>());
         func(property_tag, "addresses", +[](const EquivAddress &address) -> RawIterator<AnyScript> {
             return ranges::views::ints(0, 1) | ranges::views::transform([address](int) {
                 return address | ranges::views::transform([](const Address &address) {
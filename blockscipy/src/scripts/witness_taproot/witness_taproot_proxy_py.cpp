@@ -0,0 +1,46 @@
+//
+//  witness_taproot_proxy_py.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+//
+
+#include "witness_taproot_proxy_py.hpp"
+#include "witness_taproot_py.hpp"
+#include "scripts/address_py.hpp"
+#include "proxy_apply_py.hpp"
+#include "proxy/basic.hpp"
+#include "proxy/equality.hpp"
+#include "proxy/optional.hpp"
+#include "proxy/range.hpp"
+
+#include <blocksci/chain/block.hpp>
+#include <blocksci/cluster/cluster.hpp>
+#include <blocksci/scripts/witness_taproot_script.hpp>
+
+using namespace blocksci;
+namespace py = pybind11;
+
+struct AddWitnessTaprootMethods {
+    template <typename FuncApplication>
+    void operator()(FuncApplication func) {
+        func(property_tag, "raw_address", &script::WitnessTaproot::getOutputKey, "The 256 bit x-only output key");
+        func(property_tag, "address_string", &script::WitnessTaproot::addressString, "Bitcoin address string");
+        func(property_tag, "key_path_spent", +[](const script::WitnessTaproot &script) -> bool {
+            return script.getSpendType() == TaprootSpendType::KeyPath;
+        }, "Whether the address was first spent through the key path with a single signature");
+        func(property_tag, "script_path_spent", +[](const script::WitnessTaproot &script) -> bool {
+            return script.getSpendType() == TaprootSpendType::ScriptPath;
+        }, "Whether the address was first spent through the script path by revealing a leaf script");
+    }
+};
+
+void addWitnessTaprootProxyMethods(AllProxyClasses<script::WitnessTaproot, ProxyAddress> &cls) {
+	cls.applyToAll(AddProxyMethods{});
+    setupRangesProxy(cls);
+    addProxyOptionalMethods(cls.optional);
+
+	applyMethodsToProxy(cls.base, AddWitnessTaprootMethods{});
+    addProxyEqualityMethods(cls.base);
+}
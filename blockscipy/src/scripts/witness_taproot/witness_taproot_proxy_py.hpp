@@ -0,0 +1,17 @@
+//
+//  witness_taproot_proxy_py.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef witness_taproot_proxy_py_h
+#define witness_taproot_proxy_py_h
+
+#include "python_fwd.hpp"
+
+#include <blocksci/scripts/scripts_fwd.hpp>
+
+void addWitnessTaprootProxyMethods(AllProxyClasses<blocksci::script::WitnessTaproot, ProxyAddress> &cls);
+
+#endif /* witness_taproot_proxy_py_h */
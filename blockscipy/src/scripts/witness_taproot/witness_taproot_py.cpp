@@ -0,0 +1,27 @@
+//
+//  witness_taproot_py.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+//
+
+#include "witness_taproot_py.hpp"
+#include "caster_py.hpp"
+#include "ranges_py.hpp"
+
+#include <blocksci/scripts/witness_taproot_script.hpp>
+
+using namespace blocksci;
+namespace py = pybind11;
+
+void init_witness_taproot(py::class_<script::WitnessTaproot> &cl) {
+    cl
+    .def("__repr__", &script::WitnessTaproot::toString)
+    .def("__str__", &script::WitnessTaproot::toPrettyString)
+    ;
+}
+
+void addWitnessTaprootRangeMethods(RangeClasses<script::WitnessTaproot> &classes) {
+	addAllRangeMethods(classes);
+}
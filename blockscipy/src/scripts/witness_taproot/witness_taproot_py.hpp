@@ -0,0 +1,21 @@
+//
+//  witness_taproot_py.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+//
+
+#ifndef blocksci_witness_taproot_py_h
+#define blocksci_witness_taproot_py_h
+
+#include "python_fwd.hpp"
+
+#include <blocksci/scripts/scripts_fwd.hpp>
+
+#include <pybind11/pybind11.h>
+
+void init_witness_taproot(pybind11::class_<blocksci::script::WitnessTaproot> &cl);
+void addWitnessTaprootRangeMethods(RangeClasses<blocksci::script::WitnessTaproot> &classes);
+
+#endif /* blocksci_witness_taproot_py_h */
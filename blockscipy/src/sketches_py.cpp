@@ -0,0 +1,126 @@
+//
+//  sketches_py.cpp
+//  blocksci_interface
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include <blocksci/chain/blockchain.hpp>
+#include <blocksci/chain/sketches.hpp>
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+namespace py = pybind11;
+using namespace blocksci;
+
+namespace {
+    BlockRange blockRange(Blockchain &chain, BlockHeight start, BlockHeight stop) {
+        if (stop < 0) {
+            stop = chain.size();
+        }
+        return chain[{start, stop}];
+    }
+
+    /** Pickles a sketch as its serialized bytes, so sketches can be returned from other processes */
+    template <typename Sketch>
+    auto sketchPickle() {
+        return py::pickle(
+            [](const Sketch &sketch) {
+                return py::make_tuple(py::bytes(sketch.serialize()));
+            },
+            [](py::tuple t) {
+                if (t.size() != 1) {
+                    throw std::runtime_error("Invalid state!");
+                }
+                return Sketch::deserialize(t[0].cast<std::string>());
+            }
+        );
+    }
+}
+
+void init_sketches(py::module &m) {
+    py::class_<HyperLogLog>(m, "HyperLogLog", "Sketch estimating the number of distinct integers added to it with bounded memory (2^precision bytes)")
+    .def(py::init<uint8_t>(), py::arg("precision") = 14)
+    .def(sketchPickle<HyperLogLog>())
+    .def_property_readonly("precision", &HyperLogLog::getPrecision)
+    .def("add", &HyperLogLog::add, py::arg("key"), "Add an integer key")
+    .def("add_many", [](HyperLogLog &sketch, py::array_t<uint64_t, py::array::c_style | py::array::forcecast> keys) {
+        auto data = keys.data();
+        for (py::ssize_t i = 0; i < keys.size(); i++) {
+            sketch.add(data[i]);
+        }
+    }, py::arg("keys"), "Add all keys of a numpy array")
+    .def("merge", &HyperLogLog::merge, py::arg("other"), "Add all keys of the other sketch")
+    .def("estimate", &HyperLogLog::estimate, "Estimated number of distinct keys added")
+    .def("__len__", [](const HyperLogLog &sketch) { return static_cast<size_t>(std::llround(sketch.estimate())); })
+    ;
+
+    py::class_<CountMinSketch>(m, "CountMinSketch", "Sketch estimating how often each integer was added to it, never underestimating")
+    .def(py::init<uint32_t, uint32_t>(), py::arg("width") = 2048, py::arg("depth") = 4)
+    .def(sketchPickle<CountMinSketch>())
+    .def_property_readonly("width", &CountMinSketch::getWidth)
+    .def_property_readonly("depth", &CountMinSketch::getDepth)
+    .def_property_readonly("total_count", &CountMinSketch::totalCount, "Sum of all counts added")
+    .def("add", &CountMinSketch::add, py::arg("key"), py::arg("count") = 1, "Add count occurrences of an integer key")
+    .def("add_many", [](CountMinSketch &sketch, py::array_t<uint64_t, py::array::c_style | py::array::forcecast> keys) {
+        auto data = keys.data();
+        for (py::ssize_t i = 0; i < keys.size(); i++) {
+            sketch.add(data[i]);
+        }
+    }, py::arg("keys"), "Add one occurrence of every key of a numpy array")
+    .def("merge", &CountMinSketch::merge, py::arg("other"), "Add all counts of the other sketch")
+    .def("estimate", &CountMinSketch::estimate, py::arg("key"), "Estimated number of occurrences of the key")
+    ;
+
+    py::class_<QuantileSketch>(m, "QuantileSketch", "Sketch estimating quantiles of the numbers added to it with bounded memory (KLL)")
+    .def(py::init<uint16_t>(), py::arg("k") = 200)
+    .def(sketchPickle<QuantileSketch>())
+    .def_property_readonly("k", &QuantileSketch::getK)
+    .def_property_readonly("min", &QuantileSketch::min)
+    .def_property_readonly("max", &QuantileSketch::max)
+    .def("__len__", &QuantileSketch::size)
+    .def("add", &QuantileSketch::add, py::arg("value"), "Add a number")
+    .def("add_many", [](QuantileSketch &sketch, py::array_t<double, py::array::c_style | py::array::forcecast> values) {
+        auto data = values.data();
+        for (py::ssize_t i = 0; i < values.size(); i++) {
+            sketch.add(data[i]);
+        }
+    }, py::arg("values"), "Add all numbers of a numpy array")
+    .def("merge", &QuantileSketch::merge, py::arg("other"), "Add all numbers of the other sketch")
+    .def("quantile", &QuantileSketch::quantile, py::arg("fraction"), "Estimated value at the given fraction of the sorted numbers")
+    .def("quantiles", &QuantileSketch::quantiles, py::arg("fractions"), "Estimated values at each of the given fractions")
+    .def("rank", &QuantileSketch::rank, py::arg("value"), "Estimated fraction of the numbers less than or equal to value")
+    .def("histogram", [](const QuantileSketch &sketch, const std::vector<double> &splitPoints) {
+        auto buckets = sketch.histogram(splitPoints);
+        py::array_t<uint64_t> ret{buckets.size()};
+        std::copy(buckets.begin(), buckets.end(), ret.mutable_data());
+        return ret;
+    }, py::arg("split_points"), "Estimated number of values below split_points[0], between each pair of consecutive split points and at or above the last one")
+    ;
+
+    m.def("approximate_distinct_addresses", [](Blockchain &chain, BlockHeight start, BlockHeight stop, uint8_t precision) {
+        auto blocks = blockRange(chain, start, stop);
+        py::gil_scoped_release release;
+        return approximateDistinctAddresses(blocks, precision);
+    }, py::arg("chain"), py::arg("start") = 0, py::arg("stop") = -1, py::arg("precision") = 14,
+        "Return a HyperLogLog sketch of the addresses receiving outputs in the blocks [start, stop), computed in parallel");
+    m.def("approximate_fee_rates", [](Blockchain &chain, BlockHeight start, BlockHeight stop, uint16_t k) {
+        auto blocks = blockRange(chain, start, stop);
+        py::gil_scoped_release release;
+        return approximateFeeRates(blocks, k);
+    }, py::arg("chain"), py::arg("start") = 0, py::arg("stop") = -1, py::arg("k") = 200,
+        "Return a QuantileSketch of the fee per virtual byte of the non-coinbase transactions in the blocks [start, stop), computed in parallel");
+    m.def("approximate_output_values", [](Blockchain &chain, BlockHeight start, BlockHeight stop, uint16_t k) {
+        auto blocks = blockRange(chain, start, stop);
+        py::gil_scoped_release release;
+        return approximateOutputValues(blocks, k);
+    }, py::arg("chain"), py::arg("start") = 0, py::arg("stop") = -1, py::arg("k") = 200,
+        "Return a QuantileSketch of the output values in the blocks [start, stop), computed in parallel");
+}
@@ -0,0 +1,66 @@
+//
+//  stdout_redirect.cpp
+//  blocksci_interface
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include "stdout_redirect.hpp"
+
+#include <cstring>
+
+namespace py = pybind11;
+
+ThreadSafeStdoutRedirect::ThreadSafeStdoutRedirect() {
+    auto pythonStdout = py::module::import("sys").attr("stdout");
+    pythonWrite = pythonStdout.attr("write");
+    pythonFlush = pythonStdout.attr("flush");
+    old = std::cout.rdbuf(this);
+}
+
+ThreadSafeStdoutRedirect::~ThreadSafeStdoutRedirect() {
+    std::cout.rdbuf(old);
+    std::lock_guard<std::mutex> lock(mutex);
+    forward();
+}
+
+// Called with the mutex held
+void ThreadSafeStdoutRedirect::forward() {
+    if (pending.empty()) {
+        return;
+    }
+    py::gil_scoped_acquire acquire;
+    try {
+        pythonWrite(py::bytes(pending).attr("decode")("utf-8", "replace"));
+        pythonFlush();
+    } catch (py::error_already_set &) {
+        // Losing progress output is better than failing the computation writing it
+    }
+    pending.clear();
+}
+
+int ThreadSafeStdoutRedirect::overflow(int c) {
+    if (c != traits_type::eof()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(static_cast<char>(c));
+        if (c == '\n') {
+            forward();
+        }
+    }
+    return c;
+}
+
+std::streamsize ThreadSafeStdoutRedirect::xsputn(const char *s, std::streamsize n) {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.append(s, static_cast<size_t>(n));
+    if (std::memchr(s, '\n', static_cast<size_t>(n)) != nullptr) {
+        forward();
+    }
+    return n;
+}
+
+int ThreadSafeStdoutRedirect::sync() {
+    std::lock_guard<std::mutex> lock(mutex);
+    forward();
+    return 0;
+}
@@ -0,0 +1,45 @@
+//
+//  stdout_redirect.hpp
+//  blocksci_interface
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef stdout_redirect_hpp
+#define stdout_redirect_hpp
+
+#include <pybind11/pybind11.h>
+
+#include <iostream>
+#include <mutex>
+#include <streambuf>
+#include <string>
+
+/** Forwards std::cout to sys.stdout for calls that release the GIL
+ *
+ * pybind11::scoped_ostream_redirect writes to Python from whichever thread flushes. This buffers the output of all
+ * threads instead and takes the GIL whenever a line is complete or the stream is flushed. Construct it with the GIL
+ * held and release the GIL afterwards, so that it is reacquired before the redirect ends.
+ */
+class ThreadSafeStdoutRedirect : public std::streambuf {
+    pybind11::object pythonWrite;
+    pybind11::object pythonFlush;
+    std::streambuf *old;
+    std::mutex mutex;
+    std::string pending;
+
+    void forward();
+
+protected:
+    int overflow(int c) override;
+    std::streamsize xsputn(const char *s, std::streamsize n) override;
+    int sync() override;
+
+public:
+    ThreadSafeStdoutRedirect();
+    ThreadSafeStdoutRedirect(const ThreadSafeStdoutRedirect &) = delete;
+    ThreadSafeStdoutRedirect &operator=(const ThreadSafeStdoutRedirect &) = delete;
+    ~ThreadSafeStdoutRedirect() override;
+};
+
+#endif /* stdout_redirect_hpp */
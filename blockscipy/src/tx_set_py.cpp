@@ -0,0 +1,119 @@
+//
+//  tx_set_py.cpp
+//  blocksci_interface
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include "proxy.hpp"
+
+#include <blocksci/chain/blockchain.hpp>
+#include <blocksci/chain/tx_set.hpp>
+#include <blocksci/chain/utxo_set.hpp>
+
+#include <pybind11/numpy.h>
+#include <pybind11/operators.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include <memory>
+
+namespace py = pybind11;
+using namespace blocksci;
+
+namespace {
+    py::array_t<uint64_t> setValues(const RoaringSet &values) {
+        py::array_t<uint64_t> ret{static_cast<size_t>(values.size())};
+        auto retPtr = ret.mutable_data();
+        for (auto value : values) {
+            *retPtr++ = value;
+        }
+        return ret;
+    }
+
+    template <typename Set, typename Class>
+    void addSetMethods(Class &cl) {
+        cl
+        .def("__len__", &Set::size)
+        .def("__bool__", [](const Set &set) { return !set.empty(); })
+        .def("__iter__", [](const Set &set) { return py::make_iterator(set.begin(), set.end()); }, py::keep_alive<0, 1>())
+        .def(py::self | py::self)
+        .def(py::self & py::self)
+        .def(py::self - py::self)
+        .def(py::self |= py::self)
+        .def(py::self &= py::self)
+        .def(py::self -= py::self)
+        .def(py::self == py::self)
+        .def(py::self != py::self)
+        .def("union", [](const Set &a, const Set &b) { return a | b; }, py::arg("other"), "Return the elements in either set")
+        .def("intersection", [](const Set &a, const Set &b) { return a & b; }, py::arg("other"), "Return the elements in both sets")
+        .def("difference", [](const Set &a, const Set &b) { return a - b; }, py::arg("other"), "Return the elements of this set that are not in the other set")
+        .def("save", &Set::save, py::arg("path"), "Write the set to a file")
+        ;
+    }
+}
+
+void init_tx_sets(py::module &m) {
+    py::class_<TxSet> txSetCl(m, "TxSet", "Compressed set of transactions of one chain with fast set algebra");
+    txSetCl
+    .def(py::init([](Blockchain &chain, const std::vector<Transaction> &txes) {
+        return TxSet{txes, chain.getAccess()};
+    }), py::arg("chain"), py::arg("txes"), "Set of the given transactions")
+    .def_static("from_indexes", [](Blockchain &chain, py::array_t<uint32_t, py::array::c_style | py::array::forcecast> indexes) {
+        std::vector<uint32_t> txNums(indexes.data(), indexes.data() + indexes.size());
+        return TxSet{txNums, chain.getAccess()};
+    }, py::arg("chain"), py::arg("indexes"), "Set of the transactions with the given indexes")
+    .def_static("from_blocks", [](Blockchain &chain, BlockHeight start, BlockHeight stop) {
+        auto blocks = chain[{start, stop}];
+        return TxSet{blocks};
+    }, py::arg("chain"), py::arg("start"), py::arg("stop"), "Set of all transactions in the blocks [start, stop)")
+    .def_static("load", [](Blockchain &chain, const std::string &path) {
+        return TxSet::load(path, chain.getAccess());
+    }, py::arg("chain"), py::arg("path"), "Read a set written by save")
+    .def("__contains__", [](const TxSet &set, const Transaction &tx) { return set.contains(tx); })
+    .def("add", &TxSet::add, py::arg("tx"), "Add a transaction to the set")
+    .def_property_readonly("indexes", [](const TxSet &set) {
+        return setValues(set.getTxNums());
+    }, "Sorted numpy array of the indexes of the transactions in the set")
+    .def("to_list", &TxSet::toTransactions, "Return a list of the transactions in the set, looked up in one batch")
+    .def("includes", [](const TxSet &txSet, Proxy<Transaction> &tx) -> Proxy<bool> {
+        auto set = std::make_shared<TxSet>(txSet);
+        return {std::function<bool(std::any &)>{[set, tx](std::any &v) {
+            return set->contains(tx(v));
+        }}, tx.sourceType};
+    }, py::arg("tx"), "Return a proxy that is true when the given transaction proxy is in (a snapshot of) the set, for use in where clauses")
+    ;
+    addSetMethods<TxSet>(txSetCl);
+
+    py::class_<OutputSet> outputSetCl(m, "OutputSet", "Compressed set of outputs of one chain with fast set algebra");
+    outputSetCl
+    .def(py::init([](Blockchain &chain, const std::vector<Output> &outputs) {
+        return OutputSet{outputs, chain.getAccess()};
+    }), py::arg("chain"), py::arg("outputs"), "Set of the given outputs")
+    .def(py::init<const TxSet &>(), py::arg("txes"), "Set of all outputs of the given transactions")
+    .def_static("load", [](Blockchain &chain, const std::string &path) {
+        return OutputSet::load(path, chain.getAccess());
+    }, py::arg("chain"), py::arg("path"), "Read a set written by save")
+    .def("__contains__", [](const OutputSet &set, const Output &output) { return set.contains(output); })
+    .def("add", &OutputSet::add, py::arg("output"), "Add an output to the set")
+    .def_property_readonly("indexes", [](const OutputSet &set) {
+        return setValues(set.getOutputNums());
+    }, "Sorted numpy array of the blockchain-wide numbers of the outputs in the set")
+    .def_property_readonly("txes", &OutputSet::txes, "Set of the transactions containing the outputs")
+    .def("includes", [](const OutputSet &outputSet, Proxy<Output> &output) -> Proxy<bool> {
+        auto set = std::make_shared<OutputSet>(outputSet);
+        return {std::function<bool(std::any &)>{[set, output](std::any &v) {
+            return set->contains(output(v));
+        }}, output.sourceType};
+    }, py::arg("output"), "Return a proxy that is true when the given output proxy is in (a snapshot of) the set, for use in where clauses")
+    ;
+    addSetMethods<OutputSet>(outputSetCl);
+
+    py::class_<UTXOSetDelta>(m, "UTXOSetDelta", "Outputs added to and removed from the UTXO set by a range of blocks, see Blockchain.utxo_set_delta")
+    .def_readonly("start_height", &UTXOSetDelta::startHeight)
+    .def_readonly("end_height", &UTXOSetDelta::endHeight)
+    .def_readonly("created", &UTXOSetDelta::created, "Outputs created in the blocks that are still unspent after them")
+    .def_readonly("spent", &UTXOSetDelta::spent, "Outputs created before the blocks that the blocks spend")
+    .def("apply", &UTXOSetDelta::apply, py::arg("utxos"), "Turn the UTXO set at start_height into the one at end_height in place")
+    ;
+}
@@ -0,0 +1,42 @@
+# Try to find the ZeroMQ library.
+#
+# Usage of this module as follows:
+#
+#     find_package(ZMQ)
+#
+# Variables used by this module, they can change the default behaviour and need
+# to be set before calling find_package:
+#
+#  ZMQ_ROOT_DIR             Set this variable to the root installation of
+#                           ZeroMQ if the module has problems finding the
+#                           proper installation path.
+#
+# Variables defined by this module:
+#
+#  ZMQ_FOUND                System has ZeroMQ
+#  ZMQ_INCLUDE_DIRS         The location of the zmq.h header.
+#  ZMQ_LIBRARIES            The ZeroMQ library.
+
+find_path(ZMQ_INCLUDE_DIRS
+    NAMES zmq.h
+    HINTS ${ZMQ_ROOT_DIR}/include
+)
+
+find_library(ZMQ_LIBRARIES
+    NAMES zmq libzmq
+    HINTS ${ZMQ_ROOT_DIR}/lib
+)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(ZMQ DEFAULT_MSG
+    ZMQ_INCLUDE_DIRS
+    ZMQ_LIBRARIES
+)
+
+IF (ZMQ_FOUND AND NOT TARGET zmq)
+    add_library(zmq INTERFACE)
+    target_include_directories(zmq INTERFACE ${ZMQ_INCLUDE_DIRS})
+    target_link_libraries(zmq INTERFACE ${ZMQ_LIBRARIES})
+ENDIF ()
+
+mark_as_advanced(ZMQ_INCLUDE_DIRS ZMQ_LIBRARIES)
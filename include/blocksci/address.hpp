@@ -10,6 +10,8 @@
 #define blocksci_address_group_header
 
 #include <blocksci/address/address.hpp>
+#include <blocksci/address/address_stats.hpp>
 #include <blocksci/address/equiv_address.hpp>
+#include <blocksci/address/tag_store.hpp>
 
 #endif /* blocksci_address_group_header */
@@ -15,6 +15,8 @@
 #include <blocksci/core/raw_address.hpp>
 #include <blocksci/core/typedefs.hpp>
 #include <blocksci/chain/chain_fwd.hpp>
+#include <blocksci/chain/input_pointer.hpp>
+#include <blocksci/chain/output_pointer.hpp>
 #include <blocksci/scripts/scripts_fwd.hpp>
 
 #include <range/v3/view/any_view.hpp>
@@ -34,6 +36,18 @@ namespace blocksci {
      * Script data is stored in separate files for every address type in `scripts/` and can be accessed by ScriptAccess.
      * The scriptNum represents an index to the scripts file for this address type.
      */
+    /** Every output sent to an address and the inputs spending them, resolved in one pass (@see Address::getHistory) */
+    struct BLOCKSCI_EXPORT AddressHistory {
+        /** Outputs sent to the address, sorted by tx number */
+        std::vector<OutputPointer> outputs;
+        
+        /** Inputs spending those outputs, sorted by tx number */
+        std::vector<InputPointer> inputs;
+        
+        /** Numbers of all txes sending to or spending from the address, sorted and unique */
+        std::vector<uint32_t> txNums;
+    };
+    
     class BLOCKSCI_EXPORT Address {
         DataAccess *access;
         
@@ -96,16 +110,31 @@ namespace blocksci {
         
         ScriptBase getBaseScript() const;
         
+        /** Tx number of the first transaction that used the script of this address, same as getBaseScript().getFirstTxIndex() */
+        uint32_t getFirstTxIndex() const;
+        
         EquivAddress getEquivAddresses(bool nestedEquivalent) const;
         
         ranges::any_view<OutputPointer> getOutputPointers() const;
         int64_t calculateBalance(BlockHeight height) const;
+        
+        /** Totals of the outputs of this address from the parser maintained stats columns (@see AddressStats), much
+         * cheaper than calculateBalance. Throws std::runtime_error if the stats don't cover the address */
+        AddressStats getStats() const;
+        
         ranges::any_view<Output> getOutputs() const;
         ranges::any_view<Input> getInputs() const;
         ranges::any_view<Transaction> getTransactions() const;
         ranges::any_view<Transaction> getOutputTransactions() const;
         ranges::any_view<Transaction> getInputTransactions() const;
         
+        /** All outputs, spending inputs and txes of this address at once
+         *
+         * Resolves the spends in output order and reads them back in spending tx order, which keeps the accesses to
+         * the chain files sequential. Much cheaper than iterating getInputs() or getTransactions() for addresses with
+         * many outputs. */
+        AddressHistory getHistory() const;
+        
         std::string fullType() const;
     };
     
@@ -113,8 +142,28 @@ namespace blocksci {
     
     ranges::optional<Address> BLOCKSCI_EXPORT getAddressFromString(const std::string &addressString, DataAccess &access);
     
+    /** Batched version of getAddressFromString, entries are empty for strings without a matching address
+     *
+     * The strings are decoded and looked up in the hash index on threadCount threads (0 for one per hardware thread). */
+    std::vector<ranges::optional<Address>> BLOCKSCI_EXPORT getAddressesFromStrings(const std::vector<std::string> &addressStrings, DataAccess &access, uint32_t threadCount = 0);
+    
     std::vector<Address> BLOCKSCI_EXPORT getAddressesWithPrefix(const std::string &prefix, DataAccess &access);
     
+    /** Maximum length of the address strings of the type, 0 for types that have no address string */
+    size_t BLOCKSCI_EXPORT addressStringLength(AddressType::Enum type, DataAccess &access);
+    
+    /** Write the address string of every address of the type with address number in [start, end) into a fixed width
+     * buffer, the string of address number i at out + width * (i - start) padded with NUL bytes
+     *
+     * Only pubkey, pubkeyhash, multisig_pubkey, scripthash and witness pubkeyhash, scripthash and taproot addresses have
+     * address strings. The strings are computed on threadCount threads (0 for one per hardware thread) with the bulk base58 and
+     * bech32 encoders, which is much faster than calling addressString for every address. Throws
+     * std::invalid_argument for other types. */
+    void BLOCKSCI_EXPORT addressStrings(AddressType::Enum type, uint32_t start, uint32_t end, char *out, size_t width, DataAccess &access, uint32_t threadCount = 0);
+    
+    /** Balance of each address at the height, computed on threadCount threads (0 for one per hardware thread) */
+    std::vector<int64_t> BLOCKSCI_EXPORT calculateBalances(const std::vector<Address> &addresses, BlockHeight height, uint32_t threadCount = 0);
+    
     inline size_t hashAddress(uint32_t scriptNum, AddressType::Enum type) {
         return (static_cast<size_t>(scriptNum) << 32) + static_cast<size_t>(type);
     }
@@ -11,6 +11,7 @@
 namespace blocksci {
     class Address;
     class EquivAddress;
+    struct AddressStats;
 }
 
 #endif /* address_fwd_h */
@@ -0,0 +1,80 @@
+//
+//  address_stats.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_address_stats_hpp
+#define blocksci_address_stats_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/address/address.hpp>
+#include <blocksci/core/address_types.hpp>
+#include <blocksci/core/typedefs.hpp>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace blocksci {
+    class DataAccess;
+
+    /** Totals over all outputs ever sent to one address, kept up to date by the parser
+     *
+     * Stored in the optional scripts/<address type>_stats.dat files, one element per script number of the address type
+     * (script number i at index i - 1). They are created with "blocksci_parser build-address-stats" and extended by
+     * every later parser update. Addresses of different types sharing a script (eg. pubkey and pubkeyhash) have
+     * separate totals, like Address::calculateBalance.
+     */
+    struct BLOCKSCI_EXPORT AddressStats {
+        /** Value of all outputs sent to the address */
+        int64_t received;
+
+        /** Value of the outputs of the address which have been spent */
+        int64_t sent;
+
+        uint32_t outputCount;
+        uint32_t spentOutputCount;
+
+        /** Height of the first output sent to the address, only meaningful if outputCount > 0 */
+        BlockHeight firstSeenHeight;
+
+        /** Height of the last block sending to or spending from the address */
+        BlockHeight lastSeenHeight;
+
+        /** Balance at the end of the chain covered by the stats */
+        int64_t balance() const {
+            return received - sent;
+        }
+    };
+
+    static_assert(sizeof(AddressStats) == 32, "AddressStats is stored as raw file data");
+
+    enum class BLOCKSCI_EXPORT AddressStatsField {
+        Balance, Received, Sent, OutputCount
+    };
+
+    /** Stats of all scripts of one address type, element i belonging to script number i + 1 */
+    struct BLOCKSCI_EXPORT AddressStatsColumn {
+        const AddressStats *data = nullptr;
+        uint32_t count = 0;
+    };
+
+    /** Whether the address stats have been built for this chain */
+    BLOCKSCI_EXPORT bool hasAddressStats(DataAccess &access);
+
+    /** Number of transactions the address stats include, stats only cover the chain up to here */
+    BLOCKSCI_EXPORT uint32_t addressStatsTxCount(DataAccess &access);
+
+    /** The stats of every script of the type, without copying. Only valid until the chain is reloaded.
+     * Throws std::runtime_error if the stats were never built */
+    BLOCKSCI_EXPORT AddressStatsColumn addressStatsColumn(AddressType::Enum type, DataAccess &access);
+
+    /** The k addresses with the largest value of the field with that value, over the given types (all for an empty list)
+     *
+     * Selects from the stats columns, which is much cheaper than computing the balance of every address. */
+    BLOCKSCI_EXPORT std::vector<std::pair<Address, int64_t>> topAddresses(DataAccess &access, AddressStatsField field, size_t k, const std::vector<AddressType::Enum> &types = {});
+} // namespace blocksci
+
+#endif /* blocksci_address_stats_hpp */
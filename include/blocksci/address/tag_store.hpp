@@ -0,0 +1,117 @@
+//
+//  tag_store.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_address_tag_store_hpp
+#define blocksci_address_tag_store_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/address/address.hpp>
+#include <blocksci/chain/chain_fwd.hpp>
+#include <blocksci/core/address_types.hpp>
+#include <blocksci/core/raw_address.hpp>
+
+#include <range/v3/utility/optional.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace blocksci {
+    struct TagStoreHeader;
+
+    /** Persistent, memory mapped table of address tags
+     *
+     * Tag names are interned into a dictionary and every tagged address holds the id of its tag. The addresses are
+     * stored as a scriptNum column sorted by (type, scriptNum) with a parallel tag id column, 8 bytes per tag, so a
+     * store is opened without parsing and the pages are shared by every process mapping the same file. Lookups are a
+     * binary search within the section of the address type, batches sorted by address are merged instead.
+     *
+     * Appends merge the new tags into the sorted columns and replace the file atomically under a lock, processes that
+     * have the store open keep seeing the previous version until they open it again.
+     */
+    class BLOCKSCI_EXPORT TagStore {
+    public:
+        /** Tag id of untagged addresses, equal to ClusterFlow::OtherCluster */
+        static constexpr uint32_t NoTag = std::numeric_limits<uint32_t>::max();
+
+        /** Map the store at path, throws std::runtime_error if it doesn't exist or isn't a tag store */
+        explicit TagStore(const std::string &path);
+
+        /** Tag the addresses with the tags of the same position, creating the store at path if it doesn't exist
+         *
+         * Tags given for an address that already has one replace it, if an address is given several times the last tag
+         * wins. Tag names that aren't in the dictionary are interned in order of first appearance. Returns the store
+         * with the appended tags. Throws std::invalid_argument if the vectors differ in length. */
+        static TagStore append(const std::string &path, const std::vector<RawAddress> &addresses, const std::vector<std::string> &tags);
+        static TagStore append(const std::string &path, const std::unordered_map<Address, std::string> &tags);
+
+        /** Number of tagged addresses */
+        uint64_t size() const;
+
+        /** Number of interned tag names, ids run from 0 to tagCount() - 1 */
+        uint32_t tagCount() const;
+
+        /** Throws std::out_of_range for ids not below tagCount() */
+        std::string tagName(uint32_t tagId) const;
+
+        /** Id of the tag name, if it is in the dictionary */
+        ranges::optional<uint32_t> findTag(const std::string &name) const;
+
+        /** Tag id of the address, NoTag if it isn't tagged */
+        uint32_t tagId(const RawAddress &address) const;
+
+        /** Tag ids of the addresses given as separate scriptNum and AddressType::Enum columns, NoTag for untagged ones
+         *
+         * Input sorted by (type, scriptNum), as produced by sorting addresses or iterating the store, is merged with the
+         * store in a single pass, other input is looked up in parallel segments. Throws std::invalid_argument for
+         * invalid address types. */
+        void tagIds(const uint32_t *scriptNums, const uint8_t *types, size_t count, uint32_t *tagIds, uint32_t threadCount = 0) const;
+        std::vector<uint32_t> tagIds(const std::vector<RawAddress> &addresses, uint32_t threadCount = 0) const;
+
+        /** Tag id of every output of the blocks by output number, read from the address columns of the outputs */
+        std::vector<uint32_t> outputTagIds(BlockRange &blocks) const;
+
+        /** Addresses tagged with the tag, in (type, scriptNum) order */
+        std::vector<RawAddress> addressesWithTag(uint32_t tagId) const;
+
+        /** Every tagged address with the name of its tag, for the APIs taking tags as a map */
+        std::unordered_map<Address, std::string> toMap(DataAccess &access) const;
+
+        /** Sorted scriptNum column and tag id column, positions [typeStart(type), typeStart(type + 1)) hold the
+         * addresses of one type */
+        const uint32_t *scriptNums() const {
+            return scriptNumData;
+        }
+
+        const uint32_t *tagIdColumn() const {
+            return tagIdData;
+        }
+
+        uint64_t typeStart(size_t type) const;
+
+    private:
+        std::shared_ptr<const void> mapping;
+        const TagStoreHeader *header = nullptr;
+        const uint32_t *scriptNumData = nullptr;
+        const uint32_t *tagIdData = nullptr;
+        const uint32_t *nameOrder = nullptr;
+        const uint64_t *nameOffsets = nullptr;
+        const char *names = nullptr;
+
+        TagStore() = default;
+
+        /** Position of the address in the columns, size() if it isn't tagged */
+        uint64_t find(uint32_t scriptNum, AddressType::Enum type) const;
+    };
+} // namespace blocksci
+
+#endif /* blocksci_address_tag_store_hpp */
@@ -9,13 +9,36 @@
 #ifndef chain_h
 #define chain_h
 
+#include <blocksci/chain/address_scan.hpp>
 #include <blocksci/chain/algorithms.hpp>
+#include <blocksci/chain/async_query.hpp>
 #include <blocksci/chain/block.hpp>
+#include <blocksci/chain/block_stats.hpp>
+#include <blocksci/chain/bulk_scan.hpp>
+#include <blocksci/chain/column_data.hpp>
 #include <blocksci/chain/blockchain.hpp>
+#include <blocksci/chain/chain_table.hpp>
+#include <blocksci/chain/coin_age_columns.hpp>
+#include <blocksci/chain/derived_column.hpp>
 #include <blocksci/chain/input_pointer.hpp>
 #include <blocksci/chain/input.hpp>
+#include <blocksci/chain/inout_cursor.hpp>
+#include <blocksci/chain/mempool_time_columns.hpp>
+#include <blocksci/chain/miner_attribution.hpp>
 #include <blocksci/chain/output_pointer.hpp>
 #include <blocksci/chain/output.hpp>
+#include <blocksci/chain/output_columns.hpp>
+#include <blocksci/chain/refs.hpp>
+#include <blocksci/chain/tx_fee_columns.hpp>
+#include <blocksci/chain/sampling.hpp>
+#include <blocksci/chain/column_filter.hpp>
+#include <blocksci/chain/shard_plan.hpp>
+#include <blocksci/chain/sketches.hpp>
+#include <blocksci/chain/tx_num_range.hpp>
+#include <blocksci/chain/tx_package.hpp>
+#include <blocksci/chain/tx_set.hpp>
+#include <blocksci/chain/utxo_set.hpp>
+#include <blocksci/chain/work_pool.hpp>
 #include <blocksci/chain/transaction.hpp>
 #include <blocksci/chain/transaction_range.hpp>
 
@@ -0,0 +1,118 @@
+//
+//  address_scan.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_chain_address_scan_hpp
+#define blocksci_chain_address_scan_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/address/address_fwd.hpp>
+#include <blocksci/chain/chain_fwd.hpp>
+#include <blocksci/core/address_types.hpp>
+#include <blocksci/core/inout_pointer.hpp>
+#include <blocksci/core/raw_address.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace blocksci {
+
+    /** Set of (scriptNum, type) pairs built for testing every input and output of a chain against it
+     *
+     * The scriptNums of each address type are kept in a sorted array together with a table of bucket starts indexed by
+     * the high bits of the scriptNum, which leaves a few scriptNums to search after one table lookup. In front of the
+     * arrays sits a bitmap with bitsPerAddress bits per address indexed by a hash of the pair, which rejects about 94%
+     * of the pairs that aren't in the set with a single memory access. Twenty million addresses take under 200MB.
+     */
+    class BLOCKSCI_EXPORT AddressSet {
+    public:
+        static constexpr size_t bitsPerAddress = 16;
+
+        AddressSet() = default;
+        explicit AddressSet(const std::vector<RawAddress> &addresses);
+        explicit AddressSet(const std::vector<Address> &addresses);
+
+        /** Number of distinct addresses in the set */
+        size_t size() const {
+            return addressCount;
+        }
+
+        /** Bytes allocated by the set */
+        size_t memoryUsage() const;
+
+        bool contains(uint32_t scriptNum, AddressType::Enum type) const {
+            return mayContain(hashKey(scriptNum, type)) && bucketContains(scriptNum, type);
+        }
+
+        /** Append the positions of the addresses that are in the set to hits
+         *
+         * Probes the bitmap for the whole batch before searching the sorted arrays for the remaining candidates, so the
+         * cache misses of the batch overlap. */
+        void containsBatch(const RawAddress *addresses, size_t count, std::vector<uint32_t> &hits) const;
+
+        /** Call func(scriptNum, type) for every address of the set */
+        template <typename Func>
+        void forEach(Func &&func) const {
+            for (size_t i = 0; i < types.size(); i++) {
+                for (auto scriptNum : types[i].scriptNums) {
+                    func(scriptNum, static_cast<AddressType::Enum>(i));
+                }
+            }
+        }
+
+    private:
+        struct TypeIndex {
+            std::vector<uint32_t> scriptNums;
+            /** scriptNums[bucketStarts[b], bucketStarts[b + 1]) have b as their scriptNum >> shift */
+            std::vector<uint32_t> bucketStarts;
+            uint32_t shift = 0;
+        };
+
+        std::array<TypeIndex, AddressType::size> types;
+        std::vector<uint64_t> bitmap;
+        uint32_t bitmapShift = 64;
+        size_t addressCount = 0;
+
+        static uint64_t hashKey(uint32_t scriptNum, AddressType::Enum type) {
+            return ((static_cast<uint64_t>(type) << 32) | scriptNum) * 0x9E3779B97F4A7C15;
+        }
+
+        bool mayContain(uint64_t hash) const {
+            if (bitmap.empty()) {
+                return false;
+            }
+            auto bit = hash >> bitmapShift;
+            return (bitmap[bit >> 6] >> (bit & 63)) & 1;
+        }
+
+        bool bucketContains(uint32_t scriptNum, AddressType::Enum type) const;
+    };
+
+    /** Which side of a transaction a match was found on */
+    enum class BLOCKSCI_EXPORT InoutDirection : uint8_t {
+        Input,
+        Output
+    };
+
+    /** Input or output using an address of an AddressSet */
+    struct BLOCKSCI_EXPORT AddressMatch {
+        /** Transaction and input or output number */
+        InoutPointer pointer;
+        InoutDirection direction;
+    };
+
+    /** All inputs and outputs of the blocks whose address is in the set, sorted by transaction with the inputs of a
+     * transaction before its outputs
+     *
+     * Scans the raw inouts of tx_data.dat on the work pool of the chain and probes the set in batches. Blocks whose
+     * address filter (@see BlockRange::blocksPossiblyTouching) rules out every address of the set are skipped without
+     * reading their transactions. Inputs match on the address of the output they spend. */
+    std::vector<AddressMatch> BLOCKSCI_EXPORT scanForAddresses(BlockRange &blocks, const AddressSet &addresses);
+} // namespace blocksci
+
+#endif /* blocksci_chain_address_scan_hpp */
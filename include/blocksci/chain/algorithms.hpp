@@ -13,11 +13,13 @@
 #include <blocksci/chain/output.hpp>
 #include <blocksci/chain/input.hpp>
 #include <blocksci/chain/output.hpp>
+#include <blocksci/chain/refs.hpp>
 #include <blocksci/chain/transaction.hpp>
 
 #include <range/v3/range_for.hpp>
 #include <range/v3/numeric/accumulate.hpp>
 #include <range/v3/view/filter.hpp>
+#include <range/v3/view/iota.hpp>
 #include <range/v3/view/join.hpp>
 #include <range/v3/view/remove_if.hpp>
 #include <range/v3/view/transform.hpp>
@@ -27,6 +29,12 @@ namespace blocksci {
     CPP_template(typename B)(requires ranges::range<B>)
     CPP_concept_bool isOutputPointerRange = std::is_same<ranges::range_value_t<B>, OutputPointer>::value;
     
+    CPP_template(typename B)(requires ranges::range<B>)
+    CPP_concept_bool isInputPointerRange = std::is_same<ranges::range_value_t<B>, InputPointer>::value;
+    
+    CPP_template(typename B)(requires ranges::range<B>)
+    CPP_concept_bool isTxRefRange = std::is_same<ranges::range_value_t<B>, TxRef>::value;
+    
     CPP_template(typename B)(requires ranges::range<B>)
     CPP_concept_bool isInputRange = std::is_same<ranges::range_value_t<B>, Input>::value;
     
@@ -112,6 +120,34 @@ namespace blocksci {
         return std::forward<B>(b) | ranges::views::transform([&access](const OutputPointer &pointer) { return Output(pointer, access); });
     }
     
+    CPP_template(typename B)(requires isTxRefRange<B>)
+    inline auto BLOCKSCI_EXPORT txes(B && b, DataAccess &access) {
+        return std::forward<B>(b) | ranges::views::transform([&access](TxRef tx) { return materialize(tx, access); });
+    }
+    
+    CPP_template(typename B)(requires isInputPointerRange<B>)
+    inline auto BLOCKSCI_EXPORT inputs(B && b, DataAccess &access) {
+        return std::forward<B>(b) | ranges::views::transform([&access](const InputPointer &pointer) { return Input(pointer, access); });
+    }
+    
+    inline auto BLOCKSCI_EXPORT inputRefs(TxRef tx, DataAccess &access) {
+        return ranges::views::iota(uint16_t{0}, inputCount(tx, access)) | ranges::views::transform([tx](uint16_t i) { return inputRef(tx, i); });
+    }
+    
+    inline auto BLOCKSCI_EXPORT outputRefs(TxRef tx, DataAccess &access) {
+        return ranges::views::iota(uint16_t{0}, outputCount(tx, access)) | ranges::views::transform([tx](uint16_t i) { return outputRef(tx, i); });
+    }
+    
+    CPP_template(typename B)(requires isTxRefRange<B>)
+    inline auto BLOCKSCI_EXPORT inputRefs(B && b, DataAccess &access) {
+        return std::forward<B>(b) | ranges::views::transform([&access](TxRef tx) { return inputRefs(tx, access); }) | ranges::views::join;
+    }
+    
+    CPP_template(typename B)(requires isTxRefRange<B>)
+    inline auto BLOCKSCI_EXPORT outputRefs(B && b, DataAccess &access) {
+        return std::forward<B>(b) | ranges::views::transform([&access](TxRef tx) { return outputRefs(tx, access); }) | ranges::views::join;
+    }
+    
     template <typename T>
     inline auto BLOCKSCI_EXPORT outputsUnspent(T && t) {
         return outputs(std::forward<T>(t)) | ranges::views::remove_if([](const Output &output) { return output.isSpent(); });
@@ -119,49 +155,49 @@ namespace blocksci {
     
     template <typename T>
     inline auto BLOCKSCI_EXPORT outputsSpentBeforeHeight(T && t, blocksci::BlockHeight blockHeight) {
-        return outputs(std::forward<T>(t)) | ranges::views::filter([=](const Output &output) { return output.isSpent() && output.getSpendingTx()->getBlockHeight() < blockHeight; });
+        return outputs(std::forward<T>(t)) | ranges::views::filter([=](const Output &output) { return output.isSpent() && *output.getSpendingBlockHeight() < blockHeight; });
     }
     
     template <typename T>
     inline auto BLOCKSCI_EXPORT outputsSpentAfterHeight(T && t, blocksci::BlockHeight blockHeight) {
-        return outputs(std::forward<T>(t)) | ranges::views::filter([=](const Output &output) { return output.isSpent() && output.getSpendingTx()->getBlockHeight() >= blockHeight; });
+        return outputs(std::forward<T>(t)) | ranges::views::filter([=](const Output &output) { return output.isSpent() && *output.getSpendingBlockHeight() >= blockHeight; });
     }
     
     template <typename T>
     inline auto BLOCKSCI_EXPORT inputsCreatedAfterHeight(T && t, blocksci::BlockHeight blockHeight) {
-        return inputs(std::forward<T>(t)) | ranges::views::filter([=](const Input &input) { return input.getSpentTx().getBlockHeight() >= blockHeight; });
+        return inputs(std::forward<T>(t)) | ranges::views::filter([=](const Input &input) { return input.getSpentBlockHeight() >= blockHeight; });
     }
     
     template <typename T>
     inline auto BLOCKSCI_EXPORT inputsCreatedBeforeHeight(T && t, blocksci::BlockHeight blockHeight) {
-        return inputs(std::forward<T>(t)) | ranges::views::filter([=](const Input &input) { return input.getSpentTx().getBlockHeight() < blockHeight; });
+        return inputs(std::forward<T>(t)) | ranges::views::filter([=](const Input &input) { return input.getSpentBlockHeight() < blockHeight; });
     }
 
     template <typename T>
     inline auto BLOCKSCI_EXPORT outputsSpentWithinRelativeHeight(T && t, blocksci::BlockHeight difference) {
         return outputs(std::forward<T>(t)) | ranges::views::filter([=](const Output &output) {
-            return output.isSpent() && output.getSpendingTx()->getBlockHeight() - output.getBlockHeight() < difference;
+            return output.isSpent() && *output.getSpendingBlockHeight() - output.getBlockHeight() < difference;
         });
     }
     
     template <typename T>
     inline auto BLOCKSCI_EXPORT outputsSpentOutsideRelativeHeight(T && t, blocksci::BlockHeight difference) {
         return outputs(std::forward<T>(t)) | ranges::views::filter([=](const Output &output) {
-            return output.isSpent() && output.getSpendingTx()->getBlockHeight() - output.getBlockHeight() >= difference;
+            return output.isSpent() && *output.getSpendingBlockHeight() - output.getBlockHeight() >= difference;
         });
     }
     
     template <typename T>
     inline auto BLOCKSCI_EXPORT inputsCreatedWithinRelativeHeight(T && t, blocksci::BlockHeight difference) {
         return inputs(std::forward<T>(t)) | ranges::views::filter([=](const Input &input) {
-            return input.blockHeight - input.getSpentTx().getBlockHeight() < difference;
+            return input.blockHeight - input.getSpentBlockHeight() < difference;
         });
     }
     
     template <typename T>
     inline auto BLOCKSCI_EXPORT inputsCreatedOutsideRelativeHeight(T && t, blocksci::BlockHeight difference) {
         return inputs(std::forward<T>(t)) | ranges::views::filter([=](const Input &input) {
-            return input.blockHeight - input.getSpentTx().getBlockHeight() >= difference;
+            return input.blockHeight - input.getSpentBlockHeight() >= difference;
         });
     }
     
@@ -202,6 +238,81 @@ namespace blocksci {
     inline int64_t BLOCKSCI_EXPORT fee(const Transaction &tx) {
         return tx.fee();
     }
+    
+    CPP_template(typename B)(requires isTxRefRange<B>)
+    inline uint64_t BLOCKSCI_EXPORT inputCount(B && b, DataAccess &access) {
+        uint64_t total = 0;
+        RANGES_FOR(TxRef tx, b) {
+            total += inputCount(tx, access);
+        }
+        return total;
+    }
+    
+    CPP_template(typename B)(requires isTxRefRange<B>)
+    inline uint64_t BLOCKSCI_EXPORT outputCount(B && b, DataAccess &access) {
+        uint64_t total = 0;
+        RANGES_FOR(TxRef tx, b) {
+            total += outputCount(tx, access);
+        }
+        return total;
+    }
+    
+    CPP_template(typename B)(requires isTxRefRange<B>)
+    inline int64_t BLOCKSCI_EXPORT totalInputValue(B && b, DataAccess &access) {
+        int64_t total = 0;
+        RANGES_FOR(TxRef tx, b) {
+            total += totalInputValue(tx, access);
+        }
+        return total;
+    }
+    
+    CPP_template(typename B)(requires isInputPointerRange<B>)
+    inline int64_t BLOCKSCI_EXPORT totalInputValue(B && b, DataAccess &access) {
+        int64_t total = 0;
+        RANGES_FOR(const InputPointer &input, b) {
+            total += getValue(input, access);
+        }
+        return total;
+    }
+    
+    CPP_template(typename B)(requires isTxRefRange<B>)
+    inline int64_t BLOCKSCI_EXPORT totalOutputValue(B && b, DataAccess &access) {
+        int64_t total = 0;
+        RANGES_FOR(TxRef tx, b) {
+            total += totalOutputValue(tx, access);
+        }
+        return total;
+    }
+    
+    CPP_template(typename B)(requires isOutputPointerRange<B>)
+    inline int64_t BLOCKSCI_EXPORT totalOutputValue(B && b, DataAccess &access) {
+        int64_t total = 0;
+        RANGES_FOR(const OutputPointer &output, b) {
+            total += getValue(output, access);
+        }
+        return total;
+    }
+    
+    CPP_template(typename B)(requires isTxRefRange<B>)
+    inline int64_t BLOCKSCI_EXPORT totalFee(B && b, DataAccess &access) {
+        int64_t total = 0;
+        RANGES_FOR(TxRef tx, b) {
+            total += fee(tx, access);
+        }
+        return total;
+    }
+    
+    /** Total value of the unspent outputs among the refs, without materializing them */
+    CPP_template(typename B)(requires isOutputPointerRange<B>)
+    inline int64_t BLOCKSCI_EXPORT unspentValue(B && b, DataAccess &access) {
+        int64_t total = 0;
+        RANGES_FOR(const OutputPointer &output, b) {
+            if (!isSpent(output, access)) {
+                total += getValue(output, access);
+            }
+        }
+        return total;
+    }
 
     /** Calculate the total balance of a collection of outputs, optionally only up to a given block height */
     template <typename T>
@@ -215,7 +326,7 @@ namespace blocksci {
             }
         } else {
             RANGES_FOR(auto output, t) {
-                if (output.getBlockHeight() <= height && (!output.isSpent() || output.getSpendingTx()->getBlockHeight() > height)) {
+                if (output.getBlockHeight() <= height && (!output.isSpent() || *output.getSpendingBlockHeight() > height)) {
                     value += output.getValue();
                 }
             }
@@ -0,0 +1,127 @@
+//
+//  async_query.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_chain_async_query_hpp
+#define blocksci_chain_async_query_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/address/address.hpp>
+#include <blocksci/chain/output.hpp>
+#include <blocksci/chain/transaction.hpp>
+#include <blocksci/cluster/cluster_stats.hpp>
+#include <blocksci/core/typedefs.hpp>
+
+#include <range/v3/utility/optional.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace blocksci {
+    class Blockchain;
+    class Cluster;
+
+    struct BLOCKSCI_EXPORT AsyncQueryConfig {
+        /** Threads issuing the RocksDB reads and page faults of the queries, which mostly wait on storage */
+        unsigned ioThreads = 2;
+
+        /** Threads running the tasks submitted with AsyncQueryEngine::cpu */
+        unsigned cpuThreads = 2;
+
+        /** Transaction lookups answered by one batched read (RocksDB MultiGet and prefetched tx data) */
+        size_t maxBatchSize = 512;
+
+        /** Longest a lookup waits for its batch to fill up, which bounds the latency added by batching */
+        std::chrono::microseconds maxBatchDelay{250};
+
+        /** Queries queued or running at once, beyond which new ones are rejected with AsyncQueryOverloaded */
+        size_t maxPendingQueries = size_t{1} << 16;
+    };
+
+    /** Thrown by the query methods of AsyncQueryEngine when maxPendingQueries are outstanding */
+    class BLOCKSCI_EXPORT AsyncQueryOverloaded : public std::runtime_error {
+    public:
+        AsyncQueryOverloaded() : std::runtime_error("Too many pending queries") {}
+    };
+
+    /** Future returning queries of a Blockchain for servers answering many concurrent requests
+     *
+     * Lookups of transactions by number or hash are collected into batches of up to maxBatchSize, waiting at most
+     * maxBatchDelay, and answered together: hashes through one RocksDB MultiGet and the transaction data through
+     * getTransactions, which hints all of its pages to the kernel before touching them. Address and cluster queries
+     * run as individual tasks on the same IO threads. A few threads can so keep hundreds of requests in flight, while
+     * maxPendingQueries gives back pressure instead of unbounded queueing.
+     *
+     * The chain must outlive the engine and must not be reloaded while queries are pending. Destroying the engine
+     * waits for all queued queries to finish.
+     */
+    class BLOCKSCI_EXPORT AsyncQueryEngine {
+        struct Impl;
+        std::unique_ptr<Impl> impl;
+
+        void submitIo(std::function<void()> task);
+        void submitCpu(std::function<void()> task);
+
+        template <typename F>
+        static auto packageTask(F &&f) {
+            using Result = decltype(f());
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(f));
+            return std::make_pair(task, task->get_future());
+        }
+
+    public:
+        explicit AsyncQueryEngine(Blockchain &chain, const AsyncQueryConfig &config = {});
+        AsyncQueryEngine(const AsyncQueryEngine &) = delete;
+        AsyncQueryEngine &operator=(const AsyncQueryEngine &) = delete;
+        ~AsyncQueryEngine();
+
+        const AsyncQueryConfig &getConfig() const;
+
+        /** Queries submitted but not answered yet */
+        size_t pendingQueries() const;
+
+        /** The transaction with the given tx number, the future throws std::out_of_range for unknown numbers */
+        std::future<Transaction> tx(uint32_t txNum);
+
+        /** The transaction with the given hash, empty if the hash index doesn't contain it */
+        std::future<ranges::optional<Transaction>> txWithHash(const uint256 &hash);
+
+        /** All outputs sent to the address, read from the address index */
+        std::future<std::vector<Output>> addressOutputs(const Address &address);
+
+        /** Balance of the address at the given height, -1 for the end of the chain */
+        std::future<int64_t> addressBalance(const Address &address, BlockHeight height = -1);
+
+        /** Precomputed statistics of the cluster, @see Cluster::getStats. The clustering must outlive the query */
+        std::future<ClusterStats> clusterStats(const Cluster &cluster);
+
+        /** Run any blocking read of the chain on the IO threads */
+        template <typename F>
+        auto io(F &&f) -> std::future<decltype(f())> {
+            auto packaged = packageTask(std::forward<F>(f));
+            auto task = packaged.first;
+            submitIo([task]() { (*task)(); });
+            return std::move(packaged.second);
+        }
+
+        /** Run compute heavy work, eg. decoding the results of io queries, on the CPU threads */
+        template <typename F>
+        auto cpu(F &&f) -> std::future<decltype(f())> {
+            auto packaged = packageTask(std::forward<F>(f));
+            auto task = packaged.first;
+            submitCpu([task]() { (*task)(); });
+            return std::move(packaged.second);
+        }
+    };
+} // namespace blocksci
+
+#endif /* blocksci_chain_async_query_hpp */
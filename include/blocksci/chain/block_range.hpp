@@ -10,9 +10,16 @@
 #define block_range_hpp
 
 #include <blocksci/blocksci_export.h>
+#include <blocksci/address/address_fwd.hpp>
 #include <blocksci/chain/block.hpp>
+#include <blocksci/chain/work_pool.hpp>
+#include <blocksci/core/access_hint.hpp>
 
+#include <range/v3/utility/optional.hpp>
+
+#include <functional>
 #include <map>
+#include <memory>
 #include <type_traits>
 #include <future>
 
@@ -31,29 +38,19 @@ namespace blocksci {
             
             static constexpr bool value = decltype(test<F>(nullptr))::value;
         };
-        
-        template <typename ResultType, typename It, typename MapFunc, typename ReduceFunc>
-        ResultType BLOCKSCI_EXPORT mapReduceBlocksImp(It begin, It end, MapFunc mapFunc, ReduceFunc reduceFunc, int segmentBeginNum) {
-            auto segmentCount = static_cast<int>(std::distance(begin, end));
-            if(segmentCount == 1) {
-                ResultType res{};
-                auto ret = mapFunc(*begin, segmentBeginNum);
-                res = reduceFunc(res, ret);
-                return res;
-            } else {
-                auto mid = begin;
-                std::advance(mid, segmentCount / 2);
-                auto handle = std::async(std::launch::async, mapReduceBlocksImp<ResultType, It, MapFunc, ReduceFunc>, begin, mid, mapFunc, reduceFunc, segmentBeginNum);
-                ResultType res{};
-                auto ret2 = mapReduceBlocksImp<ResultType>(mid, end, mapFunc, reduceFunc, segmentBeginNum + segmentCount / 2);
-                auto ret1 = handle.get();
-                res = reduceFunc(res, ret1);
-                res = reduceFunc(res, ret2);
-                return res;
-            }
-        }
     }
 
+    /** What BlockRange::segment balances between the segments */
+    enum class SegmentWeight {
+        /** Number of transactions */
+        TxCount,
+        /** Number of inputs plus number of outputs, better for scans whose cost is dominated by the inouts */
+        InoutCount
+    };
+    
+    /** Caller supplied cost of processing a block, used to balance segments instead of a SegmentWeight */
+    using BlockCostFunc = std::function<uint64_t(const Block &)>;
+    
     /** Represents an iterable collection of contiguous Block objects */
     class BLOCKSCI_EXPORT BlockRange {
     public:
@@ -114,7 +111,29 @@ namespace blocksci {
         }
         
         BlockRange operator[](const Slice &slice) const {
-            return {{sl.start + slice.start, sl.start + slice.stop}, access};
+            return withSlice({sl.start + slice.start, sl.start + slice.stop});
+        }
+        
+        /** The same blocks, but a mapReduce over them throws OperationCancelled once token is cancelled */
+        BlockRange withCancellation(const CancellationToken &token) const {
+            auto range = withSlice(sl);
+            range.cancellation = &token;
+            return range;
+        }
+        
+        /** The same blocks, but segment and mapReduce balance the given weight between segments */
+        BlockRange withSegmentWeight(SegmentWeight weight) const {
+            auto range = withSlice(sl);
+            range.segmentWeight = weight;
+            range.segmentCost = nullptr;
+            return range;
+        }
+        
+        /** The same blocks, but segment and mapReduce balance the total cost of the blocks between segments */
+        BlockRange withSegmentCost(BlockCostFunc cost) const {
+            auto range = withSlice(sl);
+            range.segmentCost = std::make_shared<const BlockCostFunc>(std::move(cost));
+            return range;
         }
         
         BlockHeight size() const {
@@ -128,18 +147,37 @@ namespace blocksci {
             return this->operator[](size() - 1).endTxIndex();
         }
         
+        /** Map every chunk of the range and reduce the results in block order
+         *
+         * The range is split into chunks of similar transaction counts (see ParallelConfig), which the work pool of
+         * the chain runs with work stealing. mapFunc receives the chunk and its number in [0, chunkCount). Calls
+         * from inside another mapReduce run on the calling thread. */
         template <typename ResultType, typename MapFunc, typename ReduceFunc>
         std::enable_if_t<internal::is_callable<MapFunc, BlockRange, int>::value, ResultType>
         mapReduce(MapFunc mapFunc, ReduceFunc reduceFunc) {
-            auto segments = segment(std::thread::hardware_concurrency());
-            return internal::mapReduceBlocksImp<ResultType>(segments.begin(), segments.end(), mapFunc, reduceFunc, 0);
+            using MapType = decltype(mapFunc(std::declval<BlockRange &>(), 0));
+            auto chunks = segment(chunkCount());
+            std::vector<ranges::optional<MapType>> mapped(chunks.size());
+            runChunks(static_cast<uint32_t>(chunks.size()), [&](uint32_t chunkNum) {
+                // Check for reorgs and pre-fault the chunk's slice of tx_data.dat before scanning it
+                auto &chunk = chunks[chunkNum];
+                chunk.checkReorg();
+                chunk.adviseAccess(AccessHint::WillNeed);
+                mapped[chunkNum] = mapFunc(chunk, static_cast<int>(chunkNum));
+            });
+            ResultType res{};
+            for (auto &chunkResult : mapped) {
+                res = reduceFunc(res, *chunkResult);
+            }
+            return res;
         }
         
         template <typename ResultType, typename MapFunc, typename ReduceFunc>
         std::enable_if_t<internal::is_callable<MapFunc, BlockRange>::value, ResultType>
         mapReduce(MapFunc mapFunc, ReduceFunc reduceFunc) {
-            auto segments = segment(std::thread::hardware_concurrency());
-            return internal::mapReduceBlocksImp<ResultType>(segments.begin(), segments.end(), [&](const BlockRange &blocks, int) { return mapFunc(blocks); }, reduceFunc, 0);
+            return mapReduce<ResultType>([&](const BlockRange &blocks, int) {
+                return mapFunc(blocks);
+            }, reduceFunc);
         }
         
         template <typename ResultType, typename MapFunc, typename ReduceFunc>
@@ -193,16 +231,96 @@ namespace blocksci {
         
         std::vector<Block> filter(std::function<bool(const Block &block)> testFunc);
         std::vector<Transaction> filter(std::function<bool(const Transaction &tx)> testFunc);
+        
+        /** Sorted tx numbers of the transactions for which predicate returns true, evaluated in parallel
+         *
+         * Every chunk collects its matches locally, then the chunks are copied into the result at the offsets given by
+         * a prefix sum of their match counts. Cheaper than filter() when the matches are only looked at later or in
+         * batches (@see TxNumRange). */
+        template <typename Predicate>
+        std::vector<uint32_t> filterTxNums(Predicate predicate) {
+            auto chunks = segment(chunkCount());
+            std::vector<std::vector<uint32_t>> matches(chunks.size());
+            runChunks(static_cast<uint32_t>(chunks.size()), [&](uint32_t chunkNum) {
+                auto &chunk = chunks[chunkNum];
+                chunk.checkReorg();
+                chunk.adviseAccess(AccessHint::WillNeed);
+                auto &chunkMatches = matches[chunkNum];
+                for (auto block : chunk) {
+                    for (auto tx : block) {
+                        if (predicate(tx)) {
+                            chunkMatches.push_back(tx.txNum);
+                        }
+                    }
+                }
+            });
+            return concatenateChunks(matches);
+        }
 
-        // Returns a vector of [start, stop) intervals splitting the chain into segments with approximately the same number of segments
+        /** Blocks of the range that may use one of the addresses in an input or output, in order
+         *
+         * Only reads the per block address filters written by the parser's build-address-filters command, so a watch
+         * list scan over the returned blocks skips the transaction data of all others. A small fraction of the
+         * returned blocks don't use any of the addresses, and blocks not covered by the filters are always returned.
+         * Addresses match the top level address of an inout, not the addresses nested in multisig or P2SH scripts. */
+        std::vector<Block> blocksPossiblyTouching(const std::vector<Address> &addresses) const;
+        
+        /** Split the range into at most segmentCount contiguous segments of approximately equal weight, using the cost
+         * function or segment weight of this range (transaction count by default) */
         std::vector<BlockRange> segment(unsigned int segmentCount) const;
         
+        std::vector<BlockRange> segment(unsigned int segmentCount, SegmentWeight weight) const;
+        
+        /** Split the range into at most segmentCount segments of approximately equal total cost, calls cost once per block */
+        std::vector<BlockRange> segment(unsigned int segmentCount, const BlockCostFunc &cost) const;
+        
+        /** Apply an access hint to the transaction data (tx_data.dat and tx_index.dat) covered by this range
+         *
+         * WillNeed also charges the size of that data to the I/O limit of the current work scope (@see WorkScope),
+         * sleeping while the scope is over its budget. */
+        void adviseAccess(AccessHint hint) const;
+        
+        /** Load the transaction data of the range ahead of the queries that need it
+         *
+         * Splits the range with segment() into pieces of about 64MB of transaction data and runs adviseAccess(WillNeed)
+         * on them in block order on up to threadCount threads of the work pool (0 for the limit of the current work
+         * scope) at batch priority, so interactive queries overtake it. When tx_data.dat is fetched from object storage
+         * this copies its pages into the local cache. */
+        void prefetch(unsigned int threadCount = 0) const;
+        
+        /** Throw if the chain was loaded with errorOnReorg and the parser has replaced the last loaded block since
+         * (checked once per mapReduce chunk, the individual accessors don't check) */
+        void checkReorg() const;
+        
+        /** Number of chunks mapReduce splits this range into */
+        unsigned int chunkCount() const;
+        
+        /** Run task(chunkNum) for every chunk on the work pool of the chain, honoring the cancellation token */
+        void runChunks(uint32_t chunkCount, const std::function<void(uint32_t)> &task) const;
+        
+        /** Concatenate the per chunk results in order, copying the chunks in parallel */
+        std::vector<uint32_t> concatenateChunks(std::vector<std::vector<uint32_t>> &chunks) const;
+        
         Slice sl;
         
         DataAccess &getAccess() { return *access; }
         
     private:
         DataAccess *access;
+        const CancellationToken *cancellation = nullptr;
+        SegmentWeight segmentWeight = SegmentWeight::TxCount;
+        std::shared_ptr<const BlockCostFunc> segmentCost;
+        
+        /** Range over other blocks, keeping the mapReduce settings of this range */
+        BlockRange withSlice(const Slice &slice) const {
+            auto range = *this;
+            range.sl = slice;
+            return range;
+        }
+        
+        /** Split into segments of approximately equal cumulative(stop) - cumulative(start), where cumulative(height)
+         * is the nondecreasing total weight of the blocks of the range below height */
+        std::vector<BlockRange> segmentByWeight(unsigned int segmentCount, const std::function<uint64_t(BlockHeight)> &cumulative) const;
         
         
     };
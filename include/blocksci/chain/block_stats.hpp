@@ -0,0 +1,76 @@
+//
+//  block_stats.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_block_stats_hpp
+#define blocksci_block_stats_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/chain/chain_fwd.hpp>
+#include <blocksci/core/address_types.hpp>
+#include <blocksci/core/typedefs.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace blocksci {
+    class DataAccess;
+
+    /** Aggregates over the transactions of one block, stored in chain/block_stats.dat
+     *
+     * The parser appends the record of every block right after writing block.dat, so dashboards over the whole chain
+     * read one record per block instead of scanning every transaction. Also available without copying through
+     * columnData(ChainColumn::BlockStats, access).
+     */
+    struct BLOCKSCI_EXPORT BlockStats {
+        /** Total fee in satoshis paid by the transactions of the block */
+        int64_t totalFee;
+
+        /** Total value in satoshis of the outputs of the block, including the coinbase */
+        int64_t totalOutputValue;
+
+        /** Total value in satoshis of the outputs spent by the block */
+        int64_t totalInputValue;
+
+        /** Sum of the virtual sizes of the transactions paying a fee, ie. all but the coinbase */
+        uint64_t feeVirtualSize;
+
+        uint32_t timestamp;
+        uint32_t txCount;
+        uint32_t inputCount;
+        uint32_t outputCount;
+
+        /** Number of transactions with witness data */
+        uint32_t segwitTxCount;
+
+        /** Serialized size of the block in bytes */
+        uint32_t size;
+
+        /** Weight of the block, 3 * base size + serialized size */
+        uint32_t weight;
+
+        /** Number of outputs of every address type, indexed by AddressType::Enum */
+        uint32_t outputTypeCounts[AddressType::size];
+
+        /** Average fee rate in satoshis per virtual byte of the transactions paying a fee */
+        double averageFeeRate() const {
+            return feeVirtualSize > 0 ? static_cast<double>(totalFee) / static_cast<double>(feeVirtualSize) : 0;
+        }
+
+        /** Fraction of the transactions with witness data */
+        double segwitShare() const {
+            return txCount > 0 ? static_cast<double>(segwitTxCount) / txCount : 0;
+        }
+    };
+
+    /** Check whether chain/block_stats.dat covers all loaded blocks */
+    bool BLOCKSCI_EXPORT hasBlockStats(DataAccess &access);
+
+    /** Precomputed statistics of every block, in order. Throws if block_stats.dat doesn't cover the blocks */
+    std::vector<BlockStats> BLOCKSCI_EXPORT blockStats(BlockRange &blocks);
+} // namespace blocksci
+
+#endif /* blocksci_block_stats_hpp */
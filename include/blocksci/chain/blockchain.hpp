@@ -12,25 +12,59 @@
 #include <blocksci/blocksci_export.h>
 #include <blocksci/address/address_fwd.hpp>
 #include <blocksci/chain/block_range.hpp>
+#include <blocksci/chain/chain_view.hpp>
+#include <blocksci/chain/derived_column.hpp>
+#include <blocksci/chain/mempool_snapshot.hpp>
+#include <blocksci/chain/spend_graph.hpp>
+#include <blocksci/chain/utxo_set.hpp>
+#include <blocksci/core/access_hint.hpp>
+#include <blocksci/core/access_stats.hpp>
+#include <blocksci/scripts/scripts_fwd.hpp>
 
+#include <chrono>
 #include <map>
 #include <type_traits>
+#include <utility>
 #include <future>
+#include <vector>
 
 namespace blocksci {
     struct DataConfiguration;
     class DataAccess;
     
+    /** Version of the chain manifest that the parser publishes after every update, 0 for the latest one */
+    struct ChainSnapshot {
+        uint64_t version = 0;
+    };
+    
     class BLOCKSCI_EXPORT Blockchain : public BlockRange {
-        /** Pointer to the DataAccess instance that manages all data access objects (ChainAccess, ScriptAccess etc.) for this chain */
-        std::unique_ptr<DataAccess> access;
+        /** Pointer to the DataAccess instance that manages all data access objects (ChainAccess, ScriptAccess etc.) for this chain,
+         * shared with the other Blockchains opened from the same config file */
+        std::shared_ptr<DataAccess> access;
     public:
         
         Blockchain() = default;
         Blockchain(std::unique_ptr<DataAccess> access_);
+        Blockchain(std::shared_ptr<DataAccess> access_);
+        
+        /** Open the chain with its own DataAccess, which isn't shared with other Blockchains */
         explicit Blockchain(const DataConfiguration &config);
+        
+        /** Open the chain described by the config file
+         *
+         * Opening a chain that is already open in the process with the same config file and arguments only returns a new
+         * handle on the same data files, indexes and caches, so it is cheap and uses next to no memory. The handles
+         * share reload() (each keeps its own block count until it reloads itself), the parallelism, the memory budget,
+         * the access hints and resident mode. */
         explicit Blockchain(const std::string &configPath);
         Blockchain(const std::string &configPath, BlockHeight maxBlock);
+        
+        /** Open the chain as it was after the parser update that published the snapshot
+         *
+         * Only the data of that update is visible, so scans see a consistent chain while the parser keeps appending
+         * blocks, and reload() keeps the view. Throws ReorgException if the snapshot has been rolled back since. The
+         * address and hash indexes aren't versioned and can return results for newer blocks. */
+        Blockchain(const std::string &configPath, ChainSnapshot snapshot);
         ~Blockchain();
         
         std::string dataLocation() const;
@@ -39,7 +73,150 @@ namespace blocksci {
         void reload();
         bool isParserRunning();
         
+        /** Throw if the chain was loaded with errorOnReorg and the last loaded block has been replaced since
+         * (the individual accessors don't check, mapReduce checks once per chunk) */
+        void checkReorg() const;
+        
+        /** Number of blocks the parser has written to disk, larger than size() once new blocks arrived since the last
+         * reload. Cheap enough to poll */
+        BlockHeight diskBlockCount() const;
+        
+        /** Counter the parser increments around every update of the data directory, 0 for data of older parsers */
+        uint64_t dataGeneration() const;
+        
+        /** Manifest version the chain is pinned to, 0 if it loads everything on disk */
+        uint64_t snapshotVersion() const;
+        
+        /** Version of the most recent snapshot the parser published, 0 if there is none */
+        uint64_t latestSnapshotVersion() const;
+        
+        /** Apply an access hint (madvise) to one of the chain/ data files, eg. Sequential on TxData before full scans */
+        void setAccessHint(ChainColumn column, AccessHint hint);
+        
+        /** Apply an access hint to all chain/ data files */
+        void setAccessHint(AccessHint hint);
+        
+        /** Thread count and chunking of mapReduce on this chain. Replaces the work pool, so it must not be called while
+         * a mapReduce is running */
+        void setParallelism(const ParallelConfig &config);
+        
+        ParallelConfig parallelism() const;
+        
+        /** Count how often transactions look up each lazily resolved TxData column (version, hash and the input
+         * columns) from now on, resetting the counts, or stop counting. Tells which column files a workload touches */
+        void setTrackTxColumnAccess(bool track);
+        
+        /** Lookups counted since setTrackTxColumnAccess(true) */
+        TxColumnAccessStats txColumnAccessStats() const;
+        
+        /** Hot-path access counters (tx decodes, script loads, index lookups and iterator steps) of all threads
+         *
+         * The counters are process-wide, so they include the accesses to other chains open in the same process. They
+         * are only collected by builds configured with -DBLOCKSCI_INSTRUMENTATION=ON, @see AccessStats::enabled */
+        AccessStats stats() const;
+        
+        /** Transactions within depth hops upstream of the given ones (following inputs to the txes they spend), @see spendNeighborhood */
+        TxSet ancestors(const std::vector<uint32_t> &txNums, uint32_t depth, const SpendEdgeFilter &filter = {});
+        
+        /** Transactions within depth hops downstream of the given ones (following outputs to the txes spending them) */
+        TxSet descendants(const std::vector<uint32_t> &txNums, uint32_t depth, const SpendEdgeFilter &filter = {});
+        
+        /** Outputs that are unspent right before the block at height is mined, in one parallel scan, @see blocksci::utxoSetAt */
+        OutputSet utxoSetAt(BlockHeight height);
+        
+        /** Outputs added to and removed from the UTXO set by the blocks [startHeight, endHeight) */
+        UTXOSetDelta utxoSetDelta(BlockHeight startHeight, BlockHeight endHeight);
+        
+        /** Register the definition of a derived column for this process, replacing one with the same name */
+        void registerDerivedColumn(DerivedColumnSpec spec);
+        
+        /** Compute the registered derived columns for the blocks they don't cover yet. Columns whose version changed or
+         * whose covered blocks were reorged out are recomputed from the genesis block, along with their dependents */
+        void updateDerivedColumns();
+        
+        /** Stored values of a derived column, which can be read without registering it */
+        DerivedColumn derivedColumn(const std::string &name);
+        
+        /** Resident mode: copy block.dat, firstInput.dat, firstOutput.dat and tx_index.dat into huge page backed memory
+         * (falling back to regular pages) and optionally mlock tx_data.dat. Returns how much memory is held. The copies
+         * are spread over the NUMA nodes according to placement. */
+        ResidentMemoryStats makeResident(bool lockTxData = false, NumaPlacement placement = NumaPlacement::Default);
+        
+        /** Memory currently held by resident mode */
+        ResidentMemoryStats residentMemoryStats() const;
+        
+        /** Page cache residency (mincore) of every data file of this chain, in warmup priority order.
+         * Useful to record whether a benchmark ran against a warm or a cold data directory */
+        std::vector<FileResidency> pageCacheResidency() const;
+        
+        /** Memory held by the chain per subsystem: mapped data files, RocksDB memtables, table readers and block
+         * caches of the open indexes, the in-memory chain indexes and resident mode copies. Maps every data file to
+         * count its resident pages, so it is too slow to call per query */
+        MemoryUsage memoryUsage() const;
+        
+        /** Limit the memory of the chain (MemoryUsage::totalBytes) to the given number of bytes, 0 for no limit.
+         * Overrides the "memoryBudgetMB" config entry. The budget is enforced on every reload() */
+        void setMemoryBudget(uint64_t bytes);
+        
+        uint64_t memoryBudget() const;
+        
+        /** Shrink the RocksDB block caches and drop cold data files from their mappings (madvise MADV_DONTNEED) until
+         * the chain fits into its memory budget */
+        MemoryBudgetResult enforceMemoryBudget();
+        
         uint32_t addressCount(AddressType::Enum type) const;
+        
+        /** Number of outputs sent to each address of the type, indexed by scriptNum (entry 0 is unused)
+         *
+         * Scans the address index in parallel on threadCount threads (0 for one per hardware thread) instead of
+         * looking up the addresses one by one. */
+        std::vector<uint32_t> addressOutputCounts(AddressType::Enum type, uint32_t threadCount = 0) const;
+        
+        /** Pairs (txNum in this chain, txNum in other) of the transactions with the same hash in both chains, in hash order
+         *
+         * Merges the hash sorted transactions of both chains in one pass on threadCount threads (0 for one per hardware
+         * thread), using the tx hash orders written by the build-tx-hash-order parser command where they exist. */
+        std::vector<std::pair<uint32_t, uint32_t>> matchTransactions(const Blockchain &other, uint32_t threadCount = 0) const;
+        
+        /** The chain as of the given number of blocks, a view sharing the open data files and indexes of this chain
+         *
+         * Much cheaper than constructing a Blockchain with a max block for every height of a time series. Throws
+         * std::out_of_range if height is negative or larger than size(). */
+        ChainView asOf(BlockHeight height);
+        
+        /** Blocks mined in the time range [start, end), found through an index of the block timestamps
+         *
+         * Block timestamps are only roughly ordered, the range starts at the first block with a timestamp at or after
+         * start and ends before the first block with a timestamp at or after end. */
+        BlockRange range(std::chrono::system_clock::time_point start, std::chrono::system_clock::time_point end) const;
+        
+        /** All OP_RETURN outputs whose payload begins with prefix in the order they appear in the chain
+         *
+         * Reads the nulldata index, which has to be built with blocksci_parser build-nulldata-index. */
+        std::vector<script::OpReturn> nulldataWithPrefix(const std::string &prefix) const;
+        
+        /** Unconfirmed txes in the last snapshot of the mempool recorder, with their packages and projected blocks
+         *
+         * Throws std::runtime_error if the recorder hasn't written a snapshot. The snapshot is memory mapped, call
+         * again to see newer ones. */
+        MempoolSnapshot pendingTransactions() const;
+    };
+    
+    /** Records the access counters on construction, delta() returns the accesses since, eg.
+     *
+     *     AccessProfile profile{chain};
+     *     runQuery(chain);
+     *     auto decodes = profile.delta()[AccessEvent::TxDecode].count;
+     */
+    class BLOCKSCI_EXPORT AccessProfile {
+        const Blockchain &chain;
+        AccessStats start;
+    public:
+        explicit AccessProfile(const Blockchain &chain_) : chain(chain_), start(chain_.stats()) {}
+        
+        AccessStats delta() const {
+            return chain.stats() - start;
+        }
     };
     
     uint32_t BLOCKSCI_EXPORT txCount(Blockchain &chain);
@@ -0,0 +1,81 @@
+//
+//  bulk_scan.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_chain_bulk_scan_hpp
+#define blocksci_chain_bulk_scan_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/chain/chain_fwd.hpp>
+#include <blocksci/chain/output_pointer.hpp>
+#include <blocksci/core/address_types.hpp>
+#include <blocksci/core/typedefs.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace blocksci {
+    class Address;
+
+    /** Hardware running a bulk scan */
+    enum class BLOCKSCI_EXPORT ScanBackend {
+        /** CUDA if cudaScanAvailable(), else the CPU */
+        Auto,
+        Cpu,
+        /** Throws std::runtime_error if cudaScanAvailable() is false */
+        Cuda
+    };
+
+    struct BLOCKSCI_EXPORT BulkScanOptions {
+        ScanBackend backend = ScanBackend::Auto;
+
+        /** Rows of each column copied to the GPU per transfer. Two chunks are in flight at once, one being copied while
+         * the kernels run on the other, and each is staged through pinned host memory of this size */
+        uint64_t gpuChunkRows = uint64_t{1} << 24;
+    };
+
+    /** Whether BlockSci was built with -DBLOCKSCI_CUDA=ON and a CUDA device is present */
+    bool BLOCKSCI_EXPORT cudaScanAvailable();
+
+    /** Buckets of outputValueHistogram */
+    constexpr size_t outputValueBucketCount = 64;
+
+    /** Number of outputs by order of magnitude of their value: bucket 0 holds the outputs without value and bucket i
+     * those with a value in [2^(i-1), 2^i) satoshis */
+    std::array<uint64_t, outputValueBucketCount> BLOCKSCI_EXPORT outputValueHistogram(BlockRange &blocks, const BulkScanOptions &options = {});
+
+    /** Outputs of every address type within consecutive buckets of blocks */
+    struct BLOCKSCI_EXPORT OutputTypeMix {
+        /** First height of every bucket */
+        std::vector<BlockHeight> bucketStarts;
+
+        /** Number and total value of the outputs of each type in each bucket, indexed by AddressType::Enum */
+        std::vector<std::array<uint64_t, AddressType::size>> counts;
+        std::vector<std::array<int64_t, AddressType::size>> values;
+    };
+
+    /** Number and value of the outputs of each address type in buckets of bucketBlocks blocks, the last one possibly
+     * shorter. Throws std::invalid_argument if bucketBlocks isn't positive */
+    OutputTypeMix BLOCKSCI_EXPORT outputTypeMix(BlockRange &blocks, BlockHeight bucketBlocks, const BulkScanOptions &options = {});
+
+    /** Every output of the blocks sent to one of the addresses, in chain order
+     *
+     * Probes a hash table of the addresses with the address type and number of every output. Unlike the address index
+     * the cost doesn't depend on the number of addresses, so this is the faster way to check watch lists of many
+     * thousands of addresses against a range of blocks. */
+    std::vector<OutputPointer> BLOCKSCI_EXPORT probeOutputAddresses(BlockRange &blocks, const std::vector<Address> &addresses, const BulkScanOptions &options = {});
+
+    /** Fee rates in satoshis per virtual byte at the given quantiles (from 0 to 1) of the fee paying transactions
+     *
+     * The rates are counted in a histogram with 64 buckets per doubling between 2^-8 and 2^24 sat/vB, so each result is
+     * within 0.6% of the exact quantile. Transactions without a fee, including the coinbases, are left out and the
+     * results are 0 if no transaction pays a fee. Throws std::invalid_argument for quantiles outside of [0, 1]. */
+    std::vector<double> BLOCKSCI_EXPORT feeRateQuantiles(BlockRange &blocks, const std::vector<double> &quantiles, const BulkScanOptions &options = {});
+} // namespace blocksci
+
+#endif /* blocksci_chain_bulk_scan_hpp */
@@ -12,11 +12,13 @@ namespace blocksci {
     class ChainAccess;
     class Blockchain;
     class BlockRange;
+    class ChainView;
     class Block;
     class TransactionRange;
     class Transaction;
     struct OutputRange;
     class Output;
+    struct OutputColumns;
     struct InputRange;
     class Input;
     
@@ -0,0 +1,93 @@
+//
+//  chain_table.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_chain_chain_table_hpp
+#define blocksci_chain_chain_table_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/core/typedefs.hpp>
+
+#include <range/v3/utility/optional.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace blocksci {
+    class BlockRange;
+
+    /** Tables buildChainTable can produce, with one row per block, transaction, input or output */
+    enum class BLOCKSCI_EXPORT ChainTable {
+        Blocks, Transactions, Inputs, Outputs
+    };
+
+    /** Storage of the values of a ChainTableColumn, Hash columns hold 32 raw bytes in internal byte order */
+    enum class BLOCKSCI_EXPORT TableColumnType {
+        Int64, Int32, UInt32, UInt16, UInt8, Bool, Hash
+    };
+
+    BLOCKSCI_EXPORT size_t tableColumnElementSize(TableColumnType type);
+
+    struct BLOCKSCI_EXPORT ChainTableColumn {
+        std::string name;
+        TableColumnType type;
+
+        /** Values of all rows in chain order, packed without padding like an Arrow fixed width buffer */
+        std::vector<uint8_t> data;
+
+        size_t size() const {
+            return data.size() / tableColumnElementSize(type);
+        }
+    };
+
+    /** Names of the columns of the table in their default order */
+    BLOCKSCI_EXPORT std::vector<std::string> chainTableColumns(ChainTable table);
+
+    /** The requested columns (all for an empty list) of every row of the table within range
+     *
+     * All columns are filled in a single parallel pass over the chunks of the range, so asking for many columns at once
+     * is much cheaper than one conversion per column. Throws std::invalid_argument for unknown column names.
+     *
+     * Column values: block and tx index/height, hashes, sizes, counts and values in satoshi. Inputs and outputs have
+     * the address_type and address_num of their address, inputs the tx_index and block height of the spent output
+     * (spent_tx_index, spent_height) and outputs the spending_tx_index and spent_height, which are -1 if unspent.
+     */
+    BLOCKSCI_EXPORT std::vector<ChainTableColumn> buildChainTable(BlockRange &range, ChainTable table, const std::vector<std::string> &columns = {});
+
+    /** Rows of the blocks [start, stop) of a ChainTableStream */
+    struct BLOCKSCI_EXPORT ChainTableBatch {
+        BlockHeight start;
+        BlockHeight stop;
+        std::vector<ChainTableColumn> columns;
+    };
+
+    /** Builds a table in batches of whole blocks on a background thread, so that a consumer can process one batch while
+     * the next is filled instead of holding the table for the whole range in memory
+     *
+     * Batches hold as many blocks as fit into batchRows rows, at least one. Each is built by buildChainTable, so in
+     * parallel, and the producer runs at most prefetch batches ahead of the consumer. The range's chain must outlive the
+     * stream, destroying it stops the producer once its current batch is done.
+     */
+    class BLOCKSCI_EXPORT ChainTableStream {
+        struct Impl;
+        std::unique_ptr<Impl> impl;
+
+    public:
+        /** Throws std::invalid_argument for unknown column names or a batch size of zero */
+        ChainTableStream(const BlockRange &range, ChainTable table, std::vector<std::string> columns, uint64_t batchRows, size_t prefetch = 2);
+        ChainTableStream(const ChainTableStream &) = delete;
+        ChainTableStream &operator=(const ChainTableStream &) = delete;
+        ~ChainTableStream();
+
+        /** Waits for the next batch, nullopt once every block was returned. Rethrows errors of the producer */
+        ranges::optional<ChainTableBatch> next();
+    };
+} // namespace blocksci
+
+#endif /* blocksci_chain_chain_table_hpp */
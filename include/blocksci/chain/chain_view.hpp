@@ -0,0 +1,72 @@
+//
+//  chain_view.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_chain_chain_view_hpp
+#define blocksci_chain_chain_view_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/address/address_fwd.hpp>
+#include <blocksci/chain/block_range.hpp>
+#include <blocksci/chain/output.hpp>
+#include <blocksci/chain/output_pointer.hpp>
+#include <blocksci/cluster/cluster_fwd.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace blocksci {
+    /** The chain as it was when the block at height - 1 was mined, a BlockRange over the blocks below height that
+     * shares the DataAccess of the Blockchain it was created from (@see Blockchain::asOf)
+     *
+     * Creating a view only looks up the end tx of its last block, so comparing many heights doesn't reopen the data
+     * files and indexes the way constructing a Blockchain with a max block does. The address index and the clusterings
+     * aren't versioned, so address and cluster queries run against the whole chain and the view drops every output,
+     * spend and address from txes at or after endTxNum(). Clusters themselves can hold links made by later blocks.
+     *
+     * The view holds a pointer to the DataAccess of its chain, which has to outlive it.
+     */
+    class BLOCKSCI_EXPORT ChainView : public BlockRange {
+        uint32_t txBound;
+
+    public:
+        ChainView(BlockHeight height, DataAccess *access_);
+
+        /** Number of blocks in the view, the height of the first block it leaves out */
+        BlockHeight height() const {
+            return sl.stop;
+        }
+
+        /** Number of txes in the view, every tx number below is part of it */
+        uint32_t endTxNum() const {
+            return txBound;
+        }
+
+        bool containsTx(uint32_t txNum) const {
+            return txNum < txBound;
+        }
+
+        /** Whether the script of the address first appeared in a tx in the view */
+        bool containsAddress(const Address &address) const;
+
+        /** Outputs sent to the address by txes in the view */
+        std::vector<Output> outputs(const Address &address) const;
+
+        /** Value of the outputs sent to the address in the view that no tx in the view spent */
+        int64_t balance(const Address &address) const;
+
+        /** Balances of the addresses, computed on threadCount threads (0 for one per hardware thread) */
+        std::vector<int64_t> balances(const std::vector<Address> &addresses, uint32_t threadCount = 0) const;
+
+        /** Addresses of the cluster whose script first appeared in a tx in the view */
+        std::vector<Address> clusterAddresses(const Cluster &cluster) const;
+
+        /** Balance of the cluster in the view, see Cluster::calculateBalanceBeforeTx */
+        int64_t clusterBalance(const Cluster &cluster) const;
+    };
+} // namespace blocksci
+
+#endif /* blocksci_chain_chain_view_hpp */
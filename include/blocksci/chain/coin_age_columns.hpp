@@ -0,0 +1,119 @@
+//
+//  coin_age_columns.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_coin_age_columns_hpp
+#define blocksci_coin_age_columns_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/chain/chain_fwd.hpp>
+#include <blocksci/core/typedefs.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace blocksci {
+    class DataAccess;
+
+    /** Columnar view of the outputs spent by a contiguous range of inputs, backed by the optional
+     * chain/input_spent_height.dat and chain/input_spent_value.dat files
+     *
+     * Finding the age of a spent output otherwise needs a block height lookup of the spent transaction for every input.
+     * The columns are written along with the output columns by "blocksci_parser build-output-columns" and extended by
+     * later parser updates. Element i of the view is input firstInputNum + i, numbered like tx.inputs() for every
+     * transaction in chain order.
+     */
+    struct BLOCKSCI_EXPORT InputAgeColumns {
+        /** Height of the block containing the output spent by every input */
+        const uint32_t *spentHeights = nullptr;
+
+        /** Value in satoshis of the output spent by every input */
+        const int64_t *spentValues = nullptr;
+
+        /** Blockchain-wide number of the first input in the view */
+        uint64_t firstInputNum = 0;
+
+        /** Number of inputs in the view */
+        uint64_t count = 0;
+
+        uint64_t size() const {
+            return count;
+        }
+
+        bool empty() const {
+            return count == 0;
+        }
+
+        BlockHeight getSpentHeight(uint64_t i) const {
+            return static_cast<BlockHeight>(spentHeights[i]);
+        }
+
+        int64_t getSpentValue(uint64_t i) const {
+            return spentValues[i];
+        }
+
+        /* Plain loops over the columns like the aggregations of OutputColumns */
+
+        /** Sum over the inputs of the value in satoshis times the number of blocks between the spent output and height */
+        double valueBlocksDestroyed(BlockHeight height) const {
+            double total = 0;
+            for (uint64_t i = 0; i < count; i++) {
+                total += static_cast<double>(spentValues[i]) * static_cast<double>(static_cast<int64_t>(height) - spentHeights[i]);
+            }
+            return total;
+        }
+
+        int64_t totalSpentValue() const {
+            int64_t total = 0;
+            for (uint64_t i = 0; i < count; i++) {
+                total += spentValues[i];
+            }
+            return total;
+        }
+    };
+
+    /** Coin age statistics of the inputs of one block, stored in chain/block_coin_age.dat
+     *
+     * Ages in days are measured between the timestamps of the spending block and the block of the spent output and are
+     * clamped at 0, since block timestamps are only roughly ordered. */
+    struct BLOCKSCI_EXPORT BlockCoinAge {
+        /** Total value in satoshis of the outputs spent by the block */
+        int64_t spentValue;
+
+        /** Sum over the inputs of the spent value in coins times its age in days */
+        double coinDaysDestroyed;
+
+        /** Sum over the inputs of the number of blocks since the spent output was mined */
+        uint64_t totalInputAge;
+
+        uint32_t inputCount;
+        uint32_t reserved;
+
+        /** Average age in days of the spent coins, weighted by value */
+        double dormancy() const {
+            return spentValue > 0 ? coinDaysDestroyed / (static_cast<double>(spentValue) / 1e8) : 0;
+        }
+
+        /** Average number of blocks since the spent outputs were mined */
+        double meanInputAge() const {
+            return inputCount > 0 ? static_cast<double>(totalInputAge) / inputCount : 0;
+        }
+    };
+
+    /** Check whether the coin age columns exist and cover all loaded blocks and inputs */
+    bool BLOCKSCI_EXPORT hasCoinAgeColumns(DataAccess &access);
+
+    /** Coin age columns of all inputs of the transaction. Throws if the columns are not available */
+    InputAgeColumns BLOCKSCI_EXPORT inputAgeColumns(const Transaction &tx);
+
+    /** Coin age columns of all inputs of the blocks */
+    InputAgeColumns BLOCKSCI_EXPORT inputAgeColumns(BlockRange &blocks);
+
+    /** Precomputed coin age statistics of every block, in order. Throws if the columns are not available */
+    std::vector<BlockCoinAge> BLOCKSCI_EXPORT blockCoinAges(BlockRange &blocks);
+} // namespace blocksci
+
+#endif /* blocksci_coin_age_columns_hpp */
@@ -0,0 +1,78 @@
+//
+//  column_data.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_chain_column_data_hpp
+#define blocksci_chain_column_data_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/core/access_hint.hpp>
+#include <blocksci/core/input_signature.hpp>
+#include <blocksci/core/typedefs.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace blocksci {
+    class DataAccess;
+
+    /** Memory of one fixed size column of the chain/ directory, element i describing block, transaction, input or
+     * output number i */
+    struct BLOCKSCI_EXPORT ColumnData {
+        const void *data = nullptr;
+
+        /** Number of elements covering the loaded chain */
+        uint64_t count = 0;
+
+        /** Size of an element in bytes, for Block the size of a RawBlock, for BlockStats the size of a BlockStats and 1 for
+         * TxData */
+        uint32_t elementSize = 0;
+    };
+
+    /** The elements of a column for all loaded blocks, transactions, inputs or outputs, without copying
+     *
+     * Points into the file mapping (or the resident copy) of the column, so it is only valid until the chain is
+     * reloaded. Supported are Block (RawBlock), BlockStats (BlockStats), TxVersion, FirstInput, FirstOutput,
+     * InputSpentOutNum, Sequence, TxHashes, TxIndex (the int64_t offset of every RawTransaction in TxData), TxData (the
+     * bytes holding the loaded txes, unless it is read through the paged backend) and the optional output and fee
+     * columns. Throws std::invalid_argument for the variable sized Coinbase file and std::runtime_error if the
+     * uncompressed file doesn't cover the loaded chain (eg. an optional column that was never built).
+     *
+     * column_abi.h hands out the same memory to C callers.
+     */
+    ColumnData BLOCKSCI_EXPORT columnData(ChainColumn column, DataAccess &access);
+
+    /** Signatures of the consecutive inputs firstInput, ..., firstInput + count - 1 */
+    struct BLOCKSCI_EXPORT InputSignatureColumn {
+        const InputSignature *data = nullptr;
+        uint64_t firstInput = 0;
+        uint64_t count = 0;
+    };
+
+    /** The signatures of all inputs of the blocks [start, stop), without copying
+     *
+     * Read from the optional chain/input_signatures.dat file written by the parser with extractSignatures enabled, and
+     * only valid until the chain is reloaded. Throws std::runtime_error if the file doesn't cover the blocks.
+     */
+    InputSignatureColumn BLOCKSCI_EXPORT inputSignatureColumn(BlockHeight start, BlockHeight stop, DataAccess &access);
+
+    /** Witness item counts and serialized witness sizes (@see RawWitness) of the consecutive inputs firstInput, ... */
+    struct BLOCKSCI_EXPORT WitnessSizeColumn {
+        std::vector<uint32_t> itemCounts;
+        std::vector<uint32_t> serializedSizes;
+        uint64_t firstInput = 0;
+    };
+
+    /** The witness sizes of all inputs of the blocks [start, stop), gathered on threadCount threads (0 for one per
+     * hardware thread)
+     *
+     * Read from the optional chain/witness files written by the parser with recordWitnesses enabled, which works with
+     * both the full and the size-only variant. Throws std::runtime_error if the files don't cover the blocks.
+     */
+    WitnessSizeColumn BLOCKSCI_EXPORT witnessSizeColumn(BlockHeight start, BlockHeight stop, DataAccess &access, uint32_t threadCount = 0);
+} // namespace blocksci
+
+#endif /* blocksci_chain_column_data_hpp */
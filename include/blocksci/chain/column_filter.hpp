@@ -0,0 +1,73 @@
+//
+//  column_filter.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_chain_column_filter_hpp
+#define blocksci_chain_column_filter_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/chain/chain_fwd.hpp>
+#include <blocksci/chain/output_pointer.hpp>
+#include <blocksci/core/raw_address.hpp>
+
+#include <range/v3/utility/optional.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace blocksci {
+    /** Conjunction of constraints on the txes or outputs of a block range that can be checked without loading them
+     *
+     * Heights narrow the range of blocks, fees, values and address types are read from the tx fee and output columns
+     * (scanning the txes or outputs themselves if the columns weren't built) and addresses are looked up in the
+     * address index, so only the matches are ever materialized. The Python proxies build one from where predicates.
+     */
+    struct BLOCKSCI_EXPORT ColumnFilter {
+        enum class Column : uint8_t {
+            /** Height of the block of a tx or output */
+            Height,
+            /** Fee of a tx */
+            TxFee,
+            /** Value of an output */
+            OutputValue,
+            /** AddressType::Enum of an output */
+            OutputAddressType
+        };
+
+        /** The column lies in [min, max] */
+        struct Bound {
+            Column column;
+            int64_t min = std::numeric_limits<int64_t>::min();
+            int64_t max = std::numeric_limits<int64_t>::max();
+        };
+
+        std::vector<Bound> bounds;
+
+        /** If set, outputs must be sent to one of the addresses */
+        ranges::optional<std::vector<RawAddress>> addresses;
+
+        /** Whether the filter constrains columns of txes, the height constrains txes and outputs alike */
+        bool constrainsTxes() const;
+
+        /** Whether the filter constrains columns or addresses of outputs */
+        bool constrainsOutputs() const;
+    };
+
+    /** Sorted tx numbers of the txes of the blocks matching the filter, evaluated in parallel
+     *
+     * Throws std::invalid_argument if the filter constrains outputs. */
+    std::vector<uint32_t> BLOCKSCI_EXPORT txNumsMatching(BlockRange &blocks, const ColumnFilter &filter);
+
+    /** Outputs of the blocks matching the filter in chain order, evaluated in parallel
+     *
+     * Without values, address types or addresses to check every output of the blocks of matching height is returned,
+     * iterate over the outputs of those blocks instead to avoid materializing them. Throws std::invalid_argument if the
+     * filter constrains txes. */
+    std::vector<OutputPointer> BLOCKSCI_EXPORT outputsMatching(BlockRange &blocks, const ColumnFilter &filter);
+} // namespace blocksci
+
+#endif /* blocksci_chain_column_filter_hpp */
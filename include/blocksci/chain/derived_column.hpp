@@ -0,0 +1,219 @@
+//
+//  derived_column.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_chain_derived_column_hpp
+#define blocksci_chain_derived_column_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/chain/block.hpp>
+#include <blocksci/chain/input.hpp>
+#include <blocksci/chain/output.hpp>
+#include <blocksci/chain/transaction.hpp>
+#include <blocksci/core/typedefs.hpp>
+
+#include <range/v3/range_for.hpp>
+#include <range/v3/utility/optional.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace blocksci {
+    class DataAccess;
+
+    /** Objects a derived column has one value for */
+    enum class BLOCKSCI_EXPORT DerivedColumnLevel : uint8_t {
+        Block, Tx, Input, Output
+    };
+
+    /** Element type of a derived column, all of them are read as int64_t by DerivedColumn::operator[] */
+    enum class BLOCKSCI_EXPORT DerivedColumnType : uint8_t {
+        Int64, UInt32, UInt16, UInt8
+    };
+
+    size_t BLOCKSCI_EXPORT derivedColumnElementSize(DerivedColumnType type);
+
+    template <typename T>
+    struct DerivedColumnTypeOf;
+
+    template <>
+    struct DerivedColumnTypeOf<int64_t> {
+        static constexpr DerivedColumnType value = DerivedColumnType::Int64;
+    };
+
+    template <>
+    struct DerivedColumnTypeOf<uint32_t> {
+        static constexpr DerivedColumnType value = DerivedColumnType::UInt32;
+    };
+
+    template <>
+    struct DerivedColumnTypeOf<uint16_t> {
+        static constexpr DerivedColumnType value = DerivedColumnType::UInt16;
+    };
+
+    template <>
+    struct DerivedColumnTypeOf<uint8_t> {
+        static constexpr DerivedColumnType value = DerivedColumnType::UInt8;
+    };
+
+    /** Definition of a column with one value per block, tx, input or output that is computed from the chain
+     *
+     * The column is stored in derivedColumns/<name>.dat, indexed by height, tx number or blockchain-wide input or output
+     * number, and extended by Blockchain::updateDerivedColumns as the chain grows. The value of an object must only
+     * depend on the object and on earlier parts of the chain, so the stored values stay valid. Build one with perBlock,
+     * perTx, perInput or perOutput:
+     *
+     *     chain.registerDerivedColumn(DerivedColumnSpec::perTx<uint32_t>("input_types", [](const Transaction &tx) {...}));
+     */
+    struct BLOCKSCI_EXPORT DerivedColumnSpec {
+        std::string name;
+        DerivedColumnLevel level = DerivedColumnLevel::Tx;
+        DerivedColumnType type = DerivedColumnType::Int64;
+
+        /** Increase when compute changes, stored values of other versions are recomputed */
+        uint32_t version = 1;
+
+        /** Names of the derived columns that compute reads, which are updated first */
+        std::vector<std::string> dependencies;
+
+        /** Append the raw values of the block, or of its txes, inputs or outputs in chain order, to values */
+        std::function<void(const Block &block, std::vector<uint8_t> &values)> compute;
+
+        template <typename T, typename Func>
+        static DerivedColumnSpec perBlock(std::string name, Func func, std::vector<std::string> dependencies = {}, uint32_t version = 1) {
+            return make<T>(std::move(name), DerivedColumnLevel::Block, std::move(dependencies), version, [func](const Block &block, std::vector<uint8_t> &values) {
+                append<T>(values, func(block));
+            });
+        }
+
+        template <typename T, typename Func>
+        static DerivedColumnSpec perTx(std::string name, Func func, std::vector<std::string> dependencies = {}, uint32_t version = 1) {
+            return make<T>(std::move(name), DerivedColumnLevel::Tx, std::move(dependencies), version, [func](const Block &block, std::vector<uint8_t> &values) {
+                RANGES_FOR(auto tx, block) {
+                    append<T>(values, func(tx));
+                }
+            });
+        }
+
+        template <typename T, typename Func>
+        static DerivedColumnSpec perInput(std::string name, Func func, std::vector<std::string> dependencies = {}, uint32_t version = 1) {
+            return make<T>(std::move(name), DerivedColumnLevel::Input, std::move(dependencies), version, [func](const Block &block, std::vector<uint8_t> &values) {
+                RANGES_FOR(auto tx, block) {
+                    RANGES_FOR(auto input, tx.inputs()) {
+                        append<T>(values, func(input));
+                    }
+                }
+            });
+        }
+
+        template <typename T, typename Func>
+        static DerivedColumnSpec perOutput(std::string name, Func func, std::vector<std::string> dependencies = {}, uint32_t version = 1) {
+            return make<T>(std::move(name), DerivedColumnLevel::Output, std::move(dependencies), version, [func](const Block &block, std::vector<uint8_t> &values) {
+                RANGES_FOR(auto tx, block) {
+                    RANGES_FOR(auto output, tx.outputs()) {
+                        append<T>(values, func(output));
+                    }
+                }
+            });
+        }
+
+    private:
+        template <typename T>
+        static void append(std::vector<uint8_t> &values, T value) {
+            auto size = values.size();
+            values.resize(size + sizeof(T));
+            std::memcpy(values.data() + size, &value, sizeof(T));
+        }
+
+        template <typename T, typename Compute>
+        static DerivedColumnSpec make(std::string name, DerivedColumnLevel level, std::vector<std::string> dependencies, uint32_t version, Compute compute) {
+            DerivedColumnSpec spec;
+            spec.name = std::move(name);
+            spec.level = level;
+            spec.type = DerivedColumnTypeOf<T>::value;
+            spec.version = version;
+            spec.dependencies = std::move(dependencies);
+            spec.compute = std::move(compute);
+            return spec;
+        }
+    };
+
+    /** Read only view of the stored values of a derived column for the blocks [0, coveredHeight())
+     *
+     * The view keeps its mapping of the file alive, but must not be used once it is stale, since an update may have
+     * truncated the file. */
+    class BLOCKSCI_EXPORT DerivedColumn {
+    public:
+        DerivedColumn(std::string name_, DerivedColumnLevel level_, DerivedColumnType type_, BlockHeight coveredHeight_, uint64_t count_, const void *data_, std::shared_ptr<const void> storage_, uint64_t generation_, DataAccess &access_) :
+        columnName(std::move(name_)), columnLevel(level_), columnType(type_), covered(coveredHeight_), count(count_), rawData(data_), storage(std::move(storage_)), generation(generation_), access(&access_) {}
+
+        const std::string &name() const {
+            return columnName;
+        }
+
+        DerivedColumnLevel level() const {
+            return columnLevel;
+        }
+
+        DerivedColumnType type() const {
+            return columnType;
+        }
+
+        /** Number of blocks whose values are stored */
+        BlockHeight coveredHeight() const {
+            return covered;
+        }
+
+        /** Number of stored values */
+        uint64_t size() const {
+            return count;
+        }
+
+        const void *data() const {
+            return rawData;
+        }
+
+        /** Stored values as an array of T, throws std::invalid_argument if T isn't the type of the column */
+        template <typename T>
+        const T *values() const {
+            checkType(DerivedColumnTypeOf<T>::value);
+            return static_cast<const T *>(rawData);
+        }
+
+        /** Whether any derived column was updated or the chain reloaded since the view was opened */
+        bool isStale() const;
+
+        /** Value at the given height, tx number or blockchain-wide input or output number */
+        int64_t operator[](uint64_t index) const;
+
+        /** Value of the object, nullopt if it isn't covered. Throws std::invalid_argument if the column has values for
+         * another kind of object */
+        ranges::optional<int64_t> value(const Block &block) const;
+        ranges::optional<int64_t> value(const Transaction &tx) const;
+        ranges::optional<int64_t> value(const Input &input) const;
+        ranges::optional<int64_t> value(const Output &output) const;
+
+    private:
+        std::string columnName;
+        DerivedColumnLevel columnLevel;
+        DerivedColumnType columnType;
+        BlockHeight covered;
+        uint64_t count;
+        const void *rawData;
+        std::shared_ptr<const void> storage;
+        uint64_t generation;
+        DataAccess *access;
+
+        void checkType(DerivedColumnType type) const;
+        ranges::optional<int64_t> valueAt(DerivedColumnLevel objectLevel, uint64_t index) const;
+    };
+} // namespace blocksci
+
+#endif /* blocksci_chain_derived_column_hpp */
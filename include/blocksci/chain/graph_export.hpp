@@ -0,0 +1,157 @@
+//
+//  graph_export.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_chain_graph_export_hpp
+#define blocksci_chain_graph_export_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/chain/chain_fwd.hpp>
+#include <blocksci/core/dedup_address_type.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace blocksci {
+    class ClusterManager;
+
+    /** What the nodes of an exported transaction graph are */
+    enum class BLOCKSCI_EXPORT GraphLevel {
+        /** One node per tx number, with an edge from the spent transaction to the spending one for every input */
+        Transaction,
+        /** One node per deduplicated address, transactions are contracted to edges from their input to their output addresses */
+        Address,
+        /** One node per cluster number of a clustering, contracted like Address */
+        Cluster
+    };
+
+    /** File layouts of exported graphs, all are little endian binary files starting with a GraphFileHeader */
+    enum class BLOCKSCI_EXPORT GraphExportFormat {
+        /** graph.edges: the header followed by edgeCount GraphEdge records in chain order */
+        EdgeList,
+        /** graph.csr: the header followed by uint64 offsets[nodeCount + 1], uint32 targets[edgeCount] (padded to 8 bytes)
+         * and int64 values[edgeCount]. The edges leaving node i are [offsets[i], offsets[i + 1]), sorted by target */
+        CSR,
+        /** cospend.csr, written by exportCoSpendGraph: CSR followed by uint32 txCounts[edgeCount] */
+        WeightedCSR
+    };
+
+    struct BLOCKSCI_EXPORT GraphExportOptions {
+        GraphLevel level = GraphLevel::Transaction;
+        GraphExportFormat format = GraphExportFormat::CSR;
+
+        /** Keep edges from a node to itself, which contraction creates for change sent back to the same address or cluster */
+        bool includeSelfLoops = false;
+
+        /** Directory for the per-segment edge files, the output directory if empty */
+        std::string tempDirectory;
+    };
+
+    struct BLOCKSCI_EXPORT GraphEdge {
+        uint32_t source;
+        uint32_t target;
+
+        /** Satoshis flowing along the edge, see exportGraph */
+        int64_t value;
+    };
+
+    static_assert(sizeof(GraphEdge) == 16, "GraphEdge is written to disk as is");
+
+    struct BLOCKSCI_EXPORT GraphFileHeader {
+        static constexpr uint64_t Magic = 0x4850415247494353ULL; // "SCIGRAPH"
+        static constexpr uint32_t Version = 1;
+
+        uint64_t magic;
+        uint32_t version;
+        GraphLevel level;
+        GraphExportFormat format;
+        uint32_t padding;
+        uint64_t nodeCount;
+        uint64_t edgeCount;
+
+        /** At the Address level the node of the address (type, scriptNum) is addressOffsets[type] + scriptNum - 1 */
+        std::array<uint64_t, DedupAddressType::size> addressOffsets;
+    };
+
+    struct BLOCKSCI_EXPORT GraphExportSummary {
+        uint64_t nodeCount;
+        uint64_t edgeCount;
+
+        /** Path of the graph.edges or graph.csr file */
+        std::string path;
+    };
+
+    /** Settings of exportCoSpendGraph */
+    struct BLOCKSCI_EXPORT CoSpendGraphOptions {
+        /** Address or Cluster, transactions are not nodes of the co-spend graph */
+        GraphLevel level = GraphLevel::Address;
+
+        /** Skip transactions that heuristics::isCoinjoin detects as CoinJoins, whose inputs belong to several users */
+        bool skipCoinJoin = true;
+
+        /** Transactions spending from more nodes than this link every input node to the smallest one instead of every
+         * pair of them, which keeps the edges of huge consolidations linear */
+        uint32_t maxCliqueNodes = 64;
+
+        /** Bytes the aggregation tables of all segments scanned at once may take before they are spilled to disk */
+        uint64_t memoryLimit = uint64_t{1} << 30;
+
+        /** Directory for the spilled runs, the output directory if empty */
+        std::string tempDirectory;
+    };
+
+    /** Weight of a pair of nodes spent together as aggregated by exportCoSpendGraph, also the record of its spilled runs */
+    struct BLOCKSCI_EXPORT CoSpendEdge {
+        uint32_t source;
+        uint32_t target;
+
+        /** Number of transactions spending from both nodes */
+        uint32_t txCount;
+        uint32_t padding;
+
+        /** Satoshis the two nodes spent in these transactions together */
+        int64_t value;
+    };
+
+    static_assert(sizeof(CoSpendEdge) == 24, "CoSpendEdge is written to disk as is");
+
+    /** Write the transaction graph of the blocks to outputDirectory for external graph engines
+     *
+     * Every input of a transaction in the blocks yields an edge from the spent transaction to the spending one, worth
+     * the value of the spent output, so the source of an edge may lie before the blocks. At the Address and Cluster
+     * levels a transaction becomes one edge per distinct pair of input and output node instead, worth the value sent to
+     * the output node times the share of the transaction's input value coming from the input node (rounded down).
+     * Coinbase transactions have no edges. Parallel edges between the same nodes are kept.
+     *
+     * Segments of the blocks are scanned on the work pool of the chain, each writing its edges to its own file, which
+     * are merged in parallel into a memory mapped output file and removed afterwards. Cluster requires clusters, a
+     * clustering of the same chain. Throws if outputDirectory already holds an export.
+     */
+    GraphExportSummary BLOCKSCI_EXPORT exportGraph(BlockRange &blocks, const std::string &outputDirectory,
+                                                   const GraphExportOptions &options = GraphExportOptions{},
+                                                   const ClusterManager *clusters = nullptr);
+
+    /** Write the co-spend graph of the blocks to outputDirectory/cospend.csr in the WeightedCSR format
+     *
+     * Nodes are deduplicated addresses or clusters as in exportGraph, and two nodes share an edge if a transaction in
+     * the blocks spends from both of them, making the graph the one address clustering takes the components of. Every
+     * pair of nodes has a single edge, weighted by the number of such transactions and the total value the two nodes
+     * spent in them. The graph is undirected, so each edge is stored in the lists of both nodes and the edgeCount of
+     * the summary is twice the number of pairs. Coinbase transactions and transactions spending from a single node have
+     * no edges.
+     *
+     * Segments of the blocks are scanned on the work pool of the chain, each aggregating its edges in a hash table that
+     * is sorted and spilled to a run file whenever it outgrows its share of the memory limit. The runs are merged into
+     * the output in one sorted pass and removed afterwards. Cluster requires clusters, a clustering of the same chain.
+     * Throws if outputDirectory already holds a co-spend graph.
+     */
+    GraphExportSummary BLOCKSCI_EXPORT exportCoSpendGraph(BlockRange &blocks, const std::string &outputDirectory,
+                                                          const CoSpendGraphOptions &options = CoSpendGraphOptions{},
+                                                          const ClusterManager *clusters = nullptr);
+} // namespace blocksci
+
+#endif /* blocksci_chain_graph_export_hpp */
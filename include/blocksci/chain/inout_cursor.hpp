@@ -0,0 +1,208 @@
+//
+//  inout_cursor.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_inout_cursor_hpp
+#define blocksci_inout_cursor_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/chain/chain_fwd.hpp>
+#include <blocksci/chain/output_pointer.hpp>
+#include <blocksci/core/inout.hpp>
+#include <blocksci/core/typedefs.hpp>
+
+#include <range/v3/utility/optional.hpp>
+
+#include <cstdint>
+#include <limits>
+
+namespace blocksci {
+    class DataAccess;
+
+    /** Walks the inputs of one transaction for traversals that only read a few fields of every input, eg.
+     *
+     *     for (InputCursor input{tx}; input.valid(); input.next()) {
+     *         total += input.age();
+     *     }
+     *
+     * tx.inputs() builds a full Input for every element, and each Input looks up the height of its spent tx in the
+     * block height index again. The cursor resolves the columns of the transaction once and reads the current input
+     * from them. Spent heights come from chain/input_spent_height.dat if it covers the transaction, otherwise the last
+     * lookup is remembered, so inputs spending outputs of the same tx share it.
+     */
+    class BLOCKSCI_EXPORT InputCursor {
+        DataAccess *access;
+        const Inout *inouts;
+        const uint16_t *spentOutputNums;
+        const uint32_t *sequenceNumbers;
+
+        /** Spent heights of the inputs of the tx, nullptr if input_spent_height.dat doesn't cover them */
+        const uint32_t *spentHeights;
+        uint32_t txNum;
+        uint32_t maxTxCount;
+        BlockHeight height;
+        uint16_t inputCount;
+        uint16_t inputNum = 0;
+
+        mutable uint32_t lastSpentTxNum = 0;
+        mutable BlockHeight lastSpentHeight = -1;
+
+        BlockHeight lookupSpentBlockHeight(uint32_t spentTxNum) const;
+
+    public:
+        explicit InputCursor(const Transaction &tx);
+
+        bool valid() const {
+            return inputNum < inputCount;
+        }
+
+        void next() {
+            ++inputNum;
+        }
+
+        uint16_t inputIndex() const {
+            return inputNum;
+        }
+
+        uint32_t txIndex() const {
+            return txNum;
+        }
+
+        const Inout &inout() const {
+            return inouts[inputNum];
+        }
+
+        int64_t getValue() const {
+            return inouts[inputNum].getValue();
+        }
+
+        AddressType::Enum getType() const {
+            return inouts[inputNum].getType();
+        }
+
+        uint32_t sequenceNumber() const {
+            return sequenceNumbers[inputNum];
+        }
+
+        /** Tx number of the tx containing the output spent by the current input */
+        uint32_t spentTxIndex() const {
+            return inouts[inputNum].getLinkedTxNum();
+        }
+
+        OutputPointer getSpentOutputPointer() const {
+            return {inouts[inputNum].getLinkedTxNum(), spentOutputNums[inputNum]};
+        }
+
+        /** Height of the block containing the output spent by the current input */
+        BlockHeight getSpentBlockHeight() const {
+            if (spentHeights != nullptr) {
+                return static_cast<BlockHeight>(spentHeights[inputNum]);
+            }
+            auto spentTxNum = inouts[inputNum].getLinkedTxNum();
+            if (lastSpentHeight == -1 || spentTxNum != lastSpentTxNum) {
+                lastSpentHeight = lookupSpentBlockHeight(spentTxNum);
+                lastSpentTxNum = spentTxNum;
+            }
+            return lastSpentHeight;
+        }
+
+        /** Number of blocks between the spent output and the current input */
+        BlockHeight age() const {
+            return height - getSpentBlockHeight();
+        }
+
+        Transaction getSpentTx() const;
+
+        /** The current input as an Input object */
+        Input input() const;
+    };
+
+    /** Walks the outputs of one transaction like InputCursor walks its inputs
+     *
+     * Spending heights come from chain/output_spending_height.dat if it covers the transaction, otherwise the last
+     * lookup is remembered, so outputs spent by the same tx share it.
+     */
+    class BLOCKSCI_EXPORT OutputCursor {
+        DataAccess *access;
+        const Inout *inouts;
+
+        /** Spending heights of the outputs of the tx, nullptr if output_spending_height.dat doesn't cover them */
+        const uint32_t *spendingHeights;
+        uint32_t txNum;
+        uint32_t maxTxCount;
+        BlockHeight height;
+        uint16_t outputCount;
+        uint16_t outputNum = 0;
+
+        mutable uint32_t lastSpendingTxNum = 0;
+        mutable BlockHeight lastSpendingHeight = -1;
+
+        BlockHeight lookupSpendingBlockHeight(uint32_t spendingTxNum) const;
+
+    public:
+        explicit OutputCursor(const Transaction &tx);
+
+        bool valid() const {
+            return outputNum < outputCount;
+        }
+
+        void next() {
+            ++outputNum;
+        }
+
+        uint16_t outputIndex() const {
+            return outputNum;
+        }
+
+        uint32_t txIndex() const {
+            return txNum;
+        }
+
+        const Inout &inout() const {
+            return inouts[outputNum];
+        }
+
+        int64_t getValue() const {
+            return inouts[outputNum].getValue();
+        }
+
+        AddressType::Enum getType() const {
+            return inouts[outputNum].getType();
+        }
+
+        /** Whether the current output is spent in the loaded chain */
+        bool isSpent() const {
+            auto linkedTxNum = inouts[outputNum].getLinkedTxNum();
+            return linkedTxNum > 0 && linkedTxNum < maxTxCount;
+        }
+
+        ranges::optional<uint32_t> getSpendingTxIndex() const {
+            return isSpent() ? ranges::optional<uint32_t>{inouts[outputNum].getLinkedTxNum()} : ranges::nullopt;
+        }
+
+        /** Height of the block spending the current output, which must be spent (@see isSpent) */
+        BlockHeight getSpendingBlockHeight() const {
+            // Outputs spent after the column was written are still marked as unspent in it
+            if (spendingHeights != nullptr && spendingHeights[outputNum] != std::numeric_limits<uint32_t>::max()) {
+                return static_cast<BlockHeight>(spendingHeights[outputNum]);
+            }
+            auto spendingTxNum = inouts[outputNum].getLinkedTxNum();
+            if (lastSpendingHeight == -1 || spendingTxNum != lastSpendingTxNum) {
+                lastSpendingHeight = lookupSpendingBlockHeight(spendingTxNum);
+                lastSpendingTxNum = spendingTxNum;
+            }
+            return lastSpendingHeight;
+        }
+
+        /** The tx spending the current output, if it is spent in the loaded chain */
+        ranges::optional<Transaction> getSpendingTx() const;
+
+        /** The current output as an Output object */
+        Output output() const;
+    };
+} // namespace blocksci
+
+#endif /* blocksci_inout_cursor_hpp */
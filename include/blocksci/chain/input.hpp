@@ -16,6 +16,11 @@
 #include <blocksci/chain/output_pointer.hpp>
 #include <blocksci/core/inout.hpp>
 #include <blocksci/core/raw_transaction.hpp>
+#include <blocksci/core/raw_witness.hpp>
+
+#include <range/v3/utility/optional.hpp>
+
+#include <vector>
 
 namespace std {
     template<> struct BLOCKSCI_EXPORT hash<blocksci::Input> {
@@ -96,6 +101,9 @@ namespace blocksci {
 
         /** Get the Transaction that contains the output that is spent by this input */
         Transaction getSpentTx() const;
+        
+        /** Get the height of the block containing the spent output, without loading its Transaction */
+        BlockHeight getSpentBlockHeight() const;
 
         /** Get OutputPointer of the output that this input spends */
         OutputPointer getSpentOutputPointer() const {
@@ -103,6 +111,15 @@ namespace blocksci {
         }
 
         Output getSpentOutput() const;
+
+        /** Witness of this input, nullptr if the optional witness files written with recordWitnesses don't cover it */
+        const RawWitness *getRawWitness() const;
+
+        /** Lengths of the witness items of this input, nullopt if the witness files don't cover it */
+        ranges::optional<std::vector<uint32_t>> getWitnessItemLengths() const;
+
+        /** Witness items of this input, nullopt if the witness files don't cover it or only store the item lengths */
+        ranges::optional<std::vector<std::vector<unsigned char>>> getWitnessItems() const;
     };
     
     inline bool BLOCKSCI_EXPORT operator==(const Input& a, const Input& b) {
@@ -0,0 +1,224 @@
+//
+//  mempool_snapshot.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_mempool_snapshot_hpp
+#define blocksci_mempool_snapshot_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/core/bitcoin_uint256.hpp>
+
+#include <range/v3/utility/optional.hpp>
+#include <range/v3/view/subrange.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace blocksci {
+    class DataAccess;
+
+    /** Where the output spent by an input of a pending tx lives */
+    enum class BLOCKSCI_EXPORT PendingInputSource : uint8_t {
+        /** spentTx is the tx number of a tx of the parsed chain */
+        Chain,
+        /** spentTx is the index of another tx of the snapshot */
+        Mempool,
+        /** The spent tx is neither in the snapshot nor in the parsed chain, eg. because the parser lags the node */
+        Unknown
+    };
+
+    struct BLOCKSCI_EXPORT PendingInput {
+        uint32_t spentTx;
+        uint16_t outputNum;
+        PendingInputSource source;
+    };
+
+    /** Unconfirmed tx of a MempoolSnapshot */
+    struct BLOCKSCI_EXPORT PendingTx {
+        uint256 hash;
+
+        /** Base fee in satoshi */
+        int64_t fee;
+
+        /** Fee of the tx and all its unconfirmed ancestors */
+        int64_t ancestorFee;
+
+        /** Milliseconds since the epoch when the mempool recorder first saw the tx */
+        int64_t firstSeen;
+
+        /** Fee rate in satoshi per vbyte of the package the tx is projected to be mined with */
+        double feeRate;
+
+        uint32_t vsize;
+
+        /** Virtual size of the tx and all its unconfirmed ancestors */
+        uint32_t ancestorSize;
+
+        /** Number of unconfirmed ancestors including the tx itself */
+        uint32_t ancestorCount;
+
+        /** Number of unconfirmed descendants including the tx itself */
+        uint32_t descendantCount;
+
+        /** Number of blocks mined before the one the tx is projected to be included in */
+        uint32_t projectedBlock;
+
+        uint32_t firstParent;
+        uint32_t parentCount;
+        uint32_t firstInput;
+
+        /** Zero if the inputs haven't been decoded yet, @see inputsKnown */
+        uint32_t inputCount;
+
+        uint32_t flags;
+
+        static constexpr uint32_t inputsKnownFlag = 1;
+
+        bool inputsKnown() const {
+            return (flags & inputsKnownFlag) != 0;
+        }
+
+        double ancestorFeeRate() const {
+            return static_cast<double>(ancestorFee) / ancestorSize;
+        }
+    };
+
+    /** Unconfirmed tx as reported by the node, @see writeMempoolSnapshot */
+    struct BLOCKSCI_EXPORT MempoolEntry {
+        uint256 hash;
+        int64_t fee;
+        uint32_t vsize;
+        int64_t firstSeen;
+
+        /** Unconfirmed txes the tx spends outputs of */
+        std::vector<uint256> parents;
+
+        /** Outputs spent by the tx, only meaningful if inputsKnown is set */
+        std::vector<std::pair<uint256, uint16_t>> inputs;
+        bool inputsKnown = false;
+    };
+
+    /** Header of the mempool/snapshot.dat file
+     *
+     * It is followed by txCount PendingTx, inputCount PendingInput, parentCount uint32_t parent indexes, blockCount + 1
+     * uint32_t offsets of the projected blocks and txCount uint32_t tx indexes sorted by tx hash.
+     */
+    struct BLOCKSCI_EXPORT MempoolSnapshotHeader {
+        uint64_t magic;
+        uint32_t version;
+
+        /** Number of txes of the parsed chain when the snapshot was written, chain input links point below it */
+        uint32_t chainTxCount;
+
+        /** Milliseconds since the epoch */
+        int64_t timestamp;
+
+        uint32_t txCount;
+        uint32_t inputCount;
+        uint32_t parentCount;
+        uint32_t blockCount;
+
+        static constexpr uint64_t expectedMagic = 0x50414e5350434d42; // "BMCPSNAP"
+        static constexpr uint32_t expectedVersion = 1;
+    };
+
+    /** Memory mapped view of the mempool written by the mempool recorder
+     *
+     * Txes are ordered by the block they are projected to be mined in, which approximates the block assembly of
+     * Bitcoin Core: packages of a tx and its not yet included ancestors are added in order of the ancestor fee rate
+     * of the tx, each into the first block which has room for it and is not before the blocks of its ancestors.
+     * Within a block the txes are in inclusion order, so parents come before their children and every projected
+     * block is a valid template. Unlike Core the ancestor fee rates are not updated as ancestors are included.
+     *
+     * The snapshot is replaced atomically by the recorder, an open snapshot keeps referring to the data it was opened
+     * with. Pending txes aren't part of the parsed chain and have no script or output data, so they are exposed as
+     * PendingTx records rather than Transaction objects.
+     */
+    class BLOCKSCI_EXPORT MempoolSnapshot {
+        std::shared_ptr<const void> mapping;
+        const MempoolSnapshotHeader *header;
+        const PendingTx *txData;
+        const PendingInput *inputData;
+        const uint32_t *parentData;
+        const uint32_t *blockOffsets;
+        const uint32_t *hashOrder;
+
+    public:
+        /** Maximum virtual size of the txes of a projected block, 4M weight units minus room for the coinbase tx */
+        static constexpr uint32_t maxBlockVsize = 999000;
+
+        /** Throws std::runtime_error if the file doesn't exist or isn't a mempool snapshot */
+        explicit MempoolSnapshot(const std::string &path);
+
+        /** Snapshot in the mempool directory of the data, throws std::runtime_error if the recorder didn't write one */
+        explicit MempoolSnapshot(const DataAccess &access);
+
+        int64_t timestamp() const {
+            return header->timestamp;
+        }
+
+        uint32_t chainTxCount() const {
+            return header->chainTxCount;
+        }
+
+        uint32_t size() const {
+            return header->txCount;
+        }
+
+        const PendingTx &operator[](uint32_t index) const {
+            return txData[index];
+        }
+
+        ranges::subrange<const PendingTx *> txes() const {
+            return {txData, txData + header->txCount};
+        }
+
+        /** Index of the tx with the hash, found by binary search */
+        ranges::optional<uint32_t> find(const uint256 &hash) const;
+
+        /** Indexes of the unconfirmed txes the tx spends outputs of */
+        ranges::subrange<const uint32_t *> parents(uint32_t index) const {
+            auto &tx = txData[index];
+            return {parentData + tx.firstParent, parentData + tx.firstParent + tx.parentCount};
+        }
+
+        ranges::subrange<const PendingInput *> inputs(uint32_t index) const {
+            auto &tx = txData[index];
+            return {inputData + tx.firstInput, inputData + tx.firstInput + tx.inputCount};
+        }
+
+        /** Indexes of all unconfirmed ancestors of the tx, sorted */
+        std::vector<uint32_t> ancestors(uint32_t index) const;
+
+        uint32_t projectedBlockCount() const {
+            return header->blockCount;
+        }
+
+        /** Txes projected to be mined in the block, which is 0 for the next one, in template order */
+        ranges::subrange<const PendingTx *> projectedBlock(uint32_t block) const;
+
+        /** Total fee of the txes projected to be mined in the block */
+        int64_t projectedBlockFees(uint32_t block) const;
+
+        /** Fee rates at the percentiles (0 to 100) of the virtual size of the txes projected to be mined in the block
+         *
+         * The 0th percentile is the lowest fee rate which is projected to make it into the block. Returns 0 for every
+         * percentile if the block is empty. */
+        std::vector<double> feeRatePercentiles(const std::vector<double> &percentiles, uint32_t block = 0) const;
+    };
+
+    /** Compute the packages and projected blocks of the entries and atomically replace the snapshot in the mempool
+     * directory
+     *
+     * Parents which aren't entries themselves are ignored, inputs are linked to the txes of the parsed chain through
+     * the hash index. */
+    BLOCKSCI_EXPORT void writeMempoolSnapshot(const std::vector<MempoolEntry> &entries, int64_t timestamp, DataAccess &access);
+} // namespace blocksci
+
+#endif /* blocksci_mempool_snapshot_hpp */
@@ -0,0 +1,62 @@
+//
+//  mempool_time_columns.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_mempool_time_columns_hpp
+#define blocksci_mempool_time_columns_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/chain/chain_fwd.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace blocksci {
+
+    /** Slice of one recording of the mempool recorder, covering the txes firstTxNum, ..., firstTxNum + count - 1
+     *
+     * Points into the mapped mempool/<n>_tx and mempool/<n>_tx_ms files, so it is only valid until the chain is
+     * reloaded. Element i is 0 if the recorder didn't observe the tx, 1 if it observed it without a time and the
+     * seconds since the epoch the tx was first seen otherwise (@see Transaction::getTimeSeen).
+     */
+    struct BLOCKSCI_EXPORT MempoolTimeSegment {
+        const int64_t *timestamps = nullptr;
+
+        /** Milliseconds to add to the timestamps, covering only the first millisecondCount txes of the slice since
+         * older recordings lack them */
+        const uint16_t *milliseconds = nullptr;
+        uint32_t millisecondCount = 0;
+
+        uint32_t firstTxNum = 0;
+        uint32_t count = 0;
+    };
+
+    /** First seen times of a contiguous range of transactions, joined from the recordings that cover it
+     *
+     * Looking the recordings up once per range instead of once per tx (like Transaction::getTimeSeen) turns the
+     * mempool latency of millions of txes into a scan of the recorder's files.
+     */
+    struct BLOCKSCI_EXPORT MempoolTimeColumns {
+        /** Recordings overlapping the range in tx order, txes between them weren't recorded */
+        std::vector<MempoolTimeSegment> segments;
+
+        uint32_t firstTxNum = 0;
+        uint32_t count = 0;
+
+        /** Whether a single recording with milliseconds covers every tx, so its columns can be used without copying */
+        bool isContiguous() const {
+            return segments.size() == 1 && segments.front().count == count && segments.front().millisecondCount == count;
+        }
+
+        /** Copy the columns into arrays of count elements, 0 for txes that no recording covers */
+        void copyTo(int64_t *timestamps, uint16_t *milliseconds) const;
+    };
+
+    /** First seen times of the transactions of the blocks */
+    MempoolTimeColumns BLOCKSCI_EXPORT mempoolTimeColumns(BlockRange &blocks);
+} // namespace blocksci
+
+#endif /* blocksci_mempool_time_columns_hpp */
@@ -0,0 +1,95 @@
+//
+//  miner_attribution.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_chain_miner_attribution_hpp
+#define blocksci_chain_miner_attribution_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/address/address_fwd.hpp>
+#include <blocksci/chain/chain_fwd.hpp>
+#include <blocksci/chain/derived_column.hpp>
+
+#include <range/v3/utility/optional.hpp>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace blocksci {
+
+    /** Aho-Corasick automaton finding the first of a set of byte strings in a text, in a single pass over the text
+     *
+     * The automaton is stored as a full transition table with 256 entries per state, so every byte of the text costs
+     * one table lookup. A few hundred coinbase tags take a few megabytes. */
+    class BLOCKSCI_EXPORT CoinbaseTagMatcher {
+    public:
+        CoinbaseTagMatcher() = default;
+        explicit CoinbaseTagMatcher(const std::vector<std::string> &patterns);
+
+        /** Index of the pattern matching leftmost in the text, the lowest index among patterns starting at the same
+         * position, which is the match of a regex alternation of the patterns in order. nullopt if none matches */
+        ranges::optional<uint32_t> firstMatch(const unsigned char *begin, const unsigned char *end) const;
+
+        size_t stateCount() const {
+            return matchedPattern.size();
+        }
+
+    private:
+        static constexpr uint32_t noPattern = UINT32_MAX;
+
+        /** transitions[state * 256 + byte] */
+        std::vector<uint32_t> transitions;
+
+        /** Longest pattern ending at the state, following the failure links, noPattern if there is none */
+        std::vector<uint32_t> matchedPattern;
+        std::vector<uint32_t> patternLengths;
+        uint32_t longestPattern = 0;
+    };
+
+    /** Attributes blocks to miners by the tags in their coinbase and by the addresses paid by their coinbase tx
+     *
+     * Miners are numbered from 1 in the order of names, 0 stands for blocks that match neither a tag nor an address.
+     * Tags take priority over payout addresses like in the pool definitions of Blockchain-Known-Pools. The ids of all
+     * blocks are kept in a derived column (@see columnSpec), so only new blocks are matched when the chain grows.
+     */
+    class BLOCKSCI_EXPORT MinerMatcher {
+    public:
+        MinerMatcher(std::vector<std::string> names, const std::vector<std::pair<std::string, uint32_t>> &coinbaseTags, const std::vector<std::pair<Address, uint32_t>> &payoutAddresses);
+
+        /** Id of the miner of the block, 0 if unknown */
+        uint32_t minerOf(const Block &block) const;
+
+        /** Name of the miner with the given id, "Unknown" for 0 */
+        const std::string &name(uint32_t minerId) const;
+
+        /** Names indexed by miner id, starting with "Unknown" */
+        const std::vector<std::string> &names() const {
+            return minerNames;
+        }
+
+        /** Hash of the definitions, the version of the derived column so ids are recomputed when they change */
+        uint32_t fingerprint() const {
+            return definitionHash;
+        }
+
+        /** Derived column with the miner id of every block */
+        DerivedColumnSpec columnSpec(std::string columnName = "miner_id") const;
+
+    private:
+        std::vector<std::string> minerNames;
+        CoinbaseTagMatcher tags;
+        std::vector<uint32_t> tagMiners;
+
+        /** Miner ids by (scriptNum << 8 | type) of the payout address */
+        std::unordered_map<uint64_t, uint32_t> payoutMiners;
+        uint32_t definitionHash = 0;
+    };
+} // namespace blocksci
+
+#endif /* blocksci_chain_miner_attribution_hpp */
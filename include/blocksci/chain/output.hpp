@@ -95,6 +95,9 @@ namespace blocksci {
 
         /** Get the Transaction that spends this output, if it was spent yet (at the loaded block height) */
         ranges::optional<Transaction> getSpendingTx() const;
+        
+        /** Get the height of the block that spends this output, without loading the spending Transaction */
+        ranges::optional<BlockHeight> getSpendingBlockHeight() const;
 
         /** Get the Input that spends this Output */
         ranges::optional<Input> getSpendingInput() const;
@@ -0,0 +1,159 @@
+//
+//  output_columns.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_output_columns_hpp
+#define blocksci_output_columns_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/chain/chain_fwd.hpp>
+#include <blocksci/core/address_types.hpp>
+
+#include <range/v3/utility/optional.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+namespace blocksci {
+    class DataAccess;
+
+    /** Columnar view of a contiguous range of outputs, backed by the optional chain/output_*.dat files
+     *
+     * Each output field is stored in its own flat array indexed by blockchain-wide output number, so scans over a
+     * single field read contiguous memory instead of striding over the 16 byte Inout records in tx_data.dat.
+     * The columns are created with "blocksci_parser build-output-columns" and extended by later parser updates.
+     *
+     * Element i of the view is output i of the range in the same order as iterating over tx.outputs() for every
+     * transaction of the range. The per-element accessors mirror the ones of Output.
+     */
+    struct BLOCKSCI_EXPORT OutputColumns {
+        /** Value in satoshis of every output */
+        const int64_t *values = nullptr;
+
+        /** AddressType::Enum of every output, stored as one byte */
+        const uint8_t *types = nullptr;
+
+        /** Address number (scriptNum) of every output */
+        const uint32_t *addressNums = nullptr;
+
+        /** Tx number of the transaction spending the output, 0 if unspent */
+        const uint32_t *spentTxNums = nullptr;
+
+        /** Blockchain-wide number of the first output in the view */
+        uint64_t firstOutputNum = 0;
+
+        /** Number of outputs in the view */
+        uint64_t count = 0;
+
+        /** Spending transactions at or past this tx number are not loaded and count as unspent (see Output) */
+        uint32_t maxTxLoaded = 0;
+
+        uint64_t size() const {
+            return count;
+        }
+
+        bool empty() const {
+            return count == 0;
+        }
+
+        int64_t getValue(uint64_t i) const {
+            return values[i];
+        }
+
+        AddressType::Enum getType(uint64_t i) const {
+            return static_cast<AddressType::Enum>(types[i]);
+        }
+
+        uint32_t getAddressNum(uint64_t i) const {
+            return addressNums[i];
+        }
+
+        bool isSpent(uint64_t i) const {
+            return spentTxNums[i] > 0 && spentTxNums[i] < maxTxLoaded;
+        }
+
+        ranges::optional<uint32_t> getSpendingTxIndex(uint64_t i) const {
+            return isSpent(i) ? ranges::optional<uint32_t>{spentTxNums[i]} : ranges::nullopt;
+        }
+
+        /** View of the outputs [begin, end) of this view */
+        OutputColumns slice(uint64_t begin, uint64_t end) const {
+            return {values + begin, types + begin, addressNums + begin, spentTxNums + begin, firstOutputNum + begin, end - begin, maxTxLoaded};
+        }
+
+        /* The aggregations below are plain loops over a single column without early exits so that the compiler
+         * vectorizes them. Use them (possibly per segment of BlockRange::mapReduce) for bulk scans. */
+
+        int64_t maxValue() const {
+            int64_t curMax = 0;
+            for (uint64_t i = 0; i < count; i++) {
+                curMax = std::max(curMax, values[i]);
+            }
+            return curMax;
+        }
+
+        int64_t totalValue() const {
+            int64_t total = 0;
+            for (uint64_t i = 0; i < count; i++) {
+                total += values[i];
+            }
+            return total;
+        }
+
+        /** Total value of the outputs of the given type */
+        int64_t totalValue(AddressType::Enum type) const {
+            auto typeNum = static_cast<uint8_t>(type);
+            int64_t total = 0;
+            for (uint64_t i = 0; i < count; i++) {
+                total += types[i] == typeNum ? values[i] : 0;
+            }
+            return total;
+        }
+
+        /** Total value of the outputs of each address type, indexed by AddressType::Enum */
+        std::array<int64_t, AddressType::size> valueByType() const {
+            std::array<int64_t, AddressType::size> totals{};
+            for (uint64_t i = 0; i < count; i++) {
+                totals[types[i]] += values[i];
+            }
+            return totals;
+        }
+
+        /** Number of outputs of the given type */
+        uint64_t countType(AddressType::Enum type) const {
+            auto typeNum = static_cast<uint8_t>(type);
+            uint64_t total = 0;
+            for (uint64_t i = 0; i < count; i++) {
+                total += types[i] == typeNum;
+            }
+            return total;
+        }
+
+        /** Number of outputs that are not spent by a loaded transaction */
+        uint64_t countUnspent() const {
+            uint64_t total = 0;
+            for (uint64_t i = 0; i < count; i++) {
+                total += spentTxNums[i] == 0 || spentTxNums[i] >= maxTxLoaded;
+            }
+            return total;
+        }
+    };
+
+    /** Check whether the output columns exist and cover all loaded outputs */
+    bool BLOCKSCI_EXPORT hasOutputColumns(DataAccess &access);
+
+    /** Output columns of all outputs of the transaction. Throws if the columns are not available */
+    OutputColumns BLOCKSCI_EXPORT outputColumns(const Transaction &tx);
+
+    /** Output columns of all outputs of the transactions (eg. a Block) */
+    OutputColumns BLOCKSCI_EXPORT outputColumns(const TransactionRange &txes);
+
+    /** Output columns of all outputs of the blocks */
+    OutputColumns BLOCKSCI_EXPORT outputColumns(BlockRange &blocks);
+} // namespace blocksci
+
+#endif /* blocksci_output_columns_hpp */
@@ -0,0 +1,198 @@
+//
+//  output_scan.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_chain_output_scan_hpp
+#define blocksci_chain_output_scan_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/chain/block.hpp>
+#include <blocksci/chain/output.hpp>
+#include <blocksci/chain/output_range.hpp>
+#include <blocksci/chain/transaction.hpp>
+#include <blocksci/core/inout.hpp>
+
+#include <range/v3/range_for.hpp>
+#include <range/v3/range/traits.hpp>
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/** Fused filters and reductions over the outputs of transactions
+ *
+ * The filters in algorithms.hpp compose range views of Output objects, each of which is created from the raw Inout
+ * and then passed through every stage of the pipeline. The scans here instead run one loop over the Inouts of each
+ * transaction, in which all predicates and the reduction are inlined, and only create an Output for the outputs that
+ * the caller asks for. Predicates are combined with &&, || and !:
+ *
+ *     scan::totalValue(block, scan::ofType(AddressType::PUBKEYHASH) && scan::spentBeforeHeight(height));
+ *
+ * is equivalent to totalOutputValue(outputsSpentBeforeHeight(outputsOfType(block, AddressType::PUBKEYHASH), height)).
+ */
+namespace blocksci { namespace scan {
+
+    /** Output that is looked at during a scan, read directly from its Inout */
+    struct BLOCKSCI_EXPORT RawOutput {
+        const Inout *inout;
+        const OutputRange *range;
+        uint16_t outputNum;
+
+        int64_t getValue() const {
+            return inout->getValue();
+        }
+
+        AddressType::Enum getType() const {
+            return inout->getType();
+        }
+
+        BlockHeight getBlockHeight() const {
+            return range->height;
+        }
+
+        /** Same as Output::isSpent, spends after the loaded chain don't count */
+        bool isSpent() const {
+            auto spendingTxNum = inout->getLinkedTxNum();
+            return spendingTxNum > 0 && spendingTxNum < range->maxTxLoaded;
+        }
+
+        Output toOutput() const {
+            return {{range->txIndex, outputNum}, range->height, *inout, range->maxTxLoaded, *range->access};
+        }
+
+        /** Height of the spending block, the output must be spent */
+        BlockHeight getSpendingBlockHeight() const {
+            return *toOutput().getSpendingBlockHeight();
+        }
+    };
+
+    /** Predicate on RawOutput that can be combined with other predicates at compile time */
+    template <typename Func>
+    struct OutputPredicate {
+        Func func;
+
+        bool operator()(const RawOutput &output) const {
+            return func(output);
+        }
+    };
+
+    template <typename Func>
+    inline OutputPredicate<Func> makePredicate(Func func) {
+        return {std::move(func)};
+    }
+
+    template <typename A, typename B>
+    inline auto operator&&(OutputPredicate<A> a, OutputPredicate<B> b) {
+        return makePredicate([a, b](const RawOutput &output) { return a(output) && b(output); });
+    }
+
+    template <typename A, typename B>
+    inline auto operator||(OutputPredicate<A> a, OutputPredicate<B> b) {
+        return makePredicate([a, b](const RawOutput &output) { return a(output) || b(output); });
+    }
+
+    template <typename A>
+    inline auto operator!(OutputPredicate<A> a) {
+        return makePredicate([a](const RawOutput &output) { return !a(output); });
+    }
+
+    inline auto all() {
+        return makePredicate([](const RawOutput &) { return true; });
+    }
+
+    inline auto ofType(AddressType::Enum type) {
+        return makePredicate([type](const RawOutput &output) { return output.getType() == type; });
+    }
+
+    inline auto spent() {
+        return makePredicate([](const RawOutput &output) { return output.isSpent(); });
+    }
+
+    inline auto unspent() {
+        return makePredicate([](const RawOutput &output) { return !output.isSpent(); });
+    }
+
+    inline auto spentBeforeHeight(BlockHeight blockHeight) {
+        return makePredicate([blockHeight](const RawOutput &output) { return output.isSpent() && output.getSpendingBlockHeight() < blockHeight; });
+    }
+
+    inline auto spentAfterHeight(BlockHeight blockHeight) {
+        return makePredicate([blockHeight](const RawOutput &output) { return output.isSpent() && output.getSpendingBlockHeight() >= blockHeight; });
+    }
+
+    inline auto spentWithinRelativeHeight(BlockHeight difference) {
+        return makePredicate([difference](const RawOutput &output) {
+            return output.isSpent() && output.getSpendingBlockHeight() - output.getBlockHeight() < difference;
+        });
+    }
+
+    inline auto spentOutsideRelativeHeight(BlockHeight difference) {
+        return makePredicate([difference](const RawOutput &output) {
+            return output.isSpent() && output.getSpendingBlockHeight() - output.getBlockHeight() >= difference;
+        });
+    }
+
+    inline auto valueAtLeast(int64_t value) {
+        return makePredicate([value](const RawOutput &output) { return output.getValue() >= value; });
+    }
+
+    inline auto valueBelow(int64_t value) {
+        return makePredicate([value](const RawOutput &output) { return output.getValue() < value; });
+    }
+
+    /** Call func(RawOutput) for every output of tx that matches pred */
+    template <typename Pred, typename Func>
+    inline void forEach(const Transaction &tx, const OutputPredicate<Pred> &pred, Func &&func) {
+        auto range = tx.outputs();
+        for (uint16_t i = 0; i < range.size(); i++) {
+            RawOutput output{&range.inouts[i], &range, i};
+            if (pred(output)) {
+                func(output);
+            }
+        }
+    }
+
+    /** Call func(RawOutput) for every matching output of a range of transactions, like a Block */
+    CPP_template(typename T, typename Pred, typename Func)(requires std::is_same<ranges::range_value_t<T>, Transaction>::value)
+    inline void forEach(T &&txes, const OutputPredicate<Pred> &pred, Func &&func) {
+        RANGES_FOR(auto tx, txes) {
+            forEach(tx, pred, func);
+        }
+    }
+
+    /** Call func(RawOutput) for every matching output of a range of blocks, like a BlockRange */
+    CPP_template(typename T, typename Pred, typename Func)(requires std::is_same<ranges::range_value_t<T>, Block>::value)
+    inline void forEach(T &&blocks, const OutputPredicate<Pred> &pred, Func &&func) {
+        RANGES_FOR(auto block, blocks) {
+            forEach(block, pred, func);
+        }
+    }
+
+    template <typename T, typename Pred>
+    inline int64_t totalValue(T &&t, const OutputPredicate<Pred> &pred) {
+        int64_t total = 0;
+        forEach(std::forward<T>(t), pred, [&](const RawOutput &output) { total += output.getValue(); });
+        return total;
+    }
+
+    template <typename T, typename Pred>
+    inline uint64_t count(T &&t, const OutputPredicate<Pred> &pred) {
+        uint64_t total = 0;
+        forEach(std::forward<T>(t), pred, [&](const RawOutput &) { total++; });
+        return total;
+    }
+
+    /** The matching outputs, the only reduction that creates Output objects */
+    template <typename T, typename Pred>
+    inline std::vector<Output> collect(T &&t, const OutputPredicate<Pred> &pred) {
+        std::vector<Output> outputs;
+        forEach(std::forward<T>(t), pred, [&](const RawOutput &output) { outputs.push_back(output.toOutput()); });
+        return outputs;
+    }
+}} // namespace blocksci::scan
+
+#endif /* blocksci_chain_output_scan_hpp */
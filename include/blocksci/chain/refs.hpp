@@ -0,0 +1,109 @@
+//
+//  refs.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_chain_refs_hpp
+#define blocksci_chain_refs_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/chain/chain_fwd.hpp>
+#include <blocksci/chain/input_pointer.hpp>
+#include <blocksci/chain/output_pointer.hpp>
+#include <blocksci/core/address_types.hpp>
+#include <blocksci/core/hash_combine.hpp>
+#include <blocksci/core/typedefs.hpp>
+
+#include <range/v3/utility/optional.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+/** Lightweight handles of transactions, inputs and outputs
+ *
+ * A Transaction caches pointers into the data files and an Input or Output its spending information, which makes
+ * vectors of them several times larger than the numbers identifying them. The refs only store those numbers and look
+ * up everything else through an explicitly passed DataAccess, so they suit large intermediate collections such
+ * as clustering and taint frontiers. The heavy objects can be materialized from a ref on demand.
+ */
+namespace blocksci {
+
+    /** Identifies a transaction by its tx number */
+    struct BLOCKSCI_EXPORT TxRef {
+        uint32_t txNum;
+
+        TxRef() = default;
+        explicit TxRef(uint32_t txNum_) : txNum(txNum_) {}
+        TxRef(const Transaction &tx);
+
+        bool operator==(const TxRef &other) const { return txNum == other.txNum; }
+        bool operator!=(const TxRef &other) const { return txNum != other.txNum; }
+        bool operator<(const TxRef &other) const { return txNum < other.txNum; }
+        bool operator<=(const TxRef &other) const { return txNum <= other.txNum; }
+        bool operator>(const TxRef &other) const { return txNum > other.txNum; }
+        bool operator>=(const TxRef &other) const { return txNum >= other.txNum; }
+    };
+
+    /** Identifies an output by tx number and output number */
+    using OutputRef = OutputPointer;
+
+    /** Identifies an input by tx number and input number */
+    using InputRef = InputPointer;
+
+    static_assert(std::is_trivially_copyable<TxRef>::value && sizeof(TxRef) == 4, "TxRef must stay a plain tx number");
+    static_assert(std::is_trivially_copyable<OutputRef>::value && sizeof(OutputRef) == 8, "OutputRef must stay a plain pointer");
+    static_assert(std::is_trivially_copyable<InputRef>::value && sizeof(InputRef) == 8, "InputRef must stay a plain pointer");
+
+    /** The full objects, constructed on demand */
+    Transaction BLOCKSCI_EXPORT materialize(TxRef tx, DataAccess &access);
+    Output BLOCKSCI_EXPORT materialize(const OutputRef &output, DataAccess &access);
+    Input BLOCKSCI_EXPORT materialize(const InputRef &input, DataAccess &access);
+
+    uint16_t BLOCKSCI_EXPORT inputCount(TxRef tx, DataAccess &access);
+    uint16_t BLOCKSCI_EXPORT outputCount(TxRef tx, DataAccess &access);
+    BlockHeight BLOCKSCI_EXPORT getBlockHeight(TxRef tx, DataAccess &access);
+    bool BLOCKSCI_EXPORT isCoinbase(TxRef tx, DataAccess &access);
+    int64_t BLOCKSCI_EXPORT totalInputValue(TxRef tx, DataAccess &access);
+    int64_t BLOCKSCI_EXPORT totalOutputValue(TxRef tx, DataAccess &access);
+
+    /** Uses the tx fee column when it covers the transaction */
+    int64_t BLOCKSCI_EXPORT fee(TxRef tx, DataAccess &access);
+
+    inline OutputRef outputRef(TxRef tx, uint16_t outputNum) {
+        return {tx.txNum, outputNum};
+    }
+
+    inline InputRef inputRef(TxRef tx, uint16_t inputNum) {
+        return {tx.txNum, inputNum};
+    }
+
+    int64_t BLOCKSCI_EXPORT getValue(const OutputRef &output, DataAccess &access);
+    AddressType::Enum BLOCKSCI_EXPORT getType(const OutputRef &output, DataAccess &access);
+    uint32_t BLOCKSCI_EXPORT getAddressNum(const OutputRef &output, DataAccess &access);
+    bool BLOCKSCI_EXPORT isSpent(const OutputRef &output, DataAccess &access);
+
+    /** Transaction spending the output, empty if it is unspent at the loaded block height */
+    ranges::optional<TxRef> BLOCKSCI_EXPORT getSpendingTx(const OutputRef &output, DataAccess &access);
+
+    int64_t BLOCKSCI_EXPORT getValue(const InputRef &input, DataAccess &access);
+    AddressType::Enum BLOCKSCI_EXPORT getType(const InputRef &input, DataAccess &access);
+    uint32_t BLOCKSCI_EXPORT getAddressNum(const InputRef &input, DataAccess &access);
+
+    /** Output spent by the input */
+    OutputRef BLOCKSCI_EXPORT getSpentOutput(const InputRef &input, DataAccess &access);
+} // namespace blocksci
+
+namespace std {
+    template<> struct BLOCKSCI_EXPORT hash<blocksci::TxRef> {
+        size_t operator()(const blocksci::TxRef &tx) const {
+            std::size_t seed = 8735113;
+            blocksci::hash_combine(seed, tx.txNum);
+            return seed;
+        }
+    };
+} // namespace std
+
+#endif /* blocksci_chain_refs_hpp */
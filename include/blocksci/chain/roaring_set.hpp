@@ -0,0 +1,162 @@
+//
+//  roaring_set.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_chain_roaring_set_hpp
+#define blocksci_chain_roaring_set_hpp
+
+#include <blocksci/blocksci_export.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace blocksci {
+
+    /** Compressed set of 64 bit integers (roaring bitmap)
+     *
+     * The values are grouped by their upper 48 bits. Every group of up to 2^16 values is stored in a container that is
+     * either a sorted array of the lower 16 bits (up to 4096 values) or a bitmap of 2^16 bits. Dense sets like the
+     * txNums touching a large cluster take about one bit per possible value, sparse sets two bytes per value, and set
+     * algebra works on whole 64 bit words of the bitmaps.
+     */
+    class BLOCKSCI_EXPORT RoaringSet {
+    public:
+        /** Containers with more values than this are stored as bitmaps */
+        static constexpr uint32_t maxArraySize = 4096;
+        static constexpr uint32_t bitmapWords = (1 << 16) / 64;
+
+        struct Container {
+            uint64_t key = 0;
+            uint32_t cardinality = 0;
+            /** Sorted lower bits of the values while cardinality <= maxArraySize */
+            std::vector<uint16_t> array;
+            /** bitmapWords words once cardinality > maxArraySize */
+            std::vector<uint64_t> bitmap;
+
+            bool isBitmap() const {
+                return !bitmap.empty();
+            }
+
+            bool contains(uint16_t low) const;
+            bool add(uint16_t low);
+            bool remove(uint16_t low);
+
+            /** Switch to the representation that fits the current cardinality */
+            void normalize();
+        };
+
+        class BLOCKSCI_EXPORT const_iterator {
+        public:
+            using self_type = const_iterator;
+            using value_type = uint64_t;
+            using pointer = const uint64_t *;
+            using reference = uint64_t;
+            using difference_type = std::ptrdiff_t;
+            using iterator_category = std::forward_iterator_tag;
+
+            const_iterator() = default;
+            const_iterator(const RoaringSet *set_, size_t containerNum_);
+
+            value_type operator*() const { return current; }
+
+            self_type &operator++();
+            self_type operator++(int) { self_type tmp = *this; this->operator++(); return tmp; }
+
+            bool operator==(const self_type &rhs) const { return containerNum == rhs.containerNum && position == rhs.position; }
+            bool operator!=(const self_type &rhs) const { return !(*this == rhs); }
+
+        private:
+            const RoaringSet *set = nullptr;
+            size_t containerNum = 0;
+            /** Index into the array, or bit number in the bitmap */
+            uint32_t position = 0;
+            uint64_t current = 0;
+
+            /** Move to the first value at or after position, continuing with the next containers */
+            void settle();
+        };
+
+        RoaringSet() = default;
+
+        /** Set of the given values, which don't need to be sorted */
+        explicit RoaringSet(std::vector<uint64_t> values);
+
+        /** Build from sorted values without duplicates, much faster than adding them one by one */
+        static RoaringSet fromSorted(const uint64_t *begin, const uint64_t *end);
+        static RoaringSet fromSorted(const uint32_t *begin, const uint32_t *end);
+
+        /** All values in [begin, end) */
+        static RoaringSet fromInterval(uint64_t begin, uint64_t end);
+
+        /** Returns whether the value was added */
+        bool add(uint64_t value);
+
+        /** Returns whether the value was removed */
+        bool remove(uint64_t value);
+
+        bool contains(uint64_t value) const;
+
+        uint64_t size() const;
+
+        bool empty() const {
+            return containers.empty();
+        }
+
+        void clear() {
+            containers.clear();
+        }
+
+        /** Smallest and largest value, the set must not be empty */
+        uint64_t min() const;
+        uint64_t max() const;
+
+        const_iterator begin() const {
+            return {this, 0};
+        }
+
+        const_iterator end() const {
+            return {this, containers.size()};
+        }
+
+        std::vector<uint64_t> toVector() const;
+
+        /** Approximate memory held by the set */
+        size_t memoryUsage() const;
+
+        RoaringSet &operator|=(const RoaringSet &other);
+        RoaringSet &operator&=(const RoaringSet &other);
+        RoaringSet &operator-=(const RoaringSet &other);
+
+        friend RoaringSet operator|(RoaringSet a, const RoaringSet &b) { return a |= b; }
+        friend RoaringSet operator&(RoaringSet a, const RoaringSet &b) { return a &= b; }
+        friend RoaringSet operator-(RoaringSet a, const RoaringSet &b) { return a -= b; }
+
+        friend bool operator==(const RoaringSet &a, const RoaringSet &b);
+        friend bool operator!=(const RoaringSet &a, const RoaringSet &b) { return !(a == b); }
+
+        /** Write the set to a file, throws std::runtime_error if it can't be written */
+        void save(const std::string &path) const;
+
+        /** Read a set written by save, throws std::runtime_error if the file is missing or malformed */
+        static RoaringSet load(const std::string &path);
+
+        const std::vector<Container> &getContainers() const {
+            return containers;
+        }
+
+    private:
+        /** Sorted by key */
+        std::vector<Container> containers;
+
+        std::vector<Container>::iterator findContainer(uint64_t key);
+        std::vector<Container>::const_iterator findContainer(uint64_t key) const;
+    };
+} // namespace blocksci
+
+#endif /* blocksci_chain_roaring_set_hpp */
@@ -0,0 +1,74 @@
+//
+//  sampling.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_chain_sampling_hpp
+#define blocksci_chain_sampling_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/chain/chain_fwd.hpp>
+#include <blocksci/chain/output_pointer.hpp>
+#include <blocksci/core/typedefs.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace blocksci {
+    /* Random samples of the txes and outputs of a block range
+     *
+     * The txes and outputs of consecutive blocks have consecutive numbers, so the samplers draw numbers from the
+     * ranges given by the counts of the RawBlocks and never read the sampled objects. Except for the samples
+     * stratified by address type the cost is proportional to the sample size and not to the size of the range. The
+     * same seed and range always give the same sample. Throws std::invalid_argument for probabilities outside of
+     * [0, 1] and buckets of less than one block. */
+
+    /** Sorted tx numbers of a Bernoulli sample, every tx is included with the given probability */
+    std::vector<uint32_t> BLOCKSCI_EXPORT bernoulliTxSample(BlockRange &blocks, double probability, uint64_t seed);
+
+    /** Sorted tx numbers of count txes drawn uniformly without replacement, all txes if the range has fewer */
+    std::vector<uint32_t> BLOCKSCI_EXPORT uniformTxSample(BlockRange &blocks, uint64_t count, uint64_t seed);
+
+    /** Outputs of a Bernoulli sample in chain order, every output is included with the given probability */
+    std::vector<OutputPointer> BLOCKSCI_EXPORT bernoulliOutputSample(BlockRange &blocks, double probability, uint64_t seed);
+
+    /** count outputs drawn uniformly without replacement in chain order, all outputs if the range has fewer */
+    std::vector<OutputPointer> BLOCKSCI_EXPORT uniformOutputSample(BlockRange &blocks, uint64_t count, uint64_t seed);
+
+    /** Uniform samples of the txes of consecutive buckets of blocks */
+    struct BLOCKSCI_EXPORT StratifiedTxSample {
+        /** First height of every bucket */
+        std::vector<BlockHeight> bucketStarts;
+
+        /** Sorted tx numbers, those of bucket i at positions [offsets[i], offsets[i + 1]) */
+        std::vector<uint32_t> txNums;
+        std::vector<uint64_t> offsets;
+    };
+
+    /** Up to perBucket txes of every bucket of bucketBlocks blocks, the last bucket possibly shorter */
+    StratifiedTxSample BLOCKSCI_EXPORT stratifiedTxSample(BlockRange &blocks, BlockHeight bucketBlocks, uint64_t perBucket, uint64_t seed);
+
+    /** Uniform samples of the outputs of consecutive buckets of blocks, optionally split by address type */
+    struct BLOCKSCI_EXPORT StratifiedOutputSample {
+        /** First height of every bucket */
+        std::vector<BlockHeight> bucketStarts;
+
+        /** Whether every bucket is split into one stratum per AddressType::Enum */
+        bool byAddressType = false;
+
+        /** Outputs in chain order within every stratum, those of stratum i at positions [offsets[i], offsets[i + 1]).
+         * Stratum i is bucket i, or bucket i / AddressType::size and type i % AddressType::size if byAddressType. */
+        std::vector<OutputPointer> outputs;
+        std::vector<uint64_t> offsets;
+    };
+
+    /** Up to perStratum outputs of every bucket of bucketBlocks blocks or of every address type within each bucket
+     *
+     * Splitting by address type scans the type column of the outputs in parallel, keeping a reservoir per stratum
+     * that only draws random numbers when it is replaced into, since the RawBlocks don't count outputs by type. */
+    StratifiedOutputSample BLOCKSCI_EXPORT stratifiedOutputSample(BlockRange &blocks, BlockHeight bucketBlocks, uint64_t perStratum, bool byAddressType, uint64_t seed);
+} // namespace blocksci
+
+#endif /* blocksci_chain_sampling_hpp */
@@ -0,0 +1,50 @@
+//
+//  shard_plan.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_chain_shard_plan_hpp
+#define blocksci_chain_shard_plan_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/chain/block_range.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace blocksci {
+    /** Default number of txes per shard, about 8 million */
+    constexpr uint32_t defaultShardTxCount = uint32_t{1} << 23;
+
+    /** Part of a block range processed by one host of a distributed mapReduce */
+    struct BLOCKSCI_EXPORT BlockShard {
+        /** Number of the shard, the same for every query touching its blocks */
+        uint32_t shard;
+
+        /** Index of the host in the list passed to planShards */
+        uint32_t host;
+
+        /** Blocks of the shard within the planned range */
+        BlockRange blocks;
+    };
+
+    /** Host that processes the shard, picked by rendezvous hashing of the host names
+     *
+     * Each shard goes to the host with the highest hash of (host, shard), so a shard stays on the same host across
+     * queries and adding or removing a host only moves the shards it gains or loses. Throws std::invalid_argument if
+     * hosts is empty. */
+    uint32_t BLOCKSCI_EXPORT shardHost(uint32_t shard, const std::vector<std::string> &hosts);
+
+    /** Split the blocks into shards and assign each to a host for a distributed mapReduce
+     *
+     * Shard boundaries don't depend on the range: shard i holds the blocks whose first tx number is in
+     * [i * shardTxCount, (i + 1) * shardTxCount). Every host therefore scans the same parts of the chain whichever range
+     * is queried, and keeps them in its page cache, and the boundaries stay put as the chain grows. Shards are returned
+     * in block order, clipped to the range. */
+    std::vector<BlockShard> BLOCKSCI_EXPORT planShards(BlockRange &blocks, const std::vector<std::string> &hosts, uint32_t shardTxCount = defaultShardTxCount);
+} // namespace blocksci
+
+#endif /* blocksci_chain_shard_plan_hpp */
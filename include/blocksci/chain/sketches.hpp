@@ -0,0 +1,210 @@
+//
+//  sketches.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_chain_sketches_hpp
+#define blocksci_chain_sketches_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/chain/chain_fwd.hpp>
+#include <blocksci/core/address_types.hpp>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/** Mergeable sketches for approximate queries with bounded memory
+ *
+ * Every sketch can be default constructed and merged, so it can be used as the result of BlockRange::mapReduce:
+ *
+ *     chain.mapReduce<HyperLogLog>([](BlockRange blocks) { ... }, [](HyperLogLog &a, HyperLogLog &b) -> HyperLogLog & {
+ *         a.merge(b);
+ *         return a;
+ *     });
+ *
+ * Merging into an empty sketch adopts the parameters of the other sketch, so the default constructed result of
+ * mapReduce merges with sketches of any size. Merging two non-empty sketches of different sizes throws
+ * std::invalid_argument.
+ *
+ * serialize() packs a sketch into a byte string that deserialize() turns back into an equal sketch, so sketches can
+ * be the results of mapReduce steps running in other processes or on other hosts.
+ */
+namespace blocksci {
+
+    /** Mix the bits of a 64 bit key, used to hash the keys added to the sketches */
+    inline uint64_t sketchHash(uint64_t key) {
+        key += 0x9e3779b97f4a7c15ULL;
+        key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+        return key ^ (key >> 31);
+    }
+
+    /** Key identifying an address in the sketches */
+    inline uint64_t sketchAddressKey(uint32_t scriptNum, AddressType::Enum type) {
+        return (static_cast<uint64_t>(scriptNum) << 8) | static_cast<uint64_t>(type);
+    }
+
+    /** Estimates the number of distinct keys added, using 2^precision bytes
+     *
+     * The relative standard error is about 1.04 / sqrt(2^precision), 0.8% for the default precision of 14. */
+    class BLOCKSCI_EXPORT HyperLogLog {
+        uint8_t precision;
+        std::vector<uint8_t> registers;
+
+    public:
+        explicit HyperLogLog(uint8_t precision = 14);
+
+        uint8_t getPrecision() const {
+            return precision;
+        }
+
+        void add(uint64_t key) {
+            auto hash = sketchHash(key);
+            auto index = hash >> (64 - precision);
+            // The marker bit bounds the rank at 64 - precision + 1
+            auto rest = (hash << precision) | (uint64_t{1} << (precision - 1));
+            auto rank = static_cast<uint8_t>(__builtin_clzll(rest) + 1);
+            if (rank > registers[index]) {
+                registers[index] = rank;
+            }
+        }
+
+        bool empty() const;
+
+        double estimate() const;
+
+        void merge(const HyperLogLog &other);
+
+        std::string serialize() const;
+
+        /** Sketch packed by serialize, throws std::invalid_argument if the data isn't one */
+        static HyperLogLog deserialize(const std::string &data);
+    };
+
+    /** Estimates how often each key was added using depth rows of width counters
+     *
+     * Estimates are never below the true count and exceed it by at most 2.7 * totalCount() / width with probability
+     * 1 - 0.37^depth. */
+    class BLOCKSCI_EXPORT CountMinSketch {
+        uint32_t width;
+        uint32_t depth;
+        uint64_t total = 0;
+        std::vector<uint64_t> counters;
+
+        uint32_t column(uint64_t key, uint32_t row) const {
+            return static_cast<uint32_t>(sketchHash(key + row * 0x9e3779b97f4a7c15ULL) % width);
+        }
+
+    public:
+        explicit CountMinSketch(uint32_t width = 2048, uint32_t depth = 4);
+
+        uint32_t getWidth() const {
+            return width;
+        }
+
+        uint32_t getDepth() const {
+            return depth;
+        }
+
+        uint64_t totalCount() const {
+            return total;
+        }
+
+        void add(uint64_t key, uint64_t count = 1) {
+            for (uint32_t row = 0; row < depth; row++) {
+                counters[row * width + column(key, row)] += count;
+            }
+            total += count;
+        }
+
+        uint64_t estimate(uint64_t key) const;
+
+        void merge(const CountMinSketch &other);
+
+        std::string serialize() const;
+
+        /** Sketch packed by serialize, throws std::invalid_argument if the data isn't one */
+        static CountMinSketch deserialize(const std::string &data);
+    };
+
+    /** Estimates quantiles and ranks of the values added (KLL sketch)
+     *
+     * Keeps O(k) values in a hierarchy of compactors, level h holding values that each stand for 2^h added values.
+     * The rank error is about 1.7 / k of the number of values, 0.9% for the default k of 200. */
+    class BLOCKSCI_EXPORT QuantileSketch {
+        uint16_t k;
+        uint64_t count = 0;
+        double minValue = 0;
+        double maxValue = 0;
+        uint64_t randomState = 0x2545f4914f6cdd1dULL;
+        std::vector<std::vector<double>> levels;
+
+        uint32_t capacity(size_t level) const;
+        size_t retainedCount() const;
+        size_t totalCapacity() const;
+        void compress();
+
+        /** (value, weight) pairs of all retained values sorted by value */
+        std::vector<std::pair<double, uint64_t>> weightedValues() const;
+
+    public:
+        explicit QuantileSketch(uint16_t k = 200);
+
+        uint16_t getK() const {
+            return k;
+        }
+
+        uint64_t size() const {
+            return count;
+        }
+
+        bool empty() const {
+            return count == 0;
+        }
+
+        double min() const {
+            return minValue;
+        }
+
+        double max() const {
+            return maxValue;
+        }
+
+        void add(double value);
+
+        void merge(const QuantileSketch &other);
+
+        std::string serialize() const;
+
+        /** Sketch packed by serialize, throws std::invalid_argument if the data isn't one */
+        static QuantileSketch deserialize(const std::string &data);
+
+        /** Value at the given fraction (in [0, 1]) of the sorted values, NaN if the sketch is empty */
+        double quantile(double fraction) const;
+
+        /** Same as calling quantile for every fraction, but sorts the retained values once */
+        std::vector<double> quantiles(const std::vector<double> &fractions) const;
+
+        /** Fraction of the values that are less than or equal to value */
+        double rank(double value) const;
+
+        /** Number of values in each of the buckets [splitPoints[i - 1], splitPoints[i]), the first bucket holding the
+         * values below splitPoints[0] and the last the values at or above splitPoints.back(). splitPoints must be sorted */
+        std::vector<uint64_t> histogram(const std::vector<double> &splitPoints) const;
+    };
+
+    /** Distinct addresses that receive an output in the blocks, computed in parallel */
+    HyperLogLog BLOCKSCI_EXPORT approximateDistinctAddresses(BlockRange &blocks, uint8_t precision = 14);
+
+    /** Distribution of the fee per virtual byte of the non-coinbase transactions in the blocks, computed in parallel */
+    QuantileSketch BLOCKSCI_EXPORT approximateFeeRates(BlockRange &blocks, uint16_t k = 200);
+
+    /** Distribution of the values of the outputs in the blocks, computed in parallel */
+    QuantileSketch BLOCKSCI_EXPORT approximateOutputValues(BlockRange &blocks, uint16_t k = 200);
+} // namespace blocksci
+
+#endif /* blocksci_chain_sketches_hpp */
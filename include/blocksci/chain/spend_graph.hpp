@@ -0,0 +1,76 @@
+//
+//  spend_graph.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_chain_spend_graph_hpp
+#define blocksci_chain_spend_graph_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/chain/tx_set.hpp>
+#include <blocksci/core/address_types.hpp>
+#include <blocksci/core/inout.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace blocksci {
+
+    /** Follow inputs to the transactions whose outputs they spend, or outputs to the transactions spending them */
+    enum class SpendDirection {
+        Ancestors,
+        Descendants
+    };
+
+    /** Restricts the edges a spend graph traversal follows, evaluated on the spent output of every edge */
+    struct BLOCKSCI_EXPORT SpendEdgeFilter {
+        /** Only follow outputs worth at least this many satoshis */
+        int64_t minValue = 0;
+
+        /** Bit i is set if outputs of address type i are followed, all types by default */
+        uint32_t addressTypes = (1u << AddressType::size) - 1;
+
+        static SpendEdgeFilter ofTypes(const std::vector<AddressType::Enum> &types, int64_t minValue = 0) {
+            SpendEdgeFilter filter;
+            filter.minValue = minValue;
+            filter.addressTypes = 0;
+            for (auto type : types) {
+                filter.addressTypes |= 1u << static_cast<uint32_t>(type);
+            }
+            return filter;
+        }
+
+        bool follows(const Inout &inout) const {
+            return inout.getValue() >= minValue && (addressTypes >> static_cast<uint32_t>(inout.getType())) & 1;
+        }
+    };
+
+    /** Transactions reached by a traversal and the followed edges between them in compressed sparse row form */
+    struct BLOCKSCI_EXPORT SpendSubgraph {
+        /** Sorted tx numbers of the reached transactions, including the sources */
+        std::vector<uint32_t> txNums;
+
+        /** Number of hops from the nearest source for every transaction */
+        std::vector<uint32_t> depths;
+
+        /** The edges of txNums[i] lead to txNums[edgeTargets[j]] for j in [edgeOffsets[i], edgeOffsets[i + 1]). There is
+         * one edge per followed input or output, so a pair of transactions can be joined by several edges */
+        std::vector<uint64_t> edgeOffsets;
+        std::vector<uint32_t> edgeTargets;
+    };
+
+    /** Transactions within depth hops of the sources in the spend graph, including the sources
+     *
+     * Runs a level synchronous breadth first search on the work pool of the chain, marking visited transactions in a
+     * bitmap over all tx numbers (txCount() / 8 bytes). */
+    TxSet BLOCKSCI_EXPORT spendNeighborhood(const std::vector<uint32_t> &sources, uint32_t depth, SpendDirection direction,
+                                            const SpendEdgeFilter &filter, DataAccess &access);
+
+    /** Same traversal as spendNeighborhood, but also returns the hop counts and the edges between the reached transactions */
+    SpendSubgraph BLOCKSCI_EXPORT spendSubgraph(const std::vector<uint32_t> &sources, uint32_t depth, SpendDirection direction,
+                                                const SpendEdgeFilter &filter, DataAccess &access);
+} // namespace blocksci
+
+#endif /* blocksci_chain_spend_graph_hpp */
@@ -21,6 +21,7 @@
 #include <range/v3/utility/optional.hpp>
 
 #include <chrono>
+#include <vector>
 
 namespace blocksci {
     class uint256;
@@ -38,10 +39,20 @@ namespace blocksci {
     class BLOCKSCI_EXPORT Transaction {
     private:
         DataAccess *access;
-        TxData data;
+        mutable TxData data;
         uint32_t maxTxCount;
         mutable BlockHeight blockHeight;
         friend TransactionRange;
+        
+        /** Look up a column of data that hasn't been resolved yet */
+        void resolveColumn(TxDataColumn column) const;
+        
+        const TxData &resolvedData(TxDataColumn column) const {
+            if (!data.isResolved(column)) {
+                resolveColumn(column);
+            }
+            return data;
+        }
     public:
         /** Blockchain-wide transaction number in the same order they appear in the blockchain, also called transaction index */
         uint32_t txNum;
@@ -63,11 +74,11 @@ namespace blocksci {
         }
 
         uint256 getHash() const {
-            return *data.hash;
+            return *resolvedData(TxDataColumn::Hash).hash;
         }
         
         int32_t getVersion() const {
-            return *data.version;
+            return *resolvedData(TxDataColumn::Version).version;
         }
         
         BlockHeight calculateBlockHeight() const;
@@ -109,20 +120,8 @@ namespace blocksci {
             return virtualSize();
         }
         
-        int64_t fee() const {
-            if (isCoinbase()) {
-                return 0;
-            } else {
-                int64_t total = 0;
-                for (auto input : inputs()) {
-                    total += input.getValue();
-                }
-                for (auto output : outputs()) {
-                    total -= output.getValue();
-                }
-                return total;
-            }
-        }
+        /** Sum of the input values minus the sum of the output values, read from chain/tx_fee.dat if it exists */
+        int64_t fee() const;
         
         uint32_t locktime() const {
             return data.rawTx->locktime;
@@ -141,7 +140,8 @@ namespace blocksci {
         }
         
         InputRange inputs() const {
-            return {data.rawTx->beginInputs(), data.spentOutputNums, data.sequenceNumbers, getBlockHeight(), txNum, inputCount(), maxTxCount, access};
+            auto &inputData = resolvedData(TxDataColumn::Inputs);
+            return {data.rawTx->beginInputs(), inputData.spentOutputNums, inputData.sequenceNumbers, getBlockHeight(), txNum, inputCount(), maxTxCount, access};
         }
         
         bool isCoinbase() const {
@@ -178,6 +178,14 @@ namespace blocksci {
     using input_range = decltype(std::declval<Transaction>().inputs());
     using output_range = decltype(std::declval<Transaction>().outputs());
     
+    /** Construct the transactions with the given tx numbers (in the same order) using batched, prefetching lookups
+     * of both the transaction data and the block heights */
+    std::vector<Transaction> BLOCKSCI_EXPORT getTransactions(const std::vector<uint32_t> &txNums, DataAccess &access);
+    
+    /** Tx numbers of the transactions with the given hashes, entries are empty for hashes without a matching transaction */
+    std::vector<ranges::optional<uint32_t>> BLOCKSCI_EXPORT getTxIndexes(const std::vector<uint256> &txHashes, DataAccess &access);
+    std::vector<ranges::optional<uint32_t>> BLOCKSCI_EXPORT getTxIndexes(const std::vector<std::string> &txHashes, DataAccess &access);
+    
     bool BLOCKSCI_EXPORT hasFeeGreaterThan(Transaction &tx, int64_t txFee);
     
     bool BLOCKSCI_EXPORT includesOutputOfType(const Transaction &tx, AddressType::Enum type);
@@ -74,10 +74,16 @@ namespace blocksci {
                     updateNextBlock();
                 }
                 resetTx();
-                tx.data.sequenceNumbers -= tx.data.rawTx->inputCount;
-                tx.data.spentOutputNums -= tx.data.rawTx->inputCount;
-                --tx.data.version;
-                --tx.data.hash;
+                if (tx.data.isResolved(TxDataColumn::Inputs)) {
+                    tx.data.sequenceNumbers -= tx.data.rawTx->inputCount;
+                    tx.data.spentOutputNums -= tx.data.rawTx->inputCount;
+                }
+                if (tx.data.isResolved(TxDataColumn::Version)) {
+                    --tx.data.version;
+                }
+                if (tx.data.isResolved(TxDataColumn::Hash)) {
+                    --tx.data.hash;
+                }
                 return *this;
             }
             
@@ -0,0 +1,98 @@
+//
+//  tx_fee_columns.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_tx_fee_columns_hpp
+#define blocksci_tx_fee_columns_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/chain/chain_fwd.hpp>
+
+#include <algorithm>
+#include <cstdint>
+
+namespace blocksci {
+    class DataAccess;
+
+    /** Columnar view of the fees of a contiguous range of transactions, backed by the optional chain/tx_fee.dat and
+     * chain/tx_vsize.dat files
+     *
+     * The fee of a transaction otherwise needs the values of all of its inputs and outputs. The columns are written
+     * along with the output columns by "blocksci_parser build-output-columns" and extended by later parser updates.
+     * Element i of the view is transaction firstTxNum + i.
+     */
+    struct BLOCKSCI_EXPORT TxFeeColumns {
+        /** Fee in satoshis of every transaction, 0 for coinbase transactions */
+        const int64_t *fees = nullptr;
+
+        /** Virtual size of every transaction, same as Transaction::virtualSize */
+        const uint32_t *virtualSizes = nullptr;
+
+        /** Tx number of the first transaction in the view */
+        uint32_t firstTxNum = 0;
+
+        /** Number of transactions in the view */
+        uint32_t count = 0;
+
+        uint32_t size() const {
+            return count;
+        }
+
+        bool empty() const {
+            return count == 0;
+        }
+
+        int64_t getFee(uint32_t i) const {
+            return fees[i];
+        }
+
+        uint32_t getVirtualSize(uint32_t i) const {
+            return virtualSizes[i];
+        }
+
+        /** Same as feePerByte in algorithms.hpp */
+        double getFeePerByte(uint32_t i) const {
+            return static_cast<double>(fees[i]) / static_cast<double>(virtualSizes[i]);
+        }
+
+        /* Plain loops over the columns like the aggregations of OutputColumns */
+
+        int64_t maxFee() const {
+            int64_t curMax = 0;
+            for (uint32_t i = 0; i < count; i++) {
+                curMax = std::max(curMax, fees[i]);
+            }
+            return curMax;
+        }
+
+        int64_t totalFee() const {
+            int64_t total = 0;
+            for (uint32_t i = 0; i < count; i++) {
+                total += fees[i];
+            }
+            return total;
+        }
+
+        uint64_t totalVirtualSize() const {
+            uint64_t total = 0;
+            for (uint32_t i = 0; i < count; i++) {
+                total += virtualSizes[i];
+            }
+            return total;
+        }
+    };
+
+    /** Check whether the fee columns exist and cover all loaded transactions */
+    bool BLOCKSCI_EXPORT hasTxFeeColumns(DataAccess &access);
+
+    /** Fee columns of the transactions (eg. a Block). Throws if the columns are not available */
+    TxFeeColumns BLOCKSCI_EXPORT txFeeColumns(const TransactionRange &txes);
+
+    /** Fee columns of all transactions of the blocks */
+    TxFeeColumns BLOCKSCI_EXPORT txFeeColumns(BlockRange &blocks);
+} // namespace blocksci
+
+#endif /* blocksci_tx_fee_columns_hpp */
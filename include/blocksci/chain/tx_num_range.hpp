@@ -0,0 +1,100 @@
+//
+//  tx_num_range.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_chain_tx_num_range_hpp
+#define blocksci_chain_tx_num_range_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/chain/transaction.hpp>
+
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+namespace blocksci {
+
+    /** Iterable collection of the transactions with the given tx numbers, eg. the result of BlockRange::filterTxNums
+     *
+     * Only the tx numbers are stored, the transactions are constructed when they are accessed. */
+    class BLOCKSCI_EXPORT TxNumRange {
+    public:
+        class iterator {
+        public:
+            using self_type = iterator;
+            using value_type = Transaction;
+            using pointer = Transaction;
+            using reference = Transaction;
+            using difference_type = std::ptrdiff_t;
+            using iterator_category = std::random_access_iterator_tag;
+
+            iterator() = default;
+            iterator(std::vector<uint32_t>::const_iterator it_, DataAccess *access_) : it(it_), access(access_) {}
+
+            self_type &operator+=(difference_type i) { it += i; return *this; }
+            self_type &operator-=(difference_type i) { it -= i; return *this; }
+            self_type &operator++() { ++it; return *this; }
+            self_type &operator--() { --it; return *this; }
+            self_type operator++(int) { self_type tmp = *this; ++it; return tmp; }
+            self_type operator--(int) { self_type tmp = *this; --it; return tmp; }
+            self_type operator+(difference_type i) const { self_type tmp = *this; tmp.it += i; return tmp; }
+            self_type operator-(difference_type i) const { self_type tmp = *this; tmp.it -= i; return tmp; }
+
+            value_type operator*() const { return Transaction(*it, *access); }
+            value_type operator[](difference_type i) const { return Transaction(it[i], *access); }
+
+            bool operator==(const self_type& rhs) const { return it == rhs.it; }
+            bool operator!=(const self_type& rhs) const { return it != rhs.it; }
+            bool operator<(const self_type& rhs) const { return it < rhs.it; }
+            bool operator>(const self_type& rhs) const { return it > rhs.it; }
+            bool operator<=(const self_type& rhs) const { return it <= rhs.it; }
+            bool operator>=(const self_type& rhs) const { return it >= rhs.it; }
+
+            difference_type operator-(const self_type& rhs) const { return it - rhs.it; }
+        private:
+            std::vector<uint32_t>::const_iterator it;
+            DataAccess *access = nullptr;
+        };
+
+        TxNumRange() = default;
+        TxNumRange(std::vector<uint32_t> txNums_, DataAccess &access_) : txNums(std::move(txNums_)), access(&access_) {}
+
+        iterator begin() const {
+            return {txNums.begin(), access};
+        }
+
+        iterator end() const {
+            return {txNums.end(), access};
+        }
+
+        Transaction operator[](size_t i) const {
+            return Transaction(txNums[i], *access);
+        }
+
+        size_t size() const {
+            return txNums.size();
+        }
+
+        bool empty() const {
+            return txNums.empty();
+        }
+
+        const std::vector<uint32_t> &getTxNums() const {
+            return txNums;
+        }
+
+        /** All transactions, looked up in one batch */
+        std::vector<Transaction> toTransactions() const {
+            return getTransactions(txNums, *access);
+        }
+
+    private:
+        std::vector<uint32_t> txNums;
+        DataAccess *access = nullptr;
+    };
+} // namespace blocksci
+
+#endif /* blocksci_chain_tx_num_range_hpp */
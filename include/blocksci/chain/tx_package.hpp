@@ -0,0 +1,109 @@
+//
+//  tx_package.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_tx_package_hpp
+#define blocksci_tx_package_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/chain/chain_fwd.hpp>
+#include <blocksci/core/typedefs.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace blocksci {
+    class DataAccess;
+
+    /** Per tx bits of chain/tx_package_flags.dat */
+    namespace TxPackageFlag {
+        enum Enum : uint8_t {
+            /** The tx spends an output created by an earlier tx of the same block (zero-conf spend) */
+            SpendsSameBlock = 1,
+            /** An output of the tx is spent by a later tx of the same block */
+            HasSameBlockChild = 2
+        };
+    }
+
+    /** A tx spending an output of an earlier tx in the same block, given by the positions of both txes in the block
+     *
+     * A tx spending several outputs of the same parent has a single edge. */
+    struct BLOCKSCI_EXPORT InBlockEdge {
+        uint32_t child;
+        uint32_t parent;
+    };
+
+    /** The in-block edges of one block, stored twice: sorted by (child, parent) to find the parents of a tx and sorted
+     * by (parent, child) to find its children. Both point into the memory mapped edge files. */
+    struct BLOCKSCI_EXPORT BlockPackageEdges {
+        const InBlockEdge *byChild = nullptr;
+        const InBlockEdge *byParent = nullptr;
+        uint64_t count = 0;
+    };
+
+    /** Fee and virtual size of a tx together with its in-block ancestors, which a miner has to include to get the tx */
+    struct BLOCKSCI_EXPORT PackageFee {
+        int64_t fee = 0;
+        uint64_t virtualSize = 0;
+
+        /** Fee rate of the package in satoshis per virtual byte */
+        double feeRate() const {
+            return virtualSize > 0 ? static_cast<double>(fee) / static_cast<double>(virtualSize) : 0.0;
+        }
+    };
+
+    /** Same-block ancestry of the txes of one block, read from the files written by the parser
+     *
+     * Txes are referred to by their position within the block. A block can only spend outputs of its earlier txes, so
+     * parents always come before their children and the edges form a DAG in block order.
+     */
+    class BLOCKSCI_EXPORT BlockPackages {
+    public:
+        /** Throws std::runtime_error if the package files don't cover the block */
+        explicit BlockPackages(const Block &block);
+
+        uint32_t txCount() const {
+            return endTxNum - firstTxNum;
+        }
+
+        /** TxPackageFlag bits of the tx */
+        uint8_t flags(uint32_t position) const;
+
+        /** Positions of the direct in-block parents of the tx in block order */
+        std::vector<uint32_t> parents(uint32_t position) const;
+
+        /** Positions of the direct in-block children of the tx in block order */
+        std::vector<uint32_t> children(uint32_t position) const;
+
+        /** Positions of all in-block ancestors of the tx in block order */
+        std::vector<uint32_t> ancestors(uint32_t position) const;
+
+        /** Positions of all in-block descendants of the tx in block order */
+        std::vector<uint32_t> descendants(uint32_t position) const;
+
+        /** Fee and virtual size of every tx of the block together with its in-block ancestors, indexed by position. The
+         * coinbase has an empty package. Reads chain/tx_fee.dat and chain/tx_vsize.dat if they cover the block. */
+        std::vector<PackageFee> ancestorPackages() const;
+
+        const BlockPackageEdges &edges() const {
+            return blockEdges;
+        }
+
+    private:
+        DataAccess *access;
+        BlockHeight height;
+        uint32_t firstTxNum;
+        uint32_t endTxNum;
+        BlockPackageEdges blockEdges;
+
+        void checkPosition(uint32_t position) const;
+    };
+
+    /** Whether the package files cover every loaded block */
+    bool BLOCKSCI_EXPORT hasTxPackages(DataAccess &access);
+} // namespace blocksci
+
+#endif /* blocksci_tx_package_hpp */
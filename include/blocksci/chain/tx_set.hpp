@@ -0,0 +1,221 @@
+//
+//  tx_set.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_chain_tx_set_hpp
+#define blocksci_chain_tx_set_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/chain/output.hpp>
+#include <blocksci/chain/roaring_set.hpp>
+#include <blocksci/chain/transaction.hpp>
+
+#include <string>
+#include <vector>
+
+namespace blocksci {
+    class TransactionRange;
+    class BlockRange;
+
+    /** Set of transactions of one chain, stored as a compressed bitmap of their tx numbers
+     *
+     * Meant for intermediate results such as all transactions touching a cluster. Set algebra works directly on the
+     * bitmaps, iteration yields the transactions in chain order. */
+    class BLOCKSCI_EXPORT TxSet {
+    public:
+        class iterator {
+        public:
+            using self_type = iterator;
+            using value_type = Transaction;
+            using pointer = Transaction;
+            using reference = Transaction;
+            using difference_type = std::ptrdiff_t;
+            using iterator_category = std::forward_iterator_tag;
+
+            iterator() = default;
+            iterator(RoaringSet::const_iterator it_, DataAccess *access_) : it(it_), access(access_) {}
+
+            value_type operator*() const { return Transaction(static_cast<uint32_t>(*it), *access); }
+
+            self_type &operator++() { ++it; return *this; }
+            self_type operator++(int) { self_type tmp = *this; ++it; return tmp; }
+
+            bool operator==(const self_type& rhs) const { return it == rhs.it; }
+            bool operator!=(const self_type& rhs) const { return it != rhs.it; }
+        private:
+            RoaringSet::const_iterator it;
+            DataAccess *access = nullptr;
+        };
+
+        TxSet() = default;
+        TxSet(RoaringSet txNums_, DataAccess &access_) : txNums(std::move(txNums_)), access(&access_) {}
+        TxSet(const std::vector<uint32_t> &txNums, DataAccess &access);
+        TxSet(const std::vector<Transaction> &txes, DataAccess &access);
+        explicit TxSet(const TransactionRange &txes);
+        explicit TxSet(BlockRange &blocks);
+
+        iterator begin() const {
+            return {txNums.begin(), access};
+        }
+
+        iterator end() const {
+            return {txNums.end(), access};
+        }
+
+        uint64_t size() const {
+            return txNums.size();
+        }
+
+        bool empty() const {
+            return txNums.empty();
+        }
+
+        bool contains(uint32_t txNum) const {
+            return txNums.contains(txNum);
+        }
+
+        bool contains(const Transaction &tx) const {
+            return txNums.contains(tx.txNum);
+        }
+
+        void add(const Transaction &tx) {
+            txNums.add(tx.txNum);
+        }
+
+        const RoaringSet &getTxNums() const {
+            return txNums;
+        }
+
+        DataAccess &getAccess() const {
+            return *access;
+        }
+
+        /** All transactions, looked up in one batch */
+        std::vector<Transaction> toTransactions() const;
+
+        TxSet &operator|=(const TxSet &other);
+        TxSet &operator&=(const TxSet &other);
+        TxSet &operator-=(const TxSet &other);
+
+        friend TxSet operator|(TxSet a, const TxSet &b) { return a |= b; }
+        friend TxSet operator&(TxSet a, const TxSet &b) { return a &= b; }
+        friend TxSet operator-(TxSet a, const TxSet &b) { return a -= b; }
+
+        friend bool operator==(const TxSet &a, const TxSet &b) { return a.txNums == b.txNums; }
+        friend bool operator!=(const TxSet &a, const TxSet &b) { return a.txNums != b.txNums; }
+
+        void save(const std::string &path) const {
+            txNums.save(path);
+        }
+
+        static TxSet load(const std::string &path, DataAccess &access) {
+            return {RoaringSet::load(path), access};
+        }
+
+    private:
+        RoaringSet txNums;
+        DataAccess *access = nullptr;
+    };
+
+    /** Set of outputs of one chain, stored as a compressed bitmap of their blockchain-wide output numbers */
+    class BLOCKSCI_EXPORT OutputSet {
+    public:
+        class BLOCKSCI_EXPORT iterator {
+        public:
+            using self_type = iterator;
+            using value_type = Output;
+            using pointer = Output;
+            using reference = Output;
+            using difference_type = std::ptrdiff_t;
+            using iterator_category = std::forward_iterator_tag;
+
+            iterator() = default;
+            iterator(RoaringSet::const_iterator it_, RoaringSet::const_iterator end_, DataAccess *access_);
+
+            value_type operator*() const;
+
+            self_type &operator++();
+            self_type operator++(int) { self_type tmp = *this; this->operator++(); return tmp; }
+
+            bool operator==(const self_type& rhs) const { return it == rhs.it; }
+            bool operator!=(const self_type& rhs) const { return it != rhs.it; }
+        private:
+            RoaringSet::const_iterator it;
+            RoaringSet::const_iterator endIt;
+            DataAccess *access = nullptr;
+
+            /** Transaction containing the current output and its outputs [txFirstOutput, txEndOutput) */
+            uint32_t txNum = 0;
+            uint64_t txFirstOutput = 0;
+            uint64_t txEndOutput = 0;
+
+            void updateTx();
+        };
+
+        OutputSet() = default;
+        OutputSet(RoaringSet outputNums_, DataAccess &access_) : outputNums(std::move(outputNums_)), access(&access_) {}
+        OutputSet(const std::vector<Output> &outputs, DataAccess &access);
+
+        /** All outputs of the given transactions */
+        explicit OutputSet(const TxSet &txes);
+
+        iterator begin() const {
+            return {outputNums.begin(), outputNums.end(), access};
+        }
+
+        iterator end() const {
+            return {outputNums.end(), outputNums.end(), access};
+        }
+
+        uint64_t size() const {
+            return outputNums.size();
+        }
+
+        bool empty() const {
+            return outputNums.empty();
+        }
+
+        bool contains(const Output &output) const;
+
+        void add(const Output &output);
+
+        const RoaringSet &getOutputNums() const {
+            return outputNums;
+        }
+
+        DataAccess &getAccess() const {
+            return *access;
+        }
+
+        /** Transactions containing at least one of the outputs */
+        TxSet txes() const;
+
+        OutputSet &operator|=(const OutputSet &other);
+        OutputSet &operator&=(const OutputSet &other);
+        OutputSet &operator-=(const OutputSet &other);
+
+        friend OutputSet operator|(OutputSet a, const OutputSet &b) { return a |= b; }
+        friend OutputSet operator&(OutputSet a, const OutputSet &b) { return a &= b; }
+        friend OutputSet operator-(OutputSet a, const OutputSet &b) { return a -= b; }
+
+        friend bool operator==(const OutputSet &a, const OutputSet &b) { return a.outputNums == b.outputNums; }
+        friend bool operator!=(const OutputSet &a, const OutputSet &b) { return a.outputNums != b.outputNums; }
+
+        void save(const std::string &path) const {
+            outputNums.save(path);
+        }
+
+        static OutputSet load(const std::string &path, DataAccess &access) {
+            return {RoaringSet::load(path), access};
+        }
+
+    private:
+        RoaringSet outputNums;
+        DataAccess *access = nullptr;
+    };
+} // namespace blocksci
+
+#endif /* blocksci_chain_tx_set_hpp */
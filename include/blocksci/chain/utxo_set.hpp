@@ -0,0 +1,51 @@
+//
+//  utxo_set.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_chain_utxo_set_hpp
+#define blocksci_chain_utxo_set_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/chain/chain_fwd.hpp>
+#include <blocksci/chain/tx_set.hpp>
+#include <blocksci/core/typedefs.hpp>
+
+namespace blocksci {
+
+    /** Change of the UTXO set between two heights, @see utxoSetDelta */
+    struct BLOCKSCI_EXPORT UTXOSetDelta {
+        BlockHeight startHeight = 0;
+        BlockHeight endHeight = 0;
+
+        /** Outputs created in the blocks [startHeight, endHeight) that are still unspent at endHeight */
+        OutputSet created;
+
+        /** Outputs created before startHeight that are spent in the blocks [startHeight, endHeight) */
+        OutputSet spent;
+
+        /** Turn the UTXO set at startHeight into the one at endHeight */
+        void apply(OutputSet &utxos) const {
+            utxos -= spent;
+            utxos |= created;
+        }
+    };
+
+    /** Outputs that are unspent right before the block at height is mined, so all outputs of the blocks [0, height)
+     * that no tx of these blocks spends
+     *
+     * Runs one parallel scan over the spending tx of every output, read from output_spent_tx.dat if the output columns
+     * have been built and from the outputs in tx_data.dat otherwise. An output is unspent at height if its spending tx
+     * comes after the first tx of the block, so no spending tx has to be looked up. chain must start at height 0. */
+    OutputSet BLOCKSCI_EXPORT utxoSetAt(BlockRange &chain, BlockHeight height);
+
+    /** Outputs added to and removed from the UTXO set by the blocks [startHeight, endHeight)
+     *
+     * Only reads the inputs and outputs of these blocks, so a series of UTXO set statistics is built from one
+     * utxoSetAt and a delta per step. chain must start at height 0. */
+    UTXOSetDelta BLOCKSCI_EXPORT utxoSetDelta(BlockRange &chain, BlockHeight startHeight, BlockHeight endHeight);
+} // namespace blocksci
+
+#endif /* blocksci_chain_utxo_set_hpp */
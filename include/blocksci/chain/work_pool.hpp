@@ -0,0 +1,190 @@
+//
+//  work_pool.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_chain_work_pool_hpp
+#define blocksci_chain_work_pool_hpp
+
+#include <blocksci/blocksci_export.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+namespace blocksci {
+
+    /** Parallelism settings of a Blockchain, used by BlockRange::mapReduce and everything built on it */
+    struct BLOCKSCI_EXPORT ParallelConfig {
+        /** Maximum number of threads working on a mapReduce, including the calling thread. 0 uses one per hardware thread */
+        unsigned maxThreads = 0;
+
+        /** Pin every pool thread to its own CPU */
+        bool pinThreads = false;
+
+        /** Spread the pool threads over the NUMA nodes in proportion to their CPUs and keep them on their node. The
+         * threads of a node get neighbouring task ranges, so every node works on a contiguous part of a block range,
+         * and steal from threads of the same node first. No effect on single node machines */
+        bool numaAware = false;
+
+        /** Number of chunks per thread that mapReduce splits a range into. More chunks balance ranges with uneven
+         * blocks better at the cost of more map results to reduce */
+        unsigned chunksPerThread = 16;
+
+        /** Lower bound on the number of transactions per chunk */
+        uint32_t minChunkTxCount = 4096;
+    };
+
+    /** Lets another thread stop a running mapReduce, @see BlockRange::withCancellation */
+    class BLOCKSCI_EXPORT CancellationToken {
+        std::atomic<bool> cancelled{false};
+
+    public:
+        void cancel() {
+            cancelled.store(true, std::memory_order_release);
+        }
+
+        void reset() {
+            cancelled.store(false, std::memory_order_release);
+        }
+
+        bool isCancelled() const {
+            return cancelled.load(std::memory_order_acquire);
+        }
+    };
+
+    /** Thrown by a mapReduce whose CancellationToken was cancelled before it finished */
+    class BLOCKSCI_EXPORT OperationCancelled : public std::runtime_error {
+    public:
+        OperationCancelled() : std::runtime_error("Operation was cancelled") {}
+    };
+
+    /** Priority class of parallel operations and of the work surrounding them, @see WorkScope */
+    enum class WorkPriority {
+        /** Latency sensitive work such as point queries, which never yields */
+        Interactive,
+        /** Priority of operations started outside of any WorkScope */
+        Normal,
+        /** Long running scans, which yield to all other work */
+        Batch
+    };
+
+    /** How the parallel operations started by a thread run */
+    struct BLOCKSCI_EXPORT WorkOptions {
+        WorkPriority priority = WorkPriority::Normal;
+
+        /** Maximum number of threads working on one operation, including the calling thread. 0 allows all threads of
+         * the pool */
+        unsigned maxThreads = 0;
+
+        /** Bytes of transaction data per second the chunks of all operations in the scope may scan together, 0 for no
+         * limit */
+        uint64_t ioBytesPerSecond = 0;
+    };
+
+    /** Token bucket limiting the rate at which bytes are read
+     *
+     * The bucket holds up to a second of reads. Requests larger than what it holds go into debt, which the following
+     * requests wait for, so concurrent readers share the rate. */
+    class BLOCKSCI_EXPORT IoTokenBucket {
+        std::mutex mutex;
+        uint64_t bytesPerSecond;
+        double tokens;
+        std::chrono::steady_clock::time_point lastRefill;
+
+    public:
+        explicit IoTokenBucket(uint64_t bytesPerSecond);
+
+        /** Take bytes out of the bucket, sleeping until it has refilled enough */
+        void acquire(uint64_t bytes);
+    };
+
+    /** Sets the WorkOptions of the parallel operations the calling thread starts while the scope is alive
+     *
+     * Scopes nest, the innermost one applies. A scope with the same ioBytesPerSecond as the scope enclosing it shares
+     * its I/O budget, so overriding the priority of a single call keeps the limit of the surrounding scope. While a scope is alive, the pool threads working on operations of a lower
+     * priority in any WorkPool of the process leave them at their next task boundary (a chunk of a mapReduce), only
+     * the threads that started those operations keep working on them. Wrapping point queries (address lookups, tx
+     * fetches) that don't use a pool themselves in an Interactive scope frees the cores that batch scans hold.
+     *
+     * A scope must be destroyed on the thread that created it, in reverse order of creation.
+     */
+    class BLOCKSCI_EXPORT WorkScope {
+        WorkOptions options;
+        std::unique_ptr<IoTokenBucket> ownIoBucket;
+        IoTokenBucket *ioBucket = nullptr;
+        const WorkScope *previous;
+
+    public:
+        explicit WorkScope(const WorkOptions &options);
+        WorkScope(const WorkScope &) = delete;
+        WorkScope &operator=(const WorkScope &) = delete;
+        ~WorkScope();
+
+        const WorkOptions &getOptions() const {
+            return options;
+        }
+
+        /** Options of the innermost scope of the calling thread, the defaults outside of any scope */
+        static WorkOptions currentOptions();
+
+        /** Token bucket of the innermost scope of the calling thread, null if it doesn't limit the I/O rate */
+        static IoTokenBucket *currentIoBucket();
+    };
+
+    /** Persistent pool of threads that run batches of indexed tasks with work stealing
+     *
+     * run() splits the task indexes evenly into contiguous ranges, one per thread. Every thread works through its own
+     * range from the front, and once that is empty steals the back half of the range of another thread, so threads
+     * that finish early take over the work of stragglers. The calling thread takes part in the work with the first range.
+     *
+     * run() called from inside a task runs the nested batch on the current thread, so nested parallel operations
+     * don't oversubscribe the machine. Batches started by different threads run at the same time: every pool thread
+     * works on the batch of the highest WorkPriority that has tasks left and room for another thread under its
+     * maxThreads, older batches first within a priority, and switches at a task boundary when a batch of a higher
+     * priority (or a WorkScope of one, @see WorkScope) appears. The caller of a batch always keeps working on it.
+     */
+    class BLOCKSCI_EXPORT WorkPool {
+        struct Impl;
+        std::unique_ptr<Impl> impl;
+
+    public:
+        explicit WorkPool(const ParallelConfig &config = {});
+        WorkPool(const WorkPool &) = delete;
+        WorkPool &operator=(const WorkPool &) = delete;
+        ~WorkPool();
+
+        const ParallelConfig &getConfig() const;
+
+        /** Number of threads working on a batch, including the calling thread */
+        unsigned threadCount() const;
+
+        /** Number of threads a batch started by the calling thread may use, threadCount() limited by the maxThreads of
+         * its WorkScope */
+        unsigned batchThreadCount() const;
+
+        /** Number of NUMA nodes the threads are spread over, 1 unless numaAware is set on a multi node machine */
+        unsigned numaNodeCount() const;
+
+        /** Run task(i) for every i in [0, taskCount) and wait for all of them
+         *
+         * If a task throws, the remaining tasks are skipped and the first exception is rethrown. If token is
+         * cancelled, the remaining tasks are skipped and OperationCancelled is thrown. */
+        void run(uint32_t taskCount, const std::function<void(uint32_t)> &task, const CancellationToken *token = nullptr);
+
+        /** Wait until the I/O budget of the WorkScope of the batch whose task the calling thread runs covers bytes
+         * more. Does nothing outside of tasks or without a limit */
+        static void chargeIo(uint64_t bytes);
+
+        /** Whether chargeIo would wait at all, lets callers skip computing the bytes */
+        static bool limitsIo();
+    };
+} // namespace blocksci
+
+#endif /* blocksci_chain_work_pool_hpp */
@@ -14,11 +14,15 @@
 #include <blocksci/address/address.hpp>
 #include <blocksci/chain/output_pointer.hpp>
 #include <blocksci/chain/range_util.hpp>
+#include <blocksci/chain/tx_set.hpp>
+#include <blocksci/cluster/cluster_stats.hpp>
 #include <blocksci/core/core_fwd.hpp>
 #include <blocksci/core/dedup_address.hpp>
 
+#include <range/v3/range/concepts.hpp>
 #include <range/v3/range_for.hpp>
 
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -41,6 +45,7 @@ namespace blocksci {
     }
     
     struct TaggedCluster;
+    class ClusterManager;
     
     struct TagChecker {
         std::unordered_map<blocksci::Address, std::string> tags;
@@ -64,6 +69,38 @@ namespace blocksci {
         }
     };
     
+    /** Deduplicated addresses of a cluster, a slice of the mapped cluster file, the addresses decoded from the packed
+     * copy of a large cluster (shared between copies of the view) or the address itself for the single address
+     * clusters that compact clusterings leave out of the cluster file
+     *
+     * Iterators point into the view, so they are invalidated when it is copied.
+     */
+    class BLOCKSCI_EXPORT ClusterDedupAddresses : public ranges::view_base {
+        const DedupAddress *first = nullptr;
+        const DedupAddress *last = nullptr;
+        DedupAddress single;
+        bool isSingle = false;
+        std::shared_ptr<const std::vector<DedupAddress>> decoded;
+        
+    public:
+        ClusterDedupAddresses() = default;
+        ClusterDedupAddresses(const DedupAddress *first_, const DedupAddress *last_) : first(first_), last(last_) {}
+        explicit ClusterDedupAddresses(const DedupAddress &single_) : single(single_), isSingle(true) {}
+        explicit ClusterDedupAddresses(std::shared_ptr<const std::vector<DedupAddress>> decoded_) : first(decoded_->data()), last(decoded_->data() + decoded_->size()), decoded(std::move(decoded_)) {}
+        
+        const DedupAddress *begin() const {
+            return isSingle ? &single : first;
+        }
+        
+        const DedupAddress *end() const {
+            return isSingle ? &single + 1 : last;
+        }
+        
+        size_t size() const {
+            return static_cast<size_t>(end() - begin());
+        }
+    };
+    
     struct PossibleAddressesGetter {
         DataAccess *access;
         
@@ -82,7 +119,7 @@ namespace blocksci {
     class BLOCKSCI_EXPORT Cluster {
         const ClusterAccess *clusterAccess;
         
-        ranges::subrange<const blocksci::DedupAddress *> getDedupAddresses() const;
+        ClusterDedupAddresses getDedupAddresses() const;
         
         // Only holds tags by reference so it must remain alive while this range exists
         ranges::any_view<TaggedAddress> taggedAddressesUnsafe(const std::unordered_map<blocksci::Address, std::string> &tags) const;
@@ -97,7 +134,7 @@ namespace blocksci {
         
         ranges::any_view<TaggedAddress> taggedAddresses(const std::unordered_map<blocksci::Address, std::string> &tags) const;
         
-        ranges::transform_view<ranges::transform_view<ranges::subrange<const DedupAddress *>, PossibleAddressesGetter>, AddressRangeTagChecker>
+        ranges::transform_view<ranges::transform_view<ClusterDedupAddresses, PossibleAddressesGetter>, AddressRangeTagChecker>
         taggedAddressesNested(const std::unordered_map<blocksci::Address, std::string> &tags) const;
         
         ranges::optional<TaggedCluster> getTaggedUnsafe(const std::unordered_map<blocksci::Address, std::string> &tags) const;
@@ -109,12 +146,37 @@ namespace blocksci {
         
         int64_t getTypeEquivSize() const;
         
+        /** Precomputed statistics of the cluster, throws if the clustering has none (see ClusterManager::hasClusterStats) */
+        ClusterStats getStats() const;
+        
         ranges::any_view<OutputPointer> getOutputPointers() const;
         
+        /** Balance of the cluster at the given height, summed over the outputs found by a parallel scan of the addresses */
         int64_t calculateBalance(BlockHeight height) const;
+        
+        /** Value of the outputs sent to the cluster by txes before endTxNum that no tx before endTxNum spent */
+        int64_t calculateBalanceBeforeTx(uint32_t endTxNum) const;
 
+        /** All outputs sent to the cluster in chain order, collected by a parallel scan of the addresses */
         ranges::any_view<Output> getOutputs() const;
+        
+        /** All inputs spending outputs of the cluster in chain order, collected by a parallel scan of the addresses */
         ranges::any_view<Input> getInputs() const;
+        
+        /** All transactions sending to or spending from the cluster
+         *
+         * The output index of every address is scanned in parallel and the tx numbers are deduplicated in a bitmap, a
+         * dense bitset over all txes of the chain for clusters with very many addresses. Iterates in chain order. A
+         * threadCount of 0 uses one thread per hardware thread. */
+        TxSet getTxSet(uint32_t threadCount = 0) const;
+        
+        /** Transactions with an output sent to the cluster, @see getTxSet */
+        TxSet getOutputTxSet(uint32_t threadCount = 0) const;
+        
+        /** Transactions spending an output of the cluster, @see getTxSet */
+        TxSet getInputTxSet(uint32_t threadCount = 0) const;
+        
+        /** Same as getTxSet, in chain order */
         std::vector<Transaction> getTransactions() const;
         std::vector<Transaction> getOutputTransactions() const;
         std::vector<Transaction> getInputTransactions() const;
@@ -138,6 +200,7 @@ namespace blocksci {
     private:
         
         friend Cluster;
+        friend ClusterManager;
         
         TaggedCluster(const Cluster &cluster_, TaggedRange &&taggedAddresses_) : cluster(cluster_), taggedAddresses(std::move(taggedAddresses_)) {}
     };
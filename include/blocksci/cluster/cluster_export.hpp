@@ -0,0 +1,40 @@
+//
+//  cluster_export.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_cluster_cluster_export_hpp
+#define blocksci_cluster_cluster_export_hpp
+
+#include <blocksci/blocksci_export.h>
+
+#include <cstdint>
+
+namespace blocksci {
+    /** File formats ClusterManager::exportClusters can write */
+    enum class BLOCKSCI_EXPORT ClusterExportFormat {
+        /** Arrow IPC files (Feather V2) */
+        Arrow,
+        Parquet
+    };
+    
+    struct BLOCKSCI_EXPORT ClusterExportOptions {
+        ClusterExportFormat format = ClusterExportFormat::Parquet;
+        
+        /** Rows per record batch, Parquet files get one row group per batch */
+        uint32_t batchSize = uint32_t{1} << 20;
+        
+        /** Record batches per file, the files are written in parallel */
+        uint32_t batchesPerFile = 16;
+        
+        /** Threads writing files, 0 uses one per hardware thread */
+        uint32_t threadCount = 0;
+    };
+    
+    /** Whether this build of BlockSci can export in the given format, which depends on Arrow and Parquet being found at build time */
+    BLOCKSCI_EXPORT bool clusterExportAvailable(ClusterExportFormat format);
+} // namespace blocksci
+
+#endif /* blocksci_cluster_cluster_export_hpp */
@@ -0,0 +1,59 @@
+//
+//  cluster_flows.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_cluster_cluster_flows_hpp
+#define blocksci_cluster_cluster_flows_hpp
+
+#include "cluster_export.hpp"
+#include "cluster_stats.hpp"
+
+#include <blocksci/blocksci_export.h>
+
+#include <cstdint>
+#include <limits>
+
+namespace blocksci {
+    /** Settings of ClusterManager::clusterFlows */
+    struct BLOCKSCI_EXPORT ClusterFlowOptions {
+        /** Width of the time buckets in seconds of block time, 0 puts the whole block range into a single bucket */
+        uint32_t bucketSeconds = 86400;
+
+        /** Only keep the topK clusters by rankBy and merge all others into OtherCluster, 0 keeps every cluster. Flows
+         * between two merged clusters are dropped. Requires the precomputed cluster statistics. */
+        uint32_t topK = 0;
+        ClusterStat rankBy = ClusterStat::TotalReceived;
+
+        /** Whether to keep the value a cluster sends back to itself, which is mostly change */
+        bool includeSelfFlows = false;
+
+        /** Format of exportClusterFlows */
+        ClusterExportFormat format = ClusterExportFormat::Parquet;
+    };
+
+    /** Value moved from one cluster to another within one time bucket
+     *
+     * The value of every output is split between the clusters of the tx's inputs by their share of the input value,
+     * so the flows of a tx add up to its output value. Inputs and outputs whose address is newer than the clustering
+     * don't count. */
+    struct BLOCKSCI_EXPORT ClusterFlow {
+        /** Cluster number standing for all clusters outside of the top k */
+        static constexpr uint32_t OtherCluster = std::numeric_limits<uint32_t>::max();
+
+        /** Block timestamp at which the bucket starts, a multiple of bucketSeconds */
+        uint32_t bucketStart;
+        uint32_t source;
+        uint32_t destination;
+
+        /** Value in satoshis */
+        int64_t value;
+
+        /** Number of txes contributing to the flow */
+        uint32_t txCount;
+    };
+} // namespace blocksci
+
+#endif /* blocksci_cluster_cluster_flows_hpp */
@@ -11,36 +11,204 @@
 
 #include "cluster_fwd.hpp"
 #include "cluster.hpp"
+#include "cluster_export.hpp"
+#include "cluster_flows.hpp"
+#include "cluster_refinement.hpp"
+#include "cluster_stats.hpp"
+#include "clustering_rules.hpp"
+#include "external_clustering.hpp"
 
 #include <blocksci/blocksci_export.h>
+#include <blocksci/core/raw_address.hpp>
+#include <blocksci/heuristics/change_address.hpp>
+
+#include <limits>
 
 namespace blocksci {
-    namespace heuristics {
-        struct ChangeHeuristic;
-    }
-    
     class ClusterAccess;
+    class TagStore;
 
     class BLOCKSCI_EXPORT ClusterManager {
-        std::unique_ptr<ClusterAccess> access;
+        /** Shared with the other managers of the same clustering on the same chain */
+        std::shared_ptr<ClusterAccess> access;
         uint32_t clusterCount;
         
         friend class blocksci::Cluster;
         
     public:
+        /** Open the clustering in baseDirectory, reusing the mapped files of a manager of it that is still open */
         ClusterManager(const std::string &baseDirectory, DataAccess &access);
         ClusterManager(ClusterManager && other);
         ClusterManager &operator=(ClusterManager && other);
         ~ClusterManager();
         
-        static ClusterManager createClustering(BlockRange &chain, const heuristics::ChangeHeuristic &heuristic, const std::string &outputPath, bool overwrite = false, bool ignoreCoinJoin = true);
-        static ClusterManager createClustering(BlockRange &chain, const std::function<ranges::any_view<Output>(const Transaction &tx)> &changeHeuristic, const std::string &outputPath, bool overwrite, bool ignoreCoinJoin);
+        const ClusterAccess &getAccess() const {
+            return *access;
+        }
+        
+        /** Cluster the addresses used in the given blocks and write the clustering to outputPath
+         *
+         * threadCount sets the number of threads used to link and resolve the clusters, 0 uses one per hardware thread.
+         */
+        static ClusterManager createClustering(BlockRange &chain, const heuristics::ChangeHeuristic &heuristic, const std::string &outputPath, bool overwrite = false, bool ignoreCoinJoin = true, uint32_t threadCount = 0);
+        static ClusterManager createClustering(BlockRange &chain, const std::function<ranges::any_view<Output>(const Transaction &tx)> &changeHeuristic, const std::string &outputPath, bool overwrite, bool ignoreCoinJoin, uint32_t threadCount = 0);
+        
+        /** Cluster with a built-in change heuristic called directly, without going through std::function and any_view */
+        template <heuristics::ChangeType::Enum type>
+        static ClusterManager createClustering(BlockRange &chain, const heuristics::ChangeHeuristicImpl<type> &heuristic, const std::string &outputPath, bool overwrite = false, bool ignoreCoinJoin = true, uint32_t threadCount = 0);
+        
+        /** Cluster with the given filters and link rules instead of the default multi-input and change heuristics
+         *
+         * The change heuristic is only used if rules.linkChange is set. */
+        static ClusterManager createClustering(BlockRange &chain, const heuristics::ChangeHeuristic &heuristic, const ClusteringRules &rules, const std::string &outputPath, bool overwrite = false, uint32_t threadCount = 0);
+        
+        template <heuristics::ChangeType::Enum type>
+        static ClusterManager createClustering(BlockRange &chain, const heuristics::ChangeHeuristicImpl<type> &heuristic, const ClusteringRules &rules, const std::string &outputPath, bool overwrite = false, uint32_t threadCount = 0);
+        
+        /** Cluster out of core, bounding the memory used by all but the deduplicated per-chunk state with external.memoryBudget
+         *
+         * Produces the same clustering as createClustering with the same rules. */
+        static ClusterManager createClustering(BlockRange &chain, const heuristics::ChangeHeuristic &heuristic, const ClusteringRules &rules, const ExternalClusteringOptions &external, const std::string &outputPath, bool overwrite = false, uint32_t threadCount = 0);
+        
+        template <heuristics::ChangeType::Enum type>
+        static ClusterManager createClustering(BlockRange &chain, const heuristics::ChangeHeuristicImpl<type> &heuristic, const ClusteringRules &rules, const ExternalClusteringOptions &external, const std::string &outputPath, bool overwrite = false, uint32_t threadCount = 0);
+        
+        /** Extend the clustering in outputPath with the given blocks, which must start at or before its last block
+         *
+         * Continues from the union-find state that createClustering stores with the cluster files, so only the new blocks
+         * are scanned. The heuristic should match the one used to create the clustering. Cluster numbers are reassigned,
+         * ClusterManagers that are open on the directory keep seeing the previous clustering.
+         */
+        static ClusterManager updateClustering(BlockRange &newBlocks, const heuristics::ChangeHeuristic &heuristic, const std::string &outputPath, bool ignoreCoinJoin = true, uint32_t threadCount = 0);
+        static ClusterManager updateClustering(BlockRange &newBlocks, const std::function<ranges::any_view<Output>(const Transaction &tx)> &changeHeuristic, const std::string &outputPath, bool ignoreCoinJoin, uint32_t threadCount = 0);
+        
+        template <heuristics::ChangeType::Enum type>
+        static ClusterManager updateClustering(BlockRange &newBlocks, const heuristics::ChangeHeuristicImpl<type> &heuristic, const std::string &outputPath, bool ignoreCoinJoin = true, uint32_t threadCount = 0);
+        
+        /** Extend a clustering created with the given rules, their built-in rules are checked against the recorded ones */
+        static ClusterManager updateClustering(BlockRange &newBlocks, const heuristics::ChangeHeuristic &heuristic, const ClusteringRules &rules, const std::string &outputPath, uint32_t threadCount = 0);
+        
+        template <heuristics::ChangeType::Enum type>
+        static ClusterManager updateClustering(BlockRange &newBlocks, const heuristics::ChangeHeuristicImpl<type> &heuristic, const ClusteringRules &rules, const std::string &outputPath, uint32_t threadCount = 0);
+        
+        /** Cluster like createClustering with the rules, then refine the clustering with a change rule that depends on it
+         * until a round finds no new link or options.maxRounds rounds ran
+         *
+         * The union-find stays in memory between the rounds. The first round applies the rule to every transaction that
+         * the rules don't skip, every later round only to the transactions with an input or output in a cluster that grew
+         * in the round before, tracked in a bitmap over their txNums. A round thus costs in proportion to the transactions
+         * it affects instead of a clustering from scratch. The rule sees the clusters of the previous round only.
+         *
+         * On top of createClustering this keeps the transactions of every address in memory while refining, about 4 bytes
+         * per address of every input and output and 16 bytes per address. updateClustering can't extend the result, its
+         * incremental pass wouldn't apply the refinement. */
+        static ClusterManager refineClustering(BlockRange &chain, const heuristics::ChangeHeuristic &heuristic, const ClusteringRules &rules, const ClusterChangeRule &refinement, const std::string &outputPath, const RefinementOptions &options = RefinementOptions{}, bool overwrite = false, uint32_t threadCount = 0);
+        
+        /** Delete the cluster files in outputPath and the directory itself if nothing else is left in it */
+        static void removeClustering(const std::string &outputPath);
+        
+        /** Write a compressed copy of the addresses of the clusters of at least minClusterSize addresses in the
+         * clustering in baseDirectory
+         *
+         * Within a cluster the addresses are grouped into runs of one type with delta encoded scriptNums, which large
+         * clusters shrink to about a quarter of their size in clusterAddresses.dat, and are decoded with SIMD
+         * shuffles. Managers of the clustering opened while no other one is open read the large clusters from the copy.
+         * updateClustering keeps the copy up to date. */
+        static void packClusterAddresses(const std::string &baseDirectory, uint32_t minClusterSize = 256, uint32_t threadCount = 0);
+        
+        /** Whether the large clusters are read from the copy written by packClusterAddresses */
+        bool usesPackedAddresses() const;
         
         Cluster getCluster(const Address &address) const;
         
+        uint32_t getClusterCount() const {
+            return clusterCount;
+        }
+        
         ranges::any_view<Cluster, ranges::category::random_access | ranges::category::sized> getClusters() const;
         
-        ranges::any_view<TaggedCluster> taggedClusters(const std::unordered_map<Address, std::string> &tags) const;
+        /** Number of clusters with more than one address
+         *
+         * Clusterings list these first, so this is free for them, older clusterings count them from the cluster sizes. */
+        uint32_t getNonTrivialClusterCount() const;
+        
+        /** Clusters with more than one address in order of their cluster number, skipping the single address clusters
+         * that make up most of a clustering */
+        ranges::any_view<Cluster, ranges::category::random_access | ranges::category::sized> getNonTrivialClusters() const;
+        
+        /** Clusters of the given addresses in the same order, looked up from the cluster index of each address type in parallel */
+        std::vector<Cluster> getClusters(const std::vector<Address> &addresses, uint32_t threadCount = 0) const;
+        
+        /** Cluster number of addresses that aren't part of the clustering, eg. because they are newer than it */
+        static constexpr uint32_t NoCluster = std::numeric_limits<uint32_t>::max();
+        
+        /** Cluster numbers of the given addresses, NoCluster for addresses the clustering doesn't cover
+         *
+         * A gather over the mapped cluster index files of the address types, prefetching a few addresses ahead, in
+         * parallel segments of the input. Meant for labeling large batches of inputs or outputs. */
+        void clusterIds(const RawAddress *addresses, size_t count, uint32_t *clusterNums, uint32_t threadCount = 0) const;
+        std::vector<uint32_t> clusterIds(const std::vector<RawAddress> &addresses, uint32_t threadCount = 0) const;
+        
+        /** Same as above for addresses given as separate scriptNum and AddressType::Enum columns
+         *
+         * Throws std::invalid_argument if a type isn't a valid address type. */
+        void clusterIds(const uint32_t *scriptNums, const uint8_t *types, size_t count, uint32_t *clusterNums, uint32_t threadCount = 0) const;
+        
+        /** Clusters containing at least one of the tagged addresses, ordered by cluster number
+         *
+         * Looks up the cluster of every tagged address instead of scanning the addresses of all clusters, so the cost
+         * only depends on the number of tags. Each TaggedCluster holds a copy of the tags of its own addresses.
+         */
+        ranges::any_view<TaggedCluster> taggedClusters(const std::unordered_map<Address, std::string> &tags, uint32_t threadCount = 0) const;
+        
+        /** Tag of every cluster, indexed by cluster number: the tag carried by most of its tagged addresses, the lowest
+         * such tag id on ties and TagStore::NoTag for clusters without tagged addresses
+         *
+         * Gathers the cluster of every address of the store from the cluster index files, then counts the sorted
+         * (cluster, tag) pairs, so neither the addresses nor the tag names are materialized. */
+        std::vector<uint32_t> clusterTagIds(const TagStore &tags, uint32_t threadCount = 0) const;
+        
+        /** Whether the precomputed ClusterStats are available, clusterings written by older versions don't have them */
+        bool hasClusterStats() const;
+        
+        /** Precomputed statistics of a cluster, throws if hasClusterStats() is false */
+        ClusterStats getClusterStats(uint32_t clusterNum) const;
+        
+        /** All clusters ordered by the given statistic, clusters with equal values are ordered by cluster number */
+        std::vector<Cluster> getClustersSortedBy(ClusterStat stat, bool descending = true) const;
+        
+        /** The k clusters with the largest values of the given statistic, largest first
+         *
+         * Only scans the statistic with a bounded heap per thread instead of sorting all clusters. */
+        std::vector<Cluster> topClusters(ClusterStat stat, uint32_t k) const;
+        
+        /** Write the cluster of every address and the statistics of every cluster to outputDirectory as Arrow or Parquet
+         *
+         * Creates the datasets membership/ with the columns (address_type, script_num, cluster_id), one file per range
+         * of scriptNums of each DedupAddressType, and cluster_stats/ with cluster_id and one column per ClusterStat if
+         * hasClusterStats(). The cluster_id and statistics columns are handed to Arrow straight from the mapped cluster
+         * files without copying. Throws if the format isn't available or outputDirectory already holds an export.
+         */
+        void exportClusters(const std::string &outputDirectory, const ClusterExportOptions &options = ClusterExportOptions{}) const;
+        
+        /** Value moved between clusters by the txes of the given blocks, summed per time bucket and ordered by bucket,
+         * source and destination
+         *
+         * The blocks are scanned in parallel chunks, each looking up clusters directly in the cluster index files and
+         * summing into its own sparse map, and the maps are merged at the end. */
+        std::vector<ClusterFlow> clusterFlows(BlockRange &blocks, const ClusterFlowOptions &options = ClusterFlowOptions{}) const;
+        
+        /** Write clusterFlows to a single Arrow or Parquet file at path with the columns (bucket_start, source_cluster,
+         * destination_cluster, value, tx_count), where the other clusters of a top k filter are null */
+        void exportClusterFlows(BlockRange &blocks, const std::string &path, const ClusterFlowOptions &options = ClusterFlowOptions{}) const;
+        
+        /** clusterFlows with the source and destination clusters replaced by their clusterTagIds and the flows between
+         * the same tags summed up, so source and destination are tag ids
+         *
+         * Clusters without a tag and the other clusters of a top k filter become TagStore::NoTag. Unless
+         * options.includeSelfFlows is set, flows between different clusters of the same tag are dropped as well, except
+         * between untagged clusters. The txCount of a merged flow is the sum of the counts of the cluster flows. */
+        std::vector<ClusterFlow> tagFlows(BlockRange &blocks, const TagStore &tags, const ClusterFlowOptions &options = ClusterFlowOptions{}) const;
     };
     
     using cluster_range = decltype(std::declval<ClusterManager>().getClusters());
@@ -0,0 +1,49 @@
+//
+//  cluster_refinement.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_cluster_cluster_refinement_hpp
+#define blocksci_cluster_cluster_refinement_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/address/address_fwd.hpp>
+#include <blocksci/chain/chain_fwd.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace blocksci {
+    /** Cluster membership as of the previous round of ClusterManager::refineClustering */
+    class BLOCKSCI_EXPORT ClusterLookup {
+    public:
+        virtual ~ClusterLookup() = default;
+
+        /** Identifier of the cluster of the address, shared by all addresses of the cluster within a round */
+        virtual uint32_t clusterOf(const Address &address) const = 0;
+
+        /** Number of addresses in the cluster of the address */
+        virtual uint32_t clusterSize(const Address &address) const = 0;
+    };
+
+    /** Change heuristic that depends on the clustering itself, appending the outputs of tx to link with its inputs to
+     * change. It is called concurrently for different transactions. */
+    using ClusterChangeRule = std::function<void(const Transaction &tx, const ClusterLookup &clusters, std::vector<Output> &change)>;
+
+    /** Settings of ClusterManager::refineClustering */
+    struct BLOCKSCI_EXPORT RefinementOptions {
+        /** Stop after this many refinement rounds even if the last one still found new links */
+        uint32_t maxRounds = 32;
+    };
+
+    /** Change goes to an address outside the clusters of the payees
+     *
+     * If no output of tx is in the cluster of its inputs, at least one output is in a cluster of several addresses and
+     * exactly one output is in a cluster of its own, that output is the change: the payees are the known entities. */
+    BLOCKSCI_EXPORT void payeeClusterChange(const Transaction &tx, const ClusterLookup &clusters, std::vector<Output> &change);
+} // namespace blocksci
+
+#endif /* blocksci_cluster_cluster_refinement_hpp */
@@ -0,0 +1,45 @@
+//
+//  cluster_stats.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_cluster_cluster_stats_hpp
+#define blocksci_cluster_cluster_stats_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/core/typedefs.hpp>
+
+#include <cstdint>
+
+namespace blocksci {
+    /** Statistics that createClustering and updateClustering precompute for every cluster, see ClusterStats */
+    enum class BLOCKSCI_EXPORT ClusterStat {
+        TotalReceived, Balance, AddressCount, TxCount, FirstHeight, LastHeight
+    };
+    
+    /** Aggregates of a cluster over the blocks of its clustering
+     *
+     * Stored in cluster_stats.dat next to the cluster files, so they are available without scanning the addresses and
+     * outputs of the cluster. */
+    struct BLOCKSCI_EXPORT ClusterStats {
+        /** Value of all outputs sent to the cluster */
+        int64_t totalReceived = 0;
+        
+        /** Value of the outputs sent to the cluster that weren't spent before the end of the clustering */
+        int64_t balance = 0;
+        
+        /** Number of addresses, not counting type equivalent addresses (see Cluster::getTypeEquivSize) */
+        uint32_t addressCount = 0;
+        
+        /** Number of transactions with an input or output of the cluster */
+        uint32_t txCount = 0;
+        
+        /** Heights of the first and the last of these transactions, -1 if there are none */
+        BlockHeight firstHeight = -1;
+        BlockHeight lastHeight = -1;
+    };
+} // namespace blocksci
+
+#endif /* blocksci_cluster_cluster_stats_hpp */
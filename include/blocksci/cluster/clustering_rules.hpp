@@ -0,0 +1,86 @@
+//
+//  clustering_rules.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_cluster_clustering_rules_hpp
+#define blocksci_cluster_clustering_rules_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/chain/chain_fwd.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace blocksci {
+    /** Filters and link rules that the clusterer applies to every transaction
+     *
+     * All rules are evaluated together in a single parallel pass over the blocks, so comparing variants of the
+     * heuristics doesn't take one pass per rule. A transaction is skipped if any enabled filter matches it, otherwise every
+     * enabled link rule links the addresses it finds. Coinbase transactions are always skipped.
+     *
+     * The built-in rules are plain flags that the pass checks directly. Additional filters can be given as functions,
+     * which costs a call per transaction and filter.
+     */
+    struct BLOCKSCI_EXPORT ClusteringRules {
+        /** Skip transactions that heuristics::isCoinjoin detects as CoinJoins */
+        bool skipCoinJoin = true;
+        
+        /** Skip transactions for which heuristics::isPossibleCoinjoin finds a CoinJoin with the parameters below */
+        bool skipPossibleCoinJoin = false;
+        int64_t possibleCoinJoinMinBaseFee = 0;
+        double possibleCoinJoinPercentageFee = 0.01;
+        /** Bounds the number of subsets isPossibleCoinjoin checks per transaction, 0 checks all of them */
+        size_t possibleCoinJoinMaxDepth = 10000;
+        
+        /** Transactions for which any of these returns true are skipped as well
+         *
+         * Custom filters can't be stored with the clustering, updates have to pass the same filters again. */
+        std::vector<std::function<bool(const Transaction &tx)>> skipFilters;
+        
+        /** Link all inputs of a transaction with each other (multi-input heuristic) */
+        bool linkInputs = true;
+        
+        /** Link the outputs that the change heuristic selects with the inputs */
+        bool linkChange = true;
+        
+        /** Link every scripthash address with the address it wraps */
+        bool linkScripthashNested = true;
+        
+        /** Link spent multisig addresses, also when wrapped in scripthash, with the pubkeys of their signers */
+        bool linkMultisigCosigners = false;
+        
+        /** Link an output with the inputs if it is the only output spent by a transaction with the same wallet
+         * fingerprint as the transaction itself: its version, whether it sets a locktime and whether it signals
+         * replace-by-fee */
+        bool linkFingerprintChange = false;
+        
+        /** The built-in rules as bit flags, which a clustering records so that updates can check for the same rules
+         *
+         * Only deviations from the default rules set a bit apart from skipCoinJoin, so the flags of the default rules
+         * match the ignoreCoinJoin value that clusterings recorded before the rules became configurable. */
+        uint32_t flags() const {
+            return (skipCoinJoin ? 1u : 0u)
+            | (skipPossibleCoinJoin ? 1u << 1 : 0u)
+            | (linkInputs ? 0u : 1u << 2)
+            | (linkChange ? 0u : 1u << 3)
+            | (linkScripthashNested ? 0u : 1u << 4)
+            | (linkMultisigCosigners ? 1u << 5 : 0u)
+            | (linkFingerprintChange ? 1u << 6 : 0u);
+        }
+        
+        /** Rules as used before they became configurable: the multi-input and change heuristics, scripthash nesting and,
+         * depending on ignoreCoinJoin, skipping CoinJoins */
+        static ClusteringRules defaultRules(bool ignoreCoinJoin = true) {
+            ClusteringRules rules;
+            rules.skipCoinJoin = ignoreCoinJoin;
+            return rules;
+        }
+    };
+} // namespace blocksci
+
+#endif /* blocksci_cluster_clustering_rules_hpp */
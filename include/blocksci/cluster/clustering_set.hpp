@@ -0,0 +1,94 @@
+//
+//  clustering_set.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_cluster_clustering_set_hpp
+#define blocksci_cluster_clustering_set_hpp
+
+#include "cluster_manager.hpp"
+#include "clustering_rules.hpp"
+
+#include <blocksci/blocksci_export.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace blocksci {
+    struct ClusteringColumns;
+    
+    /** Result of comparing the clusters of two clusterings address by address */
+    struct BLOCKSCI_EXPORT ClusteringComparison {
+        /** Number of addresses covered by both clusterings */
+        uint32_t addressCount = 0;
+        
+        /** Clusters of the first clustering whose addresses are spread over several clusters of the second */
+        std::vector<uint32_t> splitClusters;
+        
+        /** Clusters of the second clustering that contain addresses of several clusters of the first */
+        std::vector<uint32_t> mergedClusters;
+    };
+    
+    /** Several named clusterings of the same chain kept in one directory
+     *
+     * Every clustering is stored in a subdirectory of its name in the layout ClusterManager uses, and a header in the
+     * directory lists the names. The per DedupAddressType cluster number columns of all clusterings are mapped when
+     * the set is opened, so lookups and comparisons between clusterings run directly on these columns without opening
+     * a ClusterManager for each of them.
+     *
+     * Directory: <directory>/clusterings.dat and <directory>/<name>/
+     */
+    class BLOCKSCI_EXPORT ClusteringSet {
+        std::string directory;
+        DataAccess *access;
+        std::vector<std::string> names;
+        std::vector<std::unique_ptr<ClusteringColumns>> columns;
+        
+        size_t clusteringIndex(const std::string &name) const;
+        void writeHeader() const;
+        
+    public:
+        /** Open the set in the given directory, which is created if it doesn't exist */
+        ClusteringSet(const std::string &directory, DataAccess &access);
+        ClusteringSet(ClusteringSet &&other);
+        ClusteringSet &operator=(ClusteringSet &&other);
+        ~ClusteringSet();
+        
+        const std::vector<std::string> &getNames() const {
+            return names;
+        }
+        
+        bool contains(const std::string &name) const;
+        
+        /** Directory of the cluster files of the clustering */
+        std::string clusteringPath(const std::string &name) const;
+        
+        /** Cluster the given blocks and add the result under the name, overwrite replaces an existing clustering of that name */
+        void createClustering(const std::string &name, BlockRange &chain, const heuristics::ChangeHeuristic &heuristic, const ClusteringRules &rules, bool overwrite = false, uint32_t threadCount = 0);
+        
+        /** Extend the clustering of the given name with new blocks, see ClusterManager::updateClustering */
+        void updateClustering(const std::string &name, BlockRange &newBlocks, const heuristics::ChangeHeuristic &heuristic, const ClusteringRules &rules, uint32_t threadCount = 0);
+        
+        /** Remove the clustering from the set and delete its files */
+        void removeClustering(const std::string &name);
+        
+        /** Open a full ClusterManager on the clustering, for queries that need the addresses of clusters */
+        ClusterManager getManager(const std::string &name) const;
+        
+        uint32_t clusterCount(const std::string &name) const;
+        
+        /** Number of the cluster containing the address in the given clustering */
+        uint32_t getClusterNum(const std::string &name, const Address &address) const;
+        
+        /** Find the clusters that split or merge between the clusterings a and b
+         *
+         * Joins the cluster number columns of both clusterings in parallel, comparing the addresses covered by both.
+         */
+        ClusteringComparison compare(const std::string &a, const std::string &b, uint32_t threadCount = 0) const;
+    };
+} // namespace blocksci
+
+#endif /* blocksci_cluster_clustering_set_hpp */
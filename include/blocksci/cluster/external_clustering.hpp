@@ -0,0 +1,33 @@
+//
+//  external_clustering.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_cluster_external_clustering_hpp
+#define blocksci_cluster_external_clustering_hpp
+
+#include <blocksci/blocksci_export.h>
+
+#include <cstdint>
+#include <string>
+
+namespace blocksci {
+    /** Settings of the out-of-core clustering mode of ClusterManager::createClustering
+     *
+     * The pairs of linked addresses are written to disk and their connected components are contracted chunk by chunk,
+     * and the arrays over all addresses and clusters are kept in mapped temporary files instead of memory. This lets
+     * the clusterer run with much less memory than the address count requires in memory, at the cost of the temporary
+     * files: 8 bytes per distinct linked pair, plus about 4 bytes per address and 32 bytes per cluster.
+     */
+    struct BLOCKSCI_EXPORT ExternalClusteringOptions {
+        /** Directory for the temporary files, defaults to a directory in the output location */
+        std::string tempDirectory;
+        
+        /** Bytes used for the links being buffered and the chunk of addresses being contracted */
+        uint64_t memoryBudget = uint64_t{1} << 30;
+    };
+} // namespace blocksci
+
+#endif /* blocksci_cluster_external_clustering_hpp */
@@ -0,0 +1,181 @@
+/*
+ *  column_abi.h
+ *  blocksci
+ *
+ *  Created by Harry Kalodner on 10/15/26.
+ */
+
+#ifndef blocksci_column_abi_h
+#define blocksci_column_abi_h
+
+#include <blocksci/blocksci_export.h>
+
+#include <stdint.h>
+
+/* Stable C interface to the memory of the data files of a chain, for kernels compiled outside of BlockSci (Numba,
+ * Cython, plain C) that read the columns directly.
+ *
+ * Every function returns 0 on success and -1 on failure, in which case blocksci_last_error() describes the problem.
+ * The descriptors point into the file mappings (or the resident copies) of the open chain or clustering and are only
+ * valid while it stays open and until it is reloaded. The data is read only.
+ *
+ * The layout of blocksci_column and the meaning of all constants in this header only change together with
+ * BLOCKSCI_COLUMN_ABI_VERSION. Check blocksci_column_abi_version() against the version a kernel was written for.
+ */
+
+#define BLOCKSCI_COLUMN_ABI_VERSION 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A blocksci::Blockchain */
+typedef struct blocksci_chain blocksci_chain;
+
+/* A blocksci::ClusterManager */
+typedef struct blocksci_clustering blocksci_clustering;
+
+/* Memory of one column, element i is at (const char *)data + i * stride and describes item first_index + i */
+typedef struct blocksci_column {
+    const void *data;
+    uint64_t length;
+    uint64_t stride;
+    uint64_t element_size;
+    uint64_t first_index;
+    uint32_t abi_version;
+    uint32_t reserved;
+} blocksci_column;
+
+/* Columns of the chain/ directory, the same numbering as blocksci::ChainColumn. Element i describes block, tx,
+ * input or output number i:
+ *
+ *   BLOCK                    RawBlock per block, see the BLOCKSCI_RAW_BLOCK_ constants
+ *   TX_DATA                  bytes of tx_data.dat, element_size 1. Not available with the paged read backend
+ *   TX_INDEX                 int64_t per tx, byte offset of its RawTransaction in TX_DATA
+ *   TX_VERSION               int32_t per tx
+ *   FIRST_INPUT/OUTPUT       uint64_t per tx, number of its first input/output
+ *   INPUT_SPENT_OUT_NUM      uint16_t per input, output number of the spent output within its tx
+ *   SEQUENCE                 uint32_t per input
+ *   TX_HASHES                32 bytes per tx, internal byte order
+ *   OUTPUT_VALUE             int64_t per output          (optional output columns)
+ *   OUTPUT_TYPE              uint8_t per output, address type
+ *   OUTPUT_ADDRESS           uint32_t per output, script number
+ *   OUTPUT_SPENT_TX          uint32_t per output, spending tx or 0 if unspent
+ *   OUTPUT_SPENDING_INPUT    uint16_t per output
+ *   OUTPUT_SPENDING_HEIGHT   uint32_t per output
+ *   TX_FEE                   int64_t per tx              (optional fee columns)
+ *   TX_VIRTUAL_SIZE          uint32_t per tx
+ *   INPUT_SPENT_HEIGHT       uint32_t per input          (optional coin age columns)
+ *   INPUT_SPENT_VALUE        int64_t per input
+ *   BLOCK_STATS              blocksci::BlockStats per block
+ *   TX_PACKAGE_FLAGS         uint8_t per tx
+ *
+ * COINBASE is variable sized and not available. Columns that are stored compressed or were never built fail.
+ */
+#define BLOCKSCI_CHAIN_BLOCK 0
+#define BLOCKSCI_CHAIN_COINBASE 1
+#define BLOCKSCI_CHAIN_TX_DATA 2
+#define BLOCKSCI_CHAIN_TX_INDEX 3
+#define BLOCKSCI_CHAIN_TX_VERSION 4
+#define BLOCKSCI_CHAIN_FIRST_INPUT 5
+#define BLOCKSCI_CHAIN_FIRST_OUTPUT 6
+#define BLOCKSCI_CHAIN_INPUT_SPENT_OUT_NUM 7
+#define BLOCKSCI_CHAIN_SEQUENCE 8
+#define BLOCKSCI_CHAIN_TX_HASHES 9
+#define BLOCKSCI_CHAIN_OUTPUT_VALUE 10
+#define BLOCKSCI_CHAIN_OUTPUT_TYPE 11
+#define BLOCKSCI_CHAIN_OUTPUT_ADDRESS 12
+#define BLOCKSCI_CHAIN_OUTPUT_SPENT_TX 13
+#define BLOCKSCI_CHAIN_OUTPUT_SPENDING_INPUT 14
+#define BLOCKSCI_CHAIN_OUTPUT_SPENDING_HEIGHT 15
+#define BLOCKSCI_CHAIN_TX_FEE 16
+#define BLOCKSCI_CHAIN_TX_VIRTUAL_SIZE 17
+#define BLOCKSCI_CHAIN_INPUT_SPENT_HEIGHT 18
+#define BLOCKSCI_CHAIN_INPUT_SPENT_VALUE 19
+#define BLOCKSCI_CHAIN_BLOCK_STATS 20
+#define BLOCKSCI_CHAIN_TX_PACKAGE_FLAGS 21
+
+/* Layout of a RawBlock, little endian */
+#define BLOCKSCI_RAW_BLOCK_SIZE 88
+#define BLOCKSCI_RAW_BLOCK_HASH_OFFSET 0
+#define BLOCKSCI_RAW_BLOCK_COINBASE_OFFSET_OFFSET 32
+#define BLOCKSCI_RAW_BLOCK_FIRST_TX_INDEX_OFFSET 40
+#define BLOCKSCI_RAW_BLOCK_TX_COUNT_OFFSET 44
+#define BLOCKSCI_RAW_BLOCK_INPUT_COUNT_OFFSET 48
+#define BLOCKSCI_RAW_BLOCK_OUTPUT_COUNT_OFFSET 52
+#define BLOCKSCI_RAW_BLOCK_HEIGHT_OFFSET 56
+#define BLOCKSCI_RAW_BLOCK_VERSION_OFFSET 60
+#define BLOCKSCI_RAW_BLOCK_TIMESTAMP_OFFSET 64
+#define BLOCKSCI_RAW_BLOCK_BITS_OFFSET 68
+#define BLOCKSCI_RAW_BLOCK_NONCE_OFFSET 72
+#define BLOCKSCI_RAW_BLOCK_REAL_SIZE_OFFSET 76
+#define BLOCKSCI_RAW_BLOCK_BASE_SIZE_OFFSET 80
+
+/* Layout of a tx in TX_DATA: the RawTransaction header (uint32_t realSize, baseSize, locktime and uint16_t
+ * inputCount, outputCount) followed by inputCount input Inouts and then outputCount output Inouts */
+#define BLOCKSCI_RAW_TX_HEADER_SIZE 16
+#define BLOCKSCI_RAW_TX_REAL_SIZE_OFFSET 0
+#define BLOCKSCI_RAW_TX_BASE_SIZE_OFFSET 4
+#define BLOCKSCI_RAW_TX_LOCKTIME_OFFSET 8
+#define BLOCKSCI_RAW_TX_INPUT_COUNT_OFFSET 12
+#define BLOCKSCI_RAW_TX_OUTPUT_COUNT_OFFSET 14
+
+/* Layout of an Inout: uint32_t linked tx (the tx of the spent output for inputs, the spending tx or 0 for outputs),
+ * uint32_t script number and a uint64_t holding the value in its low 60 bits and the address type in its high 4 */
+#define BLOCKSCI_INOUT_SIZE 16
+#define BLOCKSCI_INOUT_LINKED_TX_OFFSET 0
+#define BLOCKSCI_INOUT_SCRIPT_NUM_OFFSET 4
+#define BLOCKSCI_INOUT_PACKED_OFFSET 8
+#define BLOCKSCI_INOUT_VALUE_BITS 60
+#define BLOCKSCI_INOUT_VALUE_MASK ((UINT64_C(1) << BLOCKSCI_INOUT_VALUE_BITS) - 1)
+#define BLOCKSCI_INOUT_TYPE_SHIFT 60
+
+/* Script header columns of the scripts/ directory, uint32_t per script of a deduplicated type, element i describes
+ * script number i + 1 (first_index is 1). FIRST_SEEN and FIRST_SPENT hold tx numbers (0xFFFFFFFF if never spent).
+ * TYPES_SEEN has bit 2 * t set if the script was used as address type t and bit 2 * t + 1 if it was used at the top
+ * level of an output */
+#define BLOCKSCI_SCRIPT_FIRST_SEEN 0
+#define BLOCKSCI_SCRIPT_FIRST_SPENT 1
+#define BLOCKSCI_SCRIPT_TYPES_SEEN 2
+
+/* Deduplicated address types, the same numbering as blocksci::DedupAddressType */
+#define BLOCKSCI_DEDUP_SCRIPTHASH 0
+#define BLOCKSCI_DEDUP_PUBKEY 1
+#define BLOCKSCI_DEDUP_MULTISIG 2
+#define BLOCKSCI_DEDUP_NULL_DATA 3
+#define BLOCKSCI_DEDUP_WITNESS_UNKNOWN 4
+#define BLOCKSCI_DEDUP_NONSTANDARD 5
+#define BLOCKSCI_DEDUP_WITNESS_TAPROOT 6
+
+/* Files of a clustering:
+ *
+ *   OFFSETS     uint32_t per cluster with more than one address, end of its addresses in ADDRESSES. Clusters with a
+ *               number of at least the length of this column hold a single address that isn't stored in ADDRESSES
+ *   ADDRESSES   DedupAddress (uint32_t script number, uint32_t deduplicated type) per clustered address
+ *   INDEX       uint32_t cluster number per script of the given deduplicated type, element i is script i + 1
+ */
+#define BLOCKSCI_CLUSTER_OFFSETS 0
+#define BLOCKSCI_CLUSTER_ADDRESSES 1
+#define BLOCKSCI_CLUSTER_INDEX 2
+
+BLOCKSCI_EXPORT uint32_t blocksci_column_abi_version(void);
+
+/* Description of the last failure on the calling thread */
+BLOCKSCI_EXPORT const char *blocksci_last_error(void);
+
+/* Deduplicated type of the scripts of an address type (a value of OUTPUT_TYPE or of the type bits of an Inout), which
+ * selects the script and cluster index columns holding its script numbers. -1 for an invalid address type */
+BLOCKSCI_EXPORT int blocksci_dedup_type(int address_type);
+
+BLOCKSCI_EXPORT int blocksci_chain_column(blocksci_chain *chain, int column, blocksci_column *out);
+
+BLOCKSCI_EXPORT int blocksci_script_column(blocksci_chain *chain, int dedup_type, int column, blocksci_column *out);
+
+/* dedup_type is only used by BLOCKSCI_CLUSTER_INDEX */
+BLOCKSCI_EXPORT int blocksci_cluster_column(blocksci_clustering *clustering, int column, int dedup_type, blocksci_column *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* blocksci_column_abi_h */
@@ -0,0 +1,146 @@
+//
+//  access_hint.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_access_hint_hpp
+#define blocksci_access_hint_hpp
+
+#include <blocksci/blocksci_export.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace blocksci {
+    /** Hint passed to the kernel (via madvise) describing how a memory-mapped data file will be accessed
+     *
+     * Normal restores the default readahead behavior, Sequential enables aggressive readahead for full scans,
+     * Random disables readahead for point lookups, WillNeed asynchronously pre-faults the given range,
+     * DontNeed allows the kernel to drop the given range from the page cache and HugePage requests transparent
+     * huge pages for the mapping where the kernel and filesystem support it.
+     */
+    enum class BLOCKSCI_EXPORT AccessHint {
+        Normal, Sequential, Random, WillNeed, DontNeed, HugePage
+    };
+
+    /** Identifies the individual memory-mapped files in the chain/ directory
+     *
+     * OutputValue, OutputType, OutputAddress and OutputSpentTx are the optional output columns (see OutputColumns),
+     * OutputSpendingInput and OutputSpendingHeight are written along with them. TxFee and TxVirtualSize are the optional
+     * per-transaction fee columns and InputSpentHeight and InputSpentValue the optional coin age columns (see
+     * InputAgeColumns). BlockStats holds the per-block aggregates (see BlockStats) and TxPackageFlags the per-transaction
+     * same-block spend bits (see TxPackageFlag) */
+    enum class BLOCKSCI_EXPORT ChainColumn {
+        Block, Coinbase, TxData, TxIndex, TxVersion, FirstInput, FirstOutput, InputSpentOutNum, Sequence, TxHashes,
+        OutputValue, OutputType, OutputAddress, OutputSpentTx, OutputSpendingInput,
+        OutputSpendingHeight, TxFee, TxVirtualSize, InputSpentHeight, InputSpentValue, BlockStats,
+        TxPackageFlags
+    };
+    
+    /** NUMA memory policy of the copies made by resident mode (see Blockchain::makeResident)
+     *
+     * Default leaves the pages on the node of the copying thread, Interleave spreads them over all nodes and Partition
+     * places the i-th of n equal slices of every copy on the i-th of n nodes, which matches the contiguous tx ranges
+     * processed by the nodes of a NUMA aware work pool (see ParallelConfig::numaAware).
+     */
+    enum class BLOCKSCI_EXPORT NumaPlacement {
+        Default, Interleave, Partition
+    };
+    
+    /** Memory held by resident mode (see Blockchain::makeResident) */
+    struct BLOCKSCI_EXPORT ResidentMemoryStats {
+        /** Bytes of chain data copied into anonymous memory */
+        uint64_t residentBytes = 0;
+        
+        /** Portion of residentBytes backed by explicit huge pages (MAP_HUGETLB), the rest relies on transparent huge pages */
+        uint64_t hugePageBytes = 0;
+        
+        /** Bytes of tx_data.dat locked into memory with mlock */
+        uint64_t lockedBytes = 0;
+    };
+    
+    /** Page cache residency of one data file (see Blockchain::pageCacheResidency) */
+    struct BLOCKSCI_EXPORT FileResidency {
+        std::string path;
+        
+        /** Size of the file in bytes */
+        uint64_t size = 0;
+        
+        /** Bytes of the file currently held in the page cache, as reported by mincore */
+        uint64_t residentBytes = 0;
+        
+        double residentFraction() const {
+            return size > 0 ? static_cast<double>(residentBytes) / static_cast<double>(size) : 1.0;
+        }
+    };
+    
+    /** Memory held by the RocksDB instances of the address and hash indexes that are open, as reported by
+     * GetApproximateMemoryUsageByType. A block cache shared by both indexes is counted once */
+    struct BLOCKSCI_EXPORT IndexMemoryUsage {
+        uint64_t memtableBytes = 0;
+        
+        /** Index and filter blocks held outside of the block cache by the open table files */
+        uint64_t tableReaderBytes = 0;
+        
+        uint64_t blockCacheBytes = 0;
+        
+        /** Sum of the capacities of the block caches */
+        uint64_t blockCacheCapacity = 0;
+        
+        uint64_t totalBytes() const {
+            return memtableBytes + tableReaderBytes + blockCacheBytes;
+        }
+    };
+    
+    /** Memory footprint of a chain broken down by subsystem (see Blockchain::memoryUsage) */
+    struct BLOCKSCI_EXPORT MemoryUsage {
+        /** Page cache residency of every data file, @see Blockchain::pageCacheResidency */
+        std::vector<FileResidency> mappedFiles;
+        
+        /** Sum of the resident bytes of mappedFiles */
+        uint64_t mappedResidentBytes = 0;
+        
+        /** Copies held by resident mode */
+        ResidentMemoryStats residentMode;
+        
+        IndexMemoryUsage indexes;
+        
+        /** In-memory indexes built when the chain is loaded (block height and block time indexes) */
+        uint64_t chainIndexBytes = 0;
+        
+        /** Resident set size of the whole process, which also covers everything outside of the chain such as the
+         * objects of the Python interpreter. Not part of totalBytes() */
+        uint64_t processResidentBytes = 0;
+        
+        /** Memory attributed to the chain, the quantity limited by the memory budget */
+        uint64_t totalBytes() const {
+            return mappedResidentBytes + residentMode.residentBytes + indexes.totalBytes() + chainIndexBytes;
+        }
+    };
+    
+    /** Result of enforcing the memory budget of a chain (see Blockchain::enforceMemoryBudget) */
+    struct BLOCKSCI_EXPORT MemoryBudgetResult {
+        uint64_t budget = 0;
+        
+        /** MemoryUsage::totalBytes() before anything was released */
+        uint64_t usageBefore = 0;
+        
+        /** Bytes released by lowering the capacity of the RocksDB block caches */
+        uint64_t blockCacheReleased = 0;
+        
+        /** Resident bytes of the data files that were dropped from the mapping with madvise(MADV_DONTNEED) */
+        uint64_t mappingReleased = 0;
+        
+        /** Data files dropped from the mapping, coldest first */
+        std::vector<ChainColumn> droppedColumns;
+        
+        bool exceeded() const {
+            return budget > 0 && usageBefore > budget;
+        }
+    };
+} // namespace blocksci
+
+#endif /* blocksci_access_hint_hpp */
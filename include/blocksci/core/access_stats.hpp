@@ -0,0 +1,79 @@
+//
+//  access_stats.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_access_stats_hpp
+#define blocksci_access_stats_hpp
+
+#include <blocksci/blocksci_export.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace blocksci {
+    /** Hot-path data accesses counted by the instrumentation (see Blockchain::stats)
+     *
+     * TxDecode is a lookup of a transaction in tx_data.dat, BlockHeightLookup one of the block of a transaction,
+     * ScriptLoad one of a script in scripts/, HashIndexLookup and AddressIndexLookup are point lookups and scan starts
+     * in the RocksDB indexes and IndexIteratorStep counts the RocksDB iterator seeks and steps of index scans.
+     */
+    enum class BLOCKSCI_EXPORT AccessEvent : uint8_t {
+        TxDecode, BlockHeightLookup, ScriptLoad, HashIndexLookup, AddressIndexLookup, IndexIteratorStep
+    };
+
+    constexpr size_t accessEventCount = 6;
+
+    /** Latency histogram buckets, bucket i counts latencies in [2^i, 2^(i+1)) nanoseconds (bucket 0 includes 0) */
+    constexpr size_t accessLatencyBuckets = 32;
+
+    /** Counts and latencies of one AccessEvent
+     *
+     * Every event is counted, but only every 16th event of a thread is timed so that the clock reads don't dominate
+     * cheap accesses. The latencies describe the timed events only. */
+    struct BLOCKSCI_EXPORT AccessEventStats {
+        uint64_t count = 0;
+        uint64_t timedCount = 0;
+        uint64_t totalNanoseconds = 0;
+        std::array<uint64_t, accessLatencyBuckets> latencyHistogram{};
+
+        double meanNanoseconds() const {
+            return timedCount > 0 ? static_cast<double>(totalNanoseconds) / static_cast<double>(timedCount) : 0.0;
+        }
+
+        /** Upper bound of the histogram bucket holding the given quantile (0 to 1) of the timed latencies */
+        uint64_t quantileNanoseconds(double quantile) const;
+
+        /** Estimated time spent in all counted events, extrapolated from the timed ones */
+        double estimatedTotalNanoseconds() const {
+            return meanNanoseconds() * static_cast<double>(count);
+        }
+    };
+
+    /** Snapshot of the access counters of all threads of the process
+     *
+     * The counters only exist in builds configured with -DBLOCKSCI_INSTRUMENTATION=ON, otherwise enabled is false and
+     * everything is zero. Subtract two snapshots to get the accesses in between, @see AccessProfile */
+    struct BLOCKSCI_EXPORT AccessStats {
+        bool enabled = false;
+        std::array<AccessEventStats, accessEventCount> events;
+
+        const AccessEventStats &operator[](AccessEvent event) const {
+            return events[static_cast<size_t>(event)];
+        }
+
+        AccessEventStats &operator[](AccessEvent event) {
+            return events[static_cast<size_t>(event)];
+        }
+
+        AccessStats operator-(const AccessStats &other) const;
+    };
+
+    /** snake_case name of the event, eg. "tx_decode" */
+    BLOCKSCI_EXPORT const char *accessEventName(AccessEvent event);
+} // namespace blocksci
+
+#endif /* blocksci_access_stats_hpp */
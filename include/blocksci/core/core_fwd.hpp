@@ -24,6 +24,7 @@ namespace blocksci {
     struct NonstandardSpendScriptData;
     struct WitnessUnknownScriptData;
     struct WitnessUnknownSpendScriptData;
+    struct TaprootData;
 
     struct RawAddress;
     struct DedupAddress;
@@ -12,21 +12,21 @@
 
 #include <blocksci/core/meta.hpp>
 
-#define DEDUP_ADDRESS_TYPE_LIST VAL(SCRIPTHASH), VAL(PUBKEY), VAL(MULTISIG), VAL(NULL_DATA), VAL(WITNESS_UNKNOWN), VAL(NONSTANDARD)
+#define DEDUP_ADDRESS_TYPE_LIST VAL(SCRIPTHASH), VAL(PUBKEY), VAL(MULTISIG), VAL(NULL_DATA), VAL(WITNESS_UNKNOWN), VAL(NONSTANDARD), VAL(WITNESS_TAPROOT)
 
 namespace blocksci {
 
     struct DedupAddressType {
         
         enum Enum {
-            // after preprocessing: SCRIPTHASH, PUBKEY, MULTISIG, NULL_DATA, WITNESS_UNKNOWN, NONSTANDARD
+            // after preprocessing: SCRIPTHASH, PUBKEY, MULTISIG, NULL_DATA, WITNESS_UNKNOWN, NONSTANDARD, WITNESS_TAPROOT
 #define VAL(x) x
             DEDUP_ADDRESS_TYPE_LIST
 #undef VAL
         };
-        static constexpr size_t size = 6;
+        static constexpr size_t size = 7;
 
-        // after preprocessing: using all = std::tuple<std::integral_constant<Enum, SCRIPTHASH>, std::integral_constant<Enum, PUBKEY>, std::integral_constant<Enum, MULTISIG>, std::integral_constant<Enum, NULL_DATA>, std::integral_constant<Enum, WITNESS_UNKNOWN>, std::integral_constant<Enum, NONSTANDARD> >;
+        // after preprocessing: using all = std::tuple<std::integral_constant<Enum, SCRIPTHASH>, std::integral_constant<Enum, PUBKEY>, std::integral_constant<Enum, MULTISIG>, std::integral_constant<Enum, NULL_DATA>, std::integral_constant<Enum, WITNESS_UNKNOWN>, std::integral_constant<Enum, NONSTANDARD>, std::integral_constant<Enum, WITNESS_TAPROOT> >;
         #define VAL(x) std::integral_constant<Enum, x>
         using all = std::tuple<DEDUP_ADDRESS_TYPE_LIST>;
         #undef VAL
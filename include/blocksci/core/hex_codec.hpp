@@ -0,0 +1,38 @@
+//
+//  hex_codec.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_core_hex_codec_hpp
+#define blocksci_core_hex_codec_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/core/bitcoin_uint256.hpp>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace blocksci {
+    /** Hex strings of count hashes of width bytes each, stored consecutively
+     *
+     * Like base_blob::GetHex, the string of a hash starts with its last byte. String i takes the 2 * width chars at
+     * out + 2 * width * i and isn't terminated. Uses SSSE3 or AVX2 shuffles to reverse and expand 16 or 32 bytes at
+     * a time where the CPU supports them. */
+    void BLOCKSCI_EXPORT encodeHexBatch(const unsigned char *hashes, size_t width, size_t count, char *out);
+
+    /** Parse count strings of exactly 2 * width hex digits, string i starting at hex + stride * i, into hashes of
+     * width bytes at out + width * i, in the byte order of encodeHexBatch
+     *
+     * Returns count if all strings are valid, otherwise the number of the first string holding a char that isn't a
+     * hex digit. The contents of its hash and the ones after it are unspecified then. */
+    size_t BLOCKSCI_EXPORT decodeHexBatch(const char *hex, size_t stride, size_t width, size_t count, unsigned char *out);
+
+    /** uint256S of every string. Strings of 64 hex digits, optionally prefixed by 0x, are decoded with
+     * decodeHexBatch; anything else goes through uint256S */
+    std::vector<uint256> BLOCKSCI_EXPORT parseHashes(const std::vector<std::string> &hexStrings);
+} // namespace blocksci
+
+#endif /* blocksci_core_hex_codec_hpp */
@@ -0,0 +1,67 @@
+//
+//  input_signature.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_input_signature_hpp
+#define blocksci_input_signature_hpp
+
+#include <blocksci/blocksci_export.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace blocksci {
+    /** Signature and public key revealed by an input, as stored in the optional chain/input_signatures.dat file
+     *
+     * The parser records the first signature and the last public key pushed by the scriptSig or witness of every
+     * input. Public keys are stored compressed, so the compressed and uncompressed forms of a key compare equal;
+     * decompressPubkeys restores the full serialization.
+     */
+    struct BLOCKSCI_EXPORT InputSignature {
+        enum Flag : uint8_t {
+            HasSignature = 1,
+            Schnorr = 2,
+            HasPubkey = 4,
+            /** The input revealed the uncompressed serialization of the public key */
+            UncompressedPubkey = 8,
+            /** Extracted from the witness instead of the scriptSig */
+            Witness = 16
+        };
+        
+        /** Big endian R and S values */
+        std::array<unsigned char, 32> r;
+        std::array<unsigned char, 32> s;
+        
+        /** Compressed serialization of the public key */
+        std::array<unsigned char, 33> pubkey;
+        
+        uint8_t sighash;
+        uint8_t flags;
+        
+        bool has(Flag flag) const {
+            return (flags & flag) != 0;
+        }
+    };
+    
+    static_assert(sizeof(InputSignature) == 99, "InputSignature is stored as raw file data");
+    
+    /** Fill r, s and sighash from a pushed signature, a lax DER encoded ECDSA signature or a 64 byte Schnorr signature,
+     * each followed by the sighash byte (optional for Schnorr). Returns false if the data is no signature */
+    BLOCKSCI_EXPORT bool parseInputSignature(const unsigned char *data, size_t length, InputSignature &signature);
+    
+    /** Store the compressed form of a serialized public key, returns false if the data is no public key */
+    BLOCKSCI_EXPORT bool setInputPubkey(const unsigned char *data, size_t length, InputSignature &signature);
+    
+    /** Uncompressed serialization of each of the count 33 byte compressed keys, all zero for invalid keys
+     *
+     * Runs on threadCount threads (0 for one per hardware thread), each with its own secp256k1 context, so it
+     * doesn't need an ECCVerifyHandle. */
+    BLOCKSCI_EXPORT std::vector<std::array<unsigned char, 65>> decompressPubkeys(const unsigned char *keys, size_t count, uint32_t threadCount = 0);
+} // namespace blocksci
+
+#endif /* blocksci_input_signature_hpp */
@@ -0,0 +1,70 @@
+//
+//  raw_witness.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_raw_witness_hpp
+#define blocksci_raw_witness_hpp
+
+#include <blocksci/blocksci_export.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace blocksci {
+    /** Witness of one input as stored in the optional chain/witness files
+     *
+     * The header is followed by the itemCount item lengths and, if the files store item data (@see WitnessFileInfo),
+     * by the items themselves padded to a multiple of 4 bytes. The witnesses of all inputs of a transaction are stored
+     * back to back, so the witness of the next input starts realSize() bytes later.
+     */
+    struct BLOCKSCI_EXPORT RawWitness {
+        uint32_t itemCount;
+
+        /** Size of the serialized witness including the compact size prefixes, 0 for inputs without witness items.
+         * Every witness byte counts as one weight unit. */
+        uint32_t serializedSize;
+
+        const uint32_t *itemLengths() const {
+            return reinterpret_cast<const uint32_t *>(this + 1);
+        }
+
+        /** Total size of the items without their length prefixes */
+        uint32_t dataSize() const {
+            uint32_t size = 0;
+            for (uint32_t i = 0; i < itemCount; i++) {
+                size += itemLengths()[i];
+            }
+            return size;
+        }
+
+        /** The concatenated items, only valid if the files store item data */
+        const unsigned char *itemData() const {
+            return reinterpret_cast<const unsigned char *>(itemLengths() + itemCount);
+        }
+
+        size_t realSize(bool hasItemData) const {
+            size_t size = sizeof(RawWitness) + sizeof(uint32_t) * itemCount;
+            if (hasItemData) {
+                size += (static_cast<size_t>(dataSize()) + 3) / 4 * 4;
+            }
+            return size;
+        }
+
+        const RawWitness *next(bool hasItemData) const {
+            return reinterpret_cast<const RawWitness *>(reinterpret_cast<const char *>(this) + realSize(hasItemData));
+        }
+    };
+
+    /** Coverage of the optional chain/witness files, which start at the first transaction parsed after recording was enabled */
+    struct BLOCKSCI_EXPORT WitnessFileInfo {
+        uint32_t firstTxNum;
+
+        /** Whether the items are stored as well or only their lengths */
+        uint32_t hasItemData;
+    };
+} // namespace blocksci
+
+#endif /* blocksci_raw_witness_hpp */
@@ -93,10 +93,19 @@ namespace blocksci {
         }
         
         bool seenTopLevel(blocksci::AddressType::Enum type) const {
-            return typesSeen & (1u << (static_cast<uint32_t>(type) * 2 + 1));
+            return seenTopLevel(typesSeen, type);
         }
         
         bool seen(blocksci::AddressType::Enum type) const {
+            return seen(typesSeen, type);
+        }
+        
+        /** Same as the members for a typesSeen value read from the types seen columns of ScriptAccess */
+        static bool seenTopLevel(uint32_t typesSeen, blocksci::AddressType::Enum type) {
+            return typesSeen & (1u << (static_cast<uint32_t>(type) * 2 + 1));
+        }
+        
+        static bool seen(uint32_t typesSeen, blocksci::AddressType::Enum type) {
             return typesSeen & (1u << static_cast<uint32_t>(type) * 2);
         }
     };
@@ -154,6 +163,28 @@ namespace blocksci {
         }
     };
     
+    /** How a taproot output was spent, determined from the witness stack of its first spend */
+    enum class BLOCKSCI_EXPORT TaprootSpendType : uint8_t {
+        /** The output hasn't been spent yet */
+        Unspent,
+        /** Spent with a single signature for the output key */
+        KeyPath,
+        /** Spent by revealing a leaf script and its control block */
+        ScriptPath
+    };
+    
+    struct BLOCKSCI_EXPORT TaprootData : public ScriptDataBase {
+        /** 32 byte x-only output key, the witness program of the output */
+        uint256 outputKey;
+        TaprootSpendType spendType;
+        
+        TaprootData(uint32_t txNum, const uint256 &outputKey_) : ScriptDataBase(txNum), outputKey(outputKey_), spendType(TaprootSpendType::Unspent) {}
+        
+        size_t size() {
+            return sizeof(TaprootData);
+        }
+    };
+    
     struct BLOCKSCI_EXPORT MultisigData : public ScriptDataBase {
         uint8_t m;
         uint8_t n;
@@ -0,0 +1,109 @@
+//
+//  tracing.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_tracing_hpp
+#define blocksci_tracing_hpp
+
+#include <blocksci/blocksci_export.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace blocksci {
+    /** Operations reported to the TraceSink
+     *
+     * IndexSeek spans the creation and first seek of a RocksDB iterator, IndexScan a prefix or full scan of an index
+     * column from its seek until the last copy of its cursor is gone (so it includes the time spent by the consumer
+     * of a lazy range such as Address::getOutputs), ClusterLookup the lookup of the clusters of addresses, TaintRun
+     * one run of a taint heuristic, MapReduceSegment the processing of one chunk of a parallel operation and
+     * ClusteringPhase one phase of creating or updating a clustering.
+     */
+    enum class BLOCKSCI_EXPORT TraceOperation : uint8_t {
+        IndexSeek, IndexScan, ClusterLookup, TaintRun, MapReduceSegment, ClusteringPhase
+    };
+
+    /** snake_case name of the operation, eg. "index_seek" */
+    BLOCKSCI_EXPORT const char *traceOperationName(TraceOperation operation);
+
+    /** Phases of ClusterManager::createClustering, updateClustering and refineClustering, in the order they run
+     *
+     * LinkScripthashNested links scripthash addresses with the address they wrap, LinkTransactions applies the
+     * clustering rules to every transaction, RefineClusters runs the rounds of ClusterManager::refineClustering,
+     * ResolveClusters finds the root of every address, WriteClusterState stores the roots for later updates,
+     * RemapClusterIds numbers the clusters, SerializeClusterData writes the cluster files and WriteClusterStats the
+     * precomputed cluster statistics.
+     */
+    enum class BLOCKSCI_EXPORT ClusteringPhase : uint8_t {
+        LinkScripthashNested, LinkTransactions, RefineClusters, ResolveClusters, WriteClusterState, RemapClusterIds, SerializeClusterData, WriteClusterStats
+    };
+
+    constexpr size_t clusteringPhaseCount = 8;
+
+    /** snake_case name of the phase, eg. "resolve_clusters" */
+    BLOCKSCI_EXPORT const char *clusteringPhaseName(ClusteringPhase phase);
+
+    /** Receives a span for every traced operation, eg. to forward them to OpenTelemetry
+     *
+     * The argument of a span is the number of addresses of a ClusterLookup, the number of seed outputs of a TaintRun,
+     * the chunk number of a MapReduceSegment, the ClusteringPhase of a ClusteringPhase and 0 otherwise. beginSpan is called on the thread running the
+     * operation and may be called concurrently from several threads. endSpan receives the value returned by
+     * beginSpan, it is called on the same thread except for IndexScan spans.
+     */
+    class BLOCKSCI_EXPORT TraceSink {
+    public:
+        virtual ~TraceSink();
+        virtual uint64_t beginSpan(TraceOperation operation, uint64_t argument) = 0;
+        virtual void endSpan(uint64_t span, TraceOperation operation) = 0;
+    };
+
+    /** Report the spans of all chains of the process to sink, or stop tracing with nullptr
+     *
+     * Without a sink every traced operation costs one atomic load. The sink has to stay alive until it was replaced
+     * and the operations running at that time have finished. */
+    BLOCKSCI_EXPORT void setTraceSink(TraceSink *sink);
+
+    BLOCKSCI_EXPORT TraceSink *traceSink();
+
+    /** TraceSink keeping all spans in memory */
+    class BLOCKSCI_EXPORT SpanRecorder : public TraceSink {
+    public:
+        struct Span {
+            TraceOperation operation;
+            uint64_t argument;
+
+            /** Hash of the id of the thread that began the span */
+            uint64_t thread;
+
+            /** Begin of the span on the steady clock */
+            uint64_t startNanoseconds;
+            uint64_t durationNanoseconds;
+        };
+
+        /** Stops tracing if this is the active sink */
+        ~SpanRecorder() override;
+
+        uint64_t beginSpan(TraceOperation operation, uint64_t argument) override;
+        void endSpan(uint64_t span, TraceOperation operation) override;
+
+        /** Spans that ended so far, in the order they began */
+        std::vector<Span> spans() const;
+
+        void clear();
+
+    private:
+        mutable std::mutex mutex;
+        std::vector<Span> recorded;
+        std::vector<bool> ended;
+
+        /** Spans dropped by clear(), the id of a span is its position in recorded plus this */
+        uint64_t clearedCount = 0;
+    };
+} // namespace blocksci
+
+#endif /* blocksci_tracing_hpp */
@@ -16,8 +16,31 @@
 #include <cstdint>
 
 namespace blocksci {
-    /** Class that brings transaction data from several files together */
+    /** Columns of TxData besides rawTx, each resolved from its file on first access */
+    enum class TxDataColumn : uint8_t {
+        /** version, from chain/tx_version.dat */
+        Version = 1,
+        /** hash, from chain/tx_hashes.dat */
+        Hash = 2,
+        /** spentOutputNums and sequenceNumbers, located through chain/firstInput.dat */
+        Inputs = 4
+    };
+    
+    /** Number of lazy column lookups of each TxDataColumn, see Blockchain::setTrackTxColumnAccess */
+    struct BLOCKSCI_EXPORT TxColumnAccessStats {
+        uint64_t version = 0;
+        uint64_t hash = 0;
+        uint64_t inputs = 0;
+    };
+    
+    /** Class that brings transaction data from several files together
+     *
+     * Only rawTx is set on construction, the other pointers are only valid for the columns in resolvedColumns. The
+     * remaining ones are looked up when first needed, so scans reading only tx_data.dat don't fault in pages of the
+     * other column files. */
     struct BLOCKSCI_EXPORT TxData {
+        static constexpr uint8_t allColumns = static_cast<uint8_t>(TxDataColumn::Version) | static_cast<uint8_t>(TxDataColumn::Hash) | static_cast<uint8_t>(TxDataColumn::Inputs);
+        
         /** Raw transaction data, stored in chain/tx_data.dat */
         const RawTransaction *rawTx;
 
@@ -32,12 +55,26 @@ namespace blocksci {
 
         /** Pointer to the blockchain field <sequence number> of the transaction's first input, stored in chain/sequence.dat */
         const uint32_t *sequenceNumbers;
+        
+        /** Bitmask of the TxDataColumns whose pointers are set */
+        uint8_t resolvedColumns;
+        
+        bool isResolved(TxDataColumn column) const {
+            return (resolvedColumns & static_cast<uint8_t>(column)) != 0;
+        }
 
+        /** Move to the next transaction, resolved columns stay resolved */
         TxData &operator++() {
-            sequenceNumbers += rawTx->inputCount;
-            spentOutputNums += rawTx->inputCount;
-            version++;
-            hash++;
+            if (isResolved(TxDataColumn::Inputs)) {
+                sequenceNumbers += rawTx->inputCount;
+                spentOutputNums += rawTx->inputCount;
+            }
+            if (isResolved(TxDataColumn::Version)) {
+                version++;
+            }
+            if (isResolved(TxDataColumn::Hash)) {
+                hash++;
+            }
             auto currentTxSize = sizeof(RawTransaction) + static_cast<size_t>(rawTx->inputCount) * sizeof(Inout) + static_cast<size_t>(rawTx->outputCount) * sizeof(Inout);
             rawTx = reinterpret_cast<const RawTransaction *>(reinterpret_cast<const char*>(rawTx) + currentTxSize);
             return *this;
@@ -0,0 +1,50 @@
+//
+//  tx_features.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_core_tx_features_hpp
+#define blocksci_core_tx_features_hpp
+
+#include <blocksci/blocksci_export.h>
+
+#include <cstdint>
+
+namespace blocksci {
+    /** Results of the transaction classifiers in heuristics/tx_identification.hpp for one transaction
+     *
+     * Stored per transaction in the optional tx feature table, see heuristics::buildTxFeatureTable. Counts are
+     * saturated at the maximum of uint16_t.
+     */
+    struct BLOCKSCI_EXPORT TxFeatures {
+        enum Flag : uint16_t {
+            Coinjoin = 1 << 0,
+            PossibleCoinjoin = 1 << 1,
+            PossibleCoinjoinTimeout = 1 << 2,
+            CoinjoinExtra = 1 << 3,
+            CoinjoinExtraTimeout = 1 << 4,
+            DeanonTx = 1 << 5,
+            ChangeOverTx = 1 << 6,
+            KeysetChange = 1 << 7
+        };
+        
+        uint16_t flags;
+        
+        /** Number of distinct addresses spent by the inputs */
+        uint16_t distinctInputAddresses;
+        
+        /** Number of distinct output values */
+        uint16_t distinctOutputValues;
+        
+        /** Number of outputs sharing the most common output value */
+        uint16_t largestEqualOutputCount;
+        
+        bool has(Flag flag) const {
+            return (flags & flag) != 0;
+        }
+    };
+} // namespace blocksci
+
+#endif /* blocksci_core_tx_features_hpp */
@@ -18,7 +18,9 @@
 #include <range/v3/view.hpp>
 #include <range/v3/view/set_algorithm.hpp>
 
+#include <cstdint>
 #include <unordered_set>
+#include <vector>
 
 #define CHANGE_ADDRESS_TYPE_LIST VAL(PeelingChain), VAL(PowerOfTen), VAL(OptimalChange), VAL(AddressType), VAL(Locktime), VAL(AddressReuse), VAL(ClientChangeAddressBehavior), VAL(Legacy), VAL(FixedFee), VAL(None), VAL(Spent)
 #define CHANGE_ADDRESS_TYPE_SET VAL(PeelingChain), VAL(PowerOfTen), VAL(OptimalChange), VAL(AddressType) VAL(Locktime), VAL(AddressReuse), VAL(ClientChangeAddressBehavior), VAL(Legacy), VAL(FixedFee), VAL(None), VAL(Spent)
@@ -42,6 +44,9 @@ namespace heuristics {
     template <ChangeType::Enum heuristic>
     struct BLOCKSCI_EXPORT ChangeHeuristicImpl {
         ranges::any_view<Output> operator()(const Transaction &tx) const;
+        
+        /** Append the outputs operator() returns to change, without building a type erased range */
+        void appendChange(const Transaction &tx, std::vector<Output> &change) const;
     };
     
     template<>
@@ -49,6 +54,7 @@ namespace heuristics {
         int digits;
         ChangeHeuristicImpl(int digits_ = 6) : digits(digits_) {}
         ranges::any_view<Output> operator()(const Transaction &tx) const;
+        void appendChange(const Transaction &tx, std::vector<Output> &change) const;
     };
     
     using PeelingChainChange = ChangeHeuristicImpl<ChangeType::PeelingChain>;
@@ -63,6 +69,15 @@ namespace heuristics {
     using NoChange = ChangeHeuristicImpl<ChangeType::None>;
     using Spent = ChangeHeuristicImpl<ChangeType::Spent>;
     
+    /** Evaluate several change heuristics on every transaction in blocks at once
+     *
+     * Returns one mask per output of the range, ordered by transaction and output number, in which bit i is set if
+     * heuristics[i] returns the output as a candidate. Values that several heuristics need, like the input addresses
+     * or the spending transactions of the outputs, are computed once per transaction. Combinations like the
+     * intersection or the union of heuristics are bitwise operations on the masks.
+     */
+    std::vector<uint32_t> BLOCKSCI_EXPORT evaluateChange(BlockRange &blocks, const std::vector<ChangeType::Enum> &heuristics, int powerOfTenDigits = 6, uint32_t threadCount = 0);
+    
     struct BLOCKSCI_EXPORT ChangeHeuristic {
         using HeuristicFunc = std::function<ranges::any_view<Output>(const Transaction &tx)>;
         
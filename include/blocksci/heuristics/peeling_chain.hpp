@@ -0,0 +1,66 @@
+//
+//  peeling_chain.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef peeling_chain_hpp
+#define peeling_chain_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/core/typedefs.hpp>
+#include <blocksci/chain/chain_fwd.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace blocksci { namespace heuristics {
+
+    /** Transaction that continues a peeling chain, reached by spending the continuing output of the previous hop */
+    struct BLOCKSCI_EXPORT PeelingChainHop {
+        uint32_t txNum;
+        BlockHeight blockHeight;
+        /** Output of this transaction that the chain continues with, the one with the largest value */
+        uint16_t outputNum;
+        int64_t value;
+        /** Value of all other outputs of this transaction */
+        int64_t peeledValue;
+    };
+
+    enum class BLOCKSCI_EXPORT PeelingChainEnd {
+        /** The continuing output of the last hop is unspent */
+        Unspent,
+        /** The transaction spending the continuing output of the last hop doesn't match the predicate */
+        NotPeeling,
+        /** maxHops hops were followed */
+        MaxHops
+    };
+
+    struct BLOCKSCI_EXPORT PeelingChain {
+        std::vector<PeelingChainHop> hops;
+        PeelingChainEnd end;
+    };
+
+    /** Decides whether a transaction spending the continuing output of the previous hop is a hop itself */
+    using PeelingChainPredicate = std::function<bool(const Transaction &)>;
+
+    /** Follow the peeling chain that starts with the spend of the given output for up to maxHops hops
+     *
+     * Every transaction that spends the continuing output and matches predicate is a hop, and its largest output is the
+     * continuing output of the next hop. An empty predicate accepts transactions with one input and two outputs.
+     */
+    PeelingChain BLOCKSCI_EXPORT followPeelingChain(const Output &start, uint32_t maxHops = std::numeric_limits<uint32_t>::max(), const PeelingChainPredicate &predicate = {});
+
+    /** Follow the peeling chains starting at all given outputs together, result[i] is the chain of starts[i]
+     *
+     * The chains advance one hop per round. Each round the next transactions of all chains are sorted, split over
+     * threadCount threads (0 uses one per hardware thread) and looked up in batches, so that the lookups of the whole
+     * frontier overlap instead of waiting for one transaction after another. predicate is called concurrently.
+     */
+    std::vector<PeelingChain> BLOCKSCI_EXPORT followPeelingChains(const std::vector<Output> &starts, uint32_t maxHops = std::numeric_limits<uint32_t>::max(), const PeelingChainPredicate &predicate = {}, uint32_t threadCount = 0);
+}}
+
+#endif /* peeling_chain_hpp */
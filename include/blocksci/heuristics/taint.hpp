@@ -13,14 +13,59 @@
 #include <blocksci/chain/chain_fwd.hpp>
 
 #include <cstdint>
+#include <utility>
 #include <vector>
 
 namespace blocksci { namespace heuristics {
     using SimpleTaint = std::pair<int64_t, int64_t>; // (tainted value, untainted value)
     using ComplexTaint = std::vector<std::pair<int64_t, bool>>; // [(value, isTainted), (value, isTainted), ...]
     
-    std::vector<std::pair<Output, SimpleTaint>> BLOCKSCI_EXPORT getPoisonTainted(std::vector<Output> &outputs, BlockHeight maxBlockHeight, bool taintFee);
-    std::vector<std::pair<Output, SimpleTaint>> BLOCKSCI_EXPORT getHaircutTainted(std::vector<Output> &outputs, BlockHeight maxBlockHeight, bool taintFee);
+    /** Taint of an output by several traces at once: its value and the tainted part of it per trace, sorted by trace */
+    struct BLOCKSCI_EXPORT MultiTaint {
+        int64_t value;
+        std::vector<std::pair<uint32_t, int64_t>> seeds; // [(seedSetNum, taintedValue), ...]
+    };
+    
+    /** Options of getHaircutSourceTainted */
+    struct BLOCKSCI_EXPORT SourceTaintOptions {
+        /** Largest number of sources tracked per output (at most 256), the smallest shares beyond it are dropped */
+        uint32_t maxSources = 16;
+        /** Shares smaller than this fraction of the value of an output are dropped as dust */
+        double minProportion = 1e-6;
+        /** Threads the transactions of a block are processed on, 0 uses one per hardware thread */
+        uint32_t threadCount = 1;
+    };
+    
+    /** Taint propagated from the given fully tainted outputs up to block maxBlockHeight (-1 for the whole chain)
+     *
+     * Transactions are processed in txNum order, only those spending a tainted output are read. Returns the tainted
+     * outputs that are unspent at maxBlockHeight. If taintFee is set, tainted fees taint the coinbase of the block.
+     * showProgress prints the progress through the covered transactions.
+     */
+    std::vector<std::pair<Output, SimpleTaint>> BLOCKSCI_EXPORT getPoisonTainted(std::vector<Output> &outputs, BlockHeight maxBlockHeight, bool taintFee, bool showProgress = false);
+    std::vector<std::pair<Output, SimpleTaint>> BLOCKSCI_EXPORT getHaircutTainted(std::vector<Output> &outputs, BlockHeight maxBlockHeight, bool taintFee, bool showProgress = false);
+    
+    /** Haircut taint that keeps track of which of the given outputs the taint comes from
+     *
+     * The seeds of the result are (position in outputs, tainted value) pairs whose sum matches the tainted value of
+     * getHaircutTainted up to rounding. Each output carries fixed point proportions of its value for a bounded number
+     * of sources, and shares below the dust threshold are pruned, so long traces stay within bounded memory and time
+     * at the cost of slightly undercounting the taint.
+     */
+    std::vector<std::pair<Output, MultiTaint>> BLOCKSCI_EXPORT getHaircutSourceTainted(std::vector<Output> &outputs, BlockHeight maxBlockHeight, bool taintFee, const SourceTaintOptions &options = {}, bool showProgress = false);
+    
+    std::vector<std::pair<Output, ComplexTaint>> BLOCKSCI_EXPORT getFifoTainted(std::vector<Output> &outputs, BlockHeight maxBlockHeight, bool taintFee, bool showProgress = false);
+    std::vector<std::pair<Output, ComplexTaint>> BLOCKSCI_EXPORT getLifoTainted(std::vector<Output> &outputs, BlockHeight maxBlockHeight, bool taintFee, bool showProgress = false);
+    
+    /** Run an independent trace for every seed set in a single sweep over the chain
+     *
+     * result[i] holds the outputs tainted by seedSets[i], the same as calling getPoisonTainted or getHaircutTainted with
+     * seedSets[i] alone. The taint of all traces is carried together, so the cost grows with the transactions reached by
+     * any trace rather than with the number of traces. The transactions of each block are processed on threadCount
+     * threads, 0 uses one per hardware thread.
+     */
+    std::vector<std::vector<std::pair<Output, SimpleTaint>>> BLOCKSCI_EXPORT getPoisonTaintedBatch(std::vector<std::vector<Output>> &seedSets, BlockHeight maxBlockHeight, bool taintFee, uint32_t threadCount = 0, bool showProgress = false);
+    std::vector<std::vector<std::pair<Output, SimpleTaint>>> BLOCKSCI_EXPORT getHaircutTaintedBatch(std::vector<std::vector<Output>> &seedSets, BlockHeight maxBlockHeight, bool taintFee, uint32_t threadCount = 0, bool showProgress = false);
 }}
 
 #endif /* taint_hpp */
@@ -10,8 +10,12 @@
 
 #include <blocksci/blocksci_export.h>
 #include <blocksci/chain/chain_fwd.hpp>
+#include <blocksci/core/tx_features.hpp>
 #include <blocksci/scripts/scripts_fwd.hpp>
 
+#include <cstddef>
+#include <cstdint>
+
 namespace blocksci {
     class DataAccess;
     namespace heuristics {
@@ -20,13 +24,32 @@ namespace blocksci {
         True, False, Timeout
     };
 
+    /** One input and two outputs, the shape of a single peeling chain transaction */
+    bool BLOCKSCI_EXPORT looksLikePeelingChain(const Transaction &tx);
     bool BLOCKSCI_EXPORT isPeelingChain(const Transaction &tx);
     bool BLOCKSCI_EXPORT isCoinjoin(const Transaction &tx);
+    /** The possible CoinJoin checks search for a split of the inputs that funds every participant
+     *
+     * maxDepth bounds the number of search states visited per call, 0 searches exhaustively. When the bound is hit
+     * the result is CoinJoinResult::Timeout, meaning undetermined. */
     CoinJoinResult BLOCKSCI_EXPORT isPossibleCoinjoin(const Transaction &tx, int64_t minBaseFee, double percentageFee, size_t maxDepth);
     CoinJoinResult BLOCKSCI_EXPORT isCoinjoinExtra(const Transaction &tx, int64_t minBaseFee, double percentageFee, size_t maxDepth);
     bool BLOCKSCI_EXPORT isDeanonTx(const Transaction &tx);
     bool BLOCKSCI_EXPORT containsKeysetChange(const Transaction &tx);
     bool BLOCKSCI_EXPORT isChangeOverTx(const Transaction &tx);
+    
+    /** Results of all classifiers above except isPeelingChain, taken from the tx feature table if it covers tx and
+     * was built with the same CoinJoin parameters */
+    TxFeatures BLOCKSCI_EXPORT getTxFeatures(const Transaction &tx, int64_t minBaseFee, double percentageFee, size_t maxDepth);
+    
+    /** Compute the TxFeatures of all transactions of the chain in parallel and store them in the tx feature table
+     *
+     * Once the table exists, isCoinjoin, isDeanonTx, isChangeOverTx and containsKeysetChange look up their result for
+     * the covered transactions, as do isPossibleCoinjoin and isCoinjoinExtra when called with the parameters the table
+     * was built with. A table with the same parameters is extended with the transactions added since it was built,
+     * otherwise it is rebuilt. isPeelingChain is left out since its result depends on later transactions.
+     */
+    void BLOCKSCI_EXPORT buildTxFeatureTable(Blockchain &chain, int64_t minBaseFee = 0, double percentageFee = 0.01, size_t maxDepth = 10000, uint32_t threadCount = 0, bool showProgress = false);
 }}
 
 
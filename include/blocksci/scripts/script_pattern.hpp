@@ -0,0 +1,98 @@
+//
+//  script_pattern.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_script_pattern_hpp
+#define blocksci_script_pattern_hpp
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/core/address_types.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace blocksci {
+    class DataAccess;
+
+    /** Opcode sequence with wildcards which whole scripts are matched against
+     *
+     * A pattern is a whitespace separated list of tokens, each matching one operation of the script:
+     *
+     * - An opcode name as printed by the script disassembler (OP_CHECKSIG, OP_CHECKLOCKTIMEVERIFY, 0, 16, ...), OP_0 to
+     *   OP_16 and OP_1NEGATE are accepted as well
+     * - 0xNN for the opcode with that byte value
+     * - PUSH for any data push, PUSH(n) for a push of exactly n bytes, PUSH(n-m) for a push of n to m bytes
+     * - <hex> for a push of exactly these bytes, eg. <6f7264> for the "ord" tag of an inscription envelope
+     * - ? for any single operation
+     * - * for any sequence of operations, including none
+     *
+     * The pattern has to match the whole script, so "* OP_CHECKLOCKTIMEVERIFY *" finds every script containing
+     * OP_CHECKLOCKTIMEVERIFY. Scripts which fail to decode never match. The pattern is compiled into a nondeterministic
+     * automaton with one state per token, which is simulated with a bit set of active states for every operation of
+     * the script.
+     */
+    class BLOCKSCI_EXPORT ScriptPattern {
+    public:
+        enum class TokenKind : uint8_t {
+            Opcode, Push, PushData, AnyOp, AnySequence
+        };
+
+        struct Token {
+            TokenKind kind;
+            uint8_t opcode;
+            uint32_t minLength;
+            uint32_t maxLength;
+            std::vector<unsigned char> data;
+        };
+
+        /** Maximum number of tokens of a pattern, the automaton state has to fit into 64 bits */
+        static constexpr size_t maxTokens = 63;
+
+        /** Throws std::invalid_argument if the pattern can't be parsed */
+        explicit ScriptPattern(const std::string &pattern);
+
+        bool matches(const unsigned char *begin, const unsigned char *end) const;
+
+        const std::vector<Token> &getTokens() const {
+            return tokens;
+        }
+
+    private:
+        std::vector<Token> tokens;
+
+        /** States which are reachable from state i without consuming an operation, because of * tokens */
+        std::vector<uint64_t> closures;
+
+        uint64_t closure(uint64_t states) const;
+    };
+
+    /** Which script of a nonstandard or witness unknown address is matched against a ScriptPattern */
+    enum class BLOCKSCI_EXPORT ScriptPatternTarget {
+        /** The output script, for witness unknown addresses the witness program */
+        Output,
+        /** The input script spending the address, for witness unknown addresses each item of the witness stack */
+        Spend
+    };
+
+    /** Addresses whose scripts matched a pattern, sorted by address number
+     *
+     * txNums[i] is the tx the script of scriptNums[i] first appeared in when matching output scripts and the tx first
+     * spending it when matching spend scripts. */
+    struct BLOCKSCI_EXPORT ScriptPatternMatches {
+        std::vector<uint32_t> scriptNums;
+        std::vector<uint32_t> txNums;
+    };
+
+    /** Match the scripts of all addresses of the type (NONSTANDARD or WITNESS_UNKNOWN) against the pattern on
+     * threadCount threads (0 for one per hardware thread)
+     *
+     * Reads the script data files directly, so no script objects are created. Throws std::invalid_argument for
+     * other address types. */
+    BLOCKSCI_EXPORT ScriptPatternMatches findScriptPattern(const ScriptPattern &pattern, AddressType::Enum type, ScriptPatternTarget target, DataAccess &access, uint32_t threadCount = 0);
+} // namespace blocksci
+
+#endif /* blocksci_script_pattern_hpp */
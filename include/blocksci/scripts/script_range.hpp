@@ -15,6 +15,9 @@
 #include <range/v3/view/iota.hpp>
 #include <range/v3/view/transform.hpp>
 
+#include <cstdint>
+#include <vector>
+
 // 
 
 namespace blocksci {
@@ -34,6 +37,38 @@ namespace blocksci {
     }
     
     ScriptRangeVariant BLOCKSCI_EXPORT scriptsRange(AddressType::Enum type, DataAccess &access);
+    
+    /** ScriptDataBase fields of every script storing one address type, element i belonging to script number i + 1 */
+    struct BLOCKSCI_EXPORT ScriptHeaderColumns {
+        std::vector<uint32_t> txFirstSeen;
+        std::vector<uint32_t> txFirstSpent;
+        std::vector<uint32_t> typesSeen;
+    };
+    
+    /** Copy the ScriptDataBase fields of all scripts storing the address type into columns
+     *
+     * Scripts covered by the header columns the parser writes are copied from those, the rest are read from the script
+     * file on threadCount threads (0 for one per hardware thread) without constructing a script for every element. */
+    ScriptHeaderColumns BLOCKSCI_EXPORT scriptHeaderColumns(AddressType::Enum type, DataAccess &access, uint32_t threadCount = 0);
+    
+    /** Pubkeys of all multisig scripts as flat columns
+     *
+     * Row i of the triples says that the multisig pubkey with script number pubkeyScriptNums[i] is at position
+     * positions[i] of the multisig with script number multisigScriptNums[i]. Rows are sorted by multisig script number
+     * and position. required and total hold m and n of every multisig, element i belonging to script number i + 1. */
+    struct BLOCKSCI_EXPORT MultisigPubkeyColumns {
+        std::vector<uint32_t> multisigScriptNums;
+        std::vector<uint8_t> positions;
+        std::vector<uint32_t> pubkeyScriptNums;
+        std::vector<uint8_t> required;
+        std::vector<uint8_t> total;
+    };
+    
+    /** Read the pubkey lists of all multisig scripts into columns on threadCount threads (0 for one per hardware thread)
+     *
+     * Every thread first counts the pubkeys of its segment of the multisig scripts, so each can then write its rows
+     * at the right offset without any further synchronization. */
+    MultisigPubkeyColumns BLOCKSCI_EXPORT multisigPubkeyColumns(DataAccess &access, uint32_t threadCount = 0);
 
     
 }
@@ -15,6 +15,7 @@
 #include "multisig_pubkey_script.hpp"
 #include "scripthash_script.hpp"
 #include "witness_unknown_script.hpp"
+#include "witness_taproot_script.hpp"
 
 #include <blocksci/blocksci_export.h>
 
@@ -98,6 +99,7 @@ namespace blocksci {
         }
         
         int64_t calculateBalance(BlockHeight height) const;
+        AddressStats getStats() const;
         ranges::any_view<Output> getOutputs() const;
         ranges::any_view<Input> getInputs() const;
         ranges::any_view<Transaction> getTransactions() const;
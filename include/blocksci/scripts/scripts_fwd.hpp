@@ -46,6 +46,7 @@ namespace blocksci {
         using OpReturn = ScriptAddress<AddressType::NULL_DATA>;
         using Nonstandard = ScriptAddress<AddressType::NONSTANDARD>;
         using WitnessUnknown = ScriptAddress<AddressType::WITNESS_UNKNOWN>;
+        using WitnessTaproot = ScriptAddress<AddressType::WITNESS_TAPROOT>;
     }
 } // namespace blocksci
 
@@ -0,0 +1,64 @@
+//
+//  witness_taproot_script.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+//
+
+#ifndef witness_taproot_script_hpp
+#define witness_taproot_script_hpp
+
+#include "script.hpp"
+
+#include <blocksci/blocksci_export.h>
+#include <blocksci/core/hash_combine.hpp>
+
+#include <string>
+
+namespace blocksci {
+    template <>
+    class BLOCKSCI_EXPORT ScriptAddress<AddressType::WITNESS_TAPROOT> : public ScriptBase {
+        const TaprootData *getBackingData() const {
+            return reinterpret_cast<const TaprootData *>(ScriptBase::getData());
+        }
+        
+    public:
+        constexpr static AddressType::Enum addressType = AddressType::WITNESS_TAPROOT;
+        
+        ScriptAddress(uint32_t addressNum_, const TaprootData *data_, DataAccess &access_) : ScriptBase(addressNum_, addressType, access_, data_) {}
+        ScriptAddress(uint32_t addressNum_, DataAccess &access_);
+        
+        /** The 32 byte x-only output key which the address string encodes */
+        uint256 getOutputKey() const {
+            return getBackingData()->outputKey;
+        }
+        
+        uint256 getAddressHash() const {
+            return getOutputKey();
+        }
+        
+        /** How the first spend of the address was made, TaprootSpendType::Unspent if it hasn't been spent */
+        TaprootSpendType getSpendType() const {
+            return getBackingData()->spendType;
+        }
+        
+        std::string addressString() const;
+        
+        std::string toString() const;
+        
+        std::string toPrettyString() const;
+    };
+} // namespace blocksci
+
+namespace std {
+    template<> struct BLOCKSCI_EXPORT hash<blocksci::ScriptAddress<blocksci::AddressType::WITNESS_TAPROOT>> {
+        size_t operator()(const blocksci::ScriptAddress<blocksci::AddressType::WITNESS_TAPROOT> &address) const {
+            std::size_t seed = 9245731;
+            blocksci::hash_combine(seed, static_cast<const blocksci::ScriptBase &>(address));
+            return seed;
+        }
+    };
+} // namespace std
+
+#endif /* witness_taproot_script_hpp */
@@ -12,8 +12,10 @@
 #include <blocksci/address/equiv_address.hpp>
 #include <blocksci/chain/algorithms.hpp>
 #include <blocksci/chain/range_util.hpp>
+#include <blocksci/core/raw_transaction.hpp>
 #include <blocksci/scripts/script_variant.hpp>
 
+#include <scripts/address_encoder.hpp>
 #include <scripts/bitcoin_base58.hpp>
 #include <scripts/bitcoin_segwit_addr.hpp>
 
@@ -23,13 +25,18 @@
 #include <internal/script_access.hpp>
 #include <internal/address_index.hpp>
 #include <internal/hash_index.hpp>
+#include <internal/segment_work.hpp>
 
 #include <range/v3/view/transform.hpp>
 #include <range/v3/view/unique.hpp>
 #include <range/v3/algorithm/min.hpp>
+#include <range/v3/range/conversion.hpp>
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
 
 namespace blocksci {
     
@@ -57,23 +64,58 @@ namespace blocksci {
         | ranges::views::transform([_access](uint32_t txNum) { return Transaction(txNum, _access->getChain().getBlockHeight(txNum), *_access); });
     }
     
+    namespace {
+        bool belongsTo(const Inout &inout, const Address &address) {
+            return inout.getAddressNum() == address.scriptNum && inout.getType() == address.type;
+        }
+        
+        /** Whether the output is the first output of its tx sent to the address, compared on the raw tx data */
+        bool isFirstOutputOf(const OutputPointer &pointer, const Address &address, const ChainAccess &chain) {
+            auto rawTx = chain.getTx(pointer.txNum);
+            for (uint16_t i = 0; i < pointer.inoutNum; i++) {
+                if (belongsTo(rawTx->getOutput(i), address)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        
+        /** Whether the input is the first input of its tx spending from the address */
+        bool isFirstInputOf(const InputPointer &pointer, const Address &address, const ChainAccess &chain) {
+            auto rawTx = chain.getTx(pointer.txNum);
+            for (uint16_t i = 0; i < pointer.inoutNum; i++) {
+                if (belongsTo(rawTx->getInput(i), address)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        
+        bool hasOutputTo(uint32_t txNum, const Address &address, const ChainAccess &chain) {
+            auto rawTx = chain.getTx(txNum);
+            for (uint16_t i = 0; i < rawTx->outputCount; i++) {
+                if (belongsTo(rawTx->getOutput(i), address)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        
+        Transaction txWithNum(uint32_t txNum, DataAccess &access) {
+            return Transaction(txNum, access.getChain().getBlockHeight(txNum), access);
+        }
+    }
+    
+    /** Spending input positions come from output_spending_input.dat (or a search of the spending tx), so only the
+     * inputs before it are compared to keep each spending tx once */
     ranges::any_view<Transaction> Address::getInputTransactions() const {
         auto _access = access;
         Address searchAddress = *this;
         return getOutputPointers()
-        | ranges::views::transform([_access, searchAddress](auto pointer) -> ranges::optional<Transaction> {
-            auto spendingTx = Output(std::forward<decltype(pointer)>(pointer), *_access).getSpendingTx();
-            if (spendingTx) {
-                RANGES_FOR(auto input, spendingTx->inputs()) {
-                    if (input.getAddress() == searchAddress) {
-                        if (input.getSpentOutputPointer() == pointer) {
-                            return input.transaction();
-                        } else {
-                            return ranges::nullopt;
-                        }
-                    }
-                }
-                assert(false);
+        | ranges::views::transform([_access, searchAddress](const OutputPointer &pointer) -> ranges::optional<Transaction> {
+            auto spendingInput = Output(pointer, *_access).getSpendingInputPointer();
+            if (spendingInput && isFirstInputOf(*spendingInput, searchAddress, _access->getChain())) {
+                return txWithNum(spendingInput->txNum, *_access);
             } else {
                 return ranges::nullopt;
             }
@@ -81,6 +123,31 @@ namespace blocksci {
         | flatMapOptionals();
     }
     
+    AddressHistory Address::getHistory() const {
+        AddressHistory history;
+        history.outputs = getOutputPointers() | ranges::to_vector;
+        std::sort(history.outputs.begin(), history.outputs.end());
+        history.inputs.reserve(history.outputs.size());
+        for (auto &pointer : history.outputs) {
+            auto spendingInput = Output(pointer, *access).getSpendingInputPointer();
+            if (spendingInput) {
+                history.inputs.push_back(*spendingInput);
+            }
+        }
+        std::sort(history.inputs.begin(), history.inputs.end());
+        
+        history.txNums.reserve(history.outputs.size() + history.inputs.size());
+        for (auto &pointer : history.outputs) {
+            history.txNums.push_back(pointer.txNum);
+        }
+        for (auto &pointer : history.inputs) {
+            history.txNums.push_back(pointer.txNum);
+        }
+        std::sort(history.txNums.begin(), history.txNums.end());
+        history.txNums.erase(std::unique(history.txNums.begin(), history.txNums.end()), history.txNums.end());
+        return history;
+    }
+    
     class AddressAllTxRange : public ranges::view_facade<AddressAllTxRange> {
         friend ranges::range_access;
         using PointerView = ranges::any_view<OutputPointer>;
@@ -101,37 +168,18 @@ namespace blocksci {
             
             bool initializeFromCurrentOutput() {
                 auto pointer = *it;
-                Output out(pointer, *access);
-                auto tx = out.transaction();
-                RANGES_FOR(auto output, tx.outputs()) {
-                    if (output.getAddress() == searchAddress) {
-                        if (output.pointer == pointer) {
-                            outTx = tx;
-                        } else {
-                            outTx = ranges::nullopt;
-                        }
-                        break;
-                    }
+                auto &chain = access->getChain();
+                if (isFirstOutputOf(pointer, searchAddress, chain)) {
+                    outTx = txWithNum(pointer.txNum, *access);
+                } else {
+                    outTx = ranges::nullopt;
                 }
                 
-                inTx = out.getSpendingTx();
-                if (inTx) {
-                    RANGES_FOR(auto output, inTx->outputs()) {
-                        if (output.getAddress() == searchAddress) {
-                            inTx = ranges::nullopt;
-                            break;
-                        }
-                    }
-                }
-                if (inTx) {
-                    RANGES_FOR(auto input, inTx->inputs()) {
-                        if (input.getAddress() == searchAddress) {
-                            if (input.getSpentOutputPointer() != pointer) {
-                                inTx = ranges::nullopt;
-                            }
-                            break;
-                        }
-                    }
+                // A spending tx that also sends to the address is already listed by that output
+                inTx = ranges::nullopt;
+                auto spendingInput = Output(pointer, *access).getSpendingInputPointer();
+                if (spendingInput && !hasOutputTo(spendingInput->txNum, searchAddress, chain) && isFirstInputOf(*spendingInput, searchAddress, chain)) {
+                    inTx = txWithNum(spendingInput->txNum, *access);
                 }
                 
                 return inTx.has_value() || outTx.has_value();
@@ -207,6 +255,10 @@ namespace blocksci {
         return blocksci::isSpendable(dedupType(type));
     }
     
+    uint32_t Address::getFirstTxIndex() const {
+        return access->getScripts().getFirstTxIndex(scriptNum, dedupType(type));
+    }
+    
     std::string Address::toString() const {
         if (scriptNum == 0) {
             return "InvalidAddress()";
@@ -233,44 +285,146 @@ namespace blocksci {
         return ScriptBase(*this);
     }
     
-    ranges::optional<Address> getAddressFromString(const std::string &addressString, DataAccess &access) {
-        if (addressString.compare(0, access.config.chainConfig.segwitPrefix.size(), access.config.chainConfig.segwitPrefix) == 0) {
-            std::pair<int, std::vector<uint8_t> > decoded = segwit_addr::decode(access.config.chainConfig.segwitPrefix, addressString);
-            if (decoded.first == 0) {
-                if (decoded.second.size() == 20) {
-                    uint160 pubkeyHash(decoded.second.begin(), decoded.second.end());
-                    ranges::optional<uint32_t> addressNum = access.getHashIndex().getPubkeyHashIndex(pubkeyHash);
-                    if (addressNum) {
-                        return Address{*addressNum, AddressType::WITNESS_PUBKEYHASH, access};
-                    }
-                } else if (decoded.second.size() == 32) {
-                    uint256 scriptHash(decoded.second.begin(), decoded.second.end());
-                    ranges::optional<uint32_t> addressNum = access.getHashIndex().getScriptHashIndex(scriptHash);
-                    if (addressNum) {
-                        return Address{*addressNum, AddressType::WITNESS_SCRIPTHASH, access};
+    namespace {
+        /** Hash index key of an address string, hash160 is used unless type is WITNESS_SCRIPTHASH or WITNESS_TAPROOT */
+        struct DecodedAddressString {
+            AddressType::Enum type;
+            uint160 hash160;
+            uint256 hash256;
+        };
+        
+        ranges::optional<DecodedAddressString> decodeAddressString(const std::string &addressString, DataAccess &access) {
+            if (addressString.compare(0, access.config.chainConfig.segwitPrefix.size(), access.config.chainConfig.segwitPrefix) == 0) {
+                std::pair<int, std::vector<uint8_t> > decoded = segwit_addr::decode(access.config.chainConfig.segwitPrefix, addressString);
+                if (decoded.first == 0) {
+                    if (decoded.second.size() == 20) {
+                        return DecodedAddressString{AddressType::WITNESS_PUBKEYHASH, uint160(decoded.second.begin(), decoded.second.end()), uint256{}};
+                    } else if (decoded.second.size() == 32) {
+                        return DecodedAddressString{AddressType::WITNESS_SCRIPTHASH, uint160{}, uint256(decoded.second.begin(), decoded.second.end())};
                     }
+                } else if (decoded.first == 1 && decoded.second.size() == 32) {
+                    return DecodedAddressString{AddressType::WITNESS_TAPROOT, uint160{}, uint256(decoded.second.begin(), decoded.second.end())};
                 }
+                return ranges::nullopt;
+            }
+            unsigned int nVersionBytes = access.config.chainConfig.pubkeyPrefix.size();
+            CBitcoinAddress address{addressString, nVersionBytes};
+            uint160 hash;
+            blocksci::AddressType::Enum type;
+            std::tie(hash, type) = address.Get(access.config.chainConfig);
+            if (type == AddressType::Enum::PUBKEYHASH || type == AddressType::Enum::SCRIPTHASH) {
+                return DecodedAddressString{type, hash, uint256{}};
             }
             return ranges::nullopt;
         }
-        unsigned int nVersionBytes = access.config.chainConfig.pubkeyPrefix.size();
-        CBitcoinAddress address{addressString, nVersionBytes};
-        uint160 hash;
-        blocksci::AddressType::Enum type;
-        std::tie(hash, type) = address.Get(access.config.chainConfig);
+    }
+    
+    ranges::optional<Address> getAddressFromString(const std::string &addressString, DataAccess &access) {
+        auto decoded = decodeAddressString(addressString, access);
+        if (!decoded) {
+            return ranges::nullopt;
+        }
         ranges::optional<uint32_t> addressNum = ranges::nullopt;
-        if (type == AddressType::Enum::PUBKEYHASH) {
-            addressNum = access.getHashIndex().getPubkeyHashIndex(hash);
-        } else if (type == AddressType::Enum::SCRIPTHASH) {
-            addressNum = access.getHashIndex().getScriptHashIndex(hash);
+        switch (decoded->type) {
+            case AddressType::Enum::PUBKEYHASH:
+            case AddressType::Enum::WITNESS_PUBKEYHASH:
+                addressNum = access.getHashIndex().getPubkeyHashIndex(decoded->hash160);
+                break;
+            case AddressType::Enum::SCRIPTHASH:
+                addressNum = access.getHashIndex().getScriptHashIndex(decoded->hash160);
+                break;
+            case AddressType::Enum::WITNESS_TAPROOT:
+                addressNum = access.getHashIndex().getTaprootIndex(decoded->hash256);
+                break;
+            default:
+                addressNum = access.getHashIndex().getScriptHashIndex(decoded->hash256);
+                break;
         }
         if (addressNum) {
-            return Address{*addressNum, type, access};
+            return Address{*addressNum, decoded->type, access};
         } else {
             return ranges::nullopt;
         }
     }
     
+    namespace {
+        /** Hash index matches of keys, split over threadCount threads each issuing its own MultiGet batches */
+        template <AddressType::Enum type, typename Key>
+        std::vector<ranges::optional<uint32_t>> lookupAddressesParallel(HashIndex &hashIndex, const std::vector<Key> &keys, uint32_t threadCount) {
+            auto segments = splitSegments(0, static_cast<uint32_t>(keys.size()), threadCount);
+            std::vector<std::vector<ranges::optional<uint32_t>>> segmentMatches(segments.size());
+            runSegments(segments, [&](uint32_t segmentNum, uint32_t segmentStart, uint32_t segmentEnd) {
+                segmentMatches[segmentNum] = hashIndex.lookupAddresses<type>(std::vector<Key>(keys.begin() + segmentStart, keys.begin() + segmentEnd));
+            });
+            std::vector<ranges::optional<uint32_t>> matches;
+            matches.reserve(keys.size());
+            for (auto &segment : segmentMatches) {
+                matches.insert(matches.end(), segment.begin(), segment.end());
+            }
+            return matches;
+        }
+    }
+    
+    std::vector<ranges::optional<Address>> getAddressesFromStrings(const std::vector<std::string> &addressStrings, DataAccess &access, uint32_t threadCount) {
+        threadCount = resolveThreadCount(threadCount);
+        std::vector<ranges::optional<DecodedAddressString>> decodedStrings(addressStrings.size());
+        segmentWork(0, static_cast<uint32_t>(addressStrings.size()), threadCount, [&](uint32_t i) {
+            decodedStrings[i] = decodeAddressString(addressStrings[i], access);
+        });
+        
+        // Gather the keys of every hash index column to look them up in batches
+        std::vector<uint160> pubkeyHashes;
+        std::vector<uint160> scriptHashes;
+        std::vector<uint256> witnessScriptHashes;
+        std::vector<uint256> taprootKeys;
+        std::vector<size_t> pubkeyHashPositions;
+        std::vector<size_t> scriptHashPositions;
+        std::vector<size_t> witnessScriptHashPositions;
+        std::vector<size_t> taprootKeyPositions;
+        std::vector<AddressType::Enum> types(addressStrings.size());
+        for (size_t i = 0; i < addressStrings.size(); i++) {
+            auto &decoded = decodedStrings[i];
+            if (!decoded) {
+                continue;
+            }
+            types[i] = decoded->type;
+            switch (decoded->type) {
+                case AddressType::Enum::PUBKEYHASH:
+                case AddressType::Enum::WITNESS_PUBKEYHASH:
+                    pubkeyHashes.push_back(decoded->hash160);
+                    pubkeyHashPositions.push_back(i);
+                    break;
+                case AddressType::Enum::SCRIPTHASH:
+                    scriptHashes.push_back(decoded->hash160);
+                    scriptHashPositions.push_back(i);
+                    break;
+                case AddressType::Enum::WITNESS_TAPROOT:
+                    taprootKeys.push_back(decoded->hash256);
+                    taprootKeyPositions.push_back(i);
+                    break;
+                default:
+                    witnessScriptHashes.push_back(decoded->hash256);
+                    witnessScriptHashPositions.push_back(i);
+                    break;
+            }
+        }
+        
+        std::vector<ranges::optional<Address>> addresses(addressStrings.size());
+        auto fill = [&](const std::vector<ranges::optional<uint32_t>> &addressNums, const std::vector<size_t> &positions) {
+            for (size_t i = 0; i < positions.size(); i++) {
+                if (addressNums[i]) {
+                    addresses[positions[i]] = Address{*addressNums[i], types[positions[i]], access};
+                }
+            }
+        };
+        auto &hashIndex = access.getHashIndex();
+        fill(lookupAddressesParallel<AddressType::PUBKEYHASH>(hashIndex, pubkeyHashes, threadCount), pubkeyHashPositions);
+        fill(lookupAddressesParallel<AddressType::SCRIPTHASH>(hashIndex, scriptHashes, threadCount), scriptHashPositions);
+        fill(lookupAddressesParallel<AddressType::WITNESS_SCRIPTHASH>(hashIndex, witnessScriptHashes, threadCount), witnessScriptHashPositions);
+        fill(lookupAddressesParallel<AddressType::WITNESS_TAPROOT>(hashIndex, taprootKeys, threadCount), taprootKeyPositions);
+        return addresses;
+    }
+    
     template<AddressType::Enum type>
     std::vector<Address> getAddressesWithPrefixImp(const std::string &prefix, DataAccess &access) {
         std::vector<Address> addresses;
@@ -320,6 +474,20 @@ namespace blocksci {
             case DedupAddressType::WITNESS_UNKNOWN: {
                 break;
             }
+            case DedupAddressType::WITNESS_TAPROOT: {
+                auto script = script::WitnessTaproot(address.scriptNum, access);
+                switch (script.getSpendType()) {
+                    case TaprootSpendType::KeyPath:
+                        ss << "/keypath";
+                        break;
+                    case TaprootSpendType::ScriptPath:
+                        ss << "/scriptpath";
+                        break;
+                    case TaprootSpendType::Unspent:
+                        break;
+                }
+                break;
+            }
             case DedupAddressType::NULL_DATA: {
                 break;
             }
@@ -345,5 +513,116 @@ namespace blocksci {
     int64_t Address::calculateBalance(BlockHeight height) const {
         return balance(height, outputs(getOutputPointers(), *access));
     }
+    
+    std::vector<int64_t> calculateBalances(const std::vector<Address> &addresses, BlockHeight height, uint32_t threadCount) {
+        std::vector<int64_t> balances(addresses.size());
+        segmentWork(0, static_cast<uint32_t>(addresses.size()), resolveThreadCount(threadCount), [&](uint32_t i) {
+            balances[i] = addresses[i].calculateBalance(height);
+        });
+        return balances;
+    }
+    
+    namespace {
+        /** Number of addresses whose hashes are gathered before running the bulk encoders */
+        constexpr uint32_t addressStringBatchSize = 1024;
+        
+        size_t base58StringLength(size_t versionSize) {
+            if (versionSize == 1) {
+                return base58AddressLength;
+            }
+            // log(256) / log(58), rounded up
+            return (versionSize + sizeof(uint160) + 4) * 138 / 100 + 1;
+        }
+        
+        /** Append the hash encoded in the address string of the address */
+        void appendAddressHash(AddressType::Enum type, uint32_t scriptNum, const ScriptAccess &scripts, std::vector<unsigned char> &out) {
+            auto append = [&](const auto &hash) {
+                auto bytes = reinterpret_cast<const unsigned char *>(&hash);
+                out.insert(out.end(), bytes, bytes + sizeof(hash));
+            };
+            if (dedupType(type) == DedupAddressType::PUBKEY) {
+                auto data = scripts.getScriptData<DedupAddressType::PUBKEY>(scriptNum);
+                if (data->hasPubkey) {
+                    append(CPubKey{data->pubkey.begin(), data->pubkey.end()}.GetID());
+                } else {
+                    append(data->address);
+                }
+            } else if (type == AddressType::Enum::WITNESS_SCRIPTHASH) {
+                append(scripts.getScriptData<DedupAddressType::SCRIPTHASH>(scriptNum)->hash256);
+            } else if (type == AddressType::Enum::WITNESS_TAPROOT) {
+                append(scripts.getScriptData<DedupAddressType::WITNESS_TAPROOT>(scriptNum)->outputKey);
+            } else {
+                append(scripts.getScriptData<DedupAddressType::SCRIPTHASH>(scriptNum)->hash160);
+            }
+        }
+    }
+    
+    size_t addressStringLength(AddressType::Enum type, DataAccess &access) {
+        auto &config = access.config.chainConfig;
+        switch (type) {
+            case AddressType::Enum::PUBKEY:
+            case AddressType::Enum::PUBKEYHASH:
+            case AddressType::Enum::MULTISIG_PUBKEY:
+                return base58StringLength(config.pubkeyPrefix.size());
+            case AddressType::Enum::SCRIPTHASH:
+                return base58StringLength(config.scriptPrefix.size());
+            case AddressType::Enum::WITNESS_PUBKEYHASH:
+                return segwitAddressLength(config.segwitPrefix, sizeof(uint160));
+            case AddressType::Enum::WITNESS_SCRIPTHASH:
+            case AddressType::Enum::WITNESS_TAPROOT:
+                return segwitAddressLength(config.segwitPrefix, sizeof(uint256));
+            default:
+                return 0;
+        }
+    }
+    
+    void addressStrings(AddressType::Enum type, uint32_t start, uint32_t end, char *out, size_t width, DataAccess &access, uint32_t threadCount) {
+        if (addressStringLength(type, access) == 0) {
+            throw std::invalid_argument(addressName(type) + " addresses have no address string");
+        }
+        auto &config = access.config.chainConfig;
+        auto &scripts = access.getScripts();
+        start = std::max(start, 1u);
+        end = std::min(end, scripts.scriptCount(dedupType(type)) + 1);
+        if (start >= end) {
+            return;
+        }
+        
+        bool isSegwit = type == AddressType::Enum::WITNESS_PUBKEYHASH || type == AddressType::Enum::WITNESS_SCRIPTHASH || type == AddressType::Enum::WITNESS_TAPROOT;
+        uint8_t witnessVersion = type == AddressType::Enum::WITNESS_TAPROOT ? 1 : 0;
+        size_t programSize = type == AddressType::Enum::WITNESS_PUBKEYHASH ? sizeof(uint160) : sizeof(uint256);
+        const auto &version = type == AddressType::Enum::SCRIPTHASH ? config.scriptPrefix : config.pubkeyPrefix;
+        runSegments(splitSegments(start, end, resolveThreadCount(threadCount)), [&](uint32_t, uint32_t segmentStart, uint32_t segmentEnd) {
+            std::vector<unsigned char> payloads;
+            for (uint32_t batchStart = segmentStart; batchStart < segmentEnd; batchStart += addressStringBatchSize) {
+                auto batchEnd = std::min(batchStart + addressStringBatchSize, segmentEnd);
+                payloads.clear();
+                for (uint32_t scriptNum = batchStart; scriptNum < batchEnd; scriptNum++) {
+                    if (!isSegwit) {
+                        payloads.insert(payloads.end(), version.begin(), version.end());
+                    }
+                    appendAddressHash(type, scriptNum, scripts, payloads);
+                }
+                
+                auto batchOut = out + width * (batchStart - start);
+                size_t count = batchEnd - batchStart;
+                if (isSegwit) {
+                    encodeSegwitBatch(config.segwitPrefix, witnessVersion, payloads.data(), programSize, count, batchOut, width);
+                } else if (version.size() == 1) {
+                    encodeBase58CheckBatch(payloads.data(), count, batchOut, width);
+                } else {
+                    // The bulk encoder only handles single byte versions
+                    auto payloadSize = version.size() + sizeof(uint160);
+                    for (size_t i = 0; i < count; i++) {
+                        auto payload = payloads.begin() + static_cast<int64_t>(payloadSize * i);
+                        auto str = EncodeBase58Check(std::vector<unsigned char>(payload, payload + static_cast<int64_t>(payloadSize)));
+                        auto length = std::min(str.size(), width);
+                        std::memcpy(batchOut + width * i, str.data(), length);
+                        std::fill(batchOut + width * i + length, batchOut + width * (i + 1), '\0');
+                    }
+                }
+            }
+        });
+    }
 }
 
@@ -0,0 +1,117 @@
+//
+//  address_stats.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include <blocksci/address/address_stats.hpp>
+
+#include <internal/data_access.hpp>
+#include <internal/script_access.hpp>
+#include <internal/segment_work.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+namespace blocksci {
+    namespace {
+        int64_t statsValue(const AddressStats &stats, AddressStatsField field) {
+            switch (field) {
+                case AddressStatsField::Balance: return stats.balance();
+                case AddressStatsField::Received: return stats.received;
+                case AddressStatsField::Sent: return stats.sent;
+                case AddressStatsField::OutputCount: return static_cast<int64_t>(stats.outputCount);
+            }
+            return 0;
+        }
+
+        void checkAddressStats(const ScriptAccess &scripts) {
+            if (scripts.addressStatsTxCount() == 0) {
+                throw std::runtime_error("Address stats have not been built, run blocksci_parser build-address-stats");
+            }
+        }
+
+        /** (value, type, scriptNum) ordered such that std::greater keeps the largest values on top of a min heap */
+        using RankedAddress = std::tuple<int64_t, AddressType::Enum, uint32_t>;
+    }
+
+    AddressStats Address::getStats() const {
+        auto &scripts = access->getScripts();
+        checkAddressStats(scripts);
+        auto column = scripts.getAddressStats(type);
+        if (scriptNum == 0 || scriptNum > column.count) {
+            throw std::runtime_error("Address stats do not cover " + toString() + ", run blocksci_parser update");
+        }
+        return column.data[scriptNum - 1];
+    }
+
+    bool hasAddressStats(DataAccess &access) {
+        return access.getScripts().addressStatsTxCount() > 0;
+    }
+
+    uint32_t addressStatsTxCount(DataAccess &access) {
+        return access.getScripts().addressStatsTxCount();
+    }
+
+    AddressStatsColumn addressStatsColumn(AddressType::Enum type, DataAccess &access) {
+        auto &scripts = access.getScripts();
+        checkAddressStats(scripts);
+        return scripts.getAddressStats(type);
+    }
+
+    std::vector<std::pair<Address, int64_t>> topAddresses(DataAccess &access, AddressStatsField field, size_t k, const std::vector<AddressType::Enum> &types) {
+        auto &scripts = access.getScripts();
+        checkAddressStats(scripts);
+        std::vector<AddressType::Enum> searchTypes = types;
+        if (searchTypes.empty()) {
+            for (size_t i = 0; i < AddressType::size; i++) {
+                searchTypes.push_back(static_cast<AddressType::Enum>(i));
+            }
+        }
+
+        std::vector<RankedAddress> best;
+        if (k == 0) {
+            return {};
+        }
+        auto offer = [k](std::vector<RankedAddress> &heap, RankedAddress candidate) {
+            if (heap.size() < k) {
+                heap.push_back(candidate);
+                std::push_heap(heap.begin(), heap.end(), std::greater<>{});
+            } else if (std::get<0>(candidate) > std::get<0>(heap.front())) {
+                std::pop_heap(heap.begin(), heap.end(), std::greater<>{});
+                heap.back() = candidate;
+                std::push_heap(heap.begin(), heap.end(), std::greater<>{});
+            }
+        };
+        for (auto type : searchTypes) {
+            auto column = scripts.getAddressStats(type);
+            auto segments = splitSegments(0, column.count, resolveThreadCount(0));
+            std::vector<std::vector<RankedAddress>> segmentBest(segments.size());
+            runSegments(segments, [&](uint32_t segmentNum, uint32_t segmentStart, uint32_t segmentEnd) {
+                auto &heap = segmentBest[segmentNum];
+                for (uint32_t i = segmentStart; i < segmentEnd; i++) {
+                    if (column.data[i].outputCount > 0) {
+                        offer(heap, RankedAddress{statsValue(column.data[i], field), type, i + 1});
+                    }
+                }
+            });
+            for (auto &heap : segmentBest) {
+                for (auto &candidate : heap) {
+                    offer(best, candidate);
+                }
+            }
+        }
+
+        std::sort(best.begin(), best.end(), std::greater<>{});
+        std::vector<std::pair<Address, int64_t>> ranked;
+        ranked.reserve(best.size());
+        for (auto &candidate : best) {
+            ranked.emplace_back(Address{std::get<2>(candidate), std::get<1>(candidate), access}, std::get<0>(candidate));
+        }
+        return ranked;
+    }
+} // namespace blocksci
@@ -48,11 +48,20 @@ namespace {
     /**
      Returns addresses that are equivalent (i.e., use the same public key)
      @param scriptEquivalent whether nested addresses should be returned for script-hash addresses
+     
+     The script equivalent addresses are read from the equivalence class columns written by the parser if they cover the
+     address, otherwise they are collected through the address index.
      */
     std::unordered_set<Address> initAddresses(const DedupAddress &dedup, bool scriptEquivalent, DataAccess &access) {
         std::unordered_set<DedupAddress> equiv;
         equiv.insert(dedup);
+        ranges::optional<std::pair<const DedupAddress *, const DedupAddress *>> equivClass;
         if (scriptEquivalent) {
+            equivClass = access.getScripts().getEquivClass(dedup);
+        }
+        if (equivClass) {
+            equiv.insert(equivClass->first, equivClass->second);
+        } else if (scriptEquivalent) {
             std::vector<DedupAddress> nestedEquiv = getScriptNestedEquivalents(dedup, access);
             for (const auto &address : nestedEquiv) {
                 for (auto equivType : equivAddressTypes(address.type)) {
@@ -64,9 +73,9 @@ namespace {
         
         std::unordered_set<Address> addresses;
         for (const auto &address : equiv) {
-            auto header = access.getScripts().getScriptHeader(address.scriptNum, address.type);
+            auto typesSeen = access.getScripts().getTypesSeen(address.scriptNum, address.type);
             for (auto equivType : equivAddressTypes(address.type)) {
-                if (header->seen(equivType)) {
+                if (ScriptDataBase::seen(typesSeen, equivType)) {
                     addresses.emplace(address.scriptNum, equivType, access);
                 }
             }
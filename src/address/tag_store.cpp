@@ -0,0 +1,396 @@
+//
+//  tag_store.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include <blocksci/address/tag_store.hpp>
+#include <blocksci/chain/block_range.hpp>
+#include <blocksci/chain/output_columns.hpp>
+
+#include <internal/segment_work.hpp>
+
+#include <mio/mmap.hpp>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+
+namespace blocksci {
+    /** Start of a tag store file, followed by the scriptNum, tag id and name order columns, the name offsets aligned to
+     * 8 bytes and the concatenated names */
+    struct TagStoreHeader {
+        static constexpr uint64_t expectedMagic = 0x45524f5453474154ULL; // "TAGSTORE"
+        static constexpr uint32_t expectedVersion = 1;
+
+        uint64_t magic;
+        uint32_t version;
+        uint32_t tagCount;
+        uint64_t entryCount;
+        uint64_t nameBytes;
+        uint64_t typeStarts[AddressType::size + 1];
+    };
+
+    namespace {
+        uint64_t alignedOffsetsStart(uint64_t entryCount, uint32_t tagCount) {
+            auto end = sizeof(TagStoreHeader) + sizeof(uint32_t) * (2 * entryCount + tagCount);
+            return (end + 7) / 8 * 8;
+        }
+
+        uint64_t addressKey(uint32_t scriptNum, AddressType::Enum type) {
+            return (uint64_t{static_cast<uint8_t>(type)} << 32) | scriptNum;
+        }
+
+        template <typename T>
+        void writeArray(std::ofstream &file, const std::vector<T> &data) {
+            file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(sizeof(T) * data.size()));
+        }
+
+        /** Exclusive lock on path.lock serializing the appends of all processes */
+        class AppendLock {
+            int fd;
+        public:
+            explicit AppendLock(const std::string &path) : fd(::open((path + ".lock").c_str(), O_RDWR | O_CREAT, 0644)) {
+                if (fd < 0) {
+                    throw std::runtime_error("Could not open the lock file of the tag store " + path);
+                }
+                if (flock(fd, LOCK_EX) != 0) {
+                    ::close(fd);
+                    throw std::runtime_error("Could not lock the tag store " + path);
+                }
+            }
+
+            AppendLock(const AppendLock &) = delete;
+            AppendLock &operator=(const AppendLock &) = delete;
+
+            ~AppendLock() {
+                flock(fd, LOCK_UN);
+                ::close(fd);
+            }
+        };
+
+        bool fileExists(const std::string &path) {
+            return ::access(path.c_str(), F_OK) == 0;
+        }
+    } // namespace
+
+    constexpr uint32_t TagStore::NoTag;
+
+    TagStore::TagStore(const std::string &path) {
+        std::error_code error;
+        auto file = std::make_shared<mio::mmap_source>();
+        file->map(path, error);
+        if (error || file->size() < sizeof(TagStoreHeader)) {
+            throw std::runtime_error("Could not open tag store " + path);
+        }
+        auto base = file->data();
+        header = reinterpret_cast<const TagStoreHeader *>(base);
+        if (header->magic != TagStoreHeader::expectedMagic || header->version != TagStoreHeader::expectedVersion) {
+            throw std::runtime_error(path + " is not a tag store of this version of BlockSci");
+        }
+        auto offsetsStart = alignedOffsetsStart(header->entryCount, header->tagCount);
+        auto expectedSize = offsetsStart + sizeof(uint64_t) * (uint64_t{header->tagCount} + 1) + header->nameBytes;
+        if (file->size() != expectedSize || header->typeStarts[AddressType::size] != header->entryCount) {
+            throw std::runtime_error("Tag store " + path + " is truncated");
+        }
+        scriptNumData = reinterpret_cast<const uint32_t *>(header + 1);
+        tagIdData = scriptNumData + header->entryCount;
+        nameOrder = tagIdData + header->entryCount;
+        nameOffsets = reinterpret_cast<const uint64_t *>(base + offsetsStart);
+        names = reinterpret_cast<const char *>(nameOffsets + header->tagCount + 1);
+        mapping = std::move(file);
+    }
+
+    TagStore TagStore::append(const std::string &path, const std::vector<RawAddress> &addresses, const std::vector<std::string> &tags) {
+        if (addresses.size() != tags.size()) {
+            throw std::invalid_argument("Every address needs exactly one tag");
+        }
+        AppendLock lock{path};
+        TagStore existing;
+        if (fileExists(path)) {
+            existing = TagStore{path};
+        }
+
+        // Intern the new names after the existing ones
+        std::vector<std::string> newNames;
+        std::unordered_map<std::string, uint32_t> nameIds;
+        nameIds.reserve(existing.tagCount() + tags.size());
+        for (uint32_t i = 0; i < existing.tagCount(); i++) {
+            nameIds.emplace(existing.tagName(i), i);
+        }
+        std::vector<std::pair<uint64_t, uint32_t>> added;
+        added.reserve(addresses.size());
+        for (size_t i = 0; i < addresses.size(); i++) {
+            if (static_cast<size_t>(addresses[i].type) >= AddressType::size) {
+                throw std::invalid_argument("Invalid address type at position " + std::to_string(i));
+            }
+            auto it = nameIds.emplace(tags[i], existing.tagCount() + static_cast<uint32_t>(newNames.size())).first;
+            if (it->second >= existing.tagCount() + newNames.size()) {
+                newNames.push_back(tags[i]);
+            }
+            added.emplace_back(addressKey(addresses[i].scriptNum, addresses[i].type), it->second);
+        }
+        if (static_cast<uint64_t>(existing.tagCount()) + newNames.size() >= NoTag) {
+            throw std::runtime_error("Tag store " + path + " would hold too many distinct tags");
+        }
+        // The stable sort keeps the order of the tags of each address, so the last one is kept below
+        std::stable_sort(added.begin(), added.end(), [](const std::pair<uint64_t, uint32_t> &a, const std::pair<uint64_t, uint32_t> &b) {
+            return a.first < b.first;
+        });
+
+        // Merge the existing columns with the new tags, which replace the existing tags of their addresses
+        std::vector<uint32_t> scriptNums;
+        std::vector<uint32_t> tagIds;
+        std::vector<uint64_t> typeStarts(AddressType::size + 1, 0);
+        scriptNums.reserve(existing.size() + added.size());
+        tagIds.reserve(existing.size() + added.size());
+        auto push = [&](uint64_t key, uint32_t tagId) {
+            scriptNums.push_back(static_cast<uint32_t>(key));
+            tagIds.push_back(tagId);
+            typeStarts[(key >> 32) + 1]++;
+        };
+        uint64_t existingPos = 0;
+        size_t type = 0;
+        auto existingKey = [&](uint64_t pos) {
+            while (pos >= existing.typeStart(type + 1)) {
+                type++;
+            }
+            return addressKey(existing.scriptNumData[pos], static_cast<AddressType::Enum>(type));
+        };
+        for (size_t i = 0; i < added.size(); i++) {
+            if (i + 1 < added.size() && added[i + 1].first == added[i].first) {
+                continue;
+            }
+            auto key = added[i].first;
+            while (existingPos < existing.size() && existingKey(existingPos) < key) {
+                push(existingKey(existingPos), existing.tagIdData[existingPos]);
+                existingPos++;
+            }
+            if (existingPos < existing.size() && existingKey(existingPos) == key) {
+                existingPos++;
+            }
+            push(key, added[i].second);
+        }
+        for (; existingPos < existing.size(); existingPos++) {
+            push(existingKey(existingPos), existing.tagIdData[existingPos]);
+        }
+        std::partial_sum(typeStarts.begin(), typeStarts.end(), typeStarts.begin());
+
+        // Dictionary, with a permutation of the ids sorted by name for findTag
+        std::vector<uint64_t> nameOffsets{0};
+        std::string nameData;
+        if (existing.tagCount() > 0) {
+            nameOffsets.assign(existing.nameOffsets, existing.nameOffsets + existing.tagCount() + 1);
+            nameData.assign(existing.names, existing.nameOffsets[existing.tagCount()]);
+        }
+        for (auto &name : newNames) {
+            nameData += name;
+            nameOffsets.push_back(nameData.size());
+        }
+        auto tagCount = static_cast<uint32_t>(nameOffsets.size() - 1);
+        std::vector<uint32_t> nameOrder(tagCount);
+        std::iota(nameOrder.begin(), nameOrder.end(), 0u);
+        auto nameOf = [&](uint32_t id) {
+            return std::make_pair(nameData.data() + nameOffsets[id], nameOffsets[id + 1] - nameOffsets[id]);
+        };
+        std::sort(nameOrder.begin(), nameOrder.end(), [&](uint32_t a, uint32_t b) {
+            auto nameA = nameOf(a);
+            auto nameB = nameOf(b);
+            return std::lexicographical_compare(nameA.first, nameA.first + nameA.second, nameB.first, nameB.first + nameB.second);
+        });
+
+        TagStoreHeader header{};
+        header.magic = TagStoreHeader::expectedMagic;
+        header.version = TagStoreHeader::expectedVersion;
+        header.tagCount = tagCount;
+        header.entryCount = scriptNums.size();
+        header.nameBytes = nameData.size();
+        std::copy(typeStarts.begin(), typeStarts.end(), header.typeStarts);
+
+        // Readers map the old file until they reopen, so the new version is moved over it in one step
+        auto tempPath = path + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            writeArray(file, scriptNums);
+            writeArray(file, tagIds);
+            writeArray(file, nameOrder);
+            auto padding = alignedOffsetsStart(header.entryCount, tagCount) - (sizeof(header) + sizeof(uint32_t) * (2 * header.entryCount + tagCount));
+            file.write("\0\0\0\0\0\0\0", static_cast<std::streamsize>(padding));
+            writeArray(file, nameOffsets);
+            file.write(nameData.data(), static_cast<std::streamsize>(nameData.size()));
+            if (!file) {
+                throw std::runtime_error("Could not write the tag store to " + tempPath);
+            }
+        }
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("Could not move the tag store into place at " + path);
+        }
+        return TagStore{path};
+    }
+
+    TagStore TagStore::append(const std::string &path, const std::unordered_map<Address, std::string> &tags) {
+        std::vector<RawAddress> addresses;
+        std::vector<std::string> names;
+        addresses.reserve(tags.size());
+        names.reserve(tags.size());
+        for (auto &entry : tags) {
+            addresses.emplace_back(entry.first.scriptNum, entry.first.type);
+            names.push_back(entry.second);
+        }
+        return append(path, addresses, names);
+    }
+
+    uint64_t TagStore::size() const {
+        return header ? header->entryCount : 0;
+    }
+
+    uint32_t TagStore::tagCount() const {
+        return header ? header->tagCount : 0;
+    }
+
+    uint64_t TagStore::typeStart(size_t type) const {
+        if (type > AddressType::size) {
+            throw std::out_of_range("Invalid address type " + std::to_string(type));
+        }
+        return header ? header->typeStarts[type] : 0;
+    }
+
+    std::string TagStore::tagName(uint32_t tagId) const {
+        if (tagId >= tagCount()) {
+            throw std::out_of_range("Tag id " + std::to_string(tagId) + " is not in the tag store");
+        }
+        return std::string(names + nameOffsets[tagId], names + nameOffsets[tagId + 1]);
+    }
+
+    ranges::optional<uint32_t> TagStore::findTag(const std::string &name) const {
+        auto end = nameOrder + tagCount();
+        auto it = std::lower_bound(nameOrder, end, name, [&](uint32_t id, const std::string &value) {
+            return std::lexicographical_compare(names + nameOffsets[id], names + nameOffsets[id + 1], value.begin(), value.end());
+        });
+        if (it != end && tagName(*it) == name) {
+            return *it;
+        }
+        return ranges::nullopt;
+    }
+
+    uint64_t TagStore::find(uint32_t scriptNum, AddressType::Enum type) const {
+        auto begin = scriptNumData + typeStart(static_cast<size_t>(type));
+        auto end = scriptNumData + typeStart(static_cast<size_t>(type) + 1);
+        auto it = std::lower_bound(begin, end, scriptNum);
+        return it != end && *it == scriptNum ? static_cast<uint64_t>(it - scriptNumData) : size();
+    }
+
+    uint32_t TagStore::tagId(const RawAddress &address) const {
+        auto pos = find(address.scriptNum, address.type);
+        return pos < size() ? tagIdData[pos] : NoTag;
+    }
+
+    void TagStore::tagIds(const uint32_t *scriptNums, const uint8_t *types, size_t count, uint32_t *tagIds, uint32_t threadCount) const {
+        bool sorted = true;
+        for (size_t i = 0; i < count; i++) {
+            if (types[i] >= AddressType::size) {
+                throw std::invalid_argument("Invalid address type " + std::to_string(types[i]) + " at position " + std::to_string(i));
+            }
+            if (i > 0 && addressKey(scriptNums[i], static_cast<AddressType::Enum>(types[i])) < addressKey(scriptNums[i - 1], static_cast<AddressType::Enum>(types[i - 1]))) {
+                sorted = false;
+            }
+        }
+        if (sorted) {
+            // Merge join, only moving forward through the section of each type
+            uint64_t pos = 0;
+            uint8_t type = 0;
+            for (size_t i = 0; i < count; i++) {
+                if (i == 0 || types[i] != type) {
+                    type = types[i];
+                    pos = typeStart(type);
+                }
+                auto end = typeStart(type + 1u);
+                while (pos < end && scriptNumData[pos] < scriptNums[i]) {
+                    pos++;
+                }
+                tagIds[i] = pos < end && scriptNumData[pos] == scriptNums[i] ? tagIdData[pos] : NoTag;
+            }
+            return;
+        }
+        auto segments = splitSegments(0, static_cast<uint32_t>(count), resolveThreadCount(threadCount));
+        runSegments(segments, [&](uint32_t, uint32_t segmentStart, uint32_t segmentEnd) {
+            for (uint32_t i = segmentStart; i < segmentEnd; i++) {
+                auto pos = find(scriptNums[i], static_cast<AddressType::Enum>(types[i]));
+                tagIds[i] = pos < size() ? tagIdData[pos] : NoTag;
+            }
+        });
+    }
+
+    std::vector<uint32_t> TagStore::tagIds(const std::vector<RawAddress> &addresses, uint32_t threadCount) const {
+        std::vector<uint32_t> scriptNums;
+        std::vector<uint8_t> types;
+        scriptNums.reserve(addresses.size());
+        types.reserve(addresses.size());
+        for (auto &address : addresses) {
+            scriptNums.push_back(address.scriptNum);
+            types.push_back(static_cast<uint8_t>(address.type));
+        }
+        std::vector<uint32_t> ids(addresses.size());
+        tagIds(scriptNums.data(), types.data(), addresses.size(), ids.data(), threadCount);
+        return ids;
+    }
+
+    std::vector<uint32_t> TagStore::outputTagIds(BlockRange &blocks) const {
+        auto all = outputColumns(blocks);
+        std::vector<uint32_t> ids(all.size(), NoTag);
+        if (all.size() == 0 || size() == 0) {
+            return ids;
+        }
+        // Every chunk fills its own part of the result
+        blocks.mapReduce<int>([&](const BlockRange &chunk) {
+            auto chunkBlocks = chunk;
+            auto columns = outputColumns(chunkBlocks);
+            auto out = ids.data() + (columns.firstOutputNum - all.firstOutputNum);
+            for (uint64_t i = 0; i < columns.size(); i++) {
+                auto pos = find(columns.addressNums[i], static_cast<AddressType::Enum>(columns.types[i]));
+                out[i] = pos < size() ? tagIdData[pos] : NoTag;
+            }
+            return 0;
+        }, [](int &a, int &) -> int & {
+            return a;
+        });
+        return ids;
+    }
+
+    std::vector<RawAddress> TagStore::addressesWithTag(uint32_t tagId) const {
+        std::vector<RawAddress> addresses;
+        for (size_t type = 0; type < AddressType::size; type++) {
+            for (auto pos = typeStart(type); pos < typeStart(type + 1); pos++) {
+                if (tagIdData[pos] == tagId) {
+                    addresses.emplace_back(scriptNumData[pos], static_cast<AddressType::Enum>(type));
+                }
+            }
+        }
+        return addresses;
+    }
+
+    std::unordered_map<Address, std::string> TagStore::toMap(DataAccess &access) const {
+        std::vector<std::string> tagNames;
+        tagNames.reserve(tagCount());
+        for (uint32_t i = 0; i < tagCount(); i++) {
+            tagNames.push_back(tagName(i));
+        }
+        std::unordered_map<Address, std::string> tags;
+        tags.reserve(size());
+        for (size_t type = 0; type < AddressType::size; type++) {
+            for (auto pos = typeStart(type); pos < typeStart(type + 1); pos++) {
+                tags.emplace(Address{scriptNumData[pos], static_cast<AddressType::Enum>(type), access}, tagNames[tagIdData[pos]]);
+            }
+        }
+        return tags;
+    }
+} // namespace blocksci
@@ -0,0 +1,203 @@
+//
+//  address_scan.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include <blocksci/chain/address_scan.hpp>
+#include <blocksci/address/address.hpp>
+#include <blocksci/chain/block_range.hpp>
+
+#include <internal/address_info.hpp>
+#include <internal/block_address_filter.hpp>
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+
+#include <algorithm>
+#include <array>
+
+namespace blocksci {
+
+    namespace {
+        /** Inouts probed together by scanForAddresses */
+        constexpr size_t scanBatchSize = 256;
+
+        uint32_t log2Ceil(uint64_t value) {
+            return value <= 1 ? 0 : static_cast<uint32_t>(64 - __builtin_clzll(value - 1));
+        }
+
+        std::vector<RawAddress> toRawAddresses(const std::vector<Address> &addresses) {
+            std::vector<RawAddress> rawAddresses;
+            rawAddresses.reserve(addresses.size());
+            for (auto &address : addresses) {
+                rawAddresses.emplace_back(address.scriptNum, address.type);
+            }
+            return rawAddresses;
+        }
+    }
+
+    AddressSet::AddressSet(const std::vector<Address> &addresses) : AddressSet(toRawAddresses(addresses)) {}
+
+    AddressSet::AddressSet(const std::vector<RawAddress> &addresses) {
+        for (auto &address : addresses) {
+            types[static_cast<size_t>(address.type)].scriptNums.push_back(address.scriptNum);
+        }
+        for (auto &index : types) {
+            std::sort(index.scriptNums.begin(), index.scriptNums.end());
+            index.scriptNums.erase(std::unique(index.scriptNums.begin(), index.scriptNums.end()), index.scriptNums.end());
+            index.scriptNums.shrink_to_fit();
+            addressCount += index.scriptNums.size();
+        }
+        if (addressCount == 0) {
+            return;
+        }
+
+        auto bitmapBits = log2Ceil(std::max<uint64_t>(64, addressCount * bitsPerAddress));
+        bitmapShift = 64 - bitmapBits;
+        bitmap.assign((uint64_t(1) << bitmapBits) / 64, 0);
+
+        for (size_t i = 0; i < types.size(); i++) {
+            auto &index = types[i];
+            if (index.scriptNums.empty()) {
+                continue;
+            }
+            // About four scriptNums per bucket of the range [0, largest scriptNum]
+            auto bucketBits = log2Ceil(std::max<uint64_t>(1, index.scriptNums.size() / 4));
+            auto maxBits = static_cast<uint32_t>(64 - __builtin_clzll(static_cast<uint64_t>(index.scriptNums.back()) | 1));
+            index.shift = maxBits > bucketBits ? maxBits - bucketBits : 0;
+            index.bucketStarts.assign((size_t(1) << bucketBits) + 1, 0);
+            for (auto scriptNum : index.scriptNums) {
+                index.bucketStarts[(static_cast<uint64_t>(scriptNum) >> index.shift) + 1]++;
+                auto bit = hashKey(scriptNum, static_cast<AddressType::Enum>(i)) >> bitmapShift;
+                bitmap[bit >> 6] |= uint64_t(1) << (bit & 63);
+            }
+            for (size_t bucket = 1; bucket < index.bucketStarts.size(); bucket++) {
+                index.bucketStarts[bucket] += index.bucketStarts[bucket - 1];
+            }
+        }
+    }
+
+    size_t AddressSet::memoryUsage() const {
+        size_t total = bitmap.capacity() * sizeof(uint64_t);
+        for (auto &index : types) {
+            total += (index.scriptNums.capacity() + index.bucketStarts.capacity()) * sizeof(uint32_t);
+        }
+        return total;
+    }
+
+    bool AddressSet::bucketContains(uint32_t scriptNum, AddressType::Enum type) const {
+        auto &index = types[static_cast<size_t>(type)];
+        auto bucket = static_cast<uint64_t>(scriptNum) >> index.shift;
+        if (bucket + 1 >= index.bucketStarts.size()) {
+            return false;
+        }
+        auto begin = index.scriptNums.begin() + index.bucketStarts[bucket];
+        auto end = index.scriptNums.begin() + index.bucketStarts[bucket + 1];
+        return std::binary_search(begin, end, scriptNum);
+    }
+
+    void AddressSet::containsBatch(const RawAddress *addresses, size_t count, std::vector<uint32_t> &hits) const {
+        if (bitmap.empty()) {
+            return;
+        }
+        constexpr size_t batchSize = 64;
+        std::array<uint64_t, batchSize> bits;
+        std::array<uint32_t, batchSize> candidates;
+        for (size_t batchStart = 0; batchStart < count; batchStart += batchSize) {
+            auto batchCount = std::min(batchSize, count - batchStart);
+            for (size_t i = 0; i < batchCount; i++) {
+                auto &address = addresses[batchStart + i];
+                bits[i] = hashKey(address.scriptNum, address.type) >> bitmapShift;
+                __builtin_prefetch(&bitmap[bits[i] >> 6]);
+            }
+            size_t candidateCount = 0;
+            for (size_t i = 0; i < batchCount; i++) {
+                candidates[candidateCount] = static_cast<uint32_t>(i);
+                candidateCount += (bitmap[bits[i] >> 6] >> (bits[i] & 63)) & 1;
+            }
+            for (size_t i = 0; i < candidateCount; i++) {
+                auto position = batchStart + candidates[i];
+                if (bucketContains(addresses[position].scriptNum, addresses[position].type)) {
+                    hits.push_back(static_cast<uint32_t>(position));
+                }
+            }
+        }
+    }
+
+    std::vector<AddressMatch> scanForAddresses(BlockRange &blocks, const AddressSet &addresses) {
+        if (addresses.size() == 0 || blocks.size() == 0) {
+            return {};
+        }
+        auto &chain = blocks.getAccess().getChain();
+
+        std::vector<uint64_t> fingerprints;
+        if (chain.blockAddressFiltersEnd() > blocks.sl.start) {
+            fingerprints.reserve(addresses.size());
+            addresses.forEach([&](uint32_t scriptNum, AddressType::Enum type) {
+                fingerprints.push_back(BlockAddressFilter::fingerprint(scriptNum, dedupType(type)));
+            });
+            std::sort(fingerprints.begin(), fingerprints.end());
+            fingerprints.erase(std::unique(fingerprints.begin(), fingerprints.end()), fingerprints.end());
+        }
+
+        auto chunks = blocks.segment(blocks.chunkCount(), SegmentWeight::InoutCount);
+        std::vector<std::vector<AddressMatch>> matches(chunks.size());
+        blocks.runChunks(static_cast<uint32_t>(chunks.size()), [&](uint32_t chunkNum) {
+            auto &chunk = chunks[chunkNum];
+            chunk.checkReorg();
+            auto &chunkMatches = matches[chunkNum];
+            std::vector<RawAddress> batch;
+            std::vector<AddressMatch> batchInouts;
+            std::vector<uint32_t> hits;
+            batch.reserve(scanBatchSize * 2);
+            batchInouts.reserve(scanBatchSize * 2);
+            auto probeBatch = [&]() {
+                hits.clear();
+                addresses.containsBatch(batch.data(), batch.size(), hits);
+                for (auto hit : hits) {
+                    chunkMatches.push_back(batchInouts[hit]);
+                }
+                batch.clear();
+                batchInouts.clear();
+            };
+            for (auto height = chunk.sl.start; height < chunk.sl.stop; height++) {
+                if (!fingerprints.empty()) {
+                    auto blockFilter = chain.getBlockAddressFilter(height);
+                    if (blockFilter != nullptr && !blockFilter->mayContainAny(fingerprints)) {
+                        continue;
+                    }
+                }
+                auto block = chain.getBlock(height);
+                for (uint32_t txNum = block->firstTxIndex; txNum < block->firstTxIndex + block->txCount; txNum++) {
+                    auto tx = chain.getTx(txNum);
+                    for (uint16_t i = 0; i < tx->inputCount; i++) {
+                        auto &input = tx->getInput(i);
+                        batch.emplace_back(input.getAddressNum(), input.getType());
+                        batchInouts.push_back(AddressMatch{InoutPointer{txNum, i}, InoutDirection::Input});
+                    }
+                    for (uint16_t i = 0; i < tx->outputCount; i++) {
+                        auto &output = tx->getOutput(i);
+                        batch.emplace_back(output.getAddressNum(), output.getType());
+                        batchInouts.push_back(AddressMatch{InoutPointer{txNum, i}, InoutDirection::Output});
+                    }
+                    if (batch.size() >= scanBatchSize) {
+                        probeBatch();
+                    }
+                }
+            }
+            probeBatch();
+        });
+
+        size_t total = 0;
+        for (auto &chunkMatches : matches) {
+            total += chunkMatches.size();
+        }
+        std::vector<AddressMatch> result;
+        result.reserve(total);
+        for (auto &chunkMatches : matches) {
+            result.insert(result.end(), chunkMatches.begin(), chunkMatches.end());
+        }
+        return result;
+    }
+} // namespace blocksci
@@ -0,0 +1,309 @@
+//
+//  async_query.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include <blocksci/chain/async_query.hpp>
+#include <blocksci/chain/blockchain.hpp>
+#include <blocksci/cluster/cluster.hpp>
+
+#include <range/v3/range/conversion.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace blocksci {
+
+    namespace {
+        using Clock = std::chrono::steady_clock;
+
+        /** Lookups waiting for the next batched read, in submission order */
+        template <typename Key, typename Result>
+        struct PendingBatch {
+            std::vector<Key> keys;
+            std::vector<std::promise<Result>> promises;
+            Clock::time_point oldest;
+
+            bool empty() const {
+                return keys.empty();
+            }
+
+            void add(Key key, std::promise<Result> promise) {
+                if (keys.empty()) {
+                    oldest = Clock::now();
+                }
+                keys.push_back(std::move(key));
+                promises.push_back(std::move(promise));
+            }
+
+            /** Remove and return up to count of the oldest lookups */
+            PendingBatch take(size_t count) {
+                PendingBatch batch;
+                count = std::min(count, keys.size());
+                batch.keys.assign(std::make_move_iterator(keys.begin()), std::make_move_iterator(keys.begin() + static_cast<std::ptrdiff_t>(count)));
+                batch.promises.assign(std::make_move_iterator(promises.begin()), std::make_move_iterator(promises.begin() + static_cast<std::ptrdiff_t>(count)));
+                keys.erase(keys.begin(), keys.begin() + static_cast<std::ptrdiff_t>(count));
+                promises.erase(promises.begin(), promises.begin() + static_cast<std::ptrdiff_t>(count));
+                // The remaining lookups are younger, restarting their clock delays them by at most one batch delay
+                oldest = Clock::now();
+                return batch;
+            }
+
+            void fail(std::exception_ptr error) {
+                for (auto &promise : promises) {
+                    promise.set_exception(error);
+                }
+            }
+        };
+    }
+
+    struct AsyncQueryEngine::Impl {
+        AsyncQueryConfig config;
+        DataAccess &access;
+        uint32_t txCount;
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable cpuWake;
+        bool stopping = false;
+
+        PendingBatch<uint32_t, Transaction> txBatch;
+        PendingBatch<uint256, ranges::optional<Transaction>> hashBatch;
+        std::deque<std::function<void()>> ioTasks;
+        std::deque<std::function<void()>> cpuTasks;
+        std::atomic<size_t> pending{0};
+
+        std::vector<std::thread> ioThreads;
+        std::vector<std::thread> cpuThreads;
+
+        Impl(Blockchain &chain, const AsyncQueryConfig &config_) : config(config_), access(chain.getAccess()), txCount(chain.size() > 0 ? blocksci::txCount(chain) : 0) {
+            if (config.ioThreads == 0 || config.cpuThreads == 0) {
+                throw std::invalid_argument("An async query engine needs at least one IO and one CPU thread");
+            }
+            config.maxBatchSize = std::max<size_t>(config.maxBatchSize, 1);
+            for (unsigned i = 0; i < config.ioThreads; i++) {
+                ioThreads.emplace_back([this]() { ioLoop(); });
+            }
+            for (unsigned i = 0; i < config.cpuThreads; i++) {
+                cpuThreads.emplace_back([this]() { cpuLoop(); });
+            }
+        }
+
+        ~Impl() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            cpuWake.notify_all();
+            for (auto &thread : ioThreads) {
+                thread.join();
+            }
+            for (auto &thread : cpuThreads) {
+                thread.join();
+            }
+        }
+
+        /** Count a new query, throws if there are too many already. Must be matched by finish() */
+        void admit() {
+            if (pending.fetch_add(1, std::memory_order_relaxed) >= config.maxPendingQueries) {
+                pending.fetch_sub(1, std::memory_order_relaxed);
+                throw AsyncQueryOverloaded();
+            }
+        }
+
+        void finish(size_t count) {
+            pending.fetch_sub(count, std::memory_order_relaxed);
+        }
+
+        template <typename Batch>
+        bool batchReady(const Batch &batch, Clock::time_point now) const {
+            return !batch.empty() && (stopping || batch.keys.size() >= config.maxBatchSize || now >= batch.oldest + config.maxBatchDelay);
+        }
+
+        void answerTxBatch(PendingBatch<uint32_t, Transaction> batch) {
+            try {
+                auto txes = getTransactions(batch.keys, access);
+                for (size_t i = 0; i < txes.size(); i++) {
+                    batch.promises[i].set_value(txes[i]);
+                }
+            } catch (...) {
+                batch.fail(std::current_exception());
+            }
+            finish(batch.keys.size());
+        }
+
+        void answerHashBatch(PendingBatch<uint256, ranges::optional<Transaction>> batch) {
+            try {
+                auto txNums = getTxIndexes(batch.keys, access);
+                std::vector<uint32_t> found;
+                for (auto &txNum : txNums) {
+                    if (txNum) {
+                        found.push_back(*txNum);
+                    }
+                }
+                auto txes = getTransactions(found, access);
+                size_t j = 0;
+                for (size_t i = 0; i < txNums.size(); i++) {
+                    if (txNums[i]) {
+                        batch.promises[i].set_value(txes[j++]);
+                    } else {
+                        batch.promises[i].set_value(ranges::nullopt);
+                    }
+                }
+            } catch (...) {
+                batch.fail(std::current_exception());
+            }
+            finish(batch.keys.size());
+        }
+
+        /** Answers ready batches first, then individual tasks, until stopped and drained */
+        void ioLoop() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                auto now = Clock::now();
+                if (batchReady(txBatch, now)) {
+                    auto batch = txBatch.take(config.maxBatchSize);
+                    lock.unlock();
+                    answerTxBatch(std::move(batch));
+                    lock.lock();
+                } else if (batchReady(hashBatch, now)) {
+                    auto batch = hashBatch.take(config.maxBatchSize);
+                    lock.unlock();
+                    answerHashBatch(std::move(batch));
+                    lock.lock();
+                } else if (!ioTasks.empty()) {
+                    auto task = std::move(ioTasks.front());
+                    ioTasks.pop_front();
+                    lock.unlock();
+                    task();
+                    finish(1);
+                    lock.lock();
+                } else if (stopping) {
+                    return;
+                } else if (!txBatch.empty() || !hashBatch.empty()) {
+                    auto deadline = Clock::time_point::max();
+                    if (!txBatch.empty()) {
+                        deadline = std::min(deadline, txBatch.oldest + config.maxBatchDelay);
+                    }
+                    if (!hashBatch.empty()) {
+                        deadline = std::min(deadline, hashBatch.oldest + config.maxBatchDelay);
+                    }
+                    wake.wait_until(lock, deadline);
+                } else {
+                    wake.wait(lock);
+                }
+            }
+        }
+
+        void cpuLoop() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                if (!cpuTasks.empty()) {
+                    auto task = std::move(cpuTasks.front());
+                    cpuTasks.pop_front();
+                    lock.unlock();
+                    task();
+                    finish(1);
+                    lock.lock();
+                } else if (stopping) {
+                    return;
+                } else {
+                    cpuWake.wait(lock);
+                }
+            }
+        }
+
+        /** Queue a lookup, waking an IO thread if it completes a batch */
+        template <typename Batch, typename Key, typename Result>
+        void addLookup(Batch &batch, Key key, std::promise<Result> promise) {
+            bool notify;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                // A new batch needs an IO thread waiting on its deadline, a full one can be answered right away
+                notify = batch.empty() || batch.keys.size() + 1 >= config.maxBatchSize;
+                batch.add(std::move(key), std::move(promise));
+            }
+            if (notify) {
+                wake.notify_one();
+            }
+        }
+    };
+
+    AsyncQueryEngine::AsyncQueryEngine(Blockchain &chain, const AsyncQueryConfig &config) : impl(std::make_unique<Impl>(chain, config)) {}
+
+    AsyncQueryEngine::~AsyncQueryEngine() = default;
+
+    const AsyncQueryConfig &AsyncQueryEngine::getConfig() const {
+        return impl->config;
+    }
+
+    size_t AsyncQueryEngine::pendingQueries() const {
+        return impl->pending.load(std::memory_order_relaxed);
+    }
+
+    void AsyncQueryEngine::submitIo(std::function<void()> task) {
+        impl->admit();
+        {
+            std::lock_guard<std::mutex> lock(impl->mutex);
+            impl->ioTasks.push_back(std::move(task));
+        }
+        impl->wake.notify_one();
+    }
+
+    void AsyncQueryEngine::submitCpu(std::function<void()> task) {
+        impl->admit();
+        {
+            std::lock_guard<std::mutex> lock(impl->mutex);
+            impl->cpuTasks.push_back(std::move(task));
+        }
+        impl->cpuWake.notify_one();
+    }
+
+    std::future<Transaction> AsyncQueryEngine::tx(uint32_t txNum) {
+        std::promise<Transaction> promise;
+        auto future = promise.get_future();
+        if (txNum >= impl->txCount) {
+            promise.set_exception(std::make_exception_ptr(std::out_of_range("Transaction " + std::to_string(txNum) + " is not in the loaded chain")));
+            return future;
+        }
+        impl->admit();
+        impl->addLookup(impl->txBatch, txNum, std::move(promise));
+        return future;
+    }
+
+    std::future<ranges::optional<Transaction>> AsyncQueryEngine::txWithHash(const uint256 &hash) {
+        std::promise<ranges::optional<Transaction>> promise;
+        auto future = promise.get_future();
+        impl->admit();
+        impl->addLookup(impl->hashBatch, hash, std::move(promise));
+        return future;
+    }
+
+    std::future<std::vector<Output>> AsyncQueryEngine::addressOutputs(const Address &address) {
+        return io([address]() {
+            return address.getOutputs() | ranges::to_vector;
+        });
+    }
+
+    std::future<int64_t> AsyncQueryEngine::addressBalance(const Address &address, BlockHeight height) {
+        return io([address, height]() {
+            return address.calculateBalance(height);
+        });
+    }
+
+    std::future<ClusterStats> AsyncQueryEngine::clusterStats(const Cluster &cluster) {
+        return io([cluster]() {
+            return cluster.getStats();
+        });
+    }
+} // namespace blocksci
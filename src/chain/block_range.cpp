@@ -7,48 +7,173 @@
 //
 
 #include <blocksci/chain/blockchain.hpp>
+#include <blocksci/address/address.hpp>
+
+#include <internal/address_info.hpp>
+#include <internal/block_address_filter.hpp>
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+#include <internal/tracing.hpp>
 
 #include <range/v3/action/push_back.hpp>
 #include <range/v3/view/filter.hpp>
 
 #include <algorithm>
+#include <cassert>
 
 namespace blocksci {
     
-    std::vector<BlockRange> BlockRange::segment(unsigned int segmentCount) const {
+    std::vector<BlockRange> BlockRange::segmentByWeight(unsigned int segmentCount, const std::function<uint64_t(BlockHeight)> &cumulative) const {
         std::vector<BlockRange> segments;
         
-        if (size() < static_cast<BlockHeight>(segmentCount)) {
+        if (size() < static_cast<BlockHeight>(segmentCount) || segmentCount <= 1) {
             segments.push_back(*this);
             return segments;
         }
         
-        auto lastTx = endTxIndex();
-        auto firstTx = firstTxIndex();
-        auto totalTxCount = lastTx - firstTx;
-        uint32_t segmentSize = totalTxCount / segmentCount;
-        
+        auto startWeight = cumulative(sl.start);
+        auto totalWeight = cumulative(sl.stop) - startWeight;
         
-        auto it = begin();
-        auto chainEnd = end();
-        while(lastTx - (*it).firstTxIndex() > segmentSize) {
-            auto endIt = std::lower_bound(it, chainEnd, (*it).firstTxIndex() + segmentSize, [](const Block &block, uint32_t txNum) {
-                return block.firstTxIndex() < txNum;
-            });
-            auto startBlock = *it;
-            auto endBlock = *endIt;
-            segments.emplace_back(Slice{startBlock.height(), endBlock.height()}, access);
-            it = endIt;
-        }
-        if (segments.size() == segmentCount) {
-            segments.back() = {Slice{segments.back().sl.start, sl.stop}, access};
-        } else {
-            auto startBlock = *it;
-            segments.emplace_back(Slice{startBlock.height(), sl.stop}, access);
+        auto segmentStart = sl.start;
+        for (unsigned int i = 1; i < segmentCount; i++) {
+            auto target = startWeight + totalWeight / segmentCount * i + totalWeight % segmentCount * i / segmentCount;
+            // First height after segmentStart at which the weight reaches the target
+            auto low = segmentStart + 1;
+            auto high = sl.stop;
+            while (low < high) {
+                auto mid = low + (high - low) / 2;
+                if (cumulative(mid) < target) {
+                    low = mid + 1;
+                } else {
+                    high = mid;
+                }
+            }
+            if (low >= sl.stop) {
+                break;
+            }
+            segments.push_back(withSlice({segmentStart, low}));
+            segmentStart = low;
         }
+        segments.push_back(withSlice({segmentStart, sl.stop}));
         return segments;
     }
     
+    std::vector<BlockRange> BlockRange::segment(unsigned int segmentCount) const {
+        if (segmentCost) {
+            return segment(segmentCount, *segmentCost);
+        }
+        return segment(segmentCount, segmentWeight);
+    }
+    
+    std::vector<BlockRange> BlockRange::segment(unsigned int segmentCount, SegmentWeight weight) const {
+        auto &chain = access->getChain();
+        auto txIndex = [&](BlockHeight height) -> uint32_t {
+            if (height == sl.stop) {
+                return endTxIndex();
+            }
+            return chain.getBlock(height)->firstTxIndex;
+        };
+        switch (weight) {
+            case SegmentWeight::TxCount:
+                return segmentByWeight(segmentCount, txIndex);
+            case SegmentWeight::InoutCount:
+                return segmentByWeight(segmentCount, [&](BlockHeight height) {
+                    return chain.getInoutOffset(txIndex(height));
+                });
+        }
+        assert(false);
+        return {*this};
+    }
+    
+    std::vector<BlockRange> BlockRange::segment(unsigned int segmentCount, const BlockCostFunc &cost) const {
+        std::vector<uint64_t> cumulativeCost;
+        cumulativeCost.reserve(static_cast<size_t>(size()) + 1);
+        uint64_t total = 0;
+        cumulativeCost.push_back(total);
+        for (auto block : *this) {
+            total += cost(block);
+            cumulativeCost.push_back(total);
+        }
+        return segmentByWeight(segmentCount, [&](BlockHeight height) {
+            return cumulativeCost[static_cast<size_t>(height - sl.start)];
+        });
+    }
+    
+    void BlockRange::adviseAccess(AccessHint hint) const {
+        if (size() > 0) {
+            access->getChain().adviseTxRange(firstTxIndex(), endTxIndex(), hint);
+            if (hint == AccessHint::WillNeed && WorkPool::limitsIo()) {
+                WorkPool::chargeIo(access->getChain().txRangeBytes(firstTxIndex(), endTxIndex()));
+            }
+        }
+    }
+    
+    void BlockRange::prefetch(unsigned int threadCount) const {
+        if (size() == 0) {
+            return;
+        }
+        constexpr uint64_t segmentBytes = uint64_t{64} << 20;
+        auto bytes = access->getChain().txRangeBytes(firstTxIndex(), endTxIndex());
+        auto segmentCount = std::min<uint64_t>(std::max<uint64_t>(bytes / segmentBytes, 1), static_cast<uint64_t>(size()));
+        auto options = WorkScope::currentOptions();
+        options.priority = WorkPriority::Batch;
+        if (threadCount > 0) {
+            options.maxThreads = threadCount;
+        }
+        WorkScope scope{options};
+        auto segments = segment(static_cast<unsigned int>(segmentCount));
+        // The pool hands out the segments in order, so a scan of the range that runs behind finds its data loaded
+        runChunks(static_cast<uint32_t>(segments.size()), [&](uint32_t segmentNum) {
+            auto &segment = segments[segmentNum];
+            segment.checkReorg();
+            segment.adviseAccess(AccessHint::WillNeed);
+        });
+    }
+    
+    void BlockRange::checkReorg() const {
+        access->getChain().checkReorg();
+    }
+    
+    unsigned int BlockRange::chunkCount() const {
+        if (size() == 0) {
+            return 1;
+        }
+        auto &pool = access->getWorkPool();
+        auto &config = pool.getConfig();
+        auto chunks = static_cast<uint64_t>(pool.batchThreadCount()) * std::max(config.chunksPerThread, 1u);
+        auto txCount = static_cast<uint64_t>(endTxIndex() - firstTxIndex());
+        chunks = std::min(chunks, txCount / std::max(config.minChunkTxCount, 1u));
+        return static_cast<unsigned int>(std::max(chunks, uint64_t{1}));
+    }
+    
+    void BlockRange::runChunks(uint32_t chunkCount, const std::function<void(uint32_t)> &task) const {
+        if (!TraceSpan::tracing()) {
+            access->getWorkPool().run(chunkCount, task, cancellation);
+            return;
+        }
+        access->getWorkPool().run(chunkCount, [&task](uint32_t chunkNum) {
+            TraceSpan span{TraceOperation::MapReduceSegment, chunkNum};
+            task(chunkNum);
+        }, cancellation);
+    }
+    
+    std::vector<uint32_t> BlockRange::concatenateChunks(std::vector<std::vector<uint32_t>> &chunks) const {
+        std::vector<size_t> offsets;
+        offsets.reserve(chunks.size());
+        size_t total = 0;
+        for (auto &chunk : chunks) {
+            offsets.push_back(total);
+            total += chunk.size();
+        }
+        std::vector<uint32_t> result(total);
+        runChunks(static_cast<uint32_t>(chunks.size()), [&](uint32_t chunkNum) {
+            auto &chunk = chunks[chunkNum];
+            std::copy(chunk.begin(), chunk.end(), result.begin() + static_cast<std::ptrdiff_t>(offsets[chunkNum]));
+            std::vector<uint32_t>{}.swap(chunk);
+        });
+        return result;
+    }
+    
     std::vector<Block> BlockRange::filter(std::function<bool(const Block &block)> testFunc)  {
         auto mapFunc = [&testFunc](const BlockRange &segment) -> std::vector<Block> {
             return segment | ranges::views::filter(testFunc) | ranges::to_vector;
@@ -63,6 +188,39 @@ namespace blocksci {
         return mapReduce<std::vector<Block>>(mapFunc, reduceFunc);
     }
     
+    std::vector<Block> BlockRange::blocksPossiblyTouching(const std::vector<Address> &addresses) const {
+        if (addresses.empty()) {
+            return {};
+        }
+        std::vector<uint64_t> fingerprints;
+        fingerprints.reserve(addresses.size());
+        for (auto &address : addresses) {
+            fingerprints.push_back(BlockAddressFilter::fingerprint(address.scriptNum, dedupType(address.type)));
+        }
+        std::sort(fingerprints.begin(), fingerprints.end());
+        fingerprints.erase(std::unique(fingerprints.begin(), fingerprints.end()), fingerprints.end());
+        
+        // The filters hold about one entry per inout, so balance the chunks by inout count
+        auto &chain = access->getChain();
+        auto chunks = segment(chunkCount(), SegmentWeight::InoutCount);
+        std::vector<std::vector<uint32_t>> matches(chunks.size());
+        runChunks(static_cast<uint32_t>(chunks.size()), [&](uint32_t chunkNum) {
+            auto &chunk = chunks[chunkNum];
+            for (auto height = chunk.sl.start; height < chunk.sl.stop; height++) {
+                auto blockFilter = chain.getBlockAddressFilter(height);
+                if (blockFilter == nullptr || blockFilter->mayContainAny(fingerprints)) {
+                    matches[chunkNum].push_back(static_cast<uint32_t>(height));
+                }
+            }
+        });
+        
+        std::vector<Block> blocks;
+        for (auto height : concatenateChunks(matches)) {
+            blocks.emplace_back(static_cast<BlockHeight>(height), *access);
+        }
+        return blocks;
+    }
+    
     std::vector<Transaction> BlockRange::filter(std::function<bool(const Transaction &tx)> testFunc)  {
         auto mapFunc = [&testFunc](const BlockRange &segment) -> std::vector<Transaction> {
             std::vector<Transaction> txes;
@@ -0,0 +1,34 @@
+//
+//  block_stats.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include <blocksci/chain/block_stats.hpp>
+#include <blocksci/chain/block_range.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+
+#include <stdexcept>
+
+namespace blocksci {
+    bool hasBlockStats(DataAccess &access) {
+        auto &chain = access.getChain();
+        return chain.blockStatsSize() >= chain.blockCount();
+    }
+
+    std::vector<BlockStats> blockStats(BlockRange &blocks) {
+        auto &chain = blocks.getAccess().getChain();
+        if (blocks.sl.stop > chain.blockStatsSize()) {
+            throw std::runtime_error("Block statistics do not cover the requested blocks, run blocksci_parser update");
+        }
+        std::vector<BlockStats> stats;
+        stats.reserve(static_cast<size_t>(blocks.size()));
+        for (auto height = blocks.sl.start; height < blocks.sl.stop; height++) {
+            stats.push_back(*chain.getBlockStats(height));
+        }
+        return stats;
+    }
+} // namespace blocksci
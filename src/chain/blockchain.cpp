@@ -9,11 +9,21 @@
 #include <blocksci/chain/blockchain.hpp>
 #include <blocksci/chain/output.hpp>
 #include <blocksci/address/address.hpp>
+#include <blocksci/scripts/nulldata_script.hpp>
 
+#include <internal/access_registry.hpp>
+#include <internal/access_stats.hpp>
+#include <internal/address_index.hpp>
 #include <internal/address_info.hpp>
 #include <internal/chain_access.hpp>
+#include <internal/chain_manifest.hpp>
 #include <internal/data_access.hpp>
+#include <internal/derived_column_store.hpp>
+#include <internal/memory_budget.hpp>
+#include <internal/nulldata_prefix_index.hpp>
+#include <internal/page_cache.hpp>
 #include <internal/script_access.hpp>
+#include <internal/tx_hash_order.hpp>
 #include <internal/address_output_range.hpp>
 
 #include <range/v3/numeric/accumulate.hpp>
@@ -22,16 +32,40 @@
 #include <range/v3/view/group_by.hpp>
 #include <range/v3/view/transform.hpp>
 
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
 namespace blocksci {
     
-    Blockchain::Blockchain(std::unique_ptr<DataAccess> access_) : BlockRange{{0, access_->getChain().blockCount()}, access_.get()}, access(std::move(access_)) {}
+    namespace {
+        DataConfiguration snapshotConfig(const std::string &configPath, ChainSnapshot snapshot) {
+            auto config = loadBlockchainConfig(configPath, true, 0);
+            config.snapshotVersion = snapshot.version;
+            if (config.snapshotVersion == 0) {
+                auto latest = ChainManifest{config.chainDirectory()}.latest();
+                if (!latest) {
+                    throw std::runtime_error("The parser has not published a snapshot of the chain yet");
+                }
+                config.snapshotVersion = latest->version;
+            }
+            return config;
+        }
+    }
+    
+    Blockchain::Blockchain(std::unique_ptr<DataAccess> access_) : Blockchain(std::shared_ptr<DataAccess>{std::move(access_)}) {}
+    
+    Blockchain::Blockchain(std::shared_ptr<DataAccess> access_) : BlockRange{{0, access_->getChain().blockCount()}, access_.get()}, access(std::move(access_)) {}
     
     Blockchain::Blockchain(const DataConfiguration &config) : Blockchain(std::make_unique<DataAccess>(config)) {}
     
-    Blockchain::Blockchain(const std::string &configPath, BlockHeight maxBlock) : Blockchain(loadBlockchainConfig(configPath, true, maxBlock)) {}
+    Blockchain::Blockchain(const std::string &configPath, BlockHeight maxBlock) : Blockchain(sharedDataAccess(loadBlockchainConfig(configPath, true, maxBlock))) {}
     
     Blockchain::Blockchain(const std::string &configPath) : Blockchain(configPath, BlockHeight{0}) {}
     
+    Blockchain::Blockchain(const std::string &configPath, ChainSnapshot snapshot) : Blockchain(sharedDataAccess(snapshotConfig(configPath, snapshot))) {}
+    
     
     Blockchain::~Blockchain() = default;
     
@@ -52,12 +86,174 @@ namespace blocksci {
         return access->config.pidFilePath().exists();
     }
     
+    void Blockchain::checkReorg() const {
+        access->getChain().checkReorg();
+    }
+    
+    BlockHeight Blockchain::diskBlockCount() const {
+        return access->getChain().diskBlockCount();
+    }
+    
+    uint64_t Blockchain::dataGeneration() const {
+        return access->getChain().dataGeneration();
+    }
+    
+    uint64_t Blockchain::snapshotVersion() const {
+        return access->config.snapshotVersion;
+    }
+    
+    uint64_t Blockchain::latestSnapshotVersion() const {
+        auto latest = ChainManifest{access->config.chainDirectory()}.latest();
+        return latest ? latest->version : 0;
+    }
+    
+    void Blockchain::setAccessHint(ChainColumn column, AccessHint hint) {
+        access->chain->advise(column, hint);
+    }
+    
+    ResidentMemoryStats Blockchain::makeResident(bool lockTxData, NumaPlacement placement) {
+        return access->makeResident(lockTxData, placement);
+    }
+    
+    ResidentMemoryStats Blockchain::residentMemoryStats() const {
+        return access->residentMemory;
+    }
+    
+    std::vector<FileResidency> Blockchain::pageCacheResidency() const {
+        return dataFileResidency(access->config);
+    }
+    
+    MemoryUsage Blockchain::memoryUsage() const {
+        return blocksci::memoryUsage(*access);
+    }
+    
+    void Blockchain::setMemoryBudget(uint64_t bytes) {
+        access->config.memoryBudget = bytes;
+    }
+    
+    uint64_t Blockchain::memoryBudget() const {
+        return access->config.memoryBudget;
+    }
+    
+    MemoryBudgetResult Blockchain::enforceMemoryBudget() {
+        return blocksci::enforceMemoryBudget(*access, access->config.memoryBudget);
+    }
+    
+    void Blockchain::setAccessHint(AccessHint hint) {
+        for (auto column : {ChainColumn::Block, ChainColumn::Coinbase, ChainColumn::TxData, ChainColumn::TxIndex, ChainColumn::TxVersion, ChainColumn::FirstInput, ChainColumn::FirstOutput, ChainColumn::InputSpentOutNum, ChainColumn::Sequence, ChainColumn::TxHashes, ChainColumn::OutputValue, ChainColumn::OutputType, ChainColumn::OutputAddress, ChainColumn::OutputSpentTx, ChainColumn::OutputSpendingInput, ChainColumn::OutputSpendingHeight, ChainColumn::TxFee, ChainColumn::TxVirtualSize, ChainColumn::InputSpentHeight, ChainColumn::InputSpentValue, ChainColumn::BlockStats, ChainColumn::TxPackageFlags}) {
+            access->chain->advise(column, hint);
+        }
+    }
+    
+    void Blockchain::setParallelism(const ParallelConfig &config) {
+        access->setParallelConfig(config);
+    }
+    
+    ParallelConfig Blockchain::parallelism() const {
+        return access->parallelConfig;
+    }
+    
+    void Blockchain::setTrackTxColumnAccess(bool track) {
+        access->chain->setTrackColumnAccess(track);
+    }
+    
+    TxColumnAccessStats Blockchain::txColumnAccessStats() const {
+        return access->getChain().columnAccessStats();
+    }
+    
+    AccessStats Blockchain::stats() const {
+        return collectAccessStats();
+    }
+    
+    MempoolSnapshot Blockchain::pendingTransactions() const {
+        return MempoolSnapshot{*access};
+    }
+    
+    TxSet Blockchain::ancestors(const std::vector<uint32_t> &txNums, uint32_t depth, const SpendEdgeFilter &filter) {
+        return spendNeighborhood(txNums, depth, SpendDirection::Ancestors, filter, *access);
+    }
+    
+    TxSet Blockchain::descendants(const std::vector<uint32_t> &txNums, uint32_t depth, const SpendEdgeFilter &filter) {
+        return spendNeighborhood(txNums, depth, SpendDirection::Descendants, filter, *access);
+    }
+    
+    OutputSet Blockchain::utxoSetAt(BlockHeight height) {
+        return blocksci::utxoSetAt(*this, height);
+    }
+    
+    UTXOSetDelta Blockchain::utxoSetDelta(BlockHeight startHeight, BlockHeight endHeight) {
+        return blocksci::utxoSetDelta(*this, startHeight, endHeight);
+    }
+    
+    void Blockchain::registerDerivedColumn(DerivedColumnSpec spec) {
+        getAccess().derivedColumns->add(std::move(spec));
+    }
+    
+    void Blockchain::updateDerivedColumns() {
+        getAccess().derivedColumns->update(*this);
+    }
+    
+    DerivedColumn Blockchain::derivedColumn(const std::string &name) {
+        return getAccess().derivedColumns->open(name, getAccess());
+    }
+    
     uint32_t txCount(Blockchain &chain) {
         auto lastBlock = chain[static_cast<int>(chain.size()) - BlockHeight{1}];
         return lastBlock.endTxIndex();
     }
     
+    ChainView Blockchain::asOf(BlockHeight height) {
+        if (height > size()) {
+            throw std::out_of_range("Cannot view the chain at height " + std::to_string(height) + ", it has " + std::to_string(size()) + " blocks");
+        }
+        return ChainView{height, access.get()};
+    }
+    
     uint32_t Blockchain::addressCount(AddressType::Enum type) const {
         return access->getScripts().scriptCount(dedupType(type));
     }
+    
+    std::vector<uint32_t> Blockchain::addressOutputCounts(AddressType::Enum type, uint32_t threadCount) const {
+        // scriptNums start at 1
+        return access->getAddressIndex().countOutputs(type, addressCount(type) + 1, threadCount);
+    }
+    
+    std::vector<std::pair<uint32_t, uint32_t>> Blockchain::matchTransactions(const Blockchain &other, uint32_t threadCount) const {
+        return matchTxHashes(access->getChain(), access->config.txHashOrderFilePath(), other.access->getChain(), other.access->config.txHashOrderFilePath(), threadCount);
+    }
+    
+    namespace {
+        /** Block timestamps are whole seconds, so a block is at or after time iff it is at or after the next second */
+        uint32_t toBlockTimestamp(std::chrono::system_clock::time_point time) {
+            auto sinceEpoch = time.time_since_epoch();
+            auto seconds = std::chrono::duration_cast<std::chrono::seconds>(sinceEpoch);
+            if (seconds < sinceEpoch) {
+                seconds += std::chrono::seconds{1};
+            }
+            auto count = std::max<int64_t>(0, std::min<int64_t>(seconds.count(), std::numeric_limits<uint32_t>::max()));
+            return static_cast<uint32_t>(count);
+        }
+    }
+    
+    BlockRange Blockchain::range(std::chrono::system_clock::time_point start, std::chrono::system_clock::time_point end) const {
+        auto heights = access->getChain().getHeightRange(toBlockTimestamp(start), toBlockTimestamp(end));
+        return {{heights.first, heights.second}, access.get()};
+    }
+    
+    std::vector<script::OpReturn> Blockchain::nulldataWithPrefix(const std::string &prefix) const {
+        if (!NulldataPrefixIndex::exists(access->config.nulldataIndexDirectory())) {
+            throw std::runtime_error("The nulldata index has not been built, run blocksci_parser build-nulldata-index");
+        }
+        auto entries = access->getNulldataIndex().find(prefix, access->getScripts());
+        std::vector<script::OpReturn> scripts;
+        scripts.reserve(entries.size());
+        // Only report scripts of the loaded part of the chain
+        auto txCount = access->getChain().txCount();
+        for (const auto &entry : entries) {
+            if (entry.txNum < txCount) {
+                scripts.emplace_back(entry.scriptNum, *access);
+            }
+        }
+        return scripts;
+    }
 } // namespace blocksci
@@ -0,0 +1,279 @@
+//
+//  bulk_scan.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "bulk_scan_kernels.hpp"
+
+#include <blocksci/chain/bulk_scan.hpp>
+#include <blocksci/address/address.hpp>
+#include <blocksci/chain/block_range.hpp>
+#include <blocksci/chain/output_columns.hpp>
+#include <blocksci/chain/tx_fee_columns.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace blocksci {
+    namespace {
+        bool useCuda(const BulkScanOptions &options) {
+            if (options.gpuChunkRows == 0) {
+                throw std::invalid_argument("GPU chunks must hold at least one row");
+            }
+            switch (options.backend) {
+                case ScanBackend::Cpu:
+                    return false;
+                case ScanBackend::Cuda:
+                    if (!cudaScanAvailable()) {
+                        throw std::runtime_error("BlockSci was built without CUDA support or no CUDA device is present");
+                    }
+                    return true;
+                case ScanBackend::Auto:
+                    return cudaScanAvailable();
+            }
+            return false;
+        }
+
+        /** Sums of the type mix of a contiguous run of buckets, the part of one mapReduce chunk */
+        struct TypeMixPart {
+            size_t firstBucket = 0;
+            std::vector<std::array<uint64_t, AddressType::size>> counts;
+            std::vector<std::array<int64_t, AddressType::size>> values;
+        };
+
+        /** First output number of every bucket of bucketBlocks blocks */
+        std::vector<uint64_t> bucketOutputStarts(BlockRange &blocks, const std::vector<BlockHeight> &bucketStarts) {
+            auto &chain = blocks.getAccess().getChain();
+            std::vector<uint64_t> starts;
+            starts.reserve(bucketStarts.size());
+            for (auto height : bucketStarts) {
+                starts.push_back(chain.getFirstOutputNumber(chain.getBlock(height)->firstTxIndex));
+            }
+            return starts;
+        }
+
+        double bucketFeeRate(uint32_t bucket) {
+            if (bucket == 0) {
+                return std::exp2(bulk_scan::feeRateMinExponent);
+            }
+            if (bucket >= bulk_scan::feeRateBucketCount - 1) {
+                return std::exp2(bulk_scan::feeRateMaxExponent);
+            }
+            // Geometric middle of the bucket
+            return std::exp2(bulk_scan::feeRateMinExponent + (bucket - 0.5) / bulk_scan::feeRateBucketsPerOctave);
+        }
+    } // namespace
+
+    bool cudaScanAvailable() {
+        #ifdef BLOCKSCI_WITH_CUDA
+        static bool available = bulk_scan::cuda::deviceAvailable();
+        return available;
+        #else
+        return false;
+        #endif
+    }
+
+    std::array<uint64_t, outputValueBucketCount> outputValueHistogram(BlockRange &blocks, const BulkScanOptions &options) {
+        static_assert(outputValueBucketCount == bulk_scan::valueBucketCount, "Value buckets must match the kernels");
+        std::array<uint64_t, outputValueBucketCount> buckets{};
+        if (blocks.size() == 0) {
+            return buckets;
+        }
+        if (useCuda(options)) {
+            #ifdef BLOCKSCI_WITH_CUDA
+            auto columns = outputColumns(blocks);
+            bulk_scan::cuda::valueHistogram(columns.values, columns.size(), options.gpuChunkRows, buckets.data());
+            #endif
+            return buckets;
+        }
+        using Histogram = std::array<uint64_t, outputValueBucketCount>;
+        return blocks.mapReduce<Histogram>([](const BlockRange &chunk) {
+            auto chunkBlocks = chunk;
+            auto columns = outputColumns(chunkBlocks);
+            Histogram histogram{};
+            for (uint64_t i = 0; i < columns.size(); i++) {
+                histogram[bulk_scan::valueBucket(columns.values[i])]++;
+            }
+            return histogram;
+        }, [](Histogram &a, Histogram &b) -> Histogram & {
+            for (size_t i = 0; i < a.size(); i++) {
+                a[i] += b[i];
+            }
+            return a;
+        });
+    }
+
+    OutputTypeMix outputTypeMix(BlockRange &blocks, BlockHeight bucketBlocks, const BulkScanOptions &options) {
+        if (bucketBlocks <= 0) {
+            throw std::invalid_argument("Buckets must hold at least one block");
+        }
+        OutputTypeMix mix;
+        for (auto height = blocks.sl.start; height < blocks.sl.stop; height += bucketBlocks) {
+            mix.bucketStarts.push_back(height);
+        }
+        mix.counts.resize(mix.bucketStarts.size());
+        mix.values.resize(mix.bucketStarts.size());
+        if (blocks.size() == 0) {
+            return mix;
+        }
+        auto outputStarts = bucketOutputStarts(blocks, mix.bucketStarts);
+        if (useCuda(options)) {
+            #ifdef BLOCKSCI_WITH_CUDA
+            auto columns = outputColumns(blocks);
+            // The kernels count rows from the start of the columns
+            for (auto &start : outputStarts) {
+                start -= columns.firstOutputNum;
+            }
+            bulk_scan::cuda::typeMix(columns.values, columns.types, columns.size(), outputStarts, static_cast<uint32_t>(AddressType::size), options.gpuChunkRows, mix.counts.front().data(), mix.values.front().data());
+            #endif
+            return mix;
+        }
+        auto merged = blocks.mapReduce<TypeMixPart>([&](const BlockRange &chunk) {
+            auto chunkBlocks = chunk;
+            auto columns = outputColumns(chunkBlocks);
+            TypeMixPart part;
+            auto bucket = static_cast<size_t>(std::upper_bound(outputStarts.begin(), outputStarts.end(), columns.firstOutputNum) - outputStarts.begin()) - 1;
+            part.firstBucket = bucket;
+            part.counts.emplace_back();
+            part.values.emplace_back();
+            for (uint64_t i = 0; i < columns.size(); i++) {
+                while (bucket + 1 < outputStarts.size() && outputStarts[bucket + 1] <= columns.firstOutputNum + i) {
+                    bucket++;
+                    part.counts.emplace_back();
+                    part.values.emplace_back();
+                }
+                part.counts.back()[columns.types[i]]++;
+                part.values.back()[columns.types[i]] += columns.values[i];
+            }
+            return part;
+        }, [](TypeMixPart &a, TypeMixPart &b) -> TypeMixPart & {
+            // Chunks are reduced in block order, so b continues a and may share its last bucket
+            size_t bIndex = 0;
+            if (a.firstBucket + a.counts.size() - 1 == b.firstBucket) {
+                for (size_t type = 0; type < AddressType::size; type++) {
+                    a.counts.back()[type] += b.counts.front()[type];
+                    a.values.back()[type] += b.values.front()[type];
+                }
+                bIndex = 1;
+            }
+            a.counts.insert(a.counts.end(), b.counts.begin() + static_cast<std::ptrdiff_t>(bIndex), b.counts.end());
+            a.values.insert(a.values.end(), b.values.begin() + static_cast<std::ptrdiff_t>(bIndex), b.values.end());
+            return a;
+        });
+        std::copy(merged.counts.begin(), merged.counts.end(), mix.counts.begin() + static_cast<std::ptrdiff_t>(merged.firstBucket));
+        std::copy(merged.values.begin(), merged.values.end(), mix.values.begin() + static_cast<std::ptrdiff_t>(merged.firstBucket));
+        return mix;
+    }
+
+    std::vector<OutputPointer> probeOutputAddresses(BlockRange &blocks, const std::vector<Address> &addresses, const BulkScanOptions &options) {
+        std::vector<OutputPointer> pointers;
+        if (blocks.size() == 0 || addresses.empty()) {
+            return pointers;
+        }
+        std::vector<uint64_t> keys;
+        keys.reserve(addresses.size());
+        for (auto &address : addresses) {
+            keys.push_back(bulk_scan::addressKey(static_cast<uint8_t>(address.type), address.scriptNum));
+        }
+        uint32_t bits = 0;
+        auto table = bulk_scan::buildKeyTable(keys, bits);
+
+        std::vector<uint64_t> outputNums;
+        if (useCuda(options)) {
+            #ifdef BLOCKSCI_WITH_CUDA
+            auto columns = outputColumns(blocks);
+            outputNums = bulk_scan::cuda::probeAddresses(columns.types, columns.addressNums, columns.size(), table, bits, options.gpuChunkRows);
+            for (auto &outputNum : outputNums) {
+                outputNum += columns.firstOutputNum;
+            }
+            #endif
+        } else {
+            using Matches = std::vector<uint64_t>;
+            outputNums = blocks.mapReduce<Matches>([&](const BlockRange &chunk) {
+                auto chunkBlocks = chunk;
+                auto columns = outputColumns(chunkBlocks);
+                Matches matches;
+                for (uint64_t i = 0; i < columns.size(); i++) {
+                    if (bulk_scan::containsKey(table.data(), bits, bulk_scan::addressKey(columns.types[i], columns.addressNums[i]))) {
+                        matches.push_back(columns.firstOutputNum + i);
+                    }
+                }
+                return matches;
+            }, [](Matches &a, Matches &b) -> Matches & {
+                a.insert(a.end(), b.begin(), b.end());
+                return a;
+            });
+        }
+
+        auto &chain = blocks.getAccess().getChain();
+        pointers.reserve(outputNums.size());
+        for (auto outputNum : outputNums) {
+            auto txNum = chain.getTxNumOfOutput(outputNum);
+            pointers.emplace_back(txNum, static_cast<uint16_t>(outputNum - chain.getFirstOutputNumber(txNum)));
+        }
+        return pointers;
+    }
+
+    std::vector<double> feeRateQuantiles(BlockRange &blocks, const std::vector<double> &quantiles, const BulkScanOptions &options) {
+        for (auto quantile : quantiles) {
+            if (!(quantile >= 0 && quantile <= 1)) {
+                throw std::invalid_argument("Quantiles must be between 0 and 1");
+            }
+        }
+        using Histogram = std::vector<uint64_t>;
+        Histogram histogram(bulk_scan::feeRateBucketCount, 0);
+        if (blocks.size() > 0) {
+            if (useCuda(options)) {
+                #ifdef BLOCKSCI_WITH_CUDA
+                auto columns = txFeeColumns(blocks);
+                bulk_scan::cuda::feeRateHistogram(columns.fees, columns.virtualSizes, columns.size(), options.gpuChunkRows, histogram.data());
+                #endif
+            } else {
+                histogram = blocks.mapReduce<Histogram>([](const BlockRange &chunk) {
+                    auto chunkBlocks = chunk;
+                    auto columns = txFeeColumns(chunkBlocks);
+                    // One extra bucket collects the transactions without a fee
+                    Histogram counts(bulk_scan::feeRateBucketCount + 1, 0);
+                    for (uint32_t i = 0; i < columns.size(); i++) {
+                        counts[bulk_scan::feeRateBucket(columns.fees[i], columns.virtualSizes[i])]++;
+                    }
+                    counts.pop_back();
+                    return counts;
+                }, [](Histogram &a, Histogram &b) -> Histogram & {
+                    for (size_t i = 0; i < a.size(); i++) {
+                        a[i] += b[i];
+                    }
+                    return a;
+                });
+            }
+        }
+
+        uint64_t total = 0;
+        for (auto count : histogram) {
+            total += count;
+        }
+        std::vector<double> rates;
+        rates.reserve(quantiles.size());
+        for (auto quantile : quantiles) {
+            if (total == 0) {
+                rates.push_back(0);
+                continue;
+            }
+            auto rank = static_cast<uint64_t>(quantile * static_cast<double>(total - 1));
+            uint64_t seen = 0;
+            uint32_t bucket = 0;
+            while (seen + histogram[bucket] <= rank) {
+                seen += histogram[bucket];
+                bucket++;
+            }
+            rates.push_back(bucketFeeRate(bucket));
+        }
+        return rates;
+    }
+} // namespace blocksci
@@ -0,0 +1,310 @@
+//
+//  bulk_scan_cuda.cu
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "bulk_scan_kernels.hpp"
+
+#include <cuda_runtime.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace blocksci { namespace bulk_scan { namespace cuda {
+    namespace {
+        constexpr int threadsPerBlock = 256;
+
+        void check(cudaError_t error, const char *operation) {
+            if (error != cudaSuccess) {
+                throw std::runtime_error(std::string{operation} + " failed: " + cudaGetErrorString(error));
+            }
+        }
+
+        int gridSize(uint64_t rows) {
+            // Grid-stride loops cover the rest, a few waves of blocks keep every SM busy
+            return static_cast<int>(std::min<uint64_t>((rows + threadsPerBlock - 1) / threadsPerBlock, 4096));
+        }
+
+        /** Device memory freed when it goes out of scope */
+        template <typename T>
+        class DeviceArray {
+            T *data_ = nullptr;
+
+        public:
+            explicit DeviceArray(size_t size) {
+                check(cudaMalloc(&data_, std::max<size_t>(size, 1) * sizeof(T)), "cudaMalloc");
+            }
+            DeviceArray(DeviceArray &&other) noexcept : data_(other.data_) {
+                other.data_ = nullptr;
+            }
+            DeviceArray(const DeviceArray &) = delete;
+            DeviceArray &operator=(const DeviceArray &) = delete;
+            ~DeviceArray() {
+                cudaFree(data_);
+            }
+
+            T *get() const {
+                return data_;
+            }
+        };
+
+        template <typename T>
+        DeviceArray<T> zeroedArray(size_t size) {
+            DeviceArray<T> array{size};
+            check(cudaMemset(array.get(), 0, size * sizeof(T)), "cudaMemset");
+            return array;
+        }
+
+        template <typename T>
+        DeviceArray<T> copyToDevice(const std::vector<T> &values) {
+            DeviceArray<T> array{values.size()};
+            check(cudaMemcpy(array.get(), values.data(), values.size() * sizeof(T), cudaMemcpyHostToDevice), "cudaMemcpy");
+            return array;
+        }
+
+        template <typename T>
+        void copyToHost(const DeviceArray<T> &array, T *out, size_t size) {
+            check(cudaMemcpy(out, array.get(), size * sizeof(T), cudaMemcpyDeviceToHost), "cudaMemcpy");
+        }
+
+        /** Host column streamed to the device */
+        struct HostColumn {
+            const void *data;
+            size_t width;
+        };
+
+        /** Staging area of one chunk in flight: pinned host buffers, device buffers and the stream working on them */
+        struct Slot {
+            cudaStream_t stream = nullptr;
+            std::vector<void *> pinned;
+            std::vector<void *> device;
+
+            Slot(const std::vector<HostColumn> &columns, uint64_t chunkRows) {
+                check(cudaStreamCreate(&stream), "cudaStreamCreate");
+                for (auto &column : columns) {
+                    void *host = nullptr;
+                    void *buffer = nullptr;
+                    check(cudaMallocHost(&host, chunkRows * column.width), "cudaMallocHost");
+                    pinned.push_back(host);
+                    check(cudaMalloc(&buffer, chunkRows * column.width), "cudaMalloc");
+                    device.push_back(buffer);
+                }
+            }
+            Slot(const Slot &) = delete;
+            Slot &operator=(const Slot &) = delete;
+            ~Slot() {
+                cudaStreamSynchronize(stream);
+                for (auto buffer : pinned) {
+                    cudaFreeHost(buffer);
+                }
+                for (auto buffer : device) {
+                    cudaFree(buffer);
+                }
+                cudaStreamDestroy(stream);
+            }
+        };
+
+        /** Stream the rows [0, count) of the columns to the device in chunks of chunkRows
+         *
+         * Two slots alternate: while the kernels of one chunk run on its slot's stream, the CPU copies the next chunk
+         * from the mapped files into the other slot's pinned buffers, from where the DMA engine moves it to the device.
+         * launch(device buffers, rows, first row, stream) enqueues the kernels of a chunk; drain(slot) runs on the host
+         * once the work of the slot's previous chunk has finished. */
+        template <typename Launch, typename Drain>
+        void streamColumns(const std::vector<HostColumn> &columns, uint64_t count, uint64_t chunkRows, Launch launch, Drain drain) {
+            chunkRows = std::min(chunkRows, std::max<uint64_t>(count, 1));
+            Slot slots[2] = {Slot{columns, chunkRows}, Slot{columns, chunkRows}};
+            bool used[2] = {false, false};
+            uint64_t chunk = 0;
+            for (uint64_t begin = 0; begin < count; begin += chunkRows, chunk++) {
+                auto slotNum = chunk % 2;
+                auto &slot = slots[slotNum];
+                check(cudaStreamSynchronize(slot.stream), "cudaStreamSynchronize");
+                if (used[slotNum]) {
+                    drain(slotNum);
+                }
+                auto rows = std::min(chunkRows, count - begin);
+                for (size_t i = 0; i < columns.size(); i++) {
+                    auto bytes = rows * columns[i].width;
+                    std::memcpy(slot.pinned[i], static_cast<const char *>(columns[i].data) + begin * columns[i].width, bytes);
+                    check(cudaMemcpyAsync(slot.device[i], slot.pinned[i], bytes, cudaMemcpyHostToDevice, slot.stream), "cudaMemcpyAsync");
+                }
+                launch(slot.device, rows, begin, slot.stream);
+                check(cudaGetLastError(), "kernel launch");
+                used[slotNum] = true;
+            }
+            for (size_t slotNum = 0; slotNum < 2; slotNum++) {
+                check(cudaStreamSynchronize(slots[slotNum].stream), "cudaStreamSynchronize");
+                if (used[slotNum]) {
+                    drain(slotNum);
+                }
+            }
+        }
+
+        auto noDrain = [](size_t) {};
+
+        __global__ void valueHistogramKernel(const int64_t *values, uint64_t rows, unsigned long long *buckets) {
+            __shared__ unsigned long long local[valueBucketCount];
+            for (uint32_t i = threadIdx.x; i < valueBucketCount; i += blockDim.x) {
+                local[i] = 0;
+            }
+            __syncthreads();
+            for (uint64_t i = blockIdx.x * uint64_t{blockDim.x} + threadIdx.x; i < rows; i += uint64_t{gridDim.x} * blockDim.x) {
+                atomicAdd(&local[valueBucket(values[i])], 1ULL);
+            }
+            __syncthreads();
+            for (uint32_t i = threadIdx.x; i < valueBucketCount; i += blockDim.x) {
+                if (local[i] > 0) {
+                    atomicAdd(&buckets[i], local[i]);
+                }
+            }
+        }
+
+        __global__ void feeRateHistogramKernel(const int64_t *fees, const uint32_t *virtualSizes, uint64_t rows, unsigned long long *buckets) {
+            __shared__ unsigned long long local[feeRateBucketCount];
+            for (uint32_t i = threadIdx.x; i < feeRateBucketCount; i += blockDim.x) {
+                local[i] = 0;
+            }
+            __syncthreads();
+            for (uint64_t i = blockIdx.x * uint64_t{blockDim.x} + threadIdx.x; i < rows; i += uint64_t{gridDim.x} * blockDim.x) {
+                auto bucket = feeRateBucket(fees[i], virtualSizes[i]);
+                if (bucket < feeRateBucketCount) {
+                    atomicAdd(&local[bucket], 1ULL);
+                }
+            }
+            __syncthreads();
+            for (uint32_t i = threadIdx.x; i < feeRateBucketCount; i += blockDim.x) {
+                if (local[i] > 0) {
+                    atomicAdd(&buckets[i], local[i]);
+                }
+            }
+        }
+
+        /** Bucket of the row, the last bucket starting at or before it */
+        __device__ uint32_t rowBucket(const uint64_t *bucketStarts, uint32_t bucketCount, uint64_t row) {
+            uint32_t low = 0;
+            uint32_t high = bucketCount;
+            while (high - low > 1) {
+                auto mid = low + (high - low) / 2;
+                if (bucketStarts[mid] <= row) {
+                    low = mid;
+                } else {
+                    high = mid;
+                }
+            }
+            return low;
+        }
+
+        /** Each block handles tiles of consecutive rows. Tiles within a single bucket, nearly all of them, are summed in
+         * shared memory and flushed once, the tiles crossing a bucket boundary add every row to global memory */
+        __global__ void typeMixKernel(const int64_t *values, const uint8_t *types, uint64_t rows, uint64_t firstRow, const uint64_t *bucketStarts, uint32_t bucketCount, uint32_t typeCount, unsigned long long *counts, unsigned long long *totals) {
+            extern __shared__ unsigned long long shared[];
+            auto localCounts = shared;
+            auto localTotals = shared + typeCount;
+            constexpr uint64_t rowsPerThread = 16;
+            auto tileRows = uint64_t{blockDim.x} * rowsPerThread;
+            for (uint64_t tile = blockIdx.x * tileRows; tile < rows; tile += uint64_t{gridDim.x} * tileRows) {
+                auto tileEnd = min(tile + tileRows, rows);
+                auto firstBucket = rowBucket(bucketStarts, bucketCount, firstRow + tile);
+                auto lastBucket = rowBucket(bucketStarts, bucketCount, firstRow + tileEnd - 1);
+                if (firstBucket == lastBucket) {
+                    for (uint32_t i = threadIdx.x; i < 2 * typeCount; i += blockDim.x) {
+                        shared[i] = 0;
+                    }
+                    __syncthreads();
+                    for (auto i = tile + threadIdx.x; i < tileEnd; i += blockDim.x) {
+                        atomicAdd(&localCounts[types[i]], 1ULL);
+                        atomicAdd(&localTotals[types[i]], static_cast<unsigned long long>(values[i]));
+                    }
+                    __syncthreads();
+                    for (uint32_t i = threadIdx.x; i < typeCount; i += blockDim.x) {
+                        if (localCounts[i] > 0) {
+                            atomicAdd(&counts[firstBucket * typeCount + i], localCounts[i]);
+                            atomicAdd(&totals[firstBucket * typeCount + i], localTotals[i]);
+                        }
+                    }
+                    __syncthreads();
+                } else {
+                    for (auto i = tile + threadIdx.x; i < tileEnd; i += blockDim.x) {
+                        auto bucket = rowBucket(bucketStarts, bucketCount, firstRow + i);
+                        atomicAdd(&counts[bucket * typeCount + types[i]], 1ULL);
+                        atomicAdd(&totals[bucket * typeCount + types[i]], static_cast<unsigned long long>(values[i]));
+                    }
+                }
+            }
+        }
+
+        __global__ void probeKernel(const uint8_t *types, const uint32_t *addressNums, uint64_t rows, uint64_t firstRow, const uint64_t *table, uint32_t bits, unsigned long long *matches, unsigned long long *matchCount) {
+            for (uint64_t i = blockIdx.x * uint64_t{blockDim.x} + threadIdx.x; i < rows; i += uint64_t{gridDim.x} * blockDim.x) {
+                if (containsKey(table, bits, addressKey(types[i], addressNums[i]))) {
+                    matches[atomicAdd(matchCount, 1ULL)] = firstRow + i;
+                }
+            }
+        }
+    } // namespace
+
+    bool deviceAvailable() {
+        int deviceCount = 0;
+        return cudaGetDeviceCount(&deviceCount) == cudaSuccess && deviceCount > 0;
+    }
+
+    void valueHistogram(const int64_t *values, uint64_t count, uint64_t chunkRows, uint64_t *buckets) {
+        auto deviceBuckets = zeroedArray<unsigned long long>(valueBucketCount);
+        streamColumns({{values, sizeof(int64_t)}}, count, chunkRows, [&](const std::vector<void *> &device, uint64_t rows, uint64_t, cudaStream_t stream) {
+            valueHistogramKernel<<<gridSize(rows), threadsPerBlock, 0, stream>>>(static_cast<const int64_t *>(device[0]), rows, deviceBuckets.get());
+        }, noDrain);
+        copyToHost(deviceBuckets, reinterpret_cast<unsigned long long *>(buckets), valueBucketCount);
+    }
+
+    void typeMix(const int64_t *values, const uint8_t *types, uint64_t count, const std::vector<uint64_t> &bucketStarts, uint32_t typeCount, uint64_t chunkRows, uint64_t *counts, int64_t *totals) {
+        auto bucketCount = static_cast<uint32_t>(bucketStarts.size());
+        auto deviceStarts = copyToDevice(bucketStarts);
+        auto deviceCounts = zeroedArray<unsigned long long>(bucketCount * typeCount);
+        auto deviceTotals = zeroedArray<unsigned long long>(bucketCount * typeCount);
+        auto sharedBytes = 2 * typeCount * sizeof(unsigned long long);
+        streamColumns({{values, sizeof(int64_t)}, {types, sizeof(uint8_t)}}, count, chunkRows, [&](const std::vector<void *> &device, uint64_t rows, uint64_t firstRow, cudaStream_t stream) {
+            auto blocks = static_cast<int>(std::min<uint64_t>((rows + threadsPerBlock * 16 - 1) / (threadsPerBlock * 16), 4096));
+            typeMixKernel<<<blocks, threadsPerBlock, sharedBytes, stream>>>(static_cast<const int64_t *>(device[0]), static_cast<const uint8_t *>(device[1]), rows, firstRow, deviceStarts.get(), bucketCount, typeCount, deviceCounts.get(), deviceTotals.get());
+        }, noDrain);
+        copyToHost(deviceCounts, reinterpret_cast<unsigned long long *>(counts), bucketCount * typeCount);
+        // Totals were summed as two's complement, which gives the signed sums back
+        copyToHost(deviceTotals, reinterpret_cast<unsigned long long *>(totals), bucketCount * typeCount);
+    }
+
+    std::vector<uint64_t> probeAddresses(const uint8_t *types, const uint32_t *addressNums, uint64_t count, const std::vector<uint64_t> &table, uint32_t bits, uint64_t chunkRows) {
+        auto deviceTable = copyToDevice(table);
+        chunkRows = std::min(chunkRows, std::max<uint64_t>(count, 1));
+        // Every slot collects the matches of its chunk, which are read back before the slot is reused
+        DeviceArray<unsigned long long> slotMatches[2] = {DeviceArray<unsigned long long>{chunkRows}, DeviceArray<unsigned long long>{chunkRows}};
+        auto slotCounts = zeroedArray<unsigned long long>(2);
+        std::vector<uint64_t> matches;
+        uint64_t chunk = 0;
+        streamColumns({{types, sizeof(uint8_t)}, {addressNums, sizeof(uint32_t)}}, count, chunkRows, [&](const std::vector<void *> &device, uint64_t rows, uint64_t firstRow, cudaStream_t stream) {
+            auto slotNum = chunk++ % 2;
+            probeKernel<<<gridSize(rows), threadsPerBlock, 0, stream>>>(static_cast<const uint8_t *>(device[0]), static_cast<const uint32_t *>(device[1]), rows, firstRow, deviceTable.get(), bits, slotMatches[slotNum].get(), slotCounts.get() + slotNum);
+        }, [&](size_t slotNum) {
+            unsigned long long matchCount = 0;
+            check(cudaMemcpy(&matchCount, slotCounts.get() + slotNum, sizeof(matchCount), cudaMemcpyDeviceToHost), "cudaMemcpy");
+            auto offset = matches.size();
+            matches.resize(offset + matchCount);
+            check(cudaMemcpy(matches.data() + offset, slotMatches[slotNum].get(), matchCount * sizeof(uint64_t), cudaMemcpyDeviceToHost), "cudaMemcpy");
+            check(cudaMemset(slotCounts.get() + slotNum, 0, sizeof(matchCount)), "cudaMemset");
+        });
+        // Matches within a chunk are in the order the threads found them
+        std::sort(matches.begin(), matches.end());
+        return matches;
+    }
+
+    void feeRateHistogram(const int64_t *fees, const uint32_t *virtualSizes, uint64_t count, uint64_t chunkRows, uint64_t *buckets) {
+        auto deviceBuckets = zeroedArray<unsigned long long>(feeRateBucketCount);
+        streamColumns({{fees, sizeof(int64_t)}, {virtualSizes, sizeof(uint32_t)}}, count, chunkRows, [&](const std::vector<void *> &device, uint64_t rows, uint64_t, cudaStream_t stream) {
+            feeRateHistogramKernel<<<gridSize(rows), threadsPerBlock, 0, stream>>>(static_cast<const int64_t *>(device[0]), static_cast<const uint32_t *>(device[1]), rows, deviceBuckets.get());
+        }, noDrain);
+        copyToHost(deviceBuckets, reinterpret_cast<unsigned long long *>(buckets), feeRateBucketCount);
+    }
+}}} // namespace blocksci::bulk_scan::cuda
@@ -0,0 +1,122 @@
+//
+//  bulk_scan_kernels.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_chain_bulk_scan_kernels_hpp
+#define blocksci_chain_bulk_scan_kernels_hpp
+
+// Shared by bulk_scan.cpp and bulk_scan_cuda.cu, so that both backends bucket and hash exactly the same way
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifdef __CUDACC__
+#define BLOCKSCI_HOST_DEVICE __host__ __device__
+#else
+#define BLOCKSCI_HOST_DEVICE
+#endif
+
+namespace blocksci { namespace bulk_scan {
+    constexpr uint32_t valueBucketCount = 64;
+
+    /** Fee rate buckets per doubling and the range they cover, plus one bucket below and one above the range */
+    constexpr uint32_t feeRateBucketsPerOctave = 64;
+    constexpr int32_t feeRateMinExponent = -8;
+    constexpr int32_t feeRateMaxExponent = 24;
+    constexpr uint32_t feeRateBucketCount = feeRateBucketsPerOctave * static_cast<uint32_t>(feeRateMaxExponent - feeRateMinExponent) + 2;
+
+    /** Key of the address of an output in the watch list table, never equal to emptyKey */
+    constexpr uint64_t emptyKey = ~uint64_t{0};
+
+    BLOCKSCI_HOST_DEVICE inline uint32_t valueBucket(int64_t value) {
+        uint32_t bucket = 0;
+        auto remaining = static_cast<uint64_t>(value > 0 ? value : 0);
+        while (remaining > 0) {
+            bucket++;
+            remaining >>= 1;
+        }
+        return bucket;
+    }
+
+    /** Bucket of the fee rate, or feeRateBucketCount for transactions without a fee */
+    BLOCKSCI_HOST_DEVICE inline uint32_t feeRateBucket(int64_t fee, uint32_t virtualSize) {
+        if (fee <= 0 || virtualSize == 0) {
+            return feeRateBucketCount;
+        }
+        auto position = (std::log2(static_cast<double>(fee) / static_cast<double>(virtualSize)) - feeRateMinExponent) * feeRateBucketsPerOctave;
+        if (position < 0) {
+            return 0;
+        }
+        if (position >= feeRateBucketCount - 2) {
+            return feeRateBucketCount - 1;
+        }
+        return static_cast<uint32_t>(position) + 1;
+    }
+
+    BLOCKSCI_HOST_DEVICE inline uint64_t addressKey(uint8_t type, uint32_t addressNum) {
+        return (uint64_t{type} << 32) | addressNum;
+    }
+
+    /** First slot to probe for the key in an open addressing table of 2^bits slots */
+    BLOCKSCI_HOST_DEVICE inline uint64_t keySlot(uint64_t key, uint32_t bits) {
+        key ^= key >> 31;
+        key *= 0x7FB5D329728EA185ULL;
+        key ^= key >> 27;
+        return key >> (64 - bits);
+    }
+
+    /** Open addressing table with linear probing of the keys, sized to at most half full */
+    inline std::vector<uint64_t> buildKeyTable(const std::vector<uint64_t> &keys, uint32_t &bits) {
+        bits = 4;
+        while ((uint64_t{1} << bits) < keys.size() * 2) {
+            bits++;
+        }
+        std::vector<uint64_t> table(uint64_t{1} << bits, emptyKey);
+        auto mask = table.size() - 1;
+        for (auto key : keys) {
+            auto slot = keySlot(key, bits);
+            while (table[slot] != emptyKey && table[slot] != key) {
+                slot = (slot + 1) & mask;
+            }
+            table[slot] = key;
+        }
+        return table;
+    }
+
+    BLOCKSCI_HOST_DEVICE inline bool containsKey(const uint64_t *table, uint32_t bits, uint64_t key) {
+        auto mask = (uint64_t{1} << bits) - 1;
+        auto slot = keySlot(key, bits);
+        while (table[slot] != emptyKey) {
+            if (table[slot] == key) {
+                return true;
+            }
+            slot = (slot + 1) & mask;
+        }
+        return false;
+    }
+
+#ifdef BLOCKSCI_WITH_CUDA
+    namespace cuda {
+        /** Whether a CUDA device can be used */
+        bool deviceAvailable();
+
+        /** The kernels stream the columns to the device in chunks of chunkRows and accumulate into the given results */
+        void valueHistogram(const int64_t *values, uint64_t count, uint64_t chunkRows, uint64_t *buckets);
+
+        /** counts and values are bucketCount x typeCount, bucketStarts holds the first row of every bucket */
+        void typeMix(const int64_t *values, const uint8_t *types, uint64_t count, const std::vector<uint64_t> &bucketStarts, uint32_t typeCount, uint64_t chunkRows, uint64_t *counts, int64_t *totals);
+
+        /** Rows whose address is in the table built by buildKeyTable, in ascending order */
+        std::vector<uint64_t> probeAddresses(const uint8_t *types, const uint32_t *addressNums, uint64_t count, const std::vector<uint64_t> &table, uint32_t bits, uint64_t chunkRows);
+
+        void feeRateHistogram(const int64_t *fees, const uint32_t *virtualSizes, uint64_t count, uint64_t chunkRows, uint64_t *buckets);
+    } // namespace cuda
+#endif
+}} // namespace blocksci::bulk_scan
+
+#endif /* blocksci_chain_bulk_scan_kernels_hpp */
@@ -0,0 +1,382 @@
+//
+//  chain_table.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include <blocksci/chain/chain_table.hpp>
+#include <blocksci/chain/algorithms.hpp>
+#include <blocksci/chain/block.hpp>
+#include <blocksci/chain/block_range.hpp>
+#include <blocksci/chain/input.hpp>
+#include <blocksci/chain/output.hpp>
+#include <blocksci/chain/transaction.hpp>
+#include <blocksci/address/address.hpp>
+#include <blocksci/core/bitcoin_uint256.hpp>
+#include <blocksci/core/raw_block.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace blocksci {
+
+    size_t tableColumnElementSize(TableColumnType type) {
+        switch (type) {
+            case TableColumnType::Int64: return sizeof(int64_t);
+            case TableColumnType::Int32: return sizeof(int32_t);
+            case TableColumnType::UInt32: return sizeof(uint32_t);
+            case TableColumnType::UInt16: return sizeof(uint16_t);
+            case TableColumnType::UInt8: return sizeof(uint8_t);
+            case TableColumnType::Bool: return sizeof(uint8_t);
+            case TableColumnType::Hash: return 32;
+        }
+        throw std::invalid_argument("Unknown table column type");
+    }
+
+    namespace {
+        template <typename T>
+        void store(uint8_t *out, T value) {
+            std::memcpy(out, &value, sizeof(T));
+        }
+
+        void storeHash(uint8_t *out, const uint256 &hash) {
+            std::memcpy(out, hash.begin(), 32);
+        }
+
+        template <typename Row>
+        struct ColumnDef {
+            const char *name;
+            TableColumnType type;
+            void (*write)(const Row &row, uint8_t *out);
+        };
+
+        const std::vector<ColumnDef<Block>> &blockColumns() {
+            static const std::vector<ColumnDef<Block>> columns = {
+                {"height", TableColumnType::Int32, +[](const Block &b, uint8_t *out) { store<int32_t>(out, b.height()); }},
+                {"hash", TableColumnType::Hash, +[](const Block &b, uint8_t *out) { storeHash(out, b.getHash()); }},
+                {"timestamp", TableColumnType::UInt32, +[](const Block &b, uint8_t *out) { store<uint32_t>(out, b.timestamp()); }},
+                {"version", TableColumnType::Int32, +[](const Block &b, uint8_t *out) { store<int32_t>(out, b.version()); }},
+                {"bits", TableColumnType::UInt32, +[](const Block &b, uint8_t *out) { store<uint32_t>(out, b.bits()); }},
+                {"nonce", TableColumnType::UInt32, +[](const Block &b, uint8_t *out) { store<uint32_t>(out, b.nonce()); }},
+                {"base_size", TableColumnType::UInt32, +[](const Block &b, uint8_t *out) { store<uint32_t>(out, b.baseSize()); }},
+                {"total_size", TableColumnType::UInt32, +[](const Block &b, uint8_t *out) { store<uint32_t>(out, b.totalSize()); }},
+                {"weight", TableColumnType::UInt32, +[](const Block &b, uint8_t *out) { store<uint32_t>(out, b.weight()); }},
+                {"tx_count", TableColumnType::UInt32, +[](const Block &b, uint8_t *out) { store<uint32_t>(out, static_cast<uint32_t>(b.size())); }},
+                {"input_count", TableColumnType::UInt32, +[](const Block &b, uint8_t *out) { store<uint32_t>(out, static_cast<uint32_t>(inputCount(b))); }},
+                {"output_count", TableColumnType::UInt32, +[](const Block &b, uint8_t *out) { store<uint32_t>(out, static_cast<uint32_t>(outputCount(b))); }},
+                {"output_value", TableColumnType::Int64, +[](const Block &b, uint8_t *out) { store<int64_t>(out, totalOutputValue(b)); }},
+                {"fee", TableColumnType::Int64, +[](const Block &b, uint8_t *out) {
+                    int64_t total = 0;
+                    for (auto tx : b) {
+                        total += tx.fee();
+                    }
+                    store<int64_t>(out, total);
+                }}
+            };
+            return columns;
+        }
+
+        const std::vector<ColumnDef<Transaction>> &txColumns() {
+            static const std::vector<ColumnDef<Transaction>> columns = {
+                {"index", TableColumnType::UInt32, +[](const Transaction &tx, uint8_t *out) { store<uint32_t>(out, tx.txNum); }},
+                {"block_height", TableColumnType::Int32, +[](const Transaction &tx, uint8_t *out) { store<int32_t>(out, tx.getBlockHeight()); }},
+                {"hash", TableColumnType::Hash, +[](const Transaction &tx, uint8_t *out) { storeHash(out, tx.getHash()); }},
+                {"version", TableColumnType::Int32, +[](const Transaction &tx, uint8_t *out) { store<int32_t>(out, tx.getVersion()); }},
+                {"locktime", TableColumnType::UInt32, +[](const Transaction &tx, uint8_t *out) { store<uint32_t>(out, tx.locktime()); }},
+                {"base_size", TableColumnType::UInt32, +[](const Transaction &tx, uint8_t *out) { store<uint32_t>(out, tx.baseSize()); }},
+                {"total_size", TableColumnType::UInt32, +[](const Transaction &tx, uint8_t *out) { store<uint32_t>(out, tx.totalSize()); }},
+                {"virtual_size", TableColumnType::UInt32, +[](const Transaction &tx, uint8_t *out) { store<uint32_t>(out, tx.virtualSize()); }},
+                {"input_count", TableColumnType::UInt16, +[](const Transaction &tx, uint8_t *out) { store<uint16_t>(out, tx.inputCount()); }},
+                {"output_count", TableColumnType::UInt16, +[](const Transaction &tx, uint8_t *out) { store<uint16_t>(out, tx.outputCount()); }},
+                {"input_value", TableColumnType::Int64, +[](const Transaction &tx, uint8_t *out) { store<int64_t>(out, totalInputValue(tx)); }},
+                {"output_value", TableColumnType::Int64, +[](const Transaction &tx, uint8_t *out) { store<int64_t>(out, totalOutputValue(tx)); }},
+                {"fee", TableColumnType::Int64, +[](const Transaction &tx, uint8_t *out) { store<int64_t>(out, tx.fee()); }},
+                {"is_coinbase", TableColumnType::Bool, +[](const Transaction &tx, uint8_t *out) { store<uint8_t>(out, tx.isCoinbase()); }}
+            };
+            return columns;
+        }
+
+        const std::vector<ColumnDef<Input>> &inputColumns() {
+            static const std::vector<ColumnDef<Input>> columns = {
+                {"tx_index", TableColumnType::UInt32, +[](const Input &input, uint8_t *out) { store<uint32_t>(out, input.txIndex()); }},
+                {"input_index", TableColumnType::UInt16, +[](const Input &input, uint8_t *out) { store<uint16_t>(out, static_cast<uint16_t>(input.inputIndex())); }},
+                {"block_height", TableColumnType::Int32, +[](const Input &input, uint8_t *out) { store<int32_t>(out, input.blockHeight); }},
+                {"value", TableColumnType::Int64, +[](const Input &input, uint8_t *out) { store<int64_t>(out, input.getValue()); }},
+                {"address_type", TableColumnType::UInt8, +[](const Input &input, uint8_t *out) { store<uint8_t>(out, static_cast<uint8_t>(input.getType())); }},
+                {"address_num", TableColumnType::UInt32, +[](const Input &input, uint8_t *out) { store<uint32_t>(out, input.getAddress().scriptNum); }},
+                {"sequence", TableColumnType::UInt32, +[](const Input &input, uint8_t *out) { store<uint32_t>(out, input.sequenceNumber()); }},
+                {"spent_tx_index", TableColumnType::UInt32, +[](const Input &input, uint8_t *out) { store<uint32_t>(out, input.spentTxIndex()); }},
+                {"spent_output_index", TableColumnType::UInt16, +[](const Input &input, uint8_t *out) { store<uint16_t>(out, static_cast<uint16_t>(input.getSpentOutputPointer().inoutNum)); }},
+                {"spent_height", TableColumnType::Int32, +[](const Input &input, uint8_t *out) { store<int32_t>(out, input.getSpentBlockHeight()); }},
+                {"age", TableColumnType::Int32, +[](const Input &input, uint8_t *out) { store<int32_t>(out, input.age()); }}
+            };
+            return columns;
+        }
+
+        const std::vector<ColumnDef<Output>> &outputColumns() {
+            static const std::vector<ColumnDef<Output>> columns = {
+                {"tx_index", TableColumnType::UInt32, +[](const Output &output, uint8_t *out) { store<uint32_t>(out, output.txIndex()); }},
+                {"output_index", TableColumnType::UInt16, +[](const Output &output, uint8_t *out) { store<uint16_t>(out, static_cast<uint16_t>(output.outputIndex())); }},
+                {"block_height", TableColumnType::Int32, +[](const Output &output, uint8_t *out) { store<int32_t>(out, output.getBlockHeight()); }},
+                {"value", TableColumnType::Int64, +[](const Output &output, uint8_t *out) { store<int64_t>(out, output.getValue()); }},
+                {"address_type", TableColumnType::UInt8, +[](const Output &output, uint8_t *out) { store<uint8_t>(out, static_cast<uint8_t>(output.getType())); }},
+                {"address_num", TableColumnType::UInt32, +[](const Output &output, uint8_t *out) { store<uint32_t>(out, output.getAddress().scriptNum); }},
+                {"is_spent", TableColumnType::Bool, +[](const Output &output, uint8_t *out) { store<uint8_t>(out, output.isSpent()); }},
+                {"spending_tx_index", TableColumnType::Int64, +[](const Output &output, uint8_t *out) {
+                    auto spending = output.getSpendingTxIndex();
+                    store<int64_t>(out, spending ? static_cast<int64_t>(*spending) : -1);
+                }},
+                {"spent_height", TableColumnType::Int32, +[](const Output &output, uint8_t *out) {
+                    auto height = output.getSpendingBlockHeight();
+                    store<int32_t>(out, height ? *height : -1);
+                }}
+            };
+            return columns;
+        }
+
+        template <typename Row>
+        std::vector<const ColumnDef<Row> *> selectColumns(const std::vector<ColumnDef<Row>> &defs, const std::vector<std::string> &names) {
+            std::vector<const ColumnDef<Row> *> selected;
+            if (names.empty()) {
+                for (auto &def : defs) {
+                    selected.push_back(&def);
+                }
+                return selected;
+            }
+            for (auto &name : names) {
+                auto it = std::find_if(defs.begin(), defs.end(), [&](const ColumnDef<Row> &def) { return name == def.name; });
+                if (it == defs.end()) {
+                    throw std::invalid_argument("Unknown table column " + name);
+                }
+                selected.push_back(&*it);
+            }
+            return selected;
+        }
+
+        template <typename Row>
+        std::vector<std::string> columnNames(const std::vector<ColumnDef<Row>> &defs) {
+            std::vector<std::string> names;
+            for (auto &def : defs) {
+                names.emplace_back(def.name);
+            }
+            return names;
+        }
+
+        /** Fill the selected columns for every row, forEachRow(chunk, visit) calls visit for the rows of a chunk in order */
+        template <typename Row, typename ForEachRow>
+        std::vector<ChainTableColumn> fillColumns(BlockRange &range, const std::vector<const ColumnDef<Row> *> &defs, ForEachRow forEachRow) {
+            std::vector<size_t> elementSizes;
+            for (auto def : defs) {
+                elementSizes.push_back(tableColumnElementSize(def->type));
+            }
+
+            auto chunks = range.segment(range.chunkCount());
+            // chunkData[chunk][column]
+            std::vector<std::vector<std::vector<uint8_t>>> chunkData(chunks.size(), std::vector<std::vector<uint8_t>>(defs.size()));
+            range.runChunks(static_cast<uint32_t>(chunks.size()), [&](uint32_t chunkNum) {
+                auto &chunk = chunks[chunkNum];
+                chunk.checkReorg();
+                chunk.adviseAccess(AccessHint::WillNeed);
+                auto &data = chunkData[chunkNum];
+                forEachRow(chunk, [&](const Row &row) {
+                    for (size_t i = 0; i < defs.size(); i++) {
+                        auto offset = data[i].size();
+                        data[i].resize(offset + elementSizes[i]);
+                        defs[i]->write(row, data[i].data() + offset);
+                    }
+                });
+            });
+
+            std::vector<ChainTableColumn> columns;
+            for (size_t i = 0; i < defs.size(); i++) {
+                size_t total = 0;
+                for (auto &data : chunkData) {
+                    total += data[i].size();
+                }
+                ChainTableColumn column{defs[i]->name, defs[i]->type, {}};
+                if (chunkData.size() == 1) {
+                    column.data = std::move(chunkData[0][i]);
+                } else {
+                    column.data.reserve(total);
+                    for (auto &data : chunkData) {
+                        column.data.insert(column.data.end(), data[i].begin(), data[i].end());
+                        std::vector<uint8_t>().swap(data[i]);
+                    }
+                }
+                columns.push_back(std::move(column));
+            }
+            return columns;
+        }
+    } // namespace
+
+    std::vector<std::string> chainTableColumns(ChainTable table) {
+        switch (table) {
+            case ChainTable::Blocks: return columnNames(blockColumns());
+            case ChainTable::Transactions: return columnNames(txColumns());
+            case ChainTable::Inputs: return columnNames(inputColumns());
+            case ChainTable::Outputs: return columnNames(outputColumns());
+        }
+        throw std::invalid_argument("Unknown chain table");
+    }
+
+    std::vector<ChainTableColumn> buildChainTable(BlockRange &range, ChainTable table, const std::vector<std::string> &columns) {
+        switch (table) {
+            case ChainTable::Blocks:
+                return fillColumns<Block>(range, selectColumns(blockColumns(), columns), [](BlockRange &chunk, auto &&visit) {
+                    for (auto block : chunk) {
+                        visit(block);
+                    }
+                });
+            case ChainTable::Transactions:
+                return fillColumns<Transaction>(range, selectColumns(txColumns(), columns), [](BlockRange &chunk, auto &&visit) {
+                    for (auto block : chunk) {
+                        for (auto tx : block) {
+                            visit(tx);
+                        }
+                    }
+                });
+            case ChainTable::Inputs:
+                return fillColumns<Input>(range, selectColumns(inputColumns(), columns), [](BlockRange &chunk, auto &&visit) {
+                    for (auto block : chunk) {
+                        for (auto tx : block) {
+                            for (auto input : tx.inputs()) {
+                                visit(input);
+                            }
+                        }
+                    }
+                });
+            case ChainTable::Outputs:
+                return fillColumns<Output>(range, selectColumns(outputColumns(), columns), [](BlockRange &chunk, auto &&visit) {
+                    for (auto block : chunk) {
+                        for (auto tx : block) {
+                            for (auto output : tx.outputs()) {
+                                visit(output);
+                            }
+                        }
+                    }
+                });
+        }
+        throw std::invalid_argument("Unknown chain table");
+    }
+
+    struct ChainTableStream::Impl {
+        BlockRange range;
+        ChainTable table;
+        std::vector<std::string> columns;
+        uint64_t batchRows;
+        size_t prefetch;
+
+        std::mutex mutex;
+        std::condition_variable produced;
+        std::condition_variable consumed;
+        std::deque<ChainTableBatch> ready;
+        std::exception_ptr error;
+        bool done = false;
+        bool stopping = false;
+
+        std::thread producer;
+
+        Impl(const BlockRange &range_, ChainTable table_, std::vector<std::string> columns_, uint64_t batchRows_, size_t prefetch_) : range(range_), table(table_), columns(std::move(columns_)), batchRows(batchRows_), prefetch(std::max<size_t>(prefetch_, 1)) {
+            if (batchRows == 0) {
+                throw std::invalid_argument("Batches must hold at least one row");
+            }
+            auto names = chainTableColumns(table);
+            for (auto &name : columns) {
+                if (std::find(names.begin(), names.end(), name) == names.end()) {
+                    throw std::invalid_argument("Unknown table column " + name);
+                }
+            }
+            producer = std::thread([this]() { produce(); });
+        }
+
+        ~Impl() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            consumed.notify_all();
+            producer.join();
+        }
+
+        uint64_t rowCount(const RawBlock &block) const {
+            switch (table) {
+                case ChainTable::Blocks: return 1;
+                case ChainTable::Transactions: return block.txCount;
+                case ChainTable::Inputs: return block.inputCount;
+                case ChainTable::Outputs: return block.outputCount;
+            }
+            return 1;
+        }
+
+        void produce() {
+            try {
+                auto &chain = range.getAccess().getChain();
+                auto height = range.sl.start;
+                while (height < range.sl.stop) {
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        consumed.wait(lock, [&]() { return stopping || ready.size() < prefetch; });
+                        if (stopping) {
+                            return;
+                        }
+                    }
+                    // The block counts give the rows of a batch without reading its txes
+                    auto stop = height;
+                    uint64_t rows = 0;
+                    do {
+                        rows += rowCount(*chain.getBlock(stop));
+                        stop++;
+                    } while (stop < range.sl.stop && rows + rowCount(*chain.getBlock(stop)) <= batchRows);
+                    auto blocks = range[{height - range.sl.start, stop - range.sl.start}];
+                    ChainTableBatch batch{height, stop, buildChainTable(blocks, table, columns)};
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        ready.push_back(std::move(batch));
+                    }
+                    produced.notify_one();
+                    height = stop;
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                error = std::current_exception();
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                done = true;
+            }
+            produced.notify_one();
+        }
+    };
+
+    ChainTableStream::ChainTableStream(const BlockRange &range, ChainTable table, std::vector<std::string> columns, uint64_t batchRows, size_t prefetch) : impl(std::make_unique<Impl>(range, table, std::move(columns), batchRows, prefetch)) {}
+
+    ChainTableStream::~ChainTableStream() = default;
+
+    ranges::optional<ChainTableBatch> ChainTableStream::next() {
+        std::unique_lock<std::mutex> lock(impl->mutex);
+        impl->produced.wait(lock, [&]() { return !impl->ready.empty() || impl->done; });
+        if (!impl->ready.empty()) {
+            auto batch = std::move(impl->ready.front());
+            impl->ready.pop_front();
+            lock.unlock();
+            impl->consumed.notify_one();
+            return batch;
+        }
+        if (impl->error) {
+            auto error = impl->error;
+            impl->error = nullptr;
+            std::rethrow_exception(error);
+        }
+        return ranges::nullopt;
+    }
+} // namespace blocksci
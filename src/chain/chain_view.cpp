@@ -0,0 +1,88 @@
+//
+//  chain_view.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include <blocksci/chain/chain_view.hpp>
+#include <blocksci/address/address.hpp>
+#include <blocksci/cluster/cluster.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+#include <internal/segment_work.hpp>
+
+#include <range/v3/range_for.hpp>
+
+#include <stdexcept>
+#include <string>
+
+namespace blocksci {
+    namespace {
+        uint32_t endTxOfHeight(BlockHeight height, DataAccess &access) {
+            if (height <= 0) {
+                return 0;
+            }
+            auto block = access.getChain().getBlock(height - 1);
+            return block->firstTxIndex + block->txCount;
+        }
+    } // namespace
+
+    ChainView::ChainView(BlockHeight height, DataAccess *access_) : BlockRange{{0, height}, access_}, txBound(0) {
+        if (height < 0 || height > access_->getChain().blockCount()) {
+            throw std::out_of_range("Cannot view the chain at height " + std::to_string(height) + ", it has " + std::to_string(access_->getChain().blockCount()) + " blocks");
+        }
+        txBound = endTxOfHeight(height, *access_);
+    }
+
+    bool ChainView::containsAddress(const Address &address) const {
+        return address.scriptNum > 0 && address.getFirstTxIndex() < txBound;
+    }
+
+    std::vector<Output> ChainView::outputs(const Address &address) const {
+        std::vector<Output> result;
+        if (!containsAddress(address)) {
+            return result;
+        }
+        RANGES_FOR(auto pointer, address.getOutputPointers()) {
+            if (pointer.txNum < txBound) {
+                result.emplace_back(pointer, address.getAccess());
+            }
+        }
+        return result;
+    }
+
+    int64_t ChainView::balance(const Address &address) const {
+        int64_t total = 0;
+        for (auto &output : outputs(address)) {
+            auto spendingTx = output.getSpendingTxIndex();
+            if (!spendingTx || *spendingTx >= txBound) {
+                total += output.getValue();
+            }
+        }
+        return total;
+    }
+
+    std::vector<int64_t> ChainView::balances(const std::vector<Address> &addresses, uint32_t threadCount) const {
+        std::vector<int64_t> result(addresses.size());
+        segmentWork(0, static_cast<uint32_t>(addresses.size()), resolveThreadCount(threadCount), [&](uint32_t i) {
+            result[i] = balance(addresses[i]);
+        });
+        return result;
+    }
+
+    std::vector<Address> ChainView::clusterAddresses(const Cluster &cluster) const {
+        std::vector<Address> result;
+        RANGES_FOR(auto address, cluster.getAddresses()) {
+            if (containsAddress(address)) {
+                result.push_back(address);
+            }
+        }
+        return result;
+    }
+
+    int64_t ChainView::clusterBalance(const Cluster &cluster) const {
+        return cluster.calculateBalanceBeforeTx(txBound);
+    }
+} // namespace blocksci
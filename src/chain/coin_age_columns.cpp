@@ -0,0 +1,56 @@
+//
+//  coin_age_columns.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include <blocksci/chain/coin_age_columns.hpp>
+#include <blocksci/chain/block_range.hpp>
+#include <blocksci/chain/transaction.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+
+#include <stdexcept>
+
+namespace blocksci {
+    namespace {
+        /** Blockchain-wide number of the first input of the tx, the number of loaded inputs for the tx past the chain */
+        uint64_t firstInputOfTx(const ChainAccess &chain, uint32_t txNum) {
+            return txNum < chain.txCount() ? chain.getFirstInputNumber(txNum) : chain.inputCount();
+        }
+    }
+
+    bool hasCoinAgeColumns(DataAccess &access) {
+        auto &chain = access.getChain();
+        return chain.inputAgeColumnsSize() >= chain.inputCount() && chain.blockCoinAgeSize() >= chain.blockCount();
+    }
+
+    InputAgeColumns inputAgeColumns(const Transaction &tx) {
+        auto &chain = tx.getAccess().getChain();
+        auto begin = chain.getFirstInputNumber(tx.txNum);
+        return chain.getInputAgeColumns(begin, begin + tx.inputCount());
+    }
+
+    InputAgeColumns inputAgeColumns(BlockRange &blocks) {
+        if (blocks.size() == 0) {
+            return {};
+        }
+        auto &chain = blocks.getAccess().getChain();
+        return chain.getInputAgeColumns(firstInputOfTx(chain, blocks.firstTxIndex()), firstInputOfTx(chain, blocks.endTxIndex()));
+    }
+
+    std::vector<BlockCoinAge> blockCoinAges(BlockRange &blocks) {
+        auto &chain = blocks.getAccess().getChain();
+        if (blocks.sl.stop > chain.blockCoinAgeSize()) {
+            throw std::runtime_error("Coin age columns do not cover the requested blocks, run blocksci_parser build-output-columns");
+        }
+        std::vector<BlockCoinAge> ages;
+        ages.reserve(static_cast<size_t>(blocks.size()));
+        for (auto height = blocks.sl.start; height < blocks.sl.stop; height++) {
+            ages.push_back(*chain.getBlockCoinAge(height));
+        }
+        return ages;
+    }
+} // namespace blocksci
@@ -0,0 +1,89 @@
+//
+//  column_data.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include <blocksci/chain/column_data.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+#include <internal/segment_work.hpp>
+
+#include <stdexcept>
+
+namespace blocksci {
+    ColumnData columnData(ChainColumn column, DataAccess &access) {
+        return access.getChain().getColumnData(column);
+    }
+    
+    InputSignatureColumn inputSignatureColumn(BlockHeight start, BlockHeight stop, DataAccess &access) {
+        auto &chain = access.getChain();
+        auto blockCount = static_cast<BlockHeight>(chain.blockCount());
+        if (start < 0 || stop > blockCount || start > stop) {
+            throw std::out_of_range("Block range is not part of the chain");
+        }
+        auto firstInputOf = [&](BlockHeight height) -> uint64_t {
+            if (height == blockCount) {
+                return chain.inputCount();
+            }
+            return chain.getFirstInputNumber(chain.getBlock(height)->firstTxIndex);
+        };
+        auto firstInput = firstInputOf(start);
+        auto endInput = firstInputOf(stop);
+        if (firstInput < chain.inputSignaturesBegin() || endInput > chain.inputSignaturesEnd()) {
+            throw std::runtime_error("Input signatures do not cover the blocks, enable extractSignatures in the parser config before parsing them");
+        }
+        InputSignatureColumn column;
+        column.firstInput = firstInput;
+        column.count = endInput - firstInput;
+        column.data = column.count > 0 ? chain.getInputSignature(firstInput) : nullptr;
+        return column;
+    }
+    
+    WitnessSizeColumn witnessSizeColumn(BlockHeight start, BlockHeight stop, DataAccess &access, uint32_t threadCount) {
+        auto &chain = access.getChain();
+        auto blockCount = static_cast<BlockHeight>(chain.blockCount());
+        if (start < 0 || stop > blockCount || start > stop) {
+            throw std::out_of_range("Block range is not part of the chain");
+        }
+        auto firstTxOf = [&](BlockHeight height) -> uint32_t {
+            if (height == blockCount) {
+                return static_cast<uint32_t>(chain.txCount());
+            }
+            return chain.getBlock(height)->firstTxIndex;
+        };
+        auto firstInputOf = [&](uint32_t txNum) -> uint64_t {
+            if (txNum == chain.txCount()) {
+                return chain.inputCount();
+            }
+            return chain.getFirstInputNumber(txNum);
+        };
+        auto firstTx = firstTxOf(start);
+        auto endTx = firstTxOf(stop);
+        if (firstTx < endTx && (firstTx < chain.witnessesBegin() || endTx > chain.witnessesEnd())) {
+            throw std::runtime_error("Witnesses do not cover the blocks, enable recordWitnesses in the parser config before parsing them");
+        }
+        
+        WitnessSizeColumn column;
+        column.firstInput = firstInputOf(firstTx);
+        auto inputCount = firstInputOf(endTx) - column.firstInput;
+        column.itemCounts.resize(inputCount);
+        column.serializedSizes.resize(inputCount);
+        auto hasItemData = chain.witnessesHaveItemData();
+        runSegments(splitSegments(firstTx, endTx, resolveThreadCount(threadCount)), [&](uint32_t, uint32_t segmentStart, uint32_t segmentEnd) {
+            for (uint32_t txNum = segmentStart; txNum < segmentEnd; txNum++) {
+                auto inputNum = firstInputOf(txNum) - column.firstInput;
+                auto txInputCount = chain.getTx(txNum)->inputCount;
+                auto witness = chain.getTxWitnesses(txNum);
+                for (uint16_t i = 0; i < txInputCount; i++) {
+                    column.itemCounts[inputNum + i] = witness->itemCount;
+                    column.serializedSizes[inputNum + i] = witness->serializedSize;
+                    witness = witness->next(hasItemData);
+                }
+            }
+        });
+        return column;
+    }
+} // namespace blocksci
@@ -0,0 +1,199 @@
+//
+//  column_filter.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include <blocksci/chain/column_filter.hpp>
+#include <blocksci/chain/block_range.hpp>
+#include <blocksci/chain/output_columns.hpp>
+#include <blocksci/chain/tx_fee_columns.hpp>
+#include <blocksci/address/address.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/chain_numbering.hpp>
+#include <internal/data_access.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace blocksci {
+    namespace {
+        using Column = ColumnFilter::Column;
+
+        /** Intersection of the bounds of the filter on one column */
+        struct Interval {
+            int64_t min = std::numeric_limits<int64_t>::min();
+            int64_t max = std::numeric_limits<int64_t>::max();
+
+            bool empty() const {
+                return min > max;
+            }
+
+            bool bounded() const {
+                return min != std::numeric_limits<int64_t>::min() || max != std::numeric_limits<int64_t>::max();
+            }
+
+            bool contains(int64_t value) const {
+                return value >= min && value <= max;
+            }
+        };
+
+        Interval columnInterval(const ColumnFilter &filter, Column column) {
+            Interval interval;
+            for (auto &bound : filter.bounds) {
+                if (bound.column == column) {
+                    interval.min = std::max(interval.min, bound.min);
+                    interval.max = std::min(interval.max, bound.max);
+                }
+            }
+            return interval;
+        }
+
+        /** The blocks of the range with a height in the interval */
+        BlockRange restrictHeights(BlockRange &blocks, const Interval &heights) {
+            auto start = std::max<int64_t>(blocks.sl.start, heights.min);
+            auto stop = std::min<int64_t>(blocks.sl.stop, heights.max == std::numeric_limits<int64_t>::max() ? heights.max : heights.max + 1);
+            if (start >= stop) {
+                return blocks[{0, 0}];
+            }
+            return blocks[{static_cast<BlockHeight>(start - blocks.sl.start), static_cast<BlockHeight>(stop - blocks.sl.start)}];
+        }
+
+        /** Append the outputs of the chunk with a value and type in the intervals, read from the output columns */
+        void scanOutputColumns(BlockRange &chunk, const Interval &values, const Interval &types, std::vector<OutputPointer> &matches) {
+            auto columns = outputColumns(chunk);
+            std::vector<uint64_t> outputNums;
+            for (uint64_t i = 0; i < columns.count; i++) {
+                if (values.contains(columns.values[i]) && types.contains(columns.types[i])) {
+                    outputNums.push_back(columns.firstOutputNum + i);
+                }
+            }
+            matches = outputPointers(chunk.getAccess().getChain(), outputNums);
+        }
+
+        /** Same as scanOutputColumns for chains without output columns, reading the outputs of every tx */
+        void scanOutputs(BlockRange &chunk, const Interval &values, const Interval &types, std::vector<OutputPointer> &matches) {
+            for (auto block : chunk) {
+                for (auto tx : block) {
+                    for (auto output : tx.outputs()) {
+                        if (values.contains(output.getValue()) && types.contains(static_cast<int64_t>(output.getType()))) {
+                            matches.push_back(output.pointer);
+                        }
+                    }
+                }
+            }
+        }
+    } // namespace
+
+    bool ColumnFilter::constrainsTxes() const {
+        return std::any_of(bounds.begin(), bounds.end(), [](const Bound &bound) {
+            return bound.column == Column::TxFee;
+        });
+    }
+
+    bool ColumnFilter::constrainsOutputs() const {
+        return addresses || std::any_of(bounds.begin(), bounds.end(), [](const Bound &bound) {
+            return bound.column == Column::OutputValue || bound.column == Column::OutputAddressType;
+        });
+    }
+
+    std::vector<uint32_t> txNumsMatching(BlockRange &blocks, const ColumnFilter &filter) {
+        if (filter.constrainsOutputs()) {
+            throw std::invalid_argument("Column filter constrains outputs, not transactions");
+        }
+        auto heights = columnInterval(filter, Column::Height);
+        auto fees = columnInterval(filter, Column::TxFee);
+        if (heights.empty() || fees.empty()) {
+            return {};
+        }
+        auto range = restrictHeights(blocks, heights);
+        if (!fees.bounded()) {
+            auto txNums = txNumRange(range.getAccess().getChain(), range.sl.start, range.sl.stop);
+            std::vector<uint32_t> matches;
+            matches.reserve(txNums.second - txNums.first);
+            for (auto txNum = txNums.first; txNum < txNums.second; txNum++) {
+                matches.push_back(static_cast<uint32_t>(txNum));
+            }
+            return matches;
+        }
+        if (!hasTxFeeColumns(range.getAccess())) {
+            return range.filterTxNums([&](const Transaction &tx) {
+                return fees.contains(tx.fee());
+            });
+        }
+        auto chunks = range.segment(range.chunkCount());
+        std::vector<std::vector<uint32_t>> matches(chunks.size());
+        range.runChunks(static_cast<uint32_t>(chunks.size()), [&](uint32_t chunkNum) {
+            auto &chunk = chunks[chunkNum];
+            chunk.checkReorg();
+            auto columns = txFeeColumns(chunk);
+            auto &chunkMatches = matches[chunkNum];
+            for (uint32_t i = 0; i < columns.count; i++) {
+                if (fees.contains(columns.fees[i])) {
+                    chunkMatches.push_back(columns.firstTxNum + i);
+                }
+            }
+        });
+        return range.concatenateChunks(matches);
+    }
+
+    std::vector<OutputPointer> outputsMatching(BlockRange &blocks, const ColumnFilter &filter) {
+        if (filter.constrainsTxes()) {
+            throw std::invalid_argument("Column filter constrains transactions, not outputs");
+        }
+        auto heights = columnInterval(filter, Column::Height);
+        auto values = columnInterval(filter, Column::OutputValue);
+        auto types = columnInterval(filter, Column::OutputAddressType);
+        if (heights.empty() || values.empty() || types.empty()) {
+            return {};
+        }
+        auto range = restrictHeights(blocks, heights);
+        auto &access = range.getAccess();
+        auto &chain = access.getChain();
+
+        if (filter.addresses) {
+            // The address index holds the outputs of every address, so only those are read
+            auto txNums = txNumRange(chain, range.sl.start, range.sl.stop);
+            std::vector<OutputPointer> matches;
+            for (auto &raw : *filter.addresses) {
+                if (!types.contains(static_cast<int64_t>(raw.type))) {
+                    continue;
+                }
+                for (auto pointer : Address{raw, access}.getOutputPointers()) {
+                    if (pointer.txNum >= txNums.first && pointer.txNum < txNums.second && (!values.bounded() || values.contains(Output{pointer, access}.getValue()))) {
+                        matches.push_back(pointer);
+                    }
+                }
+            }
+            std::sort(matches.begin(), matches.end());
+            matches.erase(std::unique(matches.begin(), matches.end()), matches.end());
+            return matches;
+        }
+
+        auto columnsAvailable = hasOutputColumns(access);
+        auto chunks = range.segment(range.chunkCount());
+        std::vector<std::vector<OutputPointer>> matches(chunks.size());
+        range.runChunks(static_cast<uint32_t>(chunks.size()), [&](uint32_t chunkNum) {
+            auto &chunk = chunks[chunkNum];
+            chunk.checkReorg();
+            if (columnsAvailable) {
+                scanOutputColumns(chunk, values, types, matches[chunkNum]);
+            } else {
+                scanOutputs(chunk, values, types, matches[chunkNum]);
+            }
+        });
+        size_t total = 0;
+        for (auto &chunkMatches : matches) {
+            total += chunkMatches.size();
+        }
+        std::vector<OutputPointer> result;
+        result.reserve(total);
+        for (auto &chunkMatches : matches) {
+            result.insert(result.end(), chunkMatches.begin(), chunkMatches.end());
+        }
+        return result;
+    }
+} // namespace blocksci
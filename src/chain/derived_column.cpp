@@ -0,0 +1,83 @@
+//
+//  derived_column.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include <blocksci/chain/derived_column.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+#include <internal/derived_column_store.hpp>
+
+#include <cassert>
+#include <stdexcept>
+
+namespace blocksci {
+    size_t derivedColumnElementSize(DerivedColumnType type) {
+        switch (type) {
+            case DerivedColumnType::Int64:
+                return sizeof(int64_t);
+            case DerivedColumnType::UInt32:
+                return sizeof(uint32_t);
+            case DerivedColumnType::UInt16:
+                return sizeof(uint16_t);
+            case DerivedColumnType::UInt8:
+                return sizeof(uint8_t);
+        }
+        assert(false);
+        return 0;
+    }
+
+    int64_t DerivedColumn::operator[](uint64_t index) const {
+        switch (columnType) {
+            case DerivedColumnType::Int64:
+                return static_cast<const int64_t *>(rawData)[index];
+            case DerivedColumnType::UInt32:
+                return static_cast<const uint32_t *>(rawData)[index];
+            case DerivedColumnType::UInt16:
+                return static_cast<const uint16_t *>(rawData)[index];
+            case DerivedColumnType::UInt8:
+                return static_cast<const uint8_t *>(rawData)[index];
+        }
+        assert(false);
+        return 0;
+    }
+
+    bool DerivedColumn::isStale() const {
+        return access->derivedColumns->generation() != generation;
+    }
+
+    void DerivedColumn::checkType(DerivedColumnType type) const {
+        if (type != columnType) {
+            throw std::invalid_argument("Requested values of the wrong type from derived column " + columnName);
+        }
+    }
+
+    ranges::optional<int64_t> DerivedColumn::valueAt(DerivedColumnLevel objectLevel, uint64_t index) const {
+        if (objectLevel != columnLevel) {
+            throw std::invalid_argument("Derived column " + columnName + " has no values for this kind of object");
+        }
+        if (index >= count) {
+            return ranges::nullopt;
+        }
+        return (*this)[index];
+    }
+
+    ranges::optional<int64_t> DerivedColumn::value(const Block &block) const {
+        return valueAt(DerivedColumnLevel::Block, static_cast<uint64_t>(block.height()));
+    }
+
+    ranges::optional<int64_t> DerivedColumn::value(const Transaction &tx) const {
+        return valueAt(DerivedColumnLevel::Tx, tx.txNum);
+    }
+
+    ranges::optional<int64_t> DerivedColumn::value(const Input &input) const {
+        return valueAt(DerivedColumnLevel::Input, access->getChain().getFirstInputNumber(input.txIndex()) + input.inputIndex());
+    }
+
+    ranges::optional<int64_t> DerivedColumn::value(const Output &output) const {
+        return valueAt(DerivedColumnLevel::Output, access->getChain().getFirstOutputNumber(output.txIndex()) + output.outputIndex());
+    }
+} // namespace blocksci
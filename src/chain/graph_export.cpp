@@ -0,0 +1,621 @@
+//
+//  graph_export.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include <blocksci/chain/graph_export.hpp>
+#include <blocksci/chain/block_range.hpp>
+#include <blocksci/chain/transaction.hpp>
+#include <blocksci/address/address.hpp>
+#include <blocksci/cluster/cluster_manager.hpp>
+#include <blocksci/heuristics/tx_identification.hpp>
+
+#include <internal/address_info.hpp>
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+#include <internal/script_access.hpp>
+
+#include <mio/mmap.hpp>
+
+#include <wjfilesystem/path.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace blocksci {
+
+    namespace {
+        /** Edges a segment buffers before appending them to its file */
+        constexpr size_t flushEdgeCount = size_t{1} << 18;
+
+        /** Nodes whose edges one task sorts at the end of a CSR export */
+        constexpr uint64_t sortTaskNodes = uint64_t{1} << 16;
+
+        /** Approximate bytes an entry of a co-spend aggregation table takes, including its node and bucket */
+        constexpr uint64_t coSpendEntryBytes = 48;
+
+        /** Entries a co-spend aggregation table may always hold, however low the memory limit */
+        constexpr size_t minCoSpendEntries = size_t{1} << 16;
+
+        /** Maps the address of an inout to its node at the Address or Cluster level */
+        class NodeMapper {
+            GraphLevel level;
+            DataAccess &access;
+            const ClusterManager *clusters;
+            std::array<uint64_t, DedupAddressType::size> addressOffsets;
+
+        public:
+            NodeMapper(GraphLevel level_, DataAccess &access_, const ClusterManager *clusters_, const std::array<uint64_t, DedupAddressType::size> &addressOffsets_) :
+            level(level_), access(access_), clusters(clusters_), addressOffsets(addressOffsets_) {}
+
+            uint32_t operator()(const Inout &inout) const {
+                if (level == GraphLevel::Cluster) {
+                    return clusters->getCluster(Address{inout.getAddressNum(), inout.getType(), access}).clusterNum;
+                }
+                return static_cast<uint32_t>(addressOffsets[static_cast<size_t>(dedupType(inout.getType()))] + inout.getAddressNum() - 1);
+            }
+        };
+
+        /** Sum the values of equal nodes, leaving the nodes sorted */
+        void combineNodes(std::vector<std::pair<uint32_t, int64_t>> &nodes) {
+            std::sort(nodes.begin(), nodes.end());
+            size_t count = 0;
+            for (auto &node : nodes) {
+                if (count > 0 && nodes[count - 1].first == node.first) {
+                    nodes[count - 1].second += node.second;
+                } else {
+                    nodes[count++] = node;
+                }
+            }
+            nodes.resize(count);
+        }
+
+        /** Edges of one transaction between the nodes of its input and output addresses */
+        template <typename F>
+        void contractedEdges(const RawTransaction &tx, const NodeMapper &nodeOf, bool includeSelfLoops,
+                             std::vector<std::pair<uint32_t, int64_t>> &inputs, std::vector<std::pair<uint32_t, int64_t>> &outputs, F f) {
+            inputs.clear();
+            outputs.clear();
+            int64_t totalIn = 0;
+            for (auto input = tx.beginInputs(); input != tx.endInputs(); ++input) {
+                inputs.emplace_back(nodeOf(*input), input->getValue());
+                totalIn += input->getValue();
+            }
+            for (auto output = tx.beginOutputs(); output != tx.endOutputs(); ++output) {
+                outputs.emplace_back(nodeOf(*output), output->getValue());
+            }
+            combineNodes(inputs);
+            combineNodes(outputs);
+            for (auto &input : inputs) {
+                for (auto &output : outputs) {
+                    if (!includeSelfLoops && input.first == output.first) {
+                        continue;
+                    }
+                    int64_t value = output.second;
+                    if (inputs.size() > 1) {
+                        value = totalIn > 0 ? static_cast<int64_t>(static_cast<long double>(output.second) * input.second / totalIn) : 0;
+                    }
+                    f(GraphEdge{input.first, output.first, value});
+                }
+            }
+        }
+
+        /** The file of one segment, appends edges through a buffer */
+        template <typename Edge>
+        class PartWriter {
+            std::ofstream file;
+            std::vector<Edge> buffer;
+            uint64_t edgeCount = 0;
+
+            void flush() {
+                file.write(reinterpret_cast<const char *>(buffer.data()), static_cast<std::streamsize>(buffer.size() * sizeof(Edge)));
+                buffer.clear();
+            }
+
+        public:
+            PartWriter(const std::string &path) : file(path, std::ios::binary | std::ios::trunc) {
+                if (!file) {
+                    throw std::runtime_error("Cannot create graph export file at path " + path);
+                }
+                buffer.reserve(flushEdgeCount);
+            }
+
+            void add(const Edge &edge) {
+                buffer.push_back(edge);
+                edgeCount++;
+                if (buffer.size() == flushEdgeCount) {
+                    flush();
+                }
+            }
+
+            uint64_t close(const std::string &path) {
+                flush();
+                file.close();
+                if (!file) {
+                    throw std::runtime_error("Could not write graph export file at path " + path);
+                }
+                return edgeCount;
+            }
+        };
+
+        /** Per-segment files, removed when the export finishes or fails */
+        struct PartFiles {
+            std::vector<std::string> paths;
+            std::vector<uint64_t> edgeCounts;
+
+            ~PartFiles() {
+                for (auto &path : paths) {
+                    std::remove(path.c_str());
+                }
+            }
+        };
+
+        using ReadMapping = mio::basic_mmap<mio::access_mode::read, char>;
+        using WriteMapping = mio::basic_mmap<mio::access_mode::write, char>;
+
+        ReadMapping mapPart(const std::string &path) {
+            ReadMapping mapping;
+            std::error_code error;
+            mapping.map(path, 0, mio::map_entire_file, error);
+            if (error) {
+                throw std::runtime_error("Could not read graph export file at path " + path + " with error: " + error.message());
+            }
+            return mapping;
+        }
+
+        WriteMapping createOutput(const filesystem::path &path, uint64_t size) {
+            {
+                std::ofstream file{path.str(), std::ios::binary | std::ios::trunc};
+                if (!file) {
+                    throw std::runtime_error("Cannot create graph export file at path " + path.str());
+                }
+            }
+            filesystem::path{path}.resize_file(static_cast<size_t>(size));
+            WriteMapping mapping;
+            std::error_code error;
+            mapping.map(path.str(), 0, mio::map_entire_file, error);
+            if (error) {
+                throw std::runtime_error("Could not map graph export file at path " + path.str() + " with error: " + error.message());
+            }
+            return mapping;
+        }
+
+        template <typename Edge = GraphEdge>
+        const Edge *partEdges(const ReadMapping &mapping) {
+            return reinterpret_cast<const Edge *>(mapping.data());
+        }
+
+        /** Concatenate the parts in segment order behind the header */
+        void writeEdgeList(const PartFiles &parts, const std::vector<uint64_t> &partStarts, char *data, WorkPool &pool) {
+            auto edges = reinterpret_cast<GraphEdge *>(data + sizeof(GraphFileHeader));
+            pool.run(static_cast<uint32_t>(parts.paths.size()), [&](uint32_t partNum) {
+                if (parts.edgeCounts[partNum] == 0) {
+                    return;
+                }
+                auto mapping = mapPart(parts.paths[partNum]);
+                std::memcpy(edges + partStarts[partNum], partEdges(mapping), static_cast<size_t>(parts.edgeCounts[partNum] * sizeof(GraphEdge)));
+            });
+        }
+
+        uint64_t csrTargetsOffset(uint64_t nodeCount) {
+            return sizeof(GraphFileHeader) + (nodeCount + 1) * sizeof(uint64_t);
+        }
+
+        uint64_t csrValuesOffset(uint64_t nodeCount, uint64_t edgeCount) {
+            auto targetsEnd = csrTargetsOffset(nodeCount) + edgeCount * sizeof(uint32_t);
+            return (targetsEnd + 7) / 8 * 8;
+        }
+
+        /** Counting sort of the edges by source: count, prefix sum into the offsets, scatter through atomic cursors and
+         * finally sort the edges of every node, whose positions were claimed in arbitrary order */
+        void writeCSR(const PartFiles &parts, uint64_t nodeCount, uint64_t edgeCount, char *data, WorkPool &pool) {
+            auto offsets = reinterpret_cast<uint64_t *>(data + sizeof(GraphFileHeader));
+            auto targets = reinterpret_cast<uint32_t *>(data + csrTargetsOffset(nodeCount));
+            auto values = reinterpret_cast<int64_t *>(data + csrValuesOffset(nodeCount, edgeCount));
+            auto cursors = std::make_unique<std::atomic<uint64_t>[]>(static_cast<size_t>(nodeCount));
+            auto partCount = static_cast<uint32_t>(parts.paths.size());
+
+            pool.run(partCount, [&](uint32_t partNum) {
+                if (parts.edgeCounts[partNum] == 0) {
+                    return;
+                }
+                auto mapping = mapPart(parts.paths[partNum]);
+                auto edges = partEdges(mapping);
+                for (uint64_t i = 0; i < parts.edgeCounts[partNum]; i++) {
+                    cursors[edges[i].source].fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+
+            offsets[0] = 0;
+            for (uint64_t i = 0; i < nodeCount; i++) {
+                offsets[i + 1] = offsets[i] + cursors[i].load(std::memory_order_relaxed);
+                cursors[i].store(offsets[i], std::memory_order_relaxed);
+            }
+
+            pool.run(partCount, [&](uint32_t partNum) {
+                if (parts.edgeCounts[partNum] == 0) {
+                    return;
+                }
+                auto mapping = mapPart(parts.paths[partNum]);
+                auto edges = partEdges(mapping);
+                for (uint64_t i = 0; i < parts.edgeCounts[partNum]; i++) {
+                    auto position = cursors[edges[i].source].fetch_add(1, std::memory_order_relaxed);
+                    targets[position] = edges[i].target;
+                    values[position] = edges[i].value;
+                }
+            });
+            cursors.reset();
+
+            auto sortTasks = static_cast<uint32_t>((nodeCount + sortTaskNodes - 1) / sortTaskNodes);
+            pool.run(sortTasks, [&](uint32_t taskNum) {
+                std::vector<std::pair<uint32_t, int64_t>> nodeEdges;
+                auto end = std::min(nodeCount, (static_cast<uint64_t>(taskNum) + 1) * sortTaskNodes);
+                for (auto node = static_cast<uint64_t>(taskNum) * sortTaskNodes; node < end; node++) {
+                    auto begin = offsets[node];
+                    auto count = offsets[node + 1] - begin;
+                    if (count < 2) {
+                        continue;
+                    }
+                    nodeEdges.clear();
+                    for (uint64_t i = begin; i < begin + count; i++) {
+                        nodeEdges.emplace_back(targets[i], values[i]);
+                    }
+                    std::sort(nodeEdges.begin(), nodeEdges.end());
+                    for (uint64_t i = 0; i < count; i++) {
+                        targets[begin + i] = nodeEdges[i].first;
+                        values[begin + i] = nodeEdges[i].second;
+                    }
+                }
+            });
+        }
+
+        /** Header of a graph of the blocks with the nodes of the level */
+        GraphFileHeader makeHeader(BlockRange &blocks, GraphLevel level, GraphExportFormat format, const ClusterManager *clusters) {
+            if (level == GraphLevel::Cluster && clusters == nullptr) {
+                throw std::invalid_argument("Exporting the cluster graph requires a clustering");
+            }
+            auto &access = blocks.getAccess();
+            GraphFileHeader header{};
+            header.magic = GraphFileHeader::Magic;
+            header.version = GraphFileHeader::Version;
+            header.level = level;
+            header.format = format;
+            switch (level) {
+                case GraphLevel::Transaction:
+                    header.nodeCount = blocks.size() > 0 ? blocks.endTxIndex() : 0;
+                    break;
+                case GraphLevel::Address: {
+                    uint64_t total = 0;
+                    for (auto type : DedupAddressType::allArray()) {
+                        header.addressOffsets[static_cast<size_t>(type)] = total;
+                        total += access.getScripts().scriptCount(type);
+                    }
+                    header.nodeCount = total;
+                    break;
+                }
+                case GraphLevel::Cluster:
+                    header.nodeCount = clusters->getClusterCount();
+                    break;
+            }
+            if (header.nodeCount > std::numeric_limits<uint32_t>::max()) {
+                throw std::runtime_error("Graph has too many nodes for 32 bit node numbers");
+            }
+            return header;
+        }
+
+        /** Path of the graph file in the output directory, which is created if needed */
+        filesystem::path prepareOutput(const std::string &outputDirectory, const std::string &fileName) {
+            filesystem::path outputPath{outputDirectory};
+            if (!outputPath.exists() && !filesystem::create_directory(outputPath)) {
+                throw std::runtime_error("Cannot create directory at path " + outputDirectory);
+            }
+            auto graphPath = outputPath/fileName;
+            if (graphPath.exists()) {
+                throw std::runtime_error("Cannot export graph to " + graphPath.str() + ", it exists already");
+            }
+            return graphPath;
+        }
+
+        void syncOutput(WriteMapping &output, const filesystem::path &graphPath) {
+            std::error_code error;
+            output.sync(error);
+            if (error) {
+                throw std::runtime_error("Could not write graph export file at path " + graphPath.str() + " with error: " + error.message());
+            }
+        }
+
+        /** Co-spend edges of a segment, aggregated in a hash table that is spilled to a sorted run file when full */
+        class CoSpendAggregator {
+            struct Weight {
+                uint32_t txCount;
+                int64_t value;
+            };
+
+            /** Keyed by the smaller node in the high and the larger one in the low bits, so keys sort like edges */
+            std::unordered_map<uint64_t, Weight> edges;
+            size_t maxEntries;
+            std::string pathPrefix;
+            PartFiles &runs;
+
+        public:
+            CoSpendAggregator(size_t maxEntries_, std::string pathPrefix_, PartFiles &runs_) :
+            maxEntries(maxEntries_), pathPrefix(std::move(pathPrefix_)), runs(runs_) {
+                edges.reserve(maxEntries);
+            }
+
+            void add(uint32_t a, uint32_t b, int64_t value) {
+                auto key = a < b ? (uint64_t{a} << 32) | b : (uint64_t{b} << 32) | a;
+                auto &weight = edges[key];
+                weight.txCount++;
+                weight.value += value;
+                if (edges.size() >= maxEntries) {
+                    spill();
+                }
+            }
+
+            void spill() {
+                if (edges.empty()) {
+                    return;
+                }
+                std::vector<CoSpendEdge> sorted;
+                sorted.reserve(edges.size());
+                for (auto &edge : edges) {
+                    sorted.push_back(CoSpendEdge{static_cast<uint32_t>(edge.first >> 32), static_cast<uint32_t>(edge.first), edge.second.txCount, 0, edge.second.value});
+                }
+                edges.clear();
+                std::sort(sorted.begin(), sorted.end(), [](const CoSpendEdge &a, const CoSpendEdge &b) {
+                    return a.source != b.source ? a.source < b.source : a.target < b.target;
+                });
+                auto path = pathPrefix + std::to_string(runs.paths.size()) + ".edges";
+                runs.paths.push_back(path);
+                PartWriter<CoSpendEdge> writer{path};
+                for (auto &edge : sorted) {
+                    writer.add(edge);
+                }
+                runs.edgeCounts.push_back(writer.close(path));
+            }
+        };
+
+        /** Co-spend edges of one transaction between the nodes of its inputs, each worth the value both nodes spent */
+        template <typename F>
+        void coSpendEdges(const RawTransaction &tx, const NodeMapper &nodeOf, uint32_t maxCliqueNodes, std::vector<std::pair<uint32_t, int64_t>> &inputs, F f) {
+            inputs.clear();
+            for (auto input = tx.beginInputs(); input != tx.endInputs(); ++input) {
+                inputs.emplace_back(nodeOf(*input), input->getValue());
+            }
+            combineNodes(inputs);
+            if (inputs.size() <= maxCliqueNodes) {
+                for (size_t i = 0; i < inputs.size(); i++) {
+                    for (size_t j = i + 1; j < inputs.size(); j++) {
+                        f(inputs[i].first, inputs[j].first, inputs[i].second + inputs[j].second);
+                    }
+                }
+            } else {
+                for (size_t i = 1; i < inputs.size(); i++) {
+                    f(inputs[0].first, inputs[i].first, inputs[0].second + inputs[i].second);
+                }
+            }
+        }
+
+        /** K-way merge of the sorted runs, calling f once per pair of nodes with the weights of all runs summed */
+        template <typename F>
+        void mergeRuns(const std::vector<ReadMapping> &runs, const std::vector<uint64_t> &runCounts, F f) {
+            using Cursor = std::pair<uint64_t, uint32_t>;
+            std::priority_queue<Cursor, std::vector<Cursor>, std::greater<Cursor>> heap;
+            std::vector<uint64_t> positions(runs.size(), 0);
+            auto keyOf = [](const CoSpendEdge &edge) {
+                return (uint64_t{edge.source} << 32) | edge.target;
+            };
+            for (uint32_t i = 0; i < runs.size(); i++) {
+                if (runCounts[i] > 0) {
+                    heap.emplace(keyOf(partEdges<CoSpendEdge>(runs[i])[0]), i);
+                }
+            }
+            bool hasCurrent = false;
+            CoSpendEdge current{};
+            while (!heap.empty()) {
+                auto runNum = heap.top().second;
+                heap.pop();
+                auto &edge = partEdges<CoSpendEdge>(runs[runNum])[positions[runNum]];
+                if (hasCurrent && current.source == edge.source && current.target == edge.target) {
+                    current.txCount += edge.txCount;
+                    current.value += edge.value;
+                } else {
+                    if (hasCurrent) {
+                        f(current);
+                    }
+                    current = edge;
+                    hasCurrent = true;
+                }
+                if (++positions[runNum] < runCounts[runNum]) {
+                    heap.emplace(keyOf(partEdges<CoSpendEdge>(runs[runNum])[positions[runNum]]), runNum);
+                }
+            }
+            if (hasCurrent) {
+                f(current);
+            }
+        }
+    }
+
+    GraphExportSummary exportGraph(BlockRange &blocks, const std::string &outputDirectory, const GraphExportOptions &options, const ClusterManager *clusters) {
+        if (options.format == GraphExportFormat::WeightedCSR) {
+            throw std::invalid_argument("Weighted CSR files are written by exportCoSpendGraph");
+        }
+        auto header = makeHeader(blocks, options.level, options.format, clusters);
+        auto &access = blocks.getAccess();
+        auto &pool = access.getWorkPool();
+
+        auto graphPath = prepareOutput(outputDirectory, options.format == GraphExportFormat::CSR ? "graph.csr" : "graph.edges");
+        filesystem::path tempPath{options.tempDirectory.empty() ? outputDirectory : options.tempDirectory};
+
+        // Scan the segments, each into its own file
+        auto segments = blocks.segment(blocks.chunkCount(), SegmentWeight::InoutCount);
+        PartFiles parts;
+        for (size_t i = 0; i < segments.size(); i++) {
+            parts.paths.push_back((tempPath/("graph_part_" + std::to_string(i) + ".edges")).str());
+        }
+        parts.edgeCounts.resize(segments.size(), 0);
+        NodeMapper nodeOf{options.level, access, clusters, header.addressOffsets};
+        blocks.runChunks(static_cast<uint32_t>(segments.size()), [&](uint32_t segmentNum) {
+            auto &segment = segments[segmentNum];
+            segment.checkReorg();
+            segment.adviseAccess(AccessHint::Sequential);
+            auto &chain = access.getChain();
+            PartWriter<GraphEdge> writer{parts.paths[segmentNum]};
+            std::vector<std::pair<uint32_t, int64_t>> inputs;
+            std::vector<std::pair<uint32_t, int64_t>> outputs;
+            auto add = [&](const GraphEdge &edge) { writer.add(edge); };
+            auto endTx = segment.size() > 0 ? segment.endTxIndex() : 0;
+            for (uint32_t txNum = segment.size() > 0 ? segment.firstTxIndex() : 0; txNum < endTx; txNum++) {
+                auto tx = chain.getTx(txNum);
+                if (options.level == GraphLevel::Transaction) {
+                    for (auto input = tx->beginInputs(); input != tx->endInputs(); ++input) {
+                        add(GraphEdge{input->getLinkedTxNum(), txNum, input->getValue()});
+                    }
+                } else if (tx->inputCount > 0) {
+                    contractedEdges(*tx, nodeOf, options.includeSelfLoops, inputs, outputs, add);
+                }
+            }
+            parts.edgeCounts[segmentNum] = writer.close(parts.paths[segmentNum]);
+        });
+
+        std::vector<uint64_t> partStarts;
+        uint64_t edgeCount = 0;
+        for (auto count : parts.edgeCounts) {
+            partStarts.push_back(edgeCount);
+            edgeCount += count;
+        }
+        header.edgeCount = edgeCount;
+
+        // Merge the parts into the memory mapped output file
+        auto fileSize = options.format == GraphExportFormat::CSR
+            ? csrValuesOffset(header.nodeCount, edgeCount) + edgeCount * sizeof(int64_t)
+            : sizeof(GraphFileHeader) + edgeCount * sizeof(GraphEdge);
+        auto output = createOutput(graphPath, fileSize);
+        std::memcpy(output.data(), &header, sizeof(header));
+        if (options.format == GraphExportFormat::CSR) {
+            writeCSR(parts, header.nodeCount, edgeCount, output.data(), pool);
+        } else {
+            writeEdgeList(parts, partStarts, output.data(), pool);
+        }
+        syncOutput(output, graphPath);
+        return {header.nodeCount, edgeCount, graphPath.str()};
+    }
+
+    GraphExportSummary exportCoSpendGraph(BlockRange &blocks, const std::string &outputDirectory, const CoSpendGraphOptions &options, const ClusterManager *clusters) {
+        if (options.level == GraphLevel::Transaction) {
+            throw std::invalid_argument("The co-spend graph has address or cluster nodes");
+        }
+        auto header = makeHeader(blocks, options.level, GraphExportFormat::WeightedCSR, clusters);
+        auto &access = blocks.getAccess();
+        auto &pool = access.getWorkPool();
+
+        auto graphPath = prepareOutput(outputDirectory, "cospend.csr");
+        filesystem::path tempPath{options.tempDirectory.empty() ? outputDirectory : options.tempDirectory};
+
+        // Aggregate the edges of every segment, spilling sorted runs whenever its table is full
+        auto segments = blocks.segment(blocks.chunkCount(), SegmentWeight::InoutCount);
+        auto maxEntries = std::max(minCoSpendEntries, static_cast<size_t>(options.memoryLimit / (std::max(pool.batchThreadCount(), 1u) * coSpendEntryBytes)));
+        std::vector<PartFiles> segmentRuns(segments.size());
+        NodeMapper nodeOf{options.level, access, clusters, header.addressOffsets};
+        blocks.runChunks(static_cast<uint32_t>(segments.size()), [&](uint32_t segmentNum) {
+            auto &segment = segments[segmentNum];
+            segment.checkReorg();
+            segment.adviseAccess(AccessHint::Sequential);
+            auto &chain = access.getChain();
+            auto pathPrefix = (tempPath/("cospend_part_" + std::to_string(segmentNum) + "_")).str();
+            CoSpendAggregator aggregator{maxEntries, pathPrefix, segmentRuns[segmentNum]};
+            std::vector<std::pair<uint32_t, int64_t>> inputs;
+            auto endTx = segment.size() > 0 ? segment.endTxIndex() : 0;
+            for (uint32_t txNum = segment.size() > 0 ? segment.firstTxIndex() : 0; txNum < endTx; txNum++) {
+                auto tx = chain.getTx(txNum);
+                if (tx->inputCount < 2) {
+                    continue;
+                }
+                if (options.skipCoinJoin && heuristics::isCoinjoin(Transaction{txNum, access})) {
+                    continue;
+                }
+                coSpendEdges(*tx, nodeOf, options.maxCliqueNodes, inputs, [&](uint32_t a, uint32_t b, int64_t value) {
+                    aggregator.add(a, b, value);
+                });
+            }
+            aggregator.spill();
+        });
+
+        std::vector<ReadMapping> runMappings;
+        std::vector<uint64_t> runCounts;
+        for (auto &runs : segmentRuns) {
+            for (size_t i = 0; i < runs.paths.size(); i++) {
+                runMappings.push_back(mapPart(runs.paths[i]));
+                runCounts.push_back(runs.edgeCounts[i]);
+            }
+        }
+
+        // First merge: count the edges of every node and keep the merged pairs for the second pass
+        PartFiles mergedFile;
+        auto mergedPath = (tempPath/"cospend_merged.edges").str();
+        mergedFile.paths.push_back(mergedPath);
+        std::vector<uint64_t> cursors(static_cast<size_t>(header.nodeCount), 0);
+        uint64_t pairCount = 0;
+        {
+            PartWriter<CoSpendEdge> merged{mergedPath};
+            mergeRuns(runMappings, runCounts, [&](const CoSpendEdge &edge) {
+                cursors[edge.source]++;
+                cursors[edge.target]++;
+                merged.add(edge);
+            });
+            pairCount = merged.close(mergedPath);
+        }
+        runMappings.clear();
+        segmentRuns.clear();
+        header.edgeCount = pairCount * 2;
+
+        auto edgeCount = header.edgeCount;
+        auto countsOffset = csrValuesOffset(header.nodeCount, edgeCount) + edgeCount * sizeof(int64_t);
+        auto output = createOutput(graphPath, countsOffset + edgeCount * sizeof(uint32_t));
+        std::memcpy(output.data(), &header, sizeof(header));
+        auto offsets = reinterpret_cast<uint64_t *>(output.data() + sizeof(GraphFileHeader));
+        auto targets = reinterpret_cast<uint32_t *>(output.data() + csrTargetsOffset(header.nodeCount));
+        auto values = reinterpret_cast<int64_t *>(output.data() + csrValuesOffset(header.nodeCount, edgeCount));
+        auto txCounts = reinterpret_cast<uint32_t *>(output.data() + countsOffset);
+        offsets[0] = 0;
+        for (uint64_t i = 0; i < header.nodeCount; i++) {
+            offsets[i + 1] = offsets[i] + cursors[i];
+            cursors[i] = offsets[i];
+        }
+
+        // Second pass: the merged pairs are sorted, so a node receives its edges to smaller nodes (as the target)
+        // before the ones to larger nodes (as the source), each in increasing order, and the lists come out sorted
+        if (pairCount > 0) {
+            auto merged = mapPart(mergedPath);
+            auto edges = partEdges<CoSpendEdge>(merged);
+            for (uint64_t i = 0; i < pairCount; i++) {
+                auto &edge = edges[i];
+                auto sourcePosition = cursors[edge.source]++;
+                targets[sourcePosition] = edge.target;
+                values[sourcePosition] = edge.value;
+                txCounts[sourcePosition] = edge.txCount;
+                auto targetPosition = cursors[edge.target]++;
+                targets[targetPosition] = edge.source;
+                values[targetPosition] = edge.value;
+                txCounts[targetPosition] = edge.txCount;
+            }
+        }
+        syncOutput(output, graphPath);
+        return {header.nodeCount, edgeCount, graphPath.str()};
+    }
+} // namespace blocksci
@@ -0,0 +1,69 @@
+//
+//  inout_cursor.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include <blocksci/chain/inout_cursor.hpp>
+#include <blocksci/chain/input.hpp>
+#include <blocksci/chain/output.hpp>
+#include <blocksci/chain/transaction.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+
+namespace blocksci {
+    InputCursor::InputCursor(const Transaction &tx) {
+        auto inputs = tx.inputs();
+        access = inputs.access;
+        inouts = inputs.inouts;
+        spentOutputNums = inputs.spentOutputNums;
+        sequenceNumbers = inputs.sequenceNumbers;
+        txNum = inputs.txIndex;
+        maxTxCount = inputs.maxTxCount;
+        height = inputs.height;
+        inputCount = inputs.maxInputNum;
+        auto &chain = access->getChain();
+        spentHeights = inputCount > 0 ? chain.getInputSpentHeights(chain.getFirstInputNumber(txNum), inputCount) : nullptr;
+    }
+
+    BlockHeight InputCursor::lookupSpentBlockHeight(uint32_t spentTxNum) const {
+        return access->getChain().getBlockHeight(spentTxNum);
+    }
+
+    Transaction InputCursor::getSpentTx() const {
+        return {spentTxIndex(), getSpentBlockHeight(), *access};
+    }
+
+    Input InputCursor::input() const {
+        return {{txNum, inputNum}, height, inouts[inputNum], &spentOutputNums[inputNum], &sequenceNumbers[inputNum], maxTxCount, *access};
+    }
+
+    OutputCursor::OutputCursor(const Transaction &tx) {
+        auto outputs = tx.outputs();
+        access = outputs.access;
+        inouts = outputs.inouts;
+        txNum = outputs.txIndex;
+        maxTxCount = outputs.maxTxLoaded;
+        height = outputs.height;
+        outputCount = outputs.maxOutputNum;
+        auto &chain = access->getChain();
+        spendingHeights = outputCount > 0 ? chain.getOutputSpendingHeights(chain.getFirstOutputNumber(txNum), outputCount) : nullptr;
+    }
+
+    BlockHeight OutputCursor::lookupSpendingBlockHeight(uint32_t spendingTxNum) const {
+        return access->getChain().getBlockHeight(spendingTxNum);
+    }
+
+    ranges::optional<Transaction> OutputCursor::getSpendingTx() const {
+        if (!isSpent()) {
+            return ranges::nullopt;
+        }
+        return Transaction{inouts[outputNum].getLinkedTxNum(), getSpendingBlockHeight(), *access};
+    }
+
+    Output OutputCursor::output() const {
+        return {{txNum, outputNum}, height, inouts[outputNum], maxTxCount, *access};
+    }
+} // namespace blocksci
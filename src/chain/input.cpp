@@ -35,7 +35,7 @@ namespace blocksci {
     }
     
     BlockHeight Input::age() const {
-        return blockHeight - access->getChain().getBlockHeight(inout->getLinkedTxNum());
+        return blockHeight - getSpentBlockHeight();
     }
     
     Block Input::block() const {
@@ -47,15 +47,55 @@ namespace blocksci {
     }
     
     Transaction Input::getSpentTx() const {
-        auto txNum = inout->getLinkedTxNum();
-        return {txNum, access->getChain().getBlockHeight(txNum), *access};
+        return {inout->getLinkedTxNum(), getSpentBlockHeight(), *access};
+    }
+    
+    BlockHeight Input::getSpentBlockHeight() const {
+        auto &chain = access->getChain();
+        return chain.getSpentBlockHeight(chain.getFirstInputNumber(pointer.txNum) + pointer.inoutNum, inout->getLinkedTxNum());
     }
     
     Output Input::getSpentOutput() const {
         auto pointer = getSpentOutputPointer();
-        auto height = access->getChain().getBlockHeight(pointer.txNum);
         auto tx = access->getChain().getTx(pointer.txNum);
-        return {pointer, height, tx->getOutput(pointer.inoutNum), maxTxCount, *access};
+        return {pointer, getSpentBlockHeight(), tx->getOutput(pointer.inoutNum), maxTxCount, *access};
+    }
+    
+    const RawWitness *Input::getRawWitness() const {
+        auto &chain = access->getChain();
+        auto witness = chain.getTxWitnesses(pointer.txNum);
+        if (witness == nullptr) {
+            return nullptr;
+        }
+        auto hasItemData = chain.witnessesHaveItemData();
+        for (uint16_t i = 0; i < pointer.inoutNum; i++) {
+            witness = witness->next(hasItemData);
+        }
+        return witness;
+    }
+    
+    ranges::optional<std::vector<uint32_t>> Input::getWitnessItemLengths() const {
+        auto witness = getRawWitness();
+        if (witness == nullptr) {
+            return ranges::nullopt;
+        }
+        return std::vector<uint32_t>(witness->itemLengths(), witness->itemLengths() + witness->itemCount);
+    }
+    
+    ranges::optional<std::vector<std::vector<unsigned char>>> Input::getWitnessItems() const {
+        auto witness = getRawWitness();
+        if (witness == nullptr || !access->getChain().witnessesHaveItemData()) {
+            return ranges::nullopt;
+        }
+        std::vector<std::vector<unsigned char>> items;
+        items.reserve(witness->itemCount);
+        auto data = witness->itemData();
+        for (uint32_t i = 0; i < witness->itemCount; i++) {
+            auto length = witness->itemLengths()[i];
+            items.emplace_back(data, data + length);
+            data += length;
+        }
+        return items;
     }
     
     std::string Input::toString() const {
@@ -0,0 +1,404 @@
+//
+//  mempool_snapshot.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include <blocksci/chain/mempool_snapshot.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+#include <internal/data_configuration.hpp>
+#include <internal/hash_index.hpp>
+
+#include <mio/mmap.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+
+namespace blocksci {
+
+    namespace {
+        filesystem::path snapshotPath(const DataAccess &access) {
+            return access.config.mempoolDirectory()/"snapshot.dat";
+        }
+
+        template <typename T>
+        void writeArray(std::ofstream &file, const std::vector<T> &data) {
+            file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(sizeof(T) * data.size()));
+        }
+
+        /** Walks the unconfirmed ancestors of txes, marking visited txes with a generation number so that the marks
+         * never have to be cleared */
+        class AncestorWalker {
+            const std::vector<std::vector<uint32_t>> &parents;
+            std::vector<uint32_t> visitedGeneration;
+            std::vector<uint32_t> stack;
+            uint32_t generation = 0;
+
+        public:
+            explicit AncestorWalker(const std::vector<std::vector<uint32_t>> &parents_) : parents(parents_), visitedGeneration(parents_.size(), 0) {}
+
+            /** Calls visit for every ancestor of the tx and the tx itself, skipping txes for which skip returns true
+             * and their ancestors */
+            template <typename Skip, typename Visit>
+            void walk(uint32_t index, Skip &&skip, Visit &&visit) {
+                generation++;
+                stack.clear();
+                stack.push_back(index);
+                visitedGeneration[index] = generation;
+                while (!stack.empty()) {
+                    auto current = stack.back();
+                    stack.pop_back();
+                    visit(current);
+                    for (auto parent : parents[current]) {
+                        if (visitedGeneration[parent] != generation && !skip(parent)) {
+                            visitedGeneration[parent] = generation;
+                            stack.push_back(parent);
+                        }
+                    }
+                }
+            }
+        };
+
+        /** Sort a package so that every tx comes after its parents within the package */
+        void sortTopologically(std::vector<uint32_t> &package, const std::vector<uint32_t> &ancestorCounts) {
+            // A parent always has fewer ancestors than its child
+            std::sort(package.begin(), package.end(), [&](uint32_t a, uint32_t b) {
+                return ancestorCounts[a] < ancestorCounts[b];
+            });
+        }
+    } // namespace
+
+    MempoolSnapshot::MempoolSnapshot(const std::string &path) {
+        std::error_code error;
+        auto file = std::make_shared<mio::mmap_source>();
+        file->map(path, error);
+        if (error || file->size() < sizeof(MempoolSnapshotHeader)) {
+            throw std::runtime_error("Could not open mempool snapshot " + path + ", is the mempool recorder running?");
+        }
+        auto base = file->data();
+        header = reinterpret_cast<const MempoolSnapshotHeader *>(base);
+        if (header->magic != MempoolSnapshotHeader::expectedMagic || header->version != MempoolSnapshotHeader::expectedVersion) {
+            throw std::runtime_error(path + " is not a mempool snapshot of this version of BlockSci");
+        }
+        size_t expectedSize = sizeof(MempoolSnapshotHeader) + sizeof(PendingTx) * header->txCount + sizeof(PendingInput) * header->inputCount
+            + sizeof(uint32_t) * (header->parentCount + header->blockCount + 1 + header->txCount);
+        if (file->size() != expectedSize) {
+            throw std::runtime_error("Mempool snapshot " + path + " is truncated");
+        }
+        txData = reinterpret_cast<const PendingTx *>(header + 1);
+        inputData = reinterpret_cast<const PendingInput *>(txData + header->txCount);
+        parentData = reinterpret_cast<const uint32_t *>(inputData + header->inputCount);
+        blockOffsets = parentData + header->parentCount;
+        hashOrder = blockOffsets + header->blockCount + 1;
+        mapping = std::move(file);
+    }
+
+    MempoolSnapshot::MempoolSnapshot(const DataAccess &access) : MempoolSnapshot(snapshotPath(access).str()) {}
+
+    ranges::optional<uint32_t> MempoolSnapshot::find(const uint256 &hash) const {
+        auto end = hashOrder + header->txCount;
+        auto it = std::lower_bound(hashOrder, end, hash, [&](uint32_t index, const uint256 &value) {
+            return txData[index].hash < value;
+        });
+        if (it != end && txData[*it].hash == hash) {
+            return *it;
+        }
+        return ranges::nullopt;
+    }
+
+    std::vector<uint32_t> MempoolSnapshot::ancestors(uint32_t index) const {
+        std::vector<uint32_t> ret;
+        std::vector<uint32_t> stack{index};
+        while (!stack.empty()) {
+            auto current = stack.back();
+            stack.pop_back();
+            for (auto parent : parents(current)) {
+                if (std::find(ret.begin(), ret.end(), parent) == ret.end()) {
+                    ret.push_back(parent);
+                    stack.push_back(parent);
+                }
+            }
+        }
+        std::sort(ret.begin(), ret.end());
+        return ret;
+    }
+
+    ranges::subrange<const PendingTx *> MempoolSnapshot::projectedBlock(uint32_t block) const {
+        if (block >= header->blockCount) {
+            return {txData + header->txCount, txData + header->txCount};
+        }
+        return {txData + blockOffsets[block], txData + blockOffsets[block + 1]};
+    }
+
+    int64_t MempoolSnapshot::projectedBlockFees(uint32_t block) const {
+        int64_t fees = 0;
+        for (auto &tx : projectedBlock(block)) {
+            fees += tx.fee;
+        }
+        return fees;
+    }
+
+    std::vector<double> MempoolSnapshot::feeRatePercentiles(const std::vector<double> &percentiles, uint32_t block) const {
+        for (auto percentile : percentiles) {
+            if (percentile < 0 || percentile > 100) {
+                throw std::invalid_argument("Percentiles must be between 0 and 100");
+            }
+        }
+        auto txes = projectedBlock(block);
+        std::vector<std::pair<double, uint32_t>> rates;
+        rates.reserve(static_cast<size_t>(txes.size()));
+        uint64_t totalSize = 0;
+        for (auto &tx : txes) {
+            rates.emplace_back(tx.feeRate, tx.vsize);
+            totalSize += tx.vsize;
+        }
+        std::vector<double> ret(percentiles.size(), 0);
+        if (rates.empty()) {
+            return ret;
+        }
+        std::sort(rates.begin(), rates.end());
+
+        // Answer the percentiles in increasing order with a single pass over the cumulative size
+        std::vector<size_t> order(percentiles.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return percentiles[a] < percentiles[b]; });
+        size_t position = 0;
+        uint64_t cumulativeSize = rates.front().second;
+        for (auto i : order) {
+            auto targetSize = percentiles[i] / 100 * static_cast<double>(totalSize);
+            while (position + 1 < rates.size() && static_cast<double>(cumulativeSize) < targetSize) {
+                position++;
+                cumulativeSize += rates[position].second;
+            }
+            ret[i] = rates[position].first;
+        }
+        return ret;
+    }
+
+    void writeMempoolSnapshot(const std::vector<MempoolEntry> &entries, int64_t timestamp, DataAccess &access) {
+        auto txCount = static_cast<uint32_t>(entries.size());
+        std::unordered_map<uint256, uint32_t> indexes;
+        indexes.reserve(entries.size());
+        for (uint32_t i = 0; i < txCount; i++) {
+            indexes.emplace(entries[i].hash, i);
+        }
+
+        std::vector<std::vector<uint32_t>> parents(txCount);
+        for (uint32_t i = 0; i < txCount; i++) {
+            for (auto &parent : entries[i].parents) {
+                auto it = indexes.find(parent);
+                if (it != indexes.end() && it->second != i) {
+                    parents[i].push_back(it->second);
+                }
+            }
+        }
+
+        // Ancestor packages, every tx is also counted as a descendant of each of its ancestors
+        AncestorWalker walker{parents};
+        auto noSkip = [](uint32_t) { return false; };
+        std::vector<int64_t> ancestorFees(txCount, 0);
+        std::vector<uint32_t> ancestorSizes(txCount, 0);
+        std::vector<uint32_t> ancestorCounts(txCount, 0);
+        std::vector<uint32_t> descendantCounts(txCount, 0);
+        for (uint32_t i = 0; i < txCount; i++) {
+            walker.walk(i, noSkip, [&](uint32_t ancestor) {
+                ancestorFees[i] += entries[ancestor].fee;
+                ancestorSizes[i] += entries[ancestor].vsize;
+                ancestorCounts[i]++;
+                descendantCounts[ancestor]++;
+            });
+        }
+
+        // Fill projected blocks with packages in order of decreasing ancestor fee rate
+        std::vector<uint32_t> byAncestorFeeRate(txCount);
+        std::iota(byAncestorFeeRate.begin(), byAncestorFeeRate.end(), 0);
+        std::stable_sort(byAncestorFeeRate.begin(), byAncestorFeeRate.end(), [&](uint32_t a, uint32_t b) {
+            return static_cast<double>(ancestorFees[a]) * ancestorSizes[b] > static_cast<double>(ancestorFees[b]) * ancestorSizes[a];
+        });
+        constexpr uint32_t unassigned = std::numeric_limits<uint32_t>::max();
+        // Blocks with less room than the smallest possible tx can be skipped in the search
+        constexpr uint32_t minTxVsize = 61;
+        std::vector<uint32_t> blocks(txCount, unassigned);
+        std::vector<uint32_t> inclusionOrder(txCount, 0);
+        std::vector<double> feeRates(txCount, 0);
+        std::vector<uint32_t> blockSizes;
+        uint32_t firstOpenBlock = 0;
+        uint32_t included = 0;
+        std::vector<uint32_t> package;
+        for (auto index : byAncestorFeeRate) {
+            if (blocks[index] != unassigned) {
+                continue;
+            }
+            package.clear();
+            uint32_t minBlock = firstOpenBlock;
+            int64_t packageFee = 0;
+            uint32_t packageSize = 0;
+            walker.walk(index, [&](uint32_t ancestor) {
+                if (blocks[ancestor] != unassigned) {
+                    minBlock = std::max(minBlock, blocks[ancestor]);
+                    return true;
+                }
+                return false;
+            }, [&](uint32_t member) {
+                package.push_back(member);
+                packageFee += entries[member].fee;
+                packageSize += entries[member].vsize;
+            });
+
+            auto block = minBlock;
+            while (block < blockSizes.size() && blockSizes[block] + packageSize > MempoolSnapshot::maxBlockVsize) {
+                block++;
+            }
+            if (block == blockSizes.size()) {
+                blockSizes.push_back(0);
+            }
+            blockSizes[block] += packageSize;
+            while (firstOpenBlock < blockSizes.size() && blockSizes[firstOpenBlock] + minTxVsize > MempoolSnapshot::maxBlockVsize) {
+                firstOpenBlock++;
+            }
+
+            sortTopologically(package, ancestorCounts);
+            auto packageFeeRate = static_cast<double>(packageFee) / std::max(packageSize, uint32_t{1});
+            for (auto member : package) {
+                blocks[member] = block;
+                inclusionOrder[member] = included++;
+                feeRates[member] = packageFeeRate;
+            }
+        }
+
+        // Lay out the txes block by block in inclusion order
+        std::vector<uint32_t> order(txCount);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return std::tie(blocks[a], inclusionOrder[a]) < std::tie(blocks[b], inclusionOrder[b]);
+        });
+        std::vector<uint32_t> newIndexes(txCount);
+        for (uint32_t i = 0; i < txCount; i++) {
+            newIndexes[order[i]] = i;
+        }
+
+        // Link the inputs spending confirmed outputs to the parsed chain
+        std::vector<uint256> confirmedHashes;
+        for (auto &entry : entries) {
+            if (entry.inputsKnown) {
+                for (auto &input : entry.inputs) {
+                    if (indexes.find(input.first) == indexes.end()) {
+                        confirmedHashes.push_back(input.first);
+                    }
+                }
+            }
+        }
+        auto confirmedTxNums = access.getHashIndex().getTxIndexes(confirmedHashes);
+        auto chainTxCount = static_cast<uint32_t>(access.getChain().txCount());
+
+        std::vector<PendingTx> txes;
+        std::vector<PendingInput> inputs;
+        std::vector<uint32_t> parentIndexes;
+        std::vector<uint32_t> blockOffsets;
+        txes.reserve(txCount);
+        size_t confirmedPosition = 0;
+        std::vector<size_t> confirmedOffsets(txCount, 0);
+        for (uint32_t i = 0; i < txCount; i++) {
+            confirmedOffsets[i] = confirmedPosition;
+            if (entries[i].inputsKnown) {
+                for (auto &input : entries[i].inputs) {
+                    if (indexes.find(input.first) == indexes.end()) {
+                        confirmedPosition++;
+                    }
+                }
+            }
+        }
+        for (uint32_t i = 0; i < txCount; i++) {
+            auto index = order[i];
+            auto &entry = entries[index];
+            while (blockOffsets.size() <= blocks[index]) {
+                blockOffsets.push_back(i);
+            }
+            PendingTx tx;
+            tx.hash = entry.hash;
+            tx.fee = entry.fee;
+            tx.ancestorFee = ancestorFees[index];
+            tx.firstSeen = entry.firstSeen;
+            tx.feeRate = feeRates[index];
+            tx.vsize = entry.vsize;
+            tx.ancestorSize = ancestorSizes[index];
+            tx.ancestorCount = ancestorCounts[index];
+            tx.descendantCount = descendantCounts[index];
+            tx.projectedBlock = blocks[index];
+            tx.firstParent = static_cast<uint32_t>(parentIndexes.size());
+            tx.parentCount = static_cast<uint32_t>(parents[index].size());
+            tx.firstInput = static_cast<uint32_t>(inputs.size());
+            tx.inputCount = 0;
+            tx.flags = entry.inputsKnown ? PendingTx::inputsKnownFlag : 0;
+            for (auto parent : parents[index]) {
+                parentIndexes.push_back(newIndexes[parent]);
+            }
+            if (entry.inputsKnown) {
+                auto confirmedIndex = confirmedOffsets[index];
+                for (auto &input : entry.inputs) {
+                    PendingInput pendingInput{0, input.second, PendingInputSource::Unknown};
+                    auto it = indexes.find(input.first);
+                    if (it != indexes.end()) {
+                        pendingInput.spentTx = newIndexes[it->second];
+                        pendingInput.source = PendingInputSource::Mempool;
+                    } else {
+                        auto &txNum = confirmedTxNums[confirmedIndex++];
+                        if (txNum && *txNum < chainTxCount) {
+                            pendingInput.spentTx = *txNum;
+                            pendingInput.source = PendingInputSource::Chain;
+                        }
+                    }
+                    inputs.push_back(pendingInput);
+                }
+                tx.inputCount = static_cast<uint32_t>(entry.inputs.size());
+            }
+            txes.push_back(tx);
+        }
+        auto blockCount = static_cast<uint32_t>(blockOffsets.size());
+        blockOffsets.push_back(txCount);
+
+        std::vector<uint32_t> hashOrder(txCount);
+        std::iota(hashOrder.begin(), hashOrder.end(), 0);
+        std::sort(hashOrder.begin(), hashOrder.end(), [&](uint32_t a, uint32_t b) {
+            return txes[a].hash < txes[b].hash;
+        });
+
+        MempoolSnapshotHeader header;
+        header.magic = MempoolSnapshotHeader::expectedMagic;
+        header.version = MempoolSnapshotHeader::expectedVersion;
+        header.chainTxCount = chainTxCount;
+        header.timestamp = timestamp;
+        header.txCount = txCount;
+        header.inputCount = static_cast<uint32_t>(inputs.size());
+        header.parentCount = static_cast<uint32_t>(parentIndexes.size());
+        header.blockCount = blockCount;
+
+        // Write to a temporary file and rename it so that readers never map a partially written snapshot
+        auto path = snapshotPath(access);
+        auto tempPath = path.str() + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            writeArray(file, txes);
+            writeArray(file, inputs);
+            writeArray(file, parentIndexes);
+            writeArray(file, blockOffsets);
+            writeArray(file, hashOrder);
+            if (!file) {
+                throw std::runtime_error("Failed to write mempool snapshot " + tempPath);
+            }
+        }
+        if (std::rename(tempPath.c_str(), path.str().c_str()) != 0) {
+            throw std::runtime_error("Failed to replace mempool snapshot " + path.str());
+        }
+    }
+} // namespace blocksci
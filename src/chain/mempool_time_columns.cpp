@@ -0,0 +1,39 @@
+//
+//  mempool_time_columns.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include <blocksci/chain/mempool_time_columns.hpp>
+#include <blocksci/chain/block_range.hpp>
+
+#include <internal/data_access.hpp>
+#include <internal/mempool_index.hpp>
+
+#include <algorithm>
+
+namespace blocksci {
+    void MempoolTimeColumns::copyTo(int64_t *timestamps, uint16_t *milliseconds) const {
+        std::fill(timestamps, timestamps + count, 0);
+        std::fill(milliseconds, milliseconds + count, 0);
+        for (auto &segment : segments) {
+            auto offset = segment.firstTxNum - firstTxNum;
+            std::copy(segment.timestamps, segment.timestamps + segment.count, timestamps + offset);
+            if (segment.milliseconds != nullptr) {
+                std::copy(segment.milliseconds, segment.milliseconds + segment.millisecondCount, milliseconds + offset);
+            }
+        }
+    }
+
+    MempoolTimeColumns mempoolTimeColumns(BlockRange &blocks) {
+        MempoolTimeColumns columns;
+        if (blocks.size() == 0) {
+            return columns;
+        }
+        columns.firstTxNum = blocks.firstTxIndex();
+        columns.count = blocks.endTxIndex() - columns.firstTxNum;
+        columns.segments = blocks.getAccess().getMempoolIndex().txTimeSegments(columns.firstTxNum, blocks.endTxIndex());
+        return columns;
+    }
+} // namespace blocksci
@@ -0,0 +1,205 @@
+//
+//  miner_attribution.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include <blocksci/chain/miner_attribution.hpp>
+#include <blocksci/address/address.hpp>
+#include <blocksci/chain/block.hpp>
+#include <blocksci/chain/output.hpp>
+#include <blocksci/chain/transaction.hpp>
+
+#include <range/v3/range_for.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <stdexcept>
+
+namespace blocksci {
+
+    namespace {
+        constexpr uint32_t alphabetSize = 256;
+        constexpr uint32_t noState = UINT32_MAX;
+
+        uint64_t addressKey(const Address &address) {
+            return static_cast<uint64_t>(address.scriptNum) << 8 | static_cast<uint64_t>(address.type);
+        }
+
+        /** FNV-1a */
+        void hashBytes(uint32_t &hash, const void *data, size_t length) {
+            auto bytes = static_cast<const unsigned char *>(data);
+            for (size_t i = 0; i < length; i++) {
+                hash ^= bytes[i];
+                hash *= 16777619u;
+            }
+        }
+
+        template <typename T>
+        void hashValue(uint32_t &hash, const T &value) {
+            hashBytes(hash, &value, sizeof(value));
+        }
+
+        void hashString(uint32_t &hash, const std::string &value) {
+            hashValue(hash, static_cast<uint64_t>(value.size()));
+            hashBytes(hash, value.data(), value.size());
+        }
+    }
+
+    CoinbaseTagMatcher::CoinbaseTagMatcher(const std::vector<std::string> &patterns) {
+        // Build the trie, then turn it into a full transition table in breadth first order of the states
+        transitions.assign(alphabetSize, noState);
+        matchedPattern.push_back(noPattern);
+        patternLengths.reserve(patterns.size());
+        for (uint32_t patternNum = 0; patternNum < patterns.size(); patternNum++) {
+            const auto &pattern = patterns[patternNum];
+            if (pattern.empty()) {
+                throw std::invalid_argument("Coinbase tags must not be empty");
+            }
+            patternLengths.push_back(static_cast<uint32_t>(pattern.size()));
+            longestPattern = std::max(longestPattern, static_cast<uint32_t>(pattern.size()));
+            uint32_t state = 0;
+            for (auto c : pattern) {
+                auto &next = transitions[state * alphabetSize + static_cast<unsigned char>(c)];
+                if (next == noState) {
+                    next = static_cast<uint32_t>(matchedPattern.size());
+                    matchedPattern.push_back(noPattern);
+                    transitions.resize(transitions.size() + alphabetSize, noState);
+                }
+                state = next;
+            }
+            // Duplicates keep the first pattern, which a regex alternation would report
+            if (matchedPattern[state] == noPattern) {
+                matchedPattern[state] = patternNum;
+            }
+        }
+
+        std::vector<uint32_t> failure(matchedPattern.size(), 0);
+        std::deque<uint32_t> queue;
+        for (uint32_t c = 0; c < alphabetSize; c++) {
+            auto &next = transitions[c];
+            if (next == noState) {
+                next = 0;
+            } else {
+                queue.push_back(next);
+            }
+        }
+        while (!queue.empty()) {
+            auto state = queue.front();
+            queue.pop_front();
+            // Patterns ending at the failure state are shorter than the one ending here
+            if (matchedPattern[state] == noPattern) {
+                matchedPattern[state] = matchedPattern[failure[state]];
+            }
+            for (uint32_t c = 0; c < alphabetSize; c++) {
+                auto &next = transitions[state * alphabetSize + c];
+                auto fallback = transitions[failure[state] * alphabetSize + c];
+                if (next == noState) {
+                    next = fallback;
+                } else {
+                    failure[next] = fallback;
+                    queue.push_back(next);
+                }
+            }
+        }
+    }
+
+    ranges::optional<uint32_t> CoinbaseTagMatcher::firstMatch(const unsigned char *begin, const unsigned char *end) const {
+        if (transitions.empty()) {
+            return ranges::nullopt;
+        }
+        // The longest pattern ending at each position starts leftmost among the patterns ending there, so the leftmost
+        // match overall is one of them. Patterns starting at the same position all show up this way.
+        uint32_t state = 0;
+        uint32_t best = noPattern;
+        size_t bestStart = 0;
+        for (auto it = begin; it != end; ++it) {
+            state = transitions[state * alphabetSize + *it];
+            auto pattern = matchedPattern[state];
+            if (pattern != noPattern) {
+                auto start = static_cast<size_t>(it - begin) + 1 - patternLengths[pattern];
+                if (best == noPattern || start < bestStart || (start == bestStart && pattern < best)) {
+                    best = pattern;
+                    bestStart = start;
+                }
+            }
+            // Matches ending after this position start after the best one
+            if (best != noPattern && static_cast<size_t>(it - begin) + 1 >= bestStart + longestPattern) {
+                break;
+            }
+        }
+        if (best == noPattern) {
+            return ranges::nullopt;
+        }
+        return best;
+    }
+
+    MinerMatcher::MinerMatcher(std::vector<std::string> names, const std::vector<std::pair<std::string, uint32_t>> &coinbaseTags, const std::vector<std::pair<Address, uint32_t>> &payoutAddresses) {
+        minerNames.reserve(names.size() + 1);
+        minerNames.emplace_back("Unknown");
+        for (auto &minerName : names) {
+            minerNames.push_back(std::move(minerName));
+        }
+        auto checkId = [&](uint32_t minerId) {
+            if (minerId == 0 || minerId >= minerNames.size()) {
+                throw std::out_of_range("Miner id " + std::to_string(minerId) + " does not refer to one of the names");
+            }
+        };
+
+        definitionHash = 2166136261u;
+        for (const auto &minerName : minerNames) {
+            hashString(definitionHash, minerName);
+        }
+        std::vector<std::string> patterns;
+        patterns.reserve(coinbaseTags.size());
+        tagMiners.reserve(coinbaseTags.size());
+        for (const auto &tag : coinbaseTags) {
+            checkId(tag.second);
+            patterns.push_back(tag.first);
+            tagMiners.push_back(tag.second);
+            hashString(definitionHash, tag.first);
+            hashValue(definitionHash, tag.second);
+        }
+        tags = CoinbaseTagMatcher{patterns};
+        for (const auto &payout : payoutAddresses) {
+            checkId(payout.second);
+            auto key = addressKey(payout.first);
+            // The first definition of an address wins, like the first matching tag
+            if (payoutMiners.emplace(key, payout.second).second) {
+                hashValue(definitionHash, key);
+                hashValue(definitionHash, payout.second);
+            }
+        }
+    }
+
+    uint32_t MinerMatcher::minerOf(const Block &block) const {
+        auto coinbase = block.getCoinbase();
+        if (auto tag = tags.firstMatch(coinbase.data(), coinbase.data() + coinbase.size())) {
+            return tagMiners[*tag];
+        }
+        if (!payoutMiners.empty()) {
+            RANGES_FOR(auto output, block.coinbaseTx().outputs()) {
+                auto it = payoutMiners.find(addressKey(output.getAddress()));
+                if (it != payoutMiners.end()) {
+                    return it->second;
+                }
+            }
+        }
+        return 0;
+    }
+
+    const std::string &MinerMatcher::name(uint32_t minerId) const {
+        if (minerId >= minerNames.size()) {
+            throw std::out_of_range("Unknown miner id " + std::to_string(minerId));
+        }
+        return minerNames[minerId];
+    }
+
+    DerivedColumnSpec MinerMatcher::columnSpec(std::string columnName) const {
+        auto matcher = std::make_shared<const MinerMatcher>(*this);
+        return DerivedColumnSpec::perBlock<uint32_t>(std::move(columnName), [matcher](const Block &block) {
+            return matcher->minerOf(block);
+        }, {}, fingerprint());
+    }
+} // namespace blocksci
@@ -35,7 +35,17 @@ namespace blocksci {
     ranges::optional<Transaction> Output::getSpendingTx() const {
         auto index = getSpendingTxIndex();
         if (index) {
-            return ranges::optional<Transaction>{Transaction(*index, access->getChain().getBlockHeight(*index), *access)};
+            return ranges::optional<Transaction>{Transaction(*index, *getSpendingBlockHeight(), *access)};
+        } else {
+            return ranges::nullopt;
+        }
+    }
+
+    ranges::optional<BlockHeight> Output::getSpendingBlockHeight() const {
+        auto index = getSpendingTxIndex();
+        if (index) {
+            auto &chain = access->getChain();
+            return chain.getSpendingBlockHeight(chain.getFirstOutputNumber(pointer.txNum) + pointer.inoutNum, *index);
         } else {
             return ranges::nullopt;
         }
@@ -45,6 +55,11 @@ namespace blocksci {
     ranges::optional<Input> Output::getSpendingInput() const {
         auto spendingTx = getSpendingTx();
         if (spendingTx) {
+            auto &chain = access->getChain();
+            auto inputNum = chain.getSpendingInputNum(chain.getFirstOutputNumber(pointer.txNum) + pointer.inoutNum);
+            if (inputNum) {
+                return spendingTx->inputs()[*inputNum];
+            }
             RANGES_FOR(auto input, spendingTx->inputs()) {
                 if (input.getSpentOutputPointer() == pointer) {
                     return input;
@@ -59,8 +74,13 @@ namespace blocksci {
     ranges::optional<InputPointer> Output::getSpendingInputPointer() const {
         auto index = getSpendingTxIndex();
         if (index) {
-            auto rawTx = access->getChain().getTx(*index);
-            auto spentOutNums = access->getChain().getSpentOutputNumbers(*index);
+            auto &chain = access->getChain();
+            auto inputNum = chain.getSpendingInputNum(chain.getFirstOutputNumber(pointer.txNum) + pointer.inoutNum);
+            if (inputNum) {
+                return InputPointer{*index, *inputNum};
+            }
+            auto rawTx = chain.getTx(*index);
+            auto spentOutNums = chain.getSpentOutputNumbers(*index);
             for (uint16_t i = 0; i < rawTx->inputCount; i++) {
                 const auto &input = rawTx->getInput(i);
                 auto spentOutNum = spentOutNums[i];
@@ -0,0 +1,52 @@
+//
+//  output_columns.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include <blocksci/chain/output_columns.hpp>
+#include <blocksci/chain/block_range.hpp>
+#include <blocksci/chain/transaction.hpp>
+#include <blocksci/chain/transaction_range.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+
+namespace blocksci {
+    namespace {
+        /** Output columns of all outputs of the transactions [beginTxNum, endTxNum) */
+        OutputColumns txRangeOutputColumns(const ChainAccess &chain, uint32_t beginTxNum, uint32_t endTxNum) {
+            auto outputNum = [&](uint32_t txNum) {
+                return txNum < chain.txCount() ? chain.getFirstOutputNumber(txNum) : chain.outputCount();
+            };
+            if (beginTxNum >= endTxNum) {
+                auto begin = outputNum(beginTxNum);
+                return chain.getOutputColumns(begin, begin);
+            }
+            return chain.getOutputColumns(outputNum(beginTxNum), outputNum(endTxNum));
+        }
+    }
+    
+    bool hasOutputColumns(DataAccess &access) {
+        auto &chain = access.getChain();
+        return chain.outputColumnsSize() >= chain.outputCount();
+    }
+    
+    OutputColumns outputColumns(const Transaction &tx) {
+        auto &chain = tx.getAccess().getChain();
+        auto begin = chain.getFirstOutputNumber(tx.txNum);
+        return chain.getOutputColumns(begin, begin + tx.outputCount());
+    }
+    
+    OutputColumns outputColumns(const TransactionRange &txes) {
+        return txRangeOutputColumns(txes.getAccess().getChain(), txes.firstTxIndex(), txes.endTxIndex());
+    }
+    
+    OutputColumns outputColumns(BlockRange &blocks) {
+        if (blocks.size() == 0) {
+            return {};
+        }
+        return txRangeOutputColumns(blocks.getAccess().getChain(), blocks.firstTxIndex(), blocks.endTxIndex());
+    }
+} // namespace blocksci
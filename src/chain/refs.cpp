@@ -0,0 +1,127 @@
+//
+//  refs.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include <blocksci/chain/refs.hpp>
+#include <blocksci/chain/input.hpp>
+#include <blocksci/chain/output.hpp>
+#include <blocksci/chain/transaction.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+
+namespace blocksci {
+
+    namespace {
+        const Inout &outputInout(const OutputRef &output, DataAccess &access) {
+            return access.getChain().getTx(output.txNum)->getOutput(output.inoutNum);
+        }
+
+        const Inout &inputInout(const InputRef &input, DataAccess &access) {
+            return access.getChain().getTx(input.txNum)->getInput(input.inoutNum);
+        }
+    }
+
+    TxRef::TxRef(const Transaction &tx) : txNum(tx.txNum) {}
+
+    Transaction materialize(TxRef tx, DataAccess &access) {
+        return Transaction(tx.txNum, access);
+    }
+
+    Output materialize(const OutputRef &output, DataAccess &access) {
+        return Output(output, access);
+    }
+
+    Input materialize(const InputRef &input, DataAccess &access) {
+        return Input(input, access);
+    }
+
+    uint16_t inputCount(TxRef tx, DataAccess &access) {
+        return access.getChain().getTx(tx.txNum)->inputCount;
+    }
+
+    uint16_t outputCount(TxRef tx, DataAccess &access) {
+        return access.getChain().getTx(tx.txNum)->outputCount;
+    }
+
+    BlockHeight getBlockHeight(TxRef tx, DataAccess &access) {
+        return access.getChain().getBlockHeight(tx.txNum);
+    }
+
+    bool isCoinbase(TxRef tx, DataAccess &access) {
+        return inputCount(tx, access) == 0;
+    }
+
+    int64_t totalInputValue(TxRef tx, DataAccess &access) {
+        auto rawTx = access.getChain().getTx(tx.txNum);
+        int64_t total = 0;
+        for (auto input = rawTx->beginInputs(); input != rawTx->endInputs(); ++input) {
+            total += input->getValue();
+        }
+        return total;
+    }
+
+    int64_t totalOutputValue(TxRef tx, DataAccess &access) {
+        auto rawTx = access.getChain().getTx(tx.txNum);
+        int64_t total = 0;
+        for (auto output = rawTx->beginOutputs(); output != rawTx->endOutputs(); ++output) {
+            total += output->getValue();
+        }
+        return total;
+    }
+
+    int64_t fee(TxRef tx, DataAccess &access) {
+        if (auto storedFee = access.getChain().getTxFee(tx.txNum)) {
+            return *storedFee;
+        }
+        if (isCoinbase(tx, access)) {
+            return 0;
+        }
+        return totalInputValue(tx, access) - totalOutputValue(tx, access);
+    }
+
+    int64_t getValue(const OutputRef &output, DataAccess &access) {
+        return outputInout(output, access).getValue();
+    }
+
+    AddressType::Enum getType(const OutputRef &output, DataAccess &access) {
+        return outputInout(output, access).getType();
+    }
+
+    uint32_t getAddressNum(const OutputRef &output, DataAccess &access) {
+        return outputInout(output, access).getAddressNum();
+    }
+
+    bool isSpent(const OutputRef &output, DataAccess &access) {
+        return static_cast<bool>(getSpendingTx(output, access));
+    }
+
+    ranges::optional<TxRef> getSpendingTx(const OutputRef &output, DataAccess &access) {
+        // Same rule as Output: links to txes beyond the loaded ones don't count
+        auto linkedTxNum = outputInout(output, access).getLinkedTxNum();
+        if (linkedTxNum > 0 && linkedTxNum < access.getChain().txCount()) {
+            return TxRef{linkedTxNum};
+        }
+        return ranges::nullopt;
+    }
+
+    int64_t getValue(const InputRef &input, DataAccess &access) {
+        return inputInout(input, access).getValue();
+    }
+
+    AddressType::Enum getType(const InputRef &input, DataAccess &access) {
+        return inputInout(input, access).getType();
+    }
+
+    uint32_t getAddressNum(const InputRef &input, DataAccess &access) {
+        return inputInout(input, access).getAddressNum();
+    }
+
+    OutputRef getSpentOutput(const InputRef &input, DataAccess &access) {
+        auto &chain = access.getChain();
+        return {inputInout(input, access).getLinkedTxNum(), chain.getSpentOutputNumbers(input.txNum)[input.inoutNum]};
+    }
+} // namespace blocksci
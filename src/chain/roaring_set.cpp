@@ -0,0 +1,524 @@
+//
+//  roaring_set.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include <blocksci/chain/roaring_set.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+
+namespace blocksci {
+
+    namespace {
+        using Container = RoaringSet::Container;
+
+        constexpr char fileMagic[8] = {'B', 'S', 'C', 'I', 'R', 'S', 'E', 'T'};
+        constexpr uint32_t fileVersion = 1;
+
+        uint32_t popcount(const std::vector<uint64_t> &words) {
+            uint32_t count = 0;
+            for (auto word : words) {
+                count += static_cast<uint32_t>(__builtin_popcountll(word));
+            }
+            return count;
+        }
+
+        std::vector<uint64_t> toBitmap(const Container &container) {
+            if (container.isBitmap()) {
+                return container.bitmap;
+            }
+            std::vector<uint64_t> words(RoaringSet::bitmapWords, 0);
+            for (auto low : container.array) {
+                words[low >> 6] |= uint64_t{1} << (low & 63);
+            }
+            return words;
+        }
+
+        Container fromBitmap(uint64_t key, std::vector<uint64_t> words) {
+            Container container;
+            container.key = key;
+            container.cardinality = popcount(words);
+            container.bitmap = std::move(words);
+            container.normalize();
+            return container;
+        }
+
+        Container fromArray(uint64_t key, std::vector<uint16_t> values) {
+            Container container;
+            container.key = key;
+            container.cardinality = static_cast<uint32_t>(values.size());
+            container.array = std::move(values);
+            container.normalize();
+            return container;
+        }
+
+        Container containerUnion(const Container &a, const Container &b) {
+            if (!a.isBitmap() && !b.isBitmap()) {
+                std::vector<uint16_t> values;
+                values.reserve(a.array.size() + b.array.size());
+                std::set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), std::back_inserter(values));
+                return fromArray(a.key, std::move(values));
+            }
+            const auto &bitmapSide = a.isBitmap() ? a : b;
+            const auto &otherSide = a.isBitmap() ? b : a;
+            auto words = bitmapSide.bitmap;
+            if (otherSide.isBitmap()) {
+                for (uint32_t i = 0; i < RoaringSet::bitmapWords; i++) {
+                    words[i] |= otherSide.bitmap[i];
+                }
+            } else {
+                for (auto low : otherSide.array) {
+                    words[low >> 6] |= uint64_t{1} << (low & 63);
+                }
+            }
+            return fromBitmap(a.key, std::move(words));
+        }
+
+        Container containerIntersection(const Container &a, const Container &b) {
+            if (!a.isBitmap() && !b.isBitmap()) {
+                std::vector<uint16_t> values;
+                std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), std::back_inserter(values));
+                return fromArray(a.key, std::move(values));
+            }
+            if (a.isBitmap() && b.isBitmap()) {
+                std::vector<uint64_t> words(RoaringSet::bitmapWords);
+                for (uint32_t i = 0; i < RoaringSet::bitmapWords; i++) {
+                    words[i] = a.bitmap[i] & b.bitmap[i];
+                }
+                return fromBitmap(a.key, std::move(words));
+            }
+            const auto &arraySide = a.isBitmap() ? b : a;
+            const auto &bitmapSide = a.isBitmap() ? a : b;
+            std::vector<uint16_t> values;
+            values.reserve(arraySide.array.size());
+            for (auto low : arraySide.array) {
+                if (bitmapSide.contains(low)) {
+                    values.push_back(low);
+                }
+            }
+            return fromArray(a.key, std::move(values));
+        }
+
+        Container containerDifference(const Container &a, const Container &b) {
+            if (!a.isBitmap()) {
+                std::vector<uint16_t> values;
+                values.reserve(a.array.size());
+                if (b.isBitmap()) {
+                    for (auto low : a.array) {
+                        if (!b.contains(low)) {
+                            values.push_back(low);
+                        }
+                    }
+                } else {
+                    std::set_difference(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), std::back_inserter(values));
+                }
+                return fromArray(a.key, std::move(values));
+            }
+            auto words = a.bitmap;
+            if (b.isBitmap()) {
+                for (uint32_t i = 0; i < RoaringSet::bitmapWords; i++) {
+                    words[i] &= ~b.bitmap[i];
+                }
+            } else {
+                for (auto low : b.array) {
+                    words[low >> 6] &= ~(uint64_t{1} << (low & 63));
+                }
+            }
+            return fromBitmap(a.key, std::move(words));
+        }
+
+        template <typename T>
+        void buildFromSorted(const T *begin, const T *end, std::vector<Container> &containers) {
+            auto it = begin;
+            while (it != end) {
+                auto key = static_cast<uint64_t>(*it) >> 16;
+                auto groupEnd = std::upper_bound(it, end, static_cast<T>(((key + 1) << 16) - 1));
+                std::vector<uint16_t> values;
+                values.reserve(static_cast<size_t>(groupEnd - it));
+                for (auto value = it; value != groupEnd; ++value) {
+                    values.push_back(static_cast<uint16_t>(*value & 0xffff));
+                }
+                containers.push_back(fromArray(key, std::move(values)));
+                it = groupEnd;
+            }
+        }
+    }
+
+    bool RoaringSet::Container::contains(uint16_t low) const {
+        if (isBitmap()) {
+            return (bitmap[low >> 6] >> (low & 63)) & 1;
+        }
+        return std::binary_search(array.begin(), array.end(), low);
+    }
+
+    bool RoaringSet::Container::add(uint16_t low) {
+        if (isBitmap()) {
+            auto &word = bitmap[low >> 6];
+            auto bit = uint64_t{1} << (low & 63);
+            if (word & bit) {
+                return false;
+            }
+            word |= bit;
+        } else {
+            auto it = std::lower_bound(array.begin(), array.end(), low);
+            if (it != array.end() && *it == low) {
+                return false;
+            }
+            array.insert(it, low);
+        }
+        cardinality++;
+        normalize();
+        return true;
+    }
+
+    bool RoaringSet::Container::remove(uint16_t low) {
+        if (isBitmap()) {
+            auto &word = bitmap[low >> 6];
+            auto bit = uint64_t{1} << (low & 63);
+            if (!(word & bit)) {
+                return false;
+            }
+            word &= ~bit;
+        } else {
+            auto it = std::lower_bound(array.begin(), array.end(), low);
+            if (it == array.end() || *it != low) {
+                return false;
+            }
+            array.erase(it);
+        }
+        cardinality--;
+        normalize();
+        return true;
+    }
+
+    void RoaringSet::Container::normalize() {
+        if (isBitmap() && cardinality <= maxArraySize) {
+            std::vector<uint16_t> values;
+            values.reserve(cardinality);
+            for (uint32_t i = 0; i < bitmapWords; i++) {
+                auto word = bitmap[i];
+                while (word != 0) {
+                    values.push_back(static_cast<uint16_t>(i * 64 + static_cast<uint32_t>(__builtin_ctzll(word))));
+                    word &= word - 1;
+                }
+            }
+            array = std::move(values);
+            std::vector<uint64_t>{}.swap(bitmap);
+        } else if (!isBitmap() && cardinality > maxArraySize) {
+            bitmap = toBitmap(*this);
+            std::vector<uint16_t>{}.swap(array);
+        }
+    }
+
+    RoaringSet::const_iterator::const_iterator(const RoaringSet *set_, size_t containerNum_) : set(set_), containerNum(containerNum_) {
+        settle();
+    }
+
+    void RoaringSet::const_iterator::settle() {
+        while (containerNum < set->containers.size()) {
+            auto &container = set->containers[containerNum];
+            if (container.isBitmap()) {
+                auto wordNum = position >> 6;
+                if (wordNum < bitmapWords) {
+                    auto word = container.bitmap[wordNum] & (~uint64_t{0} << (position & 63));
+                    while (word == 0 && ++wordNum < bitmapWords) {
+                        word = container.bitmap[wordNum];
+                    }
+                    if (word != 0) {
+                        position = wordNum * 64 + static_cast<uint32_t>(__builtin_ctzll(word));
+                        current = (container.key << 16) | position;
+                        return;
+                    }
+                }
+            } else if (position < container.array.size()) {
+                current = (container.key << 16) | container.array[position];
+                return;
+            }
+            containerNum++;
+            position = 0;
+        }
+    }
+
+    RoaringSet::const_iterator &RoaringSet::const_iterator::operator++() {
+        position++;
+        settle();
+        return *this;
+    }
+
+    RoaringSet::RoaringSet(std::vector<uint64_t> values) {
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+        *this = fromSorted(values.data(), values.data() + values.size());
+    }
+
+    RoaringSet RoaringSet::fromSorted(const uint64_t *begin, const uint64_t *end) {
+        RoaringSet set;
+        buildFromSorted(begin, end, set.containers);
+        return set;
+    }
+
+    RoaringSet RoaringSet::fromSorted(const uint32_t *begin, const uint32_t *end) {
+        RoaringSet set;
+        buildFromSorted(begin, end, set.containers);
+        return set;
+    }
+
+    RoaringSet RoaringSet::fromInterval(uint64_t begin, uint64_t end) {
+        RoaringSet set;
+        if (begin >= end) {
+            return set;
+        }
+        auto lastKey = (end - 1) >> 16;
+        for (auto key = begin >> 16; key <= lastKey; key++) {
+            auto lowBegin = key == (begin >> 16) ? static_cast<uint32_t>(begin & 0xffff) : 0u;
+            auto lowEnd = key == lastKey ? static_cast<uint32_t>((end - 1) & 0xffff) + 1 : 1u << 16;
+            std::vector<uint64_t> words(bitmapWords, 0);
+            auto low = lowBegin;
+            while (low < lowEnd) {
+                auto bitEnd = std::min(lowEnd, (low | 63) + 1);
+                auto bitCount = bitEnd - low;
+                auto bits = bitCount == 64 ? ~uint64_t{0} : ((uint64_t{1} << bitCount) - 1);
+                words[low >> 6] |= bits << (low & 63);
+                low = bitEnd;
+            }
+            set.containers.push_back(fromBitmap(key, std::move(words)));
+        }
+        return set;
+    }
+
+    std::vector<RoaringSet::Container>::iterator RoaringSet::findContainer(uint64_t key) {
+        return std::lower_bound(containers.begin(), containers.end(), key, [](const Container &container, uint64_t k) {
+            return container.key < k;
+        });
+    }
+
+    std::vector<RoaringSet::Container>::const_iterator RoaringSet::findContainer(uint64_t key) const {
+        return std::lower_bound(containers.begin(), containers.end(), key, [](const Container &container, uint64_t k) {
+            return container.key < k;
+        });
+    }
+
+    bool RoaringSet::add(uint64_t value) {
+        auto key = value >> 16;
+        auto it = findContainer(key);
+        if (it == containers.end() || it->key != key) {
+            Container container;
+            container.key = key;
+            it = containers.insert(it, std::move(container));
+        }
+        return it->add(static_cast<uint16_t>(value & 0xffff));
+    }
+
+    bool RoaringSet::remove(uint64_t value) {
+        auto key = value >> 16;
+        auto it = findContainer(key);
+        if (it == containers.end() || it->key != key) {
+            return false;
+        }
+        auto removed = it->remove(static_cast<uint16_t>(value & 0xffff));
+        if (it->cardinality == 0) {
+            containers.erase(it);
+        }
+        return removed;
+    }
+
+    bool RoaringSet::contains(uint64_t value) const {
+        auto key = value >> 16;
+        auto it = findContainer(key);
+        return it != containers.end() && it->key == key && it->contains(static_cast<uint16_t>(value & 0xffff));
+    }
+
+    uint64_t RoaringSet::size() const {
+        uint64_t total = 0;
+        for (auto &container : containers) {
+            total += container.cardinality;
+        }
+        return total;
+    }
+
+    uint64_t RoaringSet::min() const {
+        if (empty()) {
+            throw std::out_of_range("min of an empty set");
+        }
+        return *begin();
+    }
+
+    uint64_t RoaringSet::max() const {
+        if (empty()) {
+            throw std::out_of_range("max of an empty set");
+        }
+        auto &container = containers.back();
+        if (!container.isBitmap()) {
+            return (container.key << 16) | container.array.back();
+        }
+        for (auto wordNum = bitmapWords; wordNum-- > 0;) {
+            auto word = container.bitmap[wordNum];
+            if (word != 0) {
+                return (container.key << 16) | (wordNum * 64 + 63 - static_cast<uint32_t>(__builtin_clzll(word)));
+            }
+        }
+        return container.key << 16;
+    }
+
+    std::vector<uint64_t> RoaringSet::toVector() const {
+        std::vector<uint64_t> values;
+        values.reserve(static_cast<size_t>(size()));
+        std::copy(begin(), end(), std::back_inserter(values));
+        return values;
+    }
+
+    size_t RoaringSet::memoryUsage() const {
+        auto total = containers.capacity() * sizeof(Container);
+        for (auto &container : containers) {
+            total += container.array.capacity() * sizeof(uint16_t) + container.bitmap.capacity() * sizeof(uint64_t);
+        }
+        return total;
+    }
+
+    RoaringSet &RoaringSet::operator|=(const RoaringSet &other) {
+        std::vector<Container> merged;
+        merged.reserve(containers.size() + other.containers.size());
+        auto a = containers.begin();
+        auto b = other.containers.begin();
+        while (a != containers.end() || b != other.containers.end()) {
+            if (b == other.containers.end() || (a != containers.end() && a->key < b->key)) {
+                merged.push_back(std::move(*a++));
+            } else if (a == containers.end() || b->key < a->key) {
+                merged.push_back(*b++);
+            } else {
+                merged.push_back(containerUnion(*a++, *b++));
+            }
+        }
+        containers = std::move(merged);
+        return *this;
+    }
+
+    RoaringSet &RoaringSet::operator&=(const RoaringSet &other) {
+        std::vector<Container> intersected;
+        auto a = containers.begin();
+        auto b = other.containers.begin();
+        while (a != containers.end() && b != other.containers.end()) {
+            if (a->key < b->key) {
+                ++a;
+            } else if (b->key < a->key) {
+                ++b;
+            } else {
+                auto container = containerIntersection(*a++, *b++);
+                if (container.cardinality > 0) {
+                    intersected.push_back(std::move(container));
+                }
+            }
+        }
+        containers = std::move(intersected);
+        return *this;
+    }
+
+    RoaringSet &RoaringSet::operator-=(const RoaringSet &other) {
+        std::vector<Container> remaining;
+        remaining.reserve(containers.size());
+        auto b = other.containers.begin();
+        for (auto &container : containers) {
+            while (b != other.containers.end() && b->key < container.key) {
+                ++b;
+            }
+            if (b == other.containers.end() || b->key != container.key) {
+                remaining.push_back(std::move(container));
+            } else {
+                auto difference = containerDifference(container, *b);
+                if (difference.cardinality > 0) {
+                    remaining.push_back(std::move(difference));
+                }
+            }
+        }
+        containers = std::move(remaining);
+        return *this;
+    }
+
+    bool operator==(const RoaringSet &a, const RoaringSet &b) {
+        if (a.containers.size() != b.containers.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.containers.size(); i++) {
+            auto &x = a.containers[i];
+            auto &y = b.containers[i];
+            if (x.key != y.key || x.cardinality != y.cardinality || x.array != y.array || x.bitmap != y.bitmap) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void RoaringSet::save(const std::string &path) const {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            throw std::runtime_error("Could not open " + path + " for writing");
+        }
+        uint64_t containerCount = containers.size();
+        file.write(fileMagic, sizeof(fileMagic));
+        file.write(reinterpret_cast<const char *>(&fileVersion), sizeof(fileVersion));
+        file.write(reinterpret_cast<const char *>(&containerCount), sizeof(containerCount));
+        for (auto &container : containers) {
+            file.write(reinterpret_cast<const char *>(&container.key), sizeof(container.key));
+            file.write(reinterpret_cast<const char *>(&container.cardinality), sizeof(container.cardinality));
+            if (container.isBitmap()) {
+                file.write(reinterpret_cast<const char *>(container.bitmap.data()), static_cast<std::streamsize>(container.bitmap.size() * sizeof(uint64_t)));
+            } else {
+                file.write(reinterpret_cast<const char *>(container.array.data()), static_cast<std::streamsize>(container.array.size() * sizeof(uint16_t)));
+            }
+        }
+        if (!file) {
+            throw std::runtime_error("Error writing " + path);
+        }
+    }
+
+    RoaringSet RoaringSet::load(const std::string &path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Could not open " + path);
+        }
+        auto malformed = [&]() {
+            return std::runtime_error(path + " is not a valid set file");
+        };
+        char magic[sizeof(fileMagic)];
+        uint32_t version = 0;
+        uint64_t containerCount = 0;
+        file.read(magic, sizeof(magic));
+        file.read(reinterpret_cast<char *>(&version), sizeof(version));
+        file.read(reinterpret_cast<char *>(&containerCount), sizeof(containerCount));
+        if (!file || std::memcmp(magic, fileMagic, sizeof(fileMagic)) != 0 || version != fileVersion) {
+            throw malformed();
+        }
+        RoaringSet set;
+        for (uint64_t i = 0; i < containerCount; i++) {
+            Container container;
+            file.read(reinterpret_cast<char *>(&container.key), sizeof(container.key));
+            file.read(reinterpret_cast<char *>(&container.cardinality), sizeof(container.cardinality));
+            if (!file || container.cardinality == 0 || container.cardinality > (1u << 16) ||
+                (!set.containers.empty() && set.containers.back().key >= container.key)) {
+                throw malformed();
+            }
+            if (container.cardinality > maxArraySize) {
+                container.bitmap.resize(bitmapWords);
+                file.read(reinterpret_cast<char *>(container.bitmap.data()), static_cast<std::streamsize>(bitmapWords * sizeof(uint64_t)));
+                if (!file || popcount(container.bitmap) != container.cardinality) {
+                    throw malformed();
+                }
+            } else {
+                container.array.resize(container.cardinality);
+                file.read(reinterpret_cast<char *>(container.array.data()), static_cast<std::streamsize>(container.cardinality * sizeof(uint16_t)));
+                if (!file || std::adjacent_find(container.array.begin(), container.array.end(), std::greater_equal<uint16_t>()) != container.array.end()) {
+                    throw malformed();
+                }
+            }
+            set.containers.push_back(std::move(container));
+        }
+        return set;
+    }
+} // namespace blocksci
@@ -0,0 +1,289 @@
+//
+//  sampling.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include <blocksci/chain/sampling.hpp>
+#include <blocksci/chain/block_range.hpp>
+#include <blocksci/chain/output_columns.hpp>
+#include <blocksci/core/address_types.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/chain_numbering.hpp>
+#include <internal/data_access.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace blocksci {
+    namespace {
+        /** Separate streams for the parts of a sample, so that they don't depend on the order they are drawn in */
+        std::mt19937_64 makeRng(uint64_t seed, uint64_t stream) {
+            std::seed_seq seq{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32), static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32)};
+            return std::mt19937_64{seq};
+        }
+
+        void checkProbability(double probability) {
+            if (!(probability >= 0 && probability <= 1)) {
+                throw std::invalid_argument("Sampling probabilities must be between 0 and 1");
+            }
+        }
+
+        /** Append a Bernoulli sample of [begin, end) to sample, jumping over geometrically distributed gaps */
+        template <typename T>
+        void bernoulliSample(uint64_t begin, uint64_t end, double probability, std::mt19937_64 &rng, std::vector<T> &sample) {
+            if (probability >= 1) {
+                for (auto i = begin; i < end; i++) {
+                    sample.push_back(static_cast<T>(i));
+                }
+                return;
+            }
+            if (probability <= 0) {
+                return;
+            }
+            std::geometric_distribution<uint64_t> gap{probability};
+            auto i = begin;
+            while (true) {
+                auto skip = gap(rng);
+                if (skip >= end - i) {
+                    return;
+                }
+                i += skip;
+                sample.push_back(static_cast<T>(i));
+                i++;
+            }
+        }
+
+        /** Append count numbers drawn uniformly without replacement from [begin, end) to sample in ascending order
+         *
+         * Floyd's algorithm draws exactly count random numbers, drawing the complement instead if it is smaller. */
+        template <typename T>
+        void uniformSample(uint64_t begin, uint64_t end, uint64_t count, std::mt19937_64 &rng, std::vector<T> &sample) {
+            auto total = end - begin;
+            if (count >= total) {
+                for (auto i = begin; i < end; i++) {
+                    sample.push_back(static_cast<T>(i));
+                }
+                return;
+            }
+            bool complement = count > total / 2;
+            auto drawn = complement ? total - count : count;
+            std::unordered_set<uint64_t> chosen;
+            chosen.reserve(drawn);
+            for (auto j = total - drawn; j < total; j++) {
+                auto candidate = std::uniform_int_distribution<uint64_t>{0, j}(rng);
+                if (!chosen.insert(candidate).second) {
+                    chosen.insert(j);
+                }
+            }
+            if (complement) {
+                for (uint64_t i = 0; i < total; i++) {
+                    if (chosen.find(i) == chosen.end()) {
+                        sample.push_back(static_cast<T>(begin + i));
+                    }
+                }
+                return;
+            }
+            auto first = sample.size();
+            for (auto i : chosen) {
+                sample.push_back(static_cast<T>(begin + i));
+            }
+            std::sort(sample.begin() + static_cast<std::ptrdiff_t>(first), sample.end());
+        }
+
+        std::vector<BlockHeight> bucketStarts(const BlockRange &blocks, BlockHeight bucketBlocks) {
+            if (bucketBlocks <= 0) {
+                throw std::invalid_argument("Buckets must hold at least one block");
+            }
+            std::vector<BlockHeight> starts;
+            for (auto height = blocks.sl.start; height < blocks.sl.stop; height += bucketBlocks) {
+                starts.push_back(height);
+            }
+            return starts;
+        }
+
+        /** Uniform sample without replacement of the items of one stratum seen so far (Algorithm L)
+         *
+         * Once full, the position of the next item to replace is drawn ahead, so items in between cost a comparison. */
+        struct Reservoir {
+            uint64_t seen = 0;
+            uint64_t nextReplacement = 0;
+            double weight = 1;
+            std::vector<uint64_t> items;
+
+            void add(uint64_t item, uint64_t capacity, std::mt19937_64 &rng) {
+                seen++;
+                if (items.size() < capacity) {
+                    items.push_back(item);
+                    if (items.size() == capacity) {
+                        weight = std::exp(std::log(uniform(rng)) / static_cast<double>(capacity));
+                        drawNext(rng);
+                    }
+                } else if (seen == nextReplacement) {
+                    items[std::uniform_int_distribution<size_t>{0, items.size() - 1}(rng)] = item;
+                    weight *= std::exp(std::log(uniform(rng)) / static_cast<double>(capacity));
+                    drawNext(rng);
+                }
+            }
+
+            /** Combine with the sample of another part of the stratum into a uniform sample of both */
+            void merge(Reservoir &other, uint64_t capacity, std::mt19937_64 &rng) {
+                std::shuffle(items.begin(), items.end(), rng);
+                std::shuffle(other.items.begin(), other.items.end(), rng);
+                std::vector<uint64_t> merged;
+                auto remaining = seen;
+                auto otherRemaining = other.seen;
+                size_t taken = 0;
+                size_t otherTaken = 0;
+                while (merged.size() < capacity && remaining + otherRemaining > 0) {
+                    auto pick = std::uniform_int_distribution<uint64_t>{0, remaining + otherRemaining - 1}(rng);
+                    if (pick < remaining) {
+                        merged.push_back(items[taken++]);
+                        remaining--;
+                    } else {
+                        merged.push_back(other.items[otherTaken++]);
+                        otherRemaining--;
+                    }
+                }
+                seen += other.seen;
+                items = std::move(merged);
+            }
+
+        private:
+            static double uniform(std::mt19937_64 &rng) {
+                return std::uniform_real_distribution<double>{std::nextafter(0.0, 1.0), 1.0}(rng);
+            }
+
+            void drawNext(std::mt19937_64 &rng) {
+                auto skip = std::floor(std::log(uniform(rng)) / std::log1p(-weight));
+                nextReplacement = skip < 1e18 ? seen + static_cast<uint64_t>(skip) + 1 : std::numeric_limits<uint64_t>::max();
+            }
+        };
+
+        /** Reservoirs of the strata touched by one mapReduce chunk */
+        struct StrataPart {
+            BlockHeight start = 0;
+            std::unordered_map<uint64_t, Reservoir> strata;
+        };
+    } // namespace
+
+    std::vector<uint32_t> bernoulliTxSample(BlockRange &blocks, double probability, uint64_t seed) {
+        checkProbability(probability);
+        auto range = txNumRange(blocks.getAccess().getChain(), blocks.sl.start, blocks.sl.stop);
+        auto rng = makeRng(seed, 0);
+        std::vector<uint32_t> sample;
+        sample.reserve(static_cast<size_t>(static_cast<double>(range.second - range.first) * probability * 1.01) + 16);
+        bernoulliSample(range.first, range.second, probability, rng, sample);
+        return sample;
+    }
+
+    std::vector<uint32_t> uniformTxSample(BlockRange &blocks, uint64_t count, uint64_t seed) {
+        auto range = txNumRange(blocks.getAccess().getChain(), blocks.sl.start, blocks.sl.stop);
+        auto rng = makeRng(seed, 0);
+        std::vector<uint32_t> sample;
+        uniformSample(range.first, range.second, count, rng, sample);
+        return sample;
+    }
+
+    std::vector<OutputPointer> bernoulliOutputSample(BlockRange &blocks, double probability, uint64_t seed) {
+        checkProbability(probability);
+        auto &chain = blocks.getAccess().getChain();
+        auto range = outputNumRange(chain, blocks.sl.start, blocks.sl.stop);
+        auto rng = makeRng(seed, 0);
+        std::vector<uint64_t> sample;
+        bernoulliSample(range.first, range.second, probability, rng, sample);
+        return outputPointers(chain, sample);
+    }
+
+    std::vector<OutputPointer> uniformOutputSample(BlockRange &blocks, uint64_t count, uint64_t seed) {
+        auto &chain = blocks.getAccess().getChain();
+        auto range = outputNumRange(chain, blocks.sl.start, blocks.sl.stop);
+        auto rng = makeRng(seed, 0);
+        std::vector<uint64_t> sample;
+        uniformSample(range.first, range.second, count, rng, sample);
+        return outputPointers(chain, sample);
+    }
+
+    StratifiedTxSample stratifiedTxSample(BlockRange &blocks, BlockHeight bucketBlocks, uint64_t perBucket, uint64_t seed) {
+        auto &chain = blocks.getAccess().getChain();
+        StratifiedTxSample sample;
+        sample.bucketStarts = bucketStarts(blocks, bucketBlocks);
+        sample.offsets.push_back(0);
+        for (auto start : sample.bucketStarts) {
+            auto range = txNumRange(chain, start, std::min(start + bucketBlocks, blocks.sl.stop));
+            auto rng = makeRng(seed, static_cast<uint64_t>(start));
+            uniformSample(range.first, range.second, perBucket, rng, sample.txNums);
+            sample.offsets.push_back(sample.txNums.size());
+        }
+        return sample;
+    }
+
+    StratifiedOutputSample stratifiedOutputSample(BlockRange &blocks, BlockHeight bucketBlocks, uint64_t perStratum, bool byAddressType, uint64_t seed) {
+        auto &chain = blocks.getAccess().getChain();
+        StratifiedOutputSample sample;
+        sample.bucketStarts = bucketStarts(blocks, bucketBlocks);
+        sample.byAddressType = byAddressType;
+        sample.offsets.push_back(0);
+        std::vector<uint64_t> outputNums;
+        if (!byAddressType) {
+            for (auto start : sample.bucketStarts) {
+                auto range = outputNumRange(chain, start, std::min(start + bucketBlocks, blocks.sl.stop));
+                auto rng = makeRng(seed, static_cast<uint64_t>(start));
+                uniformSample(range.first, range.second, perStratum, rng, outputNums);
+                sample.offsets.push_back(outputNums.size());
+            }
+            sample.outputs = outputPointers(chain, outputNums);
+            return sample;
+        }
+
+        auto strataCount = sample.bucketStarts.size() * AddressType::size;
+        StrataPart merged;
+        if (blocks.size() > 0 && perStratum > 0) {
+            merged = blocks.mapReduce<StrataPart>([&](const BlockRange &chunk) {
+                auto chunkBlocks = chunk;
+                auto columns = outputColumns(chunkBlocks);
+                StrataPart part;
+                part.start = chunk.sl.start;
+                auto rng = makeRng(seed, static_cast<uint64_t>(chunk.sl.start));
+                uint64_t row = 0;
+                for (auto height = chunk.sl.start; height < chunk.sl.stop; height++) {
+                    auto stratumBase = static_cast<uint64_t>((height - blocks.sl.start) / bucketBlocks) * AddressType::size;
+                    auto blockEnd = row + chain.getBlock(height)->outputCount;
+                    for (; row < blockEnd; row++) {
+                        part.strata[stratumBase + columns.types[row]].add(columns.firstOutputNum + row, perStratum, rng);
+                    }
+                }
+                return part;
+            }, [&](StrataPart &a, StrataPart &b) -> StrataPart & {
+                auto rng = makeRng(seed, (uint64_t{1} << 63) | static_cast<uint64_t>(b.start));
+                for (auto &entry : b.strata) {
+                    auto it = a.strata.find(entry.first);
+                    if (it == a.strata.end()) {
+                        a.strata.emplace(entry.first, std::move(entry.second));
+                    } else {
+                        it->second.merge(entry.second, perStratum, rng);
+                    }
+                }
+                return a;
+            });
+        }
+        for (uint64_t stratum = 0; stratum < strataCount; stratum++) {
+            auto it = merged.strata.find(stratum);
+            if (it != merged.strata.end()) {
+                auto &items = it->second.items;
+                std::sort(items.begin(), items.end());
+                outputNums.insert(outputNums.end(), items.begin(), items.end());
+            }
+            sample.offsets.push_back(outputNums.size());
+        }
+        sample.outputs = outputPointers(chain, outputNums);
+        return sample;
+    }
+} // namespace blocksci
@@ -0,0 +1,82 @@
+//
+//  shard_plan.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include <blocksci/chain/shard_plan.hpp>
+#include <blocksci/chain/sketches.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+
+#include <stdexcept>
+
+namespace blocksci {
+    namespace {
+        /** FNV-1a, stable across builds and platforms unlike std::hash, so every coordinator agrees on the hosts */
+        uint64_t hostHash(const std::string &host) {
+            uint64_t hash = 0xcbf29ce484222325ULL;
+            for (auto c : host) {
+                hash ^= static_cast<unsigned char>(c);
+                hash *= 0x100000001b3ULL;
+            }
+            return hash;
+        }
+    }
+
+    uint32_t shardHost(uint32_t shard, const std::vector<std::string> &hosts) {
+        if (hosts.empty()) {
+            throw std::invalid_argument("Cannot assign shards without any hosts");
+        }
+        uint32_t best = 0;
+        uint64_t bestScore = 0;
+        for (uint32_t i = 0; i < hosts.size(); i++) {
+            auto score = sketchHash(hostHash(hosts[i]) ^ sketchHash(shard));
+            if (i == 0 || score > bestScore) {
+                best = i;
+                bestScore = score;
+            }
+        }
+        return best;
+    }
+
+    std::vector<BlockShard> planShards(BlockRange &blocks, const std::vector<std::string> &hosts, uint32_t shardTxCount) {
+        if (shardTxCount == 0) {
+            throw std::invalid_argument("Shards must hold at least one tx");
+        }
+        if (hosts.empty()) {
+            throw std::invalid_argument("Cannot assign shards without any hosts");
+        }
+        std::vector<BlockShard> shards;
+        if (blocks.size() <= 0) {
+            return shards;
+        }
+        auto &chain = blocks.getAccess().getChain();
+        auto firstTx = [&](BlockHeight height) {
+            return chain.getBlock(height)->firstTxIndex;
+        };
+        auto start = blocks.sl.start;
+        auto stop = blocks.sl.stop;
+        auto shardStart = start;
+        while (shardStart < stop) {
+            auto shard = firstTx(shardStart) / shardTxCount;
+            auto nextShardTx = (static_cast<uint64_t>(shard) + 1) * shardTxCount;
+            // First height after shardStart whose first tx belongs to a later shard
+            auto low = shardStart + 1;
+            auto high = stop;
+            while (low < high) {
+                auto mid = low + (high - low) / 2;
+                if (firstTx(mid) < nextShardTx) {
+                    low = mid + 1;
+                } else {
+                    high = mid;
+                }
+            }
+            shards.push_back(BlockShard{shard, shardHost(shard, hosts), blocks[{shardStart - start, low - start}]});
+            shardStart = low;
+        }
+        return shards;
+    }
+} // namespace blocksci
@@ -0,0 +1,492 @@
+//
+//  sketches.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include <blocksci/chain/sketches.hpp>
+#include <blocksci/chain/block.hpp>
+#include <blocksci/chain/block_range.hpp>
+#include <blocksci/chain/transaction.hpp>
+
+#include <range/v3/range_for.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace blocksci {
+    namespace {
+        /** Tags of the serialized sketches, followed by the format version */
+        constexpr char hyperLogLogTag = 'H';
+        constexpr char countMinTag = 'C';
+        constexpr char quantileTag = 'Q';
+        constexpr uint8_t sketchFormatVersion = 1;
+
+        template <typename T>
+        void writeValue(std::string &data, const T &value) {
+            data.append(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+
+        template <typename T>
+        void writeValues(std::string &data, const std::vector<T> &values) {
+            data.append(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+        }
+
+        /** Reads the fields written by serialize, throwing std::invalid_argument if the data ends early */
+        class SketchReader {
+            const std::string &data;
+            const char *name;
+            size_t position = 0;
+
+        public:
+            SketchReader(const std::string &data_, const char *name_, char tag) : data(data_), name(name_) {
+                if (read<char>() != tag || read<uint8_t>() != sketchFormatVersion) {
+                    fail();
+                }
+            }
+
+            [[noreturn]] void fail() const {
+                throw std::invalid_argument(std::string{"Data is not a serialized "} + name);
+            }
+
+            template <typename T>
+            T read() {
+                T value;
+                readInto(&value, 1);
+                return value;
+            }
+
+            template <typename T>
+            void readInto(T *values, size_t count) {
+                if (count > (data.size() - position) / sizeof(T)) {
+                    fail();
+                }
+                std::memcpy(values, data.data() + position, count * sizeof(T));
+                position += count * sizeof(T);
+            }
+
+            void finish() const {
+                if (position != data.size()) {
+                    fail();
+                }
+            }
+        };
+    }
+
+    HyperLogLog::HyperLogLog(uint8_t precision_) : precision(precision_) {
+        if (precision < 4 || precision > 18) {
+            throw std::invalid_argument("HyperLogLog precision must be between 4 and 18, got " + std::to_string(precision));
+        }
+        registers.resize(size_t{1} << precision, 0);
+    }
+
+    bool HyperLogLog::empty() const {
+        return std::all_of(registers.begin(), registers.end(), [](uint8_t reg) { return reg == 0; });
+    }
+
+    double HyperLogLog::estimate() const {
+        auto m = static_cast<double>(registers.size());
+        double sum = 0;
+        size_t zeros = 0;
+        for (auto reg : registers) {
+            sum += std::ldexp(1.0, -static_cast<int>(reg));
+            zeros += reg == 0;
+        }
+        auto alpha = 0.7213 / (1.0 + 1.079 / m);
+        auto estimate = alpha * m * m / sum;
+        // Linear counting is more accurate while many registers are still empty
+        if (estimate <= 2.5 * m && zeros > 0) {
+            estimate = m * std::log(m / static_cast<double>(zeros));
+        }
+        return estimate;
+    }
+
+    void HyperLogLog::merge(const HyperLogLog &other) {
+        if (precision != other.precision) {
+            if (other.empty()) {
+                return;
+            }
+            if (!empty()) {
+                throw std::invalid_argument("Cannot merge HyperLogLog sketches of different precision");
+            }
+            *this = other;
+            return;
+        }
+        for (size_t i = 0; i < registers.size(); i++) {
+            registers[i] = std::max(registers[i], other.registers[i]);
+        }
+    }
+
+    std::string HyperLogLog::serialize() const {
+        std::string data;
+        writeValue(data, hyperLogLogTag);
+        writeValue(data, sketchFormatVersion);
+        writeValue(data, precision);
+        writeValues(data, registers);
+        return data;
+    }
+
+    HyperLogLog HyperLogLog::deserialize(const std::string &data) {
+        SketchReader reader{data, "HyperLogLog", hyperLogLogTag};
+        auto precision = reader.read<uint8_t>();
+        if (precision < 4 || precision > 18) {
+            reader.fail();
+        }
+        HyperLogLog sketch{precision};
+        reader.readInto(sketch.registers.data(), sketch.registers.size());
+        reader.finish();
+        return sketch;
+    }
+
+    CountMinSketch::CountMinSketch(uint32_t width_, uint32_t depth_) : width(width_), depth(depth_) {
+        if (width == 0 || depth == 0) {
+            throw std::invalid_argument("CountMinSketch width and depth must be positive");
+        }
+        counters.resize(static_cast<size_t>(width) * depth, 0);
+    }
+
+    uint64_t CountMinSketch::estimate(uint64_t key) const {
+        auto result = std::numeric_limits<uint64_t>::max();
+        for (uint32_t row = 0; row < depth; row++) {
+            result = std::min(result, counters[row * width + column(key, row)]);
+        }
+        return result;
+    }
+
+    void CountMinSketch::merge(const CountMinSketch &other) {
+        if (width != other.width || depth != other.depth) {
+            if (other.total == 0) {
+                return;
+            }
+            if (total != 0) {
+                throw std::invalid_argument("Cannot merge CountMinSketch sketches of different dimensions");
+            }
+            *this = other;
+            return;
+        }
+        for (size_t i = 0; i < counters.size(); i++) {
+            counters[i] += other.counters[i];
+        }
+        total += other.total;
+    }
+
+    std::string CountMinSketch::serialize() const {
+        std::string data;
+        writeValue(data, countMinTag);
+        writeValue(data, sketchFormatVersion);
+        writeValue(data, width);
+        writeValue(data, depth);
+        writeValue(data, total);
+        writeValues(data, counters);
+        return data;
+    }
+
+    CountMinSketch CountMinSketch::deserialize(const std::string &data) {
+        SketchReader reader{data, "CountMinSketch", countMinTag};
+        auto width = reader.read<uint32_t>();
+        auto depth = reader.read<uint32_t>();
+        // Check the size before allocating the counters
+        if (width == 0 || depth == 0 || static_cast<uint64_t>(width) * depth > (data.size() / sizeof(uint64_t))) {
+            reader.fail();
+        }
+        CountMinSketch sketch{width, depth};
+        sketch.total = reader.read<uint64_t>();
+        reader.readInto(sketch.counters.data(), sketch.counters.size());
+        reader.finish();
+        return sketch;
+    }
+
+    QuantileSketch::QuantileSketch(uint16_t k_) : k(k_) {
+        if (k < 8) {
+            throw std::invalid_argument("QuantileSketch k must be at least 8, got " + std::to_string(k));
+        }
+    }
+
+    uint32_t QuantileSketch::capacity(size_t level) const {
+        // Levels shrink geometrically by a factor of 2/3 below the top level
+        auto depthBelowTop = static_cast<double>(levels.size() - 1 - level);
+        auto levelCapacity = std::ceil(static_cast<double>(k) * std::pow(2.0 / 3.0, depthBelowTop));
+        return std::max(2u, static_cast<uint32_t>(levelCapacity));
+    }
+
+    size_t QuantileSketch::retainedCount() const {
+        size_t total = 0;
+        for (auto &level : levels) {
+            total += level.size();
+        }
+        return total;
+    }
+
+    size_t QuantileSketch::totalCapacity() const {
+        size_t total = 0;
+        for (size_t i = 0; i < levels.size(); i++) {
+            total += capacity(i);
+        }
+        return total;
+    }
+
+    void QuantileSketch::compress() {
+        while (retainedCount() > totalCapacity()) {
+            for (size_t h = 0; h < levels.size(); h++) {
+                if (levels[h].size() < capacity(h)) {
+                    continue;
+                }
+                if (h + 1 == levels.size()) {
+                    levels.emplace_back();
+                }
+                auto &level = levels[h];
+                auto &nextLevel = levels[h + 1];
+                std::sort(level.begin(), level.end());
+                // An odd value out stays on this level so that the total weight is unchanged
+                bool hasExtra = level.size() % 2 == 1;
+                double extra = hasExtra ? level.back() : 0;
+                if (hasExtra) {
+                    level.pop_back();
+                }
+                randomState ^= randomState << 13;
+                randomState ^= randomState >> 7;
+                randomState ^= randomState << 17;
+                for (size_t i = randomState & 1; i < level.size(); i += 2) {
+                    nextLevel.push_back(level[i]);
+                }
+                level.clear();
+                if (hasExtra) {
+                    level.push_back(extra);
+                }
+                break;
+            }
+        }
+    }
+
+    void QuantileSketch::add(double value) {
+        if (count == 0) {
+            minValue = value;
+            maxValue = value;
+            levels.emplace_back();
+        } else {
+            minValue = std::min(minValue, value);
+            maxValue = std::max(maxValue, value);
+        }
+        count++;
+        levels[0].push_back(value);
+        if (levels[0].size() >= capacity(0)) {
+            compress();
+        }
+    }
+
+    void QuantileSketch::merge(const QuantileSketch &other) {
+        if (other.empty()) {
+            return;
+        }
+        if (empty()) {
+            *this = other;
+            return;
+        }
+        if (k != other.k) {
+            throw std::invalid_argument("Cannot merge QuantileSketch sketches with different k");
+        }
+        count += other.count;
+        minValue = std::min(minValue, other.minValue);
+        maxValue = std::max(maxValue, other.maxValue);
+        if (levels.size() < other.levels.size()) {
+            levels.resize(other.levels.size());
+        }
+        for (size_t h = 0; h < other.levels.size(); h++) {
+            levels[h].insert(levels[h].end(), other.levels[h].begin(), other.levels[h].end());
+        }
+        compress();
+    }
+
+    std::string QuantileSketch::serialize() const {
+        std::string data;
+        writeValue(data, quantileTag);
+        writeValue(data, sketchFormatVersion);
+        writeValue(data, k);
+        writeValue(data, count);
+        writeValue(data, minValue);
+        writeValue(data, maxValue);
+        writeValue(data, randomState);
+        writeValue(data, static_cast<uint32_t>(levels.size()));
+        for (auto &level : levels) {
+            writeValue(data, static_cast<uint32_t>(level.size()));
+            writeValues(data, level);
+        }
+        return data;
+    }
+
+    QuantileSketch QuantileSketch::deserialize(const std::string &data) {
+        SketchReader reader{data, "QuantileSketch", quantileTag};
+        auto k = reader.read<uint16_t>();
+        if (k < 8) {
+            reader.fail();
+        }
+        QuantileSketch sketch{k};
+        sketch.count = reader.read<uint64_t>();
+        sketch.minValue = reader.read<double>();
+        sketch.maxValue = reader.read<double>();
+        sketch.randomState = reader.read<uint64_t>();
+        auto levelCount = reader.read<uint32_t>();
+        if (levelCount > data.size() / sizeof(uint32_t)) {
+            reader.fail();
+        }
+        sketch.levels.resize(levelCount);
+        for (auto &level : sketch.levels) {
+            auto size = reader.read<uint32_t>();
+            if (size > data.size() / sizeof(double)) {
+                reader.fail();
+            }
+            level.resize(size);
+            reader.readInto(level.data(), level.size());
+        }
+        reader.finish();
+        if ((sketch.count == 0) != sketch.levels.empty()) {
+            reader.fail();
+        }
+        return sketch;
+    }
+
+    std::vector<std::pair<double, uint64_t>> QuantileSketch::weightedValues() const {
+        std::vector<std::pair<double, uint64_t>> values;
+        values.reserve(retainedCount());
+        for (size_t h = 0; h < levels.size(); h++) {
+            for (auto value : levels[h]) {
+                values.emplace_back(value, uint64_t{1} << h);
+            }
+        }
+        std::sort(values.begin(), values.end());
+        return values;
+    }
+
+    std::vector<double> QuantileSketch::quantiles(const std::vector<double> &fractions) const {
+        std::vector<double> results;
+        results.reserve(fractions.size());
+        if (empty()) {
+            results.resize(fractions.size(), std::numeric_limits<double>::quiet_NaN());
+            return results;
+        }
+        auto values = weightedValues();
+        std::vector<uint64_t> cumulative;
+        cumulative.reserve(values.size());
+        uint64_t total = 0;
+        for (auto &value : values) {
+            total += value.second;
+            cumulative.push_back(total);
+        }
+        for (auto fraction : fractions) {
+            if (fraction <= 0) {
+                results.push_back(minValue);
+            } else if (fraction >= 1) {
+                results.push_back(maxValue);
+            } else {
+                auto target = static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(total)));
+                auto it = std::lower_bound(cumulative.begin(), cumulative.end(), target);
+                results.push_back(values[static_cast<size_t>(std::distance(cumulative.begin(), it))].first);
+            }
+        }
+        return results;
+    }
+
+    double QuantileSketch::quantile(double fraction) const {
+        return quantiles({fraction}).front();
+    }
+
+    double QuantileSketch::rank(double value) const {
+        if (empty()) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        uint64_t below = 0;
+        uint64_t total = 0;
+        for (size_t h = 0; h < levels.size(); h++) {
+            for (auto retained : levels[h]) {
+                total += uint64_t{1} << h;
+                below += retained <= value ? uint64_t{1} << h : 0;
+            }
+        }
+        return static_cast<double>(below) / static_cast<double>(total);
+    }
+
+    std::vector<uint64_t> QuantileSketch::histogram(const std::vector<double> &splitPoints) const {
+        std::vector<uint64_t> buckets(splitPoints.size() + 1, 0);
+        for (size_t h = 0; h < levels.size(); h++) {
+            for (auto value : levels[h]) {
+                auto bucket = std::upper_bound(splitPoints.begin(), splitPoints.end(), value) - splitPoints.begin();
+                buckets[static_cast<size_t>(bucket)] += uint64_t{1} << h;
+            }
+        }
+        return buckets;
+    }
+
+    HyperLogLog approximateDistinctAddresses(BlockRange &blocks, uint8_t precision) {
+        HyperLogLog result{precision};
+        if (blocks.size() == 0) {
+            return result;
+        }
+        result.merge(blocks.mapReduce<HyperLogLog>([precision](BlockRange segment) {
+            HyperLogLog sketch{precision};
+            RANGES_FOR(auto block, segment) {
+                RANGES_FOR(auto tx, block) {
+                    auto outputs = tx.outputs();
+                    for (uint16_t i = 0; i < outputs.size(); i++) {
+                        sketch.add(sketchAddressKey(outputs.inouts[i].getAddressNum(), outputs.inouts[i].getType()));
+                    }
+                }
+            }
+            return sketch;
+        }, [](HyperLogLog &a, HyperLogLog &b) -> HyperLogLog & {
+            a.merge(b);
+            return a;
+        }));
+        return result;
+    }
+
+    namespace {
+        QuantileSketch &mergeQuantiles(QuantileSketch &a, QuantileSketch &b) {
+            a.merge(b);
+            return a;
+        }
+    }
+
+    QuantileSketch approximateFeeRates(BlockRange &blocks, uint16_t k) {
+        QuantileSketch result{k};
+        if (blocks.size() == 0) {
+            return result;
+        }
+        result.merge(blocks.mapReduce<QuantileSketch>([k](BlockRange segment) {
+            QuantileSketch sketch{k};
+            RANGES_FOR(auto block, segment) {
+                RANGES_FOR(auto tx, block) {
+                    if (!tx.isCoinbase()) {
+                        sketch.add(static_cast<double>(tx.fee()) / static_cast<double>(tx.virtualSize()));
+                    }
+                }
+            }
+            return sketch;
+        }, mergeQuantiles));
+        return result;
+    }
+
+    QuantileSketch approximateOutputValues(BlockRange &blocks, uint16_t k) {
+        QuantileSketch result{k};
+        if (blocks.size() == 0) {
+            return result;
+        }
+        result.merge(blocks.mapReduce<QuantileSketch>([k](BlockRange segment) {
+            QuantileSketch sketch{k};
+            RANGES_FOR(auto block, segment) {
+                RANGES_FOR(auto tx, block) {
+                    auto outputs = tx.outputs();
+                    for (uint16_t i = 0; i < outputs.size(); i++) {
+                        sketch.add(static_cast<double>(outputs.inouts[i].getValue()));
+                    }
+                }
+            }
+            return sketch;
+        }, mergeQuantiles));
+        return result;
+    }
+} // namespace blocksci
@@ -0,0 +1,176 @@
+//
+//  spend_graph.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include <blocksci/chain/spend_graph.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+
+#include <range/v3/utility/optional.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace blocksci {
+
+    namespace {
+        /** Frontier entries handled by one task of a level */
+        constexpr size_t minTaskSize = 512;
+
+        /** Call f with the tx number at the other end of every followed edge of the tx */
+        template <typename F>
+        void forEachEdge(const ChainAccess &chain, uint32_t txNum, SpendDirection direction, const SpendEdgeFilter &filter, F f) {
+            auto rawTx = chain.getTx(txNum);
+            if (direction == SpendDirection::Ancestors) {
+                for (auto input = rawTx->beginInputs(); input != rawTx->endInputs(); ++input) {
+                    if (filter.follows(*input)) {
+                        f(input->getLinkedTxNum());
+                    }
+                }
+            } else {
+                auto txCount = static_cast<uint32_t>(chain.txCount());
+                for (auto output = rawTx->beginOutputs(); output != rawTx->endOutputs(); ++output) {
+                    auto spendingTxNum = output->getLinkedTxNum();
+                    // Same rule as Output::isSpent, links beyond the loaded txes don't count
+                    if (spendingTxNum > 0 && spendingTxNum < txCount && filter.follows(*output)) {
+                        f(spendingTxNum);
+                    }
+                }
+            }
+        }
+
+        uint32_t taskCount(size_t itemCount, WorkPool &pool) {
+            auto maxTasks = static_cast<size_t>(pool.threadCount()) * pool.getConfig().chunksPerThread;
+            return static_cast<uint32_t>(std::max<size_t>(1, std::min(maxTasks, itemCount / minTaskSize)));
+        }
+
+        /** [begin, end) of the items of one task */
+        std::pair<size_t, size_t> taskSlice(size_t itemCount, uint32_t taskNum, uint32_t tasks) {
+            return {itemCount * taskNum / tasks, itemCount * (taskNum + 1) / tasks};
+        }
+
+        /** (tx number, depth) of every reached transaction, level by level */
+        std::vector<std::pair<uint32_t, uint32_t>> traverse(const std::vector<uint32_t> &sources, uint32_t depth, SpendDirection direction,
+                                                            const SpendEdgeFilter &filter, DataAccess &access) {
+            auto &chain = access.getChain();
+            auto &pool = access.getWorkPool();
+            auto txCount = static_cast<uint32_t>(chain.txCount());
+            auto visited = std::make_unique<std::atomic<uint64_t>[]>((static_cast<size_t>(txCount) + 63) / 64);
+            auto visit = [&](uint32_t txNum) {
+                auto bit = uint64_t{1} << (txNum & 63);
+                return (visited[txNum >> 6].fetch_or(bit, std::memory_order_relaxed) & bit) == 0;
+            };
+
+            std::vector<std::pair<uint32_t, uint32_t>> reached;
+            std::vector<uint32_t> frontier;
+            for (auto txNum : sources) {
+                if (txNum >= txCount) {
+                    throw std::invalid_argument("Transaction " + std::to_string(txNum) + " is not in the loaded chain");
+                }
+                if (visit(txNum)) {
+                    frontier.push_back(txNum);
+                    reached.emplace_back(txNum, 0);
+                }
+            }
+
+            for (uint32_t level = 1; level <= depth && !frontier.empty(); level++) {
+                auto tasks = taskCount(frontier.size(), pool);
+                std::vector<std::vector<uint32_t>> nextParts(tasks);
+                pool.run(tasks, [&](uint32_t taskNum) {
+                    auto slice = taskSlice(frontier.size(), taskNum, tasks);
+                    auto &next = nextParts[taskNum];
+                    for (auto i = slice.first; i < slice.second; i++) {
+                        forEachEdge(chain, frontier[i], direction, filter, [&](uint32_t target) {
+                            if (visit(target)) {
+                                next.push_back(target);
+                            }
+                        });
+                    }
+                });
+                frontier.clear();
+                for (auto &part : nextParts) {
+                    frontier.insert(frontier.end(), part.begin(), part.end());
+                }
+                for (auto txNum : frontier) {
+                    reached.emplace_back(txNum, level);
+                }
+            }
+            return reached;
+        }
+    }
+
+    TxSet spendNeighborhood(const std::vector<uint32_t> &sources, uint32_t depth, SpendDirection direction,
+                            const SpendEdgeFilter &filter, DataAccess &access) {
+        auto reached = traverse(sources, depth, direction, filter, access);
+        std::vector<uint32_t> txNums;
+        txNums.reserve(reached.size());
+        for (auto &entry : reached) {
+            txNums.push_back(entry.first);
+        }
+        std::sort(txNums.begin(), txNums.end());
+        return {RoaringSet::fromSorted(txNums.data(), txNums.data() + txNums.size()), access};
+    }
+
+    SpendSubgraph spendSubgraph(const std::vector<uint32_t> &sources, uint32_t depth, SpendDirection direction,
+                                const SpendEdgeFilter &filter, DataAccess &access) {
+        auto reached = traverse(sources, depth, direction, filter, access);
+        std::sort(reached.begin(), reached.end());
+
+        SpendSubgraph graph;
+        graph.txNums.reserve(reached.size());
+        graph.depths.reserve(reached.size());
+        for (auto &entry : reached) {
+            graph.txNums.push_back(entry.first);
+            graph.depths.push_back(entry.second);
+        }
+
+        auto &chain = access.getChain();
+        auto &pool = access.getWorkPool();
+        auto nodeCount = graph.txNums.size();
+        auto nodeIndex = [&](uint32_t txNum) -> ranges::optional<uint32_t> {
+            auto it = std::lower_bound(graph.txNums.begin(), graph.txNums.end(), txNum);
+            if (it != graph.txNums.end() && *it == txNum) {
+                return static_cast<uint32_t>(it - graph.txNums.begin());
+            }
+            return ranges::nullopt;
+        };
+
+        // Count the edges of every node, then fill them in at the offsets given by the prefix sum of the counts
+        std::vector<uint64_t> edgeCounts(nodeCount, 0);
+        auto tasks = taskCount(nodeCount, pool);
+        pool.run(tasks, [&](uint32_t taskNum) {
+            auto slice = taskSlice(nodeCount, taskNum, tasks);
+            for (auto i = slice.first; i < slice.second; i++) {
+                forEachEdge(chain, graph.txNums[i], direction, filter, [&](uint32_t target) {
+                    edgeCounts[i] += nodeIndex(target) ? 1 : 0;
+                });
+            }
+        });
+        graph.edgeOffsets.resize(nodeCount + 1);
+        graph.edgeOffsets[0] = 0;
+        for (size_t i = 0; i < nodeCount; i++) {
+            graph.edgeOffsets[i + 1] = graph.edgeOffsets[i] + edgeCounts[i];
+        }
+        graph.edgeTargets.resize(static_cast<size_t>(graph.edgeOffsets.back()));
+        pool.run(tasks, [&](uint32_t taskNum) {
+            auto slice = taskSlice(nodeCount, taskNum, tasks);
+            for (auto i = slice.first; i < slice.second; i++) {
+                auto position = graph.edgeOffsets[i];
+                forEachEdge(chain, graph.txNums[i], direction, filter, [&](uint32_t target) {
+                    if (auto index = nodeIndex(target)) {
+                        graph.edgeTargets[static_cast<size_t>(position++)] = *index;
+                    }
+                });
+            }
+        });
+        return graph;
+    }
+} // namespace blocksci
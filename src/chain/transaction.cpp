@@ -13,6 +13,7 @@
 #include <blocksci/chain/block.hpp>
 #include <blocksci/chain/output.hpp>
 #include <blocksci/chain/input.hpp>
+#include <blocksci/core/hex_codec.hpp>
 #include <blocksci/scripts/nulldata_script.hpp>
 
 #include <internal/bitcoin_uint256_hex.hpp>
@@ -49,6 +50,48 @@ namespace blocksci {
 
     Transaction::Transaction(const std::string &hash, DataAccess &access_) : Transaction(uint256S(hash), access_) {}
     
+    std::vector<Transaction> getTransactions(const std::vector<uint32_t> &txNums, DataAccess &access) {
+        auto &chain = access.getChain();
+        auto txData = chain.getTxDataBatch(txNums);
+        auto heights = chain.getBlockHeights(txNums);
+        auto maxTxCount = static_cast<uint32_t>(chain.txCount());
+        std::vector<Transaction> txes;
+        txes.reserve(txNums.size());
+        for (size_t i = 0; i < txNums.size(); i++) {
+            txes.emplace_back(txData[i], txNums[i], heights[i], maxTxCount, access);
+        }
+        return txes;
+    }
+    
+    std::vector<ranges::optional<uint32_t>> getTxIndexes(const std::vector<uint256> &txHashes, DataAccess &access) {
+        return access.getHashIndex().getTxIndexes(txHashes);
+    }
+    
+    std::vector<ranges::optional<uint32_t>> getTxIndexes(const std::vector<std::string> &txHashes, DataAccess &access) {
+        return getTxIndexes(parseHashes(txHashes), access);
+    }
+    
+    void Transaction::resolveColumn(TxDataColumn column) const {
+        access->getChain().resolveTxData(data, txNum, column);
+    }
+    
+    int64_t Transaction::fee() const {
+        if (auto storedFee = access->getChain().getTxFee(txNum)) {
+            return *storedFee;
+        }
+        if (isCoinbase()) {
+            return 0;
+        }
+        int64_t total = 0;
+        for (auto input = data.rawTx->beginInputs(); input != data.rawTx->endInputs(); ++input) {
+            total += input->getValue();
+        }
+        for (auto output = data.rawTx->beginOutputs(); output != data.rawTx->endOutputs(); ++output) {
+            total -= output->getValue();
+        }
+        return total;
+    }
+    
     std::string Transaction::toString() const {
         std::stringstream ss;
         ss << "Tx(len(txins)=" << inputCount() <<", len(txouts)=" << outputCount() <<", size_bytes=" << sizeBytes() << ", block_height=" << getBlockHeight() <<", tx_index=" << txNum << ")";
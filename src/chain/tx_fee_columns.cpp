@@ -0,0 +1,31 @@
+//
+//  tx_fee_columns.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include <blocksci/chain/tx_fee_columns.hpp>
+#include <blocksci/chain/block_range.hpp>
+#include <blocksci/chain/transaction_range.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+
+namespace blocksci {
+    bool hasTxFeeColumns(DataAccess &access) {
+        auto &chain = access.getChain();
+        return chain.txFeeColumnsSize() >= chain.txCount();
+    }
+
+    TxFeeColumns txFeeColumns(const TransactionRange &txes) {
+        return txes.getAccess().getChain().getTxFeeColumns(txes.firstTxIndex(), std::max(txes.firstTxIndex(), txes.endTxIndex()));
+    }
+
+    TxFeeColumns txFeeColumns(BlockRange &blocks) {
+        if (blocks.size() == 0) {
+            return {};
+        }
+        return blocks.getAccess().getChain().getTxFeeColumns(blocks.firstTxIndex(), blocks.endTxIndex());
+    }
+} // namespace blocksci
@@ -0,0 +1,142 @@
+//
+//  tx_package.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include <blocksci/chain/tx_package.hpp>
+#include <blocksci/chain/block.hpp>
+#include <blocksci/chain/transaction.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace blocksci {
+    namespace {
+        /** Walks the edges from position to its transitive neighbours, edges sorted by from */
+        template <typename From, typename To>
+        std::vector<uint32_t> reachable(const InBlockEdge *edges, uint64_t count, uint32_t position, uint32_t txCount, From from, To to) {
+            auto end = edges + count;
+            std::vector<bool> seen(txCount, false);
+            std::vector<uint32_t> stack{position};
+            std::vector<uint32_t> found;
+            while (!stack.empty()) {
+                auto current = stack.back();
+                stack.pop_back();
+                auto first = std::lower_bound(edges, end, current, [&](const InBlockEdge &edge, uint32_t value) {
+                    return from(edge) < value;
+                });
+                for (auto it = first; it != end && from(*it) == current; ++it) {
+                    auto next = to(*it);
+                    if (!seen[next]) {
+                        seen[next] = true;
+                        found.push_back(next);
+                        stack.push_back(next);
+                    }
+                }
+            }
+            std::sort(found.begin(), found.end());
+            return found;
+        }
+
+        uint32_t edgeChild(const InBlockEdge &edge) {
+            return edge.child;
+        }
+
+        uint32_t edgeParent(const InBlockEdge &edge) {
+            return edge.parent;
+        }
+    }
+
+    BlockPackages::BlockPackages(const Block &block) : access(&block.getAccess()), height(block.height()), firstTxNum(block.firstTxIndex()), endTxNum(block.endTxIndex()) {
+        blockEdges = access->getChain().getBlockPackageEdges(height);
+    }
+
+    void BlockPackages::checkPosition(uint32_t position) const {
+        if (position >= txCount()) {
+            throw std::out_of_range("Block " + std::to_string(height) + " has no tx at position " + std::to_string(position));
+        }
+    }
+
+    uint8_t BlockPackages::flags(uint32_t position) const {
+        checkPosition(position);
+        return *access->getChain().getTxPackageFlags(firstTxNum + position);
+    }
+
+    std::vector<uint32_t> BlockPackages::parents(uint32_t position) const {
+        checkPosition(position);
+        std::vector<uint32_t> found;
+        auto end = blockEdges.byChild + blockEdges.count;
+        auto it = std::lower_bound(blockEdges.byChild, end, position, [](const InBlockEdge &edge, uint32_t value) {
+            return edge.child < value;
+        });
+        for (; it != end && it->child == position; ++it) {
+            found.push_back(it->parent);
+        }
+        return found;
+    }
+
+    std::vector<uint32_t> BlockPackages::children(uint32_t position) const {
+        checkPosition(position);
+        std::vector<uint32_t> found;
+        auto end = blockEdges.byParent + blockEdges.count;
+        auto it = std::lower_bound(blockEdges.byParent, end, position, [](const InBlockEdge &edge, uint32_t value) {
+            return edge.parent < value;
+        });
+        for (; it != end && it->parent == position; ++it) {
+            found.push_back(it->child);
+        }
+        return found;
+    }
+
+    std::vector<uint32_t> BlockPackages::ancestors(uint32_t position) const {
+        checkPosition(position);
+        return reachable(blockEdges.byChild, blockEdges.count, position, txCount(), edgeChild, edgeParent);
+    }
+
+    std::vector<uint32_t> BlockPackages::descendants(uint32_t position) const {
+        checkPosition(position);
+        return reachable(blockEdges.byParent, blockEdges.count, position, txCount(), edgeParent, edgeChild);
+    }
+
+    std::vector<PackageFee> BlockPackages::ancestorPackages() const {
+        auto &chain = access->getChain();
+        std::vector<PackageFee> own(txCount());
+        if (chain.txFeeColumnsSize() >= endTxNum) {
+            auto columns = chain.getTxFeeColumns(firstTxNum, endTxNum);
+            for (uint32_t i = 1; i < txCount(); i++) {
+                own[i].fee = columns.fees[i];
+                own[i].virtualSize = columns.virtualSizes[i];
+            }
+        } else {
+            for (uint32_t i = 1; i < txCount(); i++) {
+                Transaction tx(firstTxNum + i, height, *access);
+                own[i].fee = tx.fee();
+                own[i].virtualSize = tx.virtualSize();
+            }
+        }
+
+        // Most txes have no in-block parent, so their package is just the tx itself
+        auto packages = own;
+        for (uint32_t i = 1; i < txCount(); i++) {
+            if ((*chain.getTxPackageFlags(firstTxNum + i) & TxPackageFlag::SpendsSameBlock) == 0) {
+                continue;
+            }
+            for (auto ancestor : reachable(blockEdges.byChild, blockEdges.count, i, txCount(), edgeChild, edgeParent)) {
+                packages[i].fee += own[ancestor].fee;
+                packages[i].virtualSize += own[ancestor].virtualSize;
+            }
+        }
+        return packages;
+    }
+
+    bool hasTxPackages(DataAccess &access) {
+        auto &chain = access.getChain();
+        return chain.txPackagesSize() >= chain.blockCount();
+    }
+} // namespace blocksci
@@ -0,0 +1,196 @@
+//
+//  tx_set.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include <blocksci/chain/tx_set.hpp>
+#include <blocksci/chain/block_range.hpp>
+#include <blocksci/chain/transaction_range.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace blocksci {
+
+    namespace {
+        /** Access of the result of combining two sets, which must belong to the same chain unless one is default constructed */
+        DataAccess *combinedAccess(DataAccess *a, DataAccess *b) {
+            if (a != nullptr && b != nullptr && a != b) {
+                throw std::invalid_argument("Cannot combine sets of different chains");
+            }
+            return a != nullptr ? a : b;
+        }
+
+        uint64_t firstOutputNum(const ChainAccess &chain, uint32_t txNum) {
+            return txNum < chain.txCount() ? chain.getFirstOutputNumber(txNum) : chain.outputCount();
+        }
+    }
+
+    TxSet::TxSet(const std::vector<uint32_t> &txNums_, DataAccess &access_) : access(&access_) {
+        if (std::is_sorted(txNums_.begin(), txNums_.end()) && std::adjacent_find(txNums_.begin(), txNums_.end()) == txNums_.end()) {
+            txNums = RoaringSet::fromSorted(txNums_.data(), txNums_.data() + txNums_.size());
+        } else {
+            txNums = RoaringSet{std::vector<uint64_t>(txNums_.begin(), txNums_.end())};
+        }
+    }
+
+    TxSet::TxSet(const std::vector<Transaction> &txes, DataAccess &access_) : access(&access_) {
+        std::vector<uint64_t> values;
+        values.reserve(txes.size());
+        for (auto &tx : txes) {
+            values.push_back(tx.txNum);
+        }
+        txNums = RoaringSet{std::move(values)};
+    }
+
+    TxSet::TxSet(const TransactionRange &txes) : txNums(RoaringSet::fromInterval(txes.firstTxIndex(), txes.endTxIndex())), access(&txes.getAccess()) {}
+
+    TxSet::TxSet(BlockRange &blocks) : access(&blocks.getAccess()) {
+        if (blocks.size() > 0) {
+            txNums = RoaringSet::fromInterval(blocks.firstTxIndex(), blocks.endTxIndex());
+        }
+    }
+
+    std::vector<Transaction> TxSet::toTransactions() const {
+        std::vector<uint32_t> nums;
+        nums.reserve(static_cast<size_t>(txNums.size()));
+        for (auto txNum : txNums) {
+            nums.push_back(static_cast<uint32_t>(txNum));
+        }
+        return getTransactions(nums, *access);
+    }
+
+    TxSet &TxSet::operator|=(const TxSet &other) {
+        access = combinedAccess(access, other.access);
+        txNums |= other.txNums;
+        return *this;
+    }
+
+    TxSet &TxSet::operator&=(const TxSet &other) {
+        access = combinedAccess(access, other.access);
+        txNums &= other.txNums;
+        return *this;
+    }
+
+    TxSet &TxSet::operator-=(const TxSet &other) {
+        access = combinedAccess(access, other.access);
+        txNums -= other.txNums;
+        return *this;
+    }
+
+    OutputSet::iterator::iterator(RoaringSet::const_iterator it_, RoaringSet::const_iterator end_, DataAccess *access_) : it(it_), endIt(end_), access(access_) {
+        updateTx();
+    }
+
+    void OutputSet::iterator::updateTx() {
+        if (it == endIt) {
+            return;
+        }
+        auto outputNum = *it;
+        if (outputNum >= txFirstOutput && outputNum < txEndOutput) {
+            return;
+        }
+        auto &chain = access->getChain();
+        // Outputs are visited in order, so the next tx with outputs in the set is usually close
+        if (txEndOutput != 0 && outputNum < firstOutputNum(chain, txNum + 2)) {
+            txNum++;
+        } else {
+            txNum = chain.getTxNumOfOutput(outputNum);
+        }
+        txFirstOutput = chain.getFirstOutputNumber(txNum);
+        txEndOutput = firstOutputNum(chain, txNum + 1);
+        // Skip txes without outputs that share the first output number of the next tx
+        while (outputNum >= txEndOutput) {
+            txNum++;
+            txFirstOutput = txEndOutput;
+            txEndOutput = firstOutputNum(chain, txNum + 1);
+        }
+    }
+
+    Output OutputSet::iterator::operator*() const {
+        return Output(OutputPointer{txNum, static_cast<uint16_t>(*it - txFirstOutput)}, *access);
+    }
+
+    OutputSet::iterator &OutputSet::iterator::operator++() {
+        ++it;
+        updateTx();
+        return *this;
+    }
+
+    OutputSet::OutputSet(const std::vector<Output> &outputs, DataAccess &access_) : access(&access_) {
+        auto &chain = access->getChain();
+        std::vector<uint64_t> values;
+        values.reserve(outputs.size());
+        for (auto &output : outputs) {
+            values.push_back(chain.getFirstOutputNumber(output.pointer.txNum) + output.pointer.inoutNum);
+        }
+        outputNums = RoaringSet{std::move(values)};
+    }
+
+    OutputSet::OutputSet(const TxSet &txes) : access(&txes.getAccess()) {
+        if (txes.empty()) {
+            return;
+        }
+        auto &chain = access->getChain();
+        // Runs of consecutive txes become one interval of outputs
+        auto it = txes.getTxNums().begin();
+        auto end = txes.getTxNums().end();
+        while (it != end) {
+            auto runBegin = static_cast<uint32_t>(*it);
+            auto runEnd = runBegin + 1;
+            ++it;
+            while (it != end && *it == runEnd) {
+                runEnd++;
+                ++it;
+            }
+            outputNums |= RoaringSet::fromInterval(chain.getFirstOutputNumber(runBegin), firstOutputNum(chain, runEnd));
+        }
+    }
+
+    bool OutputSet::contains(const Output &output) const {
+        auto &chain = output.getAccess().getChain();
+        return outputNums.contains(chain.getFirstOutputNumber(output.pointer.txNum) + output.pointer.inoutNum);
+    }
+
+    void OutputSet::add(const Output &output) {
+        access = combinedAccess(access, &output.getAccess());
+        auto &chain = access->getChain();
+        outputNums.add(chain.getFirstOutputNumber(output.pointer.txNum) + output.pointer.inoutNum);
+    }
+
+    TxSet OutputSet::txes() const {
+        std::vector<uint64_t> txNums;
+        uint64_t lastTx = 0;
+        for (auto it = begin(); it != end(); ++it) {
+            auto txNum = (*it).pointer.txNum;
+            if (txNums.empty() || txNum != lastTx) {
+                txNums.push_back(txNum);
+                lastTx = txNum;
+            }
+        }
+        return {RoaringSet::fromSorted(txNums.data(), txNums.data() + txNums.size()), *access};
+    }
+
+    OutputSet &OutputSet::operator|=(const OutputSet &other) {
+        access = combinedAccess(access, other.access);
+        outputNums |= other.outputNums;
+        return *this;
+    }
+
+    OutputSet &OutputSet::operator&=(const OutputSet &other) {
+        access = combinedAccess(access, other.access);
+        outputNums &= other.outputNums;
+        return *this;
+    }
+
+    OutputSet &OutputSet::operator-=(const OutputSet &other) {
+        access = combinedAccess(access, other.access);
+        outputNums -= other.outputNums;
+        return *this;
+    }
+} // namespace blocksci
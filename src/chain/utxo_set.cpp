@@ -0,0 +1,145 @@
+//
+//  utxo_set.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include <blocksci/chain/utxo_set.hpp>
+#include <blocksci/chain/block_range.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace blocksci {
+
+    namespace {
+        /** Number of the first tx of the block at height, the number of loaded txes for the height past the chain */
+        uint32_t firstTxOfHeight(BlockRange &chain, BlockHeight height) {
+            if (height == chain.size()) {
+                return chain.size() > 0 ? chain.endTxIndex() : 0;
+            }
+            return chain.getAccess().getChain().getBlock(height)->firstTxIndex;
+        }
+
+        /** Blockchain-wide number of the first output of the tx, the number of loaded outputs for the tx past the chain */
+        uint64_t firstOutputOfTx(const ChainAccess &chain, uint32_t txNum) {
+            return txNum < chain.txCount() ? chain.getFirstOutputNumber(txNum) : chain.outputCount();
+        }
+
+        void checkHeight(BlockRange &chain, BlockHeight height) {
+            if (chain.sl.start != 0) {
+                throw std::invalid_argument("UTXO sets have to be computed over a block range starting at the genesis block");
+            }
+            if (height < 0 || height > chain.size()) {
+                throw std::out_of_range("Height " + std::to_string(height) + " is outside of the loaded chain");
+            }
+        }
+
+        /** Union of the sets of the chunks, releasing each one once it has been merged */
+        RoaringSet mergeSets(std::vector<RoaringSet> &sets) {
+            RoaringSet result;
+            for (auto &set : sets) {
+                result |= set;
+                set = RoaringSet{};
+            }
+            return result;
+        }
+
+        /** Outputs of the blocks that aren't spent by a tx before spentFromTxNum */
+        RoaringSet outputsUnspentBefore(BlockRange &blocks, uint32_t spentFromTxNum) {
+            if (blocks.size() == 0) {
+                return {};
+            }
+            auto &chain = blocks.getAccess().getChain();
+            bool useColumn = chain.outputColumnsSize() >= firstOutputOfTx(chain, blocks.endTxIndex());
+            auto chunks = blocks.segment(blocks.chunkCount(), SegmentWeight::InoutCount);
+            std::vector<RoaringSet> sets(chunks.size());
+            blocks.runChunks(static_cast<uint32_t>(chunks.size()), [&](uint32_t chunkNum) {
+                auto &chunk = chunks[chunkNum];
+                chunk.checkReorg();
+                std::vector<uint64_t> outputNums;
+                if (useColumn) {
+                    auto beginOutput = firstOutputOfTx(chain, chunk.firstTxIndex());
+                    auto columns = chain.getOutputColumns(beginOutput, firstOutputOfTx(chain, chunk.endTxIndex()));
+                    for (uint64_t i = 0; i < columns.count; i++) {
+                        auto spentTxNum = columns.spentTxNums[i];
+                        if (spentTxNum == 0 || spentTxNum >= spentFromTxNum) {
+                            outputNums.push_back(beginOutput + i);
+                        }
+                    }
+                } else {
+                    for (auto txNum = chunk.firstTxIndex(); txNum < chunk.endTxIndex(); txNum++) {
+                        auto rawTx = chain.getTx(txNum);
+                        auto firstOutput = chain.getFirstOutputNumber(txNum);
+                        for (uint16_t i = 0; i < rawTx->outputCount; i++) {
+                            auto spentTxNum = rawTx->getOutput(i).getLinkedTxNum();
+                            if (spentTxNum == 0 || spentTxNum >= spentFromTxNum) {
+                                outputNums.push_back(firstOutput + i);
+                            }
+                        }
+                    }
+                }
+                sets[chunkNum] = RoaringSet::fromSorted(outputNums.data(), outputNums.data() + outputNums.size());
+            });
+            return mergeSets(sets);
+        }
+
+        /** Outputs of txes before createdBeforeTxNum that are spent by the inputs of the blocks */
+        RoaringSet outputsSpentBy(BlockRange &blocks, uint32_t createdBeforeTxNum) {
+            if (blocks.size() == 0) {
+                return {};
+            }
+            auto &chain = blocks.getAccess().getChain();
+            auto chunks = blocks.segment(blocks.chunkCount(), SegmentWeight::InoutCount);
+            std::vector<RoaringSet> sets(chunks.size());
+            blocks.runChunks(static_cast<uint32_t>(chunks.size()), [&](uint32_t chunkNum) {
+                auto &chunk = chunks[chunkNum];
+                chunk.checkReorg();
+                std::vector<uint64_t> outputNums;
+                for (auto txNum = chunk.firstTxIndex(); txNum < chunk.endTxIndex(); txNum++) {
+                    auto rawTx = chain.getTx(txNum);
+                    if (rawTx->inputCount == 0) {
+                        continue;
+                    }
+                    auto spentOutputNums = chain.getSpentOutputNumbers(txNum);
+                    for (uint16_t i = 0; i < rawTx->inputCount; i++) {
+                        auto spentTxNum = rawTx->getInput(i).getLinkedTxNum();
+                        if (spentTxNum < createdBeforeTxNum) {
+                            outputNums.push_back(chain.getFirstOutputNumber(spentTxNum) + spentOutputNums[i]);
+                        }
+                    }
+                }
+                // Inputs spend older outputs in no particular order, the set sorts them
+                sets[chunkNum] = RoaringSet{std::move(outputNums)};
+            });
+            return mergeSets(sets);
+        }
+    }
+
+    OutputSet utxoSetAt(BlockRange &chain, BlockHeight height) {
+        checkHeight(chain, height);
+        auto blocks = chain[{0, height}];
+        return {outputsUnspentBefore(blocks, firstTxOfHeight(chain, height)), chain.getAccess()};
+    }
+
+    UTXOSetDelta utxoSetDelta(BlockRange &chain, BlockHeight startHeight, BlockHeight endHeight) {
+        checkHeight(chain, startHeight);
+        checkHeight(chain, endHeight);
+        if (startHeight > endHeight) {
+            throw std::invalid_argument("The start height of a UTXO set delta must not be after its end height");
+        }
+        auto blocks = chain[{startHeight, endHeight}];
+        UTXOSetDelta delta;
+        delta.startHeight = startHeight;
+        delta.endHeight = endHeight;
+        delta.created = {outputsUnspentBefore(blocks, firstTxOfHeight(chain, endHeight)), chain.getAccess()};
+        delta.spent = {outputsSpentBy(blocks, firstTxOfHeight(chain, startHeight)), chain.getAccess()};
+        return delta;
+    }
+} // namespace blocksci
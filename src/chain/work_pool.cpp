@@ -0,0 +1,489 @@
+//
+//  work_pool.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include <blocksci/chain/work_pool.hpp>
+
+#include <internal/numa.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace blocksci {
+
+    namespace {
+        /** Set while the current thread runs tasks of a pool, nested batches run inline */
+        thread_local bool insidePoolTask = false;
+
+        /** I/O budget of the batch whose tasks the current thread runs */
+        thread_local IoTokenBucket *taskIoBucket = nullptr;
+
+        /** Innermost WorkScope of the current thread */
+        thread_local const WorkScope *currentScope = nullptr;
+
+        constexpr size_t priorityCount = 3;
+
+        /** Number of live WorkScopes of every priority in the process */
+        std::atomic<unsigned> activeScopes[priorityCount] = {};
+
+        /** How often pool threads that yield to a WorkScope check whether it ended */
+        constexpr std::chrono::milliseconds yieldPollInterval{2};
+
+        /** Whether a WorkScope of a higher priority than the given one is alive */
+        bool outranked(WorkPriority priority) {
+            for (size_t i = 0; i < static_cast<size_t>(priority); i++) {
+                if (activeScopes[i].load(std::memory_order_relaxed) > 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /** Remaining task indexes [begin, end) of one thread, packed into one word so that they change atomically */
+        struct alignas(64) TaskRange {
+            std::atomic<uint64_t> packed{0};
+
+            static uint64_t pack(uint32_t begin, uint32_t end) {
+                return (static_cast<uint64_t>(begin) << 32) | end;
+            }
+
+            static uint32_t begin(uint64_t value) {
+                return static_cast<uint32_t>(value >> 32);
+            }
+
+            static uint32_t end(uint64_t value) {
+                return static_cast<uint32_t>(value);
+            }
+        };
+
+        void pinToCpus(std::thread &thread, const std::vector<unsigned> &cpuList) {
+#ifdef __linux__
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            for (auto cpu : cpuList) {
+                if (cpu < CPU_SETSIZE) {
+                    CPU_SET(cpu, &cpus);
+                }
+            }
+            pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus);
+#else
+            (void)thread;
+            (void)cpuList;
+#endif
+        }
+    }
+
+    struct WorkPool::Impl {
+        /** One call of run() */
+        struct Batch {
+            const std::function<void(uint32_t)> *task = nullptr;
+            const CancellationToken *token = nullptr;
+            WorkPriority priority = WorkPriority::Normal;
+
+            /** Threads allowed to work on the batch at once, including the caller */
+            unsigned maxWorkers = 1;
+
+            IoTokenBucket *ioBucket = nullptr;
+
+            /** Remaining tasks of every slot */
+            std::unique_ptr<TaskRange[]> ranges;
+
+            /** Pool threads working on the batch, guarded by the pool mutex */
+            unsigned helpers = 0;
+
+            std::atomic<bool> failed{false};
+            std::exception_ptr error;
+            std::mutex errorMutex;
+        };
+
+        ParallelConfig config;
+        unsigned participantCount;
+        std::vector<std::thread> threads;
+
+        /** Index into numaNodes() of every slot, all 0 unless the pool is NUMA aware */
+        std::vector<unsigned> slotNodes;
+        unsigned nodeCount = 1;
+
+        /** Slots every slot steals from, in order. Slots of the same node come first */
+        std::vector<std::vector<unsigned>> victims;
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable finished;
+        bool stopping = false;
+
+        /** Running batches by priority, oldest first within a priority */
+        std::vector<Batch *> batches;
+
+        /** Changes whenever batches does, so the helpers only look for a better batch after a change */
+        std::atomic<uint64_t> batchesVersion{0};
+
+        explicit Impl(const ParallelConfig &config_) : config(config_) {
+            auto hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+            participantCount = config.maxThreads == 0 ? hardwareThreads : config.maxThreads;
+            assignNodes();
+            for (unsigned i = 1; i < participantCount; i++) {
+                threads.emplace_back([this, i]() { helperLoop(i); });
+                if (nodeCount > 1) {
+                    // Slots of a node are consecutive, so the position within the node picks a distinct CPU of it
+                    auto &cpus = numaNodes()[slotNodes[i]].cpus;
+                    if (config.pinThreads) {
+                        auto firstSlot = static_cast<unsigned>(std::find(slotNodes.begin(), slotNodes.end(), slotNodes[i]) - slotNodes.begin());
+                        pinToCpus(threads.back(), {cpus[(i - firstSlot) % cpus.size()]});
+                    } else {
+                        pinToCpus(threads.back(), cpus);
+                    }
+                } else if (config.pinThreads) {
+                    pinToCpus(threads.back(), {i % hardwareThreads});
+                }
+            }
+        }
+
+        /** Give every node a consecutive group of slots in proportion to its CPUs, slot 0 (the caller) goes to the first */
+        void assignNodes() {
+            slotNodes.assign(participantCount, 0);
+            const auto &nodes = numaNodes();
+            if (config.numaAware && nodes.size() > 1 && participantCount > 1) {
+                size_t totalCpus = 0;
+                for (auto &node : nodes) {
+                    totalCpus += node.cpus.size();
+                }
+                size_t cpusBefore = 0;
+                for (unsigned node = 0; node < nodes.size(); node++) {
+                    auto firstSlot = participantCount * cpusBefore / totalCpus;
+                    cpusBefore += nodes[node].cpus.size();
+                    auto endSlot = participantCount * cpusBefore / totalCpus;
+                    for (auto slot = firstSlot; slot < endSlot; slot++) {
+                        slotNodes[slot] = node;
+                    }
+                }
+                nodeCount = slotNodes.back() + 1;
+            }
+
+            victims.resize(participantCount);
+            for (unsigned slot = 0; slot < participantCount; slot++) {
+                for (unsigned offset = 1; offset < participantCount; offset++) {
+                    auto other = (slot + offset) % participantCount;
+                    if (slotNodes[other] == slotNodes[slot]) {
+                        victims[slot].push_back(other);
+                    }
+                }
+                for (unsigned offset = 1; offset < participantCount; offset++) {
+                    auto other = (slot + offset) % participantCount;
+                    if (slotNodes[other] != slotNodes[slot]) {
+                        victims[slot].push_back(other);
+                    }
+                }
+            }
+        }
+
+        ~Impl() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (auto &thread : threads) {
+                thread.join();
+            }
+        }
+
+        bool hasTasks(const Batch &batch) const {
+            for (unsigned slot = 0; slot < participantCount; slot++) {
+                auto value = batch.ranges[slot].packed.load(std::memory_order_acquire);
+                if (TaskRange::begin(value) < TaskRange::end(value)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /** Whether another pool thread may start working on the batch, needs the mutex */
+        bool canJoin(const Batch &batch) const {
+            return batch.helpers + 1 < batch.maxWorkers && hasTasks(batch);
+        }
+
+        /** Batch a free pool thread should work on, null if there is none or all of them yield to a WorkScope of a
+         * higher priority. Sets waiting if a batch only waits for such a scope to end. Needs the mutex */
+        Batch *select(bool &waiting) const {
+            waiting = false;
+            for (auto batch : batches) {
+                if (canJoin(*batch)) {
+                    if (outranked(batch->priority)) {
+                        waiting = true;
+                        return nullptr;
+                    }
+                    return batch;
+                }
+            }
+            return nullptr;
+        }
+
+        /** Whether a pool thread working on the batch should leave it for work of a higher priority, needs the mutex */
+        bool shouldLeave(const Batch &batch) const {
+            for (auto other : batches) {
+                if (other->priority >= batch.priority) {
+                    break;
+                }
+                if (canJoin(*other)) {
+                    return true;
+                }
+            }
+            return outranked(batch.priority);
+        }
+
+        bool takeOwn(Batch &batch, unsigned slot, uint32_t &taskNum) {
+            auto &range = batch.ranges[slot].packed;
+            auto value = range.load(std::memory_order_acquire);
+            while (TaskRange::begin(value) < TaskRange::end(value)) {
+                if (range.compare_exchange_weak(value, TaskRange::pack(TaskRange::begin(value) + 1, TaskRange::end(value)), std::memory_order_acq_rel)) {
+                    taskNum = TaskRange::begin(value);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /** Move the back half of another thread's range into the own range, which must be empty */
+        bool steal(Batch &batch, unsigned slot, uint32_t &taskNum) {
+            for (auto victimSlot : victims[slot]) {
+                auto &victim = batch.ranges[victimSlot].packed;
+                auto value = victim.load(std::memory_order_acquire);
+                while (TaskRange::begin(value) < TaskRange::end(value)) {
+                    auto begin = TaskRange::begin(value);
+                    auto end = TaskRange::end(value);
+                    auto mid = begin + (end - begin) / 2;
+                    if (victim.compare_exchange_weak(value, TaskRange::pack(begin, mid), std::memory_order_acq_rel)) {
+                        batch.ranges[slot].packed.store(TaskRange::pack(mid + 1, end), std::memory_order_release);
+                        taskNum = mid;
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        /** Run tasks of the batch until it has none left or, for pool threads, until there is more important work */
+        void work(Batch &batch, unsigned slot) {
+            auto wasInside = insidePoolTask;
+            auto previousBucket = taskIoBucket;
+            insidePoolTask = true;
+            taskIoBucket = batch.ioBucket;
+            auto isHelper = slot != 0;
+            auto seenVersion = batchesVersion.load(std::memory_order_acquire);
+            uint32_t taskNum = 0;
+            while (takeOwn(batch, slot, taskNum) || steal(batch, slot, taskNum)) {
+                if (!batch.failed.load(std::memory_order_relaxed) && (batch.token == nullptr || !batch.token->isCancelled())) {
+                    try {
+                        (*batch.task)(taskNum);
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(batch.errorMutex);
+                        if (!batch.error) {
+                            batch.error = std::current_exception();
+                        }
+                        batch.failed.store(true, std::memory_order_relaxed);
+                    }
+                }
+                if (isHelper) {
+                    auto version = batchesVersion.load(std::memory_order_acquire);
+                    if (version != seenVersion || outranked(batch.priority)) {
+                        seenVersion = version;
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if (shouldLeave(batch)) {
+                            break;
+                        }
+                    }
+                }
+            }
+            insidePoolTask = wasInside;
+            taskIoBucket = previousBucket;
+        }
+
+        void helperLoop(unsigned slot) {
+            while (true) {
+                Batch *batch = nullptr;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    while (!stopping) {
+                        bool waiting;
+                        batch = select(waiting);
+                        if (batch != nullptr) {
+                            break;
+                        }
+                        if (waiting) {
+                            // WorkScopes don't know the pools, so threads yielding to one check back regularly
+                            wake.wait_for(lock, yieldPollInterval);
+                        } else {
+                            wake.wait(lock);
+                        }
+                    }
+                    if (stopping) {
+                        return;
+                    }
+                    batch->helpers++;
+                }
+                work(*batch, slot);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    batch->helpers--;
+                }
+                finished.notify_all();
+            }
+        }
+    };
+
+    WorkPool::WorkPool(const ParallelConfig &config) : impl(std::make_unique<Impl>(config)) {}
+
+    WorkPool::~WorkPool() = default;
+
+    const ParallelConfig &WorkPool::getConfig() const {
+        return impl->config;
+    }
+
+    unsigned WorkPool::threadCount() const {
+        return impl->participantCount;
+    }
+
+    unsigned WorkPool::numaNodeCount() const {
+        return impl->nodeCount;
+    }
+
+    unsigned WorkPool::batchThreadCount() const {
+        auto maxThreads = WorkScope::currentOptions().maxThreads;
+        return maxThreads == 0 ? impl->participantCount : std::min(maxThreads, impl->participantCount);
+    }
+
+    void WorkPool::run(uint32_t taskCount, const std::function<void(uint32_t)> &task, const CancellationToken *token) {
+        if (taskCount == 0) {
+            return;
+        }
+        auto maxWorkers = batchThreadCount();
+        if (insidePoolTask || maxWorkers == 1 || taskCount == 1) {
+            auto previousBucket = taskIoBucket;
+            if (!insidePoolTask) {
+                taskIoBucket = WorkScope::currentIoBucket();
+            }
+            try {
+                for (uint32_t i = 0; i < taskCount; i++) {
+                    if (token != nullptr && token->isCancelled()) {
+                        throw OperationCancelled();
+                    }
+                    task(i);
+                }
+            } catch (...) {
+                taskIoBucket = previousBucket;
+                throw;
+            }
+            taskIoBucket = previousBucket;
+            return;
+        }
+
+        Impl::Batch batch;
+        batch.task = &task;
+        batch.token = token;
+        batch.priority = WorkScope::currentOptions().priority;
+        batch.maxWorkers = maxWorkers;
+        batch.ioBucket = WorkScope::currentIoBucket();
+        auto participants = impl->participantCount;
+        batch.ranges = std::make_unique<TaskRange[]>(participants);
+        for (unsigned i = 0; i < participants; i++) {
+            auto begin = static_cast<uint32_t>(static_cast<uint64_t>(taskCount) * i / participants);
+            auto end = static_cast<uint32_t>(static_cast<uint64_t>(taskCount) * (i + 1) / participants);
+            batch.ranges[i].packed.store(TaskRange::pack(begin, end), std::memory_order_relaxed);
+        }
+        {
+            std::lock_guard<std::mutex> lock(impl->mutex);
+            auto position = std::find_if(impl->batches.begin(), impl->batches.end(), [&](const Impl::Batch *other) {
+                return other->priority > batch.priority;
+            });
+            impl->batches.insert(position, &batch);
+            impl->batchesVersion.fetch_add(1, std::memory_order_release);
+        }
+        impl->wake.notify_all();
+        impl->work(batch, 0);
+        {
+            std::unique_lock<std::mutex> lock(impl->mutex);
+            impl->finished.wait(lock, [&]() { return batch.helpers == 0; });
+            impl->batches.erase(std::find(impl->batches.begin(), impl->batches.end(), &batch));
+            impl->batchesVersion.fetch_add(1, std::memory_order_release);
+        }
+        // Threads that left other batches for this one go back to them
+        impl->wake.notify_all();
+
+        if (batch.error) {
+            std::rethrow_exception(batch.error);
+        }
+        if (token != nullptr && token->isCancelled()) {
+            throw OperationCancelled();
+        }
+    }
+
+    void WorkPool::chargeIo(uint64_t bytes) {
+        if (taskIoBucket != nullptr && bytes > 0) {
+            taskIoBucket->acquire(bytes);
+        }
+    }
+
+    bool WorkPool::limitsIo() {
+        return taskIoBucket != nullptr;
+    }
+
+    IoTokenBucket::IoTokenBucket(uint64_t bytesPerSecond_) : bytesPerSecond(std::max(bytesPerSecond_, uint64_t{1})), tokens(static_cast<double>(bytesPerSecond)), lastRefill(std::chrono::steady_clock::now()) {}
+
+    void IoTokenBucket::acquire(uint64_t bytes) {
+        std::chrono::duration<double> wait{0};
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto now = std::chrono::steady_clock::now();
+            auto rate = static_cast<double>(bytesPerSecond);
+            tokens = std::min(rate, tokens + std::chrono::duration<double>(now - lastRefill).count() * rate);
+            lastRefill = now;
+            tokens -= static_cast<double>(bytes);
+            if (tokens < 0) {
+                wait = std::chrono::duration<double>(-tokens / rate);
+            }
+        }
+        if (wait.count() > 0) {
+            std::this_thread::sleep_for(wait);
+        }
+    }
+
+    WorkScope::WorkScope(const WorkOptions &options_) : options(options_), previous(currentScope) {
+        if (options.ioBytesPerSecond > 0) {
+            if (previous != nullptr && previous->options.ioBytesPerSecond == options.ioBytesPerSecond) {
+                ioBucket = previous->ioBucket;
+            } else {
+                ownIoBucket = std::make_unique<IoTokenBucket>(options.ioBytesPerSecond);
+                ioBucket = ownIoBucket.get();
+            }
+        }
+        activeScopes[static_cast<size_t>(options.priority)].fetch_add(1, std::memory_order_relaxed);
+        currentScope = this;
+    }
+
+    WorkScope::~WorkScope() {
+        currentScope = previous;
+        activeScopes[static_cast<size_t>(options.priority)].fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    WorkOptions WorkScope::currentOptions() {
+        return currentScope != nullptr ? currentScope->options : WorkOptions{};
+    }
+
+    IoTokenBucket *WorkScope::currentIoBucket() {
+        return currentScope != nullptr ? currentScope->ioBucket : nullptr;
+    }
+} // namespace blocksci
@@ -10,21 +10,33 @@
 #include <blocksci/cluster/cluster_manager.hpp>
 
 #include <blocksci/address/equiv_address.hpp>
+#include <blocksci/chain/input.hpp>
 #include <blocksci/chain/output.hpp>
 #include <blocksci/chain/output_pointer.hpp>
 #include <blocksci/chain/transaction.hpp>
 #include <blocksci/chain/algorithms.hpp>
 #include <blocksci/core/dedup_address.hpp>
 
+#include <internal/address_index.hpp>
 #include <internal/address_info.hpp>
+#include <internal/chain_access.hpp>
 #include <internal/cluster_access.hpp>
 #include <internal/data_access.hpp>
 #include <internal/dedup_address_info.hpp>
 #include <internal/script_access.hpp>
+#include <internal/segment_work.hpp>
 
 #include <range/v3/iterator/operations.hpp>
+#include <range/v3/range_for.hpp>
+#include <range/v3/view/iota.hpp>
 #include <range/v3/view/join.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+
 namespace {
     using namespace blocksci;
     
@@ -48,7 +60,7 @@ namespace {
 
 namespace blocksci {
     
-    ranges::subrange<const blocksci::DedupAddress *> Cluster::getDedupAddresses() const {
+    ClusterDedupAddresses Cluster::getDedupAddresses() const {
         return clusterAccess->getClusterScripts(clusterNum);
     }
     
@@ -70,10 +82,10 @@ namespace blocksci {
     auto getAddressesNested(uint32_t clusterNum, const ClusterAccess *clusterAccess) {
         DataAccess *access_ = &clusterAccess->access;
         return clusterAccess->getClusterScripts(clusterNum) | ranges::views::transform([access_](const DedupAddress &address) {
-            auto header = access_->getScripts().getScriptHeader(address.scriptNum, address.type);
+            auto typesSeen = access_->getScripts().getTypesSeen(address.scriptNum, address.type);
             uint32_t scriptNum = address.scriptNum;
-            return addressTypesRange(address.type) | ranges::views::filter([header](AddressType::Enum type) {
-                return header->seenTopLevel(type);
+            return addressTypesRange(address.type) | ranges::views::filter([typesSeen](AddressType::Enum type) {
+                return ScriptDataBase::seenTopLevel(typesSeen, type);
             }) | ranges::views::transform([access_, scriptNum](AddressType::Enum addressType) {
                 return Address(scriptNum, addressType, *access_);
             });
@@ -83,10 +95,10 @@ namespace blocksci {
     ranges::any_view<Address> Cluster::getAddresses() const {
         DataAccess *access_ = &clusterAccess->access;
         return getDedupAddresses() | ranges::views::transform([access_](const DedupAddress &address) {
-            auto header = access_->getScripts().getScriptHeader(address.scriptNum, address.type);
+            auto typesSeen = access_->getScripts().getTypesSeen(address.scriptNum, address.type);
             uint32_t scriptNum = address.scriptNum;
-            return addressTypesRange(address.type) | ranges::views::filter([header](AddressType::Enum type) {
-                return header->seenTopLevel(type);
+            return addressTypesRange(address.type) | ranges::views::filter([typesSeen](AddressType::Enum type) {
+                return ScriptDataBase::seenTopLevel(typesSeen, type);
             }) | ranges::views::transform([access_, scriptNum](AddressType::Enum addressType) {
                 return Address(scriptNum, addressType, *access_);
             });
@@ -120,6 +132,13 @@ namespace blocksci {
     int64_t Cluster::getTypeEquivSize() const {
         return ranges::distance(getDedupAddresses());
     }
+    
+    ClusterStats Cluster::getStats() const {
+        if (!clusterAccess->hasClusterStats()) {
+            throw std::runtime_error("The clustering has no precomputed cluster statistics, update or recreate it to compute them");
+        }
+        return clusterAccess->getClusterStats(clusterNum);
+    }
 
     ranges::optional<TaggedCluster> Cluster::getTagged(const std::unordered_map<Address, std::string> &tags) const {
         bool isEmpty = [&]() {
@@ -173,7 +192,7 @@ namespace blocksci {
         }) | flatMapOptionals();
     }
     
-    ranges::transform_view<ranges::transform_view<ranges::subrange<const DedupAddress *>, PossibleAddressesGetter>, AddressRangeTagChecker>
+    ranges::transform_view<ranges::transform_view<ClusterDedupAddresses, PossibleAddressesGetter>, AddressRangeTagChecker>
     Cluster::taggedAddressesNested(const std::unordered_map<blocksci::Address, std::string> &tags) const {
         AddressRangeTagChecker tagCheck{tags};
         
@@ -185,8 +204,8 @@ namespace blocksci {
         uint32_t count = 0;
         for (auto &address : getDedupAddresses()) {
             if (address.type == dedupSearchType) {
-                auto header = clusterAccess->access.getScripts().getScriptHeader(address.scriptNum, address.type);
-                if (header->seenTopLevel(type)) {
+                auto typesSeen = clusterAccess->access.getScripts().getTypesSeen(address.scriptNum, address.type);
+                if (ScriptDataBase::seenTopLevel(typesSeen, type)) {
                     ++count;
                 }
             }
@@ -198,39 +217,240 @@ namespace blocksci {
         return getPossibleAddresses(clusterNum, clusterAccess) | ranges::views::transform([](auto && address) { return address.getOutputPointers(); }) | ranges::views::join;
     }
 
+    namespace {
+        /** Addresses scanned by one worker thread at least, smaller clusters are scanned on fewer threads */
+        constexpr size_t addressesPerWorker = 64;
+        
+        /** Every address that can have outputs of the cluster, all types equivalent to its deduplicated addresses */
+        std::vector<RawAddress> possibleRawAddresses(const ClusterDedupAddresses &dedupAddresses) {
+            std::vector<RawAddress> addresses;
+            for (auto &dedupAddress : dedupAddresses) {
+                for (auto type : addressTypesRange(dedupAddress.type)) {
+                    addresses.emplace_back(dedupAddress.scriptNum, type);
+                }
+            }
+            return addresses;
+        }
+        
+        uint32_t scanWorkerCount(size_t addressCount, uint32_t threadCount) {
+            auto wanted = std::max<size_t>(addressCount / addressesPerWorker, 1);
+            return static_cast<uint32_t>(std::min<size_t>(resolveThreadCount(threadCount), wanted));
+        }
+        
+        /** Call visit(workerNum, output) for every output sent to one of the addresses, on workerCount threads
+         *
+         * The output count of the addresses of a large cluster varies by orders of magnitude, so the workers take the
+         * next address from a shared counter instead of splitting the addresses into fixed segments. */
+        template <typename Visit>
+        void scanOutputs(const std::vector<RawAddress> &addresses, DataAccess &access, uint32_t workerCount, Visit visit) {
+            // Open the index before starting the workers
+            auto &index = access.getAddressIndex();
+            std::atomic<size_t> nextAddress{0};
+            // Workers can't let exceptions escape their thread, the first failure is rethrown once all have finished
+            std::vector<std::exception_ptr> errors(workerCount);
+            runSegments(splitSegments(0, workerCount, workerCount), [&](uint32_t workerNum, uint32_t, uint32_t) {
+                try {
+                    for (auto i = nextAddress++; i < addresses.size(); i = nextAddress++) {
+                        RANGES_FOR(const InoutPointer &pointer, index.getOutputPointers(addresses[i])) {
+                            visit(workerNum, Output(OutputPointer(pointer.txNum, pointer.inoutNum), access));
+                        }
+                    }
+                } catch (...) {
+                    errors[workerNum] = std::current_exception();
+                    nextAddress = addresses.size();
+                }
+            });
+            for (auto &error : errors) {
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+            }
+        }
+        
+        /** Deduplicates the tx numbers found by the workers of a scan
+         *
+         * Each worker appends to its own vector, which is sorted and merged into a bitmap at the end. If the cluster
+         * has so many addresses that the vectors could outgrow a bitset over all txes of the chain, the workers set
+         * bits in a shared dense bitset instead, so memory stays at txCount / 8 bytes however often a tx is found. */
+        class TxCollector {
+            std::vector<std::vector<uint32_t>> workerTxNums;
+            std::vector<std::atomic<uint64_t>> denseWords;
+            bool dense;
+            
+        public:
+            // Assuming a couple of txes per address, the vectors take more memory than the bitset past txCount / 64 addresses
+            TxCollector(uint32_t workerCount, size_t addressCount, uint32_t txCount) :
+            dense(txCount > 0 && addressCount >= txCount / 64) {
+                if (dense) {
+                    denseWords = std::vector<std::atomic<uint64_t>>((static_cast<size_t>(txCount) + 63) / 64);
+                } else {
+                    workerTxNums.resize(workerCount);
+                }
+            }
+            
+            void add(uint32_t workerNum, uint32_t txNum) {
+                if (dense) {
+                    denseWords[txNum / 64].fetch_or(uint64_t{1} << (txNum % 64), std::memory_order_relaxed);
+                } else {
+                    workerTxNums[workerNum].push_back(txNum);
+                }
+            }
+            
+            RoaringSet finish() {
+                RoaringSet txNums;
+                std::vector<uint32_t> sorted;
+                if (dense) {
+                    // Convert a chunk of the bitset at a time, the chunks cover increasing ranges of txes
+                    constexpr size_t chunkWords = size_t{1} << 14;
+                    for (size_t chunkStart = 0; chunkStart < denseWords.size(); chunkStart += chunkWords) {
+                        sorted.clear();
+                        auto chunkEnd = std::min(chunkStart + chunkWords, denseWords.size());
+                        for (size_t i = chunkStart; i < chunkEnd; i++) {
+                            auto word = denseWords[i].load(std::memory_order_relaxed);
+                            while (word != 0) {
+                                sorted.push_back(static_cast<uint32_t>(i * 64 + static_cast<size_t>(__builtin_ctzll(word))));
+                                word &= word - 1;
+                            }
+                        }
+                        txNums |= RoaringSet::fromSorted(sorted.data(), sorted.data() + sorted.size());
+                    }
+                } else {
+                    for (auto &worker : workerTxNums) {
+                        std::sort(worker.begin(), worker.end());
+                        worker.erase(std::unique(worker.begin(), worker.end()), worker.end());
+                        txNums |= RoaringSet::fromSorted(worker.data(), worker.data() + worker.size());
+                        worker = std::vector<uint32_t>{};
+                    }
+                }
+                return txNums;
+            }
+        };
+        
+        TxSet clusterTxSet(const ClusterAccess &clusterAccess, uint32_t clusterNum, bool outputTxes, bool inputTxes, uint32_t threadCount) {
+            auto &access = clusterAccess.access;
+            auto addresses = possibleRawAddresses(clusterAccess.getClusterScripts(clusterNum));
+            auto workerCount = scanWorkerCount(addresses.size(), threadCount);
+            TxCollector collector{workerCount, addresses.size(), static_cast<uint32_t>(access.getChain().txCount())};
+            scanOutputs(addresses, access, workerCount, [&](uint32_t workerNum, const Output &output) {
+                if (outputTxes) {
+                    collector.add(workerNum, output.pointer.txNum);
+                }
+                if (inputTxes) {
+                    if (auto spendingTx = output.getSpendingTxIndex()) {
+                        collector.add(workerNum, *spendingTx);
+                    }
+                }
+            });
+            return {collector.finish(), access};
+        }
+        
+        /** Concatenate the items found by the workers in chain order */
+        template <typename T>
+        std::vector<T> mergeSorted(std::vector<std::vector<T>> &workerItems) {
+            std::vector<T> items;
+            size_t total = 0;
+            for (auto &worker : workerItems) {
+                total += worker.size();
+            }
+            items.reserve(total);
+            for (auto &worker : workerItems) {
+                items.insert(items.end(), worker.begin(), worker.end());
+                worker = std::vector<T>{};
+            }
+            std::sort(items.begin(), items.end());
+            return items;
+        }
+    }
+    
+    TxSet Cluster::getTxSet(uint32_t threadCount) const {
+        return clusterTxSet(*clusterAccess, clusterNum, true, true, threadCount);
+    }
+    
+    TxSet Cluster::getOutputTxSet(uint32_t threadCount) const {
+        return clusterTxSet(*clusterAccess, clusterNum, true, false, threadCount);
+    }
+    
+    TxSet Cluster::getInputTxSet(uint32_t threadCount) const {
+        return clusterTxSet(*clusterAccess, clusterNum, false, true, threadCount);
+    }
+
     ranges::any_view<Output> Cluster::getOutputs() const {
-        return getPossibleAddresses(clusterNum, clusterAccess) | ranges::views::transform([](auto && address) { return address.getOutputs(); }) | ranges::views::join;
+        auto access_ = &clusterAccess->access;
+        auto addresses = possibleRawAddresses(getDedupAddresses());
+        auto workerCount = scanWorkerCount(addresses.size(), 0);
+        std::vector<std::vector<OutputPointer>> workerPointers(workerCount);
+        scanOutputs(addresses, *access_, workerCount, [&](uint32_t workerNum, const Output &output) {
+            workerPointers[workerNum].push_back(output.pointer);
+        });
+        auto pointers = std::make_shared<std::vector<OutputPointer>>(mergeSorted(workerPointers));
+        return ranges::views::ints(size_t{0}, pointers->size()) | ranges::views::transform([pointers, access_](size_t i) {
+            return Output((*pointers)[i], *access_);
+        });
     }
     
     ranges::any_view<blocksci::Input> Cluster::getInputs() const {
-        return getPossibleAddresses(clusterNum, clusterAccess) | ranges::views::transform([](auto && address) { return address.getInputs(); }) | ranges::views::join;
+        auto access_ = &clusterAccess->access;
+        auto addresses = possibleRawAddresses(getDedupAddresses());
+        auto workerCount = scanWorkerCount(addresses.size(), 0);
+        std::vector<std::vector<InputPointer>> workerPointers(workerCount);
+        scanOutputs(addresses, *access_, workerCount, [&](uint32_t workerNum, const Output &output) {
+            if (auto pointer = output.getSpendingInputPointer()) {
+                workerPointers[workerNum].push_back(*pointer);
+            }
+        });
+        auto pointers = std::make_shared<std::vector<InputPointer>>(mergeSorted(workerPointers));
+        return ranges::views::ints(size_t{0}, pointers->size()) | ranges::views::transform([pointers, access_](size_t i) {
+            return Input((*pointers)[i], *access_);
+        });
     }
     
     std::vector<blocksci::Transaction> Cluster::getTransactions() const {
-        auto pointers = getOutputPointers() | ranges::to_vector;
-        return blocksci::getTransactions(pointers, clusterAccess->access);
+        return getTxSet().toTransactions();
     }
     
     std::vector<blocksci::Transaction> Cluster::getOutputTransactions() const {
-        auto pointers = getOutputPointers() | ranges::to_vector;
-        return blocksci::getOutputTransactions(pointers, clusterAccess->access);
+        return getOutputTxSet().toTransactions();
     }
     
     std::vector<blocksci::Transaction> Cluster::getInputTransactions() const {
-        auto pointers = getOutputPointers() | ranges::to_vector;
-        return blocksci::getInputTransactions(pointers, clusterAccess->access);
+        return getInputTxSet().toTransactions();
     }
     
     int64_t Cluster::calculateBalance(BlockHeight height) const {
-        auto access_ = &clusterAccess->access;
-        auto balances = getDedupAddresses() | ranges::views::transform([access_, height](const DedupAddress &dedupAddress) {
-            uint32_t scriptNum = dedupAddress.scriptNum;
-            auto possibleAddressBalances = addressTypesRange(dedupAddress.type) | ranges::views::transform([&access_, scriptNum, height](AddressType::Enum addressType) {
-                return Address(scriptNum, addressType, *access_).calculateBalance(height);
-            });
-            return ranges::accumulate(possibleAddressBalances, int64_t{0});
+        auto addresses = possibleRawAddresses(getDedupAddresses());
+        auto workerCount = scanWorkerCount(addresses.size(), 0);
+        std::vector<int64_t> workerBalances(workerCount, 0);
+        scanOutputs(addresses, clusterAccess->access, workerCount, [&](uint32_t workerNum, const Output &output) {
+            if (height == -1) {
+                if (!output.isSpent()) {
+                    workerBalances[workerNum] += output.getValue();
+                }
+            } else if (output.getBlockHeight() <= height && (!output.isSpent() || *output.getSpendingBlockHeight() > height)) {
+                workerBalances[workerNum] += output.getValue();
+            }
         });
-        return ranges::accumulate(balances, int64_t{0});
+        int64_t balance = 0;
+        for (auto workerBalance : workerBalances) {
+            balance += workerBalance;
+        }
+        return balance;
+    }
+    
+    int64_t Cluster::calculateBalanceBeforeTx(uint32_t endTxNum) const {
+        auto addresses = possibleRawAddresses(getDedupAddresses());
+        auto workerCount = scanWorkerCount(addresses.size(), 0);
+        std::vector<int64_t> workerBalances(workerCount, 0);
+        scanOutputs(addresses, clusterAccess->access, workerCount, [&](uint32_t workerNum, const Output &output) {
+            auto spendingTx = output.getSpendingTxIndex();
+            if (output.pointer.txNum < endTxNum && (!spendingTx || *spendingTx >= endTxNum)) {
+                workerBalances[workerNum] += output.getValue();
+            }
+        });
+        int64_t balance = 0;
+        for (auto workerBalance : workerBalances) {
+            balance += workerBalance;
+        }
+        return balance;
     }
     
     ranges::any_view<TaggedAddress> TaggedCluster::getTaggedAddresses() const {
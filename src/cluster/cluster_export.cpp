@@ -0,0 +1,342 @@
+//
+//  cluster_export.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include <blocksci/cluster/cluster_export.hpp>
+#include <blocksci/cluster/cluster_flows.hpp>
+#include <blocksci/cluster/cluster_manager.hpp>
+
+#include <internal/cluster_access.hpp>
+#include <internal/dedup_address_info.hpp>
+#include <internal/segment_work.hpp>
+
+#include <wjfilesystem/path.h>
+
+#ifdef BLOCKSCI_WITH_ARROW
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <arrow/ipc/writer.h>
+#ifdef BLOCKSCI_WITH_PARQUET
+#include <parquet/arrow/writer.h>
+#endif
+#endif
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace blocksci {
+    
+    bool clusterExportAvailable(ClusterExportFormat format) {
+        switch (format) {
+            case ClusterExportFormat::Arrow:
+#ifdef BLOCKSCI_WITH_ARROW
+                return true;
+#else
+                return false;
+#endif
+            case ClusterExportFormat::Parquet:
+#ifdef BLOCKSCI_WITH_PARQUET
+                return true;
+#else
+                return false;
+#endif
+        }
+        return false;
+    }
+    
+#ifdef BLOCKSCI_WITH_ARROW
+    namespace {
+        void checkStatus(const arrow::Status &status, const std::string &path) {
+            if (!status.ok()) {
+                throw std::runtime_error("Could not export clusters to " + path + " with error: " + status.ToString());
+            }
+        }
+        
+        template <typename T>
+        T checkResult(arrow::Result<T> result, const std::string &path) {
+            checkStatus(result.status(), path);
+            return result.MoveValueUnsafe();
+        }
+        
+        /** Array over values owned by someone else, used to hand the mapped cluster files to Arrow without a copy */
+        template <typename T>
+        std::shared_ptr<arrow::Array> wrapColumn(const std::shared_ptr<arrow::DataType> &type, const T *values, int64_t length) {
+            auto buffer = std::make_shared<arrow::Buffer>(reinterpret_cast<const uint8_t *>(values), length * static_cast<int64_t>(sizeof(T)));
+            return arrow::MakeArray(arrow::ArrayData::Make(type, length, {nullptr, std::move(buffer)}, 0));
+        }
+        
+        /** Array of the numbers [first, first + length) */
+        std::shared_ptr<arrow::Array> sequenceColumn(uint32_t first, int64_t length, const std::string &path) {
+            std::shared_ptr<arrow::Buffer> buffer = checkResult(arrow::AllocateBuffer(length * static_cast<int64_t>(sizeof(uint32_t))), path);
+            auto values = reinterpret_cast<uint32_t *>(buffer->mutable_data());
+            std::iota(values, values + length, first);
+            return arrow::MakeArray(arrow::ArrayData::Make(arrow::uint32(), length, {nullptr, std::move(buffer)}, 0));
+        }
+        
+        /** Writes the record batches of one file of an exported dataset */
+        class BatchFileWriter {
+            std::string path;
+            std::shared_ptr<arrow::io::FileOutputStream> sink;
+            std::shared_ptr<arrow::ipc::RecordBatchWriter> ipcWriter;
+#ifdef BLOCKSCI_WITH_PARQUET
+            std::unique_ptr<parquet::arrow::FileWriter> parquetWriter;
+#endif
+            
+        public:
+            BatchFileWriter(std::string path_, const std::shared_ptr<arrow::Schema> &schema, ClusterExportFormat format) : path(std::move(path_)) {
+                sink = checkResult(arrow::io::FileOutputStream::Open(path), path);
+                if (format == ClusterExportFormat::Arrow) {
+                    ipcWriter = checkResult(arrow::ipc::MakeFileWriter(sink, schema), path);
+                } else {
+#ifdef BLOCKSCI_WITH_PARQUET
+                    parquetWriter = checkResult(parquet::arrow::FileWriter::Open(*schema, arrow::default_memory_pool(), sink), path);
+#endif
+                }
+            }
+            
+            void write(const std::shared_ptr<arrow::RecordBatch> &batch) {
+                if (ipcWriter) {
+                    checkStatus(ipcWriter->WriteRecordBatch(*batch), path);
+                    return;
+                }
+#ifdef BLOCKSCI_WITH_PARQUET
+                auto table = checkResult(arrow::Table::FromRecordBatches(batch->schema(), {batch}), path);
+                checkStatus(parquetWriter->WriteTable(*table, batch->num_rows()), path);
+#endif
+            }
+            
+            void close() {
+                if (ipcWriter) {
+                    checkStatus(ipcWriter->Close(), path);
+                }
+#ifdef BLOCKSCI_WITH_PARQUET
+                if (parquetWriter) {
+                    checkStatus(parquetWriter->Close(), path);
+                }
+#endif
+                checkStatus(sink->Close(), path);
+            }
+        };
+        
+        /** One file of the export covering the rows [begin, end) of a membership column or of the cluster statistics */
+        struct ExportFile {
+            bool stats;
+            DedupAddressType::Enum type;
+            uint32_t begin;
+            uint32_t end;
+            std::string path;
+        };
+        
+        std::shared_ptr<arrow::Schema> membershipSchema() {
+            return arrow::schema({
+                arrow::field("address_type", arrow::dictionary(arrow::int8(), arrow::utf8()), false),
+                arrow::field("script_num", arrow::uint32(), false),
+                arrow::field("cluster_id", arrow::uint32(), false)
+            });
+        }
+        
+        std::shared_ptr<arrow::Schema> statsSchema() {
+            return arrow::schema({
+                arrow::field("cluster_id", arrow::uint32(), false),
+                arrow::field("total_received", arrow::int64(), false),
+                arrow::field("balance", arrow::int64(), false),
+                arrow::field("address_count", arrow::uint32(), false),
+                arrow::field("tx_count", arrow::uint32(), false),
+                arrow::field("first_height", arrow::int32(), false),
+                arrow::field("last_height", arrow::int32(), false)
+            });
+        }
+        
+        /** Names of all DedupAddressTypes, shared by the address_type columns of every file so that it stays the same dictionary */
+        std::shared_ptr<arrow::Array> addressTypeDictionary() {
+            arrow::StringBuilder builder;
+            for (auto type : DedupAddressType::allArray()) {
+                checkStatus(builder.Append(dedupAddressName(type)), "address type dictionary");
+            }
+            std::shared_ptr<arrow::Array> dictionary;
+            checkStatus(builder.Finish(&dictionary), "address type dictionary");
+            return dictionary;
+        }
+        
+        void writeMembershipFile(const ClusterAccess &access, const ExportFile &file, const std::shared_ptr<arrow::Array> &dictionary, const ClusterExportOptions &options) {
+            auto schema = membershipSchema();
+            auto clusterNums = access.getTypeClusterNums(file.type).first;
+            
+            // Every batch of the file has the same type, so one buffer of indices serves all of them
+            auto batchSize = std::min(options.batchSize, file.end - file.begin);
+            std::shared_ptr<arrow::Buffer> typeIndices = checkResult(arrow::AllocateBuffer(batchSize), file.path);
+            std::fill_n(typeIndices->mutable_data(), batchSize, static_cast<uint8_t>(file.type));
+            
+            BatchFileWriter writer{file.path, schema, options.format};
+            for (uint32_t begin = file.begin; begin < file.end; begin += batchSize) {
+                auto length = static_cast<int64_t>(std::min(batchSize, file.end - begin));
+                auto indices = arrow::MakeArray(arrow::ArrayData::Make(arrow::int8(), length, {nullptr, typeIndices}, 0));
+                auto types = checkResult(arrow::DictionaryArray::FromArrays(schema->field(0)->type(), indices, dictionary), file.path);
+                // Row i of the column is the address with scriptNum i + 1
+                auto scriptNums = sequenceColumn(begin + 1, length, file.path);
+                auto clusters = wrapColumn(arrow::uint32(), clusterNums + begin, length);
+                writer.write(arrow::RecordBatch::Make(schema, length, {types, scriptNums, clusters}));
+            }
+            writer.close();
+        }
+        
+        void writeStatsFile(const ClusterAccess &access, const ExportFile &file, const ClusterExportOptions &options) {
+            auto schema = statsSchema();
+            BatchFileWriter writer{file.path, schema, options.format};
+            for (uint32_t begin = file.begin; begin < file.end; begin += options.batchSize) {
+                auto length = static_cast<int64_t>(std::min(options.batchSize, file.end - begin));
+                std::vector<std::shared_ptr<arrow::Array>> columns{
+                    sequenceColumn(begin, length, file.path),
+                    wrapColumn(arrow::int64(), access.getStatColumn<int64_t>(ClusterStat::TotalReceived) + begin, length),
+                    wrapColumn(arrow::int64(), access.getStatColumn<int64_t>(ClusterStat::Balance) + begin, length),
+                    wrapColumn(arrow::uint32(), access.getStatColumn<uint32_t>(ClusterStat::AddressCount) + begin, length),
+                    wrapColumn(arrow::uint32(), access.getStatColumn<uint32_t>(ClusterStat::TxCount) + begin, length),
+                    wrapColumn(arrow::int32(), access.getStatColumn<BlockHeight>(ClusterStat::FirstHeight) + begin, length),
+                    wrapColumn(arrow::int32(), access.getStatColumn<BlockHeight>(ClusterStat::LastHeight) + begin, length)
+                };
+                writer.write(arrow::RecordBatch::Make(schema, length, std::move(columns)));
+            }
+            writer.close();
+        }
+        
+        std::shared_ptr<arrow::Schema> flowSchema() {
+            return arrow::schema({
+                arrow::field("bucket_start", arrow::timestamp(arrow::TimeUnit::SECOND), false),
+                arrow::field("source_cluster", arrow::uint32(), true),
+                arrow::field("destination_cluster", arrow::uint32(), true),
+                arrow::field("value", arrow::int64(), false),
+                arrow::field("tx_count", arrow::uint32(), false)
+            });
+        }
+        
+        /** Cluster column of the flows with OtherCluster as null */
+        template <typename Get>
+        std::shared_ptr<arrow::Array> flowClusterColumn(const std::vector<ClusterFlow> &flows, Get get, const std::string &path) {
+            arrow::UInt32Builder builder;
+            checkStatus(builder.Reserve(static_cast<int64_t>(flows.size())), path);
+            for (auto &flow : flows) {
+                auto clusterNum = get(flow);
+                if (clusterNum == ClusterFlow::OtherCluster) {
+                    builder.UnsafeAppendNull();
+                } else {
+                    builder.UnsafeAppend(clusterNum);
+                }
+            }
+            return checkResult(builder.Finish(), path);
+        }
+        
+        filesystem::path createExportDirectory(const filesystem::path &path) {
+            if (path.exists()) {
+                throw std::runtime_error("Cannot export clusters to " + path.str() + ", it exists already");
+            }
+            if (!filesystem::create_directory(path)) {
+                throw std::runtime_error("Cannot create directory at path " + path.str());
+            }
+            return path;
+        }
+    }
+#endif
+    
+    void ClusterManager::exportClusters(const std::string &outputDirectory, const ClusterExportOptions &options) const {
+        if (!clusterExportAvailable(options.format)) {
+            throw std::runtime_error(options.format == ClusterExportFormat::Arrow ? "BlockSci was built without Arrow, clusters can't be exported as Arrow" : "BlockSci was built without Parquet, clusters can't be exported as Parquet");
+        }
+#ifdef BLOCKSCI_WITH_ARROW
+        if (options.batchSize == 0 || options.batchesPerFile == 0) {
+            throw std::runtime_error("Cluster export needs a batch size and batches per file of at least 1");
+        }
+        filesystem::path outputPath{outputDirectory};
+        if (!outputPath.exists() && !filesystem::create_directory(outputPath)) {
+            throw std::runtime_error("Cannot create directory at path " + outputDirectory);
+        }
+        auto membershipPath = createExportDirectory(outputPath/"membership");
+        auto includeStats = access->hasClusterStats();
+        auto statsPath = includeStats ? createExportDirectory(outputPath/"cluster_stats") : filesystem::path{};
+        
+        std::string extension = options.format == ClusterExportFormat::Arrow ? ".arrow" : ".parquet";
+        auto rowsPerFile = static_cast<uint64_t>(options.batchSize) * options.batchesPerFile;
+        std::vector<ExportFile> files;
+        auto addFiles = [&](bool stats, DedupAddressType::Enum type, uint32_t rowCount, const filesystem::path &directory, const std::string &prefix) {
+            uint32_t part = 0;
+            for (uint64_t begin = 0; begin < rowCount; begin += rowsPerFile, part++) {
+                auto end = static_cast<uint32_t>(std::min<uint64_t>(begin + rowsPerFile, rowCount));
+                files.push_back(ExportFile{stats, type, static_cast<uint32_t>(begin), end, (directory/(prefix + std::to_string(part) + extension)).str()});
+            }
+        };
+        for (auto type : DedupAddressType::allArray()) {
+            addFiles(false, type, access->getTypeClusterNums(type).second, membershipPath, dedupAddressName(type) + "-");
+        }
+        if (includeStats) {
+            addFiles(true, DedupAddressType::SCRIPTHASH, clusterCount, statsPath, "part-");
+        }
+        
+        // Workers can't let exceptions escape their thread, the first failure is rethrown once all have finished
+        auto dictionary = addressTypeDictionary();
+        std::vector<std::exception_ptr> errors(files.size());
+        segmentWork(0, static_cast<uint32_t>(files.size()), resolveThreadCount(options.threadCount), [&](uint32_t i) {
+            try {
+                if (files[i].stats) {
+                    writeStatsFile(*access, files[i], options);
+                } else {
+                    writeMembershipFile(*access, files[i], dictionary, options);
+                }
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+        for (auto &error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+#else
+        (void)outputDirectory;
+#endif
+    }
+    
+    void ClusterManager::exportClusterFlows(BlockRange &blocks, const std::string &path, const ClusterFlowOptions &options) const {
+        if (!clusterExportAvailable(options.format)) {
+            throw std::runtime_error(options.format == ClusterExportFormat::Arrow ? "BlockSci was built without Arrow, cluster flows can't be exported as Arrow" : "BlockSci was built without Parquet, cluster flows can't be exported as Parquet");
+        }
+#ifdef BLOCKSCI_WITH_ARROW
+        if (filesystem::path{path}.exists()) {
+            throw std::runtime_error("Cannot export cluster flows to " + path + ", it exists already");
+        }
+        auto flows = clusterFlows(blocks, options);
+        auto length = static_cast<int64_t>(flows.size());
+        arrow::TimestampBuilder bucketBuilder{arrow::timestamp(arrow::TimeUnit::SECOND), arrow::default_memory_pool()};
+        arrow::Int64Builder valueBuilder;
+        arrow::UInt32Builder txCountBuilder;
+        checkStatus(bucketBuilder.Reserve(length), path);
+        checkStatus(valueBuilder.Reserve(length), path);
+        checkStatus(txCountBuilder.Reserve(length), path);
+        for (auto &flow : flows) {
+            bucketBuilder.UnsafeAppend(static_cast<int64_t>(flow.bucketStart));
+            valueBuilder.UnsafeAppend(flow.value);
+            txCountBuilder.UnsafeAppend(flow.txCount);
+        }
+        auto schema = flowSchema();
+        std::vector<std::shared_ptr<arrow::Array>> columns{
+            checkResult(bucketBuilder.Finish(), path),
+            flowClusterColumn(flows, [](const ClusterFlow &flow) { return flow.source; }, path),
+            flowClusterColumn(flows, [](const ClusterFlow &flow) { return flow.destination; }, path),
+            checkResult(valueBuilder.Finish(), path),
+            checkResult(txCountBuilder.Finish(), path)
+        };
+        BatchFileWriter writer{path, schema, options.format};
+        writer.write(arrow::RecordBatch::Make(schema, length, std::move(columns)));
+        writer.close();
+#else
+        (void)blocks;
+        (void)path;
+#endif
+    }
+} // namespace blocksci
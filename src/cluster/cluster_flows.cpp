@@ -0,0 +1,218 @@
+//
+//  cluster_flows.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include <blocksci/cluster/cluster_flows.hpp>
+#include <blocksci/cluster/cluster_manager.hpp>
+#include <blocksci/address/tag_store.hpp>
+#include <blocksci/chain/block.hpp>
+#include <blocksci/chain/block_range.hpp>
+
+#include <internal/address_info.hpp>
+#include <internal/chain_access.hpp>
+#include <internal/cluster_access.hpp>
+#include <internal/data_access.hpp>
+
+#include <range/v3/utility/optional.hpp>
+
+#include <algorithm>
+#include <array>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace blocksci {
+    namespace {
+        struct FlowKey {
+            uint32_t bucketStart;
+            uint32_t source;
+            uint32_t destination;
+
+            bool operator==(const FlowKey &other) const {
+                return bucketStart == other.bucketStart && source == other.source && destination == other.destination;
+            }
+        };
+
+        struct FlowKeyHash {
+            size_t operator()(const FlowKey &key) const {
+                auto hash = static_cast<uint64_t>(key.source) * 0x9E3779B97F4A7C15ULL;
+                hash ^= (static_cast<uint64_t>(key.destination) + 0x632BE59BD9B4E019ULL) * 0xC2B2AE3D27D4EB4FULL;
+                hash ^= static_cast<uint64_t>(key.bucketStart) * 0x165667B19E3779F9ULL;
+                return static_cast<size_t>(hash ^ (hash >> 29));
+            }
+        };
+
+        struct FlowTotal {
+            int64_t value = 0;
+            uint32_t txCount = 0;
+        };
+
+        /** Sparse flows of one chunk of blocks, merged into each other at the end */
+        using FlowMap = std::unordered_map<FlowKey, FlowTotal, FlowKeyHash>;
+
+        /** Direct lookup of the cluster of an address in the cluster index file of its type */
+        class ClusterLookup {
+            std::array<std::pair<const uint32_t *, uint32_t>, DedupAddressType::size> indexes;
+            std::vector<bool> keptClusters;
+
+        public:
+            ClusterLookup(const ClusterAccess &access, std::vector<bool> keptClusters_) : keptClusters(std::move(keptClusters_)) {
+                for (auto type : DedupAddressType::allArray()) {
+                    indexes[static_cast<size_t>(type)] = access.getTypeClusterNums(type);
+                }
+            }
+
+            /** Cluster of the address, OtherCluster if it isn't kept and nullopt if the clustering doesn't cover it */
+            ranges::optional<uint32_t> operator()(const Inout &inout) const {
+                auto &index = indexes[static_cast<size_t>(dedupType(inout.getType()))];
+                auto scriptNum = inout.getAddressNum();
+                if (scriptNum == 0 || scriptNum > index.second) {
+                    return ranges::nullopt;
+                }
+                auto clusterNum = index.first[scriptNum - 1];
+                if (!keptClusters.empty() && !keptClusters[clusterNum]) {
+                    return ClusterFlow::OtherCluster;
+                }
+                return clusterNum;
+            }
+        };
+
+        void addBlockFlows(const ChainAccess &chain, const RawBlock &block, const ClusterLookup &clusterOf, const ClusterFlowOptions &options, FlowMap &flows) {
+            auto bucketStart = options.bucketSeconds > 0 ? block.timestamp - block.timestamp % options.bucketSeconds : 0;
+            std::vector<std::pair<uint32_t, int64_t>> sources;
+            // Txes counted once per flow they contribute to, even if several outputs go to the same cluster
+            std::vector<FlowKey> txKeys;
+            for (uint32_t txNum = block.firstTxIndex; txNum < block.firstTxIndex + block.txCount; txNum++) {
+                auto tx = chain.getTx(txNum);
+                // The coinbase creates new coins without a source cluster
+                if (tx->inputCount == 0) {
+                    continue;
+                }
+                sources.clear();
+                int64_t totalInput = 0;
+                for (auto input = tx->beginInputs(); input != tx->endInputs(); ++input) {
+                    if (auto cluster = clusterOf(*input)) {
+                        sources.emplace_back(*cluster, input->getValue());
+                        totalInput += input->getValue();
+                    }
+                }
+                if (totalInput <= 0) {
+                    continue;
+                }
+                std::sort(sources.begin(), sources.end());
+                auto merged = sources.begin();
+                for (auto it = sources.begin() + 1; it < sources.end(); ++it) {
+                    if (it->first == merged->first) {
+                        merged->second += it->second;
+                    } else {
+                        *++merged = *it;
+                    }
+                }
+                sources.erase(merged + 1, sources.end());
+
+                txKeys.clear();
+                for (auto output = tx->beginOutputs(); output != tx->endOutputs(); ++output) {
+                    auto destination = clusterOf(*output);
+                    if (!destination || output->getValue() == 0) {
+                        continue;
+                    }
+                    for (auto &source : sources) {
+                        if (source.first == *destination && (!options.includeSelfFlows || source.first == ClusterFlow::OtherCluster)) {
+                            continue;
+                        }
+                        __extension__ using int128 = __int128;
+                        auto share = static_cast<int64_t>(static_cast<int128>(output->getValue()) * source.second / totalInput);
+                        FlowKey key{bucketStart, source.first, *destination};
+                        flows[key].value += share;
+                        if (std::find(txKeys.begin(), txKeys.end(), key) == txKeys.end()) {
+                            txKeys.push_back(key);
+                            flows[key].txCount++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    constexpr uint32_t ClusterFlow::OtherCluster;
+
+    std::vector<ClusterFlow> ClusterManager::clusterFlows(BlockRange &blocks, const ClusterFlowOptions &options) const {
+        std::vector<bool> keptClusters;
+        if (options.topK > 0) {
+            keptClusters.resize(clusterCount, false);
+            for (auto &cluster : topClusters(options.rankBy, options.topK)) {
+                keptClusters[cluster.clusterNum] = true;
+            }
+        }
+        ClusterLookup clusterOf{*access, std::move(keptClusters)};
+        auto &chain = access->access.getChain();
+
+        auto mapFunc = [&](const BlockRange &chunk) {
+            FlowMap flows;
+            for (auto height = chunk.sl.start; height < chunk.sl.stop; height++) {
+                addBlockFlows(chain, *chain.getBlock(height), clusterOf, options, flows);
+            }
+            return flows;
+        };
+        auto reduceFunc = [](FlowMap &a, FlowMap &b) -> FlowMap & {
+            if (a.size() < b.size()) {
+                std::swap(a, b);
+            }
+            for (auto &entry : b) {
+                auto &total = a[entry.first];
+                total.value += entry.second.value;
+                total.txCount += entry.second.txCount;
+            }
+            return a;
+        };
+        auto flows = blocks.mapReduce<FlowMap>(mapFunc, reduceFunc);
+
+        std::vector<ClusterFlow> result;
+        result.reserve(flows.size());
+        for (auto &entry : flows) {
+            result.push_back(ClusterFlow{entry.first.bucketStart, entry.first.source, entry.first.destination, entry.second.value, entry.second.txCount});
+        }
+        std::sort(result.begin(), result.end(), [](const ClusterFlow &a, const ClusterFlow &b) {
+            return std::tie(a.bucketStart, a.source, a.destination) < std::tie(b.bucketStart, b.source, b.destination);
+        });
+        return result;
+    }
+
+    std::vector<ClusterFlow> ClusterManager::tagFlows(BlockRange &blocks, const TagStore &tags, const ClusterFlowOptions &options) const {
+        auto clusterTags = clusterTagIds(tags);
+        auto flows = clusterFlows(blocks, options);
+        auto tagOf = [&](uint32_t clusterNum) {
+            return clusterNum == ClusterFlow::OtherCluster ? TagStore::NoTag : clusterTags[clusterNum];
+        };
+        std::vector<ClusterFlow> result;
+        result.reserve(flows.size());
+        for (auto &flow : flows) {
+            auto source = tagOf(flow.source);
+            auto destination = tagOf(flow.destination);
+            if (source == destination && source != TagStore::NoTag && !options.includeSelfFlows) {
+                continue;
+            }
+            result.push_back(ClusterFlow{flow.bucketStart, source, destination, flow.value, flow.txCount});
+        }
+        std::sort(result.begin(), result.end(), [](const ClusterFlow &a, const ClusterFlow &b) {
+            return std::tie(a.bucketStart, a.source, a.destination) < std::tie(b.bucketStart, b.source, b.destination);
+        });
+        auto merged = result.begin();
+        for (auto it = result.begin(); it != result.end(); ++it) {
+            if (it != result.begin() && std::tie(it->bucketStart, it->source, it->destination) == std::tie(merged->bucketStart, merged->source, merged->destination)) {
+                merged->value += it->value;
+                merged->txCount += it->txCount;
+            } else if (it != result.begin()) {
+                *++merged = *it;
+            }
+        }
+        if (!result.empty()) {
+            result.erase(merged + 1, result.end());
+        }
+        return result;
+    }
+} // namespace blocksci
@@ -8,6 +8,7 @@
 
 #include <blocksci/cluster/cluster_manager.hpp>
 #include <blocksci/cluster/cluster.hpp>
+#include <blocksci/address/tag_store.hpp>
 
 #include <blocksci/chain/blockchain.hpp>
 #include <blocksci/chain/input.hpp>
@@ -15,74 +16,143 @@
 #include <blocksci/core/dedup_address.hpp>
 #include <blocksci/heuristics/change_address.hpp>
 #include <blocksci/heuristics/tx_identification.hpp>
+#include <blocksci/scripts/multisig_script.hpp>
 #include <blocksci/scripts/scripthash_script.hpp>
 
+#include <internal/access_registry.hpp>
 #include <internal/address_info.hpp>
 #include <internal/cluster_access.hpp>
+#include <internal/concurrent_disjoint_sets.hpp>
 #include <internal/data_access.hpp>
+#include <internal/external_components.hpp>
+#include <internal/packed_cluster_addresses.hpp>
 #include <internal/progress_bar.hpp>
+#include <internal/scratch_array.hpp>
 #include <internal/script_access.hpp>
-
-#include <dset/dset.h>
+#include <internal/segment_work.hpp>
+#include <internal/tracing.hpp>
 
 #include <wjfilesystem/path.h>
 
 #include <range/v3/view/iota.hpp>
 #include <range/v3/range_for.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
 #include <fstream>
 #include <future>
+#include <iostream>
+#include <iterator>
 #include <map>
+#include <memory>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
 
 namespace {
-    template <typename Job>
-    void segmentWork(uint32_t start, uint32_t end, uint32_t segmentCount, Job job) {
-        uint32_t total = end - start;
-        
-        // Don't partition over threads if there are less items than segment count
-        if (total < segmentCount) {
-            for (uint32_t i = start; i < end; ++i) {
-                job(i);
-            }
-            return;
+    using blocksci::runSegments;
+    using blocksci::segmentWork;
+    using blocksci::splitSegments;
+    
+    template <typename T>
+    void atomicMin(std::atomic<T> &value, T candidate) {
+        auto current = value.load(std::memory_order_relaxed);
+        while (candidate < current && !value.compare_exchange_weak(current, candidate, std::memory_order_relaxed)) {}
+    }
+    
+    template <typename T>
+    void atomicMax(std::atomic<T> &value, T candidate) {
+        auto current = value.load(std::memory_order_relaxed);
+        while (candidate > current && !value.compare_exchange_weak(current, candidate, std::memory_order_relaxed)) {}
+    }
+    
+    void checkClusterStats(const blocksci::ClusterAccess &access) {
+        if (!access.hasClusterStats()) {
+            throw std::runtime_error("The clustering has no precomputed cluster statistics, update or recreate it to compute them");
         }
-        
-        auto segmentSize = total / segmentCount;
-        auto segmentsRemaining = total % segmentCount;
-        std::vector<std::pair<uint32_t, uint32_t>> segments;
-        uint32_t i = 0;
-        while(i < total) {
-            uint32_t startSegment = i;
-            i += segmentSize;
-            if (segmentsRemaining > 0) {
-                i += 1;
-                segmentsRemaining--;
-            }
-            uint32_t endSegment = i;
-            segments.emplace_back(startSegment + start, endSegment + start);
-        }
-        std::vector<std::thread> threads;
-        for (uint32_t i = 0; i < segmentCount - 1; i++) {
-            auto segment = segments[i];
-            threads.emplace_back([segment, &job](){
-                for (uint32_t i = segment.first; i < segment.second; i++) {
-                    job(i);
-                }
-            });
+    }
+    
+    std::vector<blocksci::Cluster> makeClusters(const std::vector<uint32_t> &clusterNums, const blocksci::ClusterAccess &access) {
+        std::vector<blocksci::Cluster> clusters;
+        clusters.reserve(clusterNums.size());
+        for (auto clusterNum : clusterNums) {
+            clusters.emplace_back(clusterNum, access);
         }
-        
-        auto segment = segments.back();
-        for (uint32_t i = segment.first; i < segment.second; i++) {
-            job(i);
+        return clusters;
+    }
+    
+    /** Call func with the column of the statistic, typed by the values the column holds */
+    template <typename Func>
+    auto withStatColumn(const blocksci::ClusterAccess &access, blocksci::ClusterStat stat, Func func) {
+        using blocksci::ClusterStat;
+        switch (stat) {
+            case ClusterStat::TotalReceived:
+            case ClusterStat::Balance:
+                return func(access.getStatColumn<int64_t>(stat));
+            case ClusterStat::AddressCount:
+            case ClusterStat::TxCount:
+                return func(access.getStatColumn<uint32_t>(stat));
+            case ClusterStat::FirstHeight:
+            case ClusterStat::LastHeight:
+                return func(access.getStatColumn<blocksci::BlockHeight>(stat));
         }
-        
-        for (auto &thread : threads) {
-            thread.join();
+        throw std::runtime_error("Unknown cluster statistic");
+    }
+    
+    template <typename T>
+    std::vector<uint32_t> sortClustersBy(const T *values, uint32_t clusterCount, bool descending) {
+        std::vector<uint32_t> clusterNums(clusterCount);
+        std::iota(clusterNums.begin(), clusterNums.end(), 0u);
+        std::sort(clusterNums.begin(), clusterNums.end(), [values, descending](uint32_t a, uint32_t b) {
+            if (values[a] != values[b]) {
+                return descending ? values[a] > values[b] : values[a] < values[b];
+            }
+            return a < b;
+        });
+        return clusterNums;
+    }
+    
+    template <typename T>
+    std::vector<uint32_t> topClustersBy(const T *values, uint32_t clusterCount, uint32_t k, uint32_t threadCount) {
+        if (k == 0) {
+            return {};
         }
+        auto better = [values](uint32_t a, uint32_t b) {
+            return values[a] > values[b] || (values[a] == values[b] && a < b);
+        };
+        auto segments = splitSegments(0, clusterCount, threadCount);
+        std::vector<std::vector<uint32_t>> segmentTops(segments.size());
+        runSegments(segments, [&](uint32_t segmentNum, uint32_t segmentStart, uint32_t segmentEnd) {
+            // Heap of the best k clusters of the segment seen so far with the worst of them in front
+            auto &top = segmentTops[segmentNum];
+            for (uint32_t i = segmentStart; i < segmentEnd; i++) {
+                if (top.size() < k) {
+                    top.push_back(i);
+                    std::push_heap(top.begin(), top.end(), better);
+                } else if (better(i, top.front())) {
+                    std::pop_heap(top.begin(), top.end(), better);
+                    top.back() = i;
+                    std::push_heap(top.begin(), top.end(), better);
+                }
+            }
+        });
+        std::vector<uint32_t> top;
+        for (auto &segmentTop : segmentTops) {
+            top.insert(top.end(), segmentTop.begin(), segmentTop.end());
+        }
+        auto topCount = std::min(top.size(), static_cast<size_t>(k));
+        std::partial_sort(top.begin(), top.begin() + static_cast<std::ptrdiff_t>(topCount), top.end(), better);
+        top.resize(topCount);
+        return top;
     }
 }
 
 namespace blocksci {
-    ClusterManager::ClusterManager(const std::string &baseDirectory, DataAccess &access_) : access(std::make_unique<ClusterAccess>(baseDirectory, access_)), clusterCount(access->clusterCount()) {}
+    constexpr uint32_t ClusterManager::NoCluster;
+    
+    ClusterManager::ClusterManager(const std::string &baseDirectory, DataAccess &access_) : access(sharedClusterAccess(baseDirectory, access_)), clusterCount(access->clusterCount()) {}
     
     ClusterManager::ClusterManager(ClusterManager && other) = default;
     
@@ -91,6 +161,7 @@ namespace blocksci {
     ClusterManager::~ClusterManager() = default;
     
     Cluster ClusterManager::getCluster(const Address &address) const {
+        TraceSpan span{TraceOperation::ClusterLookup, 1};
         return Cluster(access->getClusterNum(RawAddress{address.scriptNum, address.type}), *access);
     }
     
@@ -99,30 +170,267 @@ namespace blocksci {
         | ranges::views::transform([&](uint32_t clusterNum) { return Cluster(clusterNum, *access); });
     }
     
-    ranges::any_view<TaggedCluster> ClusterManager::taggedClusters(const std::unordered_map<Address, std::string> &tags) const {
-        return getClusters() | ranges::views::transform([tags](Cluster && cluster) -> ranges::optional<TaggedCluster> {
-            return cluster.getTaggedUnsafe(tags);
-        }) | flatMapOptionals();
+    uint32_t ClusterManager::getNonTrivialClusterCount() const {
+        if (access->hasImplicitSingletons()) {
+            return access->multiAddressClusterCount();
+        }
+        auto sizes = access->getClusterSizes();
+        return static_cast<uint32_t>(std::count_if(sizes.begin(), sizes.end(), [](uint32_t size) { return size > 1; }));
+    }
+    
+    ranges::any_view<Cluster, ranges::category::random_access | ranges::category::sized> ClusterManager::getNonTrivialClusters() const {
+        if (access->hasImplicitSingletons()) {
+            return ranges::views::ints(0u, access->multiAddressClusterCount())
+            | ranges::views::transform([&](uint32_t clusterNum) { return Cluster(clusterNum, *access); });
+        }
+        // Clusterings that list every cluster are scanned for the larger ones once
+        auto sizes = access->getClusterSizes();
+        auto clusterNums = std::make_shared<std::vector<uint32_t>>();
+        for (uint32_t i = 0; i < sizes.size(); i++) {
+            if (sizes[i] > 1) {
+                clusterNums->push_back(i);
+            }
+        }
+        return ranges::views::ints(0u, static_cast<uint32_t>(clusterNums->size()))
+        | ranges::views::transform([this, clusterNums](uint32_t i) { return Cluster((*clusterNums)[i], *access); });
+    }
+    
+    std::vector<Cluster> ClusterManager::getClusters(const std::vector<Address> &addresses, uint32_t threadCount) const {
+        TraceSpan span{TraceOperation::ClusterLookup, addresses.size()};
+        std::vector<uint32_t> clusterNums(addresses.size());
+        segmentWork(0, static_cast<uint32_t>(addresses.size()), resolveThreadCount(threadCount), [&](uint32_t i) {
+            clusterNums[i] = access->getClusterNum(RawAddress{addresses[i].scriptNum, addresses[i].type});
+        });
+        return makeClusters(clusterNums, *access);
+    }
+    
+    namespace {
+        /** Write the cluster of address(i) to clusterNums[i] for every i in [0, count) */
+        template <typename GetAddress>
+        void gatherClusterNums(const ClusterAccess &access, size_t count, uint32_t *clusterNums, uint32_t threadCount, GetAddress getAddress) {
+            if (count > std::numeric_limits<uint32_t>::max()) {
+                throw std::invalid_argument("Cannot look up more than 2^32 - 1 addresses at once");
+            }
+            std::array<std::pair<const uint32_t *, uint32_t>, DedupAddressType::size> typeClusterNums;
+            for (size_t i = 0; i < DedupAddressType::size; i++) {
+                typeClusterNums[i] = access.getTypeClusterNums(static_cast<DedupAddressType::Enum>(i));
+            }
+            auto entry = [&](uint32_t i) -> const uint32_t * {
+                RawAddress address = getAddress(i);
+                auto &column = typeClusterNums[static_cast<size_t>(dedupType(address.type))];
+                return address.scriptNum > 0 && address.scriptNum <= column.second ? column.first + (address.scriptNum - 1) : nullptr;
+            };
+            // The cluster index entries of a batch are scattered over large files, so the loads are issued well before
+            // they are needed to overlap their cache and TLB misses
+            constexpr uint32_t prefetchDistance = 16;
+            runSegments(splitSegments(0, static_cast<uint32_t>(count), resolveThreadCount(threadCount)), [&](uint32_t, uint32_t segmentStart, uint32_t segmentEnd) {
+                for (uint32_t i = segmentStart; i < segmentEnd; i++) {
+                    if (i + prefetchDistance < segmentEnd) {
+                        if (auto ahead = entry(i + prefetchDistance)) {
+                            __builtin_prefetch(ahead);
+                        }
+                    }
+                    auto clusterNum = entry(i);
+                    clusterNums[i] = clusterNum ? *clusterNum : ClusterManager::NoCluster;
+                }
+            });
+        }
+    }
+    
+    void ClusterManager::clusterIds(const RawAddress *addresses, size_t count, uint32_t *clusterNums, uint32_t threadCount) const {
+        TraceSpan span{TraceOperation::ClusterLookup, count};
+        gatherClusterNums(*access, count, clusterNums, threadCount, [addresses](uint32_t i) {
+            return addresses[i];
+        });
+    }
+    
+    std::vector<uint32_t> ClusterManager::clusterIds(const std::vector<RawAddress> &addresses, uint32_t threadCount) const {
+        std::vector<uint32_t> clusterNums(addresses.size());
+        clusterIds(addresses.data(), addresses.size(), clusterNums.data(), threadCount);
+        return clusterNums;
     }
     
+    void ClusterManager::clusterIds(const uint32_t *scriptNums, const uint8_t *types, size_t count, uint32_t *clusterNums, uint32_t threadCount) const {
+        for (size_t i = 0; i < count; i++) {
+            if (types[i] >= AddressType::size) {
+                throw std::invalid_argument("Invalid address type " + std::to_string(types[i]) + " at position " + std::to_string(i));
+            }
+        }
+        TraceSpan span{TraceOperation::ClusterLookup, count};
+        gatherClusterNums(*access, count, clusterNums, threadCount, [scriptNums, types](uint32_t i) {
+            return RawAddress{scriptNums[i], static_cast<AddressType::Enum>(types[i])};
+        });
+    }
+    
+    std::vector<uint32_t> ClusterManager::clusterTagIds(const TagStore &tags, uint32_t threadCount) const {
+        std::vector<uint32_t> clusterNums(tags.size());
+        for (size_t type = 0; type < AddressType::size; type++) {
+            auto start = tags.typeStart(type);
+            auto scriptNums = tags.scriptNums() + start;
+            auto addressType = static_cast<AddressType::Enum>(type);
+            gatherClusterNums(*access, tags.typeStart(type + 1) - start, clusterNums.data() + start, threadCount, [&](uint32_t i) {
+                return RawAddress{scriptNums[i], addressType};
+            });
+        }
+        
+        std::vector<std::pair<uint32_t, uint32_t>> pairs;
+        pairs.reserve(clusterNums.size());
+        auto tagIds = tags.tagIdColumn();
+        for (size_t i = 0; i < clusterNums.size(); i++) {
+            if (clusterNums[i] != NoCluster) {
+                pairs.emplace_back(clusterNums[i], tagIds[i]);
+            }
+        }
+        std::vector<uint32_t>{}.swap(clusterNums);
+        std::sort(pairs.begin(), pairs.end());
+        
+        // Within the run of every cluster the pairs of each tag are adjacent, the first longest run wins
+        std::vector<uint32_t> clusterTags(clusterCount, TagStore::NoTag);
+        size_t bestCount = 0;
+        size_t runStart = 0;
+        for (size_t i = 0; i < pairs.size(); i++) {
+            if (i == 0 || pairs[i].first != pairs[i - 1].first) {
+                bestCount = 0;
+            }
+            if (i == 0 || pairs[i] != pairs[i - 1]) {
+                runStart = i;
+            }
+            if (i - runStart + 1 > bestCount) {
+                bestCount = i - runStart + 1;
+                clusterTags[pairs[i].first] = pairs[i].second;
+            }
+        }
+        return clusterTags;
+    }
+    
+    ranges::any_view<TaggedCluster> ClusterManager::taggedClusters(const std::unordered_map<Address, std::string> &tags, uint32_t threadCount) const {
+        using TagEntry = std::pair<const Address, std::string>;
+        std::vector<const TagEntry *> entries;
+        entries.reserve(tags.size());
+        for (auto &entry : tags) {
+            entries.push_back(&entry);
+        }
+        
+        std::array<std::pair<const uint32_t *, uint32_t>, DedupAddressType::size> typeClusterNums;
+        for (size_t i = 0; i < DedupAddressType::size; i++) {
+            typeClusterNums[i] = access->getTypeClusterNums(static_cast<DedupAddressType::Enum>(i));
+        }
+        
+        // Look up the cluster of every tag, sorting the (clusterNum, entry) pairs of each segment on its own thread
+        auto segments = splitSegments(0, static_cast<uint32_t>(entries.size()), resolveThreadCount(threadCount));
+        std::vector<std::vector<std::pair<uint32_t, uint32_t>>> segmentHits(segments.size());
+        runSegments(segments, [&](uint32_t segmentNum, uint32_t segmentStart, uint32_t segmentEnd) {
+            auto &hits = segmentHits[segmentNum];
+            hits.reserve(segmentEnd - segmentStart);
+            for (uint32_t i = segmentStart; i < segmentEnd; i++) {
+                auto &address = entries[i]->first;
+                auto &column = typeClusterNums[static_cast<size_t>(dedupType(address.type))];
+                // Tags of addresses that weren't clustered can't be in any cluster
+                if (address.scriptNum > 0 && address.scriptNum <= column.second) {
+                    hits.emplace_back(column.first[address.scriptNum - 1], i);
+                }
+            }
+            std::sort(hits.begin(), hits.end());
+        });
+        std::vector<std::pair<uint32_t, uint32_t>> hits;
+        for (auto &segment : segmentHits) {
+            auto middle = hits.insert(hits.end(), segment.begin(), segment.end());
+            std::inplace_merge(hits.begin(), middle, hits.end());
+            std::vector<std::pair<uint32_t, uint32_t>>{}.swap(segment);
+        }
+        
+        std::vector<uint32_t> groupStarts;
+        for (uint32_t i = 0; i < hits.size(); i++) {
+            if (i == 0 || hits[i].first != hits[i - 1].first) {
+                groupStarts.push_back(i);
+            }
+        }
+        groupStarts.push_back(static_cast<uint32_t>(hits.size()));
+        
+        // Every tagged cluster only holds the tags of its own addresses
+        auto groupSegments = splitSegments(0, static_cast<uint32_t>(groupStarts.size() - 1), resolveThreadCount(threadCount));
+        std::vector<std::vector<TaggedCluster>> segmentClusters(groupSegments.size());
+        runSegments(groupSegments, [&](uint32_t segmentNum, uint32_t segmentStart, uint32_t segmentEnd) {
+            auto &clusters = segmentClusters[segmentNum];
+            clusters.reserve(segmentEnd - segmentStart);
+            for (uint32_t group = segmentStart; group < segmentEnd; group++) {
+                std::unordered_map<Address, std::string> clusterTags;
+                for (uint32_t i = groupStarts[group]; i < groupStarts[group + 1]; i++) {
+                    clusterTags.insert(*entries[hits[i].second]);
+                }
+                Cluster cluster{hits[groupStarts[group]].first, *access};
+                clusters.push_back(TaggedCluster{cluster, cluster.taggedAddressesNested(clusterTags)});
+            }
+        });
+        auto taggedClusters = std::make_shared<std::vector<TaggedCluster>>();
+        for (auto &clusters : segmentClusters) {
+            std::move(clusters.begin(), clusters.end(), std::back_inserter(*taggedClusters));
+        }
+        return ranges::views::ints(size_t{0}, taggedClusters->size()) | ranges::views::transform([taggedClusters](size_t i) {
+            return (*taggedClusters)[i];
+        });
+    }
+    
+    bool ClusterManager::hasClusterStats() const {
+        return access->hasClusterStats();
+    }
+    
+    ClusterStats ClusterManager::getClusterStats(uint32_t clusterNum) const {
+        return Cluster(clusterNum, *access).getStats();
+    }
+    
+    std::vector<Cluster> ClusterManager::getClustersSortedBy(ClusterStat stat, bool descending) const {
+        checkClusterStats(*access);
+        auto clusterNums = withStatColumn(*access, stat, [&](auto values) {
+            return sortClustersBy(values, clusterCount, descending);
+        });
+        return makeClusters(clusterNums, *access);
+    }
+    
+    std::vector<Cluster> ClusterManager::topClusters(ClusterStat stat, uint32_t k) const {
+        checkClusterStats(*access);
+        auto clusterNums = withStatColumn(*access, stat, [&](auto values) {
+            return topClustersBy(values, clusterCount, k, resolveThreadCount(0));
+        });
+        return makeClusters(clusterNums, *access);
+    }
+    
+    /** Reports the enclosing scope as one phase of the clustering to the trace sink */
+    class ClusteringPhaseSpan : public TraceSpan {
+    public:
+        explicit ClusteringPhaseSpan(ClusteringPhase phase) : TraceSpan(TraceOperation::ClusteringPhase, static_cast<uint64_t>(phase)) {}
+    };
+    
+    /** Links addresses in memory through ConcurrentDisjointSets */
     struct AddressDisjointSets {
-        DisjointSets disjoinSets;
+        using Batch = DisjointSetsBatch;
+        
+        ConcurrentDisjointSets disjoinSets;
         std::unordered_map<DedupAddressType::Enum, uint32_t> addressStarts;
         
         AddressDisjointSets(uint32_t totalSize, std::unordered_map<DedupAddressType::Enum, uint32_t> addressStarts_) : disjoinSets{totalSize}, addressStarts{std::move(addressStarts_)} {}
         
+        AddressDisjointSets(const std::vector<uint32_t> &parents, std::unordered_map<DedupAddressType::Enum, uint32_t> addressStarts_) : disjoinSets{parents}, addressStarts{std::move(addressStarts_)} {}
+        
         uint32_t size() const {
             return disjoinSets.size();
         }
         
-        void link_addresses(const Address &address1, const Address &address2) {
-            auto firstAddressIndex = addressStarts.at(dedupType(address1.type)) + address1.scriptNum - 1;
-            auto secondAddressIndex = addressStarts.at(dedupType(address2.type)) + address2.scriptNum - 1;
-            disjoinSets.unite(firstAddressIndex, secondAddressIndex);
+        uint32_t addressIndex(const Address &address) const {
+            return addressStarts.at(dedupType(address.type)) + address.scriptNum - 1;
+        }
+        
+        ConcurrentDisjointSets &batchTarget() {
+            return disjoinSets;
         }
         
-        void resolveAll() {
-            segmentWork(0, disjoinSets.size(), 8, [&](uint32_t index) {
+        /** Link the addresses through a thread local batch instead of uniting them right away */
+        void link_addresses(Batch &batch, const Address &address1, const Address &address2) {
+            batch.add(addressIndex(address1), addressIndex(address2));
+        }
+        
+        void resolveAll(uint32_t threadCount) {
+            segmentWork(0, disjoinSets.size(), threadCount, [&](uint32_t index) {
                 disjoinSets.find(index);
             });
         }
@@ -130,140 +438,641 @@ namespace blocksci {
         uint32_t find(uint32_t index) {
             return disjoinSets.find(index);
         }
+        
+        void unite(uint32_t index1, uint32_t index2) {
+            disjoinSets.unite(index1, index2);
+        }
     };
     
-    template <typename ChangeFunc>
-    std::vector<std::pair<Address, Address>> processTransaction(const Transaction &tx, ChangeFunc && changeHeuristic,
-                                                                bool ignoreCoinJoin) {
-        std::vector<std::pair<Address, Address>> pairsToUnion;
+    /** Links addresses by writing the pairs to disk for ExternalComponents, which bounds the memory used for clustering */
+    struct ExternalAddressLinks {
+        using Batch = ExternalComponents::Writer;
         
-        if (!tx.isCoinbase() && (!ignoreCoinJoin || !heuristics::isCoinjoin(tx))) {
-            auto inputs = tx.inputs();
-            auto firstAddress = inputs[0].getAddress();
-            for (uint16_t i = 1; i < inputs.size(); i++) {
-                pairsToUnion.emplace_back(firstAddress, inputs[i].getAddress());
+        ExternalComponents components;
+        std::unordered_map<DedupAddressType::Enum, uint32_t> addressStarts;
+        
+        ExternalAddressLinks(uint32_t totalSize, std::unordered_map<DedupAddressType::Enum, uint32_t> addressStarts_, const filesystem::path &directory, uint64_t memoryBudget, uint32_t threadCount) : components{totalSize, directory, memoryBudget, threadCount}, addressStarts{std::move(addressStarts_)} {}
+        
+        uint32_t addressIndex(const Address &address) const {
+            return addressStarts.at(dedupType(address.type)) + address.scriptNum - 1;
+        }
+        
+        ExternalComponents &batchTarget() {
+            return components;
+        }
+        
+        void link_addresses(Batch &batch, const Address &address1, const Address &address2) {
+            batch.add(addressIndex(address1), addressIndex(address2));
+        }
+    };
+    
+    /** Append the change outputs of a heuristic that returns a range of outputs */
+    template <typename ChangeFunc>
+    void appendChange(const ChangeFunc &changeHeuristic, const Transaction &tx, std::vector<Output> &change) {
+        RANGES_FOR(auto output, changeHeuristic(tx)) {
+            change.push_back(output);
+        }
+    }
+    
+    /** Built-in heuristics append their change outputs directly */
+    template <heuristics::ChangeType::Enum type>
+    void appendChange(const heuristics::ChangeHeuristicImpl<type> &changeHeuristic, const Transaction &tx, std::vector<Output> &change) {
+        changeHeuristic.appendChange(tx, change);
+    }
+    
+    /** Whether the filters of the rules exclude the transaction from clustering */
+    bool skipTransaction(const Transaction &tx, const ClusteringRules &rules) {
+        if (tx.isCoinbase()) {
+            return true;
+        }
+        if (rules.skipCoinJoin && heuristics::isCoinjoin(tx)) {
+            return true;
+        }
+        if (rules.skipPossibleCoinJoin && heuristics::isPossibleCoinjoin(tx, rules.possibleCoinJoinMinBaseFee, rules.possibleCoinJoinPercentageFee, rules.possibleCoinJoinMaxDepth) == heuristics::CoinJoinResult::True) {
+            return true;
+        }
+        for (auto &filter : rules.skipFilters) {
+            if (filter(tx)) {
+                return true;
             }
-            
-            RANGES_FOR(auto change, std::forward<ChangeFunc>(changeHeuristic)(tx)) {
-                pairsToUnion.emplace_back(change.getAddress(), firstAddress);
+        }
+        return false;
+    }
+    
+    /** Version, whether a locktime is set and whether replace-by-fee is signaled, which differ between wallets */
+    uint64_t walletFingerprint(const Transaction &tx) {
+        bool signalsReplaceByFee = false;
+        RANGES_FOR(auto input, tx.inputs()) {
+            if (input.sequenceNumber() < 0xfffffffe) {
+                signalsReplaceByFee = true;
             }
         }
-        return pairsToUnion;
+        return (static_cast<uint64_t>(static_cast<uint32_t>(tx.getVersion())) << 2) | (tx.locktime() != 0 ? 2u : 0u) | (signalsReplaceByFee ? 1u : 0u);
     }
     
-    void linkScripthashNested(DataAccess &access, AddressDisjointSets &ds) {
-        auto scriptHashCount = access.getScripts().scriptCount(DedupAddressType::SCRIPTHASH);
-        
-        segmentWork(1, scriptHashCount + 1, 8, [&ds, &access](uint32_t index) {
-            Address pointer(index, AddressType::SCRIPTHASH, access);
-            script::ScriptHash scripthash{index, access};
-            auto wrappedAddress = scripthash.getWrappedAddress();
-            if (wrappedAddress) {
-                ds.link_addresses(pointer, *wrappedAddress);
+    /** The only output spent by a transaction with the fingerprint of tx, if there is exactly one */
+    ranges::optional<Output> fingerprintChange(const Transaction &tx) {
+        if (tx.outputCount() < 2) {
+            return ranges::nullopt;
+        }
+        auto fingerprint = walletFingerprint(tx);
+        ranges::optional<Output> change;
+        RANGES_FOR(auto output, tx.outputs()) {
+            auto spendingTx = output.getSpendingTx();
+            if (spendingTx && walletFingerprint(*spendingTx) == fingerprint) {
+                if (change) {
+                    return ranges::nullopt;
+                }
+                change = output;
             }
-        });
+        }
+        return change;
     }
     
-    template <typename ChangeFunc>
-    std::vector<uint32_t> createClusters(BlockRange &chain, std::unordered_map<DedupAddressType::Enum, uint32_t> addressStarts, uint32_t totalScriptCount, ChangeFunc && changeHeuristic, bool ignoreCoinJoin) {
-        
-        AddressDisjointSets ds(totalScriptCount, std::move(addressStarts));
+    /** Link a spent multisig address, directly or wrapped in scripthash, with the pubkeys of its signers */
+    template <typename Links>
+    void linkMultisigCosigners(const Input &input, Links &ds, typename Links::Batch &batch) {
+        auto address = input.getAddress();
+        if (dedupType(address.type) == DedupAddressType::SCRIPTHASH) {
+            auto wrappedAddress = script::ScriptHash{address.scriptNum, address.getAccess()}.getWrappedAddress();
+            if (!wrappedAddress) {
+                return;
+            }
+            address = *wrappedAddress;
+        }
+        if (address.type == AddressType::MULTISIG) {
+            script::Multisig multisig{address.scriptNum, address.getAccess()};
+            RANGES_FOR(auto pubkey, multisig.getAddresses()) {
+                ds.link_addresses(batch, address, pubkey);
+            }
+        }
+    }
+    
+    /** Add the pairs of addresses that the link rules find in the transaction to the batch
+     *
+     * All rules are applied here in one go, so that every transaction is only loaded once whatever rules are enabled.
+     * change is a scratch buffer reused across transactions, so that the hot loop doesn't allocate per transaction.
+     */
+    template <typename ChangeFunc, typename Links>
+    void processTransaction(const Transaction &tx, const ChangeFunc &changeHeuristic, const ClusteringRules &rules,
+                            Links &ds, typename Links::Batch &batch, std::vector<Output> &change) {
+        if (skipTransaction(tx, rules)) {
+            return;
+        }
+        auto inputs = tx.inputs();
+        auto firstAddress = inputs[0].getAddress();
+        if (rules.linkInputs) {
+            for (uint16_t i = 1; i < inputs.size(); i++) {
+                ds.link_addresses(batch, firstAddress, inputs[i].getAddress());
+            }
+        }
         
-        auto &access = chain.getAccess();
+        if (rules.linkChange) {
+            change.clear();
+            appendChange(changeHeuristic, tx, change);
+            for (auto &output : change) {
+                ds.link_addresses(batch, output.getAddress(), firstAddress);
+            }
+        }
         
-        linkScripthashNested(access, ds);
+        if (rules.linkFingerprintChange) {
+            auto output = fingerprintChange(tx);
+            if (output) {
+                ds.link_addresses(batch, output->getAddress(), firstAddress);
+            }
+        }
         
-        auto extract = [&](const BlockRange &blocks, int threadNum) {
-            auto progressThread = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+        if (rules.linkMultisigCosigners) {
+            RANGES_FOR(auto input, inputs) {
+                linkMultisigCosigners(input, ds, batch);
+            }
+        }
+    }
+    
+    /** Link every scripthash address in [beginScriptNum, endScriptNum) with the address it wraps */
+    template <typename Links>
+    void linkScripthashNested(DataAccess &access, Links &ds, uint32_t beginScriptNum, uint32_t endScriptNum, uint32_t threadCount) {
+        if (beginScriptNum >= endScriptNum) {
+            return;
+        }
+        ClusteringPhaseSpan span{ClusteringPhase::LinkScripthashNested};
+        runSegments(splitSegments(beginScriptNum, endScriptNum, threadCount), [&ds, &access](uint32_t, uint32_t segmentStart, uint32_t segmentEnd) {
+            typename Links::Batch batch{ds.batchTarget()};
+            for (uint32_t index = segmentStart; index < segmentEnd; index++) {
+                Address pointer(index, AddressType::SCRIPTHASH, access);
+                script::ScriptHash scripthash{index, access};
+                auto wrappedAddress = scripthash.getWrappedAddress();
+                if (wrappedAddress) {
+                    ds.link_addresses(batch, pointer, *wrappedAddress);
+                }
+            }
+        });
+    }
+    
+    /** Apply the clustering heuristics to all transactions in the blocks
+     *
+     * With linkSpentScripthash set, the scripthash addresses spent in the blocks are also linked with the address they
+     * wrap, which an incremental update needs for scripthash addresses created before but first spent in the blocks.
+     */
+    template <typename ChangeFunc, typename Links>
+    void linkBlocks(BlockRange &chain, Links &ds, const ChangeFunc &changeHeuristic, const ClusteringRules &rules, bool linkSpentScripthash, uint32_t threadCount) {
+        if (chain.size() == 0) {
+            return;
+        }
+        ClusteringPhaseSpan span{ClusteringPhase::LinkTransactions};
+        auto &access = chain.getAccess();
+        auto segments = chain.segment(threadCount);
+        auto segmentCount = static_cast<uint32_t>(segments.size());
+        segmentWork(0, segmentCount, segmentCount, [&](uint32_t segmentNum) {
+            const auto &blocks = segments[segmentNum];
+            blocks.checkReorg();
+            blocks.adviseAccess(AccessHint::WillNeed);
             auto progressBar = makeProgressBar(blocks.endTxIndex() - blocks.firstTxIndex(), [=]() {});
-            if (threadNum != progressThread) {
+            if (segmentNum != segmentCount - 1) {
                 progressBar.setSilent();
             }
+            typename Links::Batch batch{ds.batchTarget()};
+            std::vector<Output> change;
             uint32_t txNum = 0;
             for (auto block : blocks) {
                 for (auto tx : block) {
-                    auto pairs = processTransaction(tx, changeHeuristic, ignoreCoinJoin);
-                    for (auto &pair : pairs) {
-                        ds.link_addresses(pair.first, pair.second);
+                    processTransaction(tx, changeHeuristic, rules, ds, batch, change);
+                    if (linkSpentScripthash) {
+                        RANGES_FOR(auto input, tx.inputs()) {
+                            if (dedupType(input.getType()) == DedupAddressType::SCRIPTHASH) {
+                                auto scriptNum = input.getAddress().scriptNum;
+                                auto wrappedAddress = script::ScriptHash{scriptNum, access}.getWrappedAddress();
+                                if (wrappedAddress) {
+                                    ds.link_addresses(batch, Address(scriptNum, AddressType::SCRIPTHASH, access), *wrappedAddress);
+                                }
+                            }
+                        }
                     }
                     progressBar.update(txNum);
                     txNum++;
                 }
             }
-            return 0;
-        };
+        });
+    }
+    
+    /** Root of every address, the smallest address index of its cluster */
+    ScratchArray<uint32_t> resolveClusters(AddressDisjointSets &ds, uint32_t threadCount) {
+        ClusteringPhaseSpan span{ClusteringPhase::ResolveClusters};
+        ds.resolveAll(threadCount);
         
-        chain.mapReduce<int>(extract, [](int &a,int &) -> int & {return a;});
+        ScratchArray<uint32_t> parents(ds.size());
+        for (uint32_t i = 0; i < ds.size(); i++) {
+            parents[i] = ds.find(i);
+        }
+        return parents;
+    }
+    
+    template <typename ChangeFunc>
+    ScratchArray<uint32_t> createClusters(BlockRange &chain, std::unordered_map<DedupAddressType::Enum, uint32_t> addressStarts, uint32_t totalScriptCount, const ChangeFunc &changeHeuristic, const ClusteringRules &rules, uint32_t threadCount) {
+        
+        AddressDisjointSets ds(totalScriptCount, std::move(addressStarts));
         
-        ds.resolveAll();
+        auto &access = chain.getAccess();
         
-        std::vector<uint32_t> parents;
-        parents.reserve(ds.size());
-        for (uint32_t i = 0; i < totalScriptCount; i++) {
-            parents.push_back(ds.find(i));
+        if (rules.linkScripthashNested) {
+            linkScripthashNested(access, ds, 1, access.getScripts().scriptCount(DedupAddressType::SCRIPTHASH) + 1, threadCount);
         }
+        linkBlocks(chain, ds, changeHeuristic, rules, false, threadCount);
+        
+        return resolveClusters(ds, threadCount);
+    }
+    
+    /** Link with ExternalComponents and resolve the roots into a file backed array of the scratch space */
+    template <typename ChangeFunc>
+    ScratchArray<uint32_t> createClustersExternal(BlockRange &chain, std::unordered_map<DedupAddressType::Enum, uint32_t> addressStarts, uint32_t totalScriptCount, const ChangeFunc &changeHeuristic, const ClusteringRules &rules, const ExternalClusteringOptions &options, const ScratchSpace &scratch, uint32_t threadCount) {
+        
+        ExternalAddressLinks links(totalScriptCount, std::move(addressStarts), scratch.getDirectory()/"links", options.memoryBudget, threadCount);
+        
+        auto &access = chain.getAccess();
+        
+        if (rules.linkScripthashNested) {
+            linkScripthashNested(access, links, 1, access.getScripts().scriptCount(DedupAddressType::SCRIPTHASH) + 1, threadCount);
+        }
+        linkBlocks(chain, links, changeHeuristic, rules, false, threadCount);
+        
+        ClusteringPhaseSpan span{ClusteringPhase::ResolveClusters};
+        auto parents = scratch.allocate<uint32_t>(totalScriptCount);
+        links.components.resolve(parents.data(), threadCount);
         return parents;
     }
     
-    uint32_t remapClusterIds(std::vector<uint32_t> &parents) {
-        uint32_t placeholder = std::numeric_limits<uint32_t>::max();
-        std::vector<uint32_t> newClusterIds(parents.size(), placeholder);
-        uint32_t clusterCount = 0;
-        for (uint32_t &clusterNum : parents) {
-            uint32_t &clusterId = newClusterIds[clusterNum];
-            if (clusterId == placeholder) {
-                clusterId = clusterCount;
-                clusterCount++;
-            }
-            clusterNum = clusterId;
+    /** Start of the address indexes of every type, the types are laid out back to back in DedupAddressType order */
+    std::unordered_map<DedupAddressType::Enum, uint32_t> addressIndexStarts(const std::array<uint32_t, DedupAddressType::size> &scriptCounts) {
+        std::unordered_map<DedupAddressType::Enum, uint32_t> scriptStarts;
+        uint32_t start = 0;
+        for (size_t i = 0; i < DedupAddressType::size; i++) {
+            scriptStarts[static_cast<DedupAddressType::Enum>(i)] = start;
+            start += scriptCounts[i];
         }
+        return scriptStarts;
+    }
+    
+    /** Clustering state kept next to the cluster files so that later blocks can be added with updateClustering
+     *
+     * Files: - clusterState.dat: ClusterState
+     *        - clusterParents.dat: [<uint32_t rootOfAddressIndex0>, ...], laid out by the script counts in the state
+     */
+    struct ClusterState {
+        static constexpr uint64_t Magic = 0x4554415453434c42ULL; // "BLCSTATE"
         
-        return clusterCount;
+        uint64_t magic;
+        BlockHeight startHeight;
+        BlockHeight endHeight;
+        /** ClusteringRules::flags() of the rules used */
+        uint32_t ruleFlags;
+        std::array<uint32_t, DedupAddressType::size> scriptCounts;
+    };
+    
+    std::string clusterStateFilePath(const std::string &outputPath) {
+        return (filesystem::path{outputPath}/"clusterState.dat").str();
+    }
+    
+    std::string clusterParentsFilePath(const std::string &outputPath) {
+        return (filesystem::path{outputPath}/"clusterParents.dat").str();
     }
     
-    void recordOrderedAddresses(const std::vector<uint32_t> &parent, std::vector<uint32_t> &clusterPositions, const std::unordered_map<DedupAddressType::Enum, uint32_t> &scriptStarts, std::ofstream &clusterAddressesFile) {
+    /** Write the file to a temporary path and move it over the old one, readers that mapped the old file keep it */
+    void replaceFile(const std::string &path, const char *data, size_t size) {
+        auto tempPath = path + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            file.write(data, static_cast<std::streamsize>(size));
+            if (!file) {
+                throw std::runtime_error("Could not write cluster file " + tempPath);
+            }
+        }
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("Could not move cluster file into place at " + path);
+        }
+    }
+    
+    void writeClusterState(const std::string &outputPath, const ClusterState &state, const ScratchArray<uint32_t> &parents) {
+        ClusteringPhaseSpan span{ClusteringPhase::WriteClusterState};
+        // The state is written last, so it never describes parents of a different clustering
+        std::remove(clusterStateFilePath(outputPath).c_str());
+        replaceFile(clusterParentsFilePath(outputPath), reinterpret_cast<const char *>(parents.data()), sizeof(uint32_t) * parents.size());
+        replaceFile(clusterStateFilePath(outputPath), reinterpret_cast<const char *>(&state), sizeof(state));
+    }
+    
+    ClusterState readClusterState(const std::string &outputPath) {
+        std::ifstream file(clusterStateFilePath(outputPath), std::ios::binary);
+        ClusterState state{};
+        if (!file.read(reinterpret_cast<char *>(&state), sizeof(state)) || state.magic != ClusterState::Magic) {
+            throw std::runtime_error("No clustering state found in " + outputPath + ", recreate the clustering with createClustering to update it incrementally");
+        }
+        return state;
+    }
+    
+    /** Load the roots of the stored clustering, moved to the address index layout of the given script counts
+     *
+     * Addresses that were created after the stored clustering start out as clusters of their own. Moving the types into
+     * their new positions keeps the order of all old address indexes, so every root is still the smallest index of its
+     * cluster. */
+    std::vector<uint32_t> readClusterParents(const std::string &outputPath, const ClusterState &state, const std::array<uint32_t, DedupAddressType::size> &scriptCounts) {
+        auto oldStarts = addressIndexStarts(state.scriptCounts);
+        auto newStarts = addressIndexStarts(scriptCounts);
+        uint32_t oldTotal = 0;
+        uint32_t newTotal = 0;
+        for (size_t i = 0; i < DedupAddressType::size; i++) {
+            if (scriptCounts[i] < state.scriptCounts[i]) {
+                throw std::runtime_error("The chain has fewer addresses than the clustering in " + outputPath);
+            }
+            oldTotal += state.scriptCounts[i];
+            newTotal += scriptCounts[i];
+        }
         
-        std::map<uint32_t, DedupAddressType::Enum> typeIndexes;
-        for (auto &pair : scriptStarts) {
-            auto it = typeIndexes.find(pair.second);
-            if(it != typeIndexes.end()) {
-                // If an address type is not used, skip to the next one
-                it->second = std::max(it->second, pair.first);
-            } else {
-                typeIndexes[pair.second] = pair.first;
+        std::vector<uint32_t> oldParents(oldTotal);
+        {
+            std::ifstream file(clusterParentsFilePath(outputPath), std::ios::binary | std::ios::ate);
+            if (!file || static_cast<uint64_t>(file.tellg()) != sizeof(uint32_t) * uint64_t{oldTotal}) {
+                throw std::runtime_error("Clustering state in " + outputPath + " doesn't match its parents file");
             }
+            file.seekg(0);
+            file.read(reinterpret_cast<char *>(oldParents.data()), static_cast<std::streamsize>(sizeof(uint32_t) * oldParents.size()));
         }
         
-        std::vector<DedupAddress> orderedScripts;
-        orderedScripts.resize(parent.size());
+        // Shift of the address indexes of every type, looked up by the start of the type's old index range
+        std::map<uint32_t, uint32_t> shifts;
+        for (size_t i = 0; i < DedupAddressType::size; i++) {
+            auto type = static_cast<DedupAddressType::Enum>(i);
+            if (state.scriptCounts[i] > 0) {
+                shifts[oldStarts.at(type)] = newStarts.at(type) - oldStarts.at(type);
+            }
+        }
+        auto moveIndex = [&](uint32_t index) {
+            return index + std::prev(shifts.upper_bound(index))->second;
+        };
         
-        for (uint32_t i = 0; i < parent.size(); i++) {
-            uint32_t &j = clusterPositions[parent[i]];
-            auto it = typeIndexes.upper_bound(i);
+        std::vector<uint32_t> parents(newTotal);
+        std::iota(parents.begin(), parents.end(), 0u);
+        for (uint32_t i = 0; i < oldTotal; i++) {
+            parents[moveIndex(i)] = moveIndex(oldParents[i]);
+        }
+        return parents;
+    }
+    
+    /** Converts between address indexes and the addresses they stand for */
+    class AddressIndexLayout {
+        std::map<uint32_t, DedupAddressType::Enum> typeIndexes;
+        std::array<uint32_t, DedupAddressType::size> typeStarts{};
+        
+    public:
+        explicit AddressIndexLayout(const std::unordered_map<DedupAddressType::Enum, uint32_t> &scriptStarts) {
+            for (auto &pair : scriptStarts) {
+                typeStarts[static_cast<size_t>(pair.first)] = pair.second;
+                auto it = typeIndexes.find(pair.second);
+                if(it != typeIndexes.end()) {
+                    // If an address type is not used, skip to the next one
+                    it->second = std::max(it->second, pair.first);
+                } else {
+                    typeIndexes[pair.second] = pair.first;
+                }
+            }
+        }
+        
+        DedupAddress address(uint32_t index) const {
+            auto it = typeIndexes.upper_bound(index);
             it--;
-            uint32_t addressNum = i - it->first + 1;
-            auto addressType = it->second;
-            orderedScripts[j] = DedupAddress(addressNum, addressType);
-            j++;
+            return DedupAddress(index - it->first + 1, it->second);
+        }
+        
+        uint32_t index(const DedupAddress &address) const {
+            return typeStarts[static_cast<size_t>(address.type)] + address.scriptNum - 1;
         }
+    };
+    
+    /** Number of addresses in every cluster below clusterCount, addresses of later clusters are skipped
+     *
+     * Every thread counts into a small direct mapped cache of its own and only adds to the shared counters when an
+     * entry is evicted, so that the threads don't all contend on the counters of the largest clusters. */
+    ScratchArray<std::atomic<uint32_t>> countClusterSizes(const ScratchArray<uint32_t> &parent, uint32_t clusterCount, const std::vector<std::pair<uint32_t, uint32_t>> &segments, const ScratchSpace &scratch) {
+        auto clusterSizes = scratch.allocate<std::atomic<uint32_t>>(clusterCount);
+        runSegments(segments, [&](uint32_t, uint32_t segmentStart, uint32_t segmentEnd) {
+            constexpr uint32_t cacheSize = 1u << 12;
+            struct CachedCount {
+                uint32_t clusterNum;
+                uint32_t count;
+            };
+            std::vector<CachedCount> cache(cacheSize, CachedCount{0, 0});
+            for (uint32_t i = segmentStart; i < segmentEnd; i++) {
+                auto clusterNum = parent[i];
+                if (clusterNum >= clusterCount) {
+                    continue;
+                }
+                auto &entry = cache[clusterNum & (cacheSize - 1)];
+                if (entry.clusterNum != clusterNum) {
+                    if (entry.count > 0) {
+                        clusterSizes[entry.clusterNum].fetch_add(entry.count, std::memory_order_relaxed);
+                    }
+                    entry = CachedCount{clusterNum, 0};
+                }
+                entry.count++;
+            }
+            for (auto &entry : cache) {
+                if (entry.count > 0) {
+                    clusterSizes[entry.clusterNum].fetch_add(entry.count, std::memory_order_relaxed);
+                }
+            }
+        });
+        return clusterSizes;
+    }
+    
+    /** Cluster numbers of a clustering, the clusters of several addresses come first */
+    struct ClusterNumbering {
+        uint32_t clusterCount;
+        uint32_t multiAddressClusterCount;
+    };
+    
+    /** Number the clusters and replace every parent with the number of its cluster
+     *
+     * Roots are the elements that are their own parent. The disjoint sets link by index, so every root is the first
+     * address of its cluster. Clusters of several addresses are numbered in the order of their roots, then every
+     * remaining address gets the next number in the order of the address indexes, which is what lets the cluster
+     * files leave the latter out (see ClusterLayoutHeader). */
+    ClusterNumbering remapClusterIds(ScratchArray<uint32_t> &parents, const ScratchSpace &scratch, uint32_t threadCount) {
+        ClusteringPhaseSpan span{ClusteringPhase::RemapClusterIds};
+        auto addressCount = static_cast<uint32_t>(parents.size());
+        auto segments = splitSegments(0, addressCount, threadCount);
+        auto rootSizes = countClusterSizes(parents, addressCount, segments, scratch);
+        std::vector<uint32_t> segmentFirstIds(segments.size() + 1, 0);
+        std::vector<uint32_t> segmentFirstSingletons(segments.size() + 1, 0);
+        runSegments(segments, [&](uint32_t segmentNum, uint32_t segmentStart, uint32_t segmentEnd) {
+            uint32_t rootCount = 0;
+            uint32_t singletonCount = 0;
+            for (uint32_t i = segmentStart; i < segmentEnd; i++) {
+                if (parents[i] == i) {
+                    if (rootSizes[i].load(std::memory_order_relaxed) > 1) {
+                        rootCount++;
+                    } else {
+                        singletonCount++;
+                    }
+                }
+            }
+            segmentFirstIds[segmentNum + 1] = rootCount;
+            segmentFirstSingletons[segmentNum + 1] = singletonCount;
+        });
+        std::partial_sum(segmentFirstIds.begin(), segmentFirstIds.end(), segmentFirstIds.begin());
+        std::partial_sum(segmentFirstSingletons.begin(), segmentFirstSingletons.end(), segmentFirstSingletons.begin());
+        auto multiAddressClusterCount = segmentFirstIds.back();
         
-        clusterAddressesFile.write(reinterpret_cast<char *>(orderedScripts.data()), static_cast<long>(sizeof(DedupAddress) * orderedScripts.size()));
+        auto newClusterIds = scratch.allocate<uint32_t>(parents.size());
+        runSegments(segments, [&](uint32_t segmentNum, uint32_t segmentStart, uint32_t segmentEnd) {
+            uint32_t clusterId = segmentFirstIds[segmentNum];
+            uint32_t singletonId = multiAddressClusterCount + segmentFirstSingletons[segmentNum];
+            for (uint32_t i = segmentStart; i < segmentEnd; i++) {
+                if (parents[i] == i) {
+                    newClusterIds[i] = rootSizes[i].load(std::memory_order_relaxed) > 1 ? clusterId++ : singletonId++;
+                }
+            }
+        });
+        rootSizes = ScratchArray<std::atomic<uint32_t>>{};
+        runSegments(segments, [&](uint32_t, uint32_t segmentStart, uint32_t segmentEnd) {
+            for (uint32_t i = segmentStart; i < segmentEnd; i++) {
+                parents[i] = newClusterIds[parents[i]];
+            }
+        });
+        return {multiAddressClusterCount + segmentFirstSingletons.back(), multiAddressClusterCount};
     }
     
-    void prepareClusterDataLocation(const std::string &outputPath, bool overwrite) {
-        auto outputLocation = filesystem::path{outputPath};
+    /** Write the addresses of every cluster below clusterCount next to each other into clusterAddresses, ordered by
+     * address index within a cluster, and return the end offset of every cluster followed by the total address count
+     *
+     * Addresses of the later clusters, which hold a single address, are left out.
+     *
+     * This is a parallel counting sort with every thread scattering the addresses of its own segment of the address
+     * indexes. Histograms per thread would take clusterCount counters per thread, so instead the positions of small
+     * clusters are claimed from shared atomic cursors and their addresses are sorted afterwards, while clusters too
+     * large for that to be cheap get a range of positions per thread, which keeps them in order. */
+    ScratchArray<uint32_t> scatterClusterAddresses(const ScratchArray<uint32_t> &parent, uint32_t clusterCount, const AddressIndexLayout &layout, DedupAddress *clusterAddresses, const ScratchSpace &scratch, uint32_t threadCount) {
+        auto addressCount = static_cast<uint32_t>(parent.size());
+        auto addressSegments = splitSegments(0, addressCount, threadCount);
+        auto clusterSegments = splitSegments(0, clusterCount, threadCount);
+        auto cursors = countClusterSizes(parent, clusterCount, addressSegments, scratch);
         
-        std::string offsetFile = ClusterAccess::offsetFilePath(outputPath);
-        std::string addressesFile = ClusterAccess::addressesFilePath(outputPath);
-        std::vector<std::string> clusterIndexPaths;
-        clusterIndexPaths.resize(DedupAddressType::size);
-        for (auto dedupType : DedupAddressType::allArray()) {
-            clusterIndexPaths[static_cast<size_t>(dedupType)] = ClusterAccess::typeIndexFilePath(outputPath, dedupType);
+        uint32_t largeClusterSize = std::max(1u << 16, addressCount / (threadCount * 64));
+        auto clusterEnds = scratch.allocate<uint32_t>(clusterCount + 1);
+        
+        // Prefix sum over the cluster sizes, which turns the counters into the cursors of the cluster starts
+        std::vector<uint32_t> segmentStarts(clusterSegments.size() + 1, 0);
+        std::vector<std::vector<uint32_t>> segmentLargeClusters(clusterSegments.size());
+        runSegments(clusterSegments, [&](uint32_t segmentNum, uint32_t segmentStart, uint32_t segmentEnd) {
+            uint32_t total = 0;
+            for (uint32_t i = segmentStart; i < segmentEnd; i++) {
+                auto size = cursors[i].load(std::memory_order_relaxed);
+                total += size;
+                if (size >= largeClusterSize) {
+                    segmentLargeClusters[segmentNum].push_back(i);
+                }
+            }
+            segmentStarts[segmentNum + 1] = total;
+        });
+        std::partial_sum(segmentStarts.begin(), segmentStarts.end(), segmentStarts.begin());
+        clusterEnds[clusterCount] = segmentStarts.back();
+        runSegments(clusterSegments, [&](uint32_t segmentNum, uint32_t segmentStart, uint32_t segmentEnd) {
+            uint32_t position = segmentStarts[segmentNum];
+            for (uint32_t i = segmentStart; i < segmentEnd; i++) {
+                auto size = cursors[i].load(std::memory_order_relaxed);
+                cursors[i].store(position, std::memory_order_relaxed);
+                position += size;
+                clusterEnds[i] = position;
+            }
+        });
+        auto clusterStart = [&](uint32_t clusterNum) {
+            return clusterNum == 0 ? 0 : clusterEnds[clusterNum - 1];
+        };
+        auto isLarge = [&](uint32_t clusterNum) {
+            return clusterEnds[clusterNum] - clusterStart(clusterNum) >= largeClusterSize;
+        };
+        
+        std::unordered_map<uint32_t, uint32_t> largeClusterIndexes;
+        for (auto &largeClusters : segmentLargeClusters) {
+            for (auto clusterNum : largeClusters) {
+                largeClusterIndexes.emplace(clusterNum, static_cast<uint32_t>(largeClusterIndexes.size()));
+            }
         }
+        auto largeClusterCount = largeClusterIndexes.size();
         
-        std::vector<std::string> allPaths = clusterIndexPaths;
-        allPaths.push_back(offsetFile);
-        allPaths.push_back(addressesFile);
+        // Every thread gets the positions of its addresses in a large cluster right after those of the threads before it
+        std::vector<std::vector<uint32_t>> largePositions(addressSegments.size(), std::vector<uint32_t>(largeClusterCount, 0));
+        if (largeClusterCount > 0) {
+            runSegments(addressSegments, [&](uint32_t segmentNum, uint32_t segmentStart, uint32_t segmentEnd) {
+                auto &counts = largePositions[segmentNum];
+                for (uint32_t i = segmentStart; i < segmentEnd; i++) {
+                    if (parent[i] < clusterCount && isLarge(parent[i])) {
+                        counts[largeClusterIndexes.at(parent[i])]++;
+                    }
+                }
+            });
+            for (auto &pair : largeClusterIndexes) {
+                uint32_t position = clusterStart(pair.first);
+                for (auto &positions : largePositions) {
+                    auto count = positions[pair.second];
+                    positions[pair.second] = position;
+                    position += count;
+                }
+            }
+        }
+        
+        runSegments(addressSegments, [&](uint32_t segmentNum, uint32_t segmentStart, uint32_t segmentEnd) {
+            auto &positions = largePositions[segmentNum];
+            for (uint32_t i = segmentStart; i < segmentEnd; i++) {
+                auto clusterNum = parent[i];
+                if (clusterNum >= clusterCount) {
+                    continue;
+                }
+                uint32_t position;
+                if (isLarge(clusterNum)) {
+                    position = positions[largeClusterIndexes.at(clusterNum)]++;
+                } else {
+                    position = cursors[clusterNum].fetch_add(1, std::memory_order_relaxed);
+                }
+                clusterAddresses[position] = layout.address(i);
+            }
+        });
+        cursors = ScratchArray<std::atomic<uint32_t>>{};
+        
+        // Threads claimed the positions in small clusters in arbitrary order
+        auto byIndex = [&](const DedupAddress &a, const DedupAddress &b) {
+            return layout.index(a) < layout.index(b);
+        };
+        runSegments(clusterSegments, [&](uint32_t, uint32_t segmentStart, uint32_t segmentEnd) {
+            for (uint32_t i = segmentStart; i < segmentEnd; i++) {
+                if (!isLarge(i)) {
+                    auto begin = clusterAddresses + clusterStart(i);
+                    auto end = clusterAddresses + clusterEnds[i];
+                    if (!std::is_sorted(begin, end, byIndex)) {
+                        std::sort(begin, end, byIndex);
+                    }
+                }
+            }
+        });
+        return clusterEnds;
+    }
+    
+    /** All files a clustering in outputPath consists of */
+    std::vector<std::string> clusterDataPaths(const std::string &outputPath) {
+        std::vector<std::string> allPaths;
+        for (auto dedupType : DedupAddressType::allArray()) {
+            allPaths.push_back(ClusterAccess::typeIndexFilePath(outputPath, dedupType));
+        }
+        allPaths.push_back(ClusterAccess::offsetFilePath(outputPath));
+        allPaths.push_back(ClusterAccess::addressesFilePath(outputPath));
+        allPaths.push_back(clusterStateFilePath(outputPath));
+        allPaths.push_back(clusterParentsFilePath(outputPath));
+        allPaths.push_back(ClusterAccess::statsFilePath(outputPath));
+        allPaths.push_back(ClusterLayoutHeader::filePath(outputPath));
+        allPaths.push_back(ClusterAccess::packedAddressesFilePath(outputPath));
+        return allPaths;
+    }
+    
+    void prepareClusterDataLocation(const std::string &outputPath, bool overwrite) {
+        auto outputLocation = filesystem::path{outputPath};
+        auto allPaths = clusterDataPaths(outputPath);
         
         // Prepare cluster folder or fail
         auto outputLocationPath = filesystem::path{outputLocation};
@@ -297,81 +1106,647 @@ namespace blocksci {
         }
     }
     
-    void serializeClusterData(const ScriptAccess &scripts, const std::string &outputPath, const std::vector<uint32_t> &parent, const std::unordered_map<DedupAddressType::Enum, uint32_t> &scriptStarts, uint32_t clusterCount) {
+    /** Write the cluster files and return the end offset of every cluster of several addresses followed by their total
+     * address count */
+    ScratchArray<uint32_t> serializeClusterData(const ScriptAccess &scripts, const std::string &outputPath, const ScratchArray<uint32_t> &parent, const std::unordered_map<DedupAddressType::Enum, uint32_t> &scriptStarts, const ClusterNumbering &numbering, const ScratchSpace &scratch, uint32_t threadCount) {
+        ClusteringPhaseSpan span{ClusteringPhase::SerializeClusterData};
         auto outputLocation = filesystem::path{outputPath};
+        
+        // Statistics of the previous clustering must not be read along with the new one if writing the new ones fails
+        filesystem::path statsFile{ClusterAccess::statsFilePath(outputPath)};
+        if (statsFile.exists()) {
+            statsFile.remove_file();
+        }
         std::string offsetFile = ClusterAccess::offsetFilePath(outputPath);
         std::string addressesFile = ClusterAccess::addressesFilePath(outputPath);
+        std::string layoutFile = ClusterLayoutHeader::filePath(outputPath);
+        // An update repacks the large clusters if the previous clustering had a packed copy of them
+        std::string packedFile = ClusterAccess::packedAddressesFilePath(outputPath);
+        auto packedHeader = PackedClusterAddressesHeader::read(packedFile);
         std::vector<std::string> clusterIndexPaths;
         clusterIndexPaths.resize(DedupAddressType::size);
         for (auto dedupType : DedupAddressType::allArray()) {
             clusterIndexPaths[static_cast<size_t>(dedupType)] = ClusterAccess::typeIndexFilePath(outputPath, dedupType);
         }
 
-        // Generate cluster files        
-        std::vector<uint32_t> clusterPositions;
-        clusterPositions.resize(clusterCount + 1);
-        for (auto parentId : parent) {
-            clusterPositions[parentId + 1]++;
+        // Every file is written next to the current one and moved into place once all are complete, so that an update
+        // doesn't truncate files that open ClusterManagers have mapped
+        auto tempPath = [](const std::string &path) { return path + ".tmp"; };
+        ClusterLayoutHeader layout{};
+        layout.magic = ClusterLayoutHeader::Magic;
+        layout.clusterCount = numbering.clusterCount;
+        layout.multiAddressClusterCount = numbering.multiAddressClusterCount;
+        auto writeIndexes = std::async(std::launch::async, [&]() {
+            segmentWork(0, DedupAddressType::size, DedupAddressType::size, [&](uint32_t index) {
+                auto type = static_cast<DedupAddressType::Enum>(index);
+                uint32_t startIndex = scriptStarts.at(type);
+                uint32_t totalCount = scripts.scriptCount(type);
+                std::ofstream file{tempPath(clusterIndexPaths[index]), std::ios::binary};
+                file.write(reinterpret_cast<const char *>(parent.data() + startIndex), sizeof(uint32_t) * totalCount);
+                layout.singletonCounts[index] = static_cast<uint32_t>(std::count_if(parent.data() + startIndex, parent.data() + startIndex + totalCount, [&](uint32_t clusterNum) {
+                    return clusterNum >= numbering.multiAddressClusterCount;
+                }));
+            });
+        });
+        
+        // The addresses are scattered straight into the mapped file instead of being collected in memory first
+        filesystem::path addressesBuildPath = outputLocation/"clusterAddressesBuild";
+        std::string addressesBuildFile = addressesBuildPath.str() + ".dat";
+        std::ofstream{addressesBuildFile, std::ios::binary | std::ios::trunc};
+        ScratchArray<uint32_t> clusterEnds;
+        {
+            FixedSizeFileMapper<DedupAddress, mio::access_mode::write> clusterAddressesFile{addressesBuildPath};
+            auto listedAddressCount = parent.size() - (numbering.clusterCount - numbering.multiAddressClusterCount);
+            clusterAddressesFile.truncate(listedAddressCount);
+            DedupAddress *clusterAddresses = listedAddressCount == 0 ? nullptr : clusterAddressesFile[0];
+            clusterEnds = scatterClusterAddresses(parent, numbering.multiAddressClusterCount, AddressIndexLayout{scriptStarts}, clusterAddresses, scratch, threadCount);
+            if (packedHeader) {
+                writePackedClusterAddresses(tempPath(packedFile), clusterAddresses, clusterEnds.data(), numbering.multiAddressClusterCount, packedHeader->minClusterSize, threadCount);
+            }
+        }
+        
+        writeIndexes.get();
+        
+        // The single address clusters are numbered in the order of the address indexes, so those of a type follow the
+        // ones of every type that starts before it
+        for (auto &pair : scriptStarts) {
+            uint32_t start = numbering.multiAddressClusterCount;
+            for (auto &other : scriptStarts) {
+                if (other.second < pair.second) {
+                    start += layout.singletonCounts[static_cast<size_t>(other.first)];
+                }
+            }
+            layout.singletonStarts[static_cast<size_t>(pair.first)] = start;
+        }
+        {
+            std::ofstream file(tempPath(layoutFile), std::ios::binary);
+            file.write(reinterpret_cast<const char *>(&layout), sizeof(layout));
         }
         
-        for (size_t i = 1; i < clusterPositions.size(); i++) {
-            clusterPositions[i] += clusterPositions[i-1];
+        {
+            std::ofstream clusterOffsetFile(tempPath(offsetFile), std::ios::binary);
+            clusterOffsetFile.write(reinterpret_cast<const char *>(clusterEnds.data()), static_cast<long>(sizeof(uint32_t) * clusterEnds.size()));
         }
-        std::ofstream clusterAddressesFile(addressesFile, std::ios::binary);
-        auto recordOrdered = std::async(std::launch::async, recordOrderedAddresses, parent, std::ref(clusterPositions), scriptStarts, std::ref(clusterAddressesFile));
         
-        segmentWork(0, DedupAddressType::size, DedupAddressType::size, [&](uint32_t index) {
-            auto type = static_cast<DedupAddressType::Enum>(index);
-            uint32_t startIndex = scriptStarts.at(type);
-            uint32_t totalCount = scripts.scriptCount(type);
-            std::ofstream file{clusterIndexPaths[index], std::ios::binary};
-            file.write(reinterpret_cast<const char *>(parent.data() + startIndex), sizeof(uint32_t) * totalCount);
+        if (std::rename(addressesBuildFile.c_str(), addressesFile.c_str()) != 0) {
+            throw std::runtime_error("Could not move cluster file into place at " + addressesFile);
+        }
+        std::vector<std::string> allPaths = clusterIndexPaths;
+        allPaths.push_back(offsetFile);
+        allPaths.push_back(layoutFile);
+        if (packedHeader) {
+            allPaths.push_back(packedFile);
+        }
+        for (auto &path : allPaths) {
+            if (std::rename(tempPath(path).c_str(), path.c_str()) != 0) {
+                throw std::runtime_error("Could not move cluster file into place at " + path);
+            }
+        }
+        return clusterEnds;
+    }
+    
+    template <typename T, typename Func>
+    void writeStatColumn(std::ofstream &file, uint32_t clusterCount, Func value) {
+        std::vector<T> buffer;
+        buffer.reserve(1u << 16);
+        for (uint32_t i = 0; i < clusterCount; i++) {
+            buffer.push_back(value(i));
+            if (buffer.size() == buffer.capacity() || i + 1 == clusterCount) {
+                file.write(reinterpret_cast<const char *>(buffer.data()), static_cast<long>(sizeof(T) * buffer.size()));
+                buffer.clear();
+            }
+        }
+    }
+    
+    /** Aggregate the ClusterStats of every cluster over the transactions of the clustered blocks and write cluster_stats.dat
+     *
+     * The clusters of the outputs and inputs of every transaction are looked up through the address indexes, so this is
+     * a single parallel scan over the blocks that doesn't touch the address index databases. */
+    void writeClusterStats(BlockRange &chain, const std::string &outputPath, const ScratchArray<uint32_t> &parent, const std::unordered_map<DedupAddressType::Enum, uint32_t> &scriptStarts, const ClusterNumbering &numbering, const ScratchArray<uint32_t> &clusterEnds, const ScratchSpace &scratch, uint32_t threadCount) {
+        ClusteringPhaseSpan span{ClusteringPhase::WriteClusterStats};
+        auto clusterCount = numbering.clusterCount;
+        auto totalReceived = scratch.allocate<std::atomic<int64_t>>(clusterCount);
+        auto balance = scratch.allocate<std::atomic<int64_t>>(clusterCount);
+        auto txCount = scratch.allocate<std::atomic<uint32_t>>(clusterCount);
+        auto firstHeight = scratch.allocate<std::atomic<BlockHeight>>(clusterCount);
+        auto lastHeight = scratch.allocate<std::atomic<BlockHeight>>(clusterCount);
+        segmentWork(0, clusterCount, threadCount, [&](uint32_t clusterNum) {
+            firstHeight[clusterNum].store(std::numeric_limits<BlockHeight>::max(), std::memory_order_relaxed);
+            lastHeight[clusterNum].store(-1, std::memory_order_relaxed);
         });
         
-        recordOrdered.get();
+        if (chain.size() > 0) {
+            AddressIndexLayout layout{scriptStarts};
+            auto clusterNumOf = [&](const Address &address) {
+                return parent[layout.index(DedupAddress{address.scriptNum, dedupType(address.type)})];
+            };
+            // Outputs spent after the end of the clustering still count towards the balance
+            auto endTxIndex = chain.endTxIndex();
+            auto segments = chain.segment(threadCount);
+            auto segmentCount = static_cast<uint32_t>(segments.size());
+            segmentWork(0, segmentCount, segmentCount, [&](uint32_t segmentNum) {
+                std::vector<uint32_t> txClusters;
+                for (auto block : segments[segmentNum]) {
+                    auto height = block.height();
+                    for (auto tx : block) {
+                        txClusters.clear();
+                        RANGES_FOR(auto output, tx.outputs()) {
+                            auto clusterNum = clusterNumOf(output.getAddress());
+                            auto value = output.getValue();
+                            totalReceived[clusterNum].fetch_add(value, std::memory_order_relaxed);
+                            auto spendingTx = output.getSpendingTxIndex();
+                            if (!spendingTx || *spendingTx >= endTxIndex) {
+                                balance[clusterNum].fetch_add(value, std::memory_order_relaxed);
+                            }
+                            txClusters.push_back(clusterNum);
+                        }
+                        RANGES_FOR(auto input, tx.inputs()) {
+                            txClusters.push_back(clusterNumOf(input.getAddress()));
+                        }
+                        std::sort(txClusters.begin(), txClusters.end());
+                        txClusters.erase(std::unique(txClusters.begin(), txClusters.end()), txClusters.end());
+                        for (auto clusterNum : txClusters) {
+                            txCount[clusterNum].fetch_add(1, std::memory_order_relaxed);
+                            atomicMin(firstHeight[clusterNum], height);
+                            atomicMax(lastHeight[clusterNum], height);
+                        }
+                    }
+                }
+            });
+        }
+        
+        auto path = ClusterAccess::statsFilePath(outputPath);
+        auto tempPath = path + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            ClusterStatsHeader header{ClusterStatsHeader::Magic, clusterCount};
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            writeStatColumn<int64_t>(file, clusterCount, [&](uint32_t i) { return totalReceived[i].load(std::memory_order_relaxed); });
+            writeStatColumn<int64_t>(file, clusterCount, [&](uint32_t i) { return balance[i].load(std::memory_order_relaxed); });
+            writeStatColumn<uint32_t>(file, clusterCount, [&](uint32_t i) {
+                return i < numbering.multiAddressClusterCount ? clusterEnds[i] - (i == 0 ? 0 : clusterEnds[i - 1]) : 1;
+            });
+            writeStatColumn<uint32_t>(file, clusterCount, [&](uint32_t i) { return txCount[i].load(std::memory_order_relaxed); });
+            writeStatColumn<BlockHeight>(file, clusterCount, [&](uint32_t i) {
+                auto height = firstHeight[i].load(std::memory_order_relaxed);
+                return height == std::numeric_limits<BlockHeight>::max() ? -1 : height;
+            });
+            writeStatColumn<BlockHeight>(file, clusterCount, [&](uint32_t i) { return lastHeight[i].load(std::memory_order_relaxed); });
+            if (!file) {
+                throw std::runtime_error("Could not write cluster statistics to " + tempPath);
+            }
+        }
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("Could not move cluster statistics into place at " + path);
+        }
+    }
+    
+    /** Set in the ClusterState::ruleFlags of refined clusterings, which updateClustering can't extend */
+    constexpr uint32_t refinedClusteringFlag = 1u << 31;
+    
+    /** Clustering kept in memory across the rounds of ClusterManager::refineClustering
+     *
+     * Besides the union-find, every cluster keeps its addresses in a ring (members[index] is the next address of its
+     * cluster) and its root the number of its addresses, both updated as clusters are united. The transactions the
+     * refinement applies to are listed per address, so the transactions touching a cluster that grew are found by
+     * walking its ring. dirtyBits marks the transactions queued for the next round by their offset from firstTxNum.
+     */
+    class ClusterRefiner : public ClusterLookup {
+        AddressDisjointSets &ds;
+        DataAccess &access;
+        uint32_t threadCount;
+        uint32_t firstTxNum;
+        ScratchArray<uint32_t> members;
+        ScratchArray<uint32_t> sizes;
+        ScratchArray<uint64_t> txOffsets;
+        ScratchArray<uint32_t> addressTxes;
+        ScratchArray<std::atomic<uint64_t>> dirtyBits;
+        std::vector<uint32_t> dirtyTxes;
+        
+        void buildMembers() {
+            ds.resolveAll(threadCount);
+            // Roots are the smallest index of their cluster, so they start their ring before any member joins it
+            for (uint32_t index = 0; index < ds.size(); index++) {
+                auto root = ds.find(index);
+                sizes[root]++;
+                if (root == index) {
+                    members[index] = index;
+                } else {
+                    members[index] = members[root];
+                    members[root] = index;
+                }
+            }
+        }
+        
+        /** List the transactions of every address among the ones the rules don't skip, all of which are dirty */
+        void buildAddressTxes(BlockRange &chain, const ClusteringRules &rules) {
+            auto segments = chain.segment(threadCount);
+            auto segmentCount = static_cast<uint32_t>(segments.size());
+            std::vector<std::vector<std::pair<uint32_t, uint32_t>>> segmentPairs(segmentCount);
+            std::vector<std::vector<uint32_t>> segmentTxes(segmentCount);
+            ScratchArray<std::atomic<uint32_t>> counts(ds.size());
+            segmentWork(0, segmentCount, segmentCount, [&](uint32_t segmentNum) {
+                auto &pairs = segmentPairs[segmentNum];
+                std::vector<uint32_t> txAddresses;
+                for (auto block : segments[segmentNum]) {
+                    for (auto tx : block) {
+                        if (skipTransaction(tx, rules)) {
+                            continue;
+                        }
+                        txAddresses.clear();
+                        RANGES_FOR(auto input, tx.inputs()) {
+                            txAddresses.push_back(ds.addressIndex(input.getAddress()));
+                        }
+                        RANGES_FOR(auto output, tx.outputs()) {
+                            txAddresses.push_back(ds.addressIndex(output.getAddress()));
+                        }
+                        std::sort(txAddresses.begin(), txAddresses.end());
+                        txAddresses.erase(std::unique(txAddresses.begin(), txAddresses.end()), txAddresses.end());
+                        for (auto index : txAddresses) {
+                            pairs.emplace_back(index, tx.txNum);
+                            counts[index].fetch_add(1, std::memory_order_relaxed);
+                        }
+                        segmentTxes[segmentNum].push_back(tx.txNum);
+                    }
+                }
+            });
+            
+            uint64_t offset = 0;
+            for (uint32_t index = 0; index < ds.size(); index++) {
+                txOffsets[index] = offset;
+                offset += counts[index].load(std::memory_order_relaxed);
+                counts[index].store(0, std::memory_order_relaxed);
+            }
+            txOffsets[ds.size()] = offset;
+            addressTxes = ScratchArray<uint32_t>(offset);
+            segmentWork(0, segmentCount, segmentCount, [&](uint32_t segmentNum) {
+                for (auto &pair : segmentPairs[segmentNum]) {
+                    addressTxes[txOffsets[pair.first] + counts[pair.first].fetch_add(1, std::memory_order_relaxed)] = pair.second;
+                }
+                std::vector<std::pair<uint32_t, uint32_t>>{}.swap(segmentPairs[segmentNum]);
+            });
+            
+            // The segments are in txNum order, so the first round runs through the chain sequentially
+            for (auto &txes : segmentTxes) {
+                dirtyTxes.insert(dirtyTxes.end(), txes.begin(), txes.end());
+            }
+        }
+        
+        /** Queue the transactions of all addresses in the clusters of the given roots for the next round */
+        void markGrownClusters(std::vector<uint32_t> &roots) {
+            for (auto &root : roots) {
+                root = ds.find(root);
+            }
+            std::sort(roots.begin(), roots.end());
+            roots.erase(std::unique(roots.begin(), roots.end()), roots.end());
+            std::vector<uint32_t> grownAddresses;
+            for (auto root : roots) {
+                auto index = root;
+                do {
+                    grownAddresses.push_back(index);
+                    index = members[index];
+                } while (index != root);
+            }
+            
+            auto segments = splitSegments(0, static_cast<uint32_t>(grownAddresses.size()), threadCount);
+            std::vector<std::vector<uint32_t>> segmentTxes(segments.size());
+            runSegments(segments, [&](uint32_t segmentNum, uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; i++) {
+                    auto index = grownAddresses[i];
+                    for (auto offset = txOffsets[index]; offset < txOffsets[index + 1]; offset++) {
+                        auto txNum = addressTxes[offset];
+                        auto bit = txNum - firstTxNum;
+                        auto mask = uint64_t{1} << (bit % 64);
+                        if ((dirtyBits[bit / 64].fetch_or(mask, std::memory_order_relaxed) & mask) == 0) {
+                            segmentTxes[segmentNum].push_back(txNum);
+                        }
+                    }
+                }
+            });
+            dirtyTxes.clear();
+            for (auto &txes : segmentTxes) {
+                dirtyTxes.insert(dirtyTxes.end(), txes.begin(), txes.end());
+            }
+            std::sort(dirtyTxes.begin(), dirtyTxes.end());
+        }
+        
+    public:
+        ClusterRefiner(AddressDisjointSets &ds_, BlockRange &chain, const ClusteringRules &rules, uint32_t threadCount_) : ds(ds_), access(chain.getAccess()), threadCount(threadCount_), firstTxNum(chain.firstTxIndex()), members(ds_.size()), sizes(ds_.size()), txOffsets(size_t{ds_.size()} + 1), dirtyBits((size_t{chain.endTxIndex() - chain.firstTxIndex()} + 63) / 64) {
+            buildMembers();
+            buildAddressTxes(chain, rules);
+        }
+        
+        uint32_t clusterOf(const Address &address) const override {
+            return ds.find(ds.addressIndex(address));
+        }
+        
+        uint32_t clusterSize(const Address &address) const override {
+            return sizes[clusterOf(address)];
+        }
+        
+        /** Apply the rule to the dirty transactions and unite the clusters it links, returns the number of unions */
+        uint64_t runRound(const ClusterChangeRule &refinement) {
+            // The rule only sees the clusters of the previous round, the links are applied once all transactions ran
+            auto segments = splitSegments(0, static_cast<uint32_t>(dirtyTxes.size()), threadCount);
+            std::vector<std::vector<std::pair<uint32_t, uint32_t>>> segmentLinks(segments.size());
+            runSegments(segments, [&](uint32_t segmentNum, uint32_t begin, uint32_t end) {
+                std::vector<Output> change;
+                for (uint32_t i = begin; i < end; i++) {
+                    auto txNum = dirtyTxes[i];
+                    dirtyBits[(txNum - firstTxNum) / 64].fetch_and(~(uint64_t{1} << ((txNum - firstTxNum) % 64)), std::memory_order_relaxed);
+                    Transaction tx{txNum, access};
+                    change.clear();
+                    refinement(tx, *this, change);
+                    if (change.empty()) {
+                        continue;
+                    }
+                    auto firstAddress = ds.addressIndex(tx.inputs()[0].getAddress());
+                    for (auto &output : change) {
+                        segmentLinks[segmentNum].emplace_back(ds.addressIndex(output.getAddress()), firstAddress);
+                    }
+                }
+            });
+            
+            uint64_t unionCount = 0;
+            std::vector<uint32_t> grownRoots;
+            for (auto &links : segmentLinks) {
+                for (auto &link : links) {
+                    auto root1 = ds.find(link.first);
+                    auto root2 = ds.find(link.second);
+                    if (root1 == root2) {
+                        continue;
+                    }
+                    ds.unite(root1, root2);
+                    auto root = std::min(root1, root2);
+                    sizes[root] = sizes[root1] + sizes[root2];
+                    // Swapping the successors of one address of each ring joins the rings
+                    std::swap(members[root1], members[root2]);
+                    grownRoots.push_back(root);
+                    unionCount++;
+                }
+            }
+            if (unionCount == 0) {
+                dirtyTxes.clear();
+            } else {
+                markGrownClusters(grownRoots);
+            }
+            return unionCount;
+        }
+        
+        size_t dirtyCount() const {
+            return dirtyTxes.size();
+        }
+    };
+    
+    template <typename ChangeFunc>
+    ClusterManager refineClusteringImpl(BlockRange &chain, const ChangeFunc &changeHeuristic, const ClusteringRules &rules, const ClusterChangeRule &refinement, const std::string &outputPath, const RefinementOptions &options, bool overwrite, uint32_t threadCount) {
+        prepareClusterDataLocation(outputPath, overwrite);
+        
+        auto &access = chain.getAccess();
+        auto &scripts = access.getScripts();
+        auto scriptCounts = scripts.scriptCounts();
+        auto scriptStarts = addressIndexStarts(scriptCounts);
+        threadCount = resolveThreadCount(threadCount);
+        
+        AddressDisjointSets ds(static_cast<uint32_t>(scripts.totalAddressCount()), scriptStarts);
+        if (rules.linkScripthashNested) {
+            linkScripthashNested(access, ds, 1, scripts.scriptCount(DedupAddressType::SCRIPTHASH) + 1, threadCount);
+        }
+        linkBlocks(chain, ds, changeHeuristic, rules, false, threadCount);
         
-        std::ofstream clusterOffsetFile(offsetFile, std::ios::binary);
-        clusterOffsetFile.write(reinterpret_cast<char *>(clusterPositions.data()), static_cast<long>(sizeof(uint32_t) * clusterPositions.size()));
+        if (chain.size() > 0) {
+            ClusteringPhaseSpan span{ClusteringPhase::RefineClusters};
+            ClusterRefiner refiner{ds, chain, rules, threadCount};
+            for (uint32_t round = 1; round <= options.maxRounds && refiner.dirtyCount() > 0; round++) {
+                auto txCount = refiner.dirtyCount();
+                auto unionCount = refiner.runRound(refinement);
+                std::cout << "Refinement round " << round << ": " << txCount << " transactions, " << unionCount << " clusters merged\n";
+            }
+        }
+        
+        auto parent = resolveClusters(ds, threadCount);
+        writeClusterState(outputPath, ClusterState{ClusterState::Magic, chain.sl.start, chain.sl.stop, rules.flags() | refinedClusteringFlag, scriptCounts}, parent);
+        ScratchSpace scratch;
+        auto numbering = remapClusterIds(parent, scratch, threadCount);
+        auto clusterEnds = serializeClusterData(scripts, outputPath, parent, scriptStarts, numbering, scratch, threadCount);
+        writeClusterStats(chain, outputPath, parent, scriptStarts, numbering, clusterEnds, scratch, threadCount);
+        return {filesystem::path{outputPath}.str(), access};
     }
     
+    /** Cluster the blocks, in memory or, if external is set, with the memory bounded by external->memoryBudget */
     template <typename ChangeFunc>
-    ClusterManager createClusteringImpl(BlockRange &chain, ChangeFunc && changeHeuristic, const std::string &outputPath, bool overwrite, bool ignoreCoinJoin) {
+    ClusterManager createClusteringImpl(BlockRange &chain, const ChangeFunc &changeHeuristic, const ClusteringRules &rules, const std::string &outputPath, bool overwrite, uint32_t threadCount, const ExternalClusteringOptions *external = nullptr) {
         prepareClusterDataLocation(outputPath, overwrite);
         
         // Perform clustering
         
         auto &scripts = chain.getAccess().getScripts();
         size_t totalScriptCount = scripts.totalAddressCount();
+        auto scriptCounts = scripts.scriptCounts();
+        auto scriptStarts = addressIndexStarts(scriptCounts);
         
-        std::unordered_map<DedupAddressType::Enum, uint32_t> scriptStarts;
-        {
-            std::vector<uint32_t> starts(DedupAddressType::size);
-            for (size_t i = 0; i < DedupAddressType::size; i++) {
-                if (i > 0) {
-                    starts[i] = scripts.scriptCount(static_cast<DedupAddressType::Enum>(i - 1)) + starts[i - 1];
+        threadCount = resolveThreadCount(threadCount);
+        ScratchSpace scratch;
+        bool createdTempDirectory = false;
+        if (external) {
+            filesystem::path tempDirectory{external->tempDirectory.empty() ? filesystem::path{outputPath}/"clusterTemp" : filesystem::path{external->tempDirectory}};
+            if (!tempDirectory.exists()) {
+                if (!filesystem::create_directory(tempDirectory)) {
+                    throw std::runtime_error("Cannot create directory at path " + tempDirectory.str());
                 }
-                scriptStarts[static_cast<DedupAddressType::Enum>(i)] = starts[i];
+                createdTempDirectory = true;
             }
+            scratch = ScratchSpace{tempDirectory};
         }
         
-        auto parent = createClusters(chain, scriptStarts, static_cast<uint32_t>(totalScriptCount), std::forward<ChangeFunc>(changeHeuristic), ignoreCoinJoin);
-        uint32_t clusterCount = remapClusterIds(parent);
-        serializeClusterData(scripts, outputPath, parent, scriptStarts, clusterCount);
+        {
+            auto parent = external ? createClustersExternal(chain, scriptStarts, static_cast<uint32_t>(totalScriptCount), changeHeuristic, rules, *external, scratch, threadCount) : createClusters(chain, scriptStarts, static_cast<uint32_t>(totalScriptCount), changeHeuristic, rules, threadCount);
+            writeClusterState(outputPath, ClusterState{ClusterState::Magic, chain.sl.start, chain.sl.stop, rules.flags(), scriptCounts}, parent);
+            auto numbering = remapClusterIds(parent, scratch, threadCount);
+            auto clusterEnds = serializeClusterData(scripts, outputPath, parent, scriptStarts, numbering, scratch, threadCount);
+            writeClusterStats(chain, outputPath, parent, scriptStarts, numbering, clusterEnds, scratch, threadCount);
+        }
+        if (createdTempDirectory) {
+            std::remove(scratch.getDirectory().str().c_str());
+        }
         return {filesystem::path{outputPath}.str(), chain.getAccess()};
     }
     
-    ClusterManager ClusterManager::createClustering(BlockRange &chain, const heuristics::ChangeHeuristic &changeHeuristic, const std::string &outputPath, bool overwrite, bool ignoreCoinJoin) {
+    template <typename ChangeFunc>
+    ClusterManager updateClusteringImpl(BlockRange &newBlocks, const ChangeFunc &changeHeuristic, const ClusteringRules &rules, const std::string &outputPath, uint32_t threadCount) {
+        auto state = readClusterState(outputPath);
+        if (newBlocks.sl.start > state.endHeight) {
+            std::stringstream ss;
+            ss << "The clustering in " << outputPath << " ends at block " << state.endHeight << ", it can't be extended with blocks starting at " << newBlocks.sl.start;
+            throw std::runtime_error(ss.str());
+        }
+        if (state.ruleFlags != rules.flags()) {
+            throw std::runtime_error("The clustering in " + outputPath + " was created with different clustering rules");
+        }
+        threadCount = resolveThreadCount(threadCount);
+        
+        auto &access = newBlocks.getAccess();
+        auto &scripts = access.getScripts();
+        auto scriptCounts = scripts.scriptCounts();
+        auto scriptStarts = addressIndexStarts(scriptCounts);
+        
+        AddressDisjointSets ds(readClusterParents(outputPath, state, scriptCounts), scriptStarts);
+        
+        // Blocks that are already part of the clustering are skipped, linking them again wouldn't change anything
+        BlockRange blocks{{std::max(newBlocks.sl.start, state.endHeight), std::max(newBlocks.sl.stop, state.endHeight)}, &access};
+        auto scripthashIndex = static_cast<size_t>(DedupAddressType::SCRIPTHASH);
+        if (rules.linkScripthashNested) {
+            linkScripthashNested(access, ds, state.scriptCounts[scripthashIndex] + 1, scriptCounts[scripthashIndex] + 1, threadCount);
+        }
+        linkBlocks(blocks, ds, changeHeuristic, rules, rules.linkScripthashNested, threadCount);
+        
+        auto parent = resolveClusters(ds, threadCount);
+        writeClusterState(outputPath, ClusterState{ClusterState::Magic, state.startHeight, blocks.sl.stop, rules.flags(), scriptCounts}, parent);
+        ScratchSpace scratch;
+        auto numbering = remapClusterIds(parent, scratch, threadCount);
+        auto clusterEnds = serializeClusterData(scripts, outputPath, parent, scriptStarts, numbering, scratch, threadCount);
+        // The statistics are aggregated over all clustered blocks again, merged clusters can share transactions
+        BlockRange clusteredBlocks{{state.startHeight, blocks.sl.stop}, &access};
+        writeClusterStats(clusteredBlocks, outputPath, parent, scriptStarts, numbering, clusterEnds, scratch, threadCount);
+        return {filesystem::path{outputPath}.str(), access};
+    }
+    
+    ClusterManager ClusterManager::createClustering(BlockRange &chain, const heuristics::ChangeHeuristic &changeHeuristic, const std::string &outputPath, bool overwrite, bool ignoreCoinJoin, uint32_t threadCount) {
         
         auto changeHeuristicL = [&changeHeuristic](const Transaction &tx) -> ranges::any_view<Output> {
             return changeHeuristic(tx);
         };
         
-        return createClusteringImpl(chain, changeHeuristicL, outputPath, overwrite, ignoreCoinJoin);
+        return createClusteringImpl(chain, changeHeuristicL, ClusteringRules::defaultRules(ignoreCoinJoin), outputPath, overwrite, threadCount);
     }
     
-    ClusterManager ClusterManager::createClustering(BlockRange &chain, const std::function<ranges::any_view<Output>(const Transaction &tx)> &changeHeuristic, const std::string &outputPath, bool overwrite, bool ignoreCoinJoin) {
-        return createClusteringImpl(chain, changeHeuristic, outputPath, overwrite, ignoreCoinJoin);
+    ClusterManager ClusterManager::createClustering(BlockRange &chain, const std::function<ranges::any_view<Output>(const Transaction &tx)> &changeHeuristic, const std::string &outputPath, bool overwrite, bool ignoreCoinJoin, uint32_t threadCount) {
+        return createClusteringImpl(chain, changeHeuristic, ClusteringRules::defaultRules(ignoreCoinJoin), outputPath, overwrite, threadCount);
     }
+    
+    ClusterManager ClusterManager::createClustering(BlockRange &chain, const heuristics::ChangeHeuristic &changeHeuristic, const ClusteringRules &rules, const std::string &outputPath, bool overwrite, uint32_t threadCount) {
+        
+        auto changeHeuristicL = [&changeHeuristic](const Transaction &tx) -> ranges::any_view<Output> {
+            return changeHeuristic(tx);
+        };
+        
+        return createClusteringImpl(chain, changeHeuristicL, rules, outputPath, overwrite, threadCount);
+    }
+    
+    ClusterManager ClusterManager::createClustering(BlockRange &chain, const heuristics::ChangeHeuristic &changeHeuristic, const ClusteringRules &rules, const ExternalClusteringOptions &external, const std::string &outputPath, bool overwrite, uint32_t threadCount) {
+        
+        auto changeHeuristicL = [&changeHeuristic](const Transaction &tx) -> ranges::any_view<Output> {
+            return changeHeuristic(tx);
+        };
+        
+        return createClusteringImpl(chain, changeHeuristicL, rules, outputPath, overwrite, threadCount, &external);
+    }
+    
+    ClusterManager ClusterManager::refineClustering(BlockRange &chain, const heuristics::ChangeHeuristic &changeHeuristic, const ClusteringRules &rules, const ClusterChangeRule &refinement, const std::string &outputPath, const RefinementOptions &options, bool overwrite, uint32_t threadCount) {
+        
+        auto changeHeuristicL = [&changeHeuristic](const Transaction &tx) -> ranges::any_view<Output> {
+            return changeHeuristic(tx);
+        };
+        
+        return refineClusteringImpl(chain, changeHeuristicL, rules, refinement, outputPath, options, overwrite, threadCount);
+    }
+    
+    void ClusterManager::packClusterAddresses(const std::string &baseDirectory, uint32_t minClusterSize, uint32_t threadCount) {
+        if (!filesystem::path{ClusterAccess::addressesFilePath(baseDirectory)}.exists()) {
+            throw std::runtime_error("Cluster data not found");
+        }
+        FixedSizeFileMapper<uint32_t> offsetFile{filesystem::path{baseDirectory}/"clusterOffsets"};
+        FixedSizeFileMapper<DedupAddress> addressesFile{filesystem::path{baseDirectory}/"clusterAddresses"};
+        auto layout = ClusterLayoutHeader::read(baseDirectory);
+        auto offsetCount = static_cast<uint32_t>(offsetFile.size());
+        auto listedCount = layout ? std::min(layout->multiAddressClusterCount, offsetCount) : std::max(offsetCount, 1u) - 1;
+        auto path = ClusterAccess::packedAddressesFilePath(baseDirectory);
+        writePackedClusterAddresses(path + ".tmp", addressesFile.size() > 0 ? addressesFile[0] : nullptr, offsetCount > 0 ? offsetFile[0] : nullptr, listedCount, minClusterSize, threadCount);
+        if (std::rename((path + ".tmp").c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("Could not move cluster file into place at " + path);
+        }
+    }
+    
+    bool ClusterManager::usesPackedAddresses() const {
+        return access->usesPackedAddresses();
+    }
+    
+    void ClusterManager::removeClustering(const std::string &outputPath) {
+        for (auto &path : clusterDataPaths(outputPath)) {
+            filesystem::path filePath{path};
+            if (filePath.exists()) {
+                filePath.remove_file();
+            }
+        }
+        // Only succeeds if nothing else was stored in the directory
+        std::remove(outputPath.c_str());
+    }
+    
+    ClusterManager ClusterManager::updateClustering(BlockRange &newBlocks, const heuristics::ChangeHeuristic &changeHeuristic, const std::string &outputPath, bool ignoreCoinJoin, uint32_t threadCount) {
+        
+        auto changeHeuristicL = [&changeHeuristic](const Transaction &tx) -> ranges::any_view<Output> {
+            return changeHeuristic(tx);
+        };
+        
+        return updateClusteringImpl(newBlocks, changeHeuristicL, ClusteringRules::defaultRules(ignoreCoinJoin), outputPath, threadCount);
+    }
+    
+    ClusterManager ClusterManager::updateClustering(BlockRange &newBlocks, const std::function<ranges::any_view<Output>(const Transaction &tx)> &changeHeuristic, const std::string &outputPath, bool ignoreCoinJoin, uint32_t threadCount) {
+        return updateClusteringImpl(newBlocks, changeHeuristic, ClusteringRules::defaultRules(ignoreCoinJoin), outputPath, threadCount);
+    }
+    
+    ClusterManager ClusterManager::updateClustering(BlockRange &newBlocks, const heuristics::ChangeHeuristic &changeHeuristic, const ClusteringRules &rules, const std::string &outputPath, uint32_t threadCount) {
+        
+        auto changeHeuristicL = [&changeHeuristic](const Transaction &tx) -> ranges::any_view<Output> {
+            return changeHeuristic(tx);
+        };
+        
+        return updateClusteringImpl(newBlocks, changeHeuristicL, rules, outputPath, threadCount);
+    }
+    
+    template <heuristics::ChangeType::Enum type>
+    ClusterManager ClusterManager::createClustering(BlockRange &chain, const heuristics::ChangeHeuristicImpl<type> &changeHeuristic, const std::string &outputPath, bool overwrite, bool ignoreCoinJoin, uint32_t threadCount) {
+        return createClusteringImpl(chain, changeHeuristic, ClusteringRules::defaultRules(ignoreCoinJoin), outputPath, overwrite, threadCount);
+    }
+    
+    template <heuristics::ChangeType::Enum type>
+    ClusterManager ClusterManager::createClustering(BlockRange &chain, const heuristics::ChangeHeuristicImpl<type> &changeHeuristic, const ClusteringRules &rules, const std::string &outputPath, bool overwrite, uint32_t threadCount) {
+        return createClusteringImpl(chain, changeHeuristic, rules, outputPath, overwrite, threadCount);
+    }
+    
+    template <heuristics::ChangeType::Enum type>
+    ClusterManager ClusterManager::createClustering(BlockRange &chain, const heuristics::ChangeHeuristicImpl<type> &changeHeuristic, const ClusteringRules &rules, const ExternalClusteringOptions &external, const std::string &outputPath, bool overwrite, uint32_t threadCount) {
+        return createClusteringImpl(chain, changeHeuristic, rules, outputPath, overwrite, threadCount, &external);
+    }
+    
+    template <heuristics::ChangeType::Enum type>
+    ClusterManager ClusterManager::updateClustering(BlockRange &newBlocks, const heuristics::ChangeHeuristicImpl<type> &changeHeuristic, const std::string &outputPath, bool ignoreCoinJoin, uint32_t threadCount) {
+        return updateClusteringImpl(newBlocks, changeHeuristic, ClusteringRules::defaultRules(ignoreCoinJoin), outputPath, threadCount);
+    }
+    
+    template <heuristics::ChangeType::Enum type>
+    ClusterManager ClusterManager::updateClustering(BlockRange &newBlocks, const heuristics::ChangeHeuristicImpl<type> &changeHeuristic, const ClusteringRules &rules, const std::string &outputPath, uint32_t threadCount) {
+        return updateClusteringImpl(newBlocks, changeHeuristic, rules, outputPath, threadCount);
+    }
+    
+    #define CLUSTER_WITH_HEURISTIC(type) \
+    template ClusterManager ClusterManager::createClustering<heuristics::ChangeType::type>(BlockRange &, const heuristics::ChangeHeuristicImpl<heuristics::ChangeType::type> &, const std::string &, bool, bool, uint32_t); \
+    template ClusterManager ClusterManager::createClustering<heuristics::ChangeType::type>(BlockRange &, const heuristics::ChangeHeuristicImpl<heuristics::ChangeType::type> &, const ClusteringRules &, const std::string &, bool, uint32_t); \
+    template ClusterManager ClusterManager::createClustering<heuristics::ChangeType::type>(BlockRange &, const heuristics::ChangeHeuristicImpl<heuristics::ChangeType::type> &, const ClusteringRules &, const ExternalClusteringOptions &, const std::string &, bool, uint32_t); \
+    template ClusterManager ClusterManager::updateClustering<heuristics::ChangeType::type>(BlockRange &, const heuristics::ChangeHeuristicImpl<heuristics::ChangeType::type> &, const std::string &, bool, uint32_t); \
+    template ClusterManager ClusterManager::updateClustering<heuristics::ChangeType::type>(BlockRange &, const heuristics::ChangeHeuristicImpl<heuristics::ChangeType::type> &, const ClusteringRules &, const std::string &, uint32_t);
+    
+    CLUSTER_WITH_HEURISTIC(PeelingChain)
+    CLUSTER_WITH_HEURISTIC(PowerOfTen)
+    CLUSTER_WITH_HEURISTIC(OptimalChange)
+    CLUSTER_WITH_HEURISTIC(AddressType)
+    CLUSTER_WITH_HEURISTIC(Locktime)
+    CLUSTER_WITH_HEURISTIC(AddressReuse)
+    CLUSTER_WITH_HEURISTIC(ClientChangeAddressBehavior)
+    CLUSTER_WITH_HEURISTIC(Legacy)
+    CLUSTER_WITH_HEURISTIC(FixedFee)
+    CLUSTER_WITH_HEURISTIC(None)
+    CLUSTER_WITH_HEURISTIC(Spent)
+    
+    #undef CLUSTER_WITH_HEURISTIC
 } // namespace blocksci
-
-
@@ -0,0 +1,46 @@
+//
+//  cluster_refinement.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include <blocksci/cluster/cluster_refinement.hpp>
+#include <blocksci/address/address.hpp>
+#include <blocksci/chain/input.hpp>
+#include <blocksci/chain/output.hpp>
+#include <blocksci/chain/transaction.hpp>
+
+#include <range/v3/range_for.hpp>
+#include <range/v3/utility/optional.hpp>
+
+namespace blocksci {
+    void payeeClusterChange(const Transaction &tx, const ClusterLookup &clusters, std::vector<Output> &change) {
+        if (tx.isCoinbase() || tx.outputCount() < 2) {
+            return;
+        }
+        auto inputCluster = clusters.clusterOf(tx.inputs()[0].getAddress());
+        bool paysKnownCluster = false;
+        ranges::optional<Output> freshOutput;
+        RANGES_FOR(auto output, tx.outputs()) {
+            // OP_RETURN outputs don't go to anyone
+            if (output.getType() == AddressType::NULL_DATA) {
+                continue;
+            }
+            auto address = output.getAddress();
+            if (clusters.clusterOf(address) == inputCluster) {
+                return;
+            }
+            if (clusters.clusterSize(address) > 1) {
+                paysKnownCluster = true;
+            } else if (freshOutput) {
+                return;
+            } else {
+                freshOutput = output;
+            }
+        }
+        if (paysKnownCluster && freshOutput) {
+            change.push_back(*freshOutput);
+        }
+    }
+} // namespace blocksci
@@ -0,0 +1,265 @@
+//
+//  clustering_set.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include <blocksci/cluster/clustering_set.hpp>
+
+#include <blocksci/address/address.hpp>
+#include <blocksci/chain/block_range.hpp>
+
+#include <internal/address_info.hpp>
+#include <internal/cluster_access.hpp>
+#include <internal/dedup_address_info.hpp>
+#include <internal/file_mapper.hpp>
+#include <internal/segment_work.hpp>
+
+#include <wjfilesystem/path.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+
+namespace blocksci {
+    
+    /** Cluster number columns of one clustering of the set */
+    struct ClusteringColumns {
+        FixedSizeFileMapper<uint32_t> offsets;
+        ranges::optional<ClusterLayoutHeader> layout;
+        std::vector<std::unique_ptr<FixedSizeFileMapper<uint32_t>>> typeColumns;
+        
+        explicit ClusteringColumns(const filesystem::path &clusteringDirectory) : offsets(clusteringDirectory/"clusterOffsets"), layout(ClusterLayoutHeader::read(clusteringDirectory.str())) {
+            for (auto type : DedupAddressType::allArray()) {
+                typeColumns.push_back(std::make_unique<FixedSizeFileMapper<uint32_t>>(clusteringDirectory/(dedupAddressName(type) + "_cluster_index")));
+            }
+        }
+        
+        uint32_t clusterCount() const {
+            if (layout) {
+                return layout->clusterCount;
+            }
+            return offsets.size() > 0 ? static_cast<uint32_t>(offsets.size() - 1) : 0;
+        }
+        
+        const FixedSizeFileMapper<uint32_t> &column(DedupAddressType::Enum type) const {
+            return *typeColumns[static_cast<size_t>(type)];
+        }
+    };
+    
+    namespace {
+        constexpr uint64_t setMagic = 0x544553534c43424cULL; // "LBCLSSET"
+        
+        filesystem::path headerPath(const std::string &directory) {
+            return filesystem::path{directory}/"clusterings.dat";
+        }
+        
+        void checkName(const std::string &name) {
+            if (name.empty() || name == "." || name == ".." || name.find('/') != std::string::npos) {
+                throw std::runtime_error("Invalid clustering name \"" + name + "\", names must be non-empty and can't contain '/'");
+            }
+        }
+        
+        /** Mark the clusters whose addresses map to more than one cluster of the other clustering
+         *
+         * first[c] holds the first cluster seen for c, every later address of c that maps elsewhere flags c. */
+        void recordPair(std::atomic<uint32_t> *first, std::atomic<uint8_t> *flags, uint32_t clusterNum, uint32_t otherNum) {
+            auto seen = first[clusterNum].load(std::memory_order_relaxed);
+            if (seen == std::numeric_limits<uint32_t>::max()) {
+                if (first[clusterNum].compare_exchange_strong(seen, otherNum, std::memory_order_relaxed)) {
+                    return;
+                }
+            }
+            if (seen != otherNum) {
+                flags[clusterNum].store(1, std::memory_order_relaxed);
+            }
+        }
+        
+        std::vector<uint32_t> flaggedClusters(const std::atomic<uint8_t> *flags, uint32_t clusterCount) {
+            std::vector<uint32_t> clusters;
+            for (uint32_t i = 0; i < clusterCount; i++) {
+                if (flags[i].load(std::memory_order_relaxed)) {
+                    clusters.push_back(i);
+                }
+            }
+            return clusters;
+        }
+    }
+    
+    ClusteringSet::ClusteringSet(const std::string &directory_, DataAccess &access_) : directory(directory_), access(&access_) {
+        filesystem::path directoryPath{directory};
+        if (!directoryPath.exists()) {
+            if (!filesystem::create_directory(directoryPath)) {
+                throw std::runtime_error("Cannot create clustering set directory at " + directory);
+            }
+        } else if (!directoryPath.is_directory()) {
+            throw std::runtime_error("Clustering set path " + directory + " must be a directory, not a file");
+        }
+        
+        auto path = headerPath(directory);
+        if (!path.exists()) {
+            return;
+        }
+        std::ifstream file(path.str(), std::ios::binary);
+        uint64_t magic = 0;
+        uint32_t count = 0;
+        if (!file.read(reinterpret_cast<char *>(&magic), sizeof(magic)) || magic != setMagic || !file.read(reinterpret_cast<char *>(&count), sizeof(count))) {
+            throw std::runtime_error("Clustering set header " + path.str() + " is invalid");
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t length = 0;
+            std::string name;
+            if (file.read(reinterpret_cast<char *>(&length), sizeof(length))) {
+                name.resize(length);
+                file.read(&name[0], length);
+            }
+            if (!file) {
+                throw std::runtime_error("Clustering set header " + path.str() + " is truncated");
+            }
+            names.push_back(name);
+            columns.push_back(std::make_unique<ClusteringColumns>(clusteringPath(name)));
+        }
+    }
+    
+    ClusteringSet::ClusteringSet(ClusteringSet &&other) = default;
+    
+    ClusteringSet &ClusteringSet::operator=(ClusteringSet &&other) = default;
+    
+    ClusteringSet::~ClusteringSet() = default;
+    
+    size_t ClusteringSet::clusteringIndex(const std::string &name) const {
+        auto it = std::find(names.begin(), names.end(), name);
+        if (it == names.end()) {
+            throw std::runtime_error("Clustering set " + directory + " has no clustering named \"" + name + "\"");
+        }
+        return static_cast<size_t>(std::distance(names.begin(), it));
+    }
+    
+    void ClusteringSet::writeHeader() const {
+        auto path = headerPath(directory).str();
+        auto tempPath = path + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            auto count = static_cast<uint32_t>(names.size());
+            file.write(reinterpret_cast<const char *>(&setMagic), sizeof(setMagic));
+            file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+            for (auto &name : names) {
+                auto length = static_cast<uint32_t>(name.size());
+                file.write(reinterpret_cast<const char *>(&length), sizeof(length));
+                file.write(name.data(), length);
+            }
+            if (!file) {
+                throw std::runtime_error("Could not write clustering set header to " + tempPath);
+            }
+        }
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("Could not move clustering set header into place at " + path);
+        }
+    }
+    
+    bool ClusteringSet::contains(const std::string &name) const {
+        return std::find(names.begin(), names.end(), name) != names.end();
+    }
+    
+    std::string ClusteringSet::clusteringPath(const std::string &name) const {
+        return (filesystem::path{directory}/name).str();
+    }
+    
+    void ClusteringSet::createClustering(const std::string &name, BlockRange &chain, const heuristics::ChangeHeuristic &heuristic, const ClusteringRules &rules, bool overwrite, uint32_t threadCount) {
+        checkName(name);
+        if (contains(name) && !overwrite) {
+            throw std::runtime_error("Clustering set " + directory + " already has a clustering named \"" + name + "\"");
+        }
+        ClusterManager::createClustering(chain, heuristic, rules, clusteringPath(name), overwrite, threadCount);
+        auto newColumns = std::make_unique<ClusteringColumns>(clusteringPath(name));
+        if (contains(name)) {
+            columns[clusteringIndex(name)] = std::move(newColumns);
+        } else {
+            names.push_back(name);
+            columns.push_back(std::move(newColumns));
+            writeHeader();
+        }
+    }
+    
+    void ClusteringSet::updateClustering(const std::string &name, BlockRange &newBlocks, const heuristics::ChangeHeuristic &heuristic, const ClusteringRules &rules, uint32_t threadCount) {
+        auto index = clusteringIndex(name);
+        ClusterManager::updateClustering(newBlocks, heuristic, rules, clusteringPath(name), threadCount);
+        columns[index] = std::make_unique<ClusteringColumns>(clusteringPath(name));
+    }
+    
+    void ClusteringSet::removeClustering(const std::string &name) {
+        auto index = clusteringIndex(name);
+        names.erase(names.begin() + static_cast<std::ptrdiff_t>(index));
+        columns.erase(columns.begin() + static_cast<std::ptrdiff_t>(index));
+        // The header is updated first so that a failed removal never leaves a listed clustering without files
+        writeHeader();
+        ClusterManager::removeClustering(clusteringPath(name));
+    }
+    
+    ClusterManager ClusteringSet::getManager(const std::string &name) const {
+        clusteringIndex(name);
+        return ClusterManager(clusteringPath(name), *access);
+    }
+    
+    uint32_t ClusteringSet::clusterCount(const std::string &name) const {
+        return columns[clusteringIndex(name)]->clusterCount();
+    }
+    
+    uint32_t ClusteringSet::getClusterNum(const std::string &name, const Address &address) const {
+        auto &column = columns[clusteringIndex(name)]->column(dedupType(address.type));
+        if (address.scriptNum == 0 || address.scriptNum > column.size()) {
+            throw std::runtime_error("Address is not covered by clustering \"" + name + "\"");
+        }
+        return *column[address.scriptNum - 1];
+    }
+    
+    ClusteringComparison ClusteringSet::compare(const std::string &a, const std::string &b, uint32_t threadCount) const {
+        auto &columnsA = *columns[clusteringIndex(a)];
+        auto &columnsB = *columns[clusteringIndex(b)];
+        auto clusterCountA = columnsA.clusterCount();
+        auto clusterCountB = columnsB.clusterCount();
+        threadCount = resolveThreadCount(threadCount);
+        
+        auto firstB = std::make_unique<std::atomic<uint32_t>[]>(clusterCountA);
+        auto firstA = std::make_unique<std::atomic<uint32_t>[]>(clusterCountB);
+        auto splitFlags = std::make_unique<std::atomic<uint8_t>[]>(clusterCountA);
+        auto mergedFlags = std::make_unique<std::atomic<uint8_t>[]>(clusterCountB);
+        auto unset = std::numeric_limits<uint32_t>::max();
+        segmentWork(0, clusterCountA, threadCount, [&](uint32_t i) {
+            firstB[i].store(unset, std::memory_order_relaxed);
+            splitFlags[i].store(0, std::memory_order_relaxed);
+        });
+        segmentWork(0, clusterCountB, threadCount, [&](uint32_t i) {
+            firstA[i].store(unset, std::memory_order_relaxed);
+            mergedFlags[i].store(0, std::memory_order_relaxed);
+        });
+        
+        ClusteringComparison comparison;
+        for (auto type : DedupAddressType::allArray()) {
+            auto &columnA = columnsA.column(type);
+            auto &columnB = columnsB.column(type);
+            // Clusterings of different chain lengths are compared on the addresses both of them cover
+            auto addressCount = static_cast<uint32_t>(std::min(columnA.size(), columnB.size()));
+            if (addressCount == 0) {
+                continue;
+            }
+            comparison.addressCount += addressCount;
+            columnA.advise(AccessHint::Sequential, 0, addressCount);
+            columnB.advise(AccessHint::Sequential, 0, addressCount);
+            const uint32_t *clustersA = columnA[0];
+            const uint32_t *clustersB = columnB[0];
+            segmentWork(0, addressCount, threadCount, [&](uint32_t i) {
+                recordPair(firstB.get(), splitFlags.get(), clustersA[i], clustersB[i]);
+                recordPair(firstA.get(), mergedFlags.get(), clustersB[i], clustersA[i]);
+            });
+        }
+        comparison.splitClusters = flaggedClusters(splitFlags.get(), clusterCountA);
+        comparison.mergedClusters = flaggedClusters(mergedFlags.get(), clusterCountB);
+        return comparison;
+    }
+} // namespace blocksci
@@ -0,0 +1,174 @@
+//
+//  column_abi.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include <blocksci/column_abi.h>
+#include <blocksci/chain/blockchain.hpp>
+#include <blocksci/chain/column_data.hpp>
+#include <blocksci/cluster/cluster_manager.hpp>
+#include <blocksci/core/dedup_address.hpp>
+#include <blocksci/core/inout.hpp>
+#include <blocksci/core/raw_block.hpp>
+#include <blocksci/core/raw_transaction.hpp>
+
+#include <internal/address_info.hpp>
+#include <internal/cluster_access.hpp>
+#include <internal/data_access.hpp>
+#include <internal/script_access.hpp>
+
+#include <cstddef>
+#include <exception>
+#include <stdexcept>
+#include <string>
+
+namespace blocksci {
+    static_assert(BLOCKSCI_CHAIN_TX_INDEX == static_cast<int>(ChainColumn::TxIndex), "C column numbers follow ChainColumn");
+    static_assert(BLOCKSCI_CHAIN_TX_PACKAGE_FLAGS == static_cast<int>(ChainColumn::TxPackageFlags), "C column numbers follow ChainColumn");
+    static_assert(BLOCKSCI_DEDUP_WITNESS_TAPROOT == DedupAddressType::WITNESS_TAPROOT && BLOCKSCI_DEDUP_NONSTANDARD == DedupAddressType::NONSTANDARD, "C dedup types follow DedupAddressType");
+
+    static_assert(sizeof(RawBlock) == BLOCKSCI_RAW_BLOCK_SIZE, "RawBlock layout is part of the column ABI");
+    static_assert(offsetof(RawBlock, coinbaseOffset) == BLOCKSCI_RAW_BLOCK_COINBASE_OFFSET_OFFSET, "RawBlock layout is part of the column ABI");
+    static_assert(offsetof(RawBlock, firstTxIndex) == BLOCKSCI_RAW_BLOCK_FIRST_TX_INDEX_OFFSET, "RawBlock layout is part of the column ABI");
+    static_assert(offsetof(RawBlock, height) == BLOCKSCI_RAW_BLOCK_HEIGHT_OFFSET, "RawBlock layout is part of the column ABI");
+    static_assert(offsetof(RawBlock, timestamp) == BLOCKSCI_RAW_BLOCK_TIMESTAMP_OFFSET, "RawBlock layout is part of the column ABI");
+    static_assert(offsetof(RawBlock, baseSize) == BLOCKSCI_RAW_BLOCK_BASE_SIZE_OFFSET, "RawBlock layout is part of the column ABI");
+
+    static_assert(sizeof(RawTransaction) == BLOCKSCI_RAW_TX_HEADER_SIZE, "RawTransaction layout is part of the column ABI");
+    static_assert(offsetof(RawTransaction, locktime) == BLOCKSCI_RAW_TX_LOCKTIME_OFFSET, "RawTransaction layout is part of the column ABI");
+    static_assert(offsetof(RawTransaction, inputCount) == BLOCKSCI_RAW_TX_INPUT_COUNT_OFFSET, "RawTransaction layout is part of the column ABI");
+    static_assert(offsetof(RawTransaction, outputCount) == BLOCKSCI_RAW_TX_OUTPUT_COUNT_OFFSET, "RawTransaction layout is part of the column ABI");
+
+    static_assert(sizeof(Inout) == BLOCKSCI_INOUT_SIZE, "Inout layout is part of the column ABI");
+    static_assert(sizeof(DedupAddress) == 8, "DedupAddress layout is part of the column ABI");
+
+    namespace {
+        thread_local std::string lastError;
+
+        Blockchain &chainOf(blocksci_chain *chain) {
+            if (chain == nullptr) {
+                throw std::invalid_argument("No chain given");
+            }
+            return *reinterpret_cast<Blockchain *>(chain);
+        }
+
+        const ClusterManager &clusteringOf(blocksci_clustering *clustering) {
+            if (clustering == nullptr) {
+                throw std::invalid_argument("No clustering given");
+            }
+            return *reinterpret_cast<const ClusterManager *>(clustering);
+        }
+
+        DedupAddressType::Enum dedupTypeOf(int dedupType) {
+            if (dedupType < 0 || static_cast<size_t>(dedupType) >= DedupAddressType::size) {
+                throw std::invalid_argument("Invalid deduplicated address type " + std::to_string(dedupType));
+            }
+            return static_cast<DedupAddressType::Enum>(dedupType);
+        }
+
+        blocksci_column makeColumn(const void *data, uint64_t length, uint64_t elementSize, uint64_t firstIndex) {
+            blocksci_column column{};
+            column.data = length > 0 ? data : nullptr;
+            column.length = length;
+            column.stride = elementSize;
+            column.element_size = elementSize;
+            column.first_index = firstIndex;
+            column.abi_version = BLOCKSCI_COLUMN_ABI_VERSION;
+            return column;
+        }
+
+        /** Run func, turning exceptions into the -1 and the message of blocksci_last_error that C callers expect */
+        template <typename Func>
+        int translateExceptions(blocksci_column *out, Func &&func) {
+            try {
+                if (out == nullptr) {
+                    throw std::invalid_argument("No column to write to given");
+                }
+                *out = func();
+                return 0;
+            } catch (const std::exception &e) {
+                lastError = e.what();
+            } catch (...) {
+                lastError = "Unknown error";
+            }
+            return -1;
+        }
+    } // namespace
+} // namespace blocksci
+
+using namespace blocksci;
+
+extern "C" {
+    uint32_t blocksci_column_abi_version(void) {
+        return BLOCKSCI_COLUMN_ABI_VERSION;
+    }
+
+    const char *blocksci_last_error(void) {
+        return lastError.c_str();
+    }
+
+    int blocksci_dedup_type(int address_type) {
+        if (address_type < 0 || static_cast<size_t>(address_type) >= AddressType::size) {
+            lastError = "Invalid address type " + std::to_string(address_type);
+            return -1;
+        }
+        return static_cast<int>(dedupType(static_cast<AddressType::Enum>(address_type)));
+    }
+
+    int blocksci_chain_column(blocksci_chain *chain, int column, blocksci_column *out) {
+        return translateExceptions(out, [&]() {
+            auto &access = chainOf(chain).getAccess();
+            if (column < 0 || column > BLOCKSCI_CHAIN_TX_PACKAGE_FLAGS) {
+                throw std::invalid_argument("Invalid chain column " + std::to_string(column));
+            }
+            auto data = columnData(static_cast<ChainColumn>(column), access);
+            return makeColumn(data.data, data.count, data.elementSize, 0);
+        });
+    }
+
+    int blocksci_script_column(blocksci_chain *chain, int dedup_type, int column, blocksci_column *out) {
+        return translateExceptions(out, [&]() {
+            auto &scripts = chainOf(chain).getAccess().getScripts();
+            auto type = dedupTypeOf(dedup_type);
+            std::pair<const uint32_t *, uint32_t> data;
+            switch (column) {
+                case BLOCKSCI_SCRIPT_FIRST_SEEN:
+                    data = scripts.getFirstSeenColumn(type);
+                    break;
+                case BLOCKSCI_SCRIPT_FIRST_SPENT:
+                    data = scripts.getFirstSpentColumn(type);
+                    break;
+                case BLOCKSCI_SCRIPT_TYPES_SEEN:
+                    data = scripts.getTypesSeenColumn(type);
+                    break;
+                default:
+                    throw std::invalid_argument("Invalid script column " + std::to_string(column));
+            }
+            return makeColumn(data.first, data.second, sizeof(uint32_t), 1);
+        });
+    }
+
+    int blocksci_cluster_column(blocksci_clustering *clustering, int column, int dedup_type, blocksci_column *out) {
+        return translateExceptions(out, [&]() {
+            auto &access = clusteringOf(clustering).getAccess();
+            switch (column) {
+                case BLOCKSCI_CLUSTER_OFFSETS: {
+                    auto data = access.getClusterOffsetsColumn();
+                    return makeColumn(data.first, data.second, sizeof(uint32_t), 0);
+                }
+                case BLOCKSCI_CLUSTER_ADDRESSES: {
+                    auto data = access.getClusterAddressesColumn();
+                    return makeColumn(data.first, data.second, sizeof(DedupAddress), 0);
+                }
+                case BLOCKSCI_CLUSTER_INDEX: {
+                    auto data = access.getTypeClusterNums(dedupTypeOf(dedup_type));
+                    return makeColumn(data.first, data.second, sizeof(uint32_t), 1);
+                }
+                default:
+                    throw std::invalid_argument("Invalid cluster column " + std::to_string(column));
+            }
+        });
+    }
+}
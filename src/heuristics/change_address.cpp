@@ -10,19 +10,32 @@
 #include <blocksci/heuristics/change_address.hpp>
 #include <blocksci/heuristics/tx_identification.hpp>
 #include <blocksci/chain/transaction.hpp>
+#include <blocksci/chain/block.hpp>
+#include <blocksci/chain/block_range.hpp>
 #include <blocksci/chain/input.hpp>
 #include <blocksci/scripts/script_variant.hpp>
 
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+#include <internal/segment_work.hpp>
+
 #include <range/v3/range_for.hpp>
 #include <range/v3/view/filter.hpp>
 
 #include <unordered_set>
 #include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
 
 
 /** Change address heuristics
  *
  * Every heuristic returns the set of outputs it cannot rule out as change.
+ *
+ * The heuristics are written once against a collector, which either builds the lazy range returned by operator() or
+ * appends the candidates to a vector for appendChange().
  */
 namespace blocksci { namespace heuristics {
     
@@ -31,20 +44,263 @@ namespace blocksci { namespace heuristics {
         return o.getAddress().isSpendable();
     }
     
+    namespace {
+        /** Collects the candidates into the range returned by operator() */
+        struct ViewCollector {
+            using result_type = ranges::any_view<Output>;
+            
+            const Transaction &tx;
+            
+            result_type none() const {
+                return ranges::views::empty<Output>;
+            }
+            
+            result_type single(Output output) const {
+                return ranges::views::single(output);
+            }
+            
+            /** Outputs matching pred, including unspendable ones */
+            template <typename Pred>
+            result_type all(Pred pred) const {
+                return tx.outputs() | ranges::views::filter(pred);
+            }
+            
+            /** Spendable outputs matching pred */
+            template <typename Pred>
+            result_type spendable(Pred pred) const {
+                return tx.outputs() | ranges::views::filter(pred) | ranges::views::filter(filterOpReturn);
+            }
+        };
+        
+        /** Appends the candidates to a vector for appendChange() */
+        struct VectorCollector {
+            using result_type = void;
+            
+            const Transaction &tx;
+            std::vector<Output> &change;
+            
+            void none() const {}
+            
+            void single(Output output) const {
+                change.push_back(output);
+            }
+            
+            template <typename Pred>
+            void all(Pred pred) const {
+                RANGES_FOR(auto output, tx.outputs()) {
+                    if (pred(output)) {
+                        change.push_back(output);
+                    }
+                }
+            }
+            
+            template <typename Pred>
+            void spendable(Pred pred) const {
+                RANGES_FOR(auto output, tx.outputs()) {
+                    if (pred(output) && filterOpReturn(output)) {
+                        change.push_back(output);
+                    }
+                }
+            }
+        };
+        
+        /** Values of one transaction that several heuristics need, each computed on first use */
+        class ChangeTxCache {
+            const Transaction *tx = nullptr;
+            ranges::optional<int64_t> smallestInput;
+            ranges::optional<ranges::optional<AddressType::Enum>> inputType;
+            std::shared_ptr<const std::unordered_set<Address>> inputAddresses;
+            std::vector<int8_t> spendable;
+            std::vector<ranges::optional<ranges::optional<Transaction>>> spendingTxs;
+            
+        public:
+            void reset(const Transaction &tx_) {
+                tx = &tx_;
+                smallestInput = ranges::nullopt;
+                inputType = ranges::nullopt;
+                inputAddresses.reset();
+                spendable.assign(tx->outputCount(), -1);
+                spendingTxs.assign(tx->outputCount(), ranges::nullopt);
+            }
+            
+            int64_t getSmallestInputValue();
+            ranges::optional<AddressType::Enum> getInputType();
+            std::shared_ptr<const std::unordered_set<Address>> getInputAddresses();
+            
+            bool isSpendable(uint16_t outputNum) {
+                if (spendable[outputNum] < 0) {
+                    spendable[outputNum] = filterOpReturn(tx->outputs()[outputNum]) ? 1 : 0;
+                }
+                return spendable[outputNum] == 1;
+            }
+            
+            ranges::optional<Transaction> getSpendingTx(uint16_t outputNum) {
+                auto &spendingTx = spendingTxs[outputNum];
+                if (!spendingTx) {
+                    spendingTx = tx->outputs()[outputNum].getSpendingTx();
+                }
+                return *spendingTx;
+            }
+        };
+        
+        /** Sets a bit in the mask of every candidate output for evaluateChange()
+         *
+         * All heuristics evaluated on a transaction share one ChangeTxCache. */
+        struct MaskCollector {
+            using result_type = void;
+            
+            const Transaction &tx;
+            ChangeTxCache &cache;
+            uint32_t *masks;
+            uint32_t bit;
+            
+            void none() const {}
+            
+            void single(Output output) const {
+                masks[output.pointer.inoutNum] |= bit;
+            }
+            
+            template <typename Pred>
+            void all(Pred pred) const {
+                uint16_t outputNum = 0;
+                RANGES_FOR(auto output, tx.outputs()) {
+                    if (pred(output)) {
+                        masks[outputNum] |= bit;
+                    }
+                    outputNum++;
+                }
+            }
+            
+            template <typename Pred>
+            void spendable(Pred pred) const {
+                uint16_t outputNum = 0;
+                RANGES_FOR(auto output, tx.outputs()) {
+                    if (cache.isSpendable(outputNum) && pred(output)) {
+                        masks[outputNum] |= bit;
+                    }
+                    outputNum++;
+                }
+            }
+        };
+        
+        /** The input values, types and addresses, taken from the cache by MaskCollector */
+        int64_t smallestInputValue(const Transaction &tx) {
+            auto smallestInputValue = std::numeric_limits<int64_t>::max();
+            RANGES_FOR(auto input, tx.inputs()) {
+                smallestInputValue = std::min(smallestInputValue, input.getValue());
+            }
+            return smallestInputValue;
+        }
+        
+        ranges::optional<AddressType::Enum> uniformInputType(const Transaction &tx) {
+            if (tx.inputCount() == 0) {
+                return ranges::nullopt;
+            }
+            AddressType::Enum inputType = tx.inputs()[0].getType();
+            RANGES_FOR(auto input, tx.inputs()) {
+                if (input.getType() != inputType) {
+                    return ranges::nullopt;
+                }
+            }
+            return inputType;
+        }
+        
+        std::shared_ptr<const std::unordered_set<Address>> inputAddresses(const Transaction &tx) {
+            auto addresses = std::make_shared<std::unordered_set<Address>>();
+            RANGES_FOR(auto input, tx.inputs()) {
+                addresses->insert(input.getAddress());
+            }
+            return addresses;
+        }
+        
+        int64_t ChangeTxCache::getSmallestInputValue() {
+            if (!smallestInput) {
+                smallestInput = smallestInputValue(*tx);
+            }
+            return *smallestInput;
+        }
+        
+        ranges::optional<AddressType::Enum> ChangeTxCache::getInputType() {
+            if (!inputType) {
+                inputType = uniformInputType(*tx);
+            }
+            return *inputType;
+        }
+        
+        std::shared_ptr<const std::unordered_set<Address>> ChangeTxCache::getInputAddresses() {
+            if (!inputAddresses) {
+                inputAddresses = heuristics::inputAddresses(*tx);
+            }
+            return inputAddresses;
+        }
+        
+        template <typename Collector>
+        int64_t smallestInputValue(const Collector &collector) {
+            return smallestInputValue(collector.tx);
+        }
+        
+        int64_t smallestInputValue(const MaskCollector &collector) {
+            return collector.cache.getSmallestInputValue();
+        }
+        
+        template <typename Collector>
+        ranges::optional<AddressType::Enum> uniformInputType(const Collector &collector) {
+            return uniformInputType(collector.tx);
+        }
+        
+        ranges::optional<AddressType::Enum> uniformInputType(const MaskCollector &collector) {
+            return collector.cache.getInputType();
+        }
+        
+        template <typename Collector>
+        std::shared_ptr<const std::unordered_set<Address>> inputAddresses(const Collector &collector) {
+            return inputAddresses(collector.tx);
+        }
+        
+        std::shared_ptr<const std::unordered_set<Address>> inputAddresses(const MaskCollector &collector) {
+            return collector.cache.getInputAddresses();
+        }
+        
+        /** Looks up the transaction spending an output, used by the predicates and so safe to copy into a lazy range */
+        struct DirectSpendingTx {
+            ranges::optional<Transaction> operator()(const Output &output) const {
+                return output.getSpendingTx();
+            }
+        };
+        
+        struct CachedSpendingTx {
+            ChangeTxCache *cache;
+            
+            ranges::optional<Transaction> operator()(const Output &output) const {
+                return cache->getSpendingTx(output.pointer.inoutNum);
+            }
+        };
+        
+        template <typename Collector>
+        DirectSpendingTx spendingTxLookup(const Collector &) {
+            return {};
+        }
+        
+        CachedSpendingTx spendingTxLookup(const MaskCollector &collector) {
+            return {&collector.cache};
+        }
+    }
+    
     /** In a peeling chain, the change output is the output that continues the chain
      *
      * Note: This heuristic depends on the outputs being spent to detect change.
      * If an output has not been spent, it is considered a potential change output.
      */
-    template<>
-    ranges::any_view<Output> ChangeHeuristicImpl<ChangeType::PeelingChain>::operator()(const Transaction &tx) const {
+    template <typename Collector>
+    typename Collector::result_type peelingChainChange(const Collector &collector) {
         // If current tx is not a peeling chain, return an empty set
-        if (!isPeelingChain(tx)) {
-            return ranges::views::empty<Output>;
+        if (!isPeelingChain(collector.tx)) {
+            return collector.none();
         }
         
         // Check which output(s) continue the peeling chain
-        return tx.outputs() | ranges::views::filter([](Output o){return !o.isSpent() || isPeelingChain(*o.getSpendingTx());}) | ranges::views::filter(filterOpReturn);
+        auto spendingTx = spendingTxLookup(collector);
+        return collector.spendable([spendingTx](Output o){return !o.isSpent() || isPeelingChain(*spendingTx(o));});
     }
 
     /** Returns 10^{digits} */
@@ -66,9 +322,10 @@ namespace blocksci { namespace heuristics {
      * On the other hand, it is extremely unlikely that you receive power of ten change due to a wallet's coin selection.
      * Default for digits is 6 (i.e. it selects outputs with a value that is a multiple of 0.01 BTC)
      */
-    ranges::any_view<Output> ChangeHeuristicImpl<ChangeType::PowerOfTen>::operator()(const Transaction &tx) const {
+    template <typename Collector>
+    typename Collector::result_type powerOfTenChange(const Collector &collector, int digits) {
         int64_t value = int_pow_ten(digits);
-        return tx.outputs() | ranges::views::filter([value](Output o){return o.getValue() % value != 0;}) | ranges::views::filter(filterOpReturn);
+        return collector.spendable([value](Output o){return o.getValue() % value != 0;});
     }
     
     
@@ -77,32 +334,26 @@ namespace blocksci { namespace heuristics {
      * If a change output was larger than the smallest input, then the coin selection algorithm
      * wouldn't need to add the input in the first place.
      */
-    template<>
-    ranges::any_view<Output> ChangeHeuristicImpl<ChangeType::OptimalChange>::operator()(const Transaction &tx) const {
-        auto smallestInputValue = tx.inputs()[0].getValue();
-        RANGES_FOR(auto input, tx.inputs()) {
-            smallestInputValue = std::min(smallestInputValue, input.getValue());
+    template <typename Collector>
+    typename Collector::result_type optimalChangeChange(const Collector &collector) {
+        // Without inputs, as in coinbase transactions, no output can be ruled out by size
+        if (collector.tx.inputCount() == 0) {
+            return collector.none();
         }
-        return tx.outputs() | ranges::views::filter([smallestInputValue](Output o){return o.getValue() < smallestInputValue;}) | ranges::views::filter(filterOpReturn);
+        auto smallestInputValue = heuristics::smallestInputValue(collector);
+        return collector.spendable([smallestInputValue](Output o){return o.getValue() < smallestInputValue;});
     }
     
     /** If all inputs are of one address type (e.g., P2PKH or P2SH), it is likely that the change output has the same type. */
-    template<>
-    ranges::any_view<Output> ChangeHeuristicImpl<ChangeType::AddressType>::operator()(const Transaction &tx) const {
+    template <typename Collector>
+    typename Collector::result_type addressTypeChange(const Collector &collector) {
         // check whether all inputs have the same type (e.g., P2SH)
-        bool allInputsSameType = true;
-        AddressType::Enum inputType = tx.inputs()[0].getType();
-        RANGES_FOR(auto input, tx.inputs()) {
-            if (input.getType() != inputType) {
-                allInputsSameType = false;
-                break;
-            }
-        }
-        
-        if (allInputsSameType) {
-            return tx.outputs() | ranges::views::filter([inputType](Output o){return o.getType() == inputType;}) | ranges::views::filter(filterOpReturn);
+        auto inputType = uniformInputType(collector);
+        if (inputType) {
+            auto type = *inputType;
+            return collector.spendable([type](Output o){return o.getType() == type;});
         } else {
-            return ranges::views::empty<Output>;
+            return collector.none();
         }
     }
     
@@ -114,30 +365,28 @@ namespace blocksci { namespace heuristics {
      * This heuristic depends on the outputs being spent to detect change.
      * If an output has not been spent, it is considered a potential change output.
      */
-    template<>
-    ranges::any_view<Output> ChangeHeuristicImpl<ChangeType::Locktime>::operator()(const Transaction &tx) const {
-        bool locktimeGreaterZero = tx.locktime() > 0;
-        return tx.outputs() | ranges::views::filter([locktimeGreaterZero](Output o){return !o.isSpent() || (o.getSpendingTx().value().locktime() > 0) == locktimeGreaterZero;}) | ranges::views::filter(filterOpReturn);
+    template <typename Collector>
+    typename Collector::result_type locktimeChange(const Collector &collector) {
+        bool locktimeGreaterZero = collector.tx.locktime() > 0;
+        auto spendingTx = spendingTxLookup(collector);
+        return collector.spendable([locktimeGreaterZero, spendingTx](Output o){return !o.isSpent() || (spendingTx(o).value().locktime() > 0) == locktimeGreaterZero;});
     }
 
     /** If input addresses appear as an output address, the client might have reused addresses for change. */
-    template<>
-    ranges::any_view<Output> ChangeHeuristicImpl<ChangeType::AddressReuse>::operator()(const Transaction &tx) const {
-        std::unordered_set<Address> inputAddresses;
-        RANGES_FOR(auto input, tx.inputs()) {
-            inputAddresses.insert(input.getAddress());
-        }
-        
-        return tx.outputs() | ranges::views::filter([inputAddresses](Output o){return inputAddresses.find(o.getAddress()) != inputAddresses.end();}) | ranges::views::filter(filterOpReturn);
+    template <typename Collector>
+    typename Collector::result_type addressReuseChange(const Collector &collector) {
+        auto addresses = inputAddresses(collector);
+        return collector.spendable([addresses](Output o){return addresses->find(o.getAddress()) != addresses->end();});
     }
 
     /** Most clients will generate a fresh address for the change.
      *
      * If an output is the first to send value to an address, it is potentially the change.
      */
-    template<>
-    ranges::any_view<Output> ChangeHeuristicImpl<ChangeType::ClientChangeAddressBehavior>::operator()(const Transaction &tx) const {
-        return tx.outputs() | ranges::views::filter([tx](Output o){return o.getAddress().isSpendable() && o.getAddress().getBaseScript().getFirstTxIndex() == tx.txNum;}) | ranges::views::filter(filterOpReturn);
+    template <typename Collector>
+    typename Collector::result_type clientChangeAddressBehaviorChange(const Collector &collector) {
+        auto txNum = collector.tx.txNum;
+        return collector.spendable([txNum](Output o){return o.getAddress().isSpendable() && o.getAddress().getFirstTxIndex() == txNum;});
     }
     
     /** Legacy heuristic used in previous versions of BlockSci */
@@ -173,35 +422,137 @@ namespace blocksci { namespace heuristics {
     
     // This function mostly exists to ensure a consistent API.
     // The set it returns will never contain more than one output.
-    template<>
-    ranges::any_view<Output> ChangeHeuristicImpl<ChangeType::Legacy>::operator()(const Transaction &tx) const {
-        auto c = uniqueChangeByLegacyHeuristic(tx);
+    template <typename Collector>
+    typename Collector::result_type legacyChange(const Collector &collector) {
+        auto c = uniqueChangeByLegacyHeuristic(collector.tx);
         if (c.has_value()) {
-            return ranges::views::single(c.value());
+            return collector.single(c.value());
         }
-        return ranges::views::empty<Output>;
+        return collector.none();
     }
 
     /** Clients may choose a fixed fee per kb instead of using one based on the current fee market. */
-    template<>
-    ranges::any_view<Output> ChangeHeuristicImpl<ChangeType::FixedFee>::operator()(const Transaction &tx) const {
+    template <typename Collector>
+    typename Collector::result_type fixedFeeChange(const Collector &collector) {
+        const auto &tx = collector.tx;
         auto fee = tx.fee() * 1000 / tx.virtualSize();
-        return tx.outputs() | ranges::views::filter([fee](Output o) {return !o.isSpent() || (o.getSpendingTx()->fee() * 1000 / o.getSpendingTx()->virtualSize()) == fee;}) | ranges::views::filter(filterOpReturn);
+        auto spendingTx = spendingTxLookup(collector);
+        return collector.spendable([fee, spendingTx](Output o) {
+            if (!o.isSpent()) {
+                return true;
+            }
+            auto spending = spendingTx(o);
+            return (spending->fee() * 1000 / spending->virtualSize()) == fee;
+        });
     }
     
     /** Disables change address clustering by returning an empty set. */
-    template<>
-    ranges::any_view<Output> ChangeHeuristicImpl<ChangeType::None>::operator()(const Transaction &) const {
-        return ranges::views::empty<Output>;
+    template <typename Collector>
+    typename Collector::result_type noChange(const Collector &collector) {
+        return collector.none();
     }
     
     /** Returns all outputs that have been spent.
      *
      * This is useful in combination with change address heuristics that return unspent outputs as candidates.
      */
-    template<>
-    ranges::any_view<Output> ChangeHeuristicImpl<ChangeType::Spent>::operator()(const Transaction &tx) const {
-        return tx.outputs() | ranges::views::filter([](Output o){return o.isSpent();});
+    template <typename Collector>
+    typename Collector::result_type spentChange(const Collector &collector) {
+        return collector.all([](Output o){return o.isSpent();});
+    }
+    
+    #define CHANGE_HEURISTIC_IMPL(type, func) \
+    template<> \
+    ranges::any_view<Output> ChangeHeuristicImpl<ChangeType::type>::operator()(const Transaction &tx) const { \
+        return func(ViewCollector{tx}); \
+    } \
+    template<> \
+    void ChangeHeuristicImpl<ChangeType::type>::appendChange(const Transaction &tx, std::vector<Output> &change) const { \
+        func(VectorCollector{tx, change}); \
+    }
+    
+    CHANGE_HEURISTIC_IMPL(PeelingChain, peelingChainChange)
+    CHANGE_HEURISTIC_IMPL(OptimalChange, optimalChangeChange)
+    CHANGE_HEURISTIC_IMPL(AddressType, addressTypeChange)
+    CHANGE_HEURISTIC_IMPL(Locktime, locktimeChange)
+    CHANGE_HEURISTIC_IMPL(AddressReuse, addressReuseChange)
+    CHANGE_HEURISTIC_IMPL(ClientChangeAddressBehavior, clientChangeAddressBehaviorChange)
+    CHANGE_HEURISTIC_IMPL(Legacy, legacyChange)
+    CHANGE_HEURISTIC_IMPL(FixedFee, fixedFeeChange)
+    CHANGE_HEURISTIC_IMPL(None, noChange)
+    CHANGE_HEURISTIC_IMPL(Spent, spentChange)
+    
+    #undef CHANGE_HEURISTIC_IMPL
+    
+    ranges::any_view<Output> ChangeHeuristicImpl<ChangeType::PowerOfTen>::operator()(const Transaction &tx) const {
+        return powerOfTenChange(ViewCollector{tx}, digits);
+    }
+    
+    void ChangeHeuristicImpl<ChangeType::PowerOfTen>::appendChange(const Transaction &tx, std::vector<Output> &change) const {
+        powerOfTenChange(VectorCollector{tx, change}, digits);
+    }
+    
+    namespace {
+        void evaluateHeuristic(ChangeType::Enum heuristic, const MaskCollector &collector, int powerOfTenDigits) {
+            switch (heuristic) {
+                case ChangeType::PeelingChain:
+                    return peelingChainChange(collector);
+                case ChangeType::PowerOfTen:
+                    return powerOfTenChange(collector, powerOfTenDigits);
+                case ChangeType::OptimalChange:
+                    return optimalChangeChange(collector);
+                case ChangeType::AddressType:
+                    return addressTypeChange(collector);
+                case ChangeType::Locktime:
+                    return locktimeChange(collector);
+                case ChangeType::AddressReuse:
+                    return addressReuseChange(collector);
+                case ChangeType::ClientChangeAddressBehavior:
+                    return clientChangeAddressBehaviorChange(collector);
+                case ChangeType::Legacy:
+                    return legacyChange(collector);
+                case ChangeType::FixedFee:
+                    return fixedFeeChange(collector);
+                case ChangeType::None:
+                    return noChange(collector);
+                case ChangeType::Spent:
+                    return spentChange(collector);
+            }
+        }
+    }
+    
+    std::vector<uint32_t> evaluateChange(BlockRange &blocks, const std::vector<ChangeType::Enum> &heuristics, int powerOfTenDigits, uint32_t threadCount) {
+        if (heuristics.size() > 32) {
+            throw std::invalid_argument("At most 32 change heuristics can be evaluated at once");
+        }
+        if (blocks.size() == 0) {
+            return {};
+        }
+        auto &chain = blocks.getAccess().getChain();
+        auto firstOutputNum = [&](uint32_t txNum) {
+            return txNum < chain.txCount() ? chain.getFirstOutputNumber(txNum) : chain.outputCount();
+        };
+        auto rangeFirstOutputNum = firstOutputNum(blocks.firstTxIndex());
+        std::vector<uint32_t> masks(firstOutputNum(blocks.endTxIndex()) - rangeFirstOutputNum, 0);
+        
+        auto segments = blocks.segment(resolveThreadCount(threadCount));
+        auto segmentCount = static_cast<uint32_t>(segments.size());
+        segmentWork(0, segmentCount, segmentCount, [&](uint32_t segmentNum) {
+            const auto &segment = segments[segmentNum];
+            segment.adviseAccess(AccessHint::WillNeed);
+            auto txMasks = masks.data() + (firstOutputNum(segment.firstTxIndex()) - rangeFirstOutputNum);
+            ChangeTxCache cache;
+            for (auto block : segment) {
+                for (auto tx : block) {
+                    cache.reset(tx);
+                    for (size_t i = 0; i < heuristics.size(); i++) {
+                        evaluateHeuristic(heuristics[i], MaskCollector{tx, cache, txMasks, uint32_t{1} << i}, powerOfTenDigits);
+                    }
+                    txMasks += tx.outputCount();
+                }
+            }
+        });
+        return masks;
     }
 }  // namespace heuristics
 }  // namespace blocksci
@@ -0,0 +1,111 @@
+//
+//  peeling_chain.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include <blocksci/heuristics/peeling_chain.hpp>
+#include <blocksci/heuristics/tx_identification.hpp>
+#include <blocksci/chain/output.hpp>
+#include <blocksci/chain/transaction.hpp>
+
+#include <internal/segment_work.hpp>
+
+#include <range/v3/range_for.hpp>
+
+#include <algorithm>
+
+namespace blocksci { namespace heuristics {
+
+    namespace {
+        /** Next transaction of a chain that is still being followed */
+        struct FrontierEntry {
+            uint32_t txNum;
+            uint32_t chainNum;
+
+            bool operator<(const FrontierEntry &other) const {
+                return txNum < other.txNum;
+            }
+        };
+
+        // Transactions looked up in one getTransactions call
+        constexpr uint32_t lookupBatchSize = 4096;
+
+        // txNum 0 is the genesis coinbase, which never spends an output
+        constexpr uint32_t noNextTx = 0;
+    }
+
+    std::vector<PeelingChain> followPeelingChains(const std::vector<Output> &starts, uint32_t maxHops, const PeelingChainPredicate &predicate, uint32_t threadCount) {
+        std::vector<PeelingChain> chains(starts.size(), PeelingChain{{}, PeelingChainEnd::Unspent});
+        if (starts.empty()) {
+            return chains;
+        }
+        auto &access = starts.front().getAccess();
+        PeelingChainPredicate matches = predicate ? predicate : PeelingChainPredicate{looksLikePeelingChain};
+        threadCount = resolveThreadCount(threadCount);
+
+        std::vector<FrontierEntry> frontier;
+        for (uint32_t i = 0; i < starts.size(); i++) {
+            if (auto spendingTx = starts[i].getSpendingTxIndex()) {
+                frontier.push_back({*spendingTx, i});
+            }
+        }
+
+        for (uint32_t hop = 0; !frontier.empty(); hop++) {
+            if (hop == maxHops) {
+                for (auto &entry : frontier) {
+                    chains[entry.chainNum].end = PeelingChainEnd::MaxHops;
+                }
+                break;
+            }
+            // Neighbouring hops of different chains often share pages, sorting makes the batches walk the files in order
+            std::sort(frontier.begin(), frontier.end());
+            std::vector<FrontierEntry> next(frontier.size(), FrontierEntry{noNextTx, 0});
+            auto frontierSize = static_cast<uint32_t>(frontier.size());
+            runSegments(splitSegments(0, frontierSize, threadCount), [&](uint32_t, uint32_t segmentStart, uint32_t segmentEnd) {
+                std::vector<uint32_t> txNums;
+                for (uint32_t batchStart = segmentStart; batchStart < segmentEnd; batchStart += lookupBatchSize) {
+                    auto batchEnd = std::min(batchStart + lookupBatchSize, segmentEnd);
+                    txNums.clear();
+                    for (uint32_t i = batchStart; i < batchEnd; i++) {
+                        txNums.push_back(frontier[i].txNum);
+                    }
+                    auto txes = getTransactions(txNums, access);
+                    for (uint32_t i = batchStart; i < batchEnd; i++) {
+                        auto &tx = txes[i - batchStart];
+                        auto &chain = chains[frontier[i].chainNum];
+                        if (tx.outputCount() == 0 || !matches(tx)) {
+                            chain.end = PeelingChainEnd::NotPeeling;
+                            continue;
+                        }
+                        auto outputs = tx.outputs();
+                        uint16_t largest = 0;
+                        int64_t total = 0;
+                        for (uint16_t j = 0; j < outputs.size(); j++) {
+                            auto value = outputs.inouts[j].getValue();
+                            total += value;
+                            if (value > outputs.inouts[largest].getValue()) {
+                                largest = j;
+                            }
+                        }
+                        auto continuing = outputs[largest];
+                        chain.hops.push_back({tx.txNum, tx.getBlockHeight(), largest, continuing.getValue(), total - continuing.getValue()});
+                        if (auto spendingTx = continuing.getSpendingTxIndex()) {
+                            next[i] = {*spendingTx, frontier[i].chainNum};
+                        } else {
+                            chain.end = PeelingChainEnd::Unspent;
+                        }
+                    }
+                }
+            });
+            next.erase(std::remove_if(next.begin(), next.end(), [](const FrontierEntry &entry) { return entry.txNum == noNextTx; }), next.end());
+            frontier = std::move(next);
+        }
+        return chains;
+    }
+
+    PeelingChain followPeelingChain(const Output &start, uint32_t maxHops, const PeelingChainPredicate &predicate) {
+        return followPeelingChains({start}, maxHops, predicate, 1).front();
+    }
+}}
@@ -10,13 +10,21 @@
 #include <blocksci/chain/algorithms.hpp>
 #include <blocksci/chain/block.hpp>
 #include <blocksci/chain/block_range.hpp>
+#include <blocksci/chain/transaction.hpp>
 
 #include <internal/data_access.hpp>
 #include <internal/chain_access.hpp>
+#include <internal/progress_bar.hpp>
+#include <internal/segment_work.hpp>
+#include <internal/source_taint.hpp>
+#include <internal/tracing.hpp>
 
+#include <algorithm>
+#include <cassert>
 #include <numeric>
-#include <map>
-#include <unordered_map>
+#include <stdexcept>
+#include <string>
+#include <tuple>
 
 #include <iostream>
 
@@ -78,6 +86,14 @@ namespace blocksci { namespace heuristics {
         return taintedValue;
     }
     
+    bool hasTaint(const MultiTaint &val) {
+        return !val.seeds.empty();
+    }
+    
+    bool hasTaint(const SourceTaint &val) {
+        return !val.empty();
+    }
+    
     template<typename Taint>
     struct UntaintedInputCreator {
         Taint operator()(int64_t value);
@@ -96,65 +112,89 @@ namespace blocksci { namespace heuristics {
         return taint;
     }
     
-    struct InoutInfo {
-        uint32_t txNum;
-        OutputPointer pointer;
-        
-        bool operator<(const InoutInfo& other) const {
-            return std::tie(txNum, pointer) < std::tie(other.txNum, other.pointer);
-        }
-        
-        bool operator==(const InoutInfo& other) const {
-            return txNum == other.txNum && pointer == other.pointer;
-        }
-    };
-}}
-
-namespace std {
-    template<> struct BLOCKSCI_EXPORT hash<blocksci::heuristics::InoutInfo> {
-        size_t operator()(const blocksci::heuristics::InoutInfo &info) const {
-            std::size_t seed = 76547;
-            blocksci::hash_combine(seed, info.txNum);
-            blocksci::hash_combine(seed, info.pointer);
-            return seed;
-        }
-    };
-} // namespace std
-
-namespace blocksci { namespace heuristics {
-    template <typename Taint>
-    using TaintMap = std::map<InoutInfo, Taint>;
+    template<>
+    MultiTaint UntaintedInputCreator<MultiTaint>::operator()(int64_t value) {
+        return {value, {}};
+    }
     
-    // Process an output and its associated taint value
-    // If output has been spent, add the corresponding input to the list of tainted inputs
-    // If output is unspent, add it to the list of tainted outputs
-    template <typename Taint>
-    void processOutput(TaintMap<Taint> &taintedInputs, std::unordered_map<OutputPointer, Taint> &taintedOutputs, const Output &spendingOut, Taint &newTaintedValue) {
-        // Ignore untainted outputs
-        if (hasTaint(newTaintedValue)) {
-            auto spendingTx = spendingOut.getSpendingTxIndex();
-            if (spendingTx) {
-                InoutInfo info{*spendingTx, spendingOut.pointer};
-                auto it = taintedInputs.find(info);
-                if (it == taintedInputs.end()) { // check if output was passed in originally as fully tainted
-                    taintedInputs.insert(std::make_pair(info, std::move(newTaintedValue)));
-                }
-            } else {
-                auto it = taintedOutputs.find(spendingOut.pointer);
-                if (it == taintedOutputs.end()) { // check if output was passed in originally as fully tainted
-                    taintedOutputs.insert(std::make_pair(spendingOut.pointer, std::move(newTaintedValue)));
-                }
-            }
+    template<>
+    SourceTaint UntaintedInputCreator<SourceTaint>::operator()(int64_t value) {
+        return SourceTaint{value};
+    }
+    
+    // A seed output keeps the taint it was given, only the traces it isn't a seed of can add to it. Taint of a
+    // single trace is dropped completely.
+    bool excludeSeeded(SimpleTaint &, const SimpleTaint &) {
+        return false;
+    }
+    
+    bool excludeSeeded(ComplexTaint &, const ComplexTaint &) {
+        return false;
+    }
+    
+    bool excludeSeeded(SourceTaint &, const SourceTaint &) {
+        return false;
+    }
+    
+    bool excludeSeeded(MultiTaint &taint, const MultiTaint &seedTaint) {
+        auto &seeds = seedTaint.seeds;
+        taint.seeds.erase(std::remove_if(taint.seeds.begin(), taint.seeds.end(), [&](const std::pair<uint32_t, int64_t> &entry) {
+            return std::binary_search(seeds.begin(), seeds.end(), entry, [](const auto &a, const auto &b) {
+                return a.first < b.first;
+            });
+        }), taint.seeds.end());
+        return hasTaint(taint);
+    }
+    
+    // Combine two taints of the same output, a single trace keeps the first
+    void mergeTaint(SimpleTaint &, SimpleTaint &&) {}
+    
+    void mergeTaint(ComplexTaint &, ComplexTaint &&) {}
+    
+    void mergeTaint(SourceTaint &, SourceTaint &&) {}
+    
+    void mergeTaint(MultiTaint &taint, MultiTaint &&other) {
+        std::vector<std::pair<uint32_t, int64_t>> seeds;
+        seeds.reserve(taint.seeds.size() + other.seeds.size());
+        std::merge(taint.seeds.begin(), taint.seeds.end(), other.seeds.begin(), other.seeds.end(), std::back_inserter(seeds), [](const auto &a, const auto &b) {
+            return a.first < b.first;
+        });
+        // The same trace can't reach an output twice, but duplicate seeds of one trace are combined
+        seeds.erase(std::unique(seeds.begin(), seeds.end(), [](const auto &a, const auto &b) {
+            return a.first == b.first;
+        }), seeds.end());
+        taint.seeds = std::move(seeds);
+    }
+    
+    void appendSegment(ComplexTaint &taint, int64_t value, bool isTainted) {
+        if (value <= 0) {
+            return;
+        }
+        if (!taint.empty() && taint.back().second == isTainted) {
+            taint.back().first += value;
+        } else {
+            taint.emplace_back(value, isTainted);
         }
     }
     
-    // Pass all outputs of a transaction and the corresponding taint to processOutput()
+    /** Tainted output waiting for the transaction spending it to be processed */
     template <typename Taint>
-    void processTx(TaintMap<Taint> &taintedInputs, std::unordered_map<OutputPointer, Taint> &taintedOutputs, const Transaction &tx, std::vector<Taint> &outputTaint) {
-        assert(outputTaint.size() == tx.outputCount());
-        for (uint16_t i = 0; i < tx.outputCount(); i++) {
-            processOutput(taintedInputs, taintedOutputs, tx.outputs()[i], outputTaint[i]);
+    struct FrontierEntry {
+        uint32_t txNum;
+        OutputPointer pointer;
+        Taint taint;
+    };
+    
+    /** Heap order of the frontier, the entry with the smallest spending txNum is on top */
+    struct LaterFrontierEntry {
+        template <typename Taint>
+        bool operator()(const FrontierEntry<Taint> &a, const FrontierEntry<Taint> &b) const {
+            return std::tie(b.txNum, b.pointer) < std::tie(a.txNum, a.pointer);
         }
+    };
+    
+    uint64_t packPointer(const OutputPointer &pointer) {
+        return (uint64_t{pointer.txNum} << 16) | pointer.inoutNum;
     }
     
     void clearTaint(SimpleTaint &taint) {
@@ -166,6 +206,15 @@ namespace blocksci { namespace heuristics {
         taint.clear();
     }
     
+    void clearTaint(MultiTaint &taint) {
+        taint.value = 0;
+        taint.seeds.clear();
+    }
+    
+    void clearTaint(SourceTaint &taint) {
+        taint.clear();
+    }
+    
     // Return the expected reward for a block
     int64_t getSubsidy(Block &block) {
         auto chainName = block.getAccess().config.chainConfig.coinName;
@@ -191,103 +240,315 @@ namespace blocksci { namespace heuristics {
         return subsidy;
     }
     
-    // Propagate taint
-    template <typename Func, typename Taint>
-    std::vector<std::pair<Output, Taint>> getTaintedImpl(Func func, std::vector<std::pair<Output, Taint>> &taintedOutputsRaw, BlockHeight maxBlockHeight, bool taintFee) {
-        assert(taintedOutputsRaw.size() > 0);
+    /** Propagates taint through the transaction graph in txNum order
+     *
+     * The frontier holds the tainted outputs whose spending transaction hasn't been processed yet in a min-heap ordered
+     * by spending txNum, so an output is dropped from memory as soon as it is spent and only the outputs tainted at the
+     * same time are held. The frontier is drained one block at a time: the spending transactions of all entries in the
+     * block are fetched with one batched lookup, and the coinbase of the block is processed once the fee taint of all
+     * of its tainted transactions is known. Blocks without tainted transactions are never read.
+     *
+     * The taint of the transactions of a batch that don't spend outputs of other transactions in the batch is computed
+     * on up to threadCount threads. Their outputs are then added to the frontier in txNum order, followed by the
+     * transactions that had to wait for them, so the result doesn't depend on the thread count.
+     *
+     * func(tx, inputTaint, outputTaint, feeTaint) computes the taint of the outputs and the fee of a transaction from
+     * the taint of its inputs, it must be safe to call concurrently.
+     */
+    template <typename Taint, typename Func>
+    class TaintEngine {
+        // Smaller batches are processed on the calling thread
+        static constexpr size_t parallelBatchSize = 64;
         
-        auto &access = taintedOutputsRaw[0].first.getAccess();
+        DataAccess &access;
+        ChainAccess &chain;
+        Func func;
+        bool taintFee;
+        bool useSpendingInputs;
+        uint32_t threadCount;
         
-        TaintMap<Taint> taintedInputs;
+        std::vector<FrontierEntry<Taint>> frontier;
+        // Taint of the seed outputs sorted by packed pointer, which they keep even if a tainted transaction creates them
+        std::vector<std::pair<uint64_t, Taint>> seedTaints;
+        std::vector<std::pair<OutputPointer, Taint>> unspentOutputs;
         
-        std::unordered_map<OutputPointer, Taint> taintedOutputs;
+        /** Transactions of the batch being processed and the taint of their spent outputs */
+        struct Batch {
+            std::vector<uint32_t> txNums;
+            std::vector<std::vector<std::pair<OutputPointer, Taint>>> inputs;
+        };
         
-        if (maxBlockHeight == -1) {
-            maxBlockHeight = access.getChain().blockCount();
-        } else {
-            // Range should include block at maxBlockHeight
-            maxBlockHeight += 1;
-            // Range shouldn't be larger than chain size
-            maxBlockHeight = std::min(maxBlockHeight, access.getChain().blockCount());
+        /** Taint computed for a transaction of the batch */
+        struct TxResult {
+            std::vector<Taint> outputTaint;
+            Taint feeTaint;
+        };
+        
+        const Taint *findSeed(const OutputPointer &pointer) const {
+            auto packed = packPointer(pointer);
+            auto it = std::lower_bound(seedTaints.begin(), seedTaints.end(), packed, [](const std::pair<uint64_t, Taint> &seed, uint64_t p) {
+                return seed.first < p;
+            });
+            return it != seedTaints.end() && it->first == packed ? &it->second : nullptr;
+        }
+        
+        void pushFrontier(uint32_t txNum, const OutputPointer &pointer, Taint &&taint) {
+            frontier.push_back(FrontierEntry<Taint>{txNum, pointer, std::move(taint)});
+            std::push_heap(frontier.begin(), frontier.end(), LaterFrontierEntry{});
+        }
+        
+        // Outputs spent later in the current batch are handed to their transaction directly, they were already taken
+        // out of the frontier
+        void addOutput(const Output &output, Taint &&taint, Batch *batch) {
+            if (!hasTaint(taint)) {
+                return;
+            }
+            auto seedTaint = findSeed(output.pointer);
+            if (seedTaint && !excludeSeeded(taint, *seedTaint)) {
+                return;
+            }
+            auto spendingTx = output.getSpendingTxIndex();
+            if (!spendingTx) {
+                unspentOutputs.emplace_back(output.pointer, std::move(taint));
+                return;
+            }
+            if (batch) {
+                auto it = std::lower_bound(batch->txNums.begin(), batch->txNums.end(), *spendingTx);
+                if (it != batch->txNums.end() && *it == *spendingTx) {
+                    batch->inputs[static_cast<size_t>(it - batch->txNums.begin())].emplace_back(output.pointer, std::move(taint));
+                    return;
+                }
+            }
+            pushFrontier(*spendingTx, output.pointer, std::move(taint));
+        }
+        
+        void addOutputs(const Transaction &tx, std::vector<Taint> &outputTaint, Batch *batch) {
+            assert(outputTaint.size() == tx.outputCount());
+            for (uint16_t i = 0; i < tx.outputCount(); i++) {
+                addOutput(tx.outputs()[i], std::move(outputTaint[i]), batch);
+            }
         }
         
-        BlockHeight minHeight = std::numeric_limits<BlockHeight>::max();
-        for(std::pair<Output, Taint> &taintedOutput : taintedOutputsRaw){
-            // Add outputs to map of tainted outputs
-            processOutput(taintedInputs, taintedOutputs, taintedOutput.first, taintedOutput.second);
+        // Only reads the chain, so it runs concurrently for the transactions of a batch
+        TxResult computeTx(const Transaction &tx, std::vector<std::pair<OutputPointer, Taint>> &taintedInputs) const {
+            std::vector<Taint> inputTaint;
+            inputTaint.reserve(tx.inputCount());
+            for (auto input : tx.inputs()) {
+                inputTaint.emplace_back(UntaintedInputCreator<Taint>{}(input.getValue()));
+            }
+            // An output can arrive twice, as a seed and with the taint of the other traces
+            std::vector<bool> placed(tx.inputCount(), false);
+            auto place = [&](uint16_t inputNum, Taint &&taint) {
+                if (placed[inputNum]) {
+                    mergeTaint(inputTaint[inputNum], std::move(taint));
+                } else {
+                    inputTaint[inputNum] = std::move(taint);
+                    placed[inputNum] = true;
+                }
+            };
+            if (useSpendingInputs) {
+                // Place the tainted outputs at the position of their spending input instead of searching the inputs
+                for (auto &tainted : taintedInputs) {
+                    const auto &pointer = tainted.first;
+                    auto inputNum = chain.getSpendingInputNum(chain.getFirstOutputNumber(pointer.txNum) + pointer.inoutNum);
+                    assert(inputNum);
+                    place(*inputNum, std::move(tainted.second));
+                }
+            } else {
+                std::sort(taintedInputs.begin(), taintedInputs.end(), [](const auto &a, const auto &b) {
+                    return a.first < b.first;
+                });
+                uint16_t inputNum = 0;
+                for (auto input : tx.inputs()) {
+                    auto pointer = input.getSpentOutputPointer();
+                    auto it = std::lower_bound(taintedInputs.begin(), taintedInputs.end(), pointer, [](const auto &tainted, const OutputPointer &p) {
+                        return tainted.first < p;
+                    });
+                    for (; it != taintedInputs.end() && it->first == pointer; ++it) {
+                        place(inputNum, std::move(it->second));
+                    }
+                    inputNum++;
+                }
+            }
             
-            minHeight = std::min(minHeight, taintedOutput.first.getBlockHeight());
+            TxResult result;
+            result.outputTaint.reserve(tx.outputCount());
+            clearTaint(result.feeTaint);
+            func(tx, inputTaint, result.outputTaint, result.feeTaint);
+            return result;
         }
         
-        BlockRange blocks{{minHeight, maxBlockHeight}, &access};
-        std::vector<Taint> txOutputTaint;
-        std::vector<Taint> txInputTaint;
-        Taint coinbaseTaint;
-        clearTaint(coinbaseTaint);
-        for (auto block : blocks) {
-            if (taintedInputs.begin()->first.txNum >= block.endTxIndex()) {
-                continue;
-            }
-            std::vector<Taint> coinbaseTaintList;
-            coinbaseTaintList.reserve(block.size());
+        void processCoinbase(Block &block, std::vector<std::pair<uint32_t, Taint>> &feeTaints) {
+            std::sort(feeTaints.begin(), feeTaints.end(), [](const auto &a, const auto &b) {
+                return a.first < b.first;
+            });
+            std::vector<Taint> coinbaseInputs;
+            coinbaseInputs.reserve(block.size());
+            coinbaseInputs.emplace_back(UntaintedInputCreator<Taint>{}(getSubsidy(block)));
+            auto feeIt = feeTaints.begin();
             for (auto tx : block[{1, block.size()}]) {
-                txOutputTaint.clear();
-                txOutputTaint.reserve(tx.outputCount());
-                clearTaint(coinbaseTaint);
-                txInputTaint.clear();
-                txInputTaint.reserve(tx.inputCount());
-                
-                // Transactions are processed in chronological order
-                // If any input has taint, it must be at the beginning of the ordered taint map
-                if (taintedInputs.begin()->first.txNum == tx.txNum) {
-                    // Find tainted outputs spent in this transaction
-                    for (auto input : tx.inputs()) {
-                        InoutInfo info{tx.txNum, input.getSpentOutputPointer()};
-                        auto it = taintedInputs.find(info);
-                        if (it != taintedInputs.end()) {
-                            txInputTaint.emplace_back(std::move(it->second));
-                            taintedInputs.erase(it);
-                        } else {
-                            txInputTaint.emplace_back(UntaintedInputCreator<Taint>{}(input.getValue()));
-                        }
-                    }
-                    
-                    // Compute new taint of outputs
-                    func(tx, txInputTaint, txOutputTaint, coinbaseTaint);
-                    // Add new taint to taintedInputs/taintedOutputs
-                    processTx(taintedInputs, taintedOutputs, tx, txOutputTaint);
+                if (feeIt != feeTaints.end() && feeIt->first == tx.txNum) {
+                    coinbaseInputs.emplace_back(std::move(feeIt->second));
+                    ++feeIt;
                 } else {
                     // No tainted inputs, thus fee is untainted
-                    coinbaseTaint = UntaintedInputCreator<Taint>{}(tx.fee());
+                    coinbaseInputs.emplace_back(UntaintedInputCreator<Taint>{}(tx.fee()));
                 }
-                
-                coinbaseTaintList.emplace_back(coinbaseTaint);
+            }
+            auto coinbase = block[0];
+            std::vector<Taint> outputTaint;
+            outputTaint.reserve(coinbase.outputCount());
+            Taint feeTaint;
+            clearTaint(feeTaint);
+            func(coinbase, coinbaseInputs, outputTaint, feeTaint);
+            addOutputs(coinbase, outputTaint, nullptr);
+        }
+        
+        void processBatch(Batch &batch, std::vector<std::pair<uint32_t, Taint>> &feeTaints) {
+            auto txes = getTransactions(batch.txNums, access);
+            auto txCount = static_cast<uint32_t>(txes.size());
+            
+            std::vector<ranges::optional<TxResult>> results(txCount);
+            if (threadCount > 1 && txCount >= parallelBatchSize) {
+                // Transactions spending an output of an earlier transaction of the batch have to wait for it
+                segmentWork(0, txCount, threadCount, [&](uint32_t i) {
+                    for (auto input : txes[i].inputs()) {
+                        auto spentTxNum = input.getSpentOutputPointer().txNum;
+                        if (std::binary_search(batch.txNums.begin(), batch.txNums.begin() + i, spentTxNum)) {
+                            return;
+                        }
+                    }
+                    results[i] = computeTx(txes[i], batch.inputs[i]);
+                });
+            }
+            
+            for (uint32_t i = 0; i < txCount; i++) {
+                if (!results[i]) {
+                    results[i] = computeTx(txes[i], batch.inputs[i]);
+                }
+                std::vector<std::pair<OutputPointer, Taint>>{}.swap(batch.inputs[i]);
+                addOutputs(txes[i], results[i]->outputTaint, &batch);
+                feeTaints.emplace_back(txes[i].txNum, std::move(results[i]->feeTaint));
+                results[i] = ranges::nullopt;
+            }
+        }
+        
+        void processBlock(Block &block) {
+            std::vector<std::pair<uint32_t, Taint>> feeTaints;
+            // Transactions in the batch can taint outputs spent later in the same block, which start another batch
+            while (!frontier.empty() && frontier.front().txNum < block.endTxIndex()) {
+                Batch batch;
+                while (!frontier.empty() && frontier.front().txNum < block.endTxIndex()) {
+                    std::pop_heap(frontier.begin(), frontier.end(), LaterFrontierEntry{});
+                    auto &entry = frontier.back();
+                    if (batch.txNums.empty() || batch.txNums.back() != entry.txNum) {
+                        batch.txNums.push_back(entry.txNum);
+                        batch.inputs.emplace_back();
+                    }
+                    batch.inputs.back().emplace_back(entry.pointer, std::move(entry.taint));
+                    frontier.pop_back();
+                }
+                processBatch(batch, feeTaints);
             }
             // If taintFee is false, all taint going into the coinbase transaction is discarded
-            if (taintFee) {
-                txOutputTaint.clear();
-                txOutputTaint.reserve(block[0].outputCount());
-                clearTaint(coinbaseTaint);
-                
-                int64_t subsidy = getSubsidy(block);
-                coinbaseTaintList.insert(coinbaseTaintList.begin(), UntaintedInputCreator<Taint>{}(subsidy));
-                func(block[0], coinbaseTaintList, txOutputTaint, coinbaseTaint);
-                processTx(taintedInputs, taintedOutputs, block[0], txOutputTaint);
+            if (taintFee && !feeTaints.empty()) {
+                processCoinbase(block, feeTaints);
             }
         }
         
-        std::vector<std::pair<Output, Taint>> ret;
-        ret.reserve(taintedOutputs.size() + taintedInputs.size());
+    public:
+        TaintEngine(DataAccess &access_, Func func_, bool taintFee_, uint32_t threadCount_) : access(access_), chain(access_.getChain()), func(std::move(func_)), taintFee(taintFee_), useSpendingInputs(chain.hasSpendingInputColumn()), threadCount(resolveThreadCount(threadCount_)) {}
         
-        // Tainted unspent outputs
-        for (auto &item : taintedOutputs) {
-            ret.emplace_back(Output{item.first, access}, item.second);
+        /** Outputs tainted at the start, several seeds of the same output are combined with mergeTaint */
+        void addSeeds(std::vector<std::pair<Output, Taint>> &seeds) {
+            std::vector<size_t> order(seeds.size());
+            std::iota(order.begin(), order.end(), size_t{0});
+            std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                return packPointer(seeds[a].first.pointer) < packPointer(seeds[b].first.pointer);
+            });
+            std::vector<Output> seedOutputs;
+            seedTaints.reserve(seeds.size());
+            for (auto i : order) {
+                auto &seed = seeds[i];
+                auto packed = packPointer(seed.first.pointer);
+                if (!seedTaints.empty() && seedTaints.back().first == packed) {
+                    mergeTaint(seedTaints.back().second, std::move(seed.second));
+                } else {
+                    seedTaints.emplace_back(packed, std::move(seed.second));
+                    seedOutputs.push_back(seed.first);
+                }
+            }
+            for (size_t i = 0; i < seedTaints.size(); i++) {
+                auto &taint = seedTaints[i].second;
+                if (!hasTaint(taint)) {
+                    continue;
+                }
+                auto &output = seedOutputs[i];
+                auto spendingTx = output.getSpendingTxIndex();
+                if (spendingTx) {
+                    pushFrontier(*spendingTx, output.pointer, Taint(taint));
+                } else {
+                    unspentOutputs.emplace_back(output.pointer, taint);
+                }
+            }
         }
-        // Tainted spent outputs, but unspent at maxBlockHeight
-        for (auto &item : taintedInputs) {
-            ret.emplace_back(Output{item.first.pointer, access}, item.second);
+        
+        /** Process all tainted transactions before txLimit and return the tainted outputs unspent at that point
+         *
+         * An output can be listed twice if it is a seed that other traces reached as well. */
+        std::vector<std::pair<Output, Taint>> run(uint32_t txLimit, bool showProgress) {
+            if (!frontier.empty() && frontier.front().txNum < txLimit) {
+                auto firstTxNum = frontier.front().txNum;
+                auto progress = makeProgressBar(txLimit - firstTxNum, [&]() {
+                    std::cout << ", " << frontier.size() << " tainted outputs in flight";
+                });
+                if (!showProgress) {
+                    progress.setSilent();
+                }
+                while (!frontier.empty() && frontier.front().txNum < txLimit) {
+                    Block block{chain.getBlockHeight(frontier.front().txNum), access};
+                    processBlock(block);
+                    progress.advanceTo(std::min(block.endTxIndex(), txLimit) - firstTxNum);
+                }
+            }
+            
+            std::vector<std::pair<Output, Taint>> ret;
+            ret.reserve(unspentOutputs.size() + frontier.size());
+            // Tainted unspent outputs
+            for (auto &item : unspentOutputs) {
+                ret.emplace_back(Output{item.first, access}, std::move(item.second));
+            }
+            // Tainted spent outputs, but unspent at maxBlockHeight
+            for (auto &entry : frontier) {
+                ret.emplace_back(Output{entry.pointer, access}, std::move(entry.taint));
+            }
+            return ret;
         }
-        return ret;
+    };
+    
+    uint32_t taintTxLimit(DataAccess &access, BlockHeight maxBlockHeight) {
+        auto &chain = access.getChain();
+        if (maxBlockHeight == -1) {
+            maxBlockHeight = chain.blockCount();
+        } else {
+            // Range should include block at maxBlockHeight
+            maxBlockHeight += 1;
+            // Range shouldn't be larger than chain size
+            maxBlockHeight = std::min(maxBlockHeight, chain.blockCount());
+        }
+        return maxBlockHeight > 0 ? Block{maxBlockHeight - BlockHeight(1), access}.endTxIndex() : 0;
+    }
+    
+    // Propagate taint
+    template <typename Func, typename Taint>
+    std::vector<std::pair<Output, Taint>> getTaintedImpl(Func func, std::vector<std::pair<Output, Taint>> &taintedOutputsRaw, BlockHeight maxBlockHeight, bool taintFee, bool showProgress, uint32_t threadCount = 1) {
+        assert(taintedOutputsRaw.size() > 0);
+        TraceSpan span{TraceOperation::TaintRun, taintedOutputsRaw.size()};
+        
+        auto &access = taintedOutputsRaw[0].first.getAccess();
+        TaintEngine<Taint, Func> engine{access, std::move(func), taintFee, threadCount};
+        engine.addSeeds(taintedOutputsRaw);
+        return engine.run(taintTxLimit(access, maxBlockHeight), showProgress);
     }
     
     std::vector<std::pair<Output, SimpleTaint>> initSimpleTaint(std::vector<Output> &outputs) {
@@ -304,7 +565,7 @@ namespace blocksci { namespace heuristics {
      Implements poison tainting.
      Poison taint completely taints all outputs of a transaction.
      */
-    std::vector<std::pair<Output, SimpleTaint>> getPoisonTainted(std::vector<Output> &outputs, BlockHeight maxBlockHeight, bool taintFee) {
+    std::vector<std::pair<Output, SimpleTaint>> getPoisonTainted(std::vector<Output> &outputs, BlockHeight maxBlockHeight, bool taintFee, bool showProgress) {
         // Poison taint function
         auto poisonTaint = [](const Transaction &tx, const std::vector<SimpleTaint> &taintedInputs, std::vector<SimpleTaint> &outs, SimpleTaint &coinbaseTaint) {
             if(hasTaint(taintedInputs)) {
@@ -320,14 +581,14 @@ namespace blocksci { namespace heuristics {
             }
         };
         auto taint = initSimpleTaint(outputs);
-        return getTaintedImpl(poisonTaint, taint, maxBlockHeight, taintFee);
+        return getTaintedImpl(poisonTaint, taint, maxBlockHeight, taintFee, showProgress);
     }
     
     /**
      Implements haircut tainting.
      Haircut taint applies all input taint uniformly distributed to the outputs.
      */
-    std::vector<std::pair<Output, SimpleTaint>> getHaircutTainted(std::vector<Output> &outputs, BlockHeight maxBlockHeight, bool taintFee) {
+    std::vector<std::pair<Output, SimpleTaint>> getHaircutTainted(std::vector<Output> &outputs, BlockHeight maxBlockHeight, bool taintFee, bool showProgress) {
         // Haircut taint function
         auto haircutTaint = [](const Transaction &tx, const std::vector<SimpleTaint> &taintedInputs, std::vector<SimpleTaint> &outs, SimpleTaint &coinbaseTaint) {
             int64_t totalTaintedVal = totalTaintedValue(tx, taintedInputs);
@@ -348,6 +609,318 @@ namespace blocksci { namespace heuristics {
             coinbaseTaint.second = totalTxFee - feeTaint;
         };
         auto taint = initSimpleTaint(outputs);
-        return getTaintedImpl(haircutTaint, taint, maxBlockHeight, taintFee);
+        return getTaintedImpl(haircutTaint, taint, maxBlockHeight, taintFee, showProgress);
+    }
+    
+    std::vector<std::pair<Output, ComplexTaint>> initComplexTaint(std::vector<Output> &outputs) {
+        // Outputs passed in are assumed to be fully tainted
+        std::vector<std::pair<Output, ComplexTaint>> taint;
+        taint.reserve(outputs.size());
+        for(const auto &output : outputs) {
+            taint.emplace_back(output, ComplexTaint{{output.getValue(), true}});
+        }
+        return taint;
+    }
+    
+    /** Assigns the value of the inputs to the outputs in order, FIFO from the first input on, LIFO from the last
+     *
+     * The inputs are treated as one stream of (value, isTainted) segments. Every output in turn takes its value from
+     * the front (FIFO) or back (LIFO) of the stream and the rest of the stream pays the fee.
+     */
+    struct OrderedTaint {
+        bool lastInFirstOut;
+        
+        void operator()(const Transaction &tx, const std::vector<ComplexTaint> &taintedInputs, std::vector<ComplexTaint> &outs, ComplexTaint &coinbaseTaint) const {
+            ComplexTaint segments;
+            for (const auto &input : taintedInputs) {
+                for (const auto &segment : input) {
+                    appendSegment(segments, segment.first, segment.second);
+                }
+            }
+            if (lastInFirstOut) {
+                std::reverse(segments.begin(), segments.end());
+            }
+            size_t position = 0;
+            int64_t usedOfSegment = 0;
+            auto take = [&](int64_t value) {
+                ComplexTaint taint;
+                while (value > 0 && position < segments.size()) {
+                    auto amount = std::min(segments[position].first - usedOfSegment, value);
+                    appendSegment(taint, amount, segments[position].second);
+                    value -= amount;
+                    usedOfSegment += amount;
+                    if (usedOfSegment == segments[position].first) {
+                        position++;
+                        usedOfSegment = 0;
+                    }
+                }
+                // Value that isn't backed by the inputs is untainted
+                appendSegment(taint, value, false);
+                if (lastInFirstOut) {
+                    // Keep the segments in the order they were received, so that LIFO stays LIFO downstream
+                    std::reverse(taint.begin(), taint.end());
+                }
+                return taint;
+            };
+            for (auto spendingOut : tx.outputs()) {
+                outs.push_back(take(spendingOut.getValue()));
+            }
+            if (!tx.isCoinbase()) {
+                coinbaseTaint = take(tx.fee());
+            }
+        }
+    };
+    
+    /**
+     Implements FIFO tainting.
+     The value of the inputs is assigned to the outputs in order, the first input funding the first output.
+     */
+    std::vector<std::pair<Output, ComplexTaint>> getFifoTainted(std::vector<Output> &outputs, BlockHeight maxBlockHeight, bool taintFee, bool showProgress) {
+        auto taint = initComplexTaint(outputs);
+        return getTaintedImpl(OrderedTaint{false}, taint, maxBlockHeight, taintFee, showProgress);
+    }
+    
+    /**
+     Implements LIFO tainting.
+     The value of the inputs is assigned to the outputs in reverse order, the last input funding the first output.
+     */
+    std::vector<std::pair<Output, ComplexTaint>> getLifoTainted(std::vector<Output> &outputs, BlockHeight maxBlockHeight, bool taintFee, bool showProgress) {
+        auto taint = initComplexTaint(outputs);
+        return getTaintedImpl(OrderedTaint{true}, taint, maxBlockHeight, taintFee, showProgress);
+    }
+    
+    /** Poison taint of all traces at once, every output of a transaction is fully tainted by each trace tainting an input */
+    struct PoisonMultiTaint {
+        void operator()(const Transaction &tx, const std::vector<MultiTaint> &taintedInputs, std::vector<MultiTaint> &outs, MultiTaint &coinbaseTaint) const {
+            std::vector<uint32_t> traces;
+            for (const auto &input : taintedInputs) {
+                for (const auto &seed : input.seeds) {
+                    if (seed.second > 0) {
+                        traces.push_back(seed.first);
+                    }
+                }
+            }
+            std::sort(traces.begin(), traces.end());
+            traces.erase(std::unique(traces.begin(), traces.end()), traces.end());
+            auto fullTaint = [&](int64_t value) {
+                MultiTaint taint{value, {}};
+                if (value > 0) {
+                    taint.seeds.reserve(traces.size());
+                    for (auto trace : traces) {
+                        taint.seeds.emplace_back(trace, value);
+                    }
+                }
+                return taint;
+            };
+            for (auto spendingOut : tx.outputs()) {
+                outs.push_back(fullTaint(spendingOut.getValue()));
+            }
+            coinbaseTaint = fullTaint(tx.fee());
+        }
+    };
+    
+    /** Haircut taint of all traces at once, computing the same shares as the haircut function of getHaircutTainted for each trace */
+    struct HaircutMultiTaint {
+        void operator()(const Transaction &tx, const std::vector<MultiTaint> &taintedInputs, std::vector<MultiTaint> &outs, MultiTaint &coinbaseTaint) const {
+            // Tainted value of every trace, capped like totalTaintedValue
+            int64_t totalVal = tx.isCoinbase() ? totalOutputValue(tx) : totalInputValue(tx);
+            std::vector<std::pair<uint32_t, int64_t>> traceTaint;
+            for (const auto &input : taintedInputs) {
+                if (totalVal <= 0) {
+                    break;
+                }
+                for (const auto &seed : input.seeds) {
+                    traceTaint.emplace_back(seed.first, std::min(seed.second, totalVal));
+                }
+                totalVal -= input.value;
+            }
+            std::sort(traceTaint.begin(), traceTaint.end());
+            size_t traceCount = 0;
+            for (size_t i = 0; i < traceTaint.size(); i++) {
+                if (traceCount > 0 && traceTaint[traceCount - 1].first == traceTaint[i].first) {
+                    traceTaint[traceCount - 1].second += traceTaint[i].second;
+                } else {
+                    traceTaint[traceCount++] = traceTaint[i];
+                }
+            }
+            traceTaint.resize(traceCount);
+            
+            auto totalIn = static_cast<double>(totalOutputValue(tx) + tx.fee());
+            std::vector<int64_t> taintedValues(traceTaint.size(), 0);
+            for (auto spendingOut : tx.outputs()) {
+                MultiTaint taint{spendingOut.getValue(), {}};
+                auto percentage = static_cast<double>(spendingOut.getValue()) / totalIn;
+                for (size_t i = 0; i < traceTaint.size(); i++) {
+                    auto totalTaintedVal = traceTaint[i].second;
+                    auto newTaintedValue = std::min(static_cast<int64_t>(percentage * static_cast<double>(totalTaintedVal)), spendingOut.getValue());
+                    newTaintedValue = std::min(newTaintedValue, totalTaintedVal - taintedValues[i]);
+                    taintedValues[i] += newTaintedValue;
+                    if (newTaintedValue > 0) {
+                        taint.seeds.emplace_back(traceTaint[i].first, newTaintedValue);
+                    }
+                }
+                outs.push_back(std::move(taint));
+            }
+            coinbaseTaint.value = tx.fee();
+            for (size_t i = 0; i < traceTaint.size(); i++) {
+                auto feeTaint = std::min(traceTaint[i].second - taintedValues[i], tx.fee());
+                if (feeTaint > 0) {
+                    coinbaseTaint.seeds.emplace_back(traceTaint[i].first, feeTaint);
+                }
+            }
+        }
+    };
+    
+    /** Haircut taint split by source: every input passes its shares on in proportion to its value
+     *
+     * All outputs and the fee of a transaction receive the same proportions, so they are computed once per transaction.
+     * Shares below minProportion are dropped as dust and only the maxSources largest shares are kept, the dropped taint
+     * counts as untainted downstream.
+     */
+    struct HaircutSourceTaint {
+        SourceShareArena *arena;
+        uint32_t maxSources;
+        uint32_t minProportion;
+        
+        void operator()(const Transaction &tx, const std::vector<SourceTaint> &taintedInputs, std::vector<SourceTaint> &outs, SourceTaint &coinbaseTaint) const {
+            // Reused across the transactions of a thread, so only the shares that are kept are allocated
+            thread_local std::vector<std::pair<uint32_t, int64_t>> sourceValues;
+            thread_local std::vector<SourceShare> shares;
+            sourceValues.clear();
+            shares.clear();
+            
+            int64_t totalIn = 0;
+            for (const auto &input : taintedInputs) {
+                totalIn += input.value;
+                for (const auto &share : input) {
+                    sourceValues.emplace_back(share.source, applyProportion(input.value, share.proportion));
+                }
+            }
+            std::sort(sourceValues.begin(), sourceValues.end(), [](const auto &a, const auto &b) {
+                return a.first < b.first;
+            });
+            for (size_t i = 0; i < sourceValues.size();) {
+                auto source = sourceValues[i].first;
+                int64_t sourceValue = 0;
+                for (; i < sourceValues.size() && sourceValues[i].first == source; i++) {
+                    sourceValue += sourceValues[i].second;
+                }
+                if (totalIn <= 0 || sourceValue <= 0) {
+                    continue;
+                }
+                auto fraction = std::min(static_cast<double>(sourceValue) / static_cast<double>(totalIn), 1.0);
+                auto proportion = static_cast<uint32_t>(fraction * static_cast<double>(proportionOne));
+                if (proportion > 0 && proportion >= minProportion) {
+                    shares.push_back(SourceShare{source, proportion});
+                }
+            }
+            if (shares.size() > maxSources) {
+                std::nth_element(shares.begin(), shares.begin() + maxSources, shares.end(), [](const SourceShare &a, const SourceShare &b) {
+                    return a.proportion > b.proportion;
+                });
+                shares.resize(maxSources);
+                std::sort(shares.begin(), shares.end(), [](const SourceShare &a, const SourceShare &b) {
+                    return a.source < b.source;
+                });
+            }
+            
+            SourceTaint taint;
+            taint.assign(shares.data(), static_cast<uint32_t>(shares.size()), *arena);
+            for (auto spendingOut : tx.outputs()) {
+                outs.push_back(taint);
+                outs.back().value = spendingOut.getValue();
+            }
+            if (!tx.isCoinbase()) {
+                taint.value = tx.fee();
+                coinbaseTaint = std::move(taint);
+            }
+        }
+    };
+    
+    std::vector<std::pair<Output, MultiTaint>> getHaircutSourceTainted(std::vector<Output> &outputs, BlockHeight maxBlockHeight, bool taintFee, const SourceTaintOptions &options, bool showProgress) {
+        if (options.maxSources == 0 || options.maxSources > SourceShareArena::maxBlockCapacity) {
+            throw std::invalid_argument("maxSources must be between 1 and " + std::to_string(SourceShareArena::maxBlockCapacity));
+        }
+        if (!(options.minProportion >= 0 && options.minProportion < 1)) {
+            throw std::invalid_argument("minProportion must be at least 0 and less than 1");
+        }
+        std::vector<std::pair<Output, MultiTaint>> results;
+        if (outputs.empty()) {
+            return results;
+        }
+        
+        // Declared before the engine so it outlives every taint allocated from it
+        SourceShareArena arena;
+        auto minProportion = static_cast<uint32_t>(options.minProportion * static_cast<double>(proportionOne));
+        HaircutSourceTaint func{&arena, options.maxSources, minProportion};
+        
+        // Outputs passed in are fully tainted by themselves, the source of an output is its position
+        std::vector<std::pair<Output, SourceTaint>> seeds;
+        seeds.reserve(outputs.size());
+        for (uint32_t i = 0; i < outputs.size(); i++) {
+            SourceTaint taint{outputs[i].getValue()};
+            if (taint.value > 0) {
+                SourceShare share{i, proportionOne};
+                taint.assign(&share, 1, arena);
+            }
+            seeds.emplace_back(outputs[i], std::move(taint));
+        }
+        
+        TraceSpan span{TraceOperation::TaintRun, seeds.size()};
+        auto &access = seeds[0].first.getAccess();
+        TaintEngine<SourceTaint, HaircutSourceTaint> engine{access, func, taintFee, options.threadCount};
+        engine.addSeeds(seeds);
+        auto tainted = engine.run(taintTxLimit(access, maxBlockHeight), showProgress);
+        results.reserve(tainted.size());
+        for (auto &item : tainted) {
+            MultiTaint taint{item.second.value, {}};
+            taint.seeds.reserve(item.second.size());
+            for (const auto &share : item.second) {
+                auto taintedValue = applyProportion(item.second.value, share.proportion);
+                if (taintedValue > 0) {
+                    taint.seeds.emplace_back(share.source, taintedValue);
+                }
+            }
+            results.emplace_back(item.first, std::move(taint));
+        }
+        return results;
+    }
+    
+    template <typename Func>
+    std::vector<std::vector<std::pair<Output, SimpleTaint>>> getTaintedBatchImpl(Func func, std::vector<std::vector<Output>> &seedSets, BlockHeight maxBlockHeight, bool taintFee, uint32_t threadCount, bool showProgress) {
+        std::vector<std::vector<std::pair<Output, SimpleTaint>>> results(seedSets.size());
+        // Outputs passed in are assumed to be fully tainted by their trace
+        std::vector<std::pair<Output, MultiTaint>> seeds;
+        for (uint32_t i = 0; i < seedSets.size(); i++) {
+            for (const auto &output : seedSets[i]) {
+                MultiTaint taint{output.getValue(), {}};
+                if (taint.value > 0) {
+                    taint.seeds.emplace_back(i, taint.value);
+                }
+                seeds.emplace_back(output, std::move(taint));
+            }
+        }
+        if (seeds.empty()) {
+            return results;
+        }
+        
+        TraceSpan span{TraceOperation::TaintRun, seeds.size()};
+        auto &access = seeds[0].first.getAccess();
+        TaintEngine<MultiTaint, Func> engine{access, std::move(func), taintFee, threadCount};
+        engine.addSeeds(seeds);
+        for (auto &item : engine.run(taintTxLimit(access, maxBlockHeight), showProgress)) {
+            for (const auto &seed : item.second.seeds) {
+                results[seed.first].emplace_back(item.first, SimpleTaint{seed.second, item.second.value - seed.second});
+            }
+        }
+        return results;
+    }
+    
+    std::vector<std::vector<std::pair<Output, SimpleTaint>>> getPoisonTaintedBatch(std::vector<std::vector<Output>> &seedSets, BlockHeight maxBlockHeight, bool taintFee, uint32_t threadCount, bool showProgress) {
+        return getTaintedBatchImpl(PoisonMultiTaint{}, seedSets, maxBlockHeight, taintFee, threadCount, showProgress);
+    }
+    
+    std::vector<std::vector<std::pair<Output, SimpleTaint>>> getHaircutTaintedBatch(std::vector<std::vector<Output>> &seedSets, BlockHeight maxBlockHeight, bool taintFee, uint32_t threadCount, bool showProgress) {
+        return getTaintedBatchImpl(HaircutMultiTaint{}, seedSets, maxBlockHeight, taintFee, threadCount, showProgress);
     }
 }}
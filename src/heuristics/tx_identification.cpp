@@ -6,14 +6,22 @@
 //
 
 #include <blocksci/heuristics/tx_identification.hpp>
+#include <blocksci/chain/blockchain.hpp>
 #include <blocksci/chain/transaction.hpp>
 #include <blocksci/chain/input.hpp>
 #include <blocksci/chain/output.hpp>
 #include <blocksci/scripts/script_variant.hpp>
 
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+#include <internal/progress_bar.hpp>
+#include <internal/segment_work.hpp>
+#include <internal/tx_feature_table.hpp>
+
 #include <range/v3/range_for.hpp>
 
 #include <algorithm>
+#include <limits>
 #include <unordered_set>
 #include <unordered_map>
 
@@ -45,7 +53,7 @@ namespace heuristics {
         return false;
     }
     
-    bool isCoinjoin(const Transaction &tx) {
+    bool computeIsCoinjoin(const Transaction &tx) {
         if (tx.inputCount() < 2 || tx.outputCount() < 3) {
             return false;
         }
@@ -89,106 +97,133 @@ namespace heuristics {
         return true;
     }
     
-    struct OutputBucket {
-        int64_t currentValue;
-        int64_t goalValue;
-        
-        explicit OutputBucket(int64_t goal) : currentValue(0), goalValue(goal) {}
-        
-        bool isFull() const {
-            return currentValue >= goalValue;
-        }
-        
-        void addInput(int64_t val) {
-            currentValue += val;
-        }
-        
-        void removeInput(int64_t val) {
-            currentValue -= val;
-        }
-        
-        int64_t remaining() const {
-            if (goalValue > currentValue) {
-                return goalValue - currentValue;
-            } else {
-                return 0;
+    namespace {
+        /** Search state of BucketCover: the next value to place and the sorted remaining amounts of all buckets */
+        struct BucketCoverState {
+            size_t nextValue;
+            std::vector<int64_t> remaining;
+            
+            bool operator==(const BucketCoverState &other) const {
+                return nextValue == other.nextValue && remaining == other.remaining;
             }
-        }
-        
-        bool operator<(const OutputBucket &other) const {
-            return remaining() < other.remaining();
-        }
-    };
-    
-    CoinJoinResult _getSumCount(std::vector<int64_t> &values, std::vector<OutputBucket> buckets, int64_t totalRemaining, int64_t valueLeft, size_t maxDepth, size_t &depth);
-    CoinJoinResult getSumCount(std::vector<int64_t> &values, std::vector<int64_t> bucketGoals, size_t maxDepth);
-    
-    
-    CoinJoinResult _getSumCount(std::vector<int64_t> &values, std::vector<OutputBucket> buckets, int64_t totalRemaining, int64_t valueLeft, size_t maxDepth, size_t &depth) {
-        if (totalRemaining > valueLeft) {
-            return CoinJoinResult::False;
-        }
-        
-        buckets.erase(std::remove_if(buckets.begin(), buckets.end(), [&](auto &bucket) { return bucket.isFull(); }), buckets.end());
-        if (buckets.size() == 0) {
-            return CoinJoinResult::True;
-        }
-        
-        if (values.size() == 0) {
-            return CoinJoinResult::False;
-        }
-        
-        depth++;
-        
-        if (maxDepth != 0 && depth > maxDepth) {
-            return CoinJoinResult::Timeout;
-        }
-        
-        std::sort(buckets.rbegin(), buckets.rend());
-        
-        int64_t lastValue = values.back();
-        values.pop_back();
-        valueLeft -= lastValue;
-        for (auto &bucket : buckets) {
-            int64_t remaining = totalRemaining - bucket.remaining();
-            bucket.addInput(lastValue);
-            remaining += bucket.remaining();
-            auto res = _getSumCount(values, buckets, remaining, valueLeft, maxDepth, depth);
-            if (res != CoinJoinResult::False) {
-                return res;
+        };
+        
+        struct BucketCoverStateHasher {
+            size_t operator()(const BucketCoverState &state) const {
+                std::size_t seed = 7826431;
+                hash_combine(seed, state.nextValue);
+                for (auto remaining : state.remaining) {
+                    hash_combine(seed, remaining);
+                }
+                return seed;
             }
-            bucket.removeInput(lastValue);
-        }
-        values.push_back(lastValue);
-        return CoinJoinResult::False;
+        };
+        
+        /** Decides whether the values can be split into groups that each reach the goal of one bucket
+         *
+         * Values are placed largest first, every value into one of the buckets that isn't full yet. The search is
+         * pruned when the values left can't fill the remaining buckets, either by their sum or by their number. Buckets
+         * are interchangeable once they have the same remaining amount, so a value is only tried in one bucket per
+         * distinct remaining amount. States from which no cover exists are remembered, which collapses the search
+         * when inputs share values as they usually do in CoinJoins.
+         *
+         * Every visited state counts as one step. Once maxSteps (if not 0) is exceeded, the search gives up and
+         * returns CoinJoinResult::Timeout, which bounds the cost of one call independently of the transaction size.
+         */
+        class BucketCover {
+            std::vector<int64_t> values;
+            std::vector<int64_t> valueSuffixSums;
+            std::vector<int64_t> remaining;
+            size_t maxSteps;
+            size_t steps = 0;
+            std::unordered_set<BucketCoverState, BucketCoverStateHasher> failedStates;
+            
+            BucketCoverState currentState(size_t nextValue) const {
+                BucketCoverState state{nextValue, remaining};
+                std::sort(state.remaining.begin(), state.remaining.end());
+                return state;
+            }
+            
+            CoinJoinResult search(size_t nextValue, int64_t totalRemaining, size_t openBuckets) {
+                if (openBuckets == 0) {
+                    return CoinJoinResult::True;
+                }
+                // Every open bucket needs at least one more value
+                if (openBuckets > values.size() - nextValue || totalRemaining > valueSuffixSums[nextValue]) {
+                    return CoinJoinResult::False;
+                }
+                
+                auto state = currentState(nextValue);
+                if (failedStates.find(state) != failedStates.end()) {
+                    return CoinJoinResult::False;
+                }
+                
+                steps++;
+                if (maxSteps != 0 && steps > maxSteps) {
+                    return CoinJoinResult::Timeout;
+                }
+                
+                // Try the buckets with the most remaining first, which is the greedy assignment
+                std::vector<size_t> order;
+                order.reserve(remaining.size());
+                for (size_t i = 0; i < remaining.size(); i++) {
+                    if (remaining[i] > 0) {
+                        order.push_back(i);
+                    }
+                }
+                std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return remaining[a] > remaining[b]; });
+                
+                auto value = values[nextValue];
+                int64_t lastTried = 0;
+                for (auto bucket : order) {
+                    auto bucketRemaining = remaining[bucket];
+                    if (bucketRemaining == lastTried) {
+                        continue;
+                    }
+                    lastTried = bucketRemaining;
+                    auto newRemaining = std::max<int64_t>(bucketRemaining - value, 0);
+                    remaining[bucket] = newRemaining;
+                    auto res = search(nextValue + 1, totalRemaining - (bucketRemaining - newRemaining), openBuckets - (newRemaining == 0 ? 1 : 0));
+                    remaining[bucket] = bucketRemaining;
+                    if (res != CoinJoinResult::False) {
+                        return res;
+                    }
+                }
+                
+                failedStates.insert(std::move(state));
+                return CoinJoinResult::False;
+            }
+            
+        public:
+            BucketCover(std::vector<int64_t> values_, const std::vector<int64_t> &goals, size_t maxSteps_) : values(std::move(values_)), maxSteps(maxSteps_) {
+                std::sort(values.rbegin(), values.rend());
+                valueSuffixSums.resize(values.size() + 1, 0);
+                for (size_t i = values.size(); i > 0; i--) {
+                    valueSuffixSums[i - 1] = valueSuffixSums[i] + values[i - 1];
+                }
+                for (auto goal : goals) {
+                    remaining.push_back(std::max<int64_t>(goal, 0));
+                }
+            }
+            
+            CoinJoinResult solve() {
+                int64_t totalRemaining = 0;
+                size_t openBuckets = 0;
+                for (auto bucketRemaining : remaining) {
+                    totalRemaining += bucketRemaining;
+                    openBuckets += bucketRemaining > 0 ? 1 : 0;
+                }
+                return search(0, totalRemaining, openBuckets);
+            }
+        };
     }
     
-    
     CoinJoinResult getSumCount(std::vector<int64_t> &values, std::vector<int64_t> bucketGoals, size_t maxDepth) {
-        std::sort(values.begin(), values.end());
-        std::sort(bucketGoals.rbegin(), bucketGoals.rend());
-        
-        int64_t valueLeft = 0;
-        for (auto value : values) {
-            valueLeft += value;
-        }
-        
-        int64_t totalRemaining = 0;
-        for (auto goal : bucketGoals) {
-            totalRemaining += goal;
-        }
-        
-        std::vector<OutputBucket> buckets;
-        buckets.reserve(bucketGoals.size());
-        for (auto goal : bucketGoals) {
-            buckets.emplace_back(goal);
-        }
-        size_t depth = 0;
-        return _getSumCount(values, buckets, totalRemaining, valueLeft, maxDepth, depth);
+        return BucketCover{values, bucketGoals, maxDepth}.solve();
     }
     
     
-    CoinJoinResult isCoinjoinExtra(const Transaction &tx, int64_t minBaseFee, double percentageFee, size_t maxDepth) {
+    CoinJoinResult computeIsCoinjoinExtra(const Transaction &tx, int64_t minBaseFee, double percentageFee, size_t maxDepth) {
         if (tx.inputCount() < 2 || tx.outputCount() < 3) {
             return CoinJoinResult::False;
         }
@@ -263,7 +298,7 @@ namespace heuristics {
         return getSumCount(values, bucketGoals, maxDepth);
     }
     
-    CoinJoinResult isPossibleCoinjoin(const Transaction &tx, int64_t minBaseFee, double percentageFee, size_t maxDepth) {
+    CoinJoinResult computeIsPossibleCoinjoin(const Transaction &tx, int64_t minBaseFee, double percentageFee, size_t maxDepth) {
         
         if (tx.outputCount() == 1 || tx.inputCount() == 1) {
             return CoinJoinResult::False;
@@ -337,7 +372,7 @@ namespace heuristics {
         return getSumCount(values, bucketGoals, maxDepth);
     }
     
-    bool isDeanonTx(const Transaction &tx) {
+    bool computeIsDeanonTx(const Transaction &tx) {
         if (tx.isCoinbase()) {
             return false;
         }
@@ -452,7 +487,7 @@ namespace heuristics {
         }
     };
     
-    bool isChangeOverTx(const Transaction &tx) {
+    bool computeIsChangeOverTx(const Transaction &tx) {
         if (tx.isCoinbase()) {
             return false;
         }
@@ -478,7 +513,7 @@ namespace heuristics {
         return *outputTypes.begin() != *inputTypes.begin();
     }
     
-    bool containsKeysetChange(const Transaction &tx) {
+    bool computeContainsKeysetChange(const Transaction &tx) {
         if (tx.isCoinbase()) {
             return false;
         }
@@ -533,4 +568,177 @@ namespace heuristics {
         
         return false;
     }
+    
+    namespace {
+        // Large enough to keep all threads busy, small enough to bound the memory of the features not written yet
+        constexpr uint32_t featureChunkSize = 1 << 20;
+        
+        TxFeatureTable::CoinJoinParameters coinJoinParameters(int64_t minBaseFee, double percentageFee, size_t maxDepth) {
+            return {minBaseFee, percentageFee, static_cast<uint64_t>(maxDepth)};
+        }
+        
+        const TxFeatures *storedFeatures(const Transaction &tx) {
+            return tx.getAccess().getTxFeatures().get(tx.txNum);
+        }
+        
+        /** Stored features that include the possible CoinJoin flags for the given parameters */
+        const TxFeatures *storedFeatures(const Transaction &tx, int64_t minBaseFee, double percentageFee, size_t maxDepth) {
+            const auto &table = tx.getAccess().getTxFeatures();
+            if (table.getParameters() != coinJoinParameters(minBaseFee, percentageFee, maxDepth)) {
+                return nullptr;
+            }
+            return table.get(tx.txNum);
+        }
+        
+        CoinJoinResult storedResult(const TxFeatures &features, TxFeatures::Flag trueFlag, TxFeatures::Flag timeoutFlag) {
+            if (features.has(trueFlag)) {
+                return CoinJoinResult::True;
+            } else if (features.has(timeoutFlag)) {
+                return CoinJoinResult::Timeout;
+            } else {
+                return CoinJoinResult::False;
+            }
+        }
+        
+        uint16_t saturatedCount(size_t count) {
+            return static_cast<uint16_t>(std::min<size_t>(count, std::numeric_limits<uint16_t>::max()));
+        }
+        
+        uint16_t resultFlags(CoinJoinResult result, TxFeatures::Flag trueFlag, TxFeatures::Flag timeoutFlag) {
+            switch (result) {
+                case CoinJoinResult::True:
+                    return trueFlag;
+                case CoinJoinResult::Timeout:
+                    return timeoutFlag;
+                case CoinJoinResult::False:
+                    return 0;
+            }
+            return 0;
+        }
+        
+        TxFeatures computeTxFeatures(const Transaction &tx, int64_t minBaseFee, double percentageFee, size_t maxDepth) {
+            uint16_t flags = 0;
+            if (computeIsCoinjoin(tx)) {
+                flags |= TxFeatures::Coinjoin;
+            }
+            flags |= resultFlags(computeIsPossibleCoinjoin(tx, minBaseFee, percentageFee, maxDepth), TxFeatures::PossibleCoinjoin, TxFeatures::PossibleCoinjoinTimeout);
+            flags |= resultFlags(computeIsCoinjoinExtra(tx, minBaseFee, percentageFee, maxDepth), TxFeatures::CoinjoinExtra, TxFeatures::CoinjoinExtraTimeout);
+            if (computeIsDeanonTx(tx)) {
+                flags |= TxFeatures::DeanonTx;
+            }
+            if (computeIsChangeOverTx(tx)) {
+                flags |= TxFeatures::ChangeOverTx;
+            }
+            if (computeContainsKeysetChange(tx)) {
+                flags |= TxFeatures::KeysetChange;
+            }
+            
+            std::unordered_set<Address> inputAddresses;
+            RANGES_FOR (auto input, tx.inputs()) {
+                inputAddresses.insert(input.getAddress());
+            }
+            std::unordered_map<int64_t, uint16_t> outputValues;
+            uint16_t largestEqualOutputCount = 0;
+            RANGES_FOR (auto output, tx.outputs()) {
+                largestEqualOutputCount = std::max(largestEqualOutputCount, ++outputValues[output.getValue()]);
+            }
+            return {flags, saturatedCount(inputAddresses.size()), saturatedCount(outputValues.size()), largestEqualOutputCount};
+        }
+    }
+    
+    bool isCoinjoin(const Transaction &tx) {
+        if (auto features = storedFeatures(tx)) {
+            return features->has(TxFeatures::Coinjoin);
+        }
+        return computeIsCoinjoin(tx);
+    }
+    
+    CoinJoinResult isPossibleCoinjoin(const Transaction &tx, int64_t minBaseFee, double percentageFee, size_t maxDepth) {
+        if (auto features = storedFeatures(tx, minBaseFee, percentageFee, maxDepth)) {
+            return storedResult(*features, TxFeatures::PossibleCoinjoin, TxFeatures::PossibleCoinjoinTimeout);
+        }
+        return computeIsPossibleCoinjoin(tx, minBaseFee, percentageFee, maxDepth);
+    }
+    
+    CoinJoinResult isCoinjoinExtra(const Transaction &tx, int64_t minBaseFee, double percentageFee, size_t maxDepth) {
+        if (auto features = storedFeatures(tx, minBaseFee, percentageFee, maxDepth)) {
+            return storedResult(*features, TxFeatures::CoinjoinExtra, TxFeatures::CoinjoinExtraTimeout);
+        }
+        return computeIsCoinjoinExtra(tx, minBaseFee, percentageFee, maxDepth);
+    }
+    
+    bool isDeanonTx(const Transaction &tx) {
+        if (auto features = storedFeatures(tx)) {
+            return features->has(TxFeatures::DeanonTx);
+        }
+        return computeIsDeanonTx(tx);
+    }
+    
+    bool isChangeOverTx(const Transaction &tx) {
+        if (auto features = storedFeatures(tx)) {
+            return features->has(TxFeatures::ChangeOverTx);
+        }
+        return computeIsChangeOverTx(tx);
+    }
+    
+    bool containsKeysetChange(const Transaction &tx) {
+        if (auto features = storedFeatures(tx)) {
+            return features->has(TxFeatures::KeysetChange);
+        }
+        return computeContainsKeysetChange(tx);
+    }
+    
+    TxFeatures getTxFeatures(const Transaction &tx, int64_t minBaseFee, double percentageFee, size_t maxDepth) {
+        if (auto features = storedFeatures(tx, minBaseFee, percentageFee, maxDepth)) {
+            return *features;
+        }
+        return computeTxFeatures(tx, minBaseFee, percentageFee, maxDepth);
+    }
+    
+    void buildTxFeatureTable(Blockchain &chain, int64_t minBaseFee, double percentageFee, size_t maxDepth, uint32_t threadCount, bool showProgress) {
+        auto &access = chain.getAccess();
+        auto directory = access.config.txFeaturesDirectory();
+        if (!directory.exists()) {
+            filesystem::create_directory(directory);
+        }
+        auto parameters = coinJoinParameters(minBaseFee, percentageFee, maxDepth);
+        const auto &existing = access.getTxFeatures();
+        uint32_t firstTxNum = existing.getParameters() == parameters ? existing.txCount() : 0;
+        uint32_t txCount = static_cast<uint32_t>(access.getChain().txCount());
+        if (firstTxNum >= txCount) {
+            return;
+        }
+        // Release the mapping of the current table before its file is truncated
+        access.resetTxFeatures();
+        
+        threadCount = resolveThreadCount(threadCount);
+        auto progress = makeProgressBar(txCount - firstTxNum, [](){});
+        if (!showProgress) {
+            progress.setSilent();
+        }
+        try {
+            {
+                FixedSizeFileMapper<TxFeatures, mio::access_mode::write> file{TxFeatureTable::featuresPath(directory)};
+                file.truncate(firstTxNum);
+                file.seekEnd();
+                std::vector<TxFeatures> features;
+                for (uint32_t chunkStart = firstTxNum; chunkStart < txCount; chunkStart += featureChunkSize) {
+                    auto chunkEnd = std::min(txCount - chunkStart, featureChunkSize) + chunkStart;
+                    features.resize(chunkEnd - chunkStart);
+                    segmentWork(chunkStart, chunkEnd, threadCount, [&](uint32_t txNum) {
+                        features[txNum - chunkStart] = computeTxFeatures(Transaction{txNum, access}, minBaseFee, percentageFee, maxDepth);
+                    });
+                    for (const auto &txFeatures : features) {
+                        file.write(txFeatures);
+                    }
+                    progress.advanceTo(chunkEnd - firstTxNum);
+                }
+            }
+            TxFeatureTable::writeMeta(directory, parameters, txCount, *access.getChain().getTxHash(txCount - 1));
+        } catch (...) {
+            access.resetTxFeatures();
+            throw;
+        }
+        access.resetTxFeatures();
+    }
 }}
@@ -0,0 +1,205 @@
+//
+//  hex_codec.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include <blocksci/core/hex_codec.hpp>
+
+#include <internal/bitcoin_uint256_hex.hpp>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BLOCKSCI_HEX_CODEC_X86
+#endif
+
+namespace blocksci {
+    namespace {
+        const char hexChars[] = "0123456789abcdef";
+
+        signed char hexValue(char c) {
+            if (c >= '0' && c <= '9') {
+                return static_cast<signed char>(c - '0');
+            }
+            auto lower = static_cast<char>(c | 0x20);
+            if (lower >= 'a' && lower <= 'f') {
+                return static_cast<signed char>(lower - 'a' + 10);
+            }
+            return -1;
+        }
+
+        /** Hex string of the byteCount bytes in reverse order */
+        void encodeReversed(const unsigned char *bytes, size_t byteCount, char *out) {
+            for (size_t i = 0; i < byteCount; i++) {
+                auto byte = bytes[byteCount - 1 - i];
+                out[2 * i] = hexChars[byte >> 4];
+                out[2 * i + 1] = hexChars[byte & 15];
+            }
+        }
+
+        /** Reverse of encodeReversed */
+        bool decodeReversed(const char *hex, size_t byteCount, unsigned char *bytes) {
+            for (size_t i = 0; i < byteCount; i++) {
+                auto high = hexValue(hex[2 * i]);
+                auto low = hexValue(hex[2 * i + 1]);
+                if (high < 0 || low < 0) {
+                    return false;
+                }
+                bytes[byteCount - 1 - i] = static_cast<unsigned char>((high << 4) | low);
+            }
+            return true;
+        }
+
+#ifdef BLOCKSCI_HEX_CODEC_X86
+        bool hasSsse3() {
+            static const bool supported = __builtin_cpu_supports("ssse3");
+            return supported;
+        }
+
+        bool hasAvx2() {
+            static const bool supported = __builtin_cpu_supports("avx2");
+            return supported;
+        }
+
+        /** encodeReversed of 16 bytes */
+        __attribute__((target("ssse3")))
+        void encodeBlockSsse3(const unsigned char *bytes, char *out) {
+            const __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+            const __m128i digits = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+            const __m128i lowNibbles = _mm_set1_epi8(0x0f);
+            __m128i value = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes)), reverse);
+            __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(value, 4), lowNibbles));
+            __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(value, lowNibbles));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_unpacklo_epi8(high, low));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 16), _mm_unpackhi_epi8(high, low));
+        }
+
+        /** encodeReversed of a 32 byte hash */
+        __attribute__((target("avx2")))
+        void encodeHash32Avx2(const unsigned char *hash, char *out) {
+            const __m256i reverse = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+                                                     15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+            const __m256i digits = _mm256_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f',
+                                                    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+            const __m256i lowNibbles = _mm256_set1_epi8(0x0f);
+            __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(hash));
+            // Swap the 128 bit lanes, then reverse the bytes within each of them
+            value = _mm256_shuffle_epi8(_mm256_permute4x64_epi64(value, 0x4e), reverse);
+            __m256i high = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(value, 4), lowNibbles));
+            __m256i low = _mm256_shuffle_epi8(digits, _mm256_and_si256(value, lowNibbles));
+            // Interleaving works per lane, giving the chars of bytes 0-7 and 16-23 and of bytes 8-15 and 24-31
+            __m256i first = _mm256_unpacklo_epi8(high, low);
+            __m256i second = _mm256_unpackhi_epi8(high, low);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), _mm256_permute2x128_si256(first, second, 0x20));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 32), _mm256_permute2x128_si256(first, second, 0x31));
+        }
+
+        __attribute__((target("ssse3")))
+        void encodeHashSsse3(const unsigned char *hash, size_t width, char *out) {
+            size_t offset = 0;
+            for (; offset + 16 <= width; offset += 16) {
+                encodeBlockSsse3(hash + width - offset - 16, out + 2 * offset);
+            }
+            encodeReversed(hash, width - offset, out + 2 * offset);
+        }
+
+        /** Values of 16 hex digits, clearing the bytes of valid that don't hold one */
+        __attribute__((target("ssse3")))
+        __m128i hexNibbles(__m128i chars, __m128i &valid) {
+            // Chars of 0x80 and above are negative and fail both range checks
+            __m128i isDigit = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), chars));
+            __m128i lower = _mm_or_si128(chars, _mm_set1_epi8(0x20));
+            __m128i isLetter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('f' + 1), lower));
+            valid = _mm_and_si128(valid, _mm_or_si128(isDigit, isLetter));
+            __m128i digitValue = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+            __m128i letterValue = _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10));
+            return _mm_or_si128(_mm_and_si128(isDigit, digitValue), _mm_and_si128(isLetter, letterValue));
+        }
+
+        /** decodeReversed of 32 hex digits */
+        __attribute__((target("ssse3")))
+        bool decodeBlockSsse3(const char *hex, unsigned char *bytes) {
+            const __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+            // Multiplies the high nibble of each pair of digits by 16 and adds the low one
+            const __m128i weights = _mm_set1_epi16(0x0110);
+            __m128i valid = _mm_set1_epi8(-1);
+            __m128i first = hexNibbles(_mm_loadu_si128(reinterpret_cast<const __m128i *>(hex)), valid);
+            __m128i second = hexNibbles(_mm_loadu_si128(reinterpret_cast<const __m128i *>(hex + 16)), valid);
+            if (_mm_movemask_epi8(valid) != 0xffff) {
+                return false;
+            }
+            __m128i packed = _mm_packus_epi16(_mm_maddubs_epi16(first, weights), _mm_maddubs_epi16(second, weights));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(bytes), _mm_shuffle_epi8(packed, reverse));
+            return true;
+        }
+
+        __attribute__((target("ssse3")))
+        bool decodeHashSsse3(const char *hex, size_t width, unsigned char *hash) {
+            size_t offset = 0;
+            for (; offset + 16 <= width; offset += 16) {
+                if (!decodeBlockSsse3(hex + 2 * offset, hash + width - offset - 16)) {
+                    return false;
+                }
+            }
+            return decodeReversed(hex + 2 * offset, width - offset, hash);
+        }
+#endif
+    } // namespace
+
+    void encodeHexBatch(const unsigned char *hashes, size_t width, size_t count, char *out) {
+#ifdef BLOCKSCI_HEX_CODEC_X86
+        if (width == 32 && hasAvx2()) {
+            for (size_t i = 0; i < count; i++) {
+                encodeHash32Avx2(hashes + 32 * i, out + 64 * i);
+            }
+            return;
+        }
+        if (hasSsse3()) {
+            for (size_t i = 0; i < count; i++) {
+                encodeHashSsse3(hashes + width * i, width, out + 2 * width * i);
+            }
+            return;
+        }
+#endif
+        for (size_t i = 0; i < count; i++) {
+            encodeReversed(hashes + width * i, width, out + 2 * width * i);
+        }
+    }
+
+    size_t decodeHexBatch(const char *hex, size_t stride, size_t width, size_t count, unsigned char *out) {
+#ifdef BLOCKSCI_HEX_CODEC_X86
+        if (hasSsse3()) {
+            for (size_t i = 0; i < count; i++) {
+                if (!decodeHashSsse3(hex + stride * i, width, out + width * i)) {
+                    return i;
+                }
+            }
+            return count;
+        }
+#endif
+        for (size_t i = 0; i < count; i++) {
+            if (!decodeReversed(hex + stride * i, width, out + width * i)) {
+                return i;
+            }
+        }
+        return count;
+    }
+
+    std::vector<uint256> parseHashes(const std::vector<std::string> &hexStrings) {
+        std::vector<uint256> hashes(hexStrings.size());
+        for (size_t i = 0; i < hexStrings.size(); i++) {
+            auto &str = hexStrings[i];
+            auto digits = str.data();
+            auto length = str.size();
+            if (length == 66 && digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X')) {
+                digits += 2;
+                length -= 2;
+            }
+            if (length != 64 || decodeHexBatch(digits, 64, 32, 1, hashes[i].begin()) != 1) {
+                hashes[i] = uint256S(str);
+            }
+        }
+        return hashes;
+    }
+} // namespace blocksci
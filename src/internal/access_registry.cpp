@@ -0,0 +1,107 @@
+//
+//  access_registry.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "access_registry.hpp"
+#include "cluster_access.hpp"
+#include "data_access.hpp"
+
+#include <sys/stat.h>
+
+#include <climits>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace blocksci {
+    namespace {
+        /** Resolve symlinks and relative components so that every spelling of a path gets the same entry */
+        std::string canonicalPath(const std::string &path) {
+            char resolved[PATH_MAX];
+            if (realpath(path.c_str(), resolved) == nullptr) {
+                return path;
+            }
+            return resolved;
+        }
+
+        using DataAccessKey = std::tuple<std::string, std::string, bool, BlockHeight, uint64_t>;
+
+        /** Identifies the files of a clustering, which are replaced by renaming new ones over them */
+        struct ClusteringFiles {
+            dev_t device = 0;
+            ino_t inode = 0;
+            time_t modified = 0;
+
+            ClusteringFiles() = default;
+
+            explicit ClusteringFiles(const std::string &baseDirectory) {
+                struct stat fileStat;
+                if (stat(ClusterAccess::addressesFilePath(baseDirectory).c_str(), &fileStat) == 0) {
+                    device = fileStat.st_dev;
+                    inode = fileStat.st_ino;
+                    modified = fileStat.st_mtime;
+                }
+            }
+
+            bool operator==(const ClusteringFiles &other) const {
+                return device == other.device && inode == other.inode && modified == other.modified;
+            }
+        };
+
+        struct SharedClustering {
+            ClusteringFiles files;
+            std::weak_ptr<ClusterAccess> access;
+
+            bool expired() const {
+                return access.expired();
+            }
+        };
+
+        template <typename Map>
+        void eraseExpired(Map &entries) {
+            for (auto it = entries.begin(); it != entries.end();) {
+                if (it->second.expired()) {
+                    it = entries.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+    } // namespace
+
+    std::shared_ptr<DataAccess> sharedDataAccess(const DataConfiguration &config) {
+        static std::mutex mutex;
+        static std::map<DataAccessKey, std::weak_ptr<DataAccess>> accesses;
+        DataAccessKey key{canonicalPath(config.chainConfig.dataDirectory.str()), canonicalPath(config.configPath), config.errorOnReorg, config.blocksIgnored, config.snapshotVersion};
+        std::lock_guard<std::mutex> lock(mutex);
+        eraseExpired(accesses);
+        auto &weakAccess = accesses[key];
+        auto access = weakAccess.lock();
+        if (!access) {
+            access = std::make_shared<DataAccess>(config);
+            weakAccess = access;
+        }
+        return access;
+    }
+
+    std::shared_ptr<ClusterAccess> sharedClusterAccess(const std::string &baseDirectory, DataAccess &access) {
+        static std::mutex mutex;
+        static std::map<std::pair<std::string, const DataAccess *>, SharedClustering> clusterings;
+        std::pair<std::string, const DataAccess *> key{canonicalPath(baseDirectory), &access};
+        ClusteringFiles files{baseDirectory};
+        std::lock_guard<std::mutex> lock(mutex);
+        eraseExpired(clusterings);
+        auto &shared = clusterings[key];
+        auto clustering = shared.access.lock();
+        if (!clustering || !(shared.files == files)) {
+            clustering = std::make_shared<ClusterAccess>(baseDirectory, access);
+            shared.files = files;
+            shared.access = clustering;
+        }
+        return clustering;
+    }
+} // namespace blocksci
@@ -0,0 +1,36 @@
+//
+//  access_registry.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_access_registry_hpp
+#define blocksci_access_registry_hpp
+
+#include <memory>
+#include <string>
+
+namespace blocksci {
+    class ClusterAccess;
+    class DataAccess;
+    struct DataConfiguration;
+
+    /** DataAccess of the chain described by the configuration, shared with every other open handle of the same chain
+     *
+     * Handles are the same chain if they were loaded from the same config file with the same data directory, reorg
+     * setting, block limit and snapshot. The registry only holds weak references, so the data files and indexes are
+     * unmapped once the last handle is gone and the next open maps them again. Settings changed through one handle
+     * (parallelism, memory budget, access hints, resident mode) apply to all of them.
+     */
+    std::shared_ptr<DataAccess> sharedDataAccess(const DataConfiguration &config);
+
+    /** ClusterAccess of the clustering in baseDirectory, shared by every ClusterManager of it on the same DataAccess
+     *
+     * A clustering written again since the shared instance was opened gets a new instance, the old one keeps the
+     * replaced files mapped until its managers are gone.
+     */
+    std::shared_ptr<ClusterAccess> sharedClusterAccess(const std::string &baseDirectory, DataAccess &access);
+} // namespace blocksci
+
+#endif /* blocksci_access_registry_hpp */
@@ -0,0 +1,139 @@
+//
+//  access_stats.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "access_stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+namespace blocksci {
+    namespace {
+        void addCounters(AccessStats &stats, const ThreadAccessCounters &counters) {
+            for (size_t i = 0; i < accessEventCount; i++) {
+                auto &source = counters.events[i];
+                auto &target = stats.events[i];
+                target.count += source.count.load(std::memory_order_relaxed);
+                target.timedCount += source.timedCount.load(std::memory_order_relaxed);
+                target.totalNanoseconds += source.totalNanoseconds.load(std::memory_order_relaxed);
+                for (size_t bucket = 0; bucket < accessLatencyBuckets; bucket++) {
+                    target.latencyHistogram[bucket] += source.latencyHistogram[bucket].load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /** Counters of the running threads and the sum of the counters of the exited ones */
+        class AccessCounterRegistry {
+            std::mutex mutex;
+            std::vector<const ThreadAccessCounters *> live;
+            AccessStats retired;
+
+        public:
+            void add(const ThreadAccessCounters *counters) {
+                std::lock_guard<std::mutex> lock(mutex);
+                live.push_back(counters);
+            }
+
+            void retire(const ThreadAccessCounters *counters) {
+                std::lock_guard<std::mutex> lock(mutex);
+                addCounters(retired, *counters);
+                live.erase(std::remove(live.begin(), live.end(), counters), live.end());
+            }
+
+            AccessStats collect() {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto stats = retired;
+                for (auto counters : live) {
+                    addCounters(stats, *counters);
+                }
+                return stats;
+            }
+        };
+
+        /** Never destroyed, threads can exit after the static destructors ran */
+        AccessCounterRegistry &registry() {
+            static auto *instance = new AccessCounterRegistry;
+            return *instance;
+        }
+
+        struct ThreadRegistration {
+            ThreadAccessCounters counters;
+
+            ThreadRegistration() {
+                registry().add(&counters);
+            }
+
+            ~ThreadRegistration() {
+                registry().retire(&counters);
+            }
+        };
+    } // namespace
+
+    ThreadAccessCounters &threadAccessCounters() {
+        thread_local ThreadRegistration registration;
+        return registration.counters;
+    }
+
+    AccessStats collectAccessStats() {
+#ifdef BLOCKSCI_WITH_INSTRUMENTATION
+        auto stats = registry().collect();
+        stats.enabled = true;
+        return stats;
+#else
+        return AccessStats{};
+#endif
+    }
+
+    uint64_t AccessEventStats::quantileNanoseconds(double quantile) const {
+        if (timedCount == 0) {
+            return 0;
+        }
+        auto rank = static_cast<uint64_t>(std::ceil(std::min(std::max(quantile, 0.0), 1.0) * static_cast<double>(timedCount)));
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < accessLatencyBuckets; bucket++) {
+            seen += latencyHistogram[bucket];
+            if (seen >= std::max(rank, uint64_t{1})) {
+                return (uint64_t{1} << (bucket + 1)) - 1;
+            }
+        }
+        return (uint64_t{1} << accessLatencyBuckets) - 1;
+    }
+
+    AccessStats AccessStats::operator-(const AccessStats &other) const {
+        AccessStats delta = *this;
+        for (size_t i = 0; i < accessEventCount; i++) {
+            auto &target = delta.events[i];
+            auto &source = other.events[i];
+            target.count -= source.count;
+            target.timedCount -= source.timedCount;
+            target.totalNanoseconds -= source.totalNanoseconds;
+            for (size_t bucket = 0; bucket < accessLatencyBuckets; bucket++) {
+                target.latencyHistogram[bucket] -= source.latencyHistogram[bucket];
+            }
+        }
+        return delta;
+    }
+
+    const char *accessEventName(AccessEvent event) {
+        switch (event) {
+            case AccessEvent::TxDecode:
+                return "tx_decode";
+            case AccessEvent::BlockHeightLookup:
+                return "block_height_lookup";
+            case AccessEvent::ScriptLoad:
+                return "script_load";
+            case AccessEvent::HashIndexLookup:
+                return "hash_index_lookup";
+            case AccessEvent::AddressIndexLookup:
+                return "address_index_lookup";
+            case AccessEvent::IndexIteratorStep:
+                return "index_iterator_step";
+        }
+        return "unknown";
+    }
+} // namespace blocksci
@@ -0,0 +1,90 @@
+//
+//  access_stats.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_internal_access_stats_hpp
+#define blocksci_internal_access_stats_hpp
+
+#include <blocksci/core/access_stats.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+
+namespace blocksci {
+    /** Only every n-th event of a thread is timed, reading the clock costs about as much as a warm tx lookup */
+    constexpr uint64_t accessLatencySampleInterval = 16;
+
+    /** Access counters of one thread
+     *
+     * Only the owning thread writes them, so increments are plain relaxed loads and stores without a locked
+     * instruction. Readers merge the counters of all threads, @see collectAccessStats */
+    struct ThreadAccessCounters {
+        struct Event {
+            std::atomic<uint64_t> count{0};
+            std::atomic<uint64_t> timedCount{0};
+            std::atomic<uint64_t> totalNanoseconds{0};
+            std::array<std::atomic<uint64_t>, accessLatencyBuckets> latencyHistogram{};
+        };
+
+        std::array<Event, accessEventCount> events;
+
+        static void increment(std::atomic<uint64_t> &counter, uint64_t amount = 1) {
+            counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+        }
+    };
+
+    /** Counters of the calling thread, registered with the process-wide registry on first use and merged into the
+     * totals of exited threads when the thread exits */
+    ThreadAccessCounters &threadAccessCounters();
+
+    /** Sum of the counters of all threads, including the ones that exited */
+    AccessStats collectAccessStats();
+
+    /** Counts one event and times it if it is the thread's sampled one */
+    class ScopedAccessTimer {
+        ThreadAccessCounters::Event &counters;
+        bool timed;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        explicit ScopedAccessTimer(AccessEvent event) : counters(threadAccessCounters().events[static_cast<size_t>(event)]) {
+            auto count = counters.count.load(std::memory_order_relaxed);
+            counters.count.store(count + 1, std::memory_order_relaxed);
+            timed = count % accessLatencySampleInterval == 0;
+            if (timed) {
+                start = std::chrono::steady_clock::now();
+            }
+        }
+
+        ScopedAccessTimer(const ScopedAccessTimer &) = delete;
+        ScopedAccessTimer &operator=(const ScopedAccessTimer &) = delete;
+
+        ~ScopedAccessTimer() {
+            if (!timed) {
+                return;
+            }
+            auto nanoseconds = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+            size_t bucket = 0;
+            while (bucket + 1 < accessLatencyBuckets && (nanoseconds >> (bucket + 1)) != 0) {
+                bucket++;
+            }
+            ThreadAccessCounters::increment(counters.timedCount);
+            ThreadAccessCounters::increment(counters.totalNanoseconds, nanoseconds);
+            ThreadAccessCounters::increment(counters.latencyHistogram[bucket]);
+        }
+    };
+} // namespace blocksci
+
+/** Count (and sample the latency of) the enclosing scope as one AccessEvent, compiled out unless the build was
+ * configured with -DBLOCKSCI_INSTRUMENTATION=ON */
+#ifdef BLOCKSCI_WITH_INSTRUMENTATION
+#define BLOCKSCI_COUNT_ACCESS(event) ::blocksci::ScopedAccessTimer blocksciAccessTimer{::blocksci::AccessEvent::event}
+#else
+#define BLOCKSCI_COUNT_ACCESS(event) static_cast<void>(0)
+#endif
+
+#endif /* blocksci_internal_access_stats_hpp */
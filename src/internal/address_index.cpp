@@ -9,25 +9,46 @@
 #define BLOCKSCI_WITHOUT_SINGLETON
 
 #include "address_index.hpp"
+#include "access_stats.hpp"
 #include "address_info.hpp"
+#include "address_tables.hpp"
+#include "index_open.hpp"
 #include "column_iterator.hpp"
+#include "column_scan.hpp"
 #include "dedup_address_info.hpp"
 #include "memory_view.hpp"
+#include "script_access.hpp"
+#include "segment_work.hpp"
+#include "tracing.hpp"
+#include "sst_bulk_loader.hpp"
 
 #include <blocksci/core/inout_pointer.hpp>
 #include <blocksci/core/raw_address.hpp>
 #include <blocksci/core/dedup_address.hpp>
 
-#include <range/v3/view/transform.hpp>
 #include <range/v3/range_for.hpp>
+#include <range/v3/view/concat.hpp>
+#include <range/v3/view/filter.hpp>
+#include <range/v3/view/iota.hpp>
+#include <range/v3/view/subrange.hpp>
+#include <range/v3/view/transform.hpp>
 
 #include <endian/big_endian.hpp>
 
+#include <rocksdb/cache.h>
+#include <rocksdb/filter_policy.h>
+#include <rocksdb/slice_transform.h>
+#include <rocksdb/table.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
 #include <sstream>
+#include <tuple>
 
 namespace blocksci {
 
-    AddressIndex::AddressIndex(const filesystem::path &path, bool readonly) {
+    AddressIndex::AddressIndex(const filesystem::path &path, IndexOpenMode mode, std::shared_ptr<rocksdb::Cache> blockCache, const IndexTuning &tuning) : openMode(mode) {
         rocksdb::Options options;
         // Optimize RocksDB. This is the easiest way to get RocksDB to perform well
         options.IncreaseParallelism();
@@ -36,45 +57,78 @@ namespace blocksci {
         options.create_if_missing = true;
         options.create_missing_column_families = true;
 
+        // Every key starts with the scriptNum of the address it belongs to. Bloom filters hold both whole keys and
+        // scriptNum prefixes and are cached together with the index blocks, so the cache bounds the memory used.
+        rocksdb::BlockBasedTableOptions tableOptions;
+        tableOptions.block_cache = blockCache ? std::move(blockCache) : rocksdb::NewLRUCache(defaultBlockCacheSize);
+        tableOptions.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10, false));
+        tableOptions.whole_key_filtering = true;
+        tableOptions.cache_index_and_filter_blocks = true;
+        tableOptions.pin_l0_filter_and_index_blocks_in_cache = true;
+        
+        addressColumnOptions.OptimizeLevelStyleCompaction();
+        addressColumnOptions.prefix_extractor.reset(rocksdb::NewFixedPrefixTransform(sizeof(uint32_t)));
+        addressColumnOptions.memtable_prefix_bloom_size_ratio = 0.02;
+        applyIndexTuning(tuning, options, addressColumnOptions, tableOptions);
+        addressColumnOptions.table_factory.reset(rocksdb::NewBlockBasedTableFactory(tableOptions));
 
         // Initialize RocksDB column families
         std::vector<rocksdb::ColumnFamilyDescriptor> columnDescriptors;
         blocksci::for_each(AddressType::all(), [&](auto tag) {
             std::stringstream ss;
             ss << addressName(tag) << "_output";
-            columnDescriptors.emplace_back(ss.str(), rocksdb::ColumnFamilyOptions{});
+            columnDescriptors.emplace_back(ss.str(), addressColumnOptions);
         });
         blocksci::for_each(AddressType::all(), [&](auto tag) {
             std::stringstream ss;
             ss << addressName(tag) << "_nested";
-            columnDescriptors.emplace_back(ss.str(), rocksdb::ColumnFamilyOptions{});
+            columnDescriptors.emplace_back(ss.str(), addressColumnOptions);
         });
         columnDescriptors.emplace_back(rocksdb::kDefaultColumnFamilyName, rocksdb::ColumnFamilyOptions());
 
-        rocksdb::DB *dbPtr;
-        std::vector<rocksdb::ColumnFamilyHandle *> columnHandlePtrs;
-        if (readonly) {
-            rocksdb::Status s = rocksdb::DB::OpenForReadOnly(options, path.str().c_str(), columnDescriptors, &columnHandlePtrs, &dbPtr);
-            if (!s.ok()) {
-                throw std::runtime_error{"Could not open address index with error: " + std::string{s.getState()}};
-            }
-        } else {
-            rocksdb::Status s = rocksdb::DB::Open(options, path.str().c_str(), columnDescriptors, &columnHandlePtrs, &dbPtr);
-            if (!s.ok()) {
-                throw std::runtime_error{"Could not open address index with error: " + std::string{s.getState()}};
-            }
-        }
-        db = std::unique_ptr<rocksdb::DB>(dbPtr);
-        for (auto handle : columnHandlePtrs) {
-            columnHandles.emplace_back(std::unique_ptr<rocksdb::ColumnFamilyHandle>(handle));
-        }
+        db = openIndexDB(options, path, mode, columnDescriptors, columnHandles, "address index");
+        warmup = startIndexWarmup(tuning, mode, *db, columnHandles);
     }
 
     AddressIndex::~AddressIndex() = default;
+    
+    void AddressIndex::catchUpWithPrimary() {
+        blocksci::catchUpWithPrimary(*db, openMode, "address index");
+    }
 
-    void AddressIndex::compactDB() {
+    void AddressIndex::writeBatch(rocksdb::WriteBatch &batch) {
+        if (bulkLoader) {
+            std::lock_guard<std::mutex> lock(bulkLoaderMutex);
+            bulkLoader->add(batch);
+            return;
+        }
+        rocksdb::WriteOptions options;
+        options.disableWAL = true;
+        db->Write(options, &batch);
+    }
+    
+    void AddressIndex::beginBulkLoad() {
+        std::vector<rocksdb::ColumnFamilyHandle *> handles;
+        for (auto &handle : columnHandles) {
+            handles.push_back(handle.get());
+        }
+        bulkLoader = std::make_unique<SstBulkLoader>(db.get(), handles, filesystem::path{db->GetName() + "Bulk"});
+    }
+    
+    void AddressIndex::finishBulkLoad() {
+        if (bulkLoader) {
+            bulkLoader->finish();
+            bulkLoader.reset();
+        }
+    }
+    
+    void AddressIndex::compactDB(bool rewriteTableFiles) {
+        rocksdb::CompactRangeOptions compactOptions;
+        if (rewriteTableFiles) {
+            compactOptions.bottommost_level_compaction = rocksdb::BottommostLevelCompaction::kForce;
+        }
         for (auto &column : columnHandles) {
-            db->CompactRange(rocksdb::CompactRangeOptions{}, column.get(), nullptr, nullptr);
+            db->CompactRange(compactOptions, column.get(), nullptr, nullptr);
         }
     }
 
@@ -86,24 +140,323 @@ namespace blocksci {
         return columnHandles[AddressType::size + static_cast<size_t>(type)];
     }
 
+    namespace {
+        void decodeOutputKey(const rocksdb::Slice &key, uint32_t &scriptNum, InoutPointer &outPoint) {
+            uint8_t txNumData[4];
+            uint8_t outputNumData[2];
+            memcpy(&scriptNum, key.data(), sizeof(scriptNum));
+            memcpy(txNumData, key.data() + sizeof(scriptNum), 4);
+            memcpy(outputNumData, key.data() + sizeof(scriptNum) + 4, 2);
+            endian::big_endian::get(outPoint.txNum, txNumData);
+            endian::big_endian::get(outPoint.inoutNum, outputNumData);
+        }
+        
+        void decodeNestedKey(const rocksdb::Slice &key, uint32_t &scriptNum, DedupAddress &parent) {
+            memcpy(&scriptNum, key.data(), sizeof(scriptNum));
+            memcpy(&parent, key.data() + sizeof(scriptNum), sizeof(parent));
+        }
+        
+        bool nestedLess(const DedupAddress &a, const DedupAddress &b) {
+            return std::tie(a.scriptNum, a.type) < std::tie(b.scriptNum, b.type);
+        }
+        
+        void sortUnique(std::vector<DedupAddress> &addresses) {
+            std::sort(addresses.begin(), addresses.end(), nestedLess);
+            addresses.erase(std::unique(addresses.begin(), addresses.end()), addresses.end());
+        }
+        
+        /** Write the entries of the previous table and the accepted entries of a column to a new AddressTable
+         *
+         * The entries of every address are the ones from the previous table followed by the ones from the column in
+         * key order, which finalize can reorder and shrink by returning a new end.
+         */
+        template <typename T, typename DecodeFunc, typename FinalizeFunc>
+        void buildAddressTable(rocksdb::Iterator &it, const AddressTable<T> *previousTable, uint32_t addressCount, const filesystem::path &offsetsPath, const filesystem::path &entriesPath, const std::string &tableName, DecodeFunc decode, FinalizeFunc finalize) {
+            if (previousTable != nullptr) {
+                addressCount = std::max(addressCount, previousTable->addressCount());
+            }
+            
+            FixedSizeFileMapper<uint64_t, mio::access_mode::write> offsets{offsetsPath};
+            offsets.truncate(OffsetType{addressCount} + 1);
+            uint64_t *offsetsData = offsets[0];
+            
+            // Count the entries of every address into the slot of the following address
+            uint32_t scriptNum;
+            T entry;
+            for (it.SeekToFirst(); it.Valid(); it.Next()) {
+                if (!decode(it.key(), scriptNum, entry)) {
+                    continue;
+                }
+                if (scriptNum >= addressCount) {
+                    throw std::runtime_error("Address index column " + tableName + " contains unknown address " + std::to_string(scriptNum));
+                }
+                offsetsData[scriptNum + 1]++;
+            }
+            if (previousTable != nullptr) {
+                for (uint32_t i = 0; i < previousTable->addressCount(); i++) {
+                    auto range = previousTable->get(i);
+                    offsetsData[i + 1] += static_cast<uint64_t>(range.second - range.first);
+                }
+            }
+            // Now offsetsData[i + 1] is the end of the entries of address i
+            for (OffsetType i = 1; i <= addressCount; i++) {
+                offsetsData[i] += offsetsData[i - 1];
+            }
+            auto totalCount = offsetsData[addressCount];
+            if (totalCount == 0) {
+                offsets.truncate(0);
+                return;
+            }
+            
+            FixedSizeFileMapper<T, mio::access_mode::write> entries{entriesPath};
+            entries.truncate(static_cast<OffsetType>(totalCount));
+            T *entriesData = entries[0];
+            
+            // Filling every address from its end moves offsetsData[i + 1] down to the beginning of address i. The
+            // column is placed first and in reverse so that its entries follow the previous ones in key order.
+            for (it.SeekToLast(); it.Valid(); it.Prev()) {
+                if (decode(it.key(), scriptNum, entry)) {
+                    entriesData[--offsetsData[scriptNum + 1]] = entry;
+                }
+            }
+            if (previousTable != nullptr) {
+                for (uint32_t i = 0; i < previousTable->addressCount(); i++) {
+                    auto range = previousTable->get(i);
+                    offsetsData[i + 1] -= static_cast<uint64_t>(range.second - range.first);
+                    std::copy(range.first, range.second, entriesData + offsetsData[i + 1]);
+                }
+            }
+            
+            // offsetsData[i + 1] now holds the beginning of address i, finalize every address and close the gaps
+            uint64_t writePos = 0;
+            for (OffsetType i = 0; i < addressCount; i++) {
+                auto begin = entriesData + offsetsData[i + 1];
+                auto end = entriesData + (i + 1 < addressCount ? offsetsData[i + 2] : totalCount);
+                end = finalize(begin, end);
+                auto count = static_cast<uint64_t>(end - begin);
+                if (entriesData + writePos != begin) {
+                    std::memmove(entriesData + writePos, begin, count * sizeof(T));
+                }
+                offsetsData[i] = writePos;
+                writePos += count;
+            }
+            offsetsData[addressCount] = writePos;
+            if (writePos != totalCount) {
+                entries.truncate(static_cast<OffsetType>(writePos));
+            }
+        }
+    }
+
     ranges::any_view<InoutPointer, ranges::category::forward> AddressIndex::getOutputPointers(const RawAddress &address) const {
+        // Only the start of the scan, its steps are counted by ColumnIterator
+        BLOCKSCI_COUNT_ACCESS(AddressIndexLookup);
         auto prefixData = reinterpret_cast<const char *>(&address.scriptNum);
         std::vector<char> prefix(prefixData, prefixData + sizeof(address.scriptNum));  // vector with scriptNum bytes
         auto rawOutputPointerRange = ColumnIterator(db.get(), getOutputColumn(address.type).get(), prefix);
-        return rawOutputPointerRange | ranges::views::transform([](std::pair<MemoryView, MemoryView> pair) -> InoutPointer {
+        auto columnPointers = rawOutputPointerRange | ranges::views::transform([](std::pair<MemoryView, MemoryView> pair) -> InoutPointer {
+            uint32_t scriptNum;
             InoutPointer outPoint;
-            uint8_t txNumData[4];
-            uint8_t outputNumData[2];
-
-            auto &key = pair.first;  // Query result
-            key.data += sizeof(uint32_t);  // Skip the scriptNum in the key (first 4 bytes), as it is known already
-            memcpy(txNumData, key.data, 4);
-            key.data += sizeof(txNumData); // Move the key.data pointer forward
-            memcpy(outputNumData, key.data, 2);
-            endian::big_endian::get(outPoint.txNum, txNumData);
-            endian::big_endian::get(outPoint.inoutNum, outputNumData);
+            decodeOutputKey(rocksdb::Slice{pair.first.data, pair.first.size}, scriptNum, outPoint);
             return outPoint;
         });
+        if (!addressTables) {
+            return columnPointers;
+        }
+        
+        // The columns can still contain outputs of the tables if the parser stopped during a rebuild
+        auto coveredTxCount = addressTables->txCount();
+        ranges::any_view<InoutPointer, ranges::category::forward> recentPointers = columnPointers | ranges::views::filter([coveredTxCount](const InoutPointer &pointer) {
+            return pointer.txNum >= coveredTxCount;
+        });
+        auto table = addressTables->getOutputs(address.type);
+        if (table == nullptr) {
+            return recentPointers;
+        }
+        auto tableRange = table->get(address.scriptNum);
+        ranges::any_view<InoutPointer, ranges::category::forward> tablePointers = ranges::make_subrange(tableRange.first, tableRange.second);
+        return ranges::views::concat(tablePointers, recentPointers);
+    }
+
+    std::vector<DedupAddress> AddressIndex::getNestingAddresses(const RawAddress &searchAddress) const {
+        BLOCKSCI_COUNT_ACCESS(AddressIndexLookup);
+        TraceSpan scanSpan{TraceOperation::IndexScan};
+        std::vector<DedupAddress> parents;
+        rocksdb::Slice key{reinterpret_cast<const char *>(&searchAddress.scriptNum), sizeof(searchAddress.scriptNum)};
+        ScanOptions scanOptions{key.data(), key.size()};
+        std::unique_ptr<rocksdb::Iterator> it;
+        {
+            TraceSpan seekSpan{TraceOperation::IndexSeek};
+            it.reset(db->NewIterator(scanOptions.get(), getNestedColumn(searchAddress.type).get()));
+            it->Seek(key);
+        }
+        for (; it->Valid(); it->Next()) {
+            BLOCKSCI_COUNT_ACCESS(IndexIteratorStep);
+            uint32_t scriptNum;
+            DedupAddress parent;
+            decodeNestedKey(it->key(), scriptNum, parent);
+            parents.push_back(parent);
+        }
+        auto table = addressTables ? addressTables->getNested(searchAddress.type) : nullptr;
+        if (table != nullptr) {
+            auto range = table->get(searchAddress.scriptNum);
+            if (range.first != range.second) {
+                parents.insert(parents.end(), range.first, range.second);
+                // The column can still contain relations of the table if the parser stopped during a rebuild
+                sortUnique(parents);
+            }
+        }
+        return parents;
+    }
+
+    void AddressIndex::useAddressTables(const filesystem::path &directory) {
+        auto tables = std::make_unique<AddressTables>(directory);
+        if (tables->isGood()) {
+            addressTables = std::move(tables);
+        } else {
+            addressTables.reset();
+        }
+    }
+    
+    uint32_t AddressIndex::addressTablesTxCount() const {
+        return addressTables ? addressTables->txCount() : 0;
+    }
+    
+    std::vector<uint32_t> AddressIndex::countOutputs(AddressType::Enum type, uint32_t addressCount, uint32_t threadCount) const {
+        std::vector<uint32_t> counts(addressCount, 0);
+        auto coveredTxCount = addressTables ? addressTables->txCount() : 0;
+        auto table = addressTables ? addressTables->getOutputs(type) : nullptr;
+        if (table != nullptr) {
+            auto tableCount = std::min(addressCount, table->addressCount());
+            segmentWork(0, tableCount, resolveThreadCount(threadCount), [&](uint32_t scriptNum) {
+                auto range = table->get(scriptNum);
+                counts[scriptNum] = static_cast<uint32_t>(range.second - range.first);
+            });
+        }
+        
+        // All keys of an address are adjacent, so only the first and last address of a key range can also appear in
+        // another range. Their counts are added after the scan, the others directly.
+        std::vector<std::vector<std::pair<uint32_t, uint32_t>>> boundaryCounts(resolveThreadCount(threadCount));
+        scanColumnParallel(db.get(), getOutputColumn(type).get(), threadCount, [&](uint32_t threadNum, rocksdb::Iterator &it) {
+            bool first = true;
+            uint32_t runScriptNum = 0;
+            uint32_t runCount = 0;
+            for (; it.Valid(); it.Next()) {
+                uint32_t scriptNum;
+                InoutPointer pointer;
+                decodeOutputKey(it.key(), scriptNum, pointer);
+                // The column can still contain outputs of the tables if the parser stopped during a rebuild
+                if (pointer.txNum < coveredTxCount || scriptNum >= addressCount) {
+                    continue;
+                }
+                if (runCount > 0 && scriptNum != runScriptNum) {
+                    if (first) {
+                        boundaryCounts[threadNum].emplace_back(runScriptNum, runCount);
+                        first = false;
+                    } else {
+                        counts[runScriptNum] += runCount;
+                    }
+                    runCount = 0;
+                }
+                runScriptNum = scriptNum;
+                runCount++;
+            }
+            if (runCount > 0) {
+                boundaryCounts[threadNum].emplace_back(runScriptNum, runCount);
+            }
+        });
+        for (auto &threadCounts : boundaryCounts) {
+            for (auto &count : threadCounts) {
+                counts[count.first] += count.second;
+            }
+        }
+        return counts;
+    }
+    
+    std::shared_ptr<rocksdb::Cache> AddressIndex::getBlockCache() const {
+        auto tableOptions = addressColumnOptions.table_factory->GetOptions<rocksdb::BlockBasedTableOptions>();
+        return tableOptions ? tableOptions->block_cache : nullptr;
+    }
+    
+    void AddressIndex::resetColumn(size_t columnIndex) {
+        auto &handle = columnHandles[columnIndex];
+        auto name = handle->GetName();
+        auto s = db->DropColumnFamily(handle.get());
+        if (!s.ok()) {
+            throw std::runtime_error{"Could not clear column " + name + " with error: " + s.ToString()};
+        }
+        handle.reset();
+        rocksdb::ColumnFamilyHandle *newHandle;
+        s = db->CreateColumnFamily(addressColumnOptions, name, &newHandle);
+        if (!s.ok()) {
+            throw std::runtime_error{"Could not recreate column " + name + " with error: " + s.ToString()};
+        }
+        handle.reset(newHandle);
+    }
+    
+    void AddressIndex::clearOutputColumn(AddressType::Enum type) {
+        resetColumn(static_cast<size_t>(type));
+    }
+    
+    void AddressIndex::clearNestedColumn(AddressType::Enum type) {
+        resetColumn(AddressType::size + static_cast<size_t>(type));
+    }
+    
+    void AddressIndex::rebuildAddressTables(const filesystem::path &directory, uint32_t txCount, const ScriptAccess &scripts) {
+        if (!directory.exists()) {
+            filesystem::create_directory(directory);
+        }
+        AddressTables previous{directory};
+        auto generation = previous.getGeneration() + 1;
+        auto coveredTxCount = previous.txCount();
+        AddressTables::removeGeneration(directory, generation);
+        
+        rocksdb::ReadOptions scanOptions;
+        scanOptions.total_order_seek = true;
+        for (size_t i = 0; i < AddressType::size; i++) {
+            auto type = static_cast<AddressType::Enum>(i);
+            // scriptNums start at 1
+            auto addressCount = scripts.scriptCount(dedupType(type)) + 1;
+            
+            auto outputName = AddressTables::outputTableName(type);
+            std::unique_ptr<rocksdb::Iterator> outputIt{db->NewIterator(scanOptions, getOutputColumn(type).get())};
+            buildAddressTable(*outputIt, previous.getOutputs(type), addressCount, AddressTables::offsetsPath(directory, outputName, generation), AddressTables::entriesPath(directory, outputName, generation), outputName,
+                [coveredTxCount](const rocksdb::Slice &key, uint32_t &scriptNum, InoutPointer &pointer) {
+                decodeOutputKey(key, scriptNum, pointer);
+                return pointer.txNum >= coveredTxCount;
+            }, [txCount](InoutPointer *begin, InoutPointer *end) {
+                // Previous outputs are older than the ones still in the column, the keys sort the rest by txNum. The
+                // previous table can cover transactions that were removed by a reorganization since.
+                return std::remove_if(begin, end, [txCount](const InoutPointer &pointer) {
+                    return pointer.txNum >= txCount;
+                });
+            });
+            
+            auto nestedName = AddressTables::nestedTableName(type);
+            std::unique_ptr<rocksdb::Iterator> nestedIt{db->NewIterator(scanOptions, getNestedColumn(type).get())};
+            buildAddressTable(*nestedIt, previous.getNested(type), addressCount, AddressTables::offsetsPath(directory, nestedName, generation), AddressTables::entriesPath(directory, nestedName, generation), nestedName,
+                [](const rocksdb::Slice &key, uint32_t &scriptNum, DedupAddress &parent) {
+                decodeNestedKey(key, scriptNum, parent);
+                return true;
+            }, [&scripts](DedupAddress *begin, DedupAddress *end) {
+                std::sort(begin, end, nestedLess);
+                end = std::unique(begin, end);
+                return std::remove_if(begin, end, [&scripts](const DedupAddress &parent) {
+                    return parent.scriptNum > scripts.scriptCount(parent.type);
+                });
+            });
+        }
+        AddressTables::writeMeta(directory, generation, txCount);
+        
+        // Dropping the columns discards their files at once instead of writing a tombstone for every row
+        for (size_t i = 0; i < 2 * AddressType::size; i++) {
+            resetColumn(i);
+        }
+        
+        addressTables.reset();
+        if (previous.isGood()) {
+            AddressTables::removeGeneration(directory, previous.getGeneration());
+        }
+        useAddressTables(directory);
     }
 
     ranges::any_view<RawAddress> AddressIndex::getIncludingMultisigs(const RawAddress &searchAddress) const {
@@ -111,6 +464,14 @@ namespace blocksci {
             return {};
         }
 
+        if (addressTables) {
+            auto parents = std::make_shared<std::vector<DedupAddress>>(getNestingAddresses({searchAddress.scriptNum, AddressType::MULTISIG_PUBKEY}));
+            return ranges::views::iota(size_t{0}, parents->size()) | ranges::views::transform([parents](size_t i) {
+                return RawAddress{(*parents)[i].scriptNum, AddressType::MULTISIG};
+            });
+        }
+
+        BLOCKSCI_COUNT_ACCESS(AddressIndexLookup);
         auto prefixData = reinterpret_cast<const char *>(&searchAddress.scriptNum);
         std::vector<char> prefix(prefixData, prefixData + sizeof(searchAddress.scriptNum));
         auto rawDedupAddressRange = ColumnIterator(db.get(), getNestedColumn(AddressType::MULTISIG_PUBKEY).get(), prefix);
@@ -123,28 +484,18 @@ namespace blocksci {
         });
     }
 
-    void AddressIndex::addNestedAddresses(std::vector<std::pair<blocksci::RawAddress, blocksci::DedupAddress>> nestedCache) {
-        rocksdb::WriteBatch batch;
-        for (auto &pair : nestedCache) {
-            const RawAddress &childAddress = pair.first;
-            const DedupAddress &parentAddress = pair.second;
+    namespace {
+        std::string nestedKey(const RawAddress &childAddress, const DedupAddress &parentAddress) {
             std::array<rocksdb::Slice, 2> keyParts = {{
                 rocksdb::Slice(reinterpret_cast<const char *>(&childAddress.scriptNum), sizeof(childAddress.scriptNum)),
                 rocksdb::Slice(reinterpret_cast<const char *>(&parentAddress), sizeof(parentAddress))
             }};
             std::string sliceStr;
             rocksdb::Slice key{rocksdb::SliceParts{keyParts.data(), keyParts.size()}, &sliceStr};
-            auto &nestedColumn = getNestedColumn(childAddress.type);
-            batch.Put(nestedColumn.get(), key, rocksdb::Slice{});
+            return key.ToString();
         }
-        writeBatch(batch);
-    }
-
-    void AddressIndex::addOutputAddresses(std::vector<std::pair<RawAddress, InoutPointer>> outputCache) {
-        rocksdb::WriteBatch batch;
-        for (auto &pair : outputCache) {
-            const RawAddress &address = pair.first;
-            const InoutPointer &pointer = pair.second;
+        
+        std::string outputKey(const RawAddress &address, const InoutPointer &pointer) {
             uint8_t txNumData[4];
             uint8_t outputNumData[2];
             endian::big_endian::put(pointer.txNum, txNumData);
@@ -156,8 +507,42 @@ namespace blocksci {
             }};
             std::string sliceStr;
             rocksdb::Slice key{rocksdb::SliceParts{keyParts.data(), keyParts.size()}, &sliceStr};
-            auto &outputColumn = getOutputColumn(address.type);
-            batch.Put(outputColumn.get(), key, rocksdb::Slice{});
+            return key.ToString();
+        }
+    }
+
+    void AddressIndex::addNestedAddresses(std::vector<std::pair<blocksci::RawAddress, blocksci::DedupAddress>> nestedCache) {
+        rocksdb::WriteBatch batch;
+        for (auto &pair : nestedCache) {
+            auto &nestedColumn = getNestedColumn(pair.first.type);
+            batch.Put(nestedColumn.get(), nestedKey(pair.first, pair.second), rocksdb::Slice{});
+        }
+        writeBatch(batch);
+    }
+
+    void AddressIndex::addOutputAddresses(std::vector<std::pair<RawAddress, InoutPointer>> outputCache) {
+        rocksdb::WriteBatch batch;
+        for (auto &pair : outputCache) {
+            auto &outputColumn = getOutputColumn(pair.first.type);
+            batch.Put(outputColumn.get(), outputKey(pair.first, pair.second), rocksdb::Slice{});
+        }
+        writeBatch(batch);
+    }
+    
+    void AddressIndex::removeNestedAddresses(const std::vector<std::pair<RawAddress, DedupAddress>> &relations) {
+        rocksdb::WriteBatch batch;
+        for (auto &pair : relations) {
+            auto &nestedColumn = getNestedColumn(pair.first.type);
+            batch.Delete(nestedColumn.get(), nestedKey(pair.first, pair.second));
+        }
+        writeBatch(batch);
+    }
+    
+    void AddressIndex::removeOutputAddresses(const std::vector<std::pair<RawAddress, InoutPointer>> &outputs) {
+        rocksdb::WriteBatch batch;
+        for (auto &pair : outputs) {
+            auto &outputColumn = getOutputColumn(pair.first.type);
+            batch.Delete(outputColumn.get(), outputKey(pair.first, pair.second));
         }
         writeBatch(batch);
     }
@@ -167,19 +552,7 @@ namespace blocksci {
      It's possible to receive multiple results, since multisig addresses are deduplicated, but their pubkeys might be arranged in different order, leading to different wrapping addresses.
      */
     std::vector<DedupAddress> AddressIndex::getNestingScriptHash(const RawAddress &searchAddress) const {
-        std::vector<DedupAddress> parents;
-        rocksdb::Slice key{reinterpret_cast<const char *>(&searchAddress.scriptNum), sizeof(searchAddress.scriptNum)};
-        auto it = getNestedIterator(searchAddress.type);
-        it->Seek(key);
-        while (it->Valid() && it->key().starts_with(key)) {
-            auto foundKey = it->key();
-            foundKey.remove_prefix(sizeof(uint32_t));
-            DedupAddress rawParent;
-            memcpy(&rawParent, foundKey.data(), sizeof(rawParent));
-            parents.push_back(rawParent);
-            it->Next();
-        }
-        return parents;
+        return getNestingAddresses(searchAddress);
     }
 
     std::unordered_set<DedupAddress> AddressIndex::getPossibleNestedEquivalentUp(const RawAddress &searchAddress) const {
@@ -9,6 +9,8 @@
 #ifndef address_index_hpp
 #define address_index_hpp
 
+#include "index_open.hpp"
+
 #include <blocksci/core/address_types.hpp>
 #include <blocksci/core/core_fwd.hpp>
 
@@ -20,6 +22,7 @@
 #include <wjfilesystem/path.h>
 
 #include <memory>
+#include <mutex>
 #include <unordered_set>
 #include <string>
 #include <vector>
@@ -27,6 +30,9 @@
 namespace blocksci {
     struct DedupAddress;
     class RawAddressOutputRange;
+    class AddressTables;
+    class ScriptAccess;
+    class SstBulkLoader;
 
     /** Provides access to address indexes (RocksDB database)
      *
@@ -49,6 +55,9 @@ namespace blocksci {
      *        - Key: uint32_t scriptNum, uint8_t[4] txNum, uint8_t[2] outputNumInTx
      *        - Value: <empty>
      *
+     *    The outputs of the older part of the chain can be moved into AddressTables, after which these
+     *    columns only hold the outputs added since, @see useAddressTables()
+     *
      * 2) The second set of tables store information how certain address types are nested inside each other.
      *    The two places this occurs are with p2sh addresses wrapping other addresses and with multisig addresses containing pubkeys.
      *
@@ -58,37 +67,68 @@ namespace blocksci {
      *    Key/value format:
      *        - Keys: uint32_t child scriptNum, DedupAddress (= parent scriptNum, parent script type)
      *        - Value: <empty>
+     *
+     *    Like the outputs, the relations of the older part of the chain can be moved into AddressTables.
+     *
+     * All columns use the leading scriptNum as prefix for their bloom filters, so the lookup of a single address only
+     * reads the table files that contain it. Data blocks are cached in a block cache shared by all columns.
      */
     class AddressIndex {
         friend class RawAddressOutputRange;
 
         /** Pointer to the RocksDB instance */
         std::unique_ptr<rocksdb::DB> db;
+        
+        IndexOpenMode openMode;
 
         /** RocksDB column handles, one for every AddressType and the suffixes "_nested" and "_output", see above for details */
         std::vector<std::unique_ptr<rocksdb::ColumnFamilyHandle>> columnHandles;
+        
+        /** Options of all address columns, needed to recreate them */
+        rocksdb::ColumnFamilyOptions addressColumnOptions;
+        
+        /** Outputs and nesting relations of the first part of the chain, consulted before the columns */
+        std::unique_ptr<AddressTables> addressTables;
+        
+        /** Drop the given column and recreate it empty */
+        void resetColumn(size_t columnIndex);
+        
+        /** Parents of the address in the "_nested" table and column, sorted by (scriptNum, type) if a table is in use */
+        std::vector<DedupAddress> getNestingAddresses(const RawAddress &searchAddress) const;
 
         const std::unique_ptr<rocksdb::ColumnFamilyHandle> &getOutputColumn(AddressType::Enum type) const;
         const std::unique_ptr<rocksdb::ColumnFamilyHandle> &getNestedColumn(AddressType::Enum type) const;
         
+        /** Iterator over all keys of the output column in order, ignoring the prefix extractor */
         std::unique_ptr<rocksdb::Iterator> getOutputIterator(AddressType::Enum type) const {
-            return std::unique_ptr<rocksdb::Iterator>{db->NewIterator(rocksdb::ReadOptions(), getOutputColumn(type).get())};
+            rocksdb::ReadOptions options;
+            options.total_order_seek = true;
+            return std::unique_ptr<rocksdb::Iterator>{db->NewIterator(options, getOutputColumn(type).get())};
         }
         
-        std::unique_ptr<rocksdb::Iterator> getNestedIterator(AddressType::Enum type) const {
-            return std::unique_ptr<rocksdb::Iterator>{db->NewIterator(rocksdb::ReadOptions(), getNestedColumn(type).get())};
-        }
+        /** Receives all writes between beginBulkLoad() and finishBulkLoad() */
+        std::unique_ptr<SstBulkLoader> bulkLoader;
         
-        void writeBatch(rocksdb::WriteBatch &batch) {
-            rocksdb::WriteOptions options;
-            options.disableWAL = true;
-            db->Write(options, &batch);
-        }
+        /** The bulk loader takes writes from one thread at a time, RocksDB itself from any number of threads */
+        std::mutex bulkLoaderMutex;
+        
+        /** Loads the index and filter blocks into the block cache after opening, declared last to stop first */
+        std::unique_ptr<IndexWarmup> warmup;
+        
+        void writeBatch(rocksdb::WriteBatch &batch);
         
     public:
         
-        AddressIndex(const filesystem::path &path, bool readonly);
+        /** Size of the shared block cache if none is configured */
+        static constexpr size_t defaultBlockCacheSize = size_t{512} * 1024 * 1024;
+        
+        /** Open the index at path, with a block cache of defaultBlockCacheSize if none is given and the RocksDB options
+         * overridden by tuning */
+        AddressIndex(const filesystem::path &path, IndexOpenMode mode, std::shared_ptr<rocksdb::Cache> blockCache = nullptr, const IndexTuning &tuning = {});
         ~AddressIndex();
+        
+        /** Pick up the changes a running parser made to an index opened as IndexOpenMode::Secondary */
+        void catchUpWithPrimary();
 
         /** Get InoutPointer objects for all outputs that belong to the given address */
         ranges::any_view<InoutPointer, ranges::category::forward> getOutputPointers(const RawAddress &address) const;
@@ -105,9 +145,55 @@ namespace blocksci {
          * Value format: <empty>
          */
         void addOutputAddresses(std::vector<std::pair<RawAddress, InoutPointer>> outputCache);
+        
+        /** Remove the given nesting relations from the "_nested" columns, used to undo reorganized blocks */
+        void removeNestedAddresses(const std::vector<std::pair<RawAddress, DedupAddress>> &relations);
+        
+        /** Remove the given output links from the "_output" columns, used to undo reorganized blocks */
+        void removeOutputAddresses(const std::vector<std::pair<RawAddress, InoutPointer>> &outputs);
 
-        /** Compact the underlying RocksDB database */
-        void compactDB();
+        /** Drop the "_output" column of the address type and recreate it empty, done before rebuilding it */
+        void clearOutputColumn(AddressType::Enum type);
+        
+        /** Drop the "_nested" column of the address type and recreate it empty, done before rebuilding it */
+        void clearNestedColumn(AddressType::Enum type);
+        
+        /** Look up outputs and nesting relations in the AddressTables in directory first, if they exist */
+        void useAddressTables(const filesystem::path &directory);
+        
+        /** Number of transactions covered by the AddressTables in use, 0 if there are none */
+        uint32_t addressTablesTxCount() const;
+        
+        /** Number of outputs sent to each address of the type, indexed by scriptNum, for the scriptNums [0, addressCount)
+         *
+         * Counts the outputs of the AddressTables and scans the "_output" column in parallel key ranges on threadCount
+         * threads (0 for one per hardware thread), @see scanColumnParallel */
+        std::vector<uint32_t> countOutputs(AddressType::Enum type, uint32_t addressCount, uint32_t threadCount = 0) const;
+        
+        /** Merge the "_output" and "_nested" columns into a new generation of AddressTables in directory that covers
+         * the first txCount transactions and clear the columns */
+        void rebuildAddressTables(const filesystem::path &directory, uint32_t txCount, const ScriptAccess &scripts);
+        
+        /** Collect all following writes in sorted table files instead of writing them through the WAL and memtables
+         *
+         * Meant for loading large amounts of data at once such as during an initial parse. The written data only
+         * becomes visible once finishBulkLoad() ingests the files.
+         */
+        void beginBulkLoad();
+        
+        /** Ingest all data written since beginBulkLoad() */
+        void finishBulkLoad();
+        
+        /** Compact the underlying RocksDB database, with rewriteTableFiles also the files of the last level so that
+         * all table files are written with the current options */
+        void compactDB(bool rewriteTableFiles = false);
+        
+        rocksdb::DB *getDB() const {
+            return db.get();
+        }
+        
+        /** Block cache shared by all columns, whose capacity can be lowered to release memory */
+        std::shared_ptr<rocksdb::Cache> getBlockCache() const;
     };
 }
 
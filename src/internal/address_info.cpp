@@ -23,6 +23,7 @@ namespace blocksci {
     constexpr char AddressInfo<AddressType::NULL_DATA>::name[];
     constexpr char AddressInfo<AddressType::NONSTANDARD>::name[];
     constexpr char AddressInfo<AddressType::WITNESS_UNKNOWN>::name[];
+    constexpr char AddressInfo<AddressType::WITNESS_TAPROOT>::name[];
     
 
     template<AddressType::Enum type>
@@ -103,6 +103,14 @@ namespace blocksci {
         using IDType = void;
     };
     
+    template <>
+    struct AddressInfo<AddressType::WITNESS_TAPROOT> {
+        static constexpr char name[] = "witness_taproot";
+        static constexpr DedupAddressType::Enum dedupType = DedupAddressType::WITNESS_TAPROOT;
+        static constexpr AddressType::Enum exampleType = AddressType::WITNESS_TAPROOT;
+        using IDType = uint256;
+    };
+    
     template<AddressType::Enum type>
     struct DedupAddressTypeFunctor {
         static constexpr DedupAddressType::Enum f() {
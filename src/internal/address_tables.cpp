@@ -0,0 +1,122 @@
+//
+//  address_tables.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include "address_tables.hpp"
+#include "address_info.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+namespace blocksci {
+
+    namespace {
+        constexpr uint64_t metaMagic = 0x534c425452444441ULL; // "ADDRTBLS"
+
+        struct TablesMeta {
+            uint64_t magic;
+            uint32_t generation;
+            uint32_t txCount;
+        };
+    }
+
+    template <typename T>
+    AddressTable<T>::AddressTable(const filesystem::path &offsetsPath, const filesystem::path &entriesPath) : offsets(offsetsPath), entries(entriesPath) {
+        if (isGood() && static_cast<OffsetType>(*offsets[offsets.size() - 1]) != entries.size()) {
+            throw std::runtime_error("Address table " + entriesPath.str() + " doesn't match its offsets");
+        }
+        // Every lookup touches two offsets and one run of entries at a random position
+        offsets.advise(AccessHint::Random);
+        entries.advise(AccessHint::Random);
+    }
+
+    template <typename T>
+    std::pair<const T *, const T *> AddressTable<T>::get(uint32_t scriptNum) const {
+        if (scriptNum >= addressCount()) {
+            return {nullptr, nullptr};
+        }
+        auto begin = static_cast<OffsetType>(*offsets[scriptNum]);
+        auto end = static_cast<OffsetType>(*offsets[scriptNum + 1]);
+        if (begin == end) {
+            return {nullptr, nullptr};
+        }
+        auto first = entries[begin];
+        return {first, first + (end - begin)};
+    }
+
+    template class AddressTable<InoutPointer>;
+    template class AddressTable<DedupAddress>;
+
+    AddressTables::AddressTables(const filesystem::path &directory) {
+        std::ifstream file(metaPath(directory).str(), std::ios::binary);
+        TablesMeta meta{0, 0, 0};
+        if (!file.read(reinterpret_cast<char *>(&meta), sizeof(meta)) || meta.magic != metaMagic) {
+            return;
+        }
+        generation = meta.generation;
+        coveredTxCount = meta.txCount;
+        for (size_t i = 0; i < AddressType::size; i++) {
+            auto type = static_cast<AddressType::Enum>(i);
+            auto outputName = outputTableName(type);
+            auto outputTable = std::make_unique<AddressOutputTable>(offsetsPath(directory, outputName, generation), entriesPath(directory, outputName, generation));
+            outputTables.push_back(outputTable->isGood() ? std::move(outputTable) : nullptr);
+            auto nestedName = nestedTableName(type);
+            auto nestedTable = std::make_unique<AddressNestedTable>(offsetsPath(directory, nestedName, generation), entriesPath(directory, nestedName, generation));
+            nestedTables.push_back(nestedTable->isGood() ? std::move(nestedTable) : nullptr);
+        }
+    }
+
+    std::string AddressTables::outputTableName(AddressType::Enum type) {
+        return addressName(type) + "_output";
+    }
+
+    std::string AddressTables::nestedTableName(AddressType::Enum type) {
+        return addressName(type) + "_nested";
+    }
+
+    filesystem::path AddressTables::metaPath(const filesystem::path &directory) {
+        return directory/"tables.dat";
+    }
+
+    filesystem::path AddressTables::offsetsPath(const filesystem::path &directory, const std::string &tableName, uint32_t generation) {
+        return directory/(tableName + "_offsets" + std::to_string(generation));
+    }
+
+    filesystem::path AddressTables::entriesPath(const filesystem::path &directory, const std::string &tableName, uint32_t generation) {
+        return directory/(tableName + "_entries" + std::to_string(generation));
+    }
+
+    void AddressTables::writeMeta(const filesystem::path &directory, uint32_t generation, uint32_t txCount) {
+        auto path = metaPath(directory).str();
+        auto tempPath = path + ".tmp";
+        {
+            TablesMeta meta{metaMagic, generation, txCount};
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char *>(&meta), sizeof(meta));
+            if (!file) {
+                throw std::runtime_error("Could not write address table metadata to " + tempPath);
+            }
+        }
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("Could not move address table metadata into place at " + path);
+        }
+    }
+
+    void AddressTables::removeGeneration(const filesystem::path &directory, uint32_t generation) {
+        for (size_t i = 0; i < AddressType::size; i++) {
+            auto type = static_cast<AddressType::Enum>(i);
+            for (auto &tableName : {outputTableName(type), nestedTableName(type)}) {
+                for (auto &path : {offsetsPath(directory, tableName, generation), entriesPath(directory, tableName, generation)}) {
+                    filesystem::path filePath{path.str() + ".dat"};
+                    if (filePath.exists()) {
+                        filePath.remove_file();
+                    }
+                }
+            }
+        }
+    }
+} // namespace blocksci
@@ -0,0 +1,119 @@
+//
+//  address_tables.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_index_address_tables_hpp
+#define blocksci_index_address_tables_hpp
+
+#include "file_mapper.hpp"
+
+#include <blocksci/core/address_types.hpp>
+#include <blocksci/core/dedup_address.hpp>
+#include <blocksci/core/inout_pointer.hpp>
+
+#include <wjfilesystem/path.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace blocksci {
+
+    /** Immutable multimap from the scriptNums of one AddressType to entries of type T
+     *
+     * The entries are stored as a compressed sparse row matrix: entries holds the entries of all addresses sorted by
+     * scriptNum, and offsets[scriptNum] is the index of the first entry of scriptNum, so the entries of an address
+     * are the contiguous range [offsets[scriptNum], offsets[scriptNum + 1]).
+     */
+    template <typename T>
+    class AddressTable {
+        FixedSizeFileMapper<uint64_t> offsets;
+        FixedSizeFileMapper<T> entries;
+
+    public:
+        AddressTable(const filesystem::path &offsetsPath, const filesystem::path &entriesPath);
+
+        bool isGood() const {
+            return offsets.size() > 0;
+        }
+
+        /** Number of scriptNums covered by the table */
+        uint32_t addressCount() const {
+            return isGood() ? static_cast<uint32_t>(offsets.size() - 1) : 0;
+        }
+
+        /** Range of the entries of the given address */
+        std::pair<const T *, const T *> get(uint32_t scriptNum) const;
+    };
+
+    /** Outputs sent to each address sorted by (txNum, outputNum), materializing an "_output" column of the AddressIndex */
+    using AddressOutputTable = AddressTable<InoutPointer>;
+
+    /** Addresses each address is nested in, sorted by (scriptNum, type), materializing a "_nested" column of the AddressIndex */
+    using AddressNestedTable = AddressTable<DedupAddress>;
+
+    extern template class AddressTable<InoutPointer>;
+    extern template class AddressTable<DedupAddress>;
+
+    /** Output and nested tables of all address types that cover the first txCount() transactions
+     *
+     * The tables are rebuilt as a whole, every rebuild writing a new generation of files next to the previous one.
+     * A small metadata file names the current generation and is replaced atomically once all files of a generation
+     * are complete, so a crash during a rebuild leaves the previous generation in place.
+     *
+     * Directory: addressTables/
+     */
+    class AddressTables {
+        uint32_t generation = 0;
+        uint32_t coveredTxCount = 0;
+        std::vector<std::unique_ptr<AddressOutputTable>> outputTables;
+        std::vector<std::unique_ptr<AddressNestedTable>> nestedTables;
+
+    public:
+        explicit AddressTables(const filesystem::path &directory);
+
+        /** False if no generation was written yet */
+        bool isGood() const {
+            return generation != 0;
+        }
+
+        uint32_t getGeneration() const {
+            return generation;
+        }
+
+        /** The tables contain the outputs and nesting relations of the transactions [0, txCount) */
+        uint32_t txCount() const {
+            return coveredTxCount;
+        }
+
+        /** Output table for the given type, nullptr if no output of that type was covered */
+        const AddressOutputTable *getOutputs(AddressType::Enum type) const {
+            return outputTables.empty() ? nullptr : outputTables[static_cast<size_t>(type)].get();
+        }
+
+        /** Nested table for the given child type, nullptr if no address of that type was covered */
+        const AddressNestedTable *getNested(AddressType::Enum type) const {
+            return nestedTables.empty() ? nullptr : nestedTables[static_cast<size_t>(type)].get();
+        }
+
+        static std::string outputTableName(AddressType::Enum type);
+        static std::string nestedTableName(AddressType::Enum type);
+
+        static filesystem::path metaPath(const filesystem::path &directory);
+        static filesystem::path offsetsPath(const filesystem::path &directory, const std::string &tableName, uint32_t generation);
+        static filesystem::path entriesPath(const filesystem::path &directory, const std::string &tableName, uint32_t generation);
+
+        /** Make the given generation current */
+        static void writeMeta(const filesystem::path &directory, uint32_t generation, uint32_t txCount);
+
+        /** Delete the files of the given generation */
+        static void removeGeneration(const filesystem::path &directory, uint32_t generation);
+    };
+} // namespace blocksci
+
+#endif /* blocksci_index_address_tables_hpp */
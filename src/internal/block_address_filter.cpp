@@ -0,0 +1,144 @@
+//
+//  block_address_filter.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "block_address_filter.hpp"
+
+#include <algorithm>
+
+namespace blocksci {
+
+    namespace {
+        class BitWriter {
+            std::vector<uint64_t> &words;
+            uint64_t position = 0;
+
+        public:
+            explicit BitWriter(std::vector<uint64_t> &words_) : words(words_) {
+                words.clear();
+            }
+
+            void write(uint64_t value, uint32_t bits) {
+                if (bits == 0) {
+                    return;
+                }
+                auto offset = position & 63;
+                if (offset == 0) {
+                    words.push_back(0);
+                }
+                words.back() |= value << offset;
+                if (offset + bits > 64) {
+                    words.push_back(value >> (64 - offset));
+                }
+                position += bits;
+            }
+
+            void writeUnary(uint64_t count) {
+                for (; count >= 32; count -= 32) {
+                    write(0xFFFFFFFF, 32);
+                }
+                // count ones followed by a zero
+                write((uint64_t(1) << count) - 1, static_cast<uint32_t>(count) + 1);
+            }
+        };
+
+        class BitReader {
+            const uint64_t *words;
+            uint64_t position = 0;
+
+        public:
+            explicit BitReader(const uint64_t *words_) : words(words_) {}
+
+            uint64_t read(uint32_t bits) {
+                if (bits == 0) {
+                    return 0;
+                }
+                auto offset = position & 63;
+                auto index = position >> 6;
+                auto value = words[index] >> offset;
+                if (offset + bits > 64) {
+                    value |= words[index + 1] << (64 - offset);
+                }
+                position += bits;
+                return value & ((uint64_t(1) << bits) - 1);
+            }
+
+            uint64_t readUnary() {
+                uint64_t count = 0;
+                while (true) {
+                    auto offset = position & 63;
+                    auto available = 64 - offset;
+                    auto zeros = ~(words[position >> 6] >> offset);
+                    auto ones = zeros == 0 ? 64 : static_cast<uint64_t>(__builtin_ctzll(zeros));
+                    if (ones < available) {
+                        count += ones;
+                        position += ones + 1;
+                        return count;
+                    }
+                    count += available;
+                    position += available;
+                }
+            }
+        };
+    }
+
+    uint64_t BlockAddressFilter::fingerprint(uint32_t scriptNum, DedupAddressType::Enum type) {
+        // splitmix64 finalizer, the high bits depend on all bits of the address
+        uint64_t x = (static_cast<uint64_t>(type) << 32) | scriptNum;
+        x += 0x9E3779B97F4A7C15;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EB;
+        x ^= x >> 31;
+        return x >> (64 - fingerprintBits);
+    }
+
+    BlockAddressFilter BlockAddressFilter::encode(std::vector<uint64_t> fingerprints, std::vector<uint64_t> &words) {
+        std::sort(fingerprints.begin(), fingerprints.end());
+        fingerprints.erase(std::unique(fingerprints.begin(), fingerprints.end()), fingerprints.end());
+
+        BlockAddressFilter filter{};
+        filter.count = static_cast<uint32_t>(fingerprints.size());
+        if (!fingerprints.empty()) {
+            // The gaps average 2^fingerprintBits / count, which is close to the best Rice parameter
+            auto averageGap = (uint64_t(1) << fingerprintBits) / fingerprints.size();
+            filter.riceBits = averageGap > 0 ? static_cast<uint32_t>(63 - __builtin_clzll(averageGap)) : 0;
+        }
+
+        BitWriter writer{words};
+        uint64_t previous = 0;
+        for (auto value : fingerprints) {
+            auto gap = value - previous;
+            writer.writeUnary(gap >> filter.riceBits);
+            writer.write(gap & ((uint64_t(1) << filter.riceBits) - 1), filter.riceBits);
+            previous = value;
+        }
+        filter.wordCount = static_cast<uint32_t>(words.size());
+        return filter;
+    }
+
+    bool BlockAddressFilter::mayContainAny(const std::vector<uint64_t> &sortedFingerprints) const {
+        if (sortedFingerprints.empty()) {
+            return false;
+        }
+        // Both sides are sorted, so each decoded value only has to search the watch list past the previous one
+        BitReader reader{words()};
+        auto watchIt = sortedFingerprints.begin();
+        auto last = sortedFingerprints.back();
+        uint64_t value = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            value += reader.readUnary() << riceBits;
+            value += reader.read(riceBits);
+            if (value > last) {
+                return false;
+            }
+            watchIt = std::lower_bound(watchIt, sortedFingerprints.end(), value);
+            if (*watchIt == value) {
+                return true;
+            }
+        }
+        return false;
+    }
+} // namespace blocksci
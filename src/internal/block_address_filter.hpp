@@ -0,0 +1,61 @@
+//
+//  block_address_filter.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_block_address_filter_hpp
+#define blocksci_block_address_filter_hpp
+
+#include <blocksci/core/dedup_address_type.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace blocksci {
+
+    /** Compact set of the addresses used by the inputs and outputs of one block
+     *
+     * Every address is reduced to a fingerprintBits wide fingerprint of its (scriptNum, DedupAddressType). The sorted,
+     * distinct fingerprints of a block are stored as Golomb-Rice coded gaps like the BIP158 block filters, which takes
+     * about fingerprintBits - log2(count) + 1.5 bits per address, a little under 4 bytes for the addresses of a
+     * typical block. Unlike BIP158 the fingerprints don't depend on the block, so the fingerprints of a watch list are
+     * computed once and every block is matched with a single pass over its gaps.
+     *
+     * A watch list of n addresses falsely matches a block with count addresses with probability about
+     * n * count / 2^fingerprintBits, 0.4% for a million addresses against 4000.
+     *
+     * The header is followed by wordCount 64 bit words holding the gaps, least significant bit first: the quotient
+     * gap >> riceBits in unary as ones closed by a zero, then the riceBits low bits of the gap.
+     */
+    struct BlockAddressFilter {
+        static constexpr uint32_t fingerprintBits = 40;
+
+        /** Number of distinct fingerprints */
+        uint32_t count;
+        uint32_t wordCount;
+        uint32_t riceBits;
+        uint32_t reserved;
+
+        size_t realSize() const {
+            return sizeof(BlockAddressFilter) + wordCount * sizeof(uint64_t);
+        }
+
+        const uint64_t *words() const {
+            return reinterpret_cast<const uint64_t *>(this + 1);
+        }
+
+        static uint64_t fingerprint(uint32_t scriptNum, DedupAddressType::Enum type);
+
+        /** Header of the filter over the given fingerprints, which may be unsorted and repeat, its words are stored in
+         * words */
+        static BlockAddressFilter encode(std::vector<uint64_t> fingerprints, std::vector<uint64_t> &words);
+
+        /** Whether the block may use one of the addresses with the given sorted fingerprints */
+        bool mayContainAny(const std::vector<uint64_t> &sortedFingerprints) const;
+    };
+} // namespace blocksci
+
+#endif /* blocksci_block_address_filter_hpp */
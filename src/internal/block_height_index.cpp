@@ -0,0 +1,72 @@
+//
+//  block_height_index.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include "block_height_index.hpp"
+
+#include <algorithm>
+#include <new>
+
+namespace blocksci {
+
+    namespace {
+        /** Fill the subtree rooted at node k in order with the blocks starting at height i, returns the next height */
+        uint32_t fillTree(uint32_t *keys, uint32_t *heights, const RawBlock *blocks, uint32_t blockCount, uint32_t i, uint32_t k) {
+            if (k <= blockCount) {
+                i = fillTree(keys, heights, blocks, blockCount, i, 2 * k);
+                keys[k] = blocks[i].firstTxIndex;
+                heights[k] = i;
+                i++;
+                i = fillTree(keys, heights, blocks, blockCount, i, 2 * k + 1);
+            }
+            return i;
+        }
+    }
+
+    void BlockHeightIndex::build(const RawBlock *blocks, uint32_t blockCount_) {
+        blockCount = blockCount_;
+        depth = 0;
+        while ((uint64_t{1} << depth) <= blockCount) {
+            depth++;
+        }
+        // Pad to a whole number of cache lines so that prefetches of the last level stay within the allocation
+        size_t allocated = ((blockCount + 1 + keysPerCacheLine - 1) / keysPerCacheLine) * keysPerCacheLine;
+        void *memory = nullptr;
+        if (posix_memalign(&memory, keysPerCacheLine * sizeof(uint32_t), allocated * sizeof(uint32_t)) != 0) {
+            throw std::bad_alloc();
+        }
+        keys.reset(static_cast<uint32_t *>(memory));
+        std::fill(keys.get(), keys.get() + allocated, 0);
+        heights.assign(blockCount + 1, 0);
+        fillTree(keys.get(), heights.data(), blocks, blockCount, 0, 1);
+    }
+
+    std::vector<BlockHeight> BlockHeightIndex::findBatch(const std::vector<uint32_t> &txIndexes) const {
+        constexpr size_t groupSize = 16;
+        std::vector<BlockHeight> results(txIndexes.size());
+        const uint32_t *data = keys.get();
+        uint32_t nodes[groupSize];
+        for (size_t groupStart = 0; groupStart < txIndexes.size(); groupStart += groupSize) {
+            auto count = std::min(groupSize, txIndexes.size() - groupStart);
+            auto queries = txIndexes.data() + groupStart;
+            std::fill(nodes, nodes + count, 1);
+            for (uint32_t level = 0; level < depth; level++) {
+                for (size_t j = 0; j < count; j++) {
+                    auto k = nodes[j];
+                    // Nodes that fall off the partially filled last level stay where they are
+                    if (k <= blockCount) {
+                        __builtin_prefetch(data + k * keysPerCacheLine);
+                        nodes[j] = 2 * k + (data[k] <= queries[j]);
+                    }
+                }
+            }
+            for (size_t j = 0; j < count; j++) {
+                results[groupStart + j] = heightOfNode(finish(nodes[j]));
+            }
+        }
+        return results;
+    }
+} // namespace blocksci
@@ -0,0 +1,96 @@
+//
+//  block_height_index.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_block_height_index_hpp
+#define blocksci_block_height_index_hpp
+
+#include <blocksci/core/raw_block.hpp>
+#include <blocksci/core/typedefs.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+namespace blocksci {
+
+    /** In-memory index mapping tx numbers to the height of the block containing them
+     *
+     * Binary searching block.dat touches one 40 byte RawBlock per step, each in a different cache line. This index
+     * copies the firstTxIndex of every loaded block into a dense uint32_t array in Eytzinger (BFS) order, aligned so
+     * that the 16 keys of four consecutive tree levels share a cache line. A lookup is a branch-free descent that
+     * prefetches the cache line four levels ahead, so all but the first few levels are already in cache.
+     *
+     * Built from block.dat whenever the chain is (re)loaded. The index holds 8 bytes per block.
+     */
+    class BlockHeightIndex {
+        struct FreeDeleter {
+            void operator()(uint32_t *ptr) const {
+                std::free(ptr);
+            }
+        };
+
+        /** firstTxIndex of the blocks in Eytzinger order, 1-indexed */
+        std::unique_ptr<uint32_t[], FreeDeleter> keys;
+
+        /** Block height of every entry of keys */
+        std::vector<uint32_t> heights;
+
+        uint32_t blockCount = 0;
+
+        /** Number of iterations needed to descend to the bottom of the tree */
+        uint32_t depth = 0;
+
+        static constexpr uint32_t keysPerCacheLine = 16;
+
+        static uint32_t finish(uint32_t k) {
+            // Drop the trailing right turns to get the first node with a key greater than txIndex
+            return k >> __builtin_ffs(static_cast<int>(~k));
+        }
+
+        /** The transaction is in the block before the first block with a greater firstTxIndex (node k) */
+        BlockHeight heightOfNode(uint32_t k) const {
+            return k == 0 ? static_cast<BlockHeight>(blockCount) - 1 : static_cast<BlockHeight>(heights[k]) - 1;
+        }
+
+    public:
+        /** Index the first blockCount blocks of blocks */
+        void build(const RawBlock *blocks, uint32_t blockCount);
+
+        bool empty() const {
+            return blockCount == 0;
+        }
+        
+        /** Bytes allocated by the index */
+        size_t memoryUsage() const {
+            if (!keys) {
+                return 0;
+            }
+            size_t allocated = ((blockCount + 1 + keysPerCacheLine - 1) / keysPerCacheLine) * keysPerCacheLine;
+            return (allocated + heights.capacity()) * sizeof(uint32_t);
+        }
+
+        /** Height of the block containing the transaction txIndex */
+        BlockHeight find(uint32_t txIndex) const {
+            uint32_t k = 1;
+            const uint32_t *data = keys.get();
+            while (k <= blockCount) {
+                __builtin_prefetch(data + k * keysPerCacheLine);
+                k = 2 * k + (data[k] <= txIndex);
+            }
+            return heightOfNode(finish(k));
+        }
+
+        /** Heights of the blocks containing the transactions txIndexes, in the same order
+         *
+         * Descends the tree for a group of transactions in lockstep so that their cache misses overlap.
+         */
+        std::vector<BlockHeight> findBatch(const std::vector<uint32_t> &txIndexes) const;
+    };
+} // namespace blocksci
+
+#endif /* blocksci_block_height_index_hpp */
@@ -0,0 +1,39 @@
+//
+//  block_time_index.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include "block_time_index.hpp"
+
+#include <algorithm>
+
+namespace blocksci {
+
+    void BlockTimeIndex::build(const RawBlock *blocks, uint32_t blockCount) {
+        maxTimes.resize(blockCount);
+        chunkTimes.clear();
+        chunkTimes.reserve(blockCount / chunkSize + 1);
+        uint32_t maxTime = 0;
+        for (uint32_t i = 0; i < blockCount; i++) {
+            maxTime = std::max(maxTime, blocks[i].timestamp);
+            maxTimes[i] = maxTime;
+            if (i % chunkSize == 0) {
+                chunkTimes.push_back(maxTime);
+            }
+        }
+    }
+
+    BlockHeight BlockTimeIndex::firstBlockAtOrAfter(uint32_t time) const {
+        // The first chunk that starts at or after time, the block is in the chunk before it or at its start
+        auto chunkIt = std::lower_bound(chunkTimes.begin(), chunkTimes.end(), time);
+        auto chunk = static_cast<size_t>(chunkIt - chunkTimes.begin());
+        if (chunk == 0) {
+            return 0;
+        }
+        auto begin = maxTimes.begin() + static_cast<std::ptrdiff_t>((chunk - 1) * chunkSize);
+        auto end = chunk < chunkTimes.size() ? begin + chunkSize : maxTimes.end();
+        return static_cast<BlockHeight>(std::lower_bound(begin, end, time) - maxTimes.begin());
+    }
+} // namespace blocksci
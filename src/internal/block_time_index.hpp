@@ -0,0 +1,62 @@
+//
+//  block_time_index.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_block_time_index_hpp
+#define blocksci_block_time_index_hpp
+
+#include <blocksci/core/raw_block.hpp>
+#include <blocksci/core/typedefs.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace blocksci {
+
+    /** In-memory index mapping block timestamps to block heights
+     *
+     * Block timestamps are not monotonic, a block may be up to two hours older than its predecessors. The index
+     * stores the running maximum of the timestamps, which is monotonic, so the first block at or after a time is a
+     * binary search away. The maxima are searched through a table holding the first maximum of every chunk of
+     * chunkSize blocks, which fits in the L1 cache, followed by a search within one chunk.
+     *
+     * Built from block.dat whenever the chain is (re)loaded. The index holds 4 bytes per block.
+     */
+    class BlockTimeIndex {
+        /** maxTimes[height] is the latest timestamp of the blocks [0, height] */
+        std::vector<uint32_t> maxTimes;
+
+        /** maxTimes of the first block of every chunk */
+        std::vector<uint32_t> chunkTimes;
+
+        static constexpr uint32_t chunkSize = 256;
+
+    public:
+        /** Index the first blockCount blocks of blocks */
+        void build(const RawBlock *blocks, uint32_t blockCount);
+
+        /** Height of the first block whose timestamp is at or after time, the block count if there is none
+         *
+         * Every later block is mined after time as well, up to the tolerance of the timestamps.
+         */
+        BlockHeight firstBlockAtOrAfter(uint32_t time) const;
+        
+        /** Bytes allocated by the index */
+        size_t memoryUsage() const {
+            return (maxTimes.capacity() + chunkTimes.capacity()) * sizeof(uint32_t);
+        }
+
+        /** Heights [first, last) of the blocks mined in the time range [startTime, endTime) */
+        std::pair<BlockHeight, BlockHeight> heightRange(uint32_t startTime, uint32_t endTime) const {
+            auto first = firstBlockAtOrAfter(startTime);
+            return {first, std::max(first, firstBlockAtOrAfter(endTime))};
+        }
+    };
+} // namespace blocksci
+
+#endif /* blocksci_block_time_index_hpp */
@@ -9,19 +9,38 @@
 #ifndef chain_access_hpp
 #define chain_access_hpp
 
-#include "file_mapper.hpp"
+#include "access_stats.hpp"
+#include "block_address_filter.hpp"
+#include "block_height_index.hpp"
+#include "block_time_index.hpp"
+#include "chain_generation.hpp"
+#include "compressed_file_mapper.hpp"
 #include "exception.hpp"
 
+#include <blocksci/chain/block_stats.hpp>
+#include <blocksci/chain/coin_age_columns.hpp>
+#include <blocksci/chain/column_data.hpp>
+#include <blocksci/chain/output_columns.hpp>
+#include <blocksci/chain/tx_fee_columns.hpp>
+#include <blocksci/chain/tx_package.hpp>
 #include <blocksci/core/bitcoin_uint256.hpp>
 #include <blocksci/core/core_fwd.hpp>
+#include <blocksci/core/input_signature.hpp>
 #include <blocksci/core/raw_block.hpp>
 #include <blocksci/core/raw_transaction.hpp>
+#include <blocksci/core/raw_witness.hpp>
 #include <blocksci/core/typedefs.hpp>
 #include <blocksci/core/transaction_data.hpp>
 
+#include <range/v3/utility/optional.hpp>
+
 #include <wjfilesystem/path.h>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <limits>
+#include <set>
 
 namespace blocksci {
 
@@ -69,8 +88,9 @@ namespace blocksci {
          *
          * File: chain/tx_version.dat
          * Raw data format: [<int32_t versionNumberOfTx0>, <int32_t versionNumberOfTx1>, ...]
+         * Optionally read from the compressed copy chain/tx_version_compressed.dat
          */
-        FixedSizeFileMapper<int32_t> txVersionFile;
+        ColumnFileMapper<int32_t> txVersionFile;
 
         /** Stores the blockchain-wide number of the first input for every transaction, indexed by tx number.
          *
@@ -90,22 +110,144 @@ namespace blocksci {
          *
          * File: chain/input_out_num.dat
          * Raw data format: [<uint16_t>, <uint16_t>, ...]
+         * Optionally read from the compressed copy chain/input_out_num_compressed.dat
          */
-        FixedSizeFileMapper<uint16_t> inputSpentOutputFile;
+        ColumnFileMapper<uint16_t> inputSpentOutputFile;
 
         /** Stores the blockchain field sequence number for every input, indexed by blockchain-wide input number.
          *
          * File: chain/sequence.dat
          * Raw data format: [<uint32_t sequenceFieldOfInput0>, <uint32_t sequenceFieldOfInput1>, ...]
+         * Optionally read from the compressed copy chain/sequence_compressed.dat
          */
-        FixedSizeFileMapper<uint32_t> sequenceFile;
+        ColumnFileMapper<uint32_t> sequenceFile;
 
         /** Stores a mapping of (tx number) to (tx hash), thus indexed by tx number.
          *
          * File: chain/tx_hashes.dat
          * Raw data format: [<uint64_t firstOutputNumberOfTx0>, <uint64_t firstOutputNumberOfTx1>, ...]
+         * Optionally read from the compressed copy chain/tx_hashes_compressed.dat
+         */
+        ColumnFileMapper<uint256> txHashesFile;
+        
+        /** Lazy TxData column lookups since tracking was enabled, indexed by columnAccessIndex */
+        std::atomic<bool> trackColumnAccess{false};
+        mutable std::array<std::atomic<uint64_t>, 3> columnAccessCounts{};
+        
+        static size_t columnAccessIndex(TxDataColumn column) {
+            switch (column) {
+                case TxDataColumn::Version:
+                    return 0;
+                case TxDataColumn::Hash:
+                    return 1;
+                case TxDataColumn::Inputs:
+                    return 2;
+            }
+            return 0;
+        }
+
+        /** Optional columnar copy of the outputs in tx_data.dat, indexed by blockchain-wide output number (see OutputColumns)
+         *
+         * Files: - chain/output_value.dat: [<int64_t valueOfOutput0>, <int64_t valueOfOutput1>, ...]
+         *        - chain/output_type.dat: [<uint8_t addressTypeOfOutput0>, ...]
+         *        - chain/output_address.dat: [<uint32_t scriptNumOfOutput0>, ...]
+         *        - chain/output_spent_tx.dat: [<uint32_t spendingTxNumOfOutput0>, ...], 0 if unspent
+         */
+        FixedSizeFileMapper<int64_t> outputValueFile;
+        FixedSizeFileMapper<uint8_t> outputTypeFile;
+        FixedSizeFileMapper<uint32_t> outputAddressFile;
+        FixedSizeFileMapper<uint32_t> outputSpentTxFile;
+
+        /** Optional position of the spending input within the spending tx, indexed by blockchain-wide output number
+         *
+         * File: chain/output_spending_input.dat: [<uint16_t spendingInputNumOfOutput0>, ...], NoSpendingInput if unspent
+         * Written together with the output columns, but not counted by outputColumnsSize() so that existing column sets
+         * stay usable until it has been built.
+         */
+        FixedSizeFileMapper<uint16_t> outputSpendingInputFile;
+
+        /** Optional block height of the spending tx, indexed by blockchain-wide output number
+         *
+         * File: chain/output_spending_height.dat: [<uint32_t spendingBlockHeightOfOutput0>, ...], NoSpendingHeight if unspent
+         * Written together with output_spending_input.dat.
+         */
+        FixedSizeFileMapper<uint32_t> outputSpendingHeightFile;
+
+        /** Optional fee and virtual size of every tx, indexed by tx number
+         *
+         * Files: - chain/tx_fee.dat: [<int64_t feeOfTx0>, ...], 0 for coinbase txes
+         *        - chain/tx_vsize.dat: [<uint32_t virtualSizeOfTx0>, ...], (realSize + 3 * baseSize + 3) / 4
+         */
+        FixedSizeFileMapper<int64_t> txFeeFile;
+        FixedSizeFileMapper<uint32_t> txVirtualSizeFile;
+
+        /** Optional height and value of the output spent by every input, indexed by blockchain-wide input number, and
+         * coin age statistics of every block (@see InputAgeColumns, BlockCoinAge)
+         *
+         * Files: - chain/input_spent_height.dat: [<uint32_t heightOfOutputSpentByInput0>, ...]
+         *        - chain/input_spent_value.dat: [<int64_t valueOfOutputSpentByInput0>, ...]
+         *        - chain/block_coin_age.dat: [<BlockCoinAge block0>, ...]
+         * Written along with the output columns, the entry of a block after the entries of its inputs.
+         */
+        FixedSizeFileMapper<uint32_t> inputSpentHeightFile;
+        FixedSizeFileMapper<int64_t> inputSpentValueFile;
+        FixedSizeFileMapper<BlockCoinAge> blockCoinAgeFile;
+
+        /** Aggregates of every block (@see BlockStats)
+         *
+         * File: - chain/block_stats.dat: [<BlockStats block0>, ...]
+         * Written by the parser right after block.dat, so it covers every block unless the data directory was created
+         * by an older parser and hasn't been updated since.
+         */
+        FixedSizeFileMapper<BlockStats> blockStatsFile;
+
+        /** Same-block spends (@see TxPackageFlag, BlockPackages)
+         *
+         * Files: - chain/tx_package_flags.dat: [<uint8_t TxPackageFlag bits of tx0>, ...]
+         *        - chain/block_package_edges.dat: [<uint64_t end of the edges of block0>, ...]
+         *        - chain/package_edges_by_child.dat: [<InBlockEdge>, ...], sorted by (child, parent) within a block
+         *        - chain/package_edges_by_parent.dat: [<InBlockEdge>, ...], sorted by (parent, child) within a block
+         * Written by the parser after block_stats.dat, the entry of a block after the entries of its txes and edges.
+         */
+        FixedSizeFileMapper<uint8_t> txPackageFlagsFile;
+        FixedSizeFileMapper<uint64_t> blockPackageEdgesFile;
+        FixedSizeFileMapper<InBlockEdge> packageEdgesByChildFile;
+        FixedSizeFileMapper<InBlockEdge> packageEdgesByParentFile;
+
+        /** Optional signature and public key of every input, indexed by blockchain-wide input number minus the first
+         * covered input (@see InputSignature)
+         *
+         * Files: - chain/input_signatures.dat: [<InputSignature ofFirstCoveredInput>, ...]
+         *        - chain/input_signatures_start.dat: [<uint64_t firstCoveredInputNum>]
+         * Written by the parser while it reads the blocks once extractSignatures is set in its config, so they start at
+         * the first input parsed afterwards.
+         */
+        FixedSizeFileMapper<InputSignature> inputSignatureFile;
+        FixedSizeFileMapper<uint64_t> inputSignatureStartFile;
+
+        /** Optional witnesses of the inputs, indexed by tx number minus the first covered tx (@see RawWitness)
+         *
+         * Files: - chain/witness_index.dat: [<uint64_t offsetOfFirstCoveredTx>, ...]
+         *        - chain/witness_data.dat: [<RawWitness input0>, <RawWitness input1>, ...] for each tx
+         *        - chain/witness_info.dat: [<WitnessFileInfo>]
+         * Written by the parser once recordWitnesses is set in its config. Indexed by tx rather than input since the
+         * index of IndexedFileMapper is 32 bits wide while the number of inputs isn't bounded by that.
+         */
+        IndexedFileMapper<mio::access_mode::read, RawWitness> witnessFile;
+        FixedSizeFileMapper<WitnessFileInfo> witnessInfoFile;
+
+        /** Optional filter of the addresses used by every block, indexed by block height (@see BlockAddressFilter)
+         *
+         * Files: - chain/block_address_filter_index.dat: [<uint64_t offsetOfBlock0>, ...]
+         *        - chain/block_address_filter_data.dat: [<BlockAddressFilter block0>, <BlockAddressFilter block1>, ...]
          */
-        FixedSizeFileMapper<uint256> txHashesFile;
+        IndexedFileMapper<mio::access_mode::read, BlockAddressFilter> blockAddressFilterFile;
+
+        /** Tx number to block height lookups, rebuilt from blockFile on every (re)load */
+        BlockHeightIndex blockHeightIndex;
+        
+        /** Timestamp to block height lookups, rebuilt from blockFile on every (re)load */
+        BlockTimeIndex blockTimeIndex;
 
         /** Hash of the last loaded block */
         uint256 lastBlockHash;
@@ -123,10 +265,39 @@ namespace blocksci {
 
         bool errorOnReorg = false;
 
-        void reorgCheck() const {
-            if (errorOnReorg && lastBlockHash != *lastBlockHashDisk) {
-                throw ReorgException();
+        /** Generation counter of the data directory, bumped by the parser around every update */
+        mutable ChainGeneration generation;
+        
+        /** Size of block.dat on disk, read without remapping to notice appended blocks */
+        FileInfo blockFileInfo;
+
+        /** Generation at which the last block hash was last verified */
+        mutable uint64_t verifiedGeneration = 0;
+
+        template <typename T>
+        static ColumnData fixedColumnData(const FixedSizeFileMapper<T> &file, uint64_t count) {
+            if (static_cast<uint64_t>(file.size()) < count) {
+                throw std::runtime_error("The uncompressed column file does not cover the loaded chain");
             }
+            ColumnData column;
+            column.data = count > 0 ? file[0] : nullptr;
+            column.count = count;
+            column.elementSize = static_cast<uint32_t>(sizeof(T));
+            return column;
+        }
+
+        /** The bytes of tx_data.dat holding the loaded txes */
+        ColumnData txDataColumnData() const {
+            auto &dataFile = txFile.getDataFile();
+            if (dataFile.isPaged()) {
+                throw std::runtime_error("tx_data.dat is read through the paged backend and is not mapped into memory");
+            }
+            auto end = _maxLoadedTx < txFile.size() ? txFile.getOffsets(_maxLoadedTx)[0] : dataFile.size();
+            ColumnData column;
+            column.data = end > 0 ? dataFile.getDataAtOffset(0) : nullptr;
+            column.count = static_cast<uint64_t>(end);
+            column.elementSize = 1;
+            return column;
         }
 
         void setup() {
@@ -145,6 +316,9 @@ namespace blocksci {
                 _maxLoadedTx = 0;
                 lastBlockHashDisk = nullptr;
             }
+            blockHeightIndex.build(maxHeight > BlockHeight(0) ? blockFile[0] : nullptr, static_cast<uint32_t>(maxHeight));
+            blockTimeIndex.build(maxHeight > BlockHeight(0) ? blockFile[0] : nullptr, static_cast<uint32_t>(maxHeight));
+            verifiedGeneration = generation.current();
 
             if (_maxLoadedTx > txFile.size()) {
                 std::stringstream ss;
@@ -154,21 +328,71 @@ namespace blocksci {
         }
 
     public:
-        explicit ChainAccess(const filesystem::path &baseDirectory, BlockHeight blocksIgnored, bool errorOnReorg) :
+        /** compressedColumns selects which of the TxVersion, InputSpentOutNum, Sequence and TxHashes columns
+         * are read from their compressed copies (see CompressedFileMapper) if those exist */
+        explicit ChainAccess(const filesystem::path &baseDirectory, BlockHeight blocksIgnored, bool errorOnReorg, const std::set<ChainColumn> &compressedColumns = {}) :
         blockFile(blockFilePath(baseDirectory)),
         blockCoinbaseFile(blockCoinbaseFilePath(baseDirectory)),
         txFile(txFilePath(baseDirectory)),
-        txVersionFile(txVersionFilePath(baseDirectory)),
+        txVersionFile(txVersionFilePath(baseDirectory), compressedColumns.count(ChainColumn::TxVersion) > 0),
         txFirstInputFile(firstInputFilePath(baseDirectory)),
         txFirstOutputFile(firstOutputFilePath(baseDirectory)),
-        inputSpentOutputFile(inputSpentOutNumFilePath(baseDirectory)),
-        sequenceFile(sequenceFilePath(baseDirectory)),
-        txHashesFile(txHashesFilePath(baseDirectory)),
+        inputSpentOutputFile(inputSpentOutNumFilePath(baseDirectory), compressedColumns.count(ChainColumn::InputSpentOutNum) > 0),
+        sequenceFile(sequenceFilePath(baseDirectory), compressedColumns.count(ChainColumn::Sequence) > 0),
+        txHashesFile(txHashesFilePath(baseDirectory), compressedColumns.count(ChainColumn::TxHashes) > 0),
+        outputValueFile(outputValueFilePath(baseDirectory)),
+        outputTypeFile(outputTypeFilePath(baseDirectory)),
+        outputAddressFile(outputAddressFilePath(baseDirectory)),
+        outputSpentTxFile(outputSpentTxFilePath(baseDirectory)),
+        outputSpendingInputFile(outputSpendingInputFilePath(baseDirectory)),
+        outputSpendingHeightFile(outputSpendingHeightFilePath(baseDirectory)),
+        txFeeFile(txFeeFilePath(baseDirectory)),
+        txVirtualSizeFile(txVirtualSizeFilePath(baseDirectory)),
+        inputSpentHeightFile(inputSpentHeightFilePath(baseDirectory)),
+        inputSpentValueFile(inputSpentValueFilePath(baseDirectory)),
+        blockCoinAgeFile(blockCoinAgeFilePath(baseDirectory)),
+        blockStatsFile(blockStatsFilePath(baseDirectory)),
+        txPackageFlagsFile(txPackageFlagsFilePath(baseDirectory)),
+        blockPackageEdgesFile(blockPackageEdgesFilePath(baseDirectory)),
+        packageEdgesByChildFile(packageEdgesByChildFilePath(baseDirectory)),
+        packageEdgesByParentFile(packageEdgesByParentFilePath(baseDirectory)),
+        inputSignatureFile(inputSignatureFilePath(baseDirectory)),
+        inputSignatureStartFile(inputSignatureStartFilePath(baseDirectory)),
+        witnessFile(witnessFilePath(baseDirectory)),
+        witnessInfoFile(witnessInfoFilePath(baseDirectory)),
+        blockAddressFilterFile(blockAddressFilterFilePath(baseDirectory)),
         blocksIgnored(blocksIgnored),
-        errorOnReorg(errorOnReorg) {
+        errorOnReorg(errorOnReorg),
+        generation(baseDirectory),
+        blockFileInfo(blockFilePath(baseDirectory).str() + ".dat") {
             setup();
         }
 
+        /** Throw ReorgException if errorOnReorg is set and the last loaded block has changed on disk
+         *
+         * The getters don't check for reorgs themselves. This is called once per BlockRange::mapReduce segment and by
+         * Blockchain::checkReorg. As long as the parser has not touched the data directory this only compares the
+         * generation counter. */
+        void checkReorg() const {
+            if (!errorOnReorg) {
+                return;
+            }
+            auto currentGeneration = generation.current();
+            if (currentGeneration == 0) {
+                // The parser may have created the generation file since it was opened
+                generation.reload();
+                currentGeneration = generation.current();
+            }
+            // Without a generation file (data written by an older parser) always compare the hash
+            if (currentGeneration != 0 && currentGeneration == verifiedGeneration) {
+                return;
+            }
+            if (lastBlockHashDisk != nullptr && lastBlockHash != *lastBlockHashDisk) {
+                throw ReorgException();
+            }
+            verifiedGeneration = currentGeneration;
+        }
+
         static filesystem::path txFilePath(const filesystem::path &baseDirectory) {
             return baseDirectory/"tx";
         }
@@ -205,68 +429,507 @@ namespace blocksci {
             return baseDirectory/"input_out_num";
         }
 
+        static filesystem::path outputValueFilePath(const filesystem::path &baseDirectory) {
+            return baseDirectory/"output_value";
+        }
+
+        static filesystem::path outputTypeFilePath(const filesystem::path &baseDirectory) {
+            return baseDirectory/"output_type";
+        }
+
+        static filesystem::path outputAddressFilePath(const filesystem::path &baseDirectory) {
+            return baseDirectory/"output_address";
+        }
+
+        static filesystem::path outputSpentTxFilePath(const filesystem::path &baseDirectory) {
+            return baseDirectory/"output_spent_tx";
+        }
+
+        static filesystem::path outputSpendingInputFilePath(const filesystem::path &baseDirectory) {
+            return baseDirectory/"output_spending_input";
+        }
+
+        /** Value of output_spending_input.dat for outputs that haven't been spent yet */
+        static constexpr uint16_t NoSpendingInput = std::numeric_limits<uint16_t>::max();
+
+        static filesystem::path outputSpendingHeightFilePath(const filesystem::path &baseDirectory) {
+            return baseDirectory/"output_spending_height";
+        }
+
+        /** Value of output_spending_height.dat for outputs that haven't been spent yet */
+        static constexpr uint32_t NoSpendingHeight = std::numeric_limits<uint32_t>::max();
+
+        static filesystem::path txFeeFilePath(const filesystem::path &baseDirectory) {
+            return baseDirectory/"tx_fee";
+        }
+
+        static filesystem::path txVirtualSizeFilePath(const filesystem::path &baseDirectory) {
+            return baseDirectory/"tx_vsize";
+        }
+
+        static filesystem::path inputSpentHeightFilePath(const filesystem::path &baseDirectory) {
+            return baseDirectory/"input_spent_height";
+        }
+
+        static filesystem::path inputSpentValueFilePath(const filesystem::path &baseDirectory) {
+            return baseDirectory/"input_spent_value";
+        }
+
+        static filesystem::path blockCoinAgeFilePath(const filesystem::path &baseDirectory) {
+            return baseDirectory/"block_coin_age";
+        }
+
+        static filesystem::path blockStatsFilePath(const filesystem::path &baseDirectory) {
+            return baseDirectory/"block_stats";
+        }
+
+        static filesystem::path txPackageFlagsFilePath(const filesystem::path &baseDirectory) {
+            return baseDirectory/"tx_package_flags";
+        }
+
+        static filesystem::path blockPackageEdgesFilePath(const filesystem::path &baseDirectory) {
+            return baseDirectory/"block_package_edges";
+        }
+
+        static filesystem::path packageEdgesByChildFilePath(const filesystem::path &baseDirectory) {
+            return baseDirectory/"package_edges_by_child";
+        }
+
+        static filesystem::path packageEdgesByParentFilePath(const filesystem::path &baseDirectory) {
+            return baseDirectory/"package_edges_by_parent";
+        }
+
+        static filesystem::path inputSignatureFilePath(const filesystem::path &baseDirectory) {
+            return baseDirectory/"input_signatures";
+        }
+
+        static filesystem::path inputSignatureStartFilePath(const filesystem::path &baseDirectory) {
+            return baseDirectory/"input_signatures_start";
+        }
+
+        static filesystem::path witnessFilePath(const filesystem::path &baseDirectory) {
+            return baseDirectory/"witness";
+        }
+
+        static filesystem::path witnessInfoFilePath(const filesystem::path &baseDirectory) {
+            return baseDirectory/"witness_info";
+        }
+
+        static filesystem::path blockAddressFilterFilePath(const filesystem::path &baseDirectory) {
+            return baseDirectory/"block_address_filter";
+        }
+
         BlockHeight getBlockHeight(uint32_t txIndex) const {
-            reorgCheck();
             if (errorOnReorg && txIndex >= _maxLoadedTx) {
                 throw std::out_of_range("Transaction index out of range");
             }
-            auto blockBegin = blockFile[0];
-            auto blockEnd = blockFile[static_cast<OffsetType>(maxHeight) - 1] + 1;
-            auto it = std::upper_bound(blockBegin, blockEnd, txIndex, [](uint32_t index, const RawBlock &b) {
-                return index < b.firstTxIndex;
-            });
-            it--;
-            return static_cast<BlockHeight>(std::distance(blockBegin, it));
+            BLOCKSCI_COUNT_ACCESS(BlockHeightLookup);
+            return blockHeightIndex.find(txIndex);
+        }
+
+        /** Get the block heights of the given tx numbers, in the same order
+         *
+         * Interleaves the index lookups so that their cache misses overlap, cheaper than calling getBlockHeight for
+         * every transaction in random-order workloads.
+         */
+        std::vector<BlockHeight> getBlockHeights(const std::vector<uint32_t> &txIndexes) const {
+            if (errorOnReorg) {
+                for (auto txIndex : txIndexes) {
+                    if (txIndex >= _maxLoadedTx) {
+                        throw std::out_of_range("Transaction index out of range");
+                    }
+                }
+            }
+            return blockHeightIndex.findBatch(txIndexes);
+        }
+        
+        /** Bytes held by the in-memory block height and block time indexes */
+        size_t indexMemoryUsage() const {
+            return blockHeightIndex.memoryUsage() + blockTimeIndex.memoryUsage();
+        }
+        
+        /** Heights [first, last) of the loaded blocks mined in the time range [startTime, endTime), @see BlockTimeIndex */
+        std::pair<BlockHeight, BlockHeight> getHeightRange(uint32_t startTime, uint32_t endTime) const {
+            return blockTimeIndex.heightRange(startTime, endTime);
         }
 
         const RawBlock *getBlock(BlockHeight blockHeight) const {
-            reorgCheck();
             return blockFile[static_cast<OffsetType>(blockHeight)];
         }
 
         const uint256 *getTxHash(uint32_t index) const {
-            reorgCheck();
             return txHashesFile[index];
         }
 
         const RawTransaction *getTx(uint32_t index) const {
-            reorgCheck();
+            BLOCKSCI_COUNT_ACCESS(TxDecode);
             return txFile.getData(index);
         }
 
         const int32_t *getTxVersion(uint32_t index) const {
-            reorgCheck();
             return txVersionFile[index];
         }
 
         const uint32_t *getSequenceNumbers(uint32_t index) const {
-            reorgCheck();
-            return sequenceFile[static_cast<OffsetType>(*txFirstInputFile[index])];
+            return sequenceFile.getRange(static_cast<OffsetType>(*txFirstInputFile[index]), txFile.getData(index)->inputCount);
         }
 
         const uint16_t *getSpentOutputNumbers(uint32_t index) const {
-            reorgCheck();
-            return inputSpentOutputFile[static_cast<OffsetType>(*txFirstInputFile[index])];
+            return inputSpentOutputFile.getRange(static_cast<OffsetType>(*txFirstInputFile[index]), txFile.getData(index)->inputCount);
         }
 
-        /** Get TxData object for given tx number */
+        /** Get TxData object for given tx number with only rawTx set, the other columns are looked up by
+         * resolveTxData when the transaction first needs them */
         TxData getTxData(uint32_t index) const {
-            reorgCheck();
-            // Blockchain-wide number of first input for the given tx
-            auto firstInputNum = static_cast<OffsetType>(*txFirstInputFile[index]);
-            const uint16_t *inputsSpent = nullptr;
-            const uint32_t *sequenceNumbers = nullptr;
-            if (firstInputNum < inputSpentOutputFile.size()) {
-                inputsSpent = inputSpentOutputFile[firstInputNum];
-                sequenceNumbers = sequenceFile[firstInputNum];
-            }
-            return {                   // construct TxData object
-                txFile.getData(index), // const RawTransaction *rawTx
-                txVersionFile[index],  // const int32_t *version
-                txHashesFile[index],   // const uint256 *hash
-                inputsSpent,           // const uint16_t *spentOutputNums
-                sequenceNumbers        // const uint32_t *sequenceNumbers
-            };
+            BLOCKSCI_COUNT_ACCESS(TxDecode);
+            return {txFile.getData(index), nullptr, nullptr, nullptr, nullptr, 0};
+        }
+        
+        /** Set the pointers of the given column of data, the TxData of tx number index */
+        void resolveTxData(TxData &data, uint32_t index, TxDataColumn column) const {
+            if (trackColumnAccess.load(std::memory_order_relaxed)) {
+                columnAccessCounts[columnAccessIndex(column)].fetch_add(1, std::memory_order_relaxed);
+            }
+            switch (column) {
+                case TxDataColumn::Version:
+                    data.version = txVersionFile[index];
+                    break;
+                case TxDataColumn::Hash:
+                    data.hash = txHashesFile[index];
+                    break;
+                case TxDataColumn::Inputs: {
+                    // Blockchain-wide number of first input for the given tx
+                    auto firstInputNum = static_cast<OffsetType>(*txFirstInputFile[index]);
+                    data.spentOutputNums = nullptr;
+                    data.sequenceNumbers = nullptr;
+                    if (firstInputNum < inputSpentOutputFile.size()) {
+                        data.spentOutputNums = inputSpentOutputFile.getRange(firstInputNum, data.rawTx->inputCount);
+                        data.sequenceNumbers = sequenceFile.getRange(firstInputNum, data.rawTx->inputCount);
+                    }
+                    break;
+                }
+            }
+            data.resolvedColumns |= static_cast<uint8_t>(column);
+        }
+        
+        /** Count the lazy lookups of every TxDataColumn from now on, which resets the counts, or stop counting */
+        void setTrackColumnAccess(bool track) {
+            if (track) {
+                for (auto &count : columnAccessCounts) {
+                    count.store(0, std::memory_order_relaxed);
+                }
+            }
+            trackColumnAccess.store(track, std::memory_order_relaxed);
+        }
+        
+        TxColumnAccessStats columnAccessStats() const {
+            TxColumnAccessStats stats;
+            stats.version = columnAccessCounts[columnAccessIndex(TxDataColumn::Version)].load(std::memory_order_relaxed);
+            stats.hash = columnAccessCounts[columnAccessIndex(TxDataColumn::Hash)].load(std::memory_order_relaxed);
+            stats.inputs = columnAccessCounts[columnAccessIndex(TxDataColumn::Inputs)].load(std::memory_order_relaxed);
+            return stats;
+        }
+
+        /** Get TxData objects for the given tx numbers, in the same order
+         *
+         * Resolves all transactions through IndexedFileMapper::getDataBatch so that the page faults of
+         * random-order lookups overlap. Unlike getTxData all columns are resolved up front.
+         */
+        std::vector<TxData> getTxDataBatch(const std::vector<uint32_t> &indexes) const {
+            auto rawTxes = txFile.getDataBatch(indexes);
+            std::vector<TxData> txData;
+            txData.reserve(indexes.size());
+            for (size_t i = 0; i < indexes.size(); i++) {
+                auto index = indexes[i];
+                auto firstInputNum = static_cast<OffsetType>(*txFirstInputFile[index]);
+                const uint16_t *inputsSpent = nullptr;
+                const uint32_t *sequenceNumbers = nullptr;
+                if (firstInputNum < inputSpentOutputFile.size()) {
+                    inputsSpent = inputSpentOutputFile.getRange(firstInputNum, rawTxes[i]->inputCount);
+                    sequenceNumbers = sequenceFile.getRange(firstInputNum, rawTxes[i]->inputCount);
+                }
+                txData.push_back({rawTxes[i], txVersionFile[index], txHashesFile[index], inputsSpent, sequenceNumbers, TxData::allColumns});
+            }
+            return txData;
+        }
+
+        /** Blockchain-wide number of the first input of the given tx */
+        uint64_t getFirstInputNumber(uint32_t index) const {
+            return *txFirstInputFile[index];
+        }
+
+        /** Blockchain-wide number of the first input covered by input_signatures.dat */
+        uint64_t inputSignaturesBegin() const {
+            return inputSignatureStartFile.size() > 0 ? *inputSignatureStartFile[0] : 0;
+        }
+
+        /** One past the last loaded input covered by input_signatures.dat, equal to inputSignaturesBegin() if there are none */
+        uint64_t inputSignaturesEnd() const {
+            auto begin = inputSignaturesBegin();
+            if (inputSignatureStartFile.size() == 0) {
+                return begin;
+            }
+            return std::max(begin, std::min(begin + static_cast<uint64_t>(inputSignatureFile.size()), inputCount()));
+        }
+
+        /** Signature of the input with the given blockchain-wide number, nullptr if input_signatures.dat doesn't cover it */
+        const InputSignature *getInputSignature(uint64_t inputNum) const {
+            if (inputNum < inputSignaturesBegin() || inputNum >= inputSignaturesEnd()) {
+                return nullptr;
+            }
+            return inputSignatureFile[static_cast<OffsetType>(inputNum - inputSignaturesBegin())];
+        }
+
+        /** Number of the first tx covered by the witness files */
+        uint32_t witnessesBegin() const {
+            return witnessInfoFile.size() > 0 ? witnessInfoFile[0]->firstTxNum : 0;
+        }
+
+        /** One past the last loaded tx covered by the witness files, equal to witnessesBegin() if there are none */
+        uint32_t witnessesEnd() const {
+            auto begin = witnessesBegin();
+            if (witnessInfoFile.size() == 0) {
+                return begin;
+            }
+            return std::max(begin, static_cast<uint32_t>(std::min(static_cast<uint64_t>(begin) + witnessFile.size(), static_cast<uint64_t>(txCount()))));
+        }
+
+        /** Whether the witness files store the items or only their lengths */
+        bool witnessesHaveItemData() const {
+            return witnessInfoFile.size() > 0 && witnessInfoFile[0]->hasItemData != 0;
+        }
+
+        /** Witness of the first input of the tx, the others follow it (@see RawWitness::next), nullptr if the witness
+         * files don't cover the tx */
+        const RawWitness *getTxWitnesses(uint32_t index) const {
+            if (index < witnessesBegin() || index >= witnessesEnd()) {
+                return nullptr;
+            }
+            return witnessFile.getDataAtIndex(index - witnessesBegin());
+        }
+
+        /** One past the last loaded block covered by the address filters, which start at the first block */
+        BlockHeight blockAddressFiltersEnd() const {
+            return std::min(static_cast<BlockHeight>(blockAddressFilterFile.size()), blockCount());
+        }
+
+        /** Filter of the addresses used by the block, nullptr if the filter files don't cover it */
+        const BlockAddressFilter *getBlockAddressFilter(BlockHeight height) const {
+            if (height >= blockAddressFiltersEnd()) {
+                return nullptr;
+            }
+            return blockAddressFilterFile.getDataAtIndex(static_cast<uint32_t>(height));
+        }
+
+        /** Blockchain-wide number of the first output of the given tx */
+        uint64_t getFirstOutputNumber(uint32_t index) const {
+            return *txFirstOutputFile[index];
+        }
+
+        /** Tx containing the output with the given blockchain-wide output number, which must be below outputCount() */
+        uint32_t getTxNumOfOutput(uint64_t outputNum) const {
+            // Last tx whose first output is at or before outputNum
+            uint32_t low = 0;
+            uint32_t high = _maxLoadedTx;
+            while (high - low > 1) {
+                auto mid = low + (high - low) / 2;
+                if (*txFirstOutputFile[mid] <= outputNum) {
+                    low = mid;
+                } else {
+                    high = mid;
+                }
+            }
+            return low;
+        }
+
+        /** Number of inputs plus outputs of the txes before the given tx, txNum may be one past the last loaded tx */
+        uint64_t getInoutOffset(uint32_t txNum) const {
+            if (txNum >= _maxLoadedTx) {
+                return inputCount() + outputCount();
+            }
+            return *txFirstInputFile[txNum] + *txFirstOutputFile[txNum];
+        }
+
+        /** Number of outputs covered by all four output columns */
+        uint64_t outputColumnsSize() const {
+            return static_cast<uint64_t>(std::min({outputValueFile.size(), outputTypeFile.size(), outputAddressFile.size(), outputSpentTxFile.size()}));
+        }
+
+        /** Output columns of the outputs [beginOutputNum, endOutputNum), which must be covered by the columns */
+        OutputColumns getOutputColumns(uint64_t beginOutputNum, uint64_t endOutputNum) const {
+            if (endOutputNum > outputColumnsSize()) {
+                throw std::runtime_error("Output columns do not cover the requested outputs, run blocksci_parser build-output-columns");
+            }
+            OutputColumns columns;
+            columns.firstOutputNum = beginOutputNum;
+            columns.count = endOutputNum - beginOutputNum;
+            columns.maxTxLoaded = _maxLoadedTx;
+            if (columns.count > 0) {
+                auto begin = static_cast<OffsetType>(beginOutputNum);
+                columns.values = outputValueFile[begin];
+                columns.types = outputTypeFile[begin];
+                columns.addressNums = outputAddressFile[begin];
+                columns.spentTxNums = outputSpentTxFile[begin];
+            }
+            return columns;
+        }
+
+        /** True if output_spending_input.dat covers all loaded outputs, so getSpendingInputNum finds every spent output */
+        bool hasSpendingInputColumn() const {
+            return static_cast<uint64_t>(outputSpendingInputFile.size()) >= outputCount();
+        }
+
+        /** Position of the input spending the given output within its spending tx
+         *
+         * nullopt if the output is unspent or not covered by output_spending_input.dat, callers then have to search the
+         * inputs of the spending tx. */
+        ranges::optional<uint16_t> getSpendingInputNum(uint64_t outputNum) const {
+            if (outputNum < static_cast<uint64_t>(outputSpendingInputFile.size())) {
+                auto inputNum = *outputSpendingInputFile[static_cast<OffsetType>(outputNum)];
+                if (inputNum != NoSpendingInput) {
+                    return inputNum;
+                }
+            }
+            return ranges::nullopt;
+        }
+
+        /** Block height of the tx spending the given output, which must be spent in the loaded chain
+         *
+         * Read from output_spending_height.dat if it covers the output, otherwise looked up from spendingTxNum. */
+        BlockHeight getSpendingBlockHeight(uint64_t outputNum, uint32_t spendingTxNum) const {
+            if (outputNum < static_cast<uint64_t>(outputSpendingHeightFile.size())) {
+                auto height = *outputSpendingHeightFile[static_cast<OffsetType>(outputNum)];
+                if (height != NoSpendingHeight) {
+                    return static_cast<BlockHeight>(height);
+                }
+            }
+            return getBlockHeight(spendingTxNum);
+        }
+
+        /** Spending block heights of the count outputs starting at firstOutputNum, NoSpendingHeight for unspent ones,
+         * nullptr if output_spending_height.dat doesn't cover all of them */
+        const uint32_t *getOutputSpendingHeights(uint64_t firstOutputNum, uint16_t count) const {
+            if (firstOutputNum + count > static_cast<uint64_t>(outputSpendingHeightFile.size()) || count == 0) {
+                return nullptr;
+            }
+            return outputSpendingHeightFile[static_cast<OffsetType>(firstOutputNum)];
+        }
+
+        /** Block height of the tx containing the output spent by the given input
+         *
+         * Read from input_spent_height.dat if it covers the input, otherwise looked up from spentTxNum. */
+        BlockHeight getSpentBlockHeight(uint64_t inputNum, uint32_t spentTxNum) const {
+            if (inputNum < static_cast<uint64_t>(inputSpentHeightFile.size())) {
+                return static_cast<BlockHeight>(*inputSpentHeightFile[static_cast<OffsetType>(inputNum)]);
+            }
+            return getBlockHeight(spentTxNum);
+        }
+
+        /** Spent block heights of the count inputs starting at firstInputNum, nullptr if input_spent_height.dat doesn't
+         * cover all of them */
+        const uint32_t *getInputSpentHeights(uint64_t firstInputNum, uint16_t count) const {
+            if (firstInputNum + count > static_cast<uint64_t>(inputSpentHeightFile.size()) || count == 0) {
+                return nullptr;
+            }
+            return inputSpentHeightFile[static_cast<OffsetType>(firstInputNum)];
+        }
+
+        /** Fee of the given tx from tx_fee.dat, nullptr if the column doesn't cover it */
+        const int64_t *getTxFee(uint32_t index) const {
+            return index < static_cast<uint32_t>(txFeeFile.size()) ? txFeeFile[index] : nullptr;
+        }
+
+        /** Number of txes covered by both fee columns */
+        uint32_t txFeeColumnsSize() const {
+            return static_cast<uint32_t>(std::min(txFeeFile.size(), txVirtualSizeFile.size()));
+        }
+
+        /** Fee columns of the txes [beginTxNum, endTxNum), which must be covered by the columns */
+        TxFeeColumns getTxFeeColumns(uint32_t beginTxNum, uint32_t endTxNum) const {
+            if (endTxNum > txFeeColumnsSize()) {
+                throw std::runtime_error("Fee columns do not cover the requested transactions, run blocksci_parser build-output-columns");
+            }
+            TxFeeColumns columns;
+            columns.firstTxNum = beginTxNum;
+            columns.count = endTxNum - beginTxNum;
+            if (columns.count > 0) {
+                columns.fees = txFeeFile[beginTxNum];
+                columns.virtualSizes = txVirtualSizeFile[beginTxNum];
+            }
+            return columns;
+        }
+
+        /** Number of inputs covered by both input age columns */
+        uint64_t inputAgeColumnsSize() const {
+            return static_cast<uint64_t>(std::min(inputSpentHeightFile.size(), inputSpentValueFile.size()));
+        }
+
+        /** Input age columns of the inputs [beginInputNum, endInputNum), which must be covered by the columns */
+        InputAgeColumns getInputAgeColumns(uint64_t beginInputNum, uint64_t endInputNum) const {
+            if (endInputNum > inputAgeColumnsSize()) {
+                throw std::runtime_error("Coin age columns do not cover the requested inputs, run blocksci_parser build-output-columns");
+            }
+            InputAgeColumns columns;
+            columns.firstInputNum = beginInputNum;
+            columns.count = endInputNum - beginInputNum;
+            if (columns.count > 0) {
+                auto begin = static_cast<OffsetType>(beginInputNum);
+                columns.spentHeights = inputSpentHeightFile[begin];
+                columns.spentValues = inputSpentValueFile[begin];
+            }
+            return columns;
+        }
+
+        /** Number of loaded blocks covered by block_coin_age.dat */
+        BlockHeight blockCoinAgeSize() const {
+            return std::min(static_cast<BlockHeight>(blockCoinAgeFile.size()), blockCount());
+        }
+
+        /** Coin age statistics of the block, nullptr if block_coin_age.dat doesn't cover it */
+        const BlockCoinAge *getBlockCoinAge(BlockHeight height) const {
+            if (height >= blockCoinAgeSize()) {
+                return nullptr;
+            }
+            return blockCoinAgeFile[static_cast<OffsetType>(height)];
+        }
+
+        /** Number of loaded blocks covered by block_stats.dat */
+        BlockHeight blockStatsSize() const {
+            return std::min(static_cast<BlockHeight>(blockStatsFile.size()), blockCount());
+        }
+
+        /** Aggregates of the block, nullptr if block_stats.dat doesn't cover it */
+        const BlockStats *getBlockStats(BlockHeight height) const {
+            if (height >= blockStatsSize()) {
+                return nullptr;
+            }
+            return blockStatsFile[static_cast<OffsetType>(height)];
+        }
+
+        /** Number of loaded blocks covered by the package files */
+        BlockHeight txPackagesSize() const {
+            return std::min(static_cast<BlockHeight>(blockPackageEdgesFile.size()), blockCount());
+        }
+
+        /** TxPackageFlag bits of the tx, nullptr if tx_package_flags.dat doesn't cover it */
+        const uint8_t *getTxPackageFlags(uint32_t index) const {
+            return index < std::min(static_cast<uint32_t>(txPackageFlagsFile.size()), _maxLoadedTx) ? txPackageFlagsFile[index] : nullptr;
+        }
+
+        /** In-block edges of the block, which must be covered by the package files */
+        BlockPackageEdges getBlockPackageEdges(BlockHeight height) const {
+            if (height >= txPackagesSize()) {
+                throw std::runtime_error("Package files do not cover the requested block, run blocksci_parser update");
+            }
+            auto begin = height > 0 ? *blockPackageEdgesFile[static_cast<OffsetType>(height - 1)] : 0;
+            auto end = *blockPackageEdgesFile[static_cast<OffsetType>(height)];
+            BlockPackageEdges edges;
+            edges.count = end - begin;
+            if (edges.count > 0) {
+                edges.byChild = packageEdgesByChildFile[static_cast<OffsetType>(begin)];
+                edges.byParent = packageEdgesByParentFile[static_cast<OffsetType>(begin)];
+            }
+            return edges;
         }
 
         size_t txCount() const {
@@ -295,6 +958,27 @@ namespace blocksci {
             return maxHeight;
         }
 
+        /** Number of blocks in block.dat on disk, which runs ahead of blockCount() until the chain is reloaded
+         *
+         * Only stats the file, so it is cheap enough to poll for new blocks. Respects the block limit of the chain. */
+        BlockHeight diskBlockCount() const {
+            auto count = blockFileInfo.exists() ? static_cast<BlockHeight>(blockFileInfo.size() / static_cast<OffsetType>(sizeof(RawBlock))) : 0;
+            if (blocksIgnored <= 0) {
+                return std::max(count + blocksIgnored, BlockHeight(0));
+            }
+            return std::min(count, blocksIgnored);
+        }
+        
+        /** Generation counter of the data directory, 0 if the parser never wrote it (@see ChainGeneration) */
+        uint64_t dataGeneration() const {
+            auto currentGeneration = generation.current();
+            if (currentGeneration == 0) {
+                generation.reload();
+                currentGeneration = generation.current();
+            }
+            return currentGeneration;
+        }
+
         std::vector<unsigned char> getCoinbase(uint64_t offset) const {
             auto pos = blockCoinbaseFile.getDataAtOffset(static_cast<OffsetType>(offset));
             uint32_t coinbaseLength;
@@ -305,6 +989,177 @@ namespace blocksci {
             return std::vector<unsigned char>(unsignedPos, unsignedPos + length);
         }
 
+        /** Apply the access hint to an entire chain/ file. Persistent hints are kept across reload() */
+        void advise(ChainColumn column, AccessHint hint) {
+            switch (column) {
+                case ChainColumn::Block:
+                    blockFile.advise(hint);
+                    break;
+                case ChainColumn::Coinbase:
+                    blockCoinbaseFile.advise(hint);
+                    break;
+                case ChainColumn::TxData:
+                    txFile.adviseData(hint);
+                    break;
+                case ChainColumn::TxIndex:
+                    txFile.adviseIndex(hint);
+                    break;
+                case ChainColumn::TxVersion:
+                    txVersionFile.advise(hint);
+                    break;
+                case ChainColumn::FirstInput:
+                    txFirstInputFile.advise(hint);
+                    break;
+                case ChainColumn::FirstOutput:
+                    txFirstOutputFile.advise(hint);
+                    break;
+                case ChainColumn::InputSpentOutNum:
+                    inputSpentOutputFile.advise(hint);
+                    break;
+                case ChainColumn::Sequence:
+                    sequenceFile.advise(hint);
+                    break;
+                case ChainColumn::TxHashes:
+                    txHashesFile.advise(hint);
+                    break;
+                case ChainColumn::OutputValue:
+                    outputValueFile.advise(hint);
+                    break;
+                case ChainColumn::OutputType:
+                    outputTypeFile.advise(hint);
+                    break;
+                case ChainColumn::OutputAddress:
+                    outputAddressFile.advise(hint);
+                    break;
+                case ChainColumn::OutputSpentTx:
+                    outputSpentTxFile.advise(hint);
+                    break;
+                case ChainColumn::OutputSpendingInput:
+                    outputSpendingInputFile.advise(hint);
+                    break;
+                case ChainColumn::OutputSpendingHeight:
+                    outputSpendingHeightFile.advise(hint);
+                    break;
+                case ChainColumn::TxFee:
+                    txFeeFile.advise(hint);
+                    break;
+                case ChainColumn::TxVirtualSize:
+                    txVirtualSizeFile.advise(hint);
+                    break;
+                case ChainColumn::InputSpentHeight:
+                    inputSpentHeightFile.advise(hint);
+                    break;
+                case ChainColumn::InputSpentValue:
+                    inputSpentValueFile.advise(hint);
+                    break;
+                case ChainColumn::BlockStats:
+                    blockStatsFile.advise(hint);
+                    break;
+                case ChainColumn::TxPackageFlags:
+                    txPackageFlagsFile.advise(hint);
+                    break;
+            }
+        }
+        
+        /** Memory of a fixed size column, see blocksci::columnData */
+        ColumnData getColumnData(ChainColumn column) const {
+            switch (column) {
+                case ChainColumn::Block:
+                    return fixedColumnData(blockFile, static_cast<uint64_t>(maxHeight));
+                case ChainColumn::TxVersion:
+                    return fixedColumnData(txVersionFile.getRawFile(), _maxLoadedTx);
+                case ChainColumn::FirstInput:
+                    return fixedColumnData(txFirstInputFile, _maxLoadedTx);
+                case ChainColumn::FirstOutput:
+                    return fixedColumnData(txFirstOutputFile, _maxLoadedTx);
+                case ChainColumn::InputSpentOutNum:
+                    return fixedColumnData(inputSpentOutputFile.getRawFile(), inputCount());
+                case ChainColumn::Sequence:
+                    return fixedColumnData(sequenceFile.getRawFile(), inputCount());
+                case ChainColumn::TxHashes:
+                    return fixedColumnData(txHashesFile.getRawFile(), _maxLoadedTx);
+                case ChainColumn::OutputValue:
+                    return fixedColumnData(outputValueFile, outputCount());
+                case ChainColumn::OutputType:
+                    return fixedColumnData(outputTypeFile, outputCount());
+                case ChainColumn::OutputAddress:
+                    return fixedColumnData(outputAddressFile, outputCount());
+                case ChainColumn::OutputSpentTx:
+                    return fixedColumnData(outputSpentTxFile, outputCount());
+                case ChainColumn::OutputSpendingInput:
+                    return fixedColumnData(outputSpendingInputFile, outputCount());
+                case ChainColumn::OutputSpendingHeight:
+                    return fixedColumnData(outputSpendingHeightFile, outputCount());
+                case ChainColumn::TxFee:
+                    return fixedColumnData(txFeeFile, _maxLoadedTx);
+                case ChainColumn::TxVirtualSize:
+                    return fixedColumnData(txVirtualSizeFile, _maxLoadedTx);
+                case ChainColumn::InputSpentHeight:
+                    return fixedColumnData(inputSpentHeightFile, inputCount());
+                case ChainColumn::InputSpentValue:
+                    return fixedColumnData(inputSpentValueFile, inputCount());
+                case ChainColumn::BlockStats:
+                    return fixedColumnData(blockStatsFile, static_cast<uint64_t>(maxHeight));
+                case ChainColumn::TxPackageFlags:
+                    return fixedColumnData(txPackageFlagsFile, _maxLoadedTx);
+                case ChainColumn::TxIndex:
+                    return fixedColumnData(txFile.getIndexFile(), _maxLoadedTx);
+                case ChainColumn::TxData:
+                    return txDataColumnData();
+                case ChainColumn::Coinbase:
+                    break;
+            }
+            throw std::invalid_argument("Only fixed size chain columns and tx data can be accessed directly");
+        }
+
+        /** Apply the access hint to the part of tx_data.dat and tx_index.dat that holds the transactions [beginTxNum, endTxNum)
+         *
+         * Used with AccessHint::WillNeed to pre-fault the data a worker is about to scan.
+         */
+        void adviseTxRange(uint32_t beginTxNum, uint32_t endTxNum, AccessHint hint) const {
+            txFile.advise(hint, beginTxNum, std::min(endTxNum, _maxLoadedTx));
+        }
+
+        /** Bytes of tx_data.dat and tx_index.dat read by a scan of the transactions [beginTxNum, endTxNum) */
+        uint64_t txRangeBytes(uint32_t beginTxNum, uint32_t endTxNum) const {
+            return static_cast<uint64_t>(txFile.dataBytes(beginTxNum, std::min(endTxNum, _maxLoadedTx)));
+        }
+
+        /** Read tx_data.dat through PagedFile (io_uring or pread) instead of page faults on a file mapping */
+        void usePagedTxData() {
+            txFile.usePagedDataBackend();
+        }
+
+        /** Read tx_data.dat through PagedFile in pages of pageSize bytes, fetching the ones missing from the local file
+         * from a remote source such as object storage */
+        void useRemoteTxData(PagedFileRemote remote, uint32_t pageSize) {
+            txFile.usePagedDataBackend(pageSize, std::move(remote));
+        }
+
+        /** Copy block.dat, firstInput.dat, firstOutput.dat and tx_index.dat into huge page backed anonymous memory
+         * and optionally mlock tx_data.dat. Falls back to regular pages when huge pages are unavailable. The copies are
+         * placed on the NUMA nodes according to placement. */
+        ResidentMemoryStats makeResident(bool useHugePages, bool lockTxData, NumaPlacement placement = NumaPlacement::Default) {
+            ResidentMemoryStats stats;
+            auto addResident = [&](OffsetType bytes, bool hugeTLB) {
+                stats.residentBytes += static_cast<uint64_t>(bytes);
+                if (hugeTLB) {
+                    stats.hugePageBytes += static_cast<uint64_t>(bytes);
+                }
+            };
+            addResident(blockFile.makeResident(useHugePages, placement), blockFile.usesHugeTLB());
+            addResident(txFirstInputFile.makeResident(useHugePages, placement), txFirstInputFile.usesHugeTLB());
+            addResident(txFirstOutputFile.makeResident(useHugePages, placement), txFirstOutputFile.usesHugeTLB());
+            addResident(txFile.makeIndexResident(useHugePages, placement), txFile.indexUsesHugeTLB());
+            if (lockTxData) {
+                stats.lockedBytes = static_cast<uint64_t>(txFile.lockData());
+            }
+            // The cached block pointer must point into the resident copy. While resident, on-disk changes
+            // to block.dat (and thus reorgs) are only picked up by reload()
+            setup();
+            return stats;
+        }
+
         void reload() {
             blockFile.reload();
             blockCoinbaseFile.reload();
@@ -315,6 +1170,28 @@ namespace blocksci {
             inputSpentOutputFile.reload();
             txHashesFile.reload();
             sequenceFile.reload();
+            outputValueFile.reload();
+            outputTypeFile.reload();
+            outputAddressFile.reload();
+            outputSpentTxFile.reload();
+            outputSpendingInputFile.reload();
+            outputSpendingHeightFile.reload();
+            txFeeFile.reload();
+            txVirtualSizeFile.reload();
+            inputSpentHeightFile.reload();
+            inputSpentValueFile.reload();
+            blockCoinAgeFile.reload();
+            blockStatsFile.reload();
+            txPackageFlagsFile.reload();
+            blockPackageEdgesFile.reload();
+            packageEdgesByChildFile.reload();
+            packageEdgesByParentFile.reload();
+            inputSignatureFile.reload();
+            inputSignatureStartFile.reload();
+            witnessFile.reload();
+            witnessInfoFile.reload();
+            blockAddressFilterFile.reload();
+            generation.reload();
             setup();
         }
     };
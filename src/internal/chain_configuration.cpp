@@ -37,7 +37,7 @@ namespace blocksci {
     }
     
     void to_json(json& j, const ChainRPCConfiguration& p) {
-        j = json{{"username", p.username}, {"password", p.password}, {"address", p.address}, {"port", p.port}};
+        j = json{{"username", p.username}, {"password", p.password}, {"address", p.address}, {"port", p.port}, {"requestThreads", p.requestThreads}};
     }
     
     void from_json(const json& j, ChainRPCConfiguration& p) {
@@ -45,6 +45,10 @@ namespace blocksci {
         j.at("password").get_to(p.password);
         j.at("address").get_to(p.address);
         j.at("port").get_to(p.port);
+        auto requestThreadsIt = j.find("requestThreads");
+        if (requestThreadsIt != j.end()) {
+            requestThreadsIt->get_to(p.requestThreads);
+        }
     }
     
     ChainConfiguration ChainConfiguration::dash(const std::string &chainDir) {
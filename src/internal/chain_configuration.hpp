@@ -67,6 +67,9 @@ namespace blocksci {
         std::string address;
         int port = 0;
         
+        /** Number of blocks the parser requests from the node concurrently, 0 picks the default */
+        uint32_t requestThreads = 0;
+        
         static ChainRPCConfiguration bitcoin(const std::string &username, const std::string &password);
         static ChainRPCConfiguration bitcoinTestnet(const std::string &username, const std::string &password);
         
@@ -0,0 +1,42 @@
+//
+//  chain_generation.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include "chain_generation.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace blocksci {
+
+    uint64_t ChainGeneration::increment(const filesystem::path &chainDirectory) {
+        auto path = filePath(chainDirectory).str() + ".dat";
+        auto fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Could not open " + path + ": " + std::strerror(errno));
+        }
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) != 0 || (fileStat.st_size < static_cast<off_t>(sizeof(uint64_t)) && ftruncate(fd, sizeof(uint64_t)) != 0)) {
+            auto error = errno;
+            close(fd);
+            throw std::runtime_error("Could not resize " + path + ": " + std::strerror(error));
+        }
+        auto mapping = mmap(nullptr, sizeof(uint64_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("Could not map " + path + ": " + std::strerror(errno));
+        }
+        auto generation = __atomic_add_fetch(static_cast<uint64_t *>(mapping), 1, __ATOMIC_ACQ_REL);
+        munmap(mapping, sizeof(uint64_t));
+        return generation;
+    }
+} // namespace blocksci
@@ -0,0 +1,56 @@
+//
+//  chain_generation.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_chain_generation_hpp
+#define blocksci_chain_generation_hpp
+
+#include "file_mapper.hpp"
+
+#include <wjfilesystem/path.h>
+
+#include <cstdint>
+
+namespace blocksci {
+
+    /** Generation counter shared between the parser and all processes reading a data directory
+     *
+     * File: chain/generation.dat
+     * Raw data format: [<uint64_t generation>]
+     *
+     * The parser increments the counter before and after every update of the chain/ files. Readers remember the
+     * generation they loaded and only need to compare a single integer to know that the data has not been touched,
+     * the expensive comparison of the last block hash is only necessary once the generation changed.
+     */
+    class ChainGeneration {
+        SimpleFileMapper<> file;
+
+    public:
+        explicit ChainGeneration(const filesystem::path &chainDirectory) : file(filePath(chainDirectory)) {}
+
+        static filesystem::path filePath(const filesystem::path &chainDirectory) {
+            return chainDirectory/"generation";
+        }
+
+        /** Current generation, 0 if the parser never wrote the file */
+        uint64_t current() const {
+            if (!file.isGood() || file.size() < static_cast<OffsetType>(sizeof(uint64_t))) {
+                return 0;
+            }
+            return __atomic_load_n(reinterpret_cast<const uint64_t *>(file.getDataAtOffset(0)), __ATOMIC_ACQUIRE);
+        }
+
+        /** Pick up the file if the parser created it since it was opened */
+        void reload() {
+            file.reload();
+        }
+
+        /** Increment the generation of the data directory, creating the file if necessary. Used by the parser */
+        static uint64_t increment(const filesystem::path &chainDirectory);
+    };
+} // namespace blocksci
+
+#endif /* blocksci_chain_generation_hpp */
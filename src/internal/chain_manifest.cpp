@@ -0,0 +1,110 @@
+//
+//  chain_manifest.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "chain_manifest.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace blocksci {
+
+    namespace {
+        constexpr off_t entrySize = static_cast<off_t>(sizeof(ChainManifestEntry));
+
+        /** Open the manifest for writing and drop a partially written entry left by an interrupted parser */
+        int openForWriting(const std::string &path, off_t &entryCount) {
+            auto fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+            if (fd < 0) {
+                throw std::runtime_error("Could not open " + path + ": " + std::strerror(errno));
+            }
+            struct stat fileStat;
+            if (fstat(fd, &fileStat) != 0) {
+                auto error = errno;
+                close(fd);
+                throw std::runtime_error("Could not stat " + path + ": " + std::strerror(error));
+            }
+            entryCount = fileStat.st_size / entrySize;
+            if (fileStat.st_size % entrySize != 0 && ftruncate(fd, entryCount * entrySize) != 0) {
+                auto error = errno;
+                close(fd);
+                throw std::runtime_error("Could not resize " + path + ": " + std::strerror(error));
+            }
+            return fd;
+        }
+
+        bool readEntry(int fd, off_t index, ChainManifestEntry &entry) {
+            return pread(fd, &entry, sizeof(entry), index * entrySize) == static_cast<ssize_t>(sizeof(entry));
+        }
+    }
+
+    ranges::optional<ChainManifestEntry> ChainManifest::latest() const {
+        for (auto index = static_cast<OffsetType>(file.size()); index > 0; index--) {
+            auto entry = *file[index - 1];
+            if (entry.isComplete()) {
+                return entry;
+            }
+        }
+        return ranges::nullopt;
+    }
+
+    ranges::optional<ChainManifestEntry> ChainManifest::find(uint64_t version) const {
+        if (version == 0 || version > static_cast<uint64_t>(file.size())) {
+            return ranges::nullopt;
+        }
+        auto entry = *file[static_cast<OffsetType>(version - 1)];
+        if (!entry.isComplete() || entry.version != version) {
+            return ranges::nullopt;
+        }
+        return entry;
+    }
+
+    uint64_t ChainManifest::publish(const filesystem::path &chainDirectory, ChainManifestEntry entry) {
+        auto path = filePath(chainDirectory).str() + ".dat";
+        off_t entryCount = 0;
+        auto fd = openForWriting(path, entryCount);
+        ChainManifestEntry last;
+        while (entryCount > 0 && !(readEntry(fd, entryCount - 1, last) && last.isComplete())) {
+            entryCount--;
+        }
+        entry.version = static_cast<uint64_t>(entryCount) + 1;
+        entry.versionCheck = entry.version;
+        // Readers find an entry by its position, so an incomplete one is overwritten rather than skipped
+        if (pwrite(fd, &entry, sizeof(entry), entryCount * entrySize) != static_cast<ssize_t>(sizeof(entry)) || ftruncate(fd, (entryCount + 1) * entrySize) != 0 || fdatasync(fd) != 0) {
+            auto error = errno;
+            close(fd);
+            throw std::runtime_error("Could not write " + path + ": " + std::strerror(error));
+        }
+        close(fd);
+        return entry.version;
+    }
+
+    void ChainManifest::truncate(const filesystem::path &chainDirectory, BlockHeight blockCount) {
+        auto path = filePath(chainDirectory).str() + ".dat";
+        if (!filesystem::path{path}.exists()) {
+            return;
+        }
+        off_t entryCount = 0;
+        auto fd = openForWriting(path, entryCount);
+        // The chain only grows between rollbacks, so the entries are ordered by block count
+        ChainManifestEntry entry;
+        while (entryCount > 0 && (!readEntry(fd, entryCount - 1, entry) || entry.blockCount > static_cast<uint32_t>(blockCount))) {
+            entryCount--;
+        }
+        if (ftruncate(fd, entryCount * entrySize) != 0) {
+            auto error = errno;
+            close(fd);
+            throw std::runtime_error("Could not resize " + path + ": " + std::strerror(error));
+        }
+        close(fd);
+    }
+} // namespace blocksci
@@ -0,0 +1,82 @@
+//
+//  chain_manifest.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_chain_manifest_hpp
+#define blocksci_chain_manifest_hpp
+
+#include "file_mapper.hpp"
+
+#include <blocksci/core/bitcoin_uint256.hpp>
+#include <blocksci/core/dedup_address_type.hpp>
+#include <blocksci/core/typedefs.hpp>
+
+#include <range/v3/utility/optional.hpp>
+
+#include <wjfilesystem/path.h>
+
+#include <array>
+#include <cstdint>
+
+namespace blocksci {
+
+    /** Logical sizes of the chain and script files after one parser update
+     *
+     * All files the update touched only grew, so a reader that stops at these sizes sees exactly the chain of the
+     * update no matter how many blocks the parser appended since. version is repeated at the end of the entry, a
+     * reader that sees the two differ caught the entry while it was being written.
+     */
+    struct ChainManifestEntry {
+        uint64_t version;
+        uint256 tipHash;
+        uint32_t blockCount;
+        uint32_t txCount;
+        uint64_t inputCount;
+        uint64_t outputCount;
+        std::array<uint32_t, DedupAddressType::size> scriptCounts;
+        uint64_t versionCheck;
+
+        bool isComplete() const {
+            return version != 0 && version == versionCheck;
+        }
+    };
+
+    /** Versioned snapshots of the data directory that readers can pin while the parser keeps appending
+     *
+     * File: chain/manifest.dat
+     * Raw data format: [<ChainManifestEntry version 1>, <ChainManifestEntry version 2>, ...]
+     *
+     * The parser appends an entry once an update is complete (@see publish). Versions are numbered consecutively, so
+     * version v is the entry at index v - 1. A rollback of the chain removes the entries of the undone blocks, readers
+     * pinned to one of them notice through the tip hash like any other reader loaded with errorOnReorg.
+     */
+    class ChainManifest {
+        FixedSizeFileMapper<ChainManifestEntry> file;
+
+    public:
+        explicit ChainManifest(const filesystem::path &chainDirectory) : file(filePath(chainDirectory)) {}
+
+        static filesystem::path filePath(const filesystem::path &chainDirectory) {
+            return chainDirectory/"manifest";
+        }
+
+        /** Most recent complete entry, nullopt if the parser never published one */
+        ranges::optional<ChainManifestEntry> latest() const;
+
+        /** Entry of the given version, nullopt if it was never published or has been rolled back */
+        ranges::optional<ChainManifestEntry> find(uint64_t version) const;
+
+        /** Append an entry for the current state of the chain and script files, numbering it after the last entry.
+         * Used by the parser once an update is complete, returns the version of the new entry */
+        static uint64_t publish(const filesystem::path &chainDirectory, ChainManifestEntry entry);
+
+        /** Remove the entries of snapshots with more than blockCount blocks. Used by the parser when it rolls the
+         * chain back */
+        static void truncate(const filesystem::path &chainDirectory, BlockHeight blockCount);
+    };
+} // namespace blocksci
+
+#endif /* blocksci_chain_manifest_hpp */
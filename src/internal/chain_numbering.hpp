@@ -0,0 +1,59 @@
+//
+//  chain_numbering.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_chain_numbering_hpp
+#define blocksci_chain_numbering_hpp
+
+#include "chain_access.hpp"
+
+#include <blocksci/chain/output_pointer.hpp>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace blocksci {
+    /* The txes and outputs of consecutive blocks have consecutive numbers, so the numbers of a block range follow from
+     * the counts of its RawBlocks without reading the txes. */
+
+    /** Tx numbers [first, second) of the blocks [start, stop) */
+    inline std::pair<uint64_t, uint64_t> txNumRange(const ChainAccess &chain, BlockHeight start, BlockHeight stop) {
+        if (start >= stop) {
+            return {0, 0};
+        }
+        auto last = chain.getBlock(stop - 1);
+        return {chain.getBlock(start)->firstTxIndex, uint64_t{last->firstTxIndex} + last->txCount};
+    }
+
+    /** Output numbers [first, second) of the blocks [start, stop) */
+    inline std::pair<uint64_t, uint64_t> outputNumRange(const ChainAccess &chain, BlockHeight start, BlockHeight stop) {
+        if (start >= stop) {
+            return {0, 0};
+        }
+        auto last = chain.getBlock(stop - 1);
+        return {chain.getFirstOutputNumber(chain.getBlock(start)->firstTxIndex), chain.getFirstOutputNumber(last->firstTxIndex) + last->outputCount};
+    }
+
+    /** Pointers to the outputs with the given sorted output numbers */
+    inline std::vector<OutputPointer> outputPointers(const ChainAccess &chain, const std::vector<uint64_t> &outputNums) {
+        std::vector<OutputPointer> pointers;
+        pointers.reserve(outputNums.size());
+        uint32_t txNum = 0;
+        uint64_t txEnd = 0;
+        for (auto outputNum : outputNums) {
+            // Sorted outputs often share their tx with the previous one
+            if (pointers.empty() || outputNum >= txEnd || outputNum < chain.getFirstOutputNumber(txNum)) {
+                txNum = chain.getTxNumOfOutput(outputNum);
+                txEnd = chain.getFirstOutputNumber(txNum) + chain.getTx(txNum)->outputCount;
+            }
+            pointers.emplace_back(txNum, static_cast<uint16_t>(outputNum - chain.getFirstOutputNumber(txNum)));
+        }
+        return pointers;
+    }
+} // namespace blocksci
+
+#endif /* blocksci_chain_numbering_hpp */
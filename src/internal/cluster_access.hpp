@@ -11,14 +11,24 @@
 #include "address_info.hpp"
 #include "dedup_address_info.hpp"
 #include "file_mapper.hpp"
+#include "packed_cluster_addresses.hpp"
 
+#include <blocksci/cluster/cluster.hpp>
+#include <blocksci/cluster/cluster_stats.hpp>
 #include <blocksci/core/raw_address.hpp>
 #include <blocksci/core/dedup_address.hpp>
 
-#include <range/v3/view/subrange.hpp>
+#include <range/v3/utility/optional.hpp>
 
 #include <wjfilesystem/path.h>
 
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
 namespace blocksci {
     template<DedupAddressType::Enum type>
     struct ScriptClusterIndexFile : public FixedSizeFileMapper<uint32_t> {
@@ -28,14 +38,86 @@ namespace blocksci {
     class ClusterAccess;
     class DataAccess;
     
+    /** Layout of cluster_stats.dat
+     *
+     * A header followed by one column per ClusterStat in declaration order, each holding the value of every cluster by
+     * cluster number. The 64 bit columns come first, which keeps every column aligned.
+     */
+    struct ClusterStatsHeader {
+        static constexpr uint64_t Magic = 0x5354415453434c42ULL; // "BLCSTATS"
+        
+        uint64_t magic;
+        uint64_t clusterCount;
+        
+        static uint64_t columnOffset(ClusterStat column, uint64_t clusterCount) {
+            auto index = static_cast<uint64_t>(column);
+            auto wideColumns = static_cast<uint64_t>(ClusterStat::AddressCount);
+            if (index < wideColumns) {
+                return sizeof(ClusterStatsHeader) + index * sizeof(int64_t) * clusterCount;
+            }
+            return sizeof(ClusterStatsHeader) + wideColumns * sizeof(int64_t) * clusterCount + (index - wideColumns) * sizeof(uint32_t) * clusterCount;
+        }
+        
+        static uint64_t fileSize(uint64_t clusterCount) {
+            return columnOffset(ClusterStat::LastHeight, clusterCount) + sizeof(BlockHeight) * clusterCount;
+        }
+    };
+    
+    /** Layout of cluster_layout.dat, which marks clusterings that leave out the clusters of a single address
+     *
+     * Most clusters hold a single address. Clusters with several addresses are numbered first and are the only ones
+     * listed in clusterOffsets.dat and clusterAddresses.dat. Every other address is a cluster of its own, numbered from
+     * multiAddressClusterCount on in the order of the address indexes (by type in the order of the script starts, then
+     * by scriptNum), so the cluster index of its type is the only place it is recorded. Clusterings without this file
+     * list every cluster explicitly.
+     */
+    struct ClusterLayoutHeader {
+        static constexpr uint64_t Magic = 0x54554f59414c4c43ULL; // "CLLAYOUT"
+        
+        uint64_t magic;
+        uint32_t clusterCount;
+        uint32_t multiAddressClusterCount;
+        
+        /** Number of the first single address cluster of every DedupAddressType and how many the type has */
+        std::array<uint32_t, DedupAddressType::size> singletonStarts;
+        std::array<uint32_t, DedupAddressType::size> singletonCounts;
+        
+        static std::string filePath(const std::string &baseDirectory) {
+            return (filesystem::path{baseDirectory}/"cluster_layout.dat").str();
+        }
+        
+        /** The header of the clustering in baseDirectory, nullopt for clusterings that list every cluster */
+        static ranges::optional<ClusterLayoutHeader> read(const std::string &baseDirectory) {
+            std::ifstream file{filePath(baseDirectory), std::ios::binary};
+            if (!file) {
+                return ranges::nullopt;
+            }
+            ClusterLayoutHeader header;
+            file.read(reinterpret_cast<char *>(&header), sizeof(header));
+            if (!file || header.magic != Magic) {
+                throw std::runtime_error("Invalid cluster layout in " + filePath(baseDirectory));
+            }
+            return header;
+        }
+    };
+    
     template<blocksci::DedupAddressType::Enum type>
     struct ClusterNumFunctor {
         static uint32_t f(const ClusterAccess *access, uint32_t scriptNum);
     };
     
+    template<blocksci::DedupAddressType::Enum type>
+    struct ClusterIndexColumnFunctor {
+        static std::pair<const uint32_t *, uint32_t> f(const ClusterAccess *access);
+    };
+    
     class ClusterAccess {
         FixedSizeFileMapper<uint32_t> clusterOffsetFile;
         FixedSizeFileMapper<DedupAddress> clusterScriptsFile;
+        SimpleFileMapper<> clusterStatsFile;
+        ranges::optional<ClusterLayoutHeader> layout;
+        PackedClusterAddresses packedAddresses;
+        bool hasPackedAddresses = false;
         
         using ScriptClusterIndexTuple = to_dedup_address_tuple_t<ScriptClusterIndexFile>;
         
@@ -47,6 +129,9 @@ namespace blocksci {
         template<DedupAddressType::Enum type>
         friend struct ClusterNumFunctor;
         
+        template<DedupAddressType::Enum type>
+        friend struct ClusterIndexColumnFunctor;
+        
         template<DedupAddressType::Enum type>
         uint32_t getClusterNumImpl(uint32_t scriptNum) const {
             auto &file = std::get<ScriptClusterIndexFile<type>>(scriptClusterIndexFiles);
@@ -59,6 +144,9 @@ namespace blocksci {
         ClusterAccess(const std::string &baseDirectory, DataAccess &access_) :
         clusterOffsetFile((filesystem::path{baseDirectory}/"clusterOffsets").str()),
         clusterScriptsFile((filesystem::path{baseDirectory}/"clusterAddresses").str()),
+        clusterStatsFile(filesystem::path{baseDirectory}/"cluster_stats"),
+        layout(ClusterLayoutHeader::read(baseDirectory)),
+        packedAddresses(filesystem::path{baseDirectory}/"clusterAddressesPacked"),
         scriptClusterIndexFiles(blocksci::apply(DedupAddressType::all(), [&] (auto tag) {
             std::stringstream ss;
             ss << dedupAddressName(tag) << "_cluster_index";
@@ -68,6 +156,7 @@ namespace blocksci {
             if (!(filesystem::path{baseDirectory}/"clusterAddresses.dat").exists()) {
                 throw std::runtime_error("Cluster data not found");
             }
+            hasPackedAddresses = packedAddresses.matches(multiAddressClusterCount(), static_cast<uint64_t>(clusterScriptsFile.size()));
         }
         
         static std::string offsetFilePath(const std::string &baseDirectory) {
@@ -85,13 +174,95 @@ namespace blocksci {
             return (base/ss.str()).str();
         }
         
+        /** Path of the optional packed copy of the large clusters, @see PackedClusterAddressesHeader */
+        static std::string packedAddressesFilePath(const std::string &baseDirectory) {
+            return (filesystem::path{baseDirectory}/"clusterAddressesPacked.dat").str();
+        }
+        
+        /** Whether large clusters are read from a packed copy of their addresses that matches the clustering */
+        bool usesPackedAddresses() const {
+            return hasPackedAddresses;
+        }
+        
+        static std::string statsFilePath(const std::string &baseDirectory) {
+            return (filesystem::path{baseDirectory}/"cluster_stats.dat").str();
+        }
+        
         uint32_t getClusterNum(const RawAddress &address) const {
             static auto table = blocksci::make_dynamic_table<DedupAddressType, ClusterNumFunctor>();
             auto index = static_cast<size_t>(dedupType(address.type));
             return table.at(index)(this, address.scriptNum);
         }
         
+        /** Cluster numbers of all addresses of the type ordered by scriptNum and the number of addresses */
+        std::pair<const uint32_t *, uint32_t> getTypeClusterNums(DedupAddressType::Enum type) const {
+            static auto table = blocksci::make_dynamic_table<DedupAddressType, ClusterIndexColumnFunctor>();
+            return table.at(static_cast<size_t>(type))(this);
+        }
+        
+        /** The end offset in the addresses file of every cluster with an entry in clusterOffsets.dat */
+        std::pair<const uint32_t *, uint32_t> getClusterOffsetsColumn() const {
+            auto count = std::min(static_cast<uint32_t>(clusterOffsetFile.size()), multiAddressClusterCount());
+            return {count > 0 ? clusterOffsetFile[0] : nullptr, count};
+        }
+        
+        /** The addresses of those clusters, one after the other */
+        std::pair<const DedupAddress *, uint32_t> getClusterAddressesColumn() const {
+            auto count = static_cast<uint32_t>(clusterScriptsFile.size());
+            return {count > 0 ? clusterScriptsFile[0] : nullptr, count};
+        }
+        
+        /** Whether the clustering leaves the clusters of a single address out of the cluster files */
+        bool hasImplicitSingletons() const {
+            return static_cast<bool>(layout);
+        }
+        
+        /** Clusters with an entry in clusterOffsets.dat, which are numbered before all clusters of a single address */
+        uint32_t multiAddressClusterCount() const {
+            return layout ? layout->multiAddressClusterCount : clusterCount();
+        }
+        
+        /** Whether the cluster is one of the single address clusters left out of the cluster files */
+        bool isImplicitSingleton(uint32_t clusterNum) const {
+            return layout && clusterNum >= layout->multiAddressClusterCount;
+        }
+        
+        /** The address of a single address cluster left out of the cluster files
+         *
+         * Within the cluster index of a type the numbers of these clusters increase with the scriptNum, while those
+         * of the other clusters are all smaller, so this is a binary search that steps over the latter. */
+        DedupAddress getImplicitSingleton(uint32_t clusterNum) const {
+            for (size_t i = 0; i < DedupAddressType::size; i++) {
+                if (clusterNum < layout->singletonStarts[i] || clusterNum - layout->singletonStarts[i] >= layout->singletonCounts[i]) {
+                    continue;
+                }
+                auto type = static_cast<DedupAddressType::Enum>(i);
+                auto column = getTypeClusterNums(type);
+                uint32_t low = 0;
+                uint32_t high = column.second;
+                while (low < high) {
+                    auto mid = low + (high - low) / 2;
+                    auto next = mid;
+                    while (next < high && column.first[next] < layout->multiAddressClusterCount) {
+                        next++;
+                    }
+                    if (next == high || column.first[next] > clusterNum) {
+                        high = mid;
+                    } else if (column.first[next] < clusterNum) {
+                        low = next + 1;
+                    } else {
+                        return DedupAddress{next + 1, type};
+                    }
+                }
+                break;
+            }
+            throw std::out_of_range("Cluster " + std::to_string(clusterNum) + " is not part of the clustering");
+        }
+        
         uint32_t getClusterSize(uint32_t clusterNum) const {
+            if (isImplicitSingleton(clusterNum)) {
+                return 1;
+            }
             auto clusterOffset = *clusterOffsetFile[clusterNum];
             auto clusterSize = clusterOffset;
             if (clusterNum > 0) {
@@ -101,10 +272,13 @@ namespace blocksci {
         }
         
         uint32_t clusterCount() const {
-            return static_cast<uint32_t>(clusterOffsetFile.size()) - 1;
+            return layout ? layout->clusterCount : static_cast<uint32_t>(clusterOffsetFile.size()) - 1;
         }
         
-        ranges::subrange<const blocksci::DedupAddress *> getClusterScripts(uint32_t clusterNum) const {
+        ClusterDedupAddresses getClusterScripts(uint32_t clusterNum) const {
+            if (isImplicitSingleton(clusterNum)) {
+                return ClusterDedupAddresses{getImplicitSingleton(clusterNum)};
+            }
             auto nextClusterOffset = *clusterOffsetFile[clusterNum];
             uint32_t clusterOffset = 0;
             if (clusterNum > 0) {
@@ -112,15 +286,23 @@ namespace blocksci {
             }
             auto clusterSize = nextClusterOffset - clusterOffset;
             
+            if (hasPackedAddresses && packedAddresses.covers(clusterSize)) {
+                auto decoded = std::make_shared<std::vector<DedupAddress>>(clusterSize);
+                packedAddresses.decode(clusterNum, clusterSize, decoded->data());
+                return ClusterDedupAddresses{std::shared_ptr<const std::vector<DedupAddress>>{std::move(decoded)}};
+            }
+            
             auto firstAddressOffset = clusterScriptsFile[clusterOffset];
             
-            return ranges::make_subrange(firstAddressOffset, firstAddressOffset + clusterSize);
+            return ClusterDedupAddresses{firstAddressOffset, firstAddressOffset + clusterSize};
         }
         
         std::vector<uint32_t> getClusterSizes() const {
-            auto tot = clusterCount();
-            std::vector<uint32_t> clusterSizes;
-            clusterSizes.resize(tot);
+            auto tot = multiAddressClusterCount();
+            std::vector<uint32_t> clusterSizes(clusterCount(), 1);
+            if (tot == 0) {
+                return clusterSizes;
+            }
             
             clusterSizes[tot - 1] = *clusterOffsetFile[tot - 1];
             for (uint32_t i = 2; i <= tot; i++) {
@@ -129,6 +311,49 @@ namespace blocksci {
             }
             return clusterSizes;
         }
+        
+        /** Whether cluster_stats.dat exists and belongs to the current clustering, clusterings created before the
+         * statistics were added don't have it */
+        bool hasClusterStats() const {
+            if (clusterStatsFile.size() < sizeof(ClusterStatsHeader)) {
+                return false;
+            }
+            auto header = reinterpret_cast<const ClusterStatsHeader *>(clusterStatsFile.getDataAtOffset(0));
+            return header->magic == ClusterStatsHeader::Magic && header->clusterCount == clusterCount() && clusterStatsFile.size() == ClusterStatsHeader::fileSize(clusterCount());
+        }
+        
+        /** Values of the statistic for all clusters, requires hasClusterStats() and a column of matching type */
+        template <typename T>
+        const T *getStatColumn(ClusterStat column) const {
+            return reinterpret_cast<const T *>(clusterStatsFile.getDataAtOffset(0) + ClusterStatsHeader::columnOffset(column, clusterCount()));
+        }
+        
+        int64_t getClusterStat(ClusterStat column, uint32_t clusterNum) const {
+            switch (column) {
+                case ClusterStat::TotalReceived:
+                case ClusterStat::Balance:
+                    return getStatColumn<int64_t>(column)[clusterNum];
+                case ClusterStat::AddressCount:
+                case ClusterStat::TxCount:
+                    return getStatColumn<uint32_t>(column)[clusterNum];
+                case ClusterStat::FirstHeight:
+                case ClusterStat::LastHeight:
+                    return getStatColumn<BlockHeight>(column)[clusterNum];
+            }
+            assert(false);
+            return 0;
+        }
+        
+        ClusterStats getClusterStats(uint32_t clusterNum) const {
+            ClusterStats stats;
+            stats.totalReceived = getStatColumn<int64_t>(ClusterStat::TotalReceived)[clusterNum];
+            stats.balance = getStatColumn<int64_t>(ClusterStat::Balance)[clusterNum];
+            stats.addressCount = getStatColumn<uint32_t>(ClusterStat::AddressCount)[clusterNum];
+            stats.txCount = getStatColumn<uint32_t>(ClusterStat::TxCount)[clusterNum];
+            stats.firstHeight = getStatColumn<BlockHeight>(ClusterStat::FirstHeight)[clusterNum];
+            stats.lastHeight = getStatColumn<BlockHeight>(ClusterStat::LastHeight)[clusterNum];
+            return stats;
+        }
     };
     
     template<blocksci::DedupAddressType::Enum type>
@@ -136,6 +361,13 @@ namespace blocksci {
         return access->getClusterNumImpl<type>(scriptNum);
     }
     
+    template<blocksci::DedupAddressType::Enum type>
+    std::pair<const uint32_t *, uint32_t> ClusterIndexColumnFunctor<type>::f(const ClusterAccess *access) {
+        auto &file = std::get<ScriptClusterIndexFile<type>>(access->scriptClusterIndexFiles);
+        auto count = static_cast<uint32_t>(file.size());
+        return {count > 0 ? file[0] : nullptr, count};
+    }
+    
 } // namespace blocksci
 
 #endif /* cluster_access_h */
@@ -8,12 +8,16 @@
 #ifndef column_iterator_h
 #define column_iterator_h
 
+#include "access_stats.hpp"
 #include "memory_view.hpp"
+#include "tracing.hpp"
 
 #include <range/v3/view/facade.hpp>
 
 #include <rocksdb/db.h>
 
+#include <memory>
+#include <string>
 #include <vector>
 
 namespace rocksdb {
@@ -25,6 +29,44 @@ namespace rocksdb {
 namespace blocksci {
     struct MemoryView;
     
+    /** Read options for a scan over all keys starting with prefix, or over the whole column if prefix is empty
+     *
+     * A prefix scan stops at the first key past the prefix instead of reading on until a key doesn't match, and only
+     * touches the table files whose prefix bloom filter contains the prefix. The options reference the upper bound
+     * stored in this object, so it has to outlive all iterators created with them.
+     */
+    class ScanOptions {
+        std::string upperBound;
+        rocksdb::Slice upperBoundSlice;
+        rocksdb::ReadOptions options;
+        
+    public:
+        ScanOptions(const char *prefix, size_t size) : upperBound(prefix, size) {
+            if (size == 0) {
+                // Columns with a prefix extractor only return all keys in order if asked to
+                options.total_order_seek = true;
+                return;
+            }
+            options.prefix_same_as_start = true;
+            // The smallest key greater than all keys with the prefix
+            while (!upperBound.empty() && static_cast<uint8_t>(upperBound.back()) == 0xFF) {
+                upperBound.pop_back();
+            }
+            if (!upperBound.empty()) {
+                upperBound.back() = static_cast<char>(static_cast<uint8_t>(upperBound.back()) + 1);
+                upperBoundSlice = rocksdb::Slice(upperBound);
+                options.iterate_upper_bound = &upperBoundSlice;
+            }
+        }
+        
+        ScanOptions(const ScanOptions &) = delete;
+        ScanOptions &operator=(const ScanOptions &) = delete;
+        
+        const rocksdb::ReadOptions &get() const {
+            return options;
+        }
+    };
+    
     class ColumnIterator : public ranges::view_facade<ColumnIterator> {
         friend ranges::range_access;
         rocksdb::DB *db;
@@ -35,11 +77,21 @@ namespace blocksci {
         private:
             rocksdb::DB *db;
             rocksdb::ColumnFamilyHandle *column;
-            std::shared_ptr<rocksdb::Iterator> it;
             std::vector<char> prefixBytes;
+            std::shared_ptr<const ScanOptions> scanOptions;
+            std::shared_ptr<rocksdb::Iterator> it;
+            
+            /** Ends once the last copy of the cursor is gone, only set while tracing */
+            std::shared_ptr<TraceSpan> scanSpan;
         public:
             cursor() = default;
-            cursor(rocksdb::DB *db_, rocksdb::ColumnFamilyHandle *column_, std::vector<char> prefix)  : db(db_), column(column_), it(std::shared_ptr<rocksdb::Iterator>{db->NewIterator(rocksdb::ReadOptions(), column)}), prefixBytes(std::move(prefix)) {
+            cursor(rocksdb::DB *db_, rocksdb::ColumnFamilyHandle *column_, std::vector<char> prefix)  : db(db_), column(column_), prefixBytes(std::move(prefix)), scanOptions(std::make_shared<const ScanOptions>(prefixBytes.data(), prefixBytes.size())) {
+                BLOCKSCI_COUNT_ACCESS(IndexIteratorStep);
+                if (TraceSpan::tracing()) {
+                    scanSpan = std::make_shared<TraceSpan>(TraceOperation::IndexScan);
+                }
+                TraceSpan seekSpan{TraceOperation::IndexSeek};
+                it = std::shared_ptr<rocksdb::Iterator>{db->NewIterator(scanOptions->get(), column)};
                 if (prefixBytes.size() > 0) {
                     rocksdb::Slice key(prefixBytes.data(), prefixBytes.size());
                     it->Seek(key);
@@ -64,8 +116,10 @@ namespace blocksci {
             }
             
             void next() {
+                BLOCKSCI_COUNT_ACCESS(IndexIteratorStep);
                 if (it.use_count() > 1) {
-                    auto newIt = std::shared_ptr<rocksdb::Iterator>{db->NewIterator(rocksdb::ReadOptions(), column)};
+                    TraceSpan seekSpan{TraceOperation::IndexSeek};
+                    auto newIt = std::shared_ptr<rocksdb::Iterator>{db->NewIterator(scanOptions->get(), column)};
                     newIt->Seek(it->key());
                     it = newIt;
                 }
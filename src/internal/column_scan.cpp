@@ -0,0 +1,122 @@
+//
+//  column_scan.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "column_scan.hpp"
+#include "segment_work.hpp"
+#include "tracing.hpp"
+
+#include <rocksdb/db.h>
+#include <rocksdb/metadata.h>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace blocksci {
+    namespace {
+        /** Ranges per thread, so that threads that finish early take over the rest of the work */
+        constexpr uint32_t rangesPerThread = 4;
+
+        /** Sequential reads of a range fetch this much ahead of the iterator */
+        constexpr size_t scanReadahead = size_t{2} << 20;
+    }
+
+    std::vector<KeyRange> partitionColumn(rocksdb::DB *db, rocksdb::ColumnFamilyHandle *column, uint32_t partitionCount) {
+        rocksdb::ColumnFamilyMetaData metadata;
+        db->GetColumnFamilyMetaData(column, &metadata);
+        std::vector<std::pair<std::string, uint64_t>> fileStarts;
+        uint64_t totalSize = 0;
+        for (auto &level : metadata.levels) {
+            for (auto &file : level.files) {
+                fileStarts.emplace_back(file.smallestkey, file.size);
+                totalSize += file.size;
+            }
+        }
+        std::sort(fileStarts.begin(), fileStarts.end());
+
+        // Files of level 0 overlap the others, which only makes the ranges a little less even
+        std::vector<KeyRange> ranges;
+        auto targetSize = std::max<uint64_t>(totalSize / std::max(partitionCount, 1u), 1);
+        std::string begin;
+        uint64_t sizeBefore = 0;
+        for (auto &fileStart : fileStarts) {
+            if (sizeBefore >= targetSize * (ranges.size() + 1) && fileStart.first > begin) {
+                ranges.push_back({begin, fileStart.first});
+                begin = fileStart.first;
+            }
+            sizeBefore += fileStart.second;
+        }
+        ranges.push_back({begin, std::string{}});
+        return ranges;
+    }
+
+    void scanColumnParallel(rocksdb::DB *db, rocksdb::ColumnFamilyHandle *column, uint32_t threadCount, const std::function<void(uint32_t threadNum, rocksdb::Iterator &it)> &visit) {
+        threadCount = resolveThreadCount(threadCount);
+        auto ranges = partitionColumn(db, column, threadCount * rangesPerThread);
+        threadCount = std::min(threadCount, static_cast<uint32_t>(ranges.size()));
+
+        std::atomic<size_t> nextRange{0};
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;
+        std::mutex errorMutex;
+        auto worker = [&](uint32_t threadNum) {
+            try {
+                size_t rangeNum;
+                while (!failed.load() && (rangeNum = nextRange.fetch_add(1)) < ranges.size()) {
+                    auto &range = ranges[rangeNum];
+                    TraceSpan scanSpan{TraceOperation::IndexScan};
+                    rocksdb::Slice lowerBound{range.begin};
+                    rocksdb::Slice upperBound{range.end};
+                    rocksdb::ReadOptions options;
+                    // Columns with a prefix extractor only return all keys in order if asked to
+                    options.total_order_seek = true;
+                    options.fill_cache = false;
+                    options.readahead_size = scanReadahead;
+                    if (!range.begin.empty()) {
+                        options.iterate_lower_bound = &lowerBound;
+                    }
+                    if (!range.end.empty()) {
+                        options.iterate_upper_bound = &upperBound;
+                    }
+                    std::unique_ptr<rocksdb::Iterator> it{db->NewIterator(options, column)};
+                    if (range.begin.empty()) {
+                        it->SeekToFirst();
+                    } else {
+                        it->Seek(lowerBound);
+                    }
+                    visit(threadNum, *it);
+                    if (!it->status().ok()) {
+                        throw std::runtime_error("Error scanning index column " + column->GetName() + ": " + it->status().ToString());
+                    }
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                failed = true;
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (uint32_t threadNum = 1; threadNum < threadCount; threadNum++) {
+            threads.emplace_back(worker, threadNum);
+        }
+        worker(0);
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+} // namespace blocksci
@@ -0,0 +1,47 @@
+//
+//  column_scan.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_column_scan_hpp
+#define blocksci_column_scan_hpp
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace rocksdb {
+    class DB;
+    class ColumnFamilyHandle;
+    class Iterator;
+}
+
+namespace blocksci {
+    /** Keys [begin, end) of a column, an empty begin starts at the first key and an empty end runs to the last one */
+    struct KeyRange {
+        std::string begin;
+        std::string end;
+    };
+
+    /** Split the keys of the column into at most partitionCount consecutive ranges holding about the same number of
+     * bytes
+     *
+     * The ranges are cut at the smallest keys of the table files of the column (GetColumnFamilyMetaData), so no data
+     * is read. A column whose data is still in the memtables or in a few large files gets fewer ranges. */
+    std::vector<KeyRange> partitionColumn(rocksdb::DB *db, rocksdb::ColumnFamilyHandle *column, uint32_t partitionCount);
+
+    /** Scan the whole column on threadCount threads (0 for one per hardware thread)
+     *
+     * The column is split with partitionColumn into a few ranges per thread, which the threads take in turns. For every
+     * range visit(threadNum, it) is called with an iterator positioned at the first key of the range that becomes
+     * invalid past its last key (iterate_upper_bound), so visit steps through the range with it.Next(). The calls of
+     * one threadNum (< the resolved thread count) never overlap, so visit can accumulate into per thread state without
+     * locking. The order of the ranges across threads is unspecified. The scan bypasses the block cache. The first
+     * exception thrown by visit or a failed iterator stops the scan and is rethrown. */
+    void scanColumnParallel(rocksdb::DB *db, rocksdb::ColumnFamilyHandle *column, uint32_t threadCount, const std::function<void(uint32_t threadNum, rocksdb::Iterator &it)> &visit);
+} // namespace blocksci
+
+#endif /* blocksci_column_scan_hpp */
@@ -0,0 +1,420 @@
+//
+//  compressed_file_mapper.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef compressed_file_mapper_hpp
+#define compressed_file_mapper_hpp
+
+#include "file_mapper.hpp"
+
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+
+namespace blocksci {
+
+    /** Codec used to encode a single chunk of a compressed column */
+    enum class ChunkCodec : uint32_t {
+        /** Elements are stored as-is */
+        Raw = 0,
+        /** Runs of identical elements stored as [uint32_t runLength, T value] pairs */
+        RunLength = 1,
+        /** Frame-of-reference: int64_t base followed by the bit width and the packed deltas (integral types only) */
+        BitPacked = 2
+    };
+
+    static constexpr uint32_t compressedColumnMagic = 0x43435342; // "BSCC"
+    static constexpr uint32_t defaultCompressedChunkSize = 1 << 16;
+
+    struct CompressedColumnHeader {
+        uint32_t magic;
+        uint32_t elementSize;
+        uint32_t chunkSize;
+        uint32_t reserved;
+        uint64_t elementCount;
+        uint64_t chunkCount;
+    };
+
+    struct CompressedChunkInfo {
+        uint64_t offset;
+        uint32_t size;
+        ChunkCodec codec;
+    };
+
+    namespace compressed_column {
+        template <typename T>
+        struct supports_bitpacking : std::integral_constant<bool, std::is_integral<T>::value && sizeof(T) <= 4> {};
+
+        /** Maximum bit width that can be extracted with a single unaligned 64 bit load */
+        static constexpr uint8_t maxPackedBitWidth = 56;
+
+        template <typename T>
+        void appendValue(std::vector<char> &out, const T &value) {
+            auto data = reinterpret_cast<const char *>(&value);
+            out.insert(out.end(), data, data + sizeof(T));
+        }
+
+        template <typename T>
+        std::vector<char> encodeRunLength(const T *values, uint32_t count) {
+            std::vector<char> out;
+            uint32_t i = 0;
+            while (i < count) {
+                uint32_t runLength = 1;
+                while (i + runLength < count && std::memcmp(&values[i + runLength], &values[i], sizeof(T)) == 0) {
+                    runLength++;
+                }
+                appendValue(out, runLength);
+                appendValue(out, values[i]);
+                i += runLength;
+            }
+            return out;
+        }
+
+        template <typename T>
+        void decodeRunLength(const char *in, uint32_t size, T *out) {
+            const char *end = in + size;
+            while (in < end) {
+                uint32_t runLength;
+                T value;
+                std::memcpy(&runLength, in, sizeof(runLength));
+                std::memcpy(&value, in + sizeof(runLength), sizeof(T));
+                in += sizeof(runLength) + sizeof(T);
+                std::fill(out, out + runLength, value);
+                out += runLength;
+            }
+        }
+
+        template <typename T, std::enable_if_t<supports_bitpacking<T>::value, int> = 0>
+        std::vector<char> encodeBitPacked(const T *values, uint32_t count) {
+            auto minMax = std::minmax_element(values, values + count);
+            auto base = static_cast<int64_t>(*minMax.first);
+            auto range = static_cast<uint64_t>(static_cast<int64_t>(*minMax.second) - base);
+            uint8_t bitWidth = 0;
+            while (bitWidth < 64 && (range >> bitWidth) != 0) {
+                bitWidth++;
+            }
+            if (bitWidth > maxPackedBitWidth) {
+                return {};
+            }
+            std::vector<char> out;
+            appendValue(out, base);
+            appendValue(out, bitWidth);
+            auto headerSize = out.size();
+            // Trailing padding lets the decoder always perform full 8 byte loads
+            out.resize(headerSize + (static_cast<size_t>(count) * bitWidth + 7) / 8 + sizeof(uint64_t), 0);
+            auto packed = reinterpret_cast<unsigned char *>(out.data() + headerSize);
+            for (uint32_t i = 0; i < count; i++) {
+                auto delta = static_cast<uint64_t>(static_cast<int64_t>(values[i]) - base);
+                uint64_t bitPos = static_cast<uint64_t>(i) * bitWidth;
+                for (uint8_t bit = 0; bit < bitWidth; bit++, bitPos++) {
+                    if ((delta >> bit) & 1) {
+                        packed[bitPos / 8] |= static_cast<unsigned char>(1u << (bitPos % 8));
+                    }
+                }
+            }
+            return out;
+        }
+
+        template <typename T, std::enable_if_t<!supports_bitpacking<T>::value, int> = 0>
+        std::vector<char> encodeBitPacked(const T *, uint32_t) {
+            return {};
+        }
+
+        template <typename T, std::enable_if_t<supports_bitpacking<T>::value, int> = 0>
+        void decodeBitPacked(const char *in, uint32_t count, T *out) {
+            int64_t base;
+            uint8_t bitWidth;
+            std::memcpy(&base, in, sizeof(base));
+            std::memcpy(&bitWidth, in + sizeof(base), sizeof(bitWidth));
+            const char *packed = in + sizeof(base) + sizeof(bitWidth);
+            uint64_t mask = bitWidth == 0 ? 0 : ((uint64_t{1} << bitWidth) - 1);
+            for (uint32_t i = 0; i < count; i++) {
+                uint64_t bitPos = static_cast<uint64_t>(i) * bitWidth;
+                uint64_t word;
+                std::memcpy(&word, packed + bitPos / 8, sizeof(word));
+                out[i] = static_cast<T>(base + static_cast<int64_t>((word >> (bitPos % 8)) & mask));
+            }
+        }
+
+        template <typename T, std::enable_if_t<!supports_bitpacking<T>::value, int> = 0>
+        void decodeBitPacked(const char *, uint32_t, T *) {
+            throw std::runtime_error("Bit packed chunk found for non-integral column");
+        }
+    } // namespace compressed_column
+
+    /** Implements a read-only, chunk compressed version of a FixedSizeFileMapper column
+     *
+     * File: <name>_compressed.dat
+     * Raw data format: [<CompressedColumnHeader>, <CompressedChunkInfo> * chunkCount, <chunk payloads>]
+     *
+     * Elements are grouped into chunks of chunkSize elements and every chunk is encoded with the codec that
+     * produces the smallest result. Chunks are decoded on first access into a lazily populated anonymous mapping,
+     * so pointers handed out stay valid for the lifetime of the mapper (TxData holds raw pointers into these columns)
+     * while untouched chunks cost neither page cache nor resident memory.
+     */
+    template <typename T>
+    class CompressedFileMapper {
+        static_assert(std::is_trivially_copyable<T>::value, "Compressed columns require trivially copyable elements");
+
+        SimpleFileMapper<mio::access_mode::read> file;
+        CompressedColumnHeader header{};
+        const CompressedChunkInfo *chunks = nullptr;
+
+        T *decoded = nullptr;
+        size_t decodedLength = 0;
+        std::unique_ptr<std::atomic<bool>[]> chunkDecoded;
+        std::mutex decodeMutex;
+
+        void unmapDecoded() {
+            if (decoded != nullptr) {
+                munmap(decoded, decodedLength);
+                decoded = nullptr;
+                decodedLength = 0;
+            }
+        }
+
+        void setup() {
+            unmapDecoded();
+            chunks = nullptr;
+            header = CompressedColumnHeader{};
+            if (!file.isGood() || file.size() < static_cast<OffsetType>(sizeof(CompressedColumnHeader))) {
+                return;
+            }
+            std::memcpy(&header, file.getDataAtOffset(0), sizeof(header));
+            if (header.magic != compressedColumnMagic || header.elementSize != sizeof(T)) {
+                throw std::runtime_error("Compressed column file has an invalid header");
+            }
+            chunks = reinterpret_cast<const CompressedChunkInfo *>(file.getDataAtOffset(sizeof(CompressedColumnHeader)));
+            chunkDecoded = std::make_unique<std::atomic<bool>[]>(header.chunkCount);
+            for (uint64_t i = 0; i < header.chunkCount; i++) {
+                chunkDecoded[i] = false;
+            }
+            if (header.elementCount > 0) {
+                decodedLength = header.elementCount * sizeof(T);
+                auto mapping = mmap(nullptr, decodedLength, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+                if (mapping == MAP_FAILED) {
+                    decodedLength = 0;
+                    throw std::runtime_error("Could not reserve memory for compressed column");
+                }
+                decoded = static_cast<T *>(mapping);
+            }
+        }
+
+        void decodeChunk(uint64_t chunkNum) {
+            std::lock_guard<std::mutex> lock(decodeMutex);
+            if (chunkDecoded[chunkNum].load(std::memory_order_relaxed)) {
+                return;
+            }
+            const auto &chunk = chunks[chunkNum];
+            auto firstElement = chunkNum * header.chunkSize;
+            auto count = static_cast<uint32_t>(std::min<uint64_t>(header.chunkSize, header.elementCount - firstElement));
+            auto in = file.getDataAtOffset(static_cast<OffsetType>(chunk.offset));
+            auto out = decoded + firstElement;
+            switch (chunk.codec) {
+                case ChunkCodec::Raw:
+                    std::memcpy(out, in, static_cast<size_t>(count) * sizeof(T));
+                    break;
+                case ChunkCodec::RunLength:
+                    compressed_column::decodeRunLength(in, chunk.size, out);
+                    break;
+                case ChunkCodec::BitPacked:
+                    compressed_column::decodeBitPacked(in, count, out);
+                    break;
+                default:
+                    throw std::runtime_error("Compressed column contains chunk with unknown codec");
+            }
+            chunkDecoded[chunkNum].store(true, std::memory_order_release);
+        }
+
+        void ensureDecoded(OffsetType index, OffsetType count) {
+            auto firstChunk = static_cast<uint64_t>(index) / header.chunkSize;
+            auto lastChunk = static_cast<uint64_t>(index + std::max<OffsetType>(count, 1) - 1) / header.chunkSize;
+            for (auto chunkNum = firstChunk; chunkNum <= lastChunk && chunkNum < header.chunkCount; chunkNum++) {
+                if (!chunkDecoded[chunkNum].load(std::memory_order_acquire)) {
+                    decodeChunk(chunkNum);
+                }
+            }
+        }
+
+    public:
+        explicit CompressedFileMapper(const filesystem::path &path) : file(path) {
+            setup();
+        }
+
+        CompressedFileMapper(const CompressedFileMapper &) = delete;
+        CompressedFileMapper &operator=(const CompressedFileMapper &) = delete;
+
+        ~CompressedFileMapper() {
+            unmapDecoded();
+        }
+
+        bool isGood() const {
+            return decoded != nullptr;
+        }
+
+        OffsetType size() const {
+            return static_cast<OffsetType>(header.elementCount);
+        }
+
+        /** Pointer to the element at index, decoding its chunk if necessary */
+        const T *operator[](OffsetType index) {
+            return getRange(index, 1);
+        }
+
+        /** Pointer to the elements [index, index + count), decoding every chunk they overlap */
+        const T *getRange(OffsetType index, OffsetType count) {
+            assert(index < size());
+            ensureDecoded(index, count);
+            return decoded + index;
+        }
+
+        void advise(AccessHint hint) {
+            file.advise(hint);
+        }
+
+        void reload() {
+            auto oldCount = header.elementCount;
+            file.reload();
+            if (!file.isGood() || file.size() < static_cast<OffsetType>(sizeof(CompressedColumnHeader))) {
+                setup();
+                return;
+            }
+            CompressedColumnHeader newHeader;
+            std::memcpy(&newHeader, file.getDataAtOffset(0), sizeof(newHeader));
+            if (newHeader.elementCount != oldCount) {
+                setup();
+            } else {
+                chunks = reinterpret_cast<const CompressedChunkInfo *>(file.getDataAtOffset(sizeof(CompressedColumnHeader)));
+            }
+        }
+    };
+
+    /** Path of the compressed version of the FixedSizeFileMapper column at path */
+    inline filesystem::path compressedColumnPath(const filesystem::path &path) {
+        return path.str() + "_compressed";
+    }
+
+    /** Writes a compressed copy of the FixedSizeFileMapper column at sourcePath to compressedColumnPath(sourcePath)
+     *
+     * Returns the size of the compressed file in bytes.
+     */
+    template <typename T>
+    OffsetType compressColumn(const filesystem::path &sourcePath, uint32_t chunkSize = defaultCompressedChunkSize) {
+        FixedSizeFileMapper<T> source(sourcePath);
+        CompressedColumnHeader header{};
+        header.magic = compressedColumnMagic;
+        header.elementSize = sizeof(T);
+        header.chunkSize = chunkSize;
+        header.elementCount = static_cast<uint64_t>(source.size());
+        header.chunkCount = (header.elementCount + chunkSize - 1) / chunkSize;
+
+        std::vector<CompressedChunkInfo> chunkInfos;
+        chunkInfos.reserve(header.chunkCount);
+
+        auto outputPath = compressedColumnPath(sourcePath).str() + ".dat";
+        std::ofstream out(outputPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Could not open " + outputPath + " for writing");
+        }
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        std::vector<CompressedChunkInfo> placeholder(header.chunkCount);
+        out.write(reinterpret_cast<const char *>(placeholder.data()), static_cast<std::streamsize>(placeholder.size() * sizeof(CompressedChunkInfo)));
+
+        uint64_t offset = sizeof(header) + placeholder.size() * sizeof(CompressedChunkInfo);
+        for (uint64_t chunkNum = 0; chunkNum < header.chunkCount; chunkNum++) {
+            auto firstElement = chunkNum * chunkSize;
+            auto count = static_cast<uint32_t>(std::min<uint64_t>(chunkSize, header.elementCount - firstElement));
+            const T *values = source[static_cast<OffsetType>(firstElement)];
+
+            auto payload = compressed_column::encodeRunLength(values, count);
+            auto codec = ChunkCodec::RunLength;
+            auto packed = compressed_column::encodeBitPacked(values, count);
+            if (!packed.empty() && packed.size() < payload.size()) {
+                payload = std::move(packed);
+                codec = ChunkCodec::BitPacked;
+            }
+            if (payload.size() >= static_cast<size_t>(count) * sizeof(T)) {
+                auto raw = reinterpret_cast<const char *>(values);
+                payload.assign(raw, raw + static_cast<size_t>(count) * sizeof(T));
+                codec = ChunkCodec::Raw;
+            }
+            // Keep payloads 8 byte aligned
+            payload.resize((payload.size() + 7) / 8 * 8, 0);
+            chunkInfos.push_back({offset, static_cast<uint32_t>(payload.size()), codec});
+            out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+            offset += payload.size();
+        }
+
+        out.seekp(sizeof(header));
+        out.write(reinterpret_cast<const char *>(chunkInfos.data()), static_cast<std::streamsize>(chunkInfos.size() * sizeof(CompressedChunkInfo)));
+        return static_cast<OffsetType>(offset);
+    }
+
+    /** Column of fixed-size elements that is read from its compressed copy when one is enabled and available
+     *
+     * The raw file is still required since the parser only ever appends to it. Elements past the end of
+     * the compressed copy (eg. added by a later parser run) are served from the raw file.
+     */
+    template <typename T>
+    class ColumnFileMapper {
+        FixedSizeFileMapper<T> rawFile;
+        std::unique_ptr<CompressedFileMapper<T>> compressedFile;
+
+    public:
+        ColumnFileMapper(const filesystem::path &path, bool useCompressed) : rawFile(path) {
+            if (useCompressed) {
+                auto compressedPath = compressedColumnPath(path);
+                if (filesystem::path{compressedPath.str() + ".dat"}.exists()) {
+                    compressedFile = std::make_unique<CompressedFileMapper<T>>(compressedPath);
+                }
+            }
+        }
+
+        bool isCompressed() const {
+            return compressedFile && compressedFile->isGood();
+        }
+
+        const T *operator[](OffsetType index) const {
+            return getRange(index, 1);
+        }
+
+        /** Pointer to the elements [index, index + count) which are guaranteed to be contiguous in memory */
+        const T *getRange(OffsetType index, OffsetType count) const {
+            if (isCompressed() && index < compressedFile->size()) {
+                return compressedFile->getRange(index, count);
+            }
+            return rawFile[index];
+        }
+
+        OffsetType size() const {
+            return std::max(rawFile.size(), isCompressed() ? compressedFile->size() : 0);
+        }
+
+        /** The uncompressed file, which always holds every element unless it was deleted after compression */
+        const FixedSizeFileMapper<T> &getRawFile() const {
+            return rawFile;
+        }
+
+        void advise(AccessHint hint) {
+            rawFile.advise(hint);
+            if (compressedFile) {
+                compressedFile->advise(hint);
+            }
+        }
+
+        void reload() {
+            rawFile.reload();
+            if (compressedFile) {
+                compressedFile->reload();
+            }
+        }
+    };
+} // namespace blocksci
+
+#endif /* compressed_file_mapper_hpp */
@@ -0,0 +1,135 @@
+//
+//  concurrent_disjoint_sets.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_concurrent_disjoint_sets_hpp
+#define blocksci_concurrent_disjoint_sets_hpp
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace blocksci {
+
+    /** Union-find over the elements [0, size) that any number of threads can update concurrently without locks
+     *
+     * Sets are linked by index: unite() always attaches the root with the larger index below the root with the smaller
+     * one, and find() uses path splitting, pointing every visited element at its grandparent. Both only ever replace a
+     * parent with a smaller index, so parent[x] <= x holds at all times and no interleaving of updates can create a
+     * cycle. This also makes every individual load and CAS correct with relaxed memory order: a stale parent is still
+     * an ancestor, and a failed CAS only means that another thread made progress.
+     *
+     * find() is wait-free, each step moves to a strictly smaller index. unite() is lock-free, it only retries when
+     * another thread changed one of the two roots in between. Results read after all updating threads have been
+     * joined are exact.
+     */
+    class ConcurrentDisjointSets {
+        std::unique_ptr<std::atomic<uint32_t>[]> parents;
+        uint32_t elementCount;
+
+    public:
+        explicit ConcurrentDisjointSets(uint32_t size) : parents(std::make_unique<std::atomic<uint32_t>[]>(size)), elementCount(size) {
+            for (uint32_t i = 0; i < size; i++) {
+                parents[i].store(i, std::memory_order_relaxed);
+            }
+        }
+
+        /** Continue from the given parents, which must link every element to itself or to a smaller index
+         *
+         * Used to extend the roots of a previous run with more elements and links. */
+        explicit ConcurrentDisjointSets(const std::vector<uint32_t> &initialParents) : parents(std::make_unique<std::atomic<uint32_t>[]>(initialParents.size())), elementCount(static_cast<uint32_t>(initialParents.size())) {
+            for (uint32_t i = 0; i < elementCount; i++) {
+                assert(initialParents[i] <= i);
+                parents[i].store(initialParents[i], std::memory_order_relaxed);
+            }
+        }
+
+        uint32_t size() const {
+            return elementCount;
+        }
+
+        /** Root of the set containing x */
+        uint32_t find(uint32_t x) {
+            while (true) {
+                auto parent = parents[x].load(std::memory_order_relaxed);
+                auto grandParent = parents[parent].load(std::memory_order_relaxed);
+                if (parent == grandParent) {
+                    return parent;
+                }
+                // Path splitting, losing the race to another update is harmless
+                parents[x].compare_exchange_weak(parent, grandParent, std::memory_order_relaxed);
+                x = grandParent;
+            }
+        }
+
+        void unite(uint32_t a, uint32_t b) {
+            while (true) {
+                a = find(a);
+                b = find(b);
+                if (a == b) {
+                    return;
+                }
+                if (a < b) {
+                    std::swap(a, b);
+                }
+                // a is only linked if it is still a root
+                auto expected = a;
+                if (parents[a].compare_exchange_strong(expected, b, std::memory_order_relaxed)) {
+                    return;
+                }
+            }
+        }
+    };
+
+    /** Per-thread buffer of pairs to unite in a ConcurrentDisjointSets
+     *
+     * Uniting every pair as it is found makes the threads contend on the cache lines of popular elements, for example
+     * the roots of large clusters. Buffered pairs are sorted before they are applied, so that a flush walks the
+     * parent array roughly in order and repeated pairs hit the same cache lines back to back.
+     */
+    class DisjointSetsBatch {
+        ConcurrentDisjointSets &sets;
+        std::vector<std::pair<uint32_t, uint32_t>> pairs;
+        size_t batchSize;
+
+    public:
+        explicit DisjointSetsBatch(ConcurrentDisjointSets &sets_, size_t batchSize_ = size_t{1} << 16) : sets(sets_), batchSize(batchSize_) {
+            pairs.reserve(batchSize);
+        }
+
+        DisjointSetsBatch(const DisjointSetsBatch &) = delete;
+        DisjointSetsBatch &operator=(const DisjointSetsBatch &) = delete;
+
+        ~DisjointSetsBatch() {
+            flush();
+        }
+
+        void add(uint32_t a, uint32_t b) {
+            if (a == b) {
+                return;
+            }
+            pairs.emplace_back(std::min(a, b), std::max(a, b));
+            if (pairs.size() >= batchSize) {
+                flush();
+            }
+        }
+
+        void flush() {
+            std::sort(pairs.begin(), pairs.end());
+            pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+            for (auto &pair : pairs) {
+                sets.unite(pair.first, pair.second);
+            }
+            pairs.clear();
+        }
+    };
+} // namespace blocksci
+
+#endif /* blocksci_concurrent_disjoint_sets_hpp */
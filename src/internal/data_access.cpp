@@ -8,30 +8,230 @@
 
 #include "data_access.hpp"
 #include "chain_access.hpp"
+#include "chain_manifest.hpp"
+#include "file_checksums.hpp"
 #include "script_access.hpp"
 #include "address_index.hpp"
 #include "hash_index.hpp"
+#include "memory_budget.hpp"
 #include "mempool_index.hpp"
+#include "nulldata_prefix_index.hpp"
+#include "object_store.hpp"
+#include "remote_data.hpp"
+#include "snapshot_archive.hpp"
+#include "tx_feature_table.hpp"
+#include "derived_column_store.hpp"
+
+#include <rocksdb/cache.h>
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 namespace blocksci {
     
+    namespace {
+        /** Manifest entry of the snapshot the configuration pins the chain to */
+        ranges::optional<ChainManifestEntry> pinnedSnapshot(const DataConfiguration &config) {
+            if (config.snapshotVersion == 0) {
+                return ranges::nullopt;
+            }
+            auto entry = ChainManifest{config.chainDirectory()}.find(config.snapshotVersion);
+            if (!entry) {
+                throw std::invalid_argument("Snapshot " + std::to_string(config.snapshotVersion) + " of the chain does not exist or has been rolled back");
+            }
+            return entry;
+        }
+        
+        /** Check the last chunks of the data files against their checksums, @see DataConfiguration::checksumTailChunks */
+        void verifyChecksumTails(const DataConfiguration &config) {
+            std::vector<ChecksumMismatch> mismatches;
+            for (auto &directory : {config.chainDirectory(), config.scriptsDirectory()}) {
+                auto directoryMismatches = verifyDirectoryChecksums(directory, config.checksumTailChunks);
+                mismatches.insert(mismatches.end(), directoryMismatches.begin(), directoryMismatches.end());
+            }
+            if (!mismatches.empty()) {
+                std::string message = "Data files don't match their checksums, the parser might have been interrupted while writing them:";
+                for (auto &mismatch : mismatches) {
+                    message += " " + mismatch.path.str();
+                }
+                throw std::runtime_error(message);
+            }
+        }
+        
+        /** Source the data directory is copied from, nullptr if it is local */
+        std::shared_ptr<const RemoteFiles> remoteSource(const DataConfiguration &config) {
+            if (config.objectStore.isSet()) {
+                return std::make_shared<const ObjectStore>(config.objectStore);
+            } else if (config.archive.isSet()) {
+                return std::make_shared<const SnapshotArchive>(config.archive.directory, config.archive.snapshot, config.archive.readers);
+            }
+            return nullptr;
+        }
+        
+        /** Copy the files of the data directory with the given prefixes from object storage or a snapshot archive if it
+         * is stored there */
+        void hydrateRemote(const DataConfiguration &config, const std::vector<std::string> &keyPrefixes) {
+            if (auto source = remoteSource(config)) {
+                hydrateDataDirectory(config.chainConfig.dataDirectory, *source, keyPrefixes);
+            }
+        }
+        
+        /** Files opened together with the chain, the indexes are copied when they are first used */
+        const std::vector<std::string> &chainKeyPrefixes() {
+            static const std::vector<std::string> prefixes = {"chain/", "scripts/", "derivedColumns/"};
+            return prefixes;
+        }
+        
+        DataConfiguration hydratedChain(DataConfiguration config) {
+            hydrateRemote(config, chainKeyPrefixes());
+            return config;
+        }
+        
+        LazyIndex<NulldataPrefixIndex> lazyNulldataIndex(const DataConfiguration &config) {
+            auto directory = config.nulldataIndexDirectory();
+            return LazyIndex<NulldataPrefixIndex>{[config, directory]() {
+                hydrateRemote(config, {"nulldataIndex/"});
+                return std::make_unique<NulldataPrefixIndex>(directory);
+            }};
+        }
+        
+        LazyIndex<TxFeatureTable> lazyTxFeatures(const DataConfiguration &config, const ChainAccess *chain) {
+            auto directory = config.txFeaturesDirectory();
+            return LazyIndex<TxFeatureTable>{[config, directory, chain]() {
+                hydrateRemote(config, {"txFeatures/"});
+                return std::make_unique<TxFeatureTable>(directory, *chain);
+            }};
+        }
+        
+        BlockHeight loadedBlockLimit(const DataConfiguration &config) {
+            auto snapshot = pinnedSnapshot(config);
+            return snapshot ? static_cast<BlockHeight>(snapshot->blockCount) : config.blocksIgnored;
+        }
+    }
+    
     DataAccess::DataAccess() = default;
 
     DataAccess::DataAccess(DataConfiguration config_) :
-    config(std::move(config_)),
-    chain{std::make_unique<ChainAccess>(config.chainDirectory(), config.blocksIgnored, config.errorOnReorg)},
+    config(hydratedChain(std::move(config_))),
+    chain{std::make_unique<ChainAccess>(config.chainDirectory(), loadedBlockLimit(config), config.errorOnReorg, config.compressedChainColumns)},
     scripts{std::make_unique<ScriptAccess>(config.scriptsDirectory())},
-    addressIndex{std::make_unique<AddressIndex>(config.addressDBFilePath(), true)},
-    hashIndex{std::make_unique<HashIndex>(config.hashIndexFilePath(), true)},
-    mempoolIndex{std::make_unique<MempoolIndex>(config.mempoolDirectory())} {}
+    derivedColumns{std::make_unique<DerivedColumnStore>(config.derivedColumnsDirectory())} {
+        if (auto source = remoteSource(config)) {
+            auto cacheBudget = config.objectStore.isSet() ? config.objectStore.cacheBudget : config.archive.cacheBudget;
+            auto pageSize = source->rangeSize();
+            chain->useRemoteTxData(PagedFileRemote{std::move(source), lazyRemoteFile, cacheBudget}, pageSize);
+        }
+        // Remote copies are only checked against the sizes of their objects, their tx_data.dat consists of holes until
+        // it is read
+        if (config.checksumTailChunks > 0 && !config.isRemote()) {
+            verifyChecksumTails(config);
+        }
+        // The indexes only capture the configuration and the chain, which stays in place when the DataAccess is moved
+        auto indexConfig = config;
+        auto chainPtr = chain.get();
+        addressIndex = LazyIndex<AddressIndex>{[indexConfig]() {
+            hydrateRemote(indexConfig, {"addressesDb/", "addressTables/"});
+            std::shared_ptr<rocksdb::Cache> blockCache;
+            if (indexConfig.sharedIndexCacheSize > 0) {
+                blockCache = sharedBlockCache(indexConfig.sharedIndexCacheSize);
+            } else if (indexConfig.addressIndexTuning.cacheSize > 0) {
+                blockCache = rocksdb::NewLRUCache(indexConfig.addressIndexTuning.cacheSize);
+            } else if (indexConfig.addressIndexCacheSize > 0) {
+                blockCache = rocksdb::NewLRUCache(indexConfig.addressIndexCacheSize);
+            }
+            auto index = std::make_unique<AddressIndex>(indexConfig.addressDBFilePath(), indexConfig.indexOpenMode, std::move(blockCache), indexConfig.addressIndexTuning);
+            index->useAddressTables(indexConfig.addressTablesDirectory());
+            return index;
+        }};
+        hashIndex = LazyIndex<HashIndex>{[indexConfig, chainPtr]() {
+            hydrateRemote(indexConfig, {"hashIndex/", "txHashTable.dat"});
+            std::shared_ptr<rocksdb::Cache> blockCache;
+            if (indexConfig.sharedIndexCacheSize > 0) {
+                blockCache = sharedBlockCache(indexConfig.sharedIndexCacheSize);
+            } else if (indexConfig.hashIndexTuning.cacheSize > 0) {
+                blockCache = rocksdb::NewLRUCache(indexConfig.hashIndexTuning.cacheSize);
+            }
+            auto index = std::make_unique<HashIndex>(indexConfig.hashIndexFilePath(), indexConfig.indexOpenMode, std::move(blockCache), indexConfig.hashIndexTuning);
+            // The table can cover transactions that a reorganization since removed from the chain
+            index->useTxHashTable(indexConfig.txHashTableFilePath(), [chainPtr](uint32_t txNum) -> const uint256 * {
+                return txNum < chainPtr->txCount() ? chainPtr->getTxHash(txNum) : nullptr;
+            });
+            return index;
+        }};
+        auto mempoolDirectory = config.mempoolDirectory();
+        mempoolIndex = LazyIndex<MempoolIndex>{[indexConfig, mempoolDirectory]() {
+            hydrateRemote(indexConfig, {"mempool/"});
+            return std::make_unique<MempoolIndex>(mempoolDirectory);
+        }};
+        nulldataIndex = lazyNulldataIndex(config);
+        txFeatures = lazyTxFeatures(config, chainPtr);
+        if (auto snapshot = pinnedSnapshot(config)) {
+            if (chain->blockCount() != static_cast<BlockHeight>(snapshot->blockCount) || chain->txCount() != snapshot->txCount || !(*chain->getBlock(chain->blockCount() - 1)->hash == snapshot->tipHash)) {
+                throw ReorgException();
+            }
+            scripts->pinScriptCounts(snapshot->scriptCounts);
+        }
+        if (config.readBackend == ReadBackend::Paged && !config.isRemote()) {
+            chain->usePagedTxData();
+        }
+        for (const auto &hint : config.chainAccessHints) {
+            chain->advise(hint.first, hint.second);
+        }
+        if (config.residentMode) {
+            makeResident(config.lockTxData, config.residentNumaPlacement);
+        }
+    }
     
     DataAccess::DataAccess(DataAccess &&) = default;
     DataAccess &DataAccess::operator=(DataAccess &&) = default;
     DataAccess::~DataAccess() = default;
 
+    ResidentMemoryStats DataAccess::makeResident(bool lockTxData, NumaPlacement placement) {
+        residentMemory = chain->makeResident(true, lockTxData, placement);
+        return residentMemory;
+    }
+
+    void DataAccess::resetTxFeatures() {
+        txFeatures = lazyTxFeatures(config, chain.get());
+    }
+
     void DataAccess::reload() {
+        // A pinned snapshot never changes, open the chain at a newer version to see new blocks
+        if (config.snapshotVersion != 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(*reloadMutex);
+        hydrateRemote(config, chainKeyPrefixes());
         chain->reload();
         scripts->reload();
-        mempoolIndex->reload();
+        derivedColumns->reload();
+        // Indexes that aren't open yet will see the current state once they are opened
+        if (auto index = mempoolIndex.getIfOpen()) {
+            index->reload();
+        }
+        // Updates replace the index files instead of writing to them
+        if (nulldataIndex.getIfOpen()) {
+            nulldataIndex = lazyNulldataIndex(config);
+        }
+        if (txFeatures.getIfOpen()) {
+            resetTxFeatures();
+        }
+        if (auto index = addressIndex.getIfOpen()) {
+            index->catchUpWithPrimary();
+            index->useAddressTables(config.addressTablesDirectory());
+        }
+        if (auto index = hashIndex.getIfOpen()) {
+            index->catchUpWithPrimary();
+            auto chainPtr = chain.get();
+            index->useTxHashTable(config.txHashTableFilePath(), [chainPtr](uint32_t txNum) -> const uint256 * {
+                return txNum < chainPtr->txCount() ? chainPtr->getTxHash(txNum) : nullptr;
+            });
+        }
+        // New blocks grow the mappings and fill the caches of a long running process
+        if (config.memoryBudget > 0) {
+            enforceMemoryBudget(*this, config.memoryBudget);
+        }
     }
 }
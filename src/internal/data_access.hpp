@@ -10,8 +10,12 @@
 #define data_access_hpp
 
 #include "data_configuration.hpp"
+#include "lazy_index.hpp"
+
+#include <blocksci/chain/work_pool.hpp>
 
 #include <memory>
+#include <mutex>
 
 namespace blocksci {
     class ChainAccess;
@@ -19,6 +23,9 @@ namespace blocksci {
     class AddressIndex;
     class HashIndex;
     class MempoolIndex;
+    class NulldataPrefixIndex;
+    class TxFeatureTable;
+    class DerivedColumnStore;
 
     /** This class wraps and manages all data and index access classes
      *     - ChainAccess: Provides data access for blocks, transactions, inputs, and outputs
@@ -26,6 +33,10 @@ namespace blocksci {
      *     - AddressIndex: Provides data access to address indexes (RocksDB database)
      *     - HashIndex: Provides data access to hash indexes (RocksDB database)
      *     - MempoolIndex: Provides data access to the mempool index (when a transaction has been first seen)
+     *     - NulldataPrefixIndex: Provides lookups of OP_RETURN outputs by payload prefix (optional)
+     *     - TxFeatureTable: Provides the precomputed results of the transaction classifiers (optional)
+     *     - DerivedColumnStore: Provides user defined columns computed from the chain (optional)
+     *     - WorkPool: Runs the chunks of BlockRange::mapReduce
      *
      *     - DataConfiguration: Loads and holds blockchain configuration files, needed to load blockchains
      */
@@ -61,23 +72,64 @@ namespace blocksci {
          * is used in as well as information about how different addresses relate to each other.
          *
          * Directory: addressesDb/
+         *
+         * Opened on first use, @see getAddressIndex()
          */
-        std::unique_ptr<AddressIndex> addressIndex;
+        LazyIndex<AddressIndex> addressIndex;
 
         /** Provides access to hash indexes (RocksDB database)
          *
          * This RocksDB database is a lookup table from tx hash and address hash to internal BlockSci index for those objects.
          *
          * Directory: hashIndex/
+         *
+         * Opened on first use, @see getHashIndex()
          */
-        std::unique_ptr<HashIndex> hashIndex;
+        LazyIndex<HashIndex> hashIndex;
 
         /** Provides access to the mempool index, which stores the timestamp of when a transaction has been
          * first seen. Only relevant when BlockSci's mempool_recorder is enabled (= running).
          *
          * Directory: mempool/
+         *
+         * Opened on first use, @see getMempoolIndex()
+         */
+        LazyIndex<MempoolIndex> mempoolIndex;
+        
+        /** Provides lookups of nulldata scripts by the prefix of their payload. Only filled if the index was built
+         * with blocksci_parser build-nulldata-index.
+         *
+         * Directory: nulldataIndex/
+         *
+         * Opened on first use, @see getNulldataIndex()
+         */
+        LazyIndex<NulldataPrefixIndex> nulldataIndex;
+        
+        /** Provides the results of the tx_identification heuristics for every transaction. Only filled if the table was
+         * built with heuristics::buildTxFeatureTable.
+         *
+         * Directory: txFeatures/
+         *
+         * Opened on first use, @see getTxFeatures()
+         */
+        LazyIndex<TxFeatureTable> txFeatures;
+        
+        /** Holds the derived columns registered in this process and maps the stored ones, which are built and extended
+         * with Blockchain::updateDerivedColumns.
+         *
+         * Directory: derivedColumns/
          */
-        std::unique_ptr<MempoolIndex> mempoolIndex;
+        std::unique_ptr<DerivedColumnStore> derivedColumns;
+        
+        /** Memory held in resident mode, see ChainAccess::makeResident */
+        ResidentMemoryStats residentMemory;
+        
+        /** Threads running BlockRange::mapReduce, started on first use with the settings of parallelConfig */
+        LazyIndex<WorkPool> workPool{[]() { return std::make_unique<WorkPool>(ParallelConfig{}); }};
+        ParallelConfig parallelConfig;
+        
+        /** Serializes reload(), which the Blockchains sharing this instance can call from different threads */
+        std::unique_ptr<std::mutex> reloadMutex = std::make_unique<std::mutex>();
         
         DataAccess();
         explicit DataAccess(DataConfiguration config_);
@@ -94,20 +146,45 @@ namespace blocksci {
         }
 
         const MempoolIndex &getMempoolIndex() const {
-            return *mempoolIndex;
+            return mempoolIndex.get();
+        }
+        
+        const NulldataPrefixIndex &getNulldataIndex() const {
+            return nulldataIndex.get();
+        }
+        
+        const TxFeatureTable &getTxFeatures() const {
+            return txFeatures.get();
         }
+        
+        /** Close the tx feature table, it is mapped again from the current files on next use */
+        void resetTxFeatures();
 
-        AddressIndex &getAddressIndex() {
-            return *addressIndex;
+        AddressIndex &getAddressIndex() const {
+            return addressIndex.get();
         }
 
-        HashIndex &getHashIndex() {
-            return *hashIndex;
+        HashIndex &getHashIndex() const {
+            return hashIndex.get();
+        }
+        
+        WorkPool &getWorkPool() const {
+            return workPool.get();
+        }
+        
+        /** Replace the work pool, must not be called while a mapReduce on this chain is running */
+        void setParallelConfig(const ParallelConfig &config_) {
+            parallelConfig = config_;
+            workPool = LazyIndex<WorkPool>{[config_]() { return std::make_unique<WorkPool>(config_); }};
         }
         
         operator DataConfiguration() const { return config; }
         
+        /** Catch up with the parser. Every Blockchain sharing this instance (@see sharedDataAccess) sees the new data, but
+         * keeps its block count until it reloads itself */
         void reload();
+        
+        ResidentMemoryStats makeResident(bool lockTxData, NumaPlacement placement = NumaPlacement::Default);
     };
 }
 
@@ -10,18 +10,217 @@
 
 #include <nlohmann/json.hpp>
 
+#include <algorithm>
 #include <fstream>
 
 using json = nlohmann::json;
 
 namespace blocksci {
     
+    namespace {
+        ChainColumn chainColumnFromString(const std::string &name) {
+            static const std::map<std::string, ChainColumn> columns = {
+                {"block", ChainColumn::Block},
+                {"coinbases", ChainColumn::Coinbase},
+                {"tx_data", ChainColumn::TxData},
+                {"tx_index", ChainColumn::TxIndex},
+                {"tx_version", ChainColumn::TxVersion},
+                {"firstInput", ChainColumn::FirstInput},
+                {"firstOutput", ChainColumn::FirstOutput},
+                {"input_out_num", ChainColumn::InputSpentOutNum},
+                {"sequence", ChainColumn::Sequence},
+                {"tx_hashes", ChainColumn::TxHashes},
+                {"output_value", ChainColumn::OutputValue},
+                {"output_type", ChainColumn::OutputType},
+                {"output_address", ChainColumn::OutputAddress},
+                {"output_spent_tx", ChainColumn::OutputSpentTx},
+                {"output_spending_input", ChainColumn::OutputSpendingInput},
+                {"output_spending_height", ChainColumn::OutputSpendingHeight},
+                {"tx_fee", ChainColumn::TxFee},
+                {"tx_vsize", ChainColumn::TxVirtualSize},
+                {"input_spent_height", ChainColumn::InputSpentHeight},
+                {"input_spent_value", ChainColumn::InputSpentValue},
+                {"block_stats", ChainColumn::BlockStats},
+                {"tx_package_flags", ChainColumn::TxPackageFlags}
+            };
+            auto it = columns.find(name);
+            if (it == columns.end()) {
+                throw std::runtime_error("Unknown chain file in accessHints: " + name);
+            }
+            return it->second;
+        }
+        
+        AccessHint accessHintFromString(const std::string &name) {
+            static const std::map<std::string, AccessHint> hints = {
+                {"normal", AccessHint::Normal},
+                {"sequential", AccessHint::Sequential},
+                {"random", AccessHint::Random},
+                {"willneed", AccessHint::WillNeed},
+                {"dontneed", AccessHint::DontNeed},
+                {"hugepage", AccessHint::HugePage}
+            };
+            auto it = hints.find(name);
+            if (it == hints.end()) {
+                throw std::runtime_error("Unknown access hint: " + name);
+            }
+            return it->second;
+        }
+    }
+    
+    IndexTuning loadIndexTuning(const json &jsonTuning) {
+        IndexTuning tuning;
+        auto blockSizeIt = jsonTuning.find("blockSizeKB");
+        if (blockSizeIt != jsonTuning.end()) {
+            tuning.blockSize = blockSizeIt->get<size_t>() * 1024;
+        }
+        auto compressionIt = jsonTuning.find("compression");
+        if (compressionIt != jsonTuning.end()) {
+            tuning.compression = compressionIt->get<std::string>();
+            auto &names = indexCompressionNames();
+            if (std::find(names.begin(), names.end(), tuning.compression) == names.end()) {
+                throw std::runtime_error("Unknown index compression: " + tuning.compression);
+            }
+        }
+        auto bloomIt = jsonTuning.find("bloomBitsPerKey");
+        if (bloomIt != jsonTuning.end()) {
+            bloomIt->get_to(tuning.bloomBitsPerKey);
+        }
+        auto cacheIt = jsonTuning.find("cacheMB");
+        if (cacheIt != jsonTuning.end()) {
+            tuning.cacheSize = cacheIt->get<size_t>() * 1024 * 1024;
+        }
+        auto openFilesIt = jsonTuning.find("maxOpenFiles");
+        if (openFilesIt != jsonTuning.end()) {
+            openFilesIt->get_to(tuning.maxOpenFiles);
+        }
+        auto profileIt = jsonTuning.find("profile");
+        if (profileIt != jsonTuning.end()) {
+            auto profile = profileIt->get<std::string>();
+            if (profile != "default" && profile != "interactive") {
+                throw std::runtime_error("Unknown index profile: " + profile);
+            }
+            tuning.interactive = profile == "interactive";
+        }
+        auto warmupIt = jsonTuning.find("warmup");
+        if (warmupIt != jsonTuning.end()) {
+            warmupIt->get_to(tuning.warmup);
+        }
+        return tuning;
+    }
+    
     DataConfiguration loadBlockchainConfig(const std::string &configPath, bool errorOnReorg, BlockHeight blocksIgnored) {
         auto jsonConf = loadConfig(configPath);
         checkVersion(jsonConf);
         
         ChainConfiguration chainConfig = jsonConf.at("chainConfig");
-        return {configPath, chainConfig, errorOnReorg, blocksIgnored};
+        DataConfiguration config{configPath, chainConfig, errorOnReorg, blocksIgnored};
+        
+        auto hintsIt = jsonConf.find("accessHints");
+        if (hintsIt != jsonConf.end()) {
+            for (auto it = hintsIt->begin(); it != hintsIt->end(); ++it) {
+                config.chainAccessHints[chainColumnFromString(it.key())] = accessHintFromString(it.value().get<std::string>());
+            }
+        }
+        
+        auto backendIt = jsonConf.find("readBackend");
+        if (backendIt != jsonConf.end()) {
+            auto backend = backendIt->get<std::string>();
+            if (backend == "paged") {
+                config.readBackend = ReadBackend::Paged;
+            } else if (backend != "mmap") {
+                throw std::runtime_error("Unknown read backend: " + backend);
+            }
+        }
+        
+        auto objectStoreIt = jsonConf.find("objectStore");
+        if (objectStoreIt != jsonConf.end()) {
+            auto &objectStore = config.objectStore;
+            objectStore.endpoint = objectStoreIt->at("endpoint").get<std::string>();
+            objectStore.bucket = objectStoreIt->at("bucket").get<std::string>();
+            objectStore.prefix = objectStoreIt->value("prefix", std::string{});
+            objectStore.region = objectStoreIt->value("region", objectStore.region);
+            objectStore.accessKey = objectStoreIt->value("accessKey", std::string{});
+            objectStore.secretKey = objectStoreIt->value("secretKey", std::string{});
+            objectStore.rangeSize = objectStoreIt->value("rangeMB", objectStore.rangeSize >> 20) << 20;
+            objectStore.connections = objectStoreIt->value("connections", objectStore.connections);
+            objectStore.cacheBudget = objectStoreIt->value("cacheMB", uint64_t{0}) * 1024 * 1024;
+        }
+        
+        auto archiveIt = jsonConf.find("archive");
+        if (archiveIt != jsonConf.end()) {
+            if (config.objectStore.isSet()) {
+                throw std::runtime_error("A data directory can't be mounted from both object storage and a snapshot archive");
+            }
+            auto &archive = config.archive;
+            archive.directory = archiveIt->at("directory").get<std::string>();
+            archive.snapshot = archiveIt->at("snapshot").get<std::string>();
+            archive.readers = archiveIt->value("readers", archive.readers);
+            archive.cacheBudget = archiveIt->value("cacheMB", uint64_t{0}) * 1024 * 1024;
+        }
+        
+        auto residentIt = jsonConf.find("residentMode");
+        if (residentIt != jsonConf.end()) {
+            config.residentMode = true;
+            config.lockTxData = residentIt->value("lockTxData", false);
+            auto placement = residentIt->value("numaPlacement", std::string{"default"});
+            if (placement == "interleave") {
+                config.residentNumaPlacement = NumaPlacement::Interleave;
+            } else if (placement == "partition") {
+                config.residentNumaPlacement = NumaPlacement::Partition;
+            } else if (placement != "default") {
+                throw std::runtime_error("Unknown NUMA placement: " + placement);
+            }
+        }
+        
+        auto addressCacheIt = jsonConf.find("addressIndexCacheMB");
+        if (addressCacheIt != jsonConf.end()) {
+            config.addressIndexCacheSize = addressCacheIt->get<size_t>() * 1024 * 1024;
+        }
+        
+        auto openModeIt = jsonConf.find("indexOpenMode");
+        if (openModeIt != jsonConf.end()) {
+            auto openMode = openModeIt->get<std::string>();
+            if (openMode == "secondary") {
+                config.indexOpenMode = IndexOpenMode::Secondary;
+            } else if (openMode != "readOnly") {
+                throw std::runtime_error("Unknown index open mode: " + openMode);
+            }
+        }
+        
+        auto sharedCacheIt = jsonConf.find("sharedIndexCacheMB");
+        if (sharedCacheIt != jsonConf.end()) {
+            config.sharedIndexCacheSize = sharedCacheIt->get<size_t>() * 1024 * 1024;
+        }
+        
+        auto checksumTailIt = jsonConf.find("checksumTailChunks");
+        if (checksumTailIt != jsonConf.end()) {
+            checksumTailIt->get_to(config.checksumTailChunks);
+        }
+        
+        auto budgetIt = jsonConf.find("memoryBudgetMB");
+        if (budgetIt != jsonConf.end()) {
+            config.memoryBudget = budgetIt->get<uint64_t>() * 1024 * 1024;
+        }
+        
+        auto indexOptionsIt = jsonConf.find("indexOptions");
+        if (indexOptionsIt != jsonConf.end()) {
+            auto addressIt = indexOptionsIt->find("addressIndex");
+            if (addressIt != indexOptionsIt->end()) {
+                config.addressIndexTuning = loadIndexTuning(*addressIt);
+            }
+            auto hashIt = indexOptionsIt->find("hashIndex");
+            if (hashIt != indexOptionsIt->end()) {
+                config.hashIndexTuning = loadIndexTuning(*hashIt);
+            }
+        }
+        
+        auto compressedIt = jsonConf.find("compressedColumns");
+        if (compressedIt != jsonConf.end()) {
+            for (const auto &column : *compressedIt) {
+                config.compressedChainColumns.insert(chainColumnFromString(column.get<std::string>()));
+            }
+        }
+        return config;
     }
     
     void createDirectory(const filesystem::path &dir) {
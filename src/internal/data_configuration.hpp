@@ -10,11 +10,17 @@
 #define data_configuration_h
 
 #include "chain_configuration.hpp"
+#include "index_open.hpp"
+#include "object_store.hpp"
+#include "snapshot_archive.hpp"
 
+#include <blocksci/core/access_hint.hpp>
 #include <blocksci/core/typedefs.hpp>
 
 #include <wjfilesystem/path.h>
 
+#include <map>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -22,8 +28,21 @@ namespace blocksci {
     
     static constexpr int dataVersion = 5;
     
+    /** How the large chain/ data files are read */
+    enum class ReadBackend {
+        /** Memory-map the files and let page faults load the data */
+        Mmap,
+        /** Read tx_data.dat through explicit (io_uring or pread) reads, see PagedFile */
+        Paged
+    };
+    
     nlohmann::json loadConfig(const std::string &configFilePath);
     void checkVersion(const nlohmann::json &jsonConf);
+    
+    /** IndexTuning from an object such as {"blockSizeKB": 16, "compression": "lz4", "bloomBitsPerKey": 10,
+     * "cacheMB": 1024, "maxOpenFiles": -1, "profile": "interactive", "warmup": true}, all entries are optional. The
+     * profile is "default" or "interactive" */
+    IndexTuning loadIndexTuning(const nlohmann::json &jsonTuning);
 
     /** Loads and holds blockchain configuration files, needed to load blockchains */
     struct DataConfiguration {
@@ -37,9 +56,77 @@ namespace blocksci {
          * Eg. 10 loads blocks [0, 9], and -6 loads all but the last 6 blocks */
         BlockHeight blocksIgnored;
 
+        /** Version of the chain manifest the chain is pinned to (@see ChainManifest), 0 to load everything on disk.
+         * Takes the place of blocksIgnored */
+        uint64_t snapshotVersion = 0;
+
         /** Configuration of an individual chain, eg. coinName, dataDirectory, segwitActivationHeight etc. */
         ChainConfiguration chainConfig;
         
+        /** Access hints applied to the chain/ files when they are mapped, loaded from the optional "accessHints"
+         * section of the config file, eg. {"tx_data": "sequential", "tx_hashes": "random"} */
+        std::map<ChainColumn, AccessHint> chainAccessHints;
+        
+        /** Chain columns that are read from their compressed copies (created by blocksci_parser compress-columns), loaded
+         * from the optional "compressedColumns" section of the config file, eg. ["sequence", "input_out_num", "tx_version"] */
+        std::set<ChainColumn> compressedChainColumns;
+        
+        /** Copy the hot chain/ index files into huge page backed memory when the chain is opened,
+         * loaded from the optional "residentMode" section of the config file, eg. {"lockTxData": true} */
+        bool residentMode = false;
+        
+        /** In resident mode, additionally mlock tx_data.dat */
+        bool lockTxData = false;
+        
+        /** NUMA placement of the resident copies, loaded from the "numaPlacement" entry of the "residentMode" section
+         * ("default", "interleave" or "partition") */
+        NumaPlacement residentNumaPlacement = NumaPlacement::Default;
+        
+        /** Backend used to read tx_data.dat, loaded from the optional "readBackend" entry of the config file ("mmap" or "paged") */
+        ReadBackend readBackend = ReadBackend::Mmap;
+        
+        /** Object storage the data directory is copied from, loaded from the optional "objectStore" section of the
+         * config file. When set, the files needed to open the chain are copied into the (local) dataDirectory when it
+         * is opened or reloaded, the indexes when they are first used, and tx_data.dat is fetched page by page as it
+         * is read, see hydrateDataDirectory */
+        ObjectStoreConfig objectStore;
+        
+        /** Snapshot archive the data directory is mounted from, loaded from the optional "archive" section of the config
+         * file. Treated like objectStore, of which at most one may be set */
+        ArchiveMountConfig archive;
+        
+        /** Whether the data directory is a local copy of object storage or of a snapshot archive */
+        bool isRemote() const {
+            return objectStore.isSet() || archive.isSet();
+        }
+        
+        /** Size in bytes of the block cache shared by all columns of the address index, loaded from the optional
+         * "addressIndexCacheMB" entry of the config file. 0 uses AddressIndex::defaultBlockCacheSize */
+        size_t addressIndexCacheSize = 0;
+        
+        /** Mode the address and hash indexes are opened in, loaded from the optional "indexOpenMode" entry of the config
+         * file ("readOnly" or "secondary") */
+        IndexOpenMode indexOpenMode = IndexOpenMode::ReadOnly;
+        
+        /** Size in bytes of a block cache shared by the address and hash indexes of all chains opened by the process,
+         * loaded from the optional "sharedIndexCacheMB" entry of the config file. 0 gives every index its own cache */
+        size_t sharedIndexCacheSize = 0;
+        
+        /** Number of chunks at the end of every chain/ and scripts/ data file whose checksums are verified when the
+         * chain is opened (@see FileChecksums), loaded from the optional "checksumTailChunks" entry of the config file.
+         * Catches files torn by an unclean shutdown of the parser, 0 skips the check */
+        size_t checksumTailChunks = 0;
+        
+        /** Bytes of memory the chain may hold across its data files, indexes and caches before enforceMemoryBudget
+         * releases some, loaded from the optional "memoryBudgetMB" entry of the config file. 0 is unlimited */
+        uint64_t memoryBudget = 0;
+        
+        /** RocksDB options of the address and hash indexes, loaded from the "addressIndex" and "hashIndex" entries of the
+         * optional "indexOptions" section of the config file (@see loadIndexTuning). The cacheMB of the address index
+         * takes precedence over addressIndexCacheMB, sharedIndexCacheMB over both */
+        IndexTuning addressIndexTuning;
+        IndexTuning hashIndexTuning;
+        
         bool isNull() const {
             return chainConfig.dataDirectory.empty();
         }
@@ -60,10 +147,34 @@ namespace blocksci {
             return chainConfig.dataDirectory/"addressesDb";
         }
         
+        filesystem::path addressTablesDirectory() const {
+            return chainConfig.dataDirectory/"addressTables";
+        }
+        
+        filesystem::path nulldataIndexDirectory() const {
+            return chainConfig.dataDirectory/"nulldataIndex";
+        }
+        
+        filesystem::path txFeaturesDirectory() const {
+            return chainConfig.dataDirectory/"txFeatures";
+        }
+        
+        filesystem::path derivedColumnsDirectory() const {
+            return chainConfig.dataDirectory/"derivedColumns";
+        }
+        
         filesystem::path hashIndexFilePath() const {
             return chainConfig.dataDirectory/"hashIndex";
         }
         
+        filesystem::path txHashTableFilePath() const {
+            return chainConfig.dataDirectory/"txHashTable";
+        }
+        
+        filesystem::path txHashOrderFilePath() const {
+            return chainConfig.dataDirectory/"txHashOrder";
+        }
+        
         filesystem::path pidFilePath() const {
             return chainConfig.dataDirectory/"blocksci_parser.pid";
         }
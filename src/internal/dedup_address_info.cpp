@@ -16,6 +16,7 @@ namespace blocksci {
     constexpr char DedupAddressInfo<DedupAddressType::NULL_DATA>::name[];
     constexpr char DedupAddressInfo<DedupAddressType::NONSTANDARD>::name[];
     constexpr char DedupAddressInfo<DedupAddressType::WITNESS_UNKNOWN>::name[];
+    constexpr char DedupAddressInfo<DedupAddressType::WITNESS_TAPROOT>::name[];
     
     constexpr std::array<AddressType::Enum, 4> DedupAddressInfo<DedupAddressType::PUBKEY>::equivTypes;
     constexpr std::array<AddressType::Enum, 2> DedupAddressInfo<DedupAddressType::SCRIPTHASH>::equivTypes;
@@ -23,6 +24,7 @@ namespace blocksci {
     constexpr std::array<AddressType::Enum, 1> DedupAddressInfo<DedupAddressType::NULL_DATA>::equivTypes;
     constexpr std::array<AddressType::Enum, 1> DedupAddressInfo<DedupAddressType::NONSTANDARD>::equivTypes;
     constexpr std::array<AddressType::Enum, 1> DedupAddressInfo<DedupAddressType::WITNESS_UNKNOWN>::equivTypes;
+    constexpr std::array<AddressType::Enum, 1> DedupAddressInfo<DedupAddressType::WITNESS_TAPROOT>::equivTypes;
     
     template<DedupAddressType::Enum type>
     struct DedupAddressNameFunctor {
@@ -78,6 +78,16 @@ namespace blocksci {
         static constexpr AddressType::Enum reprType = AddressType::WITNESS_UNKNOWN;
     };
     
+    template <>
+    struct DedupAddressInfo<DedupAddressType::WITNESS_TAPROOT> {
+        static constexpr char name[] = "witness_taproot_script";
+        static constexpr bool equived = true;
+        static constexpr bool spendable = true;
+        static constexpr bool indexed = false;
+        static constexpr std::array<AddressType::Enum, 1> equivTypes = {{AddressType::WITNESS_TAPROOT}};
+        static constexpr AddressType::Enum reprType = AddressType::WITNESS_TAPROOT;
+    };
+    
     template<DedupAddressType::Enum type>
     struct SpendableFunctor {
         static constexpr bool f() {
@@ -0,0 +1,274 @@
+//
+//  derived_column_store.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "derived_column_store.hpp"
+#include "chain_access.hpp"
+#include "data_access.hpp"
+
+#include <blocksci/chain/block_range.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <set>
+#include <stdexcept>
+
+namespace blocksci {
+
+    namespace {
+        constexpr uint64_t metaMagic = 0x4c4f434456524544ULL; // "DERVDCOL"
+
+        /** Number of blocks computed between two writes, bounding the memory used for the values of a window */
+        constexpr BlockHeight updateWindowSize = 2000;
+
+        struct DerivedColumnMeta {
+            uint64_t magic;
+            uint32_t version;
+            uint8_t level;
+            uint8_t type;
+            uint16_t padding;
+            uint32_t coveredHeight;
+            uint32_t padding2;
+            uint64_t count;
+            uint256 lastBlockHash;
+        };
+
+        bool readMeta(const filesystem::path &path, DerivedColumnMeta &meta) {
+            std::ifstream file(path.str(), std::ios::binary);
+            return file.read(reinterpret_cast<char *>(&meta), sizeof(meta)) && meta.magic == metaMagic;
+        }
+
+        void writeMeta(const filesystem::path &path, const DerivedColumnMeta &meta) {
+            auto tempPath = path.str() + ".tmp";
+            {
+                std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+                file.write(reinterpret_cast<const char *>(&meta), sizeof(meta));
+                if (!file) {
+                    throw std::runtime_error("Could not write derived column metadata to " + tempPath);
+                }
+            }
+            if (std::rename(tempPath.c_str(), path.str().c_str()) != 0) {
+                throw std::runtime_error("Could not move derived column metadata into place at " + path.str());
+            }
+        }
+
+        /** Number of blocks of the stored column that are still part of the chain
+         *
+         * A chain loaded with blocksIgnored can end before the column, in which case only its prefix is used. */
+        BlockHeight validHeight(const DerivedColumnMeta &meta, const ChainAccess &chain) {
+            auto height = static_cast<BlockHeight>(meta.coveredHeight);
+            if (height == 0) {
+                return 0;
+            }
+            if (height > static_cast<BlockHeight>(chain.blockCount())) {
+                return static_cast<BlockHeight>(chain.blockCount());
+            }
+            return chain.getBlock(height - 1)->hash == meta.lastBlockHash ? height : 0;
+        }
+
+        /** Number of values of the level for the blocks before height */
+        uint64_t elementsBefore(const ChainAccess &chain, DerivedColumnLevel level, BlockHeight height) {
+            bool pastEnd = height >= static_cast<BlockHeight>(chain.blockCount());
+            uint32_t txNum = pastEnd ? static_cast<uint32_t>(chain.txCount()) : chain.getBlock(height)->firstTxIndex;
+            bool txPastEnd = txNum >= chain.txCount();
+            switch (level) {
+                case DerivedColumnLevel::Block:
+                    return static_cast<uint64_t>(height);
+                case DerivedColumnLevel::Tx:
+                    return txNum;
+                case DerivedColumnLevel::Input:
+                    return txPastEnd ? chain.inputCount() : chain.getFirstInputNumber(txNum);
+                case DerivedColumnLevel::Output:
+                    return txPastEnd ? chain.outputCount() : chain.getFirstOutputNumber(txNum);
+            }
+            assert(false);
+            return 0;
+        }
+
+        SegmentWeight segmentWeight(DerivedColumnLevel level) {
+            return level == DerivedColumnLevel::Input || level == DerivedColumnLevel::Output ? SegmentWeight::InoutCount : SegmentWeight::TxCount;
+        }
+    }
+
+    filesystem::path DerivedColumnStore::dataPath(const filesystem::path &directory, const std::string &name) {
+        return directory/name;
+    }
+
+    filesystem::path DerivedColumnStore::metaPath(const filesystem::path &directory, const std::string &name) {
+        return directory/(name + ".meta");
+    }
+
+    void DerivedColumnStore::add(DerivedColumnSpec spec) {
+        if (spec.name.empty() || spec.name.find('/') != std::string::npos) {
+            throw std::invalid_argument("Derived column names must be non-empty and must not contain '/'");
+        }
+        if (!spec.compute) {
+            throw std::invalid_argument("Derived column " + spec.name + " has no compute function");
+        }
+        auto name = spec.name;
+        specs[name] = std::move(spec);
+    }
+
+    std::vector<std::string> DerivedColumnStore::registeredNames() const {
+        std::vector<std::string> names;
+        names.reserve(specs.size());
+        for (const auto &entry : specs) {
+            names.push_back(entry.first);
+        }
+        return names;
+    }
+
+    std::vector<const DerivedColumnSpec *> DerivedColumnStore::updateOrder() const {
+        std::vector<const DerivedColumnSpec *> order;
+        std::set<std::string> done;
+        std::set<std::string> visiting;
+        std::function<void(const DerivedColumnSpec &)> visit = [&](const DerivedColumnSpec &spec) {
+            if (done.count(spec.name) > 0) {
+                return;
+            }
+            if (!visiting.insert(spec.name).second) {
+                throw std::runtime_error("Derived column " + spec.name + " depends on itself");
+            }
+            for (const auto &dependency : spec.dependencies) {
+                auto it = specs.find(dependency);
+                if (it == specs.end()) {
+                    throw std::runtime_error("Derived column " + spec.name + " depends on " + dependency + ", which is not registered");
+                }
+                visit(it->second);
+            }
+            visiting.erase(spec.name);
+            done.insert(spec.name);
+            order.push_back(&spec);
+        };
+        for (const auto &entry : specs) {
+            visit(entry.second);
+        }
+        return order;
+    }
+
+    DerivedColumn DerivedColumnStore::open(const std::string &name, DataAccess &access) {
+        const auto &chain = access.getChain();
+        DerivedColumnMeta meta;
+        if (!readMeta(metaPath(directory, name), meta)) {
+            throw std::runtime_error("Derived column " + name + " has not been built, register it and call update_derived_columns");
+        }
+        auto level = static_cast<DerivedColumnLevel>(meta.level);
+        auto type = static_cast<DerivedColumnType>(meta.type);
+        auto height = validHeight(meta, chain);
+        auto count = std::min(meta.count, elementsBefore(chain, level, height));
+        if (count == 0) {
+            return {name, level, type, height, 0, nullptr, nullptr, generation(), access};
+        }
+
+        std::shared_ptr<SimpleFileMapper<mio::access_mode::read>> mapping;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto &cached = mappings[name];
+            if (!cached) {
+                cached = std::make_shared<SimpleFileMapper<mio::access_mode::read>>(dataPath(directory, name));
+            }
+            mapping = cached;
+        }
+        auto byteCount = static_cast<OffsetType>(count * derivedColumnElementSize(type));
+        if (mapping->size() < byteCount) {
+            throw std::runtime_error("Derived column " + name + " is shorter than its metadata");
+        }
+        return {name, level, type, height, count, mapping->getDataAtOffset(0, byteCount), mapping, generation(), access};
+    }
+
+    void DerivedColumnStore::update(BlockRange &chain) {
+        if (chain.sl.start != 0) {
+            throw std::invalid_argument("Derived columns have to be updated over a block range starting at the genesis block");
+        }
+        auto order = updateOrder();
+        if (order.empty()) {
+            return;
+        }
+        if (!directory.exists()) {
+            filesystem::create_directory(directory);
+        }
+        const auto &access = chain.getAccess().getChain();
+        auto endHeight = chain.sl.stop;
+
+        // Height from which every column was recomputed, so the columns depending on it are recomputed from there too
+        std::map<std::string, BlockHeight> rebuiltFrom;
+        for (auto spec : order) {
+            BlockHeight startHeight = 0;
+            DerivedColumnMeta meta{};
+            if (readMeta(metaPath(directory, spec->name), meta) && meta.version == spec->version
+                && meta.level == static_cast<uint8_t>(spec->level) && meta.type == static_cast<uint8_t>(spec->type)) {
+                startHeight = std::min(validHeight(meta, access), endHeight);
+            }
+            for (const auto &dependency : spec->dependencies) {
+                startHeight = std::min(startHeight, rebuiltFrom[dependency]);
+            }
+            rebuiltFrom[spec->name] = startHeight;
+            if (startHeight == endHeight) {
+                continue;
+            }
+
+            auto elementSize = derivedColumnElementSize(spec->type);
+            auto count = elementsBefore(access, spec->level, startHeight);
+            {
+                // Release the mapping of the stored values before their file is truncated
+                std::lock_guard<std::mutex> lock(mutex);
+                mappings.erase(spec->name);
+                updateCount++;
+            }
+            {
+                SimpleFileMapper<mio::access_mode::write> file{dataPath(directory, spec->name)};
+                file.truncate(static_cast<OffsetType>(count * elementSize));
+                file.seekEnd();
+                for (auto windowStart = startHeight; windowStart < endHeight; windowStart += updateWindowSize) {
+                    auto windowEnd = std::min(windowStart + updateWindowSize, endHeight);
+                    auto window = chain[{windowStart, windowEnd}];
+                    auto chunks = window.segment(window.chunkCount(), segmentWeight(spec->level));
+                    std::vector<std::vector<uint8_t>> values(chunks.size());
+                    window.runChunks(static_cast<uint32_t>(chunks.size()), [&](uint32_t chunkNum) {
+                        auto &chunk = chunks[chunkNum];
+                        chunk.checkReorg();
+                        auto &chunkValues = values[chunkNum];
+                        for (auto block : chunk) {
+                            spec->compute(block, chunkValues);
+                        }
+                        auto expected = (elementsBefore(access, spec->level, chunk.sl.stop) - elementsBefore(access, spec->level, chunk.sl.start)) * elementSize;
+                        if (chunkValues.size() != expected) {
+                            throw std::runtime_error("Derived column " + spec->name + " computed " + std::to_string(chunkValues.size()) + " bytes for blocks which need " + std::to_string(expected));
+                        }
+                    });
+                    for (auto &chunkValues : values) {
+                        if (!chunkValues.empty()) {
+                            file.write(reinterpret_cast<const char *>(chunkValues.data()), static_cast<OffsetType>(chunkValues.size()));
+                        }
+                    }
+                    count = elementsBefore(access, spec->level, windowEnd);
+                }
+            }
+
+            DerivedColumnMeta newMeta{};
+            newMeta.magic = metaMagic;
+            newMeta.version = spec->version;
+            newMeta.level = static_cast<uint8_t>(spec->level);
+            newMeta.type = static_cast<uint8_t>(spec->type);
+            newMeta.coveredHeight = static_cast<uint32_t>(endHeight);
+            newMeta.count = count;
+            if (endHeight > 0) {
+                newMeta.lastBlockHash = access.getBlock(endHeight - 1)->hash;
+            }
+            writeMeta(metaPath(directory, spec->name), newMeta);
+            updateCount++;
+        }
+    }
+
+    void DerivedColumnStore::reload() {
+        std::lock_guard<std::mutex> lock(mutex);
+        mappings.clear();
+        updateCount++;
+    }
+} // namespace blocksci
@@ -0,0 +1,83 @@
+//
+//  derived_column_store.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_derived_column_store_hpp
+#define blocksci_derived_column_store_hpp
+
+#include "file_mapper.hpp"
+
+#include <blocksci/chain/derived_column.hpp>
+
+#include <wjfilesystem/path.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace blocksci {
+    class BlockRange;
+    class ChainAccess;
+
+    /** Registered derived columns and the mappings of the stored ones
+     *
+     * Every column is stored in two files, the values in <name>.dat and a metadata file <name>.meta naming the version,
+     * level and type of the values, the number of covered blocks and the hash of the last covered block. The metadata
+     * is replaced atomically after the values were appended. A column whose last covered block isn't part of the chain
+     * anymore after a reorg counts as empty and is recomputed by the next update.
+     *
+     * Registrations only live in the process that made them, stored columns can be read by every process.
+     *
+     * Directory: derivedColumns/
+     */
+    class DerivedColumnStore {
+    public:
+        explicit DerivedColumnStore(filesystem::path directory_) : directory(std::move(directory_)) {}
+
+        /** Register or replace the definition of a column */
+        void add(DerivedColumnSpec spec);
+
+        /** Names of the registered columns */
+        std::vector<std::string> registeredNames() const;
+
+        /** Stored values of the column, throws std::runtime_error if it hasn't been built */
+        DerivedColumn open(const std::string &name, DataAccess &access);
+
+        /** Compute the values of all registered columns for the blocks they don't cover yet, dependencies first
+         *
+         * chain has to start at the genesis block. The blocks are processed in windows, the chunks of each window in
+         * parallel on the work pool of the chain. */
+        void update(BlockRange &chain);
+
+        /** Drop the cached mappings, called when the chain is reloaded */
+        void reload();
+
+        /** Counter increased whenever a stored column changes or the mappings are dropped, see DerivedColumn::isStale */
+        uint64_t generation() const {
+            return updateCount.load(std::memory_order_acquire);
+        }
+
+        static filesystem::path dataPath(const filesystem::path &directory, const std::string &name);
+        static filesystem::path metaPath(const filesystem::path &directory, const std::string &name);
+
+    private:
+        filesystem::path directory;
+        std::map<std::string, DerivedColumnSpec> specs;
+
+        /** Guards mappings, columns are opened from the worker threads of updates */
+        std::mutex mutex;
+        std::map<std::string, std::shared_ptr<SimpleFileMapper<mio::access_mode::read>>> mappings;
+        std::atomic<uint64_t> updateCount{0};
+
+        /** Registered columns with every column after its dependencies */
+        std::vector<const DerivedColumnSpec *> updateOrder() const;
+    };
+} // namespace blocksci
+
+#endif /* blocksci_derived_column_store_hpp */
@@ -0,0 +1,178 @@
+//
+//  external_components.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include "external_components.hpp"
+#include "concurrent_disjoint_sets.hpp"
+#include "file_mapper.hpp"
+#include "segment_work.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+namespace blocksci {
+    
+    namespace {
+        void sortUnique(std::vector<uint32_t> &values) {
+            std::sort(values.begin(), values.end());
+            values.erase(std::unique(values.begin(), values.end()), values.end());
+        }
+    }
+    
+    ExternalComponents::ExternalComponents(uint32_t size, filesystem::path directory_, uint64_t memoryBudget, uint32_t writerCount) : elementCount(size), directory(std::move(directory_)) {
+        if (!directory.exists() && !filesystem::create_directory(directory)) {
+            throw std::runtime_error("Cannot create directory at path " + directory.str());
+        }
+        // A quarter of the budget goes to the disjoint sets over a chunk, the rest is left for the earlier elements
+        // linked to the chunk and the link buffers
+        auto chunkElements = memoryBudget / (4 * sizeof(uint32_t));
+        chunkSize = static_cast<uint32_t>(std::max<uint64_t>(std::min<uint64_t>(chunkElements, std::max(size, 1u)), 1u << 16));
+        auto count = size == 0 ? 0 : (size - 1) / chunkSize + 1;
+        for (uint32_t i = 0; i < count; i++) {
+            buckets.push_back(std::make_unique<Bucket>());
+            // Links are appended to the bucket files, so files left behind by an interrupted run must not be reused
+            std::remove((bucketPath(i).str() + ".dat").c_str());
+        }
+        auto bufferBytes = memoryBudget / 4 / (std::max(writerCount, 1u) * std::max(count, 1u));
+        bufferSize = std::max<size_t>(bufferBytes / sizeof(ExternalLink), 256);
+    }
+    
+    ExternalComponents::~ExternalComponents() {
+        for (uint32_t bucket = 0; bucket < buckets.size(); bucket++) {
+            buckets[bucket]->file.close();
+            std::remove((bucketPath(bucket).str() + ".dat").c_str());
+        }
+        // Only succeeds if nothing else was stored in the directory
+        std::remove(directory.str().c_str());
+    }
+    
+    filesystem::path ExternalComponents::bucketPath(uint32_t bucket) const {
+        return directory/("links" + std::to_string(bucket));
+    }
+    
+    void ExternalComponents::append(uint32_t bucket, std::vector<ExternalLink> &links) {
+        std::sort(links.begin(), links.end());
+        links.erase(std::unique(links.begin(), links.end()), links.end());
+        auto &state = *buckets[bucket];
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (!state.file.is_open()) {
+                state.file.open(bucketPath(bucket).str() + ".dat", std::ios::binary | std::ios::app);
+            }
+            state.file.write(reinterpret_cast<const char *>(links.data()), static_cast<std::streamsize>(sizeof(ExternalLink) * links.size()));
+            // Writers flush from their destructors, so failures are reported by resolve()
+            if (!state.file) {
+                state.failed = true;
+            }
+        }
+        links.clear();
+    }
+    
+    void ExternalComponents::closeBucket(uint32_t bucket) {
+        auto &state = *buckets[bucket];
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (state.file.is_open()) {
+            state.file.close();
+            if (!state.file) {
+                state.failed = true;
+            }
+        }
+        if (state.failed) {
+            throw std::runtime_error("Could not write links to " + bucketPath(bucket).str() + ".dat");
+        }
+    }
+    
+    void ExternalComponents::contractChunk(uint32_t bucket, uint32_t *roots, uint32_t threadCount) {
+        uint32_t chunkStart = bucket * chunkSize;
+        auto chunkEnd = static_cast<uint32_t>(std::min<uint64_t>(uint64_t{chunkStart} + chunkSize, elementCount));
+        closeBucket(bucket);
+        
+        auto path = bucketPath(bucket);
+        {
+            FixedSizeFileMapper<ExternalLink> linkFile{path};
+            linkFile.advise(AccessHint::Sequential);
+            auto linkCount = static_cast<uint32_t>(linkFile.size());
+            const ExternalLink *links = linkCount > 0 ? linkFile[0] : nullptr;
+            auto linkSegments = splitSegments(0, linkCount, threadCount);
+            
+            // Earlier elements linked to the chunk get the first local indexes in their order, followed by the chunk,
+            // so that linking by local index still makes the smallest element the root
+            std::vector<std::vector<uint32_t>> segmentOutside(linkSegments.size());
+            runSegments(linkSegments, [&](uint32_t segmentNum, uint32_t segmentStart, uint32_t segmentEnd) {
+                auto &outside = segmentOutside[segmentNum];
+                size_t dedupSize = size_t{1} << 20;
+                for (uint32_t i = segmentStart; i < segmentEnd; i++) {
+                    if (links[i].lower < chunkStart) {
+                        outside.push_back(links[i].lower);
+                        if (outside.size() >= dedupSize) {
+                            sortUnique(outside);
+                            dedupSize = std::max(dedupSize, outside.size() * 2);
+                        }
+                    }
+                }
+                sortUnique(outside);
+            });
+            std::vector<uint32_t> outside;
+            for (auto &segment : segmentOutside) {
+                outside.insert(outside.end(), segment.begin(), segment.end());
+                std::vector<uint32_t>{}.swap(segment);
+            }
+            sortUnique(outside);
+            auto outsideCount = static_cast<uint32_t>(outside.size());
+            
+            auto localIndex = [&](uint32_t element) {
+                if (element >= chunkStart) {
+                    return outsideCount + (element - chunkStart);
+                }
+                return static_cast<uint32_t>(std::lower_bound(outside.begin(), outside.end(), element) - outside.begin());
+            };
+            
+            ConcurrentDisjointSets sets{outsideCount + (chunkEnd - chunkStart)};
+            runSegments(linkSegments, [&](uint32_t, uint32_t segmentStart, uint32_t segmentEnd) {
+                DisjointSetsBatch batch{sets};
+                for (uint32_t i = segmentStart; i < segmentEnd; i++) {
+                    batch.add(localIndex(links[i].lower), localIndex(links[i].upper));
+                }
+            });
+            
+            segmentWork(chunkStart, chunkEnd, threadCount, [&](uint32_t element) {
+                auto root = sets.find(outsideCount + (element - chunkStart));
+                roots[element] = root < outsideCount ? outside[root] : chunkStart + (root - outsideCount);
+            });
+            
+            // The chunk is removed from the graph, the earlier elements it connected are linked directly instead
+            Writer forwarded{*this};
+            for (uint32_t i = 0; i < outsideCount; i++) {
+                auto root = sets.find(i);
+                if (root != i) {
+                    forwarded.add(outside[root], outside[i]);
+                }
+            }
+        }
+        std::remove((path.str() + ".dat").c_str());
+    }
+    
+    void ExternalComponents::resolve(uint32_t *roots, uint32_t threadCount) {
+        threadCount = resolveThreadCount(threadCount);
+        for (auto bucket = bucketCount(); bucket-- > 0;) {
+            contractChunk(bucket, roots, threadCount);
+        }
+        
+        // Pointers into earlier chunks are final by the time a chunk is reached, all others point at a root of the chunk
+        for (uint32_t bucket = 0; bucket < bucketCount(); bucket++) {
+            uint32_t chunkStart = bucket * chunkSize;
+            auto chunkEnd = static_cast<uint32_t>(std::min<uint64_t>(uint64_t{chunkStart} + chunkSize, elementCount));
+            segmentWork(chunkStart, chunkEnd, threadCount, [&](uint32_t element) {
+                auto pointer = roots[element];
+                if (pointer < chunkStart) {
+                    roots[element] = roots[pointer];
+                }
+            });
+        }
+    }
+} // namespace blocksci
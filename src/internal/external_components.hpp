@@ -0,0 +1,132 @@
+//
+//  external_components.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_external_components_hpp
+#define blocksci_external_components_hpp
+
+#include <wjfilesystem/path.h>
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace blocksci {
+    
+    /** Edge between two elements, stored with lower < upper */
+    struct ExternalLink {
+        uint32_t lower;
+        uint32_t upper;
+        
+        bool operator<(const ExternalLink &other) const {
+            return lower < other.lower || (lower == other.lower && upper < other.upper);
+        }
+        
+        bool operator==(const ExternalLink &other) const {
+            return lower == other.lower && upper == other.upper;
+        }
+    };
+    
+    /** Connected components of the elements [0, size) for more links than fit in memory
+     *
+     * The elements are split into chunks that fit into the memory budget, and every link is written to the bucket file
+     * of the chunk of its upper element. resolve() then contracts the chunks from the last to the first: the links of a
+     * chunk are united in memory, every element of the chunk is pointed at the smallest element of its component, and
+     * the earlier elements that the component connects are linked with each other in the buckets of their own chunks.
+     * This keeps the connectivity of all earlier elements intact, so once the first chunk is contracted the roots are
+     * resolved in a single ascending pass over the pointers. As with ConcurrentDisjointSets, the root of every element
+     * is the smallest element of its component.
+     *
+     * Memory is bounded by the chunk and the per-thread link buffers, plus the distinct earlier elements linked to the
+     * chunk being contracted; the links themselves only ever live on disk.
+     */
+    class ExternalComponents {
+        struct Bucket {
+            std::mutex mutex;
+            std::ofstream file;
+            bool failed = false;
+        };
+        
+        uint32_t elementCount;
+        uint32_t chunkSize;
+        size_t bufferSize;
+        filesystem::path directory;
+        std::vector<std::unique_ptr<Bucket>> buckets;
+        
+        filesystem::path bucketPath(uint32_t bucket) const;
+        
+        /** Sort, deduplicate and append the links to the bucket file, clearing them */
+        void append(uint32_t bucket, std::vector<ExternalLink> &links);
+        
+        void closeBucket(uint32_t bucket);
+        
+        void contractChunk(uint32_t bucket, uint32_t *roots, uint32_t threadCount);
+        
+    public:
+        /** Buffers the links found by one thread per bucket */
+        class Writer {
+            ExternalComponents &components;
+            std::vector<std::vector<ExternalLink>> buffers;
+            
+        public:
+            explicit Writer(ExternalComponents &components_) : components(components_), buffers(components_.buckets.size()) {}
+            
+            Writer(const Writer &) = delete;
+            Writer &operator=(const Writer &) = delete;
+            
+            ~Writer() {
+                flush();
+            }
+            
+            void add(uint32_t a, uint32_t b) {
+                if (a == b) {
+                    return;
+                }
+                auto link = a < b ? ExternalLink{a, b} : ExternalLink{b, a};
+                auto bucket = link.upper / components.chunkSize;
+                auto &buffer = buffers[bucket];
+                buffer.push_back(link);
+                if (buffer.size() >= components.bufferSize) {
+                    components.append(bucket, buffer);
+                }
+            }
+            
+            void flush() {
+                for (uint32_t bucket = 0; bucket < buffers.size(); bucket++) {
+                    if (!buffers[bucket].empty()) {
+                        components.append(bucket, buffers[bucket]);
+                    }
+                }
+            }
+        };
+        
+        /** Bucket files are written to directory, which is created if needed
+         *
+         * memoryBudget is split between the chunk contracted at a time and the buffers of up to writerCount Writers. */
+        ExternalComponents(uint32_t size, filesystem::path directory, uint64_t memoryBudget, uint32_t writerCount);
+        ExternalComponents(const ExternalComponents &) = delete;
+        ExternalComponents &operator=(const ExternalComponents &) = delete;
+        ~ExternalComponents();
+        
+        uint32_t size() const {
+            return elementCount;
+        }
+        
+        uint32_t bucketCount() const {
+            return static_cast<uint32_t>(buckets.size());
+        }
+        
+        /** Write the root of every element to roots[0, size), all Writers must have been flushed
+         *
+         * roots can point into a mapped file, every pass over it apart from looking up the roots of earlier elements is
+         * sequential. The bucket files are consumed. */
+        void resolve(uint32_t *roots, uint32_t threadCount);
+    };
+} // namespace blocksci
+
+#endif /* blocksci_external_components_hpp */
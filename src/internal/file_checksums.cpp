@@ -0,0 +1,265 @@
+//
+//  file_checksums.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "file_checksums.hpp"
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#define BLOCKSCI_CRC32C_X86
+#endif
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace blocksci {
+    namespace {
+        constexpr uint64_t checksumMagic = 0x314d555349435342; // "BSCISUM1"
+        constexpr size_t readBufferSize = 4 * 1024 * 1024;
+
+        struct ChecksumHeader {
+            uint64_t magic;
+            uint64_t chunkSize;
+            uint64_t length;
+            uint64_t chunkCount;
+        };
+
+        std::array<uint32_t, 256> makeCrcTable() {
+            std::array<uint32_t, 256> table;
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t crc = i;
+                for (int j = 0; j < 8; j++) {
+                    crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78 : 0);
+                }
+                table[i] = crc;
+            }
+            return table;
+        }
+
+        uint32_t crc32cSoftware(uint32_t state, const unsigned char *data, size_t length) {
+            static const auto table = makeCrcTable();
+            for (size_t i = 0; i < length; i++) {
+                state = table[(state ^ data[i]) & 0xff] ^ (state >> 8);
+            }
+            return state;
+        }
+
+#ifdef BLOCKSCI_CRC32C_X86
+        bool hasSse42() {
+            static const bool supported = __builtin_cpu_supports("sse4.2");
+            return supported;
+        }
+
+        __attribute__((target("sse4.2")))
+        uint32_t crc32cHardware(uint32_t state, const unsigned char *data, size_t length) {
+            uint64_t state64 = state;
+            while (length >= 8) {
+                uint64_t word;
+                std::memcpy(&word, data, sizeof(word));
+                state64 = _mm_crc32_u64(state64, word);
+                data += 8;
+                length -= 8;
+            }
+            state = static_cast<uint32_t>(state64);
+            while (length > 0) {
+                state = _mm_crc32_u8(state, *data);
+                data++;
+                length--;
+            }
+            return state;
+        }
+#endif
+
+        uint64_t chunkEnd(size_t chunk, uint64_t length) {
+            return std::min((static_cast<uint64_t>(chunk) + 1) * FileChecksums::chunkSize, length);
+        }
+
+        /** CRC32C of the bytes [chunk * chunkSize, chunkEnd(chunk, length)) of the file, nullopt if they can't be read */
+        ranges::optional<uint32_t> hashChunk(int fd, size_t chunk, uint64_t length, std::vector<unsigned char> &buffer) {
+            uint32_t crc = 0;
+            auto offset = static_cast<uint64_t>(chunk) * FileChecksums::chunkSize;
+            auto end = chunkEnd(chunk, length);
+            while (offset < end) {
+                auto toRead = static_cast<size_t>(std::min<uint64_t>(buffer.size(), end - offset));
+                auto bytesRead = pread(fd, buffer.data(), toRead, static_cast<off_t>(offset));
+                if (bytesRead < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (bytesRead <= 0) {
+                    return ranges::nullopt;
+                }
+                crc = crc32c(crc, buffer.data(), static_cast<size_t>(bytesRead));
+                offset += static_cast<uint64_t>(bytesRead);
+            }
+            return crc;
+        }
+
+        bool isRegularFile(const std::string &path) {
+            struct stat fileStat;
+            return stat(path.c_str(), &fileStat) == 0 && S_ISREG(fileStat.st_mode);
+        }
+
+        bool endsWith(const std::string &value, const std::string &suffix) {
+            return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+        }
+    }
+
+    uint32_t crc32c(uint32_t crc, const void *data, size_t length) {
+        auto bytes = static_cast<const unsigned char *>(data);
+#ifdef BLOCKSCI_CRC32C_X86
+        if (hasSse42()) {
+            return ~crc32cHardware(~crc, bytes, length);
+        }
+#endif
+        return ~crc32cSoftware(~crc, bytes, length);
+    }
+
+    ranges::optional<FileChecksums> FileChecksums::load(const filesystem::path &dataPath) {
+        std::ifstream file(checksumPath(dataPath).str(), std::ios::binary);
+        if (!file) {
+            return ranges::nullopt;
+        }
+        ChecksumHeader header;
+        if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic != checksumMagic || header.chunkSize != chunkSize || header.chunkCount != chunkCount(header.length)) {
+            return ranges::nullopt;
+        }
+        FileChecksums checksums;
+        checksums.length = header.length;
+        checksums.chunks.resize(header.chunkCount);
+        if (!file.read(reinterpret_cast<char *>(checksums.chunks.data()), static_cast<std::streamsize>(checksums.chunks.size() * sizeof(uint32_t)))) {
+            return ranges::nullopt;
+        }
+        return checksums;
+    }
+
+    void FileChecksums::save(const filesystem::path &dataPath) const {
+        // Replace the checksums in one step so that an interrupted parser never leaves a partial file behind
+        auto path = checksumPath(dataPath).str();
+        auto tempPath = path + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            ChecksumHeader header{checksumMagic, chunkSize, length, chunks.size()};
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char *>(chunks.data()), static_cast<std::streamsize>(chunks.size() * sizeof(uint32_t)));
+            if (!file.good()) {
+                throw std::runtime_error("Could not write the checksums " + tempPath);
+            }
+        }
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("Could not replace the checksums " + path + ": " + std::strerror(errno));
+        }
+    }
+
+    void FileChecksums::update(const filesystem::path &dataPath, const std::vector<bool> &dirtyChunks) {
+        auto path = dataPath.str();
+        auto sumPath = checksumPath(dataPath).str();
+        try {
+            struct stat fileStat;
+            if (stat(path.c_str(), &fileStat) != 0) {
+                std::remove(sumPath.c_str());
+                return;
+            }
+            auto previous = load(dataPath);
+            FileChecksums checksums;
+            checksums.length = static_cast<uint64_t>(fileStat.st_size);
+            checksums.chunks.resize(chunkCount(checksums.length));
+
+            auto fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw std::runtime_error("Could not open " + path + ": " + std::strerror(errno));
+            }
+            std::vector<unsigned char> buffer(readBufferSize);
+            bool readFailed = false;
+            for (size_t i = 0; i < checksums.chunks.size() && !readFailed; i++) {
+                // Without stored checksums every chunk is hashed once
+                bool reusable = previous && i < previous->chunks.size() && !(i < dirtyChunks.size() && dirtyChunks[i]) && chunkEnd(i, previous->length) == chunkEnd(i, checksums.length);
+                if (reusable) {
+                    checksums.chunks[i] = previous->chunks[i];
+                } else if (auto crc = hashChunk(fd, i, checksums.length, buffer)) {
+                    checksums.chunks[i] = *crc;
+                } else {
+                    readFailed = true;
+                }
+            }
+            close(fd);
+            if (readFailed) {
+                throw std::runtime_error("Could not read " + path);
+            }
+            checksums.save(dataPath);
+        } catch (const std::exception &) {
+            std::remove(sumPath.c_str());
+        }
+    }
+
+    std::vector<size_t> FileChecksums::verify(const filesystem::path &dataPath, size_t firstChunk, size_t endChunk) const {
+        std::vector<size_t> mismatches;
+        endChunk = std::min(endChunk, chunks.size());
+        auto fd = open(dataPath.str().c_str(), O_RDONLY);
+        std::vector<unsigned char> buffer(readBufferSize);
+        for (size_t i = firstChunk; i < endChunk; i++) {
+            ranges::optional<uint32_t> crc;
+            if (fd >= 0) {
+                crc = hashChunk(fd, i, length, buffer);
+            }
+            if (!crc || *crc != chunks[i]) {
+                mismatches.push_back(i);
+            }
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+        return mismatches;
+    }
+
+    std::vector<filesystem::path> checksummedFiles(const filesystem::path &directory) {
+        std::vector<filesystem::path> files;
+        auto dir = opendir(directory.str().c_str());
+        if (dir == nullptr) {
+            return files;
+        }
+        while (auto entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            auto path = directory/name;
+            if (endsWith(name, ".dat") && isRegularFile(path.str()) && isRegularFile(FileChecksums::checksumPath(path).str())) {
+                files.push_back(path);
+            }
+        }
+        closedir(dir);
+        std::sort(files.begin(), files.end(), [](const filesystem::path &a, const filesystem::path &b) {
+            return a.str() < b.str();
+        });
+        return files;
+    }
+
+    std::vector<ChecksumMismatch> verifyDirectoryChecksums(const filesystem::path &directory, size_t tailChunks) {
+        std::vector<ChecksumMismatch> mismatches;
+        for (auto &dataFile : checksummedFiles(directory)) {
+            auto checksums = FileChecksums::load(dataFile);
+            if (!checksums) {
+                // Checksums that can't be read are as bad as a torn file
+                mismatches.push_back({dataFile, {}});
+                continue;
+            }
+            auto chunkCount = checksums->chunks.size();
+            auto firstChunk = tailChunks > 0 && chunkCount > tailChunks ? chunkCount - tailChunks : 0;
+            auto badChunks = checksums->verify(dataFile, firstChunk, chunkCount);
+            if (!badChunks.empty()) {
+                mismatches.push_back({dataFile, std::move(badChunks)});
+            }
+        }
+        return mismatches;
+    }
+} // namespace blocksci
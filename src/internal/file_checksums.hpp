@@ -0,0 +1,116 @@
+//
+//  file_checksums.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_file_checksums_hpp
+#define blocksci_file_checksums_hpp
+
+#include <range/v3/utility/optional.hpp>
+
+#include <wjfilesystem/path.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace blocksci {
+
+    /** CRC32C of the length bytes at data, continuing from crc. Uses the crc32 instruction of SSE 4.2 if the CPU has it */
+    uint32_t crc32c(uint32_t crc, const void *data, size_t length);
+
+    /** Checksums of the chunks of a data file, stored next to it in <file>.sum
+     *
+     * The write mode file mappers and the file writers of the parser update them whenever they changed the file, so
+     * a file torn by an unclean shutdown is found by checking a few chunks at its end instead of rereading every file
+     * of the chain. Only the chunks that were written to are hashed again.
+     */
+    struct FileChecksums {
+        static constexpr uint64_t chunkSize = 64 * 1024 * 1024;
+
+        /** Length of the file when the checksums were taken */
+        uint64_t length = 0;
+
+        /** CRC32C of the chunks [i * chunkSize, min((i + 1) * chunkSize, length)) */
+        std::vector<uint32_t> chunks;
+
+        static size_t chunkCount(uint64_t length) {
+            return static_cast<size_t>((length + chunkSize - 1) / chunkSize);
+        }
+
+        static filesystem::path checksumPath(const filesystem::path &dataPath) {
+            return filesystem::path{dataPath.str() + ".sum"};
+        }
+
+        /** The stored checksums of the data file, nullopt if there are none or they can't be read */
+        static ranges::optional<FileChecksums> load(const filesystem::path &dataPath);
+
+        /** Replace the stored checksums of the data file */
+        void save(const filesystem::path &dataPath) const;
+
+        /** Take the checksums of the data file again after the chunks marked in dirtyChunks were written to, reusing
+         * the stored checksums of all other chunks. Removes the stored checksums if that fails, so that they never
+         * describe a different state of the file */
+        static void update(const filesystem::path &dataPath, const std::vector<bool> &dirtyChunks);
+
+        /** Numbers of the chunks in [firstChunk, endChunk) whose data doesn't match the checksums. A file shorter than
+         * length fails all its missing chunks, data appended after the checksums were taken is ignored */
+        std::vector<size_t> verify(const filesystem::path &dataPath, size_t firstChunk, size_t endChunk) const;
+    };
+
+    /** Chunks of a file that were written to, @see FileChecksums::update() */
+    class DirtyChunks {
+        std::vector<bool> dirty;
+        bool resized = false;
+
+    public:
+        void mark(int64_t offset, int64_t length) {
+            if (length <= 0) {
+                return;
+            }
+            auto first = static_cast<size_t>(static_cast<uint64_t>(offset) / FileChecksums::chunkSize);
+            auto last = static_cast<size_t>(static_cast<uint64_t>(offset + length - 1) / FileChecksums::chunkSize);
+            if (last >= dirty.size()) {
+                dirty.resize(last + 1, false);
+            }
+            for (auto i = first; i <= last; i++) {
+                dirty[i] = true;
+            }
+        }
+
+        /** The file was truncated or extended without writing to it, which changes its last chunks */
+        void markResized() {
+            resized = true;
+        }
+
+        bool empty() const {
+            return dirty.empty() && !resized;
+        }
+
+        /** Update the checksums of the file for the chunks written so far and start over */
+        void updateChecksums(const filesystem::path &dataPath) {
+            if (!empty()) {
+                FileChecksums::update(dataPath, dirty);
+                dirty.clear();
+                resized = false;
+            }
+        }
+    };
+
+    /** Data file whose checksums don't match, @see verifyDirectoryChecksums(). chunks is empty if the checksums can't be read */
+    struct ChecksumMismatch {
+        filesystem::path path;
+        std::vector<size_t> chunks;
+    };
+
+    /** Data files in the directory that have checksums */
+    std::vector<filesystem::path> checksummedFiles(const filesystem::path &directory);
+
+    /** Check the last tailChunks chunks (all chunks if 0) of every data file in the directory that has checksums */
+    std::vector<ChecksumMismatch> verifyDirectoryChecksums(const filesystem::path &directory, size_t tailChunks);
+} // namespace blocksci
+
+#endif /* blocksci_file_checksums_hpp */
@@ -9,15 +9,31 @@
 #ifndef file_mapper_hpp
 #define file_mapper_hpp
 
+#include "file_checksums.hpp"
+#include "growable_file.hpp"
+#include "layered_file.hpp"
+#include "numa.hpp"
+#include "paged_file.hpp"
+
+#include <blocksci/core/access_hint.hpp>
+
 #include <mio/mmap.hpp>
 
 #include <wjfilesystem/path.h>
 
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <cstdint>
 #include <fstream>
 #include <cstring>
 #include <limits>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <tuple>
@@ -66,11 +82,15 @@ namespace blocksci {
         FileInfo(filesystem::path path_) : path(std::move(path_)) {}
         
         bool exists() const {
-            return path.exists();
+            return path.exists() || LayerManifest::isLayered(path);
+        }
+        
+        bool isLayered() const {
+            return LayerManifest::isLayered(path);
         }
         
         OffsetType size() const {
-            return static_cast<OffsetType>(path.file_size());
+            return isLayered() ? LayerManifest::layeredSize(path) : static_cast<OffsetType>(path.file_size());
         }
         
         void resize(OffsetType offset) {
@@ -86,6 +106,130 @@ namespace blocksci {
         }
     };
     
+    /** Applies the given access hint to the memory range [begin, begin + length) of a mapped file
+     *
+     * The range is widened to page boundaries as required by madvise. Failures are ignored since hints
+     * never affect correctness, only paging behavior.
+     */
+    inline void adviseMappedRange(const char *begin, OffsetType length, AccessHint hint) {
+        if (begin == nullptr || length <= 0) {
+            return;
+        }
+        static const auto pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+        auto start = reinterpret_cast<uintptr_t>(begin);
+        auto alignedStart = start & ~(pageSize - 1);
+        auto alignedLength = static_cast<size_t>(start - alignedStart) + static_cast<size_t>(length);
+        int advice = MADV_NORMAL;
+        switch (hint) {
+            case AccessHint::Normal:
+                advice = MADV_NORMAL;
+                break;
+            case AccessHint::Sequential:
+                advice = MADV_SEQUENTIAL;
+                break;
+            case AccessHint::Random:
+                advice = MADV_RANDOM;
+                break;
+            case AccessHint::WillNeed:
+                advice = MADV_WILLNEED;
+                break;
+            case AccessHint::DontNeed:
+                advice = MADV_DONTNEED;
+                break;
+            case AccessHint::HugePage:
+#ifdef MADV_HUGEPAGE
+                advice = MADV_HUGEPAGE;
+                break;
+#else
+                return;
+#endif
+        }
+        madvise(reinterpret_cast<void *>(alignedStart), alignedLength, advice);
+    }
+    
+    /** Anonymous memory region used to keep a private, optionally huge page backed, copy of a mapped file */
+    class AnonymousMemory {
+        char *memory = nullptr;
+        size_t length = 0;
+        bool hugeTLB = false;
+        
+        void release() {
+            if (memory != nullptr) {
+                munmap(memory, length);
+                memory = nullptr;
+                length = 0;
+                hugeTLB = false;
+            }
+        }
+        
+    public:
+        AnonymousMemory() = default;
+        
+        /** Tries explicit huge pages (MAP_HUGETLB) first and falls back to regular pages with a transparent huge page hint */
+        AnonymousMemory(size_t size, bool useHugePages) {
+            if (size == 0) {
+                return;
+            }
+#ifdef MAP_HUGETLB
+            if (useHugePages) {
+                constexpr size_t hugePageSize = 2 * 1024 * 1024;
+                auto hugeLength = (size + hugePageSize - 1) / hugePageSize * hugePageSize;
+                auto mapping = mmap(nullptr, hugeLength, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                if (mapping != MAP_FAILED) {
+                    memory = static_cast<char *>(mapping);
+                    length = hugeLength;
+                    hugeTLB = true;
+                    return;
+                }
+            }
+#endif
+            auto mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mapping == MAP_FAILED) {
+                throw std::runtime_error("Could not allocate memory for resident file copy");
+            }
+            memory = static_cast<char *>(mapping);
+            length = size;
+            if (useHugePages) {
+                adviseMappedRange(memory, static_cast<OffsetType>(length), AccessHint::HugePage);
+            }
+        }
+        
+        AnonymousMemory(const AnonymousMemory &) = delete;
+        AnonymousMemory &operator=(const AnonymousMemory &) = delete;
+        
+        AnonymousMemory(AnonymousMemory &&other) noexcept : memory(other.memory), length(other.length), hugeTLB(other.hugeTLB) {
+            other.memory = nullptr;
+            other.length = 0;
+            other.hugeTLB = false;
+        }
+        
+        AnonymousMemory &operator=(AnonymousMemory &&other) noexcept {
+            if (this != &other) {
+                release();
+                std::swap(memory, other.memory);
+                std::swap(length, other.length);
+                std::swap(hugeTLB, other.hugeTLB);
+            }
+            return *this;
+        }
+        
+        ~AnonymousMemory() {
+            release();
+        }
+        
+        char *data() const {
+            return memory;
+        }
+        
+        size_t size() const {
+            return length;
+        }
+        
+        bool usesHugeTLB() const {
+            return hugeTLB;
+        }
+    };
+    
     template <mio::access_mode mode>
     struct SimpleFileMapperBase {
         
@@ -134,6 +278,57 @@ namespace blocksci {
     private:
         mio::basic_mmap<mio::access_mode::read, char> file;
         FileInfo fileInfo;
+        
+        /** Hint applied to the whole file, reapplied whenever the file is remapped */
+        AccessHint accessHint = AccessHint::Normal;
+        
+        /** Private in-memory copy of the file that serves all reads when resident mode is enabled */
+        AnonymousMemory residentCopy;
+        bool resident = false;
+        bool residentHugePages = false;
+        NumaPlacement residentPlacement = NumaPlacement::Default;
+        
+        /** Whether the mapping is locked into memory (mlock), reapplied whenever the file is remapped */
+        bool locked = false;
+        
+        /** Explicit read backend replacing the file mapping, see usePagedBackend() */
+        std::unique_ptr<PagedFile> pagedFile;
+        
+        /** Mapping of a file stored as a layer over a shared base directory, replacing the regular mapping */
+        std::unique_ptr<LayeredFile> layeredFile;
+        
+        /** Start of the mapped file, nullptr if it isn't mapped */
+        const char *mappedData() const {
+            if (layeredFile) {
+                return layeredFile->data();
+            }
+            return file.is_open() ? file.data() : nullptr;
+        }
+        
+        OffsetType mappedSize() const {
+            return layeredFile ? layeredFile->size() : static_cast<OffsetType>(file.length());
+        }
+        
+        void copyResident() {
+            if (mappedData() != nullptr && mappedSize() > 0) {
+                auto length = static_cast<size_t>(mappedSize());
+                residentCopy = AnonymousMemory(length, residentHugePages);
+                applyNumaPlacement(residentCopy.data(), residentCopy.size(), residentPlacement);
+                std::memcpy(residentCopy.data(), mappedData(), length);
+            } else {
+                residentCopy = AnonymousMemory();
+            }
+        }
+        
+        const char *dataBegin() const {
+            if (residentCopy.data() != nullptr) {
+                return residentCopy.data();
+            } else if (pagedFile) {
+                return pagedFile->data();
+            } else {
+                return mappedData();
+            }
+        }
     public:
         
         SimpleFileMapper(const filesystem::path &path_) : fileInfo(path_.str() + ".dat") {
@@ -141,37 +336,161 @@ namespace blocksci {
         }
         
         void openFile() {
-            std::error_code error;
-            file.map(fileInfo.path.str(), 0, mio::map_entire_file, error);
-//            if(error) {
-//                throw error;
-//            }
+            if (fileInfo.isLayered()) {
+                if (!layeredFile) {
+                    if (file.is_open()) {
+                        file.unmap();
+                    }
+                    layeredFile = std::make_unique<LayeredFile>(fileInfo.path, false);
+                }
+            } else {
+                layeredFile.reset();
+                std::error_code error;
+                file.map(fileInfo.path.str(), 0, mio::map_entire_file, error);
+//                if(error) {
+//                    throw error;
+//                }
+            }
+            if (mappedData() != nullptr && accessHint != AccessHint::Normal) {
+                adviseMappedRange(mappedData(), size(), accessHint);
+            }
+            if (resident) {
+                copyResident();
+            }
+            if (locked && mappedData() != nullptr && mappedSize() > 0) {
+                mlock(mappedData(), static_cast<size_t>(mappedSize()));
+            }
+        }
+        
+        /** Copy the file into anonymous memory, backed by huge pages if requested and available, and serve all reads from the copy
+         *
+         * Returns the number of bytes held in memory. The copy is refreshed when reload() detects a size change. The
+         * pages of the copy are placed on the NUMA nodes according to placement.
+         */
+        OffsetType makeResident(bool useHugePages, NumaPlacement placement = NumaPlacement::Default) {
+            resident = true;
+            residentHugePages = useHugePages;
+            residentPlacement = placement;
+            copyResident();
+            return static_cast<OffsetType>(residentCopy.size());
+        }
+        
+        bool isResident() const {
+            return residentCopy.data() != nullptr;
+        }
+        
+        /** Read the file through PagedFile (io_uring or pread into anonymous memory) instead of the mmap page fault path,
+         * fetching the pages missing from the local file from the remote object if one is given
+         *
+         * Layered files keep their mapping, reading them into private memory would defeat sharing the base */
+        void usePagedBackend(uint32_t pageSize = PagedFile::defaultPageSize, PagedFileRemote remote = {}) {
+            if (layeredFile) {
+                return;
+            }
+            if (remote.source) {
+                pagedFile = std::make_unique<PagedFile>(fileInfo.path, pageSize, std::move(remote));
+            } else {
+                pagedFile = std::make_unique<PagedFile>(fileInfo.path, pageSize);
+            }
+            if (file.is_open()) {
+                file.unmap();
+            }
+        }
+        
+        bool isPaged() const {
+            return pagedFile != nullptr;
+        }
+        
+        bool usesHugeTLB() const {
+            return residentCopy.usesHugeTLB();
+        }
+        
+        /** Lock the mapped file into memory. Returns the number of bytes locked or 0 if mlock failed (eg. RLIMIT_MEMLOCK) */
+        OffsetType lockInMemory() {
+            if (mappedData() == nullptr || mappedSize() == 0) {
+                return 0;
+            }
+            if (mlock(mappedData(), static_cast<size_t>(mappedSize())) != 0) {
+                return 0;
+            }
+            locked = true;
+            return size();
+        }
+        
+        /** Set the access hint for the entire file. Persistent hints (everything except WillNeed and DontNeed) survive reload() */
+        void advise(AccessHint hint) {
+            if (hint != AccessHint::WillNeed && hint != AccessHint::DontNeed) {
+                accessHint = hint;
+            }
+            if (mappedData() != nullptr) {
+                adviseMappedRange(mappedData(), size(), hint);
+            }
+        }
+        
+        /** Apply the access hint to the byte range [offset, offset + length) of the file
+         *
+         * With the paged backend WillNeed loads the range, all other hints are ignored. */
+        void advise(AccessHint hint, OffsetType offset, OffsetType length) const {
+            if (pagedFile) {
+                if (hint == AccessHint::WillNeed) {
+                    pagedFile->ensureLoaded(offset, length);
+                }
+            } else if (mappedData() != nullptr && offset < size()) {
+                adviseMappedRange(mappedData() + offset, std::min(length, size() - offset), hint);
+            }
         }
         
         bool isGood() const {
-            return file.is_open();
+            return pagedFile ? pagedFile->isGood() : mappedData() != nullptr;
         }
         
         const char *getDataAtOffset(OffsetType offset) const {
+            return getDataAtOffset(offset, 1);
+        }
+        
+        /** Pointer to the data at offset, making sure that the following length bytes are readable */
+        const char *getDataAtOffset(OffsetType offset, OffsetType length) const {
             if (offset == InvalidFileIndex) {
                 return nullptr;
             }
             assert(offset < size());
-            return &file[offset];
+            if (pagedFile && residentCopy.data() == nullptr) {
+                pagedFile->ensureLoaded(offset, length);
+            }
+            return dataBegin() + offset;
         }
         
         OffsetType size() const {
-            return file.length();
+            return pagedFile ? pagedFile->size() : mappedSize();
         }
         
         void reload() {
-            if (fileInfo.exists()) {
+            if (pagedFile) {
+                if (fileInfo.exists() && fileInfo.size() != pagedFile->size()) {
+                    pagedFile->reopen();
+                }
+                return;
+            }
+            if (fileInfo.isLayered()) {
+                if (!layeredFile) {
+                    openFile();
+                    return;
+                }
+                // The layer picks up changes of its tail and patches itself
+                auto previousData = layeredFile->data();
+                auto previousSize = layeredFile->size();
+                layeredFile->reload();
+                if (layeredFile->data() != previousData || layeredFile->size() != previousSize) {
+                    openFile();
+                }
+            } else if (fileInfo.exists()) {
                 if (!file.is_open() || fileInfo.size() != file.size()) {
                     openFile();
                 }
             } else {
                 if (file.is_open()) {
                     file.unmap();
+                    residentCopy = AnonymousMemory();
                 }
             }
         }
@@ -185,11 +504,43 @@ namespace blocksci {
         OffsetType writePos;
         static constexpr OffsetType maxBufferSize = 50000000;
         std::vector<char> buffer;
+        std::unique_ptr<GrowableFile> growableFile;
+        
+        /** Writable mapping of a file stored as a layer over a shared base directory, replacing the regular mapping */
+        std::unique_ptr<LayeredFile> layeredFile;
+        
+        /** Chunks written to, whose checksums are taken again on destruction. Writes through a pointer from
+         * getDataAtOffset() without a length are assumed to stay within maxElementSize bytes (the size of a block) */
+        DirtyChunks dirtyChunks;
+        static constexpr OffsetType maxElementSize = 4000000;
+        
+        char *fileData() {
+            if (layeredFile) {
+                return layeredFile->data();
+            }
+            return growableFile ? growableFile->data() : file.data();
+        }
+        
+        const char *fileData() const {
+            if (layeredFile) {
+                return layeredFile->data();
+            }
+            return growableFile ? growableFile->data() : file.data();
+        }
+        
+        /** Layered files track the written extents of their base instead of checksums */
+        void markWritten(OffsetType offset, OffsetType length) {
+            if (layeredFile) {
+                layeredFile->markWritten(offset, length);
+            } else {
+                dirtyChunks.mark(offset, length);
+            }
+        }
         
         char *getWritePos() {
             auto fileEnd = fileSize();
             if (writePos < fileEnd) {
-                return &file[writePos];
+                return fileData() + writePos;
             } else if (writePos < fileEnd + bufferSize()) {
                 return reinterpret_cast<char *>(buffer.data()) + (writePos - fileEnd);
             } else {
@@ -211,6 +562,18 @@ namespace blocksci {
         OffsetType bufferSize() const {
             return static_cast<OffsetType>(buffer.size());
         }
+        
+        char *getMutableData(OffsetType offset) {
+            auto fileEnd = fileSize();
+            assert(offset < fileEnd + bufferSize() || offset == InvalidFileIndex);
+            if (offset == InvalidFileIndex) {
+                return nullptr;
+            } else if (offset < fileEnd) {
+                return fileData() + offset;
+            } else {
+                return buffer.data() + (offset - fileEnd);
+            }
+        }
     public:
         static constexpr auto mode = mio::access_mode::write;
         
@@ -220,6 +583,12 @@ namespace blocksci {
         }
         
         void openFile() {
+            if (fileInfo.isLayered()) {
+                if (!layeredFile) {
+                    layeredFile = std::make_unique<LayeredFile>(fileInfo.path, true);
+                }
+                return;
+            }
             std::error_code error;
             file.map(fileInfo.path.str(), 0, mio::map_entire_file, error);
 //            if(error) {
@@ -227,11 +596,37 @@ namespace blocksci {
 //            }
         }
         
+        /** Grow the file in place instead of staging appended data in a buffer, see GrowableFile
+         *
+         * The file is preallocated ahead of the written data while the mapper is alive and truncated to its
+         * logical size on destruction. Layered files keep their own mapping. */
+        void usePreallocatedGrowth() {
+            if (layeredFile) {
+                return;
+            }
+            clearBuffer();
+            if (file.is_open()) {
+                file.unmap();
+            }
+            growableFile = std::make_unique<GrowableFile>(fileInfo.path);
+        }
+        
+        bool isPreallocated() const {
+            return growableFile != nullptr;
+        }
+        
         bool isGood() const {
-            return file.is_open();
+            return growableFile || layeredFile ? true : file.is_open();
         }
         
         void reload() {
+            if (layeredFile) {
+                layeredFile->reload();
+                return;
+            }
+            if (growableFile) {
+                return;
+            }
             if (fileInfo.exists() && fileInfo.size() > 0) {
                 if (!file.is_open() || fileInfo.size() != file.size()) {
                     openFile();
@@ -245,13 +640,52 @@ namespace blocksci {
         
         ~SimpleFileMapper() {
             clearBuffer();
+            if (!dirtyChunks.empty()) {
+                // The checksums are taken from the file, which needs its final size for that
+                growableFile.reset();
+                if (file.is_open()) {
+                    file.unmap();
+                }
+                dirtyChunks.updateChecksums(fileInfo.path);
+            }
         }
         
         OffsetType getWriteOffset() const {
             return writePos;
         }
         
+        /** Extend the file by amount bytes at the write position and return a pointer to write them to directly
+         *
+         * The write position must be at the end of the file. The pointer stays valid until the next write. */
+        char *append(OffsetType amount) {
+            assert(writePos == size());
+            markWritten(writePos, amount);
+            if (growableFile) {
+                growableFile->resize(writePos + amount);
+                auto pos = growableFile->data() + writePos;
+                writePos += amount;
+                return pos;
+            }
+            if (bufferSize() + amount > maxBufferSize) {
+                clearBuffer();
+            }
+            buffer.resize(buffer.size() + static_cast<size_t>(amount));
+            auto pos = buffer.data() + (writePos - fileSize());
+            writePos += amount;
+            return pos;
+        }
+        
         bool write(const char *valuePos, OffsetType amountToWrite) {
+            markWritten(writePos, amountToWrite);
+            if (growableFile) {
+                auto writeEnd = writePos + amountToWrite;
+                if (writeEnd > growableFile->size()) {
+                    growableFile->resize(writeEnd);
+                }
+                memcpy(growableFile->data() + writePos, valuePos, static_cast<size_t>(amountToWrite));
+                writePos = writeEnd;
+                return false;
+            }
             auto fileEnd = fileSize();
             if (writePos < fileEnd) {
                 auto writeAmount = std::min(amountToWrite, writeSpace());
@@ -301,27 +735,42 @@ namespace blocksci {
         void clearBuffer() {
             if (buffer.size() > 0) {
                 auto oldEnd = fileSize();
-                if (!fileInfo.exists()) {
-                    fileInfo.create(static_cast<OffsetType>(buffer.size()));
+                if (layeredFile) {
+                    layeredFile->resize(oldEnd + static_cast<OffsetType>(buffer.size()));
                 } else {
-                    fileInfo.resize(oldEnd + static_cast<OffsetType>(buffer.size()));
+                    if (!fileInfo.exists()) {
+                        fileInfo.create(static_cast<OffsetType>(buffer.size()));
+                    } else {
+                        fileInfo.resize(oldEnd + static_cast<OffsetType>(buffer.size()));
+                    }
+                    reload();
                 }
-                reload();
-                memcpy(&file[oldEnd], buffer.data(), buffer.size());
+                memcpy(fileData() + oldEnd, buffer.data(), buffer.size());
                 buffer.clear();
             }
         }
         
         char *getDataAtOffset(OffsetType offset) {
-            auto fileEnd = fileSize();
-            assert(offset < fileEnd + bufferSize() || offset == InvalidFileIndex);
-            if (offset == InvalidFileIndex) {
-                return nullptr;
-            } else if (offset < fileEnd) {
-                return &file[offset];
-            } else {
-                return buffer.data() + (offset - fileEnd);
+            if (offset != InvalidFileIndex) {
+                markWritten(offset, maxElementSize);
             }
+            return getMutableData(offset);
+        }
+        
+        /** Pointer to write the length bytes at offset to */
+        char *getDataAtOffset(OffsetType offset, OffsetType length) {
+            if (offset != InvalidFileIndex) {
+                markWritten(offset, length);
+            }
+            return getMutableData(offset);
+        }
+        
+        const char *getDataAtOffset(OffsetType offset, OffsetType) const {
+            return getDataAtOffset(offset);
+        }
+        
+        bool isPaged() const {
+            return false;
         }
         
         const char *getDataAtOffset(OffsetType offset) const {
@@ -330,18 +779,21 @@ namespace blocksci {
             if (offset == InvalidFileIndex) {
                 return nullptr;
             } else if (offset < fileEnd) {
-                return &file[offset];
+                return fileData() + offset;
             } else {
                 return buffer.data() + (offset - fileEnd);
             }
         }
         
         OffsetType fileSize() const {
-            return file.length();
+            if (layeredFile) {
+                return layeredFile->size();
+            }
+            return growableFile ? growableFile->size() : static_cast<OffsetType>(file.length());
         }
         
         OffsetType size() const {
-            return file.length() + bufferSize();
+            return fileSize() + bufferSize();
         }
         
         void seekEnd() {
@@ -353,12 +805,27 @@ namespace blocksci {
         }
         
         void truncate(OffsetType offset) {
-            if (offset < fileSize()) {
+            if (layeredFile) {
+                if (offset < fileSize()) {
+                    buffer.clear();
+                    layeredFile->resize(offset);
+                } else if (offset < size()) {
+                    buffer.resize(static_cast<size_t>(offset - fileSize()));
+                } else if (offset > size()) {
+                    clearBuffer();
+                    layeredFile->resize(offset);
+                }
+                return;
+            }
+            dirtyChunks.markResized();
+            if (growableFile) {
+                growableFile->resize(offset);
+            } else if (offset < fileSize()) {
                 buffer.clear();
                 fileInfo.resize(offset);
                 reload();
             } else if (offset < size()) {
-                auto bufferToSave = offset - file.length();
+                auto bufferToSave = offset - fileSize();
                 buffer.resize(static_cast<size_t>(bufferToSave));
             } else if (offset > size()) {
                 clearBuffer();
@@ -399,14 +866,14 @@ namespace blocksci {
         
         const_pointer operator[](OffsetType index) const {
             assert(index < size());
-            const char *pos = dataFile.getDataAtOffset(getPos(index));
+            const char *pos = dataFile.getDataAtOffset(getPos(index), static_cast<OffsetType>(sizeof(T)));
             return reinterpret_cast<const_pointer>(pos);
         }
         
         template <typename Dummy = void, typename Dummy2 = std::enable_if_t<mode == mio::access_mode::write, Dummy>>
         pointer operator[](OffsetType index) {
             assert(index < size());
-            char *pos = dataFile.getDataAtOffset(getPos(index));
+            char *pos = dataFile.getDataAtOffset(getPos(index), static_cast<OffsetType>(sizeof(T)));
             return reinterpret_cast<pointer>(pos);
         }
 
@@ -430,10 +897,31 @@ namespace blocksci {
             dataFile.reload();
         }
         
+        void advise(AccessHint hint) {
+            dataFile.advise(hint);
+        }
+        
+        OffsetType makeResident(bool useHugePages, NumaPlacement placement = NumaPlacement::Default) {
+            return dataFile.makeResident(useHugePages, placement);
+        }
+        
+        bool usesHugeTLB() const {
+            return dataFile.usesHugeTLB();
+        }
+        
+        /** Apply the access hint to the elements [index, index + count) */
+        void advise(AccessHint hint, OffsetType index, OffsetType count) const {
+            dataFile.advise(hint, getPos(index), getPos(count));
+        }
+        
         void clearBuffer() {
             dataFile.clearBuffer();
         }
         
+        void usePreallocatedGrowth() {
+            dataFile.usePreallocatedGrowth();
+        }
+        
         bool write(const T &t) {
             return dataFile.write(t);
         }
@@ -539,6 +1027,15 @@ namespace blocksci {
             return offset;
         }
         
+        /** Pointer to the element at index stored at offset. The paged backend needs to know the full extent of the element */
+        const char *getElementPointer(uint32_t index, OffsetType offset) const {
+            if (dataFile.isPaged() && offset != InvalidFileIndex) {
+                auto end = index + 1 < size() ? getOffset(index + 1) : dataFile.size();
+                return dataFile.getDataAtOffset(offset, end - offset);
+            }
+            return dataFile.getDataAtOffset(offset);
+        }
+        
     public:
         explicit IndexedFileMapper(const filesystem::path &pathPrefix) : dataFile(pathPrefix.str() + "_data"), indexFile(pathPrefix.str() + "_index") {
         }
@@ -548,11 +1045,120 @@ namespace blocksci {
             dataFile.reload();
         }
         
+        void adviseData(AccessHint hint) {
+            dataFile.advise(hint);
+        }
+        
+        void adviseIndex(AccessHint hint) {
+            indexFile.advise(hint);
+        }
+        
+        /** Read the data file through PagedFile instead of mmap, see SimpleFileMapper::usePagedBackend() */
+        void usePagedDataBackend(uint32_t pageSize = PagedFile::defaultPageSize, PagedFileRemote remote = {}) {
+            static_assert(indexCount == 1, "The paged backend requires that elements are stored contiguously in index order");
+            dataFile.usePagedBackend(pageSize, std::move(remote));
+        }
+        
+        /** Copy the index file into (huge page backed) memory so that only the data access can miss the TLB */
+        OffsetType makeIndexResident(bool useHugePages, NumaPlacement placement = NumaPlacement::Default) {
+            return indexFile.makeResident(useHugePages, placement);
+        }
+        
+        bool indexUsesHugeTLB() const {
+            return indexFile.usesHugeTLB();
+        }
+        
+        OffsetType lockData() {
+            return dataFile.lockInMemory();
+        }
+        
+        /** Fetch the primary element of every index in indexes, returned in the same order as indexes
+         *
+         * The lookups are performed in sorted order and the pages they touch in the index and data file are announced
+         * to the kernel (MADV_WILLNEED) for the whole batch up front, so the page faults of a random-order batch overlap
+         * instead of being serviced one after another.
+         */
+        std::vector<add_const_ptr_t<nth_element<0>>> getDataBatch(const std::vector<uint32_t> &indexes) const {
+            // Entries closer than this are announced to the kernel as one range
+            constexpr OffsetType mergeDistance = 16384;
+            
+            std::vector<uint32_t> order(indexes.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+                return indexes[a] < indexes[b];
+            });
+            
+            auto adviseRuns = [&](auto &&getPosition, OffsetType elementSize, auto &&adviseRange) {
+                size_t i = 0;
+                while (i < order.size()) {
+                    OffsetType runBegin = getPosition(order[i]);
+                    OffsetType runEnd = runBegin + elementSize;
+                    size_t j = i + 1;
+                    while (j < order.size() && getPosition(order[j]) <= runEnd + mergeDistance) {
+                        runEnd = std::max(runEnd, getPosition(order[j]) + elementSize);
+                        j++;
+                    }
+                    adviseRange(runBegin, runEnd - runBegin);
+                    i = j;
+                }
+            };
+            
+            constexpr auto indexEntrySize = static_cast<OffsetType>(sizeof(FileIndex<indexCount>));
+            adviseRuns([&](uint32_t i) { return static_cast<OffsetType>(indexes[i]) * indexEntrySize; }, indexEntrySize, [&](OffsetType begin, OffsetType length) {
+                indexFile.advise(AccessHint::WillNeed, begin / indexEntrySize, length / indexEntrySize);
+            });
+            
+            std::vector<OffsetType> offsets(indexes.size());
+            for (auto i : order) {
+                assert(indexes[i] < size());
+                offsets[i] = getOffset(indexes[i]);
+            }
+            
+            adviseRuns([&](uint32_t i) { return offsets[i]; }, static_cast<OffsetType>(sizeof(nth_element<0>)), [&](OffsetType begin, OffsetType length) {
+                dataFile.advise(AccessHint::WillNeed, begin, length);
+            });
+            
+            std::vector<add_const_ptr_t<nth_element<0>>> results(indexes.size());
+            for (auto i : order) {
+                auto pointer = getElementPointer(indexes[i], offsets[i]);
+                __builtin_prefetch(pointer);
+                results[i] = reinterpret_cast<add_const_ptr_t<nth_element<0>>>(pointer);
+            }
+            return results;
+        }
+        
+        /** Apply the access hint to the index entries and the primary data of the elements [beginIndex, endIndex) */
+        void advise(AccessHint hint, uint32_t beginIndex, uint32_t endIndex) const {
+            if (beginIndex >= endIndex || beginIndex >= size()) {
+                return;
+            }
+            indexFile.advise(hint, beginIndex, endIndex - beginIndex);
+            auto beginOffset = getOffset(beginIndex);
+            auto endOffset = endIndex < size() ? getOffset(endIndex) : dataFile.size();
+            dataFile.advise(hint, beginOffset, endOffset - beginOffset);
+        }
+        
+        /** Bytes of primary data and index entries of the elements [beginIndex, endIndex) */
+        OffsetType dataBytes(uint32_t beginIndex, uint32_t endIndex) const {
+            if (beginIndex >= endIndex || beginIndex >= size()) {
+                return 0;
+            }
+            auto beginOffset = getOffset(beginIndex);
+            auto endOffset = endIndex < size() ? getOffset(endIndex) : dataFile.size();
+            auto indexBytes = static_cast<OffsetType>((std::min<OffsetType>(endIndex, size()) - beginIndex) * sizeof(FileIndex<sizeof...(T)>));
+            return endOffset - beginOffset + indexBytes;
+        }
+        
         void clearBuffer() {
             indexFile.clearBuffer();
             dataFile.clearBuffer();
         }
         
+        void usePreallocatedGrowth() {
+            indexFile.usePreallocatedGrowth();
+            dataFile.usePreallocatedGrowth();
+        }
+        
         FileIndex<sizeof...(T)> getOffsets(uint32_t index) const {
             return *indexFile[index];
         }
@@ -565,6 +1171,15 @@ namespace blocksci {
             return indexFile.fileSize();
         }
         
+        /** The index and data files, for handing out their memory as a whole (@see blocksci::columnData) */
+        const FixedSizeFileMapper<FileIndex<indexCount>, mode> &getIndexFile() const {
+            return indexFile;
+        }
+        
+        const SimpleFileMapper<mode> &getDataFile() const {
+            return dataFile;
+        }
+        
         void truncate(uint32_t index) {
             if (index < size()) {
                 auto offsets = getOffsets(index);
@@ -573,6 +1188,17 @@ namespace blocksci {
             }
         }
         
+        /** Truncate the index to index entries but keep the data, which can hold later components of older entries */
+        void truncateIndex(uint32_t index) {
+            if (index < size()) {
+                indexFile.truncate(index);
+            }
+        }
+        
+        void setOffsets(uint32_t index, const FileIndex<sizeof...(T)> &offsets) {
+            *indexFile[index] = offsets;
+        }
+        
         void seekEnd() {
             indexFile.seekEnd();
             dataFile.seekEnd();
@@ -612,7 +1238,7 @@ namespace blocksci {
         add_const_ptr_t<nth_element<indexNum>> getDataAtIndex(uint32_t index) const {
             assert(index < size());
             auto offset = getOffset<indexNum>(index);
-            auto pointer = dataFile.getDataAtOffset(offset);
+            auto pointer = indexCount == 1 ? getElementPointer(index, offset) : dataFile.getDataAtOffset(offset);
             return reinterpret_cast<add_const_ptr_t<nth_element<indexNum>>>(pointer);
         }
         
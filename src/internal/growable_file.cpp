@@ -0,0 +1,129 @@
+//
+//  growable_file.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include "growable_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+namespace blocksci {
+
+    namespace {
+        [[noreturn]] void throwFileError(const std::string &action, const filesystem::path &path, int error) {
+            std::stringstream ss;
+            ss << "Error " << action << " " << path.str() << ": " << std::strerror(error);
+            throw std::runtime_error(ss.str());
+        }
+
+        int64_t roundToPage(int64_t size) {
+            static const auto pageSize = static_cast<int64_t>(sysconf(_SC_PAGESIZE));
+            return (size + pageSize - 1) / pageSize * pageSize;
+        }
+    }
+
+    GrowableFile::GrowableFile(const filesystem::path &path_) : path(path_) {
+        fd = ::open(path.str().c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            throwFileError("opening", path, errno);
+        }
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) != 0) {
+            auto error = errno;
+            ::close(fd);
+            throwFileError("opening", path, error);
+        }
+        logicalSize = static_cast<int64_t>(fileStat.st_size);
+        highWater = logicalSize;
+        if (logicalSize > 0) {
+            auto newMapping = mmap(nullptr, static_cast<size_t>(logicalSize), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (newMapping == MAP_FAILED) {
+                auto error = errno;
+                ::close(fd);
+                throwFileError("mapping", path, error);
+            }
+            mapping = static_cast<char *>(newMapping);
+            mappedLength = logicalSize;
+        }
+    }
+
+    GrowableFile::~GrowableFile() {
+        if (mapping != nullptr) {
+            munmap(mapping, static_cast<size_t>(mappedLength));
+        }
+        if (fd >= 0) {
+            // Drop the preallocated tail. A failure can't be reported from a destructor
+            auto ret = ftruncate(fd, static_cast<off_t>(logicalSize));
+            (void)ret;
+            ::close(fd);
+        }
+    }
+
+    void GrowableFile::allocate(int64_t newCapacity) {
+#ifdef __linux__
+        auto ret = fallocate(fd, 0, static_cast<off_t>(mappedLength), static_cast<off_t>(newCapacity - mappedLength));
+        if (ret != 0 && errno != EOPNOTSUPP) {
+            throwFileError("allocating", path, errno);
+        }
+        if (ret == 0) {
+            return;
+        }
+#endif
+        // Filesystem without fallocate support, fall back to a sparse extension
+        if (ftruncate(fd, static_cast<off_t>(newCapacity)) != 0) {
+            throwFileError("resizing", path, errno);
+        }
+    }
+
+    void GrowableFile::reserve(int64_t newCapacity) {
+        if (newCapacity <= mappedLength) {
+            return;
+        }
+        auto growth = std::min(std::max(mappedLength, minimumGrowth), maximumGrowth);
+        newCapacity = roundToPage(std::max(newCapacity, mappedLength + growth));
+        allocate(newCapacity);
+        void *newMapping;
+#ifdef MREMAP_MAYMOVE
+        if (mapping != nullptr) {
+            newMapping = mremap(mapping, static_cast<size_t>(mappedLength), static_cast<size_t>(newCapacity), MREMAP_MAYMOVE);
+        } else {
+            newMapping = mmap(nullptr, static_cast<size_t>(newCapacity), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+#else
+        if (mapping != nullptr) {
+            munmap(mapping, static_cast<size_t>(mappedLength));
+        }
+        newMapping = mmap(nullptr, static_cast<size_t>(newCapacity), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+#endif
+        if (newMapping == MAP_FAILED) {
+            mapping = nullptr;
+            mappedLength = 0;
+            throwFileError("mapping", path, errno);
+        }
+        mapping = static_cast<char *>(newMapping);
+        mappedLength = newCapacity;
+    }
+
+    void GrowableFile::resize(int64_t newSize) {
+        if (newSize > logicalSize) {
+            reserve(newSize);
+            auto zeroEnd = std::min(newSize, highWater);
+            if (zeroEnd > logicalSize) {
+                std::memset(mapping + logicalSize, 0, static_cast<size_t>(zeroEnd - logicalSize));
+            }
+        }
+        logicalSize = newSize;
+        highWater = std::max(highWater, logicalSize);
+    }
+} // namespace blocksci
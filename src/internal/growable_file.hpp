@@ -0,0 +1,73 @@
+//
+//  growable_file.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_growable_file_hpp
+#define blocksci_growable_file_hpp
+
+#include <wjfilesystem/path.h>
+
+#include <cstdint>
+
+namespace blocksci {
+
+    /** Writable memory mapping of a file that grows in place
+     *
+     * Disk space is preallocated geometrically with fallocate and the mapping is extended with mremap, so appending
+     * never copies data through an intermediate buffer or remaps the whole file. Callers write directly into the
+     * mapping. The file on disk is larger than its logical size while the GrowableFile is open and is truncated back
+     * to the logical size when it is destroyed. Growing may move the mapping, which invalidates outstanding pointers.
+     */
+    class GrowableFile {
+    public:
+        /** Growth is proportional to the current size, clamped to [minimumGrowth, maximumGrowth] */
+        static constexpr int64_t minimumGrowth = int64_t{64} << 20;
+        static constexpr int64_t maximumGrowth = int64_t{4} << 30;
+
+        explicit GrowableFile(const filesystem::path &path);
+        GrowableFile(const GrowableFile &) = delete;
+        GrowableFile &operator=(const GrowableFile &) = delete;
+        ~GrowableFile();
+
+        char *data() {
+            return mapping;
+        }
+
+        const char *data() const {
+            return mapping;
+        }
+
+        /** Logical size of the file */
+        int64_t size() const {
+            return logicalSize;
+        }
+
+        /** Bytes allocated on disk and mapped */
+        int64_t capacity() const {
+            return mappedLength;
+        }
+
+        /** Make sure that at least newCapacity bytes are allocated and mapped */
+        void reserve(int64_t newCapacity);
+
+        /** Change the logical size, bytes exposed by growing read as zero */
+        void resize(int64_t newSize);
+
+    private:
+        filesystem::path path;
+        int fd = -1;
+        char *mapping = nullptr;
+        int64_t mappedLength = 0;
+        int64_t logicalSize = 0;
+
+        /** Bytes at or past this offset have never been written since they were allocated and are zero */
+        int64_t highWater = 0;
+
+        void allocate(int64_t newCapacity);
+    };
+} // namespace blocksci
+
+#endif /* blocksci_growable_file_hpp */
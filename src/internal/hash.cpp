@@ -7,12 +7,91 @@
 //
 
 #include "hash.hpp"
+#include "sha256_kernels.hpp"
 
 #include <blocksci/core/bitcoin_uint256.hpp>
 
 #include <openssl/sha.h>
 #include <openssl/ripemd.h>
 
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    using namespace blocksci::sha256_kernels;
+
+    void writeDigest(const uint32_t state[8], unsigned char *digest) {
+        for (int i = 0; i < 8; i++) {
+            digest[4 * i] = static_cast<unsigned char>(state[i] >> 24);
+            digest[4 * i + 1] = static_cast<unsigned char>(state[i] >> 16);
+            digest[4 * i + 2] = static_cast<unsigned char>(state[i] >> 8);
+            digest[4 * i + 3] = static_cast<unsigned char>(state[i]);
+        }
+    }
+
+    /** Incremental SHA256 on top of transformShani */
+    class ShaniHasher {
+        uint32_t state[8];
+        unsigned char buffer[blockSize];
+        size_t buffered = 0;
+        uint64_t totalLength = 0;
+
+    public:
+        ShaniHasher() {
+            std::memcpy(state, initialState, sizeof(state));
+        }
+
+        void update(const unsigned char *data, size_t length) {
+            if (length == 0) {
+                return;
+            }
+            totalLength += length;
+            if (buffered > 0) {
+                size_t taken = std::min(length, blockSize - buffered);
+                std::memcpy(buffer + buffered, data, taken);
+                buffered += taken;
+                data += taken;
+                length -= taken;
+                if (buffered < blockSize) {
+                    return;
+                }
+                transformShani(state, buffer, 1);
+                buffered = 0;
+            }
+            size_t blockCount = length / blockSize;
+            transformShani(state, data, blockCount);
+            data += blockCount * blockSize;
+            length -= blockCount * blockSize;
+            std::memcpy(buffer, data, length);
+            buffered = length;
+        }
+
+        void finish(unsigned char *digest) {
+            uint64_t bitLength = totalLength * 8;
+            unsigned char padding[blockSize + 8] = {0x80};
+            size_t paddingLength = buffered < blockSize - 8 ? blockSize - 8 - buffered : 2 * blockSize - 8 - buffered;
+            for (int i = 0; i < 8; i++) {
+                padding[paddingLength + static_cast<size_t>(i)] = static_cast<unsigned char>(bitLength >> (56 - 8 * i));
+            }
+            update(padding, paddingLength + 8);
+            writeDigest(state, digest);
+        }
+    };
+
+    /** SHA256 of a 32 byte message which is a single block after padding */
+    void sha256Of32Shani(const unsigned char *in, unsigned char *out) {
+        unsigned char block[blockSize] = {};
+        std::memcpy(block, in, 32);
+        block[32] = 0x80;
+        // Message length of 256 bits
+        block[62] = 0x01;
+        uint32_t state[8];
+        std::memcpy(state, initialState, sizeof(state));
+        transformShani(state, block, 1);
+        writeDigest(state, out);
+    }
+}
+
 
 blocksci::uint256 sha256(const uint8_t *data, size_t len) {
     blocksci::uint256 hash;
@@ -34,11 +113,47 @@ bool base58_sha256(void *digest, const void *data, size_t datasz) {
 }
 
 blocksci::uint256 doubleSha256(const char *data, uint64_t len) {
-    blocksci::uint256 txHash = sha256(reinterpret_cast<const uint8_t *>(data), len);
-    txHash = sha256(reinterpret_cast<const uint8_t *>(&txHash), sizeof(blocksci::uint256));
+    HashInput input{{data, nullptr, nullptr}, {len, 0, 0}};
+    blocksci::uint256 txHash;
+    doubleSha256Batch(&input, 1, &txHash);
     return txHash;
 }
 
+void doubleSha256Batch(const HashInput *inputs, size_t count, blocksci::uint256 *out) {
+    auto digests = reinterpret_cast<unsigned char *>(out);
+    if (hasShani()) {
+        for (size_t i = 0; i < count; i++) {
+            ShaniHasher hasher;
+            for (size_t j = 0; j < 3; j++) {
+                hasher.update(static_cast<const unsigned char *>(inputs[i].parts[j]), inputs[i].lengths[j]);
+            }
+            auto digest = digests + sizeof(blocksci::uint256) * i;
+            hasher.finish(digest);
+            sha256Of32Shani(digest, digest);
+        }
+        return;
+    }
+    
+    for (size_t i = 0; i < count; i++) {
+        SHA256_CTX sha256CTX;
+        SHA256_Init(&sha256CTX);
+        for (size_t j = 0; j < 3; j++) {
+            SHA256_Update(&sha256CTX, inputs[i].parts[j], inputs[i].lengths[j]);
+        }
+        SHA256_Final(digests + sizeof(blocksci::uint256) * i, &sha256CTX);
+    }
+    size_t i = 0;
+    if (hasAvx2()) {
+        for (; i + avx2Lanes <= count; i += avx2Lanes) {
+            auto batch = digests + sizeof(blocksci::uint256) * i;
+            sha256Of32x8Avx2(batch, batch);
+        }
+    }
+    for (; i < count; i++) {
+        out[i] = sha256(reinterpret_cast<const uint8_t *>(&out[i]), sizeof(blocksci::uint256));
+    }
+}
+
 blocksci::uint160 ripemd160(const char *data, uint64_t len) {
     blocksci::uint160 hash;
     RIPEMD160_CTX ripemd;
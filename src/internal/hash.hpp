@@ -23,6 +23,18 @@ blocksci::uint256 doubleSha256(const char *data, uint64_t len);
 blocksci::uint160 ripemd160(const char *data, uint64_t len);
 blocksci::uint160 hash160(const void *data, uint64_t len);
 
+/** Message made of up to three consecutive pieces of memory, eg. a transaction stripped of its witness data */
+struct HashInput {
+    const void *parts[3];
+    uint64_t lengths[3];
+};
+
+/** Double SHA256 of count messages, written to out[0..count)
+ *
+ * Uses the SHA extensions for the variable length first round if the CPU has them and hashes the fixed size second
+ * round of eight messages at a time with AVX2 otherwise. Falls back to OpenSSL on other CPUs. */
+void doubleSha256Batch(const HashInput *inputs, size_t count, blocksci::uint256 *out);
+
 bool base58_sha256(void *digest, const void *data, size_t datasz);
 
 #endif /* hash_hpp */
@@ -7,18 +7,29 @@
 //
 
 #include "hash_index.hpp"
+#include "access_stats.hpp"
 #include "column_iterator.hpp"
+#include "column_scan.hpp"
+#include "index_open.hpp"
+#include "segment_work.hpp"
+#include "sst_bulk_loader.hpp"
+#include "tx_hash_table.hpp"
 
 #include <blocksci/core/bitcoin_uint256.hpp>
 
 #include <range/v3/view/transform.hpp>
 
+#include <rocksdb/cache.h>
 #include <rocksdb/table.h>
 #include <rocksdb/filter_policy.h>
 #include <rocksdb/slice_transform.h>
 #include <rocksdb/table_properties.h>
+#include <rocksdb/version.h>
 
+#include <algorithm>
 #include <array>
+#include <numeric>
+#include <vector>
 //
 //namespace {
 //    void OptimizeForPointLookup(rocksdb::ColumnFamilyOptions &options, std::shared_ptr<rocksdb::Cache> cache) {
@@ -34,7 +45,7 @@
 
 namespace blocksci {
     
-    HashIndex::HashIndex(const filesystem::path &path, bool readonly) {
+    HashIndex::HashIndex(const filesystem::path &path, IndexOpenMode mode, std::shared_ptr<rocksdb::Cache> blockCache, const IndexTuning &tuning) : openMode(mode) {
         rocksdb::Options options;
         // Optimize RocksDB. This is the easiest way to get RocksDB to perform well
         options.IncreaseParallelism();
@@ -44,42 +55,90 @@ namespace blocksci {
         options.create_if_missing = true;
         options.create_missing_column_families = true;
         
-        auto cache = rocksdb::NewLRUCache(static_cast<size_t>(1024 * 1024 * 1024));
+        rocksdb::BlockBasedTableOptions tableOptions;
+        if (blockCache) {
+            tableOptions.block_cache = std::move(blockCache);
+        } else if (tuning.interactive) {
+            tableOptions.block_cache = rocksdb::NewLRUCache(interactiveBlockCacheSize);
+        }
+        applyIndexTuning(tuning, options, columnOptions, tableOptions);
+        if (tableOptions.block_cache || !tuning.isDefault()) {
+            columnOptions.table_factory.reset(rocksdb::NewBlockBasedTableFactory(tableOptions));
+        }
 
         // Initialize RocksDB column families
         std::vector<rocksdb::ColumnFamilyDescriptor> columnDescriptors;
         columnDescriptors.reserve(AddressType::size + 2);
         for_each(AddressType::all(), [&](auto tag) {
-            columnDescriptors.emplace_back(addressName(tag), rocksdb::ColumnFamilyOptions{});
+            columnDescriptors.emplace_back(addressName(tag), columnOptions);
         });
-        auto txOptions = rocksdb::ColumnFamilyOptions{};
         columnDescriptors.emplace_back(rocksdb::kDefaultColumnFamilyName, rocksdb::ColumnFamilyOptions{});
-        columnDescriptors.emplace_back("T", txOptions);
+        columnDescriptors.emplace_back("T", columnOptions);
         
-        rocksdb::DB *dbPtr;
-        std::vector<rocksdb::ColumnFamilyHandle *> columnHandlePtrs;
-        if (readonly) {
-            rocksdb::Status s = rocksdb::DB::OpenForReadOnly(options, path.str().c_str(), columnDescriptors, &columnHandlePtrs, &dbPtr);
-            if (!s.ok()) {
-                throw std::runtime_error{"Could not open hash index with error: " + std::string{s.getState()}};
-            }
+        db = openIndexDB(options, path, mode, columnDescriptors, columnHandles, "hash index");
+        warmup = startIndexWarmup(tuning, mode, *db, columnHandles);
+    }
+    
+    HashIndex::~HashIndex() = default;
+    
+    void HashIndex::catchUpWithPrimary() {
+        blocksci::catchUpWithPrimary(*db, openMode, "hash index");
+    }
+    
+    void HashIndex::useTxHashTable(const filesystem::path &path, std::function<const uint256 *(uint32_t)> txHashSource_) {
+        auto table = std::make_unique<TxHashTable>(path);
+        if (table->isGood()) {
+            txHashTable = std::move(table);
+            txHashSource = std::move(txHashSource_);
         } else {
-            rocksdb::Status s = rocksdb::DB::Open(options, path.str().c_str(), columnDescriptors, &columnHandlePtrs, &dbPtr);
-            if (!s.ok()) {
-                throw std::runtime_error{"Could not open hash index with error: " + std::string{s.getState()}};
-            }
+            txHashTable.reset();
+            txHashSource = nullptr;
         }
-        db = std::unique_ptr<rocksdb::DB>(dbPtr);
-        for (auto handle : columnHandlePtrs) {
-            columnHandles.emplace_back(std::unique_ptr<rocksdb::ColumnFamilyHandle>(handle));
+    }
+    
+    uint32_t HashIndex::txHashTableCount() const {
+        return txHashTable ? txHashTable->txCount() : 0;
+    }
+    
+    std::shared_ptr<rocksdb::Cache> HashIndex::getBlockCache() const {
+        // Without a configured cache the table factory created RocksDB's default one
+        auto tableOptions = columnOptions.table_factory->GetOptions<rocksdb::BlockBasedTableOptions>();
+        return tableOptions ? tableOptions->block_cache : nullptr;
+    }
+    
+    void HashIndex::writeBatch(rocksdb::WriteBatch &batch) {
+        if (bulkLoader) {
+            std::lock_guard<std::mutex> lock(bulkLoaderMutex);
+            bulkLoader->add(batch);
+            return;
         }
+        rocksdb::WriteOptions options;
+        options.disableWAL = true;
+        db->Write(options, &batch);
     }
     
-    HashIndex::~HashIndex() = default;
+    void HashIndex::beginBulkLoad() {
+        std::vector<rocksdb::ColumnFamilyHandle *> handles;
+        for (auto &handle : columnHandles) {
+            handles.push_back(handle.get());
+        }
+        bulkLoader = std::make_unique<SstBulkLoader>(db.get(), handles, filesystem::path{db->GetName() + "Bulk"});
+    }
+    
+    void HashIndex::finishBulkLoad() {
+        if (bulkLoader) {
+            bulkLoader->finish();
+            bulkLoader.reset();
+        }
+    }
     
-    void HashIndex::compactDB() {
+    void HashIndex::compactDB(bool rewriteTableFiles) {
+        rocksdb::CompactRangeOptions compactOptions;
+        if (rewriteTableFiles) {
+            compactOptions.bottommost_level_compaction = rocksdb::BottommostLevelCompaction::kForce;
+        }
         for (auto &column : columnHandles) {
-            db->CompactRange(rocksdb::CompactRangeOptions{}, column.get(), nullptr, nullptr);
+            db->CompactRange(compactOptions, column.get(), nullptr, nullptr);
         }
     }
     
@@ -93,22 +152,70 @@ namespace blocksci {
         writeBatch(batch);
     }
     
-    uint32_t HashIndex::countColumn(AddressType::Enum type) {
-        uint32_t keyCount = 0;
-        auto it = getIterator(type);
-        for (it->SeekToFirst(); it->Valid(); it->Next()) {
-            keyCount++;
+    void HashIndex::resetColumn(std::unique_ptr<rocksdb::ColumnFamilyHandle> &handle) {
+        // Dropping the column family discards its files at once instead of writing a tombstone for every row
+        auto name = handle->GetName();
+        auto s = db->DropColumnFamily(handle.get());
+        if (!s.ok()) {
+            throw std::runtime_error{"Could not clear column " + name + " with error: " + s.ToString()};
+        }
+        handle.reset();
+        rocksdb::ColumnFamilyHandle *newHandle;
+        s = db->CreateColumnFamily(columnOptions, name, &newHandle);
+        if (!s.ok()) {
+            throw std::runtime_error{"Could not recreate column " + name + " with error: " + s.ToString()};
+        }
+        handle.reset(newHandle);
+    }
+    
+    void HashIndex::clearTxes() {
+        resetColumn(getTxColumn());
+    }
+    
+    void HashIndex::clearAddressColumn(AddressType::Enum type) {
+        resetColumn(getColumn(type));
+    }
+    
+    void HashIndex::removeTxes(const std::vector<uint256> &txHashes) {
+        rocksdb::WriteBatch batch;
+        for (const auto &hash : txHashes) {
+            batch.Delete(getTxColumn().get(), rocksdb::Slice(reinterpret_cast<const char *>(&hash), sizeof(hash)));
+        }
+        writeBatch(batch);
+    }
+    
+    void HashIndex::removeAddresses(DedupAddressType::Enum type, const std::vector<MemoryView> &keys) {
+        removeAddressesImpl(getColumn(type).get(), keys);
+    }
+    
+    void HashIndex::removeAddressesImpl(rocksdb::ColumnFamilyHandle *handle, const std::vector<MemoryView> &keys) {
+        rocksdb::WriteBatch batch;
+        for (const auto &key : keys) {
+            batch.Delete(handle, rocksdb::Slice(key.data, key.size));
         }
-        return keyCount;
+        writeBatch(batch);
     }
     
-    uint32_t HashIndex::countTxes() {
-        uint32_t keyCount = 0;
-        auto it = getTxIterator();
-        for (it->SeekToFirst(); it->Valid(); it->Next()) {
-            keyCount++;
+    namespace {
+        uint32_t countKeys(rocksdb::DB *db, rocksdb::ColumnFamilyHandle *column, uint32_t threadCount) {
+            std::vector<uint64_t> threadCounts(resolveThreadCount(threadCount), 0);
+            scanColumnParallel(db, column, threadCount, [&threadCounts](uint32_t threadNum, rocksdb::Iterator &it) {
+                uint64_t keyCount = 0;
+                for (; it.Valid(); it.Next()) {
+                    keyCount++;
+                }
+                threadCounts[threadNum] += keyCount;
+            });
+            return static_cast<uint32_t>(std::accumulate(threadCounts.begin(), threadCounts.end(), uint64_t{0}));
         }
-        return keyCount;
+    }
+    
+    uint32_t HashIndex::countColumn(AddressType::Enum type, uint32_t threadCount) {
+        return countKeys(db.get(), getColumn(type).get(), threadCount);
+    }
+    
+    uint32_t HashIndex::countTxes(uint32_t threadCount) {
+        return countKeys(db.get(), getTxColumn().get(), threadCount);
     }
     
     ranges::any_view<std::pair<MemoryView, MemoryView>> HashIndex::getRawAddressRange(AddressType::Enum type) {
@@ -127,11 +234,97 @@ namespace blocksci {
         return lookupAddress<AddressType::WITNESS_SCRIPTHASH>(scripthash);
     }
     
+    ranges::optional<uint32_t> HashIndex::getTaprootIndex(const uint256 &outputKey) {
+        return lookupAddress<AddressType::WITNESS_TAPROOT>(outputKey);
+    }
+    
     ranges::optional<uint32_t> HashIndex::getTxIndex(const uint256 &txHash) {
+        BLOCKSCI_COUNT_ACCESS(HashIndexLookup);
+        if (txHashTable) {
+            auto txNum = txHashTable->find(txHash, txHashSource);
+            if (txNum) {
+                return txNum;
+            }
+        }
         return getMatch(getTxColumn().get(), txHash);
     }
     
+    std::vector<ranges::optional<uint32_t>> HashIndex::getTxIndexes(const std::vector<uint256> &txHashes) {
+        // A batch counts as one lookup
+        BLOCKSCI_COUNT_ACCESS(HashIndexLookup);
+        if (!txHashTable) {
+            return getMatches(getTxColumn().get(), reinterpret_cast<const char *>(txHashes.data()), sizeof(uint256), txHashes.size());
+        }
+        
+        // Buckets are prefetched a few hashes ahead so that the cache misses of consecutive lookups overlap
+        constexpr size_t prefetchDistance = 8;
+        std::vector<ranges::optional<uint32_t>> results(txHashes.size());
+        std::vector<uint256> missing;
+        std::vector<size_t> missingPositions;
+        for (size_t i = 0; i < txHashes.size(); i++) {
+            if (i + prefetchDistance < txHashes.size()) {
+                txHashTable->prefetch(txHashes[i + prefetchDistance]);
+            }
+            results[i] = txHashTable->find(txHashes[i], txHashSource);
+            if (!results[i]) {
+                missing.push_back(txHashes[i]);
+                missingPositions.push_back(i);
+            }
+        }
+        if (!missing.empty()) {
+            auto tailResults = getMatches(getTxColumn().get(), reinterpret_cast<const char *>(missing.data()), sizeof(uint256), missing.size());
+            for (size_t i = 0; i < missing.size(); i++) {
+                results[missingPositions[i]] = tailResults[i];
+            }
+        }
+        return results;
+    }
+    
+    std::vector<ranges::optional<uint32_t>> HashIndex::getMatches(rocksdb::ColumnFamilyHandle *handle, const char *data, size_t keySize, size_t count) {
+        // Bounds the memory pinned by the values of one MultiGet call
+        constexpr size_t maxBatchSize = 4096;
+        
+        // Sorted keys let RocksDB resolve neighbouring keys of a batch from the same data blocks
+        std::vector<size_t> order(count);
+        std::iota(order.begin(), order.end(), size_t{0});
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return memcmp(data + a * keySize, data + b * keySize, keySize) < 0;
+        });
+        
+        rocksdb::ReadOptions readOptions;
+#if ROCKSDB_MAJOR >= 7
+        // Reads of the data blocks of one batch are issued in parallel
+        readOptions.async_io = true;
+#endif
+        
+        std::vector<ranges::optional<uint32_t>> results(count);
+        std::vector<rocksdb::Slice> keys;
+        std::vector<rocksdb::PinnableSlice> values(std::min(count, maxBatchSize));
+        std::vector<rocksdb::Status> statuses(values.size());
+        keys.reserve(values.size());
+        for (size_t batchStart = 0; batchStart < count; batchStart += maxBatchSize) {
+            auto batchSize = std::min(maxBatchSize, count - batchStart);
+            keys.clear();
+            for (size_t i = 0; i < batchSize; i++) {
+                keys.emplace_back(data + order[batchStart + i] * keySize, keySize);
+            }
+            db->MultiGet(readOptions, handle, batchSize, keys.data(), values.data(), statuses.data(), true);
+            for (size_t i = 0; i < batchSize; i++) {
+                if (statuses[i].ok()) {
+                    uint32_t value;
+                    memcpy(&value, values[i].data(), sizeof(value));
+                    results[order[batchStart + i]] = value;
+                } else if (!statuses[i].IsNotFound()) {
+                    throw std::runtime_error{"Could not read from hash index with error: " + statuses[i].ToString()};
+                }
+                values[i].Reset();
+            }
+        }
+        return results;
+    }
+    
     ranges::optional<uint32_t> HashIndex::lookupAddressImpl(blocksci::AddressType::Enum type, const char *data, size_t size) {
+        BLOCKSCI_COUNT_ACCESS(HashIndexLookup);
         return getAddressMatch(type, data, size);
     }
 
@@ -160,4 +353,5 @@ namespace blocksci {
     template ranges::any_view<std::pair<uint32_t, typename blocksci::AddressInfo<AddressType::SCRIPTHASH>::IDType>> HashIndex::getAddressRange<AddressType::SCRIPTHASH>();
     template ranges::any_view<std::pair<uint32_t, typename blocksci::AddressInfo<AddressType::WITNESS_SCRIPTHASH>::IDType>> HashIndex::getAddressRange<AddressType::WITNESS_SCRIPTHASH>();
     template ranges::any_view<std::pair<uint32_t, typename blocksci::AddressInfo<AddressType::MULTISIG>::IDType>> HashIndex::getAddressRange<AddressType::MULTISIG>();
+    template ranges::any_view<std::pair<uint32_t, typename blocksci::AddressInfo<AddressType::WITNESS_TAPROOT>::IDType>> HashIndex::getAddressRange<AddressType::WITNESS_TAPROOT>();
 }
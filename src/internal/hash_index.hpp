@@ -10,6 +10,7 @@
 #define blocksci_index_hash_index_hpp
 
 #include "address_info.hpp"
+#include "index_open.hpp"
 #include "memory_view.hpp"
 
 #include <range/v3/view/any_view.hpp>
@@ -22,8 +23,12 @@
 #include <vector>
 #include <cstdint>
 #include <cstring>
+#include <functional>
+#include <mutex>
 
 namespace blocksci {
+    class TxHashTable;
+    class SstBulkLoader;
 
     /** Provides access to hash indexes (RocksDB database)
      *
@@ -42,21 +47,40 @@ namespace blocksci {
      *         + Key: blocksci::uint256 hash
      *         + Value: uint32_t txNum
      *     - Other column families: address identifier (eg. pubkeyhash or scripthash) -> script number
-     *         + Key: blocksci::uint160 or blocksci::uint256
+     *         + Key: blocksci::uint160 or blocksci::uint256 (the x-only output key for "witness_taproot")
      *         + Value: uint32_t scriptNum
      *
+     * Transaction hashes of the older part of the chain can be moved into an immutable TxHashTable, after which the
+     * "T" column family only holds the transactions that were added since, @see useTxHashTable()
+     *
      * Directory: hashIndex/
      */
     class HashIndex {
         /** Pointer to the RocksDB instance */
         std::unique_ptr<rocksdb::DB> db;
+        
+        IndexOpenMode openMode;
+        
+        /** Options of the address and tx columns, needed to recreate them */
+        rocksdb::ColumnFamilyOptions columnOptions;
 
         /** RocksDB column handles, one for each address type, @see blocksci::AddressType::Enum */
         std::vector<std::unique_ptr<rocksdb::ColumnFamilyHandle>> columnHandles;
         
+        /** Table of the tx hashes of the first part of the chain, consulted before the "T" column family */
+        std::unique_ptr<TxHashTable> txHashTable;
+        
+        /** Hashes of the transactions in the chain, used to verify the matches of txHashTable */
+        std::function<const uint256 *(uint32_t)> txHashSource;
+        
         ranges::optional<uint32_t> lookupAddressImpl(AddressType::Enum type, const char *data, size_t size);
+        
+        /** Look up count keys of keySize bytes each stored consecutively at data with batched MultiGet calls */
+        std::vector<ranges::optional<uint32_t>> getMatches(rocksdb::ColumnFamilyHandle *handle, const char *data, size_t keySize, size_t count);
         void addAddressesImpl(AddressType::Enum type, std::vector<std::pair<MemoryView, MemoryView>> dataViews);
         
+        void removeAddressesImpl(rocksdb::ColumnFamilyHandle *handle, const std::vector<MemoryView> &keys);
+        
         template <typename T>
         ranges::optional<uint32_t> getMatch(rocksdb::ColumnFamilyHandle *handle, const T &t) {
             rocksdb::PinnableSlice val;
@@ -114,6 +138,8 @@ namespace blocksci {
                     return getColumn(AddressType::NONSTANDARD);
                 case DedupAddressType::WITNESS_UNKNOWN:
                     return getColumn(AddressType::WITNESS_UNKNOWN);
+                case DedupAddressType::WITNESS_TAPROOT:
+                    return getColumn(AddressType::WITNESS_TAPROOT);
             }
             assert(false);
             return getColumn(AddressType::NONSTANDARD);
@@ -123,26 +149,49 @@ namespace blocksci {
             return columnHandles.back();
         }
         
-        std::unique_ptr<rocksdb::Iterator> getIterator(AddressType::Enum type) {
-            return std::unique_ptr<rocksdb::Iterator>{db->NewIterator(rocksdb::ReadOptions(), getColumn(type).get())};
-        }
-        std::unique_ptr<rocksdb::Iterator> getIterator(DedupAddressType::Enum type) {
-            return std::unique_ptr<rocksdb::Iterator>{db->NewIterator(rocksdb::ReadOptions(), getColumn(type).get())};
-        }
-        std::unique_ptr<rocksdb::Iterator> getTxIterator() {
-            return std::unique_ptr<rocksdb::Iterator>{db->NewIterator(rocksdb::ReadOptions(), getTxColumn().get())};
-        }
+        /** Receives all writes between beginBulkLoad() and finishBulkLoad() */
+        std::unique_ptr<SstBulkLoader> bulkLoader;
         
-        void writeBatch(rocksdb::WriteBatch &batch) {
-            rocksdb::WriteOptions options;
-            options.disableWAL = true;
-            db->Write(options, &batch);
-        }
+        /** The bulk loader takes writes from one thread at a time, RocksDB itself from any number of threads */
+        std::mutex bulkLoaderMutex;
+        
+        /** Loads the index and filter blocks into the block cache after opening, declared last to stop first */
+        std::unique_ptr<IndexWarmup> warmup;
+        
+        void writeBatch(rocksdb::WriteBatch &batch);
+        
+        /** Drop the column and recreate it empty under the same name */
+        void resetColumn(std::unique_ptr<rocksdb::ColumnFamilyHandle> &handle);
         
     public:
         
-        HashIndex(const filesystem::path &path, bool readonly);
+        /** Size of the block cache of an index opened with the interactive profile if none is given, which has to hold
+         * all of its index and filter blocks */
+        static constexpr size_t interactiveBlockCacheSize = size_t{512} * 1024 * 1024;
+        
+        /** Open the index at path, its columns use RocksDB's default block cache if none is given, with the RocksDB
+         * options overridden by tuning */
+        HashIndex(const filesystem::path &path, IndexOpenMode mode, std::shared_ptr<rocksdb::Cache> blockCache = nullptr, const IndexTuning &tuning = {});
         ~HashIndex();
+        
+        /** Pick up the changes a running parser made to an index opened as IndexOpenMode::Secondary */
+        void catchUpWithPrimary();
+        
+        /** Look up tx hashes in the TxHashTable at path first, if it exists
+         *
+         * txHashSource must return the hash of every tx number covered by the table.
+         */
+        void useTxHashTable(const filesystem::path &path, std::function<const uint256 *(uint32_t)> txHashSource);
+        
+        /** Number of transactions covered by the TxHashTable in use, 0 if there is none */
+        uint32_t txHashTableCount() const;
+        
+        rocksdb::DB *getDB() const {
+            return db.get();
+        }
+        
+        /** Block cache of the address and tx columns, RocksDB's default cache if none was given */
+        std::shared_ptr<rocksdb::Cache> getBlockCache() const;
 
         template<AddressType::Enum type>
         ranges::optional<uint32_t> lookupAddress(const typename AddressInfo<type>::IDType &hash) {
@@ -155,12 +204,29 @@ namespace blocksci {
         /** Get the scriptNum for the given script hash */
         ranges::optional<uint32_t> getScriptHashIndex(const uint160 &scripthash);
         ranges::optional<uint32_t> getScriptHashIndex(const uint256 &scripthash);
+        
+        /** Get the scriptNum for the given x-only taproot output key */
+        ranges::optional<uint32_t> getTaprootIndex(const uint256 &outputKey);
       
         /** Get the tx number for the given transaction hash */
         ranges::optional<uint32_t> getTxIndex(const uint256 &txHash);
         
-        uint32_t countColumn(AddressType::Enum type);
-        uint32_t countTxes();
+        /** Get the tx numbers of all given transaction hashes, much faster than repeated calls to getTxIndex */
+        std::vector<ranges::optional<uint32_t>> getTxIndexes(const std::vector<uint256> &txHashes);
+        
+        /** Get the scriptNums of all given identifiers, much faster than repeated calls to lookupAddress */
+        template<AddressType::Enum type>
+        std::vector<ranges::optional<uint32_t>> lookupAddresses(const std::vector<typename AddressInfo<type>::IDType> &hashes) {
+            using IDType = typename AddressInfo<type>::IDType;
+            return getMatches(getColumn(type).get(), reinterpret_cast<const char *>(hashes.data()), sizeof(IDType), hashes.size());
+        }
+        
+        /** Number of keys in the column of the address type, counted in a parallel scan on threadCount threads (0 for
+         * one per hardware thread) */
+        uint32_t countColumn(AddressType::Enum type, uint32_t threadCount = 0);
+        
+        /** Number of keys in the tx column, counted like countColumn */
+        uint32_t countTxes(uint32_t threadCount = 0);
         
         template<AddressType::Enum type>
         void addAddresses(std::vector<std::pair<typename blocksci::AddressInfo<type>::IDType, uint32_t>> rows) {
@@ -176,13 +242,46 @@ namespace blocksci {
         /** Add a mapping from tx hash to tx number to the hash index for all given rows */
         void addTxes(std::vector<std::pair<uint256, uint32_t>> rows);
         
+        /** Remove all tx hashes from the "T" column family, done once they were moved into a TxHashTable */
+        void clearTxes();
+        
+        /** Drop the column of the address type and recreate it empty, done before rebuilding it */
+        void clearAddressColumn(AddressType::Enum type);
+        
+        /** Remove the given tx hashes from the "T" column family, used to undo transactions of reorganized blocks */
+        void removeTxes(const std::vector<uint256> &txHashes);
+        
+        /** Remove the given keys from the address column of the dedup type, used to undo scripts of reorganized blocks */
+        void removeAddresses(DedupAddressType::Enum type, const std::vector<MemoryView> &keys);
+        
+        template<AddressType::Enum type>
+        void removeAddresses(const std::vector<typename AddressInfo<type>::IDType> &hashes) {
+            std::vector<MemoryView> keys;
+            keys.reserve(hashes.size());
+            for (const auto &hash : hashes) {
+                keys.push_back(MemoryView{reinterpret_cast<const char *>(&hash), sizeof(hash)});
+            }
+            removeAddressesImpl(getColumn(type).get(), keys);
+        }
+        
         ranges::any_view<std::pair<MemoryView, MemoryView>> getRawAddressRange(AddressType::Enum type);
         
         template<AddressType::Enum type>
         ranges::any_view<std::pair<uint32_t, typename blocksci::AddressInfo<type>::IDType>> getAddressRange();
 
-        /** Compact the underlying RocksDB database */
-        void compactDB();
+        /** Collect all following writes in sorted table files instead of writing them through the WAL and memtables
+         *
+         * Meant for loading large amounts of data at once such as during an initial parse. The written data only
+         * becomes visible once finishBulkLoad() ingests the files.
+         */
+        void beginBulkLoad();
+        
+        /** Ingest all data written since beginBulkLoad() */
+        void finishBulkLoad();
+        
+        /** Compact the underlying RocksDB database, with rewriteTableFiles also the files of the last level so that
+         * all table files are written with the current options */
+        void compactDB(bool rewriteTableFiles = false);
     };
     
     extern template ranges::any_view<std::pair<uint32_t, typename blocksci::AddressInfo<AddressType::PUBKEY>::IDType>> HashIndex::getAddressRange<AddressType::PUBKEY>();
@@ -192,6 +291,7 @@ namespace blocksci {
     extern template ranges::any_view<std::pair<uint32_t, typename blocksci::AddressInfo<AddressType::SCRIPTHASH>::IDType>> HashIndex::getAddressRange<AddressType::SCRIPTHASH>();
     extern template ranges::any_view<std::pair<uint32_t, typename blocksci::AddressInfo<AddressType::WITNESS_SCRIPTHASH>::IDType>> HashIndex::getAddressRange<AddressType::WITNESS_SCRIPTHASH>();
     extern template ranges::any_view<std::pair<uint32_t, typename blocksci::AddressInfo<AddressType::MULTISIG>::IDType>> HashIndex::getAddressRange<AddressType::MULTISIG>();
+    extern template ranges::any_view<std::pair<uint32_t, typename blocksci::AddressInfo<AddressType::WITNESS_TAPROOT>::IDType>> HashIndex::getAddressRange<AddressType::WITNESS_TAPROOT>();
 }
 
 #endif /* blocksci_index_hash_index_hpp */
@@ -0,0 +1,194 @@
+//
+//  index_open.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include "index_open.hpp"
+
+#include <rocksdb/cache.h>
+#include <rocksdb/db.h>
+#include <rocksdb/filter_policy.h>
+#include <rocksdb/table.h>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+namespace blocksci {
+
+    namespace {
+        /** Every secondary instance needs a directory of its own */
+        filesystem::path secondaryDirectory(const std::string &indexName) {
+            static std::atomic<int> instanceCount{0};
+            auto tempDir = std::getenv("TMPDIR");
+            filesystem::path baseDirectory{tempDir != nullptr && *tempDir != '\0' ? tempDir : "/tmp"};
+            auto directory = baseDirectory/"blocksci_secondary";
+            if (!directory.exists()) {
+                filesystem::create_directory(directory);
+            }
+            return directory/(indexName + "_" + std::to_string(getpid()) + "_" + std::to_string(instanceCount++));
+        }
+        
+        const std::vector<std::pair<std::string, rocksdb::CompressionType>> &compressionTypes() {
+            static const std::vector<std::pair<std::string, rocksdb::CompressionType>> types{
+                {"none", rocksdb::kNoCompression},
+                {"snappy", rocksdb::kSnappyCompression},
+                {"zlib", rocksdb::kZlibCompression},
+                {"lz4", rocksdb::kLZ4Compression},
+                {"lz4hc", rocksdb::kLZ4HCCompression},
+                {"zstd", rocksdb::kZSTD}
+            };
+            return types;
+        }
+    }
+    
+    const std::vector<std::string> &indexCompressionNames() {
+        static const auto names = []() {
+            std::vector<std::string> compressionNames;
+            for (auto &type : compressionTypes()) {
+                compressionNames.push_back(type.first);
+            }
+            return compressionNames;
+        }();
+        return names;
+    }
+    
+    void applyIndexTuning(const IndexTuning &tuning, rocksdb::Options &options, rocksdb::ColumnFamilyOptions &columnOptions, rocksdb::BlockBasedTableOptions &tableOptions) {
+        if (tuning.blockSize > 0) {
+            tableOptions.block_size = tuning.blockSize;
+        }
+        if (!tuning.compression.empty()) {
+            auto &types = compressionTypes();
+            auto it = std::find_if(types.begin(), types.end(), [&](const auto &type) { return type.first == tuning.compression; });
+            if (it == types.end()) {
+                throw std::invalid_argument("Unknown index compression: " + tuning.compression);
+            }
+            // OptimizeLevelStyleCompaction sets a compression per level, which takes precedence
+            columnOptions.compression_per_level.clear();
+            columnOptions.compression = it->second;
+        }
+        if (tuning.bloomBitsPerKey == 0) {
+            tableOptions.filter_policy.reset();
+        } else if (tuning.bloomBitsPerKey > 0) {
+            tableOptions.filter_policy.reset(rocksdb::NewBloomFilterPolicy(tuning.bloomBitsPerKey, false));
+        }
+        if (tuning.interactive) {
+            if (!tableOptions.filter_policy && tuning.bloomBitsPerKey < 0) {
+                tableOptions.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10, false));
+            }
+            tableOptions.cache_index_and_filter_blocks = true;
+            tableOptions.cache_index_and_filter_blocks_with_high_priority = true;
+            tableOptions.pin_l0_filter_and_index_blocks_in_cache = true;
+            tableOptions.index_type = rocksdb::BlockBasedTableOptions::kTwoLevelIndexSearch;
+            tableOptions.partition_filters = tableOptions.filter_policy != nullptr;
+            tableOptions.pin_top_level_index_and_filter = true;
+            // Opening every table file up front moves the reads of their footers and top level blocks to the open
+            options.max_open_files = -1;
+        }
+        if (tuning.maxOpenFiles != 0) {
+            options.max_open_files = tuning.maxOpenFiles;
+        }
+    }
+
+    std::unique_ptr<rocksdb::DB> openIndexDB(rocksdb::Options options, const filesystem::path &path, IndexOpenMode mode,
+                                             const std::vector<rocksdb::ColumnFamilyDescriptor> &columnDescriptors,
+                                             std::vector<std::unique_ptr<rocksdb::ColumnFamilyHandle>> &columnHandles,
+                                             const std::string &indexName) {
+        rocksdb::DB *dbPtr;
+        std::vector<rocksdb::ColumnFamilyHandle *> columnHandlePtrs;
+        rocksdb::Status s;
+        switch (mode) {
+            case IndexOpenMode::ReadWrite:
+                s = rocksdb::DB::Open(options, path.str(), columnDescriptors, &columnHandlePtrs, &dbPtr);
+                break;
+            case IndexOpenMode::ReadOnly:
+                s = rocksdb::DB::OpenForReadOnly(options, path.str(), columnDescriptors, &columnHandlePtrs, &dbPtr);
+                break;
+            case IndexOpenMode::Secondary:
+                // Secondary instances must keep all table files open to be able to follow the primary
+                options.max_open_files = -1;
+                s = rocksdb::DB::OpenAsSecondary(options, path.str(), secondaryDirectory(indexName).str(), columnDescriptors, &columnHandlePtrs, &dbPtr);
+                break;
+        }
+        if (!s.ok()) {
+            throw std::runtime_error{"Could not open " + indexName + " with error: " + s.ToString()};
+        }
+        std::unique_ptr<rocksdb::DB> db{dbPtr};
+        columnHandles.clear();
+        for (auto handle : columnHandlePtrs) {
+            columnHandles.emplace_back(handle);
+        }
+        return db;
+    }
+
+    void catchUpWithPrimary(rocksdb::DB &db, IndexOpenMode mode, const std::string &indexName) {
+        if (mode != IndexOpenMode::Secondary) {
+            return;
+        }
+        auto s = db.TryCatchUpWithPrimary();
+        if (!s.ok()) {
+            throw std::runtime_error{"Could not update " + indexName + " with error: " + s.ToString()};
+        }
+    }
+
+    IndexWarmup::IndexWarmup(rocksdb::DB &db, const std::vector<std::unique_ptr<rocksdb::ColumnFamilyHandle>> &columnHandles) {
+        std::unordered_map<std::string, rocksdb::ColumnFamilyHandle *> columns;
+        for (auto &handle : columnHandles) {
+            columns[handle->GetName()] = handle.get();
+        }
+        thread = std::thread([this, &db, columns = std::move(columns)]() {
+            std::vector<rocksdb::LiveFileMetaData> files;
+            db.GetLiveFilesMetaData(&files);
+            // Lookups check the newest files first, so do they
+            std::stable_sort(files.begin(), files.end(), [](const auto &a, const auto &b) { return a.level < b.level; });
+            rocksdb::ReadOptions readOptions;
+            std::string value;
+            for (auto &file : files) {
+                if (stopping) {
+                    return;
+                }
+                auto it = columns.find(file.column_family_name);
+                if (it != columns.end()) {
+                    db.Get(readOptions, it->second, file.smallestkey, &value);
+                    db.Get(readOptions, it->second, file.largestkey, &value);
+                }
+            }
+            done = true;
+        });
+    }
+    
+    IndexWarmup::~IndexWarmup() {
+        stopping = true;
+        thread.join();
+    }
+    
+    std::unique_ptr<IndexWarmup> startIndexWarmup(const IndexTuning &tuning, IndexOpenMode mode, rocksdb::DB &db,
+                                                  const std::vector<std::unique_ptr<rocksdb::ColumnFamilyHandle>> &columnHandles) {
+        if (!tuning.warmup || mode == IndexOpenMode::ReadWrite) {
+            return nullptr;
+        }
+        return std::make_unique<IndexWarmup>(db, columnHandles);
+    }
+
+    std::shared_ptr<rocksdb::Cache> sharedBlockCache(size_t size) {
+        static std::mutex mutex;
+        static std::map<size_t, std::weak_ptr<rocksdb::Cache>> caches;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto &weakCache = caches[size];
+        auto cache = weakCache.lock();
+        if (!cache) {
+            cache = rocksdb::NewLRUCache(size);
+            weakCache = cache;
+        }
+        return cache;
+    }
+} // namespace blocksci
@@ -0,0 +1,140 @@
+//
+//  index_open.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_index_index_open_hpp
+#define blocksci_index_index_open_hpp
+
+#include <wjfilesystem/path.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rocksdb {
+    struct BlockBasedTableOptions;
+    class Cache;
+    class ColumnFamilyHandle;
+    struct ColumnFamilyDescriptor;
+    struct ColumnFamilyOptions;
+    class DB;
+    struct Options;
+}
+
+namespace blocksci {
+
+    /** How the RocksDB address and hash indexes are opened */
+    enum class IndexOpenMode {
+        /** Open for writing, only used by the parser */
+        ReadWrite,
+        /** Open a snapshot of the index as it was when it was opened */
+        ReadOnly,
+        /** Open as a secondary instance, which can follow a parser that keeps writing to the index
+         * through catchUpWithPrimary(). Needs a private directory for its logs, which is created in the system
+         * temp directory */
+        Secondary
+    };
+
+    /** RocksDB options of an index that the data configuration overrides, zero values keep the defaults of the index
+     *
+     * Block size, compression and bloom filters are properties of the table files, so they only apply to the files
+     * written while the index is open with them: by the parser, by a compaction or by blocksci_index_bench --rewrite.
+     * The cache size and the open file limit apply as soon as the index is opened.
+     */
+    struct IndexTuning {
+        /** Size in bytes of the uncompressed data blocks */
+        size_t blockSize = 0;
+        
+        /** Compression of all levels, one of indexCompressionNames() */
+        std::string compression;
+        
+        /** Bits per key of the bloom filters, negative keeps the default of the index and 0 writes no filters */
+        int bloomBitsPerKey = -1;
+        
+        /** Size in bytes of the block cache of the index, unless the indexes share one */
+        size_t cacheSize = 0;
+        
+        /** Number of table files kept open, -1 keeps all of them open */
+        int maxOpenFiles = 0;
+        
+        /** Tune for the latency of the first lookups after the index is opened rather than for bulk work
+         *
+         * Index and filter blocks live in the block cache with high priority, those of L0 files and the top levels of
+         * partitioned ones pinned, and all table files stay open unless maxOpenFiles is set. Table files written with
+         * the profile get partitioned indexes and filters, and bloom filters of 10 bits per key if the index has none.
+         */
+        bool interactive = false;
+        
+        /** Load the index and filter blocks of every table file into the block cache on a background thread after
+         * opening the index for reading, @see IndexWarmup */
+        bool warmup = false;
+        
+        /** Whether the table files have to be rewritten for the tuning to take effect */
+        bool changesTableFiles() const {
+            return blockSize > 0 || !compression.empty() || bloomBitsPerKey >= 0;
+        }
+        
+        bool isDefault() const {
+            return !changesTableFiles() && cacheSize == 0 && maxOpenFiles == 0 && !interactive && !warmup;
+        }
+    };
+    
+    /** Names of the compressions that IndexTuning accepts: none, snappy, zlib, lz4, lz4hc and zstd */
+    const std::vector<std::string> &indexCompressionNames();
+    
+    /** Apply everything but the cache size, which the creator of the cache handles, to the options of an index */
+    void applyIndexTuning(const IndexTuning &tuning, rocksdb::Options &options, rocksdb::ColumnFamilyOptions &columnOptions, rocksdb::BlockBasedTableOptions &tableOptions);
+
+    /** Open the RocksDB database at path in the given mode, indexName is used in error messages */
+    std::unique_ptr<rocksdb::DB> openIndexDB(rocksdb::Options options, const filesystem::path &path, IndexOpenMode mode,
+                                             const std::vector<rocksdb::ColumnFamilyDescriptor> &columnDescriptors,
+                                             std::vector<std::unique_ptr<rocksdb::ColumnFamilyHandle>> &columnHandles,
+                                             const std::string &indexName);
+
+    /** Apply the changes a parser made to a Secondary index since it was opened or last caught up, no-op otherwise */
+    void catchUpWithPrimary(rocksdb::DB &db, IndexOpenMode mode, const std::string &indexName);
+
+    /** Thread looking up the smallest and largest key of every table file of an index, L0 first, which loads the index
+     * and filter blocks the lookups of the file need into the block cache
+     *
+     * Lets the first lookups after a restart find the blocks in the cache instead of reading them from the table files.
+     * Destroying it stops the thread, so it has to be destroyed before the database and its column handles.
+     */
+    class IndexWarmup {
+        std::atomic<bool> stopping{false};
+        std::atomic<bool> done{false};
+        std::thread thread;
+        
+    public:
+        IndexWarmup(rocksdb::DB &db, const std::vector<std::unique_ptr<rocksdb::ColumnFamilyHandle>> &columnHandles);
+        ~IndexWarmup();
+        
+        IndexWarmup(const IndexWarmup &) = delete;
+        IndexWarmup &operator=(const IndexWarmup &) = delete;
+        
+        /** Whether all table files were touched */
+        bool isDone() const {
+            return done;
+        }
+    };
+    
+    /** IndexWarmup of the index if the tuning asks for one, null otherwise or if the index is opened for writing, whose
+     * columns may be dropped while the thread runs */
+    std::unique_ptr<IndexWarmup> startIndexWarmup(const IndexTuning &tuning, IndexOpenMode mode, rocksdb::DB &db,
+                                                  const std::vector<std::unique_ptr<rocksdb::ColumnFamilyHandle>> &columnHandles);
+
+    /** LRU block cache of the given size shared by all indexes of the process that ask for the same size
+     *
+     * The cache lives as long as one index uses it, so several Blockchain objects of the same data directory keep one
+     * set of cached blocks instead of one per object.
+     */
+    std::shared_ptr<rocksdb::Cache> sharedBlockCache(size_t size);
+} // namespace blocksci
+
+#endif /* blocksci_index_index_open_hpp */
@@ -0,0 +1,569 @@
+//
+//  layered_file.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "layered_file.hpp"
+#include "file_checksums.hpp"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace blocksci {
+
+    namespace {
+        constexpr uint64_t layerMagic = 0x3159414c49435342; // "BSCILAY1"
+
+        /** Address space reserved past the end of the file for the tail to grow into without moving the mapping */
+        constexpr int64_t tailHeadroom = int64_t{64} << 30;
+
+        struct LayerHeader {
+            uint64_t magic;
+            uint64_t extentSize;
+            uint64_t sharedLength;
+            uint64_t generation;
+            uint64_t patchCount;
+            uint64_t basePathLength;
+        };
+
+        [[noreturn]] void throwFileError(const std::string &action, const filesystem::path &path, int error) {
+            std::stringstream ss;
+            ss << "Error " << action << " " << path.str() << ": " << std::strerror(error);
+            throw std::runtime_error(ss.str());
+        }
+
+        int64_t pageSize() {
+            static const auto size = static_cast<int64_t>(sysconf(_SC_PAGESIZE));
+            return size;
+        }
+
+        int64_t roundToPage(int64_t size) {
+            return (size + pageSize() - 1) / pageSize() * pageSize();
+        }
+
+        int64_t fileSize(int fd) {
+            struct stat fileStat;
+            if (fd < 0 || fstat(fd, &fileStat) != 0) {
+                return 0;
+            }
+            return static_cast<int64_t>(fileStat.st_size);
+        }
+
+        bool readAt(int fd, char *data, uint64_t length, uint64_t offset) {
+            while (length > 0) {
+                auto bytesRead = pread(fd, data, length, static_cast<off_t>(offset));
+                if (bytesRead < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (bytesRead <= 0) {
+                    return false;
+                }
+                data += bytesRead;
+                length -= static_cast<uint64_t>(bytesRead);
+                offset += static_cast<uint64_t>(bytesRead);
+            }
+            return true;
+        }
+
+        bool writeAt(int fd, const char *data, uint64_t length, uint64_t offset) {
+            while (length > 0) {
+                auto bytesWritten = pwrite(fd, data, length, static_cast<off_t>(offset));
+                if (bytesWritten < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (bytesWritten <= 0) {
+                    return false;
+                }
+                data += bytesWritten;
+                length -= static_cast<uint64_t>(bytesWritten);
+                offset += static_cast<uint64_t>(bytesWritten);
+            }
+            return true;
+        }
+
+        void mapFixed(char *address, int64_t length, int prot, int flags, int fd, int64_t offset, const filesystem::path &path) {
+            auto result = mmap(address, static_cast<size_t>(length), prot, flags | MAP_FIXED, fd, static_cast<off_t>(offset));
+            if (result == MAP_FAILED) {
+                throwFileError("mapping", path, errno);
+            }
+        }
+
+        bool isRegularFile(const std::string &path) {
+            struct stat fileStat;
+            return stat(path.c_str(), &fileStat) == 0 && S_ISREG(fileStat.st_mode);
+        }
+
+        /** Number of mappings needed for the patches, consecutive extents stored next to each other share one */
+        size_t countRuns(const std::vector<uint64_t> &extents) {
+            size_t runs = 0;
+            for (size_t i = 0; i < extents.size(); i++) {
+                if (i == 0 || extents[i] != extents[i - 1] + 1) {
+                    runs++;
+                }
+            }
+            return runs;
+        }
+
+        /** Fill the smallest gaps between the runs of the sorted extents until at most maxRuns runs are left */
+        std::vector<uint64_t> coalesceRuns(const std::vector<uint64_t> &extents, size_t maxRuns) {
+            std::vector<std::pair<uint64_t, uint64_t>> runs;
+            for (auto extent : extents) {
+                if (!runs.empty() && extent == runs.back().second + 1) {
+                    runs.back().second = extent;
+                } else {
+                    runs.emplace_back(extent, extent);
+                }
+            }
+            if (runs.size() <= maxRuns) {
+                return extents;
+            }
+            std::vector<std::pair<uint64_t, size_t>> gaps;
+            for (size_t i = 0; i + 1 < runs.size(); i++) {
+                gaps.emplace_back(runs[i + 1].first - runs[i].second, i);
+            }
+            auto mergeCount = runs.size() - std::max<size_t>(maxRuns, 1);
+            std::nth_element(gaps.begin(), gaps.begin() + static_cast<std::ptrdiff_t>(mergeCount), gaps.end());
+            std::vector<bool> mergeWithNext(runs.size(), false);
+            for (size_t i = 0; i < mergeCount; i++) {
+                mergeWithNext[gaps[i].second] = true;
+            }
+            std::vector<uint64_t> coalesced;
+            for (size_t i = 0; i < runs.size(); i++) {
+                auto end = mergeWithNext[i] ? runs[i + 1].first : runs[i].second + 1;
+                for (auto extent = runs[i].first; extent < end; extent++) {
+                    coalesced.push_back(extent);
+                }
+            }
+            return coalesced;
+        }
+    }
+
+    int64_t LayerManifest::layeredSize(const filesystem::path &dataPath) {
+        auto manifest = load(dataPath);
+        auto tail = tailPath(dataPath);
+        return static_cast<int64_t>(manifest.sharedLength) + (tail.exists() ? static_cast<int64_t>(tail.file_size()) : 0);
+    }
+
+    LayerManifest LayerManifest::load(const filesystem::path &dataPath) {
+        auto path = manifestPath(dataPath);
+        std::ifstream file(path.str(), std::ios::binary);
+        LayerHeader header;
+        if (!file || !file.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic != layerMagic) {
+            throw std::runtime_error("Could not read the layer manifest " + path.str());
+        }
+        if (header.extentSize == 0 || header.extentSize % static_cast<uint64_t>(pageSize()) != 0 || header.sharedLength % header.extentSize != 0) {
+            throw std::runtime_error("Invalid layer manifest " + path.str());
+        }
+        LayerManifest manifest;
+        manifest.extentSize = header.extentSize;
+        manifest.sharedLength = header.sharedLength;
+        manifest.generation = header.generation;
+        std::string basePath(header.basePathLength, '\0');
+        manifest.patchedExtents.resize(header.patchCount);
+        if (!file.read(&basePath[0], static_cast<std::streamsize>(basePath.size())) || !file.read(reinterpret_cast<char *>(manifest.patchedExtents.data()), static_cast<std::streamsize>(manifest.patchedExtents.size() * sizeof(uint64_t)))) {
+            throw std::runtime_error("Could not read the layer manifest " + path.str());
+        }
+        manifest.basePath = filesystem::path{basePath};
+        return manifest;
+    }
+
+    void LayerManifest::save(const filesystem::path &dataPath) const {
+        auto path = manifestPath(dataPath).str();
+        auto tempPath = path + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            auto base = basePath.str();
+            LayerHeader header{layerMagic, extentSize, sharedLength, generation, patchedExtents.size(), base.size()};
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            file.write(base.data(), static_cast<std::streamsize>(base.size()));
+            file.write(reinterpret_cast<const char *>(patchedExtents.data()), static_cast<std::streamsize>(patchedExtents.size() * sizeof(uint64_t)));
+            if (!file.good()) {
+                throw std::runtime_error("Could not write the layer manifest " + tempPath);
+            }
+        }
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+            throwFileError("replacing", filesystem::path{path}, errno);
+        }
+    }
+
+    LayeredFile::LayeredFile(const filesystem::path &dataPath_, bool writable_) : dataPath(dataPath_), writable(writable_), manifest(LayerManifest::load(dataPath)) {
+        if (writable) {
+            auto path = LayerManifest::manifestPath(dataPath);
+            lockFd = ::open(path.str().c_str(), O_RDONLY);
+            if (lockFd < 0) {
+                throwFileError("opening", path, errno);
+            }
+            if (flock(lockFd, LOCK_EX | LOCK_NB) != 0) {
+                ::close(lockFd);
+                throw std::runtime_error(dataPath.str() + " is already open for writing");
+            }
+            writtenExtents.resize(static_cast<size_t>(manifest.sharedLength / manifest.extentSize), false);
+        }
+        try {
+            openFiles();
+            map();
+        } catch (...) {
+            unmap();
+            closeFiles();
+            if (lockFd >= 0) {
+                ::close(lockFd);
+            }
+            throw;
+        }
+    }
+
+    LayeredFile::~LayeredFile() {
+        if (writable) {
+            try {
+                savePatches();
+            } catch (const std::exception &e) {
+                std::cerr << "Could not save the changes to the shared part of " << dataPath.str() << ": " << e.what() << std::endl;
+            }
+        }
+        unmap();
+        closeFiles();
+        if (lockFd >= 0) {
+            ::close(lockFd);
+        }
+    }
+
+    void LayeredFile::openFiles() {
+        baseFd = ::open(manifest.basePath.str().c_str(), O_RDONLY);
+        if (baseFd < 0) {
+            throwFileError("opening the base file", manifest.basePath, errno);
+        }
+        if (fileSize(baseFd) < static_cast<int64_t>(manifest.sharedLength)) {
+            throw std::runtime_error("The base file " + manifest.basePath.str() + " is shorter than the part " + dataPath.str() + " shares with it");
+        }
+        auto patchPath = manifest.patchPath(dataPath);
+        if (writable || !manifest.patchedExtents.empty()) {
+            patchFd = ::open(patchPath.str().c_str(), writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+            if (patchFd < 0) {
+                throwFileError("opening", patchPath, errno);
+            }
+            if (fileSize(patchFd) < static_cast<int64_t>(manifest.patchedExtents.size() * manifest.extentSize)) {
+                throw std::runtime_error("The patch file " + patchPath.str() + " is shorter than its manifest");
+            }
+        }
+        auto tailPath = LayerManifest::tailPath(dataPath);
+        tailFd = ::open(tailPath.str().c_str(), writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+        if (tailFd < 0 && (writable || errno != ENOENT)) {
+            throwFileError("opening", tailPath, errno);
+        }
+    }
+
+    void LayeredFile::closeFiles() {
+        for (auto fd : {&baseFd, &patchFd, &tailFd}) {
+            if (*fd >= 0) {
+                ::close(*fd);
+                *fd = -1;
+            }
+        }
+    }
+
+    void LayeredFile::map() {
+        auto shared = static_cast<int64_t>(manifest.sharedLength);
+        auto tailLength = fileSize(tailFd);
+        logicalSize = shared + tailLength;
+        reservedLength = roundToPage(logicalSize + std::max(logicalSize, tailHeadroom));
+        auto reservation = mmap(nullptr, static_cast<size_t>(reservedLength), PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (reservation == MAP_FAILED) {
+            throwFileError("reserving address space for", dataPath, errno);
+        }
+        mapping = static_cast<char *>(reservation);
+        mappedTailLength = 0;
+
+        int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+        if (shared > 0) {
+            // Copy-on-write for a writer, the base is never changed
+            mapFixed(mapping, shared, prot, writable ? MAP_PRIVATE : MAP_SHARED, baseFd, 0, manifest.basePath);
+        }
+        auto extentSize = static_cast<int64_t>(manifest.extentSize);
+        auto &extents = manifest.patchedExtents;
+        size_t runStart = 0;
+        while (runStart < extents.size()) {
+            auto runEnd = runStart + 1;
+            while (runEnd < extents.size() && extents[runEnd] == extents[runEnd - 1] + 1) {
+                runEnd++;
+            }
+            auto offset = static_cast<int64_t>(extents[runStart]) * extentSize;
+            mapFixed(mapping + offset, static_cast<int64_t>(runEnd - runStart) * extentSize, prot, MAP_SHARED, patchFd, static_cast<int64_t>(runStart) * extentSize, manifest.patchPath(dataPath));
+            runStart = runEnd;
+        }
+        mapTail(tailLength);
+    }
+
+    void LayeredFile::unmap() {
+        if (mapping != nullptr) {
+            munmap(mapping, static_cast<size_t>(reservedLength));
+            mapping = nullptr;
+            reservedLength = 0;
+            mappedTailLength = 0;
+        }
+    }
+
+    void LayeredFile::mapTail(int64_t tailLength) {
+        auto shared = static_cast<int64_t>(manifest.sharedLength);
+        auto newMappedLength = roundToPage(tailLength);
+        if (shared + newMappedLength > reservedLength) {
+            throw std::runtime_error(dataPath.str() + " outgrew the address space reserved for it");
+        }
+        if (newMappedLength > 0) {
+            mapFixed(mapping + shared, newMappedLength, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, tailFd, 0, LayerManifest::tailPath(dataPath));
+        }
+        if (newMappedLength < mappedTailLength) {
+            // Return the pages past the new end to the reservation, touching them would fault past the end of the file
+            auto freed = mmap(mapping + shared + newMappedLength, static_cast<size_t>(mappedTailLength - newMappedLength), PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+            if (freed == MAP_FAILED) {
+                throwFileError("unmapping the end of", dataPath, errno);
+            }
+        }
+        mappedTailLength = newMappedLength;
+        logicalSize = shared + tailLength;
+    }
+
+    void LayeredFile::resize(int64_t newSize) {
+        if (!writable) {
+            throw std::runtime_error("Can't resize " + dataPath.str() + " since it was opened read-only");
+        }
+        auto shared = static_cast<int64_t>(manifest.sharedLength);
+        if (newSize < shared) {
+            throw std::runtime_error("Can't truncate " + dataPath.str() + " into the part it shares with " + manifest.basePath.str());
+        }
+        if (shared + roundToPage(newSize - shared) > reservedLength) {
+            throw std::runtime_error(dataPath.str() + " outgrew the address space reserved for it");
+        }
+        if (ftruncate(tailFd, static_cast<off_t>(newSize - shared)) != 0) {
+            throwFileError("resizing", LayerManifest::tailPath(dataPath), errno);
+        }
+        mapTail(newSize - shared);
+    }
+
+    void LayeredFile::markWritten(int64_t offset, int64_t length) {
+        auto shared = static_cast<int64_t>(manifest.sharedLength);
+        if (!writable || length <= 0 || offset >= shared) {
+            return;
+        }
+        auto extentSize = static_cast<int64_t>(manifest.extentSize);
+        auto first = static_cast<size_t>(offset / extentSize);
+        auto last = static_cast<size_t>((std::min(offset + length, shared) - 1) / extentSize);
+        for (auto i = first; i <= last; i++) {
+            writtenExtents[i] = true;
+        }
+    }
+
+    void LayeredFile::reload() {
+        if (!writable) {
+            auto current = LayerManifest::load(dataPath);
+            if (current.generation != manifest.generation || current.patchedExtents != manifest.patchedExtents) {
+                unmap();
+                closeFiles();
+                manifest = std::move(current);
+                openFiles();
+                map();
+                return;
+            }
+            if (tailFd < 0) {
+                tailFd = ::open(LayerManifest::tailPath(dataPath).str().c_str(), O_RDONLY);
+            }
+        }
+        auto tailLength = fileSize(tailFd);
+        if (static_cast<int64_t>(manifest.sharedLength) + tailLength != logicalSize) {
+            if (!writable && static_cast<int64_t>(manifest.sharedLength) + roundToPage(tailLength) > reservedLength) {
+                unmap();
+                map();
+                return;
+            }
+            mapTail(tailLength);
+        }
+    }
+
+    void LayeredFile::savePatches() {
+        auto extentSize = manifest.extentSize;
+        std::vector<bool> patched(writtenExtents.size(), false);
+        for (auto extent : manifest.patchedExtents) {
+            patched[static_cast<size_t>(extent)] = true;
+        }
+        // Writes to patched extents already went to the patch file, the others are kept if they differ from the base
+        std::vector<uint64_t> added;
+        std::vector<char> baseExtent(extentSize);
+        for (size_t extent = 0; extent < writtenExtents.size(); extent++) {
+            if (!writtenExtents[extent] || patched[extent]) {
+                continue;
+            }
+            if (!readAt(baseFd, baseExtent.data(), extentSize, extent * extentSize)) {
+                throw std::runtime_error("Could not read " + manifest.basePath.str());
+            }
+            if (std::memcmp(baseExtent.data(), mapping + extent * extentSize, extentSize) != 0) {
+                added.push_back(extent);
+            }
+        }
+        std::fill(writtenExtents.begin(), writtenExtents.end(), false);
+        if (added.empty()) {
+            return;
+        }
+
+        auto updated = manifest;
+        updated.patchedExtents.insert(updated.patchedExtents.end(), added.begin(), added.end());
+        if (countRuns(updated.patchedExtents) <= LayerManifest::maxPatchRuns) {
+            // Append the new patches, the manifest only refers to them once they are complete
+            for (size_t i = 0; i < added.size(); i++) {
+                auto position = (manifest.patchedExtents.size() + i) * extentSize;
+                if (!writeAt(patchFd, mapping + added[i] * extentSize, extentSize, position)) {
+                    throwFileError("writing", manifest.patchPath(dataPath), errno);
+                }
+            }
+            updated.save(dataPath);
+        } else {
+            // Rewrite the patches in order as a new generation, merging runs that are close to each other
+            std::sort(updated.patchedExtents.begin(), updated.patchedExtents.end());
+            updated.patchedExtents = coalesceRuns(updated.patchedExtents, LayerManifest::maxPatchRuns);
+            updated.generation++;
+            auto newPatchPath = updated.patchPath(dataPath);
+            auto fd = ::open(newPatchPath.str().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) {
+                throwFileError("creating", newPatchPath, errno);
+            }
+            for (size_t i = 0; i < updated.patchedExtents.size(); i++) {
+                if (!writeAt(fd, mapping + updated.patchedExtents[i] * extentSize, extentSize, i * extentSize)) {
+                    auto error = errno;
+                    ::close(fd);
+                    std::remove(newPatchPath.str().c_str());
+                    throwFileError("writing", newPatchPath, error);
+                }
+            }
+            ::close(fd);
+            updated.save(dataPath);
+            std::remove(manifest.patchPath(dataPath).str().c_str());
+        }
+        manifest = std::move(updated);
+    }
+
+    int64_t layerOverBase(const filesystem::path &dataPath, const filesystem::path &basePath, uint64_t extentSize) {
+        if (LayerManifest::isLayered(dataPath)) {
+            // An earlier conversion was interrupted after its manifest was complete
+            std::remove(dataPath.str().c_str());
+            return 0;
+        }
+        auto dataFd = ::open(dataPath.str().c_str(), O_RDONLY);
+        if (dataFd < 0) {
+            throwFileError("opening", dataPath, errno);
+        }
+        auto baseFd = ::open(basePath.str().c_str(), O_RDONLY);
+        if (baseFd < 0) {
+            auto error = errno;
+            ::close(dataFd);
+            throwFileError("opening", basePath, error);
+        }
+        auto closeFiles = [&]() {
+            ::close(dataFd);
+            ::close(baseFd);
+        };
+
+        auto dataSize = static_cast<uint64_t>(fileSize(dataFd));
+        auto sharedExtents = std::min(dataSize, static_cast<uint64_t>(fileSize(baseFd))) / extentSize;
+        std::vector<char> dataExtent(extentSize);
+        std::vector<char> baseExtent(extentSize);
+        std::vector<uint64_t> patchedExtents;
+        for (uint64_t extent = 0; extent < sharedExtents; extent++) {
+            if (!readAt(dataFd, dataExtent.data(), extentSize, extent * extentSize) || !readAt(baseFd, baseExtent.data(), extentSize, extent * extentSize)) {
+                closeFiles();
+                throw std::runtime_error("Could not read " + dataPath.str() + " or " + basePath.str());
+            }
+            if (std::memcmp(dataExtent.data(), baseExtent.data(), extentSize) != 0) {
+                patchedExtents.push_back(extent);
+            }
+        }
+        patchedExtents = coalesceRuns(patchedExtents, LayerManifest::maxPatchRuns);
+        if (patchedExtents.size() == sharedExtents) {
+            closeFiles();
+            return 0;
+        }
+
+        LayerManifest manifest;
+        manifest.extentSize = extentSize;
+        manifest.sharedLength = sharedExtents * extentSize;
+        manifest.basePath = basePath;
+        manifest.patchedExtents = patchedExtents;
+        auto patchPath = manifest.patchPath(dataPath);
+        auto tailPath = LayerManifest::tailPath(dataPath);
+        auto patchFd = ::open(patchPath.str().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        auto tailFd = ::open(tailPath.str().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        bool copied = patchFd >= 0 && tailFd >= 0;
+        for (size_t i = 0; copied && i < patchedExtents.size(); i++) {
+            copied = readAt(dataFd, dataExtent.data(), extentSize, patchedExtents[i] * extentSize) && writeAt(patchFd, dataExtent.data(), extentSize, i * extentSize);
+        }
+        for (auto offset = manifest.sharedLength; copied && offset < dataSize; offset += extentSize) {
+            auto length = std::min(extentSize, dataSize - offset);
+            copied = readAt(dataFd, dataExtent.data(), length, offset) && writeAt(tailFd, dataExtent.data(), length, offset - manifest.sharedLength);
+        }
+        for (auto fd : {patchFd, tailFd}) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+        closeFiles();
+        if (!copied) {
+            std::remove(patchPath.str().c_str());
+            std::remove(tailPath.str().c_str());
+            throw std::runtime_error("Could not write the layer of " + dataPath.str());
+        }
+
+        // The file is only removed once the manifest describing its replacement is complete
+        manifest.save(dataPath);
+        std::remove(dataPath.str().c_str());
+        std::remove(FileChecksums::checksumPath(dataPath).str().c_str());
+        return static_cast<int64_t>(manifest.sharedLength - patchedExtents.size() * extentSize);
+    }
+
+    std::vector<std::pair<filesystem::path, int64_t>> layerDirectoryOverBase(const filesystem::path &directory, const filesystem::path &baseDirectory, int64_t minimumSize) {
+        std::vector<std::string> names;
+        auto dir = opendir(directory.str().c_str());
+        if (dir == nullptr) {
+            return {};
+        }
+        while (auto entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name.size() > 4 && name.compare(name.size() - 4, 4, ".dat") == 0) {
+                names.push_back(name);
+            }
+        }
+        closedir(dir);
+        std::sort(names.begin(), names.end());
+
+        std::vector<std::pair<filesystem::path, int64_t>> layered;
+        for (auto &name : names) {
+            auto dataPath = directory/name;
+            auto basePath = baseDirectory/name;
+            if (!isRegularFile(dataPath.str()) || !isRegularFile(basePath.str()) || static_cast<int64_t>(dataPath.file_size()) < minimumSize) {
+                continue;
+            }
+            auto sharedBytes = layerOverBase(dataPath, basePath);
+            if (sharedBytes > 0) {
+                // The layers are only valid as long as the base doesn't change
+                struct stat baseStat;
+                if (stat(basePath.str().c_str(), &baseStat) == 0) {
+                    chmod(basePath.str().c_str(), baseStat.st_mode & ~static_cast<mode_t>(S_IWUSR | S_IWGRP | S_IWOTH));
+                }
+                layered.emplace_back(dataPath, sharedBytes);
+            }
+        }
+        return layered;
+    }
+} // namespace blocksci
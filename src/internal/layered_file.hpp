@@ -0,0 +1,158 @@
+//
+//  layered_file.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_layered_file_hpp
+#define blocksci_layered_file_hpp
+
+#include <wjfilesystem/path.h>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace blocksci {
+
+    /** Layout of a data file that is stored as a copy-on-write layer over the same file of a shared base directory
+     *
+     * Forks of a chain (eg. BTC, BCH and BSV) have identical data files up to the fork height. A base directory parsed
+     * up to that height is shared by all of them and every chain only keeps the parts of a file that differ from it.
+     * The base files are never written to again, so their pages are shared by all processes that read any of the chains.
+     *
+     * Files: - <file>.dat.layer: the manifest, [<LayerHeader>, <char basePath[basePathLength]>, <uint64_t patchedExtents[patchCount]>]
+     *        - <file>.dat.patch.<generation>: copies of the extents of the base the chain changed, in manifest order
+     *        - <file>.dat.tail: bytes [sharedLength, size) of the file
+     * The file itself (<file>.dat) doesn't exist, so tools that don't know about layers fail instead of reading a part of it.
+     */
+    struct LayerManifest {
+        /** Granularity of the patches, a multiple of the page size */
+        static constexpr uint64_t defaultExtentSize = 1024 * 1024;
+
+        /** Upper bound on the number of contiguous runs of patches per file. Every run is a separate mapping, so
+         * closer runs are merged by patching the extents between them to stay far below vm.max_map_count */
+        static constexpr size_t maxPatchRuns = 128;
+
+        uint64_t extentSize = defaultExtentSize;
+
+        /** Bytes [0, sharedLength) are read from the base unless patched, a multiple of extentSize */
+        uint64_t sharedLength = 0;
+
+        /** Incremented whenever the patch file is rewritten instead of appended to */
+        uint64_t generation = 1;
+
+        /** Data file of the base directory */
+        filesystem::path basePath;
+
+        /** Extent numbers of the patches, in the order they are stored in the patch file */
+        std::vector<uint64_t> patchedExtents;
+
+        static filesystem::path manifestPath(const filesystem::path &dataPath) {
+            return filesystem::path{dataPath.str() + ".layer"};
+        }
+
+        static filesystem::path tailPath(const filesystem::path &dataPath) {
+            return filesystem::path{dataPath.str() + ".tail"};
+        }
+
+        filesystem::path patchPath(const filesystem::path &dataPath) const {
+            return filesystem::path{dataPath.str() + ".patch." + std::to_string(generation)};
+        }
+
+        static bool isLayered(const filesystem::path &dataPath) {
+            return manifestPath(dataPath).exists();
+        }
+
+        /** Logical size of a layered data file */
+        static int64_t layeredSize(const filesystem::path &dataPath);
+
+        static LayerManifest load(const filesystem::path &dataPath);
+
+        /** Replace the manifest in one step */
+        void save(const filesystem::path &dataPath) const;
+    };
+
+    /** Contiguous mapping of a layered data file, @see LayerManifest
+     *
+     * The shared part of the base, the patches and the tail are mapped next to each other into one reserved range of
+     * address space, so pointers into the file work as with a regular mapping and stay valid when the tail grows.
+     *
+     * A writable LayeredFile maps the base copy-on-write and records which extents were written to. When it is
+     * destroyed the extents that now differ from the base are appended to the patch file. Writes to extents that
+     * already are patched and to the tail go directly to their files. Only one writable LayeredFile of a file can be
+     * open at a time and its changes to the base extents become visible to readers when it is destroyed.
+     */
+    class LayeredFile {
+    public:
+        LayeredFile(const filesystem::path &dataPath, bool writable);
+        LayeredFile(const LayeredFile &) = delete;
+        LayeredFile &operator=(const LayeredFile &) = delete;
+        ~LayeredFile();
+
+        char *data() {
+            return mapping;
+        }
+
+        const char *data() const {
+            return mapping;
+        }
+
+        int64_t size() const {
+            return logicalSize;
+        }
+
+        int64_t sharedLength() const {
+            return static_cast<int64_t>(manifest.sharedLength);
+        }
+
+        /** Change the size of the file by resizing the tail. Writable only, the shared part can't be truncated */
+        void resize(int64_t newSize);
+
+        /** Record that the bytes [offset, offset + length) may have been written to through data() */
+        void markWritten(int64_t offset, int64_t length);
+
+        /** Pick up changes of the tail and the manifest made by other writers. A read-only LayeredFile is remapped
+         * if the patches changed, which invalidates outstanding pointers */
+        void reload();
+
+    private:
+        filesystem::path dataPath;
+        bool writable;
+        LayerManifest manifest;
+        int baseFd = -1;
+        int patchFd = -1;
+        int tailFd = -1;
+
+        /** Descriptor of the manifest holding the lock of a writable LayeredFile */
+        int lockFd = -1;
+
+        char *mapping = nullptr;
+        int64_t reservedLength = 0;
+        int64_t logicalSize = 0;
+        int64_t mappedTailLength = 0;
+
+        /** Extents of the shared part that were written to since the file was opened */
+        std::vector<bool> writtenExtents;
+
+        void openFiles();
+        void closeFiles();
+        void map();
+        void unmap();
+        void mapTail(int64_t tailLength);
+        void savePatches();
+    };
+
+    /** Replace the data file by a layer over the same file of a base directory, keeping only the extents that differ
+     * from it and the bytes past its end. Returns the number of bytes that are now read from the base */
+    int64_t layerOverBase(const filesystem::path &dataPath, const filesystem::path &basePath, uint64_t extentSize = LayerManifest::defaultExtentSize);
+
+    /** Layer every data file of at least minimumSize bytes in the directory over the file of the same name in
+     * baseDirectory (@see layerOverBase) and make the base files read-only. Returns the converted files together with
+     * the number of bytes they now read from the base */
+    std::vector<std::pair<filesystem::path, int64_t>> layerDirectoryOverBase(const filesystem::path &directory, const filesystem::path &baseDirectory, int64_t minimumSize);
+} // namespace blocksci
+
+#endif /* blocksci_layered_file_hpp */
@@ -0,0 +1,64 @@
+//
+//  lazy_index.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_index_lazy_index_hpp
+#define blocksci_index_lazy_index_hpp
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace blocksci {
+
+    /** Holds an index that is only opened when it is first used
+     *
+     * Opening the RocksDB indexes reads their manifests and table metadata, which analyses that only scan the chain
+     * never need. get() is thread safe and only takes a lock until the index is open.
+     */
+    template <typename T>
+    class LazyIndex {
+        struct State {
+            std::function<std::unique_ptr<T>()> open;
+            std::mutex mutex;
+            std::unique_ptr<T> index;
+            std::atomic<T *> openIndex{nullptr};
+        };
+
+        /** Held by pointer so that the index can be moved */
+        std::unique_ptr<State> state;
+
+    public:
+        LazyIndex() = default;
+
+        explicit LazyIndex(std::function<std::unique_ptr<T>()> open) : state(std::make_unique<State>()) {
+            state->open = std::move(open);
+        }
+
+        /** The index, opened if this is its first use */
+        T &get() const {
+            auto index = state->openIndex.load(std::memory_order_acquire);
+            if (index == nullptr) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                index = state->openIndex.load(std::memory_order_relaxed);
+                if (index == nullptr) {
+                    state->index = state->open();
+                    index = state->index.get();
+                    state->openIndex.store(index, std::memory_order_release);
+                }
+            }
+            return *index;
+        }
+
+        /** The index if it was opened already, nullptr otherwise */
+        T *getIfOpen() const {
+            return state ? state->openIndex.load(std::memory_order_acquire) : nullptr;
+        }
+    };
+} // namespace blocksci
+
+#endif /* blocksci_index_lazy_index_hpp */
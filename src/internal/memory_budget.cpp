@@ -0,0 +1,202 @@
+//
+//  memory_budget.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "memory_budget.hpp"
+#include "address_index.hpp"
+#include "chain_access.hpp"
+#include "data_access.hpp"
+#include "hash_index.hpp"
+#include "page_cache.hpp"
+
+#include <rocksdb/cache.h>
+#include <rocksdb/utilities/memory_util.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+namespace blocksci {
+    namespace {
+        /** Columns whose mappings the budget may drop, coldest first. The remaining ones are read by nearly every query */
+        constexpr ChainColumn droppableColumns[] = {
+            ChainColumn::InputSpentValue, ChainColumn::InputSpentHeight, ChainColumn::TxVirtualSize, ChainColumn::TxFee, ChainColumn::OutputSpendingHeight, ChainColumn::OutputSpendingInput,
+            ChainColumn::OutputSpentTx, ChainColumn::OutputAddress, ChainColumn::OutputType, ChainColumn::OutputValue,
+            ChainColumn::Coinbase, ChainColumn::Sequence, ChainColumn::InputSpentOutNum, ChainColumn::TxHashes,
+            ChainColumn::TxVersion, ChainColumn::TxData
+        };
+
+        filesystem::path columnFilePath(const filesystem::path &chainDirectory, ChainColumn column) {
+            auto datFile = [](const filesystem::path &path) {
+                return filesystem::path{path.str() + ".dat"};
+            };
+            switch (column) {
+                case ChainColumn::Block:
+                    return datFile(ChainAccess::blockFilePath(chainDirectory));
+                case ChainColumn::Coinbase:
+                    return datFile(ChainAccess::blockCoinbaseFilePath(chainDirectory));
+                case ChainColumn::TxData:
+                    return datFile(filesystem::path{ChainAccess::txFilePath(chainDirectory).str() + "_data"});
+                case ChainColumn::TxIndex:
+                    return datFile(filesystem::path{ChainAccess::txFilePath(chainDirectory).str() + "_index"});
+                case ChainColumn::TxVersion:
+                    return datFile(ChainAccess::txVersionFilePath(chainDirectory));
+                case ChainColumn::FirstInput:
+                    return datFile(ChainAccess::firstInputFilePath(chainDirectory));
+                case ChainColumn::FirstOutput:
+                    return datFile(ChainAccess::firstOutputFilePath(chainDirectory));
+                case ChainColumn::InputSpentOutNum:
+                    return datFile(ChainAccess::inputSpentOutNumFilePath(chainDirectory));
+                case ChainColumn::Sequence:
+                    return datFile(ChainAccess::sequenceFilePath(chainDirectory));
+                case ChainColumn::TxHashes:
+                    return datFile(ChainAccess::txHashesFilePath(chainDirectory));
+                case ChainColumn::OutputValue:
+                    return datFile(ChainAccess::outputValueFilePath(chainDirectory));
+                case ChainColumn::OutputType:
+                    return datFile(ChainAccess::outputTypeFilePath(chainDirectory));
+                case ChainColumn::OutputAddress:
+                    return datFile(ChainAccess::outputAddressFilePath(chainDirectory));
+                case ChainColumn::OutputSpentTx:
+                    return datFile(ChainAccess::outputSpentTxFilePath(chainDirectory));
+                case ChainColumn::OutputSpendingInput:
+                    return datFile(ChainAccess::outputSpendingInputFilePath(chainDirectory));
+                case ChainColumn::OutputSpendingHeight:
+                    return datFile(ChainAccess::outputSpendingHeightFilePath(chainDirectory));
+                case ChainColumn::TxFee:
+                    return datFile(ChainAccess::txFeeFilePath(chainDirectory));
+                case ChainColumn::TxVirtualSize:
+                    return datFile(ChainAccess::txVirtualSizeFilePath(chainDirectory));
+                case ChainColumn::InputSpentHeight:
+                    return datFile(ChainAccess::inputSpentHeightFilePath(chainDirectory));
+                case ChainColumn::InputSpentValue:
+                    return datFile(ChainAccess::inputSpentValueFilePath(chainDirectory));
+                case ChainColumn::BlockStats:
+                    return datFile(ChainAccess::blockStatsFilePath(chainDirectory));
+                case ChainColumn::TxPackageFlags:
+                    return datFile(ChainAccess::txPackageFlagsFilePath(chainDirectory));
+            }
+            return {};
+        }
+
+        /** Block caches of the open indexes, without duplicates */
+        std::vector<std::shared_ptr<rocksdb::Cache>> openBlockCaches(const DataAccess &access) {
+            std::vector<std::shared_ptr<rocksdb::Cache>> caches;
+            auto add = [&](std::shared_ptr<rocksdb::Cache> cache) {
+                if (cache && std::find(caches.begin(), caches.end(), cache) == caches.end()) {
+                    caches.push_back(std::move(cache));
+                }
+            };
+            if (auto index = access.addressIndex.getIfOpen()) {
+                add(index->getBlockCache());
+            }
+            if (auto index = access.hashIndex.getIfOpen()) {
+                add(index->getBlockCache());
+            }
+            return caches;
+        }
+
+        IndexMemoryUsage indexMemoryUsage(const DataAccess &access) {
+            IndexMemoryUsage usage;
+            std::vector<rocksdb::DB *> dbs;
+            if (auto index = access.addressIndex.getIfOpen()) {
+                dbs.push_back(index->getDB());
+            }
+            if (auto index = access.hashIndex.getIfOpen()) {
+                dbs.push_back(index->getDB());
+            }
+            if (dbs.empty()) {
+                return usage;
+            }
+            std::unordered_set<const rocksdb::Cache *> cacheSet;
+            for (auto &cache : openBlockCaches(access)) {
+                cacheSet.insert(cache.get());
+                usage.blockCacheCapacity += cache->GetCapacity();
+            }
+            std::map<rocksdb::MemoryUtil::UsageType, uint64_t> usageByType;
+            if (rocksdb::MemoryUtil::GetApproximateMemoryUsageByType(dbs, cacheSet, &usageByType).ok()) {
+                usage.memtableBytes = usageByType[rocksdb::MemoryUtil::kMemTableTotal];
+                usage.tableReaderBytes = usageByType[rocksdb::MemoryUtil::kTableReadersTotal];
+                usage.blockCacheBytes = usageByType[rocksdb::MemoryUtil::kCacheTotal];
+            }
+            return usage;
+        }
+
+        uint64_t processResidentBytes() {
+            // The second field of statm is the resident set size in pages
+            std::ifstream statm("/proc/self/statm");
+            uint64_t totalPages = 0;
+            uint64_t residentPages = 0;
+            if (!(statm >> totalPages >> residentPages)) {
+                return 0;
+            }
+            return residentPages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+        }
+    } // namespace
+
+    MemoryUsage memoryUsage(const DataAccess &access) {
+        MemoryUsage usage;
+        usage.mappedFiles = dataFileResidency(access.config);
+        for (auto &file : usage.mappedFiles) {
+            usage.mappedResidentBytes += file.residentBytes;
+        }
+        usage.residentMode = access.residentMemory;
+        usage.indexes = indexMemoryUsage(access);
+        usage.chainIndexBytes = access.getChain().indexMemoryUsage();
+        usage.processResidentBytes = processResidentBytes();
+        return usage;
+    }
+
+    MemoryBudgetResult enforceMemoryBudget(DataAccess &access, uint64_t budget) {
+        MemoryBudgetResult result;
+        result.budget = budget;
+        if (budget == 0) {
+            return result;
+        }
+        result.usageBefore = memoryUsage(access).totalBytes();
+        if (result.usageBefore <= budget) {
+            return result;
+        }
+        auto excess = result.usageBefore - budget;
+
+        for (auto &cache : openBlockCaches(access)) {
+            if (excess == 0) {
+                break;
+            }
+            auto before = static_cast<uint64_t>(cache->GetUsage());
+            auto target = std::max({minimumBudgetBlockCacheSize, before > excess ? before - excess : 0, static_cast<uint64_t>(cache->GetPinnedUsage())});
+            if (target >= cache->GetCapacity()) {
+                continue;
+            }
+            cache->SetCapacity(target);
+            auto after = static_cast<uint64_t>(cache->GetUsage());
+            auto released = before > after ? before - after : 0;
+            result.blockCacheReleased += released;
+            excess -= std::min(excess, released);
+        }
+
+        auto chainDirectory = access.config.chainDirectory();
+        for (auto column : droppableColumns) {
+            if (excess == 0) {
+                break;
+            }
+            auto residency = fileResidency(columnFilePath(chainDirectory, column));
+            if (residency.residentBytes == 0) {
+                continue;
+            }
+            access.chain->advise(column, AccessHint::DontNeed);
+            result.mappingReleased += residency.residentBytes;
+            result.droppedColumns.push_back(column);
+            excess -= std::min(excess, residency.residentBytes);
+        }
+        return result;
+    }
+} // namespace blocksci
@@ -0,0 +1,36 @@
+//
+//  memory_budget.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_memory_budget_hpp
+#define blocksci_memory_budget_hpp
+
+#include <blocksci/core/access_hint.hpp>
+
+#include <cstdint>
+
+namespace blocksci {
+    class DataAccess;
+
+    /** Block caches are never shrunk below this capacity by the memory budget */
+    constexpr uint64_t minimumBudgetBlockCacheSize = uint64_t{16} * 1024 * 1024;
+
+    /** Memory footprint of the chain: page cache residency of the data files (mincore), the RocksDB memory of the open
+     * indexes (GetApproximateMemoryUsageByType), the in-memory chain indexes and the copies of resident mode */
+    MemoryUsage memoryUsage(const DataAccess &access);
+
+    /** Release memory until the footprint of the chain fits into budget bytes, a budget of 0 is unlimited
+     *
+     * First lowers the capacity of the RocksDB block caches down to minimumBudgetBlockCacheSize, which evicts their
+     * least recently used blocks. If that isn't enough the chain/ data files are dropped from their mappings with
+     * madvise(MADV_DONTNEED), starting with the optional columns and never touching the block, tx index, first input
+     * and first output files that nearly every query needs. Dropped pages fault back in when they are accessed again.
+     * A block cache shared between chains (sharedIndexCacheMB) shrinks for all of them.
+     */
+    MemoryBudgetResult enforceMemoryBudget(DataAccess &access, uint64_t budget);
+} // namespace blocksci
+
+#endif /* blocksci_memory_budget_hpp */
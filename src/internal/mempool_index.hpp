@@ -10,12 +10,16 @@
 
 #include "file_mapper.hpp"
 
+#include <blocksci/chain/mempool_time_columns.hpp>
+
 #include <range/v3/algorithm/upper_bound.hpp>
 #include <range/v3/view/transform.hpp>
 
 #include <wjfilesystem/path.h>
 
+#include <algorithm>
 #include <chrono>
+#include <vector>
 
 namespace blocksci {
     
@@ -23,20 +27,28 @@ namespace blocksci {
         time_t time;
     };
     
+    static_assert(sizeof(MempoolRecord) == sizeof(int64_t), "MempoolTimeSegment views the records as 64 bit timestamps");
+    
     struct BlockRecord {
         time_t observationTime;
     };
     
     struct TimestampIndex {
         FixedSizeFileMapper<MempoolRecord> timestampFile;
+        /** Milliseconds to add to the timestamps, missing in recordings made before they were recorded */
+        FixedSizeFileMapper<uint16_t> millisecondFile;
         uint32_t firstTxIndex;
         
-        explicit TimestampIndex(const filesystem::path &path, uint32_t firstTxIndex_) : timestampFile(path), firstTxIndex(firstTxIndex_) {}
+        TimestampIndex(const filesystem::path &path, const filesystem::path &millisecondPath, uint32_t firstTxIndex_) : timestampFile(path), millisecondFile(millisecondPath), firstTxIndex(firstTxIndex_) {}
         
         ranges::optional<std::chrono::system_clock::time_point> getTime(uint32_t index) const {
             auto record = getTimestamp(index);
             if (record.has_value()) {
-                return std::chrono::system_clock::from_time_t(record.value());
+                auto time = std::chrono::system_clock::from_time_t(record.value());
+                if (index - firstTxIndex < millisecondFile.size()) {
+                    time += std::chrono::milliseconds(*millisecondFile[index - firstTxIndex]);
+                }
+                return time;
             } else {
                 return ranges::nullopt;
             }
@@ -66,19 +78,26 @@ namespace blocksci {
         
         void reload() {
             timestampFile.reload();
+            millisecondFile.reload();
         }
     };
     
     struct BlocktimeIndex {
         FixedSizeFileMapper<BlockRecord> timestampFile;
+        /** Milliseconds to add to the timestamps, missing in recordings made before they were recorded */
+        FixedSizeFileMapper<uint16_t> millisecondFile;
         int firstBlockNum;
         
-        explicit BlocktimeIndex(const filesystem::path &path, int firstBlockNum_) : timestampFile(path), firstBlockNum(firstBlockNum_) {}
+        BlocktimeIndex(const filesystem::path &path, const filesystem::path &millisecondPath, int firstBlockNum_) : timestampFile(path), millisecondFile(millisecondPath), firstBlockNum(firstBlockNum_) {}
         
         ranges::optional<std::chrono::system_clock::time_point> getTime(OffsetType index) const {
             auto record = getTimestamp(index);
             if (record) {
-                return std::chrono::system_clock::from_time_t(record.value());
+                auto time = std::chrono::system_clock::from_time_t(record.value());
+                if (index - firstBlockNum < millisecondFile.size()) {
+                    time += std::chrono::milliseconds(*millisecondFile[index - firstBlockNum]);
+                }
+                return time;
             } else {
                 return ranges::nullopt;
             }
@@ -100,6 +119,7 @@ namespace blocksci {
         
         void reload() {
             timestampFile.reload();
+            millisecondFile.reload();
         }
     };
 
@@ -117,12 +137,12 @@ namespace blocksci {
             timestampFiles.clear();
             FixedSizeFileMapper<uint32_t> txRecordingPositions{txIndexFilePath(baseDirectory)};
             for (OffsetType i = 0; i < static_cast<OffsetType>(txRecordingPositions.size()); i++) {
-                timestampFiles.emplace_back(nthTxFilePath(baseDirectory, i), *txRecordingPositions[i]);
+                timestampFiles.emplace_back(nthTxFilePath(baseDirectory, i), nthTxMillisecondFilePath(baseDirectory, i), *txRecordingPositions[i]);
             }
             blockTimeFiles.clear();
             FixedSizeFileMapper<int> blockRecordingPositions{blockIndexFilePath(baseDirectory)};
             for (OffsetType i = 0; i < static_cast<OffsetType>(blockRecordingPositions.size()); i++) {
-                blockTimeFiles.emplace_back(nthBlockFilePath(baseDirectory, i), *blockRecordingPositions[i]);
+                blockTimeFiles.emplace_back(nthBlockFilePath(baseDirectory, i), nthBlockMillisecondFilePath(baseDirectory, i), *blockRecordingPositions[i]);
             }
         }
         
@@ -142,6 +162,14 @@ namespace blocksci {
             return baseDirectory/(std::to_string(i) + "_block");
         }
         
+        static filesystem::path nthTxMillisecondFilePath(const filesystem::path &baseDirectory, int64_t i) {
+            return baseDirectory/(std::to_string(i) + "_tx_ms");
+        }
+        
+        static filesystem::path nthBlockMillisecondFilePath(const filesystem::path &baseDirectory, int64_t i) {
+            return baseDirectory/(std::to_string(i) + "_block_ms");
+        }
+        
     public:
         explicit MempoolIndex(filesystem::path baseDirectory_) :  baseDirectory(std::move(baseDirectory_)) {
             setup();
@@ -173,6 +201,31 @@ namespace blocksci {
             return ranges::nullopt;
         }
 
+        /** Slices of the recordings overlapping the txes [beginTxNum, endTxNum), in tx order */
+        std::vector<MempoolTimeSegment> txTimeSegments(uint32_t beginTxNum, uint32_t endTxNum) const {
+            std::vector<MempoolTimeSegment> segments;
+            for (auto &file : timestampFiles) {
+                auto fileEnd = file.firstTxIndex + static_cast<uint32_t>(file.timestampFile.size());
+                auto begin = std::max(beginTxNum, file.firstTxIndex);
+                auto end = std::min(endTxNum, fileEnd);
+                if (begin >= end) {
+                    continue;
+                }
+                MempoolTimeSegment segment;
+                auto offset = static_cast<OffsetType>(begin - file.firstTxIndex);
+                segment.timestamps = reinterpret_cast<const int64_t *>(file.timestampFile[offset]);
+                segment.firstTxNum = begin;
+                segment.count = end - begin;
+                auto millisecondEnd = std::min(end, file.firstTxIndex + static_cast<uint32_t>(file.millisecondFile.size()));
+                if (millisecondEnd > begin) {
+                    segment.milliseconds = file.millisecondFile[offset];
+                    segment.millisecondCount = millisecondEnd - begin;
+                }
+                segments.push_back(segment);
+            }
+            return segments;
+        }
+
         ranges::optional<std::chrono::system_clock::time_point> getTxTime(uint32_t index) const {
             auto possibleFile = selectPossibleTxRecording(index);
             if (possibleFile) {
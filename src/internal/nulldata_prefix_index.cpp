@@ -0,0 +1,194 @@
+//
+//  nulldata_prefix_index.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include "nulldata_prefix_index.hpp"
+#include "script_access.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+
+namespace blocksci {
+
+    namespace {
+        // Merging rewrites the main file, so it only happens once the recent entries are a significant fraction of it
+        constexpr OffsetType minMergeSize = 1'000'000;
+        constexpr OffsetType mergeFraction = 8;
+
+        using Entry = NulldataPrefixIndex::Entry;
+
+        bool byKey(const Entry &a, const Entry &b) {
+            return std::tie(a.key, a.txNum, a.scriptNum) < std::tie(b.key, b.txNum, b.scriptNum);
+        }
+
+        bool byTx(const Entry &a, const Entry &b) {
+            return std::tie(a.txNum, a.scriptNum) < std::tie(b.txNum, b.scriptNum);
+        }
+
+        std::vector<Entry> readEntries(const FixedSizeFileMapper<Entry> &file) {
+            if (file.size() == 0) {
+                return {};
+            }
+            auto begin = file[0];
+            return std::vector<Entry>(begin, begin + file.size());
+        }
+
+        /** Append the entries of the sorted file whose keys are in [minKey, maxKey] */
+        void findRange(const FixedSizeFileMapper<Entry> &file, uint64_t minKey, uint64_t maxKey, std::vector<Entry> &results) {
+            if (file.size() == 0) {
+                return;
+            }
+            auto begin = file[0];
+            auto end = begin + file.size();
+            auto first = std::lower_bound(begin, end, minKey, [](const Entry &entry, uint64_t key) { return entry.key < key; });
+            auto last = std::upper_bound(first, end, maxKey, [](uint64_t key, const Entry &entry) { return key < entry.key; });
+            results.insert(results.end(), first, last);
+        }
+
+        /** Duplicates can only be left behind by an update that was interrupted */
+        std::vector<Entry> mergeUnique(std::vector<Entry> a, std::vector<Entry> b) {
+            std::vector<Entry> merged;
+            merged.reserve(a.size() + b.size());
+            std::merge(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(merged), byKey);
+            merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+            return merged;
+        }
+
+        void writeEntries(const filesystem::path &path, const std::vector<Entry> &entries) {
+            filesystem::path writePath{path.str() + "Build"};
+            filesystem::path writeFilePath{writePath.str() + ".dat"};
+            if (writeFilePath.exists()) {
+                writeFilePath.remove_file();
+            }
+            {
+                FixedSizeFileMapper<Entry, mio::access_mode::write> file{writePath};
+                file.truncate(static_cast<OffsetType>(entries.size()));
+                if (!entries.empty()) {
+                    std::copy(entries.begin(), entries.end(), file[0]);
+                }
+            }
+            filesystem::path filePath{path.str() + ".dat"};
+            if (std::rename(writeFilePath.str().c_str(), filePath.str().c_str()) != 0) {
+                throw std::runtime_error("Could not move nulldata index file into place at " + filePath.str());
+            }
+        }
+    }
+
+    NulldataPrefixIndex::NulldataPrefixIndex(const filesystem::path &directory) : mainFile(mainPath(directory)), recentFile(recentPath(directory)) {
+        // Lookups binary search both files
+        mainFile.advise(AccessHint::Random);
+    }
+
+    filesystem::path NulldataPrefixIndex::mainPath(const filesystem::path &directory) {
+        return directory/"main";
+    }
+
+    filesystem::path NulldataPrefixIndex::recentPath(const filesystem::path &directory) {
+        return directory/"recent";
+    }
+
+    bool NulldataPrefixIndex::exists(const filesystem::path &directory) {
+        return filesystem::path{mainPath(directory).str() + ".dat"}.exists() || filesystem::path{recentPath(directory).str() + ".dat"}.exists();
+    }
+
+    uint64_t NulldataPrefixIndex::makeKey(const unsigned char *data, size_t size) {
+        uint64_t key = 0;
+        for (size_t i = 0; i < keyPrefixSize; i++) {
+            key = (key << 8) | (i < size ? data[i] : 0);
+        }
+        return (key << 8) | std::min<size_t>(size, 255);
+    }
+
+    std::vector<NulldataPrefixIndex::Entry> NulldataPrefixIndex::find(const std::string &prefix, const ScriptAccess &scripts) const {
+        auto data = reinterpret_cast<const unsigned char *>(prefix.data());
+        uint64_t minKey = 0;
+        uint64_t maxKey = 0;
+        for (size_t i = 0; i < keyPrefixSize; i++) {
+            minKey = (minKey << 8) | (i < prefix.size() ? data[i] : 0);
+            maxKey = (maxKey << 8) | (i < prefix.size() ? data[i] : 0xff);
+        }
+        minKey <<= 8;
+        maxKey = (maxKey << 8) | 0xff;
+
+        std::vector<Entry> results;
+        findRange(mainFile, minKey, maxKey, results);
+        findRange(recentFile, minKey, maxKey, results);
+
+        // The range also contains shorter payloads that are padded to look like the prefix
+        auto end = std::remove_if(results.begin(), results.end(), [&](const Entry &entry) {
+            auto size = static_cast<size_t>(entry.key & 0xff);
+            if (size < std::min<size_t>(prefix.size(), 255)) {
+                return true;
+            }
+            if (prefix.size() <= keyPrefixSize) {
+                return false;
+            }
+            auto payload = scripts.getScriptData<DedupAddressType::NULL_DATA>(entry.scriptNum);
+            return payload->rawData.size() < prefix.size() || !std::equal(data + keyPrefixSize, data + prefix.size(), payload->rawData.begin() + keyPrefixSize);
+        });
+        results.erase(end, results.end());
+        std::sort(results.begin(), results.end(), byTx);
+        results.erase(std::unique(results.begin(), results.end()), results.end());
+        return results;
+    }
+
+    void NulldataPrefixIndex::addEntries(const filesystem::path &directory, std::vector<Entry> entries) {
+        if (!directory.exists()) {
+            filesystem::create_directory(directory);
+        }
+        std::sort(entries.begin(), entries.end(), byKey);
+        std::vector<Entry> recent;
+        OffsetType mainSize;
+        {
+            NulldataPrefixIndex index{directory};
+            recent = mergeUnique(readEntries(index.recentFile), std::move(entries));
+            mainSize = index.mainFile.size();
+        }
+        if (static_cast<OffsetType>(recent.size()) < std::max(minMergeSize, mainSize / mergeFraction)) {
+            writeEntries(recentPath(directory), recent);
+            return;
+        }
+
+        std::vector<Entry> main;
+        {
+            NulldataPrefixIndex index{directory};
+            main = readEntries(index.mainFile);
+        }
+        writeEntries(mainPath(directory), mergeUnique(std::move(main), std::move(recent)));
+        // Entries left in the recent file by a crash at this point are dropped as duplicates later
+        writeEntries(recentPath(directory), {});
+    }
+
+    void NulldataPrefixIndex::removeEntriesFrom(const filesystem::path &directory, uint32_t txCount) {
+        if (!exists(directory)) {
+            return;
+        }
+        auto isRemoved = [txCount](const Entry &entry) {
+            return entry.txNum >= txCount;
+        };
+        std::vector<Entry> main;
+        std::vector<Entry> recent;
+        {
+            NulldataPrefixIndex index{directory};
+            main = readEntries(index.mainFile);
+            recent = readEntries(index.recentFile);
+        }
+        // Removing entries keeps the order by key
+        auto recentEnd = std::remove_if(recent.begin(), recent.end(), isRemoved);
+        if (recentEnd != recent.end()) {
+            recent.erase(recentEnd, recent.end());
+            writeEntries(recentPath(directory), recent);
+        }
+        auto mainEnd = std::remove_if(main.begin(), main.end(), isRemoved);
+        if (mainEnd != main.end()) {
+            main.erase(mainEnd, main.end());
+            writeEntries(mainPath(directory), main);
+        }
+    }
+} // namespace blocksci
@@ -0,0 +1,80 @@
+//
+//  nulldata_prefix_index.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_index_nulldata_prefix_index_hpp
+#define blocksci_index_nulldata_prefix_index_hpp
+
+#include "file_mapper.hpp"
+
+#include <wjfilesystem/path.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace blocksci {
+    class ScriptAccess;
+
+    /** Index from the leading payload bytes of OP_RETURN (nulldata) outputs to their scripts
+     *
+     * Every nulldata script has one Entry whose key holds the first keyPrefixSize payload bytes in big endian order,
+     * followed by a byte with the payload size (saturated at 255). Sorting by key thus sorts by payload prefix, and all
+     * payloads beginning with a given prefix of up to keyPrefixSize bytes form one contiguous range of entries.
+     * Longer prefixes are checked against the script data.
+     *
+     * The sorted entries are split into a large main file and a small file of recent entries, which is rewritten on
+     * every update. Once the recent entries grow to a fraction of the main file, both are merged into a new main file.
+     * Files are replaced by renaming complete copies over them.
+     *
+     * Directory: nulldataIndex/
+     */
+    class NulldataPrefixIndex {
+    public:
+        struct Entry {
+            uint64_t key;
+            uint32_t scriptNum;
+            uint32_t txNum;
+
+            bool operator==(const Entry &other) const {
+                return key == other.key && scriptNum == other.scriptNum && txNum == other.txNum;
+            }
+        };
+
+        static constexpr size_t keyPrefixSize = 7;
+
+        explicit NulldataPrefixIndex(const filesystem::path &directory);
+
+        /** Whether the index was built for this data directory */
+        static bool exists(const filesystem::path &directory);
+
+        /** Key of a payload */
+        static uint64_t makeKey(const unsigned char *data, size_t size);
+
+        /** Entries of all nulldata scripts whose payload begins with prefix, sorted by (txNum, scriptNum) */
+        std::vector<Entry> find(const std::string &prefix, const ScriptAccess &scripts) const;
+
+        /** Number of indexed scripts */
+        OffsetType size() const {
+            return mainFile.size() + recentFile.size();
+        }
+
+        /** Add entries of scripts that aren't in the index yet */
+        static void addEntries(const filesystem::path &directory, std::vector<Entry> entries);
+
+        /** Remove the entries of the scripts created by transaction txCount and later, used to undo reorganized blocks */
+        static void removeEntriesFrom(const filesystem::path &directory, uint32_t txCount);
+
+    private:
+        FixedSizeFileMapper<Entry> mainFile;
+        FixedSizeFileMapper<Entry> recentFile;
+
+        static filesystem::path mainPath(const filesystem::path &directory);
+        static filesystem::path recentPath(const filesystem::path &directory);
+    };
+} // namespace blocksci
+
+#endif /* blocksci_index_nulldata_prefix_index_hpp */
@@ -0,0 +1,129 @@
+//
+//  numa.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include "numa.hpp"
+
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace blocksci {
+    namespace {
+        /** Parse a cpulist such as "0-15,32-47" */
+        std::vector<unsigned> parseCpuList(const std::string &list) {
+            std::vector<unsigned> cpus;
+            std::stringstream ss(list);
+            std::string item;
+            while (std::getline(ss, item, ',')) {
+                if (item.empty() || item == "\n") {
+                    continue;
+                }
+                auto dash = item.find('-');
+                try {
+                    auto first = static_cast<unsigned>(std::stoul(item.substr(0, dash)));
+                    auto last = dash == std::string::npos ? first : static_cast<unsigned>(std::stoul(item.substr(dash + 1)));
+                    for (auto cpu = first; cpu <= last; cpu++) {
+                        cpus.push_back(cpu);
+                    }
+                } catch (const std::exception &) {
+                    return {};
+                }
+            }
+            return cpus;
+        }
+
+        std::vector<NumaNode> readNumaNodes() {
+            std::vector<NumaNode> nodes;
+#ifdef __linux__
+            // Node numbers can have gaps, scan well past the last node found
+            for (unsigned node = 0, missing = 0; missing < 64; node++) {
+                std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+                if (!file) {
+                    missing++;
+                    continue;
+                }
+                std::string list;
+                std::getline(file, list);
+                auto cpus = parseCpuList(list);
+                if (!cpus.empty()) {
+                    nodes.push_back(NumaNode{node, std::move(cpus)});
+                }
+            }
+#endif
+            if (nodes.empty()) {
+                std::vector<unsigned> cpus(std::max(std::thread::hardware_concurrency(), 1u));
+                for (unsigned i = 0; i < cpus.size(); i++) {
+                    cpus[i] = i;
+                }
+                nodes.push_back(NumaNode{0, std::move(cpus)});
+            }
+            return nodes;
+        }
+
+#ifdef __linux__
+        void bindRange(char *begin, size_t length, int mode, const std::vector<unsigned> &nodes) {
+            if (length == 0 || nodes.empty()) {
+                return;
+            }
+            constexpr size_t maxNode = 1024;
+            unsigned long mask[maxNode / (8 * sizeof(unsigned long))] = {};
+            for (auto node : nodes) {
+                if (node < maxNode) {
+                    mask[node / (8 * sizeof(unsigned long))] |= 1ul << (node % (8 * sizeof(unsigned long)));
+                }
+            }
+            syscall(SYS_mbind, begin, length, mode, mask, maxNode + 1, 0);
+        }
+#endif
+    }
+
+    const std::vector<NumaNode> &numaNodes() {
+        static const auto nodes = readNumaNodes();
+        return nodes;
+    }
+
+    void applyNumaPlacement(char *begin, size_t length, NumaPlacement placement) {
+#ifdef __linux__
+        auto &nodes = numaNodes();
+        if (placement == NumaPlacement::Default || begin == nullptr || nodes.size() < 2) {
+            return;
+        }
+        // mbind requires page aligned ranges, which anonymous mappings start at
+        static const auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        if (placement == NumaPlacement::Interleave) {
+            std::vector<unsigned> numbers;
+            for (auto &node : nodes) {
+                numbers.push_back(node.number);
+            }
+            bindRange(begin, length, MPOL_INTERLEAVE, numbers);
+            return;
+        }
+        auto pages = (length + pageSize - 1) / pageSize;
+        for (size_t i = 0; i < nodes.size(); i++) {
+            auto firstPage = pages * i / nodes.size();
+            auto endPage = pages * (i + 1) / nodes.size();
+            bindRange(begin + firstPage * pageSize, (endPage - firstPage) * pageSize, MPOL_PREFERRED, {nodes[i].number});
+        }
+#else
+        (void)begin;
+        (void)length;
+        (void)placement;
+#endif
+    }
+} // namespace blocksci
@@ -0,0 +1,38 @@
+//
+//  numa.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_numa_hpp
+#define blocksci_numa_hpp
+
+#include <blocksci/core/access_hint.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace blocksci {
+    struct NumaNode {
+        /** Node number used by the kernel */
+        unsigned number;
+        
+        std::vector<unsigned> cpus;
+    };
+    
+    /** NUMA nodes with at least one CPU ordered by node number, read once from /sys/devices/system/node
+     *
+     * A single node 0 with all hardware threads is returned on machines without NUMA information. */
+    const std::vector<NumaNode> &numaNodes();
+
+    /** Set the memory policy (mbind) of the anonymous memory [begin, begin + length) before it is first touched
+     *
+     * Interleave spreads the pages over all nodes, Partition prefers the i-th of numaNodes() for the i-th of as many equal
+     * slices. Has no effect on single node machines or outside Linux, failures are ignored since the policy never
+     * affects correctness. The kernel ignores policies of shared file mappings, so this is only useful for private copies.
+     */
+    void applyNumaPlacement(char *begin, size_t length, NumaPlacement placement);
+} // namespace blocksci
+
+#endif /* blocksci_numa_hpp */
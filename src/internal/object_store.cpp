@@ -0,0 +1,256 @@
+//
+//  object_store.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "object_store.hpp"
+
+#ifdef BLOCKSCI_WITH_CURL
+#include <curl/curl.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace blocksci {
+    namespace {
+        std::string environmentValue(const char *name) {
+            auto value = std::getenv(name);
+            return value != nullptr ? std::string{value} : std::string{};
+        }
+
+#ifdef BLOCKSCI_WITH_CURL
+        constexpr int maxAttempts = 4;
+
+        /** Percent-encode everything but the unreserved chars of RFC 3986, and slashes if keepSlashes is set */
+        std::string uriEncode(const std::string &value, bool keepSlashes) {
+            static const char hexDigits[] = "0123456789ABCDEF";
+            std::string encoded;
+            for (auto c : value) {
+                auto byte = static_cast<unsigned char>(c);
+                if (std::isalnum(byte) || c == '-' || c == '_' || c == '.' || c == '~' || (keepSlashes && c == '/')) {
+                    encoded += c;
+                } else {
+                    encoded += '%';
+                    encoded += hexDigits[byte >> 4];
+                    encoded += hexDigits[byte & 15];
+                }
+            }
+            return encoded;
+        }
+
+        std::string xmlUnescape(std::string value) {
+            static const std::pair<const char *, char> entities[] = {{"&amp;", '&'}, {"&lt;", '<'}, {"&gt;", '>'}, {"&quot;", '"'}, {"&apos;", '\''}};
+            std::string::size_type pos = 0;
+            while ((pos = value.find('&', pos)) != std::string::npos) {
+                for (auto &entity : entities) {
+                    auto length = std::strlen(entity.first);
+                    if (value.compare(pos, length, entity.first) == 0) {
+                        value.replace(pos, length, 1, entity.second);
+                        break;
+                    }
+                }
+                pos++;
+            }
+            return value;
+        }
+
+        /** Contents of the first <tag> element in [begin, end) of the xml, or nothing if there is none */
+        std::string xmlValue(const std::string &xml, const std::string &tag, std::string::size_type begin = 0, std::string::size_type end = std::string::npos) {
+            auto open = "<" + tag + ">";
+            auto start = xml.find(open, begin);
+            if (start == std::string::npos || start >= end) {
+                return {};
+            }
+            start += open.size();
+            auto stop = xml.find("</" + tag + ">", start);
+            if (stop == std::string::npos || stop > end) {
+                return {};
+            }
+            return xmlUnescape(xml.substr(start, stop - start));
+        }
+
+        /** One connection per thread, reused by all requests of the thread */
+        struct ThreadConnection {
+            CURL *handle;
+
+            ThreadConnection() : handle(curl_easy_init()) {}
+
+            ~ThreadConnection() {
+                if (handle != nullptr) {
+                    curl_easy_cleanup(handle);
+                }
+            }
+        };
+
+        CURL *threadConnection() {
+            thread_local ThreadConnection connection;
+            if (connection.handle == nullptr) {
+                throw std::runtime_error("Could not create a connection to the object store");
+            }
+            curl_easy_reset(connection.handle);
+            return connection.handle;
+        }
+
+        /** Destination of the body of a request, either a growing string or a fixed buffer */
+        struct ResponseBody {
+            std::string *text = nullptr;
+            char *buffer = nullptr;
+            size_t capacity = 0;
+            size_t received = 0;
+        };
+
+        size_t writeBody(char *data, size_t size, size_t count, void *userData) {
+            auto &body = *static_cast<ResponseBody *>(userData);
+            auto length = size * count;
+            if (body.text != nullptr) {
+                body.text->append(data, length);
+            } else {
+                if (body.received + length > body.capacity) {
+                    // Aborts the transfer, the server ignored the range
+                    return 0;
+                }
+                std::memcpy(body.buffer + body.received, data, length);
+            }
+            body.received += length;
+            return length;
+        }
+
+        /** Perform a GET of url with the optional range header, retrying transient failures. Returns the status */
+        long performGet(const ObjectStoreConfig &config, const std::string &url, const std::string &range, ResponseBody &body) {
+            std::string lastError;
+            for (int attempt = 0; attempt < maxAttempts; attempt++) {
+                if (attempt > 0) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(100 << attempt));
+                }
+                auto handle = threadConnection();
+                body.received = 0;
+                if (body.text != nullptr) {
+                    body.text->clear();
+                }
+                curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+                curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, writeBody);
+                curl_easy_setopt(handle, CURLOPT_WRITEDATA, &body);
+                curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+                curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT, 30L);
+                curl_easy_setopt(handle, CURLOPT_LOW_SPEED_LIMIT, 1024L);
+                curl_easy_setopt(handle, CURLOPT_LOW_SPEED_TIME, 60L);
+                if (!range.empty()) {
+                    curl_easy_setopt(handle, CURLOPT_RANGE, range.c_str());
+                }
+                std::string sigv4;
+                if (!config.accessKey.empty()) {
+                    sigv4 = "aws:amz:" + config.region + ":s3";
+                    curl_easy_setopt(handle, CURLOPT_AWS_SIGV4, sigv4.c_str());
+                    curl_easy_setopt(handle, CURLOPT_USERNAME, config.accessKey.c_str());
+                    curl_easy_setopt(handle, CURLOPT_PASSWORD, config.secretKey.c_str());
+                }
+                auto result = curl_easy_perform(handle);
+                if (result != CURLE_OK) {
+                    lastError = curl_easy_strerror(result);
+                    continue;
+                }
+                long status = 0;
+                curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &status);
+                if (status == 429 || status >= 500) {
+                    lastError = "HTTP status " + std::to_string(status);
+                    continue;
+                }
+                return status;
+            }
+            throw std::runtime_error("Request to the object store failed (" + lastError + "): " + url);
+        }
+#endif
+    } // namespace
+
+    ObjectStore::ObjectStore(ObjectStoreConfig config_) : config(std::move(config_)) {
+        while (!config.endpoint.empty() && config.endpoint.back() == '/') {
+            config.endpoint.pop_back();
+        }
+        if (config.accessKey.empty()) {
+            config.accessKey = environmentValue("AWS_ACCESS_KEY_ID");
+            config.secretKey = environmentValue("AWS_SECRET_ACCESS_KEY");
+        }
+        if (config.rangeSize < 4096 || (config.rangeSize & (config.rangeSize - 1)) != 0) {
+            throw std::invalid_argument("The range size of the object store must be a power of two of at least 4KB");
+        }
+#ifdef BLOCKSCI_WITH_CURL
+        static std::once_flag curlInitialized;
+        std::call_once(curlInitialized, []() {
+            curl_global_init(CURL_GLOBAL_DEFAULT);
+        });
+#endif
+    }
+
+#ifdef BLOCKSCI_WITH_CURL
+    std::vector<ObjectStore::Object> ObjectStore::list(const std::string &keyPrefix) const {
+        std::vector<Object> objects;
+        std::string continuationToken;
+        while (true) {
+            // SigV4 expects the query parameters in sorted order
+            auto url = config.endpoint + "/" + config.bucket + "?";
+            if (!continuationToken.empty()) {
+                url += "continuation-token=" + uriEncode(continuationToken, false) + "&";
+            }
+            url += "list-type=2&prefix=" + uriEncode(config.prefix + keyPrefix, false);
+            std::string text;
+            ResponseBody body;
+            body.text = &text;
+            auto status = performGet(config, url, "", body);
+            if (status != 200) {
+                throw std::runtime_error("Could not list the objects of " + config.bucket + "/" + config.prefix + keyPrefix + ": HTTP status " + std::to_string(status));
+            }
+            std::string::size_type pos = 0;
+            while ((pos = text.find("<Contents>", pos)) != std::string::npos) {
+                auto end = text.find("</Contents>", pos);
+                auto key = xmlValue(text, "Key", pos, end);
+                auto size = xmlValue(text, "Size", pos, end);
+                if (key.compare(0, config.prefix.size(), config.prefix) == 0 && !size.empty()) {
+                    objects.push_back({key.substr(config.prefix.size()), std::stoll(size), xmlValue(text, "ETag", pos, end)});
+                }
+                pos = end;
+            }
+            if (xmlValue(text, "IsTruncated") != "true") {
+                break;
+            }
+            continuationToken = xmlValue(text, "NextContinuationToken");
+        }
+        std::sort(objects.begin(), objects.end(), [](const Object &a, const Object &b) {
+            return a.key < b.key;
+        });
+        return objects;
+    }
+
+    void ObjectStore::read(const std::string &key, int64_t offset, int64_t length, char *out) const {
+        if (length <= 0) {
+            return;
+        }
+        auto url = config.endpoint + "/" + config.bucket + "/" + uriEncode(config.prefix + key, true);
+        auto range = std::to_string(offset) + "-" + std::to_string(offset + length - 1);
+        ResponseBody body;
+        body.buffer = out;
+        body.capacity = static_cast<size_t>(length);
+        auto status = performGet(config, url, range, body);
+        if ((status != 206 && status != 200) || body.received != static_cast<size_t>(length)) {
+            throw std::runtime_error("Could not read bytes " + range + " of " + key + " from the object store: HTTP status " + std::to_string(status));
+        }
+    }
+#else
+    std::vector<ObjectStore::Object> ObjectStore::list(const std::string &) const {
+        throw std::runtime_error("BlockSci was built without libcurl, which is required to read data from object storage");
+    }
+
+    void ObjectStore::read(const std::string &, int64_t, int64_t, char *) const {
+        throw std::runtime_error("BlockSci was built without libcurl, which is required to read data from object storage");
+    }
+#endif
+} // namespace blocksci
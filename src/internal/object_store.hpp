@@ -0,0 +1,79 @@
+//
+//  object_store.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_object_store_hpp
+#define blocksci_object_store_hpp
+
+#include "remote_data.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace blocksci {
+    /** Location of a data directory copied to S3-compatible object storage, loaded from the optional "objectStore"
+     * section of the config file, eg. {"endpoint": "https://s3.us-east-1.amazonaws.com", "bucket": "blocksci",
+     * "prefix": "bitcoin/", "region": "us-east-1", "rangeMB": 8, "connections": 16, "cacheMB": 262144}
+     *
+     * Object keys are the paths of the files relative to the data directory, appended to the prefix. The credentials
+     * are taken from AWS_ACCESS_KEY_ID and AWS_SECRET_ACCESS_KEY unless the section sets "accessKey" and "secretKey",
+     * requests are unsigned without any. */
+    struct ObjectStoreConfig {
+        std::string endpoint;
+        std::string bucket;
+        std::string prefix;
+        std::string region = "us-east-1";
+        std::string accessKey;
+        std::string secretKey;
+
+        /** Size of the aligned ranges fetched at a time, also the page size of the lazily fetched files */
+        uint32_t rangeSize = 8 << 20;
+
+        /** Number of ranges fetched in parallel when files are copied in full */
+        uint32_t connections = 16;
+
+        /** Bytes of the lazily fetched files kept in the local data directory before the least recently used ranges
+         * are dropped, 0 is unlimited */
+        uint64_t cacheBudget = 0;
+
+        bool isSet() const {
+            return !bucket.empty();
+        }
+    };
+
+    /** Client reading objects of an S3-compatible store through path-style HTTP requests signed with SigV4
+     *
+     * Every thread keeps its own connection, so reads from many workers don't contend. Failed requests are retried a
+     * few times before std::runtime_error is thrown. Requires BlockSci to be built with libcurl
+     * (BLOCKSCI_WITH_CURL), otherwise every request throws. */
+    class ObjectStore : public RemoteFiles {
+        ObjectStoreConfig config;
+
+    public:
+        explicit ObjectStore(ObjectStoreConfig config);
+
+        const ObjectStoreConfig &getConfig() const {
+            return config;
+        }
+
+        /** All objects whose keys relative to the prefix start with keyPrefix, sorted by key and tagged with their ETag */
+        std::vector<Object> list(const std::string &keyPrefix) const override;
+
+        /** Read the bytes [offset, offset + length) of the object into out */
+        void read(const std::string &key, int64_t offset, int64_t length, char *out) const override;
+
+        uint32_t rangeSize() const override {
+            return config.rangeSize;
+        }
+
+        uint32_t parallelReads() const override {
+            return config.connections;
+        }
+    };
+} // namespace blocksci
+
+#endif /* blocksci_object_store_hpp */
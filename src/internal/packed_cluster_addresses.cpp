@@ -0,0 +1,315 @@
+//
+//  packed_cluster_addresses.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "packed_cluster_addresses.hpp"
+#include "segment_work.hpp"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BLOCKSCI_PACKED_CLUSTER_X86
+#endif
+
+namespace blocksci {
+    namespace {
+        /** Zero bytes after the last block, the SIMD decoder loads 16 bytes from the start of every group of deltas */
+        constexpr size_t paddingBytes = 16;
+
+        /** Bytes of blocks encoded in memory before they are written */
+        constexpr uint64_t roundBytes = uint64_t{256} << 20;
+
+        /** Position of the block offsets, which follow the cluster numbers aligned to 8 bytes */
+        uint64_t offsetsPosition(uint32_t packedCount) {
+            auto end = sizeof(PackedClusterAddressesHeader) + sizeof(uint32_t) * static_cast<uint64_t>(packedCount);
+            return (end + 7) & ~uint64_t{7};
+        }
+
+        uint64_t blocksPosition(uint32_t packedCount) {
+            return offsetsPosition(packedCount) + sizeof(uint64_t) * (static_cast<uint64_t>(packedCount) + 1);
+        }
+
+        size_t varintLength(uint32_t value) {
+            size_t length = 1;
+            while (value >= 0x80) {
+                value >>= 7;
+                length++;
+            }
+            return length;
+        }
+
+        void writeVarint(unsigned char *&out, uint32_t value) {
+            while (value >= 0x80) {
+                *out++ = static_cast<unsigned char>(value | 0x80);
+                value >>= 7;
+            }
+            *out++ = static_cast<unsigned char>(value);
+        }
+
+        uint32_t readVarint(const unsigned char *&in) {
+            uint32_t value = 0;
+            int shift = 0;
+            while (*in & 0x80) {
+                value |= static_cast<uint32_t>(*in++ & 0x7f) << shift;
+                shift += 7;
+            }
+            return value | static_cast<uint32_t>(*in++) << shift;
+        }
+
+        uint32_t deltaLength(uint32_t delta) {
+            return delta < (1u << 8) ? 1 : delta < (1u << 16) ? 2 : delta < (1u << 24) ? 3 : 4;
+        }
+
+        /** Call func(type, begin, end) for every run of consecutive addresses of the same type */
+        template <typename Func>
+        void forEachRun(const DedupAddress *addresses, uint32_t count, Func func) {
+            uint32_t runStart = 0;
+            for (uint32_t i = 1; i <= count; i++) {
+                if (i == count || addresses[i].type != addresses[runStart].type) {
+                    func(addresses[runStart].type, runStart, i);
+                    runStart = i;
+                }
+            }
+        }
+
+        uint64_t encodedSize(const DedupAddress *addresses, uint32_t count) {
+            uint64_t size = (count + 3) / 4;
+            uint32_t runCount = 0;
+            forEachRun(addresses, count, [&](DedupAddressType::Enum, uint32_t begin, uint32_t end) {
+                runCount++;
+                size += 1 + varintLength(end - begin);
+                uint32_t previous = 0;
+                for (uint32_t i = begin; i < end; i++) {
+                    size += deltaLength(addresses[i].scriptNum - previous);
+                    previous = addresses[i].scriptNum;
+                }
+            });
+            return size + varintLength(runCount);
+        }
+
+        void encodeBlock(const DedupAddress *addresses, uint32_t count, unsigned char *out) {
+            std::vector<std::pair<DedupAddressType::Enum, uint32_t>> runs;
+            forEachRun(addresses, count, [&](DedupAddressType::Enum type, uint32_t begin, uint32_t end) {
+                runs.emplace_back(type, end - begin);
+            });
+            writeVarint(out, static_cast<uint32_t>(runs.size()));
+            for (auto &run : runs) {
+                *out++ = static_cast<unsigned char>(run.first);
+                writeVarint(out, run.second);
+            }
+            auto control = out;
+            auto data = control + (count + 3) / 4;
+            std::fill(control, data, 0);
+            uint32_t i = 0;
+            for (auto &run : runs) {
+                uint32_t previous = 0;
+                for (uint32_t end = i + run.second; i < end; i++) {
+                    auto delta = addresses[i].scriptNum - previous;
+                    previous = addresses[i].scriptNum;
+                    auto length = deltaLength(delta);
+                    control[i / 4] |= static_cast<unsigned char>((length - 1) << (2 * (i % 4)));
+                    for (uint32_t byte = 0; byte < length; byte++) {
+                        *data++ = static_cast<unsigned char>(delta >> (8 * byte));
+                    }
+                }
+            }
+        }
+
+        /** Decode the deltas [begin, end) one at a time, returns the position after their bytes */
+        const unsigned char *decodeDeltasScalar(const unsigned char *control, const unsigned char *data, uint32_t begin, uint32_t end, uint32_t *out) {
+            for (uint32_t i = begin; i < end; i++) {
+                auto length = ((control[i / 4] >> (2 * (i % 4))) & 3u) + 1;
+                uint32_t delta = 0;
+                for (uint32_t byte = 0; byte < length; byte++) {
+                    delta |= static_cast<uint32_t>(data[byte]) << (8 * byte);
+                }
+                data += length;
+                out[i] = delta;
+            }
+            return data;
+        }
+
+#ifdef BLOCKSCI_PACKED_CLUSTER_X86
+        bool hasSsse3() {
+            static const bool supported = __builtin_cpu_supports("ssse3");
+            return supported;
+        }
+
+        /** Shuffle moving the bytes of the 4 deltas of a control byte into their 32 bit lanes, and their total length */
+        struct StreamVByteTables {
+            std::array<std::array<uint8_t, 16>, 256> shuffles;
+            std::array<uint8_t, 256> lengths;
+
+            StreamVByteTables() {
+                for (unsigned control = 0; control < 256; control++) {
+                    uint8_t offset = 0;
+                    for (unsigned lane = 0; lane < 4; lane++) {
+                        auto length = ((control >> (2 * lane)) & 3u) + 1;
+                        for (unsigned byte = 0; byte < 4; byte++) {
+                            shuffles[control][4 * lane + byte] = byte < length ? static_cast<uint8_t>(offset + byte) : 0x80;
+                        }
+                        offset = static_cast<uint8_t>(offset + length);
+                    }
+                    lengths[control] = offset;
+                }
+            }
+        };
+
+        const StreamVByteTables &streamVByteTables() {
+            static const StreamVByteTables tables;
+            return tables;
+        }
+
+        /** Decode the first groupCount groups of 4 deltas with one shuffle each */
+        __attribute__((target("ssse3")))
+        const unsigned char *decodeDeltasSsse3(const unsigned char *control, const unsigned char *data, uint32_t groupCount, uint32_t *out) {
+            auto &tables = streamVByteTables();
+            for (uint32_t group = 0; group < groupCount; group++) {
+                auto groupControl = control[group];
+                __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+                __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i *>(tables.shuffles[groupControl].data()));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 4 * group), _mm_shuffle_epi8(bytes, shuffle));
+                data += tables.lengths[groupControl];
+            }
+            return data;
+        }
+#endif
+
+        void decodeDeltas(const unsigned char *control, const unsigned char *data, uint32_t count, uint32_t *out) {
+            uint32_t decoded = 0;
+#ifdef BLOCKSCI_PACKED_CLUSTER_X86
+            if (hasSsse3()) {
+                data = decodeDeltasSsse3(control, data, count / 4, out);
+                decoded = count / 4 * 4;
+            }
+#endif
+            decodeDeltasScalar(control, data, decoded, count, out);
+        }
+    } // namespace
+
+    void writePackedClusterAddresses(const std::string &path, const DedupAddress *addresses, const uint32_t *clusterEnds, uint32_t clusterCount, uint32_t minClusterSize, uint32_t threadCount) {
+        threadCount = resolveThreadCount(threadCount);
+        minClusterSize = std::max(minClusterSize, 1u);
+        auto clusterStart = [&](uint32_t clusterNum) {
+            return clusterNum == 0 ? 0 : clusterEnds[clusterNum - 1];
+        };
+        std::vector<uint32_t> packed;
+        for (uint32_t i = 0; i < clusterCount; i++) {
+            if (clusterEnds[i] - clusterStart(i) >= minClusterSize) {
+                packed.push_back(i);
+            }
+        }
+        auto packedCount = static_cast<uint32_t>(packed.size());
+
+        std::vector<uint64_t> offsets(packed.size() + 1, 0);
+        segmentWork(0, packedCount, threadCount, [&](uint32_t i) {
+            auto clusterNum = packed[i];
+            offsets[i + 1] = encodedSize(addresses + clusterStart(clusterNum), clusterEnds[clusterNum] - clusterStart(clusterNum));
+        });
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+        PackedClusterAddressesHeader header{};
+        header.magic = PackedClusterAddressesHeader::Magic;
+        header.clusterCount = clusterCount;
+        header.minClusterSize = minClusterSize;
+        header.addressCount = clusterCount > 0 ? clusterEnds[clusterCount - 1] : 0;
+        header.packedCount = packedCount;
+
+        std::ofstream file{path, std::ios::binary | std::ios::trunc};
+        if (!file) {
+            throw std::runtime_error("Could not write packed cluster addresses to " + path);
+        }
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(packed.data()), static_cast<std::streamsize>(sizeof(uint32_t) * packed.size()));
+        std::array<char, 8> zeros{};
+        file.write(zeros.data(), static_cast<std::streamsize>(offsetsPosition(packedCount) - sizeof(header) - sizeof(uint32_t) * packed.size()));
+        file.write(reinterpret_cast<const char *>(offsets.data()), static_cast<std::streamsize>(sizeof(uint64_t) * offsets.size()));
+
+        std::vector<unsigned char> buffer;
+        uint32_t roundStart = 0;
+        while (roundStart < packedCount) {
+            auto roundEnd = roundStart + 1;
+            while (roundEnd < packedCount && offsets[roundEnd + 1] - offsets[roundStart] <= roundBytes) {
+                roundEnd++;
+            }
+            buffer.resize(offsets[roundEnd] - offsets[roundStart]);
+            segmentWork(roundStart, roundEnd, threadCount, [&](uint32_t i) {
+                auto clusterNum = packed[i];
+                encodeBlock(addresses + clusterStart(clusterNum), clusterEnds[clusterNum] - clusterStart(clusterNum), buffer.data() + (offsets[i] - offsets[roundStart]));
+            });
+            file.write(reinterpret_cast<const char *>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+            roundStart = roundEnd;
+        }
+        std::array<char, paddingBytes> padding{};
+        file.write(padding.data(), padding.size());
+        if (!file) {
+            throw std::runtime_error("Could not write packed cluster addresses to " + path);
+        }
+    }
+
+    const uint32_t *PackedClusterAddresses::clusterNums() const {
+        return reinterpret_cast<const uint32_t *>(file.getDataAtOffset(sizeof(PackedClusterAddressesHeader)));
+    }
+
+    const uint64_t *PackedClusterAddresses::blockOffsets() const {
+        return reinterpret_cast<const uint64_t *>(file.getDataAtOffset(static_cast<OffsetType>(offsetsPosition(header()->packedCount))));
+    }
+
+    const unsigned char *PackedClusterAddresses::blocks() const {
+        return reinterpret_cast<const unsigned char *>(file.getDataAtOffset(static_cast<OffsetType>(blocksPosition(header()->packedCount))));
+    }
+
+    bool PackedClusterAddresses::matches(uint32_t clusterCount, uint64_t addressCount) const {
+        auto size = static_cast<uint64_t>(file.size());
+        if (size < sizeof(PackedClusterAddressesHeader)) {
+            return false;
+        }
+        auto fileHeader = header();
+        if (fileHeader->magic != PackedClusterAddressesHeader::Magic || fileHeader->clusterCount != clusterCount || fileHeader->addressCount != addressCount || size < blocksPosition(fileHeader->packedCount)) {
+            return false;
+        }
+        return size == blocksPosition(fileHeader->packedCount) + blockOffsets()[fileHeader->packedCount] + paddingBytes;
+    }
+
+    void PackedClusterAddresses::decode(uint32_t clusterNum, uint32_t clusterSize, DedupAddress *out) const {
+        auto packedCount = header()->packedCount;
+        auto nums = clusterNums();
+        auto it = std::lower_bound(nums, nums + packedCount, clusterNum);
+        if (it == nums + packedCount || *it != clusterNum) {
+            throw std::out_of_range("Cluster " + std::to_string(clusterNum) + " is not packed");
+        }
+        auto in = blocks() + blockOffsets()[it - nums];
+
+        std::vector<std::pair<DedupAddressType::Enum, uint32_t>> runs(readVarint(in));
+        for (auto &run : runs) {
+            run.first = static_cast<DedupAddressType::Enum>(*in++);
+            run.second = readVarint(in);
+        }
+
+        thread_local std::vector<uint32_t> deltas;
+        deltas.resize(clusterSize);
+        decodeDeltas(in, in + (clusterSize + 3) / 4, clusterSize, deltas.data());
+
+        uint32_t i = 0;
+        for (auto &run : runs) {
+            uint32_t scriptNum = 0;
+            for (uint32_t end = std::min(i + run.second, clusterSize); i < end; i++) {
+                scriptNum += deltas[i];
+                out[i] = DedupAddress{scriptNum, run.first};
+            }
+        }
+    }
+
+    uint64_t PackedClusterAddresses::packedBytes() const {
+        return blockOffsets()[header()->packedCount];
+    }
+} // namespace blocksci
@@ -0,0 +1,102 @@
+//
+//  packed_cluster_addresses.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_packed_cluster_addresses_hpp
+#define blocksci_packed_cluster_addresses_hpp
+
+#include "file_mapper.hpp"
+
+#include <blocksci/core/dedup_address.hpp>
+
+#include <range/v3/utility/optional.hpp>
+
+#include <wjfilesystem/path.h>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace blocksci {
+    /** Layout of clusterAddressesPacked.dat, the optional compressed copy of the large clusters of clusterAddresses.dat
+     *
+     * The header is followed by the sorted numbers of the packedCount clusters of at least minClusterSize addresses,
+     * the uint64_t start offset of the block of each of them plus the end of the last one (relative to the first
+     * block), the blocks and 16 bytes of padding that let the decoder load 16 bytes at any position in a block.
+     *
+     * A block lists the runs of addresses of the same type as a varint run count followed by the type byte and the
+     * varint length of every run. The scriptNums follow as deltas to the previous scriptNum of their run, the first one
+     * of a run as is, encoded with stream-vbyte: one control byte per 4 deltas holding their byte lengths minus one in
+     * 2 bits each, then the 1 to 4 little endian bytes of every delta. The addresses of a cluster are ordered by type
+     * and scriptNum, so the deltas of large clusters mostly take one byte.
+     */
+    struct PackedClusterAddressesHeader {
+        static constexpr uint64_t Magic = 0x44454b4341504c43ULL; // "CLPACKED"
+
+        uint64_t magic;
+
+        /** Clusters listed in clusterOffsets.dat and addresses in clusterAddresses.dat the file was packed from */
+        uint32_t clusterCount;
+        uint32_t minClusterSize;
+        uint64_t addressCount;
+
+        uint32_t packedCount;
+        uint32_t reserved;
+
+        /** The header of the file at path, nullopt if it doesn't exist or isn't a packed cluster file */
+        static ranges::optional<PackedClusterAddressesHeader> read(const std::string &path) {
+            std::ifstream file{path, std::ios::binary};
+            PackedClusterAddressesHeader header;
+            if (!file || !file.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic != Magic) {
+                return ranges::nullopt;
+            }
+            return header;
+        }
+    };
+
+    /** Write the packed copy of the clusters of at least minClusterSize addresses to path
+     *
+     * clusterEnds holds the end offset of each of the clusterCount clusters in addresses. The blocks are encoded on
+     * threadCount threads (0 for one per hardware thread) in rounds of bounded size. */
+    void writePackedClusterAddresses(const std::string &path, const DedupAddress *addresses, const uint32_t *clusterEnds, uint32_t clusterCount, uint32_t minClusterSize, uint32_t threadCount);
+
+    /** Reader of clusterAddressesPacked.dat */
+    class PackedClusterAddresses {
+        SimpleFileMapper<> file;
+
+        const PackedClusterAddressesHeader *header() const {
+            return reinterpret_cast<const PackedClusterAddressesHeader *>(file.getDataAtOffset(0));
+        }
+
+        const uint32_t *clusterNums() const;
+        const uint64_t *blockOffsets() const;
+        const unsigned char *blocks() const;
+
+    public:
+        /** Default size above which clusters are packed, smaller ones are cheaper to read from the flat file */
+        static constexpr uint32_t defaultMinClusterSize = 256;
+
+        /** Map the file at path (without the .dat extension), which may not exist */
+        explicit PackedClusterAddresses(const filesystem::path &path) : file(path) {}
+
+        /** Whether the file exists and was packed from a clustering with the given number of listed clusters and
+         * addresses, so it isn't left over from an earlier version of the clustering */
+        bool matches(uint32_t clusterCount, uint64_t addressCount) const;
+
+        /** Whether the addresses of a cluster of the given size are in the file, requires matches() */
+        bool covers(uint32_t clusterSize) const {
+            return clusterSize >= header()->minClusterSize;
+        }
+
+        /** Decode the clusterSize addresses of a covered cluster into out in the order of clusterAddresses.dat */
+        void decode(uint32_t clusterNum, uint32_t clusterSize, DedupAddress *out) const;
+
+        /** Bytes of the blocks of all packed clusters */
+        uint64_t packedBytes() const;
+    };
+} // namespace blocksci
+
+#endif /* blocksci_packed_cluster_addresses_hpp */
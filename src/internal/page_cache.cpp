@@ -0,0 +1,197 @@
+//
+//  page_cache.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include "page_cache.hpp"
+#include "chain_access.hpp"
+#include "data_configuration.hpp"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+
+namespace blocksci {
+    namespace {
+        bool isRegularFile(const std::string &path) {
+            struct stat fileStat;
+            return stat(path.c_str(), &fileStat) == 0 && S_ISREG(fileStat.st_mode);
+        }
+
+        /** Regular files directly inside the directory, sorted by name */
+        std::vector<filesystem::path> listFiles(const filesystem::path &directory) {
+            std::vector<filesystem::path> files;
+            auto dir = opendir(directory.str().c_str());
+            if (dir == nullptr) {
+                return files;
+            }
+            while (auto entry = readdir(dir)) {
+                auto path = directory/std::string{entry->d_name};
+                if (isRegularFile(path.str())) {
+                    files.push_back(path);
+                }
+            }
+            closedir(dir);
+            std::sort(files.begin(), files.end(), [](const filesystem::path &a, const filesystem::path &b) {
+                return a.str() < b.str();
+            });
+            return files;
+        }
+
+        struct Chunk {
+            size_t fileNum;
+            uint64_t offset;
+            uint64_t length;
+        };
+    }
+
+    std::vector<std::vector<filesystem::path>> dataFilesByPriority(const DataConfiguration &config) {
+        auto chainDirectory = config.chainDirectory();
+        auto datFile = [](const filesystem::path &path) {
+            return filesystem::path{path.str() + ".dat"};
+        };
+        std::vector<filesystem::path> hot = {
+            datFile(ChainAccess::blockFilePath(chainDirectory)),
+            datFile(filesystem::path{ChainAccess::txFilePath(chainDirectory).str() + "_index"}),
+            datFile(ChainAccess::firstInputFilePath(chainDirectory)),
+            datFile(ChainAccess::firstOutputFilePath(chainDirectory))
+        };
+        std::vector<filesystem::path> txData = {datFile(filesystem::path{ChainAccess::txFilePath(chainDirectory).str() + "_data"})};
+
+        std::set<std::string> assigned;
+        std::vector<std::vector<filesystem::path>> tiers;
+        auto addTier = [&](const std::vector<filesystem::path> &files) {
+            std::vector<filesystem::path> tier;
+            for (auto &file : files) {
+                if (assigned.insert(file.str()).second && isRegularFile(file.str())) {
+                    tier.push_back(file);
+                }
+            }
+            tiers.push_back(tier);
+        };
+        addTier(hot);
+        addTier(txData);
+        addTier(listFiles(chainDirectory));
+        addTier(listFiles(config.scriptsDirectory()));
+        auto indexFiles = listFiles(config.hashIndexFilePath());
+        auto addressIndexFiles = listFiles(config.addressDBFilePath());
+        auto mempoolFiles = listFiles(config.mempoolDirectory());
+        indexFiles.insert(indexFiles.end(), addressIndexFiles.begin(), addressIndexFiles.end());
+        indexFiles.insert(indexFiles.end(), mempoolFiles.begin(), mempoolFiles.end());
+        addTier(indexFiles);
+        return tiers;
+    }
+
+    FileResidency fileResidency(const filesystem::path &path) {
+        FileResidency residency;
+        residency.path = path.str();
+        auto fd = open(path.str().c_str(), O_RDONLY);
+        if (fd < 0) {
+            return residency;
+        }
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+            close(fd);
+            return residency;
+        }
+        residency.size = static_cast<uint64_t>(fileStat.st_size);
+        auto mapping = mmap(nullptr, residency.size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED) {
+            return residency;
+        }
+        static const auto pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+        auto pageCount = (residency.size + pageSize - 1) / pageSize;
+        // Query in bounded windows to keep the status vector small for very large files
+        constexpr uint64_t windowPages = uint64_t{1} << 20;
+        std::vector<unsigned char> status(static_cast<size_t>(std::min(pageCount, windowPages)));
+        uint64_t residentPages = 0;
+        for (uint64_t page = 0; page < pageCount; page += windowPages) {
+            auto pages = std::min(windowPages, pageCount - page);
+            auto start = static_cast<char *>(mapping) + page * pageSize;
+            if (mincore(start, pages * pageSize, status.data()) != 0) {
+                break;
+            }
+            for (uint64_t i = 0; i < pages; i++) {
+                residentPages += status[i] & 1;
+            }
+        }
+        munmap(mapping, residency.size);
+        residency.residentBytes = std::min(residentPages * pageSize, residency.size);
+        return residency;
+    }
+
+    std::vector<FileResidency> dataFileResidency(const DataConfiguration &config) {
+        std::vector<FileResidency> residency;
+        for (auto &tier : dataFilesByPriority(config)) {
+            for (auto &file : tier) {
+                residency.push_back(fileResidency(file));
+            }
+        }
+        return residency;
+    }
+
+    void warmPageCache(const std::vector<filesystem::path> &files, unsigned int threadCount, uint64_t chunkSize) {
+        std::vector<int> fds;
+        std::vector<Chunk> chunks;
+        for (auto &file : files) {
+            auto fd = open(file.str().c_str(), O_RDONLY);
+            if (fd < 0) {
+                continue;
+            }
+            struct stat fileStat;
+            if (fstat(fd, &fileStat) != 0) {
+                close(fd);
+                continue;
+            }
+            auto size = static_cast<uint64_t>(fileStat.st_size);
+            posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+            for (uint64_t offset = 0; offset < size; offset += chunkSize) {
+                chunks.push_back({fds.size(), offset, std::min(chunkSize, size - offset)});
+            }
+            fds.push_back(fd);
+        }
+
+        std::atomic<size_t> nextChunk{0};
+        auto worker = [&]() {
+            constexpr size_t bufferSize = 1 << 20;
+            auto buffer = std::make_unique<char[]>(bufferSize);
+            size_t chunkNum;
+            while ((chunkNum = nextChunk.fetch_add(1)) < chunks.size()) {
+                auto &chunk = chunks[chunkNum];
+                auto fd = fds[chunk.fileNum];
+                uint64_t done = 0;
+                while (done < chunk.length) {
+                    auto toRead = static_cast<size_t>(std::min<uint64_t>(bufferSize, chunk.length - done));
+                    auto ret = pread(fd, buffer.get(), toRead, static_cast<off_t>(chunk.offset + done));
+                    if (ret <= 0) {
+                        break;
+                    }
+                    done += static_cast<uint64_t>(ret);
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (unsigned int i = 0; i < std::max(threadCount, 1u); i++) {
+            threads.emplace_back(worker);
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        for (auto fd : fds) {
+            close(fd);
+        }
+    }
+} // namespace blocksci
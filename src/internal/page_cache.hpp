@@ -0,0 +1,43 @@
+//
+//  page_cache.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_page_cache_hpp
+#define blocksci_page_cache_hpp
+
+#include <blocksci/core/access_hint.hpp>
+
+#include <wjfilesystem/path.h>
+
+#include <vector>
+
+namespace blocksci {
+    struct DataConfiguration;
+
+    /** All data files that DataAccess may open, grouped into tiers that should be brought into the page cache in order
+     *
+     * Tier 0: block.dat, tx_index.dat, firstInput.dat and firstOutput.dat, needed by nearly every query
+     * Tier 1: tx_data.dat
+     * Tier 2: all other files in chain/
+     * Tier 3: scripts/
+     * Tier 4: the hash index, address index and mempool files
+     */
+    std::vector<std::vector<filesystem::path>> dataFilesByPriority(const DataConfiguration &config);
+
+    /** Page cache residency of the file, determined by mapping it and calling mincore */
+    FileResidency fileResidency(const filesystem::path &path);
+
+    /** Page cache residency of all files returned by dataFilesByPriority, in priority order */
+    std::vector<FileResidency> dataFileResidency(const DataConfiguration &config);
+
+    /** Read the files into the page cache with sequential reads of chunkSize bytes across threadCount threads
+     *
+     * Chunks are handed out in the order of the files, so earlier files become resident first while large files are
+     * still read by all threads in parallel. */
+    void warmPageCache(const std::vector<filesystem::path> &files, unsigned int threadCount, uint64_t chunkSize = uint64_t{64} << 20);
+} // namespace blocksci
+
+#endif /* blocksci_page_cache_hpp */
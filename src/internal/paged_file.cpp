@@ -0,0 +1,453 @@
+//
+//  paged_file.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include "paged_file.hpp"
+#include "remote_data.hpp"
+
+#ifdef BLOCKSCI_WITH_LIBURING
+#include <liburing.h>
+#endif
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace blocksci {
+
+    namespace {
+        [[noreturn]] void throwReadError(const filesystem::path &path, int error) {
+            std::stringstream ss;
+            ss << "Error reading " << path.str() << ": " << std::strerror(error);
+            throw std::runtime_error(ss.str());
+        }
+
+        std::string fetchTicksPath(const filesystem::path &path) {
+            return path.str() + ".fetched";
+        }
+
+        /** flock of the sidecar of a remote file through a descriptor of its own, so that threads of the same process
+         * exclude each other like other processes do */
+        class FetchTicksLock {
+            int fd;
+
+        public:
+            FetchTicksLock(const filesystem::path &path, int operation) : fd(::open(fetchTicksPath(path).c_str(), O_RDWR | O_CREAT, 0644)) {
+                if (fd < 0) {
+                    throwReadError(fetchTicksPath(path), errno);
+                }
+                while (flock(fd, operation) != 0) {
+                    if (errno != EINTR) {
+                        auto error = errno;
+                        ::close(fd);
+                        throwReadError(fetchTicksPath(path), error);
+                    }
+                }
+            }
+
+            FetchTicksLock(const FetchTicksLock &) = delete;
+            FetchTicksLock &operator=(const FetchTicksLock &) = delete;
+
+            ~FetchTicksLock() {
+                // Closing the descriptor releases the lock
+                ::close(fd);
+            }
+        };
+
+        bool writeAll(int fd, const char *data, int64_t length, int64_t offset) {
+            int64_t done = 0;
+            while (done < length) {
+                auto ret = pwrite(fd, data + done, static_cast<size_t>(length - done), static_cast<off_t>(offset + done));
+                if (ret < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return false;
+                }
+                done += ret;
+            }
+            return true;
+        }
+
+#ifdef BLOCKSCI_WITH_LIBURING
+        /** One ring per thread so that concurrent workers never contend on submission or completion */
+        struct ThreadRing {
+            static constexpr unsigned queueDepth = 64;
+            io_uring ring;
+            bool initialized = false;
+
+            ThreadRing() {
+                initialized = io_uring_queue_init(queueDepth, &ring, 0) == 0;
+            }
+
+            ~ThreadRing() {
+                if (initialized) {
+                    io_uring_queue_exit(&ring);
+                }
+            }
+        };
+
+        ThreadRing &threadRing() {
+            thread_local ThreadRing ring;
+            return ring;
+        }
+#endif
+    }
+
+    PagedFile::PagedFile(const filesystem::path &path_, uint32_t pageSize_) : path(path_), pageSize(pageSize_) {
+        open();
+    }
+
+    PagedFile::PagedFile(const filesystem::path &path_, uint32_t pageSize_, PagedFileRemote remote_) : path(path_), pageSize(pageSize_), remote(std::move(remote_)) {
+        open();
+    }
+
+    PagedFile::~PagedFile() {
+        close();
+    }
+
+    void PagedFile::open() {
+        fd = ::open(path.str().c_str(), isRemote() ? O_RDWR : O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+            ::close(fd);
+            fd = -1;
+            return;
+        }
+        fileSize = static_cast<int64_t>(fileStat.st_size);
+        pageCount = static_cast<size_t>((fileSize + pageSize - 1) / pageSize);
+        memoryLength = pageCount * pageSize;
+        auto mapping = mmap(nullptr, memoryLength, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            fd = -1;
+            throw std::runtime_error("Could not reserve memory for " + path.str());
+        }
+        memory = static_cast<char *>(mapping);
+        pageStates = std::make_unique<std::atomic<uint8_t>[]>(pageCount);
+        for (size_t i = 0; i < pageCount; i++) {
+            pageStates[i] = Missing;
+        }
+        pagesLoaded = 0;
+        if (isRemote()) {
+            openFetchTicks();
+        }
+    }
+
+    void PagedFile::openFetchTicks() {
+        auto length = (pageCount + 1) * sizeof(uint64_t);
+        FetchTicksLock lock{path, LOCK_EX};
+        auto sidecar = ::open(fetchTicksPath(path).c_str(), O_RDWR);
+        struct stat sidecarStat;
+        if (sidecar < 0 || fstat(sidecar, &sidecarStat) != 0) {
+            throwReadError(fetchTicksPath(path), errno);
+        }
+        auto previousLength = static_cast<size_t>(sidecarStat.st_size);
+        if (previousLength != length) {
+            // The file only grows by appending, so the pages cached for a shorter version stay valid. Anything else
+            // is left over from a different object and none of its pages can be trusted
+            auto grown = previousLength > sizeof(uint64_t) && previousLength < length && previousLength % sizeof(uint64_t) == 0;
+            if ((!grown && ftruncate(sidecar, 0) != 0) || ftruncate(sidecar, static_cast<off_t>(length)) != 0) {
+                auto error = errno;
+                ::close(sidecar);
+                throwReadError(fetchTicksPath(path), error);
+            }
+            if (!grown) {
+                previousLength = 0;
+            }
+        }
+        auto mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, sidecar, 0);
+        ::close(sidecar);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("Could not map " + fetchTicksPath(path));
+        }
+        fetchTicks = static_cast<uint64_t *>(mapping);
+        fetchTicksLength = length;
+        if (previousLength > sizeof(uint64_t) && previousLength < length) {
+            // The last page of the shorter file was cached before the rest of it was written
+            auto previousPageCount = previousLength / sizeof(uint64_t) - 1;
+            __atomic_store_n(&fetchTicks[previousPageCount], uint64_t{0}, __ATOMIC_RELEASE);
+        }
+    }
+
+    void PagedFile::close() {
+        if (fetchTicks != nullptr) {
+            munmap(fetchTicks, fetchTicksLength);
+            fetchTicks = nullptr;
+            fetchTicksLength = 0;
+        }
+        if (memory != nullptr) {
+            munmap(memory, memoryLength);
+            memory = nullptr;
+            memoryLength = 0;
+        }
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+        pageStates.reset();
+        pageCount = 0;
+        fileSize = 0;
+    }
+
+    void PagedFile::reopen() {
+        close();
+        open();
+    }
+
+    void PagedFile::readPage(size_t page) const {
+        auto pageOffset = static_cast<int64_t>(page) * pageSize;
+        auto toRead = std::min<int64_t>(pageSize, fileSize - pageOffset);
+        int64_t done = 0;
+        while (done < toRead) {
+            auto ret = pread(fd, memory + pageOffset + done, static_cast<size_t>(toRead - done), static_cast<off_t>(pageOffset + done));
+            if (ret < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throwReadError(path, errno);
+            }
+            if (ret == 0) {
+                break;
+            }
+            done += ret;
+        }
+    }
+
+    uint64_t PagedFile::cachedPages() const {
+        uint64_t count = 0;
+        if (fetchTicks != nullptr) {
+            for (size_t page = 0; page < pageCount; page++) {
+                count += __atomic_load_n(&fetchTicks[page + 1], __ATOMIC_RELAXED) != 0;
+            }
+        }
+        return count;
+    }
+
+    void PagedFile::readPages(const std::vector<size_t> &pages) const {
+        if (!isRemote()) {
+            readLocalPages(pages);
+            return;
+        }
+        std::vector<size_t> missing;
+        {
+            // Evicting pages takes the lock exclusively, so cached pages stay in the local file while they are read
+            FetchTicksLock lock{path, LOCK_SH};
+            std::vector<size_t> cached;
+            for (auto page : pages) {
+                if (__atomic_load_n(&fetchTicks[page + 1], __ATOMIC_ACQUIRE) != 0) {
+                    cached.push_back(page);
+                } else {
+                    missing.push_back(page);
+                }
+            }
+            readLocalPages(cached);
+            auto tick = __atomic_add_fetch(&fetchTicks[0], 1, __ATOMIC_RELAXED);
+            for (auto page : cached) {
+                __atomic_store_n(&fetchTicks[page + 1], tick, __ATOMIC_RELEASE);
+            }
+        }
+        if (!missing.empty()) {
+            fetchPages(missing);
+            evictCachedPages();
+        }
+    }
+
+    void PagedFile::fetchPages(const std::vector<size_t> &pages) const {
+        // Consecutive missing pages are fetched with one request of up to 64MB
+        constexpr int64_t maxRequestBytes = int64_t{64} << 20;
+        auto maxRunPages = std::max<size_t>(static_cast<size_t>(maxRequestBytes / pageSize), 1);
+        struct Run {
+            size_t firstPage;
+            size_t pageCount;
+        };
+        std::vector<Run> runs;
+        for (size_t i = 0; i < pages.size();) {
+            size_t count = 1;
+            while (i + count < pages.size() && pages[i + count] == pages[i] + count && count < maxRunPages) {
+                count++;
+            }
+            runs.push_back({pages[i], count});
+            i += count;
+        }
+        auto runBytes = [&](const Run &run) {
+            auto offset = static_cast<int64_t>(run.firstPage) * pageSize;
+            return std::make_pair(offset, std::min<int64_t>(static_cast<int64_t>(run.pageCount) * pageSize, fileSize - offset));
+        };
+        for (auto &run : runs) {
+            auto bytes = runBytes(run);
+            remote.source->read(remote.key, bytes.first, bytes.second, memory + bytes.first);
+        }
+
+        // Pages that can't be written to the cache (eg. a full disk) are only kept in memory
+        FetchTicksLock lock{path, LOCK_SH};
+        std::vector<size_t> written;
+        for (auto &run : runs) {
+            auto bytes = runBytes(run);
+            if (writeAll(fd, memory + bytes.first, bytes.second, bytes.first)) {
+                for (size_t i = 0; i < run.pageCount; i++) {
+                    written.push_back(run.firstPage + i);
+                }
+            }
+        }
+        if (written.empty() || fdatasync(fd) != 0) {
+            return;
+        }
+        auto tick = __atomic_add_fetch(&fetchTicks[0], 1, __ATOMIC_RELAXED);
+        for (auto page : written) {
+            __atomic_store_n(&fetchTicks[page + 1], tick, __ATOMIC_RELEASE);
+        }
+    }
+
+    void PagedFile::evictCachedPages() const {
+        if (remote.cacheBudget == 0) {
+            return;
+        }
+        auto budgetPages = std::max<uint64_t>(remote.cacheBudget / pageSize, 1);
+        if (cachedPages() <= budgetPages) {
+            return;
+        }
+        FetchTicksLock lock{path, LOCK_EX};
+        std::vector<std::pair<uint64_t, size_t>> cached;
+        for (size_t page = 0; page < pageCount; page++) {
+            auto tick = __atomic_load_n(&fetchTicks[page + 1], __ATOMIC_ACQUIRE);
+            if (tick != 0) {
+                cached.emplace_back(tick, page);
+            }
+        }
+        if (cached.size() <= budgetPages) {
+            return;
+        }
+        auto evictCount = cached.size() - budgetPages;
+        std::nth_element(cached.begin(), cached.begin() + static_cast<std::ptrdiff_t>(evictCount), cached.end());
+        for (size_t i = 0; i < evictCount; i++) {
+            auto page = cached[i].second;
+            __atomic_store_n(&fetchTicks[page + 1], uint64_t{0}, __ATOMIC_RELEASE);
+            auto offset = static_cast<off_t>(page) * pageSize;
+            fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, static_cast<off_t>(pageSize));
+        }
+    }
+
+    void PagedFile::readLocalPages(const std::vector<size_t> &pages) const {
+#ifdef BLOCKSCI_WITH_LIBURING
+        auto &threadLocalRing = threadRing();
+        if (threadLocalRing.initialized) {
+            auto ring = &threadLocalRing.ring;
+            size_t submitted = 0;
+            while (submitted < pages.size()) {
+                auto batchEnd = std::min(pages.size(), submitted + ThreadRing::queueDepth);
+                for (size_t i = submitted; i < batchEnd; i++) {
+                    auto pageOffset = static_cast<int64_t>(pages[i]) * pageSize;
+                    auto toRead = std::min<int64_t>(pageSize, fileSize - pageOffset);
+                    auto sqe = io_uring_get_sqe(ring);
+                    io_uring_prep_read(sqe, fd, memory + pageOffset, static_cast<unsigned>(toRead), static_cast<uint64_t>(pageOffset));
+                    io_uring_sqe_set_data(sqe, reinterpret_cast<void *>(pages[i]));
+                }
+                io_uring_submit(ring);
+                for (size_t i = submitted; i < batchEnd; i++) {
+                    io_uring_cqe *cqe;
+                    auto ret = io_uring_wait_cqe(ring, &cqe);
+                    if (ret < 0) {
+                        throwReadError(path, -ret);
+                    }
+                    auto page = reinterpret_cast<size_t>(io_uring_cqe_get_data(cqe));
+                    auto result = cqe->res;
+                    io_uring_cqe_seen(ring, cqe);
+                    auto expected = std::min<int64_t>(pageSize, fileSize - static_cast<int64_t>(page) * pageSize);
+                    if (result < 0) {
+                        throwReadError(path, -result);
+                    } else if (result < expected) {
+                        // Short read, finish the page synchronously
+                        readPage(page);
+                    }
+                }
+                submitted = batchEnd;
+            }
+            return;
+        }
+#endif
+        for (auto page : pages) {
+            readPage(page);
+        }
+    }
+
+    void PagedFile::ensureLoaded(int64_t offset, int64_t length) const {
+        if (memory == nullptr || length <= 0 || offset >= fileSize) {
+            return;
+        }
+        auto firstPage = static_cast<size_t>(offset / pageSize);
+        auto lastPage = std::min(static_cast<size_t>((offset + length - 1) / pageSize), pageCount - 1);
+
+        bool allPresent = true;
+        for (auto page = firstPage; page <= lastPage; page++) {
+            if (pageStates[page].load(std::memory_order_acquire) != Present) {
+                allPresent = false;
+                break;
+            }
+        }
+        if (allPresent) {
+            return;
+        }
+
+        std::vector<size_t> claimed;
+        bool othersLoading = false;
+        for (auto page = firstPage; page <= lastPage; page++) {
+            uint8_t expected = Missing;
+            if (pageStates[page].compare_exchange_strong(expected, Loading, std::memory_order_acq_rel)) {
+                claimed.push_back(page);
+            } else if (expected == Loading) {
+                othersLoading = true;
+            }
+        }
+
+        if (!claimed.empty()) {
+            try {
+                readPages(claimed);
+            } catch (...) {
+                for (auto page : claimed) {
+                    pageStates[page].store(Missing, std::memory_order_release);
+                }
+                throw;
+            }
+            for (auto page : claimed) {
+                pageStates[page].store(Present, std::memory_order_release);
+            }
+            pagesLoaded += claimed.size();
+            auto rangeBegin = static_cast<off_t>(claimed.front()) * pageSize;
+            auto rangeEnd = static_cast<off_t>(claimed.back() + 1) * pageSize;
+            posix_fadvise(fd, rangeBegin, rangeEnd - rangeBegin, POSIX_FADV_DONTNEED);
+        }
+
+        if (othersLoading) {
+            for (auto page = firstPage; page <= lastPage; page++) {
+                while (true) {
+                    auto state = pageStates[page].load(std::memory_order_acquire);
+                    if (state == Present) {
+                        break;
+                    } else if (state == Missing) {
+                        // The other loader failed, retry the page ourselves
+                        ensureLoaded(static_cast<int64_t>(page) * pageSize, 1);
+                    } else {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+        }
+    }
+} // namespace blocksci
@@ -0,0 +1,125 @@
+//
+//  paged_file.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_paged_file_hpp
+#define blocksci_paged_file_hpp
+
+#include <wjfilesystem/path.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace blocksci {
+    class RemoteFiles;
+
+    /** File of a remote source, eg. object storage, that a PagedFile fetches its missing pages from */
+    struct PagedFileRemote {
+        std::shared_ptr<const RemoteFiles> source;
+        std::string key;
+
+        /** Bytes of fetched pages kept in the local file before the least recently used ones are dropped, 0 is
+         * unlimited */
+        uint64_t cacheBudget = 0;
+    };
+
+    /** Read-only file access through explicit reads instead of page faults on a file mapping
+     *
+     * The file is read in fixed-size pages into an anonymous memory region of the same size as the file, so the
+     * pointer-returning API of SimpleFileMapper keeps working: a pointer into the region stays valid for the lifetime
+     * of the PagedFile. Before data is accessed the pages covering it must be loaded with ensureLoaded(). Pages that are
+     * missing from a range are submitted as one batch, through io_uring when BlockSci is built with liburing
+     * (BLOCKSCI_WITH_LIBURING) and through pread otherwise. Loaded ranges are dropped from the kernel page cache
+     * (POSIX_FADV_DONTNEED) so that the data is not cached twice.
+     *
+     * Loaded pages are never evicted, since BlockSci objects hold raw pointers with unbounded lifetimes into the data.
+     * The state of each page is tracked lock-free so that many mapReduce workers can load disjoint segments concurrently.
+     *
+     * With a PagedFileRemote the local file is a sparse copy of an object of the same size and serves as a cache on
+     * local disk. Pages are read from it if they were fetched before, otherwise runs of missing pages are fetched with
+     * one range request each and written to it. The fetched pages are recorded in a sidecar file (path.fetched) with
+     * the tick of their last use, shared by all processes using the directory. Once more than cacheBudget bytes are
+     * cached, the least recently used pages are punched out of the local file again.
+     */
+    class PagedFile {
+    public:
+        static constexpr uint32_t defaultPageSize = 1 << 16;
+
+        PagedFile(const filesystem::path &path, uint32_t pageSize = defaultPageSize);
+        PagedFile(const filesystem::path &path, uint32_t pageSize, PagedFileRemote remote);
+        PagedFile(const PagedFile &) = delete;
+        PagedFile &operator=(const PagedFile &) = delete;
+        ~PagedFile();
+
+        bool isGood() const {
+            return memory != nullptr;
+        }
+
+        int64_t size() const {
+            return fileSize;
+        }
+
+        const char *data() const {
+            return memory;
+        }
+
+        /** Make sure the bytes [offset, offset + length) are loaded, reading all missing pages in one batch */
+        void ensureLoaded(int64_t offset, int64_t length) const;
+
+        /** Number of bytes loaded so far */
+        int64_t loadedBytes() const {
+            return static_cast<int64_t>(pagesLoaded.load(std::memory_order_relaxed)) * pageSize;
+        }
+
+        /** Reopen the file after it has changed size. Invalidates all pointers into the previous data */
+        void reopen();
+
+        bool isRemote() const {
+            return remote.source != nullptr;
+        }
+
+        /** Number of pages of the local file cached from the remote object */
+        uint64_t cachedPages() const;
+
+    private:
+        enum PageState : uint8_t {
+            Missing = 0,
+            Loading = 1,
+            Present = 2
+        };
+
+        filesystem::path path;
+        uint32_t pageSize;
+        int fd = -1;
+        int64_t fileSize = 0;
+        char *memory = nullptr;
+        size_t memoryLength = 0;
+        std::unique_ptr<std::atomic<uint8_t>[]> pageStates;
+        size_t pageCount = 0;
+        mutable std::atomic<uint64_t> pagesLoaded{0};
+
+        PagedFileRemote remote;
+
+        /** Shared mapping of the sidecar of a remote file: a tick counter followed by the tick of the last use of every
+         * page, 0 for pages that aren't cached */
+        uint64_t *fetchTicks = nullptr;
+        size_t fetchTicksLength = 0;
+
+        void open();
+        void openFetchTicks();
+        void close();
+        void readPages(const std::vector<size_t> &pages) const;
+        void readLocalPages(const std::vector<size_t> &pages) const;
+        void fetchPages(const std::vector<size_t> &pages) const;
+        void evictCachedPages() const;
+        void readPage(size_t page) const;
+    };
+} // namespace blocksci
+
+#endif /* blocksci_paged_file_hpp */
@@ -8,6 +8,7 @@
 #ifndef progress_bar_hpp
 #define progress_bar_hpp
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <iostream>
@@ -18,6 +19,7 @@ namespace blocksci {
     class ProgressBar {
         uint64_t total;
         uint64_t percentageMarker;
+        uint64_t nextMarker = 0;
         UpdateFunc updateFunc;
         bool silence;
         
@@ -51,6 +53,19 @@ namespace blocksci {
                 std::cout << std::flush;
             }
         }
+        
+        /** Like update, for counts that advance in jumps instead of one at a time, reports every 0.1% of total */
+        template <typename... Args>
+        void advanceTo(uint64_t currentCount, Args&&... args) {
+            if (!silence && currentCount >= nextMarker) {
+                auto percentDone = (static_cast<double>(currentCount) / static_cast<double>(total)) * 100;
+                std::cout << "\r" << percentDone << "% done";
+                updateFunc(std::forward<Args>(args)...);
+                std::cout << std::flush;
+                auto marker = std::max<uint64_t>(percentageMarker, 1);
+                nextMarker = (currentCount / marker + 1) * marker;
+            }
+        }
     };
 
     template<class UpdateFunc>
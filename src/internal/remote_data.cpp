@@ -0,0 +1,224 @@
+//
+//  remote_data.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "remote_data.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace blocksci {
+    namespace {
+        [[noreturn]] void throwFileError(const std::string &path, int error) {
+            throw std::runtime_error("Error writing " + path + ": " + std::strerror(error));
+        }
+
+        /** Size of the regular file at path, -1 if there is none */
+        int64_t localFileSize(const std::string &path) {
+            struct stat fileStat;
+            if (stat(path.c_str(), &fileStat) != 0 || !S_ISREG(fileStat.st_mode)) {
+                return -1;
+            }
+            return static_cast<int64_t>(fileStat.st_size);
+        }
+
+        void createParentDirectories(const std::string &path) {
+            for (auto pos = path.find('/', 1); pos != std::string::npos; pos = path.find('/', pos + 1)) {
+                auto directory = path.substr(0, pos);
+                if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+                    throwFileError(directory, errno);
+                }
+            }
+        }
+
+        /** A file of the given size whose contents are all holes */
+        void createSparseFile(const std::string &path, int64_t size) {
+            auto fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) {
+                throwFileError(path, errno);
+            }
+            if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+                auto error = errno;
+                ::close(fd);
+                throwFileError(path, error);
+            }
+            ::close(fd);
+        }
+
+        /** Tags of the copied files by key, @see RemoteFiles::Object::tag */
+        std::map<std::string, std::string> readCopiedTags(const std::string &path) {
+            std::map<std::string, std::string> tags;
+            std::ifstream file{path};
+            std::string key;
+            std::string tag;
+            while (std::getline(file, key, '\t') && std::getline(file, tag)) {
+                tags[key] = tag;
+            }
+            return tags;
+        }
+
+        void writeCopiedTags(const std::string &path, const std::map<std::string, std::string> &tags) {
+            auto tempPath = path + ".part";
+            {
+                std::ofstream file{tempPath, std::ios::trunc};
+                for (auto &entry : tags) {
+                    file << entry.first << '\t' << entry.second << '\n';
+                }
+                if (!file.flush()) {
+                    throwFileError(tempPath, errno);
+                }
+            }
+            if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+                throwFileError(path, errno);
+            }
+        }
+
+        struct Download {
+            RemoteFiles::Object object;
+            std::string path;
+            int fd;
+        };
+
+        struct Piece {
+            size_t downloadNum;
+            int64_t offset;
+            int64_t length;
+        };
+    }
+
+    void hydrateDataDirectory(const filesystem::path &dataDirectory, const RemoteFiles &source, const std::vector<std::string> &keyPrefixes, bool lazyTxData) {
+        auto tagsPath = (dataDirectory/".remote_tags").str();
+        auto copiedTags = readCopiedTags(tagsPath);
+        std::vector<Download> downloads;
+        for (auto &keyPrefix : keyPrefixes) {
+            for (auto &object : source.list(keyPrefix)) {
+                auto path = (dataDirectory/object.key).str();
+                auto localSize = localFileSize(path);
+                auto isLazy = lazyTxData && object.key == lazyRemoteFile;
+                // Files like the CURRENT file of RocksDB change without changing size
+                auto tagIt = copiedTags.find(object.key);
+                auto sameTag = isLazy || object.tag.empty() || (tagIt != copiedTags.end() && tagIt->second == object.tag);
+                if (localSize == object.size && sameTag) {
+                    continue;
+                }
+                createParentDirectories(path);
+                if (isLazy) {
+                    if (localSize >= 0 && localSize < object.size) {
+                        // The parser only appends to the file, so the pages cached so far stay valid
+                        if (truncate(path.c_str(), static_cast<off_t>(object.size)) != 0) {
+                            throwFileError(path, errno);
+                        }
+                    } else {
+                        std::remove((path + ".fetched").c_str());
+                        createSparseFile(path, object.size);
+                    }
+                } else {
+                    downloads.push_back({object, path, -1});
+                }
+            }
+        }
+
+        if (downloads.empty()) {
+            return;
+        }
+
+        auto pieceSize = std::max<int64_t>(source.rangeSize(), int64_t{64} << 20);
+        std::vector<Piece> pieces;
+        auto closeAll = [&]() {
+            for (auto &download : downloads) {
+                if (download.fd >= 0) {
+                    ::close(download.fd);
+                    download.fd = -1;
+                }
+            }
+        };
+        for (size_t i = 0; i < downloads.size(); i++) {
+            auto &download = downloads[i];
+            auto partPath = download.path + ".part";
+            download.fd = ::open(partPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (download.fd < 0) {
+                auto error = errno;
+                closeAll();
+                throwFileError(partPath, error);
+            }
+            for (int64_t offset = 0; offset < download.object.size; offset += pieceSize) {
+                pieces.push_back({i, offset, std::min(pieceSize, download.object.size - offset)});
+            }
+        }
+
+        std::atomic<size_t> nextPiece{0};
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;
+        std::mutex errorMutex;
+        auto worker = [&]() {
+            auto buffer = std::make_unique<char[]>(static_cast<size_t>(pieceSize));
+            size_t pieceNum;
+            while (!failed.load() && (pieceNum = nextPiece.fetch_add(1)) < pieces.size()) {
+                auto &piece = pieces[pieceNum];
+                auto &download = downloads[piece.downloadNum];
+                try {
+                    source.read(download.object.key, piece.offset, piece.length, buffer.get());
+                    int64_t done = 0;
+                    while (done < piece.length) {
+                        auto ret = pwrite(download.fd, buffer.get() + done, static_cast<size_t>(piece.length - done), static_cast<off_t>(piece.offset + done));
+                        if (ret < 0) {
+                            if (errno == EINTR) {
+                                continue;
+                            }
+                            throwFileError(download.path + ".part", errno);
+                        }
+                        done += ret;
+                    }
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    failed = true;
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        auto threadCount = std::min<size_t>(std::max(source.parallelReads(), 1u), std::max<size_t>(pieces.size(), 1));
+        for (size_t i = 0; i < threadCount; i++) {
+            threads.emplace_back(worker);
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        for (auto &download : downloads) {
+            if (!error && fsync(download.fd) != 0) {
+                error = std::make_exception_ptr(std::runtime_error("Error writing " + download.path + ".part: " + std::strerror(errno)));
+            }
+        }
+        closeAll();
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        for (auto &download : downloads) {
+            if (std::rename((download.path + ".part").c_str(), download.path.c_str()) != 0) {
+                throwFileError(download.path, errno);
+            }
+            copiedTags[download.object.key] = download.object.tag;
+        }
+        writeCopiedTags(tagsPath, copiedTags);
+    }
+} // namespace blocksci
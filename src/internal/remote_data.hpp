@@ -0,0 +1,63 @@
+//
+//  remote_data.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_remote_data_hpp
+#define blocksci_remote_data_hpp
+
+#include <wjfilesystem/path.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace blocksci {
+    /** Read-only source of the files of a data directory that is kept somewhere else than on local disk, eg. in
+     * object storage (ObjectStore) or in a snapshot archive (SnapshotArchive) */
+    class RemoteFiles {
+    public:
+        struct Object {
+            /** Path of the file relative to the data directory */
+            std::string key;
+            int64_t size;
+
+            /** Changes whenever the contents of the file change, eg. its ETag. Empty if the source doesn't tell */
+            std::string tag;
+        };
+
+        virtual ~RemoteFiles() = default;
+
+        /** All files whose keys start with keyPrefix, sorted by key */
+        virtual std::vector<Object> list(const std::string &keyPrefix) const = 0;
+
+        /** Read the bytes [offset, offset + length) of the file into out */
+        virtual void read(const std::string &key, int64_t offset, int64_t length, char *out) const = 0;
+
+        /** Size of the aligned ranges reads are best made in, a power of two of at least 4KB. Used as the page size of
+         * the lazily fetched file */
+        virtual uint32_t rangeSize() const = 0;
+
+        /** Number of reads worth making in parallel when files are copied in full */
+        virtual uint32_t parallelReads() const = 0;
+    };
+
+    /** Path relative to the data directory of the file that is fetched page by page when read (see PagedFileRemote)
+     * instead of being copied in full. It holds most of the bytes of a data directory */
+    constexpr const char *lazyRemoteFile = "chain/tx_data.dat";
+
+    /** Copy the files of the data directory whose relative paths start with one of the prefixes (eg. "chain/") from
+     * the remote source into the local data directory
+     *
+     * Files that already exist with the size and tag of their object are kept, so only new and changed files are copied
+     * again. The tags of the copies are recorded in the .remote_tags file of the data directory. The rest are fetched in
+     * ranges of at least 64MB on parallelReads() threads, in the order of their paths, into temporary files that are
+     * renamed once everything has arrived. Unless lazyTxData is false, lazyRemoteFile is only created as a sparse file
+     * of the size of its object. Since it is only ever appended to, growing it keeps the pages cached so far, while a
+     * shrunk file is recreated without any. */
+    void hydrateDataDirectory(const filesystem::path &dataDirectory, const RemoteFiles &source, const std::vector<std::string> &keyPrefixes, bool lazyTxData = true);
+} // namespace blocksci
+
+#endif /* blocksci_remote_data_hpp */
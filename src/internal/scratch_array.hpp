@@ -0,0 +1,154 @@
+//
+//  scratch_array.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_scratch_array_hpp
+#define blocksci_scratch_array_hpp
+
+#include "file_mapper.hpp"
+
+#include <wjfilesystem/path.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+
+namespace blocksci {
+    
+    /** Zero-initialized temporary array, held in memory or in a mapped file that the kernel can page out
+     *
+     * File backed arrays let passes over data larger than the available memory use the page cache instead of anonymous
+     * memory. The file is deleted again when the array is destroyed.
+     */
+    template <typename T>
+    class ScratchArray {
+        std::unique_ptr<T[]> memory;
+        std::unique_ptr<FixedSizeFileMapper<T, mio::access_mode::write>> file;
+        filesystem::path path;
+        T *values = nullptr;
+        size_t count = 0;
+        
+        void release() {
+            file.reset();
+            if (!path.empty()) {
+                std::remove((path.str() + ".dat").c_str());
+            }
+        }
+        
+    public:
+        ScratchArray() = default;
+        
+        /** In memory */
+        explicit ScratchArray(size_t count_) : memory(std::make_unique<T[]>(count_)), values(memory.get()), count(count_) {}
+        
+        /** In the file path + ".dat", which is replaced if it exists */
+        ScratchArray(size_t count_, filesystem::path path_) : path(std::move(path_)), count(count_) {
+            std::ofstream{path.str() + ".dat", std::ios::binary | std::ios::trunc};
+            file = std::make_unique<FixedSizeFileMapper<T, mio::access_mode::write>>(path);
+            file->truncate(count);
+            values = count > 0 ? (*file)[0] : nullptr;
+        }
+        
+        ScratchArray(ScratchArray &&other) : memory(std::move(other.memory)), file(std::move(other.file)), path(std::move(other.path)), values(other.values), count(other.count) {
+            other.path = filesystem::path{};
+            other.values = nullptr;
+            other.count = 0;
+        }
+        
+        ScratchArray &operator=(ScratchArray &&other) {
+            if (this != &other) {
+                release();
+                memory = std::move(other.memory);
+                file = std::move(other.file);
+                path = std::move(other.path);
+                values = other.values;
+                count = other.count;
+                other.path = filesystem::path{};
+                other.values = nullptr;
+                other.count = 0;
+            }
+            return *this;
+        }
+        
+        ScratchArray(const ScratchArray &) = delete;
+        ScratchArray &operator=(const ScratchArray &) = delete;
+        
+        ~ScratchArray() {
+            release();
+        }
+        
+        size_t size() const {
+            return count;
+        }
+        
+        bool empty() const {
+            return count == 0;
+        }
+        
+        T *data() {
+            return values;
+        }
+        
+        const T *data() const {
+            return values;
+        }
+        
+        T &operator[](size_t index) {
+            return values[index];
+        }
+        
+        const T &operator[](size_t index) const {
+            return values[index];
+        }
+        
+        T *begin() {
+            return values;
+        }
+        
+        T *end() {
+            return values + count;
+        }
+        
+        const T *begin() const {
+            return values;
+        }
+        
+        const T *end() const {
+            return values + count;
+        }
+    };
+    
+    /** Allocates ScratchArrays, in memory by default or as files in a directory */
+    class ScratchSpace {
+        filesystem::path directory;
+        std::shared_ptr<uint32_t> fileCount = std::make_shared<uint32_t>(0);
+        
+    public:
+        ScratchSpace() = default;
+        explicit ScratchSpace(filesystem::path directory_) : directory(std::move(directory_)) {}
+        
+        bool inFiles() const {
+            return !directory.empty();
+        }
+        
+        const filesystem::path &getDirectory() const {
+            return directory;
+        }
+        
+        /** Not thread safe, arrays are allocated by the thread coordinating a pass */
+        template <typename T>
+        ScratchArray<T> allocate(size_t count) const {
+            if (!inFiles()) {
+                return ScratchArray<T>(count);
+            }
+            return ScratchArray<T>(count, directory/("scratch" + std::to_string((*fileCount)++)));
+        }
+    };
+} // namespace blocksci
+
+#endif /* blocksci_scratch_array_hpp */
@@ -9,16 +9,29 @@
 #ifndef script_access_hpp
 #define script_access_hpp
 
+#include "access_stats.hpp"
 #include "file_mapper.hpp"
+#include "address_info.hpp"
 #include "dedup_address_info.hpp"
 #include "script_info.hpp"
+#include "segment_work.hpp"
 
+#include <blocksci/address/address_stats.hpp>
+#include <blocksci/core/dedup_address.hpp>
 #include <blocksci/core/meta.hpp>
 #include <blocksci/core/script_data.hpp>
 
+#include <range/v3/utility/optional.hpp>
 #include <wjfilesystem/path.h>
 
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <memory>
+#include <string>
 #include <tuple>
+#include <utility>
+#include <vector>
 
 namespace blocksci {
     class ScriptAccess;
@@ -37,6 +50,12 @@ namespace blocksci {
     
     class ScriptAccess;
     
+    /** Progress of the address stats, the stats include all txes before txCount if complete is set */
+    struct AddressStatsProgress {
+        uint32_t txCount;
+        uint32_t complete;
+    };
+    
     template<typename T>
     struct ScriptFileType;
     
@@ -63,18 +82,103 @@ namespace blocksci {
      * BlockSci supports the parsing of all standard Bitcoin address types in order to extract relevant data.
      * Each address type has its own file/s storing this data.
      *
+     * The optional header columns copy the ScriptDataBase fields of every script (txFirstSeen, txFirstSpent and
+     * typesSeen) into dense arrays, so that checking when an address first appeared or was first spent and which
+     * address types it was seen as reads 4 bytes per script instead of faulting in the whole script data. They are
+     * written by the parser along with the output columns. The first seen tx of a script never changes, the other
+     * two columns are refreshed at the end of every update, so they can lag behind the script data while an update
+     * is running.
+     *
+     * The optional address stats (@see AddressStats) hold the totals of the outputs of every address. They are also
+     * written by the parser, which records how many txes they cover in the progress file.
+     *
+     * The optional equivalence class columns group every script with the scripthash scripts nesting it (directly or
+     * through other scripthashes), the addresses EquivAddress collects with script equivalence. Only scripts in a
+     * class of more than one member have a class id, the members of class i are stored in
+     * equiv_class_members[offsets[i - 1], offsets[i]).
+     *
      * Directory: scripts/
+     * Files: scripts/<type>_first_seen.dat: [<uint32_t txFirstSeenOfScript1>, ...]
+     *        scripts/<type>_first_spent.dat: [<uint32_t txFirstSpentOfScript1>, ...]
+     *        scripts/<type>_types_seen.dat: [<uint32_t typesSeenOfScript1>, ...]
+     *        scripts/<address type>_stats.dat: [<AddressStats of script 1>, ...]
+     *        scripts/address_stats_progress.dat: [<AddressStatsProgress>]
+     *        scripts/<type>_equiv_class.dat: [<uint32_t classIdOfScript1 or 0>, ...]
+     *        scripts/equiv_class_offsets.dat: [<uint64_t 0>, <uint64_t endOfClass1>, ...]
+     *        scripts/equiv_class_members.dat: [<DedupAddress>, ...]
      */
     class ScriptAccess {
     private:
         using ScriptFilesTuple = to_dedup_address_tuple_t<ScriptFile>;
         ScriptFilesTuple scriptFiles;
+        std::vector<std::unique_ptr<FixedSizeFileMapper<uint32_t>>> firstSeenFiles;
+        std::vector<std::unique_ptr<FixedSizeFileMapper<uint32_t>>> firstSpentFiles;
+        std::vector<std::unique_ptr<FixedSizeFileMapper<uint32_t>>> typesSeenFiles;
+        std::vector<std::unique_ptr<FixedSizeFileMapper<AddressStats>>> statsFiles;
+        FixedSizeFileMapper<AddressStatsProgress> statsProgressFile;
+        std::vector<std::unique_ptr<FixedSizeFileMapper<uint32_t>>> equivClassFiles;
+        FixedSizeFileMapper<uint64_t> equivClassOffsetsFile;
+        FixedSizeFileMapper<DedupAddress> equivClassMembersFile;
+        
+        /** Number of scripts of every type that are visible, limited to the snapshot of a pinned chain */
+        std::array<uint32_t, DedupAddressType::size> scriptLimits;
+        
+        std::pair<const uint32_t *, uint32_t> headerColumn(const FixedSizeFileMapper<uint32_t> &file, DedupAddressType::Enum type) const {
+            auto count = std::min(static_cast<uint32_t>(file.size()), scriptCount(type));
+            return {count > 0 ? file[0] : nullptr, count};
+        }
         
     public:
         explicit ScriptAccess(const filesystem::path &baseDirectory) :
         scriptFiles(blocksci::apply(DedupAddressType::all(), [&] (auto tag) {
             return ScriptFile<tag.value>{baseDirectory/std::string{dedupAddressName(tag)}};
-        })) {}
+        })),
+        statsProgressFile(statsProgressFilePath(baseDirectory)),
+        equivClassOffsetsFile(equivClassOffsetsFilePath(baseDirectory)),
+        equivClassMembersFile(equivClassMembersFilePath(baseDirectory)) {
+            scriptLimits.fill(std::numeric_limits<uint32_t>::max());
+            for (size_t i = 0; i < DedupAddressType::size; i++) {
+                firstSeenFiles.push_back(std::make_unique<FixedSizeFileMapper<uint32_t>>(firstSeenFilePath(baseDirectory, static_cast<DedupAddressType::Enum>(i))));
+                firstSpentFiles.push_back(std::make_unique<FixedSizeFileMapper<uint32_t>>(firstSpentFilePath(baseDirectory, static_cast<DedupAddressType::Enum>(i))));
+                typesSeenFiles.push_back(std::make_unique<FixedSizeFileMapper<uint32_t>>(typesSeenFilePath(baseDirectory, static_cast<DedupAddressType::Enum>(i))));
+                equivClassFiles.push_back(std::make_unique<FixedSizeFileMapper<uint32_t>>(equivClassFilePath(baseDirectory, static_cast<DedupAddressType::Enum>(i))));
+            }
+            for (size_t i = 0; i < AddressType::size; i++) {
+                statsFiles.push_back(std::make_unique<FixedSizeFileMapper<AddressStats>>(statsFilePath(baseDirectory, static_cast<AddressType::Enum>(i))));
+            }
+        }
+        
+        static filesystem::path firstSeenFilePath(const filesystem::path &baseDirectory, DedupAddressType::Enum type) {
+            return baseDirectory/(dedupAddressName(type) + "_first_seen");
+        }
+        
+        static filesystem::path firstSpentFilePath(const filesystem::path &baseDirectory, DedupAddressType::Enum type) {
+            return baseDirectory/(dedupAddressName(type) + "_first_spent");
+        }
+        
+        static filesystem::path typesSeenFilePath(const filesystem::path &baseDirectory, DedupAddressType::Enum type) {
+            return baseDirectory/(dedupAddressName(type) + "_types_seen");
+        }
+        
+        static filesystem::path statsFilePath(const filesystem::path &baseDirectory, AddressType::Enum type) {
+            return baseDirectory/(addressName(type) + "_stats");
+        }
+        
+        static filesystem::path statsProgressFilePath(const filesystem::path &baseDirectory) {
+            return baseDirectory/"address_stats_progress";
+        }
+        
+        static filesystem::path equivClassFilePath(const filesystem::path &baseDirectory, DedupAddressType::Enum type) {
+            return baseDirectory/(dedupAddressName(type) + "_equiv_class");
+        }
+        
+        static filesystem::path equivClassOffsetsFilePath(const filesystem::path &baseDirectory) {
+            return baseDirectory/"equiv_class_offsets";
+        }
+        
+        static filesystem::path equivClassMembersFilePath(const filesystem::path &baseDirectory) {
+            return baseDirectory/"equiv_class_members";
+        }
         
         template <DedupAddressType::Enum type>
         ScriptFile<type> &getFile() {
@@ -88,6 +192,7 @@ namespace blocksci {
         
         template <DedupAddressType::Enum type>
         auto getScriptData(uint32_t addressNum) const {
+            BLOCKSCI_COUNT_ACCESS(ScriptLoad);
             return getFile<type>()[addressNum - 1];
         }
         
@@ -97,6 +202,7 @@ namespace blocksci {
                 return new decltype(table){table};
             }();
             auto index = static_cast<size_t>(type);
+            BLOCKSCI_COUNT_ACCESS(ScriptLoad);
             return scriptDataBaseTable.at(index)(addressNum, *this);
         }
         
@@ -111,20 +217,150 @@ namespace blocksci {
         }
         
         size_t totalAddressCount() const {
-            uint32_t count = 0;
-            for_each(scriptFiles, [&count](auto& obj) -> decltype(auto) {count += obj.size();});
+            size_t count = 0;
+            for (auto typeCount : scriptCounts()) {
+                count += typeCount;
+            }
             return count;
         }
         
+        /** Hide the scripts that were added after a chain snapshot (@see ChainManifest) */
+        void pinScriptCounts(const std::array<uint32_t, DedupAddressType::size> &counts) {
+            scriptLimits = counts;
+        }
+        
+        uint32_t scriptLimit(DedupAddressType::Enum type) const {
+            return scriptLimits[static_cast<size_t>(type)];
+        }
+        
+        /** Call func(scriptNum, data) for every script of the type with script number in [start, end), split over
+         * threadCount threads (0 for one per hardware thread)
+         *
+         * data is the fixed size part of the script data (ScriptData<type>, deriving from ScriptDataBase) read directly
+         * from the script file, so scans over all scripts of one type avoid the ScriptVariant dispatch and table lookup
+         * of getScriptHeader. func is called concurrently for different scripts. */
+        template <DedupAddressType::Enum type, typename Func>
+        void forEachScript(uint32_t start, uint32_t end, uint32_t threadCount, Func func) const {
+            const auto &file = getFile<type>();
+            start = std::max(start, 1u);
+            end = std::min(end, scriptCount(type) + 1);
+            if (start >= end) {
+                return;
+            }
+            segmentWork(start, end, resolveThreadCount(threadCount), [&](uint32_t scriptNum) {
+                func(scriptNum, *file.getDataAtIndex(scriptNum - 1));
+            });
+        }
+        
+        /** Number of the transaction the given script first appeared in, read from the first seen column if it covers
+         * the script */
+        uint32_t getFirstTxIndex(uint32_t scriptNum, DedupAddressType::Enum type) const {
+            const auto &firstSeenFile = *firstSeenFiles[static_cast<size_t>(type)];
+            if (scriptNum <= firstSeenFile.size()) {
+                return *firstSeenFile[scriptNum - 1];
+            }
+            return getScriptHeader(scriptNum, type)->txFirstSeen;
+        }
+        
+        /** Number of the transaction that first spent the given script (std::numeric_limits<uint32_t>::max() if none),
+         * read from the first spent column if it covers the script */
+        uint32_t getFirstSpentTxIndex(uint32_t scriptNum, DedupAddressType::Enum type) const {
+            const auto &firstSpentFile = *firstSpentFiles[static_cast<size_t>(type)];
+            if (scriptNum <= firstSpentFile.size()) {
+                return *firstSpentFile[scriptNum - 1];
+            }
+            return getScriptHeader(scriptNum, type)->txFirstSpent;
+        }
+        
+        /** ScriptDataBase::typesSeen of the given script, read from the types seen column if it covers the script */
+        uint32_t getTypesSeen(uint32_t scriptNum, DedupAddressType::Enum type) const {
+            const auto &typesSeenFile = *typesSeenFiles[static_cast<size_t>(type)];
+            if (scriptNum <= typesSeenFile.size()) {
+                return *typesSeenFile[scriptNum - 1];
+            }
+            return getScriptHeader(scriptNum, type)->typesSeen;
+        }
+        
+        /** The header columns of all scripts of the type, each with the number of scripts it covers from script 1 on */
+        std::pair<const uint32_t *, uint32_t> getFirstSeenColumn(DedupAddressType::Enum type) const {
+            return headerColumn(*firstSeenFiles[static_cast<size_t>(type)], type);
+        }
+        
+        std::pair<const uint32_t *, uint32_t> getFirstSpentColumn(DedupAddressType::Enum type) const {
+            return headerColumn(*firstSpentFiles[static_cast<size_t>(type)], type);
+        }
+        
+        std::pair<const uint32_t *, uint32_t> getTypesSeenColumn(DedupAddressType::Enum type) const {
+            return headerColumn(*typesSeenFiles[static_cast<size_t>(type)], type);
+        }
+        
+        /** Number of txes included in the address stats, 0 if they were never built or an update was interrupted */
+        uint32_t addressStatsTxCount() const {
+            if (statsProgressFile.size() == 0 || !statsProgressFile[0]->complete) {
+                return 0;
+            }
+            return statsProgressFile[0]->txCount;
+        }
+        
+        /** Address stats of all scripts of the type covered by the stats file */
+        AddressStatsColumn getAddressStats(AddressType::Enum type) const {
+            const auto &file = *statsFiles[static_cast<size_t>(type)];
+            auto count = static_cast<uint32_t>(file.size());
+            return {count > 0 ? file[0] : nullptr, count};
+        }
+        
+        /** Members of the equivalence class of the script, read from the equivalence class columns
+         *
+         * Returns nullopt if the columns don't cover the script, callers then have to search the address index. An empty
+         * range means that the script is the only member of its class. */
+        ranges::optional<std::pair<const DedupAddress *, const DedupAddress *>> getEquivClass(const DedupAddress &address) const {
+            const auto &classFile = *equivClassFiles[static_cast<size_t>(address.type)];
+            if (address.scriptNum == 0 || address.scriptNum > classFile.size()) {
+                return ranges::nullopt;
+            }
+            auto classId = *classFile[address.scriptNum - 1];
+            if (classId == 0) {
+                return std::pair<const DedupAddress *, const DedupAddress *>{nullptr, nullptr};
+            }
+            if (classId >= equivClassOffsetsFile.size()) {
+                return ranges::nullopt;
+            }
+            auto begin = *equivClassOffsetsFile[classId - 1];
+            auto end = *equivClassOffsetsFile[classId];
+            if (begin == end || end > static_cast<uint64_t>(equivClassMembersFile.size())) {
+                return ranges::nullopt;
+            }
+            const DedupAddress *members = equivClassMembersFile[static_cast<OffsetType>(begin)];
+            return std::make_pair(members, members + (end - begin));
+        }
+        
         void reload() {
             for_each(scriptFiles, [&](auto& file) -> decltype(auto) { file.reload(); });
+            for (auto &file : firstSeenFiles) {
+                file->reload();
+            }
+            for (auto &file : firstSpentFiles) {
+                file->reload();
+            }
+            for (auto &file : typesSeenFiles) {
+                file->reload();
+            }
+            for (auto &file : statsFiles) {
+                file->reload();
+            }
+            statsProgressFile.reload();
+            for (auto &file : equivClassFiles) {
+                file->reload();
+            }
+            equivClassOffsetsFile.reload();
+            equivClassMembersFile.reload();
         }
     };
         
     namespace internal {
         template<DedupAddressType::Enum type>
         uint32_t ScriptCountFunctor<type>::f(const ScriptAccess &access) {
-            return static_cast<uint32_t>(access.getFile<type>().size());
+            return std::min(static_cast<uint32_t>(access.getFile<type>().size()), access.scriptLimit(type));
         }
         
         template<DedupAddressType::Enum type>
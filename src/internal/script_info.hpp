@@ -58,6 +58,12 @@ namespace blocksci {
         using outputType = WitnessUnknownScriptData;
         using storage = Indexed<WitnessUnknownScriptData,WitnessUnknownSpendScriptData>;
     };
+    
+    template <>
+    struct BLOCKSCI_EXPORT ScriptInfo<DedupAddressType::WITNESS_TAPROOT> {
+        using outputType = TaprootData;
+        using storage = FixedSize<TaprootData>;
+    };
 } // namespace blocksci
 
 #endif /* script_info_hpp */
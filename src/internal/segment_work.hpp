@@ -0,0 +1,81 @@
+//
+//  segment_work.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_segment_work_hpp
+#define blocksci_segment_work_hpp
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace blocksci {
+    /** Number of threads to use for a requested thread count of 0, which picks one per hardware thread */
+    inline uint32_t resolveThreadCount(uint32_t threadCount) {
+        if (threadCount == 0) {
+            threadCount = std::thread::hardware_concurrency();
+        }
+        return std::max(threadCount, 1u);
+    }
+    
+    /** Split [start, end) into segmentCount consecutive segments of nearly equal size
+     *
+     * Don't partition over threads if there are less items than segment count, a single segment is returned then. */
+    inline std::vector<std::pair<uint32_t, uint32_t>> splitSegments(uint32_t start, uint32_t end, uint32_t segmentCount) {
+        uint32_t total = end - start;
+        if (total < segmentCount) {
+            return {{start, end}};
+        }
+        
+        auto segmentSize = total / segmentCount;
+        auto segmentsRemaining = total % segmentCount;
+        std::vector<std::pair<uint32_t, uint32_t>> segments;
+        uint32_t i = 0;
+        while(i < total) {
+            uint32_t startSegment = i;
+            i += segmentSize;
+            if (segmentsRemaining > 0) {
+                i += 1;
+                segmentsRemaining--;
+            }
+            uint32_t endSegment = i;
+            segments.emplace_back(startSegment + start, endSegment + start);
+        }
+        return segments;
+    }
+    
+    /** Run job(segmentNum, segmentStart, segmentEnd) for every segment, each on its own thread */
+    template <typename Job>
+    void runSegments(const std::vector<std::pair<uint32_t, uint32_t>> &segments, Job job) {
+        std::vector<std::thread> threads;
+        for (uint32_t i = 0; i + 1 < segments.size(); i++) {
+            auto segment = segments[i];
+            threads.emplace_back([i, segment, &job](){
+                job(i, segment.first, segment.second);
+            });
+        }
+        
+        auto segment = segments.back();
+        job(static_cast<uint32_t>(segments.size() - 1), segment.first, segment.second);
+        
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+    
+    template <typename Job>
+    void segmentWork(uint32_t start, uint32_t end, uint32_t segmentCount, Job job) {
+        runSegments(splitSegments(start, end, segmentCount), [&job](uint32_t, uint32_t segmentStart, uint32_t segmentEnd) {
+            for (uint32_t i = segmentStart; i < segmentEnd; i++) {
+                job(i);
+            }
+        });
+    }
+} // namespace blocksci
+
+#endif /* blocksci_segment_work_hpp */
@@ -0,0 +1,218 @@
+//
+//  sha256_kernels.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include "sha256_kernels.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define BLOCKSCI_SHA256_X86
+#endif
+
+namespace blocksci { namespace sha256_kernels {
+
+    const uint32_t initialState[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+#ifdef BLOCKSCI_SHA256_X86
+
+    namespace {
+        alignas(64) const uint32_t roundConstants[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+        };
+    }
+
+    bool hasShani() {
+        static const bool supported = []() {
+            unsigned int eax, ebx, ecx, edx;
+            if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+                return false;
+            }
+            bool sha = (ebx >> 29) & 1;
+            // The kernel also needs SSSE3 and SSE4.1
+            return sha && __builtin_cpu_supports("ssse3") && __builtin_cpu_supports("sse4.1");
+        }();
+        return supported;
+    }
+
+    bool hasAvx2() {
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+    }
+
+    __attribute__((target("sha,sse4.1,ssse3")))
+    void transformShani(uint32_t state[8], const unsigned char *blocks, size_t blockCount) {
+        const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+        // The SHA instructions keep the state as ABEF and CDGH
+        __m128i tmp = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&state[0]));
+        __m128i state1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&state[4]));
+        tmp = _mm_shuffle_epi32(tmp, 0xB1);
+        state1 = _mm_shuffle_epi32(state1, 0x1B);
+        __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+        state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+        for (size_t block = 0; block < blockCount; block++, blocks += blockSize) {
+            __m128i abefSave = state0;
+            __m128i cdghSave = state1;
+            __m128i words[4];
+            for (int i = 0; i < 16; i++) {
+                __m128i quad;
+                if (i < 4) {
+                    quad = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(blocks + 16 * i)), byteSwap);
+                } else {
+                    // words[i % 4] still holds the words four quads back
+                    auto &w4 = words[i & 3];
+                    auto &w3 = words[(i + 1) & 3];
+                    auto &w2 = words[(i + 2) & 3];
+                    auto &w1 = words[(i + 3) & 3];
+                    quad = _mm_sha256msg1_epu32(w4, w3);
+                    quad = _mm_add_epi32(quad, _mm_alignr_epi8(w1, w2, 4));
+                    quad = _mm_sha256msg2_epu32(quad, w1);
+                }
+                words[i & 3] = quad;
+                __m128i msg = _mm_add_epi32(quad, _mm_load_si128(reinterpret_cast<const __m128i *>(roundConstants + 4 * i)));
+                state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+                msg = _mm_shuffle_epi32(msg, 0x0E);
+                state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+            }
+            state0 = _mm_add_epi32(state0, abefSave);
+            state1 = _mm_add_epi32(state1, cdghSave);
+        }
+
+        tmp = _mm_shuffle_epi32(state0, 0x1B);
+        state1 = _mm_shuffle_epi32(state1, 0xB1);
+        state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+        state1 = _mm_alignr_epi8(state1, tmp, 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(&state[0]), state0);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(&state[4]), state1);
+    }
+
+    namespace {
+        __attribute__((target("avx2")))
+        inline __m256i rotr(__m256i x, int n) {
+            return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+        }
+
+        __attribute__((target("avx2")))
+        inline __m256i add(__m256i a, __m256i b) {
+            return _mm256_add_epi32(a, b);
+        }
+
+        __attribute__((target("avx2")))
+        inline __m256i broadcast(uint32_t x) {
+            return _mm256_set1_epi32(static_cast<int>(x));
+        }
+
+        inline uint32_t readBE32(const unsigned char *ptr) {
+            return (uint32_t{ptr[0]} << 24) | (uint32_t{ptr[1]} << 16) | (uint32_t{ptr[2]} << 8) | uint32_t{ptr[3]};
+        }
+
+        inline void writeBE32(unsigned char *ptr, uint32_t x) {
+            ptr[0] = static_cast<unsigned char>(x >> 24);
+            ptr[1] = static_cast<unsigned char>(x >> 16);
+            ptr[2] = static_cast<unsigned char>(x >> 8);
+            ptr[3] = static_cast<unsigned char>(x);
+        }
+    }
+
+    __attribute__((target("avx2")))
+    void sha256Of32x8Avx2(const unsigned char *in, unsigned char *out) {
+        // Lane j of every vector belongs to message j. A 32 byte message is a single padded block whose last eight
+        // words are constant.
+        __m256i w[16];
+        for (int i = 0; i < 8; i++) {
+            w[i] = _mm256_setr_epi32(
+                static_cast<int>(readBE32(in + 0 * 32 + 4 * i)), static_cast<int>(readBE32(in + 1 * 32 + 4 * i)),
+                static_cast<int>(readBE32(in + 2 * 32 + 4 * i)), static_cast<int>(readBE32(in + 3 * 32 + 4 * i)),
+                static_cast<int>(readBE32(in + 4 * 32 + 4 * i)), static_cast<int>(readBE32(in + 5 * 32 + 4 * i)),
+                static_cast<int>(readBE32(in + 6 * 32 + 4 * i)), static_cast<int>(readBE32(in + 7 * 32 + 4 * i)));
+        }
+        w[8] = broadcast(0x80000000);
+        for (int i = 9; i < 15; i++) {
+            w[i] = _mm256_setzero_si256();
+        }
+        w[15] = broadcast(256);
+
+        __m256i a = broadcast(initialState[0]);
+        __m256i b = broadcast(initialState[1]);
+        __m256i c = broadcast(initialState[2]);
+        __m256i d = broadcast(initialState[3]);
+        __m256i e = broadcast(initialState[4]);
+        __m256i f = broadcast(initialState[5]);
+        __m256i g = broadcast(initialState[6]);
+        __m256i h = broadcast(initialState[7]);
+
+        for (int i = 0; i < 64; i++) {
+            __m256i word;
+            if (i < 16) {
+                word = w[i];
+            } else {
+                auto &w15 = w[(i - 15) & 15];
+                auto &w2 = w[(i - 2) & 15];
+                __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(rotr(w15, 7), rotr(w15, 18)), _mm256_srli_epi32(w15, 3));
+                __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(rotr(w2, 17), rotr(w2, 19)), _mm256_srli_epi32(w2, 10));
+                word = add(add(w[i & 15], s0), add(w[(i - 7) & 15], s1));
+                w[i & 15] = word;
+            }
+            __m256i bigSigma1 = _mm256_xor_si256(_mm256_xor_si256(rotr(e, 6), rotr(e, 11)), rotr(e, 25));
+            __m256i choose = _mm256_xor_si256(g, _mm256_and_si256(e, _mm256_xor_si256(f, g)));
+            __m256i t1 = add(add(add(h, bigSigma1), add(choose, broadcast(roundConstants[i]))), word);
+            __m256i bigSigma0 = _mm256_xor_si256(_mm256_xor_si256(rotr(a, 2), rotr(a, 13)), rotr(a, 22));
+            __m256i majority = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+            __m256i t2 = add(bigSigma0, majority);
+            h = g;
+            g = f;
+            f = e;
+            e = add(d, t1);
+            d = c;
+            c = b;
+            b = a;
+            a = add(t1, t2);
+        }
+
+        __m256i result[8] = {
+            add(a, broadcast(initialState[0])), add(b, broadcast(initialState[1])),
+            add(c, broadcast(initialState[2])), add(d, broadcast(initialState[3])),
+            add(e, broadcast(initialState[4])), add(f, broadcast(initialState[5])),
+            add(g, broadcast(initialState[6])), add(h, broadcast(initialState[7]))
+        };
+        alignas(32) uint32_t lanes[8][avx2Lanes];
+        for (int i = 0; i < 8; i++) {
+            _mm256_store_si256(reinterpret_cast<__m256i *>(lanes[i]), result[i]);
+        }
+        for (size_t lane = 0; lane < avx2Lanes; lane++) {
+            for (int i = 0; i < 8; i++) {
+                writeBE32(out + 32 * lane + 4 * i, lanes[i][lane]);
+            }
+        }
+    }
+
+#else
+
+    bool hasShani() {
+        return false;
+    }
+
+    bool hasAvx2() {
+        return false;
+    }
+
+    void transformShani(uint32_t *, const unsigned char *, size_t) {}
+
+    void sha256Of32x8Avx2(const unsigned char *, unsigned char *) {}
+
+#endif
+}} // namespace blocksci::sha256_kernels
@@ -0,0 +1,40 @@
+//
+//  sha256_kernels.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_sha256_kernels_hpp
+#define blocksci_sha256_kernels_hpp
+
+#include <cstddef>
+#include <cstdint>
+
+/** Hardware accelerated SHA256 compression functions used by doubleSha256Batch
+ *
+ * The kernels are compiled for their instruction set independently of the flags of the build, callers must check
+ * the matching has*() function first.
+ */
+namespace blocksci { namespace sha256_kernels {
+
+    constexpr size_t blockSize = 64;
+    constexpr size_t avx2Lanes = 8;
+
+    /** Initial SHA256 state */
+    extern const uint32_t initialState[8];
+
+    bool hasShani();
+    bool hasAvx2();
+
+    /** Compress blockCount consecutive 64 byte blocks into state using the SHA extensions */
+    void transformShani(uint32_t state[8], const unsigned char *blocks, size_t blockCount);
+
+    /** SHA256 of 8 messages of 32 bytes each (eg. the second round of a double SHA256) using AVX2
+     *
+     * Message i is stored at in + 32 * i, its digest is written to out + 32 * i. in and out may alias.
+     */
+    void sha256Of32x8Avx2(const unsigned char *in, unsigned char *out);
+}} // namespace blocksci::sha256_kernels
+
+#endif /* blocksci_sha256_kernels_hpp */
@@ -0,0 +1,506 @@
+//
+//  snapshot_archive.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "snapshot_archive.hpp"
+#include "bitcoin_uint256_hex.hpp"
+#include "hash.hpp"
+
+#include <nlohmann/json.hpp>
+
+#ifdef BLOCKSCI_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+using json = nlohmann::json;
+
+namespace blocksci {
+    namespace {
+        constexpr int manifestFormat = 1;
+
+        [[noreturn]] void throwFileError(const std::string &action, const std::string &path, int error) {
+            throw std::runtime_error("Error " + action + " " + path + ": " + std::strerror(error));
+        }
+
+        /** Hex digits of the hash in byte order, as printed by sha256sum */
+        std::string hashHex(const uint256 &hash) {
+            return hash.GetHexReverse();
+        }
+
+        uint256 hashFromHex(const std::string &hex) {
+            uint256 hash;
+            if (hex.size() != 2 * hash.size()) {
+                throw std::runtime_error("Invalid chunk hash in snapshot manifest: " + hex);
+            }
+            auto bytes = hash.begin();
+            for (size_t i = 0; i < hash.size(); i++) {
+                auto high = HexDigit(hex[2 * i]);
+                auto low = HexDigit(hex[2 * i + 1]);
+                if (high < 0 || low < 0) {
+                    throw std::runtime_error("Invalid chunk hash in snapshot manifest: " + hex);
+                }
+                bytes[i] = static_cast<unsigned char>((high << 4) | low);
+            }
+            return hash;
+        }
+
+        filesystem::path manifestPath(const filesystem::path &archiveDirectory, const std::string &name) {
+            return archiveDirectory/"snapshots"/(name + ".json");
+        }
+
+        std::string chunkPath(const filesystem::path &archiveDirectory, const uint256 &hash) {
+            auto hex = hashHex(hash);
+            return (archiveDirectory/"chunks"/hex.substr(0, 2)/hex).str();
+        }
+
+        void makeDirectory(const std::string &path) {
+            if (mkdir(path.c_str(), 0755) != 0 && errno != EEXIST) {
+                throwFileError("creating", path, errno);
+            }
+        }
+
+        void readFully(int fd, char *out, size_t length, off_t offset, const std::string &path) {
+            size_t done = 0;
+            while (done < length) {
+                auto ret = pread(fd, out + done, length - done, offset + static_cast<off_t>(done));
+                if (ret < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (ret <= 0) {
+                    throwFileError("reading", path, ret < 0 ? errno : EIO);
+                }
+                done += static_cast<size_t>(ret);
+            }
+        }
+
+        void writeFully(int fd, const char *data, size_t length, const std::string &path) {
+            size_t done = 0;
+            while (done < length) {
+                auto ret = ::write(fd, data + done, length - done);
+                if (ret < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throwFileError("writing", path, errno);
+                }
+                done += static_cast<size_t>(ret);
+            }
+        }
+
+        int64_t modificationTime(const struct stat &fileStat) {
+            return static_cast<int64_t>(fileStat.st_mtim.tv_sec) * 1000000000 + fileStat.st_mtim.tv_nsec;
+        }
+
+        std::string canonicalPath(const filesystem::path &path) {
+            char resolved[PATH_MAX];
+            return realpath(path.str().c_str(), resolved) != nullptr ? std::string{resolved} : std::string{};
+        }
+
+        /** Regular file found while walking the directories to archive */
+        struct SourceFile {
+            std::string key;
+            std::string path;
+            int64_t size;
+            int64_t modificationTime;
+        };
+
+        bool isSkippedName(const std::string &name) {
+            auto endsWith = [&](const std::string &suffix) {
+                return name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+            };
+            return endsWith(".fetched") || endsWith(".part") || name == ".remote_tags";
+        }
+
+        void collectFiles(const std::string &directory, const std::string &keyPrefix, const std::string &skippedDirectory, std::vector<SourceFile> &files) {
+            auto dir = opendir(directory.c_str());
+            if (dir == nullptr) {
+                throwFileError("listing", directory, errno);
+            }
+            std::vector<std::string> names;
+            while (auto entry = readdir(dir)) {
+                std::string name = entry->d_name;
+                if (name != "." && name != ".." && !isSkippedName(name)) {
+                    names.push_back(name);
+                }
+            }
+            closedir(dir);
+            for (auto &name : names) {
+                auto path = directory + "/" + name;
+                struct stat fileStat;
+                if (stat(path.c_str(), &fileStat) != 0) {
+                    throwFileError("reading", path, errno);
+                }
+                if (S_ISDIR(fileStat.st_mode)) {
+                    if (skippedDirectory.empty() || canonicalPath(path) != skippedDirectory) {
+                        collectFiles(path, keyPrefix + name + "/", skippedDirectory, files);
+                    }
+                } else if (S_ISREG(fileStat.st_mode)) {
+                    files.push_back({keyPrefix + name, path, static_cast<int64_t>(fileStat.st_size), modificationTime(fileStat)});
+                }
+            }
+        }
+
+        /** Chunk of a file that is hashed and, if new, compressed into the archive */
+        struct ChunkTask {
+            size_t fileNum;
+            size_t chunkNum;
+        };
+
+        uint32_t chunkLength(int64_t fileSize, size_t chunkNum, uint32_t chunkSize) {
+            return static_cast<uint32_t>(std::min<int64_t>(chunkSize, fileSize - static_cast<int64_t>(chunkNum) * chunkSize));
+        }
+
+        /** Stores chunks in the archive, one per worker thread */
+        class ChunkWriter {
+            filesystem::path archiveDirectory;
+            int compressionLevel;
+            std::vector<char> buffer;
+#ifdef BLOCKSCI_WITH_ZSTD
+            std::unique_ptr<ZSTD_CCtx, size_t (*)(ZSTD_CCtx *)> context{ZSTD_createCCtx(), ZSTD_freeCCtx};
+#endif
+
+        public:
+            ChunkWriter(filesystem::path archiveDirectory_, int compressionLevel_, uint32_t chunkSize) : archiveDirectory(std::move(archiveDirectory_)), compressionLevel(compressionLevel_) {
+#ifdef BLOCKSCI_WITH_ZSTD
+                buffer.resize(ZSTD_compressBound(chunkSize));
+#else
+                (void)chunkSize;
+#endif
+            }
+
+            /** Store the chunk unless the archive has it already. Returns its stored size and whether it was new */
+            std::pair<uint32_t, bool> store(const uint256 &hash, const char *data, uint32_t length) {
+                auto path = chunkPath(archiveDirectory, hash);
+                struct stat chunkStat;
+                if (stat(path.c_str(), &chunkStat) == 0) {
+                    return {static_cast<uint32_t>(chunkStat.st_size), false};
+                }
+                const char *stored = data;
+                size_t storedSize = length;
+#ifdef BLOCKSCI_WITH_ZSTD
+                auto compressedSize = ZSTD_compressCCtx(context.get(), buffer.data(), buffer.size(), data, length, compressionLevel);
+                if (ZSTD_isError(compressedSize)) {
+                    throw std::runtime_error(std::string{"Error compressing chunk: "} + ZSTD_getErrorName(compressedSize));
+                }
+                // Incompressible chunks are stored as is, readers tell them apart by their stored size matching their length
+                if (compressedSize < length) {
+                    stored = buffer.data();
+                    storedSize = compressedSize;
+                }
+#else
+                (void)compressionLevel;
+#endif
+                makeDirectory(path.substr(0, path.rfind('/')));
+                // Several writers may store the same chunk, each one renames its own complete copy into place
+                auto tempPath = path + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".part";
+                auto fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                if (fd < 0) {
+                    throwFileError("writing", tempPath, errno);
+                }
+                try {
+                    writeFully(fd, stored, storedSize, tempPath);
+                    if (fdatasync(fd) != 0) {
+                        throwFileError("writing", tempPath, errno);
+                    }
+                } catch (...) {
+                    ::close(fd);
+                    std::remove(tempPath.c_str());
+                    throw;
+                }
+                ::close(fd);
+                if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+                    throwFileError("writing", path, errno);
+                }
+                return {static_cast<uint32_t>(storedSize), true};
+            }
+        };
+    } // namespace
+
+    SnapshotArchive::SnapshotArchive(const filesystem::path &archiveDirectory_, const std::string &name, uint32_t readers_) : archiveDirectory(archiveDirectory_), readers(readers_) {
+        auto path = manifestPath(archiveDirectory, name).str();
+        std::ifstream file{path};
+        if (!file) {
+            throw std::invalid_argument("Snapshot " + name + " does not exist in " + archiveDirectory.str());
+        }
+        json manifest;
+        file >> manifest;
+        if (manifest.at("format").get<int>() != manifestFormat) {
+            throw std::runtime_error("Snapshot " + name + " has an unsupported format");
+        }
+        chunkSize = manifest.at("chunkSize").get<uint32_t>();
+        for (auto &fileEntry : manifest.at("files")) {
+            File archived;
+            archived.size = fileEntry.at("size").get<int64_t>();
+            archived.modificationTime = fileEntry.at("mtime").get<int64_t>();
+            for (auto &chunkEntry : fileEntry.at("chunks")) {
+                archived.chunks.push_back({hashFromHex(chunkEntry.at(0).get<std::string>()), chunkEntry.at(1).get<uint32_t>()});
+            }
+            if (archived.chunks.size() != (static_cast<uint64_t>(archived.size) + chunkSize - 1) / chunkSize) {
+                throw std::runtime_error("Snapshot " + name + " lists the wrong number of chunks for " + fileEntry.at("path").get<std::string>());
+            }
+            files.emplace(fileEntry.at("path").get<std::string>(), std::move(archived));
+        }
+    }
+
+    std::vector<std::string> SnapshotArchive::snapshotNames(const filesystem::path &archiveDirectory) {
+        std::vector<std::string> names;
+        auto dir = opendir((archiveDirectory/"snapshots").str().c_str());
+        if (dir == nullptr) {
+            return names;
+        }
+        const std::string extension = ".json";
+        while (auto entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name.size() > extension.size() && name.compare(name.size() - extension.size(), extension.size(), extension) == 0) {
+                names.push_back(name.substr(0, name.size() - extension.size()));
+            }
+        }
+        closedir(dir);
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+    std::vector<RemoteFiles::Object> SnapshotArchive::list(const std::string &keyPrefix) const {
+        std::vector<Object> objects;
+        for (auto it = files.lower_bound(keyPrefix); it != files.end() && it->first.compare(0, keyPrefix.size(), keyPrefix) == 0; ++it) {
+            std::vector<unsigned char> hashes;
+            for (auto &chunk : it->second.chunks) {
+                hashes.insert(hashes.end(), chunk.hash.begin(), chunk.hash.end());
+            }
+            auto tag = sha256(hashes.data(), hashes.size());
+            objects.push_back({it->first, it->second.size, hashHex(tag)});
+        }
+        return objects;
+    }
+
+    void SnapshotArchive::readChunk(const Chunk &chunk, uint32_t length, char *out) const {
+        auto path = chunkPath(archiveDirectory, chunk.hash);
+        auto fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throwFileError("reading", path, errno);
+        }
+        try {
+            if (chunk.storedSize == length) {
+                readFully(fd, out, length, 0, path);
+            } else {
+#ifdef BLOCKSCI_WITH_ZSTD
+                thread_local std::vector<char> compressed;
+                compressed.resize(chunk.storedSize);
+                readFully(fd, compressed.data(), chunk.storedSize, 0, path);
+                auto size = ZSTD_decompress(out, length, compressed.data(), chunk.storedSize);
+                if (ZSTD_isError(size) || size != length) {
+                    throw std::runtime_error("Chunk " + path + " is corrupted");
+                }
+#else
+                throw std::runtime_error("BlockSci was built without zstd, which is required to read the compressed chunk " + path);
+#endif
+            }
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd);
+        if (sha256(reinterpret_cast<const uint8_t *>(out), length) != chunk.hash) {
+            throw std::runtime_error("Chunk " + path + " does not match its hash");
+        }
+    }
+
+    void SnapshotArchive::read(const std::string &key, int64_t offset, int64_t length, char *out) const {
+        auto it = files.find(key);
+        if (it == files.end()) {
+            throw std::invalid_argument("File " + key + " is not part of the snapshot");
+        }
+        auto &file = it->second;
+        if (offset < 0 || length < 0 || offset + length > file.size) {
+            throw std::out_of_range("Read past the end of " + key);
+        }
+        thread_local std::vector<char> partialChunk;
+        auto end = offset + length;
+        while (offset < end) {
+            auto chunkNum = static_cast<size_t>(offset / chunkSize);
+            auto chunkStart = static_cast<int64_t>(chunkNum) * chunkSize;
+            auto chunkBytes = chunkLength(file.size, chunkNum, chunkSize);
+            auto chunkEnd = chunkStart + chunkBytes;
+            if (offset == chunkStart && chunkEnd <= end) {
+                readChunk(file.chunks[chunkNum], chunkBytes, out);
+            } else {
+                partialChunk.resize(chunkBytes);
+                readChunk(file.chunks[chunkNum], chunkBytes, partialChunk.data());
+                auto copyEnd = std::min(chunkEnd, end);
+                std::memcpy(out, partialChunk.data() + (offset - chunkStart), static_cast<size_t>(copyEnd - offset));
+            }
+            auto next = std::min(chunkEnd, end);
+            out += next - offset;
+            offset = next;
+        }
+    }
+
+    SnapshotStats createSnapshot(const filesystem::path &dataDirectory, const filesystem::path &archiveDirectory, const std::string &name, const SnapshotOptions &options) {
+        if (options.chunkSize < (1u << 16) || (options.chunkSize & (options.chunkSize - 1)) != 0) {
+            throw std::invalid_argument("The chunk size of a snapshot must be a power of two of at least 64KB");
+        }
+        if (name.empty() || name.find('/') != std::string::npos) {
+            throw std::invalid_argument("Invalid snapshot name: " + name);
+        }
+        makeDirectory(archiveDirectory.str());
+        makeDirectory((archiveDirectory/"chunks").str());
+        makeDirectory((archiveDirectory/"snapshots").str());
+        auto manifestFile = manifestPath(archiveDirectory, name).str();
+        if (access(manifestFile.c_str(), F_OK) == 0) {
+            throw std::invalid_argument("Snapshot " + name + " already exists in " + archiveDirectory.str());
+        }
+
+        std::vector<SourceFile> sourceFiles;
+        auto skippedDirectory = canonicalPath(archiveDirectory);
+        collectFiles(dataDirectory.str(), "", skippedDirectory, sourceFiles);
+        for (auto &extra : options.extraDirectories) {
+            auto keyPrefix = extra.first;
+            if (!keyPrefix.empty() && keyPrefix.back() != '/') {
+                keyPrefix += '/';
+            }
+            collectFiles(extra.second.str(), keyPrefix, skippedDirectory, sourceFiles);
+        }
+        std::sort(sourceFiles.begin(), sourceFiles.end(), [](const SourceFile &a, const SourceFile &b) {
+            return a.key < b.key;
+        });
+
+        std::map<std::string, SnapshotArchive::File> parentFiles;
+        if (!options.parent.empty()) {
+            SnapshotArchive parent{archiveDirectory, options.parent};
+            if (parent.getChunkSize() == options.chunkSize) {
+                parentFiles = parent.getFiles();
+            }
+        }
+
+        SnapshotStats stats;
+        std::vector<SnapshotArchive::File> archivedFiles(sourceFiles.size());
+        std::vector<ChunkTask> tasks;
+        for (size_t fileNum = 0; fileNum < sourceFiles.size(); fileNum++) {
+            auto &source = sourceFiles[fileNum];
+            auto &archived = archivedFiles[fileNum];
+            archived.size = source.size;
+            archived.modificationTime = source.modificationTime;
+            auto chunkCount = static_cast<size_t>((static_cast<uint64_t>(source.size) + options.chunkSize - 1) / options.chunkSize);
+            auto parentIt = parentFiles.find(source.key);
+            if (parentIt != parentFiles.end() && parentIt->second.size == source.size && parentIt->second.modificationTime == source.modificationTime) {
+                archived.chunks = parentIt->second.chunks;
+            } else {
+                archived.chunks.resize(chunkCount);
+                for (size_t chunkNum = 0; chunkNum < chunkCount; chunkNum++) {
+                    tasks.push_back({fileNum, chunkNum});
+                }
+            }
+            stats.fileCount++;
+            stats.totalBytes += static_cast<uint64_t>(source.size);
+            stats.chunkCount += chunkCount;
+        }
+
+        std::atomic<size_t> nextTask{0};
+        std::atomic<uint64_t> newChunkCount{0};
+        std::atomic<uint64_t> newStoredBytes{0};
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;
+        std::mutex errorMutex;
+        auto worker = [&]() {
+            try {
+                ChunkWriter writer{archiveDirectory, options.compressionLevel, options.chunkSize};
+                std::vector<char> data(options.chunkSize);
+                size_t taskNum;
+                while (!failed.load() && (taskNum = nextTask.fetch_add(1)) < tasks.size()) {
+                    auto &task = tasks[taskNum];
+                    auto &source = sourceFiles[task.fileNum];
+                    auto length = chunkLength(source.size, task.chunkNum, options.chunkSize);
+                    auto fd = ::open(source.path.c_str(), O_RDONLY);
+                    if (fd < 0) {
+                        throwFileError("reading", source.path, errno);
+                    }
+                    try {
+                        readFully(fd, data.data(), length, static_cast<off_t>(task.chunkNum) * options.chunkSize, source.path);
+                    } catch (...) {
+                        ::close(fd);
+                        throw;
+                    }
+                    ::close(fd);
+                    auto hash = sha256(reinterpret_cast<const uint8_t *>(data.data()), length);
+                    auto stored = writer.store(hash, data.data(), length);
+                    archivedFiles[task.fileNum].chunks[task.chunkNum] = {hash, stored.first};
+                    if (stored.second) {
+                        newChunkCount++;
+                        newStoredBytes += stored.first;
+                    }
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                failed = true;
+            }
+        };
+        auto threadCount = options.threadCount > 0 ? options.threadCount : std::max(std::thread::hardware_concurrency(), 1u);
+        threadCount = static_cast<uint32_t>(std::min<size_t>(threadCount, std::max<size_t>(tasks.size(), 1)));
+        std::vector<std::thread> threads;
+        for (uint32_t i = 0; i < threadCount; i++) {
+            threads.emplace_back(worker);
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        stats.newChunkCount = newChunkCount;
+        stats.newStoredBytes = newStoredBytes;
+
+        json fileEntries = json::array();
+        for (size_t fileNum = 0; fileNum < sourceFiles.size(); fileNum++) {
+            auto &source = sourceFiles[fileNum];
+            auto &archived = archivedFiles[fileNum];
+            struct stat fileStat;
+            if (stat(source.path.c_str(), &fileStat) != 0 || static_cast<int64_t>(fileStat.st_size) != source.size || modificationTime(fileStat) != source.modificationTime) {
+                throw std::runtime_error(source.path + " changed while the snapshot was taken");
+            }
+            json chunkEntries = json::array();
+            for (auto &chunk : archived.chunks) {
+                chunkEntries.push_back({hashHex(chunk.hash), chunk.storedSize});
+            }
+            fileEntries.push_back({{"path", source.key}, {"size", source.size}, {"mtime", source.modificationTime}, {"chunks", std::move(chunkEntries)}});
+        }
+        json manifest = {{"format", manifestFormat}, {"chunkSize", options.chunkSize}, {"parent", options.parent}, {"files", std::move(fileEntries)}};
+        auto tempPath = manifestFile + ".part";
+        {
+            std::ofstream file{tempPath, std::ios::trunc};
+            file << manifest.dump();
+            if (!file.flush()) {
+                throwFileError("writing", tempPath, errno);
+            }
+        }
+        if (std::rename(tempPath.c_str(), manifestFile.c_str()) != 0) {
+            throwFileError("writing", manifestFile, errno);
+        }
+        return stats;
+    }
+} // namespace blocksci
@@ -0,0 +1,150 @@
+//
+//  snapshot_archive.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_snapshot_archive_hpp
+#define blocksci_snapshot_archive_hpp
+
+#include "remote_data.hpp"
+
+#include <blocksci/core/bitcoin_uint256.hpp>
+
+#include <wjfilesystem/path.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace blocksci {
+    /** Snapshot of an archive that a data directory is mounted from, loaded from the optional "archive" section of the
+     * config file, eg. {"directory": "/mnt/archive", "snapshot": "2026-10-15", "readers": 8, "cacheMB": 262144}
+     *
+     * The data directory serves as the local cache of the snapshot like with object storage, cacheMB bounds the part
+     * of tx_data.dat kept there (0 is unlimited). */
+    struct ArchiveMountConfig {
+        std::string directory;
+        std::string snapshot;
+        uint32_t readers = 8;
+        uint64_t cacheBudget = 0;
+
+        bool isSet() const {
+            return !snapshot.empty();
+        }
+    };
+
+    /** Options of createSnapshot */
+    struct SnapshotOptions {
+        /** Uncompressed size of the chunks the files are split into, a power of two of at least 64KB */
+        uint32_t chunkSize = 4 << 20;
+
+        /** zstd compression level of the chunks */
+        int compressionLevel = 3;
+
+        /** Earlier snapshot in the same archive whose chunk lists are reused for the files that have the same size and
+         * modification time as back then, so that only the changed files are read again. Empty reads every file */
+        std::string parent;
+
+        /** Directories outside of the data directory that are stored under a key prefix, eg. {"clusters/", path of a
+         * clustering} */
+        std::vector<std::pair<std::string, filesystem::path>> extraDirectories;
+
+        /** Number of threads hashing and compressing chunks, 0 for one per hardware thread */
+        uint32_t threadCount = 0;
+    };
+
+    struct SnapshotStats {
+        uint64_t fileCount = 0;
+        uint64_t totalBytes = 0;
+        uint64_t chunkCount = 0;
+
+        /** Chunks that weren't in the archive before and their size after compression */
+        uint64_t newChunkCount = 0;
+        uint64_t newStoredBytes = 0;
+    };
+
+    /** Directory of snapshots of data directories that share content-addressed chunks, used to distribute BlockSci data
+     *
+     * Layout:
+     *     - chunks/<first two hex digits>/<sha256 of the chunk as hex>: one chunk of up to chunkSize bytes of a file,
+     *       compressed as a single zstd frame, or stored as is if compression didn't make it smaller (then the stored
+     *       size equals the uncompressed size)
+     *     - snapshots/<name>.json: the manifest of a snapshot, {"format": 1, "chunkSize": ..., "parent": ...,
+     *       "files": [{"path": ..., "size": ..., "mtime": ..., "chunks": [["<sha256>", <stored size>], ...]}, ...]}
+     *
+     * Files are split at fixed offsets, so a file that was appended to since the last snapshot shares all but its
+     * last chunks with it and RocksDB tables, which are never rewritten, share all of them. Only the new chunks are
+     * added to the archive and copying the chunks/ directory with any tool that skips existing files (eg. rsync
+     * --ignore-existing) transfers just those. Since every chunk is an independent frame, the manifest doubles as the
+     * seek table: any range of a file is read by decompressing the chunks that cover it.
+     *
+     * A snapshot is opened as a RemoteFiles source and mounted like object storage (@see hydrateDataDirectory), which
+     * extracts the small files and reads tx_data.dat chunk by chunk as it is accessed.
+     */
+    class SnapshotArchive : public RemoteFiles {
+    public:
+        struct Chunk {
+            uint256 hash;
+            uint32_t storedSize;
+        };
+
+        struct File {
+            int64_t size;
+            int64_t modificationTime;
+            std::vector<Chunk> chunks;
+        };
+
+        /** Open the snapshot with the given name. readers is the number of chunks read in parallel by
+         * hydrateDataDirectory */
+        SnapshotArchive(const filesystem::path &archiveDirectory, const std::string &name, uint32_t readers = 8);
+
+        /** Names of the snapshots in the archive, sorted */
+        static std::vector<std::string> snapshotNames(const filesystem::path &archiveDirectory);
+
+        const std::map<std::string, File> &getFiles() const {
+            return files;
+        }
+
+        uint32_t getChunkSize() const {
+            return chunkSize;
+        }
+
+        /** Files of the snapshot whose paths start with keyPrefix, tagged with the hash of their chunk list */
+        std::vector<Object> list(const std::string &keyPrefix) const override;
+
+        /** Read the bytes [offset, offset + length) of the file by decompressing the chunks covering them. Every chunk
+         * is checked against its hash */
+        void read(const std::string &key, int64_t offset, int64_t length, char *out) const override;
+
+        uint32_t rangeSize() const override {
+            return chunkSize;
+        }
+
+        uint32_t parallelReads() const override {
+            return readers;
+        }
+
+    private:
+        filesystem::path archiveDirectory;
+        uint32_t chunkSize = 0;
+        uint32_t readers;
+        std::map<std::string, File> files;
+
+        void readChunk(const Chunk &chunk, uint32_t length, char *out) const;
+    };
+
+    /** Add a snapshot of the data directory (and the extra directories of the options) with the given name to the
+     * archive, creating the archive if necessary
+     *
+     * Only the chunks that aren't in the archive yet are compressed and written. The data directory must not change
+     * while it is archived, so the parser must not run at the same time; a file whose size or modification time
+     * changed by the time its last chunk was read fails the snapshot. Sidecars of lazily fetched files and the archive
+     * itself, if it is inside the data directory, are skipped. */
+    SnapshotStats createSnapshot(const filesystem::path &dataDirectory, const filesystem::path &archiveDirectory, const std::string &name, const SnapshotOptions &options);
+} // namespace blocksci
+
+#endif /* blocksci_snapshot_archive_hpp */
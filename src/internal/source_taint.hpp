@@ -0,0 +1,230 @@
+//
+//  source_taint.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_source_taint_hpp
+#define blocksci_source_taint_hpp
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace blocksci { namespace heuristics {
+    /** Fixed point proportion representing the whole value of an output */
+    constexpr uint32_t proportionOne = uint32_t{1} << 31;
+
+    /** Part of value given by proportion (@see proportionOne), rounded down, without overflowing for any valid value */
+    inline int64_t applyProportion(int64_t value, uint32_t proportion) {
+        constexpr int64_t lowMask = (int64_t{1} << 31) - 1;
+        return (value >> 31) * proportion + (((value & lowMask) * proportion) >> 31);
+    }
+
+    /** Share of the value of an output that comes from the seed output source */
+    struct SourceShare {
+        uint32_t source;
+        uint32_t proportion;
+    };
+
+    /** Storage of the share lists that don't fit inline in a SourceTaint, owned by one trace
+     *
+     * Blocks come in power of two size classes carved out of large chunks. A released block goes on the free list of its
+     * class and is handed out again, so the memory of a trace is bounded by the largest number of shares alive at once
+     * instead of growing with every transaction. Everything is freed together with the arena at the end of the trace.
+     * Allocation and release lock the arena, since transactions of a batch are processed concurrently.
+     */
+    class SourceShareArena {
+    public:
+        static constexpr uint32_t minBlockCapacity = 8;
+        static constexpr uint32_t maxBlockCapacity = 256;
+
+    private:
+        static constexpr size_t classCount = 6;
+        static constexpr size_t chunkCapacity = 8192;
+
+        struct FreeBlock {
+            FreeBlock *next;
+        };
+
+        static_assert(sizeof(FreeBlock) <= sizeof(SourceShare) * minBlockCapacity, "Free blocks hold their link");
+        static_assert(minBlockCapacity << (classCount - 1) == maxBlockCapacity, "Size classes cover all capacities");
+
+        std::mutex mutex;
+        std::vector<std::unique_ptr<SourceShare[]>> chunks;
+        size_t chunkOffset = chunkCapacity;
+        std::array<FreeBlock *, classCount> freeLists{};
+
+        static size_t sizeClass(uint32_t capacity) {
+            size_t sizeClass = 0;
+            while ((minBlockCapacity << sizeClass) < capacity) {
+                sizeClass++;
+            }
+            return sizeClass;
+        }
+
+    public:
+        SourceShareArena() = default;
+        SourceShareArena(const SourceShareArena &) = delete;
+        SourceShareArena &operator=(const SourceShareArena &) = delete;
+
+        /** Block for at least capacity shares, capacity is rounded up to the capacity of the block */
+        SourceShare *allocate(uint32_t &capacity) {
+            if (capacity > maxBlockCapacity) {
+                throw std::invalid_argument("A source taint can't track more than " + std::to_string(maxBlockCapacity) + " sources");
+            }
+            auto blockClass = sizeClass(capacity);
+            capacity = minBlockCapacity << blockClass;
+            std::lock_guard<std::mutex> lock(mutex);
+            if (auto block = freeLists[blockClass]) {
+                freeLists[blockClass] = block->next;
+                return reinterpret_cast<SourceShare *>(block);
+            }
+            if (chunkOffset + capacity > chunkCapacity) {
+                chunks.emplace_back(new SourceShare[chunkCapacity]);
+                chunkOffset = 0;
+            }
+            auto block = chunks.back().get() + chunkOffset;
+            chunkOffset += capacity;
+            return block;
+        }
+
+        void release(SourceShare *shares, uint32_t capacity) {
+            auto block = reinterpret_cast<FreeBlock *>(shares);
+            auto blockClass = sizeClass(capacity);
+            std::lock_guard<std::mutex> lock(mutex);
+            block->next = freeLists[blockClass];
+            freeLists[blockClass] = block;
+        }
+
+        /** Bytes held by the arena, including released blocks */
+        size_t reservedBytes() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return chunks.size() * chunkCapacity * sizeof(SourceShare);
+        }
+    };
+
+    /** Haircut taint of an output by source: its value and the share of it coming from every tainted seed output,
+     * sorted by source
+     *
+     * Up to inlineCapacity shares are stored in the object itself, which covers most outputs, longer lists live in the
+     * SourceShareArena of the trace. */
+    class SourceTaint {
+    public:
+        static constexpr uint32_t inlineCapacity = 4;
+
+        int64_t value = 0;
+
+    private:
+        SourceShareArena *arena = nullptr;
+        SourceShare *spilled = nullptr;
+        uint32_t count = 0;
+        uint32_t capacity = inlineCapacity;
+        SourceShare inlineShares[inlineCapacity];
+
+        void release() {
+            if (spilled != nullptr) {
+                arena->release(spilled, capacity);
+                spilled = nullptr;
+                arena = nullptr;
+                capacity = inlineCapacity;
+            }
+            count = 0;
+        }
+
+    public:
+        SourceTaint() = default;
+        explicit SourceTaint(int64_t value_) : value(value_) {}
+
+        SourceTaint(const SourceTaint &other) : value(other.value) {
+            if (other.spilled != nullptr) {
+                assign(other.begin(), other.count, *other.arena);
+            } else {
+                std::copy(other.inlineShares, other.inlineShares + other.count, inlineShares);
+                count = other.count;
+            }
+        }
+
+        SourceTaint(SourceTaint &&other) noexcept : value(other.value), arena(other.arena), spilled(other.spilled), count(other.count), capacity(other.capacity) {
+            if (spilled == nullptr) {
+                std::copy(other.inlineShares, other.inlineShares + other.count, inlineShares);
+            }
+            other.arena = nullptr;
+            other.spilled = nullptr;
+            other.count = 0;
+            other.capacity = inlineCapacity;
+        }
+
+        SourceTaint &operator=(const SourceTaint &other) {
+            if (this != &other) {
+                SourceTaint copy{other};
+                *this = std::move(copy);
+            }
+            return *this;
+        }
+
+        SourceTaint &operator=(SourceTaint &&other) noexcept {
+            if (this != &other) {
+                release();
+                value = other.value;
+                arena = other.arena;
+                spilled = other.spilled;
+                count = other.count;
+                capacity = other.capacity;
+                if (spilled == nullptr) {
+                    std::copy(other.inlineShares, other.inlineShares + other.count, inlineShares);
+                }
+                other.arena = nullptr;
+                other.spilled = nullptr;
+                other.count = 0;
+                other.capacity = inlineCapacity;
+            }
+            return *this;
+        }
+
+        ~SourceTaint() {
+            release();
+        }
+
+        /** Replace the shares, the ones that don't fit inline are stored in the arena */
+        void assign(const SourceShare *shares, uint32_t shareCount, SourceShareArena &arena_) {
+            if (shareCount > capacity) {
+                release();
+                capacity = shareCount;
+                spilled = arena_.allocate(capacity);
+                arena = &arena_;
+            }
+            std::copy(shares, shares + shareCount, spilled != nullptr ? spilled : inlineShares);
+            count = shareCount;
+        }
+
+        void clear() {
+            value = 0;
+            release();
+        }
+
+        const SourceShare *begin() const {
+            return spilled != nullptr ? spilled : inlineShares;
+        }
+
+        const SourceShare *end() const {
+            return begin() + count;
+        }
+
+        uint32_t size() const {
+            return count;
+        }
+
+        bool empty() const {
+            return count == 0;
+        }
+    };
+}}
+
+#endif /* blocksci_source_taint_hpp */
@@ -0,0 +1,151 @@
+//
+//  sst_bulk_loader.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include "sst_bulk_loader.hpp"
+
+#include <rocksdb/sst_file_writer.h>
+#include <rocksdb/write_batch.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace blocksci {
+
+    namespace {
+        class BatchHandler : public rocksdb::WriteBatch::Handler {
+            SstBulkLoader &loader;
+
+        public:
+            explicit BatchHandler(SstBulkLoader &loader_) : loader(loader_) {}
+
+            rocksdb::Status PutCF(uint32_t columnId, const rocksdb::Slice &key, const rocksdb::Slice &value) override {
+                loader.put(columnId, key, value);
+                return rocksdb::Status::OK();
+            }
+        };
+    }
+
+    SstBulkLoader::SstBulkLoader(rocksdb::DB *db_, const std::vector<rocksdb::ColumnFamilyHandle *> &handles, const filesystem::path &directory_) : db(db_), directory(directory_) {
+        if (!directory.exists()) {
+            filesystem::create_directory(directory);
+        }
+        for (auto handle : handles) {
+            columns[handle->GetID()].handle = handle;
+        }
+    }
+
+    SstBulkLoader::~SstBulkLoader() {
+        for (auto &entry : columns) {
+            auto &column = entry.second;
+            if (column.pendingWrite.valid()) {
+                try {
+                    column.pendingWrite.get();
+                } catch (const std::exception &) {
+                    // The load is abandoned anyway
+                }
+            }
+            for (auto &file : column.files) {
+                std::remove(file.c_str());
+            }
+        }
+        std::remove(directory.str().c_str());
+    }
+
+    void SstBulkLoader::put(uint32_t columnId, const rocksdb::Slice &key, const rocksdb::Slice &value) {
+        auto it = columns.find(columnId);
+        if (it == columns.end()) {
+            throw std::runtime_error("Bulk load into unknown column family " + std::to_string(columnId));
+        }
+        auto &run = it->second.run;
+        run.rows.push_back(Row{run.data.size(), static_cast<uint32_t>(key.size()), static_cast<uint32_t>(value.size())});
+        run.data.insert(run.data.end(), key.data(), key.data() + key.size());
+        run.data.insert(run.data.end(), value.data(), value.data() + value.size());
+        if (run.data.size() >= runSize) {
+            flushRun(it->second);
+        }
+    }
+
+    void SstBulkLoader::add(const rocksdb::WriteBatch &batch) {
+        BatchHandler handler{*this};
+        auto s = batch.Iterate(&handler);
+        if (!s.ok()) {
+            throw std::runtime_error("Could not add batch to bulk load with error: " + s.ToString());
+        }
+    }
+
+    void SstBulkLoader::flushRun(ColumnState &column) {
+        if (column.run.rows.empty()) {
+            return;
+        }
+        // Bounds memory to one run being collected and one being written per column
+        if (column.pendingWrite.valid()) {
+            column.pendingWrite.get();
+        }
+        auto path = (directory/(std::to_string(column.handle->GetID()) + "_" + std::to_string(fileCount++) + ".sst")).str();
+        column.files.push_back(path);
+        Run run;
+        std::swap(run, column.run);
+        column.pendingWrite = std::async(std::launch::async, writeRun, db, column.handle, std::move(run), path);
+    }
+
+    void SstBulkLoader::writeRun(rocksdb::DB *db, rocksdb::ColumnFamilyHandle *handle, Run run, const std::string &path) {
+        const char *data = run.data.data();
+        auto keyLess = [data](const Row &a, const Row &b) {
+            auto cmp = memcmp(data + a.offset, data + b.offset, std::min(a.keySize, b.keySize));
+            return cmp < 0 || (cmp == 0 && a.keySize < b.keySize);
+        };
+        // Stable so that the last of several rows with the same key can be kept
+        std::stable_sort(run.rows.begin(), run.rows.end(), keyLess);
+
+        rocksdb::SstFileWriter writer{rocksdb::EnvOptions{}, db->GetOptions(handle), handle};
+        auto s = writer.Open(path);
+        if (!s.ok()) {
+            throw std::runtime_error("Could not create bulk load file " + path + " with error: " + s.ToString());
+        }
+        for (size_t i = 0; i < run.rows.size(); i++) {
+            const auto &row = run.rows[i];
+            if (i + 1 < run.rows.size() && !keyLess(row, run.rows[i + 1])) {
+                continue;
+            }
+            rocksdb::Slice key{data + row.offset, row.keySize};
+            rocksdb::Slice value{data + row.offset + row.keySize, row.valueSize};
+            s = writer.Put(key, value);
+            if (!s.ok()) {
+                throw std::runtime_error("Could not write bulk load file " + path + " with error: " + s.ToString());
+            }
+        }
+        s = writer.Finish();
+        if (!s.ok()) {
+            throw std::runtime_error("Could not finish bulk load file " + path + " with error: " + s.ToString());
+        }
+    }
+
+    void SstBulkLoader::finish() {
+        for (auto &entry : columns) {
+            flushRun(entry.second);
+        }
+        for (auto &entry : columns) {
+            auto &column = entry.second;
+            if (column.pendingWrite.valid()) {
+                column.pendingWrite.get();
+            }
+            if (column.files.empty()) {
+                continue;
+            }
+            rocksdb::IngestExternalFileOptions options;
+            options.move_files = true;
+            // Files of later runs overlap earlier ones and are ingested after them, so their values win
+            auto s = db->IngestExternalFile(column.handle, column.files, options);
+            if (!s.ok()) {
+                throw std::runtime_error("Could not ingest bulk load files into " + column.handle->GetName() + " with error: " + s.ToString());
+            }
+            column.files.clear();
+        }
+    }
+} // namespace blocksci
@@ -0,0 +1,86 @@
+//
+//  sst_bulk_loader.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_index_sst_bulk_loader_hpp
+#define blocksci_index_sst_bulk_loader_hpp
+
+#include <rocksdb/db.h>
+
+#include <wjfilesystem/path.h>
+
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rocksdb {
+    class WriteBatch;
+}
+
+namespace blocksci {
+
+    /** Loads large amounts of data into a RocksDB database by ingesting sorted table files
+     *
+     * Rows are collected in memory per column family. Whenever a column has collected a full run, the run is sorted
+     * and written to a table file with SstFileWriter on a background thread while new rows are collected, so the
+     * runs of all columns are sorted and written in parallel. finish() ingests all files with IngestExternalFile,
+     * which bypasses the WAL, the memtables and the compactions that writing the rows one at a time would cause.
+     *
+     * Rows added to the loader are not visible in the database before finish(). If a key is added repeatedly, the
+     * last value wins.
+     */
+    class SstBulkLoader {
+        struct Row {
+            size_t offset;
+            uint32_t keySize;
+            uint32_t valueSize;
+        };
+
+        /** Rows of one column family that haven't been written yet */
+        struct Run {
+            std::vector<char> data;
+            std::vector<Row> rows;
+        };
+
+        struct ColumnState {
+            rocksdb::ColumnFamilyHandle *handle;
+            Run run;
+            std::future<void> pendingWrite;
+            std::vector<std::string> files;
+        };
+
+        rocksdb::DB *db;
+        filesystem::path directory;
+        std::map<uint32_t, ColumnState> columns;
+        size_t fileCount = 0;
+
+        void flushRun(ColumnState &column);
+        static void writeRun(rocksdb::DB *db, rocksdb::ColumnFamilyHandle *handle, Run run, const std::string &path);
+
+    public:
+        /** Bytes of rows collected per column before they are written out as a table file */
+        static constexpr size_t runSize = size_t{128} * 1024 * 1024;
+
+        /** Temporary table files are written to directory, which is created if needed */
+        SstBulkLoader(rocksdb::DB *db, const std::vector<rocksdb::ColumnFamilyHandle *> &handles, const filesystem::path &directory);
+        SstBulkLoader(const SstBulkLoader &) = delete;
+        SstBulkLoader &operator=(const SstBulkLoader &) = delete;
+        ~SstBulkLoader();
+
+        void put(uint32_t columnId, const rocksdb::Slice &key, const rocksdb::Slice &value);
+
+        /** Add all puts of the batch */
+        void add(const rocksdb::WriteBatch &batch);
+
+        /** Write the remaining rows and ingest all table files into the database */
+        void finish();
+    };
+} // namespace blocksci
+
+#endif /* blocksci_index_sst_bulk_loader_hpp */
@@ -0,0 +1,115 @@
+//
+//  tracing.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "tracing.hpp"
+
+#include <chrono>
+#include <functional>
+#include <thread>
+
+namespace blocksci {
+    std::atomic<TraceSink *> activeTraceSink{nullptr};
+
+    namespace {
+        uint64_t steadyNanoseconds() {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+    }
+
+    const char *traceOperationName(TraceOperation operation) {
+        switch (operation) {
+            case TraceOperation::IndexSeek:
+                return "index_seek";
+            case TraceOperation::IndexScan:
+                return "index_scan";
+            case TraceOperation::ClusterLookup:
+                return "cluster_lookup";
+            case TraceOperation::TaintRun:
+                return "taint_run";
+            case TraceOperation::MapReduceSegment:
+                return "map_reduce_segment";
+            case TraceOperation::ClusteringPhase:
+                return "clustering_phase";
+        }
+        return "unknown";
+    }
+
+    const char *clusteringPhaseName(ClusteringPhase phase) {
+        switch (phase) {
+            case ClusteringPhase::LinkScripthashNested:
+                return "link_scripthash_nested";
+            case ClusteringPhase::LinkTransactions:
+                return "link_transactions";
+            case ClusteringPhase::RefineClusters:
+                return "refine_clusters";
+            case ClusteringPhase::ResolveClusters:
+                return "resolve_clusters";
+            case ClusteringPhase::WriteClusterState:
+                return "write_cluster_state";
+            case ClusteringPhase::RemapClusterIds:
+                return "remap_cluster_ids";
+            case ClusteringPhase::SerializeClusterData:
+                return "serialize_cluster_data";
+            case ClusteringPhase::WriteClusterStats:
+                return "write_cluster_stats";
+        }
+        return "unknown";
+    }
+
+    TraceSink::~TraceSink() = default;
+
+    void setTraceSink(TraceSink *sink) {
+        activeTraceSink.store(sink, std::memory_order_release);
+    }
+
+    TraceSink *traceSink() {
+        return activeTraceSink.load(std::memory_order_acquire);
+    }
+
+    SpanRecorder::~SpanRecorder() {
+        TraceSink *self = this;
+        activeTraceSink.compare_exchange_strong(self, nullptr);
+    }
+
+    uint64_t SpanRecorder::beginSpan(TraceOperation operation, uint64_t argument) {
+        Span span{operation, argument, std::hash<std::thread::id>{}(std::this_thread::get_id()), steadyNanoseconds(), 0};
+        std::lock_guard<std::mutex> lock(mutex);
+        recorded.push_back(span);
+        ended.push_back(false);
+        return clearedCount + recorded.size() - 1;
+    }
+
+    void SpanRecorder::endSpan(uint64_t span, TraceOperation) {
+        auto now = steadyNanoseconds();
+        std::lock_guard<std::mutex> lock(mutex);
+        // Spans that began before a clear() are dropped
+        if (span < clearedCount || span - clearedCount >= recorded.size()) {
+            return;
+        }
+        auto index = static_cast<size_t>(span - clearedCount);
+        recorded[index].durationNanoseconds = now - recorded[index].startNanoseconds;
+        ended[index] = true;
+    }
+
+    std::vector<SpanRecorder::Span> SpanRecorder::spans() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<Span> finished;
+        for (size_t i = 0; i < recorded.size(); i++) {
+            if (ended[i]) {
+                finished.push_back(recorded[i]);
+            }
+        }
+        return finished;
+    }
+
+    void SpanRecorder::clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        clearedCount += recorded.size();
+        recorded.clear();
+        ended.clear();
+    }
+} // namespace blocksci
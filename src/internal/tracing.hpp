@@ -0,0 +1,47 @@
+//
+//  tracing.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_internal_tracing_hpp
+#define blocksci_internal_tracing_hpp
+
+#include <blocksci/core/tracing.hpp>
+
+#include <atomic>
+
+namespace blocksci {
+    /** Sink installed with setTraceSink, nullptr while tracing is off */
+    extern std::atomic<TraceSink *> activeTraceSink;
+
+    /** Reports the enclosing scope as one span to the active sink, if there is one when the span begins */
+    class TraceSpan {
+        TraceSink *sink;
+        TraceOperation operation;
+        uint64_t span = 0;
+
+    public:
+        explicit TraceSpan(TraceOperation operation_, uint64_t argument = 0) : sink(activeTraceSink.load(std::memory_order_acquire)), operation(operation_) {
+            if (sink != nullptr) {
+                span = sink->beginSpan(operation, argument);
+            }
+        }
+
+        TraceSpan(const TraceSpan &) = delete;
+        TraceSpan &operator=(const TraceSpan &) = delete;
+
+        ~TraceSpan() {
+            if (sink != nullptr) {
+                sink->endSpan(span, operation);
+            }
+        }
+
+        static bool tracing() {
+            return activeTraceSink.load(std::memory_order_relaxed) != nullptr;
+        }
+    };
+} // namespace blocksci
+
+#endif /* blocksci_internal_tracing_hpp */
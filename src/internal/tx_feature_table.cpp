@@ -0,0 +1,75 @@
+//
+//  tx_feature_table.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include "tx_feature_table.hpp"
+#include "chain_access.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+namespace blocksci {
+
+    namespace {
+        constexpr uint64_t metaMagic = 0x5341454654525854ULL; // "TXRTFEAS"
+
+        struct FeatureMeta {
+            uint64_t magic;
+            uint32_t txCount;
+            uint32_t padding;
+            TxFeatureTable::CoinJoinParameters parameters;
+            uint256 lastTxHash;
+        };
+    }
+
+    TxFeatureTable::TxFeatureTable(const filesystem::path &directory, const ChainAccess &chain) : features(featuresPath(directory)) {
+        std::ifstream file(metaPath(directory).str(), std::ios::binary);
+        FeatureMeta meta;
+        if (!file.read(reinterpret_cast<char *>(&meta), sizeof(meta)) || meta.magic != metaMagic || meta.txCount == 0) {
+            return;
+        }
+        if (features.size() < meta.txCount) {
+            throw std::runtime_error("Tx feature table in " + directory.str() + " is shorter than its metadata");
+        }
+        // A chain loaded with blocksIgnored can end before the table, in which case only its prefix is checked
+        auto checkedTxCount = std::min(meta.txCount, static_cast<uint32_t>(chain.txCount()));
+        if (checkedTxCount == 0) {
+            return;
+        }
+        if (checkedTxCount == meta.txCount && *chain.getTxHash(checkedTxCount - 1) != meta.lastTxHash) {
+            return;
+        }
+        parameters = meta.parameters;
+        coveredTxCount = checkedTxCount;
+        features.advise(AccessHint::Random);
+    }
+
+    filesystem::path TxFeatureTable::metaPath(const filesystem::path &directory) {
+        return directory/"meta.dat";
+    }
+
+    filesystem::path TxFeatureTable::featuresPath(const filesystem::path &directory) {
+        return directory/"features";
+    }
+
+    void TxFeatureTable::writeMeta(const filesystem::path &directory, const CoinJoinParameters &parameters, uint32_t txCount, const uint256 &lastTxHash) {
+        auto path = metaPath(directory).str();
+        auto tempPath = path + ".tmp";
+        {
+            FeatureMeta meta{metaMagic, txCount, 0, parameters, lastTxHash};
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char *>(&meta), sizeof(meta));
+            if (!file) {
+                throw std::runtime_error("Could not write tx feature table metadata to " + tempPath);
+            }
+        }
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("Could not move tx feature table metadata into place at " + path);
+        }
+    }
+} // namespace blocksci
@@ -0,0 +1,82 @@
+//
+//  tx_feature_table.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_index_tx_feature_table_hpp
+#define blocksci_index_tx_feature_table_hpp
+
+#include "file_mapper.hpp"
+
+#include <blocksci/core/bitcoin_uint256.hpp>
+#include <blocksci/core/tx_features.hpp>
+
+#include <wjfilesystem/path.h>
+
+#include <cstdint>
+
+namespace blocksci {
+    class ChainAccess;
+
+    /** Precomputed TxFeatures of the first txCount() transactions, indexed by txNum
+     *
+     * The possible CoinJoin flags depend on the parameters of isPossibleCoinjoin and isCoinjoinExtra, which are stored
+     * with the table and have to match for these flags to be used. The table only holds classifiers that depend on
+     * the transaction and the outputs it spends, so the entries stay valid as the chain grows. A metadata file names
+     * the number of covered transactions and the hash of the last one. It is replaced atomically after the entries
+     * were appended, and a table whose last transaction isn't part of the chain anymore after a reorg is ignored.
+     *
+     * Directory: txFeatures/
+     */
+    class TxFeatureTable {
+    public:
+        struct CoinJoinParameters {
+            int64_t minBaseFee;
+            double percentageFee;
+            uint64_t maxDepth;
+            
+            bool operator==(const CoinJoinParameters &other) const {
+                return minBaseFee == other.minBaseFee && percentageFee == other.percentageFee && maxDepth == other.maxDepth;
+            }
+            
+            bool operator!=(const CoinJoinParameters &other) const {
+                return !operator==(other);
+            }
+        };
+        
+        TxFeatureTable(const filesystem::path &directory, const ChainAccess &chain);
+        
+        /** False if no table was built or it doesn't match the chain */
+        bool isGood() const {
+            return coveredTxCount > 0;
+        }
+        
+        uint32_t txCount() const {
+            return coveredTxCount;
+        }
+        
+        const CoinJoinParameters &getParameters() const {
+            return parameters;
+        }
+        
+        /** Features of the given transaction, nullptr if it isn't covered */
+        const TxFeatures *get(uint32_t txNum) const {
+            return txNum < coveredTxCount ? features[txNum] : nullptr;
+        }
+        
+        static filesystem::path metaPath(const filesystem::path &directory);
+        static filesystem::path featuresPath(const filesystem::path &directory);
+        
+        /** Declare the first txCount entries of the features file complete */
+        static void writeMeta(const filesystem::path &directory, const CoinJoinParameters &parameters, uint32_t txCount, const uint256 &lastTxHash);
+        
+    private:
+        FixedSizeFileMapper<TxFeatures> features;
+        CoinJoinParameters parameters{0, 0, 0};
+        uint32_t coveredTxCount = 0;
+    };
+} // namespace blocksci
+
+#endif /* blocksci_index_tx_feature_table_hpp */
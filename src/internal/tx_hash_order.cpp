@@ -0,0 +1,295 @@
+//
+//  tx_hash_order.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "tx_hash_order.hpp"
+#include "chain_access.hpp"
+#include "segment_work.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+
+namespace blocksci {
+
+    namespace {
+        constexpr OffsetType headerWords = sizeof(TxHashOrder::Header) / sizeof(uint32_t);
+
+        // Buckets of a few thousand transactions sort within the caches
+        constexpr uint32_t targetBucketSize = 4096;
+        constexpr uint32_t maxBucketBits = 24;
+
+        // Ranges of the hash space per thread when merging, so that threads that finish early take over the rest
+        constexpr uint32_t rangesPerThread = 8;
+
+        uint32_t calculateBucketBits(uint32_t txCount) {
+            uint32_t bits = 0;
+            while (bits < maxBucketBits && (uint64_t{1} << bits) * targetBucketSize < txCount) {
+                bits++;
+            }
+            return bits;
+        }
+
+        inline uint32_t bucketOf(uint64_t key, uint32_t bucketBits) {
+            return bucketBits == 0 ? 0 : static_cast<uint32_t>(key >> (64 - bucketBits));
+        }
+
+        /** Transactions of a loaded chain in hash order, the ones covered by its TxHashOrder followed by the rest
+         * sorted in memory, which a merge walks like one sequence */
+        struct SortedTxes {
+            const ChainAccess &chain;
+            std::unique_ptr<TxHashOrder> order;
+            const uint32_t *ordered = nullptr;
+            uint32_t orderedCount = 0;
+            std::vector<uint32_t> rest;
+
+            SortedTxes(const ChainAccess &chain_, const filesystem::path &orderPath, uint32_t threadCount) : chain(chain_), order(std::make_unique<TxHashOrder>(orderPath)) {
+                if (order->matches(chain)) {
+                    ordered = order->begin();
+                    orderedCount = order->txCount();
+                }
+                auto txCount = static_cast<uint32_t>(chain.txCount());
+                rest.resize(txCount - orderedCount);
+                sortTxNumsByHash(chain, orderedCount, txCount, rest.data(), threadCount);
+            }
+
+            const uint256 &hash(uint32_t txNum) const {
+                return *chain.getTxHash(txNum);
+            }
+
+            /** Positions of the first transactions whose hashes have at least the given order key in both sequences */
+            std::pair<size_t, size_t> lowerBound(uint64_t key) const {
+                auto below = [&](uint32_t txNum) { return txHashOrderKey(hash(txNum)) < key; };
+                auto orderedPos = std::partition_point(ordered, ordered + orderedCount, below) - ordered;
+                auto restPos = std::partition_point(rest.begin(), rest.end(), below) - rest.begin();
+                return {static_cast<size_t>(orderedPos), static_cast<size_t>(restPos)};
+            }
+        };
+
+        /** Merges the two sequences of SortedTxes between two lowerBound positions */
+        class SortedTxCursor {
+            const SortedTxes &txes;
+            size_t orderedPos;
+            size_t orderedEnd;
+            size_t restPos;
+            size_t restEnd;
+            bool headIsOrdered = false;
+
+            void settle() {
+                if (restPos == restEnd) {
+                    headIsOrdered = true;
+                } else if (orderedPos == orderedEnd) {
+                    headIsOrdered = false;
+                } else {
+                    headIsOrdered = !txHashOrderLess(txes.hash(txes.rest[restPos]), txes.hash(txes.ordered[orderedPos]));
+                }
+            }
+
+        public:
+            SortedTxCursor(const SortedTxes &txes_, std::pair<size_t, size_t> begin, std::pair<size_t, size_t> end) : txes(txes_), orderedPos(begin.first), orderedEnd(end.first), restPos(begin.second), restEnd(end.second) {
+                settle();
+            }
+
+            bool valid() const {
+                return orderedPos < orderedEnd || restPos < restEnd;
+            }
+
+            uint32_t txNum() const {
+                return headIsOrdered ? txes.ordered[orderedPos] : txes.rest[restPos];
+            }
+
+            const uint256 &hash() const {
+                return txes.hash(txNum());
+            }
+
+            void next() {
+                if (headIsOrdered) {
+                    orderedPos++;
+                } else {
+                    restPos++;
+                }
+                settle();
+            }
+        };
+    }
+
+    TxHashOrder::TxHashOrder(const filesystem::path &path) : file(path) {
+        if (!file.isGood() || file.size() < static_cast<OffsetType>(sizeof(Header))) {
+            return;
+        }
+        std::memcpy(&header, file.getDataAtOffset(0), sizeof(Header));
+        auto expectedSize = static_cast<OffsetType>(sizeof(Header)) + header.txCount * static_cast<OffsetType>(sizeof(uint32_t));
+        if (header.magic != Magic || header.txCount == 0 || file.size() != expectedSize) {
+            header = Header{0, 0, 0, uint256{}};
+            return;
+        }
+        txNums = reinterpret_cast<const uint32_t *>(file.getDataAtOffset(sizeof(Header)));
+    }
+
+    bool TxHashOrder::matches(const ChainAccess &chain) const {
+        // The order can cover transactions that a reorganization since removed from the chain
+        return isGood() && header.txCount <= chain.txCount() && *chain.getTxHash(header.txCount - 1) == header.lastTxHash;
+    }
+
+    ranges::optional<uint32_t> TxHashOrder::find(const uint256 &hash, const ChainAccess &chain) const {
+        if (!isGood()) {
+            return ranges::nullopt;
+        }
+        auto it = std::partition_point(begin(), end(), [&](uint32_t txNum) {
+            return txHashOrderLess(*chain.getTxHash(txNum), hash);
+        });
+        if (it != end() && *chain.getTxHash(*it) == hash) {
+            return *it;
+        }
+        return ranges::nullopt;
+    }
+
+    void TxHashOrder::build(const filesystem::path &path, const ChainAccess &chain, uint32_t txCount, uint32_t threadCount) {
+        if (txCount == 0 || txCount > chain.txCount()) {
+            throw std::invalid_argument("A tx hash order must cover between one and all transactions of the chain");
+        }
+
+        // Written next to the existing order and renamed over it once complete, so readers never see a partial order
+        filesystem::path buildPath{path.str() + "Build"};
+        filesystem::path buildFilePath{buildPath.str() + ".dat"};
+        if (buildFilePath.exists()) {
+            buildFilePath.remove_file();
+        }
+        {
+            FixedSizeFileMapper<uint32_t, mio::access_mode::write> out{buildPath};
+            out.truncate(headerWords + txCount);
+            sortTxNumsByHash(chain, 0, txCount, out[headerWords], threadCount);
+            Header header{Magic, txCount, 0, *chain.getTxHash(txCount - 1)};
+            std::memcpy(out[0], &header, sizeof(header));
+        }
+
+        filesystem::path filePath{path.str() + ".dat"};
+        if (std::rename(buildFilePath.str().c_str(), filePath.str().c_str()) != 0) {
+            throw std::runtime_error("Could not move tx hash order into place at " + filePath.str());
+        }
+    }
+
+    void sortTxNumsByHash(const ChainAccess &chain, uint32_t beginTxNum, uint32_t endTxNum, uint32_t *out, uint32_t threadCount) {
+        if (endTxNum <= beginTxNum) {
+            return;
+        }
+        threadCount = resolveThreadCount(threadCount);
+        auto bucketBits = calculateBucketBits(endTxNum - beginTxNum);
+        auto bucketCount = uint32_t{1} << bucketBits;
+        auto segments = splitSegments(beginTxNum, endTxNum, threadCount);
+
+        // Count the transactions of every segment in every bucket, then turn the counts into the positions at which
+        // each segment writes the transactions of a bucket
+        std::vector<std::vector<uint32_t>> positions(segments.size(), std::vector<uint32_t>(bucketCount, 0));
+        runSegments(segments, [&](uint32_t segmentNum, uint32_t segmentStart, uint32_t segmentEnd) {
+            auto &counts = positions[segmentNum];
+            for (uint32_t txNum = segmentStart; txNum < segmentEnd; txNum++) {
+                counts[bucketOf(txHashOrderKey(*chain.getTxHash(txNum)), bucketBits)]++;
+            }
+        });
+        std::vector<uint32_t> bucketStarts(bucketCount + 1);
+        uint32_t position = 0;
+        for (uint32_t bucket = 0; bucket < bucketCount; bucket++) {
+            bucketStarts[bucket] = position;
+            for (auto &segmentPositions : positions) {
+                auto count = segmentPositions[bucket];
+                segmentPositions[bucket] = position;
+                position += count;
+            }
+        }
+        bucketStarts[bucketCount] = position;
+        runSegments(segments, [&](uint32_t segmentNum, uint32_t segmentStart, uint32_t segmentEnd) {
+            auto &segmentPositions = positions[segmentNum];
+            for (uint32_t txNum = segmentStart; txNum < segmentEnd; txNum++) {
+                out[segmentPositions[bucketOf(txHashOrderKey(*chain.getTxHash(txNum)), bucketBits)]++] = txNum;
+            }
+        });
+        std::vector<std::vector<uint32_t>>{}.swap(positions);
+
+        // Buckets are sorted by the order key first, which only compares whole hashes for the rare equal keys
+        std::atomic<uint32_t> nextBucket{0};
+        runSegments(std::vector<std::pair<uint32_t, uint32_t>>(threadCount), [&](uint32_t, uint32_t, uint32_t) {
+            std::vector<std::pair<uint64_t, uint32_t>> keys;
+            uint32_t bucket;
+            while ((bucket = nextBucket.fetch_add(1)) < bucketCount) {
+                auto begin = out + bucketStarts[bucket];
+                auto end = out + bucketStarts[bucket + 1];
+                keys.clear();
+                for (auto it = begin; it != end; ++it) {
+                    keys.emplace_back(txHashOrderKey(*chain.getTxHash(*it)), *it);
+                }
+                std::sort(keys.begin(), keys.end(), [&](const std::pair<uint64_t, uint32_t> &a, const std::pair<uint64_t, uint32_t> &b) {
+                    if (a.first != b.first) {
+                        return a.first < b.first;
+                    }
+                    auto &hashA = *chain.getTxHash(a.second);
+                    auto &hashB = *chain.getTxHash(b.second);
+                    // Duplicate hashes (BIP30) stay in tx number order
+                    return hashA != hashB ? hashA < hashB : a.second < b.second;
+                });
+                for (size_t i = 0; i < keys.size(); i++) {
+                    begin[i] = keys[i].second;
+                }
+            }
+        });
+    }
+
+    std::vector<std::pair<uint32_t, uint32_t>> matchTxHashes(const ChainAccess &a, const filesystem::path &orderPathA, const ChainAccess &b, const filesystem::path &orderPathB, uint32_t threadCount) {
+        threadCount = resolveThreadCount(threadCount);
+        SortedTxes txesA{a, orderPathA, threadCount};
+        SortedTxes txesB{b, orderPathB, threadCount};
+
+        // Ranges of equal width in the order key, which splits the uniformly distributed hashes evenly
+        auto rangeCount = threadCount * rangesPerThread;
+        auto rangeWidth = std::numeric_limits<uint64_t>::max() / rangeCount + 1;
+        auto rangeStart = [&](const SortedTxes &txes, uint32_t range) -> std::pair<size_t, size_t> {
+            if (range == rangeCount) {
+                return {txes.orderedCount, txes.rest.size()};
+            }
+            return txes.lowerBound(range * rangeWidth);
+        };
+
+        std::vector<std::vector<std::pair<uint32_t, uint32_t>>> rangeMatches(rangeCount);
+        std::atomic<uint32_t> nextRange{0};
+        runSegments(std::vector<std::pair<uint32_t, uint32_t>>(threadCount), [&](uint32_t, uint32_t, uint32_t) {
+            uint32_t range;
+            while ((range = nextRange.fetch_add(1)) < rangeCount) {
+                SortedTxCursor cursorA{txesA, rangeStart(txesA, range), rangeStart(txesA, range + 1)};
+                SortedTxCursor cursorB{txesB, rangeStart(txesB, range), rangeStart(txesB, range + 1)};
+                auto &matches = rangeMatches[range];
+                while (cursorA.valid() && cursorB.valid()) {
+                    auto &hashA = cursorA.hash();
+                    auto &hashB = cursorB.hash();
+                    if (txHashOrderLess(hashA, hashB)) {
+                        cursorA.next();
+                    } else if (txHashOrderLess(hashB, hashA)) {
+                        cursorB.next();
+                    } else {
+                        // Duplicate hashes are paired up in tx number order
+                        matches.emplace_back(cursorA.txNum(), cursorB.txNum());
+                        cursorA.next();
+                        cursorB.next();
+                    }
+                }
+            }
+        });
+
+        size_t matchCount = 0;
+        for (auto &matches : rangeMatches) {
+            matchCount += matches.size();
+        }
+        std::vector<std::pair<uint32_t, uint32_t>> allMatches;
+        allMatches.reserve(matchCount);
+        for (auto &matches : rangeMatches) {
+            allMatches.insert(allMatches.end(), matches.begin(), matches.end());
+            std::vector<std::pair<uint32_t, uint32_t>>{}.swap(matches);
+        }
+        return allMatches;
+    }
+} // namespace blocksci
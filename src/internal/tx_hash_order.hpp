@@ -0,0 +1,118 @@
+//
+//  tx_hash_order.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_tx_hash_order_hpp
+#define blocksci_tx_hash_order_hpp
+
+#include "file_mapper.hpp"
+
+#include <blocksci/core/bitcoin_uint256.hpp>
+
+#include <range/v3/utility/optional.hpp>
+
+#include <wjfilesystem/path.h>
+
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace blocksci {
+    class ChainAccess;
+
+    /** Order of the tx hashes shared by all chains: by the first 8 bytes of the hash read as a host order integer,
+     * then by the whole hash */
+    inline uint64_t txHashOrderKey(const uint256 &hash) {
+        uint64_t key;
+        std::memcpy(&key, hash.begin(), sizeof(key));
+        return key;
+    }
+
+    inline bool txHashOrderLess(const uint256 &a, const uint256 &b) {
+        auto keyA = txHashOrderKey(a);
+        auto keyB = txHashOrderKey(b);
+        return keyA != keyB ? keyA < keyB : a < b;
+    }
+
+    /** Permutation of the tx numbers [0, txCount()) of a chain that sorts their hashes (@see txHashOrderLess)
+     *
+     * Since every chain sorts its hashes the same way, the transactions two chains have in common, like the shared
+     * history of two forks or replayed transactions, are found by merging their orders in one sequential pass
+     * (@see matchTxHashes) instead of looking up every hash of one chain in the hash index of the other. The order
+     * also finds single hashes by binary search.
+     *
+     * The order is checked against the hash of its last tx, so it is not used after a reorganization removed or
+     * replaced that tx. Transactions added since it was built are sorted in memory when needed.
+     *
+     * File format (all values in host byte order):
+     *     - Header: uint64_t magic, uint32_t txCount, uint32_t reserved, uint256 hash of tx txCount - 1
+     *     - uint32_t txNums[txCount]
+     */
+    class TxHashOrder {
+    public:
+        struct Header {
+            uint64_t magic;
+            uint32_t txCount;
+            uint32_t reserved;
+            uint256 lastTxHash;
+        };
+
+        static constexpr uint64_t Magic = 0x44524f4853485854ULL; // "TXHSHORD"
+
+        explicit TxHashOrder(const filesystem::path &path);
+
+        /** False if the order is missing or malformed, in which case it must not be used */
+        bool isGood() const {
+            return txNums != nullptr;
+        }
+
+        /** Number of transactions covered by the order, these are exactly the tx numbers [0, txCount) */
+        uint32_t txCount() const {
+            return header.txCount;
+        }
+
+        /** Whether the order still describes the first txCount() transactions of the chain */
+        bool matches(const ChainAccess &chain) const;
+
+        const uint32_t *begin() const {
+            return txNums;
+        }
+
+        const uint32_t *end() const {
+            return txNums + header.txCount;
+        }
+
+        /** Tx number of the transaction with the given hash among the ones covered by the order, using a binary search
+         * over the hashes of the chain */
+        ranges::optional<uint32_t> find(const uint256 &hash, const ChainAccess &chain) const;
+
+        /** Write the order of the first txCount transactions of the chain to path, sorting them on threadCount threads
+         * (0 for one per hardware thread), replacing an existing order atomically */
+        static void build(const filesystem::path &path, const ChainAccess &chain, uint32_t txCount, uint32_t threadCount = 0);
+
+    private:
+        SimpleFileMapper<> file;
+        Header header{0, 0, 0, uint256{}};
+        const uint32_t *txNums = nullptr;
+    };
+
+    /** Sort the tx numbers [beginTxNum, endTxNum) of the chain by hash into out, on threadCount threads (0 for one per
+     * hardware thread)
+     *
+     * The transactions are distributed over buckets by the leading bits of their hash, whose sizes are counted first,
+     * and the buckets are sorted independently. */
+    void sortTxNumsByHash(const ChainAccess &chain, uint32_t beginTxNum, uint32_t endTxNum, uint32_t *out, uint32_t threadCount = 0);
+
+    /** Pairs (txNumA, txNumB) of the transactions with the same hash in the loaded chains a and b, in hash order
+     *
+     * Both chains are walked in hash order, each using its TxHashOrder at the given path if it exists and matches the
+     * chain and sorting the remaining transactions in memory. The hash space is split into ranges that are merged on
+     * threadCount threads (0 for one per hardware thread). */
+    std::vector<std::pair<uint32_t, uint32_t>> matchTxHashes(const ChainAccess &a, const filesystem::path &orderPathA, const ChainAccess &b, const filesystem::path &orderPathB, uint32_t threadCount = 0);
+} // namespace blocksci
+
+#endif /* blocksci_tx_hash_order_hpp */
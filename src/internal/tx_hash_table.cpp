@@ -0,0 +1,139 @@
+//
+//  tx_hash_table.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include "tx_hash_table.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace blocksci {
+
+    namespace {
+        constexpr OffsetType headerWords = sizeof(TxHashTable::Header) / sizeof(uint32_t);
+        constexpr OffsetType entryWords = sizeof(TxHashTable::Entry) / sizeof(uint32_t);
+
+        // Keeps the average bucket between 4 and 8 entries, which fits into a single cache line
+        constexpr uint32_t targetBucketSize = 8;
+
+        inline uint32_t bucketOf(const uint256 &hash, uint32_t bucketBits) {
+            uint64_t prefix;
+            std::memcpy(&prefix, hash.begin(), sizeof(prefix));
+            return bucketBits == 0 ? 0 : static_cast<uint32_t>(prefix >> (64 - bucketBits));
+        }
+
+        inline uint32_t fingerprintOf(const uint256 &hash) {
+            uint32_t fingerprint;
+            std::memcpy(&fingerprint, hash.begin() + sizeof(uint64_t), sizeof(fingerprint));
+            return fingerprint;
+        }
+
+        uint32_t calculateBucketBits(uint32_t txCount) {
+            uint32_t bits = 0;
+            while (bits < 31 && (uint64_t{1} << bits) * targetBucketSize < txCount) {
+                bits++;
+            }
+            return bits;
+        }
+
+        inline bool byFingerprint(const TxHashTable::Entry &a, const TxHashTable::Entry &b) {
+            return a.fingerprint < b.fingerprint;
+        }
+    }
+
+    TxHashTable::TxHashTable(const filesystem::path &path) : file(path) {
+        if (!file.isGood() || file.size() < static_cast<OffsetType>(sizeof(Header))) {
+            return;
+        }
+        std::memcpy(&header, file.getDataAtOffset(0), sizeof(Header));
+        auto bucketCount = OffsetType{1} << header.bucketBits;
+        auto expectedSize = static_cast<OffsetType>(sizeof(Header)) + (bucketCount + 1) * static_cast<OffsetType>(sizeof(uint32_t)) + header.txCount * static_cast<OffsetType>(sizeof(Entry));
+        if (header.magic != Magic || header.bucketBits > 31 || file.size() != expectedSize) {
+            header = Header{0, 0, 0};
+            return;
+        }
+        offsets = reinterpret_cast<const uint32_t *>(file.getDataAtOffset(sizeof(Header)));
+        entries = reinterpret_cast<const Entry *>(offsets + bucketCount + 1);
+        // Lookups hit random buckets
+        file.advise(AccessHint::Random);
+    }
+
+    ranges::optional<uint32_t> TxHashTable::find(const uint256 &hash, const TxHashSource &getTxHash) const {
+        if (!isGood()) {
+            return ranges::nullopt;
+        }
+        auto bucket = bucketOf(hash, header.bucketBits);
+        auto fingerprint = fingerprintOf(hash);
+        auto end = entries + offsets[bucket + 1];
+        auto it = std::lower_bound(entries + offsets[bucket], end, Entry{fingerprint, 0}, byFingerprint);
+        for (; it != end && it->fingerprint == fingerprint; ++it) {
+            auto candidate = getTxHash(it->txNum);
+            if (candidate != nullptr && *candidate == hash) {
+                return it->txNum;
+            }
+        }
+        return ranges::nullopt;
+    }
+
+    void TxHashTable::prefetch(const uint256 &hash) const {
+        if (isGood()) {
+            auto bucket = bucketOf(hash, header.bucketBits);
+            __builtin_prefetch(offsets + bucket);
+            __builtin_prefetch(entries + offsets[bucket]);
+        }
+    }
+
+    void TxHashTable::build(const filesystem::path &path, uint32_t txCount, const TxHashSource &getTxHash) {
+        auto bucketBits = calculateBucketBits(txCount);
+        auto bucketCount = OffsetType{1} << bucketBits;
+        auto offsetsBegin = headerWords;
+        auto entriesBegin = offsetsBegin + bucketCount + 1;
+
+        // Written next to the existing table and renamed over it once complete, so readers never see a partial table
+        filesystem::path buildPath{path.str() + "Build"};
+        filesystem::path buildFilePath{buildPath.str() + ".dat"};
+        if (buildFilePath.exists()) {
+            buildFilePath.remove_file();
+        }
+        {
+            FixedSizeFileMapper<uint32_t, mio::access_mode::write> out{buildPath};
+            out.truncate(entriesBegin + txCount * entryWords);
+            uint32_t *offsetsData = out[offsetsBegin];
+            auto entriesData = reinterpret_cast<Entry *>(out[entriesBegin]);
+
+            // Count the entries of every bucket into the slot of the following bucket
+            for (uint32_t txNum = 0; txNum < txCount; txNum++) {
+                offsetsData[bucketOf(*getTxHash(txNum), bucketBits) + 1]++;
+            }
+            // Now offsetsData[i + 1] is the end of bucket i
+            for (OffsetType i = 1; i <= bucketCount; i++) {
+                offsetsData[i] += offsetsData[i - 1];
+            }
+            // Filling every bucket from its end moves offsetsData[i + 1] down to the beginning of bucket i
+            for (uint32_t txNum = 0; txNum < txCount; txNum++) {
+                const auto &hash = *getTxHash(txNum);
+                auto pos = --offsetsData[bucketOf(hash, bucketBits) + 1];
+                entriesData[pos] = Entry{fingerprintOf(hash), txNum};
+            }
+            std::memmove(offsetsData, offsetsData + 1, static_cast<size_t>(bucketCount) * sizeof(uint32_t));
+            offsetsData[bucketCount] = txCount;
+
+            for (OffsetType i = 0; i < bucketCount; i++) {
+                std::sort(entriesData + offsetsData[i], entriesData + offsetsData[i + 1], byFingerprint);
+            }
+
+            Header header{Magic, txCount, bucketBits};
+            std::memcpy(out[0], &header, sizeof(header));
+        }
+
+        filesystem::path filePath{path.str() + ".dat"};
+        if (std::rename(buildFilePath.str().c_str(), filePath.str().c_str()) != 0) {
+            throw std::runtime_error("Could not move tx hash table into place at " + filePath.str());
+        }
+    }
+} // namespace blocksci
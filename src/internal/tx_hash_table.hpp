@@ -0,0 +1,84 @@
+//
+//  tx_hash_table.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef blocksci_index_tx_hash_table_hpp
+#define blocksci_index_tx_hash_table_hpp
+
+#include "file_mapper.hpp"
+
+#include <blocksci/core/bitcoin_uint256.hpp>
+
+#include <range/v3/utility/optional.hpp>
+
+#include <wjfilesystem/path.h>
+
+#include <cstdint>
+#include <functional>
+
+namespace blocksci {
+
+    /** Immutable lookup table from tx hash to tx number for the first txCount() transactions of the chain
+     *
+     * Transactions are distributed over 2^bucketBits buckets by the leading bits of their hash. Every transaction is
+     * stored as an 8 byte entry holding a 32 bit fingerprint of its hash and its tx number, and the entries of a
+     * bucket are sorted by fingerprint. Since the hashes are uniformly distributed, a bucket holds only a handful
+     * of entries, so a lookup reads one bucket offset and one cache line of entries. Matching fingerprints are
+     * verified against the tx hashes of the chain, which means that the table never returns a wrong tx number and
+     * doesn't have to store the hashes themselves.
+     *
+     * File format (all values in host byte order):
+     *     - Header: uint64_t magic, uint32_t txCount, uint32_t bucketBits
+     *     - uint32_t offsets[2^bucketBits + 1]: index of the first entry of every bucket
+     *     - Entry entries[txCount]
+     */
+    class TxHashTable {
+    public:
+        /** Returns a pointer to the hash of the given tx number */
+        using TxHashSource = std::function<const uint256 *(uint32_t)>;
+
+        struct Entry {
+            uint32_t fingerprint;
+            uint32_t txNum;
+        };
+
+        struct Header {
+            uint64_t magic;
+            uint32_t txCount;
+            uint32_t bucketBits;
+        };
+
+        static constexpr uint64_t Magic = 0x4c42544853485854ULL; // "TXHSHTBL"
+
+        explicit TxHashTable(const filesystem::path &path);
+
+        /** False if the table is missing or malformed, in which case it must not be used */
+        bool isGood() const {
+            return offsets != nullptr;
+        }
+
+        /** Number of transactions covered by the table, these are exactly the tx numbers [0, txCount) */
+        uint32_t txCount() const {
+            return header.txCount;
+        }
+
+        ranges::optional<uint32_t> find(const uint256 &hash, const TxHashSource &getTxHash) const;
+
+        /** Hint that the entries of hash will be read soon */
+        void prefetch(const uint256 &hash) const;
+
+        /** Write a table covering the first txCount transactions to path, replacing an existing table atomically */
+        static void build(const filesystem::path &path, uint32_t txCount, const TxHashSource &getTxHash);
+
+    private:
+        SimpleFileMapper<> file;
+        Header header{0, 0, 0};
+        const uint32_t *offsets = nullptr;
+        const Entry *entries = nullptr;
+    };
+} // namespace blocksci
+
+#endif /* blocksci_index_tx_hash_table_hpp */
@@ -0,0 +1,262 @@
+//
+//  address_encoder.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "address_encoder.hpp"
+
+#include <blocksci/core/bitcoin_uint256.hpp>
+
+#include <internal/hash.hpp>
+#include <internal/sha256_kernels.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BLOCKSCI_ADDRESS_ENCODER_X86
+#endif
+
+namespace blocksci {
+
+    namespace {
+        const char *base58Alphabet = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+        const char *bech32Charset = "qpzry9x8gf2tvdw0s3jn54khce6mua7l";
+
+        constexpr size_t base58CheckedSize = base58PayloadSize + 4;
+        constexpr uint32_t base58Pow5 = 656356768; // 58^5
+        constexpr size_t base58LimbCount = 7;
+        // 58^35 > 2^200, enough digits for every 25 byte number
+        constexpr size_t base58DigitCount = 5 * base58LimbCount;
+        constexpr size_t hashBatchSize = 64;
+
+        constexpr size_t maxProgramValues = 52;
+        constexpr size_t checksumLength = 6;
+        constexpr size_t polymodLanes = 8;
+
+        /** Writer of one fixed width string, which drops characters past the width and pads the rest with NUL */
+        class FixedWidthWriter {
+            char *out;
+            size_t width;
+            size_t pos = 0;
+
+        public:
+            FixedWidthWriter(char *out_, size_t width_) : out(out_), width(width_) {}
+
+            void put(char c) {
+                if (pos < width) {
+                    out[pos++] = c;
+                }
+            }
+
+            void finish() {
+                std::fill(out + pos, out + width, '\0');
+            }
+        };
+
+        /** Base58 string of a payload followed by its checksum */
+        void encodeBase58Checked(const unsigned char *data, char *out, size_t width) {
+            // Big endian 32 bit limbs, the first limb only holds the first byte
+            uint32_t limbs[base58LimbCount];
+            limbs[0] = data[0];
+            for (size_t i = 1; i < base58LimbCount; i++) {
+                auto bytes = data + 1 + 4 * (i - 1);
+                limbs[i] = (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) | (static_cast<uint32_t>(bytes[2]) << 8) | bytes[3];
+            }
+
+            uint8_t digits[base58DigitCount];
+            for (size_t chunk = 0; chunk < base58LimbCount; chunk++) {
+                // The remainder is below 2^30 so the current value always fits into 64 bits
+                uint64_t remainder = 0;
+                for (auto &limb : limbs) {
+                    uint64_t current = (remainder << 32) | limb;
+                    limb = static_cast<uint32_t>(current / base58Pow5);
+                    remainder = current % base58Pow5;
+                }
+                auto value = static_cast<uint32_t>(remainder);
+                for (size_t j = 0; j < 5; j++) {
+                    digits[base58DigitCount - 1 - 5 * chunk - j] = static_cast<uint8_t>(value % 58);
+                    value /= 58;
+                }
+            }
+
+            // Like EncodeBase58, every leading zero byte becomes a '1' and leading zero digits are dropped
+            size_t zeroes = 0;
+            while (zeroes < base58CheckedSize && data[zeroes] == 0) {
+                zeroes++;
+            }
+            size_t firstDigit = 0;
+            while (firstDigit < base58DigitCount && digits[firstDigit] == 0) {
+                firstDigit++;
+            }
+            FixedWidthWriter writer{out, width};
+            for (size_t i = 0; i < zeroes; i++) {
+                writer.put('1');
+            }
+            for (size_t i = firstDigit; i < base58DigitCount; i++) {
+                writer.put(base58Alphabet[digits[i]]);
+            }
+            writer.finish();
+        }
+
+        uint32_t polymodStep(uint32_t chk, uint32_t value) {
+            uint32_t top = chk >> 25;
+            return ((chk & 0x1ffffff) << 5) ^ value ^
+                (-((top >> 0) & 1) & 0x3b6a57b2u) ^
+                (-((top >> 1) & 1) & 0x26508e6du) ^
+                (-((top >> 2) & 1) & 0x1ea119fau) ^
+                (-((top >> 3) & 1) & 0x3d4233ddu) ^
+                (-((top >> 4) & 1) & 0x2a1462b3u);
+        }
+
+        /** Constant the checksum is xored with, Bech32 for witness version 0 and Bech32m for all later versions */
+        uint32_t checksumConstant(uint8_t witnessVersion) {
+            return witnessVersion == 0 ? 1 : 0x2bc830a3;
+        }
+        
+        /** Checksum state after the expanded human readable part and the witness version */
+        uint32_t segwitState(const std::string &hrp, uint8_t witnessVersion) {
+            uint32_t chk = 1;
+            for (auto c : hrp) {
+                chk = polymodStep(chk, static_cast<unsigned char>(c) >> 5);
+            }
+            chk = polymodStep(chk, 0);
+            for (auto c : hrp) {
+                chk = polymodStep(chk, static_cast<unsigned char>(c) & 0x1f);
+            }
+            return polymodStep(chk, witnessVersion);
+        }
+
+        size_t programValueCount(size_t programSize) {
+            return (programSize * 8 + 4) / 5;
+        }
+
+        /** Split the program into padded 5 bit values */
+        void toFiveBitValues(const unsigned char *program, size_t programSize, uint8_t *values) {
+            uint32_t acc = 0;
+            int bits = 0;
+            size_t count = 0;
+            for (size_t i = 0; i < programSize; i++) {
+                acc = ((acc << 8) | program[i]) & 0xfff;
+                bits += 8;
+                while (bits >= 5) {
+                    bits -= 5;
+                    values[count++] = static_cast<uint8_t>((acc >> bits) & 31);
+                }
+            }
+            if (bits > 0) {
+                values[count] = static_cast<uint8_t>((acc << (5 - bits)) & 31);
+            }
+        }
+
+        uint32_t finishChecksum(uint32_t chk, uint32_t constant, const uint8_t *values, size_t valueCount) {
+            for (size_t i = 0; i < valueCount; i++) {
+                chk = polymodStep(chk, values[i]);
+            }
+            for (size_t i = 0; i < checksumLength; i++) {
+                chk = polymodStep(chk, 0);
+            }
+            return chk ^ constant;
+        }
+
+#ifdef BLOCKSCI_ADDRESS_ENCODER_X86
+        /** finishChecksum of 8 programs at once, the values of program i start at values + stride * i */
+        __attribute__((target("avx2")))
+        void finishChecksumsx8(uint32_t initial, uint32_t constant, const uint8_t *values, size_t stride, size_t valueCount, uint32_t *checksums) {
+            const __m256i generators[5] = {
+                _mm256_set1_epi32(0x3b6a57b2), _mm256_set1_epi32(0x26508e6d), _mm256_set1_epi32(0x1ea119fa),
+                _mm256_set1_epi32(0x3d4233dd), _mm256_set1_epi32(0x2a1462b3)
+            };
+            const __m256i one = _mm256_set1_epi32(1);
+            const __m256i lowBits = _mm256_set1_epi32(0x1ffffff);
+            __m256i chk = _mm256_set1_epi32(static_cast<int>(initial));
+            for (size_t i = 0; i < valueCount + checksumLength; i++) {
+                __m256i value = _mm256_setzero_si256();
+                if (i < valueCount) {
+                    value = _mm256_set_epi32(values[7 * stride + i], values[6 * stride + i], values[5 * stride + i], values[4 * stride + i],
+                                             values[3 * stride + i], values[2 * stride + i], values[stride + i], values[i]);
+                }
+                __m256i top = _mm256_srli_epi32(chk, 25);
+                chk = _mm256_xor_si256(_mm256_slli_epi32(_mm256_and_si256(chk, lowBits), 5), value);
+                for (int bit = 0; bit < 5; bit++) {
+                    // All ones in the lanes which have the bit set
+                    __m256i mask = _mm256_sub_epi32(_mm256_setzero_si256(), _mm256_and_si256(_mm256_srl_epi32(top, _mm_cvtsi32_si128(bit)), one));
+                    chk = _mm256_xor_si256(chk, _mm256_and_si256(mask, generators[bit]));
+                }
+            }
+            chk = _mm256_xor_si256(chk, _mm256_set1_epi32(static_cast<int>(constant)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(checksums), chk);
+        }
+#endif
+
+        void writeSegwitString(const std::string &hrp, uint8_t witnessVersion, const uint8_t *values, size_t valueCount, uint32_t checksum, char *out, size_t width) {
+            FixedWidthWriter writer{out, width};
+            for (auto c : hrp) {
+                writer.put(c);
+            }
+            writer.put('1');
+            writer.put(bech32Charset[witnessVersion]);
+            for (size_t i = 0; i < valueCount; i++) {
+                writer.put(bech32Charset[values[i]]);
+            }
+            for (size_t i = 0; i < checksumLength; i++) {
+                writer.put(bech32Charset[(checksum >> (5 * (checksumLength - 1 - i))) & 31]);
+            }
+            writer.finish();
+        }
+    } // namespace
+
+    void encodeBase58CheckBatch(const unsigned char *payloads, size_t count, char *out, size_t width) {
+        std::array<HashInput, hashBatchSize> inputs;
+        std::array<uint256, hashBatchSize> hashes;
+        for (size_t start = 0; start < count; start += hashBatchSize) {
+            auto batchCount = std::min(hashBatchSize, count - start);
+            for (size_t i = 0; i < batchCount; i++) {
+                inputs[i] = HashInput{{payloads + base58PayloadSize * (start + i), nullptr, nullptr}, {base58PayloadSize, 0, 0}};
+            }
+            doubleSha256Batch(inputs.data(), batchCount, hashes.data());
+            for (size_t i = 0; i < batchCount; i++) {
+                unsigned char data[base58CheckedSize];
+                std::memcpy(data, payloads + base58PayloadSize * (start + i), base58PayloadSize);
+                std::memcpy(data + base58PayloadSize, &hashes[i], 4);
+                encodeBase58Checked(data, out + width * (start + i), width);
+            }
+        }
+    }
+
+    size_t segwitAddressLength(const std::string &hrp, size_t programSize) {
+        return hrp.size() + 2 + programValueCount(programSize) + checksumLength;
+    }
+
+    void encodeSegwitBatch(const std::string &hrp, uint8_t witnessVersion, const unsigned char *programs, size_t programSize, size_t count, char *out, size_t width) {
+        auto initial = segwitState(hrp, witnessVersion);
+        auto constant = checksumConstant(witnessVersion);
+        auto valueCount = programValueCount(programSize);
+        uint8_t values[polymodLanes][maxProgramValues];
+        uint32_t checksums[polymodLanes];
+        for (size_t start = 0; start < count; start += polymodLanes) {
+            auto laneCount = std::min(polymodLanes, count - start);
+            for (size_t lane = 0; lane < laneCount; lane++) {
+                toFiveBitValues(programs + programSize * (start + lane), programSize, values[lane]);
+            }
+#ifdef BLOCKSCI_ADDRESS_ENCODER_X86
+            if (laneCount == polymodLanes && sha256_kernels::hasAvx2()) {
+                finishChecksumsx8(initial, constant, values[0], maxProgramValues, valueCount, checksums);
+            } else
+#endif
+            {
+                for (size_t lane = 0; lane < laneCount; lane++) {
+                    checksums[lane] = finishChecksum(initial, constant, values[lane], valueCount);
+                }
+            }
+            for (size_t lane = 0; lane < laneCount; lane++) {
+                writeSegwitString(hrp, witnessVersion, values[lane], valueCount, checksums[lane], out + width * (start + lane), width);
+            }
+        }
+    }
+} // namespace blocksci
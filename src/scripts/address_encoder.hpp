@@ -0,0 +1,46 @@
+//
+//  address_encoder.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_address_encoder_hpp
+#define blocksci_address_encoder_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/** Bulk encoders for address strings
+ *
+ * String i is written to out + width * i and padded with NUL bytes up to width, longer strings are truncated. Unlike
+ * EncodeBase58Check and segwit_addr::encode they don't allocate and handle fixed size inputs only.
+ */
+namespace blocksci {
+
+    /** Size of a base58 address payload before the checksum, one version byte followed by a hash160 */
+    constexpr size_t base58PayloadSize = 21;
+
+    /** Maximum length of the base58 string of a payload with its checksum */
+    constexpr size_t base58AddressLength = 34;
+
+    /** Base58Check strings of count payloads of base58PayloadSize bytes each, stored consecutively
+     *
+     * The checksums are computed with doubleSha256Batch. Each payload with its checksum is converted as a 25 byte
+     * number split into 32 bit limbs, dividing all limbs by 58^5 to get five digits at a time rather than running
+     * a division over the whole number for every digit. */
+    void encodeBase58CheckBatch(const unsigned char *payloads, size_t count, char *out, size_t width);
+
+    /** Length of the bech32 string of a witness program of programSize bytes with the human readable part */
+    size_t segwitAddressLength(const std::string &hrp, size_t programSize);
+
+    /** Bech32 strings of count witness programs of programSize (20 or 32) bytes each, stored consecutively
+     *
+     * Version 0 programs get a Bech32 checksum, later versions such as taproot outputs a Bech32m one. The checksum
+     * state of the human readable part and version is computed once, the checksums of 8 programs are then computed
+     * at a time with AVX2 if the CPU supports it. */
+    void encodeSegwitBatch(const std::string &hrp, uint8_t witnessVersion, const unsigned char *programs, size_t programSize, size_t count, char *out, size_t width);
+} // namespace blocksci
+
+#endif /* blocksci_address_encoder_hpp */
@@ -29,10 +29,23 @@ namespace blocksci {
 
 namespace bech32 {
 
-/** Encode a Bech32 string. Returns the empty string in case of failure. */
-std::string encode(const std::string& hrp, const std::vector<uint8_t>& values);
+/** Checksum variant of a string, Bech32 for witness version 0 and Bech32m (BIP 350) for all later versions */
+enum class Encoding {
+    INVALID,
+    BECH32,
+    BECH32M
+};
 
-/** Decode a Bech32 string. Returns (hrp, data). Empty hrp means failure. */
-std::pair<std::string, std::vector<uint8_t> > decode(const std::string& str);
+/** Encode a Bech32 or Bech32m string. Returns the empty string in case of failure. */
+std::string encode(const std::string& hrp, const std::vector<uint8_t>& values, Encoding encoding = Encoding::BECH32);
+
+struct DecodeResult {
+    Encoding encoding;
+    std::string hrp;
+    std::vector<uint8_t> data;
+};
+
+/** Decode a Bech32 or Bech32m string. Encoding::INVALID means failure. */
+DecodeResult decode(const std::string& str);
 
 } // namespace bech32
@@ -3,12 +3,17 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <blocksci/scripts/bitcoin_pubkey.hpp>
+#include <blocksci/core/input_signature.hpp>
 
 #include <internal/hash.hpp>
+#include <internal/segment_work.hpp>
 
 #include <secp256k1_recovery.h>
 #include <secp256k1.h>
 
+#include <algorithm>
+#include <cstring>
+
 namespace {
 /* Global secp256k1_context object used for verification. */
 secp256k1_context* secp256k1_context_verify = nullptr;
@@ -23,17 +28,16 @@ secp256k1_context* secp256k1_context_verify = nullptr;
  *  Bitcoin because since the activation of BIP66, signatures are verified to be
  *  strict DER before being passed to this module, and we know it supports all
  *  violations present in the blockchain before that point.
+ *
+ *  The DER decoding is split into der_lax_parse_compact, which copies R and S
+ *  into the 64 byte compact buffer (and sets overflow if either is longer than
+ *  32 bytes) without needing a context.
  */
 
-static int ecdsa_signature_parse_der_lax(const secp256k1_context* ctx, secp256k1_ecdsa_signature* sig, const unsigned char *input, size_t inputlen) {
+static int der_lax_parse_compact(const unsigned char *input, size_t inputlen, unsigned char *tmpsig, int *overflow) {
     size_t rpos, rlen, spos, slen;
     size_t pos = 0;
     size_t lenbyte;
-    unsigned char tmpsig[64] = {0};
-    int overflow = 0;
-
-    /* Hack to initialize sig with a correctly-parsed but invalid signature. */
-    secp256k1_ecdsa_signature_parse_compact(ctx, sig, tmpsig);
 
     /* Sequence tag byte */
     if (pos == inputlen || input[pos] != 0x30) {
@@ -137,7 +141,7 @@ static int ecdsa_signature_parse_der_lax(const secp256k1_context* ctx, secp256k1
     }
     /* Copy R value */
     if (rlen > 32) {
-        overflow = 1;
+        *overflow = 1;
     } else {
         memcpy(tmpsig + 32 - rlen, input + rpos, rlen);
     }
@@ -149,10 +153,23 @@ static int ecdsa_signature_parse_der_lax(const secp256k1_context* ctx, secp256k1
     }
     /* Copy S value */
     if (slen > 32) {
-        overflow = 1;
+        *overflow = 1;
     } else {
         memcpy(tmpsig + 64 - slen, input + spos, slen);
     }
+    return 1;
+}
+
+static int ecdsa_signature_parse_der_lax(const secp256k1_context* ctx, secp256k1_ecdsa_signature* sig, const unsigned char *input, size_t inputlen) {
+    unsigned char tmpsig[64] = {0};
+    int overflow = 0;
+
+    /* Hack to initialize sig with a correctly-parsed but invalid signature. */
+    secp256k1_ecdsa_signature_parse_compact(ctx, sig, tmpsig);
+
+    if (!der_lax_parse_compact(input, inputlen, tmpsig, &overflow)) {
+        return 0;
+    }
 
     if (!overflow) {
         overflow = !secp256k1_ecdsa_signature_parse_compact(ctx, sig, tmpsig);
@@ -241,6 +258,61 @@ namespace blocksci {
         return (!secp256k1_ecdsa_signature_normalize(secp256k1_context_verify, nullptr, &sig));
     }
     
+    bool parseInputSignature(const unsigned char *data, size_t length, InputSignature &signature) {
+        unsigned char compact[64] = {0};
+        int overflow = 0;
+        if (length >= 9 && length <= CPubKey::SIGNATURE_SIZE + 1 && der_lax_parse_compact(data, length - 1, compact, &overflow) && !overflow) {
+            signature.flags = static_cast<uint8_t>(signature.flags & ~InputSignature::Schnorr);
+            signature.sighash = data[length - 1];
+        } else if (length == 64 || length == 65) {
+            std::memcpy(compact, data, 64);
+            signature.flags |= InputSignature::Schnorr;
+            signature.sighash = length == 65 ? data[64] : 0;
+        } else {
+            return false;
+        }
+        std::copy(compact, compact + 32, signature.r.begin());
+        std::copy(compact + 32, compact + 64, signature.s.begin());
+        signature.flags |= InputSignature::HasSignature;
+        return true;
+    }
+    
+    bool setInputPubkey(const unsigned char *data, size_t length, InputSignature &signature) {
+        if (length == 0 || CPubKey::GetLen(data[0]) != length) {
+            return false;
+        }
+        if (length == CPubKey::COMPRESSED_PUBLIC_KEY_SIZE) {
+            std::copy(data, data + length, signature.pubkey.begin());
+            signature.flags = static_cast<uint8_t>(signature.flags & ~InputSignature::UncompressedPubkey);
+        } else {
+            signature.pubkey[0] = static_cast<unsigned char>(0x02 | (data[64] & 1));
+            std::copy(data + 1, data + 33, signature.pubkey.begin() + 1);
+            signature.flags |= InputSignature::UncompressedPubkey;
+        }
+        signature.flags |= InputSignature::HasPubkey;
+        return true;
+    }
+    
+    std::vector<std::array<unsigned char, 65>> decompressPubkeys(const unsigned char *keys, size_t count, uint32_t threadCount) {
+        std::vector<std::array<unsigned char, 65>> decompressed(count);
+        auto segments = splitSegments(0, static_cast<uint32_t>(count), resolveThreadCount(threadCount));
+        runSegments(segments, [&](uint32_t, uint32_t segmentStart, uint32_t segmentEnd) {
+            // Contexts are not thread safe for all operations, so every thread parses with its own
+            auto context = secp256k1_context_create(SECP256K1_CONTEXT_VERIFY);
+            for (uint32_t i = segmentStart; i < segmentEnd; i++) {
+                auto &out = decompressed[i];
+                out.fill(0);
+                secp256k1_pubkey pubkey;
+                if (secp256k1_ec_pubkey_parse(context, &pubkey, keys + static_cast<size_t>(i) * CPubKey::COMPRESSED_PUBLIC_KEY_SIZE, CPubKey::COMPRESSED_PUBLIC_KEY_SIZE)) {
+                    size_t publen = out.size();
+                    secp256k1_ec_pubkey_serialize(context, out.data(), &publen, &pubkey, SECP256K1_EC_UNCOMPRESSED);
+                }
+            }
+            secp256k1_context_destroy(context);
+        });
+        return decompressed;
+    }
+    
     /* static */ int ECCVerifyHandle::refcount = 0;
     
     ECCVerifyHandle::ECCVerifyHandle()
@@ -53,21 +53,27 @@ bool convertbits(segwit_data& out, const segwit_data& in) {
     return true;
 }
 
+/** Witness version 0 programs use Bech32, all later versions Bech32m */
+bech32::Encoding witness_encoding(int witver) {
+    return witver == 0 ? bech32::Encoding::BECH32 : bech32::Encoding::BECH32M;
+}
+
 } // namespace
 
 namespace segwit_addr {
 
 /** Decode a SegWit address. */
 std::pair<int, segwit_data> decode(const std::string& hrp, const std::string& addr) {
-    std::pair<std::string, segwit_data> dec = bech32::decode(addr);
-    if (dec.first != hrp || dec.second.size() < 1) return std::make_pair(-1, segwit_data());
+    bech32::DecodeResult dec = bech32::decode(addr);
+    if (dec.encoding == bech32::Encoding::INVALID || dec.hrp != hrp || dec.data.size() < 1) return std::make_pair(-1, segwit_data());
     segwit_data conv;
-    if (!convertbits<5, 8, false>(conv, segwit_data(dec.second.begin() + 1, dec.second.end())) ||
-        conv.size() < 2 || conv.size() > 40 || dec.second[0] > 16 || (dec.second[0] == 0 &&
+    if (!convertbits<5, 8, false>(conv, segwit_data(dec.data.begin() + 1, dec.data.end())) ||
+        conv.size() < 2 || conv.size() > 40 || dec.data[0] > 16 || (dec.data[0] == 0 &&
         conv.size() != 20 && conv.size() != 32)) {
         return std::make_pair(-1, segwit_data());
     }
-    return std::make_pair(dec.second[0], conv);
+    if (dec.encoding != witness_encoding(dec.data[0])) return std::make_pair(-1, segwit_data());
+    return std::make_pair(dec.data[0], conv);
 }
 
 /** Encode a SegWit address. */
@@ -75,7 +81,7 @@ std::string encode(const std::string& hrp, int witver, const segwit_data& witpro
     segwit_data enc;
     enc.push_back(static_cast<unsigned char>(witver));
     convertbits<8, 5, true>(enc, witprog);
-    std::string ret = bech32::encode(hrp, enc);
+    std::string ret = bech32::encode(hrp, enc, witness_encoding(witver));
     if (decode(hrp, ret).first == -1) return "";
     return ret;
 }
@@ -84,7 +90,7 @@ std::string encode(const blocksci::ChainConfiguration &config, int witver, const
     segwit_data enc;
     enc.push_back(static_cast<unsigned char>(witver));
     convertbits<8, 5, true>(enc, witprog);
-    std::string ret = bech32::encode(config.segwitPrefix, enc);
+    std::string ret = bech32::encode(config.segwitPrefix, enc, witness_encoding(witver));
     if (decode(config.segwitPrefix, ret).first == -1) return "";
     return ret;
 }
@@ -0,0 +1,258 @@
+//
+//  script_pattern.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include <blocksci/scripts/script_pattern.hpp>
+
+#include <internal/data_access.hpp>
+#include <internal/script_access.hpp>
+#include <internal/script_view.hpp>
+#include <internal/segment_work.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace blocksci {
+
+    namespace {
+        /** Opcode of every name accepted in a pattern */
+        const std::unordered_map<std::string, uint8_t> &opcodeNames() {
+            static const auto names = []() {
+                std::unordered_map<std::string, uint8_t> ret;
+                ret[GetOpName(OP_0)] = OP_0;
+                for (unsigned int opcode = OP_PUSHDATA1; opcode <= MAX_OPCODE; opcode++) {
+                    ret[GetOpName(static_cast<opcodetype>(opcode))] = static_cast<uint8_t>(opcode);
+                }
+                ret[GetOpName(OP_INVALIDOPCODE)] = OP_INVALIDOPCODE;
+                ret["OP_0"] = OP_0;
+                ret["OP_FALSE"] = OP_0;
+                ret["OP_1NEGATE"] = OP_1NEGATE;
+                ret["OP_TRUE"] = OP_1;
+                for (int i = 1; i <= 16; i++) {
+                    ret["OP_" + std::to_string(i)] = static_cast<uint8_t>(CScript::EncodeOP_N(i));
+                }
+                return ret;
+            }();
+            return names;
+        }
+
+        int hexValue(char c) {
+            if (c >= '0' && c <= '9') {
+                return c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                return c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                return c - 'A' + 10;
+            }
+            return -1;
+        }
+
+        std::vector<unsigned char> parseHex(const std::string &hex, const std::string &token) {
+            if (hex.size() % 2 != 0) {
+                throw std::invalid_argument("Odd number of hex digits in pattern token " + token);
+            }
+            std::vector<unsigned char> ret;
+            for (size_t i = 0; i < hex.size(); i += 2) {
+                auto high = hexValue(hex[i]);
+                auto low = hexValue(hex[i + 1]);
+                if (high < 0 || low < 0) {
+                    throw std::invalid_argument("Invalid hex digit in pattern token " + token);
+                }
+                ret.push_back(static_cast<unsigned char>(high * 16 + low));
+            }
+            return ret;
+        }
+
+        uint32_t parseLength(const std::string &number, const std::string &token) {
+            if (number.empty() || !std::all_of(number.begin(), number.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); })) {
+                throw std::invalid_argument("Invalid push length in pattern token " + token);
+            }
+            return static_cast<uint32_t>(std::stoul(number));
+        }
+
+        ScriptPattern::Token parseToken(const std::string &token) {
+            using Kind = ScriptPattern::TokenKind;
+            ScriptPattern::Token ret{Kind::Opcode, 0, 0, 0, {}};
+            if (token == "*") {
+                ret.kind = Kind::AnySequence;
+            } else if (token == "?") {
+                ret.kind = Kind::AnyOp;
+            } else if (token == "PUSH") {
+                ret.kind = Kind::Push;
+                ret.maxLength = std::numeric_limits<uint32_t>::max();
+            } else if (token.compare(0, 5, "PUSH(") == 0 && token.back() == ')') {
+                ret.kind = Kind::Push;
+                auto range = token.substr(5, token.size() - 6);
+                auto dash = range.find('-');
+                if (dash == std::string::npos) {
+                    ret.minLength = parseLength(range, token);
+                    ret.maxLength = ret.minLength;
+                } else {
+                    ret.minLength = parseLength(range.substr(0, dash), token);
+                    ret.maxLength = parseLength(range.substr(dash + 1), token);
+                }
+                if (ret.minLength > ret.maxLength) {
+                    throw std::invalid_argument("Empty push length range in pattern token " + token);
+                }
+            } else if (token.size() >= 2 && token.front() == '<' && token.back() == '>') {
+                ret.kind = Kind::PushData;
+                ret.data = parseHex(token.substr(1, token.size() - 2), token);
+            } else if (token.size() == 4 && token.compare(0, 2, "0x") == 0) {
+                ret.opcode = parseHex(token.substr(2), token)[0];
+            } else {
+                auto &names = opcodeNames();
+                auto it = names.find(token);
+                if (it == names.end()) {
+                    throw std::invalid_argument("Unknown opcode " + token + " in pattern");
+                }
+                ret.opcode = it->second;
+            }
+            return ret;
+        }
+
+        bool tokenMatches(const ScriptPattern::Token &token, opcodetype opcode, const ranges::subrange<const unsigned char *> &data) {
+            using Kind = ScriptPattern::TokenKind;
+            switch (token.kind) {
+                case Kind::Opcode:
+                    return opcode == token.opcode;
+                case Kind::Push:
+                    return opcode <= OP_PUSHDATA4 && data.size() >= token.minLength && data.size() <= token.maxLength;
+                case Kind::PushData:
+                    return opcode <= OP_PUSHDATA4 && data.size() == token.data.size() && std::equal(data.begin(), data.end(), token.data.begin());
+                case Kind::AnyOp:
+                    return true;
+                case Kind::AnySequence:
+                    return false;
+            }
+            return false;
+        }
+
+        bool spendMatches(const ScriptPattern &pattern, const NonstandardSpendScriptData &spend) {
+            return pattern.matches(spend.scriptData.begin(), spend.scriptData.end());
+        }
+
+        bool spendMatches(const ScriptPattern &pattern, const WitnessUnknownSpendScriptData &spend) {
+            // Items of the witness stack are separated by 0xfe, like in getWitnessStack
+            auto itemBegin = spend.scriptData.begin();
+            for (auto it = spend.scriptData.begin();; ++it) {
+                if (it == spend.scriptData.end() || *it == 0xfe) {
+                    if (pattern.matches(itemBegin, it)) {
+                        return true;
+                    }
+                    if (it == spend.scriptData.end()) {
+                        return false;
+                    }
+                    itemBegin = it + 1;
+                }
+            }
+        }
+
+        template <DedupAddressType::Enum type>
+        ScriptPatternMatches findInScripts(const ScriptPattern &pattern, ScriptPatternTarget target, const ScriptAccess &scripts, uint32_t threadCount) {
+            auto segments = splitSegments(1, scripts.scriptCount(type) + 1, resolveThreadCount(threadCount));
+            std::vector<ScriptPatternMatches> segmentMatches(segments.size());
+            runSegments(segments, [&](uint32_t segmentNum, uint32_t segmentStart, uint32_t segmentEnd) {
+                auto &matches = segmentMatches[segmentNum];
+                for (uint32_t scriptNum = segmentStart; scriptNum < segmentEnd; scriptNum++) {
+                    auto data = scripts.getScriptData<type>(scriptNum);
+                    auto header = std::get<0>(data);
+                    auto spend = std::get<1>(data);
+                    if (target == ScriptPatternTarget::Output) {
+                        if (pattern.matches(header->scriptData.begin(), header->scriptData.end())) {
+                            matches.scriptNums.push_back(scriptNum);
+                            matches.txNums.push_back(header->txFirstSeen);
+                        }
+                    } else if (spend != nullptr && spendMatches(pattern, *spend)) {
+                        matches.scriptNums.push_back(scriptNum);
+                        matches.txNums.push_back(header->txFirstSpent);
+                    }
+                }
+            });
+
+            // Segments are consecutive, so concatenating them keeps the matches sorted
+            ScriptPatternMatches ret;
+            for (auto &matches : segmentMatches) {
+                ret.scriptNums.insert(ret.scriptNums.end(), matches.scriptNums.begin(), matches.scriptNums.end());
+                ret.txNums.insert(ret.txNums.end(), matches.txNums.begin(), matches.txNums.end());
+            }
+            return ret;
+        }
+    } // namespace
+
+    ScriptPattern::ScriptPattern(const std::string &pattern) {
+        std::istringstream stream(pattern);
+        std::string token;
+        while (stream >> token) {
+            tokens.push_back(parseToken(token));
+        }
+        if (tokens.size() > maxTokens) {
+            throw std::invalid_argument("Script patterns can have at most " + std::to_string(maxTokens) + " tokens");
+        }
+
+        // Compute the closures backwards since a * token reaches everything reachable from the next state
+        closures.resize(tokens.size() + 1);
+        closures[tokens.size()] = uint64_t{1} << tokens.size();
+        for (size_t i = tokens.size(); i-- > 0;) {
+            closures[i] = uint64_t{1} << i;
+            if (tokens[i].kind == TokenKind::AnySequence) {
+                closures[i] |= closures[i + 1];
+            }
+        }
+    }
+
+    uint64_t ScriptPattern::closure(uint64_t states) const {
+        uint64_t ret = 0;
+        for (size_t i = 0; i < closures.size(); i++) {
+            if (states & (uint64_t{1} << i)) {
+                ret |= closures[i];
+            }
+        }
+        return ret;
+    }
+
+    bool ScriptPattern::matches(const unsigned char *begin, const unsigned char *end) const {
+        CScriptView script{begin, end};
+        uint64_t acceptState = uint64_t{1} << tokens.size();
+        uint64_t states = closures[0];
+        auto pc = script.begin();
+        while (pc != script.end() && states != 0) {
+            opcodetype opcode;
+            ranges::subrange<const unsigned char *> data;
+            if (!script.GetOp(pc, opcode, data)) {
+                return false;
+            }
+            uint64_t next = 0;
+            for (size_t i = 0; i < tokens.size(); i++) {
+                if (!(states & (uint64_t{1} << i))) {
+                    continue;
+                }
+                if (tokens[i].kind == TokenKind::AnySequence) {
+                    next |= uint64_t{1} << i;
+                } else if (tokenMatches(tokens[i], opcode, data)) {
+                    next |= uint64_t{1} << (i + 1);
+                }
+            }
+            states = closure(next);
+        }
+        return (states & acceptState) != 0;
+    }
+
+    ScriptPatternMatches findScriptPattern(const ScriptPattern &pattern, AddressType::Enum type, ScriptPatternTarget target, DataAccess &access, uint32_t threadCount) {
+        auto &scripts = access.getScripts();
+        switch (type) {
+            case AddressType::Enum::NONSTANDARD:
+                return findInScripts<DedupAddressType::NONSTANDARD>(pattern, target, scripts, threadCount);
+            case AddressType::Enum::WITNESS_UNKNOWN:
+                return findInScripts<DedupAddressType::WITNESS_UNKNOWN>(pattern, target, scripts, threadCount);
+            default:
+                throw std::invalid_argument("Script patterns can only be matched against nonstandard and witness unknown scripts");
+        }
+    }
+} // namespace blocksci
@@ -10,6 +10,9 @@
 #include <internal/address_info.hpp>
 #include <internal/data_access.hpp>
 #include <internal/script_access.hpp>
+#include <internal/segment_work.hpp>
+
+#include <algorithm>
 
 namespace {
     template<blocksci::AddressType::Enum type>
@@ -18,6 +21,32 @@ namespace {
             return blocksci::scriptsRange<type>(access);
         }
     };
+    
+    template<blocksci::DedupAddressType::Enum type>
+    struct ScriptHeaderColumnsFunctor {
+        static blocksci::ScriptHeaderColumns f(blocksci::DataAccess &access, uint32_t threadCount) {
+            auto &scripts = access.getScripts();
+            auto count = scripts.scriptCount(type);
+            blocksci::ScriptHeaderColumns columns;
+            // Scripts covered by all header columns are copied from them, only the rest is read from the script file
+            auto firstSeen = scripts.getFirstSeenColumn(type);
+            auto firstSpent = scripts.getFirstSpentColumn(type);
+            auto typesSeen = scripts.getTypesSeenColumn(type);
+            auto covered = std::min({firstSeen.second, firstSpent.second, typesSeen.second});
+            columns.txFirstSeen.assign(firstSeen.first, firstSeen.first + covered);
+            columns.txFirstSpent.assign(firstSpent.first, firstSpent.first + covered);
+            columns.typesSeen.assign(typesSeen.first, typesSeen.first + covered);
+            columns.txFirstSeen.resize(count);
+            columns.txFirstSpent.resize(count);
+            columns.typesSeen.resize(count);
+            scripts.forEachScript<type>(covered + 1, count + 1, threadCount, [&](uint32_t scriptNum, const blocksci::ScriptDataBase &data) {
+                columns.txFirstSeen[scriptNum - 1] = data.txFirstSeen;
+                columns.txFirstSpent[scriptNum - 1] = data.txFirstSpent;
+                columns.typesSeen[scriptNum - 1] = data.typesSeen;
+            });
+            return columns;
+        }
+    };
 }
     
 
@@ -33,5 +62,53 @@ namespace blocksci {
         auto index = static_cast<size_t>(type);
         return table.at(index)(access);
     }
+    
+    ScriptHeaderColumns scriptHeaderColumns(AddressType::Enum type, DataAccess &access, uint32_t threadCount) {
+        static constexpr auto table = make_dynamic_table<DedupAddressType, ScriptHeaderColumnsFunctor>();
+        auto index = static_cast<size_t>(dedupType(type));
+        return table.at(index)(access, threadCount);
+    }
+    
+    MultisigPubkeyColumns multisigPubkeyColumns(DataAccess &access, uint32_t threadCount) {
+        const auto &file = access.getScripts().getFile<DedupAddressType::MULTISIG>();
+        auto count = static_cast<uint32_t>(file.size());
+        auto segments = splitSegments(0, count, resolveThreadCount(threadCount));
+        
+        MultisigPubkeyColumns columns;
+        columns.required.resize(count);
+        columns.total.resize(count);
+        std::vector<size_t> rowOffsets(segments.size() + 1, 0);
+        runSegments(segments, [&](uint32_t segmentNum, uint32_t start, uint32_t end) {
+            size_t rowCount = 0;
+            for (uint32_t i = start; i < end; i++) {
+                auto data = file.getDataAtIndex(i);
+                columns.required[i] = data->m;
+                columns.total[i] = data->n;
+                rowCount += data->addresses.size();
+            }
+            rowOffsets[segmentNum + 1] = rowCount;
+        });
+        for (size_t i = 1; i < rowOffsets.size(); i++) {
+            rowOffsets[i] += rowOffsets[i - 1];
+        }
+        
+        columns.multisigScriptNums.resize(rowOffsets.back());
+        columns.positions.resize(rowOffsets.back());
+        columns.pubkeyScriptNums.resize(rowOffsets.back());
+        runSegments(segments, [&](uint32_t segmentNum, uint32_t start, uint32_t end) {
+            auto row = rowOffsets[segmentNum];
+            for (uint32_t i = start; i < end; i++) {
+                auto data = file.getDataAtIndex(i);
+                uint8_t position = 0;
+                for (auto pubkeyScriptNum : data->addresses) {
+                    columns.multisigScriptNums[row] = i + 1;
+                    columns.positions[row] = position++;
+                    columns.pubkeyScriptNums[row] = pubkeyScriptNum;
+                    row++;
+                }
+            }
+        });
+        return columns;
+    }
    
 } // namespace blocksci
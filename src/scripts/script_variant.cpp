@@ -10,6 +10,7 @@
 #include <blocksci/chain/transaction.hpp>
 #include <blocksci/chain/input.hpp>
 #include <blocksci/chain/output.hpp>
+#include <blocksci/address/address_stats.hpp>
 #include <blocksci/address/equiv_address.hpp>
 
 #include <internal/address_info.hpp>
@@ -47,6 +48,10 @@ namespace blocksci {
 	int64_t AnyScript::calculateBalance(BlockHeight height) const {
 		return mpark::visit([&](auto &scriptAddress) { return scriptAddress.calculateBalance(height); }, wrapped);
 	}
+
+	AddressStats AnyScript::getStats() const {
+		return mpark::visit([&](auto &scriptAddress) { return scriptAddress.getStats(); }, wrapped);
+	}
     
     ranges::any_view<Output> AnyScript::getOutputs() const {
     	return mpark::visit([&](auto &scriptAddress) { return scriptAddress.getOutputs(); }, wrapped);
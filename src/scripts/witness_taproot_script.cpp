@@ -0,0 +1,56 @@
+//
+//  witness_taproot_script.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+//
+
+#include "bitcoin_segwit_addr.hpp"
+
+#include <blocksci/scripts/witness_taproot_script.hpp>
+
+#include <internal/address_info.hpp>
+#include <internal/data_access.hpp>
+#include <internal/script_access.hpp>
+
+#include <sstream>
+
+namespace blocksci {
+    using script::WitnessTaproot;
+    
+    namespace {
+        const char *spendTypeName(TaprootSpendType spendType) {
+            switch (spendType) {
+                case TaprootSpendType::KeyPath:
+                    return "key_path";
+                case TaprootSpendType::ScriptPath:
+                    return "script_path";
+                case TaprootSpendType::Unspent:
+                    break;
+            }
+            return "unspent";
+        }
+    }
+    
+    WitnessTaproot::ScriptAddress(uint32_t addressNum_, DataAccess &access_) : ScriptAddress(addressNum_, access_.getScripts().getScriptData<dedupType(addressType)>(addressNum_), access_) {}
+    
+    std::string WitnessTaproot::addressString() const {
+        std::vector<uint8_t> witprog;
+        auto outputKey = getOutputKey();
+        witprog.insert(witprog.end(), reinterpret_cast<const uint8_t *>(&outputKey), reinterpret_cast<const uint8_t *>(&outputKey) + sizeof(outputKey));
+        return segwit_addr::encode(getAccess().config.chainConfig, 1, witprog);
+    }
+    
+    std::string WitnessTaproot::toString() const {
+        std::stringstream ss;
+        ss << "WitnessTaprootAddress(" << addressString() << ")";
+        return ss.str();
+    }
+    
+    std::string WitnessTaproot::toPrettyString() const {
+        std::stringstream ss;
+        ss << "WitnessTaprootAddress(" << addressString() << ", spend_type=" << spendTypeName(getSpendType()) << ")";
+        return ss.str();
+    }
+} // namespace blocksci
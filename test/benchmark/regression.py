@@ -0,0 +1,284 @@
+#!/usr/bin/env python3
+"""Performance regression tracking for the Python and C++ benchmarks
+
+Runs the pytest benchmarks of this directory and optionally the C++ suite (blocksci_benchmark) against one or more
+chains, stores the raw timings under <results>/<commit>/ and compares them with the results of an earlier commit.
+A benchmark regresses when its median got slower by more than the threshold and a Mann-Whitney U test on the raw
+timings of both commits is significant, so noisy benchmarks don't raise false alarms. The worst regressions can be
+profiled with perf, producing flame graphs if the FlameGraph scripts are on the PATH.
+
+Examples:
+    ./regression.py run --chain btc --chain /data/blocksci/config.json --cpp ../../build/benchmark/blocksci_benchmark
+    ./regression.py run --synthetic 100000 --synthetic 1000000
+    ./regression.py compare --profile 3
+"""
+
+import argparse
+import json
+import math
+import os
+import shutil
+import subprocess
+import sys
+
+SELF_DIR = os.path.dirname(os.path.realpath(__file__))
+PYTHON_SUITES = [
+    "test_proxy_interface.py",
+    "test_compute_fee.py",
+    "test_misc_queries.py",
+    "test_chain_size_impact.py",
+]
+
+
+def git(*args):
+    return subprocess.run(["git"] + list(args), cwd=SELF_DIR, check=True, stdout=subprocess.PIPE, universal_newlines=True).stdout.strip()
+
+
+def current_commit():
+    commit = git("rev-parse", "HEAD")
+    if git("status", "--porcelain", "--untracked-files=no"):
+        commit += "-dirty"
+    return commit
+
+
+def chain_label(chain):
+    if chain == "btc":
+        return "btc"
+    return os.path.basename(os.path.dirname(os.path.abspath(chain))) or "local"
+
+
+def synthetic_chain(results_dir, tx_count):
+    """Config of a synthetic chain with tx_count transactions, generated and parsed once per results directory"""
+    chain_dir = os.path.join(results_dir, "chains", "synthetic-{}".format(tx_count))
+    config = os.path.join(chain_dir, "config.json")
+    done_marker = os.path.join(chain_dir, "parsed")
+    if not os.path.exists(done_marker):
+        shutil.rmtree(chain_dir, ignore_errors=True)
+        os.makedirs(chain_dir)
+        subprocess.run(["blocksci_parser", config, "synthesize-chain", os.path.join(chain_dir, "coin"), os.path.join(chain_dir, "data"), "--txes", str(tx_count)], check=True)
+        subprocess.run(["blocksci_parser", config, "update"], check=True)
+        open(done_marker, "w").close()
+    return config
+
+
+def run_python(chain, output):
+    chain_option = "--btc" if chain == "btc" else "--local={}".format(os.path.abspath(chain))
+    cmd = [sys.executable, "-m", "pytest"] + PYTHON_SUITES + [
+        chain_option,
+        "--benchmark-only",
+        "--benchmark-warmup=true",
+        "--benchmark-warmup-iterations=1",
+        "--benchmark-min-rounds=10",
+        "--benchmark-save-data",
+        "--benchmark-json={}".format(output),
+    ]
+    subprocess.run(cmd, cwd=SELF_DIR, check=True)
+
+
+def run_cpp(binary, chain, output, repetitions):
+    if chain == "btc":
+        raise ValueError("The C++ suite needs a parsed chain, pass its config or use --synthetic")
+    cmd = [binary, os.path.abspath(chain), "-i", str(repetitions),
+           "--benchmark_repetitions={}".format(repetitions),
+           "--benchmark_out={}".format(output),
+           "--benchmark_out_format=json"]
+    subprocess.run(cmd, check=True)
+
+
+def load_samples(path):
+    """Raw timings in seconds by benchmark name, from pytest-benchmark or Google Benchmark JSON"""
+    with open(path) as f:
+        data = json.load(f)
+    samples = {}
+    if "context" in data:
+        units = {"ns": 1e-9, "us": 1e-6, "ms": 1e-3, "s": 1.0}
+        for bench in data.get("benchmarks", []):
+            if bench.get("run_type", "iteration") != "iteration":
+                continue
+            name = bench.get("run_name", bench["name"])
+            samples.setdefault(name, []).append(bench["real_time"] * units[bench.get("time_unit", "ns")])
+    else:
+        for bench in data.get("benchmarks", []):
+            stats = bench["stats"]
+            samples[bench["fullname"]] = stats.get("data") or [stats["median"]]
+    return samples
+
+
+def median(values):
+    ordered = sorted(values)
+    middle = len(ordered) // 2
+    if len(ordered) % 2:
+        return ordered[middle]
+    return (ordered[middle - 1] + ordered[middle]) / 2
+
+
+def mann_whitney_p(a, b):
+    """Two-sided p-value of the Mann-Whitney U test with the normal approximation and tie correction"""
+    n1, n2 = len(a), len(b)
+    if n1 < 2 or n2 < 2:
+        return 1.0
+    combined = sorted([(value, 0) for value in a] + [(value, 1) for value in b])
+    ranks = [0.0] * len(combined)
+    tie_term = 0.0
+    i = 0
+    while i < len(combined):
+        j = i
+        while j + 1 < len(combined) and combined[j + 1][0] == combined[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = (i + j) / 2 + 1
+        ties = j - i + 1
+        tie_term += ties ** 3 - ties
+        i = j + 1
+    rank_sum = sum(rank for rank, (_, group) in zip(ranks, combined) if group == 0)
+    u = rank_sum - n1 * (n1 + 1) / 2
+    n = n1 + n2
+    variance = n1 * n2 / 12 * ((n + 1) - tie_term / (n * (n - 1)))
+    if variance <= 0:
+        return 1.0
+    z = (abs(u - n1 * n2 / 2) - 0.5) / math.sqrt(variance)
+    return math.erfc(max(z, 0) / math.sqrt(2))
+
+
+def stored_commits(results_dir):
+    if not os.path.isdir(results_dir):
+        return set()
+    return {name for name in os.listdir(results_dir) if os.path.isfile(os.path.join(results_dir, name, "meta.json"))}
+
+
+def previous_commit(results_dir, head):
+    """Most recent ancestor of head with stored results"""
+    stored = stored_commits(results_dir)
+    for commit in git("rev-list", "--max-count=1000", head.replace("-dirty", "")).split():
+        if commit != head and commit in stored:
+            return commit
+    return None
+
+
+def compare(results_dir, base, head, threshold, alpha):
+    regressions = []
+    improvements = []
+    base_dir = os.path.join(results_dir, base)
+    head_dir = os.path.join(results_dir, head)
+    for result_file in sorted(os.listdir(head_dir)):
+        if not result_file.endswith(".json") or result_file == "meta.json" or not os.path.exists(os.path.join(base_dir, result_file)):
+            continue
+        base_samples = load_samples(os.path.join(base_dir, result_file))
+        head_samples = load_samples(os.path.join(head_dir, result_file))
+        for name, head_values in sorted(head_samples.items()):
+            base_values = base_samples.get(name)
+            if not base_values:
+                continue
+            change = median(head_values) / median(base_values) - 1
+            p = mann_whitney_p(base_values, head_values)
+            entry = {"file": result_file, "name": name, "change": change, "p": p,
+                     "base_median": median(base_values), "head_median": median(head_values)}
+            if p < alpha and change > threshold:
+                regressions.append(entry)
+            elif p < alpha and change < -threshold:
+                improvements.append(entry)
+    regressions.sort(key=lambda entry: -entry["change"])
+    improvements.sort(key=lambda entry: entry["change"])
+    return regressions, improvements
+
+
+def profile(entry, meta, profile_dir):
+    """Record the benchmark with perf and render a flame graph, or the raw perf script output without FlameGraph"""
+    if shutil.which("perf") is None:
+        print("perf not found, skipping the profile of {}".format(entry["name"]))
+        return
+    os.makedirs(profile_dir, exist_ok=True)
+    safe_name = "".join(c if c.isalnum() else "_" for c in entry["file"] + "_" + entry["name"])[:150]
+    perf_data = os.path.join(profile_dir, safe_name + ".perf.data")
+    chain = meta["chains"][entry["file"].split("-", 1)[1][:-len(".json")]]
+    if entry["file"].startswith("cpp-"):
+        cmd = [meta["cpp"], os.path.abspath(chain), "--benchmark_filter=^{}".format(entry["name"])]
+        cwd = None
+    else:
+        chain_option = "--btc" if chain == "btc" else "--local={}".format(os.path.abspath(chain))
+        cmd = [sys.executable, "-X", "perf", "-m", "pytest", entry["name"], chain_option, "--benchmark-only"]
+        cwd = SELF_DIR
+    env = dict(os.environ, PYTHONPERFSUPPORT="1")
+    subprocess.run(["perf", "record", "-F", "999", "-g", "-o", perf_data, "--"] + cmd, cwd=cwd, env=env, check=False)
+    script = subprocess.run(["perf", "script", "-i", perf_data], stdout=subprocess.PIPE, universal_newlines=True, check=False).stdout
+    if shutil.which("stackcollapse-perf.pl") and shutil.which("flamegraph.pl"):
+        collapsed = subprocess.run(["stackcollapse-perf.pl"], input=script, stdout=subprocess.PIPE, universal_newlines=True, check=True).stdout
+        svg = subprocess.run(["flamegraph.pl", "--title", entry["name"]], input=collapsed, stdout=subprocess.PIPE, universal_newlines=True, check=True).stdout
+        output = os.path.join(profile_dir, safe_name + ".svg")
+        with open(output, "w") as f:
+            f.write(svg)
+    else:
+        output = os.path.join(profile_dir, safe_name + ".perf.txt")
+        with open(output, "w") as f:
+            f.write(script)
+    print("Profile of {}: {}".format(entry["name"], output))
+
+
+def command_run(args):
+    commit = current_commit()
+    commit_dir = os.path.join(args.results, commit)
+    os.makedirs(commit_dir, exist_ok=True)
+    chains = list(args.chain) + [synthetic_chain(args.results, tx_count) for tx_count in args.synthetic]
+    if not chains:
+        chains = ["btc"]
+    meta = {"commit": commit, "chains": {}, "cpp": os.path.abspath(args.cpp) if args.cpp else None}
+    for chain in chains:
+        label = chain_label(chain)
+        meta["chains"][label] = chain
+        if not args.skip_python:
+            run_python(chain, os.path.join(commit_dir, "python-{}.json".format(label)))
+        if args.cpp and chain != "btc":
+            run_cpp(args.cpp, chain, os.path.join(commit_dir, "cpp-{}.json".format(label)), args.repetitions)
+    with open(os.path.join(commit_dir, "meta.json"), "w") as f:
+        json.dump(meta, f, indent=4)
+    print("Stored results for {} in {}".format(commit, commit_dir))
+
+
+def command_compare(args):
+    head = args.head or current_commit()
+    base = args.base or previous_commit(args.results, head)
+    if base is None:
+        print("No results of an earlier commit to compare {} with".format(head))
+        return 0
+    regressions, improvements = compare(args.results, base, head, args.threshold, args.alpha)
+    print("Comparing {} against {}".format(head, base))
+    for title, entries in (("Regressions", regressions), ("Improvements", improvements)):
+        print("\n{} ({}):".format(title, len(entries)))
+        for entry in entries:
+            print("  {:+7.1%}  p={:.4f}  {:.6f}s -> {:.6f}s  {} {}".format(entry["change"], entry["p"], entry["base_median"], entry["head_median"], entry["file"], entry["name"]))
+    if args.profile and regressions:
+        with open(os.path.join(args.results, head, "meta.json")) as f:
+            meta = json.load(f)
+        for entry in regressions[:args.profile]:
+            profile(entry, meta, os.path.join(args.results, head, "profiles"))
+    return 1 if regressions else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Track performance regressions of the BlockSci benchmarks across commits")
+    parser.add_argument("--results", default=os.path.join(SELF_DIR, ".regression"), help="Directory the results are stored in, keyed by commit")
+    commands = parser.add_subparsers(dest="command")
+    commands.required = True
+
+    run = commands.add_parser("run", help="Run the benchmarks and store the results of the current commit")
+    run.add_argument("--chain", action="append", default=[], help="btc for the synthetic regtest chain or the path of a BlockSci config, can be repeated to cover several chain sizes")
+    run.add_argument("--synthetic", action="append", type=int, default=[], help="Also run against a chain with this many synthetic transactions (blocksci_parser synthesize-chain), can be repeated")
+    run.add_argument("--cpp", help="Path of blocksci_benchmark to also run the C++ suite")
+    run.add_argument("--repetitions", type=int, default=5, help="Repetitions of every C++ benchmark (default 5)")
+    run.add_argument("--skip-python", action="store_true", help="Only run the C++ suite")
+    run.set_defaults(func=command_run)
+
+    comp = commands.add_parser("compare", help="Flag significant slowdowns of the current commit, exits with 1 if there are any")
+    comp.add_argument("--base", help="Commit to compare against (default: the most recent ancestor with results)")
+    comp.add_argument("--head", help="Commit to check (default: the current commit)")
+    comp.add_argument("--threshold", type=float, default=0.05, help="Minimum slowdown of the median (default 0.05)")
+    comp.add_argument("--alpha", type=float, default=0.01, help="Significance level of the Mann-Whitney U test (default 0.01)")
+    comp.add_argument("--profile", type=int, default=0, metavar="N", help="Profile the N worst regressions with perf")
+    comp.set_defaults(func=command_compare)
+
+    args = parser.parse_args()
+    sys.exit(args.func(args) or 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,120 @@
+//
+//  main.cpp
+//
+//  blocksci_archive
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include <internal/data_configuration.hpp>
+#include <internal/remote_data.hpp>
+#include <internal/snapshot_archive.hpp>
+
+#include <clipp.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace blocksci;
+
+namespace {
+    double gigabytes(uint64_t bytes) {
+        return static_cast<double>(bytes) / (1024.0 * 1024.0 * 1024.0);
+    }
+
+    int createArchiveSnapshot(const std::string &configLocation, const std::string &archiveLocation, const std::string &name, const std::string &clusterLocation, uint32_t chunkMB, SnapshotOptions options) {
+        auto config = loadBlockchainConfig(configLocation, false, 0);
+        // A snapshot taken while the parser appends would fail or mix two states of the chain
+        if (config.pidFilePath().exists()) {
+            std::cout << "A PID file exists in the data directory, a parser might be running. Aborting." << std::endl;
+            return 1;
+        }
+        options.chunkSize = chunkMB << 20;
+        if (!clusterLocation.empty()) {
+            options.extraDirectories.emplace_back("clusters/", filesystem::path{clusterLocation});
+        }
+        auto start = std::chrono::steady_clock::now();
+        auto stats = createSnapshot(config.chainConfig.dataDirectory, filesystem::path{archiveLocation}, name, options);
+        auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << "Snapshot " << name << ": " << stats.fileCount << " files, " << gigabytes(stats.totalBytes) << " GB in " << stats.chunkCount << " chunks\n";
+        std::cout << "Added " << stats.newChunkCount << " new chunks, " << gigabytes(stats.newStoredBytes) << " GB compressed, in " << seconds << "s" << std::endl;
+        return 0;
+    }
+
+    void listArchiveSnapshots(const std::string &archiveLocation) {
+        std::cout << std::fixed << std::setprecision(2);
+        for (auto &name : SnapshotArchive::snapshotNames(filesystem::path{archiveLocation})) {
+            SnapshotArchive archive{filesystem::path{archiveLocation}, name};
+            uint64_t totalBytes = 0;
+            for (auto &file : archive.getFiles()) {
+                totalBytes += static_cast<uint64_t>(file.second.size);
+            }
+            std::cout << name << "  " << archive.getFiles().size() << " files  " << gigabytes(totalBytes) << " GB\n";
+        }
+    }
+}
+
+int main(int argc, char * argv[]) {
+    enum class mode {create, list, extract};
+    mode selected = mode::list;
+    std::string configLocation;
+    std::string archiveLocation;
+    std::string name;
+    std::string clusterLocation;
+    std::string targetLocation;
+    std::vector<std::string> prefixes;
+    uint32_t chunkMB = SnapshotOptions{}.chunkSize >> 20;
+    uint32_t readers = 8;
+    SnapshotOptions options;
+
+    auto createCli = (
+        clipp::command("create").set(selected, mode::create) % "Add a snapshot of the data directory to an archive, storing only the chunks the archive doesn't have yet",
+        clipp::value("config file location", configLocation),
+        clipp::value("archive location", archiveLocation),
+        clipp::value("snapshot name", name),
+        (clipp::option("--parent") & clipp::value("snapshot", options.parent)) % "Earlier snapshot whose chunks are reused for unchanged files instead of reading them again",
+        (clipp::option("--clusters") & clipp::value("cluster location", clusterLocation)) % "Also archive this clustering under clusters/",
+        (clipp::option("--chunk-mb") & clipp::value("MB", chunkMB)) % "Uncompressed size of the chunks, a power of two",
+        (clipp::option("--level") & clipp::value("level", options.compressionLevel)) % "zstd compression level",
+        (clipp::option("--threads", "-j") & clipp::value("thread count", options.threadCount)) % "Number of threads compressing chunks, defaults to one per hardware thread"
+    );
+    auto listCli = (
+        clipp::command("list").set(selected, mode::list) % "List the snapshots of an archive",
+        clipp::value("archive location", archiveLocation)
+    );
+    auto extractCli = (
+        clipp::command("extract").set(selected, mode::extract) % "Extract a snapshot into a data directory, only copying the files that differ from it",
+        clipp::value("archive location", archiveLocation),
+        clipp::value("snapshot name", name),
+        clipp::value("target location", targetLocation),
+        (clipp::option("--only") & clipp::values("prefix", prefixes)) % "Only extract the files whose paths start with one of the prefixes, eg. chain/ or clusters/",
+        (clipp::option("--threads", "-j") & clipp::value("thread count", readers)) % "Number of chunks read in parallel"
+    );
+    auto cli = (createCli | listCli | extractCli);
+
+    auto res = parse(argc, argv, cli);
+    if (res.any_error() || (selected == mode::create && chunkMB == 0)) {
+        std::cout << "Invalid command line parameter\n" << clipp::make_man_page(cli, argv[0]);
+        return 0;
+    }
+
+    switch (selected) {
+        case mode::create:
+            return createArchiveSnapshot(configLocation, archiveLocation, name, clusterLocation, chunkMB, options);
+        case mode::list:
+            listArchiveSnapshots(archiveLocation);
+            break;
+        case mode::extract: {
+            SnapshotArchive archive{filesystem::path{archiveLocation}, name, readers};
+            if (prefixes.empty()) {
+                prefixes.push_back("");
+            }
+            hydrateDataDirectory(filesystem::path{targetLocation}, archive, prefixes, false);
+            break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+//
+//  main.cpp
+//
+//  blocksci_warm_cache
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include <internal/data_configuration.hpp>
+#include <internal/page_cache.hpp>
+
+#include <clipp.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+using namespace blocksci;
+
+/**
+ Print the page cache residency of the files and return the total number of resident bytes.
+ */
+uint64_t printResidency(const std::vector<filesystem::path> &files, uint64_t &totalSize) {
+    uint64_t totalResident = 0;
+    for (auto &file : files) {
+        auto residency = fileResidency(file);
+        totalSize += residency.size;
+        totalResident += residency.residentBytes;
+        std::cout << std::setw(7) << std::fixed << std::setprecision(2) << residency.residentFraction() * 100 << "%  "
+        << std::setw(16) << residency.size << "  " << residency.path << "\n";
+    }
+    return totalResident;
+}
+
+void printReport(const std::vector<std::vector<filesystem::path>> &tiers) {
+    uint64_t totalSize = 0;
+    uint64_t totalResident = 0;
+    for (size_t i = 0; i < tiers.size(); i++) {
+        std::cout << "Tier " << i << ":\n";
+        totalResident += printResidency(tiers[i], totalSize);
+    }
+    auto fraction = totalSize > 0 ? static_cast<double>(totalResident) / static_cast<double>(totalSize) : 1.0;
+    std::cout << "Total: " << totalResident << " of " << totalSize << " bytes resident (" << std::fixed << std::setprecision(2) << fraction * 100 << "%)" << std::endl;
+}
+
+int main(int argc, char * argv[]) {
+    std::string configLocation;
+    bool reportOnly = false;
+    unsigned int threadCount = std::thread::hardware_concurrency();
+    int maxTier = -1;
+
+    auto cli = (
+        clipp::value("config file location", configLocation) % "Path to config file",
+        clipp::option("--report", "-r").set(reportOnly).doc("Only report page cache residency, don't read any data"),
+        (clipp::option("--threads", "-j") & clipp::value("thread count", threadCount)) % "Number of parallel readers (default: number of cores)",
+        (clipp::option("--max-tier", "-m") & clipp::value("tier", maxTier)) % "Only warm up files up to this tier (0: block and tx index, 1: tx data, 2: other chain files, 3: scripts, 4: indexes)"
+    );
+
+    auto res = parse(argc, argv, cli);
+    if (res.any_error()) {
+        std::cout << "Invalid command line parameter\n" << clipp::make_man_page(cli, argv[0]);
+        return 0;
+    }
+
+    auto config = loadBlockchainConfig(configLocation, false, 0);
+    auto tiers = dataFilesByPriority(config);
+
+    std::cout << "Page cache residency:" << std::endl;
+    printReport(tiers);
+
+    if (reportOnly) {
+        return 0;
+    }
+
+    std::cout << std::endl;
+    for (size_t i = 0; i < tiers.size(); i++) {
+        if (maxTier >= 0 && static_cast<int>(i) > maxTier) {
+            break;
+        }
+        auto start = std::chrono::steady_clock::now();
+        warmPageCache(tiers[i], threadCount);
+        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        std::cout << "Warmed up tier " << i << " in " << duration.count() << "ms" << std::endl;
+    }
+
+    std::cout << std::endl << "Page cache residency after warmup:" << std::endl;
+    printReport(tiers);
+    return 0;
+}
@@ -7,30 +7,269 @@
 //
 
 #include <blocksci/chain/blockchain.hpp>
+#include <blocksci/cluster/cluster_export.hpp>
 #include <blocksci/cluster/cluster_manager.hpp>
+#include <blocksci/cluster/clustering_rules.hpp>
+#include <blocksci/cluster/external_clustering.hpp>
+#include <blocksci/core/tracing.hpp>
 #include <blocksci/heuristics/change_address.hpp>
 
 #include <clipp.h>
+#include <nlohmann/json.hpp>
 
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace {
+    std::map<std::string, blocksci::heuristics::ChangeHeuristic> changeHeuristics() {
+        using namespace blocksci::heuristics;
+        return {
+            {"none", NoChange{}},
+            {"peeling-chain", PeelingChainChange{}},
+            {"power-of-ten", PowerOfTenChange{}},
+            {"optimal-change", OptimalChangeChange{}},
+            {"address-type", AddressTypeChange{}},
+            {"locktime", LocktimeChange{}},
+            {"address-reuse", AddressReuseChange{}},
+            {"client-behavior", ClientChangeAddressBehaviorChange{}},
+            {"legacy", LegacyChange{}},
+            {"fixed-fee", FixedFee{}},
+            {"spent", Spent{}}
+        };
+    }
+    
+    /** Trace sink adding up the time spent in every phase of the clustering, the phases run one after the other */
+    class PhaseTimer : public blocksci::TraceSink {
+        std::mutex mutex;
+        std::array<std::chrono::steady_clock::time_point, blocksci::clusteringPhaseCount> starts;
+        std::array<double, blocksci::clusteringPhaseCount> seconds{};
+        
+    public:
+        uint64_t beginSpan(blocksci::TraceOperation operation, uint64_t argument) override {
+            if (operation == blocksci::TraceOperation::ClusteringPhase && argument < blocksci::clusteringPhaseCount) {
+                std::lock_guard<std::mutex> lock(mutex);
+                starts[argument] = std::chrono::steady_clock::now();
+            }
+            return argument;
+        }
+        
+        void endSpan(uint64_t span, blocksci::TraceOperation operation) override {
+            if (operation == blocksci::TraceOperation::ClusteringPhase && span < blocksci::clusteringPhaseCount) {
+                std::lock_guard<std::mutex> lock(mutex);
+                seconds[span] += std::chrono::duration<double>(std::chrono::steady_clock::now() - starts[span]).count();
+            }
+        }
+        
+        std::array<double, blocksci::clusteringPhaseCount> phaseSeconds() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return seconds;
+        }
+    };
+    
+    /** Restart the peak resident set size of the process, so that every run of a sweep reports its own peak */
+    void resetPeakResidentSize() {
+        // Writing 5 to clear_refs resets VmHWM since Linux 4.0, ignored elsewhere
+        std::ofstream clearRefs("/proc/self/clear_refs");
+        clearRefs << "5";
+    }
+    
+    /** Peak resident set size in bytes since the last resetPeakResidentSize */
+    uint64_t peakResidentSize() {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.compare(0, 6, "VmHWM:") == 0) {
+                return std::stoull(line.substr(6)) * 1024;
+            }
+        }
+        // Without procfs fall back to the peak of the whole process
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+        return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+        return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+    }
+    
+    struct ClusteringRun {
+        uint32_t threadCount;
+        double totalSeconds;
+        std::array<double, blocksci::clusteringPhaseCount> phaseSeconds;
+        uint64_t peakResidentBytes;
+    };
+    
+    /** Comma separated list of thread counts, eg. "1,2,4,8" */
+    std::vector<uint32_t> parseThreadCounts(const std::string &list) {
+        std::vector<uint32_t> counts;
+        std::stringstream ss(list);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            counts.push_back(static_cast<uint32_t>(std::stoul(item)));
+        }
+        if (counts.empty()) {
+            counts.push_back(0);
+        }
+        return counts;
+    }
+    
+    void printRun(const ClusteringRun &run) {
+        std::cout << "\nClustering with " << run.threadCount << " threads took " << std::fixed << std::setprecision(2) << run.totalSeconds << "s, peak RSS " << run.peakResidentBytes / (1024 * 1024) << " MB\n";
+        for (size_t i = 0; i < blocksci::clusteringPhaseCount; i++) {
+            std::cout << "  " << std::left << std::setw(24) << blocksci::clusteringPhaseName(static_cast<blocksci::ClusteringPhase>(i)) << std::right << std::setw(10) << run.phaseSeconds[i] << "s\n";
+        }
+    }
+    
+    /** Scaling curve of a thread sweep, speedup and efficiency are relative to the first run */
+    void printScaling(const std::vector<ClusteringRun> &runs) {
+        std::cout << "\n" << std::setw(8) << "threads" << std::setw(12) << "seconds" << std::setw(10) << "speedup" << std::setw(12) << "efficiency" << std::setw(14) << "peak RSS MB" << "\n";
+        for (auto &run : runs) {
+            auto speedup = runs.front().totalSeconds / run.totalSeconds;
+            auto efficiency = speedup * runs.front().threadCount / run.threadCount;
+            std::cout << std::setw(8) << run.threadCount << std::setw(12) << run.totalSeconds << std::setw(10) << speedup << std::setw(12) << efficiency << std::setw(14) << run.peakResidentBytes / (1024 * 1024) << "\n";
+        }
+    }
+    
+    void writeReport(const std::string &path, const std::vector<ClusteringRun> &runs) {
+        auto report = nlohmann::json::array();
+        for (auto &run : runs) {
+            nlohmann::json phases;
+            for (size_t i = 0; i < blocksci::clusteringPhaseCount; i++) {
+                phases[blocksci::clusteringPhaseName(static_cast<blocksci::ClusteringPhase>(i))] = run.phaseSeconds[i];
+            }
+            report.push_back({{"threads", run.threadCount}, {"total_seconds", run.totalSeconds}, {"phase_seconds", phases}, {"peak_rss_bytes", run.peakResidentBytes}});
+        }
+        std::ofstream file(path);
+        file << report.dump(4) << "\n";
+    }
+}
 
 int main(int argc, char * argv[]) {
     std::string configLocation;
     std::string outputLocation;
-    bool overwrite;
-    auto cli = (
+    bool overwrite = false;
+    bool update = false;
+    std::string changeName = "none";
+    std::string threadList = "0";
+    std::string reportLocation;
+    bool keepCoinJoin = false;
+    bool noLinkInputs = false;
+    bool noLinkScripthash = false;
+    blocksci::ClusteringRules rules;
+    bool exportMode = false;
+    std::string exportLocation;
+    std::string exportFormat = "parquet";
+    blocksci::ClusterExportOptions exportOptions;
+    bool externalMode = false;
+    uint32_t refineRounds = 0;
+    blocksci::ExternalClusteringOptions externalOptions;
+    auto clusterCli = (
                 clipp::value("config file location", configLocation),
                 clipp::value("output location", outputLocation),
-                clipp::option("--overwrite").set(overwrite).doc("Overwrite existing cluster files if they exist")
+                clipp::option("--overwrite").set(overwrite).doc("Overwrite existing cluster files if they exist"),
+                clipp::option("--update").set(update).doc("Extend the existing clustering in the output location with the blocks added since it was created, the rules must match the ones it was created with"),
+                (clipp::option("--change") & clipp::value("heuristic", changeName)) % "Change heuristic to link with the inputs: none, peeling-chain, power-of-ten, optimal-change, address-type, locktime, address-reuse, client-behavior, legacy, fixed-fee or spent",
+                (clipp::option("--threads") & clipp::value("counts", threadList)) % "Number of threads, defaults to one per hardware thread. A comma separated list such as 1,2,4,8 clusters once per count and prints the scaling curve",
+                (clipp::option("--report") & clipp::value("file", reportLocation)) % "Write the phase timings and peak RSS of every run as JSON",
+                (clipp::option("--external-memory").set(externalMode) & clipp::value("bytes", externalOptions.memoryBudget)) % "Cluster out of core, keeping the address arrays in temporary files and buffering at most this many bytes of links and addresses in memory",
+                (clipp::option("--temp-dir") & clipp::value("directory", externalOptions.tempDirectory)) % "Directory for the temporary files of --external-memory, defaults to one in the output location",
+                clipp::option("--keep-coinjoin").set(keepCoinJoin).doc("Don't skip transactions detected as CoinJoins"),
+                clipp::option("--skip-possible-coinjoin").set(rules.skipPossibleCoinJoin).doc("Skip transactions that could be JoinMarket CoinJoins"),
+                clipp::option("--no-link-inputs").set(noLinkInputs).doc("Don't link the inputs of a transaction with each other"),
+                clipp::option("--no-link-scripthash").set(noLinkScripthash).doc("Don't link scripthash addresses with the address they wrap"),
+                clipp::option("--link-multisig").set(rules.linkMultisigCosigners).doc("Link spent multisig addresses with the pubkeys of their signers"),
+                clipp::option("--link-fingerprint-change").set(rules.linkFingerprintChange).doc("Link the only output spent by a transaction with the same wallet fingerprint with the inputs"),
+                (clipp::option("--refine") & clipp::value("rounds", refineRounds)) % "Refine the clustering for up to this many rounds, linking the only output to a fresh address with the inputs when the other outputs go to known clusters"
+    );
+    auto exportCli = (
+                clipp::command("export").set(exportMode).doc("Export the cluster of every address and the cluster statistics of a clustering"),
+                clipp::value("config file location", configLocation),
+                clipp::value("cluster location", outputLocation),
+                clipp::value("export location", exportLocation),
+                (clipp::option("--format") & clipp::value("format", exportFormat)) % "File format to write: parquet or arrow",
+                (clipp::option("--batch-size") & clipp::value("rows", exportOptions.batchSize)) % "Rows per record batch",
+                (clipp::option("--batches-per-file") & clipp::value("count", exportOptions.batchesPerFile)) % "Record batches per file",
+                (clipp::option("--threads") & clipp::value("count", exportOptions.threadCount)) % "Number of files written in parallel, defaults to one per hardware thread"
     );
+    auto cli = (exportCli | clusterCli);
     auto res = parse(argc, argv, cli);
-    if (res.any_error()) {
+    auto heuristics = changeHeuristics();
+    auto heuristic = heuristics.find(changeName);
+    bool validFormat = exportFormat == "parquet" || exportFormat == "arrow";
+    std::vector<uint32_t> threadCounts;
+    try {
+        threadCounts = parseThreadCounts(threadList);
+    } catch (const std::exception &) {
+    }
+    // An update can't be repeated, the first run already extends the clustering to the end of the chain
+    bool validSweep = !threadCounts.empty() && (threadCounts.size() == 1 || !update);
+    // Refinement keeps the union-find in memory and can't be continued by an update
+    bool validRefine = refineRounds == 0 || (!update && !externalMode);
+    if (res.any_error() || heuristic == heuristics.end() || !validFormat || !validSweep || !validRefine) {
         std::cout << "Invalid command line parameter\n" << clipp::make_man_page(cli, argv[0]);
         return 0;
     }
+    rules.skipCoinJoin = !keepCoinJoin;
+    rules.linkInputs = !noLinkInputs;
+    rules.linkScripthashNested = !noLinkScripthash;
     
     blocksci::Blockchain chain(configLocation);
     
-    blocksci::ClusterManager::createClustering(chain, blocksci::heuristics::NoChange{}, outputLocation, overwrite);
+    if (exportMode) {
+        exportOptions.format = exportFormat == "arrow" ? blocksci::ClusterExportFormat::Arrow : blocksci::ClusterExportFormat::Parquet;
+        blocksci::ClusterManager manager(outputLocation, chain.getAccess());
+        manager.exportClusters(exportLocation, exportOptions);
+    } else {
+        PhaseTimer timer;
+        blocksci::setTraceSink(&timer);
+        std::vector<ClusteringRun> runs;
+        for (size_t i = 0; i < threadCounts.size(); i++) {
+            auto threadCount = threadCounts[i];
+            // Later runs of a sweep replace the clustering of the previous one
+            auto overwriteRun = overwrite || i > 0;
+            auto phasesBefore = timer.phaseSeconds();
+            resetPeakResidentSize();
+            auto start = std::chrono::steady_clock::now();
+            if (update) {
+                blocksci::ClusterManager::updateClustering(chain, heuristic->second, rules, outputLocation, threadCount);
+            } else if (refineRounds > 0) {
+                blocksci::RefinementOptions refineOptions;
+                refineOptions.maxRounds = refineRounds;
+                blocksci::ClusterManager::refineClustering(chain, heuristic->second, rules, blocksci::payeeClusterChange, outputLocation, refineOptions, overwriteRun, threadCount);
+            } else if (externalMode) {
+                blocksci::ClusterManager::createClustering(chain, heuristic->second, rules, externalOptions, outputLocation, overwriteRun, threadCount);
+            } else {
+                blocksci::ClusterManager::createClustering(chain, heuristic->second, rules, outputLocation, overwriteRun, threadCount);
+            }
+            ClusteringRun run;
+            run.threadCount = threadCount == 0 ? std::max(std::thread::hardware_concurrency(), 1u) : threadCount;
+            run.totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            run.phaseSeconds = timer.phaseSeconds();
+            for (size_t phase = 0; phase < blocksci::clusteringPhaseCount; phase++) {
+                run.phaseSeconds[phase] -= phasesBefore[phase];
+            }
+            run.peakResidentBytes = peakResidentSize();
+            printRun(run);
+            runs.push_back(run);
+        }
+        blocksci::setTraceSink(nullptr);
+        if (runs.size() > 1) {
+            printScaling(runs);
+        }
+        if (!reportLocation.empty()) {
+            writeReport(reportLocation, runs);
+        }
+    }
     return 0;
 }
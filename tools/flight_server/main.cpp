@@ -0,0 +1,740 @@
+//
+//  main.cpp
+//
+//  blocksci_flight_server
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include <blocksci/address/address.hpp>
+#include <blocksci/chain/async_query.hpp>
+#include <blocksci/chain/blockchain.hpp>
+#include <blocksci/chain/chain_table.hpp>
+#include <blocksci/chain/derived_column.hpp>
+#include <blocksci/chain/output_columns.hpp>
+#include <blocksci/cluster/cluster.hpp>
+#include <blocksci/cluster/cluster_manager.hpp>
+#include <blocksci/heuristics/taint.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+
+#include <arrow/api.h>
+#include <arrow/flight/api.h>
+
+#include <clipp.h>
+#include <nlohmann/json.hpp>
+#include <range/v3/range_for.hpp>
+
+#include <algorithm>
+#include <csignal>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace blocksci;
+using json = nlohmann::json;
+namespace flight = arrow::flight;
+
+namespace {
+    template <typename T>
+    T checkResult(arrow::Result<T> result) {
+        if (!result.ok()) {
+            throw std::runtime_error(result.status().ToString());
+        }
+        return std::move(result).ValueOrDie();
+    }
+
+    /** Status answering the exception currently being handled */
+    arrow::Status errorStatus() {
+        try {
+            throw;
+        } catch (const AsyncQueryOverloaded &e) {
+            return flight::MakeFlightError(flight::FlightStatusCode::Unavailable, e.what());
+        } catch (const json::exception &e) {
+            return arrow::Status::Invalid("Malformed request: ", e.what());
+        } catch (const std::invalid_argument &e) {
+            return arrow::Status::Invalid(e.what());
+        } catch (const std::out_of_range &e) {
+            return arrow::Status::IndexError(e.what());
+        } catch (const std::exception &e) {
+            return arrow::Status::UnknownError(e.what());
+        }
+    }
+
+    /** Buffer over memory owned by another object, eg. the mapping of a derived column, which it keeps alive */
+    template <typename Owner>
+    class PinnedBuffer : public arrow::Buffer {
+        std::shared_ptr<Owner> owner;
+
+    public:
+        PinnedBuffer(const void *data, int64_t size, std::shared_ptr<Owner> owner_) : arrow::Buffer(static_cast<const uint8_t *>(data), size), owner(std::move(owner_)) {}
+    };
+
+    /** Array over fixed width values without nulls */
+    std::shared_ptr<arrow::Array> fixedArray(const std::shared_ptr<arrow::DataType> &type, int64_t length, std::shared_ptr<arrow::Buffer> values) {
+        return arrow::MakeArray(arrow::ArrayData::Make(type, length, {nullptr, std::move(values)}));
+    }
+
+    /** Array over the values of a vector, which is moved into the array without copying */
+    template <typename T>
+    std::shared_ptr<arrow::Array> vectorArray(const std::shared_ptr<arrow::DataType> &type, std::vector<T> values) {
+        auto length = static_cast<int64_t>(values.size());
+        return fixedArray(type, length, arrow::Buffer::FromVector(std::move(values)));
+    }
+
+    std::shared_ptr<arrow::DataType> tableColumnArrowType(TableColumnType type) {
+        switch (type) {
+            case TableColumnType::Int64: return arrow::int64();
+            case TableColumnType::Int32: return arrow::int32();
+            case TableColumnType::UInt32: return arrow::uint32();
+            case TableColumnType::UInt16: return arrow::uint16();
+            case TableColumnType::UInt8: return arrow::uint8();
+            case TableColumnType::Bool: return arrow::boolean();
+            case TableColumnType::Hash: return arrow::fixed_size_binary(32);
+        }
+        throw std::invalid_argument("Unknown table column type");
+    }
+
+    std::shared_ptr<arrow::DataType> derivedColumnArrowType(DerivedColumnType type) {
+        switch (type) {
+            case DerivedColumnType::Int64: return arrow::int64();
+            case DerivedColumnType::UInt32: return arrow::uint32();
+            case DerivedColumnType::UInt16: return arrow::uint16();
+            case DerivedColumnType::UInt8: return arrow::uint8();
+        }
+        throw std::invalid_argument("Unknown derived column type");
+    }
+
+    /** Arrow array of a column built by buildChainTable, whose values are moved rather than copied except for the
+     * one byte flags of Bool columns, which Arrow stores as bits */
+    std::shared_ptr<arrow::Array> tableColumnArray(ChainTableColumn &column) {
+        auto length = static_cast<int64_t>(column.size());
+        if (column.type == TableColumnType::Bool) {
+            std::shared_ptr<arrow::Buffer> bits = checkResult(arrow::AllocateBuffer((length + 7) / 8));
+            auto out = bits->mutable_data();
+            std::fill_n(out, bits->size(), 0);
+            for (int64_t i = 0; i < length; i++) {
+                out[i / 8] |= static_cast<uint8_t>((column.data[static_cast<size_t>(i)] != 0) << (i % 8));
+            }
+            return fixedArray(arrow::boolean(), length, std::move(bits));
+        }
+        return fixedArray(tableColumnArrowType(column.type), length, arrow::Buffer::FromVector(std::move(column.data)));
+    }
+
+    /** Output fields stored in the chain/output_*.dat columns, which are served straight from the mapped files */
+    struct MappedOutputColumn {
+        const char *name;
+        TableColumnType type;
+    };
+
+    constexpr MappedOutputColumn mappedOutputColumns[] = {
+        {"value", TableColumnType::Int64},
+        {"address_type", TableColumnType::UInt8},
+        {"address_num", TableColumnType::UInt32}
+    };
+
+    const void *mappedOutputData(const OutputColumns &outputs, const std::string &name) {
+        if (name == "value") {
+            return outputs.values;
+        } else if (name == "address_type") {
+            return outputs.types;
+        } else {
+            return outputs.addressNums;
+        }
+    }
+
+    DerivedColumnLevel tableLevel(ChainTable table) {
+        switch (table) {
+            case ChainTable::Blocks: return DerivedColumnLevel::Block;
+            case ChainTable::Transactions: return DerivedColumnLevel::Tx;
+            case ChainTable::Inputs: return DerivedColumnLevel::Input;
+            case ChainTable::Outputs: return DerivedColumnLevel::Output;
+        }
+        throw std::invalid_argument("Unknown table");
+    }
+
+    ChainTable parseTable(const std::string &name) {
+        if (name == "blocks") {
+            return ChainTable::Blocks;
+        } else if (name == "txs") {
+            return ChainTable::Transactions;
+        } else if (name == "inputs") {
+            return ChainTable::Inputs;
+        } else if (name == "outputs") {
+            return ChainTable::Outputs;
+        }
+        throw std::invalid_argument("Unknown table " + name);
+    }
+
+    std::shared_ptr<arrow::Schema> addressHistorySchema() {
+        return arrow::schema({
+            arrow::field("tx_index", arrow::uint32(), false),
+            arrow::field("output_index", arrow::uint16(), false),
+            arrow::field("block_height", arrow::int32(), false),
+            arrow::field("value", arrow::int64(), false),
+            arrow::field("spending_tx_index", arrow::int64(), false)
+        });
+    }
+
+    std::shared_ptr<arrow::Schema> clusterMembersSchema() {
+        return arrow::schema({
+            arrow::field("address_type", arrow::uint8(), false),
+            arrow::field("address_num", arrow::uint32(), false)
+        });
+    }
+
+    std::shared_ptr<arrow::Schema> taintSchema() {
+        return arrow::schema({
+            arrow::field("tx_index", arrow::uint32(), false),
+            arrow::field("output_index", arrow::uint16(), false),
+            arrow::field("block_height", arrow::int32(), false),
+            arrow::field("tainted", arrow::int64(), false),
+            arrow::field("untainted", arrow::int64(), false)
+        });
+    }
+
+    std::shared_ptr<arrow::Schema> clusterStatsSchema() {
+        return arrow::schema({
+            arrow::field("cluster_num", arrow::uint32(), false),
+            arrow::field("total_received", arrow::int64(), false),
+            arrow::field("balance", arrow::int64(), false),
+            arrow::field("address_count", arrow::uint32(), false),
+            arrow::field("tx_count", arrow::uint32(), false),
+            arrow::field("first_height", arrow::int32(), false),
+            arrow::field("last_height", arrow::int32(), false)
+        });
+    }
+
+    /** Served state shared by all RPCs */
+    struct ServedChain {
+        Blockchain &chain;
+        ClusterManager *clusters;
+        AsyncQueryEngine &engine;
+        int64_t batchRows;
+
+        /** Derived columns are opened once and shared by all requests */
+        std::mutex derivedLock;
+        std::unordered_map<std::string, std::shared_ptr<DerivedColumn>> derivedColumns;
+
+        std::shared_ptr<DerivedColumn> derivedColumn(const std::string &name) {
+            std::lock_guard<std::mutex> lock(derivedLock);
+            auto it = derivedColumns.find(name);
+            if (it == derivedColumns.end()) {
+                it = derivedColumns.emplace(name, std::make_shared<DerivedColumn>(chain.derivedColumn(name))).first;
+            }
+            return it->second;
+        }
+
+        ClusterManager &requireClusters() const {
+            if (clusters == nullptr) {
+                throw std::invalid_argument("The server was started without a clustering");
+            }
+            return *clusters;
+        }
+    };
+
+    /** Streams the rows of a chain table one chunk of blocks at a time
+     *
+     * Each batch covers about batchRows txes. Output fields with a column file and derived columns are wrapped in
+     * place, all other columns are built by buildChainTable for the chunk and moved into the batch. */
+    class ChainTableReader : public arrow::RecordBatchReader {
+        enum class Source {
+            Table, MappedOutputs, Derived
+        };
+
+        struct Column {
+            std::string name;
+            Source source;
+            size_t index;
+        };
+
+        ServedChain &served;
+        const ChainAccess &chainAccess;
+        ChainTable table;
+        BlockHeight next;
+        BlockHeight stop;
+        std::vector<Column> columns;
+        std::vector<std::string> tableColumns;
+        std::vector<std::shared_ptr<DerivedColumn>> derived;
+        std::shared_ptr<arrow::Schema> tableSchema;
+
+        /** First row of the table that belongs to the block at the given height, which may be the chain's end */
+        uint64_t firstRow(BlockHeight height) const {
+            if (table == ChainTable::Blocks) {
+                return static_cast<uint64_t>(height);
+            }
+            auto txNum = height < chainAccess.blockCount() ? chainAccess.getBlock(height)->firstTxIndex : static_cast<uint32_t>(chainAccess.txCount());
+            switch (table) {
+                case ChainTable::Transactions:
+                    return txNum;
+                case ChainTable::Inputs:
+                    return txNum < chainAccess.txCount() ? chainAccess.getFirstInputNumber(txNum) : chainAccess.inputCount();
+                default:
+                    return txNum < chainAccess.txCount() ? chainAccess.getFirstOutputNumber(txNum) : chainAccess.outputCount();
+            }
+        }
+
+        /** End of the chunk starting at start, the first block past batchRows blocks or txes */
+        BlockHeight chunkEnd(BlockHeight start) const {
+            if (table == ChainTable::Blocks) {
+                return static_cast<BlockHeight>(std::min<int64_t>(stop, start + served.batchRows));
+            }
+            auto limit = static_cast<uint64_t>(chainAccess.getBlock(start)->firstTxIndex) + static_cast<uint64_t>(served.batchRows);
+            auto low = start + 1;
+            auto high = stop;
+            while (low < high) {
+                auto mid = low + (high - low) / 2;
+                if (chainAccess.getBlock(mid)->firstTxIndex < limit) {
+                    low = mid + 1;
+                } else {
+                    high = mid;
+                }
+            }
+            return low;
+        }
+
+    public:
+        ChainTableReader(ServedChain &served_, ChainTable table_, BlockHeight start, BlockHeight stop_, std::vector<std::string> requested, const std::vector<std::string> &derivedNames) :
+        served(served_), chainAccess(served_.chain.getAccess().getChain()), table(table_), next(start), stop(stop_) {
+            if (start < 0 || start > stop || stop > served.chain.size()) {
+                throw std::out_of_range("Block range [" + std::to_string(start) + ", " + std::to_string(stop) + ") is outside of the chain");
+            }
+            if (requested.empty()) {
+                requested = chainTableColumns(table);
+            }
+            bool mapped = table == ChainTable::Outputs && hasOutputColumns(served.chain.getAccess());
+            std::vector<std::shared_ptr<arrow::Field>> fields;
+            std::vector<size_t> tableFields;
+            for (auto &name : requested) {
+                auto mappedColumn = std::find_if(std::begin(mappedOutputColumns), std::end(mappedOutputColumns), [&](const MappedOutputColumn &column) {
+                    return name == column.name;
+                });
+                if (mapped && mappedColumn != std::end(mappedOutputColumns)) {
+                    columns.push_back(Column{name, Source::MappedOutputs, 0});
+                    fields.push_back(arrow::field(name, tableColumnArrowType(mappedColumn->type), false));
+                } else {
+                    columns.push_back(Column{name, Source::Table, tableColumns.size()});
+                    tableColumns.push_back(name);
+                    tableFields.push_back(fields.size());
+                    fields.push_back(nullptr);
+                }
+            }
+            if (!tableColumns.empty()) {
+                // Types of the other columns, from a table of at most one block
+                auto probeHeight = std::min(start, std::max(served.chain.size() - 1, BlockHeight{0}));
+                auto probeRange = served.chain[{probeHeight, std::min(probeHeight + 1, served.chain.size())}];
+                auto probe = buildChainTable(probeRange, table, tableColumns);
+                for (size_t i = 0; i < probe.size(); i++) {
+                    fields[tableFields[i]] = arrow::field(probe[i].name, tableColumnArrowType(probe[i].type), false);
+                }
+            }
+            for (auto &name : derivedNames) {
+                auto column = served.derivedColumn(name);
+                if (column->level() != tableLevel(table)) {
+                    throw std::invalid_argument("Derived column " + name + " doesn't have one value per row of the table");
+                }
+                if (column->coveredHeight() < stop) {
+                    throw std::out_of_range("Derived column " + name + " only covers the blocks up to " + std::to_string(column->coveredHeight()));
+                }
+                columns.push_back(Column{name, Source::Derived, derived.size()});
+                derived.push_back(column);
+                fields.push_back(arrow::field(name, derivedColumnArrowType(column->type()), false));
+            }
+            tableSchema = arrow::schema(fields);
+        }
+
+        std::shared_ptr<arrow::Schema> schema() const override {
+            return tableSchema;
+        }
+
+        arrow::Status ReadNext(std::shared_ptr<arrow::RecordBatch> *batch) override {
+            try {
+                if (next >= stop) {
+                    *batch = nullptr;
+                    return arrow::Status::OK();
+                }
+                auto end = chunkEnd(next);
+                auto chunk = served.chain[{next, end}];
+                auto rowBegin = firstRow(next);
+                auto rows = static_cast<int64_t>(firstRow(end) - rowBegin);
+
+                std::vector<ChainTableColumn> built;
+                if (!tableColumns.empty()) {
+                    built = buildChainTable(chunk, table, tableColumns);
+                }
+                OutputColumns outputs;
+                bool needsOutputs = std::any_of(columns.begin(), columns.end(), [](const Column &column) {
+                    return column.source == Source::MappedOutputs;
+                });
+                if (needsOutputs) {
+                    outputs = outputColumns(chunk);
+                }
+
+                std::vector<std::shared_ptr<arrow::Array>> arrays;
+                for (size_t i = 0; i < columns.size(); i++) {
+                    auto &column = columns[i];
+                    auto &type = tableSchema->field(static_cast<int>(i))->type();
+                    switch (column.source) {
+                        case Source::Table:
+                            arrays.push_back(tableColumnArray(built[column.index]));
+                            break;
+                        case Source::MappedOutputs: {
+                            // The chain outlives the server, so the mapping needs no owner
+                            auto size = static_cast<int64_t>(outputs.size()) * type->byte_width();
+                            arrays.push_back(fixedArray(type, static_cast<int64_t>(outputs.size()), std::make_shared<arrow::Buffer>(static_cast<const uint8_t *>(mappedOutputData(outputs, column.name)), size)));
+                            break;
+                        }
+                        case Source::Derived: {
+                            auto &values = derived[column.index];
+                            auto width = static_cast<int64_t>(derivedColumnElementSize(values->type()));
+                            auto data = static_cast<const uint8_t *>(values->data()) + static_cast<int64_t>(rowBegin) * width;
+                            arrays.push_back(fixedArray(type, rows, std::make_shared<PinnedBuffer<DerivedColumn>>(data, rows * width, values)));
+                            break;
+                        }
+                    }
+                    if (arrays.back()->length() != rows) {
+                        return arrow::Status::Invalid("Column ", column.name, " has ", arrays.back()->length(), " rows instead of ", rows);
+                    }
+                }
+                *batch = arrow::RecordBatch::Make(tableSchema, rows, std::move(arrays));
+                next = end;
+                return arrow::Status::OK();
+            } catch (...) {
+                return errorStatus();
+            }
+        }
+    };
+
+    /** Streams the precomputed statistics of every cluster */
+    class ClusterStatsReader : public arrow::RecordBatchReader {
+        ServedChain &served;
+        uint32_t next = 0;
+
+    public:
+        explicit ClusterStatsReader(ServedChain &served_) : served(served_) {
+            if (!served.requireClusters().hasClusterStats()) {
+                throw std::invalid_argument("The clustering has no precomputed cluster statistics");
+            }
+        }
+
+        std::shared_ptr<arrow::Schema> schema() const override {
+            return clusterStatsSchema();
+        }
+
+        arrow::Status ReadNext(std::shared_ptr<arrow::RecordBatch> *batch) override {
+            try {
+                auto &clusters = *served.clusters;
+                auto end = static_cast<uint32_t>(std::min<int64_t>(clusters.getClusterCount(), int64_t{next} + served.batchRows));
+                if (next >= end) {
+                    *batch = nullptr;
+                    return arrow::Status::OK();
+                }
+                auto rows = static_cast<size_t>(end - next);
+                std::vector<uint32_t> clusterNums(rows), addressCounts(rows), txCounts(rows);
+                std::vector<int64_t> totalReceived(rows), balances(rows);
+                std::vector<int32_t> firstHeights(rows), lastHeights(rows);
+                for (size_t i = 0; i < rows; i++) {
+                    auto clusterNum = next + static_cast<uint32_t>(i);
+                    auto stats = clusters.getClusterStats(clusterNum);
+                    clusterNums[i] = clusterNum;
+                    totalReceived[i] = stats.totalReceived;
+                    balances[i] = stats.balance;
+                    addressCounts[i] = stats.addressCount;
+                    txCounts[i] = stats.txCount;
+                    firstHeights[i] = stats.firstHeight;
+                    lastHeights[i] = stats.lastHeight;
+                }
+                *batch = arrow::RecordBatch::Make(schema(), static_cast<int64_t>(rows), {
+                    vectorArray(arrow::uint32(), std::move(clusterNums)),
+                    vectorArray(arrow::int64(), std::move(totalReceived)),
+                    vectorArray(arrow::int64(), std::move(balances)),
+                    vectorArray(arrow::uint32(), std::move(addressCounts)),
+                    vectorArray(arrow::uint32(), std::move(txCounts)),
+                    vectorArray(arrow::int32(), std::move(firstHeights)),
+                    vectorArray(arrow::int32(), std::move(lastHeights))
+                });
+                next = end;
+                return arrow::Status::OK();
+            } catch (...) {
+                return errorStatus();
+            }
+        }
+    };
+
+    std::shared_ptr<arrow::RecordBatchReader> singleBatch(const std::shared_ptr<arrow::Schema> &schema, int64_t rows, std::vector<std::shared_ptr<arrow::Array>> arrays) {
+        return checkResult(arrow::RecordBatchReader::Make({arrow::RecordBatch::Make(schema, rows, std::move(arrays))}, schema));
+    }
+
+    /** Serves chain tables and queries over Arrow Flight
+     *
+     * Tickets and command descriptors are JSON objects. Tables are requested with
+     *
+     *     {"table": "blocks" | "txs" | "inputs" | "outputs", "start": 0, "stop": <height>, "columns": [...], "derived": [...]}
+     *
+     * where columns are names of chainTableColumns (all by default) and derived names derived columns with one value
+     * per row, or with {"table": "clusters"} for the statistics of every cluster. Queries are
+     *
+     *     {"query": "address_history", "address": "<address>"}
+     *     {"query": "cluster_members", "cluster": <number>} or {"query": "cluster_members", "address": "<address>"}
+     *     {"query": "taint", "seeds": [[tx_index, output_index], ...], "method": "poison" | "haircut", "max_height": -1, "taint_fee": false}
+     *
+     * Path descriptors name a whole table, eg. ["outputs"]. Queries run on the threads of the AsyncQueryEngine, which
+     * rejects them with an Unavailable error once too many are pending, while gRPC's threads only wait for them.
+     */
+    class ChainFlightServer : public flight::FlightServerBase {
+        ServedChain &served;
+
+        json requestOf(const flight::FlightDescriptor &descriptor) const {
+            if (descriptor.type == flight::FlightDescriptor::PATH) {
+                if (descriptor.path.size() != 1) {
+                    throw std::invalid_argument("Path descriptors consist of a single table name");
+                }
+                return json{{"table", descriptor.path[0]}};
+            }
+            return json::parse(descriptor.cmd);
+        }
+
+        Address parseAddress(const std::string &addressString) {
+            auto &access = served.chain.getAccess();
+            auto address = served.engine.io([&]() {
+                return getAddressFromString(addressString, access);
+            }).get();
+            if (!address) {
+                throw std::invalid_argument("Unknown address " + addressString);
+            }
+            return *address;
+        }
+
+        std::shared_ptr<arrow::RecordBatchReader> tableReader(const json &request) {
+            auto tableName = request.at("table").get<std::string>();
+            if (tableName == "clusters") {
+                return std::make_shared<ClusterStatsReader>(served);
+            }
+            auto start = request.value("start", BlockHeight{0});
+            auto stop = request.value("stop", served.chain.size());
+            auto columns = request.value("columns", std::vector<std::string>{});
+            auto derived = request.value("derived", std::vector<std::string>{});
+            return std::make_shared<ChainTableReader>(served, parseTable(tableName), start, stop, std::move(columns), derived);
+        }
+
+        std::shared_ptr<arrow::RecordBatchReader> addressHistory(const json &request) {
+            auto address = parseAddress(request.at("address").get<std::string>());
+            auto outputs = served.engine.addressOutputs(address).get();
+            std::vector<uint32_t> txIndexes;
+            std::vector<uint16_t> outputIndexes;
+            std::vector<int32_t> heights;
+            std::vector<int64_t> values, spendingTxIndexes;
+            for (auto &output : outputs) {
+                txIndexes.push_back(output.pointer.txNum);
+                outputIndexes.push_back(static_cast<uint16_t>(output.pointer.inoutNum));
+                heights.push_back(output.getBlockHeight());
+                values.push_back(output.getValue());
+                auto spendingTx = output.getSpendingTxIndex();
+                spendingTxIndexes.push_back(spendingTx ? int64_t{*spendingTx} : -1);
+            }
+            return singleBatch(addressHistorySchema(), static_cast<int64_t>(outputs.size()), {
+                vectorArray(arrow::uint32(), std::move(txIndexes)),
+                vectorArray(arrow::uint16(), std::move(outputIndexes)),
+                vectorArray(arrow::int32(), std::move(heights)),
+                vectorArray(arrow::int64(), std::move(values)),
+                vectorArray(arrow::int64(), std::move(spendingTxIndexes))
+            });
+        }
+
+        std::shared_ptr<arrow::RecordBatchReader> clusterMembers(const json &request) {
+            auto &clusters = served.requireClusters();
+            ranges::optional<Address> address;
+            if (request.count("address")) {
+                address = parseAddress(request.at("address").get<std::string>());
+            }
+            auto clusterNum = address ? 0u : request.at("cluster").get<uint32_t>();
+            if (!address && clusterNum >= clusters.getClusterCount()) {
+                throw std::out_of_range("Cluster " + std::to_string(clusterNum) + " doesn't exist");
+            }
+            auto members = served.engine.io([&]() {
+                auto cluster = address ? clusters.getCluster(*address) : clusters.getClusters()[clusterNum];
+                std::pair<std::vector<uint8_t>, std::vector<uint32_t>> result;
+                RANGES_FOR(auto member, cluster.getAddresses()) {
+                    result.first.push_back(static_cast<uint8_t>(member.type));
+                    result.second.push_back(member.scriptNum);
+                }
+                return result;
+            }).get();
+            auto rows = static_cast<int64_t>(members.first.size());
+            return singleBatch(clusterMembersSchema(), rows, {
+                vectorArray(arrow::uint8(), std::move(members.first)),
+                vectorArray(arrow::uint32(), std::move(members.second))
+            });
+        }
+
+        std::shared_ptr<arrow::RecordBatchReader> taint(const json &request) {
+            auto &access = served.chain.getAccess();
+            std::vector<Output> seeds;
+            for (auto &seed : request.at("seeds")) {
+                auto txNum = seed.at(0).get<uint32_t>();
+                auto outputNum = seed.at(1).get<uint16_t>();
+                if (txNum >= access.getChain().txCount() || outputNum >= access.getChain().getTx(txNum)->outputCount) {
+                    throw std::out_of_range("Seed output " + std::to_string(txNum) + ":" + std::to_string(outputNum) + " doesn't exist");
+                }
+                seeds.emplace_back(OutputPointer{txNum, outputNum}, access);
+            }
+            auto method = request.value("method", std::string{"poison"});
+            if (method != "poison" && method != "haircut") {
+                throw std::invalid_argument("Unknown taint method " + method);
+            }
+            auto maxHeight = request.value("max_height", BlockHeight{-1});
+            auto taintFee = request.value("taint_fee", false);
+            auto tainted = served.engine.cpu([&]() {
+                return method == "poison" ? heuristics::getPoisonTainted(seeds, maxHeight, taintFee) : heuristics::getHaircutTainted(seeds, maxHeight, taintFee);
+            }).get();
+            std::vector<uint32_t> txIndexes;
+            std::vector<uint16_t> outputIndexes;
+            std::vector<int32_t> heights;
+            std::vector<int64_t> taintedValues, untaintedValues;
+            for (auto &entry : tainted) {
+                txIndexes.push_back(entry.first.pointer.txNum);
+                outputIndexes.push_back(static_cast<uint16_t>(entry.first.pointer.inoutNum));
+                heights.push_back(entry.first.getBlockHeight());
+                taintedValues.push_back(entry.second.first);
+                untaintedValues.push_back(entry.second.second);
+            }
+            return singleBatch(taintSchema(), static_cast<int64_t>(tainted.size()), {
+                vectorArray(arrow::uint32(), std::move(txIndexes)),
+                vectorArray(arrow::uint16(), std::move(outputIndexes)),
+                vectorArray(arrow::int32(), std::move(heights)),
+                vectorArray(arrow::int64(), std::move(taintedValues)),
+                vectorArray(arrow::int64(), std::move(untaintedValues))
+            });
+        }
+
+        std::shared_ptr<arrow::Schema> querySchema(const std::string &query) const {
+            if (query == "address_history") {
+                return addressHistorySchema();
+            } else if (query == "cluster_members") {
+                return clusterMembersSchema();
+            } else if (query == "taint") {
+                return taintSchema();
+            }
+            throw std::invalid_argument("Unknown query " + query);
+        }
+
+        std::shared_ptr<arrow::RecordBatchReader> run(const json &request) {
+            if (request.count("table")) {
+                return tableReader(request);
+            }
+            auto query = request.at("query").get<std::string>();
+            if (query == "address_history") {
+                return addressHistory(request);
+            } else if (query == "cluster_members") {
+                return clusterMembers(request);
+            } else if (query == "taint") {
+                return taint(request);
+            }
+            throw std::invalid_argument("Unknown query " + query);
+        }
+
+        flight::FlightInfo flightInfo(const flight::FlightDescriptor &descriptor) {
+            auto request = requestOf(descriptor);
+            // Only tables are opened to find their schema, queries are answered when the ticket is redeemed
+            auto schema = request.count("table") ? tableReader(request)->schema() : querySchema(request.at("query").get<std::string>());
+            flight::FlightEndpoint endpoint;
+            endpoint.ticket.ticket = request.dump();
+            return checkResult(flight::FlightInfo::Make(*schema, descriptor, {endpoint}, -1, -1));
+        }
+
+    public:
+        explicit ChainFlightServer(ServedChain &served_) : served(served_) {}
+
+        arrow::Status ListFlights(const flight::ServerCallContext &, const flight::Criteria *, std::unique_ptr<flight::FlightListing> *listings) override {
+            try {
+                std::vector<std::string> tables{"blocks", "txs", "inputs", "outputs"};
+                if (served.clusters != nullptr && served.clusters->hasClusterStats()) {
+                    tables.push_back("clusters");
+                }
+                std::vector<flight::FlightInfo> flights;
+                for (auto &table : tables) {
+                    flights.push_back(flightInfo(flight::FlightDescriptor::Path({table})));
+                }
+                *listings = std::make_unique<flight::SimpleFlightListing>(std::move(flights));
+                return arrow::Status::OK();
+            } catch (...) {
+                return errorStatus();
+            }
+        }
+
+        arrow::Status GetFlightInfo(const flight::ServerCallContext &, const flight::FlightDescriptor &descriptor, std::unique_ptr<flight::FlightInfo> *info) override {
+            try {
+                *info = std::make_unique<flight::FlightInfo>(flightInfo(descriptor));
+                return arrow::Status::OK();
+            } catch (...) {
+                return errorStatus();
+            }
+        }
+
+        arrow::Status DoGet(const flight::ServerCallContext &, const flight::Ticket &ticket, std::unique_ptr<flight::FlightDataStream> *stream) override {
+            try {
+                *stream = std::make_unique<flight::RecordBatchStream>(run(json::parse(ticket.ticket)));
+                return arrow::Status::OK();
+            } catch (...) {
+                return errorStatus();
+            }
+        }
+    };
+}
+
+int main(int argc, char * argv[]) {
+    std::string configLocation;
+    std::string clusterDirectory;
+    std::string host = "0.0.0.0";
+    int port = 8815;
+    AsyncQueryConfig queryConfig;
+    int64_t batchRows = int64_t{1} << 20;
+
+    auto cli = (
+        clipp::value("config file location", configLocation) % "Path to config file",
+        (clipp::option("--clusters", "-c") & clipp::value("cluster directory", clusterDirectory)) % "Also serve the clustering stored in this directory",
+        (clipp::option("--host") & clipp::value("host", host)) % "Interface to listen on (default: 0.0.0.0)",
+        (clipp::option("--port", "-p") & clipp::value("port", port)) % "Port to listen on (default: 8815)",
+        (clipp::option("--io-threads") & clipp::value("thread count", queryConfig.ioThreads)) % "Threads answering index lookups (default: 2)",
+        (clipp::option("--cpu-threads") & clipp::value("thread count", queryConfig.cpuThreads)) % "Threads running taint traces (default: 2)",
+        (clipp::option("--batch-rows") & clipp::value("rows", batchRows)) % "Blocks or transactions per streamed record batch (default: 1048576)"
+    );
+
+    auto res = parse(argc, argv, cli);
+    if (res.any_error() || batchRows <= 0) {
+        std::cout << "Invalid command line parameter\n" << clipp::make_man_page(cli, argv[0]);
+        return 0;
+    }
+
+    Blockchain chain{configLocation};
+    std::unique_ptr<ClusterManager> clusters;
+    if (!clusterDirectory.empty()) {
+        clusters = std::make_unique<ClusterManager>(clusterDirectory, chain.getAccess());
+    }
+    AsyncQueryEngine engine{chain, queryConfig};
+    ServedChain served{chain, clusters.get(), engine, batchRows, {}, {}};
+
+    auto location = checkResult(flight::Location::ForGrpcTcp(host, port));
+    flight::FlightServerOptions options{location};
+    ChainFlightServer server{served};
+    auto status = server.Init(options);
+    if (status.ok()) {
+        status = server.SetShutdownOnSignals({SIGINT, SIGTERM});
+    }
+    if (!status.ok()) {
+        std::cerr << "Failed to start the server: " << status.ToString() << std::endl;
+        return 1;
+    }
+    std::cout << "Serving " << chain.size() << " blocks on " << location.ToString() << std::endl;
+    status = server.Serve();
+    if (!status.ok()) {
+        std::cerr << status.ToString() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,430 @@
+//
+//  main.cpp
+//
+//  blocksci_index_bench
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#define BLOCKSCI_WITHOUT_SINGLETON
+
+#include <blocksci/chain/blockchain.hpp>
+#include <blocksci/chain/output.hpp>
+#include <blocksci/chain/transaction.hpp>
+#include <blocksci/address/address.hpp>
+#include <blocksci/core/bitcoin_uint256.hpp>
+#include <blocksci/core/raw_address.hpp>
+
+#include <internal/address_index.hpp>
+#include <internal/address_info.hpp>
+#include <internal/bitcoin_uint256_hex.hpp>
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+#include <internal/data_configuration.hpp>
+#include <internal/hash_index.hpp>
+
+#include <clipp.h>
+#include <nlohmann/json.hpp>
+
+#include <rocksdb/cache.h>
+#include <rocksdb/perf_context.h>
+#include <rocksdb/perf_level.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <range/v3/range_for.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace blocksci;
+
+namespace {
+    /** One lookup of the trace
+     *
+     * Trace files hold one lookup per line: "tx <hash>" gets the txNum of a transaction from the hash index,
+     * "outputs <address type> <scriptNum>" scans the outputs of an address and "nested <address type> <scriptNum>"
+     * looks up the addresses wrapping it. Address types are spelled like the index columns, eg. "pubkeyhash".
+     */
+    struct Lookup {
+        enum Kind { TxGet, OutputScan, NestedLookup };
+        static constexpr size_t kindCount = 3;
+
+        Kind kind;
+        uint256 hash;
+        RawAddress address;
+    };
+
+    const char *kindName(Lookup::Kind kind) {
+        switch (kind) {
+            case Lookup::TxGet:
+                return "tx";
+            case Lookup::OutputScan:
+                return "outputs";
+            case Lookup::NestedLookup:
+                return "nested";
+        }
+        return "unknown";
+    }
+
+    AddressType::Enum addressTypeFromName(const std::string &name) {
+        for (size_t i = 0; i < AddressType::size; i++) {
+            auto type = static_cast<AddressType::Enum>(i);
+            if (addressName(type) == name) {
+                return type;
+            }
+        }
+        throw std::invalid_argument("Unknown address type in trace: " + name);
+    }
+
+    std::vector<Lookup> readTrace(const std::string &path) {
+        std::ifstream file(path);
+        if (!file) {
+            throw std::runtime_error("Could not open trace " + path);
+        }
+        std::vector<Lookup> trace;
+        std::string line;
+        while (std::getline(file, line)) {
+            std::stringstream ss(line);
+            std::string kind;
+            if (!(ss >> kind) || kind[0] == '#') {
+                continue;
+            }
+            Lookup lookup;
+            if (kind == "tx") {
+                std::string hash;
+                ss >> hash;
+                lookup.kind = Lookup::TxGet;
+                lookup.hash = uint256S(hash);
+            } else if (kind == "outputs" || kind == "nested") {
+                std::string type;
+                uint32_t scriptNum = 0;
+                ss >> type >> scriptNum;
+                lookup.kind = kind == "outputs" ? Lookup::OutputScan : Lookup::NestedLookup;
+                lookup.address = RawAddress{scriptNum, addressTypeFromName(type)};
+            } else {
+                throw std::invalid_argument("Unknown lookup in trace: " + line);
+            }
+            trace.push_back(lookup);
+        }
+        return trace;
+    }
+
+    void writeTrace(const std::string &path, const std::vector<Lookup> &trace) {
+        std::ofstream file(path);
+        for (auto &lookup : trace) {
+            file << kindName(lookup.kind);
+            if (lookup.kind == Lookup::TxGet) {
+                file << " " << lookup.hash.GetHex() << "\n";
+            } else {
+                file << " " << addressName(lookup.address.type) << " " << lookup.address.scriptNum << "\n";
+            }
+        }
+    }
+
+    /** Lookups of count random transactions: the hash of each and the outputs and wrapping addresses of its first
+     * output's address, so addresses appear as often as they are used */
+    std::vector<Lookup> generateTrace(Blockchain &chain, size_t count, uint32_t seed) {
+        auto &access = chain.getAccess();
+        auto txCount = access.getChain().txCount();
+        std::vector<Lookup> trace;
+        if (txCount == 0) {
+            return trace;
+        }
+        std::mt19937 generator(seed);
+        std::uniform_int_distribution<uint32_t> txNums(0, txCount - 1);
+        for (size_t i = 0; i < count; i++) {
+            Transaction tx(txNums(generator), access);
+            Lookup txLookup;
+            txLookup.kind = Lookup::TxGet;
+            txLookup.hash = tx.getHash();
+            trace.push_back(txLookup);
+            if (tx.outputCount() > 0) {
+                auto address = tx.outputs()[0].getAddress();
+                RawAddress raw{address.scriptNum, address.type};
+                trace.push_back(Lookup{Lookup::OutputScan, {}, raw});
+                trace.push_back(Lookup{Lookup::NestedLookup, {}, raw});
+            }
+        }
+        return trace;
+    }
+
+    /** RocksDB options of both indexes compared by the benchmark, in the format of the "indexOptions" config section */
+    struct OptionSet {
+        std::string name;
+        IndexTuning addressTuning;
+        IndexTuning hashTuning;
+    };
+
+    std::vector<OptionSet> readSweep(const std::string &path) {
+        std::ifstream file(path);
+        if (!file) {
+            throw std::runtime_error("Could not open sweep " + path);
+        }
+        nlohmann::json sweep;
+        file >> sweep;
+        std::vector<OptionSet> sets;
+        for (auto &entry : sweep) {
+            OptionSet set;
+            set.name = entry.at("name").get<std::string>();
+            auto addressIt = entry.find("addressIndex");
+            if (addressIt != entry.end()) {
+                set.addressTuning = loadIndexTuning(*addressIt);
+            }
+            auto hashIt = entry.find("hashIndex");
+            if (hashIt != entry.end()) {
+                set.hashTuning = loadIndexTuning(*hashIt);
+            }
+            sets.push_back(set);
+        }
+        return sets;
+    }
+
+    std::vector<std::string> directoryFiles(const filesystem::path &directory) {
+        std::vector<std::string> files;
+        auto dir = opendir(directory.str().c_str());
+        if (dir == nullptr) {
+            throw std::runtime_error("Could not read directory " + directory.str());
+        }
+        while (auto entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name != "." && name != ".." && name != "LOCK") {
+                files.push_back(name);
+            }
+        }
+        closedir(dir);
+        return files;
+    }
+
+    /** Copy the index at source to destination, hard linking the table files, which RocksDB never modifies */
+    void copyIndex(const filesystem::path &source, const filesystem::path &destination) {
+        if (destination.exists()) {
+            throw std::runtime_error("Rewrite destination " + destination.str() + " already exists");
+        }
+        filesystem::create_directory(destination);
+        for (auto &name : directoryFiles(source)) {
+            auto from = (source/name).str();
+            auto to = (destination/name).str();
+            bool isTable = name.size() > 4 && name.compare(name.size() - 4, 4, ".sst") == 0;
+            if (!isTable || link(from.c_str(), to.c_str()) != 0) {
+                std::ifstream in(from, std::ios::binary);
+                std::ofstream out(to, std::ios::binary);
+                out << in.rdbuf();
+            }
+        }
+    }
+
+    /** Evict the files of the index from the page cache, so that every option set starts cold */
+    void evictIndex(const filesystem::path &directory) {
+        for (auto &name : directoryFiles(directory)) {
+            auto fd = open((directory/name).str().c_str(), O_RDONLY);
+            if (fd >= 0) {
+                posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+                close(fd);
+            }
+        }
+    }
+
+    struct KindResult {
+        std::vector<double> latencies;
+        /** Transactions found, outputs scanned and wrapping addresses found */
+        uint64_t rows = 0;
+        uint64_t bytesRead = 0;
+        uint64_t blocksRead = 0;
+
+        double percentile(double q) const {
+            if (latencies.empty()) {
+                return 0;
+            }
+            auto index = static_cast<size_t>(q * static_cast<double>(latencies.size() - 1));
+            return latencies[index];
+        }
+    };
+
+    struct SetResult {
+        std::string name;
+        std::array<KindResult, Lookup::kindCount> kinds;
+    };
+
+    std::shared_ptr<rocksdb::Cache> cacheFor(const IndexTuning &tuning) {
+        return tuning.cacheSize > 0 ? rocksdb::NewLRUCache(tuning.cacheSize) : nullptr;
+    }
+
+    SetResult replay(const std::vector<Lookup> &trace, const OptionSet &set, const filesystem::path &addressPath, const filesystem::path &hashPath) {
+        AddressIndex addressIndex(addressPath, IndexOpenMode::ReadOnly, cacheFor(set.addressTuning), set.addressTuning);
+        HashIndex hashIndex(hashPath, IndexOpenMode::ReadOnly, cacheFor(set.hashTuning), set.hashTuning);
+        SetResult result;
+        result.name = set.name;
+        rocksdb::SetPerfLevel(rocksdb::PerfLevel::kEnableCount);
+        auto perfContext = rocksdb::get_perf_context();
+        for (auto &lookup : trace) {
+            perfContext->Reset();
+            auto &kind = result.kinds[lookup.kind];
+            auto start = std::chrono::steady_clock::now();
+            switch (lookup.kind) {
+                case Lookup::TxGet:
+                    kind.rows += hashIndex.getTxIndex(lookup.hash) ? 1 : 0;
+                    break;
+                case Lookup::OutputScan:
+                    RANGES_FOR(auto pointer, addressIndex.getOutputPointers(lookup.address)) {
+                        static_cast<void>(pointer);
+                        kind.rows++;
+                    }
+                    break;
+                case Lookup::NestedLookup:
+                    kind.rows += addressIndex.getPossibleNestedEquivalentUp(lookup.address).size();
+                    break;
+            }
+            kind.latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+            kind.bytesRead += perfContext->block_read_byte;
+            kind.blocksRead += perfContext->block_read_count;
+        }
+        rocksdb::SetPerfLevel(rocksdb::PerfLevel::kDisable);
+        for (auto &kind : result.kinds) {
+            std::sort(kind.latencies.begin(), kind.latencies.end());
+        }
+        return result;
+    }
+
+    void printResults(const std::vector<SetResult> &results) {
+        std::cout << std::left << std::setw(20) << "option set" << std::setw(9) << "lookup" << std::right << std::setw(10) << "count" << std::setw(12) << "p50 us" << std::setw(12) << "p99 us" << std::setw(16) << "bytes read" << std::setw(12) << "bytes/op" << "\n";
+        for (auto &result : results) {
+            for (size_t i = 0; i < Lookup::kindCount; i++) {
+                auto &kind = result.kinds[i];
+                if (kind.latencies.empty()) {
+                    continue;
+                }
+                std::cout << std::left << std::setw(20) << result.name << std::setw(9) << kindName(static_cast<Lookup::Kind>(i)) << std::right << std::setw(10) << kind.latencies.size()
+                << std::fixed << std::setprecision(1) << std::setw(12) << kind.percentile(0.5) << std::setw(12) << kind.percentile(0.99)
+                << std::setw(16) << kind.bytesRead << std::setw(12) << kind.bytesRead / kind.latencies.size() << "\n";
+            }
+        }
+    }
+
+    void writeReport(const std::string &path, const std::vector<SetResult> &results) {
+        auto report = nlohmann::json::array();
+        for (auto &result : results) {
+            nlohmann::json lookups;
+            for (size_t i = 0; i < Lookup::kindCount; i++) {
+                auto &kind = result.kinds[i];
+                lookups[kindName(static_cast<Lookup::Kind>(i))] = {
+                    {"count", kind.latencies.size()},
+                    {"rows", kind.rows},
+                    {"p50_us", kind.percentile(0.5)},
+                    {"p99_us", kind.percentile(0.99)},
+                    {"bytes_read", kind.bytesRead},
+                    {"blocks_read", kind.blocksRead}
+                };
+            }
+            report.push_back({{"name", result.name}, {"lookups", lookups}});
+        }
+        std::ofstream file(path);
+        file << report.dump(4) << "\n";
+    }
+}
+
+int main(int argc, char * argv[]) {
+    std::string configLocation;
+    std::string tracePath;
+    std::string writeTracePath;
+    size_t generateCount = 100000;
+    uint32_t seed = 42;
+    std::string sweepPath;
+    std::string rewriteDirectory;
+    std::string reportPath;
+    bool cold = false;
+    IndexTuning cliTuning;
+    size_t blockSizeKB = 0;
+    size_t cacheMB = 0;
+
+    auto cli = (
+        clipp::value("config file location", configLocation),
+        (clipp::option("--trace") & clipp::value("file", tracePath)) % "Replay the lookups of a trace file instead of generating them",
+        (clipp::option("--generate") & clipp::value("count", generateCount)) % "Number of random transactions to generate lookups for, defaults to 100000",
+        (clipp::option("--seed") & clipp::value("seed", seed)) % "Seed of the generated trace",
+        (clipp::option("--write-trace") & clipp::value("file", writeTracePath)) % "Save the replayed trace, eg. to replay the same lookups later",
+        (clipp::option("--sweep") & clipp::value("file", sweepPath)) % "JSON array of option sets to compare, each with a name and the addressIndex and hashIndex entries of the indexOptions config section",
+        (clipp::option("--block-size-kb") & clipp::value("size", blockSizeKB)) % "Compare an option set with this block size",
+        (clipp::option("--compression") & clipp::value("name", cliTuning.compression)) % "Compare an option set with this compression: none, snappy, zlib, lz4, lz4hc or zstd",
+        (clipp::option("--bloom-bits") & clipp::value("bits", cliTuning.bloomBitsPerKey)) % "Compare an option set with this many bloom filter bits per key, 0 for no filters",
+        (clipp::option("--cache-mb") & clipp::value("size", cacheMB)) % "Compare an option set with this block cache size",
+        (clipp::option("--max-open-files") & clipp::value("count", cliTuning.maxOpenFiles)) % "Compare an option set with this open file limit, -1 for no limit",
+        clipp::option("--interactive").set(cliTuning.interactive).doc("Compare an option set with the interactive profile, which pins index and filter blocks in the cache"),
+        clipp::option("--warmup").set(cliTuning.warmup).doc("Compare an option set that loads the index and filter blocks into the cache on a background thread after opening"),
+        (clipp::option("--rewrite-dir") & clipp::value("directory", rewriteDirectory)) % "Directory for the copies of the indexes rewritten with the block size, compression or bloom filters of an option set",
+        clipp::option("--cold").set(cold).doc("Evict the index files from the page cache before replaying every option set"),
+        (clipp::option("--report") & clipp::value("file", reportPath)) % "Write the results as JSON"
+    );
+    auto res = parse(argc, argv, cli);
+    if (res.any_error()) {
+        std::cout << "Invalid command line parameter\n" << clipp::make_man_page(cli, argv[0]);
+        return 0;
+    }
+    cliTuning.blockSize = blockSizeKB * 1024;
+    cliTuning.cacheSize = cacheMB * 1024 * 1024;
+
+    Blockchain chain(configLocation);
+    auto &config = chain.getAccess().config;
+
+    auto trace = tracePath.empty() ? generateTrace(chain, generateCount, seed) : readTrace(tracePath);
+    if (!writeTracePath.empty()) {
+        writeTrace(writeTracePath, trace);
+    }
+
+    // The configured options are the baseline, the existing index files were written with them
+    std::vector<OptionSet> sets{{"config", config.addressIndexTuning, config.hashIndexTuning}};
+    if (!cliTuning.isDefault()) {
+        sets.push_back({"cli", cliTuning, cliTuning});
+    }
+    if (!sweepPath.empty()) {
+        auto sweep = readSweep(sweepPath);
+        sets.insert(sets.end(), sweep.begin(), sweep.end());
+    }
+
+    std::vector<SetResult> results;
+    for (size_t i = 0; i < sets.size(); i++) {
+        auto &set = sets[i];
+        auto addressPath = config.addressDBFilePath();
+        auto hashPath = config.hashIndexFilePath();
+        if (i > 0 && (set.addressTuning.changesTableFiles() || set.hashTuning.changesTableFiles())) {
+            if (rewriteDirectory.empty()) {
+                throw std::invalid_argument("Option set " + set.name + " changes the table files, which needs --rewrite-dir");
+            }
+            auto setDirectory = filesystem::path{rewriteDirectory}/set.name;
+            filesystem::create_directory(filesystem::path{rewriteDirectory});
+            filesystem::create_directory(setDirectory);
+            std::cout << "Rewriting the indexes for " << set.name << " into " << setDirectory.str() << std::endl;
+            if (set.addressTuning.changesTableFiles()) {
+                copyIndex(addressPath, setDirectory/"addressesDb");
+                addressPath = setDirectory/"addressesDb";
+                AddressIndex{addressPath, IndexOpenMode::ReadWrite, nullptr, set.addressTuning}.compactDB(true);
+            }
+            if (set.hashTuning.changesTableFiles()) {
+                copyIndex(hashPath, setDirectory/"hashIndex");
+                hashPath = setDirectory/"hashIndex";
+                HashIndex{hashPath, IndexOpenMode::ReadWrite, nullptr, set.hashTuning}.compactDB(true);
+            }
+        }
+        if (cold) {
+            evictIndex(addressPath);
+            evictIndex(hashPath);
+        }
+        results.push_back(replay(trace, set, addressPath, hashPath));
+    }
+
+    printResults(results);
+    if (!reportPath.empty()) {
+        writeReport(reportPath, results);
+    }
+    return 0;
+}
@@ -13,9 +13,12 @@
 
 
 #include <internal/address_index.hpp>
+#include <internal/bitcoin_uint256_hex.hpp>
 #include <internal/chain_access.hpp>
 #include <internal/data_access.hpp>
 #include <internal/dedup_address_info.hpp>
+#include <internal/file_checksums.hpp>
+#include <internal/hash.hpp>
 #include <internal/hash_index.hpp>
 #include <internal/script_access.hpp>
 
@@ -25,56 +28,99 @@
 
 #include <clipp.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <future>
 #include <iostream>
 #include <fstream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <thread>
 
 using namespace blocksci;
 
+/** Number of blocks covered by one checksum chunk. Fixed so that the checksums don't depend on the number of
+ threads and the digests of old chunks can be reused by the incremental mode */
+constexpr BlockHeight checksumChunkBlocks = 2016;
+
+std::mutex outputMutex;
+
+/** Print a problem found by one of the checks, safe to call from several threads */
+void reportProblem(const std::string &problem) {
+    std::lock_guard<std::mutex> lock(outputMutex);
+    std::cout << problem << std::endl;
+}
+
 /**
- Compute a checksum over block data.
+ Run check on every range using up to threadCount threads and return the number of problems it found.
  */
-uint256 compute_block_hash(const ChainAccess &access) {
-    uint256 hash;
-    SHA256_CTX sha256;
-    SHA256_Init(&sha256);
-    for(int i = 0; i < access.blockCount(); i++) {
-        const RawBlock *block = access.getBlock(i);
-        SHA256_Update(&sha256, &block->baseSize, 4);
-        SHA256_Update(&sha256, &block->bits, 4);
-        SHA256_Update(&sha256, &block->coinbaseOffset, 8);
-        SHA256_Update(&sha256, &block->firstTxIndex, 4);
-        SHA256_Update(&sha256, &block->hash, 32);
-        SHA256_Update(&sha256, &block->height, 4);
-        SHA256_Update(&sha256, &block->inputCount, 4);
-        SHA256_Update(&sha256, &block->nonce, 4);
-        SHA256_Update(&sha256, &block->outputCount, 4);
-        SHA256_Update(&sha256, &block->realSize, 4);
-        SHA256_Update(&sha256, &block->timestamp, 4);
-        SHA256_Update(&sha256, &block->txCount, 4);
-        SHA256_Update(&sha256, &block->version, 4);
+template <typename Range, typename Func>
+uint64_t runParallel(const std::vector<Range> &ranges, unsigned int threadCount, Func check) {
+    std::atomic<size_t> nextRange{0};
+    std::atomic<uint64_t> problemCount{0};
+    std::vector<std::future<void>> workers;
+    auto workerCount = std::min<size_t>(std::max(threadCount, 1u), ranges.size());
+    for (size_t i = 0; i < workerCount; i++) {
+        workers.push_back(std::async(std::launch::async, [&]() {
+            size_t rangeNum;
+            while ((rangeNum = nextRange++) < ranges.size()) {
+                problemCount += check(ranges[rangeNum]);
+            }
+        }));
     }
-    SHA256_Final(reinterpret_cast<unsigned char *>(&hash), &sha256);
-    return hash;
+    for (auto &worker : workers) {
+        worker.get();
+    }
+    return problemCount;
 }
 
 /**
- Compute a checksum over core transaction data.
+ Chain columns that are checksummed and checked next to the transactions.
  */
-uint256 compute_txdata_hash(const ChainAccess &access) {
-    uint256 hash;
-    SHA256_CTX sha256;
-    SHA256_Init(&sha256);
-    for(size_t i = 0; i < access.txCount(); i++) {
-        // no additional padding in RawTransaction, can simply hash struct
-        const RawTransaction *tx = access.getTx(i);
-        SHA256_Update(&sha256, tx, tx->serializedSize());
-    }
-    SHA256_Final(reinterpret_cast<unsigned char *>(&hash), &sha256);
-    return hash;
+struct AdditionalColumns {
+    FixedSizeFileMapper<uint32_t> sequenceFile;
+    FixedSizeFileMapper<uint16_t> spentOutNumFile;
+    FixedSizeFileMapper<int32_t> txVersionFile;
+    FixedSizeFileMapper<uint256> txHashesFile;
+    FixedSizeFileMapper<uint64_t> txFirstInputFile;
+    FixedSizeFileMapper<uint64_t> txFirstOutputFile;
+
+    explicit AdditionalColumns(const DataAccess &access) :
+    sequenceFile(ChainAccess::sequenceFilePath(access.config.chainDirectory())),
+    spentOutNumFile(ChainAccess::inputSpentOutNumFilePath(access.config.chainDirectory())),
+    txVersionFile(ChainAccess::txVersionFilePath(access.config.chainDirectory())),
+    txHashesFile(ChainAccess::txHashesFilePath(access.config.chainDirectory())),
+    txFirstInputFile(ChainAccess::firstInputFilePath(access.config.chainDirectory())),
+    txFirstOutputFile(ChainAccess::firstOutputFilePath(access.config.chainDirectory())) {}
+};
+
+/**
+ The elements [begin, end) of a column as one message for doubleSha256Batch.
+ */
+template <typename T>
+HashInput columnSlice(const FixedSizeFileMapper<T> &column, uint64_t begin, uint64_t end) {
+    static const unsigned char empty = 0;
+    const void *data = begin < end ? static_cast<const void *>(column[begin]) : &empty;
+    return HashInput{{data, nullptr, nullptr}, {(end - begin) * sizeof(T), 0, 0}};
 }
 
 /**
- Compute a checksum over additional data (kept in separate files that are memory-mapped on-demand).
+ Checksums of one chunk of blocks, the checksums of the whole chain are the hash of the checksums of its chunks.
+ */
+struct ChunkDigests {
+    /** Hash of the last block of the chunk, to tell whether a stored chunk was reorganized away */
+    uint256 lastBlockHash;
+    uint256 blocks;
+    uint256 txes;
+    uint256 additional;
+};
+
+/**
+ Compute the checksums over the block data, the core transaction data and the additional columns of a chunk.
+ The additional columns (kept in separate files that are memory-mapped on-demand) are:
  - Input sequence numbers
  - Indexes of outputs spent by inputs
  - Transaction version
@@ -82,46 +128,184 @@ uint256 compute_txdata_hash(const ChainAccess &access) {
  - Index of first input for each transaction
  - Index of first output for each transaction
  */
-uint256 compute_additional_data_hash(const DataAccess &access) {
-    uint256 hash;
-    SHA256_CTX sha256;
-    SHA256_Init(&sha256);
-    const ChainAccess &chainAccess = access.getChain();
-    auto chainDirectory = access.config.chainDirectory();
-
-    FixedSizeFileMapper<uint32_t> sequenceFile(chainAccess.sequenceFilePath(chainDirectory));
-    for(uint64_t i = 0; i < chainAccess.inputCount(); ++i) {
-        SHA256_Update(&sha256, sequenceFile[i], 4);
+ChunkDigests compute_chunk_digests(const ChainAccess &access, const AdditionalColumns &columns, BlockHeight firstHeight, BlockHeight endHeight) {
+    ChunkDigests digests;
+    SHA256_CTX blockSha256;
+    SHA256_Init(&blockSha256);
+    SHA256_CTX txSha256;
+    SHA256_Init(&txSha256);
+    uint64_t chunkInputCount = 0;
+    for(BlockHeight i = firstHeight; i < endHeight; i++) {
+        const RawBlock *block = access.getBlock(i);
+        SHA256_Update(&blockSha256, &block->baseSize, 4);
+        SHA256_Update(&blockSha256, &block->bits, 4);
+        SHA256_Update(&blockSha256, &block->coinbaseOffset, 8);
+        SHA256_Update(&blockSha256, &block->firstTxIndex, 4);
+        SHA256_Update(&blockSha256, &block->hash, 32);
+        SHA256_Update(&blockSha256, &block->height, 4);
+        SHA256_Update(&blockSha256, &block->inputCount, 4);
+        SHA256_Update(&blockSha256, &block->nonce, 4);
+        SHA256_Update(&blockSha256, &block->outputCount, 4);
+        SHA256_Update(&blockSha256, &block->realSize, 4);
+        SHA256_Update(&blockSha256, &block->timestamp, 4);
+        SHA256_Update(&blockSha256, &block->txCount, 4);
+        SHA256_Update(&blockSha256, &block->version, 4);
+        for(uint32_t txNum = block->firstTxIndex; txNum < block->firstTxIndex + block->txCount; txNum++) {
+            // no additional padding in RawTransaction, can simply hash struct
+            const RawTransaction *tx = access.getTx(txNum);
+            SHA256_Update(&txSha256, tx, tx->serializedSize());
+        }
+        chunkInputCount += block->inputCount;
     }
+    SHA256_Final(reinterpret_cast<unsigned char *>(&digests.blocks), &blockSha256);
+    SHA256_Final(reinterpret_cast<unsigned char *>(&digests.txes), &txSha256);
+
+    const RawBlock *lastBlock = access.getBlock(endHeight - 1);
+    digests.lastBlockHash = lastBlock->hash;
+    uint32_t firstTx = access.getBlock(firstHeight)->firstTxIndex;
+    uint32_t endTx = lastBlock->firstTxIndex + lastBlock->txCount;
+    uint64_t firstInput = access.getFirstInputNumber(firstTx);
+
+    // The columns are contiguous in their files, so they are hashed as one message each with the batched kernels
+    std::array<HashInput, 6> columnSlices{{
+        columnSlice(columns.sequenceFile, firstInput, firstInput + chunkInputCount),
+        columnSlice(columns.spentOutNumFile, firstInput, firstInput + chunkInputCount),
+        columnSlice(columns.txVersionFile, firstTx, endTx),
+        columnSlice(columns.txHashesFile, firstTx, endTx),
+        columnSlice(columns.txFirstInputFile, firstTx, endTx),
+        columnSlice(columns.txFirstOutputFile, firstTx, endTx)
+    }};
+    std::array<uint256, 6> columnHashes;
+    doubleSha256Batch(columnSlices.data(), columnSlices.size(), columnHashes.data());
+    digests.additional = sha256(reinterpret_cast<const uint8_t *>(columnHashes.data()), sizeof(columnHashes));
+    return digests;
+}
 
-    FixedSizeFileMapper<uint16_t> spentOutNumFile(chainAccess.inputSpentOutNumFilePath(chainDirectory));
-    for(uint64_t i = 0; i < chainAccess.inputCount(); ++i) {
-        SHA256_Update(&sha256, spentOutNumFile[i], 2);
+/**
+ Combine the checksums of the chunks of the chain into one.
+ */
+uint256 combine_chunk_digests(const std::vector<ChunkDigests> &chunks, uint256 ChunkDigests::*digest) {
+    std::vector<uint256> digests;
+    digests.reserve(chunks.size());
+    for (auto &chunk : chunks) {
+        digests.push_back(chunk.*digest);
     }
+    return sha256(reinterpret_cast<const uint8_t *>(digests.data()), digests.size() * sizeof(uint256));
+}
 
-    FixedSizeFileMapper<int32_t> txVersionFile(chainAccess.txVersionFilePath(chainDirectory));
-    for(uint32_t i = 0; i < chainAccess.txCount(); ++i) {
-        SHA256_Update(&sha256, txVersionFile[i], 4);
-    }
+/**
+ Check that the blocks link up and that the first input and output numbers and the tx index agree with the
+ transactions of the blocks. Returns the number of problems found.
+ */
+uint64_t check_chain_structure(const DataAccess &access, const AdditionalColumns &columns, const BlockRange &blocks, bool checkTxIndex) {
+    const ChainAccess &chainAccess = access.getChain();
+    auto &hashIndex = access.getHashIndex();
+    uint64_t problemCount = 0;
+    auto report = [&](const std::string &problem) {
+        reportProblem(problem);
+        problemCount++;
+    };
+
+    for (auto block : blocks) {
+        auto height = block.height();
+        const RawBlock *rawBlock = chainAccess.getBlock(height);
+        if (static_cast<BlockHeight>(rawBlock->height) != height) {
+            report("Block " + std::to_string(height) + " has the height " + std::to_string(rawBlock->height) + ".");
+        }
+        if (height > 0) {
+            const RawBlock *prevBlock = chainAccess.getBlock(height - 1);
+            if (rawBlock->firstTxIndex != prevBlock->firstTxIndex + prevBlock->txCount) {
+                report("First transaction of block " + std::to_string(height) + " doesn't follow the previous block.");
+            }
+        }
 
-    FixedSizeFileMapper<uint256> txHashesFile(chainAccess.txHashesFilePath(chainDirectory));
-    for(uint32_t i = 0; i < chainAccess.txCount(); ++i) {
-        SHA256_Update(&sha256, txHashesFile[i], 32);
-    }
+        uint64_t inputNum = chainAccess.getFirstInputNumber(rawBlock->firstTxIndex);
+        uint64_t outputNum = chainAccess.getFirstOutputNumber(rawBlock->firstTxIndex);
+        std::vector<uint256> txHashes;
+        txHashes.reserve(rawBlock->txCount);
+        for (uint32_t txNum = rawBlock->firstTxIndex; txNum < rawBlock->firstTxIndex + rawBlock->txCount; txNum++) {
+            const RawTransaction *tx = chainAccess.getTx(txNum);
+            if (*columns.txFirstInputFile[txNum] != inputNum || *columns.txFirstOutputFile[txNum] != outputNum) {
+                report("Incorrect first input or output number for transaction " + std::to_string(txNum) + ".");
+            }
+            inputNum += tx->inputCount;
+            outputNum += tx->outputCount;
+            txHashes.push_back(*columns.txHashesFile[txNum]);
+        }
+        if (inputNum - chainAccess.getFirstInputNumber(rawBlock->firstTxIndex) != rawBlock->inputCount || outputNum - chainAccess.getFirstOutputNumber(rawBlock->firstTxIndex) != rawBlock->outputCount) {
+            report("Input or output count of block " + std::to_string(height) + " doesn't match its transactions.");
+        }
 
-    FixedSizeFileMapper<uint64_t> txFirstInputFile(chainAccess.firstInputFilePath(chainDirectory));
-    for(uint32_t i = 0; i < chainAccess.txCount(); ++i) {
-        SHA256_Update(&sha256, txFirstInputFile[i], 8);
+        if (checkTxIndex) {
+            // A single batched lookup per block instead of one lookup per transaction
+            auto txIndexes = hashIndex.getTxIndexes(txHashes);
+            for (uint32_t i = 0; i < txIndexes.size(); i++) {
+                auto txNum = rawBlock->firstTxIndex + i;
+                if (!txIndexes[i]) {
+                    report("Found no txindex for transaction " + std::to_string(txNum) + ".");
+                } else if (*txIndexes[i] != txNum) {
+                    report("Incorrect index for transaction " + std::to_string(txNum) + ". Got: " + std::to_string(*txIndexes[i]) + ".");
+                }
+            }
+        }
     }
+    return problemCount;
+}
 
-    FixedSizeFileMapper<uint64_t> txFirstOutputFile(chainAccess.firstOutputFilePath(chainDirectory));
-    for(uint32_t i = 0; i < chainAccess.txCount(); ++i) {
-        SHA256_Update(&sha256, txFirstOutputFile[i], 8);
+/**
+ Verified state of the chain remembered by the incremental mode between runs.
+ */
+struct VerifiedState {
+    /** Number of blocks that were verified and the hash of the last of them */
+    BlockHeight height = 0;
+    uint256 tipHash;
+
+    /** Number of scripthash scripts whose nesting was verified */
+    uint32_t scriptHashCount = 0;
+
+    /** Checksums of the complete chunks of the verified blocks */
+    std::vector<ChunkDigests> chunks;
+
+    static VerifiedState load(const std::string &path) {
+        VerifiedState state;
+        std::ifstream file(path);
+        if (!file) {
+            return state;
+        }
+        size_t chunkCount = 0;
+        std::string tipHash;
+        if (!(file >> state.height >> tipHash >> state.scriptHashCount >> chunkCount)) {
+            throw std::runtime_error("Could not read the integrity check state in " + path);
+        }
+        for (size_t i = 0; i < chunkCount; i++) {
+            std::string lastBlockHash, blocks, txes, additional;
+            if (!(file >> lastBlockHash >> blocks >> txes >> additional)) {
+                throw std::runtime_error("Could not read the integrity check state in " + path);
+            }
+            state.chunks.push_back({uint256S(lastBlockHash), uint256S(blocks), uint256S(txes), uint256S(additional)});
+        }
+        state.tipHash = uint256S(tipHash);
+        return state;
     }
 
-    SHA256_Final(reinterpret_cast<unsigned char *>(&hash), &sha256);
-    return hash;
-}
+    void save(const std::string &path) const {
+        // Replace the state in one step so that an interrupted run keeps the previous state
+        auto tempPath = path + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::trunc);
+            file << height << " " << tipHash.GetHex() << " " << scriptHashCount << " " << chunks.size() << "\n";
+            for (auto &chunk : chunks) {
+                file << chunk.lastBlockHash.GetHex() << " " << chunk.blocks.GetHex() << " " << chunk.txes.GetHex() << " " << chunk.additional.GetHex() << "\n";
+            }
+            if (!file.good()) {
+                throw std::runtime_error("Could not write the integrity check state to " + tempPath);
+            }
+        }
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("Could not replace the integrity check state " + path);
+        }
+    }
+};
 
 template<DedupAddressType::Enum dedupType>
 uint256 compute_scriptdata_hash(const DataAccess &access);
@@ -280,13 +464,39 @@ uint256 compute_scriptdata_hash<DedupAddressType::Enum::WITNESS_UNKNOWN>(const D
     return hash;
 }
 
+/**
+Compute a checksum over taproot data.
+*/
+template<>
+uint256 compute_scriptdata_hash<DedupAddressType::Enum::WITNESS_TAPROOT>(const DataAccess &access) {
+    uint256 hash;
+    SHA256_CTX sha256;
+    SHA256_Init(&sha256);
+
+    auto scripts = &access.getScripts();
+    constexpr DedupAddressType::Enum dedupType = DedupAddressType::WITNESS_TAPROOT;
+    auto scriptCount = scripts->scriptCount(dedupType);
+
+    for(uint32_t i = 1; i <= scriptCount; ++i) {
+        auto data = scripts->getScriptData<dedupType>(i);
+        SHA256_Update(&sha256, &data->outputKey, sizeof(uint256));
+        SHA256_Update(&sha256, &data->spendType, sizeof(data->spendType));
+        SHA256_Update(&sha256, &data->txFirstSeen, 4);
+        SHA256_Update(&sha256, &data->txFirstSpent, 4);
+        SHA256_Update(&sha256, &data->typesSeen, 4);
+    }
+
+    SHA256_Final(reinterpret_cast<unsigned char *>(&hash), &sha256);
+    return hash;
+}
+
 /**
  Compute a checksum over address range in hash index
  */
 template<AddressType::Enum type>
 void hash_addressrange(SHA256_CTX &sha256, const DataAccess &access) {
-    auto &hashIndex = access.hashIndex;
-    auto rng = hashIndex->getAddressRange<type>();
+    auto &hashIndex = access.getHashIndex();
+    auto rng = hashIndex.getAddressRange<type>();
     RANGES_FOR(auto pair, rng) {
         SHA256_Update(&sha256, &pair.first, sizeof(pair.first));
         SHA256_Update(&sha256, &pair.second, sizeof(pair.second));
@@ -308,78 +518,108 @@ uint256 compute_hashindex_addressrange_hash(const DataAccess &access) {
     hash_addressrange<AddressType::SCRIPTHASH>(sha256, access);
     hash_addressrange<AddressType::WITNESS_PUBKEYHASH>(sha256, access);
     hash_addressrange<AddressType::WITNESS_SCRIPTHASH>(sha256, access);
+    hash_addressrange<AddressType::WITNESS_TAPROOT>(sha256, access);
 
     SHA256_Final(reinterpret_cast<unsigned char *>(&hash), &sha256);
     return hash;
 }
 
 /**
- Compute a checksum over txindex lookup data in hash index.
+ Check that we can resolve P2(W)SH addresses from the address they wrap using the address index, for the scripthash
+ scripts [firstScriptNum, endScriptNum). If sampleRate is below 1, only that fraction of them is checked.
+ Returns the number of problems found.
  */
-bool check_hashindex_txindex(const DataAccess &access) {
-    const ChainAccess &chainAccess = access.getChain();
-    auto chainDirectory = access.config.chainDirectory();
-    FixedSizeFileMapper<uint256> txHashesFile(chainAccess.txHashesFilePath(chainDirectory));
-    auto &hashIndex = access.hashIndex;
-
-    bool allIndexesCorrect = true;
-
-    for(uint32_t i = 0; i < chainAccess.txCount(); ++i) {
-        auto txindex = hashIndex->getTxIndex(*txHashesFile[i]);
-        if(*txindex != i) {
-            allIndexesCorrect = false;
-            std::cout << "Incorrect index for transaction " << i << ". Got: " << *txindex << "." << std::endl;
-        }
-    }
-    if(allIndexesCorrect) {
-        std::cout << "All txindex lookups correct for transaction hashes." << std::endl;
-    }
-    return allIndexesCorrect;
-}
-
-
-/**
- Check that we can resolve P2(W)SH addresses from the address they wrap using the address index
- */
-bool check_nesting_scripthash_index(const DataAccess &access) {
+uint64_t check_nesting_scripthash_index(const DataAccess &access, uint32_t firstScriptNum, uint32_t endScriptNum, double sampleRate, uint64_t seed) {
     auto scripts = &access.getScripts();
     constexpr DedupAddressType::Enum dedupType = DedupAddressType::SCRIPTHASH;
-    auto scriptCount = scripts->scriptCount(dedupType);
-    auto &addressIndex = access.addressIndex;
+    auto &addressIndex = access.getAddressIndex();
+    std::mt19937_64 rng(seed);
+    std::bernoulli_distribution sampled(sampleRate);
 
-    bool allNestingsCorrect = true;
+    uint64_t problemCount = 0;
 
-    for(uint32_t i = 1; i <= scriptCount; ++i) {
+    for(uint32_t i = firstScriptNum; i < endScriptNum; ++i) {
+        if(sampleRate < 1 && !sampled(rng)) {
+            continue;
+        }
         auto data = scripts->getScriptData<dedupType>(i);
         if(data->hasWrappedAddress()) {
             RawAddress wrappedAddress = data->wrappedAddress;
             DedupAddress expectedAddress{i, dedupType};
-            auto nestingAddresses = addressIndex->getNestingScriptHash(wrappedAddress);
+            auto nestingAddresses = addressIndex.getNestingScriptHash(wrappedAddress);
 
             // nesting of multisig addresses might not be unique since keys can appear in arbitrary order
+            std::stringstream ss;
             if(nestingAddresses.size() > 0) {
                 if(std::find(nestingAddresses.begin(), nestingAddresses.end(), expectedAddress) == nestingAddresses.end()) {
-                    allNestingsCorrect = false;
-                    std::cout << "Incorrect nesting scripthash for (" << wrappedAddress.scriptNum << ", " << wrappedAddress.type << ")." << std::endl;
+                    ss << "Incorrect nesting scripthash for (" << wrappedAddress.scriptNum << ", " << wrappedAddress.type << ").";
+                    reportProblem(ss.str());
+                    problemCount++;
                 }
             } else {
-                allNestingsCorrect = false;
-                std::cout << "Found no nesting scripthash for (" << wrappedAddress.scriptNum << ", " << wrappedAddress.type << "). Expected: (" << i << ", " << dedupType << ")." << std::endl;
+                ss << "Found no nesting scripthash for (" << wrappedAddress.scriptNum << ", " << wrappedAddress.type << "). Expected: (" << i << ", " << dedupType << ").";
+                reportProblem(ss.str());
+                problemCount++;
             }
         }
     }
-    if(allNestingsCorrect) {
-        std::cout << "All reverse nested lookups correct for wrapped addresses." << std::endl;
+    return problemCount;
+}
+
+/**
+ Verify every chunk of the data files in the chain and scripts directories that have checksums, spreading the chunks
+ of all files over the threads. Returns the number of torn chunks.
+ */
+uint64_t check_file_checksums(const DataConfiguration &config, unsigned int threadCount) {
+    struct ChunkRange {
+        filesystem::path path;
+        const FileChecksums *checksums;
+        size_t firstChunk;
+        size_t endChunk;
+    };
+    // Few chunks per work item so that the single large files don't end up on one thread
+    constexpr size_t chunksPerRange = 4;
+    uint64_t problemCount = 0;
+    std::vector<std::pair<filesystem::path, FileChecksums>> files;
+    for (auto &directory : {config.chainDirectory(), config.scriptsDirectory()}) {
+        for (auto &path : checksummedFiles(directory)) {
+            if (auto checksums = FileChecksums::load(path)) {
+                files.emplace_back(path, std::move(*checksums));
+            } else {
+                reportProblem("Could not read the checksums of " + path.str());
+                problemCount++;
+            }
+        }
     }
-    return allNestingsCorrect;
+    std::vector<ChunkRange> ranges;
+    for (auto &file : files) {
+        for (size_t chunk = 0; chunk < file.second.chunks.size(); chunk += chunksPerRange) {
+            ranges.push_back({file.first, &file.second, chunk, std::min(chunk + chunksPerRange, file.second.chunks.size())});
+        }
+    }
+    problemCount += runParallel(ranges, threadCount, [](const ChunkRange &range) {
+        auto mismatches = range.checksums->verify(range.path, range.firstChunk, range.endChunk);
+        for (auto chunk : mismatches) {
+            std::stringstream ss;
+            ss << "Chunk " << chunk << " of " << range.path.str() << " doesn't match its checksum";
+            reportProblem(ss.str());
+        }
+        return static_cast<uint64_t>(mismatches.size());
+    });
+    return problemCount;
 }
 
 int main(int argc, char * argv[]) {
     std::string configLocation;
     std::string outputFile;
+    std::string stateFile;
     std::ofstream out;
     bool runTxIndexCheck = false;
     bool runNestingIndexCheck = false;
+    bool runFileChecksumCheck = false;
+    double sampleRate = 1;
+    uint64_t seed = std::random_device{}();
+    unsigned int threadCount = std::max(std::thread::hardware_concurrency(), 1u);
     std::streambuf *coutbuf = nullptr;
     int endBlock = 0;
 
@@ -387,14 +627,25 @@ int main(int argc, char * argv[]) {
         clipp::value("config file location", configLocation) % "Path to config file",
         (clipp::option("--file", "-f") & clipp::value("output file", outputFile)) % "Write to file instead of std::cout",
         clipp::option("--txindex", "-t").set(runTxIndexCheck).doc("Run tx index check"),
-        clipp::option("--nestingindex", "-n").set(runNestingIndexCheck).doc("Run nesting address index check")
+        clipp::option("--nestingindex", "-n").set(runNestingIndexCheck).doc("Run nesting address index check"),
+        clipp::option("--checksums", "-c").set(runFileChecksumCheck).doc("Verify every chunk of the data files against the checksums written next to them"),
+        (clipp::option("--threads", "-j") & clipp::value("thread count", threadCount)) % "Number of threads to verify with, defaults to the number of cores",
+        (clipp::option("--incremental", "-i") & clipp::value("state file", stateFile)) % "Only check the blocks added since the height recorded in the state file, and record the new height. Skips the script and hash index checksums",
+        (clipp::option("--sample", "-s") & clipp::value("fraction", sampleRate)) % "Quick health check of a random fraction of the chunks of blocks and scripts, without checksums",
+        (clipp::option("--seed") & clipp::value("seed", seed)) % "Seed of the sampled mode"
     );
 
     auto res = parse(argc, argv, cli);
-    if (res.any_error()) {
+    if (res.any_error() || sampleRate <= 0 || sampleRate > 1) {
         std::cout << "Invalid command line parameter\n" << clipp::make_man_page(cli, argv[0]);
         return 0;
     }
+    bool incremental = !stateFile.empty();
+    bool sampled = sampleRate < 1;
+    if (incremental && sampled) {
+        std::cout << "The incremental and sampled modes can't be combined\n";
+        return 0;
+    }
 
     // Write to file instead of stdout
     if(!outputFile.empty()) {
@@ -407,54 +658,148 @@ int main(int argc, char * argv[]) {
 
     const DataAccess &dataAccess = chain.getAccess();
     const ChainAccess &chainAccess = dataAccess.getChain();
+    AdditionalColumns columns(dataAccess);
 
     std::cout << "Chain contains " << chain.size() << " blocks, " << chain.getAccess().getChain().txCount() << " txes, " << chain.getAccess().getChain().inputCount() << " inputs, " << chain.getAccess().getChain().outputCount() << " outputs." << std::endl;
 
-    std::cout << std::endl << "Blocks:" << std::endl;
-    auto block_hash = compute_block_hash(chainAccess);
-    std::cout << block_hash.GetHex() << " (BLOCKS)" <<  std::endl;
-
-    std::cout << std::endl << "Transactions:" << std::endl;
-    auto txdata_hash = compute_txdata_hash(chainAccess);
-    std::cout << txdata_hash.GetHex() << " (TXES)" << std::endl;
-
-    std::cout << std::endl << "Additional data:" << std::endl;
-    auto additional_data_hash = compute_additional_data_hash(dataAccess);
-    std::cout << additional_data_hash.GetHex() << " (ADDITIONAL)" <<  std::endl;
-
-    std::cout << std::endl << "Scripts:" << std::endl;
-
-    auto scripthash_hash = compute_scriptdata_hash<DedupAddressType::SCRIPTHASH>(dataAccess);
-    std::cout << scripthash_hash.GetHex() <<  " (SCRIPTHASH)" << std::endl;
-
-    auto pubkey_hash = compute_scriptdata_hash<DedupAddressType::PUBKEY>(dataAccess);
-    std::cout << pubkey_hash.GetHex() <<  " (PUBKEY)" << std::endl;
-
-    auto multisig_hash = compute_scriptdata_hash<DedupAddressType::MULTISIG>(dataAccess);
-    std::cout << multisig_hash.GetHex() <<  " (MULTISIG)" << std::endl;
+    // Chunks whose checksums are known from the state of the previous incremental run and still cover the same blocks
+    VerifiedState state;
+    std::vector<ChunkDigests> chunkDigests;
+    BlockHeight firstHeight = 0;
+    if (incremental) {
+        state = VerifiedState::load(stateFile);
+        for (size_t i = 0; i < state.chunks.size(); i++) {
+            auto endHeight = static_cast<BlockHeight>(i + 1) * checksumChunkBlocks;
+            if (endHeight > chain.size() || chainAccess.getBlock(endHeight - 1)->hash != state.chunks[i].lastBlockHash) {
+                break;
+            }
+            chunkDigests.push_back(state.chunks[i]);
+        }
+        // After a reorganization everything from the first changed chunk on is verified again
+        bool reorganized = chunkDigests.size() < state.chunks.size() || state.height > chain.size() || (state.height > 0 && chainAccess.getBlock(state.height - 1)->hash != state.tipHash);
+        firstHeight = reorganized ? static_cast<BlockHeight>(chunkDigests.size()) * checksumChunkBlocks : state.height;
+        std::cout << "Verifying blocks " << firstHeight << " to " << chain.size() << " (" << chunkDigests.size() << " chunks already verified)." << std::endl;
+    }
 
-    auto nulldata_hash = compute_scriptdata_hash<DedupAddressType::NULL_DATA>(dataAccess);
-    std::cout << nulldata_hash.GetHex() <<  " (NULL_DATA)" << std::endl;
+    std::vector<BlockRange> checkedRanges;
+    if (sampled) {
+        std::mt19937_64 rng(seed);
+        std::bernoulli_distribution sampleChunk(sampleRate);
+        std::vector<BlockRange> chunks;
+        for (BlockHeight height = 0; height < chain.size(); height += checksumChunkBlocks) {
+            chunks.push_back(chain[{height, std::min(height + checksumChunkBlocks, chain.size())}]);
+        }
+        for (auto &chunk : chunks) {
+            if (sampleChunk(rng)) {
+                checkedRanges.push_back(chunk);
+            }
+        }
+        if (checkedRanges.empty() && !chunks.empty()) {
+            checkedRanges.push_back(chunks[std::uniform_int_distribution<size_t>(0, chunks.size() - 1)(rng)]);
+        }
+        std::cout << "Checking " << checkedRanges.size() << " of " << chunks.size() << " chunks of " << checksumChunkBlocks << " blocks (seed " << seed << ")." << std::endl;
+    } else if (firstHeight < chain.size()) {
+        checkedRanges = chain[{firstHeight, chain.size()}].segment(threadCount * 4);
+    }
 
-    auto witnessunknown_hash = compute_scriptdata_hash<DedupAddressType::WITNESS_UNKNOWN>(dataAccess);
-    std::cout << witnessunknown_hash.GetHex() <<  " (WITNESS_UNKNOWN)" << std::endl;
+    std::cout << std::endl << "Structure:" << std::endl;
+    if (runTxIndexCheck) {
+        std::cout << "Note: the tx index check will report errors if TXIDs are not unique." << std::endl;
+    }
+    auto structureProblems = runParallel(checkedRanges, threadCount, [&](const BlockRange &blocks) {
+        return check_chain_structure(dataAccess, columns, blocks, runTxIndexCheck);
+    });
+    if(structureProblems == 0) {
+        std::cout << "Blocks, first input and output numbers" << (runTxIndexCheck ? " and txindex lookups" : "") << " consistent." << std::endl;
+    }
 
-    auto nonstandard_hash = compute_scriptdata_hash<DedupAddressType::NONSTANDARD>(dataAccess);
-    std::cout << nonstandard_hash.GetHex() <<  " (NONSTANDARD)" << std::endl;
+    if (!sampled) {
+        // Checksum the chunks that aren't known yet in parallel, they are combined in order afterwards
+        std::vector<BlockRange> missingChunks;
+        for (auto height = static_cast<BlockHeight>(chunkDigests.size()) * checksumChunkBlocks; height < chain.size(); height += checksumChunkBlocks) {
+            missingChunks.push_back(chain[{height, std::min(height + checksumChunkBlocks, chain.size())}]);
+        }
+        auto knownChunkCount = chunkDigests.size();
+        chunkDigests.resize(knownChunkCount + missingChunks.size());
+        runParallel(missingChunks, threadCount, [&](const BlockRange &chunk) {
+            auto chunkHeight = chunk[0].height();
+            chunkDigests[static_cast<size_t>(chunkHeight / checksumChunkBlocks)] = compute_chunk_digests(chainAccess, columns, chunkHeight, chunkHeight + chunk.size());
+            return uint64_t{0};
+        });
+
+        std::cout << std::endl << "Blocks:" << std::endl;
+        std::cout << combine_chunk_digests(chunkDigests, &ChunkDigests::blocks).GetHex() << " (BLOCKS)" <<  std::endl;
+
+        std::cout << std::endl << "Transactions:" << std::endl;
+        std::cout << combine_chunk_digests(chunkDigests, &ChunkDigests::txes).GetHex() << " (TXES)" << std::endl;
+
+        std::cout << std::endl << "Additional data:" << std::endl;
+        std::cout << combine_chunk_digests(chunkDigests, &ChunkDigests::additional).GetHex() << " (ADDITIONAL)" <<  std::endl;
+    }
 
-    std::cout << std::endl << "Hash index:" << std::endl;
-    auto hashindex_addressrange_hash = compute_hashindex_addressrange_hash(dataAccess);
-    std::cout << hashindex_addressrange_hash.GetHex() << " (ADDRESSINDEX)" <<  std::endl;
+    if (!incremental && !sampled) {
+        // The scripts are updated when they are spent, so their checksums always cover all of them
+        std::vector<std::pair<std::string, std::future<uint256>>> scriptHashes;
+        auto launch = [&](std::string name, uint256 (*compute)(const DataAccess &)) {
+            scriptHashes.emplace_back(std::move(name), std::async(std::launch::async, compute, std::cref(dataAccess)));
+        };
+        launch("SCRIPTHASH", compute_scriptdata_hash<DedupAddressType::SCRIPTHASH>);
+        launch("PUBKEY", compute_scriptdata_hash<DedupAddressType::PUBKEY>);
+        launch("MULTISIG", compute_scriptdata_hash<DedupAddressType::MULTISIG>);
+        launch("NULL_DATA", compute_scriptdata_hash<DedupAddressType::NULL_DATA>);
+        launch("WITNESS_UNKNOWN", compute_scriptdata_hash<DedupAddressType::WITNESS_UNKNOWN>);
+        launch("WITNESS_TAPROOT", compute_scriptdata_hash<DedupAddressType::WITNESS_TAPROOT>);
+        launch("NONSTANDARD", compute_scriptdata_hash<DedupAddressType::NONSTANDARD>);
+        auto hashindexAddressRangeHash = std::async(std::launch::async, compute_hashindex_addressrange_hash, std::cref(dataAccess));
+
+        std::cout << std::endl << "Scripts:" << std::endl;
+        for (auto &scriptHash : scriptHashes) {
+            std::cout << scriptHash.second.get().GetHex() << " (" << scriptHash.first << ")" << std::endl;
+        }
 
-    if(runTxIndexCheck) {
-        std::cout << std::endl << "Index: transaction hash->transaction index:" << std::endl;
-        std::cout << "Note: this check will report errors if TXIDs are not unique." << std::endl;
-        check_hashindex_txindex(dataAccess);
+        std::cout << std::endl << "Hash index:" << std::endl;
+        std::cout << hashindexAddressRangeHash.get().GetHex() << " (ADDRESSINDEX)" <<  std::endl;
     }
 
+    auto scriptHashCount = dataAccess.getScripts().scriptCount(DedupAddressType::SCRIPTHASH);
     if(runNestingIndexCheck) {
         std::cout << std::endl << "Index: nesting address->parent address:" << std::endl;
-        check_nesting_scripthash_index(dataAccess);
+        uint32_t firstScriptNum = incremental ? std::min(state.scriptHashCount, scriptHashCount) + 1 : 1;
+        uint32_t endScriptNum = scriptHashCount + 1;
+        uint32_t rangeSize = std::max<uint32_t>((endScriptNum - std::min(firstScriptNum, endScriptNum)) / (threadCount * 4), 1);
+        std::vector<std::pair<uint32_t, uint32_t>> scriptRanges;
+        for (uint32_t scriptNum = firstScriptNum; scriptNum < endScriptNum; scriptNum += rangeSize) {
+            scriptRanges.emplace_back(scriptNum, std::min(scriptNum + rangeSize, endScriptNum));
+        }
+        auto nestingProblems = runParallel(scriptRanges, threadCount, [&](const std::pair<uint32_t, uint32_t> &scriptRange) {
+            return check_nesting_scripthash_index(dataAccess, scriptRange.first, scriptRange.second, sampleRate, seed + scriptRange.first);
+        });
+        if(nestingProblems == 0) {
+            std::cout << "All reverse nested lookups correct for wrapped addresses." << std::endl;
+        }
+        structureProblems += nestingProblems;
+    }
+
+    if (runFileChecksumCheck) {
+        std::cout << std::endl << "Data file checksums:" << std::endl;
+        auto checksumProblems = check_file_checksums(dataAccess.config, threadCount);
+        if (checksumProblems == 0) {
+            std::cout << "All checksummed data files match." << std::endl;
+        }
+        structureProblems += checksumProblems;
+    }
+
+    if (incremental) {
+        if (structureProblems == 0) {
+            // Only complete chunks are remembered, the last partial chunk is checksummed again by the next run
+            state.height = chain.size();
+            state.tipHash = chain.size() > 0 ? chainAccess.getBlock(chain.size() - 1)->hash : uint256{};
+            state.scriptHashCount = runNestingIndexCheck ? scriptHashCount : state.scriptHashCount;
+            state.chunks.assign(chunkDigests.begin(), chunkDigests.begin() + static_cast<std::ptrdiff_t>(static_cast<size_t>(chain.size() / checksumChunkBlocks)));
+            state.save(stateFile);
+        } else {
+            std::cout << "Not recording the verified height since problems were found." << std::endl;
+        }
     }
 
     if((!outputFile.empty()) && (coutbuf != nullptr)) {
@@ -462,5 +807,5 @@ int main(int argc, char * argv[]) {
         out.close();
     }
 
-    return 0;
+    return structureProblems == 0 ? 0 : 1;
 }
@@ -9,9 +9,13 @@
 #define BLOCKSCI_WITHOUT_SINGLETON
 
 #include "file_writer.hpp"
+#ifdef BLOCKSCI_WITH_ZMQ
+#include "zmq_subscriber.hpp"
+#endif
 
 #include <blocksci/chain/blockchain.hpp>
 #include <blocksci/chain/block.hpp>
+#include <blocksci/chain/mempool_snapshot.hpp>
 
 #include <internal/bitcoin_uint256_hex.hpp>
 #include <internal/data_access.hpp>
@@ -26,11 +30,14 @@
 #include <range/v3/range_for.hpp>
 
 #include <chrono>
+#include <cmath>
 #include <ctime>
 #include <iomanip>
 #include <iostream>
 #include <future>
 #include <sstream>
+#include <algorithm>
+#include <array>
 #include <unordered_map>
 
 #include <csignal>
@@ -61,14 +68,47 @@ int initializeRecordingFile(Blockchain &chain) {
     return fileNum;
 }
 
+/** Time a tx or block was first seen, split into the seconds of MempoolRecord/BlockRecord and the remaining milliseconds */
+struct Observation {
+    time_t time;
+    uint16_t milliseconds;
+    
+    static Observation now() {
+        auto tp = system_clock::now();
+        auto millis = duration_cast<milliseconds>(tp.time_since_epoch()).count() % 1000;
+        return {system_clock::to_time_t(tp), static_cast<uint16_t>(millis)};
+    }
+};
+
 struct MempoolFiles {
     FixedSizeFileWriter<MempoolRecord> txTimeFile;
     FixedSizeFileWriter<BlockRecord> blockTimeFile;
+    FixedSizeFileWriter<uint16_t> txMillisecondFile;
+    FixedSizeFileWriter<uint16_t> blockMillisecondFile;
     
     MempoolFiles(const filesystem::path &mempoolPath, int fileNum) :
     txTimeFile(mempoolPath/(std::to_string(fileNum) + "_tx")),
-    blockTimeFile(mempoolPath/(std::to_string(fileNum) + "_block"))
+    blockTimeFile(mempoolPath/(std::to_string(fileNum) + "_block")),
+    txMillisecondFile(mempoolPath/(std::to_string(fileNum) + "_tx_ms")),
+    blockMillisecondFile(mempoolPath/(std::to_string(fileNum) + "_block_ms"))
     {}
+    
+    void writeTx(const Observation &observation) {
+        txTimeFile.write({observation.time});
+        txMillisecondFile.write(observation.milliseconds);
+    }
+    
+    void writeBlock(const Observation &observation) {
+        blockTimeFile.write({observation.time});
+        blockMillisecondFile.write(observation.milliseconds);
+    }
+    
+    void flush() {
+        txTimeFile.flush();
+        blockTimeFile.flush();
+        txMillisecondFile.flush();
+        blockMillisecondFile.flush();
+    }
 };
 
 class SaferBitcoinApi {
@@ -97,18 +137,39 @@ public:
     std::vector<std::string> getrawmempool() {
         return bitcoinAPI.getrawmempool();
     }
+    
+    /** Fees, sizes and in-mempool parents of every tx in the mempool, keyed by txid */
+    Json::Value getrawmempoolVerbose() {
+        Json::Value params(Json::arrayValue);
+        params.append(true);
+        return bitcoinAPI.sendcommand("getrawmempool", params);
+    }
+    
+    getrawtransaction_t getrawtransaction(const std::string &txid) {
+        return bitcoinAPI.getrawtransaction(txid, 1);
+    }
 };
 
 class MempoolRecorder {
     blocksci::Blockchain chain;
     blocksci::BlockHeight lastHeight;
-    std::unordered_map<blocksci::uint256, MempoolRecord, std::hash<blocksci::uint256>> mempool;
+    std::unordered_map<blocksci::uint256, Observation, std::hash<blocksci::uint256>> mempool;
     SaferBitcoinApi &bitcoinAPI;
     
     MempoolFiles files;
-    std::unordered_map<std::string, std::pair<BlockRecord, int>> blocksSeen;
+    std::unordered_map<std::string, std::pair<Observation, int>> blocksSeen;
+    
+    /** Outputs spent by the mempool txes decoded so far */
+    std::unordered_map<blocksci::uint256, std::vector<std::pair<blocksci::uint256, uint16_t>>, std::hash<blocksci::uint256>> decodedInputs;
     
     static constexpr int heightCutoff = 1000;
+    
+    /** Txes decoded over RPC per snapshot, so that a full mempool after a restart doesn't stall recording */
+    static constexpr size_t maxDecodesPerSnapshot = 2000;
+    
+    static int64_t toSatoshi(const Json::Value &btc) {
+        return static_cast<int64_t>(std::llround(btc.asDouble() * 1e8));
+    }
 
 public:
     MempoolRecorder(const std::string &configLocation, SaferBitcoinApi &bitcoinAPI_) :
@@ -116,44 +177,66 @@ public:
     lastHeight(static_cast<int>(chain.size())),
     bitcoinAPI(bitcoinAPI_),
     files(chain.getAccess().config.mempoolDirectory(), initializeRecordingFile(chain)) {
-        updateBlockTimes(0);
-        updateTxTimes(1);
+        updateBlockTimes({0, 0});
+        updateTxTimes({1, 0});
     }
     
-    void updateBlockTimes(time_t time) {
+    void updateBlockTimes(Observation time) {
         auto tips = bitcoinAPI.getchaintips();
         auto currentHeight = bitcoinAPI.getblockcount();
         for(auto &tip : tips) {
             std::string searchBlock = std::move(tip.hash);
             int height = tip.height;
             while (height >= std::max(currentHeight - heightCutoff, 0) &&
-                   blocksSeen.insert(std::pair<std::string, std::pair<BlockRecord, int>>(searchBlock, {BlockRecord{time}, height})).second) {
+                   blocksSeen.insert(std::pair<std::string, std::pair<Observation, int>>(searchBlock, {time, height})).second) {
                 searchBlock = bitcoinAPI.getpreviousblockhash(searchBlock);
                 height--;
             }
         }
     }
     
-    void updateTxTimes(time_t time) {
+    void updateTxTimes(Observation time) {
         auto rawMempool = bitcoinAPI.getrawmempool();
         for (auto &txHashString : rawMempool) {
-            auto txHash = uint256S(txHashString);
-            auto it = mempool.find(txHash);
-            if (it == mempool.end()) {
-                mempool[txHash] = {time};
-            }
+            mempool.emplace(uint256S(txHashString), time);
         }
     }
 
     // Update our view of the mempool
     void updateMempool() {
         try {
-            updateTxTimes(system_clock::to_time_t(system_clock::now()));
-            updateBlockTimes(system_clock::to_time_t(system_clock::now()));
+            updateTxTimes(Observation::now());
+            updateBlockTimes(Observation::now());
         } catch (BitcoinException& e){
             std::cerr << "Failed to update mempool with error: " << e.what() << std::endl;
         }
     }
+    
+#ifdef BLOCKSCI_WITH_ZMQ
+    /** Record a message of bitcoind's ZMQ sequence topic: <32 byte hash><label>[<8 byte mempool sequence>]
+     *
+     * A is a tx added to the mempool and C a connected block, both are timestamped on arrival. Txes which are
+     * announced by C blocks without having been in the mempool stay unobserved like in polling mode. */
+    void processSequenceNotification(const std::vector<unsigned char> &body) {
+        if (body.size() < 33) {
+            return;
+        }
+        // The hash is published in the byte order of its hex representation
+        std::array<unsigned char, 32> hashBytes;
+        std::reverse_copy(body.begin(), body.begin() + 32, hashBytes.begin());
+        blocksci::uint256 hash{hashBytes.begin(), hashBytes.end()};
+        auto label = body[32];
+        if (label == 'A') {
+            mempool.emplace(hash, Observation::now());
+        } else if (label == 'C') {
+            try {
+                blocksSeen.emplace(hash.GetHex(), std::make_pair(Observation::now(), bitcoinAPI.getblockcount()));
+            } catch (BitcoinException& e){
+                std::cerr << "Failed to look up block height with error: " << e.what() << std::endl;
+            }
+        }
+    }
+#endif
 
     // Write timestamps for transactions and blocks that were observed in the mempool
     void recordMempool() {
@@ -171,36 +254,33 @@ public:
         auto blockCount = static_cast<BlockHeight>(chain.size());
         for (; lastHeight < blockCount; lastHeight++) {
             auto block = chain[lastHeight];
-            time_t time;
+            Observation time;
             auto blockIt = blocksSeen.find(block.getHash().GetHex());
             std::stringstream ss;
             if (blockIt == blocksSeen.end()) {
                 ss << "Block at height " << lastHeight << " hasn't been observed in the network.";
-                system_clock::time_point tp = system_clock::now();
-                time = system_clock::to_time_t(tp);
+                time = Observation::now();
             } else {
                 ss << "Block at height " << lastHeight << "has been observed in the network.";
-                time = blockIt->second.first.observationTime;
+                time = blockIt->second.first;
             }
             print_msg(ss.str(), true);
-            files.blockTimeFile.write({time});
+            files.writeBlock(time);
             RANGES_FOR(auto tx, chain[lastHeight]) {
                 allTxs += 1;
                 auto it = mempool.find(tx.getHash());
                 if (it != mempool.end()) {
                     txWithTimestamp += 1;
-                    auto &txData = it->second;
-                    files.txTimeFile.write(txData);
+                    files.writeTx(it->second);
                     mempool.erase(it);
                 } else {
-                    files.txTimeFile.write({0});
+                    files.writeTx({0, 0});
                 }
             }
         }
 
         if(newBlocks > 0) {
-            files.txTimeFile.flush();
-            files.blockTimeFile.flush();
+            files.flush();
 
             std::stringstream ss;
             ss << "Added mempool data for " << newBlocks << " blocks and " << txWithTimestamp << " out of " << allTxs << " transactions.";
@@ -208,6 +288,85 @@ public:
         }
     }
 
+    // Write the snapshot of the mempool with fees and packages that Blockchain.pendingTransactions() reads
+    void writeSnapshot() {
+        // The inputs are linked to the chain through the hash index, which the parser may be updating
+        if(chain.isParserRunning()) {
+            return;
+        }
+        
+        Json::Value rawMempool;
+        try {
+            rawMempool = bitcoinAPI.getrawmempoolVerbose();
+        } catch (BitcoinException& e){
+            std::cerr << "Failed to load mempool entries with error: " << e.what() << std::endl;
+            return;
+        }
+        
+        std::vector<MempoolEntry> entries;
+        entries.reserve(rawMempool.size());
+        size_t decodes = 0;
+        for (auto it = rawMempool.begin(); it != rawMempool.end(); ++it) {
+            auto &val = *it;
+            MempoolEntry entry;
+            entry.hash = uint256S(it.key().asString());
+            // Nodes before 0.19 report the fee directly instead of a fees object
+            entry.fee = toSatoshi(val.isMember("fees") ? val["fees"]["base"] : val["fee"]);
+            entry.vsize = val.isMember("vsize") ? val["vsize"].asUInt() : val["size"].asUInt();
+            auto observed = mempool.find(entry.hash);
+            if (observed != mempool.end()) {
+                entry.firstSeen = static_cast<int64_t>(observed->second.time) * 1000 + observed->second.milliseconds;
+            } else {
+                entry.firstSeen = val["time"].asInt64() * 1000;
+            }
+            for (auto &parent : val["depends"]) {
+                entry.parents.push_back(uint256S(parent.asString()));
+            }
+            
+            auto decoded = decodedInputs.find(entry.hash);
+            if (decoded == decodedInputs.end() && decodes < maxDecodesPerSnapshot) {
+                try {
+                    auto txinfo = bitcoinAPI.getrawtransaction(it.key().asString());
+                    decodes++;
+                    std::vector<std::pair<blocksci::uint256, uint16_t>> inputs;
+                    for (auto &vin : txinfo.vin) {
+                        inputs.emplace_back(uint256S(vin.txid), static_cast<uint16_t>(vin.n));
+                    }
+                    decoded = decodedInputs.emplace(entry.hash, std::move(inputs)).first;
+                } catch (BitcoinException &) {
+                    // The tx left the mempool since getrawmempool
+                }
+            }
+            if (decoded != decodedInputs.end()) {
+                entry.inputs = decoded->second;
+                entry.inputsKnown = true;
+            }
+            entries.push_back(std::move(entry));
+        }
+        
+        // Forget the inputs of txes which left the mempool
+        for (auto it = decodedInputs.begin(); it != decodedInputs.end();) {
+            if (!rawMempool.isMember(it->first.GetHex())) {
+                it = decodedInputs.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        
+        chain.reload();
+        auto timestamp = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+        try {
+            writeMempoolSnapshot(entries, timestamp, chain.getAccess());
+        } catch (std::runtime_error &e) {
+            std::cerr << "Failed to write mempool snapshot with error: " << e.what() << std::endl;
+            return;
+        }
+        
+        std::stringstream ss;
+        ss << "Wrote mempool snapshot of " << entries.size() << " transactions, decoded " << decodes << " new transactions.";
+        print_msg(ss.str(), true);
+    }
+
     // Clear transactions and blocks that were not included in the chain in more than 5 days
     void clearOldMempool() {
         int oldTxs = 0;
@@ -263,10 +422,12 @@ int main(int argc, char * argv[]) {
     sigaction(SIGTERM, &action, nullptr);
     
     std::string configFilePathString;
+    std::string zmqEndpoint;
     auto configFileOption = clipp::value("config file", configFilePathString) % "Path to config file";
     auto cli = (
                 clipp::value("config file", configFilePathString) % "Path to config file",
-                clipp::option("-v", "--verbose").set(verbose).doc("run in verbose mode")
+                clipp::option("-v", "--verbose").set(verbose).doc("run in verbose mode"),
+                (clipp::option("--zmq") & clipp::value("endpoint", zmqEndpoint)) % "Subscribe to the ZMQ sequence notifications of the node (bitcoind -zmqpubsequence=<endpoint>) instead of polling its mempool"
                 );
     
     auto res = parse(argc, argv, cli);
@@ -298,6 +459,54 @@ int main(int argc, char * argv[]) {
         }
     }
     
+#ifdef BLOCKSCI_WITH_ZMQ
+    if (!zmqEndpoint.empty()) {
+        // Subscribe before taking the initial RPC snapshot of the mempool so that no tx falls between the two
+        ZmqSubscriber subscriber{zmqEndpoint, {"sequence"}};
+        MempoolRecorder recorder{configFilePath.str(), bitcoinAPI};
+        std::cout << "Subscribed to ZMQ notifications at " << zmqEndpoint << std::endl;
+        
+        auto lastRecord = steady_clock::now();
+        auto lastSnapshot = steady_clock::now();
+        auto lastClear = steady_clock::now();
+        bool haveSequence = false;
+        uint32_t lastSequence = 0;
+        while(!done) {
+            ZmqNotification notification;
+            if (subscriber.receive(notification, 250)) {
+                if (haveSequence && notification.sequence != lastSequence + 1) {
+                    // Notifications were dropped, fall back to RPC to catch up on the mempool and chain tips
+                    recorder.print_msg("Missed ZMQ notifications, resyncing mempool over RPC");
+                    recorder.updateMempool();
+                }
+                haveSequence = true;
+                lastSequence = notification.sequence;
+                recorder.processSequenceNotification(notification.body);
+            }
+            auto now = steady_clock::now();
+            if (now - lastRecord >= minutes(1)) {
+                recorder.recordMempool();
+                lastRecord = now;
+            }
+            if (now - lastSnapshot >= seconds(10)) {
+                recorder.writeSnapshot();
+                lastSnapshot = now;
+            }
+            if (now - lastClear >= hours(24)) {
+                recorder.clearOldMempool();
+                lastClear = now;
+            }
+        }
+        std::cout << "Shut down mempool recorder\n";
+        return 0;
+    }
+#else
+    if (!zmqEndpoint.empty()) {
+        std::cerr << "mempool_recorder was built without ZMQ support, install libzmq and rebuild to use --zmq" << std::endl;
+        return 1;
+    }
+#endif
+    
     MempoolRecorder recorder{configFilePath.str(), bitcoinAPI};
     
     int updateCount = 0;
@@ -305,6 +514,9 @@ int main(int argc, char * argv[]) {
         std::this_thread::sleep_for(std::chrono::milliseconds(250));
         recorder.updateMempool();
         updateCount++;
+        if (updateCount % (4 * 10) == 0) { // every 10 seconds
+            recorder.writeSnapshot();
+        }
         if (updateCount % (4 * 60) == 0) { // every minute
             recorder.recordMempool();
         }
@@ -0,0 +1,106 @@
+//
+//  zmq_subscriber.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef zmq_subscriber_hpp
+#define zmq_subscriber_hpp
+
+#include <zmq.h>
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/** Message published by bitcoind on one of its -zmqpub* topics */
+struct ZmqNotification {
+    std::string topic;
+    std::vector<unsigned char> body;
+
+    /** Per topic counter of bitcoind, a gap means that messages were dropped */
+    uint32_t sequence = 0;
+};
+
+/** Subscription to the ZMQ notifications of bitcoind */
+class ZmqSubscriber {
+    void *context;
+    void *socket;
+
+    static std::runtime_error zmqError(const std::string &what) {
+        return std::runtime_error(what + ": " + zmq_strerror(zmq_errno()));
+    }
+
+    /** Receive the next part of a multipart message, returns false if there are no further parts */
+    bool receivePart(std::vector<unsigned char> &data, bool &more) {
+        zmq_msg_t msg;
+        zmq_msg_init(&msg);
+        if (zmq_msg_recv(&msg, socket, 0) == -1) {
+            zmq_msg_close(&msg);
+            return false;
+        }
+        auto begin = static_cast<const unsigned char *>(zmq_msg_data(&msg));
+        data.assign(begin, begin + zmq_msg_size(&msg));
+        more = zmq_msg_more(&msg) != 0;
+        zmq_msg_close(&msg);
+        return true;
+    }
+
+public:
+    ZmqSubscriber(const std::string &endpoint, const std::vector<std::string> &topics) : context(zmq_ctx_new()), socket(zmq_socket(context, ZMQ_SUB)) {
+        if (socket == nullptr) {
+            zmq_ctx_term(context);
+            throw zmqError("Failed to create ZMQ socket");
+        }
+        // Queue notifications while the recorder writes to disk instead of dropping them
+        int highWaterMark = 0;
+        zmq_setsockopt(socket, ZMQ_RCVHWM, &highWaterMark, sizeof(highWaterMark));
+        for (auto &topic : topics) {
+            zmq_setsockopt(socket, ZMQ_SUBSCRIBE, topic.data(), topic.size());
+        }
+        if (zmq_connect(socket, endpoint.c_str()) != 0) {
+            auto error = zmqError("Failed to connect to " + endpoint);
+            zmq_close(socket);
+            zmq_ctx_term(context);
+            throw error;
+        }
+    }
+
+    ZmqSubscriber(const ZmqSubscriber &) = delete;
+    ZmqSubscriber &operator=(const ZmqSubscriber &) = delete;
+
+    ~ZmqSubscriber() {
+        zmq_close(socket);
+        zmq_ctx_term(context);
+    }
+
+    /** Wait up to timeoutMs for the next notification, returns false if none arrived */
+    bool receive(ZmqNotification &notification, long timeoutMs) {
+        zmq_pollitem_t items[] = {{socket, 0, ZMQ_POLLIN, 0}};
+        if (zmq_poll(items, 1, timeoutMs) <= 0 || !(items[0].revents & ZMQ_POLLIN)) {
+            return false;
+        }
+
+        // bitcoind sends [topic, body, 4 byte little endian sequence number]
+        std::vector<std::vector<unsigned char>> parts;
+        bool more = true;
+        while (more) {
+            parts.emplace_back();
+            if (!receivePart(parts.back(), more)) {
+                return false;
+            }
+        }
+        if (parts.size() != 3 || parts[2].size() != 4) {
+            return false;
+        }
+        notification.topic.assign(parts[0].begin(), parts[0].end());
+        notification.body = std::move(parts[1]);
+        notification.sequence = static_cast<uint32_t>(parts[2][0]) | (static_cast<uint32_t>(parts[2][1]) << 8) | (static_cast<uint32_t>(parts[2][2]) << 16) | (static_cast<uint32_t>(parts[2][3]) << 24);
+        return true;
+    }
+};
+
+#endif /* zmq_subscriber_hpp */
@@ -14,6 +14,10 @@
 #include <blocksci/core/inout_pointer.hpp>
 
 #include <internal/address_info.hpp>
+#include <internal/address_tables.hpp>
+
+#include <algorithm>
+#include <iostream>
 
 using blocksci::RawAddress;
 using blocksci::DedupAddress;
@@ -21,7 +25,14 @@ using blocksci::InoutPointer;
 using blocksci::State;
 using blocksci::DedupAddressType;
 
-AddressDB::AddressDB(const ParserConfigurationBase &config_, const filesystem::path &path) : ParserIndex(config_, "addressDB"), db(path, false) {
+namespace {
+    // A rebuild rewrites all outputs and relations, so it is only done once the RocksDB part has grown by a significant fraction
+    // of the chain
+    constexpr uint32_t minAddressTableTail = 10'000'000;
+    constexpr uint32_t addressTableTailFraction = 8;
+}
+
+AddressDB::AddressDB(const ParserConfigurationBase &config_, const filesystem::path &path) : ParserIndex(config_, "addressDB"), db(path, blocksci::IndexOpenMode::ReadWrite, nullptr, config_.dataConfig.addressIndexTuning) {
     outputCache.reserve(cacheSize);
     nestedCache.reserve(cacheSize);
 }
@@ -31,32 +42,93 @@ AddressDB::~AddressDB() {
     clearOutputCache();
 }
 
-void AddressDB::processTx(const blocksci::RawTransaction *tx, uint32_t txNum, const blocksci::ChainAccess &, const blocksci::ScriptAccess &scripts) {
-    std::unordered_set<RawAddress> addedAddresses;
-    std::function<bool(const RawAddress &)> visitFunc = [&](const RawAddress &a) {
-        if (dedupType(a.type) == DedupAddressType::SCRIPTHASH && addedAddresses.find(a) == addedAddresses.end()) {
-            addedAddresses.insert(a);
-            auto scriptHash = scripts.getScriptData<DedupAddressType::SCRIPTHASH>(a.scriptNum);
-            if (scriptHash->txFirstSpent == txNum) {
-                addAddressNested(scriptHash->wrappedAddress, DedupAddress{a.scriptNum, DedupAddressType::SCRIPTHASH});
-                return true;
+void AddressDB::beginBulkLoad() {
+    clearNestedCache();
+    clearOutputCache();
+    db.beginBulkLoad();
+}
+
+void AddressDB::finishBulkLoad() {
+    clearNestedCache();
+    clearOutputCache();
+    db.finishBulkLoad();
+}
+
+namespace {
+    /** Call nestedFunc with every nesting relation and outputFunc with every output link the tx adds to the index */
+    template <typename NestedFunc, typename OutputFunc>
+    void visitTxEntries(const blocksci::RawTransaction *tx, uint32_t txNum, const blocksci::ScriptAccess &scripts, NestedFunc &&nestedFunc, OutputFunc &&outputFunc) {
+        std::unordered_set<RawAddress> addedAddresses;
+        std::function<bool(const RawAddress &)> visitFunc = [&](const RawAddress &a) {
+            if (dedupType(a.type) == DedupAddressType::SCRIPTHASH && addedAddresses.find(a) == addedAddresses.end()) {
+                addedAddresses.insert(a);
+                auto scriptHash = scripts.getScriptData<DedupAddressType::SCRIPTHASH>(a.scriptNum);
+                if (scriptHash->txFirstSpent == txNum) {
+                    nestedFunc(scriptHash->wrappedAddress, DedupAddress{a.scriptNum, DedupAddressType::SCRIPTHASH});
+                    return true;
+                } else {
+                    return false;
+                }
             } else {
                 return false;
             }
-        } else {
-            return false;
+        };
+        auto inputs = ranges::make_subrange(tx->beginInputs(), tx->endInputs());
+        for (auto &input : inputs) {
+            visit(RawAddress{input.getAddressNum(), input.getType()}, visitFunc, scripts);
+        }
+        
+        for (uint16_t i = 0; i < tx->outputCount; i++) {
+            auto &output = tx->getOutput(i);
+            auto pointer = InoutPointer{txNum, i};
+            outputFunc(blocksci::RawAddress{output.getAddressNum(), output.getType()}, pointer);
         }
-    };
-    auto inputs = ranges::make_subrange(tx->beginInputs(), tx->endInputs());
-    for (auto &input : inputs) {
-        visit(RawAddress{input.getAddressNum(), input.getType()}, visitFunc, scripts);
     }
+}
+
+void AddressDB::processTx(const blocksci::RawTransaction *tx, uint32_t txNum, const blocksci::ChainAccess &, const blocksci::ScriptAccess &scripts) {
+    visitTxEntries(tx, txNum, scripts, [&](const RawAddress &child, const DedupAddress &parent) {
+        addAddressNested(child, parent);
+    }, [&](const RawAddress &address, const InoutPointer &pointer) {
+        addAddressOutput(address, pointer);
+    });
+}
+
+void AddressDB::rollback(const State &state, const blocksci::ChainAccess &chain, const blocksci::ScriptAccess &scripts) {
+    clearNestedCache();
+    clearOutputCache();
     
-    for (uint16_t i = 0; i < tx->outputCount; i++) {
-        auto &output = tx->getOutput(i);
-        auto pointer = InoutPointer{txNum, i};
-        addAddressOutput(blocksci::RawAddress{output.getAddressNum(), output.getType()}, pointer);
+    std::vector<std::pair<RawAddress, DedupAddress>> relations;
+    std::vector<std::pair<RawAddress, InoutPointer>> outputs;
+    for (uint32_t txNum = state.txCount; txNum < latestState.txCount; txNum++) {
+        visitTxEntries(chain.getTx(txNum), txNum, scripts, [&](const RawAddress &child, const DedupAddress &parent) {
+            relations.emplace_back(child, parent);
+        }, [&](const RawAddress &address, const InoutPointer &pointer) {
+            outputs.emplace_back(address, pointer);
+        });
+    }
+    
+    auto multisigIndex = static_cast<size_t>(DedupAddressType::MULTISIG);
+    for (uint32_t scriptNum = state.scriptCounts[multisigIndex] + 1; scriptNum <= latestState.scriptCounts[multisigIndex]; scriptNum++) {
+        auto multisig = scripts.getScriptData<DedupAddressType::MULTISIG>(scriptNum);
+        for (const auto &addressNum : multisig->addresses) {
+            relations.emplace_back(RawAddress{addressNum, blocksci::AddressType::MULTISIG_PUBKEY}, DedupAddress{scriptNum, DedupAddressType::MULTISIG});
+        }
     }
+    
+    db.removeNestedAddresses(relations);
+    db.removeOutputAddresses(outputs);
+    rollbackProgress(state);
+}
+
+void AddressDB::rollbackAddressTables(const filesystem::path &directory, uint32_t txCount, const blocksci::ScriptAccess &scripts) {
+    if (blocksci::AddressTables{directory}.txCount() <= txCount) {
+        return;
+    }
+    std::cout << "Removing reorganized transactions from the address tables\n";
+    clearNestedCache();
+    clearOutputCache();
+    db.rebuildAddressTables(directory, txCount, scripts);
 }
 
 void AddressDB::addAddressNested(const blocksci::RawAddress &childAddress, const blocksci::DedupAddress &parentAddress) {
@@ -82,3 +154,16 @@ void AddressDB::clearOutputCache() {
     db.addOutputAddresses(std::move(outputCache));
     outputCache.clear();
 }
+
+void AddressDB::updateAddressTables(const filesystem::path &directory, uint32_t txCount, const blocksci::ScriptAccess &scripts) {
+    uint32_t coveredCount = blocksci::AddressTables{directory}.txCount();
+    auto tailCount = txCount - std::min(coveredCount, txCount);
+    if (tailCount < std::max(minAddressTableTail, coveredCount / addressTableTailFraction)) {
+        return;
+    }
+    
+    std::cout << "Moving address outputs and relations of " << txCount << " transactions into the address tables\n";
+    clearNestedCache();
+    clearOutputCache();
+    db.rebuildAddressTables(directory, txCount, scripts);
+}
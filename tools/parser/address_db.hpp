@@ -47,6 +47,23 @@ public:
     void addAddressNested(const blocksci::RawAddress &childAddress, const blocksci::DedupAddress &parentAddress);
     void addAddressOutput(const blocksci::RawAddress &address, const blocksci::InoutPointer &pointer);
     
+    /** Load everything that is processed until finishBulkLoad() through ingested table files, @see blocksci::AddressIndex::beginBulkLoad() */
+    void beginBulkLoad();
+    void finishBulkLoad();
+    
+    /** Merge the outputs and relations in the RocksDB index into new AddressTables in directory once enough
+     * transactions were added since they were last built */
+    void updateAddressTables(const filesystem::path &directory, uint32_t txCount, const blocksci::ScriptAccess &scripts);
+    
+    /** Remove the outputs and nesting relations that the transactions and scripts beyond state added to the index
+     *
+     * Called after a reorganization while the chain and scripts still contain the undone blocks. */
+    void rollback(const blocksci::State &state, const blocksci::ChainAccess &chain, const blocksci::ScriptAccess &scripts);
+    
+    /** Rebuild the AddressTables in directory without the undone transactions if they cover any, called once the
+     * chain and scripts were rolled back to txCount */
+    void rollbackAddressTables(const filesystem::path &directory, uint32_t txCount, const blocksci::ScriptAccess &scripts);
+    
     void compact() {
         db.compactDB();
     }
@@ -8,12 +8,14 @@
 
 #include "address_state.hpp"
 #include "parser_configuration.hpp"
+#include "parser_telemetry.hpp"
 
 #include <blocksci/core/bitcoin_uint256.hpp>
 
 #include <internal/address_info.hpp>
 
 #include <fstream>
+#include <iomanip>
 #include <string>
 #include <sstream>
 
@@ -44,9 +46,27 @@ AddressState::AddressState(filesystem::path path_, HashIndexCreator &hashDb) : p
             scriptIndexes.push_back(1);
         }
     }
+    
+    // Filters left behind in the old single file format are filled again from the hash index
+    if (std::get<AddressBloomFilterPointer<blocksci::DedupAddressType::PUBKEY>>(addressBloomFilters)->needsRebuild()) {
+        reloadBloomFilter<blocksci::DedupAddressType::PUBKEY>();
+    }
+    if (std::get<AddressBloomFilterPointer<blocksci::DedupAddressType::SCRIPTHASH>>(addressBloomFilters)->needsRebuild()) {
+        reloadBloomFilter<blocksci::DedupAddressType::SCRIPTHASH>();
+    }
+    if (std::get<AddressBloomFilterPointer<blocksci::DedupAddressType::MULTISIG>>(addressBloomFilters)->needsRebuild()) {
+        reloadBloomFilter<blocksci::DedupAddressType::MULTISIG>();
+    }
+    if (std::get<AddressBloomFilterPointer<blocksci::DedupAddressType::WITNESS_TAPROOT>>(addressBloomFilters)->needsRebuild()) {
+        reloadBloomFilter<blocksci::DedupAddressType::WITNESS_TAPROOT>();
+    }
 }
 
 AddressState::~AddressState() {
+    serialize();
+}
+
+void AddressState::serialize() {
     blocksci::for_each(multiAddressMaps, [&](auto &multiAddressMap) {
         std::stringstream ss;
         ss << multiAddressFileName << "_" << dedupAddressName(multiAddressMap.type) << ".dat";
@@ -66,6 +86,14 @@ uint32_t AddressState::getNewAddressIndex(blocksci::DedupAddressType::Enum type)
     return scriptNum;
 }
 
+void AddressState::finishProbes() {
+    blocksci::for_each(pendingLookups, [&](auto &pending) {
+        constexpr auto type = std::decay_t<decltype(pending)>::type;
+        lookupPending(pending, std::integral_constant<bool, blocksci::DedupAddressInfo<type>::equived>{});
+    });
+    probedScriptIndexes = scriptIndexes;
+}
+
 void AddressState::reset(const blocksci::State &state) {
     reloadBloomFilters();
     scriptIndexes.clear();
@@ -73,3 +101,87 @@ void AddressState::reset(const blocksci::State &state) {
         scriptIndexes.push_back(size);
     }
 }
+
+std::array<uint32_t, blocksci::DedupAddressType::size> AddressState::scriptCounts() const {
+    std::array<uint32_t, blocksci::DedupAddressType::size> counts;
+    for (size_t i = 0; i < counts.size(); i++) {
+        counts[i] = scriptIndexes[i] - 1;
+    }
+    return counts;
+}
+
+void AddressState::rollback(const std::array<uint32_t, blocksci::DedupAddressType::size> &scriptCounts, const std::vector<UndoAddressKey> &removedAddresses) {
+    for (size_t i = 0; i < scriptCounts.size(); i++) {
+        scriptIndexes[i] = std::min(scriptIndexes[i], scriptCounts[i] + 1);
+    }
+    
+    // An address that was reused right after it was added can also be in the multi use map
+    blocksci::for_each(multiAddressMaps, [&](auto &multiAddressMap) {
+        using HashType = DedupHash_t<std::decay_t<decltype(multiAddressMap)>::type>;
+        for (const auto &address : removedAddresses) {
+            if (address.type == multiAddressMap.type && address.keySize == sizeof(HashType)) {
+                HashType hash;
+                std::memcpy(&hash, address.key.data(), sizeof(hash));
+                auto it = multiAddressMap.find(hash);
+                if (it != multiAddressMap.end()) {
+                    multiAddressMap.erase(it);
+                }
+            }
+        }
+    });
+}
+
+void AddressState::printStats(std::ostream &os) const {
+    auto precision = os.precision();
+    uint64_t bloomNegatives = bloomNegativeCount;
+    uint64_t bloomFPs = bloomFPCount;
+    uint64_t multis = multiCount;
+    uint64_t dbs = dbCount;
+    auto lookupCount = bloomNegatives + multis + dbs + bloomFPs;
+    auto newCount = bloomNegatives + bloomFPs;
+    auto observedFPRate = newCount > 0 ? static_cast<double>(bloomFPs) / static_cast<double>(newCount) : 0.0;
+    os << "Address lookups: " << lookupCount << " (" << bloomNegatives << " bloom negatives, " << bloomFPs << " bloom false positives, " << multis << " in multi use map, " << dbs << " in hash index), observed false positive rate " << std::setprecision(3) << observedFPRate * 100 << "%\n";
+    blocksci::for_each(addressBloomFilters, [&](auto &addressBloomFilter) {
+        if (addressBloomFilter->size() == 0) {
+            return;
+        }
+        os << "Bloom filter " << dedupAddressName(addressBloomFilter->type) << ": " << addressBloomFilter->size() << " items in " << addressBloomFilter->stageCount() << " stages, " << addressBloomFilter->memoryUsage() / (1024 * 1024) << " MB, estimated false positive rate " << addressBloomFilter->estimatedFPRate() * 100 << "%\n";
+    });
+    os.precision(precision);
+}
+
+void AddressState::publishStats() {
+    blocksci::for_each(addressBloomFilters, [&](auto &addressBloomFilter) {
+        auto index = static_cast<size_t>(addressBloomFilter->type);
+        publishedBloomItems[index].store(static_cast<uint64_t>(addressBloomFilter->size()), std::memory_order_relaxed);
+        publishedBloomBytes[index].store(static_cast<uint64_t>(addressBloomFilter->memoryUsage()), std::memory_order_relaxed);
+        publishedBloomFPRate[index].store(addressBloomFilter->estimatedFPRate(), std::memory_order_relaxed);
+    });
+    blocksci::for_each(multiAddressMaps, [&](auto &multiAddressMap) {
+        publishedMultiUseAddresses[static_cast<size_t>(multiAddressMap.type)].store(multiAddressMap.size(), std::memory_order_relaxed);
+    });
+}
+
+void AddressState::sampleTelemetry(std::vector<TelemetryMetric> &metrics) const {
+    static constexpr auto lookupsHelp = "Lookups of deduplicated addresses by where they were resolved";
+    metrics.push_back({"blocksci_parser_address_lookups_total", lookupsHelp, TelemetryMetric::Kind::Counter, {{"result", "bloom_negative"}}, static_cast<double>(bloomNegativeCount.load(std::memory_order_relaxed))});
+    metrics.push_back({"blocksci_parser_address_lookups_total", lookupsHelp, TelemetryMetric::Kind::Counter, {{"result", "bloom_false_positive"}}, static_cast<double>(bloomFPCount.load(std::memory_order_relaxed))});
+    metrics.push_back({"blocksci_parser_address_lookups_total", lookupsHelp, TelemetryMetric::Kind::Counter, {{"result", "multi_use_map"}}, static_cast<double>(multiCount.load(std::memory_order_relaxed))});
+    metrics.push_back({"blocksci_parser_address_lookups_total", lookupsHelp, TelemetryMetric::Kind::Counter, {{"result", "hash_index"}}, static_cast<double>(dbCount.load(std::memory_order_relaxed))});
+    metrics.push_back({"blocksci_parser_hash_index_flushed_addresses_total", "Addresses written to the hash index from its caches", TelemetryMetric::Kind::Counter, {}, static_cast<double>(db.flushedAddressCount.load(std::memory_order_relaxed))});
+    metrics.push_back({"blocksci_parser_hash_index_flush_seconds_total", "Time spent writing cached addresses to the hash index", TelemetryMetric::Kind::Counter, {}, static_cast<double>(db.flushNanoseconds.load(std::memory_order_relaxed)) / 1e9});
+    metrics.push_back({"blocksci_parser_hash_index_flush_wait_seconds_total", "Time the parser waited for earlier hash index flushes", TelemetryMetric::Kind::Counter, {}, static_cast<double>(db.flushWaitNanoseconds.load(std::memory_order_relaxed)) / 1e9});
+    metrics.push_back({"blocksci_parser_hash_index_queued_rows", "Hash index rows waiting to be written in the background", TelemetryMetric::Kind::Gauge, {}, static_cast<double>(db.queuedFlushRows())});
+    
+    for (auto type : blocksci::DedupAddressType::allArray()) {
+        auto index = static_cast<size_t>(type);
+        auto items = publishedBloomItems[index].load(std::memory_order_relaxed);
+        std::vector<std::pair<std::string, std::string>> labels{{"type", dedupAddressName(type)}};
+        if (items > 0) {
+            metrics.push_back({"blocksci_parser_bloom_filter_items", "Addresses added to the bloom filter", TelemetryMetric::Kind::Gauge, labels, static_cast<double>(items)});
+            metrics.push_back({"blocksci_parser_bloom_filter_bytes", "Memory used by the bloom filter", TelemetryMetric::Kind::Gauge, labels, static_cast<double>(publishedBloomBytes[index].load(std::memory_order_relaxed))});
+            metrics.push_back({"blocksci_parser_bloom_filter_estimated_false_positive_ratio", "Estimated false positive rate of the bloom filter", TelemetryMetric::Kind::Gauge, labels, publishedBloomFPRate[index].load(std::memory_order_relaxed)});
+        }
+        metrics.push_back({"blocksci_parser_multi_use_addresses", "Addresses in the multi use map", TelemetryMetric::Kind::Gauge, labels, static_cast<double>(publishedMultiUseAddresses[index].load(std::memory_order_relaxed))});
+    }
+}
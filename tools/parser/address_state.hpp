@@ -13,21 +13,62 @@
 #include "parser_fwd.hpp"
 #include "serializable_map.hpp"
 #include "hash_index_creator.hpp"
+#include "undo_journal.hpp"
 
 #include <internal/dedup_address_info.hpp>
 #include <internal/bitcoin_uint256_hex.hpp>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstring>
 #include <memory>
+#include <ostream>
+#include <vector>
 
 enum class AddressLocation {
     MultiUseMap,
     LevelDb,
-    NotFound
+    NotFound,
+    /** Passed the bloom filter in AddressState::probeAddress(), the hash index is checked by finishProbes() */
+    Unchecked
 };
 
+/** Key that addresses of the dedup type are deduplicated by, the hash160 of the script for all types but taproot
+ * outputs, which are keyed by their 32 byte output key like in the hash index */
+template<blocksci::DedupAddressType::Enum type>
+struct DedupHash {
+    using type = blocksci::uint160;
+    
+    static type deletedKey() {
+        return blocksci::uint160S("FFFFFFFFFFFFFFFFFFFF");
+    }
+    
+    static type emptyKey() {
+        return blocksci::uint160S("AAAAAAAAAAAAAAAAAA");
+    }
+};
+
+template<>
+struct DedupHash<blocksci::DedupAddressType::WITNESS_TAPROOT> {
+    using type = blocksci::uint256;
+    
+    static type deletedKey() {
+        return blocksci::uint256S("FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF");
+    }
+    
+    static type emptyKey() {
+        return blocksci::uint256S("AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA");
+    }
+};
+
+template<blocksci::DedupAddressType::Enum type>
+using DedupHash_t = typename DedupHash<type>::type;
+
 template<blocksci::AddressType::Enum type>
 struct RawAddressInfo {
-    blocksci::uint160 hash;
+    DedupHash_t<dedupType(type)> hash;
     AddressLocation location;
     uint32_t addressNum;
 };
@@ -45,15 +86,17 @@ template<>
 constexpr int startingCount<blocksci::DedupAddressType::SCRIPTHASH> = 100'000'000;
 template<>
 constexpr int startingCount<blocksci::DedupAddressType::MULTISIG> = 100'000'000;
+template<>
+constexpr int startingCount<blocksci::DedupAddressType::WITNESS_TAPROOT> = 100'000'000;
 
 class AddressState {
     static constexpr auto AddressFalsePositiveRate = .05;
     
     template<blocksci::DedupAddressType::Enum scriptType>
-    class AddressMap : public SerializableMap<blocksci::uint160, uint32_t>  {
+    class AddressMap : public SerializableMap<DedupHash_t<scriptType>, uint32_t>  {
     public:
         static constexpr auto type = scriptType;
-        AddressMap() : SerializableMap(blocksci::uint160S("FFFFFFFFFFFFFFFFFFFF"), blocksci::uint160S("AAAAAAAAAAAAAAAAAA")) {}
+        AddressMap() : SerializableMap<DedupHash_t<scriptType>, uint32_t>(DedupHash<scriptType>::deletedKey(), DedupHash<scriptType>::emptyKey()) {}
     };
     
     template<blocksci::DedupAddressType::Enum scriptType>
@@ -76,30 +119,86 @@ class AddressState {
     AddressMapTuple multiAddressMaps;
     AddressBloomFilterTuple addressBloomFilters;
     
-    mutable long bloomNegativeCount = 0;
-    mutable long multiCount = 0;
-    mutable long dbCount = 0;
-    mutable long bloomFPCount = 0;
+    /** Outcomes of the address lookups. Only the thread resolving addresses writes them, but the telemetry thread
+     * reads them while it runs */
+    std::atomic<uint64_t> bloomNegativeCount{0};
+    std::atomic<uint64_t> multiCount{0};
+    std::atomic<uint64_t> dbCount{0};
+    std::atomic<uint64_t> bloomFPCount{0};
+    
+    /** Probed addresses that still need to be looked up in the hash index, @see queueProbe() */
+    template<blocksci::DedupAddressType::Enum scriptType>
+    struct PendingLookups {
+        static constexpr auto type = scriptType;
+        std::vector<DedupHash_t<scriptType>> hashes;
+        std::vector<std::pair<AddressLocation *, uint32_t *>> results;
+    };
+    
+    blocksci::to_dedup_address_tuple_t<PendingLookups> pendingLookups;
+    
+    /** Script counts when the last batch of probes was finished */
+    std::vector<uint32_t> probedScriptIndexes;
+    
+    template<blocksci::DedupAddressType::Enum type>
+    void lookupPending(PendingLookups<type> &pending, std::true_type) {
+        if (pending.hashes.empty()) {
+            return;
+        }
+        auto destNums = db.lookupAddresses<blocksci::DedupAddressInfo<type>::reprType>(pending.hashes);
+        for (size_t i = 0; i < destNums.size(); i++) {
+            if (destNums[i]) {
+                countLookup(dbCount);
+                *pending.results[i].first = AddressLocation::LevelDb;
+                *pending.results[i].second = *destNums[i];
+            } else {
+                // We must have had a false positive
+                countLookup(bloomFPCount);
+                *pending.results[i].first = AddressLocation::NotFound;
+            }
+        }
+        pending.hashes.clear();
+        pending.results.clear();
+    }
+    
+    /** Addresses of types that aren't deduplicated are never probed */
+    template<blocksci::DedupAddressType::Enum type>
+    void lookupPending(PendingLookups<type> &, std::false_type) {}
+    
+    /** Sizes of the bloom filters and multi use maps as of the last publishStats(), indexed by DedupAddressType */
+    std::array<std::atomic<uint64_t>, blocksci::DedupAddressType::size> publishedBloomItems{};
+    std::array<std::atomic<uint64_t>, blocksci::DedupAddressType::size> publishedBloomBytes{};
+    std::array<std::atomic<double>, blocksci::DedupAddressType::size> publishedBloomFPRate{};
+    std::array<std::atomic<uint64_t>, blocksci::DedupAddressType::size> publishedMultiUseAddresses{};
+    
+    static void countLookup(std::atomic<uint64_t> &counter) {
+        // Single writer, so there is no need for an atomic read-modify-write
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
     
     
     std::vector<uint32_t> scriptIndexes;
     
-    template<blocksci::AddressType::Enum type>
-    void reloadBloomFilter(int sizeIncreaseRatio) {
-        auto &addressBloomFilter = std::get<AddressBloomFilterPointer<dedupType(type)>>(addressBloomFilters);
-        addressBloomFilter->reset(addressBloomFilter->getMaxItems() * sizeIncreaseRatio, addressBloomFilter->getFPRate());
+    /** Receives the keys of the addresses added to the hash index while set, @see setNewAddressLog() */
+    std::vector<UndoAddressKey> *newAddressLog = nullptr;
+    
+    template<blocksci::DedupAddressType::Enum type>
+    void reloadBloomFilter() {
+        auto &addressBloomFilter = std::get<AddressBloomFilterPointer<type>>(addressBloomFilters);
+        // Keep the capacity reached so far so that adding the items again doesn't allocate a chain of stages
+        addressBloomFilter->reset(std::max<int64_t>(addressBloomFilter->size(), startingCount<type>));
         
-        db.clearAddressCache<blocksci::DedupAddressInfo<dedupType(type)>::reprType>();
+        db.clearAddressCache<typename blocksci::DedupAddressInfo<type>::reprType>();
         
-        RANGES_FOR(auto item, db.db.getAddressRange<blocksci::DedupAddressInfo<dedupType(type)>::reprType>()) {
+        RANGES_FOR(auto item, db.db.getAddressRange<typename blocksci::DedupAddressInfo<type>::reprType>()) {
             addressBloomFilter->add(item.second);
         }
     }
     
     void reloadBloomFilters() {
-        reloadBloomFilter<blocksci::AddressType::PUBKEYHASH>(1);
-        reloadBloomFilter<blocksci::AddressType::SCRIPTHASH>(1);
-        reloadBloomFilter<blocksci::AddressType::MULTISIG>(1);
+        reloadBloomFilter<blocksci::DedupAddressType::PUBKEY>();
+        reloadBloomFilter<blocksci::DedupAddressType::SCRIPTHASH>();
+        reloadBloomFilter<blocksci::DedupAddressType::MULTISIG>();
+        reloadBloomFilter<blocksci::DedupAddressType::WITNESS_TAPROOT>();
     }
     
 public:
@@ -110,6 +209,9 @@ public:
     AddressState &operator=(AddressState &&) = delete;
     ~AddressState();
     
+    /** Write the multi use address maps and script counts, which also happens on destruction */
+    void serialize();
+    
     template<blocksci::AddressType::Enum type, std::enable_if_t<!blocksci::DedupAddressInfo<dedupType(type)>::equived, int> = 0>
     NonDudupAddressInfo<type> findAddress(const ScriptOutputData<type> &) {
         uint32_t scriptNum = getNewAddressIndex(dedupType(type));
@@ -127,7 +229,7 @@ public:
         auto &addressBloomFilter = std::get<AddressBloomFilterPointer<dedupType(type)>>(addressBloomFilters);
         if (!addressBloomFilter->possiblyContains(hash)) {
             // Address has definitely never been seen
-            bloomNegativeCount++;
+            countLookup(bloomNegativeCount);
             return {hash, AddressLocation::NotFound, 0};
         }
         
@@ -135,30 +237,105 @@ public:
             auto &multiAddressMap = std::get<AddressMap<dedupType(type)>>(multiAddressMaps);
             auto it = multiAddressMap.find(hash);
             if (it != multiAddressMap.end()) {
-                multiCount++;
+                countLookup(multiCount);
                 return {hash, AddressLocation::MultiUseMap, it->second};
             }
         }
         
         ranges::optional<uint32_t> destNum = db.lookupAddress<blocksci::DedupAddressInfo<dedupType(type)>::reprType>(hash);
         if (destNum) {
-            dbCount++;
+            countLookup(dbCount);
             return {hash, AddressLocation::LevelDb, *destNum};
         } else {
-            bloomFPCount++;
+            countLookup(bloomFPCount);
             // We must have had a false positive
             return {hash, AddressLocation::NotFound, 0};
         }
     }
     
+    /** Bloom filter and multi use map part of findAddress(), which can run on several threads at once as long as no
+     * address is resolved in the meantime. Hashing the scripts is most of the work of finding an address. */
+    template<blocksci::AddressType::Enum type, std::enable_if_t<blocksci::DedupAddressInfo<dedupType(type)>::equived, int> = 0>
+    RawAddressInfo<type> probeAddress(const ScriptOutputData<type> &data) const {
+        auto hash = data.getHash();
+        auto &addressBloomFilter = std::get<AddressBloomFilterPointer<dedupType(type)>>(addressBloomFilters);
+        if (!addressBloomFilter->possiblyContains(hash)) {
+            return {hash, AddressLocation::NotFound, 0};
+        }
+        auto &multiAddressMap = std::get<AddressMap<dedupType(type)>>(multiAddressMaps);
+        auto it = multiAddressMap.find(hash);
+        if (it != multiAddressMap.end()) {
+            return {hash, AddressLocation::MultiUseMap, it->second};
+        }
+        return {hash, AddressLocation::Unchecked, 0};
+    }
+    
+    /** Count the outcome of a probe and queue it for the hash index lookups of finishProbes() if it is unchecked, info
+     * must stay in place until then */
+    template<blocksci::AddressType::Enum type>
+    void queueProbe(RawAddressInfo<type> &info) {
+        switch (info.location) {
+            case AddressLocation::NotFound:
+                countLookup(bloomNegativeCount);
+                break;
+            case AddressLocation::MultiUseMap:
+                countLookup(multiCount);
+                break;
+            case AddressLocation::Unchecked: {
+                auto &pending = std::get<PendingLookups<dedupType(type)>>(pendingLookups);
+                pending.hashes.push_back(info.hash);
+                pending.results.emplace_back(&info.location, &info.addressNum);
+                break;
+            }
+            case AddressLocation::LevelDb:
+                break;
+        }
+    }
+    
+    /** Look up the queued probes in the hash index with batched reads */
+    void finishProbes();
+    
+    /** Address info of a probed address for resolveAddress()
+     *
+     * Addresses resolved after the probes were finished, like an earlier output of the same batch creating the
+     * address, are missing from the probes. So an address that wasn't found is looked up again if addresses of its
+     * type were added since, and one found in the hash index may have been moved to the multi use map. */
+    template<blocksci::AddressType::Enum type>
+    RawAddressInfo<type> confirmProbe(RawAddressInfo<type> info) {
+        auto &multiAddressMap = std::get<AddressMap<dedupType(type)>>(multiAddressMaps);
+        if (info.location == AddressLocation::LevelDb) {
+            auto it = multiAddressMap.find(info.hash);
+            if (it != multiAddressMap.end()) {
+                return {info.hash, AddressLocation::MultiUseMap, it->second};
+            }
+            return info;
+        }
+        auto typeIndex = static_cast<size_t>(dedupType(type));
+        if (info.location != AddressLocation::NotFound || scriptIndexes[typeIndex] == probedScriptIndexes[typeIndex]) {
+            return info;
+        }
+        auto &addressBloomFilter = std::get<AddressBloomFilterPointer<dedupType(type)>>(addressBloomFilters);
+        if (!addressBloomFilter->possiblyContains(info.hash)) {
+            return info;
+        }
+        auto it = multiAddressMap.find(info.hash);
+        if (it != multiAddressMap.end()) {
+            return {info.hash, AddressLocation::MultiUseMap, it->second};
+        }
+        if (auto destNum = db.lookupAddress<blocksci::DedupAddressInfo<dedupType(type)>::reprType>(info.hash)) {
+            return {info.hash, AddressLocation::LevelDb, *destNum};
+        }
+        return info;
+    }
+    
     // Bool is true if address is new
     template<blocksci::AddressType::Enum type>
     std::pair<uint32_t, bool> resolveAddress(const RawAddressInfo<type> &addressInfo) {
         bool existingAddress = false;
+        assert(addressInfo.location != AddressLocation::Unchecked);
         switch (addressInfo.location) {
             case AddressLocation::LevelDb: {
-                auto &multiAddressMap = std::get<AddressMap<dedupType(type)>>(multiAddressMaps);
-                multiAddressMap.add(addressInfo.hash, addressInfo.addressNum);
+                addReusedAddress<dedupType(type)>(addressInfo.hash, addressInfo.addressNum);
                 existingAddress = true;
                 break;
             }
@@ -166,7 +343,8 @@ public:
                 existingAddress = true;
                 break;
             }
-            case AddressLocation::NotFound: {
+            case AddressLocation::NotFound:
+            case AddressLocation::Unchecked: {
                 existingAddress = false;
                 break;
             }
@@ -174,21 +352,65 @@ public:
         
         uint32_t addressNum = addressInfo.addressNum;
         if (!existingAddress) {
-            addressNum = getNewAddressIndex(dedupType(type));
-            auto &addressBloomFilter = std::get<AddressBloomFilterPointer<dedupType(type)>>(addressBloomFilters);
-            addressBloomFilter->add(addressInfo.hash);
-            db.addAddress<blocksci::DedupAddressInfo<dedupType(type)>::reprType>(addressInfo.hash, addressNum);
-            if (addressBloomFilter->isFull()) {
-                reloadBloomFilter<type>(2);
-            }
+            addressNum = addNewAddress<dedupType(type)>(addressInfo.hash);
         }
         return std::make_pair(addressNum, !existingAddress);
     }
     
+    /** Give the address with the given hash, which must not have been seen before, the next scriptNum of its type */
+    template<blocksci::DedupAddressType::Enum type>
+    uint32_t addNewAddress(const DedupHash_t<type> &hash) {
+        auto addressNum = getNewAddressIndex(type);
+        auto &addressBloomFilter = std::get<AddressBloomFilterPointer<type>>(addressBloomFilters);
+        addressBloomFilter->add(hash);
+        db.addAddress<blocksci::DedupAddressInfo<type>::reprType>(hash, addressNum);
+        if (newAddressLog != nullptr) {
+            UndoAddressKey key;
+            key.type = type;
+            key.scriptNum = addressNum;
+            key.keySize = sizeof(hash);
+            key.key.fill(0);
+            std::memcpy(key.key.data(), &hash, sizeof(hash));
+            newAddressLog->push_back(key);
+        }
+        return addressNum;
+    }
+    
+    /** Record that an address found in the hash index was used again, which keeps it in the multi use map */
+    template<blocksci::DedupAddressType::Enum type>
+    void addReusedAddress(const DedupHash_t<type> &hash, uint32_t addressNum) {
+        auto &multiAddressMap = std::get<AddressMap<type>>(multiAddressMaps);
+        multiAddressMap.add(hash, addressNum);
+    }
+    
     uint32_t getNewAddressIndex(blocksci::DedupAddressType::Enum type);
     
     // Called after resetting index
     void reset(const blocksci::State &state);
+    
+    /** Number of scripts of each type created so far */
+    std::array<uint32_t, blocksci::DedupAddressType::size> scriptCounts() const;
+    
+    /** Record the keys of the new addresses into log until it is set back to nullptr */
+    void setNewAddressLog(std::vector<UndoAddressKey> *log) {
+        newAddressLog = log;
+    }
+    
+    /** Forget the scripts beyond scriptCounts after the blocks that created them were undone
+     *
+     * The keys of the removed addresses must already be gone from the hash index. They stay in the bloom filters,
+     * which only costs a lookup if they are seen again. */
+    void rollback(const std::array<uint32_t, blocksci::DedupAddressType::size> &scriptCounts, const std::vector<UndoAddressKey> &removedAddresses);
+    
+    /** Print the size and false positive rates of the bloom filters along with the outcome of all address lookups */
+    void printStats(std::ostream &os) const;
+    
+    /** Copy the sizes of the bloom filters and multi use maps for sampleTelemetry(). Must be called by the thread
+     * resolving addresses */
+    void publishStats();
+    
+    /** Add the lookup outcomes and the published sizes of the filters and maps to metrics, safe to call from any thread */
+    void sampleTelemetry(std::vector<TelemetryMetric> &metrics) const;
 };
 
 
@@ -0,0 +1,125 @@
+//
+//  address_stats_writer.cpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include "address_stats_writer.hpp"
+#include "parser_configuration.hpp"
+
+#include <blocksci/address/address_stats.hpp>
+
+#include <internal/address_info.hpp>
+#include <internal/chain_access.hpp>
+#include <internal/file_mapper.hpp>
+#include <internal/progress_bar.hpp>
+#include <internal/script_access.hpp>
+
+#include <array>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+namespace {
+    using StatsFile = blocksci::FixedSizeFileMapper<blocksci::AddressStats, mio::access_mode::write>;
+    using StatsProgressFile = blocksci::FixedSizeFileMapper<blocksci::AddressStatsProgress, mio::access_mode::write>;
+    
+    void writeProgress(StatsProgressFile &progressFile, blocksci::AddressStatsProgress progress) {
+        if (progressFile.size() == 0) {
+            progressFile.write(progress);
+        } else {
+            *progressFile[0] = progress;
+        }
+        progressFile.clearBuffer();
+    }
+}
+
+bool addressStatsExist(const ParserConfigurationBase &config) {
+    return filesystem::path{blocksci::ScriptAccess::statsProgressFilePath(config.dataConfig.scriptsDirectory()).str() + ".dat"}.exists();
+}
+
+void invalidateAddressStats(const ParserConfigurationBase &config) {
+    if (!addressStatsExist(config)) {
+        return;
+    }
+    StatsProgressFile progressFile{blocksci::ScriptAccess::statsProgressFilePath(config.dataConfig.scriptsDirectory())};
+    writeProgress(progressFile, {0, 0});
+}
+
+void updateAddressStats(const ParserConfigurationBase &config) {
+    auto scriptsDirectory = config.dataConfig.scriptsDirectory();
+    blocksci::ChainAccess chain{config.dataConfig.chainDirectory(), 0, false};
+    std::array<uint32_t, blocksci::DedupAddressType::size> scriptCounts;
+    {
+        blocksci::ScriptAccess scripts{scriptsDirectory};
+        scriptCounts = scripts.scriptCounts();
+    }
+    
+    StatsProgressFile progressFile{blocksci::ScriptAccess::statsProgressFilePath(scriptsDirectory)};
+    std::vector<std::unique_ptr<StatsFile>> statsFiles;
+    for (size_t i = 0; i < blocksci::AddressType::size; i++) {
+        statsFiles.push_back(std::make_unique<StatsFile>(blocksci::ScriptAccess::statsFilePath(scriptsDirectory, static_cast<blocksci::AddressType::Enum>(i))));
+    }
+    
+    uint32_t txCount = static_cast<uint32_t>(chain.txCount());
+    uint32_t firstTx = 0;
+    if (progressFile.size() > 0 && progressFile[0]->complete) {
+        firstTx = progressFile[0]->txCount;
+    }
+    
+    // Totals of an interrupted update are partially applied, so they are rebuilt from the first tx
+    writeProgress(progressFile, {firstTx, 0});
+    for (size_t i = 0; i < blocksci::AddressType::size; i++) {
+        auto &statsFile = *statsFiles[i];
+        auto scriptCount = scriptCounts[static_cast<size_t>(blocksci::dedupType(static_cast<blocksci::AddressType::Enum>(i)))];
+        if (firstTx == 0) {
+            statsFile.truncate(0);
+        }
+        statsFile.seekEnd();
+        for (auto scriptNum = static_cast<uint32_t>(statsFile.size()); scriptNum < scriptCount; scriptNum++) {
+            statsFile.write(blocksci::AddressStats{0, 0, 0, 0, 0, 0});
+        }
+        statsFile.clearBuffer();
+    }
+    
+    if (firstTx < txCount) {
+        std::cout << "Updating address stats\n";
+        auto height = chain.getBlockHeight(firstTx);
+        auto blockEnd = chain.getBlock(height)->firstTxIndex + chain.getBlock(height)->txCount;
+        auto progressBar = blocksci::makeProgressBar(txCount - firstTx, [=]() {});
+        for (uint32_t txNum = firstTx; txNum < txCount; txNum++) {
+            while (txNum >= blockEnd) {
+                height++;
+                blockEnd = chain.getBlock(height)->firstTxIndex + chain.getBlock(height)->txCount;
+            }
+            auto tx = chain.getTx(txNum);
+            for (uint16_t i = 0; i < tx->outputCount; i++) {
+                auto &output = tx->getOutput(i);
+                if (output.getAddressNum() == 0) {
+                    continue;
+                }
+                auto stats = (*statsFiles[static_cast<size_t>(output.getType())])[output.getAddressNum() - 1];
+                if (stats->outputCount == 0) {
+                    stats->firstSeenHeight = height;
+                }
+                stats->received += output.getValue();
+                stats->outputCount++;
+                stats->lastSeenHeight = height;
+            }
+            for (uint16_t i = 0; i < tx->inputCount; i++) {
+                auto &input = tx->getInput(i);
+                if (input.getAddressNum() == 0) {
+                    continue;
+                }
+                auto stats = (*statsFiles[static_cast<size_t>(input.getType())])[input.getAddressNum() - 1];
+                stats->sent += input.getValue();
+                stats->spentOutputCount++;
+                stats->lastSeenHeight = height;
+            }
+            progressBar.update(txNum - firstTx);
+        }
+    }
+    
+    writeProgress(progressFile, {txCount, 1});
+}
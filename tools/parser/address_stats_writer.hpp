@@ -0,0 +1,28 @@
+//
+//  address_stats_writer.hpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef address_stats_writer_hpp
+#define address_stats_writer_hpp
+
+#include "parser_fwd.hpp"
+
+/** Check whether the optional address stats (scripts/<address type>_stats.dat) have been created */
+bool addressStatsExist(const ParserConfigurationBase &config);
+
+/** Create the address stats or extend them to include all txes in the chain
+ *
+ * The stats of an address only grow as txes are appended, so an update adds the outputs and inputs of the new txes to
+ * the existing totals. scripts/address_stats_progress.dat records how many txes are included and is marked incomplete
+ * while the totals are modified, an interrupted update rebuilds the stats from scratch.
+ */
+void updateAddressStats(const ParserConfigurationBase &config);
+
+/** Mark the address stats incomplete so that the next update rebuilds them, used once a reorganization removed txes
+ * that are included in the totals */
+void invalidateAddressStats(const ParserConfigurationBase &config);
+
+#endif /* address_stats_writer_hpp */
@@ -9,6 +9,10 @@
 
 #include "address_writer.hpp"
 #include "preproccessed_block.hpp"
+#include "work_stealing_pool.hpp"
+
+#include <algorithm>
+#include <exception>
 
 using blocksci::AddressType;
 using blocksci::DedupAddressType;
@@ -17,22 +21,97 @@ AddressWriter::AddressWriter(const ParserConfigurationBase &config) :
 scriptFiles(blocksci::apply(blocksci::DedupAddressType::all(), [&] (auto tag) {
     return (filesystem::path{config.dataConfig.scriptsDirectory()}/std::string{dedupAddressName(tag)}).str();
 })) {
+    // Script files only grow while parsing, preallocate them instead of flushing through a buffer
+    blocksci::for_each(scriptFiles, [](auto &file) { file.usePreallocatedGrowth(); });
+}
+
+void AddressWriter::rollback(const std::vector<BlockUndo> &undoneBlocks) {
+    if (undoneBlocks.empty()) {
+        return;
+    }
+    auto oldestBlock = std::min_element(undoneBlocks.begin(), undoneBlocks.end(), [](const BlockUndo &a, const BlockUndo &b) {
+        return a.height < b.height;
+    });
+    const auto &scriptCounts = oldestBlock->scriptCounts;
+    
+    std::vector<const UndoScript *> records;
+    for (auto &block : undoneBlocks) {
+        for (auto &script : block.scripts) {
+            // Scripts created by an undone block are removed entirely
+            if (script.scriptNum <= scriptCounts[static_cast<size_t>(script.type)]) {
+                records.push_back(&script);
+            }
+        }
+    }
+    std::sort(records.begin(), records.end(), [](const UndoScript *a, const UndoScript *b) {
+        return a->sequence > b->sequence;
+    });
+    
+    blocksci::for_each(blocksci::DedupAddressType::all(), [&](auto tag) {
+        constexpr auto type = decltype(tag)::value;
+        auto &file = std::get<ScriptFile<type>>(scriptFiles);
+        for (auto record : records) {
+            if (record->type == type) {
+                restoreScript(file, record->scriptNum - 1, *record);
+            }
+        }
+        truncateScripts(file, scriptCounts[static_cast<size_t>(type)]);
+    });
+}
+
+void AddressWriter::queueNewOutput(const AnyScriptOutput &output, uint32_t txNum, bool topLevel) {
+    mpark::visit([&](auto &scriptOutput) { this->queueNewOutput(scriptOutput, txNum, topLevel); }, output.wrapped);
 }
 
-blocksci::OffsetType AddressWriter::serializeNewOutput(const AnyScriptOutput &output, uint32_t txNum, bool topLevel) {
-    return mpark::visit([&](auto &scriptOutput) { return this->serializeNewOutput(scriptOutput, txNum, topLevel); }, output.wrapped);
+void AddressWriter::queueExistingOutput(const AnyScriptOutput &output, uint32_t txNum, bool topLevel) {
+    mpark::visit([&](auto &scriptOutput) { this->queueExistingOutput(scriptOutput, txNum, topLevel); }, output.wrapped);
 }
 
-void AddressWriter::serializeExistingOutput(const AnyScriptOutput &output, bool topLevel) {
-    mpark::visit([&](auto &scriptOutput) { return this->serializeExistingOutput(scriptOutput, topLevel); }, output.wrapped);
+void AddressWriter::queueInput(const AnyScriptInput &input, uint32_t txNum, uint32_t outputTxNum) {
+    mpark::visit([&](auto &scriptInput) { this->queueInput(scriptInput, txNum, outputTxNum); }, input.wrapped);
 }
 
-void AddressWriter::serializeInput(const AnyScriptInput &input, uint32_t txNum, uint32_t outputTxNum) {
-    mpark::visit([&](auto &scriptInput) { this->serializeInput(scriptInput, txNum, outputTxNum); }, input.wrapped);
+void AddressWriter::queueWrappedScript(const AnyScriptInput &input, uint32_t txNum, uint32_t outputTxNum) {
+    mpark::visit([&](auto &scriptInput) { this->queueWrappedScript(scriptInput.data, txNum, outputTxNum); }, input.wrapped);
 }
 
-void AddressWriter::serializeWrappedScript(const AnyScriptInput &input, uint32_t txNum, uint32_t outputTxNum) {
-    mpark::visit([&](auto &scriptInput) { this->serializeWrappedScript(scriptInput.data, txNum, outputTxNum); }, input.wrapped);
+void AddressWriter::flushWrites() {
+    for (auto &writes : queuedWrites) {
+        for (auto &write : writes) {
+            write.apply(*this, write);
+        }
+        writes.clear();
+    }
+}
+
+void AddressWriter::flushWrites(WorkStealingPool &pool) {
+    std::vector<size_t> types;
+    for (size_t i = 0; i < queuedWrites.size(); i++) {
+        if (!queuedWrites[i].empty()) {
+            types.push_back(i);
+        }
+    }
+    std::array<std::exception_ptr, blocksci::DedupAddressType::size> errors;
+    pool.parallelFor(types.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            auto type = types[i];
+            try {
+                for (auto &write : queuedWrites[type]) {
+                    write.apply(*this, write);
+                }
+            } catch (...) {
+                errors[type] = std::current_exception();
+            }
+        }
+    });
+    for (auto &writes : queuedWrites) {
+        writes.clear();
+    }
+    for (auto &error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
 }
 
 void AddressWriter::serializeOutputImp(const ScriptOutput<AddressType::PUBKEY> &output, ScriptFile<DedupAddressType::PUBKEY> &file, bool topLevel) {
@@ -86,14 +165,14 @@ void AddressWriter::serializeInputImp(const ScriptInput<AddressType::WITNESS_SCR
     data->wrappedAddress = input.data.wrappedScriptOutput.address();
 }
 
-void AddressWriter::serializeWrappedScript(const ScriptInputData<AddressType::Enum::WITNESS_SCRIPTHASH> &data, uint32_t txNum, uint32_t outputTxNum) {
+void AddressWriter::queueWrappedScript(const ScriptInputData<AddressType::Enum::WITNESS_SCRIPTHASH> &data, uint32_t txNum, uint32_t outputTxNum) {
     if (data.wrappedScriptOutput.isNew()) {
-        serializeNewOutput(data.wrappedScriptOutput, txNum, false);
+        queueNewOutput(data.wrappedScriptOutput, txNum, false);
     } else {
-        serializeExistingOutput(data.wrappedScriptOutput, false);
+        queueExistingOutput(data.wrappedScriptOutput, txNum, false);
     }
     
-    serializeInput(*data.wrappedScriptInput, txNum, outputTxNum);
+    queueInput(*data.wrappedScriptInput, txNum, outputTxNum);
 }
 
 void AddressWriter::serializeInputImp(const ScriptInput<AddressType::SCRIPTHASH> &input, ScriptFile<DedupAddressType::SCRIPTHASH> &file) {
@@ -101,14 +180,14 @@ void AddressWriter::serializeInputImp(const ScriptInput<AddressType::SCRIPTHASH>
     data->wrappedAddress = input.data.wrappedScriptOutput.address();
 }
 
-void AddressWriter::serializeWrappedScript(const ScriptInputData<AddressType::Enum::SCRIPTHASH> &data, uint32_t txNum, uint32_t outputTxNum) {
+void AddressWriter::queueWrappedScript(const ScriptInputData<AddressType::Enum::SCRIPTHASH> &data, uint32_t txNum, uint32_t outputTxNum) {
     if (data.wrappedScriptOutput.isNew()) {
-        serializeNewOutput(data.wrappedScriptOutput, txNum, false);
+        queueNewOutput(data.wrappedScriptOutput, txNum, false);
     } else {
-        serializeExistingOutput(data.wrappedScriptOutput, false);
+        queueExistingOutput(data.wrappedScriptOutput, txNum, false);
     }
-    serializeInput(*data.wrappedScriptInput, txNum, outputTxNum);
-    serializeWrappedScript(*data.wrappedScriptInput, txNum, outputTxNum);
+    queueInput(*data.wrappedScriptInput, txNum, outputTxNum);
+    queueWrappedScript(*data.wrappedScriptInput, txNum, outputTxNum);
 }
 
 void AddressWriter::serializeInputImp(const ScriptInput<AddressType::NONSTANDARD> &input, ScriptFile<DedupAddressType::NONSTANDARD> &file) {
@@ -124,3 +203,8 @@ void AddressWriter::serializeInputImp(const ScriptInput<AddressType::WITNESS_UNK
     data.add(input.data.script.begin(), input.data.script.end());
     file.write<1>(input.scriptNum - 1, data);
 }
+
+void AddressWriter::serializeInputImp(const ScriptInput<AddressType::WITNESS_TAPROOT> &input, ScriptFile<DedupAddressType::WITNESS_TAPROOT> &file) {
+    auto data = file[input.scriptNum - 1];
+    data->spendType = input.data.spendType;
+}
@@ -11,6 +11,11 @@
 
 #include "script_output.hpp"
 #include "script_input.hpp"
+#include "undo_journal.hpp"
+
+#include <array>
+#include <cstring>
+#include <vector>
 
 template<typename T>
 struct ScriptFileType;
@@ -39,6 +44,57 @@ class AddressWriter {
 
     ScriptFilesTuple scriptFiles;
 
+    UndoJournalWriter *undoJournal = nullptr;
+
+    template<typename T>
+    static void copyScript(const blocksci::FixedSizeFileMapper<T, mio::access_mode::write> &file, uint32_t index, UndoScript &script) {
+        auto data = reinterpret_cast<const char *>(file[index]);
+        script.data.assign(data, data + sizeof(T));
+    }
+
+    template<typename T, typename... Rest>
+    static void copyScript(const blocksci::IndexedFileMapper<mio::access_mode::write, T, Rest...> &file, uint32_t index, UndoScript &script) {
+        auto offsets = file.getOffsets(index);
+        script.offsets.assign(offsets.begin(), offsets.end());
+        auto data = reinterpret_cast<const char *>(file.getDataAtIndex(index));
+        script.data.assign(data, data + sizeof(T));
+    }
+
+    template<typename T>
+    static void restoreScript(blocksci::FixedSizeFileMapper<T, mio::access_mode::write> &file, uint32_t index, const UndoScript &script) {
+        std::memcpy(file[index], script.data.data(), sizeof(T));
+    }
+
+    template<typename T, typename... Rest>
+    static void restoreScript(blocksci::IndexedFileMapper<mio::access_mode::write, T, Rest...> &file, uint32_t index, const UndoScript &script) {
+        blocksci::FileIndex<sizeof...(Rest) + 1> offsets;
+        std::copy(script.offsets.begin(), script.offsets.end(), offsets.begin());
+        file.setOffsets(index, offsets);
+        std::memcpy(file.getDataAtIndex(index), script.data.data(), sizeof(T));
+    }
+
+    /** Spend data written after the block began stays in the data file, the restored offsets no longer refer to it */
+    template<typename T>
+    static void truncateScripts(blocksci::FixedSizeFileMapper<T, mio::access_mode::write> &file, uint32_t count) {
+        file.truncate(count);
+    }
+
+    template<typename... T>
+    static void truncateScripts(blocksci::IndexedFileMapper<mio::access_mode::write, T...> &file, uint32_t count) {
+        file.truncateIndex(count);
+    }
+
+    /** Journal the state of an existing script before the tx modifies it */
+    template<blocksci::DedupAddressType::Enum type>
+    void recordScript(uint32_t scriptNum, uint32_t txNum) {
+        if (undoJournal != nullptr) {
+            auto &file = std::get<ScriptFile<type>>(scriptFiles);
+            undoJournal->recordScript(txNum, type, scriptNum, [&](UndoScript &script) {
+                copyScript(file, scriptNum - 1, script);
+            });
+        }
+    }
+
     template<blocksci::AddressType::Enum type>
     void serializeInputImp(const ScriptInput<type> &, ScriptFile<dedupType(type)> &) {}
 
@@ -48,6 +104,7 @@ class AddressWriter {
     void serializeInputImp(const ScriptInput<blocksci::AddressType::WITNESS_SCRIPTHASH> &input, ScriptFile<blocksci::DedupAddressType::SCRIPTHASH> &file);
     void serializeInputImp(const ScriptInput<blocksci::AddressType::NONSTANDARD> &input, ScriptFile<blocksci::DedupAddressType::NONSTANDARD> &file);
     void serializeInputImp(const ScriptInput<blocksci::AddressType::WITNESS_UNKNOWN> &input, ScriptFile<blocksci::DedupAddressType::WITNESS_UNKNOWN> &file);
+    void serializeInputImp(const ScriptInput<blocksci::AddressType::WITNESS_TAPROOT> &input, ScriptFile<blocksci::DedupAddressType::WITNESS_TAPROOT> &file);
 
     template<blocksci::AddressType::Enum type>
     void serializeOutputImp(const ScriptOutput<type> &output, ScriptFile<dedupType(type)> &file, bool topLevel) {
@@ -61,11 +118,43 @@ class AddressWriter {
     void serializeOutputImp(const ScriptOutput<blocksci::AddressType::NONSTANDARD> &output, ScriptFile<blocksci::DedupAddressType::NONSTANDARD> &file, bool topLevel);
     void serializeOutputImp(const ScriptOutput<blocksci::AddressType::WITNESS_UNKNOWN> &output, ScriptFile<blocksci::DedupAddressType::WITNESS_UNKNOWN> &file, bool topLevel);
 
+    /** Change to the script file of one dedup type, collected by the queue methods and applied by flushWrites() */
+    struct ScriptWrite {
+        void (*apply)(AddressWriter &writer, const ScriptWrite &write);
+        const void *script;
+        uint32_t txNum;
+        uint32_t outputTxNum;
+        bool topLevel;
+    };
+
+    /** Queued writes by dedup type, the writes of one type are applied in order */
+    std::array<std::vector<ScriptWrite>, blocksci::DedupAddressType::size> queuedWrites;
+
+    template<blocksci::AddressType::Enum type>
+    static void applyNewOutput(AddressWriter &writer, const ScriptWrite &write) {
+        writer.serializeNewOutput(*static_cast<const ScriptOutput<type> *>(write.script), write.txNum, write.topLevel);
+    }
+
+    template<blocksci::AddressType::Enum type>
+    static void applyExistingOutput(AddressWriter &writer, const ScriptWrite &write) {
+        writer.serializeExistingOutput(*static_cast<const ScriptOutput<type> *>(write.script), write.txNum, write.topLevel);
+    }
+
+    template<blocksci::AddressType::Enum type>
+    static void applyInput(AddressWriter &writer, const ScriptWrite &write) {
+        writer.serializeInput(*static_cast<const ScriptInput<type> *>(write.script), write.txNum, write.outputTxNum);
+    }
+
     template<blocksci::AddressType::Enum type>
-    void serializeWrappedScript(const ScriptInputData<type> &, uint32_t, uint32_t) {}
+    void queueWrite(void (*apply)(AddressWriter &, const ScriptWrite &), const void *script, uint32_t txNum, uint32_t outputTxNum, bool topLevel) {
+        queuedWrites[static_cast<size_t>(dedupType(type))].push_back(ScriptWrite{apply, script, txNum, outputTxNum, topLevel});
+    }
+
+    template<blocksci::AddressType::Enum type>
+    void queueWrappedScript(const ScriptInputData<type> &, uint32_t, uint32_t) {}
 
-    void serializeWrappedScript(const ScriptInputData<blocksci::AddressType::Enum::SCRIPTHASH> &input, uint32_t txNum, uint32_t outputTxNum);
-    void serializeWrappedScript(const ScriptInputData<blocksci::AddressType::Enum::WITNESS_SCRIPTHASH> &input, uint32_t txNum, uint32_t outputTxNum);
+    void queueWrappedScript(const ScriptInputData<blocksci::AddressType::Enum::SCRIPTHASH> &input, uint32_t txNum, uint32_t outputTxNum);
+    void queueWrappedScript(const ScriptInputData<blocksci::AddressType::Enum::WITNESS_SCRIPTHASH> &input, uint32_t txNum, uint32_t outputTxNum);
 
 public:
 
@@ -81,7 +170,7 @@ public:
 
     /**
      Appends a new script to the script file of the corresponding dedup type.
-     Recurses over wrapped scripts, currently these include only pubkeys of raw multisig scripts.
+     Wrapped scripts are written separately, @see queueNewOutput()
      */
     template<blocksci::AddressType::Enum type>
     blocksci::OffsetType serializeNewOutput(const ScriptOutput<type> &output, uint32_t txNum, bool topLevel) {
@@ -90,22 +179,14 @@ public:
         auto data = output.data.getData(txNum, topLevel);
         file.write(data);
         assert(output.scriptNum == file.size());
-
-        // serialize pubkeys in raw multisig outputs
-        output.data.visitWrapped([&](auto &wrappedOutput) {
-            if (wrappedOutput.isNew) {
-                serializeNewOutput(wrappedOutput, txNum, false);
-            } else {
-                serializeExistingOutput(wrappedOutput, false);
-            }
-        });
         return file.size();
     }
 
     template<blocksci::AddressType::Enum type>
-    void serializeExistingOutput(const ScriptOutput<type> &output, bool topLevel) {
+    void serializeExistingOutput(const ScriptOutput<type> &output, uint32_t txNum, bool topLevel) {
         assert(!output.isNew);
         auto &file = std::get<ScriptFile<dedupType(type)>>(scriptFiles);
+        recordScript<dedupType(type)>(output.scriptNum, txNum);
         serializeOutputImp(output, file, topLevel);
     }
 
@@ -117,6 +198,7 @@ public:
     template<blocksci::AddressType::Enum type>
     void serializeInput(const ScriptInput<type> &input, uint32_t txNum, uint32_t outputTxNum) {
         auto &file = std::get<ScriptFile<dedupType(type)>>(scriptFiles);
+        recordScript<dedupType(type)>(input.scriptNum, txNum);
         auto data = file.getDataAtIndex(input.scriptNum - 1);
 
         /** Default value of ScriptDataBase.txFirstSpent is (std::numeric_limits<uint32_t>::max()) */
@@ -139,13 +221,57 @@ public:
         }
     }
 
-    blocksci::OffsetType serializeNewOutput(const AnyScriptOutput &output, uint32_t txNum, bool topLevel);
-    void serializeExistingOutput(const AnyScriptOutput &output, bool topLevel);
+    /** Queue serializeNewOutput() for the script. Recurses over wrapped scripts, currently these include only pubkeys
+     * of raw multisig scripts */
+    template<blocksci::AddressType::Enum type>
+    void queueNewOutput(const ScriptOutput<type> &output, uint32_t txNum, bool topLevel) {
+        queueWrite<type>(&AddressWriter::applyNewOutput<type>, &output, txNum, 0, topLevel);
+        output.data.visitWrapped([&](auto &wrappedOutput) {
+            if (wrappedOutput.isNew) {
+                queueNewOutput(wrappedOutput, txNum, false);
+            } else {
+                queueExistingOutput(wrappedOutput, txNum, false);
+            }
+        });
+    }
+
+    template<blocksci::AddressType::Enum type>
+    void queueExistingOutput(const ScriptOutput<type> &output, uint32_t txNum, bool topLevel) {
+        queueWrite<type>(&AddressWriter::applyExistingOutput<type>, &output, txNum, 0, topLevel);
+    }
+
+    template<blocksci::AddressType::Enum type>
+    void queueInput(const ScriptInput<type> &input, uint32_t txNum, uint32_t outputTxNum) {
+        queueWrite<type>(&AddressWriter::applyInput<type>, &input, txNum, outputTxNum, false);
+    }
+
+    /** The queued scripts must stay in place until the next flushWrites() */
+    void queueNewOutput(const AnyScriptOutput &output, uint32_t txNum, bool topLevel);
+    void queueExistingOutput(const AnyScriptOutput &output, uint32_t txNum, bool topLevel);
+    void queueInput(const AnyScriptInput &input, uint32_t txNum, uint32_t outputTxNum);
+
+    /** Queue the scripts wrapped in a P2SH or P2WSH input */
+    void queueWrappedScript(const AnyScriptInput &input, uint32_t txNum, uint32_t outputTxNum);
+
+    /** Apply the queued writes in the order they were queued */
+    void flushWrites();
 
-    void serializeInput(const AnyScriptInput &input, uint32_t txNum, uint32_t outputTxNum);
-    void serializeWrappedScript(const AnyScriptInput &input, uint32_t txNum, uint32_t outputTxNum);
+    /** Apply the queued writes with the script files of the different dedup types written in parallel on pool. The
+     * writes of one type only touch its own file, so keeping their order is enough. */
+    void flushWrites(WorkStealingPool &pool);
 
     AddressWriter(const ParserConfigurationBase &config);
+
+    /** Journal the previous state of the existing scripts that the journaled blocks modify */
+    void setUndoJournal(UndoJournalWriter *journal) {
+        undoJournal = journal;
+    }
+
+    /** Undo the script changes of the blocks whose journals are given, newest first
+     *
+     * The scripts are truncated to the counts before the oldest block and the older scripts are restored, later
+     * records first so that every script ends up in the state before its first change. */
+    void rollback(const std::vector<BlockUndo> &undoneBlocks);
 };
 
 #endif /* address_writer_hpp */
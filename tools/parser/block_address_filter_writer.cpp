@@ -0,0 +1,75 @@
+//
+//  block_address_filter_writer.cpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "block_address_filter_writer.hpp"
+#include "parser_configuration.hpp"
+
+#include <internal/address_info.hpp>
+#include <internal/block_address_filter.hpp>
+#include <internal/chain_access.hpp>
+#include <internal/file_mapper.hpp>
+#include <internal/progress_bar.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+namespace {
+    using FilterFile = blocksci::IndexedFileMapper<mio::access_mode::write, blocksci::BlockAddressFilter>;
+}
+
+bool blockAddressFiltersExist(const ParserConfigurationBase &config) {
+    return filesystem::path{blocksci::ChainAccess::blockAddressFilterFilePath(config.dataConfig.chainDirectory()).str() + "_index.dat"}.exists();
+}
+
+void updateBlockAddressFilters(const ParserConfigurationBase &config) {
+    auto chainDirectory = config.dataConfig.chainDirectory();
+    blocksci::ChainAccess chain{chainDirectory, 0, false};
+    FilterFile filterFile{blocksci::ChainAccess::blockAddressFilterFilePath(chainDirectory)};
+    filterFile.usePreallocatedGrowth();
+
+    auto blockCount = static_cast<uint32_t>(chain.blockCount());
+    auto firstBlock = std::min(static_cast<uint32_t>(filterFile.size()), blockCount);
+    filterFile.truncate(firstBlock);
+    filterFile.seekEnd();
+
+    if (firstBlock == blockCount) {
+        return;
+    }
+
+    std::cout << "Updating block address filters\n";
+    std::vector<uint64_t> fingerprints;
+    std::vector<uint64_t> words;
+    auto progressBar = blocksci::makeProgressBar(blockCount - firstBlock, [=]() {});
+    for (uint32_t height = firstBlock; height < blockCount; height++) {
+        auto block = chain.getBlock(static_cast<blocksci::BlockHeight>(height));
+        fingerprints.clear();
+        for (uint32_t txNum = block->firstTxIndex; txNum < block->firstTxIndex + block->txCount; txNum++) {
+            auto tx = chain.getTx(txNum);
+            for (uint16_t i = 0; i < tx->inputCount; i++) {
+                auto &input = tx->getInput(i);
+                fingerprints.push_back(blocksci::BlockAddressFilter::fingerprint(input.getAddressNum(), blocksci::dedupType(input.getType())));
+            }
+            for (uint16_t i = 0; i < tx->outputCount; i++) {
+                auto &output = tx->getOutput(i);
+                fingerprints.push_back(blocksci::BlockAddressFilter::fingerprint(output.getAddressNum(), blocksci::dedupType(output.getType())));
+            }
+        }
+        blocksci::ArbitraryLengthData<blocksci::BlockAddressFilter> filter{blocksci::BlockAddressFilter::encode(fingerprints, words)};
+        filter.add(words.begin(), words.end());
+        filterFile.write(filter);
+        progressBar.update(height - firstBlock);
+    }
+}
+
+void truncateBlockAddressFilters(const ParserConfigurationBase &config, blocksci::BlockHeight splitPoint) {
+    if (!blockAddressFiltersExist(config)) {
+        return;
+    }
+    FilterFile filterFile{blocksci::ChainAccess::blockAddressFilterFilePath(config.dataConfig.chainDirectory())};
+    filterFile.truncate(static_cast<uint32_t>(splitPoint));
+}
@@ -0,0 +1,27 @@
+//
+//  block_address_filter_writer.hpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef block_address_filter_writer_hpp
+#define block_address_filter_writer_hpp
+
+#include "parser_fwd.hpp"
+
+#include <blocksci/core/typedefs.hpp>
+
+/** Check whether the optional block address filters (chain/block_address_filter_*.dat) have been created */
+bool blockAddressFiltersExist(const ParserConfigurationBase &config);
+
+/** Create the block address filters or extend them to cover all blocks in the chain
+ *
+ * The filter of a block covers the addresses of all of its inputs and outputs, which never change once the block was
+ * written, so existing filters are only extended. */
+void updateBlockAddressFilters(const ParserConfigurationBase &config);
+
+/** Drop the filters of the blocks from splitPoint on, used when these blocks are undone */
+void truncateBlockAddressFilters(const ParserConfigurationBase &config, blocksci::BlockHeight splitPoint);
+
+#endif /* block_address_filter_writer_hpp */
@@ -0,0 +1,103 @@
+//
+//  block_file_stream.cpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "block_file_stream.hpp"
+#include "safe_mem_reader.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+BlockFileStream::BlockFileStream(std::vector<FileRange> files_, size_t readSize_, size_t filesAhead_) : files(std::move(files_)), loaded(files.size()), readSize(std::max(readSize_, size_t{1})), filesAhead(std::max(filesAhead_, size_t{1})) {
+    reader = std::thread([this]() { readFiles(); });
+}
+
+BlockFileStream::~BlockFileStream() {
+    stop();
+    reader.join();
+}
+
+void BlockFileStream::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+}
+
+void BlockFileStream::readFiles() {
+    for (size_t i = 0; i < files.size(); i++) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&]() { return stopping || bufferedCount < filesAhead; });
+            if (stopping) {
+                return;
+            }
+        }
+        std::unique_ptr<char[]> data;
+        std::exception_ptr error;
+        try {
+            data = readRange(files[i]);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            loaded[i].data = std::move(data);
+            loaded[i].error = error;
+            loaded[i].ready = true;
+            bufferedCount++;
+        }
+        changed.notify_all();
+    }
+}
+
+std::unique_ptr<char[]> BlockFileStream::readRange(const FileRange &range) const {
+    auto fd = open(range.path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Error: Failed to open block file " + range.path + ": " + std::strerror(errno));
+    }
+    posix_fadvise(fd, static_cast<off_t>(range.begin), static_cast<off_t>(range.end - range.begin), POSIX_FADV_SEQUENTIAL);
+    // The bytes before the range are never touched, so they don't take up memory
+    std::unique_ptr<char[]> data{new char[range.end]};
+    auto pos = range.begin;
+    while (pos < range.end) {
+        auto toRead = std::min(readSize, range.end - pos);
+        auto ret = pread(fd, data.get() + pos, toRead, static_cast<off_t>(pos));
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            auto reason = ret < 0 ? std::string{std::strerror(errno)} : std::string{"unexpected end of file"};
+            close(fd);
+            throw std::runtime_error("Error: Failed to read block file " + range.path + ": " + reason);
+        }
+        pos += static_cast<size_t>(ret);
+    }
+    close(fd);
+    return data;
+}
+
+std::unique_ptr<SafeMemReader> BlockFileStream::take(size_t fileIndex) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto &file = loaded.at(fileIndex);
+    changed.wait(lock, [&]() { return stopping || file.ready; });
+    if (!file.ready) {
+        throw std::runtime_error("Block file stream was stopped");
+    }
+    bufferedCount--;
+    changed.notify_all();
+    if (file.error) {
+        std::rethrow_exception(file.error);
+    }
+    auto &range = files[fileIndex];
+    return std::make_unique<SafeMemReader>(range.path, std::move(file.data), range.end);
+}
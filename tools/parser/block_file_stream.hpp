@@ -0,0 +1,73 @@
+//
+//  block_file_stream.hpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef block_file_stream_hpp
+#define block_file_stream_hpp
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class SafeMemReader;
+
+/** Reads the block files to parse into memory with large sequential reads on a background thread
+ *
+ * Used instead of mapping the blkXXXXX.dat files when they live on network storage, where the page faults of a mapping
+ * turn into many small random reads. The thread reads the files in the order they were passed to the constructor and
+ * stays at most filesAhead files ahead of the ones taken by the decoding workers, which bounds the memory of files
+ * that were read but not decoded yet.
+ */
+class BlockFileStream {
+public:
+    /** Bytes [begin, end) of the file at path hold the blocks to parse */
+    struct FileRange {
+        std::string path;
+        size_t begin;
+        size_t end;
+    };
+
+    BlockFileStream(std::vector<FileRange> files, size_t readSize, size_t filesAhead);
+    BlockFileStream(const BlockFileStream &) = delete;
+    BlockFileStream &operator=(const BlockFileStream &) = delete;
+    ~BlockFileStream();
+
+    /** Reader over the file with the given index into the list passed to the constructor, waits until it was read.
+     * Every file can be taken once. Only the range of the file holding the blocks is filled, at the same offsets as in
+     * the file. */
+    std::unique_ptr<SafeMemReader> take(size_t fileIndex);
+
+    /** Stop reading, take() throws from now on instead of waiting */
+    void stop();
+
+private:
+    struct LoadedFile {
+        std::unique_ptr<char[]> data;
+        std::exception_ptr error;
+        bool ready = false;
+    };
+
+    std::vector<FileRange> files;
+    std::vector<LoadedFile> loaded;
+    size_t readSize;
+    size_t filesAhead;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    size_t bufferedCount = 0;
+    bool stopping = false;
+    std::thread reader;
+
+    void readFiles();
+    std::unique_ptr<char[]> readRange(const FileRange &range) const;
+};
+
+#endif /* block_file_stream_hpp */
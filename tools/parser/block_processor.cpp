@@ -9,9 +9,11 @@
 #define BLOCKSCI_WITHOUT_SINGLETON
 
 #include "block_processor.hpp"
+#include "partitioned_address_resolver.hpp"
 #include "script_input.hpp"
 #include "address_writer.hpp"
 #include "safe_mem_reader.hpp"
+#include "block_file_stream.hpp"
 #include "chain_index.hpp"
 #include "preproccessed_block.hpp"
 #include "chain_index.hpp"
@@ -21,6 +23,11 @@
 #include "output_spend_data.hpp"
 #include "serializable_map.hpp"
 #include "file_writer.hpp"
+#include "input_signature_extractor.hpp"
+#include "output_column_writer.hpp"
+#include "event_count.hpp"
+#include "work_stealing_pool.hpp"
+#include "parser_telemetry.hpp"
 
 #ifdef BLOCKSCI_RPC_PARSER
 #include <bitcoinapi/bitcoinapi.h>
@@ -29,10 +36,16 @@
 #include <boost/lockfree/spsc_queue.hpp>
 
 #include <atomic>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <exception>
 #include <fstream>
 #include <future>
+#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <mutex>
 #include <thread>
 #include <list>
 
@@ -73,73 +86,276 @@ class BlockFileReader;
 
 template <>
 class BlockFileReader<FileTag> : public BlockFileReaderBase {
-    /** Map of (blkXXXXX.dat file number) -> pair(SafeMemReader for blkXXXXX.dat file, last tx number of this blkXXXXX.dat file) */
-    std::unordered_map<int, std::pair<SafeMemReader, uint32_t>> files;
+    /** Decoded transactions of one block, filled by a decoding worker */
+    struct DecodedBlock {
+        std::vector<RawTransaction *> txes;
+        bool ready = false;
+    };
+
+    const ParserConfiguration<FileTag> &config;
+    std::vector<BlockInfo<FileTag>> &blocks;
+
+    /** Blockchain-wide tx number of the first transaction of every block */
+    std::vector<uint32_t> firstTxNums;
+
+    /** Indexes into blocks of the blocks stored in each blkXXXXX.dat file, in order of first appearance */
+    std::vector<std::vector<size_t>> fileGroups;
+
+    /** Index into fileGroups of every block */
+    std::vector<size_t> groupOfBlock;
+
+    std::vector<DecodedBlock> decodedBlocks;
+
+    /** Reads the files ahead of the workers when they are streamed instead of mapped, @see ChainDiskConfiguration::streamReadMB */
+    std::unique_ptr<BlockFileStream> stream;
+
+    /** Map of (blkXXXXX.dat file number) -> pair(SafeMemReader for blkXXXXX.dat file, last tx number of this blkXXXXX.dat file)
+     * The transactions point into the mapped files, so a file stays open until its last transaction left the pipeline */
+    std::unordered_map<int, std::pair<std::unique_ptr<SafeMemReader>, uint32_t>> files;
 
     /** Map of (blkXXXXX.dat file number) -> (last tx number of this blkXXXXX.dat file) */
     std::unordered_map<int, uint32_t> lastTxRequired;
 
-    const ParserConfiguration<FileTag> &config;
-    SafeMemReader *reader = nullptr;
-    
-    blocksci::BlockHeight currentHeight = 0;
-    uint32_t currentTxNum = 0;
+    /** Transactions returned from the end of the pipeline, reused by the decoding workers */
+    std::vector<RawTransaction *> recycledTxes;
+
+    std::mutex mutex;
+    std::condition_variable blockDecoded;
+    std::condition_variable groupsAvailable;
+    std::vector<std::thread> workers;
+    std::exception_ptr workerError;
+    size_t nextGroup = 0;
+    size_t highestGroupNeeded = 0;
+    size_t groupsAhead = 0;
+    bool stopping = false;
+
+    size_t nextBlockIndex = 0;
+    size_t currentBlock = 0;
+    size_t currentTxOffset = 0;
+    bool hasCurrentBlock = false;
+
+    void decodeGroup(size_t groupNum) {
+        auto &group = fileGroups[groupNum];
+        auto fileNum = blocks[group.front()].nFile;
+        std::unique_ptr<SafeMemReader> readerPtr;
+        if (stream) {
+            readerPtr = stream->take(groupNum);
+        } else {
+            auto blockPath = config.pathForBlockFile(fileNum);
+            if (!blockPath.exists()) {
+                std::stringstream ss;
+                ss << "Error: Failed to open block file " << blockPath << "\n";
+                throw std::runtime_error(ss.str());
+            }
+            readerPtr = std::make_unique<SafeMemReader>(blockPath.str());
+        }
+        auto &reader = *readerPtr;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            files.insert(std::make_pair(fileNum, std::make_pair(std::move(readerPtr), lastTxRequired[fileNum])));
+        }
 
-    template<bool shouldAdvance>
-    void nextTxImp(RawTransaction *tx, bool isSegwit) {
-        try {
-            auto firstTxOffset = reader->offset();
-            tx->load(*reader, currentTxNum, currentHeight, isSegwit);
-            if (shouldAdvance) {
-                currentTxNum++;
-            } else {
-                reader->reset(firstTxOffset);
+        for (auto blockIndex : group) {
+            auto &block = blocks[blockIndex];
+            std::vector<RawTransaction *> txes;
+            txes.reserve(block.nTx);
+            {
+                // Try to re-use memory from transactions that have passed the entire queue
+                std::lock_guard<std::mutex> lock(mutex);
+                while (txes.size() < block.nTx && !recycledTxes.empty()) {
+                    txes.push_back(recycledTxes.back());
+                    recycledTxes.pop_back();
+                }
             }
-        } catch (const std::exception &e) {
-            std::cerr << "Failed to load tx"
-            << " from block" << currentHeight
-            << " at offset " << reader->offset()
-            << ".\n" << e.what();
-            throw;
+            while (txes.size() < block.nTx) {
+                txes.push_back(new RawTransaction());
+            }
+
+            // Seek to the block in the blkXXXXX.dat file and skip CblockHeader and transaction count integer
+            reader.reset(block.nDataPos);
+            reader.advance(sizeof(CBlockHeader));
+            reader.readVariableLengthInteger();
+            bool isSegwit = block.height >= config.dataConfig.chainConfig.segwitActivationHeight;
+            auto txNum = firstTxNums[blockIndex];
+            for (auto tx : txes) {
+                try {
+                    tx->load(reader, txNum, block.height, isSegwit);
+                } catch (const std::exception &e) {
+                    std::cerr << "Failed to load tx"
+                    << " from block" << block.height
+                    << " at offset " << reader.offset()
+                    << ".\n" << e.what();
+                    for (auto txToDelete : txes) {
+                        delete txToDelete;
+                    }
+                    throw;
+                }
+                txNum++;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                decodedBlocks[blockIndex].txes = std::move(txes);
+                decodedBlocks[blockIndex].ready = true;
+            }
+            blockDecoded.notify_all();
         }
     }
-    
+
+    void runWorker() {
+        while (true) {
+            size_t groupNum;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                // Stay at most groupsAhead files ahead of the importer to bound the memory of decoded transactions
+                groupsAvailable.wait(lock, [&]() {
+                    return stopping || nextGroup >= fileGroups.size() || nextGroup <= highestGroupNeeded + groupsAhead;
+                });
+                if (stopping || nextGroup >= fileGroups.size()) {
+                    return;
+                }
+                groupNum = nextGroup++;
+            }
+            try {
+                decodeGroup(groupNum);
+            } catch (...) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!workerError) {
+                        workerError = std::current_exception();
+                    }
+                    stopping = true;
+                }
+                blockDecoded.notify_all();
+                groupsAvailable.notify_all();
+                return;
+            }
+        }
+    }
+
+    void releaseCurrentBlock() {
+        if (hasCurrentBlock) {
+            auto &txes = decodedBlocks[currentBlock].txes;
+            // Transactions that were not handed to the pipeline
+            for (size_t i = currentTxOffset; i < txes.size(); i++) {
+                delete txes[i];
+            }
+            std::vector<RawTransaction *>().swap(txes);
+            hasCurrentBlock = false;
+        }
+    }
+
 public:
-    BlockFileReader(const ParserConfiguration<FileTag> &config_, std::vector<BlockInfo<FileTag>> &blocksToAdd, uint32_t firstTxNum) : config(config_) {
-        for (auto &block : blocksToAdd) {
+    /** Decodes the blocks to add on decodeThreads workers ahead of the importer. Every worker takes all blocks of one
+     * blkXXXXX.dat file at a time, the importer then receives the transactions in block height order. */
+    BlockFileReader(const ParserConfiguration<FileTag> &config_, std::vector<BlockInfo<FileTag>> &blocksToAdd, uint32_t firstTxNum) : config(config_), blocks(blocksToAdd) {
+        std::unordered_map<int, size_t> groupOfFile;
+        firstTxNums.reserve(blocks.size());
+        groupOfBlock.reserve(blocks.size());
+        for (size_t i = 0; i < blocks.size(); i++) {
+            auto &block = blocks[i];
+            firstTxNums.push_back(firstTxNum);
             firstTxNum += block.nTx;
             lastTxRequired[block.nFile] = firstTxNum;
+            auto groupIt = groupOfFile.find(block.nFile);
+            if (groupIt == groupOfFile.end()) {
+                groupIt = groupOfFile.insert(std::make_pair(block.nFile, fileGroups.size())).first;
+                fileGroups.emplace_back();
+            }
+            fileGroups[groupIt->second].push_back(i);
+            groupOfBlock.push_back(groupIt->second);
+        }
+        decodedBlocks.resize(blocks.size());
+
+        auto threadCount = config.diskConfig.decodeThreads;
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::min(8u, std::thread::hardware_concurrency() / 2));
+        }
+        threadCount = std::max(1u, std::min(threadCount, static_cast<uint32_t>(fileGroups.size())));
+        groupsAhead = threadCount;
+        if (config.diskConfig.streamReadMB > 0) {
+            std::vector<BlockFileStream::FileRange> ranges;
+            ranges.reserve(fileGroups.size());
+            for (auto &group : fileGroups) {
+                BlockFileStream::FileRange range{config.pathForBlockFile(blocks[group.front()].nFile).str(), std::numeric_limits<size_t>::max(), 0};
+                for (auto blockIndex : group) {
+                    auto &block = blocks[blockIndex];
+                    range.begin = std::min(range.begin, size_t{block.nDataPos});
+                    range.end = std::max(range.end, size_t{block.nDataPos} + block.size);
+                }
+                ranges.push_back(std::move(range));
+            }
+            // One file for every worker and one more that is read while they decode
+            stream = std::make_unique<BlockFileStream>(std::move(ranges), size_t{config.diskConfig.streamReadMB} << 20, threadCount + 1);
+        }
+        for (uint32_t i = 0; i < threadCount; i++) {
+            workers.emplace_back([this]() { runWorker(); });
         }
     }
-    
-    void nextBlock(BlockInfo<FileTag> &block, uint32_t firstTxNum) {
-        auto fileIt = files.find(block.nFile);
-        if (fileIt == files.end()) {
-            auto blockPath = config.pathForBlockFile(block.nFile);
-            if (!blockPath.exists()) {
-                std::stringstream ss;
-                ss << "Error: Failed to open block file " << blockPath << "\n";
-                throw std::runtime_error(ss.str());
+
+    BlockFileReader(const BlockFileReader &) = delete;
+    BlockFileReader &operator=(const BlockFileReader &) = delete;
+
+    ~BlockFileReader() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        groupsAvailable.notify_all();
+        if (stream) {
+            // Workers waiting for a file give up
+            stream->stop();
+        }
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        releaseCurrentBlock();
+        for (auto &decoded : decodedBlocks) {
+            for (auto tx : decoded.txes) {
+                delete tx;
             }
-            files.insert(std::make_pair(block.nFile, std::make_pair(SafeMemReader(blockPath.str()), lastTxRequired[block.nFile])));
         }
-        reader = &files.at(block.nFile).first;
-        reader->reset(block.nDataPos);
-        reader->advance(sizeof(CBlockHeader));
-        reader->readVariableLengthInteger();
-        currentHeight = block.height;
-        currentTxNum = firstTxNum;
+        for (auto tx : recycledTxes) {
+            delete tx;
+        }
     }
-    
-    void nextTx(RawTransaction *tx, bool isSegwit) override {
-        nextTxImp<true>(tx, isSegwit);
+
+    /** Blocks must be requested in the same order as they were passed to the constructor */
+    void nextBlock(BlockInfo<FileTag> &, uint32_t) {
+        releaseCurrentBlock();
+        auto blockIndex = nextBlockIndex++;
+        assert(blockIndex < blocks.size());
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (groupOfBlock[blockIndex] > highestGroupNeeded) {
+                highestGroupNeeded = groupOfBlock[blockIndex];
+                groupsAvailable.notify_all();
+            }
+            blockDecoded.wait(lock, [&]() {
+                return decodedBlocks[blockIndex].ready || workerError;
+            });
+            if (!decodedBlocks[blockIndex].ready) {
+                std::rethrow_exception(workerError);
+            }
+        }
+        currentBlock = blockIndex;
+        currentTxOffset = 0;
+        hasCurrentBlock = true;
     }
-    
-    void nextTxNoAdvance(RawTransaction *tx, bool isSegwit) override {
-        nextTxImp<false>(tx, isSegwit);
+
+    void nextTx(RawTransaction *&tx, bool) override {
+        if (tx != nullptr) {
+            std::lock_guard<std::mutex> lock(mutex);
+            recycledTxes.push_back(tx);
+        }
+        auto &txes = decodedBlocks[currentBlock].txes;
+        assert(currentTxOffset < txes.size());
+        tx = txes[currentTxOffset];
+        currentTxOffset++;
     }
-    
+
     void receivedFinishedTx(RawTransaction *tx) override {
+        std::lock_guard<std::mutex> lock(mutex);
         auto it = files.begin();
         while (it != files.end()) {
             if (it->second.second < tx->txNum) {
@@ -155,54 +371,272 @@ public:
 
 #ifdef BLOCKSCI_RPC_PARSER
 
+namespace {
+    /** Fill txinfo from a transaction of the result of getblock with verbosity 2, which has the same layout as the
+     * result of getrawtransaction */
+    void decodeRPCTransaction(const Json::Value &val, getrawtransaction_t &txinfo) {
+        txinfo.hex = val["hex"].asString();
+        txinfo.txid = val["txid"].asString();
+        txinfo.version = val["version"].asInt();
+        txinfo.locktime = val["locktime"].asUInt();
+        txinfo.vin.clear();
+        for (const auto &inputVal : val["vin"]) {
+            vin_t input;
+            if (inputVal.isMember("coinbase")) {
+                // The coinbase has no spent output, keep its data as the input script like the disk parser does
+                input.n = 0;
+                input.scriptSig.hex = inputVal["coinbase"].asString();
+            } else {
+                input.txid = inputVal["txid"].asString();
+                input.n = inputVal["vout"].asUInt();
+                input.scriptSig.hex = inputVal["scriptSig"]["hex"].asString();
+            }
+            input.sequence = inputVal["sequence"].asUInt();
+            for (const auto &item : inputVal["txinwitness"]) {
+                input.txinwitness.push_back(item.asString());
+            }
+            txinfo.vin.push_back(input);
+        }
+        txinfo.vout.clear();
+        for (const auto &outputVal : val["vout"]) {
+            vout_t output;
+            output.value = outputVal["value"].asDouble();
+            output.n = outputVal["n"].asUInt();
+            output.scriptPubKey.hex = outputVal["scriptPubKey"]["hex"].asString();
+            txinfo.vout.push_back(output);
+        }
+    }
+
+    void loadGenesisTx(RawTransaction *tx) {
+        tx->outputs.clear();
+        tx->outputs.reserve(1);
+        
+        auto scriptPubKey = blocksci::CScript() << ParseHex("040184a11fa689ad5123690c81a3a49c8f13f8d45bac857fbcbc8bc4a8ead3eb4b1ff4d4614fa18dce611aaf1f471216fe1b51851b4acf21b17fc45171ac7b13af") << blocksci::OP_CHECKSIG;
+        std::vector<unsigned char> scriptBytes(scriptPubKey.begin(), scriptPubKey.end());
+        //Set the desired initial block reward
+        tx->outputs.emplace_back(scriptBytes, 50l * 100000000l);
+        tx->hash = blocksci::uint256S("0100000000000000000000000000000000000000000000000000000000000000");
+        tx->blockHeight = blocksci::BlockHeight{0};
+        tx->txNum = 0;
+        tx->isSegwit = false;
+    }
+}
+
 template <>
 class BlockFileReader<RPCTag> : public BlockFileReaderBase {
-    BitcoinAPI bapi;
-    
-    uint32_t firstTxNum = 0;
-    uint32_t currentTxOffset = 0;
-    blocksci::BlockHeight currentHeight = 0;
-    BlockInfo<RPCTag> block;
-    
-    template<bool shouldAdvance>
-    void nextTxImp(RawTransaction *tx, bool isSegwit) {
-        if (currentHeight == 0) {
-            tx->outputs.clear();
-            tx->outputs.reserve(1);
-            
-            auto scriptPubKey = blocksci::CScript() << ParseHex("040184a11fa689ad5123690c81a3a49c8f13f8d45bac857fbcbc8bc4a8ead3eb4b1ff4d4614fa18dce611aaf1f471216fe1b51851b4acf21b17fc45171ac7b13af") << blocksci::OP_CHECKSIG;
-            std::vector<unsigned char> scriptBytes(scriptPubKey.begin(), scriptPubKey.end());
-            //Set the desired initial block reward
-            tx->outputs.emplace_back(scriptBytes, 50l * 100000000l);
-            tx->hash = blocksci::uint256S("0100000000000000000000000000000000000000000000000000000000000000");
-            tx->blockHeight = blocksci::BlockHeight{0};
-            tx->txNum = 0;
-            tx->isSegwit = false;
-        } else {
-            auto txinfo = bapi.getrawtransaction(block.tx[currentTxOffset], 1);
-            tx->load(txinfo, firstTxNum + currentTxOffset, currentHeight, isSegwit);
+    /** Decoded transactions of one block, filled by a fetching worker */
+    struct DecodedBlock {
+        std::vector<RawTransaction *> txes;
+        bool ready = false;
+    };
+
+    const ParserConfiguration<RPCTag> &config;
+    std::vector<BlockInfo<RPCTag>> &blocks;
+
+    /** Blockchain-wide tx number of the first transaction of every block */
+    std::vector<uint32_t> firstTxNums;
+
+    /** Reorder buffer of the blocks fetched by the workers, handed to the importer in block height order */
+    std::vector<DecodedBlock> decodedBlocks;
+
+    /** Transactions returned from the end of the pipeline, reused by the fetching workers */
+    std::vector<RawTransaction *> recycledTxes;
+
+    std::mutex mutex;
+    std::condition_variable blockDecoded;
+    std::condition_variable blocksAvailable;
+    std::vector<std::thread> workers;
+    std::exception_ptr workerError;
+    size_t nextBlockToFetch = 0;
+    size_t blocksAhead = 0;
+    bool stopping = false;
+
+    size_t nextBlockIndex = 0;
+    size_t currentBlock = 0;
+    size_t currentTxOffset = 0;
+    bool hasCurrentBlock = false;
+
+    void fetchBlock(BitcoinAPI &bapi, size_t blockIndex) {
+        auto &block = blocks[blockIndex];
+        std::vector<RawTransaction *> txes;
+        txes.reserve(block.nTx);
+        {
+            // Try to re-use memory from transactions that have passed the entire queue
+            std::lock_guard<std::mutex> lock(mutex);
+            while (txes.size() < block.nTx && !recycledTxes.empty()) {
+                txes.push_back(recycledTxes.back());
+                recycledTxes.pop_back();
+            }
+        }
+        while (txes.size() < block.nTx) {
+            txes.push_back(new RawTransaction());
+        }
+
+        try {
+            if (block.height == 0) {
+                // The node doesn't return the outputs of the genesis coinbase
+                loadGenesisTx(txes.front());
+            } else {
+                // Verbosity 2 returns all transactions of the block decoded in a single round trip
+                Json::Value params(Json::arrayValue);
+                params.append(block.hash.GetHex());
+                params.append(2);
+                auto blockVal = bapi.sendcommand("getblock", params);
+                auto &txVals = blockVal["tx"];
+                if (txVals.size() != block.nTx) {
+                    std::stringstream ss;
+                    ss << "Error: RPC returned " << txVals.size() << " transactions for block " << block.height << " instead of " << block.nTx << "\n";
+                    throw std::runtime_error(ss.str());
+                }
+                bool isSegwit = block.height >= config.dataConfig.chainConfig.segwitActivationHeight;
+                getrawtransaction_t txinfo;
+                for (unsigned int i = 0; i < block.nTx; i++) {
+                    decodeRPCTransaction(txVals[i], txinfo);
+                    txes[i]->load(txinfo, firstTxNums[blockIndex] + i, block.height, isSegwit);
+                }
+            }
+        } catch (const BitcoinException &e) {
+            for (auto txToDelete : txes) {
+                delete txToDelete;
+            }
+            std::stringstream ss;
+            ss << "Error while fetching block " << block.height << " over RPC: " << e.what() << "\n";
+            throw std::runtime_error(ss.str());
+        } catch (...) {
+            for (auto txToDelete : txes) {
+                delete txToDelete;
+            }
+            throw;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            decodedBlocks[blockIndex].txes = std::move(txes);
+            decodedBlocks[blockIndex].ready = true;
+        }
+        blockDecoded.notify_all();
+    }
+
+    void runWorker() {
+        try {
+            // Every worker keeps its own connection to the node
+            auto bapi = config.createBitcoinAPI();
+            while (true) {
+                size_t blockIndex;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    // Stay at most blocksAhead blocks ahead of the importer to bound the reorder buffer
+                    blocksAvailable.wait(lock, [&]() {
+                        return stopping || nextBlockToFetch >= blocks.size() || nextBlockToFetch < nextBlockIndex + blocksAhead;
+                    });
+                    if (stopping || nextBlockToFetch >= blocks.size()) {
+                        return;
+                    }
+                    blockIndex = nextBlockToFetch++;
+                }
+                fetchBlock(bapi, blockIndex);
+            }
+        } catch (...) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!workerError) {
+                    workerError = std::current_exception();
+                }
+                stopping = true;
+            }
+            blockDecoded.notify_all();
+            blocksAvailable.notify_all();
         }
-        if (shouldAdvance) {
-            currentTxOffset++;
+    }
+
+    void releaseCurrentBlock() {
+        if (hasCurrentBlock) {
+            auto &txes = decodedBlocks[currentBlock].txes;
+            // Transactions that were not handed to the pipeline
+            for (size_t i = currentTxOffset; i < txes.size(); i++) {
+                delete txes[i];
+            }
+            std::vector<RawTransaction *>().swap(txes);
+            hasCurrentBlock = false;
         }
     }
     
 public:
-    BlockFileReader(const ParserConfiguration<RPCTag> &config, std::vector<BlockInfo<RPCTag>> &, uint32_t) : bapi(config.createBitcoinAPI()) {}
-    
-    void nextBlock(BlockInfo<RPCTag> &block_, uint32_t txNum) {
-        block = block_;
-        currentHeight = block.height;
-        firstTxNum = txNum;
-        currentTxOffset = 0;
+    /** Fetches the blocks to add with requestThreads concurrent getblock calls ahead of the importer */
+    BlockFileReader(const ParserConfiguration<RPCTag> &config_, std::vector<BlockInfo<RPCTag>> &blocksToAdd, uint32_t firstTxNum) : config(config_), blocks(blocksToAdd) {
+        firstTxNums.reserve(blocks.size());
+        for (auto &block : blocks) {
+            firstTxNums.push_back(firstTxNum);
+            firstTxNum += block.nTx;
+        }
+        decodedBlocks.resize(blocks.size());
+
+        auto threadCount = config.config.requestThreads;
+        if (threadCount == 0) {
+            // Matches the default number of RPC threads of bitcoind
+            threadCount = 4;
+        }
+        threadCount = std::max(1u, std::min(threadCount, static_cast<uint32_t>(blocks.size())));
+        blocksAhead = 4 * threadCount;
+        for (uint32_t i = 0; i < threadCount; i++) {
+            workers.emplace_back([this]() { runWorker(); });
+        }
+    }
+
+    BlockFileReader(const BlockFileReader &) = delete;
+    BlockFileReader &operator=(const BlockFileReader &) = delete;
+
+    ~BlockFileReader() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        blocksAvailable.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        releaseCurrentBlock();
+        for (auto &decoded : decodedBlocks) {
+            for (auto tx : decoded.txes) {
+                delete tx;
+            }
+        }
+        for (auto tx : recycledTxes) {
+            delete tx;
+        }
     }
     
-    void nextTx(RawTransaction *tx, bool isSegwit) override {
-        nextTxImp<true>(tx, isSegwit);
+    /** Blocks must be requested in the same order as they were passed to the constructor */
+    void nextBlock(BlockInfo<RPCTag> &, uint32_t) {
+        releaseCurrentBlock();
+        size_t blockIndex;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            blockIndex = nextBlockIndex++;
+            assert(blockIndex < blocks.size());
+            // Moving on frees a slot of the reorder buffer
+            blocksAvailable.notify_all();
+            blockDecoded.wait(lock, [&]() {
+                return decodedBlocks[blockIndex].ready || workerError;
+            });
+            if (!decodedBlocks[blockIndex].ready) {
+                std::rethrow_exception(workerError);
+            }
+        }
+        currentBlock = blockIndex;
+        currentTxOffset = 0;
+        hasCurrentBlock = true;
     }
     
-    void nextTxNoAdvance(RawTransaction *tx, bool isSegwit) override {
-        nextTxImp<false>(tx, isSegwit);
+    void nextTx(RawTransaction *&tx, bool) override {
+        if (tx != nullptr) {
+            std::lock_guard<std::mutex> lock(mutex);
+            recycledTxes.push_back(tx);
+        }
+        auto &txes = decodedBlocks[currentBlock].txes;
+        assert(currentTxOffset < txes.size());
+        tx = txes[currentTxOffset];
+        currentTxOffset++;
     }
     
     void receivedFinishedTx(RawTransaction *) override {}
@@ -225,17 +659,13 @@ blocksci::RawBlock readNewBlock(uint32_t firstTxNum, uint64_t firstInputNum, uin
     for (uint32_t j = 0; j < block.nTx; j++) {
         RawTransaction *tx = nullptr;
 
-        // Try to re-use memory from transactions that have passed the entire queue
-        if (!loadFunc(tx)) {
-            // No tx is currently available in finished_transaction_queue -> allocate new memory
-            tx = new RawTransaction();
-        } else {
-            // loadFunc(tx) set the pointer tx to memory from a finished RawTransaction -> reuse that space
+        // Hand memory from transactions that have passed the entire queue back to the reader for re-use
+        if (loadFunc(tx)) {
             assert(tx);
             fileReader.receivedFinishedTx(tx);
         }
 
-        // Read next transaction into tx
+        // Get the next transaction, the reader allocates a new one if none was recycled
         fileReader.nextTx(tx, isSegwit);
 
         // For every tx, write blockchain-wide number of the first tx input and output to file (FixedSizeFileMapper<uint64_t>)
@@ -283,29 +713,123 @@ blocksci::RawBlock readNewBlock(uint32_t firstTxNum, uint64_t firstInputNum, uin
 std::vector<std::function<void(RawTransaction &tx)>> CalculateTxHashStep::steps() {
     return {[&](RawTransaction &tx) {
         tx.calculateHash();
+    }, [&](RawTransaction &tx) {
         hashFile.write(tx.hash);
     }};
 }
 
+bool CalculateTxHashStep::isOrderFree(size_t subStepNum) const {
+    // Hashing is independent per transaction, writing the hash file is not
+    return subStepNum == 0;
+}
+
+std::function<void(RawTransaction * const *txes, size_t count)> CalculateTxHashStep::batchStep(size_t subStepNum) {
+    if (subStepNum == 0) {
+        return calculateHashes;
+    }
+    return {};
+}
+
+std::vector<std::function<void(RawTransaction &tx)>> ExtractSignaturesStep::steps() {
+    return {[&](RawTransaction &tx) {
+        tx.inputSignatures.clear();
+        tx.inputSignatures.reserve(tx.inputs.size());
+        for (auto &input : tx.inputs) {
+            tx.inputSignatures.push_back(extractInputSignature(input));
+        }
+    }, [&](RawTransaction &tx) {
+        for (auto &signature : tx.inputSignatures) {
+            signatureFile.write(signature);
+        }
+    }};
+}
+
+bool ExtractSignaturesStep::isOrderFree(size_t subStepNum) const {
+    // Parsing the signatures is independent per transaction, writing them is not
+    return subStepNum == 0;
+}
+
+namespace {
+    uint32_t compactSizeLength(uint64_t value) {
+        if (value < 253) {
+            return 1;
+        } else if (value <= 0xffff) {
+            return 3;
+        } else if (value <= 0xffffffff) {
+            return 5;
+        }
+        return 9;
+    }
+    
+    template <typename T>
+    void appendRecord(std::vector<char> &records, const T &value) {
+        auto data = reinterpret_cast<const char *>(&value);
+        records.insert(records.end(), data, data + sizeof(T));
+    }
+}
+
+std::vector<std::function<void(RawTransaction &tx)>> RecordWitnessesStep::steps() {
+    return {[&](RawTransaction &tx) {
+        tx.witnessRecords.clear();
+        for (auto &input : tx.inputs) {
+            auto witness = input.getWitnessStack();
+            blocksci::RawWitness header{static_cast<uint32_t>(witness.size()), 0};
+            if (!witness.empty()) {
+                header.serializedSize = compactSizeLength(witness.size());
+                for (auto &item : witness) {
+                    header.serializedSize += compactSizeLength(item.length) + item.length;
+                }
+            }
+            appendRecord(tx.witnessRecords, header);
+            for (auto &item : witness) {
+                appendRecord(tx.witnessRecords, item.length);
+            }
+            if (hasItemData) {
+                size_t dataSize = 0;
+                for (auto &item : witness) {
+                    tx.witnessRecords.insert(tx.witnessRecords.end(), item.itemBegin, item.itemBegin + item.length);
+                    dataSize += item.length;
+                }
+                tx.witnessRecords.resize(tx.witnessRecords.size() + (4 - dataSize % 4) % 4, 0);
+            }
+        }
+    }, [&](RawTransaction &tx) {
+        witnessFile.writeIndexGroup();
+        witnessFile.writeBytes(tx.witnessRecords.data(), tx.witnessRecords.size());
+    }};
+}
+
+bool RecordWitnessesStep::isOrderFree(size_t subStepNum) const {
+    // Serializing the witnesses is independent per transaction, writing them is not
+    return subStepNum == 0;
+}
+
 /** 1. step of the processing pipeline
  * Parse the output scripts (into CScriptView) of the transaction in order to identify address types and extract relevant information. */
 std::vector<std::function<void(RawTransaction &tx)>> GenerateScriptOutputsStep::steps() {
     return {[&](RawTransaction &tx) {
         tx.scriptOutputs.clear();
         tx.scriptOutputs.reserve(tx.outputs.size());
-        for (auto &output : tx.outputs) {
-            // 2nd param assumes p2sh is always active
-            // TODO: Add flag to disable p2sh
-            tx.scriptOutputs.emplace_back(output.getScriptView(), true, tx.isSegwit);
-        }
+        // Pick the rules once per transaction so classifying the outputs doesn't branch on them
+        // Assumes p2sh is always active
+        // TODO: Add flag to disable p2sh
+        dispatchScriptRules(true, tx.isSegwit, [&](auto rules) {
+            for (auto &output : tx.outputs) {
+                tx.scriptOutputs.emplace_back(output.getScriptView(), rules);
+            }
+        });
     }};
 }
 
+bool GenerateScriptOutputsStep::isOrderFree(size_t) const {
+    return true;
+}
+
 /** 2. step of the processing pipeline
  * Store information about the spent output with each input of the transaction. Then store information about each output for future lookup. */
 std::vector<std::function<void(RawTransaction &tx)>> ConnectUTXOsStep::steps() {
     return {[&](RawTransaction &tx) {
-        // Fill UTXOState (SerializableMap<RawOutputPointer, UTXO>) with mapping tx output ->  UTXO(output.value, txNum, type)
+        // Fill UTXOState (sharded PackedUTXOMap) with mapping tx output ->  UTXO(output.value, txNum, type)
         for (uint16_t i = 0; i < tx.outputs.size(); i++) {
             auto &output = tx.outputs[i];
             auto &scriptOutput = tx.scriptOutputs[i];
@@ -324,6 +848,34 @@ std::vector<std::function<void(RawTransaction &tx)>> ConnectUTXOsStep::steps() {
     }};
 }
 
+bool ConnectUTXOsStep::isOrderFree(size_t subStepNum) const {
+    /* Outputs are added in order. By the time a transaction reaches the second substep every earlier transaction
+     * has added its outputs, so the inputs can be spent in any order since no two inputs spend the same output. */
+    return subStepNum == 1;
+}
+
+std::function<void(RawTransaction * const *txes, size_t count)> ConnectUTXOsStep::batchStep(size_t subStepNum) {
+    if (subStepNum != 1) {
+        return {};
+    }
+    return [&](RawTransaction * const *txes, size_t count) {
+        std::vector<RawOutputPointer> pointers;
+        for (size_t i = 0; i < count; i++) {
+            for (auto &input : txes[i]->inputs) {
+                pointers.push_back(input.rawOutputPointer);
+            }
+        }
+        std::vector<UTXO> utxos(pointers.size());
+        utxoState.eraseBatch(pointers.data(), utxos.data(), pointers.size());
+        size_t inputNum = 0;
+        for (size_t i = 0; i < count; i++) {
+            for (auto &input : txes[i]->inputs) {
+                input.utxo = utxos[inputNum++];
+            }
+        }
+    };
+}
+
 /** 3. step of the processing pipeline
  * Parse the input script of each input based information about the associated output script.
  * Then store information about each output address for future lookup. */
@@ -351,15 +903,89 @@ std::vector<std::function<void(RawTransaction &tx)>> GenerateScriptInputStep::st
  * Attach a scriptNum to each script in the transaction. For address types which are
  * deduplicated (Pubkey, ScriptHash, Multisig and their varients) use the previously allocated
  * scriptNum if the address was seen before. Increment the scriptNum counter for newly seen addresses. */
+ProcessAddressesStep::ProcessAddressesStep(AddressState &addressState_, WorkStealingPool &pool_, UndoJournalWriter *undoJournal_, bool partitionedScriptNums) : addressState(addressState_), pool(pool_), undoJournal(undoJournal_) {
+    if (partitionedScriptNums) {
+        partitionedResolver = std::make_unique<PartitionedAddressResolver>(addressState, pool);
+    }
+}
+
+ProcessAddressesStep::~ProcessAddressesStep() = default;
+
 std::vector<std::function<void(RawTransaction &tx)>> ProcessAddressesStep::steps() {
     return {[&](RawTransaction &tx) {
-        for (auto &scriptOutput : tx.scriptOutputs) {
-            scriptOutput.resolve(addressState);
+        processTx(tx);
+    }};
+}
+
+/** Hashing the scripts and checking the bloom filters and multi use maps doesn't change the address state, so it runs
+ * for all outputs of the batch on the pool while this step waits. Only assigning the scriptNums stays serial, which
+ * keeps them the same as resolving every output in order. */
+std::function<void(RawTransaction * const *txes, size_t count)> ProcessAddressesStep::batchStep(size_t) {
+    return [&](RawTransaction * const *txes, size_t count) {
+        if (partitionedResolver && count > 0 && !isJournaled(txes, count)) {
+            partitionedResolver->resolve(txes, count);
+            currentHeight = txes[count - 1]->blockHeight;
+            addressState.publishStats();
+            return;
         }
-        for (auto &scriptInput : tx.scriptInputs) {
-            scriptInput.process(addressState);
+        batchOutputs.clear();
+        for (size_t i = 0; i < count; i++) {
+            for (auto &scriptOutput : txes[i]->scriptOutputs) {
+                batchOutputs.push_back(&scriptOutput);
+            }
         }
-    }};
+        const AddressState &probeState = addressState;
+        pool.parallelFor(batchOutputs.size(), 16, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                batchOutputs[i]->probe(probeState);
+            }
+        });
+        for (auto scriptOutput : batchOutputs) {
+            scriptOutput->queueProbe(addressState);
+        }
+        addressState.finishProbes();
+        for (size_t i = 0; i < count; i++) {
+            processTx(*txes[i]);
+        }
+    };
+}
+
+bool ProcessAddressesStep::isJournaled(RawTransaction * const *txes, size_t count) const {
+    if (undoJournal == nullptr) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (undoJournal->isJournaled(txes[i]->blockHeight)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ProcessAddressesStep::processTx(RawTransaction &tx) {
+    bool journaled = undoJournal != nullptr && undoJournal->isJournaled(tx.blockHeight);
+    // Transactions pass this step in order, so the counts are the ones before the block
+    if (tx.blockHeight != currentHeight) {
+        currentHeight = tx.blockHeight;
+        addressState.publishStats();
+        if (journaled) {
+            undoJournal->beginBlock(tx.blockHeight, tx.txNum, addressState.scriptCounts());
+        }
+    }
+    if (journaled) {
+        newAddresses.clear();
+        addressState.setNewAddressLog(&newAddresses);
+    }
+    for (auto &scriptOutput : tx.scriptOutputs) {
+        scriptOutput.resolve(addressState);
+    }
+    for (auto &scriptInput : tx.scriptInputs) {
+        scriptInput.process(addressState);
+    }
+    if (journaled) {
+        addressState.setNewAddressLog(nullptr);
+        undoJournal->addAddresses(tx.blockHeight, newAddresses);
+    }
 }
 
 /* 5. step of the processing pipeline
@@ -414,33 +1040,56 @@ std::vector<std::function<void(RawTransaction &tx)>> SerializeTransactionStep::s
 /** 7. step of the processing pipeline
  * Save address data into files for the analysis library */
 std::vector<std::function<void(RawTransaction &tx)>> SerializeAddressesStep::steps() {
-    return {[&](RawTransaction &tx) {        
-        for (auto &scriptOutput : tx.scriptOutputs) {
-            if (scriptOutput.isNew()) {
-                // serialize new script to file
-                addressWriter.serializeNewOutput(scriptOutput, tx.txNum, true);
-            }
-        }
-        
-        for (size_t i = 0; i < tx.inputs.size(); i++) {
-            auto &input = tx.inputs[i];
-            auto &scriptInput = tx.scriptInputs[i];
-            addressWriter.serializeWrappedScript(scriptInput, tx.txNum, input.utxo.txNum);
-        }
+    return {[&](RawTransaction &tx) {
+        queueNewScripts(tx);
+        addressWriter.flushWrites();
     }, [&](RawTransaction &tx) {
-        // updates the seenTopLevel flag for outputs that have only been seen wrapped in inputs so far
-        for (auto &scriptOutput : tx.scriptOutputs) {
-            if (!scriptOutput.isNew()) {
-                addressWriter.serializeExistingOutput(scriptOutput, true);
+        queueSeenScripts(tx);
+        addressWriter.flushWrites();
+    }};
+}
+
+std::function<void(RawTransaction * const *txes, size_t count)> SerializeAddressesStep::batchStep(size_t subStepNum) {
+    return [this, subStepNum](RawTransaction * const *txes, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            if (subStepNum == 0) {
+                queueNewScripts(*txes[i]);
+            } else {
+                queueSeenScripts(*txes[i]);
             }
         }
-        
-        for (size_t i = 0; i < tx.inputs.size(); i++) {
-            auto &input = tx.inputs[i];
-            auto &scriptInput = tx.scriptInputs[i];
-            addressWriter.serializeInput(scriptInput, tx.txNum, input.utxo.txNum);
+        addressWriter.flushWrites(pool);
+    };
+}
+
+void SerializeAddressesStep::queueNewScripts(const RawTransaction &tx) {
+    for (auto &scriptOutput : tx.scriptOutputs) {
+        if (scriptOutput.isNew()) {
+            // serialize new script to file
+            addressWriter.queueNewOutput(scriptOutput, tx.txNum, true);
         }
-    }};
+    }
+    
+    for (size_t i = 0; i < tx.inputs.size(); i++) {
+        auto &input = tx.inputs[i];
+        auto &scriptInput = tx.scriptInputs[i];
+        addressWriter.queueWrappedScript(scriptInput, tx.txNum, input.utxo.txNum);
+    }
+}
+
+void SerializeAddressesStep::queueSeenScripts(const RawTransaction &tx) {
+    // updates the seenTopLevel flag for outputs that have only been seen wrapped in inputs so far
+    for (auto &scriptOutput : tx.scriptOutputs) {
+        if (!scriptOutput.isNew()) {
+            addressWriter.queueExistingOutput(scriptOutput, tx.txNum, true);
+        }
+    }
+    
+    for (size_t i = 0; i < tx.inputs.size(); i++) {
+        auto &input = tx.inputs[i];
+        auto &scriptInput = tx.scriptInputs[i];
+        addressWriter.queueInput(scriptInput, tx.txNum, input.utxo.txNum);
+    }
 }
 
 void backUpdateTxes(const ParserConfigurationBase &config) {
@@ -476,22 +1125,44 @@ void backUpdateTxes(const ParserConfigurationBase &config) {
             progressBar.update(count);
         }
     }
+    
+    if (outputColumnsExist(config)) {
+        // Keep the spending tx column in sync for outputs it already covers, newer outputs are added by updateOutputColumns
+        auto chainDirectory = config.dataConfig.chainDirectory();
+        blocksci::FixedSizeFileMapper<uint64_t> firstOutputFile(blocksci::ChainAccess::firstOutputFilePath(chainDirectory));
+        blocksci::FixedSizeFileMapper<uint32_t, mio::access_mode::write> spentTxFile(blocksci::ChainAccess::outputSpentTxFilePath(chainDirectory));
+        for (auto &update : updates) {
+            if (update.pointer.txNum < firstOutputFile.size()) {
+                auto outputNum = static_cast<blocksci::OffsetType>(*firstOutputFile[update.pointer.txNum] + update.pointer.inoutNum);
+                if (outputNum < spentTxFile.size()) {
+                    *spentTxFile[outputNum] = update.txNum;
+                }
+            }
+        }
+    }
     filesystem::path{config.txUpdatesFilePath() + ".dat"}.remove_file();
 }
 
 struct CompletionGuard {
-    explicit CompletionGuard(std::atomic<bool> &isDone_) : isDone(isDone_) {}
+    /** doneSignal is notified after isDone has been set, so that a waiting consumer notices the completion */
+    explicit CompletionGuard(std::atomic<bool> &isDone_, EventCount *doneSignal_ = nullptr) : isDone(isDone_), doneSignal(doneSignal_) {}
     CompletionGuard(const CompletionGuard &) = delete;
     CompletionGuard &operator=(const CompletionGuard &) = delete;
     CompletionGuard(CompletionGuard &&) = delete;
     CompletionGuard &operator=(CompletionGuard &&) = delete;
     ~CompletionGuard() {
         isDone = true;
+        if (doneSignal != nullptr) {
+            doneSignal->notify();
+        }
     }
 private:
     std::atomic<bool> &isDone;
+    EventCount *doneSignal;
 };
 
+using SteadyClock = std::chrono::steady_clock;
+
 struct NextQueueFinishedEarlyException : public std::runtime_error {
     NextQueueFinishedEarlyException() : std::runtime_error("Next queue finished early") {}
 };
@@ -499,7 +1170,8 @@ struct NextQueueFinishedEarlyException : public std::runtime_error {
 /* Single-producer/single-consumer fifo queues, pushing and popping is wait-free
  * size of the ringbuffer is specified by boost::lockfree::capacity<>
  */
-using TxQueue = boost::lockfree::spsc_queue<RawTransaction *, boost::lockfree::capacity<10000>>;
+static constexpr size_t txQueueCapacity = 10000;
+using TxQueue = boost::lockfree::spsc_queue<RawTransaction *, boost::lockfree::capacity<txQueueCapacity>>;
 
 using DiscardCheckFunc = std::function<bool(RawTransaction &)>;
 
@@ -531,6 +1203,11 @@ struct QueueStage {
     virtual void complete() = 0;
     virtual ~QueueStage() = default;
     
+    /** Whether the stage still holds transactions that it took from its input queue */
+    virtual bool hasPending() const {
+        return false;
+    }
+    
     std::atomic<bool> *prevDone = nullptr;
     
     std::atomic<bool> isDone{false};
@@ -539,26 +1216,91 @@ struct QueueStage {
     TxQueue *nextQueue;
     std::atomic<bool> *nextDone = nullptr;
     
-    int64_t nextWaitCount;
+    /** Signal of the thread running this stage, notified when there is new input, space in nextQueue or a
+     * neighbouring stage finished */
+    EventCount *ownerSignal = nullptr;
+    
+    /** Signals of the threads consuming nextQueue and producing inputQueue */
+    EventCount *nextSignal = nullptr;
+    EventCount *prevSignal = nullptr;
+    
     StepNum stepNum;
     
+    /** Statistics reported after the pipeline finished */
+    uint64_t processedCount = 0;
+    uint64_t queueDepthSum = 0;
+    uint64_t queueDepthSamples = 0;
+    SteadyClock::duration blockedTime{0};
+    
+    /** Copies of the statistics for the telemetry thread, refreshed by the thread running the stage */
+    std::atomic<uint64_t> publishedProcessedCount{0};
+    std::atomic<uint64_t> publishedQueueDepth{0};
+    std::atomic<SteadyClock::rep> publishedBlockedTime{0};
+    
+    void publishStats() {
+        publishedProcessedCount.store(processedCount, std::memory_order_relaxed);
+        publishedQueueDepth.store(inputQueue.read_available(), std::memory_order_relaxed);
+        publishedBlockedTime.store(blockedTime.count(), std::memory_order_relaxed);
+    }
+    
+    /** The neighbours are notified once per pass over the stages of a thread instead of for every transaction */
+    bool pushedSinceNotify = false;
+    bool poppedSinceNotify = false;
+    
+    void notifyNeighbours() {
+        if (pushedSinceNotify && nextSignal != nullptr) {
+            nextSignal->notify();
+        }
+        if (poppedSinceNotify && prevSignal != nullptr) {
+            prevSignal->notify();
+        }
+        pushedSinceNotify = false;
+        poppedSinceNotify = false;
+    }
+    
+    bool popInput(RawTransaction *&tx) {
+        if (inputQueue.pop(tx)) {
+            poppedSinceNotify = true;
+            return true;
+        }
+        return false;
+    }
+    
+    void sampleQueueDepth() {
+        queueDepthSum += inputQueue.read_available();
+        queueDepthSamples++;
+    }
+    
     void push(RawTransaction *tx) {
-        using namespace std::chrono_literals;
-        while (!nextQueue->push(tx)) {
+        if (nextQueue->push(tx)) {
+            pushedSinceNotify = true;
+            return;
+        }
+        // The next queue is full, make sure its consumer knows about everything queued so far and wait for space
+        notifyNeighbours();
+        auto waitStart = SteadyClock::now();
+        while (true) {
+            auto key = ownerSignal->prepareWait();
+            if (nextQueue->push(tx)) {
+                break;
+            }
             if (nextDone && *nextDone) {
                 // Error: next ProcessStep finished before all items were queued
                 throw NextQueueFinishedEarlyException();
             }
-            nextWaitCount++;
-            std::this_thread::sleep_for(5ms);
+            ownerSignal->wait(key);
         }
+        blockedTime += SteadyClock::now() - waitStart;
+        pushedSinceNotify = true;
     }
     
     void linkBack(QueueStage &prevStage) {
         // Link the queue- and done-pointers for the previous queue to this object's variables
         prevStage.nextQueue = &inputQueue;
         prevStage.nextDone = &isDone;
+        prevStage.nextSignal = ownerSignal;
         prevDone = &prevStage.isDone;
+        prevSignal = prevStage.ownerSignal;
     }
     
     bool prevFinished() {
@@ -569,17 +1311,47 @@ struct QueueStage {
 
 class ProcessSubStep : public QueueStage {
 public:
+    static constexpr size_t batchSize = 64;
+    
     std::function<void(RawTransaction &)> func;
+    std::function<void(RawTransaction * const *, size_t)> batchFunc;
     DiscardCheckFunc shouldDiscard;
     bool discardIfFull;
     
-    ProcessSubStep(std::function<void(RawTransaction &)> func_, const DiscardCheckFunc &shouldDiscard_, bool discardIfFull_) : func(std::move(func_)), shouldDiscard(shouldDiscard_), discardIfFull(discardIfFull_) {}
+    ProcessSubStep(std::function<void(RawTransaction &)> func_, std::function<void(RawTransaction * const *, size_t)> batchFunc_, const DiscardCheckFunc &shouldDiscard_, bool discardIfFull_) : func(std::move(func_)), batchFunc(std::move(batchFunc_)), shouldDiscard(shouldDiscard_), discardIfFull(discardIfFull_) {}
+    
+    /** Runs batchFunc over the available transactions that fit into the next queue */
+    bool processBatch() {
+        auto limit = discardIfFull ? batchSize : std::min(batchSize, nextQueue->write_available());
+        RawTransaction *txes[batchSize];
+        size_t count = 0;
+        while (count < limit && popInput(txes[count])) {
+            assert(txes[count] != nullptr);
+            count++;
+        }
+        if (count == 0) {
+            return false;
+        }
+        batchFunc(txes, count);
+        processedCount += count;
+        for (size_t i = 0; i < count; i++) {
+            if (nextQueue->write_available() == 0 || shouldDiscard(*txes[i])) {
+                delete txes[i];
+            } else {
+                push(txes[i]);
+            }
+        }
+        return true;
+    }
     
     // inputProcessingDone
     bool processNext() override {
+        if (batchFunc) {
+            return processBatch();
+        }
         if (inputQueue.read_available() && (discardIfFull || nextQueue->write_available() > 0)) {
             RawTransaction *rawTx = nullptr;
-            inputQueue.pop(rawTx);
+            popInput(rawTx);
 //            {
 //                static std::mutex m;
 //                std::lock_guard<std::mutex> lock(m);
@@ -588,6 +1360,7 @@ public:
             assert(rawTx != nullptr);
             // Execute processing step on rawTx, eg. calculateHashesFunc or connectUTXOsFunc
             func(*rawTx);
+            processedCount++;
             // Check if advanceFunc is successful before further processing the pipeline
             if (nextQueue->write_available() == 0 || shouldDiscard(*rawTx)) {
                 delete rawTx;
@@ -605,13 +1378,173 @@ public:
     }
 };
 
+/** Substep of an order-free ProcessorStep, executed on the shared WorkStealingPool
+ *
+ * The step's thread only dispatches batches of transactions to the pool and forwards finished transactions to the
+ * next queue through a reorder buffer, so the following steps still see the transactions in their original order.
+ */
+class ParallelSubStep : public QueueStage {
+    static constexpr size_t maxInFlight = 8192;
+    static constexpr size_t batchSize = 64;
+    
+    std::function<void(RawTransaction &)> func;
+    std::function<void(RawTransaction * const *, size_t)> batchFunc;
+    DiscardCheckFunc shouldDiscard;
+    bool discardIfFull;
+    WorkStealingPool &pool;
+    
+    /** Reorder buffer, transaction number n of the stage is stored in slot n % maxInFlight */
+    std::unique_ptr<RawTransaction *[]> slots;
+    std::unique_ptr<std::atomic<bool>[]> finished;
+    
+    /** Number of transactions dispatched to the pool and forwarded to the next queue */
+    uint64_t dispatchedCount = 0;
+    uint64_t forwardedCount = 0;
+    
+    std::atomic<uint64_t> outstandingBatches{0};
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    
+    void recordError() {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (!error) {
+            error = std::current_exception();
+        }
+    }
+    
+    void runBatch(uint64_t begin, size_t count) {
+        if (batchFunc) {
+            RawTransaction *txes[batchSize];
+            for (size_t i = 0; i < count; i++) {
+                txes[i] = slots[(begin + i) % maxInFlight];
+            }
+            try {
+                batchFunc(txes, count);
+            } catch (...) {
+                recordError();
+            }
+        }
+        for (size_t i = 0; i < count; i++) {
+            auto slot = (begin + i) % maxInFlight;
+            if (!batchFunc) {
+                try {
+                    func(*slots[slot]);
+                } catch (...) {
+                    recordError();
+                }
+            }
+            finished[slot].store(true, std::memory_order_release);
+        }
+        // Wake up the step's thread once per batch to forward the finished transactions
+        ownerSignal->notify();
+        outstandingBatches.fetch_sub(1, std::memory_order_acq_rel);
+    }
+    
+    bool dispatch() {
+        bool progress = false;
+        while (dispatchedCount - forwardedCount + batchSize <= maxInFlight) {
+            size_t count = 0;
+            RawTransaction *rawTx = nullptr;
+            while (count < batchSize && popInput(rawTx)) {
+                assert(rawTx != nullptr);
+                slots[(dispatchedCount + count) % maxInFlight] = rawTx;
+                count++;
+            }
+            if (count == 0) {
+                break;
+            }
+            auto begin = dispatchedCount;
+            dispatchedCount += count;
+            outstandingBatches.fetch_add(1, std::memory_order_acq_rel);
+            pool.submit([this, begin, count]() { runBatch(begin, count); });
+            progress = true;
+        }
+        return progress;
+    }
+    
+    bool forward(bool waitForSpace) {
+        bool progress = false;
+        while (forwardedCount < dispatchedCount) {
+            auto slot = forwardedCount % maxInFlight;
+            if (!finished[slot].load(std::memory_order_acquire)) {
+                break;
+            }
+            bool nextFull = nextQueue->write_available() == 0;
+            if (nextFull && !discardIfFull && !waitForSpace) {
+                break;
+            }
+            auto rawTx = slots[slot];
+            finished[slot].store(false, std::memory_order_relaxed);
+            forwardedCount++;
+            processedCount++;
+            if ((nextFull && discardIfFull) || shouldDiscard(*rawTx)) {
+                delete rawTx;
+            } else {
+                // Waits for space in the next queue if necessary
+                push(rawTx);
+            }
+            progress = true;
+        }
+        return progress;
+    }
+    
+    void rethrowError() {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    
+public:
+    ParallelSubStep(std::function<void(RawTransaction &)> func_, std::function<void(RawTransaction * const *, size_t)> batchFunc_, const DiscardCheckFunc &shouldDiscard_, bool discardIfFull_, WorkStealingPool &pool_) : func(std::move(func_)), batchFunc(std::move(batchFunc_)), shouldDiscard(shouldDiscard_), discardIfFull(discardIfFull_), pool(pool_), slots(std::make_unique<RawTransaction *[]>(maxInFlight)), finished(std::make_unique<std::atomic<bool>[]>(maxInFlight)) {
+        for (size_t i = 0; i < maxInFlight; i++) {
+            finished[i] = false;
+        }
+    }
+    
+    ~ParallelSubStep() override {
+        // The pool may still be running batches that reference the reorder buffer if the pipeline failed
+        while (outstandingBatches.load(std::memory_order_acquire) > 0) {
+            std::this_thread::yield();
+        }
+    }
+    
+    bool processNext() override {
+        rethrowError();
+        bool progress = forward(false);
+        progress |= dispatch();
+        return progress;
+    }
+    
+    bool hasPending() const override {
+        return forwardedCount < dispatchedCount;
+    }
+    
+    void complete() override {
+        while (hasPending()) {
+            rethrowError();
+            auto key = ownerSignal->prepareWait();
+            if (!forward(true)) {
+                ownerSignal->wait(key);
+            }
+        }
+        rethrowError();
+    }
+};
+
 ProcessorStep::~ProcessorStep() = default;
 
+bool ProcessorStep::isOrderFree(size_t) const {
+    return false;
+}
+
+std::function<void(RawTransaction * const *txes, size_t count)> ProcessorStep::batchStep(size_t) {
+    return {};
+}
+
 struct TxHoldSubStep : public QueueStage {
     std::vector<RawTransaction *> heldTransactions;
     
-    int64_t prevWaitCount = 0;
-    
     TxHoldSubStep() {}
     
     ~TxHoldSubStep() override {
@@ -619,16 +1552,16 @@ struct TxHoldSubStep : public QueueStage {
     }
     
     void emptyQueue() {
-        using namespace std::chrono_literals;
         for (auto tx : heldTransactions) {
             push(tx);
         }
+        processedCount += heldTransactions.size();
         heldTransactions.clear();
     }
     
     bool processNext() override {
         RawTransaction *rawTx = nullptr;
-        inputQueue.pop(rawTx);
+        popInput(rawTx);
         if (rawTx) {
             if (heldTransactions.size() == 0 || heldTransactions.back()->blockHeight == rawTx->blockHeight) {
                 heldTransactions.push_back(rawTx);
@@ -649,72 +1582,124 @@ struct TxHoldSubStep : public QueueStage {
 
 class ProcessStep {
 public:
+    std::string name;
+    
+    /** Wakes up the thread of this step, shared by all of its stages. Declared first since stages notify it
+     * until they are destroyed */
+    std::unique_ptr<EventCount> signal;
+    
     std::unique_ptr<ProcessorStep> func;
     std::vector<std::unique_ptr<QueueStage>> stages;
     
-    int64_t prevWaitCount = 0;
+    /** Time spent waiting with nothing to do and the total running time of the step's thread */
+    SteadyClock::duration idleTime{0};
+    SteadyClock::duration runTime{0};
+    
+    /** Copies of the times for the telemetry thread, behind a pointer since steps are moved into the queue */
+    struct PublishedTimes {
+        std::atomic<SteadyClock::rep> start{0};
+        std::atomic<SteadyClock::rep> idle{0};
+        std::atomic<SteadyClock::rep> run{0};
+    };
+    std::unique_ptr<PublishedTimes> publishedTimes;
     
     // AdvanceFunc
-    ProcessStep(std::unique_ptr<ProcessorStep> func_, std::vector<std::unique_ptr<QueueStage>> stages_) : func(std::move(func_)), stages(std::move(stages_)) {
+    ProcessStep(std::unique_ptr<ProcessorStep> func_, std::vector<std::unique_ptr<QueueStage>> stages_) : signal(std::make_unique<EventCount>()), func(std::move(func_)), stages(std::move(stages_)), publishedTimes(std::make_unique<PublishedTimes>()) {
+        for (auto &stage : stages) {
+            stage->ownerSignal = signal.get();
+        }
     }
 
     bool anyNotDone() {
         for (auto &stage : stages) {
-            if (!stage->prevFinished() || !stage->inputQueue.empty()) {
+            if (!stage->prevFinished() || !stage->inputQueue.empty() || stage->hasPending()) {
                 return true;
             }
         }
         return false;
     }
     
-    void doAll() {
+    void notifyNeighbours() {
+        for (auto &stage : stages) {
+            stage->notifyNeighbours();
+        }
+    }
+    
+    /** Process everything currently available, returns whether any stage made progress */
+    bool doAll() {
+        bool anyProgress = false;
         bool success = true;
         while (success) {
             success = false;
             for (auto &stage : stages) {
+                stage->sampleQueueDepth();
                 success |= stage->processNext();
             }
+            notifyNeighbours();
+            anyProgress |= success;
+        }
+        
+        for (auto &stage : stages) {
+            stage->publishStats();
         }
         
         for (auto &stage : stages) {
-            if (stage->prevFinished() && stage->inputQueue.empty()) {
+            if (stage->prevFinished() && stage->inputQueue.empty() && !stage->isDone) {
                 stage->complete();
                 stage->isDone = true;
+                stage->notifyNeighbours();
+                if (stage->nextSignal != nullptr) {
+                    stage->nextSignal->notify();
+                }
+                anyProgress = true;
             }
         }
+        return anyProgress;
     }
     // inputProcessingDone
     void run() {
-        using namespace std::chrono_literals;
+        auto runStart = SteadyClock::now();
+        publishedTimes->start.store(runStart.time_since_epoch().count(), std::memory_order_relaxed);
         // CompletionGuard sets isDone to true in its destructor that is called at the end of this operator() method
         std::list<CompletionGuard> guards;
         for (auto &stage : stages) {
-            guards.emplace_back(stage->isDone);
+            guards.emplace_back(stage->isDone, stage->nextSignal);
         }
         
-        // Consume queued items as long as the previous processing step has not finished
+        // Consume queued items as long as the previous processing step has not finished, park when there is nothing to do
         while (anyNotDone()) {
-            doAll();
-            prevWaitCount++;
-            std::this_thread::sleep_for(5ms);
+            auto key = signal->prepareWait();
+            if (!doAll()) {
+                auto waitStart = SteadyClock::now();
+                signal->wait(key);
+                idleTime += SteadyClock::now() - waitStart;
+                publishedTimes->idle.store(idleTime.count(), std::memory_order_relaxed);
+            }
         }
 
         // Last call to consume queued items to catch last items
         doAll();
         for (auto &stage : stages) {
             stage->complete();
+            stage->notifyNeighbours();
+            stage->publishStats();
         }
+        runTime = SteadyClock::now() - runStart;
+        publishedTimes->run.store(runTime.count(), std::memory_order_relaxed);
     }
 };
 
-ProcessStep makeStandardProcessStep(std::unique_ptr<ProcessorStep> && func, const DiscardCheckFunc &advanceFuncFirst, const DiscardCheckFunc &advanceFuncSecond, bool discardIfFullFirst = false, bool discardIfFullSecond = false) {
+ProcessStep makeStandardProcessStep(std::unique_ptr<ProcessorStep> && func, WorkStealingPool &pool, const DiscardCheckFunc &advanceFuncFirst, const DiscardCheckFunc &advanceFuncSecond, bool discardIfFullFirst = false, bool discardIfFullSecond = false) {
     std::vector<std::unique_ptr<QueueStage>> subSteps;
     auto steps = func->steps();
     for (size_t i = 0; i < steps.size(); i++) {
-        if (i == steps.size() - 1) {
-            subSteps.push_back(std::make_unique<ProcessSubStep>(steps[i], advanceFuncSecond, discardIfFullSecond));
+        bool isLast = i == steps.size() - 1;
+        auto &advanceFunc = isLast ? advanceFuncSecond : advanceFuncFirst;
+        auto discardIfFull = isLast ? discardIfFullSecond : discardIfFullFirst;
+        if (func->isOrderFree(i)) {
+            subSteps.push_back(std::make_unique<ParallelSubStep>(steps[i], func->batchStep(i), advanceFunc, discardIfFull, pool));
         } else {
-            subSteps.push_back(std::make_unique<ProcessSubStep>(steps[i], advanceFuncFirst, discardIfFullFirst));
+            subSteps.push_back(std::make_unique<ProcessSubStep>(steps[i], func->batchStep(i), advanceFunc, discardIfFull));
         }
     }
     return {std::move(func), std::move(subSteps)};
@@ -737,13 +1722,25 @@ struct ProcessStepQueue {
     TxQueue finishedQueue;
     
     QueueStage *firstStage;
+    QueueStage *lastStage;
+    
+    /** Wakes up the importer when the first stage has consumed input */
+    EventCount importerSignal;
+    SteadyClock::duration importerBlockedTime{0};
+    
+    /** Progress of the importer for the telemetry thread */
+    std::atomic<uint64_t> importedBlocks{0};
+    std::atomic<uint64_t> importedTxes{0};
+    std::atomic<uint64_t> importedBytes{0};
+    std::atomic<SteadyClock::rep> publishedImporterBlockedTime{0};
     
     std::vector<ProcessStep> steps;
     std::vector<std::future<void>> futures;
     
     ProcessStepQueue() {}
     
-    void addStep(ProcessStep && step) {
+    void addStep(std::string name, ProcessStep && step) {
+        step.name = std::move(name);
         steps.emplace_back(std::move(step));
     }
     
@@ -779,12 +1776,13 @@ struct ProcessStepQueue {
                 stage->linkBack(*prevStage);
             } else {
                 stage->prevDone = &importDone;
+                stage->prevSignal = &importerSignal;
             }
             prevStage = stage.get();
         }
         
         auto lastStepNum = subStepList.back();
-        auto &lastStage = steps[lastStepNum.threadNum].stages[lastStepNum.subStepNum];
+        lastStage = steps[lastStepNum.threadNum].stages[lastStepNum.subStepNum].get();
         
         // Add finishedQueue as the last queue after the last actual processing step
         lastStage->nextQueue = &finishedQueue;
@@ -794,14 +1792,112 @@ struct ProcessStepQueue {
         firstStage = steps[firstStepNum.threadNum].stages[firstStepNum.subStepNum].get();
     }
     
-    TxQueue &inputQueue() {
+    /** Add a transaction to the first queue of the pipeline, waiting for space if it is full. Called by the importer */
+    void pushInput(RawTransaction *tx) {
         assert(firstStage != nullptr);
-        return firstStage->inputQueue;
+        if (!firstStage->inputQueue.push(tx)) {
+            auto waitStart = SteadyClock::now();
+            while (true) {
+                auto key = importerSignal.prepareWait();
+                if (firstStage->inputQueue.push(tx)) {
+                    break;
+                }
+                if (firstStage->isDone) {
+                    // Error: calculateHashesStep() finished before all items were queued
+                    throw NextQueueFinishedEarlyException();
+                }
+                importerSignal.wait(key);
+            }
+            importerBlockedTime += SteadyClock::now() - waitStart;
+            publishedImporterBlockedTime.store(importerBlockedTime.count(), std::memory_order_relaxed);
+        }
+        firstStage->ownerSignal->notify();
     }
     
-    bool isRunning() {
+    /** Take a transaction that has passed the whole pipeline for re-use. Called by the importer */
+    bool popFinished(RawTransaction *&tx) {
+        if (finishedQueue.pop(tx)) {
+            lastStage->ownerSignal->notify();
+            return true;
+        }
+        return false;
+    }
+    
+    /** Signal to notify once importDone has been set */
+    EventCount *importDoneSignal() {
         assert(firstStage != nullptr);
-        return !firstStage->isDone;
+        return firstStage->ownerSignal;
+    }
+    
+    /** Count a block whose transactions were all queued. Called by the importer */
+    void recordImportedBlock(const blocksci::RawBlock &block) {
+        importedBlocks.fetch_add(1, std::memory_order_relaxed);
+        importedTxes.fetch_add(block.txCount, std::memory_order_relaxed);
+        importedBytes.fetch_add(block.realSize, std::memory_order_relaxed);
+    }
+    
+    /** Add the busy and idle time of every step and the throughput, queue occupancy and stall time of every stage
+     * to metrics. Called by the telemetry thread while the pipeline runs */
+    void sampleTelemetry(std::vector<TelemetryMetric> &metrics) const {
+        auto seconds = [](SteadyClock::rep ticks) {
+            return std::chrono::duration<double>(SteadyClock::duration(ticks)).count();
+        };
+        auto now = SteadyClock::now().time_since_epoch().count();
+        
+        metrics.push_back({"blocksci_parser_imported_blocks_total", "Blocks read and queued by the importer", TelemetryMetric::Kind::Counter, {}, static_cast<double>(importedBlocks.load(std::memory_order_relaxed))});
+        metrics.push_back({"blocksci_parser_imported_txes_total", "Transactions read and queued by the importer", TelemetryMetric::Kind::Counter, {}, static_cast<double>(importedTxes.load(std::memory_order_relaxed))});
+        metrics.push_back({"blocksci_parser_imported_bytes_total", "Serialized size of the blocks read by the importer", TelemetryMetric::Kind::Counter, {}, static_cast<double>(importedBytes.load(std::memory_order_relaxed))});
+        metrics.push_back({"blocksci_parser_importer_blocked_seconds_total", "Time the importer waited for space in the first queue", TelemetryMetric::Kind::Counter, {}, seconds(publishedImporterBlockedTime.load(std::memory_order_relaxed))});
+        
+        for (size_t j = 0; j < steps.size(); j++) {
+            auto &step = steps[j];
+            std::stringstream stepName;
+            stepName << j << " " << step.name;
+            
+            auto start = step.publishedTimes->start.load(std::memory_order_relaxed);
+            auto run = step.publishedTimes->run.load(std::memory_order_relaxed);
+            auto idle = step.publishedTimes->idle.load(std::memory_order_relaxed);
+            auto elapsed = run > 0 ? run : (start > 0 ? now - start : 0);
+            std::vector<std::pair<std::string, std::string>> stepLabels{{"step", stepName.str()}};
+            metrics.push_back({"blocksci_parser_step_busy_seconds_total", "Time the thread of the step spent processing", TelemetryMetric::Kind::Counter, stepLabels, seconds(std::max<SteadyClock::rep>(elapsed - idle, 0))});
+            metrics.push_back({"blocksci_parser_step_idle_seconds_total", "Time the thread of the step waited for input", TelemetryMetric::Kind::Counter, stepLabels, seconds(idle)});
+            
+            for (size_t i = 0; i < step.stages.size(); i++) {
+                auto &stage = *step.stages[i];
+                auto queueDepth = static_cast<double>(stage.publishedQueueDepth.load(std::memory_order_relaxed));
+                auto stageLabels = stepLabels;
+                stageLabels.emplace_back("stage", std::to_string(i));
+                metrics.push_back({"blocksci_parser_stage_processed_txes_total", "Transactions passed on by the stage", TelemetryMetric::Kind::Counter, stageLabels, static_cast<double>(stage.publishedProcessedCount.load(std::memory_order_relaxed))});
+                metrics.push_back({"blocksci_parser_stage_queue_depth", "Transactions waiting in the input queue of the stage", TelemetryMetric::Kind::Gauge, stageLabels, queueDepth});
+                metrics.push_back({"blocksci_parser_stage_queue_occupancy_ratio", "Fill level of the input queue of the stage", TelemetryMetric::Kind::Gauge, stageLabels, queueDepth / txQueueCapacity});
+                metrics.push_back({"blocksci_parser_stage_blocked_seconds_total", "Time the stage waited for space in the next queue", TelemetryMetric::Kind::Counter, stageLabels, seconds(stage.publishedBlockedTime.load(std::memory_order_relaxed))});
+            }
+        }
+    }
+    
+    /** Print queue depth, stall time and throughput of every stage, to find the bottleneck of the pipeline */
+    void printStats(std::ostream &os) const {
+        auto seconds = [](SteadyClock::duration duration) {
+            return std::chrono::duration<double>(duration).count();
+        };
+        os << "Pipeline statistics (importer blocked " << std::fixed << std::setprecision(1) << seconds(importerBlockedTime) << "s)\n";
+        os << std::left << std::setw(28) << "Step" << std::right << std::setw(12) << "Txes" << std::setw(12) << "Tx/s" << std::setw(12) << "Avg queue" << std::setw(12) << "Blocked(s)" << std::setw(10) << "Idle(s)" << "\n";
+        for (auto &step : steps) {
+            auto runSeconds = seconds(step.runTime);
+            for (size_t i = 0; i < step.stages.size(); i++) {
+                auto &stage = *step.stages[i];
+                std::stringstream name;
+                name << step.name;
+                if (step.stages.size() > 1) {
+                    name << " " << i;
+                }
+                auto avgQueue = stage.queueDepthSamples > 0 ? static_cast<double>(stage.queueDepthSum) / static_cast<double>(stage.queueDepthSamples) : 0.0;
+                auto throughput = runSeconds > 0 ? static_cast<double>(stage.processedCount) / runSeconds : 0.0;
+                os << std::left << std::setw(28) << name.str() << std::right << std::setw(12) << stage.processedCount << std::setw(12) << std::setprecision(0) << throughput << std::setw(12) << std::setprecision(1) << avgQueue << std::setw(12) << seconds(stage.blockedTime) << std::setw(10) << seconds(step.idleTime) << "\n";
+            }
+        }
+        os.unsetf(std::ios_base::floatfield);
+        os << std::setprecision(6);
     }
     
     void run() {
@@ -835,10 +1931,50 @@ NewBlocksFiles::NewBlocksFiles(const ParserConfigurationBase &config) :
 template <typename ParseTag>
 std::vector<blocksci::RawBlock> BlockProcessor::addNewBlocks(const ParserConfiguration<ParseTag> &config, std::vector<BlockInfo<ParseTag>> blocks, UTXOState &utxoState, UTXOAddressState &utxoAddressState, AddressState &addressState, UTXOScriptState &utxoScriptState) {
 
+    // Journals the last blocks so that a reorganization can undo them, @see rollbackChain()
+    UndoJournalWriter undoJournal{maxBlockHeight};
     AddressWriter addressWriter{config};
+    addressWriter.setUndoJournal(&undoJournal);
     IndexedFileWriter<1> txFile(blocksci::ChainAccess::txFilePath(config.dataConfig.chainDirectory()));
     FixedSizeFileWriter<OutputLinkData> linkDataFile(config.txUpdatesFilePath());
     FixedSizeFileWriter<blocksci::uint256> txHashFile{blocksci::ChainAccess::txHashesFilePath(config.dataConfig.chainDirectory())};
+    
+    // Once signatures have been extracted the file has to keep covering every new input
+    auto signatureFilePath = blocksci::ChainAccess::inputSignatureFilePath(config.dataConfig.chainDirectory());
+    bool extractSignatures = config.extractSignatures || filesystem::path{signatureFilePath.str() + ".dat"}.exists();
+    std::unique_ptr<FixedSizeFileWriter<blocksci::InputSignature>> signatureFile;
+    if (extractSignatures) {
+        FixedSizeFileWriter<uint64_t> signatureStartFile{blocksci::ChainAccess::inputSignatureStartFilePath(config.dataConfig.chainDirectory())};
+        if (signatureStartFile.size() == 0) {
+            signatureStartFile.write(currentInputNum);
+        }
+        signatureFile = std::make_unique<FixedSizeFileWriter<blocksci::InputSignature>>(signatureFilePath);
+        if (signatureStartFile.read(0) + signatureFile->size() != currentInputNum) {
+            throw std::runtime_error("Input signature file doesn't end at the last parsed input, delete chain/input_signatures*.dat to restart the extraction");
+        }
+    }
+
+    // Witnesses are recorded in the mode of the existing files, which have to keep covering every new transaction
+    auto witnessInfoPath = blocksci::ChainAccess::witnessInfoFilePath(config.dataConfig.chainDirectory());
+    bool recordWitnesses = config.recordWitnesses != ParserConfigurationBase::WitnessRecording::None || filesystem::path{witnessInfoPath.str() + ".dat"}.exists();
+    bool witnessItemData = false;
+    std::unique_ptr<IndexedFileWriter<1>> witnessFile;
+    if (recordWitnesses) {
+        FixedSizeFileWriter<blocksci::WitnessFileInfo> witnessInfoFile{witnessInfoPath};
+        if (witnessInfoFile.size() == 0) {
+            bool full = config.recordWitnesses == ParserConfigurationBase::WitnessRecording::Full;
+            witnessInfoFile.write({currentTxNum, full ? 1u : 0u});
+        }
+        auto info = witnessInfoFile.read(0);
+        witnessItemData = info.hasItemData != 0;
+        if ((config.recordWitnesses == ParserConfigurationBase::WitnessRecording::Full && !witnessItemData) || (config.recordWitnesses == ParserConfigurationBase::WitnessRecording::Sizes && witnessItemData)) {
+            throw std::runtime_error("recordWitnesses doesn't match the mode of the existing witness files, delete chain/witness*.dat to change it");
+        }
+        witnessFile = std::make_unique<IndexedFileWriter<1>>(blocksci::ChainAccess::witnessFilePath(config.dataConfig.chainDirectory()));
+        if (info.firstTxNum + witnessFile->size() != currentTxNum) {
+            throw std::runtime_error("Witness files don't end at the last parsed transaction, delete chain/witness*.dat to restart the recording");
+        }
+    }
 
     auto discardFunc = [](RawTransaction &) { return false; };
     
@@ -854,43 +1990,68 @@ std::vector<blocksci::RawBlock> BlockProcessor::addNewBlocks(const ParserConfigu
         return tx.realSize >= 800;
     };
     
+    // Shared by the order-free substeps, declared before processQueue so that it outlives all stages
+    WorkStealingPool pool{std::max(2u, std::thread::hardware_concurrency() / 2)};
+    
     // Definition of all ProcessStep objects for the processing pipeline
     ProcessStepQueue processQueue;
     
     // 0. Step: Calculate hash of transaction and write it to the hash file (chain/tx_hashes.dat)
-    processQueue.addStep(makeStandardProcessStep(std::make_unique<CalculateTxHashStep>(txHashFile), discardFunc, discardFunc));
+    processQueue.addStep("tx hash", makeStandardProcessStep(std::make_unique<CalculateTxHashStep>(txHashFile), pool, discardFunc, discardFunc));
 
     // 1. Step: Parse the output scripts (into CScriptView) of the transaction in order to identify address types and extract relevant information.
-    processQueue.addStep(makeStandardProcessStep(std::make_unique<GenerateScriptOutputsStep>(), discardFunc, discardFunc));
+    processQueue.addStep("parse outputs", makeStandardProcessStep(std::make_unique<GenerateScriptOutputsStep>(), pool, discardFunc, discardFunc));
 
     // 2. Step: Store information about the spent output with each input of the transaction. Then store information about each output for future lookup.
-    processQueue.addStep(makeStandardProcessStep(std::make_unique<ConnectUTXOsStep>(utxoState), discardFunc, discardFunc));
+    processQueue.addStep("connect utxos", makeStandardProcessStep(std::make_unique<ConnectUTXOsStep>(utxoState), pool, discardFunc, discardFunc));
 
     /* 3. Step: Parse the input script of each input based information about the associated output script.
      *    Then store information about each output address for future lookup. */
-    processQueue.addStep(makeStandardProcessStep(std::make_unique<GenerateScriptInputStep>(utxoAddressState), discardFunc, discardFunc));
+    processQueue.addStep("parse inputs", makeStandardProcessStep(std::make_unique<GenerateScriptInputStep>(utxoAddressState), pool, discardFunc, discardFunc));
 
     /* 4. Step: Attach a scriptNum to each script in the transaction. For address types which are
           deduplicated (Pubkey, ScriptHash, Multisig and their varients) use the previously allocated
           scriptNum if the address was seen before. Increment the scriptNum counter for newly seen addresses. */
-    processQueue.addStep(makeStandardProcessStep(std::make_unique<ProcessAddressesStep>(addressState), discardFunc, discardFunc));
+    processQueue.addStep("process addresses", makeStandardProcessStep(std::make_unique<ProcessAddressesStep>(addressState, pool, &undoJournal, config.partitionedScriptNums), pool, discardFunc, discardFunc));
 
     /* 5. Step: Record the scriptNum for each output for later reference. Assign each spent input with
      the scriptNum of the output its spending */
-    processQueue.addStep(makeStandardProcessStep(std::make_unique<RecordAddressesStep>(utxoScriptState), discardFunc, discardFunc));
+    processQueue.addStep("record addresses", makeStandardProcessStep(std::make_unique<RecordAddressesStep>(utxoScriptState), pool, discardFunc, discardFunc));
 
     // 6. Step: Serialize transaction data, inputs, and outputs and write them to the txFile
-    processQueue.addStep(makeStandardProcessStep(std::make_unique<SerializeTransactionStep>(txFile, linkDataFile), discardFunc, discardFunc));
+    processQueue.addStep("serialize txes", makeStandardProcessStep(std::make_unique<SerializeTransactionStep>(txFile, linkDataFile), pool, discardFunc, discardFunc));
 
     // 7. Step: Save address data into files for the analysis library
-    processQueue.addStep(makeStandardProcessStep(std::make_unique<SerializeAddressesStep>(addressWriter), discardFunc, serializeAddressDiscardFunc, false, true));
+    processQueue.addStep("serialize addresses", makeStandardProcessStep(std::make_unique<SerializeAddressesStep>(addressWriter, pool), pool, discardFunc, serializeAddressDiscardFunc, false, true));
     
     // Two hold stages for ATOR
-    processQueue.addStep(makeHoldTxStep()); // 8
-    processQueue.addStep(makeHoldTxStep()); // 9
+    processQueue.addStep("hold block", makeHoldTxStep()); // 8
+    processQueue.addStep("hold block", makeHoldTxStep()); // 9
+    
+    // 10. Optional step: Record the signature and public key of each input (chain/input_signatures.dat)
+    if (extractSignatures) {
+        processQueue.addStep("extract signatures", makeStandardProcessStep(std::make_unique<ExtractSignaturesStep>(*signatureFile), pool, discardFunc, discardFunc));
+    }
+    
+    // 10. or 11. Optional step: Record the witness of each input (chain/witness_*.dat)
+    size_t witnessStep = extractSignatures ? 11 : 10;
+    if (recordWitnesses) {
+        processQueue.addStep("record witnesses", makeStandardProcessStep(std::make_unique<RecordWitnessesStep>(*witnessFile, witnessItemData), pool, discardFunc, discardFunc));
+    }
     
-    processQueue.setStepOrder({
+    std::vector<StepNum> stepOrder{
         {0, 0}, // calculate tx hash
+        {0, 1}, // write tx hash
+    };
+    if (extractSignatures) {
+        stepOrder.push_back({10, 0}); // parse input signatures
+        stepOrder.push_back({10, 1}); // write input signatures
+    }
+    if (recordWitnesses) {
+        stepOrder.push_back({witnessStep, 0}); // serialize witnesses
+        stepOrder.push_back({witnessStep, 1}); // write witnesses
+    }
+    stepOrder.insert(stepOrder.end(), {
         {1, 0}, // parse outputs into CScriptView
         {2, 0}, // store UTXOs
         {3, 0}, // store scripts
@@ -905,31 +2066,21 @@ std::vector<blocksci::RawBlock> BlockProcessor::addNewBlocks(const ParserConfigu
         {6, 0}, // serialize transaction data
         {7, 1}  // update scripts
     });
-    
-    int64_t nextWaitCount = 0;
+    processQueue.setStepOrder(stepOrder);
     
     std::vector<blocksci::RawBlock> blocksAdded;
     BlockFileReader<ParseTag> fileReader(config, blocks, currentTxNum);
 
     // Launch the importer in its own thread
     auto importer = std::async(std::launch::async, [&] {
-        CompletionGuard guard(processQueue.importDone);
+        CompletionGuard guard(processQueue.importDone, processQueue.importDoneSignal());
         auto loadFinishedTx = [&](RawTransaction *&tx) {
-            return processQueue.finishedQueue.pop(tx);
+            return processQueue.popFinished(tx);
         };
         
-        // Function that adds transaction to the first queue of the processing pipeline
+        // Function that adds transaction to the first queue of the processing pipeline, waits if the queue is full
         auto outFunc = [&](RawTransaction *tx) {
-            using namespace std::chrono_literals;
-            // Add tx to the inputQueue of the first processing step, if it fails (queue is full), wait 5ms and try again
-            while (!processQueue.inputQueue().push(tx)) {
-                if (!processQueue.isRunning()) {
-                    // Error: calculateHashesStep() finished before all items were queued
-                    throw NextQueueFinishedEarlyException();
-                }
-                nextWaitCount++;
-                std::this_thread::sleep_for(5ms);
-            }
+            processQueue.pushInput(tx);
         };
         
         NewBlocksFiles files(config);
@@ -941,6 +2092,7 @@ std::vector<blocksci::RawBlock> BlockProcessor::addNewBlocks(const ParserConfigu
 
             auto newBlock = readNewBlock(currentTxNum, currentInputNum, currentOutputNum, block, fileReader, files, loadFinishedTx, outFunc, block.height >= config.dataConfig.chainConfig.segwitActivationHeight);
             blocksAdded.push_back(newBlock);
+            processQueue.recordImportedBlock(newBlock);
             currentTxNum += newBlock.txCount;
             currentInputNum += newBlock.inputCount;
             currentOutputNum += newBlock.outputCount;
@@ -950,9 +2102,23 @@ std::vector<blocksci::RawBlock> BlockProcessor::addNewBlocks(const ParserConfigu
     // Launch all processing steps as concurrent threads
     processQueue.run();
 
-    // Wait for all processing step threads to complete
-    importer.get();
-    processQueue.waitForComplete();
+    {
+        // Writes the metrics of the pipeline until it finished, and a last sample afterwards
+        ParserTelemetry telemetry{config, {
+            [&](std::vector<TelemetryMetric> &metrics) { processQueue.sampleTelemetry(metrics); },
+            [&](std::vector<TelemetryMetric> &metrics) { addressState.sampleTelemetry(metrics); },
+            [&](std::vector<TelemetryMetric> &metrics) {
+                metrics.push_back({"blocksci_parser_utxos", "Unspent outputs held by the parser", TelemetryMetric::Kind::Gauge, {}, static_cast<double>(utxoState.size())});
+            }
+        }};
+
+        // Wait for all processing step threads to complete
+        importer.get();
+        processQueue.waitForComplete();
+    }
+    processQueue.printStats(std::cout);
+    
+    undoJournal.write(config, blocksAdded);
 
     return blocksAdded;
 }
@@ -13,9 +13,12 @@
 #include "parser_fwd.hpp"
 #include "parser_configuration.hpp"
 #include "file_writer.hpp"
+#include "undo_journal.hpp"
 
 #include <blocksci/core/inout_pointer.hpp>
 #include <blocksci/core/core_fwd.hpp>
+#include <blocksci/core/input_signature.hpp>
+#include <blocksci/core/raw_witness.hpp>
 
 class BlockFileReaderBase {
 public:
@@ -23,8 +26,9 @@ public:
     BlockFileReaderBase(const BlockFileReaderBase &) = default;
     virtual ~BlockFileReaderBase();
 
-    virtual void nextTx(RawTransaction *tx, bool isSegwit) = 0;
-    virtual void nextTxNoAdvance(RawTransaction *tx, bool isSegwit) = 0;
+    /** Load the next transaction into tx. tx is either memory recycled from the end of the pipeline or nullptr, and
+     * readers may replace it with a different (already decoded) transaction */
+    virtual void nextTx(RawTransaction *&tx, bool isSegwit) = 0;
     virtual void receivedFinishedTx(RawTransaction *) = 0;
 };
 
@@ -48,6 +52,16 @@ blocksci::RawBlock readNewBlock(uint32_t firstTxNum, uint64_t firstInputNum, uin
 
 struct ProcessorStep {
     virtual std::vector<std::function<void(RawTransaction &tx)>> steps() = 0;
+    
+    /** Whether the given substep only touches the transaction it is called with and doesn't depend on the order
+     * of transactions. Order-free substeps run on the shared WorkStealingPool instead of a dedicated thread */
+    virtual bool isOrderFree(size_t subStepNum) const;
+    
+    /** Optional version of a substep that processes a whole batch of transactions at once. If it returns a function,
+     * it is called instead of calling the substep for every transaction, on the pool for order-free substeps and
+     * with consecutive transactions in order for the others */
+    virtual std::function<void(RawTransaction * const *txes, size_t count)> batchStep(size_t subStepNum);
+    
     virtual ~ProcessorStep();
 };
 
@@ -57,10 +71,34 @@ struct CalculateTxHashStep : public ProcessorStep {
     CalculateTxHashStep(FixedSizeFileWriter<blocksci::uint256> &hashFile_) : hashFile(hashFile_) {}
     
     std::vector<std::function<void(RawTransaction &tx)>> steps() override;
+    bool isOrderFree(size_t subStepNum) const override;
+    std::function<void(RawTransaction * const *txes, size_t count)> batchStep(size_t subStepNum) override;
+};
+
+/** Optional step recording the signature and public key of every input in chain/input_signatures.dat */
+struct ExtractSignaturesStep : public ProcessorStep {
+    FixedSizeFileWriter<blocksci::InputSignature> &signatureFile;
+    
+    ExtractSignaturesStep(FixedSizeFileWriter<blocksci::InputSignature> &signatureFile_) : signatureFile(signatureFile_) {}
+    
+    std::vector<std::function<void(RawTransaction &tx)>> steps() override;
+    bool isOrderFree(size_t subStepNum) const override;
+};
+
+/** Optional step recording the witness of every input in the chain/witness files, @see blocksci::RawWitness */
+struct RecordWitnessesStep : public ProcessorStep {
+    IndexedFileWriter<1> &witnessFile;
+    bool hasItemData;
+    
+    RecordWitnessesStep(IndexedFileWriter<1> &witnessFile_, bool hasItemData_) : witnessFile(witnessFile_), hasItemData(hasItemData_) {}
+    
+    std::vector<std::function<void(RawTransaction &tx)>> steps() override;
+    bool isOrderFree(size_t subStepNum) const override;
 };
 
 struct GenerateScriptOutputsStep : public ProcessorStep {
     std::vector<std::function<void(RawTransaction &tx)>> steps() override;
+    bool isOrderFree(size_t subStepNum) const override;
 };
 
 struct ConnectUTXOsStep : public ProcessorStep {
@@ -69,6 +107,8 @@ struct ConnectUTXOsStep : public ProcessorStep {
     ConnectUTXOsStep(UTXOState &utxoState_) : utxoState(utxoState_) {}
     
     std::vector<std::function<void(RawTransaction &tx)>> steps() override;
+    bool isOrderFree(size_t subStepNum) const override;
+    std::function<void(RawTransaction * const *txes, size_t count)> batchStep(size_t subStepNum) override;
 };
 
 struct GenerateScriptInputStep : public ProcessorStep {
@@ -81,10 +121,30 @@ struct GenerateScriptInputStep : public ProcessorStep {
 
 struct ProcessAddressesStep : public ProcessorStep {
     AddressState &addressState;
+    WorkStealingPool &pool;
+    UndoJournalWriter *undoJournal;
+    
+    /** Height of the block the previous transaction belonged to */
+    blocksci::BlockHeight currentHeight = -1;
+    std::vector<UndoAddressKey> newAddresses;
+    
+    /** Outputs of the current batch, @see batchStep() */
+    std::vector<AnyScriptOutput *> batchOutputs;
     
-    ProcessAddressesStep(AddressState &addressState_) : addressState(addressState_) {}
+    /** Resolves the batches which aren't journaled if partitionedScriptNums is enabled */
+    std::unique_ptr<PartitionedAddressResolver> partitionedResolver;
+    
+    ProcessAddressesStep(AddressState &addressState_, WorkStealingPool &pool_, UndoJournalWriter *undoJournal_ = nullptr, bool partitionedScriptNums = false);
+    ~ProcessAddressesStep() override;
     
     std::vector<std::function<void(RawTransaction &tx)>> steps() override;
+    
+    /** Probes the addresses of all outputs of the batch on the pool before resolving them in order */
+    std::function<void(RawTransaction * const *txes, size_t count)> batchStep(size_t subStepNum) override;
+    
+private:
+    bool isJournaled(RawTransaction * const *txes, size_t count) const;
+    void processTx(RawTransaction &tx);
 };
 
 struct RecordAddressesStep : public ProcessorStep {
@@ -106,10 +166,18 @@ struct SerializeTransactionStep : public ProcessorStep {
 
 struct SerializeAddressesStep : public ProcessorStep {
     AddressWriter &addressWriter;
+    WorkStealingPool &pool;
     
-    SerializeAddressesStep(AddressWriter &addressWriter_) : addressWriter(addressWriter_) {}
+    SerializeAddressesStep(AddressWriter &addressWriter_, WorkStealingPool &pool_) : addressWriter(addressWriter_), pool(pool_) {}
     
     std::vector<std::function<void(RawTransaction &tx)>> steps() override;
+    
+    /** Queues the writes of a batch of transactions and writes the script files of the dedup types in parallel */
+    std::function<void(RawTransaction * const *txes, size_t count)> batchStep(size_t subStepNum) override;
+    
+private:
+    void queueNewScripts(const RawTransaction &tx);
+    void queueSeenScripts(const RawTransaction &tx);
 };
 
 void backUpdateTxes(const ParserConfigurationBase &config);
@@ -0,0 +1,92 @@
+//
+//  block_stats_writer.cpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "block_stats_writer.hpp"
+#include "parser_configuration.hpp"
+
+#include <blocksci/chain/block_stats.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/file_mapper.hpp>
+#include <internal/progress_bar.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    blocksci::BlockStats computeBlockStats(const blocksci::ChainAccess &chain, const blocksci::RawBlock &block) {
+        blocksci::BlockStats stats{};
+        stats.timestamp = block.timestamp;
+        stats.txCount = block.txCount;
+        stats.inputCount = block.inputCount;
+        stats.outputCount = block.outputCount;
+        stats.size = block.realSize;
+        stats.weight = 3 * block.baseSize + block.realSize;
+        for (uint32_t txNum = block.firstTxIndex; txNum < block.firstTxIndex + block.txCount; txNum++) {
+            auto tx = chain.getTx(txNum);
+            int64_t outputValue = 0;
+            for (auto output = tx->beginOutputs(); output != tx->endOutputs(); ++output) {
+                outputValue += output->getValue();
+                stats.outputTypeCounts[static_cast<size_t>(output->getType())]++;
+            }
+            stats.totalOutputValue += outputValue;
+            if (tx->inputCount > 0) {
+                int64_t inputValue = 0;
+                for (auto input = tx->beginInputs(); input != tx->endInputs(); ++input) {
+                    inputValue += input->getValue();
+                }
+                stats.totalInputValue += inputValue;
+                stats.totalFee += inputValue - outputValue;
+                stats.feeVirtualSize += (tx->realSize + 3 * tx->baseSize + 3) / 4;
+            }
+            if (tx->realSize != tx->baseSize) {
+                stats.segwitTxCount++;
+            }
+        }
+        return stats;
+    }
+}
+
+void updateBlockStats(const ParserConfigurationBase &config) {
+    auto chainDirectory = config.dataConfig.chainDirectory();
+    blocksci::ChainAccess chain{chainDirectory, 0, false};
+    blocksci::FixedSizeFileMapper<blocksci::BlockStats, mio::access_mode::write> statsFile{blocksci::ChainAccess::blockStatsFilePath(chainDirectory)};
+
+    auto blockCount = chain.blockCount();
+    auto firstBlock = std::min(static_cast<blocksci::BlockHeight>(statsFile.size()), blockCount);
+    statsFile.truncate(static_cast<blocksci::OffsetType>(firstBlock));
+    statsFile.seekEnd();
+
+    if (firstBlock == blockCount) {
+        return;
+    }
+
+    // Only shown when an older data directory is filled in, regular updates add a handful of blocks
+    bool showProgress = blockCount - firstBlock > 1000;
+    if (showProgress) {
+        std::cout << "Updating block statistics\n";
+    }
+    auto progressBar = blocksci::makeProgressBar(blockCount - firstBlock, [=]() {});
+    if (!showProgress) {
+        progressBar.setSilent();
+    }
+    for (auto height = firstBlock; height < blockCount; height++) {
+        statsFile.write(computeBlockStats(chain, *chain.getBlock(height)));
+        progressBar.update(static_cast<uint32_t>(height - firstBlock));
+    }
+}
+
+void truncateBlockStats(const ParserConfigurationBase &config, blocksci::BlockHeight splitPoint) {
+    auto path = blocksci::ChainAccess::blockStatsFilePath(config.dataConfig.chainDirectory());
+    if (!filesystem::path{path.str() + ".dat"}.exists()) {
+        return;
+    }
+    blocksci::FixedSizeFileMapper<blocksci::BlockStats, mio::access_mode::write> statsFile{path};
+    if (static_cast<blocksci::BlockHeight>(statsFile.size()) > splitPoint) {
+        statsFile.truncate(static_cast<blocksci::OffsetType>(splitPoint));
+    }
+}
@@ -0,0 +1,24 @@
+//
+//  block_stats_writer.hpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef block_stats_writer_hpp
+#define block_stats_writer_hpp
+
+#include "parser_fwd.hpp"
+
+#include <blocksci/core/typedefs.hpp>
+
+/** Extend chain/block_stats.dat to cover all blocks in the chain
+ *
+ * The statistics of a block only depend on its transactions, so existing records are kept and the file of a data
+ * directory created by an older parser is filled in by its next update. */
+void updateBlockStats(const ParserConfigurationBase &config);
+
+/** Drop the statistics of the blocks from splitPoint on, used when these blocks are undone */
+void truncateBlockStats(const ParserConfigurationBase &config, blocksci::BlockHeight splitPoint);
+
+#endif /* block_stats_writer_hpp */
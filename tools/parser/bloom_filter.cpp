@@ -9,118 +9,237 @@
 #include "bloom_filter.hpp"
 
 #include <cereal/archives/binary.hpp>
+#include <cereal/types/vector.hpp>
 
 #include <fstream>
 #include <array>
 #include <cmath>
+#include <cstring>
 
 
 constexpr double Log2 = 0.69314718056;
 constexpr double Log2Squared = Log2 * Log2;
 
-BloomStore::BloomStore(const std::string &path_, int64_t length_) : bitMasks{}, backingFile(path_), length(length_) {
-    
-    for (size_t i = 0; i < BloomStore::BlockSize; ++i) {
-        bitMasks.at(i) = BloomStore::BlockType{1} << i;
+namespace {
+    // Every new stage holds twice the items of the previous one at half the false positive rate, so the rates of
+    // all stages sum up to at most the rate of the whole filter
+    constexpr int64_t stageGrowthFactor = 2;
+    constexpr double stageTighteningRatio = 0.5;
+
+    // Probes that fit into one 64 bit hash with 9 bits per bit position inside of a bucket
+    constexpr uint8_t probesPerHash = 7;
+}
+
+int64_t calculateLength(int64_t maxItems, double fpRate) {
+    return static_cast<int64_t>(std::ceil(-(std::log(fpRate) * maxItems) / Log2Squared));
+}
+
+uint8_t calculateHashes(double fpRate) {
+    return static_cast<uint8_t>(std::max(1.0, std::round(-std::log(fpRate) / Log2)));
+}
+
+/** False positive rate of a blocked bloom filter
+ *
+ * The number of items per bucket is Poisson distributed, which makes a blocked filter slightly less accurate than a
+ * classic one of the same size.
+ */
+double blockedFPRate(int64_t itemCount, int64_t bucketCount, uint8_t numHashes) {
+    if (itemCount == 0 || bucketCount == 0) {
+        return 0;
     }
-    
-    if (backingFile.size() == 0) {
-        backingFile.truncate(blockCount());
+    double load = static_cast<double>(itemCount) / static_cast<double>(bucketCount);
+    auto maxLoad = static_cast<int64_t>(load + 10 * std::sqrt(load) + 20);
+    double bitMissRate = 1.0 - 1.0 / BloomStage::Bucket::BitCount;
+    double rate = 0;
+    for (int64_t j = 0; j <= maxLoad; j++) {
+        double bucketProbability = std::exp(-load + static_cast<double>(j) * std::log(load) - std::lgamma(static_cast<double>(j) + 1));
+        double setFraction = 1.0 - std::pow(bitMissRate, static_cast<double>(numHashes) * static_cast<double>(j));
+        rate += bucketProbability * std::pow(setFraction, numHashes);
     }
-    
-    if (backingFile.size() != blockCount()) {
-        throw std::runtime_error("Trying to open bloom filter of wrong size");
+    return rate;
+}
+
+BloomStageData::BloomStageData() : maxItems(0), fpRate(1), m_numHashes(0), bucketCount(0), addedCount(0) {}
+BloomStageData::BloomStageData(int64_t maxItems_, double fpRate_) : maxItems(std::max(maxItems_, int64_t{1})), fpRate(fpRate_), m_numHashes(calculateHashes(fpRate_)), bucketCount(0), addedCount(0) {
+    constexpr int64_t bucketBits = BloomStage::Bucket::BitCount;
+    bucketCount = (calculateLength(maxItems, fpRate) + bucketBits - 1) / bucketBits;
+    // Make up for the accuracy lost to blocking
+    while (blockedFPRate(maxItems, bucketCount, m_numHashes) > fpRate) {
+        bucketCount += bucketCount / 32 + 1;
     }
 }
 
-int64_t BloomStore::blockCount() const {
-    return (length + BlockSize - 1) / BlockSize;
+inline std::array<uint64_t, 2> hash(const uint8_t *data, int len) {
+    uint64_t hashA, hashB;
+    memcpy(&hashA, data + len - sizeof(uint64_t), sizeof(uint64_t));
+    memcpy(&hashB, data + len - 2*sizeof(uint64_t), sizeof(uint64_t));
+    return {{hashA, hashB}};
 }
 
-void BloomStore::setBit(int64_t bitPos) {
-    assert(bitPos < length);
-    BlockType mask = bitMasks[bitPos % BlockSize];
-    int64_t filePos = bitPos / BlockSize;
-    BlockType *fileEntry = backingFile[filePos];
-    *fileEntry |= mask;
+inline int64_t bucketIndex(uint64_t hashA, int64_t bucketCount) {
+    // Multiply-shift maps the hash onto [0, bucketCount) without a division
+    return static_cast<int64_t>((static_cast<unsigned __int128>(hashA) * static_cast<uint64_t>(bucketCount)) >> 64);
 }
 
-bool BloomStore::isSet(int64_t bitPos) const {
-    return !(((*backingFile[bitPos / BlockSize]) & bitMasks[bitPos % BlockSize]) == 0);
+inline void bucketMask(uint64_t hashB, uint8_t numHashes, BloomStage::Bucket &mask) {
+    for (auto &word : mask.words) {
+        word = 0;
+    }
+    uint64_t bits = hashB;
+    for (uint8_t n = 0; n < numHashes; n++) {
+        if (n > 0 && n % probesPerHash == 0) {
+            // Derive further bit positions for very low false positive rates
+            bits = (hashB ^ n) * 0x9E3779B97F4A7C15ULL;
+            bits ^= bits >> 29;
+        }
+        auto bit = bits % BloomStage::Bucket::BitCount;
+        bits /= BloomStage::Bucket::BitCount;
+        mask.words[bit / 64] |= uint64_t{1} << (bit % 64);
+    }
 }
 
-void BloomStore::reset(int64_t newLength) {
-    backingFile.truncate(0);
-    backingFile.truncate((newLength + BlockSize - 1) / BlockSize);
-    length = newLength;
+BloomStage::BloomStage(const std::string &path, const BloomStageData &data_) : data(data_), backingFile(path) {
+    if (backingFile.size() == 0) {
+        backingFile.truncate(data.bucketCount);
+    }
+
+    if (backingFile.size() != data.bucketCount) {
+        throw std::runtime_error("Trying to open bloom filter of wrong size");
+    }
+    backingFile.advise(blocksci::AccessHint::Random);
 }
 
-int64_t calculateLength(int64_t maxItems, double fpRate) {
-    return static_cast<int64_t>(std::ceil(-(std::log(fpRate) * maxItems) / Log2Squared));
+void BloomStage::add(uint64_t hashA, uint64_t hashB) {
+    Bucket mask;
+    bucketMask(hashB, data.m_numHashes, mask);
+    Bucket &bucket = *backingFile[bucketIndex(hashA, data.bucketCount)];
+    for (int i = 0; i < Bucket::WordCount; i++) {
+        bucket.words[i] |= mask.words[i];
+    }
+    data.addedCount++;
 }
 
-uint8_t calculateHashes(double fpRate) {
-    return static_cast<uint8_t>(std::round(-std::log(fpRate) / Log2));
+bool BloomStage::possiblyContains(uint64_t hashA, uint64_t hashB) const {
+    Bucket mask;
+    bucketMask(hashB, data.m_numHashes, mask);
+    const Bucket &bucket = *backingFile[bucketIndex(hashA, data.bucketCount)];
+    uint64_t missing = 0;
+    for (int i = 0; i < Bucket::WordCount; i++) {
+        missing |= mask.words[i] & ~bucket.words[i];
+    }
+    return missing == 0;
 }
 
-BloomFilterData::BloomFilterData() : maxItems(0), fpRate(1), m_numHashes(0), length(0), addedCount(0) {}
-BloomFilterData::BloomFilterData(int64_t maxItems_, double fpRate_) : maxItems(maxItems_), fpRate(fpRate_), m_numHashes(calculateHashes(fpRate_)), length(calculateLength(maxItems_, fpRate_)), addedCount(0) {}
+void BloomStage::clear() {
+    backingFile.truncate(0);
+    backingFile.truncate(data.bucketCount);
+    data.addedCount = 0;
+}
 
+double BloomStage::estimatedFPRate() const {
+    return blockedFPRate(data.addedCount, data.bucketCount, data.m_numHashes);
+}
 
-BloomFilterData loadData(const filesystem::path &path, int64_t maxItems, double fpRate) {
-    BloomFilterData data{maxItems, fpRate};
-    std::ifstream file(path.str(), std::ios::binary);
+BloomFilter::BloomFilter(const std::string &path_, int64_t initialItems_, double fpRate_) : path(path_), initialItems(initialItems_), fpRate(fpRate_) {
+    std::vector<BloomStageData> stageData;
+    std::ifstream file(metaPath().str(), std::ios::binary);
     if (file.good()) {
         cereal::BinaryInputArchive ia(file);
-        ia(data);
+        ia(initialItems, fpRate, stageData);
+    } else {
+        // Filters written before the filter could grow used a single store that can't be converted
+        filesystem::path legacyMetaPath{path + "Meta.dat"};
+        filesystem::path legacyStorePath{path + "Store"};
+        if (legacyMetaPath.exists()) {
+            legacyMetaPath.remove_file();
+            if (legacyStorePath.exists()) {
+                legacyStorePath.remove_file();
+            }
+            rebuildNeeded = true;
+        }
     }
-    return data;
-}
 
-BloomFilter::BloomFilter(const std::string &path_, int64_t maxItems, double fpRate) : path(path_), impData(loadData(metaPath(), maxItems, fpRate)), store(storePath().str(), impData.length) {}
+    for (auto &data : stageData) {
+        stages.push_back(std::make_unique<BloomStage>(stagePath(stages.size()).str(), data));
+    }
+    if (stages.empty()) {
+        reset(initialItems);
+    }
+}
 
 BloomFilter::~BloomFilter() {
+    std::vector<BloomStageData> stageData;
+    for (auto &stage : stages) {
+        stageData.push_back(stage->getData());
+    }
     std::ofstream file(metaPath().str(), std::ios::binary);
     cereal::BinaryOutputArchive oa(file);
-    oa(impData);
-}
-
-void BloomFilter::reset(int64_t maxItems, double fpRate) {
-    impData = BloomFilterData(maxItems, fpRate);
-    store.reset(impData.length);
+    oa(initialItems, fpRate, stageData);
 }
 
-inline std::array<uint64_t, 2> hash(const uint8_t *data, int len) {
-    uint64_t hashA, hashB;
-    memcpy(&hashA, data + len - sizeof(uint64_t), sizeof(uint64_t));
-    memcpy(&hashB, data + len - 2*sizeof(uint64_t), sizeof(uint64_t));
-    return {{hashA, hashB}};
+void BloomFilter::reset(int64_t maxItems) {
+    for (size_t i = 0; i < stages.size(); i++) {
+        stages[i].reset();
+        stagePath(i).remove_file();
+    }
+    stages.clear();
+    auto path0 = stagePath(0);
+    if (path0.exists()) {
+        path0.remove_file();
+    }
+    BloomStageData data{maxItems, fpRate * (1 - stageTighteningRatio)};
+    stages.push_back(std::make_unique<BloomStage>(path0.str(), data));
 }
 
-inline int64_t nthHash(uint8_t n, uint64_t hashA, uint64_t hashB, int64_t filterSize) {
-    return static_cast<int64_t>((hashA + n * hashB) % static_cast<uint64_t>(filterSize));
+void BloomFilter::addStage() {
+    auto &last = stages.back()->getData();
+    BloomStageData data{last.maxItems * stageGrowthFactor, last.fpRate * stageTighteningRatio};
+    auto newPath = stagePath(stages.size());
+    if (newPath.exists()) {
+        newPath.remove_file();
+    }
+    stages.push_back(std::make_unique<BloomStage>(newPath.str(), data));
 }
 
 void BloomFilter::add(const uint8_t *item, int length) {
-    auto hashValues = hash(item, length);
-    
-    for (uint8_t n = 0; n < impData.m_numHashes; n++) {
-        auto bitPos = nthHash(n, hashValues[0], hashValues[1], impData.length);
-        store.setBit(bitPos);
+    if (stages.back()->isFull()) {
+        addStage();
     }
-    
-    impData.addedCount++;
+    auto hashValues = hash(item, length);
+    stages.back()->add(hashValues[0], hashValues[1]);
 }
 
 bool BloomFilter::possiblyContains(const uint8_t *item, int length) const {
     auto hashValues = hash(item, length);
-    
-    for (uint8_t n = 0; n < impData.m_numHashes; n++) {
-        auto bitPos = nthHash(n, hashValues[0], hashValues[1], impData.length);
-        if (!store.isSet(bitPos)) {
-            return false;
+    // Later stages are larger and therefore hold most of the items
+    for (auto it = stages.rbegin(); it != stages.rend(); ++it) {
+        if ((*it)->possiblyContains(hashValues[0], hashValues[1])) {
+            return true;
         }
     }
-    
-    return true;
+    return false;
+}
+
+int64_t BloomFilter::size() const {
+    int64_t count = 0;
+    for (auto &stage : stages) {
+        count += stage->getData().addedCount;
+    }
+    return count;
+}
+
+double BloomFilter::estimatedFPRate() const {
+    double trueNegativeRate = 1;
+    for (auto &stage : stages) {
+        trueNegativeRate *= 1 - stage->estimatedFPRate();
+    }
+    return 1 - trueNegativeRate;
+}
+
+int64_t BloomFilter::memoryUsage() const {
+    int64_t bytes = 0;
+    for (auto &stage : stages) {
+        bytes += stage->memoryUsage();
+    }
+    return bytes;
 }
@@ -13,40 +13,21 @@
 
 #include <wjfilesystem/path.h>
 
+#include <array>
 #include <fstream>
+#include <memory>
 #include <vector>
 
-struct BloomStore {
-    using BlockType = size_t;
-    static constexpr int64_t BlockSize = static_cast<int64_t>(sizeof(BlockType) * 8);
-
-    BloomStore(const std::string &path, int64_t length);
-    
-    void setBit(int64_t bitPos);
-    bool isSet(int64_t bitPos) const;
-    
-    void reset(int64_t length);
-    
-private:
-    std::array<BloomStore::BlockType, BloomStore::BlockSize> bitMasks;
-    
-private:
-    blocksci::FixedSizeFileMapper<BlockType, mio::access_mode::write> backingFile;
-    int64_t length;
-    
-    int64_t blockCount() const;
-};
-
-struct BloomFilterData {
+struct BloomStageData {
     int64_t maxItems;
     double fpRate;
     uint8_t m_numHashes;
-    int64_t length;
+    int64_t bucketCount;
     int64_t addedCount;
-    
-    BloomFilterData();
-    BloomFilterData(int64_t maxItems_, double fpRate_);
-    
+
+    BloomStageData();
+    BloomStageData(int64_t maxItems_, double fpRate_);
+
     template<class Archive>
     void serialize(Archive & archive)
     {
@@ -54,63 +35,124 @@ struct BloomFilterData {
                 maxItems,
                 fpRate,
                 m_numHashes,
-                length,
+                bucketCount,
                 addedCount
         );
     }
 };
 
+/** Blocked bloom filter that is one link of the chain of a BloomFilter
+ *
+ * All bits of an item lie in the same cache line sized bucket, so a probe touches a single cache line no matter how
+ * many hashes are used. The bucket mask of an item is compared against the bucket word by word without branches,
+ * which the compiler turns into a couple of vector instructions.
+ */
+class BloomStage {
+public:
+    struct alignas(64) Bucket {
+        static constexpr int WordCount = 8;
+        static constexpr int BitCount = WordCount * 64;
+        uint64_t words[WordCount];
+    };
+
+    BloomStage(const std::string &path, const BloomStageData &data);
+
+    void add(uint64_t hashA, uint64_t hashB);
+    bool possiblyContains(uint64_t hashA, uint64_t hashB) const;
+
+    /** Empty the stage, keeping its size */
+    void clear();
+
+    bool isFull() const {
+        return data.addedCount >= data.maxItems;
+    }
+
+    const BloomStageData &getData() const {
+        return data;
+    }
+
+    /** False positive rate of the stage at its current fill level */
+    double estimatedFPRate() const;
+
+    int64_t memoryUsage() const {
+        return data.bucketCount * static_cast<int64_t>(sizeof(Bucket));
+    }
+
+private:
+    BloomStageData data;
+    blocksci::FixedSizeFileMapper<Bucket, mio::access_mode::write> backingFile;
+};
+
+/** Scalable bloom filter (Almeida et al.) made up of a chain of BloomStages
+ *
+ * Once the newest stage holds as many items as it was sized for, a new stage with twice the capacity and half the
+ * false positive rate is appended, so the filter grows without ever rehashing the items it already contains and the
+ * false positive rate of the whole chain stays below the rate it was created with. Every stage is a separate memory
+ * mapped file next to a metadata file describing the chain.
+ */
 class BloomFilter {
 public:
     // Load or create
-    BloomFilter(const std::string &path, int64_t maxItems, double fpRate);
+    BloomFilter(const std::string &path, int64_t initialItems, double fpRate);
     BloomFilter(const BloomFilter &) = delete;
     BloomFilter &operator=(const BloomFilter &) = delete;
     ~BloomFilter();
-    
-    void reset(int64_t maxItems, double fpRate);
-    
+
+    /** Empty the filter and size its first stage for maxItems */
+    void reset(int64_t maxItems);
+
     template<class Key>
     void add(const Key &key) {
         int len = static_cast<int>(sizeof(Key));
         auto item = reinterpret_cast<const uint8_t *>(&key);
         add(item, len);
     }
-    
+
     template<class Key>
     bool possiblyContains(const Key &key) const {
         auto len = static_cast<int>(sizeof(Key));
         auto item = reinterpret_cast<const uint8_t *>(&key);
         return possiblyContains(item, len);
     }
-    
-    bool isFull() const {
-        return impData.addedCount >= impData.maxItems;
-    }
-    
-    int64_t size() { return impData.addedCount; }
-    
-    int64_t getMaxItems() const {
-        return impData.maxItems;
+
+    int64_t size() const;
+
+    size_t stageCount() const {
+        return stages.size();
     }
-    
+
     double getFPRate() const {
-        return impData.fpRate;
+        return fpRate;
     }
-    
+
+    /** Probability that an item that was never added is reported as present, given the current fill level */
+    double estimatedFPRate() const;
+
+    /** Bytes of all stages */
+    int64_t memoryUsage() const;
+
+    /** True if the filter was created while a filter in the old single file format existed, whose items must be
+     * added again */
+    bool needsRebuild() const {
+        return rebuildNeeded;
+    }
+
     filesystem::path metaPath() const {
-        return filesystem::path(path + "Meta.dat");
+        return filesystem::path(path + "Stages.dat");
     }
-    
-    filesystem::path storePath() const {
-        return filesystem::path(path + "Store");
+
+    filesystem::path stagePath(size_t stageNum) const {
+        return filesystem::path(path + "Stage" + std::to_string(stageNum));
     }
-    
+
 private:
     std::string path;
-    BloomFilterData impData;
-    BloomStore store;
-    
+    int64_t initialItems;
+    double fpRate;
+    bool rebuildNeeded = false;
+    std::vector<std::unique_ptr<BloomStage>> stages;
+
+    void addStage();
     void add(const uint8_t *item, int length);
     bool possiblyContains(const uint8_t *item, int length) const;
 };
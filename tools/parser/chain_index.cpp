@@ -19,9 +19,19 @@
 
 #include <cereal/archives/binary.hpp>
 
+#include <rocksdb/db.h>
+
+#include <algorithm>
+#include <atomic>
 #include <cmath>
-#include <future>
+#include <cstring>
+#include <exception>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
 
 #ifdef BLOCKSCI_FILE_PARSER
 
@@ -100,91 +110,357 @@ std::vector<BlockInfo<FileTag>> readBlocksInfo(int fileNum, const ParserConfigur
     return readBlocksImpl(reader, fileNum, config.diskConfig);
 }
 
-template <>
+namespace {
+    uint32_t indexThreadCount(const ParserConfiguration<FileTag> &config, size_t taskCount) {
+        auto threadCount = config.diskConfig.indexThreads;
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        return static_cast<uint32_t>(std::max<size_t>(1, std::min<size_t>(threadCount, taskCount)));
+    }
+
+    /** Run func(i) for every i in [0, taskCount) on indexThreads threads and rethrow the first exception afterwards */
+    template <typename Func>
+    void runIndexTasks(const ParserConfiguration<FileTag> &config, size_t taskCount, Func func) {
+        std::atomic<size_t> nextTask{0};
+        std::mutex errorMutex;
+        std::exception_ptr error;
+        std::vector<std::thread> workers;
+        auto threadCount = indexThreadCount(config, taskCount);
+        for (uint32_t i = 0; i < threadCount; i++) {
+            workers.emplace_back([&]() {
+                for (auto task = nextTask++; task < taskCount; task = nextTask++) {
+                    try {
+                        func(task);
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(errorMutex);
+                        if (!error) {
+                            error = std::current_exception();
+                        }
+                        nextTask = taskCount;
+                    }
+                }
+            });
+        }
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    /** Scan the block files from (firstFile, filePos) on, one file per task. Returns the blocks in file order. */
+    std::vector<BlockInfo<FileTag>> scanBlockFiles(const ParserConfiguration<FileTag> &config, int firstFile, unsigned int filePos) {
+        auto maxFileNum = maxBlockFileNum(firstFile, config);
+        auto fileCount = static_cast<size_t>(std::max(0, maxFileNum - firstFile + 1));
+        std::vector<std::vector<BlockInfo<FileTag>>> fileBlocks(fileCount);
+        
+        std::mutex progressMutex;
+        size_t filesDone = 0;
+        std::cout.setf(std::ios::fixed,std::ios::floatfield);
+        std::cout.precision(1);
+        runIndexTasks(config, fileCount, [&](size_t i) {
+            auto fileNum = firstFile + static_cast<int>(i);
+            SafeMemReader reader{config.pathForBlockFile(fileNum).str()};
+            // Logic for resume from last processed block, note blockStartOffset and length below
+            if (fileNum == firstFile) {
+                reader.reset(filePos);
+            }
+            fileBlocks[i] = readBlocksImpl(reader, fileNum, config.diskConfig);
+            
+            std::lock_guard<std::mutex> lock(progressMutex);
+            filesDone++;
+            std::cout << "\r" << (static_cast<double>(filesDone) / static_cast<double>(fileCount)) * 100 << "% done fetching block headers" << std::flush;
+        });
+        std::cout << std::endl;
+        
+        std::vector<BlockInfo<FileTag>> blocks;
+        for (auto &file : fileBlocks) {
+            blocks.insert(blocks.end(), file.begin(), file.end());
+        }
+        return blocks;
+    }
+
+    /** Reads the VARINT encoding of Bitcoin Core's serialize.h, which differs from the compact size of block files */
+    uint64_t readCoreVarInt(const char *&pos, const char *end) {
+        uint64_t n = 0;
+        while (pos != end) {
+            auto ch = static_cast<uint8_t>(*pos++);
+            n = (n << 7) | (ch & 0x7F);
+            if (ch & 0x80) {
+                n++;
+            } else {
+                return n;
+            }
+        }
+        throw std::out_of_range("Truncated entry in block index database");
+    }
+
+    /** Read the blocks stored in the block files from the CDiskBlockIndex entries of Bitcoin Core's blocks/index
+     * database, which RocksDB can open read only. The input and output counts of the blocks are left at 0, the
+     * processor counts them while decoding. Only the block lengths are read from the block files. */
+    std::vector<BlockInfo<FileTag>> readBlockIndexDb(const ParserConfiguration<FileTag> &config) {
+        constexpr uint64_t blockHaveData = 8;
+        constexpr uint64_t blockFailedMask = 32 | 64;
+        
+        auto indexPath = config.diskConfig.coinDirectory/"blocks"/"index";
+        rocksdb::Options options;
+        rocksdb::DB *dbPtr;
+        auto status = rocksdb::DB::OpenForReadOnly(options, indexPath.str(), &dbPtr);
+        if (!status.ok()) {
+            throw std::runtime_error{"Could not open block index database " + indexPath.str() + " with error: " + status.ToString()};
+        }
+        std::unique_ptr<rocksdb::DB> db(dbPtr);
+        
+        std::vector<BlockInfo<FileTag>> blocks;
+        std::unique_ptr<rocksdb::Iterator> it(db->NewIterator(rocksdb::ReadOptions{}));
+        for (it->Seek(rocksdb::Slice("b", 1)); it->Valid() && it->key().starts_with(rocksdb::Slice("b", 1)); it->Next()) {
+            auto value = it->value();
+            auto pos = value.data();
+            auto end = value.data() + value.size();
+            readCoreVarInt(pos, end); // client version
+            readCoreVarInt(pos, end); // height, recomputed from the prev-hash linkage
+            auto blockStatus = readCoreVarInt(pos, end);
+            auto txCount = readCoreVarInt(pos, end);
+            if (!(blockStatus & blockHaveData) || (blockStatus & blockFailedMask)) {
+                continue;
+            }
+            auto fileNum = readCoreVarInt(pos, end);
+            auto dataPos = readCoreVarInt(pos, end);
+            if (blockStatus & 16) {
+                readCoreVarInt(pos, end); // undo position
+            }
+            if (static_cast<size_t>(end - pos) < sizeof(CBlockHeader)) {
+                throw std::out_of_range("Truncated entry in block index database");
+            }
+            CBlockHeader header;
+            std::memcpy(&header, pos, sizeof(CBlockHeader));
+            blocks.emplace_back(header, 0, static_cast<unsigned int>(txCount), 0, 0, config.diskConfig, static_cast<int>(fileNum), static_cast<unsigned int>(dataPos));
+        }
+        if (!it->status().ok()) {
+            throw std::runtime_error{"Could not read block index database with error: " + it->status().ToString()};
+        }
+        
+        std::sort(blocks.begin(), blocks.end(), [](const BlockInfo<FileTag> &a, const BlockInfo<FileTag> &b) {
+            return std::tie(a.nFile, a.nDataPos) < std::tie(b.nFile, b.nDataPos);
+        });
+        
+        // The length of each block precedes its data in the block file
+        std::vector<std::pair<size_t, size_t>> fileRanges;
+        for (size_t i = 0; i < blocks.size(); i++) {
+            if (fileRanges.empty() || blocks[fileRanges.back().first].nFile != blocks[i].nFile) {
+                fileRanges.emplace_back(i, i);
+            }
+            fileRanges.back().second = i + 1;
+        }
+        runIndexTasks(config, fileRanges.size(), [&](size_t i) {
+            SafeMemReader reader{config.pathForBlockFile(blocks[fileRanges[i].first].nFile).str()};
+            for (auto j = fileRanges[i].first; j < fileRanges[i].second; j++) {
+                reader.reset(blocks[j].nDataPos - sizeof(uint32_t));
+                blocks[j].size = reader.readNext<uint32_t>();
+            }
+        });
+        return blocks;
+    }
+}
+
+ChainIndex<FileTag>::ChainIndex(const filesystem::path &directory) : blocks(directory/"blocks"), bestChain(directory/"chain"), orphans(directory/"orphans") {}
+
 void ChainIndex<FileTag>::update(const ConfigType &config, blocksci::BlockHeight /*maxblockHeight*/) {
     int fileNum = 0;
     unsigned int filePos = 0;
-
-    if (!blockList.empty()) {
+    if (blocks.size() > 0) {
+        BlockType newestBlock = *blocks[blocks.size() - 1];
         fileNum = newestBlock.nFile;
         filePos = newestBlock.nDataPos + newestBlock.size;
     }
-
-    auto firstFile = fileNum;
-    
-    auto maxFileNum = maxBlockFileNum(fileNum, config);
     
-    auto localConfig = config;
-    
-    std::mutex m;
-    
-    std::cout.setf(std::ios::fixed,std::ios::floatfield);
-    std::cout.precision(1);
-    auto fileCount = maxFileNum - fileNum + 1;
-    int filesDone = 0;
-    using namespace std::chrono_literals;
-    std::atomic<int> activeThreads{0};
-    {
-        std::vector<std::future<void>> blockFutures;
-        for (; fileNum <= maxFileNum; fileNum++) {
-            while (activeThreads > 20) {
-                std::this_thread::sleep_for(500ms);
+    std::vector<BlockType> newBlocks;
+    if (config.diskConfig.useBlockIndexDb) {
+        newBlocks = readBlockIndexDb(config);
+        // The database lists every block, the ones up to the newest record were added before
+        newBlocks.erase(std::remove_if(newBlocks.begin(), newBlocks.end(), [&](const BlockType &block) {
+            return std::make_tuple(block.nFile, block.nDataPos) < std::make_tuple(fileNum, filePos);
+        }), newBlocks.end());
+    } else {
+        newBlocks = scanBlockFiles(config, fileNum, filePos);
+    }
+    addBlocks(newBlocks);
+}
+
+int64_t ChainIndex<FileTag>::findRecord(const blocksci::uint256 &hash) {
+    if (!hashesLoaded) {
+        constexpr uint32_t recentRecordCount = 1000;
+        auto recordCount = blockCount();
+        for (uint32_t i = recordCount; i > recordCount - std::min(recordCount, recentRecordCount); i--) {
+            if (blocks[i - 1]->hash == hash) {
+                return i - 1;
             }
-            blockFutures.emplace_back(std::async(std::launch::async, [&](int fileNum) {
-                activeThreads++;
-                // Determine block file path
-                auto blockFilePath = localConfig.pathForBlockFile(fileNum);
-                SafeMemReader reader{blockFilePath.str()};
-                // Logic for resume from last processed block, note blockStartOffset and length below
-                if (fileNum == firstFile) {
-                    reader.reset(filePos);
-                }
-                auto blocks = readBlocksImpl(reader, fileNum, localConfig.diskConfig);
-                
-                if (fileNum == maxFileNum && blocks.size() > 0) {
-                    newestBlock = blocks.back();
-                }
-                activeThreads--;
-                std::lock_guard<std::mutex> lock(m);
-                
-                for (auto &block : blocks) {
-                    blockList[block.hash] = block;
-                }
-                
-                filesDone++;
-                std::cout << "\r" << (static_cast<double>(filesDone) / static_cast<double>(fileCount)) * 100 << "% done fetching block headers" << std::flush;
-                
-            }, fileNum));
         }
+        recordOfHash.reserve(recordCount);
+        for (uint32_t i = 0; i < recordCount; i++) {
+            recordOfHash.emplace(blocks[i]->hash, i);
+        }
+        hashesLoaded = true;
     }
-    
-    std::cout << std::endl;
-    
-    std::unordered_multimap<blocksci::uint256, blocksci::uint256> forwardHashes;
+    auto it = recordOfHash.find(hash);
+    return it != recordOfHash.end() ? static_cast<int64_t>(it->second) : -1;
+}
 
-    // Fill forwardHashes with pairs of ((prevBlockHash) -> (currentBlockHash)) for every block
-    for (auto &pair : blockList) {
-        forwardHashes.emplace(pair.second.header.hashPrevBlock, pair.second.hash);
-    }
-    
+void ChainIndex<FileTag>::addBlocks(const std::vector<BlockType> &newBlocks) {
     blocksci::uint256 nullHash;
     nullHash.SetNull();
     
-    std::vector<std::pair<blocksci::uint256, blocksci::BlockHeight>> queue;
+    // The blocks without height so far and the ones added now are the candidates to connect to the chain
+    std::vector<uint32_t> candidates;
+    for (uint32_t i = 0; i < orphans.size(); i++) {
+        candidates.push_back(*orphans[i]);
+    }
+    std::unordered_map<blocksci::uint256, uint32_t> candidateOfHash;
+    for (uint32_t i = 0; i < orphans.size(); i++) {
+        candidateOfHash.emplace(blocks[*orphans[i]]->hash, *orphans[i]);
+    }
+    for (auto block : newBlocks) {
+        // Bitcoin Core can store a block twice when it was downloaded again
+        if (!candidateOfHash.emplace(block.hash, blockCount()).second) {
+            continue;
+        }
+        block.height = -1;
+        candidates.push_back(blockCount());
+        if (hashesLoaded) {
+            recordOfHash.emplace(block.hash, blockCount());
+        }
+        blocks.write(block);
+    }
+    
+    // Map of (prevBlockHash) -> (record) for every candidate whose parent is a candidate too, the others are roots
+    // if their parent has a height already
+    std::unordered_multimap<blocksci::uint256, uint32_t> forwardRecords;
+    std::vector<uint32_t> queue;
+    for (auto record : candidates) {
+        auto &prevHash = blocks[record]->header.hashPrevBlock;
+        if (prevHash == nullHash) {
+            blocks[record]->height = 1;
+            queue.push_back(record);
+        } else if (candidateOfHash.find(prevHash) != candidateOfHash.end()) {
+            forwardRecords.emplace(prevHash, record);
+        } else {
+            auto parent = findRecord(prevHash);
+            if (parent >= 0 && blocks[static_cast<uint32_t>(parent)]->height >= 0) {
+                blocks[record]->height = blocks[static_cast<uint32_t>(parent)]->height + 1;
+                queue.push_back(record);
+            }
+        }
+    }
     
-    queue.emplace_back(nullHash, 0);
+    auto tipHeight = bestChain.size() > 0 ? blocks[*bestChain[bestChain.size() - 1]]->height : 0;
+    int64_t bestRecord = -1;
     while (!queue.empty()) {
-        blocksci::uint256 blockHash;
-        blocksci::BlockHeight height;
-        std::tie(blockHash, height) = queue.back();
+        auto record = queue.back();
         queue.pop_back();
-        for (auto ret = forwardHashes.equal_range(blockHash); ret.first != ret.second; ++ret.first) {
-            auto &block = blockList.at(ret.first->second);
-            block.height = height + 1;
-            queue.emplace_back(block.hash, block.height);
+        auto height = blocks[record]->height;
+        if (height > tipHeight) {
+            tipHeight = height;
+            bestRecord = record;
+        }
+        for (auto ret = forwardRecords.equal_range(blocks[record]->hash); ret.first != ret.second; ++ret.first) {
+            blocks[ret.first->second]->height = height + 1;
+            queue.push_back(ret.first->second);
+        }
+    }
+    
+    orphans.truncate(0);
+    for (auto record : candidates) {
+        if (blocks[record]->height < 0) {
+            orphans.write(record);
+        }
+    }
+    
+    if (bestRecord < 0) {
+        return;
+    }
+    
+    // Walk back from the new tip until reaching the best chain, which is then cut off after that block. The genesis
+    // block has height 1, so the block at height h is entry h - 1 of the best chain.
+    std::vector<uint32_t> branch;
+    auto record = static_cast<uint32_t>(bestRecord);
+    uint32_t keptCount = 0;
+    while (true) {
+        auto position = static_cast<uint32_t>(blocks[record]->height - 1);
+        if (position < bestChain.size() && *bestChain[position] == record) {
+            keptCount = position + 1;
+            break;
+        }
+        branch.push_back(record);
+        auto &prevHash = blocks[record]->header.hashPrevBlock;
+        if (prevHash == nullHash) {
+            break;
         }
+        record = static_cast<uint32_t>(findRecord(prevHash));
+    }
+    bestChain.truncate(keptCount);
+    for (auto it = branch.rbegin(); it != branch.rend(); ++it) {
+        bestChain.write(*it);
+    }
+}
+
+std::vector<BlockInfo<FileTag>> ChainIndex<FileTag>::generateChain(blocksci::BlockHeight maxBlockHeight) const {
+    std::vector<BlockType> chain;
+    chain.reserve(bestChain.size());
+    for (uint32_t i = 0; i < bestChain.size(); i++) {
+        chain.push_back(*blocks[*bestChain[i]]);
     }
     
+    if (maxBlockHeight < 0) {
+        return {chain.begin(), chain.end() + maxBlockHeight};
+    } else if (maxBlockHeight == 0 || maxBlockHeight > static_cast<blocksci::BlockHeight>(chain.size())) {
+        return chain;
+    } else {
+        return {chain.begin(), chain.begin() + maxBlockHeight};
+    }
+}
+
+void ChainIndex<FileTag>::flush() {
+    blocks.clearBuffer();
+    bestChain.clearBuffer();
+    orphans.clearBuffer();
+}
+
+std::unique_ptr<ChainIndex<FileTag>> openChainIndex(const ParserConfiguration<FileTag> &config) {
+    auto directory = config.chainIndexDirectory();
+    if (!directory.exists()) {
+        filesystem::create_directory(directory);
+    }
+    auto index = std::make_unique<ChainIndex<FileTag>>(directory);
+    if (index->blockCount() == 0 && config.blockListPath().exists()) {
+        // Carry over the headers of a cereal serialized index written by an earlier version
+        std::unordered_map<blocksci::uint256, BlockInfo<FileTag>> blockList;
+        BlockInfo<FileTag> newestBlock;
+        try {
+            std::ifstream inFile(config.blockListPath().str(), std::ios::binary);
+            cereal::BinaryInputArchive ia(inFile);
+            ia(blockList, newestBlock);
+        } catch (const std::exception &) {
+            std::cout << "Error loading chain index. Reparsing from scratch\n";
+            blockList.clear();
+        }
+        std::vector<BlockInfo<FileTag>> oldBlocks;
+        oldBlocks.reserve(blockList.size());
+        for (auto &pair : blockList) {
+            oldBlocks.push_back(pair.second);
+        }
+        std::sort(oldBlocks.begin(), oldBlocks.end(), [](const BlockInfo<FileTag> &a, const BlockInfo<FileTag> &b) {
+            return std::tie(a.nFile, a.nDataPos) < std::tie(b.nFile, b.nDataPos);
+        });
+        index->addBlocks(oldBlocks);
+        index->flush();
+    }
+    return index;
+}
+
+void saveChainIndex(ChainIndex<FileTag> &index, const ParserConfiguration<FileTag> &) {
+    index.flush();
 }
 
 template<>
@@ -233,4 +509,26 @@ void ChainIndex<RPCTag>::update(const ConfigType &config, blocksci::BlockHeight
     std::cout << std::endl;
 }
 
+std::unique_ptr<ChainIndex<RPCTag>> openChainIndex(const ParserConfiguration<RPCTag> &config) {
+    auto index = std::make_unique<ChainIndex<RPCTag>>();
+    // Load the persisted (serialized) ChainIndex object that contains information about all blocks (without transaction data)
+    std::ifstream inFile(config.blockListPath().str(), std::ios::binary);
+    if (inFile.good()) {
+        try {
+            cereal::BinaryInputArchive ia(inFile);
+            ia(*index);
+        } catch (const std::exception &) {
+            std::cout << "Error loading chain index. Reparsing from scratch\n";
+            index = std::make_unique<ChainIndex<RPCTag>>();
+        }
+    }
+    return index;
+}
+
+void saveChainIndex(ChainIndex<RPCTag> &index, const ParserConfiguration<RPCTag> &config) {
+    std::ofstream of(config.blockListPath().str(), std::ios::binary);
+    cereal::BinaryOutputArchive oa(of);
+    oa(index);
+}
+
 #endif
@@ -15,6 +15,10 @@
 #include <blocksci/core/typedefs.hpp>
 #include <blocksci/core/bitcoin_uint256.hpp>
 
+#include <internal/file_mapper.hpp>
+
+#include <wjfilesystem/path.h>
+
 #include <cereal/types/base_class.hpp>
 #include <cereal/types/unordered_map.hpp>
 #include <cereal/types/vector.hpp>
@@ -22,6 +26,8 @@
 
 #include <unordered_map>
 #include <algorithm>
+#include <memory>
+#include <type_traits>
 #include <vector>
 #include <cstdint>
 #include <limits>
@@ -140,7 +146,7 @@ struct BlockInfo<RPCTag> : BlockInfoBase {
     }
 };
 
-/** Holds the current set/state of blocks for the parser
+/** Holds the current set/state of blocks for the RPC parser
  *
  * File: parser/blockList.dat
  * Raw data format: ChainIndex object serialized using cereal library @see: https://uscilab.github.io/cereal/
@@ -224,6 +230,61 @@ private:
     int updateHeight(size_t blockNum, const std::unordered_map<blocksci::uint256, size_t> &indexMap);
 };
 
+static_assert(std::is_trivially_copyable<BlockInfo<FileTag>>::value, "BlockInfo<FileTag> is stored as fixed size records");
+
+/** Holds the blocks found in the block files for the disk parser
+ *
+ * Directory: parser/chainIndex
+ * blocks.dat: BlockInfo<FileTag> records in the order they were read from the block files, each update appends the new ones
+ * chain.dat: uint32_t record number of the block at every height of the best chain, used to detect forks
+ * orphans.dat: uint32_t record numbers of the blocks whose parent hasn't been found yet
+ *
+ * The files are memory-mapped instead of deserialized, so an incremental update only pays for the new blocks. Their
+ * parents are almost always among the most recent records, a hash map of all records is only built when a block
+ * doesn't connect to those.
+ */
+template <>
+struct ChainIndex<FileTag> {
+    using BlockType = BlockInfo<FileTag>;
+    using ConfigType = ParserConfiguration<FileTag>;
+    
+    explicit ChainIndex(const filesystem::path &directory);
+    
+    /** Read the blocks stored after the newest record from the block files */
+    void update(const ConfigType &config, blocksci::BlockHeight maxblockHeight);
+    
+    /** Append blocks given in block file order, set the heights of those which connect to the chain and move the best
+     * chain to the highest block */
+    void addBlocks(const std::vector<BlockType> &newBlocks);
+    
+    std::vector<BlockType> generateChain(blocksci::BlockHeight maxBlockHeight) const;
+    
+    uint32_t blockCount() const {
+        return static_cast<uint32_t>(blocks.size());
+    }
+    
+    void flush();
+    
+private:
+    blocksci::FixedSizeFileMapper<BlockType, mio::access_mode::write> blocks;
+    blocksci::FixedSizeFileMapper<uint32_t, mio::access_mode::write> bestChain;
+    blocksci::FixedSizeFileMapper<uint32_t, mio::access_mode::write> orphans;
+    
+    /** Record number of every block hash, only filled once a lookup misses the recent records */
+    std::unordered_map<blocksci::uint256, uint32_t> recordOfHash;
+    bool hashesLoaded = false;
+    
+    /** Record number of the block with the given hash or -1 if there is none */
+    int64_t findRecord(const blocksci::uint256 &hash);
+};
+
+/** Load the chain index of the parser, the disk parser migrates a blockList.dat left by an earlier version */
+std::unique_ptr<ChainIndex<FileTag>> openChainIndex(const ParserConfiguration<FileTag> &config);
+std::unique_ptr<ChainIndex<RPCTag>> openChainIndex(const ParserConfiguration<RPCTag> &config);
+
+void saveChainIndex(ChainIndex<FileTag> &index, const ParserConfiguration<FileTag> &config);
+void saveChainIndex(ChainIndex<RPCTag> &index, const ParserConfiguration<RPCTag> &config);
+
 std::vector<BlockInfo<FileTag>> readBlocksInfo(int fileNum, const ParserConfiguration<FileTag> &config);
 
 #endif /* data_store_hpp */
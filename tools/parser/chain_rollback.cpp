@@ -0,0 +1,256 @@
+//
+//  chain_rollback.cpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#define BLOCKSCI_WITHOUT_SINGLETON
+
+#include "chain_rollback.hpp"
+#include "address_db.hpp"
+#include "address_state.hpp"
+#include "address_stats_writer.hpp"
+#include "address_writer.hpp"
+#include "basic_types.hpp"
+#include "block_address_filter_writer.hpp"
+#include "block_stats_writer.hpp"
+#include "hash_index_creator.hpp"
+#include "nulldata_index_creator.hpp"
+#include "output_column_writer.hpp"
+#include "output_spend_data.hpp"
+#include "parser_configuration.hpp"
+#include "tx_package_writer.hpp"
+#include "undo_journal.hpp"
+#include "utxo.hpp"
+#include "utxo_address_state.hpp"
+#include "utxo_state.hpp"
+
+#include <blocksci/core/input_signature.hpp>
+#include <blocksci/core/raw_block.hpp>
+#include <blocksci/core/raw_transaction.hpp>
+#include <blocksci/core/raw_witness.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/chain_generation.hpp>
+#include <internal/chain_manifest.hpp>
+#include <internal/compressed_file_mapper.hpp>
+#include <internal/dedup_address_info.hpp>
+#include <internal/file_mapper.hpp>
+#include <internal/script_access.hpp>
+#include <internal/state.hpp>
+
+#include <iostream>
+#include <vector>
+
+namespace {
+    /** Output of an older tx that an undone block spent */
+    struct RestoredOutput {
+        blocksci::uint256 txHash;
+        uint32_t txNum;
+        uint16_t outputNum;
+        uint64_t globalOutputNum;
+        int64_t value;
+        blocksci::RawAddress address;
+    };
+
+    /** Output of an undone block that was still unspent */
+    struct RemovedOutput {
+        blocksci::uint256 txHash;
+        uint32_t txNum;
+        uint16_t outputNum;
+        blocksci::AddressType::Enum type;
+    };
+
+    std::vector<BlockUndo> loadJournals(const ParserConfigurationBase &config, const blocksci::ChainAccess &chain, blocksci::BlockHeight splitPoint) {
+        std::vector<BlockUndo> journals;
+        for (auto height = splitPoint; height < chain.blockCount(); height++) {
+            auto block = chain.getBlock(height);
+            BlockUndo undo;
+            if (!undo.load(config, height) || !(undo.hash == block->hash) || undo.firstTxNum != block->firstTxIndex) {
+                return {};
+            }
+            journals.push_back(std::move(undo));
+        }
+        return journals;
+    }
+
+    /** Truncate a column indexed by tx or input number if it exists, its compressed copy is outdated afterwards */
+    template <typename T>
+    void truncateColumn(const filesystem::path &path, blocksci::OffsetType size) {
+        if (filesystem::path{path.str() + ".dat"}.exists()) {
+            blocksci::FixedSizeFileMapper<T, mio::access_mode::write> file{path};
+            file.truncate(size);
+        }
+        filesystem::path compressedPath{blocksci::compressedColumnPath(path).str() + ".dat"};
+        if (compressedPath.exists()) {
+            compressedPath.remove_file();
+        }
+    }
+}
+
+bool canRollback(const ParserConfigurationBase &config, blocksci::BlockHeight splitPoint) {
+    blocksci::ChainAccess chain{config.dataConfig.chainDirectory(), 0, false};
+    return splitPoint < chain.blockCount() && !loadJournals(config, chain, splitPoint).empty();
+}
+
+void rollbackChain(const ParserConfigurationBase &config, blocksci::BlockHeight splitPoint, UTXOState &utxoState, UTXOAddressState &utxoAddressState, UTXOScriptState &utxoScriptState, AddressState &addressState, HashIndexCreator &hashDb) {
+    auto chainDirectory = config.dataConfig.chainDirectory();
+
+    // Readers loaded with errorOnReorg recheck the chain once the generation changed
+    blocksci::ChainGeneration::increment(chainDirectory);
+    // Remove the undone snapshots before their files shrink so that no reader pins them anymore
+    blocksci::ChainManifest::truncate(chainDirectory, splitPoint);
+
+    AddressDB addressDb(config, config.dataConfig.addressDBFilePath());
+
+    std::vector<BlockUndo> journals;
+    blocksci::State state;
+    uint64_t firstInputNum;
+    uint64_t coinbaseOffset;
+    blocksci::BlockHeight blockCount;
+    std::vector<RestoredOutput> restoredOutputs;
+    std::vector<RemovedOutput> removedOutputs;
+    std::vector<UndoAddressKey> removedAddresses;
+    {
+        blocksci::ChainAccess chain{chainDirectory, 0, false};
+        blocksci::ScriptAccess scripts{config.dataConfig.scriptsDirectory()};
+        journals = loadJournals(config, chain, splitPoint);
+        if (journals.empty()) {
+            throw std::runtime_error("Undo journals of the blocks to roll back are missing, reparse to switch to the new fork");
+        }
+
+        blockCount = chain.blockCount();
+        auto firstBlock = chain.getBlock(splitPoint);
+        state.blockCount = static_cast<uint32_t>(splitPoint);
+        state.txCount = firstBlock->firstTxIndex;
+        state.scriptCounts = journals.front().scriptCounts;
+        firstInputNum = chain.getFirstInputNumber(state.txCount);
+        coinbaseOffset = firstBlock->coinbaseOffset;
+        std::cout << "Rolling back " << blockCount - splitPoint << " blocks with " << chain.txCount() - state.txCount << " transactions\n";
+
+        // Outputs spent by the undone txes become unspent again, outputs they created and left unspent disappear
+        std::vector<blocksci::uint256> txHashes;
+        auto txCount = static_cast<uint32_t>(chain.txCount());
+        for (uint32_t txNum = state.txCount; txNum < txCount; txNum++) {
+            auto tx = chain.getTx(txNum);
+            auto txHash = *chain.getTxHash(txNum);
+            txHashes.push_back(txHash);
+            auto spentOutNums = chain.getSpentOutputNumbers(txNum);
+            for (uint16_t i = 0; i < tx->inputCount; i++) {
+                auto &input = tx->getInput(i);
+                auto spentTxNum = input.getLinkedTxNum();
+                if (spentTxNum < state.txCount) {
+                    auto globalOutputNum = chain.getFirstOutputNumber(spentTxNum) + spentOutNums[i];
+                    restoredOutputs.push_back({*chain.getTxHash(spentTxNum), spentTxNum, spentOutNums[i], globalOutputNum, input.getValue(), blocksci::RawAddress{input.getAddressNum(), input.getType()}});
+                }
+            }
+            for (uint16_t i = 0; i < tx->outputCount; i++) {
+                auto &output = tx->getOutput(i);
+                if (output.getLinkedTxNum() == 0) {
+                    removedOutputs.push_back({txHash, txNum, i, output.getType()});
+                }
+            }
+        }
+
+        for (auto &journal : journals) {
+            removedAddresses.insert(removedAddresses.end(), journal.newAddresses.begin(), journal.newAddresses.end());
+        }
+        std::vector<blocksci::uint256> witnessScriptHashes;
+        auto scriptHashIndex = static_cast<size_t>(blocksci::DedupAddressType::SCRIPTHASH);
+        for (uint32_t scriptNum = state.scriptCounts[scriptHashIndex] + 1; scriptNum <= scripts.scriptCount(blocksci::DedupAddressType::SCRIPTHASH); scriptNum++) {
+            auto script = scripts.getScriptData<blocksci::DedupAddressType::SCRIPTHASH>(scriptNum);
+            if (script->isSegwit) {
+                witnessScriptHashes.push_back(script->hash256);
+            }
+        }
+
+        // The index entries are derived from the data that is about to be removed
+        addressDb.rollback(state, chain, scripts);
+        hashDb.rollback(state, txHashes, removedAddresses, witnessScriptHashes);
+    }
+
+    {
+        AddressWriter addressWriter{config};
+        addressWriter.rollback(journals);
+    }
+
+    {
+        blocksci::IndexedFileMapper<mio::access_mode::write, blocksci::RawTransaction> txFile(blocksci::ChainAccess::txFilePath(chainDirectory));
+        for (auto &output : restoredOutputs) {
+            txFile.getData(output.txNum)->getOutput(output.outputNum).setLinkedTxNum(0);
+        }
+        txFile.truncate(state.txCount);
+    }
+    truncateColumn<blocksci::uint256>(blocksci::ChainAccess::txHashesFilePath(chainDirectory), state.txCount);
+    truncateColumn<uint64_t>(blocksci::ChainAccess::firstInputFilePath(chainDirectory), state.txCount);
+    truncateColumn<uint64_t>(blocksci::ChainAccess::firstOutputFilePath(chainDirectory), state.txCount);
+    truncateColumn<int32_t>(blocksci::ChainAccess::txVersionFilePath(chainDirectory), state.txCount);
+    truncateColumn<uint16_t>(blocksci::ChainAccess::inputSpentOutNumFilePath(chainDirectory), static_cast<blocksci::OffsetType>(firstInputNum));
+    truncateColumn<uint32_t>(blocksci::ChainAccess::sequenceFilePath(chainDirectory), static_cast<blocksci::OffsetType>(firstInputNum));
+
+    auto signatureStartPath = blocksci::ChainAccess::inputSignatureStartFilePath(chainDirectory);
+    if (filesystem::path{signatureStartPath.str() + ".dat"}.exists()) {
+        blocksci::FixedSizeFileMapper<uint64_t> signatureStartFile{signatureStartPath};
+        auto firstSignature = signatureStartFile.size() > 0 ? *signatureStartFile[0] : 0;
+        truncateColumn<blocksci::InputSignature>(blocksci::ChainAccess::inputSignatureFilePath(chainDirectory), static_cast<blocksci::OffsetType>(firstInputNum > firstSignature ? firstInputNum - firstSignature : 0));
+    }
+    auto witnessInfoPath = blocksci::ChainAccess::witnessInfoFilePath(chainDirectory);
+    if (filesystem::path{witnessInfoPath.str() + ".dat"}.exists()) {
+        blocksci::FixedSizeFileMapper<blocksci::WitnessFileInfo> witnessInfoFile{witnessInfoPath};
+        auto firstWitnessTx = witnessInfoFile.size() > 0 ? witnessInfoFile[0]->firstTxNum : 0;
+        blocksci::IndexedFileMapper<mio::access_mode::write, blocksci::RawWitness> witnessFile{blocksci::ChainAccess::witnessFilePath(chainDirectory)};
+        witnessFile.truncate(state.txCount > firstWitnessTx ? state.txCount - firstWitnessTx : 0);
+    }
+
+    {
+        blocksci::FixedSizeFileMapper<blocksci::RawBlock, mio::access_mode::write> blockFile{blocksci::ChainAccess::blockFilePath(chainDirectory)};
+        blockFile.truncate(static_cast<blocksci::OffsetType>(splitPoint));
+        blocksci::SimpleFileMapper<mio::access_mode::write> coinbaseFile{blocksci::ChainAccess::blockCoinbaseFilePath(chainDirectory)};
+        coinbaseFile.truncate(static_cast<blocksci::OffsetType>(coinbaseOffset));
+    }
+
+    // Columns of the undone outputs are truncated by the next update, only the spends of older outputs are reset
+    std::vector<uint64_t> reopenedOutputs;
+    reopenedOutputs.reserve(restoredOutputs.size());
+    for (auto &output : restoredOutputs) {
+        reopenedOutputs.push_back(output.globalOutputNum);
+    }
+    resetSpentOutputs(config, reopenedOutputs);
+    truncateCoinAgeColumns(config, splitPoint);
+    truncateBlockStats(config, splitPoint);
+    truncateTxPackages(config, splitPoint);
+    invalidateAddressStats(config);
+    truncateBlockAddressFilters(config, splitPoint);
+    if (blocksci::NulldataPrefixIndex::exists(config.dataConfig.nulldataIndexDirectory())) {
+        NulldataIndexCreator nulldataIndex(config, config.dataConfig.nulldataIndexDirectory());
+        nulldataIndex.rollback(state);
+    }
+
+    {
+        blocksci::ScriptAccess scripts{config.dataConfig.scriptsDirectory()};
+        for (auto &output : removedOutputs) {
+            blocksci::InoutPointer pointer{output.txNum, output.outputNum};
+            if (isSpendable(dedupType(output.type))) {
+                utxoState.erase(RawOutputPointer{output.txHash, output.outputNum});
+            }
+            utxoScriptState.erase(pointer);
+            utxoAddressState.spendOutput(pointer, output.type);
+        }
+        for (auto &output : restoredOutputs) {
+            blocksci::InoutPointer pointer{output.txNum, output.outputNum};
+            utxoState.add(RawOutputPointer{output.txHash, output.outputNum}, UTXO{output.value, output.txNum, output.address.type});
+            utxoScriptState.add(pointer, output.address.scriptNum);
+            utxoAddressState.addOutput(AnySpendData{output.address, scripts}, pointer);
+        }
+        addressState.rollback(state.scriptCounts, removedAddresses);
+
+        addressDb.rollbackAddressTables(config.dataConfig.addressTablesDirectory(), state.txCount, scripts);
+    }
+
+    for (auto height = splitPoint; height < blockCount; height++) {
+        BlockUndo::remove(config, height);
+    }
+
+    blocksci::ChainGeneration::increment(chainDirectory);
+}
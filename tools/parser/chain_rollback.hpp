@@ -0,0 +1,30 @@
+//
+//  chain_rollback.hpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef chain_rollback_hpp
+#define chain_rollback_hpp
+
+#include "parser_fwd.hpp"
+
+#include <blocksci/core/typedefs.hpp>
+
+class HashIndexCreator;
+
+/** Whether every parsed block from splitPoint on has an undo journal that matches it, @see BlockUndo */
+bool canRollback(const ParserConfigurationBase &config, blocksci::BlockHeight splitPoint);
+
+/** Undo all parsed blocks from splitPoint on after the chain was reorganized, so that the blocks of the new fork can
+ * be added by a regular update
+ *
+ * Truncates the chain and script files to the state before splitPoint, restores the scripts that the undone blocks
+ * modified, returns the outputs they spent to the UTXO maps and removes their entries from the indexes. Derived data
+ * that can't be undone in place (address stats, address tables covering the undone txes) is rebuilt by the next
+ * update. Requires canRollback(config, splitPoint).
+ */
+void rollbackChain(const ParserConfigurationBase &config, blocksci::BlockHeight splitPoint, UTXOState &utxoState, UTXOAddressState &utxoAddressState, UTXOScriptState &utxoScriptState, AddressState &addressState, HashIndexCreator &hashDb);
+
+#endif /* chain_rollback_hpp */
@@ -0,0 +1,521 @@
+//
+//  chain_synthesizer.cpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "chain_synthesizer.hpp"
+
+#include <internal/hash.hpp>
+
+#include <blocksci/core/bitcoin_uint256.hpp>
+#include <blocksci/core/typedefs.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    enum class ScriptKind : uint8_t { PubkeyHash, WitnessPubkeyHash, ScriptHash, Multisig, Pubkey, Nulldata };
+
+    constexpr uint32_t maxInouts = 2000;
+    constexpr int64_t blockSubsidy = 50 * int64_t{100000000};
+    constexpr int64_t txFee = 1000;
+    constexpr uint32_t firstBlockTime = 1296688602;
+
+    struct SyntheticUtxo {
+        blocksci::uint256 txHash;
+        int64_t value;
+        uint32_t key;
+        uint16_t outputNum;
+        ScriptKind kind;
+    };
+
+    std::vector<std::pair<ScriptKind, double>> parseScriptMix(const std::string &mix) {
+        static const std::vector<std::pair<std::string, ScriptKind>> names = {
+            {"pubkeyhash", ScriptKind::PubkeyHash},
+            {"witness_pubkeyhash", ScriptKind::WitnessPubkeyHash},
+            {"scripthash", ScriptKind::ScriptHash},
+            {"multisig", ScriptKind::Multisig},
+            {"pubkey", ScriptKind::Pubkey},
+            {"nulldata", ScriptKind::Nulldata}
+        };
+        std::vector<std::pair<ScriptKind, double>> weights;
+        std::stringstream ss(mix);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            auto separator = item.find('=');
+            if (separator == std::string::npos) {
+                throw std::invalid_argument("Invalid script mix entry " + item + ", expected <type>=<weight>");
+            }
+            auto name = item.substr(0, separator);
+            auto it = std::find_if(names.begin(), names.end(), [&](const auto &pair) { return pair.first == name; });
+            if (it == names.end()) {
+                throw std::invalid_argument("Unknown script type " + name + " in script mix");
+            }
+            weights.emplace_back(it->second, std::stod(item.substr(separator + 1)));
+        }
+        bool spendable = std::any_of(weights.begin(), weights.end(), [](const auto &pair) { return pair.first != ScriptKind::Nulldata && pair.second > 0; });
+        if (!spendable) {
+            throw std::invalid_argument("The script mix needs a positive weight for at least one spendable script type");
+        }
+        return weights;
+    }
+
+    class ByteWriter {
+        std::vector<unsigned char> &buffer;
+
+    public:
+        explicit ByteWriter(std::vector<unsigned char> &buffer_) : buffer(buffer_) {}
+
+        template <typename T>
+        void write(T value) {
+            auto bytes = reinterpret_cast<const unsigned char *>(&value);
+            buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+        }
+
+        void write(const unsigned char *data, size_t length) {
+            buffer.insert(buffer.end(), data, data + length);
+        }
+
+        void writeCompactSize(uint64_t value) {
+            if (value < 253) {
+                write(static_cast<uint8_t>(value));
+            } else if (value <= 0xffff) {
+                write(static_cast<uint8_t>(253));
+                write(static_cast<uint16_t>(value));
+            } else if (value <= 0xffffffff) {
+                write(static_cast<uint8_t>(254));
+                write(static_cast<uint32_t>(value));
+            } else {
+                write(static_cast<uint8_t>(255));
+                write(value);
+            }
+        }
+
+        void writeBytes(const std::vector<unsigned char> &data) {
+            writeCompactSize(data.size());
+            write(data.data(), data.size());
+        }
+    };
+
+    void pushData(std::vector<unsigned char> &script, const unsigned char *data, size_t length) {
+        if (length < 0x4c) {
+            script.push_back(static_cast<unsigned char>(length));
+        } else {
+            script.push_back(0x4c);
+            script.push_back(static_cast<unsigned char>(length));
+        }
+        script.insert(script.end(), data, data + length);
+    }
+
+    void pushData(std::vector<unsigned char> &script, const std::vector<unsigned char> &data) {
+        pushData(script, data.data(), data.size());
+    }
+
+    /** Compressed public key of the key number, unique per number */
+    std::array<unsigned char, 33> makePubkey(uint32_t key) {
+        std::array<unsigned char, 33> pubkey;
+        auto hash = sha256(reinterpret_cast<const uint8_t *>(&key), sizeof(key));
+        pubkey[0] = (hash.begin()[0] & 1) ? 0x03 : 0x02;
+        std::copy(hash.begin(), hash.end(), pubkey.begin() + 1);
+        return pubkey;
+    }
+
+    /** DER encoded signature of plausible length with the SIGHASH_ALL byte */
+    std::vector<unsigned char> makeSignature(std::mt19937_64 &generator) {
+        std::vector<unsigned char> signature = {0x30, 0x44, 0x02, 0x20};
+        for (int i = 0; i < 32; i++) {
+            signature.push_back(static_cast<unsigned char>(generator()));
+        }
+        signature[4] &= 0x7f;
+        signature.insert(signature.end(), {0x02, 0x20});
+        for (int i = 0; i < 32; i++) {
+            signature.push_back(static_cast<unsigned char>(generator()));
+        }
+        signature[38] &= 0x7f;
+        signature.push_back(0x01);
+        return signature;
+    }
+
+    std::vector<unsigned char> redeemScript(uint32_t key) {
+        auto pubkey = makePubkey(key);
+        std::vector<unsigned char> script;
+        pushData(script, pubkey.data(), pubkey.size());
+        script.push_back(0xac); // OP_CHECKSIG
+        return script;
+    }
+
+    std::vector<unsigned char> outputScript(ScriptKind kind, uint32_t key, std::mt19937_64 &generator) {
+        std::vector<unsigned char> script;
+        switch (kind) {
+            case ScriptKind::PubkeyHash: {
+                auto pubkey = makePubkey(key);
+                auto hash = hash160(pubkey.data(), pubkey.size());
+                script = {0x76, 0xa9}; // OP_DUP OP_HASH160
+                pushData(script, hash.begin(), hash.size());
+                script.insert(script.end(), {0x88, 0xac}); // OP_EQUALVERIFY OP_CHECKSIG
+                break;
+            }
+            case ScriptKind::WitnessPubkeyHash: {
+                auto pubkey = makePubkey(key);
+                auto hash = hash160(pubkey.data(), pubkey.size());
+                script = {0x00};
+                pushData(script, hash.begin(), hash.size());
+                break;
+            }
+            case ScriptKind::ScriptHash: {
+                auto redeem = redeemScript(key);
+                auto hash = hash160(redeem.data(), redeem.size());
+                script = {0xa9}; // OP_HASH160
+                pushData(script, hash.begin(), hash.size());
+                script.push_back(0x87); // OP_EQUAL
+                break;
+            }
+            case ScriptKind::Multisig: {
+                auto first = makePubkey(key);
+                auto second = makePubkey(key + 1);
+                script = {0x51}; // OP_1
+                pushData(script, first.data(), first.size());
+                pushData(script, second.data(), second.size());
+                script.insert(script.end(), {0x52, 0xae}); // OP_2 OP_CHECKMULTISIG
+                break;
+            }
+            case ScriptKind::Pubkey: {
+                script = redeemScript(key);
+                break;
+            }
+            case ScriptKind::Nulldata: {
+                std::array<unsigned char, 16> payload;
+                for (auto &byte : payload) {
+                    byte = static_cast<unsigned char>(generator());
+                }
+                script = {0x6a}; // OP_RETURN
+                pushData(script, payload.data(), payload.size());
+                break;
+            }
+        }
+        return script;
+    }
+
+    /** Input script and witness stack spending the output */
+    void spendingData(const SyntheticUtxo &utxo, std::mt19937_64 &generator, std::vector<unsigned char> &scriptSig, std::vector<std::vector<unsigned char>> &witness) {
+        scriptSig.clear();
+        witness.clear();
+        auto signature = makeSignature(generator);
+        switch (utxo.kind) {
+            case ScriptKind::PubkeyHash: {
+                auto pubkey = makePubkey(utxo.key);
+                pushData(scriptSig, signature);
+                pushData(scriptSig, pubkey.data(), pubkey.size());
+                break;
+            }
+            case ScriptKind::WitnessPubkeyHash: {
+                auto pubkey = makePubkey(utxo.key);
+                witness.push_back(signature);
+                witness.emplace_back(pubkey.begin(), pubkey.end());
+                break;
+            }
+            case ScriptKind::ScriptHash:
+                pushData(scriptSig, signature);
+                pushData(scriptSig, redeemScript(utxo.key));
+                break;
+            case ScriptKind::Multisig:
+                scriptSig.push_back(0x00); // OP_0 for the extra item consumed by OP_CHECKMULTISIG
+                pushData(scriptSig, signature);
+                break;
+            case ScriptKind::Pubkey:
+                pushData(scriptSig, signature);
+                break;
+            case ScriptKind::Nulldata:
+                break;
+        }
+    }
+
+    blocksci::uint256 merkleRoot(std::vector<blocksci::uint256> hashes) {
+        while (hashes.size() > 1) {
+            if (hashes.size() % 2 == 1) {
+                hashes.push_back(hashes.back());
+            }
+            std::vector<blocksci::uint256> parents(hashes.size() / 2);
+            std::vector<HashInput> inputs(parents.size());
+            for (size_t i = 0; i < parents.size(); i++) {
+                inputs[i] = HashInput{{hashes[2 * i].begin(), hashes[2 * i + 1].begin(), nullptr}, {32, 32, 0}};
+            }
+            doubleSha256Batch(inputs.data(), inputs.size(), parents.data());
+            hashes = std::move(parents);
+        }
+        return hashes.empty() ? blocksci::uint256{} : hashes.front();
+    }
+
+    class ChainSynthesizer {
+        const SyntheticChainOptions &options;
+        std::mt19937_64 generator;
+        std::vector<std::pair<ScriptKind, double>> scriptMix;
+        std::discrete_distribution<size_t> scriptDistribution;
+        std::geometric_distribution<uint32_t> extraInputs;
+        std::geometric_distribution<uint32_t> extraOutputs;
+        std::uniform_real_distribution<double> unit{0.0, 1.0};
+
+        std::vector<SyntheticUtxo> utxos;
+        uint32_t keyCount = 0;
+
+        std::vector<unsigned char> scriptSig;
+        std::vector<std::vector<unsigned char>> witness;
+
+        static std::geometric_distribution<uint32_t> countDistribution(double mean) {
+            return std::geometric_distribution<uint32_t>(1.0 / std::max(mean, 1.0));
+        }
+
+        std::discrete_distribution<size_t> makeScriptDistribution() {
+            std::vector<double> weights;
+            for (auto &pair : scriptMix) {
+                weights.push_back(pair.second);
+            }
+            return std::discrete_distribution<size_t>(weights.begin(), weights.end());
+        }
+
+        uint32_t pickKey() {
+            if (keyCount > 0 && unit(generator) < options.addressReuse) {
+                return std::uniform_int_distribution<uint32_t>(0, keyCount - 1)(generator);
+            }
+            // Multisig outputs use the key and its successor
+            auto key = keyCount;
+            keyCount += 2;
+            return key;
+        }
+
+        /** Half of the spends take one of the most recent outputs, real chains spend young outputs far more often */
+        SyntheticUtxo takeUtxo() {
+            auto recent = std::max<size_t>(1, utxos.size() / 16);
+            size_t index;
+            if (unit(generator) < 0.5) {
+                index = utxos.size() - 1 - std::uniform_int_distribution<size_t>(0, recent - 1)(generator);
+            } else {
+                index = std::uniform_int_distribution<size_t>(0, utxos.size() - 1)(generator);
+            }
+            auto utxo = utxos[index];
+            utxos[index] = utxos.back();
+            utxos.pop_back();
+            return utxo;
+        }
+
+        void writeOutputs(ByteWriter &writer, uint32_t outputCount, int64_t totalValue, std::vector<SyntheticUtxo> &created) {
+            created.clear();
+            std::vector<ScriptKind> kinds(outputCount);
+            uint32_t spendableCount = 0;
+            for (auto &kind : kinds) {
+                kind = scriptMix[scriptDistribution(generator)].first;
+                spendableCount += kind != ScriptKind::Nulldata;
+            }
+            if (spendableCount == 0) {
+                kinds.back() = ScriptKind::PubkeyHash;
+                spendableCount = 1;
+            }
+            writer.writeCompactSize(outputCount);
+            auto remaining = totalValue;
+            for (uint32_t i = 0; i < outputCount; i++) {
+                auto kind = kinds[i];
+                int64_t value = 0;
+                uint32_t key = 0;
+                if (kind != ScriptKind::Nulldata) {
+                    spendableCount--;
+                    value = spendableCount == 0 ? remaining : static_cast<int64_t>(static_cast<double>(remaining) * unit(generator) * 0.8);
+                    remaining -= value;
+                    key = pickKey();
+                }
+                writer.write(value);
+                writer.writeBytes(outputScript(kind, key, generator));
+                if (kind != ScriptKind::Nulldata) {
+                    created.push_back({blocksci::uint256{}, value, key, static_cast<uint16_t>(i), kind});
+                }
+            }
+        }
+
+        /** Serialize a transaction into tx and return its hash. Coinbase transactions have no inputs to spend */
+        blocksci::uint256 writeTransaction(std::vector<unsigned char> &tx, blocksci::BlockHeight height, bool coinbase, int64_t &fees, SyntheticChainStats &stats) {
+            std::vector<SyntheticUtxo> spent;
+            if (!coinbase) {
+                auto inputCount = std::min<uint32_t>(1 + extraInputs(generator), maxInouts);
+                while (spent.size() < inputCount && !utxos.empty()) {
+                    spent.push_back(takeUtxo());
+                }
+            }
+            auto outputCount = std::min<uint32_t>(1 + extraOutputs(generator), maxInouts);
+
+            std::vector<std::vector<std::vector<unsigned char>>> witnesses;
+            bool hasWitness = false;
+            std::vector<unsigned char> body;
+            ByteWriter bodyWriter(body);
+            int64_t inputValue = 0;
+            if (coinbase) {
+                bodyWriter.writeCompactSize(1);
+                blocksci::uint256 nullHash;
+                bodyWriter.write(nullHash.begin(), nullHash.size());
+                bodyWriter.write(uint32_t{0xffffffff});
+                std::vector<unsigned char> coinbaseScript;
+                int32_t heightValue = height;
+                pushData(coinbaseScript, reinterpret_cast<const unsigned char *>(&heightValue), sizeof(heightValue));
+                coinbaseScript.push_back(0x00);
+                bodyWriter.writeBytes(coinbaseScript);
+                bodyWriter.write(uint32_t{0xffffffff});
+                inputValue = blockSubsidy + fees;
+                witnesses.emplace_back();
+            } else {
+                bodyWriter.writeCompactSize(spent.size());
+                for (auto &utxo : spent) {
+                    bodyWriter.write(utxo.txHash.begin(), utxo.txHash.size());
+                    bodyWriter.write(uint32_t{utxo.outputNum});
+                    spendingData(utxo, generator, scriptSig, witness);
+                    bodyWriter.writeBytes(scriptSig);
+                    bodyWriter.write(uint32_t{0xfffffffe});
+                    hasWitness |= !witness.empty();
+                    witnesses.push_back(witness);
+                    inputValue += utxo.value;
+                }
+            }
+            auto fee = coinbase ? 0 : std::min(txFee, inputValue / 10);
+            std::vector<SyntheticUtxo> created;
+            writeOutputs(bodyWriter, outputCount, inputValue - fee, created);
+
+            // Serialization with witness data (BIP 144), the hash covers everything but the marker, flag and witnesses
+            tx.clear();
+            ByteWriter txWriter(tx);
+            txWriter.write(int32_t{2});
+            if (hasWitness) {
+                txWriter.write(uint8_t{0x00});
+                txWriter.write(uint8_t{0x01});
+            }
+            auto bodyOffset = tx.size();
+            txWriter.write(body.data(), body.size());
+            if (hasWitness) {
+                for (auto &stack : witnesses) {
+                    txWriter.writeCompactSize(stack.size());
+                    for (auto &item : stack) {
+                        txWriter.writeBytes(item);
+                    }
+                }
+            }
+            auto locktimeOffset = tx.size();
+            txWriter.write(uint32_t{0});
+
+            HashInput hashInput{{tx.data(), tx.data() + bodyOffset, tx.data() + locktimeOffset}, {4, body.size(), 4}};
+            blocksci::uint256 txHash;
+            doubleSha256Batch(&hashInput, 1, &txHash);
+
+            for (auto &utxo : created) {
+                utxo.txHash = txHash;
+                utxos.push_back(utxo);
+            }
+            if (coinbase) {
+                fees = 0;
+            } else {
+                fees += fee;
+            }
+            stats.txes++;
+            stats.inputs += spent.size();
+            stats.outputs += outputCount;
+            return txHash;
+        }
+
+    public:
+        explicit ChainSynthesizer(const SyntheticChainOptions &options_) : options(options_), generator(options_.seed), scriptMix(parseScriptMix(options_.scriptMix)), scriptDistribution(makeScriptDistribution()), extraInputs(countDistribution(options_.meanInputs)), extraOutputs(countDistribution(options_.meanOutputs)) {}
+
+        SyntheticChainStats run(const filesystem::path &coinDirectory, uint32_t blockMagic) {
+            auto blocksDirectory = coinDirectory/"blocks";
+            for (auto &directory : {coinDirectory, blocksDirectory}) {
+                if (!directory.exists()) {
+                    filesystem::create_directory(directory);
+                }
+            }
+
+            SyntheticChainStats stats;
+            std::ofstream blockFile;
+            uint64_t blockFileSize = 0;
+            blocksci::uint256 prevBlockHash;
+            std::vector<unsigned char> block;
+            std::vector<unsigned char> tx;
+            std::vector<blocksci::uint256> txHashes;
+            std::vector<std::vector<unsigned char>> txes;
+            std::cout.setf(std::ios::fixed, std::ios::floatfield);
+            std::cout.precision(1);
+            auto percentageMarker = std::max<uint64_t>(1, options.txCount / 1000);
+            blocksci::BlockHeight height = 0;
+            while (stats.txes < options.txCount) {
+                // Fees are only known after the other transactions, so the coinbase is written last and moved to the front
+                txHashes.clear();
+                txes.clear();
+                int64_t fees = 0;
+                auto blockTxes = std::min<uint64_t>(options.txesPerBlock, options.txCount - stats.txes);
+                for (uint64_t i = 1; i < blockTxes && !utxos.empty(); i++) {
+                    txHashes.push_back(writeTransaction(tx, height, false, fees, stats));
+                    txes.push_back(tx);
+                }
+                txHashes.insert(txHashes.begin(), writeTransaction(tx, height, true, fees, stats));
+                txes.insert(txes.begin(), tx);
+
+                block.clear();
+                ByteWriter blockWriter(block);
+                blockWriter.write(int32_t{0x20000000});
+                blockWriter.write(prevBlockHash.begin(), prevBlockHash.size());
+                auto root = merkleRoot(txHashes);
+                blockWriter.write(root.begin(), root.size());
+                blockWriter.write(firstBlockTime + static_cast<uint32_t>(height) * 600);
+                blockWriter.write(uint32_t{0x207fffff});
+                blockWriter.write(uint32_t{0});
+                prevBlockHash = doubleSha256(reinterpret_cast<const char *>(block.data()), 80);
+                blockWriter.writeCompactSize(txes.size());
+                for (auto &blockTx : txes) {
+                    blockWriter.write(blockTx.data(), blockTx.size());
+                }
+
+                if (!blockFile.is_open() || blockFileSize + 8 + block.size() > options.maxBlockFileSize) {
+                    std::stringstream fileName;
+                    fileName << "blk" << std::setfill('0') << std::setw(5) << stats.blockFiles << ".dat";
+                    blockFile.close();
+                    blockFile.open((blocksDirectory/fileName.str()).str(), std::ios::binary | std::ios::trunc);
+                    if (!blockFile) {
+                        throw std::runtime_error("Could not create block file " + (blocksDirectory/fileName.str()).str());
+                    }
+                    blockFileSize = 0;
+                    stats.blockFiles++;
+                }
+                auto blockSize = static_cast<uint32_t>(block.size());
+                blockFile.write(reinterpret_cast<const char *>(&blockMagic), sizeof(blockMagic));
+                blockFile.write(reinterpret_cast<const char *>(&blockSize), sizeof(blockSize));
+                blockFile.write(reinterpret_cast<const char *>(block.data()), static_cast<std::streamsize>(block.size()));
+                if (!blockFile) {
+                    throw std::runtime_error("Could not write block " + std::to_string(height));
+                }
+                blockFileSize += 8 + block.size();
+                stats.bytes += 8 + block.size();
+                stats.blocks++;
+                ++height;
+
+                if (stats.txes / percentageMarker != (stats.txes - txes.size()) / percentageMarker) {
+                    std::cout << "\r" << static_cast<double>(stats.txes) / static_cast<double>(options.txCount) * 100 << "% done synthesizing transactions" << std::flush;
+                }
+            }
+            std::cout << std::endl;
+            return stats;
+        }
+    };
+}
+
+SyntheticChainStats synthesizeChain(const filesystem::path &coinDirectory, uint32_t blockMagic, const SyntheticChainOptions &options) {
+    if (options.txCount == 0 || options.txesPerBlock == 0) {
+        throw std::invalid_argument("The synthetic chain needs at least one transaction per block");
+    }
+    if (options.addressReuse < 0 || options.addressReuse > 1) {
+        throw std::invalid_argument("The address reuse rate must be between 0 and 1");
+    }
+    return ChainSynthesizer{options}.run(coinDirectory, blockMagic);
+}
@@ -0,0 +1,59 @@
+//
+//  chain_synthesizer.hpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef chain_synthesizer_hpp
+#define chain_synthesizer_hpp
+
+#include <wjfilesystem/path.h>
+
+#include <cstdint>
+#include <string>
+
+/** Shape of a synthetic chain, @see synthesizeChain() */
+struct SyntheticChainOptions {
+    /** Transactions in the chain, including the coinbase transactions */
+    uint64_t txCount = 1000000;
+
+    uint32_t txesPerBlock = 2000;
+
+    /** Mean number of inputs and outputs per transaction, drawn from geometric distributions starting at 1 */
+    double meanInputs = 2.0;
+    double meanOutputs = 2.5;
+
+    /** Relative weights of the output script types, eg. "pubkeyhash=50,witness_pubkeyhash=25,scripthash=12,
+     * multisig=3,pubkey=2,nulldata=8". Script hash outputs wrap pay to pubkey scripts, multisig outputs are 1-of-2 */
+    std::string scriptMix = "pubkeyhash=50,witness_pubkeyhash=25,scripthash=12,multisig=3,pubkey=2,nulldata=8";
+
+    /** Probability that an output pays to a key that was used before instead of a new one */
+    double addressReuse = 0.3;
+
+    /** Seed of the generator, the same options and seed always produce the same block files */
+    uint64_t seed = 1;
+
+    /** Block files are started anew once they reach this size, like the 128MB files of bitcoind */
+    uint64_t maxBlockFileSize = uint64_t{128} * 1024 * 1024;
+};
+
+struct SyntheticChainStats {
+    uint64_t blocks = 0;
+    uint64_t txes = 0;
+    uint64_t inputs = 0;
+    uint64_t outputs = 0;
+    uint64_t bytes = 0;
+    int blockFiles = 0;
+};
+
+/** Write a synthetic chain as blk*.dat files into coinDirectory/blocks, in the format of bitcoind's block files
+ *
+ * Meant to benchmark the parser repeatably at any scale without a node. Transactions spend random unspent outputs
+ * of earlier transactions, including ones in the same block, and serialize their inputs, witnesses and outputs like
+ * the real scripts do, so that every stage of the parser, the address deduplication and the indexes see a realistic
+ * load. Keys, signatures and proof of work are made up, the parser doesn't verify them.
+ */
+SyntheticChainStats synthesizeChain(const filesystem::path &coinDirectory, uint32_t blockMagic, const SyntheticChainOptions &options);
+
+#endif /* chain_synthesizer_hpp */
@@ -6,11 +6,26 @@
 //
 
 #include "doctor.hpp"
+#include "address_state.hpp"
+#include "basic_types.hpp"
 #include "chain_index.hpp"
+#include "utxo.hpp"
 
+#include <blocksci/core/inout.hpp>
+#include <blocksci/core/inout_pointer.hpp>
+#include <blocksci/core/raw_transaction.hpp>
+
+#include <sys/statfs.h>
 #include <sys/statvfs.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
 #include <iostream>
+#include <thread>
+#include <utility>
 
 void printInfo(std::string str) {
     std::cout << str << std::endl;
@@ -34,6 +49,73 @@ void printOk(std::string str) {
     std::cout << output.str();
 }
 
+namespace {
+    /* Rules of thumb for the estimates of planResources(), taken from parses of the Bitcoin main chain */
+
+    /** Share of the outputs that pay to an address which wasn't seen before */
+    constexpr double newAddressShare = 0.5;
+
+    /** Share of the addresses that are used more than once and end up in the multi use maps */
+    constexpr double multiUseShare = 0.1;
+
+    /** dense_hash_map keeps its tables between a quarter and half full and holds the old table while it grows */
+    constexpr double hashMapOverhead = 3.0;
+
+    /** Bytes of the spend data of an output kept by UTXOAddressState, averaged over all outputs */
+    constexpr double spendDataBytes = 40;
+
+    /** Bytes of an address in the script files, averaged over the types */
+    constexpr double scriptBytes = 40;
+
+    /** RocksDB keeps some space for the write ahead log and compactions */
+    constexpr double indexOverhead = 1.3;
+
+    /** Transactions processed per second and core by the pipeline, which doesn't scale beyond about 16 cores */
+    constexpr double txesPerCoreSecond = 2500;
+
+    /** Reads from block files on network storage are much slower than the pipeline */
+    constexpr double networkReadBytesPerSecond = 100e6;
+
+    double gigabytes(double bytes) {
+        return bytes / (1024.0 * 1024.0 * 1024.0);
+    }
+
+    std::string formatSize(double bytes) {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(1) << gigabytes(bytes) << "GB";
+        return ss.str();
+    }
+
+    std::string formatDuration(double seconds) {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(1);
+        if (seconds < 3600) {
+            ss << seconds / 60 << " minutes";
+        } else {
+            ss << seconds / 3600 << " hours";
+        }
+        return ss.str();
+    }
+
+    /** Whether path is on NFS, SMB or a FUSE file system, where mapping the block files is slow */
+    bool isNetworkFileSystem(const filesystem::path &path) {
+        struct statfs stats;
+        if (statfs(path.str().c_str(), &stats) != 0) {
+            return false;
+        }
+        switch (static_cast<unsigned long>(stats.f_type)) {
+            case 0x6969: // NFS
+            case 0xFF534D42: // CIFS
+            case 0xFE534D42: // SMB2
+            case 0x517B: // SMB
+            case 0x65735546: // FUSE
+                return true;
+            default:
+                return false;
+        }
+    }
+}
+
 
 BlockSciDoctor::BlockSciDoctor(filesystem::path _configFilePath) : configFilePath(_configFilePath), config(blocksci::loadBlockchainConfig(_configFilePath.str(), true, 0)), jsonConf(blocksci::loadConfig(configFilePath.str())) {
     blocksci::checkVersion(jsonConf);
@@ -107,12 +189,35 @@ void BlockSciDoctor::rebuildChainIndex() {
     blocksci::DataConfiguration dataConfig{configFilePath.str(), chainConfig, true, 0};
     ParserConfiguration<FileTag> config{dataConfig, diskConfig};
 
-    ChainIndex<FileTag> index = ChainIndex<FileTag>{};
+    // The index is built in a temporary directory so that the one of the parser is left untouched
+    char directoryTemplate[] = "/tmp/blocksci_doctor_XXXXXX";
+    if (!mkdtemp(directoryTemplate)) {
+        printError("Could not create a temporary directory for the chain index.");
+        errors += 1;
+        return;
+    }
+    filesystem::path indexDirectory{directoryTemplate};
 
     printInfo("Constructing chain index from scratch. This may take a few minutes.");
 
-    index.update(config, maxBlock);
-    auto blocks = index.generateChain(maxBlock);
+    std::vector<BlockInfo<FileTag>> blocks;
+    {
+        ChainIndex<FileTag> index{indexDirectory};
+        index.update(config, maxBlock);
+        blocks = index.generateChain(maxBlock);
+    }
+    for (auto name : {"blocks.dat", "chain.dat", "orphans.dat"}) {
+        (indexDirectory/name).remove_file();
+    }
+    indexDirectory.remove_file();
+    chainStats = ChainStats{};
+    for (auto &block : blocks) {
+        chainStats.blockCount++;
+        chainStats.txCount += block.nTx;
+        chainStats.inputCount += block.inputCount;
+        chainStats.outputCount += block.outputCount;
+        chainStats.blockBytes += block.size;
+    }
     if(blocks.size() > 0) {
         auto lastBlock = blocks.back();
 
@@ -166,6 +271,147 @@ void BlockSciDoctor::checkOpenFilesLimit() {
     }
 }
 
+void BlockSciDoctor::planResources() {
+    if (chainStats.blockCount == 0) {
+        printInfo("No blocks were found in the block files. Skipping resource estimates.");
+        return;
+    }
+    printInfo("Estimating resources needed to parse the chain from scratch.");
+
+    auto parserConf = jsonConf.at("parser");
+    size_t maxUTXOsInMemory = 0;
+    auto maxUTXOsIt = parserConf.find("maxUTXOsInMemory");
+    if (maxUTXOsIt != parserConf.end()) {
+        maxUTXOsIt->get_to(maxUTXOsInMemory);
+    }
+    size_t maxPendingIndexRows = 2'000'000;
+    auto maxPendingIndexRowsIt = parserConf.find("maxPendingIndexRows");
+    if (maxPendingIndexRowsIt != parserConf.end()) {
+        maxPendingIndexRowsIt->get_to(maxPendingIndexRows);
+    }
+
+    auto txCount = static_cast<double>(chainStats.txCount);
+    auto inputCount = static_cast<double>(chainStats.inputCount);
+    auto outputCount = static_cast<double>(chainStats.outputCount);
+    // Every block has one coinbase input which doesn't spend an output
+    auto utxoCount = std::max(0.0, outputCount - (inputCount - static_cast<double>(chainStats.blockCount)));
+    auto addressCount = outputCount * newAddressShare;
+
+    // Memory of the parser's structures at the tip of the chain, which is when they are largest
+    // Counts every UTXO as the only unspent output of its transaction, which is the most expensive case of PackedUTXOMap
+    auto utxoEntryBytes = static_cast<double>(sizeof(blocksci::uint256) + 2 * sizeof(uint64_t)) * hashMapOverhead;
+    auto utxosInMemory = maxUTXOsInMemory > 0 ? std::min(utxoCount, static_cast<double>(maxUTXOsInMemory)) : utxoCount;
+    auto utxoStateBytes = utxosInMemory * utxoEntryBytes;
+    auto coldUTXOBytes = static_cast<double>(sizeof(std::pair<RawOutputPointer, UTXO>));
+    auto utxoScriptStateBytes = utxoCount * static_cast<double>(sizeof(std::pair<blocksci::InoutPointer, uint32_t>)) * hashMapOverhead;
+    auto utxoAddressStateBytes = utxoCount * (static_cast<double>(sizeof(blocksci::InoutPointer)) + spendDataBytes) * hashMapOverhead;
+    auto addressMapBytes = addressCount * multiUseShare * static_cast<double>(sizeof(std::pair<blocksci::uint160, uint32_t>)) * hashMapOverhead;
+    // The filters start out with room for the starting counts of AddressState and use its false positive rate of 5%
+    double bloomItems = startingCount<blocksci::DedupAddressType::PUBKEY> + startingCount<blocksci::DedupAddressType::SCRIPTHASH> + startingCount<blocksci::DedupAddressType::MULTISIG> + startingCount<blocksci::DedupAddressType::WITNESS_TAPROOT>;
+    bloomItems = std::max(bloomItems, addressCount);
+    auto bloomBytes = bloomItems * -std::log(0.05) / (std::log(2.0) * std::log(2.0)) / 8;
+    // Double buffered caches of the hash index, with a hash and a number per row
+    auto indexCacheBytes = 2 * static_cast<double>(maxPendingIndexRows) * static_cast<double>(sizeof(std::pair<blocksci::uint256, uint32_t>)) * hashMapOverhead;
+    auto peakMemory = utxoStateBytes + utxoScriptStateBytes + utxoAddressStateBytes + addressMapBytes + bloomBytes + indexCacheBytes;
+
+    std::cout << "Chain of " << chainStats.blockCount << " blocks with " << chainStats.txCount << " transactions, " << chainStats.inputCount << " inputs and " << chainStats.outputCount << " outputs (" << formatSize(static_cast<double>(chainStats.blockBytes)) << " of blocks)" << std::endl;
+    std::cout << "Estimated peak memory:" << std::endl;
+    std::cout << "    UTXOState:          " << formatSize(utxoStateBytes);
+    if (maxUTXOsInMemory > 0 && utxosInMemory < utxoCount) {
+        std::cout << " (the other " << static_cast<uint64_t>(utxoCount - utxosInMemory) << " UTXOs are spilled to disk)";
+    }
+    std::cout << std::endl;
+    std::cout << "    UTXOScriptState:    " << formatSize(utxoScriptStateBytes) << std::endl;
+    std::cout << "    UTXOAddressState:   " << formatSize(utxoAddressStateBytes) << std::endl;
+    std::cout << "    Multi use maps:     " << formatSize(addressMapBytes) << std::endl;
+    std::cout << "    Bloom filters:      " << formatSize(bloomBytes) << std::endl;
+    std::cout << "    Hash index caches:  " << formatSize(indexCacheBytes) << std::endl;
+    std::cout << "    Total:              " << formatSize(peakMemory) << std::endl;
+
+    // Disk usage of the output directories
+    auto chainBytes = txCount * (sizeof(blocksci::RawTransaction) + sizeof(blocksci::uint256) + 2 * sizeof(uint64_t) + sizeof(int32_t) + sizeof(uint64_t)) + (inputCount + outputCount) * sizeof(blocksci::Inout) + inputCount * (sizeof(uint16_t) + sizeof(uint32_t));
+    auto scriptsBytes = addressCount * scriptBytes;
+    auto hashIndexBytes = (txCount * (sizeof(blocksci::uint256) + sizeof(uint32_t)) + addressCount * (sizeof(blocksci::uint160) + sizeof(uint32_t))) * indexOverhead;
+    auto addressIndexBytes = (inputCount + outputCount) * (sizeof(uint32_t) + sizeof(uint8_t) + sizeof(blocksci::InoutPointer) + sizeof(uint32_t)) * indexOverhead;
+    auto parserBytes = (utxoStateBytes + utxoScriptStateBytes + utxoAddressStateBytes + addressMapBytes) / hashMapOverhead + bloomBytes;
+    if (maxUTXOsInMemory > 0) {
+        parserBytes += (utxoCount - utxosInMemory) * coldUTXOBytes;
+    }
+    auto totalDisk = chainBytes + scriptsBytes + hashIndexBytes + addressIndexBytes + parserBytes;
+
+    std::cout << "Estimated disk usage:" << std::endl;
+    std::cout << "    chain/:             " << formatSize(chainBytes) << std::endl;
+    std::cout << "    scripts/:           " << formatSize(scriptsBytes) << std::endl;
+    std::cout << "    hashIndex/:         " << formatSize(hashIndexBytes) << std::endl;
+    std::cout << "    addressesDb/:       " << formatSize(addressIndexBytes) << std::endl;
+    std::cout << "    parser/:            " << formatSize(parserBytes) << std::endl;
+    std::cout << "    Total:              " << formatSize(totalDisk) << std::endl;
+
+    auto cores = std::max(1u, std::thread::hardware_concurrency());
+    auto txesPerSecond = txesPerCoreSecond * std::min(cores, 16u);
+    auto runtime = txCount / txesPerSecond;
+    bool networkBlocks = false;
+    if (parserConf.find("disk") != parserConf.end()) {
+        ChainDiskConfiguration diskConfig = parserConf.at("disk");
+        networkBlocks = isNetworkFileSystem(diskConfig.coinDirectory/"blocks");
+        if (networkBlocks) {
+            runtime = std::max(runtime, static_cast<double>(chainStats.blockBytes) / networkReadBytesPerSecond);
+        }
+    }
+    std::cout << "Estimated runtime of the core parse with " << cores << " cores: " << formatDuration(runtime) << ", the indexes take about as long again" << std::endl;
+
+    // Compare with this machine
+    auto physicalMemory = static_cast<double>(sysconf(_SC_PHYS_PAGES)) * static_cast<double>(sysconf(_SC_PAGE_SIZE));
+    auto usableMemory = physicalMemory * 0.8;
+    if (peakMemory > usableMemory) {
+        auto otherMemory = peakMemory - utxoStateBytes;
+        if (otherMemory > usableMemory) {
+            std::stringstream ss;
+            ss << "The parser needs about " << formatSize(otherMemory) << " of memory even without UTXOs in memory, but the machine only has " << formatSize(physicalMemory) << ".";
+            printError(ss.str());
+            errors += 1;
+        } else {
+            auto fittingUTXOs = static_cast<uint64_t>((usableMemory - otherMemory) / utxoEntryBytes);
+            std::stringstream ss;
+            ss << "The parser may need " << formatSize(peakMemory) << " of memory, but the machine only has " << formatSize(physicalMemory) << ". Set maxUTXOsInMemory in the parser config to at most " << fittingUTXOs << " to spill older UTXOs to disk.";
+            printWarning(ss.str());
+            warnings += 1;
+        }
+    } else {
+        std::stringstream ss;
+        ss << "Estimated peak memory of " << formatSize(peakMemory) << " fits into " << formatSize(physicalMemory) << " of memory.";
+        printOk(ss.str());
+    }
+
+    blocksci::ChainConfiguration chainConfig = jsonConf.at("chainConfig");
+    struct statvfs stats;
+    if (statvfs(chainConfig.dataDirectory.str().c_str(), &stats) == 0) {
+        auto freeDisk = static_cast<double>(stats.f_frsize) * static_cast<double>(stats.f_bavail);
+        if (totalDisk > freeDisk) {
+            std::stringstream ss;
+            ss << "The data directory needs about " << formatSize(totalDisk) << " but only " << formatSize(freeDisk) << " are free.";
+            printError(ss.str());
+            errors += 1;
+        } else {
+            std::stringstream ss;
+            ss << "Estimated disk usage of " << formatSize(totalDisk) << " fits into the " << formatSize(freeDisk) << " free.";
+            printOk(ss.str());
+        }
+    }
+
+    if (networkBlocks) {
+        printInfo("Recommendation: The block files are on network storage, set streamReadMB to 128 in the disk parser settings to read them with large sequential reads.");
+    }
+    if (cores >= 8) {
+        printInfo("Recommendation: Set partitionedScriptNums to true in the parser config to number the scripts of a full parse on several cores.");
+    } else if (cores < 4) {
+        std::stringstream ss;
+        ss << "Only " << cores << " cores are available, the parsing pipeline runs best with at least 4.";
+        printWarning(ss.str());
+        warnings += 1;
+    }
+}
+
 void BlockSciDoctor::printResults() {
     if(warnings + errors > 0) {
         std::cout << "Found " << warnings << " warnings and " << errors << " errors." << std::endl;
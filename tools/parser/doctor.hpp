@@ -12,6 +12,8 @@
 
 #include <sys/resource.h>
 
+#include <cstdint>
+
 #include <wjfilesystem/path.h>
 #include <nlohmann/json.hpp>
 
@@ -29,6 +31,17 @@ private:
     const ParserConfigurationBase config;
     nlohmann::json jsonConf;
 
+    /** Totals over the blocks found by rebuildChainIndex(), which planResources() bases its estimates on */
+    struct ChainStats {
+        uint64_t blockCount = 0;
+        uint64_t txCount = 0;
+        uint64_t inputCount = 0;
+        uint64_t outputCount = 0;
+        uint64_t blockBytes = 0;
+    };
+
+    ChainStats chainStats;
+
 public:
 
     BlockSciDoctor(filesystem::path _configFilePath);
@@ -45,6 +58,10 @@ public:
     /** Checks if the process can open at least MIN_OPEN_FILES file descriptors */
     void checkOpenFilesLimit();
 
+    /** Estimates the peak memory of the parser's maps, the disk usage of the data directory and the runtime of a full
+     * parse from the chain found by rebuildChainIndex(), and recommends settings for this machine */
+    void planResources();
+
     /** Prints the results of running the checks */
     void printResults();
 
@@ -0,0 +1,121 @@
+//
+//  equiv_class_writer.cpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include "equiv_class_writer.hpp"
+#include "parser_configuration.hpp"
+
+#include <blocksci/core/dedup_address.hpp>
+
+#include <internal/address_info.hpp>
+#include <internal/file_mapper.hpp>
+#include <internal/script_access.hpp>
+#include <internal/segment_work.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace {
+    using blocksci::DedupAddress;
+    using blocksci::DedupAddressType;
+    
+    /** Script at the bottom of the chain of scripthashes starting at the given scripthash
+     *
+     * The wrapped address of a scripthash is only known once it was spent, an unspent scripthash is its own root. */
+    DedupAddress nestingRoot(uint32_t scriptHashNum, const blocksci::ScriptAccess &scripts) {
+        DedupAddress address{scriptHashNum, DedupAddressType::SCRIPTHASH};
+        while (address.type == DedupAddressType::SCRIPTHASH) {
+            auto wrapped = scripts.getScriptData<DedupAddressType::SCRIPTHASH>(address.scriptNum)->wrappedAddress;
+            if (wrapped.scriptNum == 0) {
+                break;
+            }
+            address = DedupAddress{wrapped.scriptNum, blocksci::dedupType(wrapped.type)};
+        }
+        return address;
+    }
+}
+
+bool equivClassesExist(const ParserConfigurationBase &config) {
+    return filesystem::path{blocksci::ScriptAccess::equivClassOffsetsFilePath(config.dataConfig.scriptsDirectory()).str() + ".dat"}.exists();
+}
+
+void updateEquivClasses(const ParserConfigurationBase &config) {
+    auto scriptsDirectory = config.dataConfig.scriptsDirectory();
+    blocksci::ScriptAccess scripts{scriptsDirectory};
+    auto scriptCounts = scripts.scriptCounts();
+    
+    std::vector<std::unique_ptr<blocksci::FixedSizeFileMapper<uint32_t, mio::access_mode::write>>> classFiles;
+    for (size_t i = 0; i < DedupAddressType::size; i++) {
+        classFiles.push_back(std::make_unique<blocksci::FixedSizeFileMapper<uint32_t, mio::access_mode::write>>(blocksci::ScriptAccess::equivClassFilePath(scriptsDirectory, static_cast<DedupAddressType::Enum>(i))));
+        classFiles.back()->truncate(0);
+    }
+    
+    std::cout << "Updating equivalence classes\n";
+    
+    // With every scripthash wrapping at most one script the nesting relations form trees, so the class of a script is
+    // the root of its tree together with all scripthashes whose chain ends there
+    auto scriptHashCount = scriptCounts[static_cast<size_t>(DedupAddressType::SCRIPTHASH)];
+    std::vector<DedupAddress> roots(scriptHashCount);
+    blocksci::segmentWork(0, scriptHashCount, blocksci::resolveThreadCount(0), [&](uint32_t i) {
+        roots[i] = nestingRoot(i + 1, scripts);
+    });
+    
+    std::vector<std::pair<DedupAddress, uint32_t>> nested;
+    for (uint32_t i = 0; i < scriptHashCount; i++) {
+        if (roots[i] != DedupAddress{i + 1, DedupAddressType::SCRIPTHASH}) {
+            nested.emplace_back(roots[i], i + 1);
+        }
+    }
+    roots.clear();
+    roots.shrink_to_fit();
+    std::sort(nested.begin(), nested.end(), [](const auto &a, const auto &b) {
+        return std::make_tuple(a.first.type, a.first.scriptNum, a.second) < std::make_tuple(b.first.type, b.first.scriptNum, b.second);
+    });
+    
+    std::vector<std::vector<uint32_t>> classIds(DedupAddressType::size);
+    for (size_t i = 0; i < DedupAddressType::size; i++) {
+        classIds[i].resize(scriptCounts[i], 0);
+    }
+    blocksci::FixedSizeFileMapper<uint64_t, mio::access_mode::write> offsetsFile{blocksci::ScriptAccess::equivClassOffsetsFilePath(scriptsDirectory)};
+    blocksci::FixedSizeFileMapper<DedupAddress, mio::access_mode::write> membersFile{blocksci::ScriptAccess::equivClassMembersFilePath(scriptsDirectory)};
+    offsetsFile.truncate(0);
+    membersFile.truncate(0);
+    offsetsFile.seekEnd();
+    membersFile.seekEnd();
+    
+    uint64_t memberCount = 0;
+    uint32_t classCount = 0;
+    offsetsFile.write(memberCount);
+    size_t i = 0;
+    while (i < nested.size()) {
+        auto root = nested[i].first;
+        classCount++;
+        classIds[static_cast<size_t>(root.type)][root.scriptNum - 1] = classCount;
+        membersFile.write(root);
+        memberCount++;
+        for (; i < nested.size() && nested[i].first == root; i++) {
+            classIds[static_cast<size_t>(DedupAddressType::SCRIPTHASH)][nested[i].second - 1] = classCount;
+            membersFile.write(DedupAddress{nested[i].second, DedupAddressType::SCRIPTHASH});
+            memberCount++;
+        }
+        offsetsFile.write(memberCount);
+    }
+    offsetsFile.clearBuffer();
+    membersFile.clearBuffer();
+    
+    for (size_t type = 0; type < DedupAddressType::size; type++) {
+        auto &classFile = *classFiles[type];
+        classFile.seekEnd();
+        for (auto classId : classIds[type]) {
+            classFile.write(classId);
+        }
+        classFile.clearBuffer();
+    }
+}
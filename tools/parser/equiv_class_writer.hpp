@@ -0,0 +1,24 @@
+//
+//  equiv_class_writer.hpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef equiv_class_writer_hpp
+#define equiv_class_writer_hpp
+
+#include "parser_fwd.hpp"
+
+/** Check whether the optional equivalence class columns (scripts/equiv_class_*.dat) have been created */
+bool equivClassesExist(const ParserConfigurationBase &config);
+
+/** Write the equivalence class columns of all scripts, @see blocksci::ScriptAccess::getEquivClass
+ *
+ * Revealing a scripthash can join two classes, so they are recomputed from the wrapped addresses of all scripthash
+ * scripts on every update. The class id columns are cleared first, so readers fall back to the address index while
+ * the classes are rewritten.
+ */
+void updateEquivClasses(const ParserConfigurationBase &config);
+
+#endif /* equiv_class_writer_hpp */
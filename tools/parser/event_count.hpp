@@ -0,0 +1,84 @@
+//
+//  event_count.hpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef event_count_hpp
+#define event_count_hpp
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+/** Wakes up a thread waiting for any of the events it is interested in (eg. data or space in a queue)
+ *
+ * A waiter takes a key with prepareWait(), rechecks its condition and then calls wait(key), which returns as soon as
+ * notify() was called after the key was taken. wait() spins briefly, then yields and finally parks on a condition
+ * variable. notify() is a single atomic increment unless a thread is parked, so notifying after every batch of queue
+ * operations is cheap.
+ */
+class EventCount {
+    std::atomic<uint64_t> epoch{0};
+    std::atomic<uint32_t> waiters{0};
+    std::mutex mutex;
+    std::condition_variable parked;
+
+    static constexpr int spinIterations = 128;
+    static constexpr int yieldIterations = 16;
+
+    /** Upper bound on a single park so that a missed notification can never stall the pipeline */
+    static std::chrono::milliseconds maxPark() {
+        return std::chrono::milliseconds{50};
+    }
+
+    static void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+public:
+    uint64_t prepareWait() const {
+        return epoch.load(std::memory_order_seq_cst);
+    }
+
+    void wait(uint64_t key) {
+        for (int i = 0; i < spinIterations; i++) {
+            if (epoch.load(std::memory_order_acquire) != key) {
+                return;
+            }
+            cpuRelax();
+        }
+        for (int i = 0; i < yieldIterations; i++) {
+            if (epoch.load(std::memory_order_acquire) != key) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            parked.wait_for(lock, maxPark(), [&]() {
+                return epoch.load(std::memory_order_seq_cst) != key;
+            });
+        }
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void notify() {
+        epoch.fetch_add(1, std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_seq_cst) > 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            parked.notify_all();
+        }
+    }
+};
+
+#endif /* event_count_hpp */
@@ -9,7 +9,11 @@
 #ifndef file_writer_hpp
 #define file_writer_hpp
 
+#include <internal/file_checksums.hpp>
+#include <internal/layered_file.hpp>
+
 #include <fstream>
+#include <stdexcept>
 
 #include <wjfilesystem/path.h>
 
@@ -17,6 +21,27 @@ struct SimpleFileWriter {
 protected:
     uint64_t lastDataPos;
     std::fstream file;
+    filesystem::path dataPath;
+    
+    /** Chunks written to, whose checksums are taken again once the file is closed */
+    blocksci::DirtyChunks dirtyChunks;
+    
+    /** Offset of the opened file within the data file. For a file layered over a shared base (@see LayerManifest)
+     * only its tail is written to, which starts at the end of the shared part */
+    uint64_t fileStart = 0;
+    
+    void markWritten(uint64_t offset, uint64_t length) {
+        if (fileStart == 0) {
+            dirtyChunks.mark(static_cast<int64_t>(offset), static_cast<int64_t>(length));
+        }
+    }
+    
+    std::streamoff filePosition(uint64_t offset) const {
+        if (offset < fileStart) {
+            throw std::runtime_error("Can't write to the part of " + dataPath.str() + " shared with its base");
+        }
+        return static_cast<std::streamoff>(offset - fileStart);
+    }
 public:
     
     uint64_t getLastPos() const { return lastDataPos; }
@@ -25,6 +50,11 @@ public:
         auto mainParams = std::fstream::out | std::fstream::binary;
         auto extraParams = std::fstream::ate | std::fstream::in;
         path = filesystem::path{path.str() + ".dat"};
+        dataPath = path;
+        if (blocksci::LayerManifest::isLayered(dataPath)) {
+            fileStart = blocksci::LayerManifest::load(dataPath).sharedLength;
+            path = blocksci::LayerManifest::tailPath(dataPath);
+        }
         
         file.open(path.str(), mainParams | extraParams);
         if (!file.is_open())
@@ -39,33 +69,54 @@ public:
             // re-open
             file.open(path.str(), mainParams | extraParams);
         }
-        lastDataPos = static_cast<size_t>(file.tellp());
+        lastDataPos = fileStart + static_cast<size_t>(file.tellp());
+    }
+    
+    SimpleFileWriter(SimpleFileWriter &&) = default;
+    SimpleFileWriter &operator=(SimpleFileWriter &&) = default;
+    
+    ~SimpleFileWriter() {
+        if (file.is_open() && !dirtyChunks.empty()) {
+            file.close();
+            dirtyChunks.updateChecksums(dataPath);
+        }
     }
     
     template<typename T, typename = std::enable_if_t<std::is_trivially_copyable<T>::value>>
     void writeImp(const T &t) {
+        markWritten(lastDataPos, sizeof(T));
         file.write(reinterpret_cast<const char *>(&t), sizeof(T));
         lastDataPos += sizeof(T);
     }
     
+    void writeBytes(const char *data, size_t length) {
+        markWritten(lastDataPos, length);
+        file.write(data, static_cast<std::streamsize>(length));
+        lastDataPos += length;
+    }
+    
     template <typename T>
     T read(size_t offset) {
         T ret;
-        file.seekg(static_cast<std::streamoff>(offset));
+        file.seekg(filePosition(offset));
         file.read(reinterpret_cast<char *>(&ret), sizeof(T));
-        file.seekg(static_cast<std::streamoff>(lastDataPos));
+        file.seekg(filePosition(lastDataPos));
         return ret;
     }
     
     template<typename K>
     void update(size_t offset, const K &t) {
-        file.seekp(static_cast<std::streamoff>(offset));
+        markWritten(offset, sizeof(t));
+        file.seekp(filePosition(offset));
         file.write(reinterpret_cast<const char *>(&t), sizeof(t));
-        file.seekp(static_cast<std::streamoff>(lastDataPos));
+        file.seekp(filePosition(lastDataPos));
     }
     
     void expandToFit(std::streamoff size) {
-        file.seekp(size - 1);
+        if (fileStart == 0) {
+            dirtyChunks.markResized();
+        }
+        file.seekp(filePosition(static_cast<uint64_t>(size)) - 1);
         file.write("", 1);
     }
     
@@ -157,6 +208,10 @@ public:
         dataFile.writeImp(t);
     }
     
+    void writeBytes(const char *data, size_t length) {
+        dataFile.writeBytes(data, length);
+    }
+    
     void expandToFit(size_t length, uint32_t items) {
         dataFile.expandToFit(length);
         indexFile.expandToFit(items);
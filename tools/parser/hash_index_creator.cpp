@@ -9,47 +9,91 @@
 #include "hash_index_creator.hpp"
 #include "parser_configuration.hpp"
 #include "raw_address_visitor.hpp"
+#include "undo_journal.hpp"
 
 #include <blocksci/core/raw_address.hpp>
 
-HashIndexCreator::HashIndexCreator(const ParserConfigurationBase &config_, const filesystem::path &path) : ParserIndex(config_, "hashIndex"), db(path, false) {}
+#include <internal/chain_access.hpp>
+#include <internal/tx_hash_table.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+    // Rebuilding the table rereads all tx hashes, so it is only done once the RocksDB tail has grown by a significant
+    // fraction of the chain
+    constexpr uint32_t minTxHashTableTail = 10'000'000;
+    constexpr uint32_t txHashTableTailFraction = 8;
+    
+    // Enough for the flushes of the tx hashes and the busiest address types to be written at the same time
+    constexpr uint32_t indexWriterCount = 4;
+}
+
+HashIndexCreator::HashIndexCreator(const ParserConfigurationBase &config_, const filesystem::path &path) : ParserIndex(config_, "hashIndex"), db(path, blocksci::IndexOpenMode::ReadWrite, nullptr, config_.dataConfig.hashIndexTuning), writeQueue(indexWriterCount, config_.maxPendingIndexRows) {}
 
 template <bool, blocksci::AddressType::Enum type>
-struct ClearerFunctor;
+struct FlushFunctor;
 
 template <blocksci::AddressType::Enum type>
-struct ClearerFunctor<true, type> {
-    HashIndexAddressCache<type> &cache;
-    blocksci::HashIndex &db;
-    
-    ClearerFunctor(HashIndexAddressCache<type> &cache_, blocksci::HashIndex &db_) : cache(cache_), db(db_) {}
-    
-    void operator()() {
-        std::vector<std::pair<typename blocksci::AddressInfo<type>::IDType, uint32_t>> rows;
-        rows.reserve(cache.size());
-        for (const auto &pair : cache) {
-            rows.emplace_back(pair.first.key, pair.second);
-        }
-        cache.clear();
-        db.addAddresses<type>(std::move(rows));
+struct FlushFunctor<true, type> {
+    template <typename Func>
+    void operator()(Func &&queueFlush) {
+        queueFlush(std::integral_constant<blocksci::AddressType::Enum, type>{});
     }
 };
 
 template <blocksci::AddressType::Enum type>
-struct ClearerFunctor<false, type> {
-    ClearerFunctor(HashIndexAddressCache<type> &, blocksci::HashIndex &) {}
-    void operator()() {
-        
+struct FlushFunctor<false, type> {
+    template <typename Func>
+    void operator()(Func &&) {}
+};
+
+template <bool, blocksci::AddressType::Enum type>
+struct DiscardFunctor;
+
+template <blocksci::AddressType::Enum type>
+struct DiscardFunctor<true, type> {
+    void operator()(HashIndexAddressCache<type> &cache) {
+        cache.discardFlushed();
     }
 };
 
+template <blocksci::AddressType::Enum type>
+struct DiscardFunctor<false, type> {
+    void operator()(HashIndexAddressCache<type> &) {}
+};
+
 HashIndexCreator::~HashIndexCreator() {
-    clearTxCache();
+    try {
+        clearCaches();
+    } catch (const std::exception &e) {
+        std::cerr << "Failed to write the hash index caches: " << e.what() << "\n";
+    }
+}
+
+void HashIndexCreator::clearCaches() {
+    queueTxFlush();
     // Duplicated to avoid crash in GCC 7.2
     for_each(blocksci::AddressType::all{}, [&](auto tag) {
-        ClearerFunctor<!std::is_same<typename blocksci::AddressInfo<tag.value>::IDType, void>::value, tag.value>{std::get<HashIndexAddressCache<tag.value>>(addressCache), db}();
-        
+        FlushFunctor<!std::is_same<typename blocksci::AddressInfo<tag.value>::IDType, void>::value, tag.value>{}([&](auto typeTag) {
+            queueAddressFlush<decltype(typeTag)::value>();
+        });
     });
+    writeQueue.wait();
+    txCache.discardFlushed();
+    for_each(blocksci::AddressType::all{}, [&](auto tag) {
+        DiscardFunctor<!std::is_same<typename blocksci::AddressInfo<tag.value>::IDType, void>::value, tag.value>{}(std::get<HashIndexAddressCache<tag.value>>(addressCache));
+    });
+}
+
+void HashIndexCreator::beginBulkLoad() {
+    clearCaches();
+    db.beginBulkLoad();
+}
+
+void HashIndexCreator::finishBulkLoad() {
+    clearCaches();
+    db.finishBulkLoad();
 }
 
 void HashIndexCreator::processTx(const blocksci::RawTransaction *tx, uint32_t txNum, const blocksci::ChainAccess &chain, const blocksci::ScriptAccess &scripts) {
@@ -85,25 +129,65 @@ void HashIndexCreator::processTx(const blocksci::RawTransaction *tx, uint32_t tx
 void HashIndexCreator::addTx(const blocksci::uint256 &hash, uint32_t txNum) {
     txCache.insert(hash, txNum);
     if (txCache.isFull()) {
-        clearTxCache();
+        queueTxFlush();
+    }
+}
+
+void HashIndexCreator::rollback(const blocksci::State &state, const std::vector<blocksci::uint256> &txHashes, const std::vector<UndoAddressKey> &addresses, const std::vector<blocksci::uint256> &witnessScriptHashes) {
+    // Cached entries would be written back after the removal
+    clearCaches();
+    db.removeTxes(txHashes);
+    std::vector<blocksci::MemoryView> keys;
+    for (auto type : blocksci::DedupAddressType::allArray()) {
+        keys.clear();
+        for (const auto &address : addresses) {
+            if (address.type == type) {
+                keys.push_back(blocksci::MemoryView{reinterpret_cast<const char *>(address.key.data()), address.keySize});
+            }
+        }
+        db.removeAddresses(type, keys);
     }
+    db.removeAddresses<blocksci::AddressType::WITNESS_SCRIPTHASH>(witnessScriptHashes);
+    rollbackProgress(state);
 }
 
 ranges::optional<uint32_t> HashIndexCreator::getTxIndex(const blocksci::uint256 &txHash) {
-    auto it = txCache.find(txHash);
-    if (it != txCache.end()) {
-        return it->second;
+    if (auto cached = txCache.find(txHash)) {
+        return cached;
     } else {
         return db.getTxIndex(txHash);
     }
 }
 
+void HashIndexCreator::queueTxFlush() {
+    queueFlush(txCache, [this](std::vector<std::pair<blocksci::uint256, uint32_t>> rows) {
+        db.addTxes(std::move(rows));
+    });
+}
+
 void HashIndexCreator::clearTxCache() {
-    std::vector<std::pair<blocksci::uint256, uint32_t>> rows;
-    rows.reserve(txCache.size());
-    for (const auto &pair : txCache) {
-        rows.emplace_back(pair.first.key, pair.second);
+    queueTxFlush();
+    writeQueue.waitUntil([&]() { return !txCache.isFlushing(); });
+}
+
+void HashIndexCreator::updateTxHashTable(const filesystem::path &path, const blocksci::ChainAccess &chain) {
+    auto txCount = static_cast<uint32_t>(chain.txCount());
+    uint32_t coveredCount = 0;
+    {
+        blocksci::TxHashTable existing{path};
+        coveredCount = existing.txCount();
     }
-    txCache.clear();
-    db.addTxes(std::move(rows));
+    auto tailCount = txCount - std::min(coveredCount, txCount);
+    if (tailCount < std::max(minTxHashTableTail, coveredCount / txHashTableTailFraction)) {
+        return;
+    }
+    
+    std::cout << "Moving " << txCount << " tx hashes into the tx hash table\n";
+    clearTxCache();
+    blocksci::TxHashTable::build(path, txCount, [&](uint32_t txNum) {
+        return chain.getTxHash(txNum);
+    });
+    // Every hash in the "T" column is now also in the table. If the parser stops before this, the duplicates are
+    // harmless and removed at the next rebuild.
+    db.clearTxes();
 }
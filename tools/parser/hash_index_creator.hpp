@@ -12,13 +12,21 @@
 #include "parser_fwd.hpp"
 #include "parser_index.hpp"
 #include "serializable_map.hpp"
+#include "write_behind_queue.hpp"
 
 #include <blocksci/core/address_type_meta.hpp>
 
 #include <internal/address_info.hpp>
 #include <internal/hash_index.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <memory>
 #include <tuple>
+#include <vector>
 
 namespace blocksci {
     class uint256;
@@ -54,20 +62,24 @@ namespace std {
     };
 } // namespace std
 
+template <typename T>
+struct ParserKeyHash<DenseHashMapWrappedKey<T>> {
+    size_t operator()(const DenseHashMapWrappedKey<T> &item) const {
+        return ParserKeyHash<T>{}(item.key) ^ key_hash::mixWord(item.extra);
+    }
+};
+
+/** Rows added to the hash index since they were last written to RocksDB
+ *
+ * Once the cache is full, beginFlush() moves its rows to a second map that stays readable while they are written in
+ * the background and the first map starts over. find() checks both maps, so a row can be found during its flush.
+ */
 template <typename Key>
 struct DenseHashMapCache {
     using Cache = SerializableMap<DenseHashMapWrappedKey<Key>, uint32_t>;
     static constexpr int cacheSize = 20000;
-    size_t cacheItems = 0;
     
-    DenseHashMapCache() : cache({Key{}, 1}, {Key{}, 2}) {
-        cache.resize(cacheSize);
-    }
-    
-    void clear() {
-        cache.clear_no_resize();
-        cacheItems = 0;
-    }
+    DenseHashMapCache() : cache(makeCache()), flushingCache(makeCache()) {}
     
     size_t size() const {
         return cacheItems;
@@ -78,50 +90,87 @@ struct DenseHashMapCache {
     }
     
     void insert(const Key &id, uint32_t num) {
-        cache.add(DenseHashMapWrappedKey<Key>{id, 0}, num);
+        cache->add(DenseHashMapWrappedKey<Key>{id, 0}, num);
         cacheItems++;
     }
     
-    typename Cache::const_iterator find(const Key &id) const {
-        return cache.find({id, 0});
+    ranges::optional<uint32_t> find(const Key &id) const {
+        auto it = cache->find({id, 0});
+        if (it != cache->end()) {
+            return it->second;
+        }
+        auto flushingIt = flushingCache->find({id, 0});
+        if (flushingIt != flushingCache->end()) {
+            return flushingIt->second;
+        }
+        return ranges::nullopt;
     }
     
-    typename Cache::const_iterator end() const {
-        return cache.end();
+    /** Whether the rows of the last beginFlush() are still being written */
+    bool isFlushing() const {
+        return flushing.load(std::memory_order_acquire);
     }
     
-    auto begin() {
-        return cache.begin();
+    /** Move the cached rows to the flushing map, the previous flush must have finished */
+    void beginFlush() {
+        assert(!isFlushing());
+        std::swap(cache, flushingCache);
+        cache->clear_no_resize();
+        flushingItems = cacheItems;
+        cacheItems = 0;
+        flushing.store(true, std::memory_order_release);
     }
     
-    auto end() {
-        return cache.end();
+    size_t flushingSize() const {
+        return flushingItems;
     }
     
-private:
-    Cache cache;
-};
-
-template <blocksci::AddressType::Enum type>
-struct HashIndexAddressCacheImpl<std::true_type, type> : public DenseHashMapCache<typename blocksci::AddressInfo<type>::IDType> {};
-
-template <blocksci::AddressType::Enum type>
-struct HashIndexAddressCacheImpl<std::false_type, type> {
-    void clear() {}
+    /** Rows of the flushing map sorted by key, which is the order RocksDB stores them in. Can be called on another
+     * thread than the one using the cache, which only reads the flushing map until finishFlush() */
+    std::vector<std::pair<Key, uint32_t>> flushingRows() const {
+        std::vector<std::pair<Key, uint32_t>> rows;
+        rows.reserve(flushingItems);
+        for (const auto &pair : *flushingCache) {
+            rows.emplace_back(pair.first.key, pair.second);
+        }
+        std::sort(rows.begin(), rows.end(), [](const auto &a, const auto &b) {
+            return std::memcmp(&a.first, &b.first, sizeof(Key)) < 0;
+        });
+        return rows;
+    }
     
-    std::pair<DenseHashMapWrappedKey<int>, int> *begin() {
-        return nullptr;
+    void finishFlush() {
+        flushing.store(false, std::memory_order_release);
     }
     
-    std::pair<DenseHashMapWrappedKey<int>, int> *end() {
-        return nullptr;
+    /** Forget the rows of the finished flush, needed once they may have been removed from the hash index */
+    void discardFlushed() {
+        assert(!isFlushing());
+        flushingCache->clear_no_resize();
+        flushingItems = 0;
     }
     
-    size_t size() const {
-        return 0;
+private:
+    std::unique_ptr<Cache> cache;
+    std::unique_ptr<Cache> flushingCache;
+    size_t cacheItems = 0;
+    size_t flushingItems = 0;
+    std::atomic<bool> flushing{false};
+    
+    static std::unique_ptr<Cache> makeCache() {
+        auto newCache = std::make_unique<Cache>(DenseHashMapWrappedKey<Key>{Key{}, 1}, DenseHashMapWrappedKey<Key>{Key{}, 2});
+        newCache->resize(cacheSize);
+        return newCache;
     }
 };
 
+template <blocksci::AddressType::Enum type>
+struct HashIndexAddressCacheImpl<std::true_type, type> : public DenseHashMapCache<typename blocksci::AddressInfo<type>::IDType> {};
+
+/** Types without a hash key aren't stored in the hash index */
+template <blocksci::AddressType::Enum type>
+struct HashIndexAddressCacheImpl<std::false_type, type> {};
+
 template <blocksci::AddressType::Enum type>
 struct HashIndexAddressCache : public HashIndexAddressCacheImpl<std::integral_constant<bool, !std::is_same<typename blocksci::AddressInfo<type>::IDType, void>::value>, type> {};
 
@@ -131,24 +180,61 @@ class HashIndexCreator : public ParserIndex<HashIndexCreator> {
     DenseHashMapCache<blocksci::uint256> txCache;
     AddressCacheTuple addressCache;
     
+    /** Write the rows of cache in the background with write(rows) once its previous flush finished */
+    template <typename Key, typename WriteFunc>
+    void queueFlush(DenseHashMapCache<Key> &cache, WriteFunc write) {
+        if (cache.size() == 0) {
+            return;
+        }
+        auto waitStart = std::chrono::steady_clock::now();
+        writeQueue.waitUntil([&]() { return !cache.isFlushing(); });
+        cache.beginFlush();
+        writeQueue.submit(cache.flushingSize(), [&cache, write]() {
+            write(cache.flushingRows());
+            cache.finishFlush();
+        });
+        flushWaitNanoseconds.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - waitStart).count()), std::memory_order_relaxed);
+    }
+    
+    template<blocksci::AddressType::Enum type>
+    void queueAddressFlush() {
+        queueFlush(std::get<HashIndexAddressCache<type>>(addressCache), [this](std::vector<std::pair<typename blocksci::AddressInfo<type>::IDType, uint32_t>> rows) {
+            auto rowCount = rows.size();
+            auto flushStart = std::chrono::steady_clock::now();
+            db.addAddresses<type>(std::move(rows));
+            flushedAddressCount.fetch_add(rowCount, std::memory_order_relaxed);
+            flushNanoseconds.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - flushStart).count()), std::memory_order_relaxed);
+        });
+    }
+    
+    void queueTxFlush();
+    
+    /** Write the tx cache to the hash index and wait for it */
     void clearTxCache();
     
+    /** Write all caches to the hash index and wait for them, afterwards the caches only hold rows that were added since */
+    void clearCaches();
+    
 public:
     
+    /** Write the cached addresses of the type to the hash index and wait for it */
     template<blocksci::AddressType::Enum type>
     void clearAddressCache() {
         auto &cache = std::get<HashIndexAddressCache<type>>(addressCache);
-        std::vector<std::pair<typename blocksci::AddressInfo<type>::IDType, uint32_t>> rows;
-        rows.reserve(cache.size());
-        for (const auto &pair : cache) {
-            rows.emplace_back(pair.first.key, pair.second);
-        }
-        cache.clear();
-        db.addAddresses<type>(std::move(rows));
+        queueAddressFlush<type>();
+        writeQueue.waitUntil([&]() { return !cache.isFlushing(); });
     }
     
     blocksci::HashIndex db;
     
+    /** Addresses written to the hash index by flushing the caches and the time spent writing them, read by the
+     * parser telemetry */
+    std::atomic<uint64_t> flushedAddressCount{0};
+    std::atomic<uint64_t> flushNanoseconds{0};
+    
+    /** Time the parser waited for earlier flushes before it could start a new one */
+    std::atomic<uint64_t> flushWaitNanoseconds{0};
+    
     HashIndexCreator(const ParserConfigurationBase &config, const filesystem::path &path);
     ~HashIndexCreator();
     
@@ -160,31 +246,77 @@ public:
     
     void addTx(const blocksci::uint256 &hash, uint32_t txID);
     
+    /** Remove the hashes of the undone transactions and the keys of the undone scripts after the chain was rolled
+     * back to state. witnessScriptHashes are the sha256 keys of the removed segwit script hashes. */
+    void rollback(const blocksci::State &state, const std::vector<blocksci::uint256> &txHashes, const std::vector<UndoAddressKey> &addresses, const std::vector<blocksci::uint256> &witnessScriptHashes);
+    
+    /** Only finds transactions that were added since the last rebuild of the TxHashTable */
     ranges::optional<uint32_t> getTxIndex(const blocksci::uint256 &txHash);
     
+    /** Move the tx hashes of the whole chain into the TxHashTable at path once enough transactions were added since
+     * it was last built, leaving the "T" column family of the RocksDB index empty */
+    void updateTxHashTable(const filesystem::path &path, const blocksci::ChainAccess &chain);
+    
     template<blocksci::AddressType::Enum type>
     void addAddress(const typename blocksci::AddressInfo<type>::IDType &hash, uint32_t scriptNum) {
         auto &cache = std::get<HashIndexAddressCache<type>>(addressCache);
         cache.insert(hash, scriptNum);
         if (cache.isFull()) {
-            clearAddressCache<type>();
+            queueAddressFlush<type>();
         }
     }
     
     template<blocksci::AddressType::Enum type>
     ranges::optional<uint32_t> lookupAddress(const typename blocksci::AddressInfo<type>::IDType &hash) {
         auto &cache = std::get<HashIndexAddressCache<type>>(addressCache);
-        auto it = cache.find(hash);
-        if (it != cache.end()) {
-            return it->second;
+        if (auto cached = cache.find(hash)) {
+            return cached;
         } else {
             return db.lookupAddress<type>(hash);
         }
     }
     
+    /** lookupAddress() for many hashes, the ones missing from the cache are read with batched MultiGet calls */
+    template<blocksci::AddressType::Enum type>
+    std::vector<ranges::optional<uint32_t>> lookupAddresses(const std::vector<typename blocksci::AddressInfo<type>::IDType> &hashes) {
+        auto &cache = std::get<HashIndexAddressCache<type>>(addressCache);
+        std::vector<ranges::optional<uint32_t>> destNums(hashes.size());
+        std::vector<typename blocksci::AddressInfo<type>::IDType> uncachedHashes;
+        std::vector<size_t> uncachedIndexes;
+        for (size_t i = 0; i < hashes.size(); i++) {
+            if (auto cached = cache.find(hashes[i])) {
+                destNums[i] = cached;
+            } else {
+                uncachedHashes.push_back(hashes[i]);
+                uncachedIndexes.push_back(i);
+            }
+        }
+        if (!uncachedHashes.empty()) {
+            auto uncachedNums = db.lookupAddresses<type>(uncachedHashes);
+            for (size_t i = 0; i < uncachedIndexes.size(); i++) {
+                destNums[uncachedIndexes[i]] = uncachedNums[i];
+            }
+        }
+        return destNums;
+    }
+    
+    /** Load everything that is processed until finishBulkLoad() through ingested table files, @see blocksci::HashIndex::beginBulkLoad() */
+    void beginBulkLoad();
+    void finishBulkLoad();
+    
     void compact() {
+        clearCaches();
         db.compactDB();
     }
+    
+    /** Rows handed to the write queue that haven't been written yet */
+    size_t queuedFlushRows() const {
+        return writeQueue.queuedRows();
+    }
+    
+private:
+    /** Declared last so that it is destroyed before the caches and the index its writes use */
+    WriteBehindQueue writeQueue;
 };
 
 #endif /* hash_index_creator_hpp */
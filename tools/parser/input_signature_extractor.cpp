@@ -0,0 +1,65 @@
+//
+//  input_signature_extractor.cpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#define BLOCKSCI_WITHOUT_SINGLETON
+
+#include "input_signature_extractor.hpp"
+#include "preproccessed_block.hpp"
+
+#include <internal/script_view.hpp>
+
+namespace {
+    const unsigned char *itemData(const WitnessStackItem &item) {
+        return reinterpret_cast<const unsigned char *>(item.itemBegin);
+    }
+    
+    void extractFromWitness(const WitnessStack &witness, blocksci::InputSignature &signature) {
+        signature.flags |= blocksci::InputSignature::Witness;
+        if (witness.size() == 1 && (witness[0].length == 64 || witness[0].length == 65)) {
+            // Taproot key path spends only reveal the signature, the key is the output itself
+            parseInputSignature(itemData(witness[0]), witness[0].length, signature);
+            return;
+        }
+        for (auto &item : witness) {
+            if (!signature.has(blocksci::InputSignature::HasSignature)) {
+                if (parseInputSignature(itemData(item), item.length, signature)) {
+                    continue;
+                }
+            }
+            setInputPubkey(itemData(item), item.length, signature);
+        }
+    }
+    
+    void extractFromScript(const blocksci::CScriptView &scriptView, blocksci::InputSignature &signature) {
+        auto pc = scriptView.begin();
+        blocksci::opcodetype opcode;
+        ranges::subrange<const unsigned char *> vch;
+        while (scriptView.GetOp(pc, opcode, vch)) {
+            if (opcode > blocksci::OP_PUSHDATA4 || vch.empty()) {
+                continue;
+            }
+            auto length = static_cast<size_t>(vch.size());
+            if (!signature.has(blocksci::InputSignature::HasSignature)) {
+                if (parseInputSignature(vch.begin(), length, signature)) {
+                    continue;
+                }
+            }
+            setInputPubkey(vch.begin(), length, signature);
+        }
+    }
+}
+
+blocksci::InputSignature extractInputSignature(const RawInput &input) {
+    blocksci::InputSignature signature{};
+    auto witness = input.getWitnessStack();
+    if (!witness.empty()) {
+        extractFromWitness(witness, signature);
+    } else {
+        extractFromScript(input.getScriptView(), signature);
+    }
+    return signature;
+}
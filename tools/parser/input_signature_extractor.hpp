@@ -0,0 +1,23 @@
+//
+//  input_signature_extractor.hpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef input_signature_extractor_hpp
+#define input_signature_extractor_hpp
+
+#include "parser_fwd.hpp"
+
+#include <blocksci/core/input_signature.hpp>
+
+/** Signature and public key revealed by the input, @see blocksci::InputSignature
+ *
+ * Segwit inputs are read from the witness stack, where a single 64 or 65 byte item is a taproot key path spend. All
+ * other inputs are read from the pushes of their scriptSig. Inputs without a signature (eg. coinbase or nonstandard
+ * inputs) get an entry without any flags set.
+ */
+blocksci::InputSignature extractInputSignature(const RawInput &input);
+
+#endif /* input_signature_extractor_hpp */
@@ -0,0 +1,117 @@
+//
+//  key_hash.hpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef key_hash_hpp
+#define key_hash_hpp
+
+#include "basic_types.hpp"
+
+#include <blocksci/core/bitcoin_uint256.hpp>
+#include <blocksci/core/inout_pointer.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
+/** Mixing hash of the keys of the parser's hash maps
+ *
+ * std::hash<uint256> and std::hash<uint160> return a single 64 bit word of the key. The open addressing tables of
+ * dense_hash_map only use the low bits of that word, so keys which agree in it (ground vanity hashes, outputs of the
+ * same transaction) end up on the same probe sequence. ParserKeyHash folds the whole key with 64x64->128 bit
+ * multiplications in the style of wyhash, which costs a few cycles more per key but spreads every bit of it.
+ */
+namespace key_hash {
+    constexpr uint64_t secret0 = 0xa0761d6478bd642full;
+    constexpr uint64_t secret1 = 0xe7037ed1a0b428dbull;
+    constexpr uint64_t secret2 = 0x8ebc6af09c88c6e3ull;
+    constexpr uint64_t secret3 = 0x589965cc75374cc3ull;
+
+    __extension__ using uint128 = unsigned __int128;
+
+    inline uint64_t mum(uint64_t a, uint64_t b) {
+        auto product = static_cast<uint128>(a) * b;
+        return static_cast<uint64_t>(product >> 64) ^ static_cast<uint64_t>(product);
+    }
+
+    inline uint64_t read64(const unsigned char *data) {
+        uint64_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    /** Hash of length bytes, the keys are short so there is no bulk loop over larger blocks */
+    inline uint64_t mixBytes(const unsigned char *data, size_t length, uint64_t seed) {
+        seed ^= secret0;
+        size_t i = 0;
+        for (; i + 16 <= length; i += 16) {
+            seed = mum(read64(data + i) ^ secret1, read64(data + i + 8) ^ seed);
+        }
+        if (i < length) {
+            unsigned char tail[16] = {};
+            std::memcpy(tail, data + i, length - i);
+            seed = mum(read64(tail) ^ secret2, read64(tail + 8) ^ seed);
+        }
+        return mum(seed ^ secret1, length ^ secret3);
+    }
+
+    inline uint64_t mixWord(uint64_t word) {
+        return mum(word ^ secret0, secret1);
+    }
+}
+
+/** Falls back to finalizing std::hash, which is enough for keys that are small integers */
+template <typename Key>
+struct ParserKeyHash {
+    size_t operator()(const Key &key) const {
+        return key_hash::mixWord(std::hash<Key>{}(key));
+    }
+};
+
+template <>
+struct ParserKeyHash<blocksci::uint256> {
+    size_t operator()(const blocksci::uint256 &key) const {
+        return key_hash::mixBytes(key.begin(), key.size(), 0);
+    }
+};
+
+template <>
+struct ParserKeyHash<blocksci::uint160> {
+    size_t operator()(const blocksci::uint160 &key) const {
+        return key_hash::mixBytes(key.begin(), key.size(), 0);
+    }
+};
+
+template <>
+struct ParserKeyHash<RawOutputPointer> {
+    size_t operator()(const RawOutputPointer &pointer) const {
+        return key_hash::mixBytes(pointer.hash.begin(), pointer.hash.size(), pointer.outputNum);
+    }
+};
+
+template <>
+struct ParserKeyHash<blocksci::InoutPointer> {
+    size_t operator()(const blocksci::InoutPointer &pointer) const {
+        return key_hash::mixWord((static_cast<uint64_t>(pointer.txNum) << 16) | pointer.inoutNum);
+    }
+};
+
+/** Hash of the keys of SerializableMap, selected with the BLOCKSCI_PARSER_MAP_HASH CMake option
+ *
+ * The hash determines the layout of the serialized maps, so each one records mapKeyHashId and maps written with the
+ * other hash are rehashed while they are loaded.
+ */
+#ifdef BLOCKSCI_PARSER_STD_HASH
+template <typename Key>
+using MapKeyHash = std::hash<Key>;
+constexpr uint32_t mapKeyHashId = 0;
+#else
+template <typename Key>
+using MapKeyHash = ParserKeyHash<Key>;
+constexpr uint32_t mapKeyHashId = 1;
+#endif
+
+#endif /* key_hash_hpp */
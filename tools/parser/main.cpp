@@ -15,34 +15,57 @@
 #include "chain_index.hpp"
 #include "preproccessed_block.hpp"
 #include "block_processor.hpp"
+#include "chain_synthesizer.hpp"
+#include "chain_rollback.hpp"
 #include "address_db.hpp"
 #include "parser_index_creator.hpp"
 #include "hash_index_creator.hpp"
+#include "nulldata_index_creator.hpp"
 #include "address_writer.hpp"
+#include "block_address_filter_writer.hpp"
+#include "block_stats_writer.hpp"
+#include "tx_package_writer.hpp"
 #include "utxo_address_state.hpp"
 #include "doctor.hpp"
+#include "output_column_writer.hpp"
+#include "address_stats_writer.hpp"
+#include "equiv_class_writer.hpp"
 
 #include <internal/bitcoin_uint256_hex.hpp>
+#include <internal/chain_access.hpp>
+#include <internal/chain_generation.hpp>
+#include <internal/chain_manifest.hpp>
+#include <internal/compressed_file_mapper.hpp>
 #include <internal/data_configuration.hpp>
+#include <internal/layered_file.hpp>
+#include <internal/tx_hash_order.hpp>
 
 #ifdef BLOCKSCI_RPC_PARSER
 #include <bitcoinapi/bitcoinapi.h>
 #endif
 
+#ifdef BLOCKSCI_WITH_ZMQ
+#include <zmq_subscriber.hpp>
+#endif
+
 #include <clipp.h>
 
 #include <wjfilesystem/path.h>
 
-#include <cereal/archives/binary.hpp>
-
 #include <nlohmann/json.hpp>
 
 #include <sys/resource.h>
 
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstring>
 #include <fstream>
 #include <future>
 #include <iostream>
 #include <iomanip>
+#include <memory>
+#include <thread>
 #include <cassert>
 
 using json = nlohmann::json;
@@ -83,132 +106,185 @@ struct ChainUpdateInfo {
     uint32_t splitPoint;
 };
 
+/** Parser state carried from one update to the next: the ChainIndex with all block headers and the UTXO and address
+ * maps
+ *
+ * A batch update loads it from disk, adds the new blocks and writes it back on destruction. The follow mode keeps a
+ * single instance for the lifetime of the daemon, so each new block only pays for fetching and processing the block
+ * itself. */
 template <typename ParserTag>
-std::vector<blocksci::RawBlock> updateChain(const ParserConfiguration<ParserTag> &config, blocksci::BlockHeight maxBlockNum, HashIndexCreator &hashDb) {
-    using namespace std::chrono_literals;
-
-    /* Load and update the persisted (serialized) ChainIndex object that contains information about all blocks (without transaction data)
-     * Generate the ChainIndex if no data is available on disk.
-     *
-     * This step represents the "xx.x% done fetching block headers" step of the parser output messages.
-     */
-    auto chainBlocks = [&]() {
-        ChainIndex<ParserTag> index;
-        std::ifstream inFile(config.blockListPath().str(), std::ios::binary);
-        if (inFile.good()) {
-            try {
-                cereal::BinaryInputArchive ia(inFile);
-                ia(index);
-            } catch (const std::exception &) {
-                std::cout << "Error loading chain index. Reparsing from scratch\n";
-                index = ChainIndex<ParserTag>{};
-            }
-        }
-        
-        index.update(config, maxBlockNum);
-        auto blocks = index.generateChain(maxBlockNum);
-        std::ofstream of(config.blockListPath().str(), std::ios::binary);
-        cereal::BinaryOutputArchive oa(of);
-        oa(index);
-        return blocks;
-    }();
-
-    /* Determine whether blocks have to be removed from the old chain (due to a fork, eg. caused by miners)
-     *
-     * This step represents the "Starting with chain of X blocks" and "Adding X blocks" step of the parser output messages.
-     */
-    blocksci::BlockHeight splitPoint = [&]() {
-        blocksci::ChainAccess oldChain{config.dataConfig.chainDirectory(), config.dataConfig.blocksIgnored, config.dataConfig.errorOnReorg};
-        blocksci::BlockHeight maxSize = std::min(oldChain.blockCount(), static_cast<blocksci::BlockHeight>(chainBlocks.size()));
-        auto splitPoint = maxSize;
-        for (blocksci::BlockHeight i{0}; i < maxSize; i++) {
-            blocksci::uint256 oldHash = oldChain.getBlock(maxSize - 1 - i)->hash;
-            blocksci::uint256 newHash = chainBlocks[static_cast<size_t>(static_cast<int>(maxSize - 1 - i))].hash;
-            if (!(oldHash == newHash)) {
-                splitPoint = maxSize - 1 - i;
-                break;
-            }
-        }
+class ChainUpdater {
+    const ParserConfiguration<ParserTag> &config;
+    HashIndexCreator &hashDb;
+    std::unique_ptr<ChainIndex<ParserTag>> index;
+    UTXOState utxoState;
+    UTXOAddressState utxoAddressState;
+    std::unique_ptr<AddressState> addressState;
+    UTXOScriptState utxoScriptState;
+    
+    /** Whether blocks were added since the UTXO maps were loaded, so that they need to be written back */
+    bool statesChanged = false;
 
-        if(static_cast<blocksci::BlockHeight>(oldChain.blockCount()) != splitPoint) {
-            std::cout << "Previously parsed chain is on a different fork than the longest chain. You may need to reparse. Aborting." << std::endl;
-            exit(1);
+    void serializeIndex() {
+        saveChainIndex(*index, config);
+    }
+
+    void serializeUTXOStates() {
+        if (statesChanged) {
+            utxoAddressState.serialize(config.utxoAddressStatePath().str());
+            utxoState.serialize(config.utxoCacheFile().str());
+            utxoScriptState.serialize(config.utxoScriptStatePath().str());
+            statesChanged = false;
         }
-        
-        std::cout << "Starting with chain of " << oldChain.blockCount() << " blocks" << std::endl;
-        std::cout << "Adding " << static_cast<blocksci::BlockHeight>(chainBlocks.size()) - splitPoint << " blocks" << std::endl;
-        
-        return splitPoint;
-    }();
+    }
 
-    std::vector<BlockInfo<ParserTag>> blocksToAdd{chainBlocks.begin() + static_cast<int>(splitPoint), chainBlocks.end()};
-    
-    std::ios::sync_with_stdio(false);
-    
-    if (blocksToAdd.size() == 0) {
-        return {};  // No new blocks since the last update
+    /** The UTXO and address maps are only loaded once there are blocks to add, so polling for new blocks stays cheap */
+    void loadStates() {
+        if (addressState) {
+            return;
+        }
+        addressState = std::make_unique<AddressState>(config.addressPath(), hashDb);
+        utxoAddressState.unserialize(config.utxoAddressStatePath().str());
+        utxoState.unserialize(config.utxoCacheFile().str());
+        utxoScriptState.unserialize(config.utxoScriptStatePath().str());
+        // UTXOs evicted by an earlier run stay on disk even if the limit was removed since
+        if (config.maxUTXOsInMemory > 0 || config.utxoColdStorePath().exists()) {
+            utxoState.useColdStore(config.utxoColdStorePath(), config.maxUTXOsInMemory);
+            utxoState.spill();
+        }
     }
-    
-    uint32_t startingTxCount;
-    uint64_t startingInputCount;
-    uint64_t startingOutputCount;
-    {
-        blocksci::ChainAccess chain{config.dataConfig.chainDirectory(), 0, false};
-        startingTxCount = static_cast<uint32_t>(chain.txCount());
-        startingInputCount = chain.inputCount();
-        startingOutputCount = chain.outputCount();
+
+public:
+    ChainUpdater(const ParserConfiguration<ParserTag> &config_, HashIndexCreator &hashDb_) : config(config_), hashDb(hashDb_), index(openChainIndex(config)) {}
+
+    ChainUpdater(const ChainUpdater &) = delete;
+    ChainUpdater &operator=(const ChainUpdater &) = delete;
+
+    ~ChainUpdater() {
+        serializeIndex();
+        serializeUTXOStates();
     }
-    
-    auto maxBlockHeight = blocksToAdd.back().height;
-    
-    uint32_t totalTxCount = 0;
-    uint32_t totalInputCount = 0;
-    uint32_t totalOutputCount = 0;
-    for (auto &block : blocksToAdd) {
-        totalTxCount += block.nTx;
-        totalInputCount += block.inputCount;
-        totalOutputCount += block.outputCount;
+
+    /** Write all state to disk so that a later batch update can continue from here, the address state is written
+     * by its own destructor otherwise */
+    void checkpoint() {
+        serializeIndex();
+        serializeUTXOStates();
+        if (addressState) {
+            addressState->serialize();
+        }
     }
 
-    BlockProcessor processor{startingTxCount, startingInputCount, startingOutputCount, totalTxCount, maxBlockHeight};
-    UTXOState utxoState;
-    UTXOAddressState utxoAddressState;
-    AddressState addressState{config.addressPath(), hashDb};
-    UTXOScriptState utxoScriptState;
-    
-    utxoAddressState.unserialize(config.utxoAddressStatePath().str());
-    utxoState.unserialize(config.utxoCacheFile().str());
-    utxoScriptState.unserialize(config.utxoScriptStatePath().str());
-    
-    std::vector<blocksci::RawBlock> newBlocks;
-    auto it = blocksToAdd.begin();
-    auto end = blocksToAdd.end();
-    while (it != end) {
-        auto prev = it;
-        uint32_t newTxCount = 0;
+    /** Fetch the new block headers and process the blocks which extend the parsed chain, returning their RawBlock
+     * entries for the block file */
+    std::vector<blocksci::RawBlock> update(blocksci::BlockHeight maxBlockNum) {
+        /* Update the ChainIndex, generating it if no data is available on disk.
+         *
+         * This step represents the "xx.x% done fetching block headers" step of the parser output messages.
+         */
+        index->update(config, maxBlockNum);
+        auto chainBlocks = index->generateChain(maxBlockNum);
+
+        /* Determine whether blocks have to be removed from the old chain (due to a fork, eg. caused by miners)
+         *
+         * This step represents the "Starting with chain of X blocks" and "Adding X blocks" step of the parser output messages.
+         */
+        blocksci::BlockHeight parsedBlockCount = 0;
+        blocksci::BlockHeight splitPoint = [&]() {
+            blocksci::ChainAccess oldChain{config.dataConfig.chainDirectory(), config.dataConfig.blocksIgnored, config.dataConfig.errorOnReorg};
+            parsedBlockCount = oldChain.blockCount();
+            blocksci::BlockHeight maxSize = std::min(oldChain.blockCount(), static_cast<blocksci::BlockHeight>(chainBlocks.size()));
+            auto splitPoint = maxSize;
+            for (blocksci::BlockHeight i{0}; i < maxSize; i++) {
+                blocksci::uint256 oldHash = oldChain.getBlock(maxSize - 1 - i)->hash;
+                blocksci::uint256 newHash = chainBlocks[static_cast<size_t>(static_cast<int>(maxSize - 1 - i))].hash;
+                if (!(oldHash == newHash)) {
+                    splitPoint = maxSize - 1 - i;
+                    break;
+                }
+            }
 
-        // Process only as many blocks such that ~10,000,000 transactions are added in one BlockProcessor.addNewBlocks() call
-        while (newTxCount < 10000000 && it != end) {
-            newTxCount += it->nTx;
-            ++it;
+            return splitPoint;
+        }();
+        
+        // Blocks of a recent fork are undone with their journals, deeper reorganizations require a reparse
+        if (parsedBlockCount != splitPoint) {
+            bool onOtherFork = splitPoint < static_cast<blocksci::BlockHeight>(chainBlocks.size());
+            if (!onOtherFork || !canRollback(config, splitPoint)) {
+                std::cout << "Previously parsed chain is on a different fork than the longest chain. You may need to reparse. Aborting." << std::endl;
+                exit(1);
+            }
+            std::cout << "Previously parsed chain is on a different fork than the longest chain, rolling back to block " << splitPoint << std::endl;
+            loadStates();
+            rollbackChain(config, splitPoint, utxoState, utxoAddressState, utxoScriptState, *addressState, hashDb);
+            statesChanged = true;
         }
         
-        decltype(blocksToAdd) nextBlocks{prev, it};
+        std::cout << "Starting with chain of " << splitPoint << " blocks" << std::endl;
+        std::cout << "Adding " << static_cast<blocksci::BlockHeight>(chainBlocks.size()) - splitPoint << " blocks" << std::endl;
 
-        auto blocks = processor.addNewBlocks(config, nextBlocks, utxoState, utxoAddressState, addressState, utxoScriptState);
+        std::vector<BlockInfo<ParserTag>> blocksToAdd{chainBlocks.begin() + static_cast<int>(splitPoint), chainBlocks.end()};
+        
+        std::ios::sync_with_stdio(false);
+        
+        if (blocksToAdd.size() == 0) {
+            return {};  // No new blocks since the last update
+        }
+        
+        uint32_t startingTxCount;
+        uint64_t startingInputCount;
+        uint64_t startingOutputCount;
+        {
+            blocksci::ChainAccess chain{config.dataConfig.chainDirectory(), 0, false};
+            startingTxCount = static_cast<uint32_t>(chain.txCount());
+            startingInputCount = chain.inputCount();
+            startingOutputCount = chain.outputCount();
+        }
+        
+        auto maxBlockHeight = blocksToAdd.back().height;
+        
+        uint32_t totalTxCount = 0;
+        uint32_t totalInputCount = 0;
+        uint32_t totalOutputCount = 0;
+        for (auto &block : blocksToAdd) {
+            totalTxCount += block.nTx;
+            totalInputCount += block.inputCount;
+            totalOutputCount += block.outputCount;
+        }
+
+        loadStates();
+        statesChanged = true;
+        BlockProcessor processor{startingTxCount, startingInputCount, startingOutputCount, totalTxCount, maxBlockHeight};
+        
+        std::vector<blocksci::RawBlock> newBlocks;
+        auto it = blocksToAdd.begin();
+        auto end = blocksToAdd.end();
+        while (it != end) {
+            auto prev = it;
+            uint32_t newTxCount = 0;
+
+            // Process only as many blocks such that ~10,000,000 transactions are added in one BlockProcessor.addNewBlocks() call
+            while (newTxCount < 10000000 && it != end) {
+                newTxCount += it->nTx;
+                ++it;
+            }
+            
+            decltype(blocksToAdd) nextBlocks{prev, it};
 
-        // Add all just processed blocks to newBlocks as RawBlock. The blocks are in turn written to blockFile in the calling (parent) function
-        newBlocks.insert(newBlocks.end(), blocks.begin(), blocks.end());
+            auto blocks = processor.addNewBlocks(config, nextBlocks, utxoState, utxoAddressState, *addressState, utxoScriptState);
+            addressState->printStats(std::cout);
 
-        // This step represents the "Back linking transactions" step of the parser output messages.
-        backUpdateTxes(config);
+            // Add all just processed blocks to newBlocks as RawBlock. The blocks are in turn written to blockFile in the calling (parent) function
+            newBlocks.insert(newBlocks.end(), blocks.begin(), blocks.end());
+
+            // This step represents the "Back linking transactions" step of the parser output messages.
+            backUpdateTxes(config);
+            
+            utxoState.spill();
+        }
+        return newBlocks;
     }
-    
-    utxoAddressState.serialize(config.utxoAddressStatePath().str());
-    utxoState.serialize(config.utxoCacheFile().str());
-    utxoScriptState.serialize(config.utxoScriptStatePath().str());
-    return newBlocks;
-}
+};
 
 void updateHashDB(const ParserConfigurationBase &config, HashIndexCreator &db) {
     blocksci::ChainAccess chain{config.dataConfig.chainDirectory(), config.dataConfig.blocksIgnored, config.dataConfig.errorOnReorg};
@@ -217,7 +293,16 @@ void updateHashDB(const ParserConfigurationBase &config, HashIndexCreator &db) {
     blocksci::State updateState{chain, scripts};
     std::cout << "Updating hash index\n";
     
+    // An initial parse writes the whole index at once, which is much faster as sorted table files
+    bool bulkLoad = db.isEmpty();
+    if (bulkLoad) {
+        db.beginBulkLoad();
+    }
     db.runUpdate(updateState);
+    if (bulkLoad) {
+        db.finishBulkLoad();
+    }
+    db.updateTxHashTable(config.dataConfig.txHashTableFilePath(), chain);
 }
 
 void updateAddressDB(const ParserConfigurationBase &config) {
@@ -229,9 +314,111 @@ void updateAddressDB(const ParserConfigurationBase &config) {
     
     std::cout << "Updating address index\n";
     
+    bool bulkLoad = db.isEmpty();
+    if (bulkLoad) {
+        db.beginBulkLoad();
+    }
+    db.runUpdate(updateState);
+    if (bulkLoad) {
+        db.finishBulkLoad();
+    }
+    db.updateAddressTables(config.dataConfig.addressTablesDirectory(), static_cast<uint32_t>(chain.txCount()), scripts);
+}
+
+void updateNulldataIndex(const ParserConfigurationBase &config) {
+    blocksci::ChainAccess chain{config.dataConfig.chainDirectory(), config.dataConfig.blocksIgnored, config.dataConfig.errorOnReorg};
+    blocksci::ScriptAccess scripts{config.dataConfig.scriptsDirectory()};
+    
+    blocksci::State updateState{chain, scripts};
+    NulldataIndexCreator db(config, config.dataConfig.nulldataIndexDirectory());
+    
+    std::cout << "Updating nulldata index\n";
     db.runUpdate(updateState);
 }
 
+/** Rebuild the tx hash order once the transactions added since it was built are worth sorting again, which are
+ * otherwise sorted in memory whenever it is used */
+void updateTxHashOrder(const ParserConfigurationBase &config, bool force) {
+    blocksci::ChainAccess chain{config.dataConfig.chainDirectory(), config.dataConfig.blocksIgnored, config.dataConfig.errorOnReorg};
+    auto txCount = static_cast<uint32_t>(chain.txCount());
+    if (txCount == 0) {
+        return;
+    }
+    auto path = config.dataConfig.txHashOrderFilePath();
+    if (!force) {
+        blocksci::TxHashOrder order{path};
+        if (order.matches(chain) && txCount - order.txCount() < std::max(uint32_t{10'000'000}, order.txCount() / 8)) {
+            return;
+        }
+    }
+    std::cout << "Updating tx hash order\n";
+    blocksci::TxHashOrder::build(path, chain, txCount);
+}
+
+/** The nulldata index and the tx hash order are optional, once built they are kept up to date with the other indexes */
+void updateOptionalIndexes(const ParserConfigurationBase &config) {
+    if (blocksci::NulldataPrefixIndex::exists(config.dataConfig.nulldataIndexDirectory())) {
+        updateNulldataIndex(config);
+    }
+    if (filesystem::path{config.dataConfig.txHashOrderFilePath().str() + ".dat"}.exists()) {
+        updateTxHashOrder(config, false);
+    }
+}
+
+template <typename T>
+void compressChainColumn(const filesystem::path &columnPath) {
+    filesystem::path rawPath{columnPath.str() + ".dat"};
+    if (!rawPath.exists()) {
+        return;
+    }
+    auto rawSize = rawPath.file_size();
+    auto compressedSize = blocksci::compressColumn<T>(columnPath);
+    std::cout << "Compressed " << rawPath.filename() << " from " << rawSize << " to " << compressedSize << " bytes\n";
+}
+
+void compressChainColumns(const ParserConfigurationBase &config) {
+    auto chainDirectory = config.dataConfig.chainDirectory();
+    compressChainColumn<int32_t>(blocksci::ChainAccess::txVersionFilePath(chainDirectory));
+    compressChainColumn<uint16_t>(blocksci::ChainAccess::inputSpentOutNumFilePath(chainDirectory));
+    compressChainColumn<uint32_t>(blocksci::ChainAccess::sequenceFilePath(chainDirectory));
+    compressChainColumn<blocksci::uint256>(blocksci::ChainAccess::txHashesFilePath(chainDirectory));
+}
+
+/** Files smaller than this aren't worth sharing with the base */
+constexpr int64_t minimumSharedFileSize = int64_t{64} << 20;
+
+/** Store the chain/ and scripts/ files as layers over a base data directory that was parsed up to the height where
+ * the chain forked off, so that forks like BCH and BSV share the data of their common history (@see LayerManifest).
+ * The base must not be updated afterwards, its files are made read-only. The hash and address indexes stay separate */
+void shareBase(const ParserConfigurationBase &config, filesystem::path baseDirectory) {
+    baseDirectory = baseDirectory.make_absolute();
+    auto dataDirectory = config.dataConfig.chainConfig.dataDirectory.make_absolute();
+    if (baseDirectory.str() == dataDirectory.str()) {
+        throw std::invalid_argument("The base directory must differ from the data directory of the chain");
+    }
+    
+    // The files only share their beginning if the base holds a prefix of the chain
+    blocksci::FixedSizeFileMapper<blocksci::RawBlock> baseBlocks{blocksci::ChainAccess::blockFilePath(baseDirectory/"chain")};
+    blocksci::FixedSizeFileMapper<blocksci::RawBlock> blocks{blocksci::ChainAccess::blockFilePath(config.dataConfig.chainDirectory())};
+    if (baseBlocks.size() == 0 || baseBlocks.size() > blocks.size()) {
+        throw std::runtime_error("The base directory " + baseDirectory.str() + " doesn't hold a prefix of the chain");
+    }
+    for (blocksci::OffsetType height = 0; height < baseBlocks.size(); height++) {
+        if (baseBlocks[height]->hash != blocks[height]->hash) {
+            throw std::runtime_error("The chain diverges from the base directory at block " + std::to_string(height));
+        }
+    }
+    
+    int64_t sharedBytes = 0;
+    for (auto subdirectory : {"chain", "scripts"}) {
+        for (auto &file : blocksci::layerDirectoryOverBase(dataDirectory/subdirectory, baseDirectory/subdirectory, minimumSharedFileSize)) {
+            std::cout << "Sharing " << file.second << " bytes of " << subdirectory << "/" << file.first.filename() << " with the base\n";
+            sharedBytes += file.second;
+        }
+    }
+    std::cout << "Sharing " << sharedBytes << " bytes of the first " << baseBlocks.size() << " blocks with " << baseDirectory.str() << "\n";
+}
+
 ParserConfigurationBase getBaseConfig(const filesystem::path &configPath) {
     if (!configPath.exists()) {
         throw std::runtime_error("Config path does not exist");
@@ -239,45 +426,293 @@ ParserConfigurationBase getBaseConfig(const filesystem::path &configPath) {
     return {blocksci::loadBlockchainConfig(configPath.str(), true, 0)};
 }
 
-void updateChain(const filesystem::path &configFilePath, bool fullParse) {
+/** Read the parser settings of the config file and call func with the disk or RPC parser configuration and the
+ * maximum block height */
+template <typename Func>
+void withParserConfiguration(const filesystem::path &configFilePath, Func &&func) {
     auto jsonConf = blocksci::loadConfig(configFilePath.str());
     blocksci::checkVersion(jsonConf);
     
     blocksci::ChainConfiguration chainConfig = jsonConf.at("chainConfig");
     blocksci::DataConfiguration dataConfig{configFilePath.str(), chainConfig, true, 0};
     
-    ParserConfigurationBase config{dataConfig};
-    HashIndexCreator hashDb(config, config.dataConfig.hashIndexFilePath());
-    
     auto parserConf = jsonConf.at("parser");
     blocksci::BlockHeight maxBlock = parserConf.at("maxBlockNum");
+    size_t maxUTXOsInMemory = 0;
+    auto maxUTXOsIt = parserConf.find("maxUTXOsInMemory");
+    if (maxUTXOsIt != parserConf.end()) {
+        maxUTXOsIt->get_to(maxUTXOsInMemory);
+    }
+    size_t maxPendingIndexRows = 2'000'000;
+    auto maxPendingIndexRowsIt = parserConf.find("maxPendingIndexRows");
+    if (maxPendingIndexRowsIt != parserConf.end()) {
+        maxPendingIndexRowsIt->get_to(maxPendingIndexRows);
+    }
+    bool partitionedScriptNums = false;
+    auto partitionedScriptNumsIt = parserConf.find("partitionedScriptNums");
+    if (partitionedScriptNumsIt != parserConf.end()) {
+        partitionedScriptNumsIt->get_to(partitionedScriptNums);
+    }
+    bool extractSignatures = false;
+    auto extractSignaturesIt = parserConf.find("extractSignatures");
+    if (extractSignaturesIt != parserConf.end()) {
+        extractSignaturesIt->get_to(extractSignatures);
+    }
+    auto recordWitnesses = ParserConfigurationBase::WitnessRecording::None;
+    auto recordWitnessesIt = parserConf.find("recordWitnesses");
+    if (recordWitnessesIt != parserConf.end()) {
+        auto mode = recordWitnessesIt->get<std::string>();
+        if (mode == "sizes") {
+            recordWitnesses = ParserConfigurationBase::WitnessRecording::Sizes;
+        } else if (mode == "full") {
+            recordWitnesses = ParserConfigurationBase::WitnessRecording::Full;
+        } else {
+            throw std::invalid_argument("Unknown recordWitnesses mode " + mode + ", expected sizes or full");
+        }
+    }
+    std::string telemetryPath;
+    auto telemetryFormat = ParserConfigurationBase::TelemetryFormat::Json;
+    int telemetryInterval = 10;
+    auto telemetryIt = parserConf.find("telemetry");
+    if (telemetryIt != parserConf.end()) {
+        telemetryPath = telemetryIt->at("path").get<std::string>();
+        auto formatIt = telemetryIt->find("format");
+        if (formatIt != telemetryIt->end()) {
+            auto format = formatIt->get<std::string>();
+            if (format == "json") {
+                telemetryFormat = ParserConfigurationBase::TelemetryFormat::Json;
+            } else if (format == "prometheus") {
+                telemetryFormat = ParserConfigurationBase::TelemetryFormat::Prometheus;
+            } else {
+                throw std::invalid_argument("Unknown telemetry format " + format + ", expected json or prometheus");
+            }
+        }
+        auto intervalIt = telemetryIt->find("interval");
+        if (intervalIt != telemetryIt->end()) {
+            intervalIt->get_to(telemetryInterval);
+            if (telemetryInterval <= 0) {
+                throw std::invalid_argument("The telemetry interval must be a positive number of seconds");
+            }
+        }
+    }
     
-    std::vector<blocksci::RawBlock> newBlocks;
     if (parserConf.find("disk") != parserConf.end()) {
         ChainDiskConfiguration diskConfig = parserConf.at("disk");
         ParserConfiguration<FileTag> config{dataConfig, diskConfig};
-        newBlocks = updateChain(config, blocksci::BlockHeight{maxBlock}, hashDb);
+        config.maxUTXOsInMemory = maxUTXOsInMemory;
+        config.maxPendingIndexRows = maxPendingIndexRows;
+        config.partitionedScriptNums = partitionedScriptNums;
+        config.extractSignatures = extractSignatures;
+        config.recordWitnesses = recordWitnesses;
+        config.telemetryPath = telemetryPath;
+        config.telemetryFormat = telemetryFormat;
+        config.telemetryInterval = telemetryInterval;
+        func(config, maxBlock);
     } else if (parserConf.find("rpc") != parserConf.end()) {
         blocksci::ChainRPCConfiguration rpcConfig = parserConf.at("rpc");
         ParserConfiguration<RPCTag> config(dataConfig, rpcConfig);
-        newBlocks = updateChain(config, blocksci::BlockHeight{maxBlock}, hashDb);
+        config.maxUTXOsInMemory = maxUTXOsInMemory;
+        config.maxPendingIndexRows = maxPendingIndexRows;
+        config.partitionedScriptNums = partitionedScriptNums;
+        config.extractSignatures = extractSignatures;
+        config.recordWitnesses = recordWitnesses;
+        config.telemetryPath = telemetryPath;
+        config.telemetryFormat = telemetryFormat;
+        config.telemetryInterval = telemetryInterval;
+        func(config, maxBlock);
     } else {
         throw std::runtime_error("Must provide either rpc or disk parsing settings");
     }
+}
+
+/** Record the sizes of the chain and script files in a new manifest entry, which readers can pin as a snapshot */
+void publishManifest(const ParserConfigurationBase &config) {
+    auto chainDirectory = config.dataConfig.chainDirectory();
+    blocksci::ChainAccess chain{chainDirectory, 0, false};
+    if (chain.blockCount() == 0) {
+        return;
+    }
+    blocksci::ScriptAccess scripts{config.dataConfig.scriptsDirectory()};
+    blocksci::ChainManifestEntry entry{};
+    entry.tipHash = chain.getBlock(chain.blockCount() - 1)->hash;
+    entry.blockCount = static_cast<uint32_t>(chain.blockCount());
+    entry.txCount = static_cast<uint32_t>(chain.txCount());
+    entry.inputCount = chain.inputCount();
+    entry.outputCount = chain.outputCount();
+    entry.scriptCounts = scripts.scriptCounts();
+    blocksci::ChainManifest::publish(chainDirectory, entry);
+}
+
+/** Append the processed blocks to the block file, which makes them visible to readers, and bring the optional
+ * columns up to date */
+void publishBlocks(const ParserConfigurationBase &config, const std::vector<blocksci::RawBlock> &newBlocks) {
+    // Bump the chain generation before and after replacing blocks so that readers loaded with errorOnReorg
+    // recheck the last block hash the next time they check for a reorg
+    blocksci::ChainGeneration::increment(config.dataConfig.chainDirectory());
     
     // It'd be nice to do this after the indexes are updated, but they currently depend on the chain being fully updated
     {
-        // Write new RawBlock blocks from the updateChain() method to the blockFile
+        // Write new RawBlock blocks from ChainUpdater::update() to the blockFile
         FixedSizeFileWriter<blocksci::RawBlock> blockFile{blocksci::ChainAccess::blockFilePath(config.dataConfig.chainDirectory())};
         for (auto &block : newBlocks) {
             blockFile.write(block);
         }
     }
     
+    updateBlockStats(config);
+    updateTxPackages(config);
+    
+    if (outputColumnsExist(config)) {
+        updateOutputColumns(config);
+    }
+    
+    if (addressStatsExist(config)) {
+        updateAddressStats(config);
+    }
+    
+    if (equivClassesExist(config)) {
+        updateEquivClasses(config);
+    }
+    
+    if (blockAddressFiltersExist(config)) {
+        updateBlockAddressFilters(config);
+    }
+    
+    // Data directories of older parsers get their first snapshot even if there was nothing new
+    if (!newBlocks.empty() || !blocksci::ChainManifest{config.dataConfig.chainDirectory()}.latest()) {
+        publishManifest(config);
+    }
+    
+    blocksci::ChainGeneration::increment(config.dataConfig.chainDirectory());
+}
+
+void updateIndexes(const ParserConfigurationBase &config, HashIndexCreator &hashDb) {
+    updateHashDB(config, hashDb);
+    updateAddressDB(config);
+    updateOptionalIndexes(config);
+}
+
+template <typename ParserTag>
+void updateChain(const ParserConfiguration<ParserTag> &config, blocksci::BlockHeight maxBlock, bool fullParse) {
+    HashIndexCreator hashDb(config, config.dataConfig.hashIndexFilePath());
+    std::vector<blocksci::RawBlock> newBlocks;
+    {
+        ChainUpdater<ParserTag> updater{config, hashDb};
+        newBlocks = updater.update(maxBlock);
+    }
+    
+    publishBlocks(config, newBlocks);
+    
     if (fullParse) {
-        updateHashDB(config, hashDb);
-        updateAddressDB(config);
+        updateIndexes(config, hashDb);
+    }
+}
+
+void updateChain(const filesystem::path &configFilePath, bool fullParse) {
+    withParserConfiguration(configFilePath, [&](const auto &config, blocksci::BlockHeight maxBlock) {
+        updateChain(config, maxBlock, fullParse);
+    });
+}
+
+static volatile sig_atomic_t followDone = 0;
+static volatile sig_atomic_t blockNotified = 0;
+
+void stopFollowing(int) {
+    followDone = 1;
+}
+
+void notifyBlock(int) {
+    blockNotified = 1;
+}
+
+/** Settings of the follow mode */
+struct FollowOptions {
+    /** Seconds between checks for new blocks without a notification */
+    int pollInterval = 30;
+    
+    /** Blocks after which the in memory state is written to disk, 0 to only write it on shutdown */
+    int checkpointInterval = 144;
+    
+    /** ZMQ endpoint of bitcoind's hashblock notifications, empty to rely on signals and polling */
+    std::string zmqEndpoint;
+};
+
+template <typename ParserTag, typename Wait>
+void followChain(const ParserConfiguration<ParserTag> &config, blocksci::BlockHeight maxBlock, const FollowOptions &options, Wait &&waitForBlock) {
+    HashIndexCreator hashDb(config, config.dataConfig.hashIndexFilePath());
+    ChainUpdater<ParserTag> updater{config, hashDb};
+    std::cout << "Following the chain, waiting for new blocks" << std::endl;
+    
+    int blocksSinceCheckpoint = 0;
+    while (!followDone) {
+        auto start = std::chrono::steady_clock::now();
+        auto newBlocks = updater.update(maxBlock);
+        if (!newBlocks.empty()) {
+            publishBlocks(config, newBlocks);
+            updateIndexes(config, hashDb);
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+            std::cout << "Published " << newBlocks.size() << " blocks in " << elapsed.count() << "ms" << std::endl;
+            
+            blocksSinceCheckpoint += static_cast<int>(newBlocks.size());
+            if (options.checkpointInterval > 0 && blocksSinceCheckpoint >= options.checkpointInterval) {
+                updater.checkpoint();
+                blocksSinceCheckpoint = 0;
+            }
+        }
+        waitForBlock();
     }
+    std::cout << "Writing parser state before shutting down" << std::endl;
+}
+
+/** Keep the parser state in memory and add every new block as soon as the node announces it
+ *
+ * New blocks are announced with SIGUSR1, eg. from bitcoind -blocknotify="kill -USR1 $(cat <data>/blocksci_parser.pid)",
+ * or through the hashblock topic of bitcoind's ZMQ notifications. The chain is also checked every pollInterval seconds
+ * in case a notification is missed. Every update is published like a regular update, so readers pick it up through
+ * the chain generation and Blockchain::diskBlockCount(). The in memory state is written to disk every
+ * checkpointInterval blocks and on SIGTERM or SIGINT, a daemon killed in between leaves the PID file behind like a
+ * crashed batch update. */
+void followChain(const filesystem::path &configFilePath, const FollowOptions &options) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(struct sigaction));
+    action.sa_handler = stopFollowing;
+    sigaction(SIGTERM, &action, nullptr);
+    sigaction(SIGINT, &action, nullptr);
+    action.sa_handler = notifyBlock;
+    sigaction(SIGUSR1, &action, nullptr);
+    
+#ifdef BLOCKSCI_WITH_ZMQ
+    std::unique_ptr<ZmqSubscriber> subscriber;
+    if (!options.zmqEndpoint.empty()) {
+        subscriber = std::make_unique<ZmqSubscriber>(options.zmqEndpoint, std::vector<std::string>{"hashblock"});
+    }
+#else
+    if (!options.zmqEndpoint.empty()) {
+        throw std::runtime_error("blocksci_parser was built without ZMQ support, install libzmq and rebuild to use --zmq");
+    }
+#endif
+    
+    // Wait in short slices so that signals are handled promptly
+    auto waitForBlock = [&]() {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(options.pollInterval);
+        while (!followDone && !blockNotified && std::chrono::steady_clock::now() < deadline) {
+#ifdef BLOCKSCI_WITH_ZMQ
+            if (subscriber) {
+                ZmqNotification notification;
+                if (subscriber->receive(notification, 50)) {
+                    blockNotified = 1;
+                }
+                continue;
+            }
+#endif
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        blockNotified = 0;
+    };
+    
+    withParserConfiguration(configFilePath, [&](const auto &config, blocksci::BlockHeight maxBlock) {
+        followChain(config, maxBlock, options, waitForBlock);
+    });
 }
 
 int main(int argc, char * argv[]) {
@@ -289,7 +724,7 @@ int main(int argc, char * argv[]) {
     //    --data-directory /Users/hkalodner/bitcoin-samp
     //    --coin-directory /Users/hkalodner/Library/Application\ Support/Bitcoin
     
-    enum class mode {generateConfig, update, updateCore, updateIndexes, updateHashIndex, updateAddressIndex, compactIndexes, help, doctor};
+    enum class mode {generateConfig, update, updateCore, follow, updateIndexes, updateHashIndex, updateAddressIndex, compactIndexes, compressColumns, shareBase, synthesizeChain, buildOutputColumns, buildAddressStats, buildEquivClasses, buildNulldataIndex, buildAddressFilters, buildTxHashOrder, help, doctor};
     mode selected = mode::help;
     
     bool enableRPC = false;
@@ -353,12 +788,46 @@ int main(int argc, char * argv[]) {
     auto addressIndexUpdateCommand = clipp::command("address-index-update").set(selected,mode::updateAddressIndex) % "Update address index to latest state";
     auto hashIndexUpdateCommand = clipp::command("hash-index-update").set(selected,mode::updateHashIndex) % "Update hash index to latest state";
     auto compactIndexesCommand = clipp::command("compact-indexes").set(selected, mode::compactIndexes) % "Compact indexes to speed up blockchain construction";
+    auto compressColumnsCommand = clipp::command("compress-columns").set(selected, mode::compressColumns) % "Write compressed copies of the cold chain columns (enable them with compressedColumns in the config file)";
+    std::string baseDirectoryString;
+    auto shareBaseCommand = (
+        clipp::command("share-base").set(selected, mode::shareBase) % "Store the chain and script files as layers over a base data directory parsed up to the fork height of the chain, keeping only the parts that differ",
+        clipp::value("base directory", baseDirectoryString) % "Data directory of the base, which must not be updated afterwards"
+    );
+    SyntheticChainOptions syntheticOptions;
+    std::string syntheticCoinDirectory;
+    std::string syntheticDataDirectory;
+    auto synthesizeChainCommand = (
+        clipp::command("synthesize-chain").set(selected, mode::synthesizeChain) % "Write a synthetic regtest chain as block files and a config to parse it with, for benchmarking the parser",
+        clipp::value("coin directory", syntheticCoinDirectory) % "Directory the block files are written to",
+        clipp::value("data directory", syntheticDataDirectory) % "Path to blocksci data location",
+        (clipp::option("--txes") & clipp::value("count", syntheticOptions.txCount)) % "Number of transactions (default 1000000)",
+        (clipp::option("--block-txes") & clipp::value("count", syntheticOptions.txesPerBlock)) % "Transactions per block (default 2000)",
+        (clipp::option("--inputs") & clipp::value("mean", syntheticOptions.meanInputs)) % "Mean number of inputs per transaction (default 2)",
+        (clipp::option("--outputs") & clipp::value("mean", syntheticOptions.meanOutputs)) % "Mean number of outputs per transaction (default 2.5)",
+        (clipp::option("--script-mix") & clipp::value("weights", syntheticOptions.scriptMix)) % "Weights of the output types, eg. pubkeyhash=50,witness_pubkeyhash=25,scripthash=12,multisig=3,pubkey=2,nulldata=8",
+        (clipp::option("--address-reuse") & clipp::value("rate", syntheticOptions.addressReuse)) % "Probability that an output reuses an earlier address (default 0.3)",
+        (clipp::option("--seed") & clipp::value("seed", syntheticOptions.seed)) % "Seed of the generator (default 1)"
+    );
+    FollowOptions followOptions;
+    auto followCommand = (
+        clipp::command("follow").set(selected,mode::follow) % "Keep the parser state in memory and add new blocks as soon as they are announced (SIGUSR1 from bitcoind -blocknotify, or ZMQ hashblock notifications)",
+        (clipp::option("--zmq") & clipp::value("endpoint", followOptions.zmqEndpoint)) % "Subscribe to the hashblock notifications of bitcoind (-zmqpubhashblock=<endpoint>)",
+        (clipp::option("--poll-interval") & clipp::value("seconds", followOptions.pollInterval)) % "Check for new blocks after this many seconds without a notification (default 30)",
+        (clipp::option("--checkpoint-interval") & clipp::value("blocks", followOptions.checkpointInterval)) % "Write the parser state to disk after this many blocks, 0 to only write it on shutdown (default 144)"
+    );
     auto doctorCommand = clipp::command("doctor").set(selected,mode::doctor) % "Diagnose issues with BlockSci or the provided config file.";
     
     std::string configFilePathString;
     auto configFileOpt = clipp::value("config file", configFilePathString) % "Path to config file";
     
-    auto commands = (generateConfigCommand, configOptions) | updateCommand | updateCoreCommand | indexUpdateCommand | addressIndexUpdateCommand | hashIndexUpdateCommand | compactIndexesCommand | doctorCommand;
+    auto buildOutputColumnsCommand = clipp::command("build-output-columns").set(selected, mode::buildOutputColumns) % "Write the columnar output files (chain/output_*.dat) used by OutputColumns, later updates keep them current";
+    auto buildAddressStatsCommand = clipp::command("build-address-stats").set(selected, mode::buildAddressStats) % "Write the per address received, sent and balance totals (scripts/<type>_stats.dat), later updates keep them current";
+    auto buildEquivClassesCommand = clipp::command("build-equiv-classes").set(selected, mode::buildEquivClasses) % "Write the script equivalence classes (scripts/*equiv_class*.dat) used by EquivAddress, later updates keep them current";
+    auto buildNulldataIndexCommand = clipp::command("build-nulldata-index").set(selected, mode::buildNulldataIndex) % "Write the index of OP_RETURN payload prefixes (nulldataIndex/), later updates keep it current";
+    auto buildAddressFiltersCommand = clipp::command("build-address-filters").set(selected, mode::buildAddressFilters) % "Write the per block address filters (chain/block_address_filter_*.dat) used to skip blocks in watch list scans, later updates keep them current";
+    auto buildTxHashOrderCommand = clipp::command("build-tx-hash-order").set(selected, mode::buildTxHashOrder) % "Write the tx numbers sorted by hash (txHashOrder.dat) used to match the transactions of two chains, later updates keep it current";
+    auto commands = (generateConfigCommand, configOptions) | updateCommand | updateCoreCommand | followCommand | indexUpdateCommand | addressIndexUpdateCommand | hashIndexUpdateCommand | compactIndexesCommand | compressColumnsCommand | shareBaseCommand | synthesizeChainCommand | buildOutputColumnsCommand | buildAddressStatsCommand | buildEquivClassesCommand | buildNulldataIndexCommand | buildAddressFiltersCommand | buildTxHashOrderCommand | doctorCommand;
     
     auto cli = (configFileOpt, commands);
     
@@ -501,6 +970,19 @@ int main(int argc, char * argv[]) {
             break;
         }
 
+        case mode::follow: {
+            auto doctor = BlockSciDoctor(configFilePath);
+            doctor.checkDiskSpace();
+            doctor.checkOpenFilesLimit();
+            std::cout << std::endl;
+
+            auto config = getBaseConfig(configFilePath);
+            lockDataDirectory(config);
+            followChain(configFilePath, followOptions);
+            unlockDataDirectory(config);
+            break;
+        }
+
         case mode::updateIndexes: {
             auto config = getBaseConfig(configFilePath);
             lockDataDirectory(config);
@@ -509,6 +991,7 @@ int main(int argc, char * argv[]) {
                 HashIndexCreator db(config, config.dataConfig.hashIndexFilePath());
                 updateHashDB(config, db);
             }
+            updateOptionalIndexes(config);
             unlockDataDirectory(config);
             break;
         }
@@ -545,6 +1028,105 @@ int main(int argc, char * argv[]) {
             break;
         }
 
+        case mode::compressColumns: {
+            auto config = getBaseConfig(configFilePath);
+            lockDataDirectory(config);
+            compressChainColumns(config);
+            unlockDataDirectory(config);
+            break;
+        }
+        
+        case mode::shareBase: {
+            auto config = getBaseConfig(configFilePath);
+            lockDataDirectory(config);
+            shareBase(config, filesystem::path{baseDirectoryString});
+            unlockDataDirectory(config);
+            break;
+        }
+        
+        case mode::synthesizeChain: {
+            filesystem::path coinDirectory{syntheticCoinDirectory};
+            filesystem::path dataDirectoryPath{syntheticDataDirectory};
+            for (auto &directory : {coinDirectory, dataDirectoryPath}) {
+                if (!directory.exists()) {
+                    filesystem::create_directory(directory);
+                }
+            }
+            coinDirectory = coinDirectory.make_absolute();
+            dataDirectoryPath = dataDirectoryPath.make_absolute();
+            
+            auto diskConfig = ChainDiskConfiguration::bitcoinRegtest(coinDirectory.str());
+            auto start = std::chrono::steady_clock::now();
+            auto stats = synthesizeChain(coinDirectory, diskConfig.blockMagic, syntheticOptions);
+            auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "Wrote " << stats.blocks << " blocks with " << stats.txes << " txes, " << stats.inputs << " inputs and " << stats.outputs << " outputs (" << stats.bytes / (1024 * 1024) << " MB in " << stats.blockFiles << " block files) in " << seconds << " seconds\n";
+            
+            // Parse it like a bitcoin_regtest chain and record the per-stage timings of the pipeline
+            auto chainConfig = blocksci::ChainConfiguration::bitcoinRegtest(dataDirectoryPath.str());
+            chainConfig.coinName = "bitcoin_regtest";
+            json parser = {
+                {"maxBlockNum", 0},
+                {"disk", diskConfig},
+                {"telemetry", {{"path", (dataDirectoryPath/"parser_telemetry.json").str()}, {"format", "json"}, {"interval", 5}}}
+            };
+            json jsonConf = {
+                {"version", blocksci::dataVersion},
+                {"chainConfig", chainConfig},
+                {"parser", parser}
+            };
+            std::ofstream rawConf(configFilePath.str());
+            rawConf << std::setw(4) << jsonConf;
+            break;
+        }
+        
+        case mode::buildOutputColumns: {
+            auto config = getBaseConfig(configFilePath);
+            lockDataDirectory(config);
+            updateOutputColumns(config);
+            unlockDataDirectory(config);
+            break;
+        }
+        
+        case mode::buildAddressStats: {
+            auto config = getBaseConfig(configFilePath);
+            lockDataDirectory(config);
+            updateAddressStats(config);
+            unlockDataDirectory(config);
+            break;
+        }
+        
+        case mode::buildEquivClasses: {
+            auto config = getBaseConfig(configFilePath);
+            lockDataDirectory(config);
+            updateEquivClasses(config);
+            unlockDataDirectory(config);
+            break;
+        }
+        
+        case mode::buildNulldataIndex: {
+            auto config = getBaseConfig(configFilePath);
+            lockDataDirectory(config);
+            updateNulldataIndex(config);
+            unlockDataDirectory(config);
+            break;
+        }
+        
+        case mode::buildAddressFilters: {
+            auto config = getBaseConfig(configFilePath);
+            lockDataDirectory(config);
+            updateBlockAddressFilters(config);
+            unlockDataDirectory(config);
+            break;
+        }
+        
+        case mode::buildTxHashOrder: {
+            auto config = getBaseConfig(configFilePath);
+            lockDataDirectory(config);
+            updateTxHashOrder(config, true);
+            unlockDataDirectory(config);
+            break;
+        }
+
         case mode::doctor: {
             auto doctor = BlockSciDoctor(configFilePath);
             doctor.checkDiskSpace();
@@ -554,6 +1136,8 @@ int main(int argc, char * argv[]) {
             std::cout << std::endl;
             doctor.rebuildChainIndex();
             std::cout << std::endl;
+            doctor.planResources();
+            std::cout << std::endl;
             doctor.printResults();
             break;
         }
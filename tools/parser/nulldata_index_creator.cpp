@@ -0,0 +1,24 @@
+//
+//  nulldata_index_creator.cpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include "nulldata_index_creator.hpp"
+
+NulldataIndexCreator::NulldataIndexCreator(const ParserConfigurationBase &config_, const filesystem::path &directory_) : ParserIndex(config_, "nulldataIndex"), directory(directory_) {
+    // Start over if the index files were removed
+    if (!blocksci::NulldataPrefixIndex::exists(directory)) {
+        latestState = blocksci::State{};
+    }
+}
+
+NulldataIndexCreator::~NulldataIndexCreator() {
+    blocksci::NulldataPrefixIndex::addEntries(directory, std::move(entries));
+}
+
+void NulldataIndexCreator::rollback(const blocksci::State &state) {
+    blocksci::NulldataPrefixIndex::removeEntriesFrom(directory, state.txCount);
+    rollbackProgress(state);
+}
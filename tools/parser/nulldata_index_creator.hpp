@@ -0,0 +1,56 @@
+//
+//  nulldata_index_creator.hpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef nulldata_index_creator_hpp
+#define nulldata_index_creator_hpp
+
+#include "parser_fwd.hpp"
+#include "parser_index.hpp"
+
+#include <internal/nulldata_prefix_index.hpp>
+
+#include <vector>
+
+class NulldataIndexCreator;
+
+template<blocksci::DedupAddressType::Enum type>
+struct ParserIndexScriptInfo<NulldataIndexCreator, type> : std::false_type {};
+
+template<>
+struct ParserIndexScriptInfo<NulldataIndexCreator, blocksci::DedupAddressType::NULL_DATA> : std::true_type {};
+
+/** Optional index of the payload prefixes of all nulldata scripts, @see blocksci::NulldataPrefixIndex
+ *
+ * Every nulldata output has its own script, so the index is filled from the new scripts of every update.
+ */
+class NulldataIndexCreator : public ParserIndex<NulldataIndexCreator> {
+    filesystem::path directory;
+    std::vector<blocksci::NulldataPrefixIndex::Entry> entries;
+    
+public:
+    NulldataIndexCreator(const ParserConfigurationBase &config, const filesystem::path &directory);
+    
+    /** Writes the entries collected by the update */
+    ~NulldataIndexCreator();
+    
+    void processTx(const blocksci::RawTransaction *, uint32_t, const blocksci::ChainAccess &, const blocksci::ScriptAccess &) {}
+    
+    template<blocksci::DedupAddressType::Enum type>
+    void processScript(uint32_t, const blocksci::ScriptAccess &);
+    
+    /** Remove the entries of the scripts beyond state after the chain was rolled back to it */
+    void rollback(const blocksci::State &state);
+};
+
+template<>
+inline void NulldataIndexCreator::processScript<blocksci::DedupAddressType::NULL_DATA>(uint32_t scriptNum, const blocksci::ScriptAccess &scripts) {
+    auto nulldata = scripts.getScriptData<blocksci::DedupAddressType::NULL_DATA>(scriptNum);
+    auto key = blocksci::NulldataPrefixIndex::makeKey(nulldata->rawData.begin(), nulldata->rawData.size());
+    entries.push_back({key, scriptNum, nulldata->txFirstSeen});
+}
+
+#endif /* nulldata_index_creator_hpp */
@@ -0,0 +1,356 @@
+//
+//  output_column_writer.cpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include "output_column_writer.hpp"
+#include "parser_configuration.hpp"
+
+#include <internal/chain_access.hpp>
+#include <internal/file_mapper.hpp>
+#include <internal/progress_bar.hpp>
+#include <internal/script_access.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+namespace {
+    /** Resume point of a column indexed by output number: the first tx whose outputs are not all covered by the first
+     * covered entries */
+    uint32_t firstUncoveredTx(const blocksci::ChainAccess &chain, uint64_t covered) {
+        uint32_t firstTx = 0;
+        uint32_t lastTx = static_cast<uint32_t>(chain.txCount());
+        while (firstTx < lastTx) {
+            auto mid = firstTx + (lastTx - firstTx) / 2;
+            if (chain.getFirstOutputNumber(mid) + chain.getTx(mid)->outputCount <= covered) {
+                firstTx = mid + 1;
+            } else {
+                lastTx = mid;
+            }
+        }
+        return firstTx;
+    }
+    
+    blocksci::OffsetType firstOutputOf(const blocksci::ChainAccess &chain, uint32_t txNum) {
+        return static_cast<blocksci::OffsetType>(txNum < chain.txCount() ? chain.getFirstOutputNumber(txNum) : chain.outputCount());
+    }
+    
+    /** Extend output_spending_input.dat to cover all outputs in the chain
+     *
+     * Every tx first records the position of each of its inputs at the outputs they spend, which all belong to earlier
+     * txes, and only then appends its own outputs as unspent. So if the column covers the outputs of a tx, the inputs of
+     * that tx have been recorded as well, and an interrupted update resumes at the first uncovered tx.
+     */
+    void updateSpendingInputColumn(const blocksci::ChainAccess &chain, const filesystem::path &chainDirectory) {
+        blocksci::FixedSizeFileMapper<uint16_t, mio::access_mode::write> spendingInputFile{blocksci::ChainAccess::outputSpendingInputFilePath(chainDirectory)};
+        spendingInputFile.usePreallocatedGrowth();
+        
+        uint32_t txCount = static_cast<uint32_t>(chain.txCount());
+        auto firstTx = firstUncoveredTx(chain, static_cast<uint64_t>(spendingInputFile.size()));
+        spendingInputFile.truncate(firstOutputOf(chain, firstTx));
+        spendingInputFile.seekEnd();
+        
+        if (firstTx == txCount) {
+            return;
+        }
+        
+        std::cout << "Updating spending input column\n";
+        const uint16_t unspent = blocksci::ChainAccess::NoSpendingInput;
+        auto progressBar = blocksci::makeProgressBar(txCount - firstTx, [=]() {});
+        for (uint32_t txNum = firstTx; txNum < txCount; txNum++) {
+            auto tx = chain.getTx(txNum);
+            auto spentOutNums = chain.getSpentOutputNumbers(txNum);
+            for (uint16_t i = 0; i < tx->inputCount; i++) {
+                auto outputNum = chain.getFirstOutputNumber(tx->getInput(i).getLinkedTxNum()) + spentOutNums[i];
+                *spendingInputFile[static_cast<blocksci::OffsetType>(outputNum)] = i;
+            }
+            for (uint16_t i = 0; i < tx->outputCount; i++) {
+                spendingInputFile.write(unspent);
+            }
+            progressBar.update(txNum - firstTx);
+        }
+    }
+    
+    /** Extend output_spending_height.dat to cover all outputs in the chain, resuming like updateSpendingInputColumn */
+    void updateSpendingHeightColumn(const blocksci::ChainAccess &chain, const filesystem::path &chainDirectory) {
+        blocksci::FixedSizeFileMapper<uint32_t, mio::access_mode::write> spendingHeightFile{blocksci::ChainAccess::outputSpendingHeightFilePath(chainDirectory)};
+        spendingHeightFile.usePreallocatedGrowth();
+        
+        uint32_t txCount = static_cast<uint32_t>(chain.txCount());
+        auto firstTx = firstUncoveredTx(chain, static_cast<uint64_t>(spendingHeightFile.size()));
+        spendingHeightFile.truncate(firstOutputOf(chain, firstTx));
+        spendingHeightFile.seekEnd();
+        
+        if (firstTx == txCount) {
+            return;
+        }
+        
+        std::cout << "Updating spending height column\n";
+        const uint32_t unspent = blocksci::ChainAccess::NoSpendingHeight;
+        auto height = chain.getBlockHeight(firstTx);
+        auto blockEnd = chain.getBlock(height)->firstTxIndex + chain.getBlock(height)->txCount;
+        auto progressBar = blocksci::makeProgressBar(txCount - firstTx, [=]() {});
+        for (uint32_t txNum = firstTx; txNum < txCount; txNum++) {
+            while (txNum >= blockEnd) {
+                height++;
+                blockEnd = chain.getBlock(height)->firstTxIndex + chain.getBlock(height)->txCount;
+            }
+            auto tx = chain.getTx(txNum);
+            auto spentOutNums = chain.getSpentOutputNumbers(txNum);
+            for (uint16_t i = 0; i < tx->inputCount; i++) {
+                auto outputNum = chain.getFirstOutputNumber(tx->getInput(i).getLinkedTxNum()) + spentOutNums[i];
+                *spendingHeightFile[static_cast<blocksci::OffsetType>(outputNum)] = static_cast<uint32_t>(height);
+            }
+            for (uint16_t i = 0; i < tx->outputCount; i++) {
+                spendingHeightFile.write(unspent);
+            }
+            progressBar.update(txNum - firstTx);
+        }
+    }
+    
+    /** Extend chain/tx_fee.dat and chain/tx_vsize.dat to cover all txes
+     *
+     * Both only depend on the tx itself, so the columns resume at the first tx not covered by both. */
+    void updateTxFeeColumns(const blocksci::ChainAccess &chain, const filesystem::path &chainDirectory) {
+        blocksci::FixedSizeFileMapper<int64_t, mio::access_mode::write> feeFile{blocksci::ChainAccess::txFeeFilePath(chainDirectory)};
+        blocksci::FixedSizeFileMapper<uint32_t, mio::access_mode::write> virtualSizeFile{blocksci::ChainAccess::txVirtualSizeFilePath(chainDirectory)};
+        feeFile.usePreallocatedGrowth();
+        virtualSizeFile.usePreallocatedGrowth();
+        
+        uint32_t txCount = static_cast<uint32_t>(chain.txCount());
+        auto firstTx = std::min({static_cast<uint32_t>(feeFile.size()), static_cast<uint32_t>(virtualSizeFile.size()), txCount});
+        feeFile.truncate(firstTx);
+        virtualSizeFile.truncate(firstTx);
+        feeFile.seekEnd();
+        virtualSizeFile.seekEnd();
+        
+        if (firstTx == txCount) {
+            return;
+        }
+        
+        std::cout << "Updating fee columns\n";
+        auto progressBar = blocksci::makeProgressBar(txCount - firstTx, [=]() {});
+        for (uint32_t txNum = firstTx; txNum < txCount; txNum++) {
+            auto tx = chain.getTx(txNum);
+            int64_t fee = 0;
+            if (tx->inputCount > 0) {
+                for (auto input = tx->beginInputs(); input != tx->endInputs(); ++input) {
+                    fee += input->getValue();
+                }
+                for (auto output = tx->beginOutputs(); output != tx->endOutputs(); ++output) {
+                    fee -= output->getValue();
+                }
+            }
+            feeFile.write(fee);
+            virtualSizeFile.write((tx->realSize + 3 * tx->baseSize + 3) / 4);
+            progressBar.update(txNum - firstTx);
+        }
+    }
+    
+    /** Extend chain/input_spent_height.dat, chain/input_spent_value.dat and chain/block_coin_age.dat to cover all blocks
+     *
+     * The entry of a block is written after those of its inputs, so the update resumes at the first block without an
+     * entry whose inputs are all covered. */
+    void updateCoinAgeColumns(const blocksci::ChainAccess &chain, const filesystem::path &chainDirectory) {
+        blocksci::FixedSizeFileMapper<uint32_t, mio::access_mode::write> spentHeightFile{blocksci::ChainAccess::inputSpentHeightFilePath(chainDirectory)};
+        blocksci::FixedSizeFileMapper<int64_t, mio::access_mode::write> spentValueFile{blocksci::ChainAccess::inputSpentValueFilePath(chainDirectory)};
+        blocksci::FixedSizeFileMapper<blocksci::BlockCoinAge, mio::access_mode::write> blockCoinAgeFile{blocksci::ChainAccess::blockCoinAgeFilePath(chainDirectory)};
+        spentHeightFile.usePreallocatedGrowth();
+        spentValueFile.usePreallocatedGrowth();
+        
+        auto firstInputOfBlock = [&](blocksci::BlockHeight height) -> uint64_t {
+            auto txNum = chain.getBlock(height)->firstTxIndex;
+            return txNum < chain.txCount() ? chain.getFirstInputNumber(txNum) : chain.inputCount();
+        };
+        auto blockCount = chain.blockCount();
+        auto coveredInputs = static_cast<uint64_t>(std::min(spentHeightFile.size(), spentValueFile.size()));
+        auto firstBlock = std::min(static_cast<blocksci::BlockHeight>(blockCoinAgeFile.size()), blockCount);
+        while (firstBlock > 0 && (firstBlock == blockCount ? chain.inputCount() : firstInputOfBlock(firstBlock)) > coveredInputs) {
+            firstBlock--;
+        }
+        blockCoinAgeFile.truncate(static_cast<blocksci::OffsetType>(firstBlock));
+        blockCoinAgeFile.seekEnd();
+        auto firstInput = firstBlock == blockCount ? chain.inputCount() : firstInputOfBlock(firstBlock);
+        spentHeightFile.truncate(static_cast<blocksci::OffsetType>(firstInput));
+        spentValueFile.truncate(static_cast<blocksci::OffsetType>(firstInput));
+        spentHeightFile.seekEnd();
+        spentValueFile.seekEnd();
+        
+        if (firstBlock == blockCount) {
+            return;
+        }
+        
+        std::cout << "Updating coin age columns\n";
+        std::vector<uint32_t> spentTxNums;
+        auto progressBar = blocksci::makeProgressBar(blockCount - firstBlock, [=]() {});
+        for (auto height = firstBlock; height < blockCount; height++) {
+            auto block = chain.getBlock(height);
+            spentTxNums.clear();
+            for (uint32_t txNum = block->firstTxIndex; txNum < block->firstTxIndex + block->txCount; txNum++) {
+                auto tx = chain.getTx(txNum);
+                for (uint16_t i = 0; i < tx->inputCount; i++) {
+                    spentTxNums.push_back(tx->getInput(i).getLinkedTxNum());
+                }
+            }
+            auto spentHeights = chain.getBlockHeights(spentTxNums);
+            
+            blocksci::BlockCoinAge age{};
+            size_t inputNum = 0;
+            for (uint32_t txNum = block->firstTxIndex; txNum < block->firstTxIndex + block->txCount; txNum++) {
+                auto tx = chain.getTx(txNum);
+                for (uint16_t i = 0; i < tx->inputCount; i++) {
+                    auto value = tx->getInput(i).getValue();
+                    auto spentHeight = spentHeights[inputNum++];
+                    auto spentTimestamp = chain.getBlock(spentHeight)->timestamp;
+                    auto ageSeconds = block->timestamp > spentTimestamp ? block->timestamp - spentTimestamp : 0;
+                    spentHeightFile.write(static_cast<uint32_t>(spentHeight));
+                    spentValueFile.write(value);
+                    age.spentValue += value;
+                    age.coinDaysDestroyed += static_cast<double>(value) / 1e8 * ageSeconds / 86400.0;
+                    age.totalInputAge += static_cast<uint64_t>(height - spentHeight);
+                }
+            }
+            age.inputCount = static_cast<uint32_t>(spentTxNums.size());
+            blockCoinAgeFile.write(age);
+            progressBar.update(static_cast<uint32_t>(height - firstBlock));
+        }
+    }
+    
+    /** Extend the header columns of the scripts (scripts/<type>_first_seen.dat, scripts/<type>_first_spent.dat and
+     * scripts/<type>_types_seen.dat) to cover all scripts
+     *
+     * The first seen tx of a script can only decrease while the update that created it is running, so the values of
+     * scripts from earlier updates never change and only new scripts are appended. Scripts from earlier updates can be
+     * spent or seen as new address types by any later one (and undone blocks can revert that), so the other two
+     * columns are compared against the script data in a single pass and only entries that changed are rewritten. */
+    void updateScriptHeaderColumns(const filesystem::path &scriptsDirectory) {
+        using ColumnFile = blocksci::FixedSizeFileMapper<uint32_t, mio::access_mode::write>;
+        blocksci::ScriptAccess scripts{scriptsDirectory};
+        for (size_t i = 0; i < blocksci::DedupAddressType::size; i++) {
+            auto type = static_cast<blocksci::DedupAddressType::Enum>(i);
+            ColumnFile firstSeenFile{blocksci::ScriptAccess::firstSeenFilePath(scriptsDirectory, type)};
+            ColumnFile firstSpentFile{blocksci::ScriptAccess::firstSpentFilePath(scriptsDirectory, type)};
+            ColumnFile typesSeenFile{blocksci::ScriptAccess::typesSeenFilePath(scriptsDirectory, type)};
+            auto scriptCount = scripts.scriptCount(type);
+            auto covered = std::min(static_cast<uint32_t>(firstSeenFile.size()), scriptCount);
+            firstSeenFile.truncate(covered);
+            firstSeenFile.seekEnd();
+            auto refreshed = std::min({static_cast<uint32_t>(firstSpentFile.size()), static_cast<uint32_t>(typesSeenFile.size()), scriptCount});
+            firstSpentFile.truncate(refreshed);
+            typesSeenFile.truncate(refreshed);
+            for (uint32_t scriptNum = 1; scriptNum <= refreshed; scriptNum++) {
+                auto header = scripts.getScriptHeader(scriptNum, type);
+                auto firstSpent = firstSpentFile[scriptNum - 1];
+                if (*firstSpent != header->txFirstSpent) {
+                    *firstSpent = header->txFirstSpent;
+                }
+                auto typesSeen = typesSeenFile[scriptNum - 1];
+                if (*typesSeen != header->typesSeen) {
+                    *typesSeen = header->typesSeen;
+                }
+            }
+            firstSpentFile.seekEnd();
+            typesSeenFile.seekEnd();
+            for (uint32_t scriptNum = std::min(covered, refreshed) + 1; scriptNum <= scriptCount; scriptNum++) {
+                auto header = scripts.getScriptHeader(scriptNum, type);
+                if (scriptNum > covered) {
+                    firstSeenFile.write(header->txFirstSeen);
+                }
+                if (scriptNum > refreshed) {
+                    firstSpentFile.write(header->txFirstSpent);
+                    typesSeenFile.write(header->typesSeen);
+                }
+            }
+        }
+    }
+}
+
+bool outputColumnsExist(const ParserConfigurationBase &config) {
+    return filesystem::path{blocksci::ChainAccess::outputValueFilePath(config.dataConfig.chainDirectory()).str() + ".dat"}.exists();
+}
+
+void updateOutputColumns(const ParserConfigurationBase &config) {
+    auto chainDirectory = config.dataConfig.chainDirectory();
+    blocksci::ChainAccess chain{chainDirectory, 0, false};
+    
+    blocksci::FixedSizeFileMapper<int64_t, mio::access_mode::write> valueFile{blocksci::ChainAccess::outputValueFilePath(chainDirectory)};
+    blocksci::FixedSizeFileMapper<uint8_t, mio::access_mode::write> typeFile{blocksci::ChainAccess::outputTypeFilePath(chainDirectory)};
+    blocksci::FixedSizeFileMapper<uint32_t, mio::access_mode::write> addressFile{blocksci::ChainAccess::outputAddressFilePath(chainDirectory)};
+    blocksci::FixedSizeFileMapper<uint32_t, mio::access_mode::write> spentTxFile{blocksci::ChainAccess::outputSpentTxFilePath(chainDirectory)};
+    valueFile.usePreallocatedGrowth();
+    typeFile.usePreallocatedGrowth();
+    addressFile.usePreallocatedGrowth();
+    spentTxFile.usePreallocatedGrowth();
+    
+    // Resume at the first transaction whose outputs are not fully covered by all columns
+    auto covered = static_cast<uint64_t>(std::min({valueFile.size(), typeFile.size(), addressFile.size(), spentTxFile.size()}));
+    uint32_t txCount = static_cast<uint32_t>(chain.txCount());
+    auto firstTx = firstUncoveredTx(chain, covered);
+    auto startOutput = firstOutputOf(chain, firstTx);
+    valueFile.truncate(startOutput);
+    typeFile.truncate(startOutput);
+    addressFile.truncate(startOutput);
+    spentTxFile.truncate(startOutput);
+    valueFile.seekEnd();
+    typeFile.seekEnd();
+    addressFile.seekEnd();
+    spentTxFile.seekEnd();
+    
+    if (firstTx < txCount) {
+        std::cout << "Updating output columns\n";
+        auto progressBar = blocksci::makeProgressBar(txCount - firstTx, [=]() {});
+        for (uint32_t txNum = firstTx; txNum < txCount; txNum++) {
+            auto tx = chain.getTx(txNum);
+            for (uint16_t i = 0; i < tx->outputCount; i++) {
+                auto &output = tx->getOutput(i);
+                valueFile.write(output.getValue());
+                typeFile.write(static_cast<uint8_t>(output.getType()));
+                addressFile.write(output.getAddressNum());
+                spentTxFile.write(output.getLinkedTxNum());
+            }
+            progressBar.update(txNum - firstTx);
+        }
+    }
+    
+    updateSpendingInputColumn(chain, chainDirectory);
+    updateSpendingHeightColumn(chain, chainDirectory);
+    updateTxFeeColumns(chain, chainDirectory);
+    updateCoinAgeColumns(chain, chainDirectory);
+    updateScriptHeaderColumns(config.dataConfig.scriptsDirectory());
+}
+
+void resetSpentOutputs(const ParserConfigurationBase &config, const std::vector<uint64_t> &outputNums) {
+    if (!outputColumnsExist(config) || outputNums.empty()) {
+        return;
+    }
+    auto chainDirectory = config.dataConfig.chainDirectory();
+    blocksci::FixedSizeFileMapper<uint32_t, mio::access_mode::write> spentTxFile{blocksci::ChainAccess::outputSpentTxFilePath(chainDirectory)};
+    blocksci::FixedSizeFileMapper<uint16_t, mio::access_mode::write> spendingInputFile{blocksci::ChainAccess::outputSpendingInputFilePath(chainDirectory)};
+    blocksci::FixedSizeFileMapper<uint32_t, mio::access_mode::write> spendingHeightFile{blocksci::ChainAccess::outputSpendingHeightFilePath(chainDirectory)};
+    for (auto outputNum : outputNums) {
+        auto offset = static_cast<blocksci::OffsetType>(outputNum);
+        if (offset < spentTxFile.size()) {
+            *spentTxFile[offset] = 0;
+        }
+        if (offset < spendingInputFile.size()) {
+            *spendingInputFile[offset] = blocksci::ChainAccess::NoSpendingInput;
+        }
+        if (offset < spendingHeightFile.size()) {
+            *spendingHeightFile[offset] = blocksci::ChainAccess::NoSpendingHeight;
+        }
+    }
+}
+
+void truncateCoinAgeColumns(const ParserConfigurationBase &config, blocksci::BlockHeight splitPoint) {
+    auto path = blocksci::ChainAccess::blockCoinAgeFilePath(config.dataConfig.chainDirectory());
+    if (!filesystem::path{path.str() + ".dat"}.exists()) {
+        return;
+    }
+    blocksci::FixedSizeFileMapper<blocksci::BlockCoinAge, mio::access_mode::write> blockCoinAgeFile{path};
+    if (static_cast<blocksci::BlockHeight>(blockCoinAgeFile.size()) > splitPoint) {
+        blockCoinAgeFile.truncate(static_cast<blocksci::OffsetType>(splitPoint));
+    }
+}
@@ -0,0 +1,44 @@
+//
+//  output_column_writer.hpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef output_column_writer_hpp
+#define output_column_writer_hpp
+
+#include "parser_fwd.hpp"
+
+#include <blocksci/core/typedefs.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/** Check whether the optional output columns (chain/output_*.dat) have been created */
+bool outputColumnsExist(const ParserConfigurationBase &config);
+
+/** Create the output columns or extend them to cover all outputs in the chain
+ *
+ * Values, types and addresses never change once written, so an existing column set is only extended. The spending tx
+ * of outputs that are already covered is kept up to date by backUpdateTxes, new outputs take it from tx_data.dat.
+ * Also extends chain/output_spending_input.dat, which records the input position of the spending input of each output,
+ * chain/output_spending_height.dat with the block height of the spending tx of each output, the fee and virtual size
+ * of each tx (chain/tx_fee.dat, chain/tx_vsize.dat), the coin age columns of the inputs and blocks
+ * (chain/input_spent_height.dat, chain/input_spent_value.dat, chain/block_coin_age.dat) and the header columns of the
+ * scripts (scripts/<type>_first_seen.dat, scripts/<type>_first_spent.dat, scripts/<type>_types_seen.dat).
+ */
+void updateOutputColumns(const ParserConfigurationBase &config);
+
+/** Mark the given outputs as unspent again in the spending columns after the blocks spending them were undone
+ *
+ * Entries of the undone outputs themselves are dropped by the next updateOutputColumns. */
+void resetSpentOutputs(const ParserConfigurationBase &config, const std::vector<uint64_t> &outputNums);
+
+/** Drop the coin age statistics of the blocks from splitPoint on, used when these blocks are undone
+ *
+ * The input columns of the undone blocks are dropped by the next updateOutputColumns, which resumes at the first block
+ * without statistics. */
+void truncateCoinAgeColumns(const ParserConfigurationBase &config, blocksci::BlockHeight splitPoint);
+
+#endif /* output_column_writer_hpp */
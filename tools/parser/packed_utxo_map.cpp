@@ -0,0 +1,137 @@
+//
+//  packed_utxo_map.cpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "packed_utxo_map.hpp"
+
+#include <cstring>
+#include <utility>
+#include <unordered_map>
+
+blocksci::uint256 PackedUTXOMap::filledKey(unsigned char byte) {
+    blocksci::uint256 key;
+    std::memset(key.begin(), byte, key.size());
+    return key;
+}
+
+// No transaction hashes to all zero or all one bits, and no transaction gets the largest txNum
+PackedUTXOMap::PackedUTXOMap() : txes(filledKey(0xFF), filledKey(0)), extras({std::numeric_limits<uint32_t>::max(), 0}, {std::numeric_limits<uint32_t>::max(), 1}) {}
+
+/* Like the map keyed by RawOutputPointer, adding an output that is already unspent keeps the existing UTXO. The
+ * outputs of a transaction whose txid duplicates an unspent one (BIP30) get the txNum of the first transaction. */
+void PackedUTXOMap::add(const RawOutputPointer &pointer, const UTXO &utxo) {
+    auto it = txes.find(pointer.hash);
+    if (it == txes.end()) {
+        txes.add(pointer.hash, TxUTXOs{pack(utxo), utxo.txNum, pointer.outputNum, 0});
+        utxoCount++;
+        return;
+    }
+    auto &tx = it->second;
+    if (tx.outputNum == pointer.outputNum) {
+        return;
+    }
+    if (tx.outputNum == noOutput) {
+        tx.outputNum = pointer.outputNum;
+        tx.packed = pack(utxo);
+        utxoCount++;
+        return;
+    }
+    blocksci::InoutPointer extraKey{tx.txNum, pointer.outputNum};
+    if (extras.find(extraKey) != extras.end()) {
+        return;
+    }
+    extras.add(extraKey, pack(utxo));
+    tx.extraCount++;
+    utxoCount++;
+}
+
+bool PackedUTXOMap::take(const RawOutputPointer &pointer, UTXO &utxo) {
+    auto it = txes.find(pointer.hash);
+    if (it == txes.end()) {
+        return false;
+    }
+    auto &tx = it->second;
+    if (tx.outputNum == pointer.outputNum) {
+        utxo = unpack(tx.packed, tx.txNum);
+        tx.outputNum = noOutput;
+    } else {
+        auto extraIt = extras.find(blocksci::InoutPointer{tx.txNum, pointer.outputNum});
+        if (extraIt == extras.end()) {
+            return false;
+        }
+        utxo = unpack(extraIt->second, tx.txNum);
+        extras.erase(extraIt);
+        tx.extraCount--;
+    }
+    if (tx.outputNum == noOutput && tx.extraCount == 0) {
+        txes.erase(it);
+    }
+    utxoCount--;
+    return true;
+}
+
+bool PackedUTXOMap::find(const RawOutputPointer &pointer, UTXO &utxo) const {
+    auto it = txes.find(pointer.hash);
+    if (it == txes.end()) {
+        return false;
+    }
+    auto &tx = it->second;
+    if (tx.outputNum == pointer.outputNum) {
+        utxo = unpack(tx.packed, tx.txNum);
+        return true;
+    }
+    auto extraIt = extras.find(blocksci::InoutPointer{tx.txNum, pointer.outputNum});
+    if (extraIt == extras.end()) {
+        return false;
+    }
+    utxo = unpack(extraIt->second, tx.txNum);
+    return true;
+}
+
+void PackedUTXOMap::evictBefore(uint32_t cutoffTxNum, std::vector<std::pair<RawOutputPointer, UTXO>> &evicted) {
+    PackedUTXOMap kept;
+    std::unordered_map<uint32_t, blocksci::uint256> evictedHashes;
+    for (auto &entry : txes) {
+        auto &tx = entry.second;
+        if (tx.txNum < cutoffTxNum) {
+            if (tx.outputNum != noOutput) {
+                evicted.emplace_back(RawOutputPointer{entry.first, tx.outputNum}, unpack(tx.packed, tx.txNum));
+            }
+            if (tx.extraCount > 0) {
+                evictedHashes.emplace(tx.txNum, entry.first);
+            }
+        } else {
+            kept.txes.add(entry.first, tx);
+            kept.utxoCount += (tx.outputNum != noOutput ? 1 : 0) + tx.extraCount;
+        }
+    }
+    for (auto &entry : extras) {
+        if (entry.first.txNum < cutoffTxNum) {
+            auto &hash = evictedHashes.at(entry.first.txNum);
+            evicted.emplace_back(RawOutputPointer{hash, entry.first.inoutNum}, unpack(entry.second, entry.first.txNum));
+        } else {
+            kept.extras.add(entry.first, entry.second);
+        }
+    }
+    txes.swap(kept.txes);
+    extras.swap(kept.extras);
+    std::swap(utxoCount, kept.utxoCount);
+}
+
+bool PackedUTXOMap::serialize(std::ostream &file) {
+    return txes.serialize(file) && extras.serialize(file);
+}
+
+void PackedUTXOMap::unserialize(std::istream &file, const std::string &path) {
+    txes.unserialize(file, path);
+    extras.unserialize(file, path);
+    utxoCount = extras.size();
+    for (auto &entry : txes) {
+        if (entry.second.outputNum != noOutput) {
+            utxoCount++;
+        }
+    }
+}
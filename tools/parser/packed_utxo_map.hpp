@@ -0,0 +1,114 @@
+//
+//  packed_utxo_map.hpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef packed_utxo_map_hpp
+#define packed_utxo_map_hpp
+
+#include "serializable_map.hpp"
+#include "basic_types.hpp"
+#include "utxo.hpp"
+
+#include <blocksci/core/inout_pointer.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/** UTXOs keyed by transaction instead of by output
+ *
+ * A map keyed by RawOutputPointer repeats the 32 byte txid for every unspent output of a transaction. Here the txid
+ * is stored once, together with the txNum and one of its unspent outputs. The other unspent outputs of the
+ * transaction are kept in a second map keyed by (txNum, outputNum), which takes 16 bytes per output. Values and
+ * types are packed into 64 bits like Inout::other, with the value in the low 60 bits and the type in the high 4 bits.
+ *
+ * An output costs 48 bytes if it is the only unspent output of its transaction and 16 bytes otherwise, instead of
+ * 56 bytes for an entry of SerializableMap<RawOutputPointer, UTXO>.
+ */
+class PackedUTXOMap {
+    static constexpr uint16_t noOutput = std::numeric_limits<uint16_t>::max();
+    static constexpr uint64_t valueMask = (uint64_t(1) << 60) - 1;
+
+    struct TxUTXOs {
+        /** Packed value and type of the output held inline */
+        uint64_t packed;
+        uint32_t txNum;
+        /** Output held inline, noOutput once it was spent while other outputs of the transaction are unspent */
+        uint16_t outputNum;
+        /** Unspent outputs of the transaction in the extra map */
+        uint16_t extraCount;
+    };
+
+    SerializableMap<blocksci::uint256, TxUTXOs> txes;
+    SerializableMap<blocksci::InoutPointer, uint64_t> extras;
+    size_t utxoCount = 0;
+
+    static uint64_t pack(const UTXO &utxo) {
+        return (static_cast<uint64_t>(utxo.value) & valueMask) | (uint64_t{static_cast<uint8_t>(utxo.type)} << 60);
+    }
+
+    static UTXO unpack(uint64_t packed, uint32_t txNum) {
+        return {static_cast<int64_t>(packed & valueMask), txNum, static_cast<blocksci::AddressType::Enum>(packed >> 60)};
+    }
+
+    static blocksci::uint256 filledKey(unsigned char byte);
+
+public:
+    /** Magic of the files written by serialize() */
+    static constexpr uint64_t formatMagic = 0x4B4341504F585455; // "UTXOPACK"
+
+    PackedUTXOMap();
+
+    void add(const RawOutputPointer &pointer, const UTXO &utxo);
+
+    /** Remove the UTXO of pointer and store it in utxo, returns false if the map doesn't contain it */
+    bool take(const RawOutputPointer &pointer, UTXO &utxo);
+
+    bool find(const RawOutputPointer &pointer, UTXO &utxo) const;
+
+    size_t size() const {
+        return utxoCount;
+    }
+
+    /** Call func(pointer, utxo) for every UTXO */
+    template <typename Func>
+    void forEach(Func &&func) const {
+        std::vector<std::pair<uint32_t, const blocksci::uint256 *>> txHashes;
+        for (auto &entry : txes) {
+            if (entry.second.outputNum != noOutput) {
+                func(RawOutputPointer{entry.first, entry.second.outputNum}, unpack(entry.second.packed, entry.second.txNum));
+            }
+            if (entry.second.extraCount > 0) {
+                txHashes.emplace_back(entry.second.txNum, &entry.first);
+            }
+        }
+        if (extras.size() == 0) {
+            return;
+        }
+        std::sort(txHashes.begin(), txHashes.end());
+        for (auto &entry : extras) {
+            auto it = std::lower_bound(txHashes.begin(), txHashes.end(), std::make_pair(entry.first.txNum, static_cast<const blocksci::uint256 *>(nullptr)));
+            func(RawOutputPointer{*it->second, entry.first.inoutNum}, unpack(entry.second, entry.first.txNum));
+        }
+    }
+
+    /** Remove the UTXOs created by transactions before cutoffTxNum and append them to evicted. The maps are rebuilt
+     * since dense_hash_map never shrinks on erase. */
+    void evictBefore(uint32_t cutoffTxNum, std::vector<std::pair<RawOutputPointer, UTXO>> &evicted);
+
+    /** Write both maps to file */
+    bool serialize(std::ostream &file);
+
+    /** Read maps written by serialize() from the current position of file, path is only used for errors */
+    void unserialize(std::istream &file, const std::string &path);
+};
+
+#endif /* packed_utxo_map_hpp */
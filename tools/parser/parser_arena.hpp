@@ -0,0 +1,90 @@
+//
+//  parser_arena.hpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef parser_arena_hpp
+#define parser_arena_hpp
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/** Bump allocator for the variable sized data of a transaction that is being parsed
+ *
+ * Every RawTransaction owns an arena that its per input data is allocated from. Nothing is freed individually, the
+ * whole arena is reset when the transaction is loaded again after it left the pipeline. The chunks are kept across
+ * resets (merged into a single chunk if the previous transaction needed more than one), so once a recycled transaction
+ * has seen a large enough transaction loading it no longer touches the heap.
+ *
+ * Only trivially destructible types may be allocated since destructors are never run.
+ */
+class ParserArena {
+    struct Chunk {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    static constexpr size_t minChunkSize = 1024;
+
+    std::vector<Chunk> chunks;
+    size_t chunkIndex = 0;
+    size_t offset = 0;
+
+    void *allocate(size_t bytes, size_t alignment) {
+        while (chunkIndex < chunks.size()) {
+            auto &chunk = chunks[chunkIndex];
+            size_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+            if (aligned + bytes <= chunk.size) {
+                offset = aligned + bytes;
+                return chunk.data.get() + aligned;
+            }
+            chunkIndex++;
+            offset = 0;
+        }
+        size_t lastSize = chunks.empty() ? 0 : chunks.back().size;
+        size_t size = std::max({minChunkSize, bytes + alignment, lastSize * 2});
+        chunks.push_back(Chunk{std::unique_ptr<char[]>(new char[size]), size});
+        chunkIndex = chunks.size() - 1;
+        offset = 0;
+        return allocate(bytes, alignment);
+    }
+
+public:
+    ParserArena() = default;
+    ParserArena(const ParserArena &) = delete;
+    ParserArena &operator=(const ParserArena &) = delete;
+    ParserArena(ParserArena &&) = default;
+    ParserArena &operator=(ParserArena &&) = default;
+
+    /** Uninitialized storage for count objects of type T, the caller constructs them in place */
+    template <typename T>
+    T *allocateArray(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "Arena allocated types are never destroyed");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "Arena chunks are only aligned to max_align_t");
+        if (count == 0) {
+            return nullptr;
+        }
+        return static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    /** Invalidates everything allocated from the arena */
+    void reset() {
+        if (chunks.size() > 1) {
+            size_t total = 0;
+            for (auto &chunk : chunks) {
+                total += chunk.size;
+            }
+            chunks.clear();
+            chunks.push_back(Chunk{std::unique_ptr<char[]>(new char[total]), total});
+        }
+        chunkIndex = 0;
+        offset = 0;
+    }
+};
+
+#endif /* parser_arena_hpp */
@@ -17,6 +17,8 @@
 
 #include <nlohmann/json.hpp>
 
+#include <stdexcept>
+
 using json = nlohmann::json;
 
 ParserConfigurationBase::ParserConfigurationBase() : dataConfig() {}
@@ -61,7 +63,7 @@ void ChainDiskConfiguration::resetHashFunc() {
 }
 
 void to_json(json& j, const ChainDiskConfiguration& p) {
-    j = json{{"blockMagic", p.blockMagic}, {"hashFuncName", p.hashFuncName}, {"coinDirectory", p.coinDirectory.str()}};
+    j = json{{"blockMagic", p.blockMagic}, {"hashFuncName", p.hashFuncName}, {"coinDirectory", p.coinDirectory.str()}, {"decodeThreads", p.decodeThreads}, {"indexThreads", p.indexThreads}, {"streamReadMB", p.streamReadMB}, {"useBlockIndexDb", p.useBlockIndexDb}};
 }
 
 void from_json(const json& j, ChainDiskConfiguration& p) {
@@ -70,6 +72,25 @@ void from_json(const json& j, ChainDiskConfiguration& p) {
     std::string coinDirString;
     j.at("coinDirectory").get_to(coinDirString);
     p.coinDirectory = coinDirString;
+    auto decodeThreadsIt = j.find("decodeThreads");
+    if (decodeThreadsIt != j.end()) {
+        decodeThreadsIt->get_to(p.decodeThreads);
+    }
+    auto indexThreadsIt = j.find("indexThreads");
+    if (indexThreadsIt != j.end()) {
+        indexThreadsIt->get_to(p.indexThreads);
+    }
+    auto streamReadMBIt = j.find("streamReadMB");
+    if (streamReadMBIt != j.end()) {
+        streamReadMBIt->get_to(p.streamReadMB);
+        if (p.streamReadMB != 0 && (p.streamReadMB < 64 || p.streamReadMB > 256)) {
+            throw std::invalid_argument("streamReadMB must be 0 or between 64 and 256");
+        }
+    }
+    auto useBlockIndexDbIt = j.find("useBlockIndexDb");
+    if (useBlockIndexDbIt != j.end()) {
+        useBlockIndexDbIt->get_to(p.useBlockIndexDb);
+    }
     
     p.resetHashFunc();
 }
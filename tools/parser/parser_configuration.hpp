@@ -22,6 +22,39 @@
 struct ParserConfigurationBase {
     blocksci::DataConfiguration dataConfig;
     
+    /** Maximum number of UTXOs kept in memory while parsing, older ones are moved to utxoColdStorePath(). 0 keeps
+     * the whole UTXO set in memory. Set with the optional maxUTXOsInMemory key of the parser config */
+    size_t maxUTXOsInMemory = 0;
+    
+    /** Whether to record the signature and public key of every parsed input in chain/input_signatures.dat. Set with
+     * the optional extractSignatures key of the parser config, extraction continues once the file exists */
+    bool extractSignatures = false;
+    
+    /** Maximum number of hash index rows that are waiting to be written in the background, adding rows blocks once
+     * it is reached. Set with the optional maxPendingIndexRows key of the parser config */
+    size_t maxPendingIndexRows = 2'000'000;
+    
+    /** Whether to number the scripts of a batch of transactions in two passes over partitions of it, which gives the
+     * same scriptNums as numbering them in order. Meant for full parses, batches of journaled blocks are always
+     * numbered in order. Set with the optional partitionedScriptNums key of the parser config */
+    bool partitionedScriptNums = false;
+    
+    /** Witness data recorded in the chain/witness files: nothing, only the item counts and lengths or the items too */
+    enum class WitnessRecording { None, Sizes, Full };
+    
+    /** Set with the optional recordWitnesses key ("sizes" or "full") of the parser config, recording continues in the
+     * mode of the existing files once they exist */
+    WitnessRecording recordWitnesses = WitnessRecording::None;
+    
+    enum class TelemetryFormat { Json, Prometheus };
+    
+    /** File the pipeline metrics are written to every telemetryInterval seconds while blocks are added, empty to
+     * disable them. Set with the optional telemetry section of the parser config, eg. {"path": "/var/lib/node_exporter/
+     * blocksci.prom", "format": "prometheus", "interval": 10}, @see ParserTelemetry */
+    std::string telemetryPath;
+    TelemetryFormat telemetryFormat = TelemetryFormat::Json;
+    int telemetryInterval = 10;
+    
     ParserConfigurationBase();
     ParserConfigurationBase(const blocksci::DataConfiguration &config);
 
@@ -35,6 +68,11 @@ struct ParserConfigurationBase {
         return parserDirectory()/"utxoCache.dat";
     }
 
+    // RocksDB database holding the UTXOs evicted from memory if maxUTXOsInMemory is set
+    filesystem::path utxoColdStorePath() const {
+        return parserDirectory()/"utxoCold";
+    }
+
     /* Directory that stores the serialization of the UTXOAddressState class. For each address type, this contains mapping from output
        pointers to addresses of that type to data necessary to parse the input script spending an output of that type */
     filesystem::path utxoAddressStatePath() const {
@@ -53,14 +91,21 @@ struct ParserConfigurationBase {
         return parserDirectory()/"address";
     }
 
-    /** Stores the serialized ChainIndex<ParserTag> object
+    /** Stores the serialized ChainIndex<RPCTag> object
      *
      * Main content is ChainIndex's std::unordered_map<blocksci::uint256, BlockType> blockList property
      * BlockType contains block data like the hash, height, size, no. of txes, inputCount, outputcount, CBlockHeader object
+     *
+     * The disk parser only reads it once to migrate to chainIndexDirectory()
      */
     filesystem::path blockListPath() const {
         return parserDirectory()/"blockList.dat";
     }
+    
+    /** Directory of the memory-mapped ChainIndex<FileTag>, @see ChainIndex<FileTag> */
+    filesystem::path chainIndexDirectory() const {
+        return parserDirectory()/"chainIndex";
+    }
 
     /** Stores serialized OutputLinkData, memory-mapped as blocksci::FixedSizeFileMapper<OutputLinkData>
      *
@@ -69,6 +114,11 @@ struct ParserConfigurationBase {
     std::string txUpdatesFilePath() const {
         return (parserDirectory()/"txUpdates").str();
     }
+
+    /** Directory of the undo journals of the most recent blocks, one file per block named by its height, @see BlockUndo */
+    filesystem::path undoDirectory() const {
+        return parserDirectory()/"undo";
+    }
 };
 
 #ifdef BLOCKSCI_FILE_PARSER
@@ -78,6 +128,21 @@ struct ChainDiskConfiguration {
     std::string hashFuncName;
     std::function<blocksci::uint256(const char *data, unsigned long len)> workHashFunction;
     
+    /** Number of threads decoding block files ahead of the processing pipeline, 0 picks one based on the core count */
+    uint32_t decodeThreads = 0;
+    
+    /** Number of threads scanning block files for headers when the chain index is updated, 0 uses all cores */
+    uint32_t indexThreads = 0;
+    
+    /** Read the block files with sequential reads of this many MiB (64 to 256) instead of mapping them, for block
+     * directories on network storage. 0 maps the files. The files of blocks that are still in the pipeline are held in
+     * memory in full, @see BlockFileStream */
+    uint32_t streamReadMB = 0;
+    
+    /** Take the block positions from the blocks/index LevelDB database of Bitcoin Core instead of scanning every block
+     * file. The node must not be running while the parser reads it. */
+    bool useBlockIndexDb = false;
+    
     ChainDiskConfiguration() {}
     ChainDiskConfiguration(const std::string bitcoinDir, uint32_t blockMagic_, std::string hashFuncName) : coinDirectory(bitcoinDir), blockMagic(blockMagic_), hashFuncName(std::move(hashFuncName)) {
         resetHashFunc();
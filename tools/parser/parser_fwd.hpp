@@ -38,6 +38,10 @@ struct BlockInfoBase;
 class UTXOAddressState;
 class AddressState;
 class AddressWriter;
+class WorkStealingPool;
+class PartitionedAddressResolver;
+
+struct TelemetryMetric;
 
 struct RawTransaction;
 struct RawInput;
@@ -65,6 +69,10 @@ struct SpendData;
 
 class AnySpendData;
 
+struct UndoAddressKey;
+struct BlockUndo;
+class UndoJournalWriter;
+
 struct ParserConfigurationBase;
 template <typename ParseType>
 struct ParserConfiguration;
@@ -22,6 +22,7 @@
 
 #include <wjfilesystem/path.h>
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 
@@ -50,6 +51,21 @@ public:
         outputFile << latestState;
     }
     
+    /** Forget the progress beyond state after the chain was rolled back to it, the index itself has to remove the
+     * entries of the undone transactions and scripts */
+    void rollbackProgress(const blocksci::State &state) {
+        latestState.blockCount = std::min(latestState.blockCount, state.blockCount);
+        latestState.txCount = std::min(latestState.txCount, state.txCount);
+        for (size_t i = 0; i < latestState.scriptCounts.size(); i++) {
+            latestState.scriptCounts[i] = std::min(latestState.scriptCounts[i], state.scriptCounts[i]);
+        }
+    }
+    
+    /** True if the index hasn't processed any transactions yet */
+    bool isEmpty() const {
+        return latestState.txCount == 0;
+    }
+    
     template<typename EquivType>
     void updateScript(std::true_type, EquivType type, const blocksci::State &state, const blocksci::ScriptAccess &scripts) {
         auto typeIndex = static_cast<size_t>(type);
@@ -0,0 +1,144 @@
+//
+//  parser_telemetry.cpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "parser_telemetry.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+    std::string escapeLabel(const std::string &value) {
+        std::string escaped;
+        for (auto c : value) {
+            if (c == '\\' || c == '"') {
+                escaped += '\\';
+            }
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    std::string labelString(const TelemetryMetric &metric) {
+        if (metric.labels.empty()) {
+            return "";
+        }
+        std::stringstream ss;
+        ss << "{";
+        for (size_t i = 0; i < metric.labels.size(); i++) {
+            if (i > 0) {
+                ss << ",";
+            }
+            ss << metric.labels[i].first << "=\"" << escapeLabel(metric.labels[i].second) << "\"";
+        }
+        ss << "}";
+        return ss.str();
+    }
+}
+
+ParserTelemetry::ParserTelemetry(const ParserConfigurationBase &config, std::vector<TelemetrySampler> samplers_) : path(config.telemetryPath), format(config.telemetryFormat), interval(std::max(1, config.telemetryInterval)), samplers(std::move(samplers_)), start(std::chrono::steady_clock::now()), lastSampleTime(start) {
+    if (path.empty()) {
+        return;
+    }
+    thread = std::thread([this]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            wake.wait_for(lock, interval, [this]() { return stopping; });
+            if (!stopping) {
+                writeSample();
+            }
+        }
+    });
+}
+
+ParserTelemetry::~ParserTelemetry() {
+    if (!thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    thread.join();
+    writeSample();
+}
+
+void ParserTelemetry::writeSample() {
+    auto now = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::duration<double>(now - start).count();
+    std::vector<TelemetryMetric> metrics;
+    metrics.push_back({"blocksci_parser_elapsed_seconds", "Time since the parser started adding the current batch of blocks", TelemetryMetric::Kind::Gauge, {}, elapsed});
+    for (auto &sampler : samplers) {
+        sampler(metrics);
+    }
+
+    auto rendered = format == ParserConfigurationBase::TelemetryFormat::Json ? renderJson(metrics, std::chrono::duration<double>(now - lastSampleTime).count()) : renderPrometheus(metrics);
+    lastSampleTime = now;
+
+    // Replace the file in one step so that readers never see a partial sample
+    auto tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::trunc);
+        file << rendered;
+        if (!file.good()) {
+            std::cerr << "Could not write the parser telemetry to " << tempPath << std::endl;
+            return;
+        }
+    }
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Could not replace the parser telemetry file " << path << std::endl;
+    }
+}
+
+std::string ParserTelemetry::renderJson(const std::vector<TelemetryMetric> &metrics, double sampleSeconds) {
+    std::stringstream ss;
+    ss << std::setprecision(15);
+    ss << "{\"timestamp\":" << std::time(nullptr) << ",\"metrics\":[";
+    for (size_t i = 0; i < metrics.size(); i++) {
+        auto &metric = metrics[i];
+        ss << (i > 0 ? "," : "") << "{\"name\":\"" << metric.name << "\",\"labels\":{";
+        for (size_t j = 0; j < metric.labels.size(); j++) {
+            ss << (j > 0 ? "," : "") << "\"" << metric.labels[j].first << "\":\"" << escapeLabel(metric.labels[j].second) << "\"";
+        }
+        ss << "},\"value\":" << metric.value;
+        if (metric.kind == TelemetryMetric::Kind::Counter) {
+            auto key = metric.name + labelString(metric);
+            auto it = lastCounterValues.find(key);
+            auto previous = it != lastCounterValues.end() ? it->second : 0.0;
+            ss << ",\"rate\":" << (sampleSeconds > 0 ? (metric.value - previous) / sampleSeconds : 0.0);
+            lastCounterValues[key] = metric.value;
+        }
+        ss << "}";
+    }
+    ss << "]}\n";
+    return ss.str();
+}
+
+std::string ParserTelemetry::renderPrometheus(const std::vector<TelemetryMetric> &metrics) {
+    // All samples of a metric have to follow its header
+    auto sorted = metrics;
+    std::stable_sort(sorted.begin(), sorted.end(), [](const TelemetryMetric &a, const TelemetryMetric &b) {
+        return a.name < b.name;
+    });
+    std::stringstream ss;
+    ss << std::setprecision(15);
+    std::string lastName;
+    for (auto &metric : sorted) {
+        if (metric.name != lastName) {
+            ss << "# HELP " << metric.name << " " << metric.help << "\n";
+            ss << "# TYPE " << metric.name << " " << (metric.kind == TelemetryMetric::Kind::Counter ? "counter" : "gauge") << "\n";
+            lastName = metric.name;
+        }
+        ss << metric.name << labelString(metric) << " " << metric.value << "\n";
+    }
+    return ss.str();
+}
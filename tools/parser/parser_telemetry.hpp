@@ -0,0 +1,71 @@
+//
+//  parser_telemetry.hpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef parser_telemetry_hpp
+#define parser_telemetry_hpp
+
+#include "parser_configuration.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/** One counter or gauge of the parser, rendered as a Prometheus sample or a JSON object */
+struct TelemetryMetric {
+    enum class Kind { Counter, Gauge };
+
+    std::string name;
+    std::string help;
+    Kind kind;
+    std::vector<std::pair<std::string, std::string>> labels;
+    double value;
+};
+
+/** Collects the metrics of the running parser. Called from the telemetry thread, so everything it reads has to be
+ * safe to read while the pipeline runs */
+using TelemetrySampler = std::function<void(std::vector<TelemetryMetric> &metrics)>;
+
+/** Writes the metrics of the parser to a file every few seconds while blocks are added
+ *
+ * The file is replaced atomically, so it can be served by the textfile collector of the Prometheus node exporter or
+ * polled by any other tool. In the JSON format every counter also carries its rate per second since the previous
+ * sample, Prometheus computes those itself. A last sample is written when the telemetry is destroyed.
+ */
+class ParserTelemetry {
+    std::string path;
+    ParserConfigurationBase::TelemetryFormat format;
+    std::chrono::seconds interval;
+    std::vector<TelemetrySampler> samplers;
+
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point lastSampleTime;
+    std::map<std::string, double> lastCounterValues;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread thread;
+
+    void writeSample();
+    std::string renderJson(const std::vector<TelemetryMetric> &metrics, double sampleSeconds);
+    static std::string renderPrometheus(const std::vector<TelemetryMetric> &metrics);
+
+public:
+    /** Start writing to the telemetry path of the config, does nothing if none is set */
+    ParserTelemetry(const ParserConfigurationBase &config, std::vector<TelemetrySampler> samplers);
+    ParserTelemetry(const ParserTelemetry &) = delete;
+    ParserTelemetry &operator=(const ParserTelemetry &) = delete;
+    ~ParserTelemetry();
+};
+
+#endif /* parser_telemetry_hpp */
@@ -0,0 +1,195 @@
+//
+//  partitioned_address_resolver.cpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "partitioned_address_resolver.hpp"
+#include "preproccessed_block.hpp"
+#include "work_stealing_pool.hpp"
+
+#include <algorithm>
+
+namespace {
+    template <typename Func>
+    void visitScripts(AnyScriptOutput &output, Func &func);
+    template <typename Func>
+    void visitScripts(AnyScriptInput &input, Func &func);
+
+    template <blocksci::AddressType::Enum type, typename Func>
+    void visitScripts(ScriptOutput<type> &output, Func &func) {
+        func(output);
+        output.data.visitWrapped([&](auto &wrapped) { visitScripts(wrapped, func); });
+    }
+
+    template <typename Data, typename Func>
+    void visitInputScripts(Data &, Func &) {}
+
+    template <typename Func>
+    void visitInputScripts(ScriptInputData<blocksci::AddressType::SCRIPTHASH> &data, Func &func) {
+        visitScripts(data.wrappedScriptOutput, func);
+        visitScripts(*data.wrappedScriptInput, func);
+    }
+
+    template <typename Func>
+    void visitInputScripts(ScriptInputData<blocksci::AddressType::WITNESS_SCRIPTHASH> &data, Func &func) {
+        visitScripts(data.wrappedScriptOutput, func);
+        visitScripts(*data.wrappedScriptInput, func);
+    }
+
+    template <typename Func>
+    void visitScripts(AnyScriptOutput &output, Func &func) {
+        mpark::visit([&](auto &typed) { visitScripts(typed, func); }, output.wrapped);
+    }
+
+    template <typename Func>
+    void visitScripts(AnyScriptInput &input, Func &func) {
+        mpark::visit([&](auto &typed) { visitInputScripts(typed.data, func); }, input.wrapped);
+    }
+
+    /** Call func on every script of the transaction, including the ones wrapped in multisig outputs and spends */
+    template <typename Func>
+    void visitScripts(RawTransaction &tx, Func &&func) {
+        for (auto &scriptOutput : tx.scriptOutputs) {
+            visitScripts(scriptOutput, func);
+        }
+        for (auto &scriptInput : tx.scriptInputs) {
+            visitScripts(scriptInput, func);
+        }
+    }
+}
+
+void PartitionedAddressResolver::Partition::clear() {
+    candidates.clear();
+    lookups.clear();
+    existing.clear();
+    wrappedInputs.clear();
+    seen.clear();
+}
+
+PartitionedAddressResolver::PartitionedAddressResolver(AddressState &state_, WorkStealingPool &pool_) : state(state_), pool(pool_), partitions(std::max<size_t>(pool_.threadCount(), 1)) {}
+
+void PartitionedAddressResolver::probe(RawTransaction * const *txes, size_t count) {
+    const AddressState &probeState = state;
+    pool.parallelFor(count, 4, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            visitScripts(*txes[i], [&](auto &output) { output.probe(probeState); });
+        }
+    });
+    for (size_t i = 0; i < count; i++) {
+        visitScripts(*txes[i], [&](auto &output) { output.queueProbe(state); });
+    }
+    state.finishProbes();
+}
+
+void PartitionedAddressResolver::resolve(RawTransaction * const *txes, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    probe(txes, count);
+
+    // Contiguous ranges of transactions, so that the partitions follow each other in chain order
+    auto partitionCount = std::min(partitions.size(), count);
+    auto partitionSize = (count + partitionCount - 1) / partitionCount;
+    partitionCount = (count + partitionSize - 1) / partitionSize;
+    pool.parallelFor(partitionCount, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            auto &partition = partitions[i];
+            partition.clear();
+            auto txEnd = std::min(count, (i + 1) * partitionSize);
+            for (size_t j = i * partitionSize; j < txEnd; j++) {
+                collect(partition, *txes[j]);
+            }
+        }
+    });
+
+    for (auto &nums : addressNums) {
+        nums.clear();
+    }
+    for (size_t i = 0; i < partitionCount; i++) {
+        merge(partitions[i]);
+    }
+
+    pool.parallelFor(partitionCount, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            fill(partitions[i]);
+        }
+    });
+}
+
+void PartitionedAddressResolver::collect(Partition &partition, RawTransaction &tx) {
+    for (auto &scriptOutput : tx.scriptOutputs) {
+        collectOutput(partition, scriptOutput);
+    }
+    for (auto &scriptInput : tx.scriptInputs) {
+        collectInput(partition, scriptInput);
+    }
+}
+
+void PartitionedAddressResolver::collectOutput(Partition &partition, AnyScriptOutput &output) {
+    mpark::visit([&](auto &typed) {
+        using Output = std::decay_t<decltype(typed)>;
+        collectOutput(partition, typed, -1, typename Output::Deduplicated{});
+    }, output.wrapped);
+}
+
+void PartitionedAddressResolver::collectInput(Partition &partition, AnyScriptInput &input) {
+    mpark::visit([&](auto &typed) { collectInput(partition, typed); }, input.wrapped);
+}
+
+void PartitionedAddressResolver::collectInput(Partition &partition, ScriptInput<blocksci::AddressType::SCRIPTHASH> &input) {
+    collectOutput(partition, input.data.wrappedScriptOutput);
+    collectInput(partition, *input.data.wrappedScriptInput);
+    partition.wrappedInputs.emplace_back(input.data.wrappedScriptInput.get(), &input.data.wrappedScriptOutput);
+}
+
+void PartitionedAddressResolver::collectInput(Partition &partition, ScriptInput<blocksci::AddressType::WITNESS_SCRIPTHASH> &input) {
+    collectOutput(partition, input.data.wrappedScriptOutput);
+    collectInput(partition, *input.data.wrappedScriptInput);
+    partition.wrappedInputs.emplace_back(input.data.wrappedScriptInput.get(), &input.data.wrappedScriptOutput);
+}
+
+void PartitionedAddressResolver::merge(Partition &partition) {
+    candidateIsNew.assign(partition.candidates.size(), false);
+    for (size_t i = 0; i < partition.candidates.size(); i++) {
+        auto &candidate = partition.candidates[i];
+        if (candidate.parent != -1 && !candidateIsNew[static_cast<size_t>(candidate.parent)]) {
+            // Wrapped in a script that was seen before, which resolving in order never gets to
+            continue;
+        }
+        if (candidate.deduped) {
+            auto &nums = addressNums[static_cast<size_t>(candidate.type)];
+            auto it = nums.find(candidate.key);
+            if (it != nums.end()) {
+                *candidate.scriptNum = it->second;
+                continue;
+            }
+            auto scriptNum = candidate.addNew(state, candidate.key);
+            nums.emplace(candidate.key, scriptNum);
+            *candidate.scriptNum = scriptNum;
+        } else {
+            *candidate.scriptNum = candidate.addNew(state, candidate.key);
+        }
+        *candidate.isNew = true;
+        candidateIsNew[i] = true;
+    }
+    for (auto &existing : partition.existing) {
+        if (existing.parent != -1 && !candidateIsNew[static_cast<size_t>(existing.parent)]) {
+            continue;
+        }
+        *existing.target = existing.scriptNum;
+        if (existing.addReused != nullptr) {
+            existing.addReused(state, existing.key, existing.scriptNum);
+        }
+    }
+}
+
+void PartitionedAddressResolver::fill(Partition &partition) {
+    for (auto &lookup : partition.lookups) {
+        *lookup.scriptNum = addressNums[static_cast<size_t>(lookup.type)].at(lookup.key);
+    }
+    for (auto &wrappedInput : partition.wrappedInputs) {
+        wrappedInput.first->setScriptNum(wrappedInput.second->address().scriptNum);
+    }
+}
@@ -0,0 +1,190 @@
+//
+//  partitioned_address_resolver.hpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef partitioned_address_resolver_hpp
+#define partitioned_address_resolver_hpp
+
+#include "parser_fwd.hpp"
+#include "address_state.hpp"
+#include "key_hash.hpp"
+#include "script_input.hpp"
+#include "script_output.hpp"
+
+#include <blocksci/core/bitcoin_uint256.hpp>
+
+#include <array>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/** Resolves the scripts of a batch of transactions in two passes over partitions of the batch, which gives the same
+ * scriptNums as resolving every script in chain order
+ *
+ * Pass 1 walks each partition on the pool in resolve order and collects the scripts that may be the first occurrence
+ * of their address: the ones that aren't in the address state yet and weren't already seen in the partition. A short
+ * serial merge goes through these candidates partition by partition, drops the addresses an earlier partition created
+ * and numbers the rest in order, which is the only part that adds to the address state. Pass 2 then fills in the
+ * scriptNums of the remaining scripts on the pool.
+ *
+ * The outputs of a multisig script are only resolved if the script is new. Candidates below another candidate are
+ * therefore kept even if the address was already seen in the partition, and the merge skips them unless their parent
+ * turned out to be new.
+ */
+class PartitionedAddressResolver {
+public:
+    PartitionedAddressResolver(AddressState &state, WorkStealingPool &pool);
+
+    /** Resolve all scripts of the transactions, which must not be journaled since no new address log is written */
+    void resolve(RawTransaction * const *txes, size_t count);
+
+private:
+    /** Hashes of all dedup types widened to 32 bytes */
+    using Key = blocksci::uint256;
+
+    using AddNewFunc = uint32_t (*)(AddressState &state, const Key &key);
+    using AddReusedFunc = void (*)(AddressState &state, const Key &key, uint32_t scriptNum);
+
+    /** Script that may be the first occurrence of its address */
+    struct Candidate {
+        Key key;
+        blocksci::DedupAddressType::Enum type;
+        bool deduped;
+        /** Index of the candidate whose wrapped script this is, or -1 */
+        int32_t parent;
+        uint32_t *scriptNum;
+        bool *isNew;
+        AddNewFunc addNew;
+    };
+
+    /** Script whose address was seen before, either in the address state or in the partition */
+    struct Lookup {
+        Key key;
+        blocksci::DedupAddressType::Enum type;
+        uint32_t *scriptNum;
+    };
+
+    /** Script whose address is in the address state. The ones below a candidate only count if it turns out to be
+     * new, and the ones found in the hash index move to the multi use map. */
+    struct Existing {
+        Key key;
+        uint32_t scriptNum;
+        int32_t parent;
+        uint32_t *target;
+        AddReusedFunc addReused;
+    };
+
+    struct Partition {
+        std::vector<Candidate> candidates;
+        std::vector<Lookup> lookups;
+        std::vector<Existing> existing;
+        /** Wrapped inputs of P2SH and P2WSH spends, which get the scriptNum of their wrapped output */
+        std::vector<std::pair<AnyScriptInput *, const AnyScriptOutput *>> wrappedInputs;
+        /** Candidates of the partition that were seen without a candidate above them */
+        std::unordered_set<Key, ParserKeyHash<Key>> seen;
+
+        void clear();
+    };
+
+    using AddressNums = std::unordered_map<Key, uint32_t, ParserKeyHash<Key>>;
+
+    AddressState &state;
+    WorkStealingPool &pool;
+    std::vector<Partition> partitions;
+    std::array<AddressNums, blocksci::DedupAddressType::size> addressNums;
+    /** Whether each candidate of the partition being merged was numbered as a new address */
+    std::vector<bool> candidateIsNew;
+
+    void probe(RawTransaction * const *txes, size_t count);
+    void collect(Partition &partition, RawTransaction &tx);
+    void merge(Partition &partition);
+    void fill(Partition &partition);
+
+    template <typename Hash>
+    static Key toKey(const Hash &hash) {
+        Key key;
+        key.SetNull();
+        std::memcpy(key.begin(), hash.begin(), hash.size());
+        return key;
+    }
+
+    template <typename Hash>
+    static Hash fromKey(const Key &key) {
+        Hash hash;
+        std::memcpy(hash.begin(), key.begin(), hash.size());
+        return hash;
+    }
+
+    template <blocksci::AddressType::Enum type>
+    static uint32_t addNewDeduped(AddressState &state, const Key &key) {
+        return state.addNewAddress<dedupType(type)>(fromKey<DedupHash_t<dedupType(type)>>(key));
+    }
+
+    template <blocksci::AddressType::Enum type>
+    static uint32_t addNewUndeduped(AddressState &state, const Key &) {
+        return state.getNewAddressIndex(dedupType(type));
+    }
+
+    template <blocksci::AddressType::Enum type>
+    static void addReused(AddressState &state, const Key &key, uint32_t scriptNum) {
+        state.addReusedAddress<dedupType(type)>(fromKey<DedupHash_t<dedupType(type)>>(key), scriptNum);
+    }
+
+    template <blocksci::AddressType::Enum type>
+    void collectOutput(Partition &partition, ScriptOutput<type> &output, int32_t parent, std::true_type) {
+        assert(output.probed && output.probed->location != AddressLocation::Unchecked);
+        auto &info = *output.probed;
+        auto key = toKey(info.hash);
+        if (info.location != AddressLocation::NotFound) {
+            auto addReusedFunc = info.location == AddressLocation::LevelDb ? &addReused<type> : nullptr;
+            if (parent == -1) {
+                output.scriptNum = info.addressNum;
+                if (addReusedFunc == nullptr) {
+                    return;
+                }
+            }
+            partition.existing.push_back(Existing{key, info.addressNum, parent, &output.scriptNum, addReusedFunc});
+            return;
+        }
+        if (partition.seen.count(key) > 0) {
+            partition.lookups.push_back(Lookup{key, dedupType(type), &output.scriptNum});
+            return;
+        }
+        if (parent == -1) {
+            partition.seen.insert(key);
+        }
+        addCandidate(partition, output, Candidate{key, dedupType(type), true, parent, &output.scriptNum, &output.isNew, &addNewDeduped<type>});
+    }
+
+    template <blocksci::AddressType::Enum type>
+    void collectOutput(Partition &partition, ScriptOutput<type> &output, int32_t parent, std::false_type) {
+        Key key;
+        key.SetNull();
+        addCandidate(partition, output, Candidate{key, dedupType(type), false, parent, &output.scriptNum, &output.isNew, &addNewUndeduped<type>});
+    }
+
+    template <blocksci::AddressType::Enum type>
+    void addCandidate(Partition &partition, ScriptOutput<type> &output, const Candidate &candidate) {
+        auto index = static_cast<int32_t>(partition.candidates.size());
+        partition.candidates.push_back(candidate);
+        output.data.visitWrapped([&](auto &wrapped) {
+            using Wrapped = std::decay_t<decltype(wrapped)>;
+            collectOutput(partition, wrapped, index, typename Wrapped::Deduplicated{});
+        });
+    }
+
+    void collectOutput(Partition &partition, AnyScriptOutput &output);
+    void collectInput(Partition &partition, AnyScriptInput &input);
+
+    template <blocksci::AddressType::Enum type>
+    void collectInput(Partition &, ScriptInput<type> &) {}
+
+    void collectInput(Partition &partition, ScriptInput<blocksci::AddressType::SCRIPTHASH> &input);
+    void collectInput(Partition &partition, ScriptInput<blocksci::AddressType::WITNESS_SCRIPTHASH> &input);
+};
+
+#endif /* partitioned_address_resolver_hpp */
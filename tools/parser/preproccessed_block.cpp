@@ -23,6 +23,7 @@
 #include <openssl/sha.h>
 
 #include <iostream>
+#include <new>
 
 using SequenceNum = uint32_t;
 using Value = uint64_t;
@@ -50,11 +51,13 @@ RawInput::RawInput(SafeMemReader &reader) : utxo{} {
     sequenceNum = reader.readNext<SequenceNum>();
 }
 
-void RawInput::readWitnessStack(SafeMemReader &reader) {
-    auto stackItemCount = reader.readVariableLengthInteger();
-    for (uint32_t j = 0; j < stackItemCount; j++) {
-        witnessStack.emplace_back(reader);
+void RawInput::readWitnessStack(SafeMemReader &reader, ParserArena &arena) {
+    witnessItemCount = reader.readVariableLengthInteger();
+    auto items = arena.allocateArray<WitnessStackItem>(witnessItemCount);
+    for (uint32_t j = 0; j < witnessItemCount; j++) {
+        new (items + j) WitnessStackItem(reader);
     }
+    witnessItems = items;
 }
 
 RawOutput::RawOutput(SafeMemReader &reader) {
@@ -74,6 +77,7 @@ void RawTransaction::load(SafeMemReader &reader, uint32_t txNum_, blocksci::Bloc
     txNum = txNum_;
     isSegwit = witnessActivated;
     blockHeight = blockHeight_;
+    arena.reset();
     auto startOffset = reader.offset();
     auto curOffset = reader.offset();
     version = reader.readNext<decltype(version)>();
@@ -107,7 +111,7 @@ void RawTransaction::load(SafeMemReader &reader, uint32_t txNum_, blocksci::Bloc
     txHashLength = static_cast<uint32_t>(reader.unsafePos() - txHashStart);
     if (containsSegwit) {
         for (decltype(inputCount) i = 0; i < inputCount; i++) {
-            inputs[i].readWitnessStack(reader);
+            inputs[i].readWitnessStack(reader, arena);
         }
     }
     curOffset = reader.offset();
@@ -162,15 +166,33 @@ TransactionHeader::TransactionHeader(SafeMemReader &reader) {
     realSize = static_cast<uint32_t>(reader.offset() - startOffset);
 }
 
+HashInput RawTransaction::hashInput() const {
+    return {{&version, txHashStart, &locktime}, {sizeof(version), txHashLength, sizeof(locktime)}};
+}
+
 void RawTransaction::calculateHash() {
     if (hash.IsNull()) {
-        SHA256_CTX sha256CTX;
-        SHA256_Init(&sha256CTX);
-        SHA256_Update(&sha256CTX, &version, sizeof(version));
-        SHA256_Update(&sha256CTX, txHashStart, txHashLength);
-        SHA256_Update(&sha256CTX, &locktime, sizeof(locktime));
-        SHA256_Final(reinterpret_cast<unsigned char *>(&hash), &sha256CTX);
-        hash = sha256(reinterpret_cast<const uint8_t *>(&hash), sizeof(hash));
+        auto input = hashInput();
+        doubleSha256Batch(&input, 1, &hash);
+    }
+}
+
+void calculateHashes(RawTransaction * const *txes, size_t count) {
+    std::vector<HashInput> inputs;
+    std::vector<blocksci::uint256> hashes;
+    inputs.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        if (txes[i]->hash.IsNull()) {
+            inputs.push_back(txes[i]->hashInput());
+        }
+    }
+    hashes.resize(inputs.size());
+    doubleSha256Batch(inputs.data(), inputs.size(), hashes.data());
+    size_t hashNum = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (txes[i]->hash.IsNull()) {
+            txes[i]->hash = hashes[hashNum++];
+        }
     }
 }
 
@@ -188,6 +210,16 @@ RawInput::RawInput(const vin_t &vin) {
     }
 }
 
+void RawInput::buildWitnessStack(ParserArena &arena) {
+    witnessItemCount = static_cast<uint32_t>(rpcWitnessStack.size());
+    auto items = arena.allocateArray<WitnessStackItem>(witnessItemCount);
+    for (uint32_t j = 0; j < witnessItemCount; j++) {
+        auto &item = rpcWitnessStack[j];
+        new (items + j) WitnessStackItem(item.data(), static_cast<uint32_t>(item.size()));
+    }
+    witnessItems = items;
+}
+
 RawOutput::RawOutput(std::vector<unsigned char> scriptBytes_, int64_t value_) : scriptBytes(std::move(scriptBytes_)), value(value_)  {
 }
 
@@ -197,6 +229,7 @@ void RawTransaction::load(const getrawtransaction_t &txinfo, uint32_t txNum_, bl
     txNum = txNum_;
     isSegwit = witnessActivated;
     blockHeight = blockHeight_;
+    arena.reset();
     version = txinfo.version;
     locktime = txinfo.locktime;
     realSize = static_cast<uint32_t>(txinfo.hex.size() / 2);
@@ -205,6 +238,7 @@ void RawTransaction::load(const getrawtransaction_t &txinfo, uint32_t txNum_, bl
     inputs.reserve(inputCount);
     for (size_t i = 0; i < inputCount; i++) {
         inputs.emplace_back(txinfo.vin[i]);
+        inputs.back().buildWitnessStack(arena);
     }
     auto outputCount = txinfo.vout.size();
     
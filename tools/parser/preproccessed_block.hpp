@@ -10,11 +10,14 @@
 #define preproccessed_block_hpp
 
 #include "config.hpp"
+#include "parser_arena.hpp"
 #include "script_output.hpp"
 #include "script_input.hpp"
 #include "utxo.hpp"
+#include "witness_stack.hpp"
 
 #include <blocksci/core/bitcoin_uint256.hpp>
+#include <blocksci/core/input_signature.hpp>
 
 #include <boost/container/small_vector.hpp>
 
@@ -22,6 +25,7 @@ struct getrawtransaction_t;
 struct vout_t;
 struct vin_t;
 struct InputView;
+struct HashInput;
 
 namespace blocksci {
     struct RawTransaction;
@@ -31,17 +35,6 @@ std::vector<unsigned char> hexStringToVec(const std::string &scripthex);
 
 class SafeMemReader;
 
-struct WitnessStackItem {
-    uint32_t length = 0;
-    const char *itemBegin = nullptr;
-    
-    WitnessStackItem(const char *itemBegin_, uint32_t length_) : length(length_), itemBegin(itemBegin_) {}
-    
-    #ifdef BLOCKSCI_FILE_PARSER
-    WitnessStackItem(SafeMemReader &reader);
-    #endif
-};
-
 struct RawInput {
 private:
     const unsigned char *scriptBegin = nullptr;
@@ -49,7 +42,8 @@ private:
     
     std::vector<unsigned char> scriptBytes;
     
-    std::vector<WitnessStackItem> witnessStack;
+    const WitnessStackItem *witnessItems = nullptr;
+    uint32_t witnessItemCount = 0;
     
     std::vector<std::vector<char>> rpcWitnessStack;
     
@@ -72,27 +66,20 @@ public:
         }
     }
     
-    std::vector<WitnessStackItem> getWitnessStack() const {
-        if (witnessStack.size() == 0) {
-            std::vector<WitnessStackItem> realStack;
-            for (const auto &witnessItem : rpcWitnessStack) {
-                realStack.emplace_back(witnessItem.data(), static_cast<uint32_t>(witnessItem.size()));
-            }
-            return realStack;
-        } else {
-            return witnessStack;
-        }
+    WitnessStack getWitnessStack() const {
+        return {witnessItems, witnessItemCount};
     }
     
     RawInput() : utxo{} {}
     
     #ifdef BLOCKSCI_FILE_PARSER
     RawInput(SafeMemReader &reader);
-    void readWitnessStack(SafeMemReader &reader);
+    void readWitnessStack(SafeMemReader &reader, ParserArena &arena);
     #endif
     
     #ifdef BLOCKSCI_RPC_PARSER
     RawInput(const vin_t &vin);
+    void buildWitnessStack(ParserArena &arena);
     #endif
 };
 
@@ -150,6 +137,14 @@ struct RawTransaction {
     boost::container::small_vector<AnyScriptInput, 4> scriptInputs;
     boost::container::small_vector<AnyScriptOutput, 4> scriptOutputs;
     
+    /** Backing storage of the witness stacks of the inputs, reset whenever the transaction is loaded */
+    ParserArena arena;
+    
+    /** Signatures of the inputs, only filled by ExtractSignaturesStep */
+    std::vector<blocksci::InputSignature> inputSignatures;
+    
+    /** Serialized RawWitness records of the inputs, only filled by RecordWitnessesStep */
+    std::vector<char> witnessRecords;
     
     RawTransaction() :
       txNum(0),
@@ -169,6 +164,7 @@ struct RawTransaction {
     #endif
     
     void calculateHash();
+    HashInput hashInput() const;
     
     blocksci::uint256 getHash(const InputView &info, const blocksci::CScriptView &scriptView, int hashType) const;
     blocksci::RawTransaction getRawTransaction() const;
@@ -176,5 +172,8 @@ struct RawTransaction {
     std::vector<char> getSer(const InputView &info, const blocksci::CScriptView &scriptView, int hashType) const;
 };
 
+/** Calculate the hashes of all transactions whose hash isn't known yet with a single call to doubleSha256Batch */
+void calculateHashes(RawTransaction * const *txes, size_t count);
+
 
 #endif /* preproccessed_block_hpp */
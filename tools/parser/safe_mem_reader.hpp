@@ -10,6 +10,12 @@
 
 #include <mio/mmap.hpp>
 
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
 inline unsigned int variableLengthIntSize(uint64_t nSize) {
     if (nSize < 253)             return sizeof(unsigned char);
     else if (nSize <= std::numeric_limits<unsigned short>::max()) return sizeof(unsigned char) + sizeof(unsigned short);
@@ -33,6 +39,13 @@ public:
         pos = begin;
     }
     
+    /** Reader over the first size bytes of the file at path that were already read into buffer */
+    SafeMemReader(std::string path_, std::unique_ptr<char[]> buffer_, size_type size) : path(std::move(path_)), buffer(std::move(buffer_)) {
+        begin = buffer.get();
+        end = begin + size;
+        pos = begin;
+    }
+    
     std::string getPath() const {
         return path;
     }
@@ -103,6 +116,7 @@ public:
 protected:
     mio::mmap_source fileMap;
     std::string path;
+    std::unique_ptr<char[]> buffer;
     iterator pos;
     iterator begin;
     iterator end;
@@ -150,6 +150,24 @@ void ScriptInputData<blocksci::AddressType::Enum::WITNESS_SCRIPTHASH>::process(A
     wrappedScriptInput->setScriptNum(scriptNum);
 }
 
+/** Classify the spend following BIP341: after dropping the annex (a last item starting with 0x50 when there are at
+ * least two items) a single remaining item is a key path signature, more items are a script path spend. Spends
+ * without witness, which were only possible before taproot activation, stay Unspent. */
+ScriptInputData<blocksci::AddressType::Enum::WITNESS_TAPROOT>::ScriptInputData(const InputView &inputView, const blocksci::CScriptView &, const RawTransaction &, const SpendData<blocksci::AddressType::Enum::WITNESS_TAPROOT> &) : spendType(blocksci::TaprootSpendType::Unspent) {
+    auto itemCount = inputView.witnessStack.size();
+    if (itemCount >= 2) {
+        auto &lastItem = inputView.witnessStack[itemCount - 1];
+        if (lastItem.length > 0 && static_cast<unsigned char>(*lastItem.itemBegin) == 0x50) {
+            itemCount--;
+        }
+    }
+    if (itemCount == 1) {
+        spendType = blocksci::TaprootSpendType::KeyPath;
+    } else if (itemCount >= 2) {
+        spendType = blocksci::TaprootSpendType::ScriptPath;
+    }
+}
+
 ScriptInputData<blocksci::AddressType::Enum::WITNESS_UNKNOWN>::ScriptInputData(const InputView &inputView, const blocksci::CScriptView &, const RawTransaction &, const SpendData<blocksci::AddressType::Enum::WITNESS_UNKNOWN> &) {
     for (size_t i = 0; i < inputView.witnessStack.size(); i++) {
         auto &stackItem = inputView.witnessStack[i];
@@ -11,6 +11,7 @@
 
 #include "parser_fwd.hpp"
 #include "script_output.hpp"
+#include "witness_stack.hpp"
 
 #include <internal/script_view.hpp>
 
@@ -21,10 +22,10 @@
 struct InputView {
     uint32_t inputNum;
     uint32_t txNum;
-    std::vector<WitnessStackItem> witnessStack;
+    WitnessStack witnessStack;
     bool witnessActivated;
     
-    InputView(uint32_t inputNum_, uint32_t txNum_, std::vector<WitnessStackItem> && witnessStack_, bool witnessActivated_) : inputNum(inputNum_), txNum(txNum_), witnessStack(std::move(witnessStack_)), witnessActivated(witnessActivated_) {}
+    InputView(uint32_t inputNum_, uint32_t txNum_, WitnessStack witnessStack_, bool witnessActivated_) : inputNum(inputNum_), txNum(txNum_), witnessStack(witnessStack_), witnessActivated(witnessActivated_) {}
 };
 
 template<blocksci::AddressType::Enum type>
@@ -99,6 +100,13 @@ struct ScriptInputData<blocksci::AddressType::Enum::WITNESS_UNKNOWN> : public Sc
     ScriptInputData(const InputView &inputView, const blocksci::CScriptView &scriptView, const RawTransaction &tx, const SpendData<blocksci::AddressType::Enum::WITNESS_UNKNOWN> &);
 };
 
+template<>
+struct ScriptInputData<blocksci::AddressType::Enum::WITNESS_TAPROOT> : public ScriptInputDataBase {
+    blocksci::TaprootSpendType spendType;
+    
+    ScriptInputData(const InputView &inputView, const blocksci::CScriptView &scriptView, const RawTransaction &tx, const SpendData<blocksci::AddressType::Enum::WITNESS_TAPROOT> &);
+};
+
 class AnyScriptInput;
 
 template<>
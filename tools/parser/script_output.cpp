@@ -80,7 +80,8 @@ static bool MatchMultisig(const CScriptView& script, ScriptOutputData<blocksci::
 }
 
 
-ScriptOutputDataType extractScriptData(const blocksci::CScriptView &scriptPubKey, bool p2shActivated, bool witnessActivated) {
+template <typename Rules>
+ScriptOutputDataType extractScriptData(const blocksci::CScriptView &scriptPubKey) {
     using blocksci::AddressType;
     using blocksci::CScript;
     using blocksci::CScriptView;
@@ -89,7 +90,7 @@ ScriptOutputDataType extractScriptData(const blocksci::CScriptView &scriptPubKey
     
     // Shortcut for pay-to-script-hash, which are more constrained than the other types:
     // it is always OP_HASH160 20 [20 byte hash] OP_EQUAL
-    if (p2shActivated && scriptPubKey.IsPayToScriptHash()) {
+    if (Rules::p2shActivated && scriptPubKey.IsPayToScriptHash()) {
         blocksci::uint160 hash;
         memcpy(&hash, &(*(scriptPubKey.begin()+2)), 20);
         return ScriptOutputData<AddressType::Enum::SCRIPTHASH>{{hash}};
@@ -97,7 +98,7 @@ ScriptOutputDataType extractScriptData(const blocksci::CScriptView &scriptPubKey
     
     uint8_t witnessversion;
     ranges::subrange<const unsigned char *> witnessprogram;
-    if (witnessActivated && scriptPubKey.IsWitnessProgram(witnessversion, witnessprogram)) {
+    if (Rules::witnessActivated && scriptPubKey.IsWitnessProgram(witnessversion, witnessprogram)) {
         if (witnessversion == 0) {
             if (witnessprogram.size() == 20) {
                 return ScriptOutputData<AddressType::Enum::WITNESS_PUBKEYHASH>(uint160{witnessprogram.begin(), witnessprogram.end()});
@@ -107,6 +108,8 @@ ScriptOutputDataType extractScriptData(const blocksci::CScriptView &scriptPubKey
                 // Witness v0 with other script length is treated as nonstandard
                 return ScriptOutputData<AddressType::Enum::NONSTANDARD>{scriptPubKey};
             }
+        } else if (witnessversion == 1 && witnessprogram.size() == 32) {
+            return ScriptOutputData<AddressType::Enum::WITNESS_TAPROOT>(uint256{witnessprogram.begin(), witnessprogram.end()});
         } else {
              return ScriptOutputData<AddressType::Enum::WITNESS_UNKNOWN>(witnessversion, witnessprogram);
         }
@@ -147,7 +150,17 @@ struct ScriptOutputGenerator {
     }
 };
                      
-AnyScriptOutput::AnyScriptOutput(const blocksci::CScriptView &scriptPubKey, bool p2shActivated, bool witnessActivated) : wrapped(mpark::visit(ScriptOutputGenerator(), extractScriptData(scriptPubKey, p2shActivated, witnessActivated))) {}
+template <bool p2sh, bool witness>
+AnyScriptOutput::AnyScriptOutput(const blocksci::CScriptView &scriptPubKey, ScriptRules<p2sh, witness>) : wrapped(mpark::visit(ScriptOutputGenerator(), extractScriptData<ScriptRules<p2sh, witness>>(scriptPubKey))) {}
+
+template AnyScriptOutput::AnyScriptOutput(const blocksci::CScriptView &, ScriptRules<true, true>);
+template AnyScriptOutput::AnyScriptOutput(const blocksci::CScriptView &, ScriptRules<true, false>);
+template AnyScriptOutput::AnyScriptOutput(const blocksci::CScriptView &, ScriptRules<false, true>);
+template AnyScriptOutput::AnyScriptOutput(const blocksci::CScriptView &, ScriptRules<false, false>);
+
+AnyScriptOutput::AnyScriptOutput(const blocksci::CScriptView &scriptPubKey, bool p2shActivated, bool witnessActivated) : AnyScriptOutput(dispatchScriptRules(p2shActivated, witnessActivated, [&](auto rules) {
+    return AnyScriptOutput(scriptPubKey, rules);
+})) {}
 
 blocksci::RawAddress AnyScriptOutput::address() const {
     return mpark::visit([&](auto &output) { return blocksci::RawAddress{output.scriptNum, output.address_v}; }, wrapped);
@@ -165,6 +178,14 @@ blocksci::AddressType::Enum AnyScriptOutput::type() const {
     return mpark::visit([&](auto &output) { return output.address_v; }, wrapped);
 }
 
+void AnyScriptOutput::probe(const AddressState &state) {
+    mpark::visit([&](auto &output) { output.probe(state); }, wrapped);
+}
+
+void AnyScriptOutput::queueProbe(AddressState &state) {
+    mpark::visit([&](auto &output) { output.queueProbe(state); }, wrapped);
+}
+
 uint32_t AnyScriptOutput::resolve(AddressState &state) {
     return mpark::visit([&](auto &output) { return output.resolve(state); }, wrapped);
 }
@@ -344,3 +365,15 @@ blocksci::ArbitraryLengthData<blocksci::WitnessUnknownScriptData> ScriptOutputDa
     data.add(witnessData.begin(), witnessData.end());
     return data;
 }
+
+// MARK: WITNESS_TAPROOT
+
+blocksci::uint256 ScriptOutputData<blocksci::AddressType::Enum::WITNESS_TAPROOT>::getHash() const {
+    return outputKey;
+}
+
+blocksci::TaprootData ScriptOutputData<blocksci::AddressType::Enum::WITNESS_TAPROOT>::getData(uint32_t txNum, bool topLevel) const {
+    blocksci::TaprootData data{txNum, outputKey};
+    data.saw(blocksci::AddressType::Enum::WITNESS_TAPROOT, topLevel);
+    return data;
+}
@@ -20,22 +20,55 @@
 template<blocksci::AddressType::Enum type>
 struct ScriptOutput {
     static constexpr auto address_v = type;
+    using Deduplicated = std::integral_constant<bool, blocksci::DedupAddressInfo<dedupType(type)>::equived>;
+    
     ScriptOutputData<type> data;
     uint32_t scriptNum = 0;
     bool isNew = false;
     
+    /** Result of AddressState::probeAddress() if the address was looked up ahead of resolve() */
+    ranges::optional<RawAddressInfo<type>> probed;
+    
     ScriptOutput() = default;
     ScriptOutput(const ScriptOutputData<type> &data_) : data(data_) {}
     
+    /** Look up the address ahead of resolve(), can run for many outputs at once @see AddressState::probeAddress() */
+    void probe(const AddressState &state) {
+        probeImpl(state, Deduplicated{});
+    }
+    
+    void queueProbe(AddressState &state) {
+        if (probed) {
+            state.queueProbe(*probed);
+        }
+    }
+    
     uint32_t resolve(AddressState &state) {
-        auto addressInfo = state.findAddress(data);
-        std::tie(scriptNum, isNew) = state.resolveAddress(addressInfo);
+        std::tie(scriptNum, isNew) = resolveImpl(state, Deduplicated{});
         assert(scriptNum > 0);
         if (isNew) {
             data.visitWrapped([&](auto &output) { output.resolve(state); });
         }
         return scriptNum;
     }
+    
+private:
+    void probeImpl(const AddressState &state, std::true_type) {
+        probed = state.probeAddress(data);
+    }
+    
+    void probeImpl(const AddressState &, std::false_type) {}
+    
+    std::pair<uint32_t, bool> resolveImpl(AddressState &state, std::true_type) {
+        if (probed) {
+            return state.resolveAddress(state.confirmProbe(*probed));
+        }
+        return state.resolveAddress(state.findAddress(data));
+    }
+    
+    std::pair<uint32_t, bool> resolveImpl(AddressState &state, std::false_type) {
+        return state.resolveAddress(state.findAddress(data));
+    }
 };
 
 struct ScriptOutputDataBase {
@@ -200,8 +233,44 @@ struct ScriptOutputData<blocksci::AddressType::Enum::WITNESS_UNKNOWN> : public S
     blocksci::ArbitraryLengthData<blocksci::WitnessUnknownScriptData> getData(uint32_t txNum, bool topLevel) const;
 };
 
+template <>
+struct ScriptOutputData<blocksci::AddressType::Enum::WITNESS_TAPROOT> : public ScriptOutputDataBase {
+    blocksci::uint256 outputKey;
+    
+    ScriptOutputData(blocksci::uint256 outputKey_) : outputKey(outputKey_) {}
+    
+    blocksci::uint256 getHash() const;
+    
+    blocksci::TaprootData getData(uint32_t txNum, bool topLevel) const;
+};
+
 using ScriptOutputType = blocksci::to_variadic_t<blocksci::to_address_tuple_t<ScriptOutput>, mpark::variant>;
 
+/** Consensus rules that decide how output scripts are classified
+ *
+ * The rules are template parameters so the classification of every output is compiled once per rule set without
+ * branching on them. Callers pick the rule set once per transaction with dispatchScriptRules. */
+template <bool p2sh, bool witness>
+struct ScriptRules {
+    static constexpr bool p2shActivated = p2sh;
+    static constexpr bool witnessActivated = witness;
+};
+
+/** Call func with the ScriptRules matching the flags */
+template <typename Func>
+decltype(auto) dispatchScriptRules(bool p2shActivated, bool witnessActivated, Func &&func) {
+    if (p2shActivated) {
+        if (witnessActivated) {
+            return func(ScriptRules<true, true>{});
+        }
+        return func(ScriptRules<true, false>{});
+    }
+    if (witnessActivated) {
+        return func(ScriptRules<false, true>{});
+    }
+    return func(ScriptRules<false, false>{});
+}
+
 class AnyScriptOutput {
 public:
     ScriptOutputType wrapped;
@@ -212,6 +281,13 @@ public:
     AnyScriptOutput() = default;
     AnyScriptOutput(const blocksci::CScriptView &scriptPubKey, bool p2shActivated, bool witnessActivated);
 
+    /** Classify the script under the given ScriptRules, instantiated for all of them in script_output.cpp */
+    template <bool p2sh, bool witness>
+    AnyScriptOutput(const blocksci::CScriptView &scriptPubKey, ScriptRules<p2sh, witness> rules);
+
+    /** @see ScriptOutput::probe() */
+    void probe(const AddressState &state);
+    void queueProbe(AddressState &state);
     uint32_t resolve(AddressState &state);
     bool isValid() const;
 };
@@ -8,16 +8,43 @@
 #ifndef serializable_map_hpp
 #define serializable_map_hpp
 
+#include "key_hash.hpp"
+
 #include <google/dense_hash_map>
 
+#include <cstdint>
 #include <string>
 #include <fstream>
+#include <istream>
+#include <ostream>
 
+/** dense_hash_map which can be written to and read from a file
+ *
+ * The file starts with formatMagic and the id of the hash the map was written with, followed by the serialized
+ * table. Files written before the hash was configurable have no header and were written with std::hash.
+ */
 template<typename Key, typename Value>
 class SerializableMap {
-    using Map = google::dense_hash_map<Key, Value, std::hash<Key>>;
+    using Map = google::dense_hash_map<Key, Value, MapKeyHash<Key>>;
     Map map;
     
+    static constexpr uint64_t formatMagic = 0x70616d48534b4221;
+    
+    /** Replace the content with a map that was serialized using Hasher, inserting every entry again */
+    template <typename Hasher>
+    void rehashFrom(std::istream &file, const std::string &path) {
+        google::dense_hash_map<Key, Value, Hasher> stored;
+        stored.set_deleted_key(map.deleted_key());
+        stored.set_empty_key(map.empty_key());
+        typename decltype(stored)::NopointerSerializer serializer;
+        if(!stored.unserialize(serializer, &file)) {
+            throw BadSerializationFormatException{path};
+        }
+        map.clear();
+        map.resize(stored.size());
+        map.insert(stored.begin(), stored.end());
+    }
+    
 public:
     
     using value_type = typename Map::value_type;
@@ -41,17 +68,48 @@ public:
     bool unserialize(const std::string &path) {
         std::fstream file{path, std::fstream::in | std::fstream::binary};
         if (file.is_open()) {
+            unserialize(file, path);
+            return true;
+        }
+        return false;
+    }
+    
+    /** Read a map written by serialize() from the current position of file, path is only used for errors */
+    void unserialize(std::istream &file, const std::string &path) {
+        auto start = file.tellg();
+        uint64_t magic = 0;
+        uint32_t hashId = 0;
+        file.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+        if (file && magic == formatMagic) {
+            file.read(reinterpret_cast<char *>(&hashId), sizeof(hashId));
+        } else {
+            file.clear();
+            file.seekg(start);
+        }
+        if (hashId == mapKeyHashId) {
             typename Map::NopointerSerializer serializer;
             if(!map.unserialize(serializer, &file)) {
                 throw BadSerializationFormatException{path};
             }
-            return true;
+        } else if (hashId == 0) {
+            rehashFrom<std::hash<Key>>(file, path);
+        } else if (hashId == 1) {
+            rehashFrom<ParserKeyHash<Key>>(file, path);
+        } else {
+            throw BadSerializationFormatException{path};
         }
-        return false;
     }
     
     bool serialize(const std::string &path) {
         std::ofstream file{path, std::fstream::out | std::fstream::binary};
+        return serialize(file);
+    }
+    
+    bool serialize(std::ostream &file) {
+        uint64_t magic = formatMagic;
+        uint32_t hashId = mapKeyHashId;
+        file.write(reinterpret_cast<const char *>(&magic), sizeof(magic));
+        file.write(reinterpret_cast<const char *>(&hashId), sizeof(hashId));
         typename Map::NopointerSerializer serializer;
         return map.serialize(serializer, &file);
     }
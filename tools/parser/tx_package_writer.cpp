@@ -0,0 +1,116 @@
+//
+//  tx_package_writer.cpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "tx_package_writer.hpp"
+#include "parser_configuration.hpp"
+
+#include <blocksci/chain/tx_package.hpp>
+
+#include <internal/chain_access.hpp>
+#include <internal/file_mapper.hpp>
+#include <internal/progress_bar.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+void updateTxPackages(const ParserConfigurationBase &config) {
+    auto chainDirectory = config.dataConfig.chainDirectory();
+    blocksci::ChainAccess chain{chainDirectory, 0, false};
+    blocksci::FixedSizeFileMapper<uint8_t, mio::access_mode::write> flagsFile{blocksci::ChainAccess::txPackageFlagsFilePath(chainDirectory)};
+    blocksci::FixedSizeFileMapper<uint64_t, mio::access_mode::write> blockEdgesFile{blocksci::ChainAccess::blockPackageEdgesFilePath(chainDirectory)};
+    blocksci::FixedSizeFileMapper<blocksci::InBlockEdge, mio::access_mode::write> byChildFile{blocksci::ChainAccess::packageEdgesByChildFilePath(chainDirectory)};
+    blocksci::FixedSizeFileMapper<blocksci::InBlockEdge, mio::access_mode::write> byParentFile{blocksci::ChainAccess::packageEdgesByParentFilePath(chainDirectory)};
+
+    // The entry of a block is written after its flags and edges, so resume at the first block without an entry whose
+    // flags and edges are all covered
+    auto blockCount = chain.blockCount();
+    auto edgeEnd = [&](blocksci::BlockHeight height) -> uint64_t {
+        return height > 0 ? *blockEdgesFile[static_cast<blocksci::OffsetType>(height - 1)] : 0;
+    };
+    auto firstTxOfBlock = [&](blocksci::BlockHeight height) -> uint64_t {
+        return height == blockCount ? chain.txCount() : chain.getBlock(height)->firstTxIndex;
+    };
+    auto coveredEdges = static_cast<uint64_t>(std::min(byChildFile.size(), byParentFile.size()));
+    auto firstBlock = std::min(static_cast<blocksci::BlockHeight>(blockEdgesFile.size()), blockCount);
+    while (firstBlock > 0 && (edgeEnd(firstBlock) > coveredEdges || firstTxOfBlock(firstBlock) > static_cast<uint64_t>(flagsFile.size()))) {
+        firstBlock--;
+    }
+    auto edgeCount = edgeEnd(firstBlock);
+    blockEdgesFile.truncate(static_cast<blocksci::OffsetType>(firstBlock));
+    byChildFile.truncate(static_cast<blocksci::OffsetType>(edgeCount));
+    byParentFile.truncate(static_cast<blocksci::OffsetType>(edgeCount));
+    flagsFile.truncate(static_cast<blocksci::OffsetType>(firstTxOfBlock(firstBlock)));
+    blockEdgesFile.seekEnd();
+    byChildFile.seekEnd();
+    byParentFile.seekEnd();
+    flagsFile.seekEnd();
+
+    if (firstBlock == blockCount) {
+        return;
+    }
+
+    bool showProgress = blockCount - firstBlock > 1000;
+    if (showProgress) {
+        std::cout << "Updating same-block spends\n";
+    }
+    auto progressBar = blocksci::makeProgressBar(blockCount - firstBlock, [=]() {});
+    if (!showProgress) {
+        progressBar.setSilent();
+    }
+    std::vector<blocksci::InBlockEdge> edges;
+    std::vector<uint8_t> flags;
+    for (auto height = firstBlock; height < blockCount; height++) {
+        auto block = chain.getBlock(height);
+        edges.clear();
+        flags.assign(block->txCount, 0);
+        // The coinbase has no real inputs
+        for (uint32_t position = 1; position < block->txCount; position++) {
+            auto tx = chain.getTx(block->firstTxIndex + position);
+            for (auto input = tx->beginInputs(); input != tx->endInputs(); ++input) {
+                auto spentTxNum = input->getLinkedTxNum();
+                if (spentTxNum >= block->firstTxIndex) {
+                    edges.push_back({position, spentTxNum - block->firstTxIndex});
+                }
+            }
+        }
+        std::sort(edges.begin(), edges.end(), [](const blocksci::InBlockEdge &a, const blocksci::InBlockEdge &b) {
+            return a.child < b.child || (a.child == b.child && a.parent < b.parent);
+        });
+        edges.erase(std::unique(edges.begin(), edges.end(), [](const blocksci::InBlockEdge &a, const blocksci::InBlockEdge &b) {
+            return a.child == b.child && a.parent == b.parent;
+        }), edges.end());
+        for (auto &edge : edges) {
+            flags[edge.child] |= blocksci::TxPackageFlag::SpendsSameBlock;
+            flags[edge.parent] |= blocksci::TxPackageFlag::HasSameBlockChild;
+            byChildFile.write(edge);
+        }
+        std::sort(edges.begin(), edges.end(), [](const blocksci::InBlockEdge &a, const blocksci::InBlockEdge &b) {
+            return a.parent < b.parent || (a.parent == b.parent && a.child < b.child);
+        });
+        for (auto &edge : edges) {
+            byParentFile.write(edge);
+        }
+        for (auto flag : flags) {
+            flagsFile.write(flag);
+        }
+        edgeCount += edges.size();
+        blockEdgesFile.write(edgeCount);
+        progressBar.update(static_cast<uint32_t>(height - firstBlock));
+    }
+}
+
+void truncateTxPackages(const ParserConfigurationBase &config, blocksci::BlockHeight splitPoint) {
+    auto path = blocksci::ChainAccess::blockPackageEdgesFilePath(config.dataConfig.chainDirectory());
+    if (!filesystem::path{path.str() + ".dat"}.exists()) {
+        return;
+    }
+    blocksci::FixedSizeFileMapper<uint64_t, mio::access_mode::write> blockEdgesFile{path};
+    if (static_cast<blocksci::BlockHeight>(blockEdgesFile.size()) > splitPoint) {
+        blockEdgesFile.truncate(static_cast<blocksci::OffsetType>(splitPoint));
+    }
+}
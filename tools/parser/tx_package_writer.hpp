@@ -0,0 +1,26 @@
+//
+//  tx_package_writer.hpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef tx_package_writer_hpp
+#define tx_package_writer_hpp
+
+#include "parser_fwd.hpp"
+
+#include <blocksci/core/typedefs.hpp>
+
+/** Extend the same-block spend files (chain/tx_package_flags.dat, chain/block_package_edges.dat and the two edge
+ * files) to cover all blocks in the chain
+ *
+ * Like the block statistics they only depend on the txes of a block, so a data directory created by an older parser
+ * is filled in by its next update. */
+void updateTxPackages(const ParserConfigurationBase &config);
+
+/** Drop the entries of the blocks from splitPoint on, used when these blocks are undone. The per tx and per edge
+ * entries of these blocks are truncated by the next update. */
+void truncateTxPackages(const ParserConfigurationBase &config, blocksci::BlockHeight splitPoint);
+
+#endif /* tx_package_writer_hpp */
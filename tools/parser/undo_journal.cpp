@@ -0,0 +1,97 @@
+//
+//  undo_journal.cpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "undo_journal.hpp"
+#include "chain_index.hpp"
+#include "parser_configuration.hpp"
+
+#include <blocksci/core/raw_block.hpp>
+
+#include <cereal/archives/binary.hpp>
+#include <cereal/types/array.hpp>
+#include <cereal/types/vector.hpp>
+
+#include <fstream>
+#include <string>
+
+namespace {
+    filesystem::path undoFilePath(const ParserConfigurationBase &config, blocksci::BlockHeight height) {
+        return config.undoDirectory()/(std::to_string(height) + ".dat");
+    }
+}
+
+template<class Archive>
+void BlockUndo::serialize(Archive &archive) {
+    archive(version, height, hash, firstTxNum, scriptCounts, newAddresses, scripts);
+}
+
+bool BlockUndo::load(const ParserConfigurationBase &config, blocksci::BlockHeight height_) {
+    std::ifstream file(undoFilePath(config, height_).str(), std::ios::binary);
+    if (!file.good()) {
+        return false;
+    }
+    try {
+        cereal::BinaryInputArchive archive(file);
+        archive(*this);
+    } catch (const std::exception &) {
+        return false;
+    }
+    return version == currentVersion && height == height_;
+}
+
+void BlockUndo::remove(const ParserConfigurationBase &config, blocksci::BlockHeight height_) {
+    auto path = undoFilePath(config, height_);
+    if (path.exists()) {
+        path.remove_file();
+    }
+}
+
+void UndoJournalWriter::beginBlock(blocksci::BlockHeight height, uint32_t firstTxNum, const std::array<uint32_t, blocksci::DedupAddressType::size> &scriptCounts) {
+    if (!isJournaled(height)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &block = blocks[height];
+    block.height = height;
+    block.firstTxNum = firstTxNum;
+    block.scriptCounts = scriptCounts;
+    blockStarts[firstTxNum] = height;
+}
+
+void UndoJournalWriter::addAddresses(blocksci::BlockHeight height, const std::vector<UndoAddressKey> &keys) {
+    if (!isJournaled(height) || keys.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &block = blocks[height];
+    block.newAddresses.insert(block.newAddresses.end(), keys.begin(), keys.end());
+}
+
+void UndoJournalWriter::write(const ParserConfigurationBase &config, const std::vector<blocksci::RawBlock> &processedBlocks) {
+    auto directory = config.undoDirectory();
+    if (!directory.exists()) {
+        filesystem::create_directory(directory);
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto &rawBlock : processedBlocks) {
+        auto height = static_cast<blocksci::BlockHeight>(rawBlock.height);
+        auto it = blocks.find(height);
+        if (it != blocks.end()) {
+            auto &block = it->second;
+            block.hash = rawBlock.hash;
+            std::ofstream file(undoFilePath(config, height).str(), std::ios::binary | std::ios::trunc);
+            cereal::BinaryOutputArchive archive(file);
+            archive(block);
+        }
+
+        // Every block is added once, so this removes every journal once it falls out of the window
+        filesystem::path expired = undoFilePath(config, height - undoDepth);
+        if (expired.exists()) {
+            expired.remove_file();
+        }
+    }
+}
@@ -0,0 +1,156 @@
+//
+//  undo_journal.hpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef undo_journal_hpp
+#define undo_journal_hpp
+
+#include "parser_fwd.hpp"
+
+#include <blocksci/core/bitcoin_uint256.hpp>
+#include <blocksci/core/dedup_address_type.hpp>
+#include <blocksci/core/typedefs.hpp>
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace blocksci {
+    struct RawBlock;
+}
+
+/** Hash index key of a script that was first seen in the block */
+struct UndoAddressKey {
+    blocksci::DedupAddressType::Enum type;
+    uint32_t scriptNum;
+    uint8_t keySize;
+    std::array<unsigned char, 32> key;
+
+    template<class Archive>
+    void serialize(Archive &archive) {
+        archive(type, scriptNum, keySize, key);
+    }
+};
+
+/** Record of a script from an earlier block before the block first modified it */
+struct UndoScript {
+    /** Order in which the records of all blocks were taken, later records are undone first */
+    uint64_t sequence;
+    blocksci::DedupAddressType::Enum type;
+    uint32_t scriptNum;
+
+    /** Offsets of the script's components in the data file if the scripts of the type have variable size */
+    std::vector<uint64_t> offsets;
+
+    /** The fixed size part of the script data, which holds every field that changes once a script was written */
+    std::vector<char> data;
+
+    template<class Archive>
+    void serialize(Archive &archive) {
+        archive(sequence, type, scriptNum, offsets, data);
+    }
+};
+
+/** Undo journal of one block, stored as parser/undo/<height>.dat
+ *
+ * A block only appends to the chain files, so undoing it truncates them again and everything else that it changed
+ * can be derived from its transactions: the outputs it spent are stored with its inputs and the outputs it created
+ * with their addresses. The journal holds the rest, which is lost once the files are truncated: the number of scripts
+ * before the block, the hash index keys of the scripts it added and the previous state of the older scripts it
+ * updated (first spend, revealed pubkeys and wrapped scripts, the types they were seen as).
+ */
+struct BlockUndo {
+    static constexpr uint32_t currentVersion = 1;
+
+    uint32_t version = currentVersion;
+    blocksci::BlockHeight height = 0;
+    blocksci::uint256 hash;
+    uint32_t firstTxNum = 0;
+    std::array<uint32_t, blocksci::DedupAddressType::size> scriptCounts{};
+    std::vector<UndoAddressKey> newAddresses;
+    std::vector<UndoScript> scripts;
+
+    template<class Archive>
+    void serialize(Archive &archive);
+
+    /** Load the journal of the block at height, returns false if there is none or it is unreadable */
+    bool load(const ParserConfigurationBase &config, blocksci::BlockHeight height);
+    
+    /** Remove the journal of the block at height once the block was undone */
+    static void remove(const ParserConfigurationBase &config, blocksci::BlockHeight height);
+};
+
+/** Collects the undo journals of the blocks processed by one BlockProcessor::addNewBlocks call
+ *
+ * Only the last undoDepth blocks below the tip of the update are journaled, older blocks can't be reorganized by
+ * any realistic fork. The processing steps record into the journal concurrently, so all records are attributed to
+ * their block by height or tx number and guarded by a mutex.
+ */
+class UndoJournalWriter {
+    blocksci::BlockHeight firstJournaledHeight;
+
+    std::mutex mutex;
+    std::map<blocksci::BlockHeight, BlockUndo> blocks;
+
+    /** Height of the journaled blocks by their first tx number */
+    std::map<uint32_t, blocksci::BlockHeight> blockStarts;
+
+    /** Scripts already recorded for a block, only the state before its first change is needed */
+    std::set<std::tuple<blocksci::BlockHeight, blocksci::DedupAddressType::Enum, uint32_t>> recordedScripts;
+    uint64_t nextSequence = 0;
+
+public:
+    /** Blocks this deep below the tip keep their journal */
+    static constexpr blocksci::BlockHeight undoDepth = 100;
+
+    explicit UndoJournalWriter(blocksci::BlockHeight maxBlockHeight) : firstJournaledHeight(maxBlockHeight - undoDepth + 1) {}
+
+    bool isJournaled(blocksci::BlockHeight height) const {
+        return height >= firstJournaledHeight;
+    }
+
+    /** Called with the first tx of every block before any of its scripts are resolved */
+    void beginBlock(blocksci::BlockHeight height, uint32_t firstTxNum, const std::array<uint32_t, blocksci::DedupAddressType::size> &scriptCounts);
+
+    void addAddresses(blocksci::BlockHeight height, const std::vector<UndoAddressKey> &keys);
+
+    /** Record the script before the tx changes it unless the block of the tx already did or created it
+     *
+     * copy fills in the offsets and data of the record and is called with the lock held. */
+    template<typename Func>
+    void recordScript(uint32_t txNum, blocksci::DedupAddressType::Enum type, uint32_t scriptNum, Func &&copy) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = blockStarts.upper_bound(txNum);
+        if (it == blockStarts.begin()) {
+            return;
+        }
+        --it;
+        auto height = it->second;
+        auto &block = blocks[height];
+        if (scriptNum > block.scriptCounts[static_cast<size_t>(type)]) {
+            return;
+        }
+        if (!recordedScripts.emplace(height, type, scriptNum).second) {
+            return;
+        }
+        UndoScript script;
+        script.sequence = nextSequence++;
+        script.type = type;
+        script.scriptNum = scriptNum;
+        copy(script);
+        block.scripts.push_back(std::move(script));
+    }
+
+    /** Write the journals of the processed blocks and remove the ones that are now too deep */
+    void write(const ParserConfigurationBase &config, const std::vector<blocksci::RawBlock> &processedBlocks);
+};
+
+#endif /* undo_journal_hpp */
@@ -0,0 +1,87 @@
+//
+//  utxo_cold_store.cpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include "utxo_cold_store.hpp"
+
+#include <rocksdb/db.h>
+#include <rocksdb/filter_policy.h>
+#include <rocksdb/table.h>
+#include <rocksdb/write_batch.h>
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+UTXOColdStore::UTXOColdStore(const filesystem::path &path) {
+    rocksdb::Options options;
+    options.IncreaseParallelism();
+    options.OptimizeLevelStyleCompaction();
+    options.create_if_missing = true;
+
+    rocksdb::BlockBasedTableOptions tableOptions;
+    tableOptions.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10, false));
+    options.table_factory.reset(rocksdb::NewBlockBasedTableFactory(tableOptions));
+
+    rocksdb::DB *dbPtr;
+    rocksdb::Status s = rocksdb::DB::Open(options, path.str(), &dbPtr);
+    if (!s.ok()) {
+        throw std::runtime_error{"Could not open UTXO cold store with error: " + std::string{s.getState()}};
+    }
+    db.reset(dbPtr);
+}
+
+UTXOColdStore::~UTXOColdStore() = default;
+
+UTXOColdStore::Key UTXOColdStore::encodeKey(const RawOutputPointer &pointer) {
+    Key key;
+    std::memcpy(key.data(), pointer.hash.begin(), sizeof(blocksci::uint256));
+    std::memcpy(key.data() + sizeof(blocksci::uint256), &pointer.outputNum, sizeof(pointer.outputNum));
+    return key;
+}
+
+void UTXOColdStore::add(const std::vector<std::pair<RawOutputPointer, UTXO>> &utxos) {
+    rocksdb::WriteBatch batch;
+    for (auto &entry : utxos) {
+        auto key = encodeKey(entry.first);
+        batch.Put(rocksdb::Slice(key.data(), key.size()), rocksdb::Slice(reinterpret_cast<const char *>(&entry.second), sizeof(UTXO)));
+    }
+    rocksdb::WriteOptions writeOptions;
+    // The UTXOs are also part of the serialized state of the parser, which is only written after a successful update
+    writeOptions.disableWAL = true;
+    auto s = db->Write(writeOptions, &batch);
+    if (!s.ok()) {
+        throw std::runtime_error{"Could not write to UTXO cold store with error: " + std::string{s.getState()}};
+    }
+}
+
+bool UTXOColdStore::take(const RawOutputPointer &pointer, UTXO &utxo) {
+    auto key = encodeKey(pointer);
+    rocksdb::Slice keySlice(key.data(), key.size());
+    rocksdb::PinnableSlice value;
+    auto s = db->Get(rocksdb::ReadOptions{}, db->DefaultColumnFamily(), keySlice, &value);
+    if (s.IsNotFound()) {
+        return false;
+    }
+    if (!s.ok() || value.size() != sizeof(UTXO)) {
+        throw std::runtime_error{"Could not read from UTXO cold store"};
+    }
+    std::memcpy(&utxo, value.data(), sizeof(UTXO));
+    rocksdb::WriteOptions writeOptions;
+    writeOptions.disableWAL = true;
+    s = db->Delete(writeOptions, keySlice);
+    if (!s.ok()) {
+        throw std::runtime_error{"Could not delete from UTXO cold store with error: " + std::string{s.getState()}};
+    }
+    return true;
+}
+
+void UTXOColdStore::flush() {
+    auto s = db->Flush(rocksdb::FlushOptions{});
+    if (!s.ok()) {
+        throw std::runtime_error{"Could not flush UTXO cold store with error: " + std::string{s.getState()}};
+    }
+}
@@ -0,0 +1,55 @@
+//
+//  utxo_cold_store.hpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef utxo_cold_store_hpp
+#define utxo_cold_store_hpp
+
+#include "basic_types.hpp"
+#include "utxo.hpp"
+
+#include <wjfilesystem/path.h>
+
+#include <array>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace rocksdb {
+    class DB;
+}
+
+/** On-disk part of a UTXOState that is limited in memory
+ *
+ * Holds the UTXOs that were evicted from memory in a RocksDB database, which keeps them sorted by outpoint on disk.
+ * Every table file carries a bloom filter over its outpoints, so a lookup only reads the data blocks of the file
+ * that actually contains the UTXO.
+ *
+ * take() may be called from several threads at once, add() only while no other thread uses the store.
+ */
+class UTXOColdStore {
+    using Key = std::array<char, sizeof(blocksci::uint256) + sizeof(uint16_t)>;
+
+    std::unique_ptr<rocksdb::DB> db;
+
+    static Key encodeKey(const RawOutputPointer &pointer);
+
+public:
+    explicit UTXOColdStore(const filesystem::path &path);
+    UTXOColdStore(const UTXOColdStore &) = delete;
+    UTXOColdStore &operator=(const UTXOColdStore &) = delete;
+    ~UTXOColdStore();
+
+    void add(const std::vector<std::pair<RawOutputPointer, UTXO>> &utxos);
+
+    /** Remove the UTXO of pointer from the store, returns false if the store doesn't contain it */
+    bool take(const RawOutputPointer &pointer, UTXO &utxo);
+
+    /** Persist all changes, called whenever the in-memory part of the UTXO set is serialized */
+    void flush();
+};
+
+#endif /* utxo_cold_store_hpp */
@@ -0,0 +1,472 @@
+//
+//  utxo_state.cpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include "utxo_state.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+    /** Marks a file written by older versions of UTXOState::serialize with shards keyed by RawOutputPointer, the
+     * current version writes PackedUTXOMap::formatMagic and even older files start directly with a single map */
+    constexpr uint64_t shardedFormatMagic = 0x445248534F585455; // "UTXOSHRD"
+    
+    /** Starts every record of the delta log */
+    constexpr uint64_t deltaRecordMagic = 0x41544C444F585455; // "UTXODLTA"
+    
+    constexpr size_t minJournalPerShard = 1 << 16;
+    
+    std::string deltaLogPath(const std::string &path) {
+        return path + ".log";
+    }
+    
+    uint64_t fnv1a(const char *data, size_t length) {
+        uint64_t hash = 0xcbf29ce484222325;
+        for (size_t i = 0; i < length; i++) {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 0x100000001b3;
+        }
+        return hash;
+    }
+    
+    /** Record of the delta log: magic, payload length, payload and a checksum of the payload */
+    class DeltaRecordWriter {
+        std::vector<char> payload;
+        
+    public:
+        template <typename T>
+        void write(const T &value) {
+            auto data = reinterpret_cast<const char *>(&value);
+            payload.insert(payload.end(), data, data + sizeof(T));
+        }
+        
+        void write(const RawOutputPointer &pointer, const UTXO &utxo) {
+            payload.insert(payload.end(), pointer.hash.begin(), pointer.hash.end());
+            write(pointer.outputNum);
+            write(utxo.value);
+            write(utxo.txNum);
+            write(static_cast<uint8_t>(utxo.type));
+        }
+        
+        void finish(std::ostream &file) {
+            uint64_t length = payload.size();
+            uint64_t checksum = fnv1a(payload.data(), payload.size());
+            file.write(reinterpret_cast<const char *>(&deltaRecordMagic), sizeof(deltaRecordMagic));
+            file.write(reinterpret_cast<const char *>(&length), sizeof(length));
+            file.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+            file.write(reinterpret_cast<const char *>(&checksum), sizeof(checksum));
+        }
+    };
+    
+    class DeltaRecordReader {
+        const std::vector<char> &payload;
+        size_t offset = 0;
+        
+    public:
+        explicit DeltaRecordReader(const std::vector<char> &payload_) : payload(payload_) {}
+        
+        /** Read the payload of the next record, returns false at the end of the log or at a torn record */
+        static bool read(std::istream &file, std::vector<char> &payload) {
+            uint64_t magic = 0;
+            uint64_t length = 0;
+            uint64_t checksum = 0;
+            file.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+            file.read(reinterpret_cast<char *>(&length), sizeof(length));
+            if (!file || magic != deltaRecordMagic) {
+                return false;
+            }
+            payload.resize(length);
+            file.read(payload.data(), static_cast<std::streamsize>(length));
+            file.read(reinterpret_cast<char *>(&checksum), sizeof(checksum));
+            return file && checksum == fnv1a(payload.data(), payload.size());
+        }
+        
+        static uint64_t recordSize(const std::vector<char> &payload) {
+            return sizeof(deltaRecordMagic) + sizeof(uint64_t) + payload.size() + sizeof(uint64_t);
+        }
+        
+        template <typename T>
+        T read() {
+            if (offset + sizeof(T) > payload.size()) {
+                throw std::runtime_error("Corrupt UTXO checkpoint record");
+            }
+            T value;
+            std::memcpy(&value, payload.data() + offset, sizeof(T));
+            offset += sizeof(T);
+            return value;
+        }
+        
+        std::pair<RawOutputPointer, UTXO> readEntry() {
+            RawOutputPointer pointer;
+            for (auto it = pointer.hash.begin(); it != pointer.hash.end(); ++it) {
+                *it = read<unsigned char>();
+            }
+            pointer.outputNum = read<uint16_t>();
+            UTXO utxo;
+            utxo.value = read<int64_t>();
+            utxo.txNum = read<uint32_t>();
+            utxo.type = static_cast<blocksci::AddressType::Enum>(read<uint8_t>());
+            return {pointer, utxo};
+        }
+    };
+}
+
+UTXOState::UTXOState() {
+    for (uint32_t i = 0; i < shardCount; i++) {
+        shards.push_back(std::make_unique<Shard>());
+    }
+}
+
+void UTXOState::add(const RawOutputPointer &pointer, const UTXO &utxo) {
+    auto &shard = *shards[shardOf(pointer)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.map.add(pointer, utxo);
+    journalAdd(shard, pointer);
+}
+
+UTXO UTXOState::erase(const RawOutputPointer &pointer) {
+    {
+        auto &shard = *shards[shardOf(pointer)];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        UTXO utxo;
+        if (shard.map.take(pointer, utxo)) {
+            journalRemove(shard, pointer, utxo);
+            return utxo;
+        }
+    }
+    return takeCold(pointer);
+}
+
+UTXO UTXOState::takeCold(const RawOutputPointer &pointer) {
+    UTXO utxo;
+    if (!coldStore || !coldStore->take(pointer, utxo)) {
+        throw MissingKeyException();
+    }
+    return utxo;
+}
+
+std::vector<uint32_t> UTXOState::groupByShard(const RawOutputPointer *pointers, size_t count, uint32_t (&shardStarts)[shardCount + 1]) {
+    std::fill(std::begin(shardStarts), std::end(shardStarts), 0);
+    for (size_t i = 0; i < count; i++) {
+        shardStarts[shardOf(pointers[i]) + 1]++;
+    }
+    for (uint32_t i = 0; i < shardCount; i++) {
+        shardStarts[i + 1] += shardStarts[i];
+    }
+    uint32_t nextPosition[shardCount];
+    std::copy(shardStarts, shardStarts + shardCount, nextPosition);
+    std::vector<uint32_t> order(count);
+    for (size_t i = 0; i < count; i++) {
+        order[nextPosition[shardOf(pointers[i])]++] = static_cast<uint32_t>(i);
+    }
+    return order;
+}
+
+void UTXOState::addBatch(const RawOutputPointer *pointers, const UTXO *utxos, size_t count) {
+    uint32_t shardStarts[shardCount + 1];
+    auto order = groupByShard(pointers, count, shardStarts);
+    for (uint32_t shardNum = 0; shardNum < shardCount; shardNum++) {
+        if (shardStarts[shardNum] == shardStarts[shardNum + 1]) {
+            continue;
+        }
+        auto &shard = *shards[shardNum];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (auto i = shardStarts[shardNum]; i < shardStarts[shardNum + 1]; i++) {
+            shard.map.add(pointers[order[i]], utxos[order[i]]);
+            journalAdd(shard, pointers[order[i]]);
+        }
+    }
+}
+
+void UTXOState::eraseBatch(const RawOutputPointer *pointers, UTXO *utxos, size_t count) {
+    uint32_t shardStarts[shardCount + 1];
+    auto order = groupByShard(pointers, count, shardStarts);
+    std::vector<uint32_t> missing;
+    for (uint32_t shardNum = 0; shardNum < shardCount; shardNum++) {
+        if (shardStarts[shardNum] == shardStarts[shardNum + 1]) {
+            continue;
+        }
+        auto &shard = *shards[shardNum];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (auto i = shardStarts[shardNum]; i < shardStarts[shardNum + 1]; i++) {
+            if (shard.map.take(pointers[order[i]], utxos[order[i]])) {
+                journalRemove(shard, pointers[order[i]], utxos[order[i]]);
+            } else {
+                missing.push_back(order[i]);
+            }
+        }
+    }
+    // Disk reads happen without holding a shard lock
+    for (auto i : missing) {
+        utxos[i] = takeCold(pointers[i]);
+    }
+}
+
+size_t UTXOState::size() const {
+    size_t total = 0;
+    for (auto &shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total += shard->map.size();
+    }
+    return total;
+}
+
+void UTXOState::journalAdd(Shard &shard, const RawOutputPointer &pointer) {
+    if (journalFull.load(std::memory_order_relaxed)) {
+        return;
+    }
+    shard.added.insert(pointer);
+    if (shard.added.size() + shard.removed.size() > maxJournalPerShard) {
+        journalFull = true;
+    }
+}
+
+void UTXOState::journalRemove(Shard &shard, const RawOutputPointer &pointer, const UTXO &utxo) {
+    if (journalFull.load(std::memory_order_relaxed)) {
+        return;
+    }
+    // Outputs created and spent since the last checkpoint don't need to be recorded at all
+    if (shard.added.erase(pointer) == 0) {
+        shard.removed.emplace_back(pointer, utxo);
+        if (shard.added.size() + shard.removed.size() > maxJournalPerShard) {
+            journalFull = true;
+        }
+    }
+}
+
+void UTXOState::resetJournal() {
+    for (auto &shard : shards) {
+        std::unordered_set<RawOutputPointer>{}.swap(shard->added);
+        std::vector<std::pair<RawOutputPointer, UTXO>>{}.swap(shard->removed);
+    }
+    journalFull = false;
+    // Track up to half as many changes as the set holds before falling back to a snapshot
+    maxJournalPerShard = std::max(size() / shardCount / 2, minJournalPerShard);
+}
+
+void UTXOState::useColdStore(const filesystem::path &path, size_t maxInMemory_) {
+    coldStore = std::make_unique<UTXOColdStore>(path);
+    maxInMemory = maxInMemory_;
+}
+
+void UTXOState::spill() {
+    auto inMemory = size();
+    if (!coldStore || maxInMemory == 0 || inMemory <= maxInMemory) {
+        return;
+    }
+    
+    // Histogram of the creating transactions in buckets of 2^16 transactions
+    constexpr uint32_t bucketBits = 16;
+    std::vector<size_t> histogram;
+    for (auto &shard : shards) {
+        shard->map.forEach([&](const RawOutputPointer &, const UTXO &utxo) {
+            auto bucket = utxo.txNum >> bucketBits;
+            if (bucket >= histogram.size()) {
+                histogram.resize(bucket + 1);
+            }
+            histogram[bucket]++;
+        });
+    }
+    size_t toEvict = inMemory - (maxInMemory - maxInMemory / 4);
+    size_t evictedCount = 0;
+    uint64_t cutoffTxNum = 0;
+    for (size_t bucket = 0; bucket < histogram.size() && evictedCount < toEvict; bucket++) {
+        evictedCount += histogram[bucket];
+        cutoffTxNum = (uint64_t{bucket} + 1) << bucketBits;
+    }
+    
+    // The in-memory set changes wholesale, so the next checkpoint has to be a full snapshot
+    journalFull = true;
+    
+    auto cutoff = static_cast<uint32_t>(std::min<uint64_t>(cutoffTxNum, std::numeric_limits<uint32_t>::max()));
+    std::vector<std::pair<RawOutputPointer, UTXO>> evicted;
+    for (auto &shard : shards) {
+        evicted.clear();
+        shard->map.evictBefore(cutoff, evicted);
+        coldStore->add(evicted);
+    }
+    std::cout << "Moved " << evictedCount << " UTXOs created before tx " << cutoffTxNum << " to disk" << std::endl;
+}
+
+void UTXOState::addAll(const Map &map) {
+    for (auto &entry : map) {
+        shards[shardOf(entry.first)]->map.add(entry.first, entry.second);
+    }
+}
+
+void UTXOState::loadSnapshot(const std::string &path) {
+    std::ifstream file{path, std::ifstream::in | std::ifstream::binary};
+    uint64_t magic = 0;
+    file.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+    if (!file || (magic != PackedUTXOMap::formatMagic && magic != shardedFormatMagic)) {
+        file.clear();
+        file.seekg(0);
+        auto legacyMap = makeMap();
+        legacyMap.unserialize(file, path);
+        addAll(legacyMap);
+        snapshotId = 0;
+        return;
+    }
+    uint32_t storedShardCount = 0;
+    file.read(reinterpret_cast<char *>(&storedShardCount), sizeof(storedShardCount));
+    file.read(reinterpret_cast<char *>(&snapshotId), sizeof(snapshotId));
+    if (!file) {
+        throw Map::BadSerializationFormatException{path};
+    }
+    for (uint32_t i = 0; i < storedShardCount; i++) {
+        if (magic == shardedFormatMagic) {
+            auto storedShard = makeMap();
+            storedShard.unserialize(file, path);
+            addAll(storedShard);
+        } else if (storedShardCount == shardCount) {
+            shards[i]->map.unserialize(file, path);
+        } else {
+            PackedUTXOMap storedShard;
+            storedShard.unserialize(file, path);
+            storedShard.forEach([&](const RawOutputPointer &pointer, const UTXO &utxo) {
+                shards[shardOf(pointer)]->map.add(pointer, utxo);
+            });
+        }
+    }
+}
+
+bool UTXOState::unserialize(const std::string &path) {
+    if (!filesystem::path{path}.exists()) {
+        resetJournal();
+        return false;
+    }
+    loadSnapshot(path);
+    replayDeltas(deltaLogPath(path));
+    resetJournal();
+    return true;
+}
+
+bool UTXOState::writeSnapshot(const std::string &path) {
+    // Written next to the old snapshot and renamed over it, so a crash leaves either the old or the new one
+    auto tempPath = path + ".tmp";
+    {
+        std::ofstream file{tempPath, std::ofstream::out | std::ofstream::binary};
+        uint32_t storedShardCount = shardCount;
+        uint64_t newSnapshotId = snapshotId + 1;
+        file.write(reinterpret_cast<const char *>(&PackedUTXOMap::formatMagic), sizeof(PackedUTXOMap::formatMagic));
+        file.write(reinterpret_cast<const char *>(&storedShardCount), sizeof(storedShardCount));
+        file.write(reinterpret_cast<const char *>(&newSnapshotId), sizeof(newSnapshotId));
+        for (auto &shard : shards) {
+            if (!shard->map.serialize(file)) {
+                return false;
+            }
+        }
+        file.flush();
+        if (!file) {
+            return false;
+        }
+    }
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        return false;
+    }
+    snapshotId++;
+    // Records of the log carry the old snapshot id and would be skipped anyway
+    filesystem::path logPath{deltaLogPath(path)};
+    if (logPath.exists()) {
+        logPath.remove_file();
+    }
+    return true;
+}
+
+bool UTXOState::appendDelta(const std::string &logPath) {
+    DeltaRecordWriter record;
+    uint64_t addedCount = 0;
+    uint64_t removedCount = 0;
+    for (auto &shard : shards) {
+        addedCount += shard->added.size();
+        removedCount += shard->removed.size();
+    }
+    record.write(snapshotId);
+    record.write(addedCount);
+    record.write(removedCount);
+    for (auto &shard : shards) {
+        for (auto &pointer : shard->added) {
+            UTXO utxo;
+            bool found = shard->map.find(pointer, utxo);
+            assert(found);
+            (void)found;
+            record.write(pointer, utxo);
+        }
+    }
+    for (auto &shard : shards) {
+        for (auto &entry : shard->removed) {
+            record.write(entry.first, entry.second);
+        }
+    }
+    std::ofstream file{logPath, std::ofstream::out | std::ofstream::binary | std::ofstream::app};
+    record.finish(file);
+    file.flush();
+    return static_cast<bool>(file);
+}
+
+void UTXOState::replayDeltas(const std::string &logPath) {
+    std::ifstream file{logPath, std::ifstream::in | std::ifstream::binary};
+    if (!file.is_open()) {
+        return;
+    }
+    uint64_t validLength = 0;
+    uint64_t replayedCount = 0;
+    std::vector<char> payload;
+    while (DeltaRecordReader::read(file, payload)) {
+        validLength += DeltaRecordReader::recordSize(payload);
+        DeltaRecordReader record{payload};
+        uint64_t recordSnapshotId = record.read<uint64_t>();
+        uint64_t addedCount = record.read<uint64_t>();
+        uint64_t removedCount = record.read<uint64_t>();
+        if (recordSnapshotId != snapshotId) {
+            continue;
+        }
+        std::vector<std::pair<RawOutputPointer, UTXO>> addedEntries;
+        addedEntries.reserve(addedCount);
+        for (uint64_t i = 0; i < addedCount; i++) {
+            addedEntries.push_back(record.readEntry());
+        }
+        // Outputs spent in a run were all created before it, so removing first keeps re-added outputs
+        for (uint64_t i = 0; i < removedCount; i++) {
+            auto entry = record.readEntry();
+            UTXO utxo;
+            shards[shardOf(entry.first)]->map.take(entry.first, utxo);
+        }
+        for (auto &entry : addedEntries) {
+            shards[shardOf(entry.first)]->map.add(entry.first, entry.second);
+        }
+        replayedCount++;
+    }
+    file.close();
+    // Drop a record torn by a crash so that the next record is appended right after the last valid one
+    filesystem::path log{logPath};
+    if (log.file_size() != validLength) {
+        log.resize_file(validLength);
+    }
+    if (replayedCount > 0) {
+        std::cout << "Replayed " << replayedCount << " UTXO checkpoint records" << std::endl;
+    }
+}
+
+bool UTXOState::serialize(const std::string &path) {
+    if (coldStore) {
+        coldStore->flush();
+    }
+    filesystem::path snapshotPath{path};
+    filesystem::path logPath{deltaLogPath(path)};
+    bool fullSnapshot = journalFull || !snapshotPath.exists() || (logPath.exists() && logPath.file_size() > snapshotPath.file_size() / 2);
+    bool success = fullSnapshot ? writeSnapshot(path) : appendDelta(logPath.str());
+    resetJournal();
+    return success;
+}
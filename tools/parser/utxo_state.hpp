@@ -9,16 +9,125 @@
 #ifndef utxo_state_hpp
 #define utxo_state_hpp
 
+#include "packed_utxo_map.hpp"
 #include "serializable_map.hpp"
+#include "utxo_cold_store.hpp"
 #include "basic_types.hpp"
 #include "utxo.hpp"
 
 #include <blocksci/core/inout_pointer.hpp>
 
-/** Map of the current UTXO set of the parser */
-class UTXOState : public SerializableMap<RawOutputPointer, UTXO> {
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/** Map of the current UTXO set of the parser, split into shards that are locked independently
+ *
+ * An output's shard is taken from a byte of its txid, which is already uniformly distributed, so the shards stay
+ * balanced. Threads that update different shards never contend, which lets ConnectUTXOsStep spend inputs on the
+ * shared pool while outputs are still being added in order. The batch functions group the updates of many
+ * transactions by shard and take every shard lock only once.
+ */
+class UTXOState {
+public:
+    /** Format of the UTXO maps written by older versions of the parser */
+    using Map = SerializableMap<RawOutputPointer, UTXO>;
+    using MissingKeyException = Map::MissingKeyException;
+    
+    static constexpr uint32_t shardCount = 64;
+    
+private:
+    struct Shard {
+        std::mutex mutex;
+        PackedUTXOMap map;
+        
+        /** Net changes since the last checkpoint: outputs added and still unspent, and spent outputs that were
+         * part of the last checkpoint */
+        std::unordered_set<RawOutputPointer> added;
+        std::vector<std::pair<RawOutputPointer, UTXO>> removed;
+    };
+    
+    std::vector<std::unique_ptr<Shard>> shards;
+    
+    /** Set once the changes are too many to track, the next checkpoint is then a full snapshot */
+    std::atomic<bool> journalFull{false};
+    size_t maxJournalPerShard = 0;
+    
+    /** Identifies the snapshot that the records of the delta log apply to */
+    uint64_t snapshotId = 0;
+    
+    /** UTXOs evicted from memory, only used if a memory limit was set with useColdStore() */
+    std::unique_ptr<UTXOColdStore> coldStore;
+    size_t maxInMemory = 0;
+    
+    static uint32_t shardOf(const RawOutputPointer &pointer) {
+        return pointer.hash.begin()[0] % shardCount;
+    }
+    
+    /** Indexes of pointers ordered by their shard, shardStarts[i] is the first index of shard i */
+    static std::vector<uint32_t> groupByShard(const RawOutputPointer *pointers, size_t count, uint32_t (&shardStarts)[shardCount + 1]);
+    
+    static Map makeMap() {
+        return Map({blocksci::uint256{}, 0}, {blocksci::uint256{}, 1});
+    }
+    
+    void addAll(const Map &map);
+    
+    /** Must be called with the shard's lock held */
+    void journalAdd(Shard &shard, const RawOutputPointer &pointer);
+    void journalRemove(Shard &shard, const RawOutputPointer &pointer, const UTXO &utxo);
+    void resetJournal();
+    
+    void loadSnapshot(const std::string &path);
+    bool writeSnapshot(const std::string &path);
+    bool appendDelta(const std::string &logPath);
+    void replayDeltas(const std::string &logPath);
+    
+    /** Look up a UTXO missing from memory in the cold store */
+    UTXO takeCold(const RawOutputPointer &pointer);
+    
 public:
-    UTXOState() : SerializableMap<RawOutputPointer, UTXO>({blocksci::uint256{}, 0}, {blocksci::uint256{}, 1}) {}
+    UTXOState();
+    
+    void add(const RawOutputPointer &pointer, const UTXO &utxo);
+    
+    /** Remove and return the UTXO of pointer, throws MissingKeyException if there is no such UTXO */
+    UTXO erase(const RawOutputPointer &pointer);
+    
+    void addBatch(const RawOutputPointer *pointers, const UTXO *utxos, size_t count);
+    
+    /** Erase all pointers and store their UTXOs in utxos, in the same order */
+    void eraseBatch(const RawOutputPointer *pointers, UTXO *utxos, size_t count);
+    
+    /** Number of UTXOs held in memory */
+    size_t size() const;
+    
+    /** Keep at most maxInMemory UTXOs in memory and move the oldest ones to a RocksDB database at path. With a limit
+     * of 0 UTXOs stored at path by earlier runs are still found, but no new ones are evicted */
+    void useColdStore(const filesystem::path &path, size_t maxInMemory);
+    
+    /** Move UTXOs to the cold store if more than the limit are in memory, must only be called between updates
+     *
+     * Old outputs are much less likely to be spent than new ones, so the outputs created by the oldest
+     * transactions are evicted until a quarter of the limit is free again. */
+    void spill();
+    
+    /** Load the UTXO set, either written by serialize() or by older versions of the parser as a single map or as
+     * shards keyed by RawOutputPointer */
+    bool unserialize(const std::string &path);
+    
+    /** Checkpoint the UTXO set
+     *
+     * Appends the changes since the last checkpoint as one record to the delta log next to path, so an incremental
+     * update only writes what it changed. A full snapshot replaces path and the log once the log grows past half
+     * the size of the snapshot or the changes were too many to track. Records carry a checksum and the id of the
+     * snapshot they apply to, so a record torn by a crash or left over from a replaced snapshot is skipped when
+     * loading. */
+    bool serialize(const std::string &path);
 };
 
 class UTXOScriptState : public SerializableMap<blocksci::InoutPointer, uint32_t> {
@@ -0,0 +1,62 @@
+//
+//  witness_stack.hpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef witness_stack_hpp
+#define witness_stack_hpp
+
+#include "config.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+class SafeMemReader;
+
+struct WitnessStackItem {
+    uint32_t length = 0;
+    const char *itemBegin = nullptr;
+
+    WitnessStackItem(const char *itemBegin_, uint32_t length_) : length(length_), itemBegin(itemBegin_) {}
+
+    #ifdef BLOCKSCI_FILE_PARSER
+    WitnessStackItem(SafeMemReader &reader);
+    #endif
+};
+
+/** Non-owning view of the witness stack of an input, whose items live in the arena of their transaction */
+struct WitnessStack {
+    const WitnessStackItem *items = nullptr;
+    uint32_t count = 0;
+
+    WitnessStack() = default;
+    WitnessStack(const WitnessStackItem *items_, uint32_t count_) : items(items_), count(count_) {}
+
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    const WitnessStackItem &operator[](size_t i) const {
+        return items[i];
+    }
+
+    const WitnessStackItem &back() const {
+        return items[count - 1];
+    }
+
+    const WitnessStackItem *begin() const {
+        return items;
+    }
+
+    const WitnessStackItem *end() const {
+        return items + count;
+    }
+};
+
+#endif /* witness_stack_hpp */
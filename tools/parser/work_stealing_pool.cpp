@@ -0,0 +1,135 @@
+//
+//  work_stealing_pool.cpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#include "work_stealing_pool.hpp"
+
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(uint32_t threadCount) {
+    threadCount = std::max(threadCount, 1u);
+    for (uint32_t i = 0; i < threadCount; i++) {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    for (uint32_t i = 0; i < threadCount; i++) {
+        workers.emplace_back([this, i]() { runWorker(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+void WorkStealingPool::submit(std::function<void()> task) {
+    auto &queue = *queues[nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    {
+        // Taking the lock orders the increment with the check of an idle worker about to wait
+        std::lock_guard<std::mutex> lock(idleMutex);
+        queuedTasks.fetch_add(1, std::memory_order_release);
+    }
+    workAvailable.notify_one();
+}
+
+bool WorkStealingPool::popTask(size_t workerNum, std::function<void()> &task) {
+    {
+        auto &queue = *queues[workerNum];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+    for (size_t i = 1; i < queues.size(); i++) {
+        auto &queue = *queues[(workerNum + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::runWorker(size_t workerNum) {
+    std::function<void()> task;
+    while (true) {
+        if (popTask(workerNum, task)) {
+            queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+            task();
+            task = nullptr;
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(idleMutex);
+        workAvailable.wait(lock, [&]() {
+            return stopping || queuedTasks.load(std::memory_order_acquire) > 0;
+        });
+        if (stopping && queuedTasks.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+}
+
+void WorkStealingPool::parallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)> &func) {
+    grainSize = std::max(grainSize, size_t{1});
+    auto rangeCount = (count + grainSize - 1) / grainSize;
+    if (rangeCount <= 1) {
+        if (count > 0) {
+            func(0, count);
+        }
+        return;
+    }
+
+    struct SharedState {
+        std::atomic<size_t> nextRange{0};
+        size_t doneRanges = 0;
+        std::mutex mutex;
+        std::condition_variable allDone;
+    };
+
+    // Helpers can start after the call returned, so they only touch func while ranges are left
+    auto state = std::make_shared<SharedState>();
+    auto runRanges = [state, rangeCount, count, grainSize, &func]() {
+        size_t finished = 0;
+        size_t range;
+        while ((range = state->nextRange.fetch_add(1, std::memory_order_relaxed)) < rangeCount) {
+            auto begin = range * grainSize;
+            func(begin, std::min(begin + grainSize, count));
+            finished++;
+        }
+        if (finished > 0) {
+            bool last;
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->doneRanges += finished;
+                last = state->doneRanges == rangeCount;
+            }
+            if (last) {
+                state->allDone.notify_one();
+            }
+        }
+    };
+
+    auto helperCount = std::min(threadCount(), rangeCount - 1);
+    for (size_t i = 0; i < helperCount; i++) {
+        submit(runRanges);
+    }
+    runRanges();
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->allDone.wait(lock, [&]() { return state->doneRanges == rangeCount; });
+}
@@ -0,0 +1,68 @@
+//
+//  work_stealing_pool.hpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/14/26.
+//
+
+#ifndef work_stealing_pool_hpp
+#define work_stealing_pool_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** Thread pool shared by all order-free processing steps of the parser pipeline
+ *
+ * Every worker owns a task queue. Submitted tasks are distributed round robin over the queues, workers take tasks
+ * from the front of their own queue and steal from the back of the other queues once theirs is empty, so a step that
+ * submits a burst of work is spread over all idle workers.
+ */
+class WorkStealingPool {
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex idleMutex;
+    std::condition_variable workAvailable;
+    std::atomic<uint64_t> queuedTasks{0};
+    std::atomic<uint32_t> nextQueue{0};
+    bool stopping = false;
+
+    bool popTask(size_t workerNum, std::function<void()> &task);
+    void runWorker(size_t workerNum);
+
+public:
+    explicit WorkStealingPool(uint32_t threadCount);
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    /** Runs all tasks that have already been submitted before joining the workers */
+    ~WorkStealingPool();
+
+    /** Tasks must not throw */
+    void submit(std::function<void()> task);
+
+    /** Calls func(begin, end) over [0, count) in ranges of grainSize and returns once all ranges are done
+     *
+     * The calling thread works on the ranges as well, so this can't deadlock when every worker is busy. func must
+     * not throw.
+     */
+    void parallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)> &func);
+
+    size_t threadCount() const {
+        return workers.size();
+    }
+};
+
+#endif /* work_stealing_pool_hpp */
@@ -0,0 +1,95 @@
+//
+//  write_behind_queue.cpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "write_behind_queue.hpp"
+
+#include <algorithm>
+
+WriteBehindQueue::WriteBehindQueue(uint32_t writerCount, size_t maxPendingRows_) : maxPendingRows(maxPendingRows_) {
+    writerCount = std::max(writerCount, 1u);
+    for (uint32_t i = 0; i < writerCount; i++) {
+        writers.emplace_back([this]() { runWriter(); });
+    }
+}
+
+WriteBehindQueue::~WriteBehindQueue() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    for (auto &writer : writers) {
+        writer.join();
+    }
+}
+
+void WriteBehindQueue::runWriter() {
+    while (true) {
+        Write write;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&]() { return stopping || !writes.empty(); });
+            if (writes.empty()) {
+                return;
+            }
+            write = std::move(writes.front());
+            writes.pop_front();
+            activeWrites++;
+        }
+        std::exception_ptr writeError;
+        try {
+            write.func();
+        } catch (...) {
+            writeError = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            activeWrites--;
+            pendingRows -= write.rowCount;
+            if (writeError && !error) {
+                error = writeError;
+            }
+        }
+        changed.notify_all();
+    }
+}
+
+void WriteBehindQueue::rethrowError() {
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void WriteBehindQueue::submit(size_t rowCount, std::function<void()> write) {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() {
+            return error || pendingRows == 0 || pendingRows + rowCount <= maxPendingRows;
+        });
+        rethrowError();
+        pendingRows += rowCount;
+        writes.push_back(Write{rowCount, std::move(write)});
+    }
+    changed.notify_all();
+}
+
+void WriteBehindQueue::waitUntil(const std::function<bool()> &done) {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [&]() { return error || done(); });
+    rethrowError();
+}
+
+void WriteBehindQueue::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [&]() { return error || (writes.empty() && activeWrites == 0); });
+    rethrowError();
+}
+
+size_t WriteBehindQueue::queuedRows() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pendingRows;
+}
@@ -0,0 +1,67 @@
+//
+//  write_behind_queue.hpp
+//  blocksci_parser
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef write_behind_queue_hpp
+#define write_behind_queue_hpp
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** Background threads writing the flushed caches of HashIndexCreator to the hash index
+ *
+ * The writes run on writerCount threads, so the flushes of different column families overlap with each other and
+ * with the parser filling the next caches. submit() blocks while more than maxPendingRows rows are queued or being
+ * written, which bounds the memory held by flushes that haven't reached RocksDB yet. An exception thrown by a write
+ * is rethrown by the next call on the parser's thread.
+ */
+class WriteBehindQueue {
+    struct Write {
+        size_t rowCount;
+        std::function<void()> func;
+    };
+
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Write> writes;
+    size_t pendingRows = 0;
+    size_t activeWrites = 0;
+    size_t maxPendingRows;
+    bool stopping = false;
+    std::exception_ptr error;
+    std::vector<std::thread> writers;
+
+    void runWriter();
+    void rethrowError();
+
+public:
+    WriteBehindQueue(uint32_t writerCount, size_t maxPendingRows);
+    WriteBehindQueue(const WriteBehindQueue &) = delete;
+    WriteBehindQueue &operator=(const WriteBehindQueue &) = delete;
+
+    /** Finishes the queued writes before joining the writers, their errors are dropped */
+    ~WriteBehindQueue();
+
+    /** Queue write, which stores rowCount rows. A single write larger than maxPendingRows only waits for the queue to
+     * run empty. */
+    void submit(size_t rowCount, std::function<void()> write);
+
+    /** Block until done returns true, it is checked whenever a write finished */
+    void waitUntil(const std::function<bool()> &done);
+
+    /** Block until all queued writes finished */
+    void wait();
+
+    size_t queuedRows() const;
+};
+
+#endif /* write_behind_queue_hpp */
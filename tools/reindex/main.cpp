@@ -0,0 +1,492 @@
+//
+//  main.cpp
+//
+//  blocksci_reindex
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#define BLOCKSCI_WITHOUT_SINGLETON
+
+#include <blocksci/core/bitcoin_uint256.hpp>
+#include <blocksci/core/dedup_address.hpp>
+#include <blocksci/core/inout_pointer.hpp>
+#include <blocksci/core/raw_address.hpp>
+#include <blocksci/core/raw_transaction.hpp>
+#include <blocksci/core/script_data.hpp>
+#include <blocksci/scripts/bitcoin_pubkey.hpp>
+
+#include <internal/address_index.hpp>
+#include <internal/address_info.hpp>
+#include <internal/address_tables.hpp>
+#include <internal/chain_access.hpp>
+#include <internal/data_configuration.hpp>
+#include <internal/hash.hpp>
+#include <internal/hash_index.hpp>
+#include <internal/script_access.hpp>
+#include <internal/segment_work.hpp>
+#include <internal/state.hpp>
+#include <internal/tx_hash_table.hpp>
+
+#include <clipp.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace blocksci;
+
+namespace {
+    /** Rows a segment collects before handing them to the index, which serializes the writes into its bulk loader */
+    constexpr size_t rowBatchSize = 100'000;
+
+    /** Column families selected for the rebuild, all of them if none was named */
+    struct ColumnSelection {
+        std::set<std::string> names;
+
+        bool contains(const std::string &name) const {
+            return names.empty() || names.find(name) != names.end();
+        }
+    };
+
+    std::string outputColumnName(AddressType::Enum type) {
+        return addressName(type) + "_output";
+    }
+
+    std::string nestedColumnName(AddressType::Enum type) {
+        return addressName(type) + "_nested";
+    }
+
+    /** Address columns of the hash index filled from the scripts, the other address types have no hash key */
+    constexpr std::array<AddressType::Enum, 5> hashedAddressTypes = {{AddressType::PUBKEYHASH, AddressType::SCRIPTHASH, AddressType::WITNESS_SCRIPTHASH, AddressType::MULTISIG, AddressType::WITNESS_TAPROOT}};
+
+    std::vector<std::string> addressIndexColumns() {
+        std::vector<std::string> names;
+        for (size_t i = 0; i < AddressType::size; i++) {
+            auto type = static_cast<AddressType::Enum>(i);
+            names.push_back(outputColumnName(type));
+            names.push_back(nestedColumnName(type));
+        }
+        return names;
+    }
+
+    std::vector<std::string> hashIndexColumns() {
+        std::vector<std::string> names{"T"};
+        for (auto type : hashedAddressTypes) {
+            names.push_back(addressName(type));
+        }
+        return names;
+    }
+
+    /** Collect rows of one segment and pass them to write in batches of rowBatchSize */
+    template <typename Row>
+    class RowBatch {
+        std::vector<Row> rows;
+        std::function<void(std::vector<Row>)> write;
+
+    public:
+        explicit RowBatch(std::function<void(std::vector<Row>)> write_) : write(std::move(write_)) {
+            rows.reserve(rowBatchSize);
+        }
+
+        RowBatch(const RowBatch &) = delete;
+        RowBatch &operator=(const RowBatch &) = delete;
+
+        ~RowBatch() {
+            flush();
+        }
+
+        template <typename... Args>
+        void add(Args &&... args) {
+            rows.emplace_back(std::forward<Args>(args)...);
+            if (rows.size() >= rowBatchSize) {
+                flush();
+            }
+        }
+
+        void flush() {
+            if (!rows.empty()) {
+                write(std::move(rows));
+                rows.clear();
+                rows.reserve(rowBatchSize);
+            }
+        }
+    };
+
+    /** Run job(start, end) over consecutive segments of [start, end) on threadCount threads, rethrowing the first
+     * exception of a segment once all of them finished */
+    template <typename Job>
+    void runParallel(uint32_t start, uint32_t end, uint32_t threadCount, Job job) {
+        if (start >= end) {
+            return;
+        }
+        std::mutex errorMutex;
+        std::exception_ptr error;
+        runSegments(splitSegments(start, end, threadCount), [&](uint32_t, uint32_t segmentStart, uint32_t segmentEnd) {
+            try {
+                job(segmentStart, segmentEnd);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        });
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    double secondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /** Key of a multisig script in the hash index, the same as the parser derives from the output script: ripemd160 of
+     * the required signature count followed by the hash160 of every 65 byte padded pubkey in sorted order */
+    uint160 multisigKey(const MultisigData &multisig, const ScriptAccess &scripts) {
+        std::vector<RawPubkey> pubkeys;
+        pubkeys.reserve(multisig.addresses.size());
+        for (auto addressNum : multisig.addresses) {
+            auto pubkey = scripts.getScriptData<DedupAddressType::PUBKEY>(addressNum);
+            if (!pubkey->hasPubkey) {
+                throw std::runtime_error("Pubkey " + std::to_string(addressNum) + " of a multisig script is missing from the script data");
+            }
+            pubkeys.push_back(pubkey->pubkey);
+        }
+        std::sort(pubkeys.begin(), pubkeys.end());
+        std::vector<char> sigData(sizeof(multisig.m) + sizeof(uint160) * pubkeys.size());
+        memcpy(sigData.data(), &multisig.m, sizeof(multisig.m));
+        size_t sigDataPos = sizeof(multisig.m);
+        for (auto &pubkey : pubkeys) {
+            auto addressHash = hash160(pubkey.data(), pubkey.size());
+            memcpy(&sigData[sigDataPos], &addressHash, sizeof(addressHash));
+            sigDataPos += sizeof(addressHash);
+        }
+        return ripemd160(sigData.data(), sigData.size());
+    }
+
+    /** Rebuild the selected "_output" and "_nested" columns of the address index
+     *
+     * The AddressTables are immutable files and kept, the columns receive the outputs and relations of the
+     * transactions they don't cover, exactly what the parser's address index update leaves in them. */
+    void reindexAddresses(const DataConfiguration &config, const ChainAccess &chain, const ScriptAccess &scripts, const ColumnSelection &columns, uint32_t threadCount) {
+        AddressIndex db(config.addressDBFilePath(), IndexOpenMode::ReadWrite, nullptr, config.addressIndexTuning);
+        auto txCount = static_cast<uint32_t>(chain.txCount());
+        auto coveredTxCount = std::min(AddressTables{config.addressTablesDirectory()}.txCount(), txCount);
+
+        std::array<bool, AddressType::size> outputTypes{};
+        std::array<bool, AddressType::size> nestedTypes{};
+        bool anyOutputs = false;
+        for (size_t index = 0; index < AddressType::size; index++) {
+            auto type = static_cast<AddressType::Enum>(index);
+            outputTypes[index] = columns.contains(outputColumnName(type));
+            nestedTypes[index] = columns.contains(nestedColumnName(type));
+            if (outputTypes[index]) {
+                db.clearOutputColumn(type);
+                anyOutputs = true;
+            }
+            if (nestedTypes[index]) {
+                db.clearNestedColumn(type);
+            }
+        }
+
+        db.beginBulkLoad();
+
+        if (anyOutputs) {
+            std::cout << "Collecting the outputs of txes " << coveredTxCount << " to " << txCount << std::endl;
+            auto start = std::chrono::steady_clock::now();
+            runParallel(coveredTxCount, txCount, threadCount, [&](uint32_t segmentStart, uint32_t segmentEnd) {
+                RowBatch<std::pair<RawAddress, InoutPointer>> outputs{[&](std::vector<std::pair<RawAddress, InoutPointer>> rows) {
+                    db.addOutputAddresses(std::move(rows));
+                }};
+                for (uint32_t txNum = segmentStart; txNum < segmentEnd; txNum++) {
+                    auto tx = chain.getTx(txNum);
+                    for (uint16_t i = 0; i < tx->outputCount; i++) {
+                        auto &output = tx->getOutput(i);
+                        if (outputTypes[static_cast<size_t>(output.getType())]) {
+                            outputs.add(RawAddress{output.getAddressNum(), output.getType()}, InoutPointer{txNum, i});
+                        }
+                    }
+                }
+            });
+            std::cout << "Collected outputs in " << secondsSince(start) << "s" << std::endl;
+        }
+
+        auto addNested = [&](auto &batch, const RawAddress &child, const DedupAddress &parent) {
+            if (nestedTypes[static_cast<size_t>(child.type)]) {
+                batch.add(child, parent);
+            }
+        };
+        auto writeNested = [&](std::vector<std::pair<RawAddress, DedupAddress>> rows) {
+            db.addNestedAddresses(std::move(rows));
+        };
+
+        if (std::any_of(nestedTypes.begin(), nestedTypes.end(), [](bool selected) { return selected; })) {
+            auto start = std::chrono::steady_clock::now();
+            // A scripthash address is linked to the address it wraps by the tx that first spends it
+            std::cout << "Collecting the addresses wrapped by scripthash scripts" << std::endl;
+            runParallel(1, scripts.scriptCount(DedupAddressType::SCRIPTHASH) + 1, threadCount, [&](uint32_t segmentStart, uint32_t segmentEnd) {
+                RowBatch<std::pair<RawAddress, DedupAddress>> nested{writeNested};
+                for (uint32_t scriptNum = segmentStart; scriptNum < segmentEnd; scriptNum++) {
+                    auto scriptHash = scripts.getScriptData<DedupAddressType::SCRIPTHASH>(scriptNum);
+                    if (scriptHash->hasWrappedAddress() && scriptHash->hasBeenSpent() && scriptHash->txFirstSpent >= coveredTxCount && scriptHash->txFirstSpent < txCount) {
+                        addNested(nested, scriptHash->wrappedAddress, DedupAddress{scriptNum, DedupAddressType::SCRIPTHASH});
+                    }
+                }
+            });
+            // A multisig address is linked to its pubkeys by the tx it first appears in
+            std::cout << "Collecting the pubkeys of multisig scripts" << std::endl;
+            runParallel(1, scripts.scriptCount(DedupAddressType::MULTISIG) + 1, threadCount, [&](uint32_t segmentStart, uint32_t segmentEnd) {
+                RowBatch<std::pair<RawAddress, DedupAddress>> nested{writeNested};
+                for (uint32_t scriptNum = segmentStart; scriptNum < segmentEnd; scriptNum++) {
+                    auto multisig = scripts.getScriptData<DedupAddressType::MULTISIG>(scriptNum);
+                    if (multisig->txFirstSeen >= coveredTxCount && multisig->txFirstSeen < txCount) {
+                        for (auto addressNum : multisig->addresses) {
+                            addNested(nested, RawAddress{addressNum, AddressType::MULTISIG_PUBKEY}, DedupAddress{scriptNum, DedupAddressType::MULTISIG});
+                        }
+                    }
+                }
+            });
+            std::cout << "Collected nesting relations in " << secondsSince(start) << "s" << std::endl;
+        }
+
+        std::cout << "Ingesting the address index files" << std::endl;
+        auto start = std::chrono::steady_clock::now();
+        db.finishBulkLoad();
+        std::cout << "Ingested in " << secondsSince(start) << "s" << std::endl;
+    }
+
+    /** Rebuild the selected columns of the hash index
+     *
+     * The address columns are rebuilt from the keys stored with the scripts, the "T" column from the hashes of the
+     * transactions that the TxHashTable doesn't cover. */
+    void reindexHashes(const DataConfiguration &config, const ChainAccess &chain, const ScriptAccess &scripts, const ColumnSelection &columns, uint32_t threadCount) {
+        HashIndex db(config.hashIndexFilePath(), IndexOpenMode::ReadWrite, nullptr, config.hashIndexTuning);
+        auto txCount = static_cast<uint32_t>(chain.txCount());
+
+        bool txes = columns.contains("T");
+        if (txes) {
+            db.clearTxes();
+        }
+        std::array<bool, AddressType::size> addressTypes{};
+        for (auto type : hashedAddressTypes) {
+            addressTypes[static_cast<size_t>(type)] = columns.contains(addressName(type));
+            if (addressTypes[static_cast<size_t>(type)]) {
+                db.clearAddressColumn(type);
+            }
+        }
+        auto selected = [&](AddressType::Enum type) {
+            return addressTypes[static_cast<size_t>(type)];
+        };
+
+        db.beginBulkLoad();
+
+        if (txes) {
+            uint32_t coveredTxCount = 0;
+            auto tablePath = config.txHashTableFilePath();
+            if (tablePath.exists()) {
+                coveredTxCount = std::min(TxHashTable{tablePath}.txCount(), txCount);
+            }
+            std::cout << "Collecting the hashes of txes " << coveredTxCount << " to " << txCount << std::endl;
+            auto start = std::chrono::steady_clock::now();
+            runParallel(coveredTxCount, txCount, threadCount, [&](uint32_t segmentStart, uint32_t segmentEnd) {
+                RowBatch<std::pair<uint256, uint32_t>> rows{[&](std::vector<std::pair<uint256, uint32_t>> batch) {
+                    db.addTxes(std::move(batch));
+                }};
+                for (uint32_t txNum = segmentStart; txNum < segmentEnd; txNum++) {
+                    rows.add(*chain.getTxHash(txNum), txNum);
+                }
+            });
+            std::cout << "Collected tx hashes in " << secondsSince(start) << "s" << std::endl;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        if (selected(AddressType::PUBKEYHASH)) {
+            std::cout << "Collecting the keys of pubkey scripts" << std::endl;
+            runParallel(1, scripts.scriptCount(DedupAddressType::PUBKEY) + 1, threadCount, [&](uint32_t segmentStart, uint32_t segmentEnd) {
+                RowBatch<std::pair<uint160, uint32_t>> rows{[&](std::vector<std::pair<uint160, uint32_t>> batch) {
+                    db.addAddresses<AddressType::PUBKEYHASH>(std::move(batch));
+                }};
+                for (uint32_t scriptNum = segmentStart; scriptNum < segmentEnd; scriptNum++) {
+                    auto pubkey = scripts.getScriptData<DedupAddressType::PUBKEY>(scriptNum);
+                    if (pubkey->hasPubkey) {
+                        rows.add(hash160(pubkey->pubkey.data(), CPubKey::GetLen(pubkey->pubkey[0])), scriptNum);
+                    } else {
+                        rows.add(pubkey->address, scriptNum);
+                    }
+                }
+            });
+        }
+        if (selected(AddressType::SCRIPTHASH) || selected(AddressType::WITNESS_SCRIPTHASH)) {
+            std::cout << "Collecting the keys of scripthash scripts" << std::endl;
+            runParallel(1, scripts.scriptCount(DedupAddressType::SCRIPTHASH) + 1, threadCount, [&](uint32_t segmentStart, uint32_t segmentEnd) {
+                RowBatch<std::pair<uint160, uint32_t>> rows{[&](std::vector<std::pair<uint160, uint32_t>> batch) {
+                    db.addAddresses<AddressType::SCRIPTHASH>(std::move(batch));
+                }};
+                RowBatch<std::pair<uint256, uint32_t>> witnessRows{[&](std::vector<std::pair<uint256, uint32_t>> batch) {
+                    db.addAddresses<AddressType::WITNESS_SCRIPTHASH>(std::move(batch));
+                }};
+                for (uint32_t scriptNum = segmentStart; scriptNum < segmentEnd; scriptNum++) {
+                    auto scriptHash = scripts.getScriptData<DedupAddressType::SCRIPTHASH>(scriptNum);
+                    if (scriptHash->isSegwit) {
+                        // Deduplicated with P2SH by the ripemd160 of the sha256 script hash, found by the latter
+                        if (selected(AddressType::SCRIPTHASH)) {
+                            rows.add(ripemd160(reinterpret_cast<const char *>(&scriptHash->hash256), sizeof(scriptHash->hash256)), scriptNum);
+                        }
+                        if (selected(AddressType::WITNESS_SCRIPTHASH)) {
+                            witnessRows.add(scriptHash->hash256, scriptNum);
+                        }
+                    } else if (selected(AddressType::SCRIPTHASH)) {
+                        rows.add(scriptHash->hash160, scriptNum);
+                    }
+                }
+            });
+        }
+        if (selected(AddressType::MULTISIG)) {
+            std::cout << "Collecting the keys of multisig scripts" << std::endl;
+            runParallel(1, scripts.scriptCount(DedupAddressType::MULTISIG) + 1, threadCount, [&](uint32_t segmentStart, uint32_t segmentEnd) {
+                RowBatch<std::pair<uint160, uint32_t>> rows{[&](std::vector<std::pair<uint160, uint32_t>> batch) {
+                    db.addAddresses<AddressType::MULTISIG>(std::move(batch));
+                }};
+                for (uint32_t scriptNum = segmentStart; scriptNum < segmentEnd; scriptNum++) {
+                    rows.add(multisigKey(*scripts.getScriptData<DedupAddressType::MULTISIG>(scriptNum), scripts), scriptNum);
+                }
+            });
+        }
+        if (selected(AddressType::WITNESS_TAPROOT)) {
+            std::cout << "Collecting the keys of taproot scripts" << std::endl;
+            runParallel(1, scripts.scriptCount(DedupAddressType::WITNESS_TAPROOT) + 1, threadCount, [&](uint32_t segmentStart, uint32_t segmentEnd) {
+                RowBatch<std::pair<uint256, uint32_t>> rows{[&](std::vector<std::pair<uint256, uint32_t>> batch) {
+                    db.addAddresses<AddressType::WITNESS_TAPROOT>(std::move(batch));
+                }};
+                for (uint32_t scriptNum = segmentStart; scriptNum < segmentEnd; scriptNum++) {
+                    rows.add(scripts.getScriptData<DedupAddressType::WITNESS_TAPROOT>(scriptNum)->outputKey, scriptNum);
+                }
+            });
+        }
+        std::cout << "Collected script keys in " << secondsSince(start) << "s" << std::endl;
+
+        std::cout << "Ingesting the hash index files" << std::endl;
+        start = std::chrono::steady_clock::now();
+        db.finishBulkLoad();
+        std::cout << "Ingested in " << secondsSince(start) << "s" << std::endl;
+    }
+
+    /** Record that the index named resultName covers state, which the parser's next index update continues from */
+    void writeParserIndexState(const DataConfiguration &config, const std::string &resultName, const State &state) {
+        auto parserDirectory = filesystem::path{config.chainConfig.dataDirectory}/"parser";
+        if (!parserDirectory.exists()) {
+            filesystem::create_directory(parserDirectory);
+        }
+        std::ofstream outputFile((parserDirectory/(resultName + ".txt")).str());
+        outputFile << state;
+    }
+}
+
+int main(int argc, char * argv[]) {
+    std::string configLocation;
+    bool addressIndex = false;
+    bool hashIndex = false;
+    std::vector<std::string> columnNames;
+    uint32_t threadCount = 0;
+    auto cli = (
+        clipp::value("config file location", configLocation),
+        clipp::option("--address-index").set(addressIndex).doc("Rebuild the address index (addressesDb/)"),
+        clipp::option("--hash-index").set(hashIndex).doc("Rebuild the hash index (hashIndex/)"),
+        (clipp::option("--column") & clipp::values("name", columnNames)) % "Only rebuild the named column families, eg. pubkeyhash_output, multisig_nested, T or scripthash",
+        (clipp::option("--threads", "-j") & clipp::value("thread count", threadCount)) % "Number of threads reading the chain and scripts, defaults to one per hardware thread"
+    );
+
+    auto res = parse(argc, argv, cli);
+    if (res.any_error()) {
+        std::cout << "Invalid command line parameter\n" << clipp::make_man_page(cli, argv[0]);
+        return 0;
+    }
+
+    // Neither index named means both
+    if (!addressIndex && !hashIndex) {
+        addressIndex = true;
+        hashIndex = true;
+    }
+
+    ColumnSelection columns;
+    columns.names.insert(columnNames.begin(), columnNames.end());
+    auto addressColumns = addressIndexColumns();
+    auto hashColumns = hashIndexColumns();
+    for (auto &name : columnNames) {
+        bool inAddressIndex = std::find(addressColumns.begin(), addressColumns.end(), name) != addressColumns.end();
+        bool inHashIndex = std::find(hashColumns.begin(), hashColumns.end(), name) != hashColumns.end();
+        if (!inAddressIndex && !inHashIndex) {
+            std::cout << "Unknown column family " << name << "\n";
+            return 1;
+        }
+        if ((inAddressIndex && !addressIndex) || (inHashIndex && !hashIndex)) {
+            std::cout << "Column family " << name << " is not part of the selected index\n";
+            return 1;
+        }
+    }
+    auto coversAll = [&](const std::vector<std::string> &names) {
+        return std::all_of(names.begin(), names.end(), [&](const std::string &name) { return columns.contains(name); });
+    };
+    // Only named columns limit the indexes to the ones that contain them
+    if (!columnNames.empty()) {
+        addressIndex = addressIndex && std::any_of(addressColumns.begin(), addressColumns.end(), [&](const std::string &name) { return columns.names.count(name) > 0; });
+        hashIndex = hashIndex && std::any_of(hashColumns.begin(), hashColumns.end(), [&](const std::string &name) { return columns.names.count(name) > 0; });
+    }
+
+    auto config = loadBlockchainConfig(configLocation, false, 0);
+    threadCount = resolveThreadCount(threadCount);
+
+    // The parser must not update the indexes while they are rebuilt
+    auto pidFile = config.pidFilePath();
+    if (pidFile.exists()) {
+        std::cout << "A PID file exists in the data directory, a parser might be running. Aborting." << std::endl;
+        return 1;
+    }
+    {
+        std::ofstream rawFile(pidFile.str());
+        rawFile << getpid();
+    }
+
+    int result = 0;
+    try {
+        ChainAccess chain{config.chainDirectory(), config.blocksIgnored, config.errorOnReorg};
+        ScriptAccess scripts{config.scriptsDirectory()};
+        State state{chain, scripts};
+        auto start = std::chrono::steady_clock::now();
+
+        if (addressIndex) {
+            std::cout << "Rebuilding the address index with " << threadCount << " threads" << std::endl;
+            reindexAddresses(config, chain, scripts, columns, threadCount);
+            // A partial rebuild leaves the other columns at whatever state they were in
+            if (coversAll(addressColumns)) {
+                writeParserIndexState(config, "addressDB", state);
+            }
+        }
+        if (hashIndex) {
+            std::cout << "Rebuilding the hash index with " << threadCount << " threads" << std::endl;
+            reindexHashes(config, chain, scripts, columns, threadCount);
+            if (coversAll(hashColumns)) {
+                writeParserIndexState(config, "hashIndex", state);
+            }
+        }
+        std::cout << "Reindexed " << state.txCount << " txes in " << secondsSince(start) << "s" << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << "Reindexing failed: " << e.what() << std::endl;
+        result = 1;
+    }
+
+    pidFile.remove_file();
+    return result;
+}
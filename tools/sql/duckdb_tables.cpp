@@ -0,0 +1,450 @@
+//
+//  duckdb_tables.cpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "duckdb_tables.hpp"
+
+#include <blocksci/address/address.hpp>
+#include <blocksci/chain/blockchain.hpp>
+#include <blocksci/chain/chain_table.hpp>
+#include <blocksci/chain/derived_column.hpp>
+
+#include <internal/address_info.hpp>
+#include <internal/chain_access.hpp>
+#include <internal/data_access.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace blocksci {
+    namespace {
+        /** Rows of blocksci_derived and addresses of blocksci_addresses claimed by a thread at once */
+        constexpr uint64_t claimRows = uint64_t{1} << 16;
+
+        enum class TableKind {
+            Chain, Derived, Addresses
+        };
+
+        /** Extra info of a registered function */
+        struct FunctionInfo {
+            Blockchain *chain;
+            TableKind kind;
+            ChainTable table;
+        };
+
+        template <typename T>
+        void destroy(void *data) {
+            delete static_cast<T *>(data);
+        }
+
+        void addColumn(duckdb_bind_info info, const std::string &name, DUCKDB_TYPE type) {
+            auto logicalType = duckdb_create_logical_type(type);
+            duckdb_bind_add_result_column(info, name.c_str(), logicalType);
+            duckdb_destroy_logical_type(&logicalType);
+        }
+
+        DUCKDB_TYPE duckdbType(TableColumnType type) {
+            switch (type) {
+                case TableColumnType::Int64: return DUCKDB_TYPE_BIGINT;
+                case TableColumnType::Int32: return DUCKDB_TYPE_INTEGER;
+                case TableColumnType::UInt32: return DUCKDB_TYPE_UINTEGER;
+                case TableColumnType::UInt16: return DUCKDB_TYPE_USMALLINT;
+                case TableColumnType::UInt8: return DUCKDB_TYPE_UTINYINT;
+                case TableColumnType::Bool: return DUCKDB_TYPE_BOOLEAN;
+                case TableColumnType::Hash: return DUCKDB_TYPE_BLOB;
+            }
+            throw std::invalid_argument("Unknown table column type");
+        }
+
+        DUCKDB_TYPE duckdbType(DerivedColumnType type) {
+            switch (type) {
+                case DerivedColumnType::Int64: return DUCKDB_TYPE_BIGINT;
+                case DerivedColumnType::UInt32: return DUCKDB_TYPE_UINTEGER;
+                case DerivedColumnType::UInt16: return DUCKDB_TYPE_USMALLINT;
+                case DerivedColumnType::UInt8: return DUCKDB_TYPE_UTINYINT;
+            }
+            throw std::invalid_argument("Unknown derived column type");
+        }
+
+        std::string stringParameter(duckdb_value value) {
+            auto chars = duckdb_get_varchar(value);
+            std::string result{chars};
+            duckdb_free(chars);
+            duckdb_destroy_value(&value);
+            return result;
+        }
+
+        BlockHeight heightParameter(duckdb_bind_info info, const char *name, BlockHeight defaultHeight) {
+            auto value = duckdb_bind_get_named_parameter(info, name);
+            if (value == nullptr) {
+                return defaultHeight;
+            }
+            auto height = duckdb_get_int64(value);
+            duckdb_destroy_value(&value);
+            return static_cast<BlockHeight>(height);
+        }
+
+        /** Blocks [start, stop) selected by the start and stop parameters */
+        BlockRange boundRange(duckdb_bind_info info, Blockchain &chain) {
+            auto start = heightParameter(info, "start", 0);
+            auto stop = heightParameter(info, "stop", chain.size());
+            if (start < 0 || start > stop || stop > chain.size()) {
+                throw std::out_of_range("Block range [" + std::to_string(start) + ", " + std::to_string(stop) + ") is outside of the chain");
+            }
+            return chain[{start, stop}];
+        }
+
+        DerivedColumnLevel tableLevel(ChainTable table) {
+            switch (table) {
+                case ChainTable::Blocks: return DerivedColumnLevel::Block;
+                case ChainTable::Transactions: return DerivedColumnLevel::Tx;
+                case ChainTable::Inputs: return DerivedColumnLevel::Input;
+                case ChainTable::Outputs: return DerivedColumnLevel::Output;
+            }
+            throw std::invalid_argument("Unknown table");
+        }
+
+        /** Number of the first object of the level in the block at the given height, which may be the chain's end */
+        uint64_t firstRow(const ChainAccess &chain, DerivedColumnLevel level, BlockHeight height) {
+            if (level == DerivedColumnLevel::Block) {
+                return static_cast<uint64_t>(height);
+            }
+            auto txNum = height < chain.blockCount() ? chain.getBlock(height)->firstTxIndex : static_cast<uint32_t>(chain.txCount());
+            switch (level) {
+                case DerivedColumnLevel::Tx:
+                    return txNum;
+                case DerivedColumnLevel::Input:
+                    return txNum < chain.txCount() ? chain.getFirstInputNumber(txNum) : chain.inputCount();
+                default:
+                    return txNum < chain.txCount() ? chain.getFirstOutputNumber(txNum) : chain.outputCount();
+            }
+        }
+
+        uint64_t rowCount(BlockRange &range, DerivedColumnLevel level) {
+            auto &chain = range.getAccess().getChain();
+            return firstRow(chain, level, range.sl.stop) - firstRow(chain, level, range.sl.start);
+        }
+
+        // Chain tables
+
+        struct ChainBind {
+            BlockRange range;
+            ChainTable table;
+            std::vector<std::string> names;
+            std::vector<TableColumnType> types;
+        };
+
+        struct ChainScan {
+            std::vector<BlockRange> segments;
+            std::atomic<size_t> nextSegment{0};
+            /** Names of the projected columns in the order of the output chunk */
+            std::vector<std::string> names;
+        };
+
+        /** Table of the segment a thread is emitting */
+        struct ChainLocalScan {
+            std::vector<ChainTableColumn> columns;
+            uint64_t rows = 0;
+            uint64_t offset = 0;
+        };
+
+        void bindChain(duckdb_bind_info info) {
+            try {
+                auto function = static_cast<FunctionInfo *>(duckdb_bind_get_extra_info(info));
+                auto &chain = *function->chain;
+                auto bind = std::make_unique<ChainBind>(ChainBind{boundRange(info, chain), function->table, {}, {}});
+                // Column types from a table of at most one block
+                auto probeHeight = std::max(std::min(bind->range.sl.start, chain.size() - 1), BlockHeight{0});
+                auto probeRange = chain[{probeHeight, std::min(probeHeight + 1, chain.size())}];
+                for (auto &column : buildChainTable(probeRange, bind->table)) {
+                    addColumn(info, column.name, duckdbType(column.type));
+                    bind->names.push_back(column.name);
+                    bind->types.push_back(column.type);
+                }
+                duckdb_bind_set_cardinality(info, rowCount(bind->range, tableLevel(bind->table)), true);
+                duckdb_bind_set_bind_data(info, bind.release(), destroy<ChainBind>);
+            } catch (const std::exception &e) {
+                duckdb_bind_set_error(info, e.what());
+            }
+        }
+
+        void initChain(duckdb_init_info info) {
+            try {
+                auto &bind = *static_cast<ChainBind *>(duckdb_init_get_bind_data(info));
+                auto scan = std::make_unique<ChainScan>();
+                if (bind.range.size() > 0) {
+                    scan->segments = bind.range.segment(bind.range.chunkCount());
+                }
+                auto columnCount = duckdb_init_get_column_count(info);
+                for (idx_t i = 0; i < columnCount; i++) {
+                    scan->names.push_back(bind.names.at(duckdb_init_get_column_index(info, i)));
+                }
+                duckdb_init_set_max_threads(info, std::max<idx_t>(scan->segments.size(), 1));
+                duckdb_init_set_init_data(info, scan.release(), destroy<ChainScan>);
+            } catch (const std::exception &e) {
+                duckdb_init_set_error(info, e.what());
+            }
+        }
+
+        void initChainLocal(duckdb_init_info info) {
+            duckdb_init_set_init_data(info, new ChainLocalScan, destroy<ChainLocalScan>);
+        }
+
+        void scanChain(duckdb_function_info info, duckdb_data_chunk output) {
+            try {
+                auto &bind = *static_cast<ChainBind *>(duckdb_function_get_bind_data(info));
+                auto &scan = *static_cast<ChainScan *>(duckdb_function_get_init_data(info));
+                auto &local = *static_cast<ChainLocalScan *>(duckdb_function_get_local_init_data(info));
+                while (local.offset >= local.rows) {
+                    auto segmentNum = scan.nextSegment++;
+                    if (segmentNum >= scan.segments.size()) {
+                        duckdb_data_chunk_set_size(output, 0);
+                        return;
+                    }
+                    auto &segment = scan.segments[segmentNum];
+                    local.offset = 0;
+                    if (scan.names.empty()) {
+                        // Only the row count is needed, eg. for count(*)
+                        local.columns.clear();
+                        local.rows = rowCount(segment, tableLevel(bind.table));
+                    } else {
+                        local.columns = buildChainTable(segment, bind.table, scan.names);
+                        local.rows = local.columns.front().size();
+                    }
+                }
+                auto rows = std::min<uint64_t>(duckdb_vector_size(), local.rows - local.offset);
+                for (size_t i = 0; i < local.columns.size(); i++) {
+                    auto &column = local.columns[i];
+                    auto vector = duckdb_data_chunk_get_vector(output, i);
+                    auto width = tableColumnElementSize(column.type);
+                    auto source = reinterpret_cast<const char *>(column.data.data() + local.offset * width);
+                    if (column.type == TableColumnType::Hash) {
+                        for (uint64_t row = 0; row < rows; row++) {
+                            duckdb_vector_assign_string_element_len(vector, row, source + row * width, width);
+                        }
+                    } else {
+                        // DuckDB stores booleans as one byte like ChainTableColumn
+                        std::memcpy(duckdb_vector_get_data(vector), source, rows * width);
+                    }
+                }
+                local.offset += rows;
+                duckdb_data_chunk_set_size(output, rows);
+            } catch (const std::exception &e) {
+                duckdb_function_set_error(info, e.what());
+            }
+        }
+
+        // Derived columns
+
+        struct DerivedBind {
+            std::shared_ptr<DerivedColumn> column;
+            uint64_t begin;
+            uint64_t end;
+        };
+
+        /** Scan claiming rows from a shared counter */
+        struct RowScan {
+            std::atomic<uint64_t> next;
+            /** Bound column of each column of the output chunk */
+            std::vector<idx_t> columns;
+
+            RowScan(duckdb_init_info info, uint64_t first) : next(first) {
+                auto columnCount = duckdb_init_get_column_count(info);
+                for (idx_t i = 0; i < columnCount; i++) {
+                    columns.push_back(duckdb_init_get_column_index(info, i));
+                }
+            }
+        };
+
+        void bindDerived(duckdb_bind_info info) {
+            try {
+                auto function = static_cast<FunctionInfo *>(duckdb_bind_get_extra_info(info));
+                auto &chain = *function->chain;
+                auto column = std::make_shared<DerivedColumn>(chain.derivedColumn(stringParameter(duckdb_bind_get_parameter(info, 0))));
+                auto range = boundRange(info, chain);
+                if (range.sl.stop > column->coveredHeight()) {
+                    throw std::out_of_range("Derived column " + column->name() + " only covers the blocks up to " + std::to_string(column->coveredHeight()));
+                }
+                auto &chainAccess = chain.getAccess().getChain();
+                auto begin = firstRow(chainAccess, column->level(), range.sl.start);
+                auto end = firstRow(chainAccess, column->level(), range.sl.stop);
+                addColumn(info, "index", DUCKDB_TYPE_UBIGINT);
+                addColumn(info, "value", duckdbType(column->type()));
+                duckdb_bind_set_cardinality(info, end - begin, true);
+                duckdb_bind_set_bind_data(info, new DerivedBind{std::move(column), begin, end}, destroy<DerivedBind>);
+            } catch (const std::exception &e) {
+                duckdb_bind_set_error(info, e.what());
+            }
+        }
+
+        void initDerived(duckdb_init_info info) {
+            auto &bind = *static_cast<DerivedBind *>(duckdb_init_get_bind_data(info));
+            duckdb_init_set_max_threads(info, std::max<idx_t>((bind.end - bind.begin) / claimRows, 1));
+            duckdb_init_set_init_data(info, new RowScan{info, bind.begin}, destroy<RowScan>);
+        }
+
+        void scanDerived(duckdb_function_info info, duckdb_data_chunk output) {
+            auto &bind = *static_cast<DerivedBind *>(duckdb_function_get_bind_data(info));
+            auto &scan = *static_cast<RowScan *>(duckdb_function_get_init_data(info));
+            // Values are copied straight from the mapped file, one vector per call
+            auto begin = std::min(scan.next.fetch_add(duckdb_vector_size()), bind.end);
+            auto rows = std::min<uint64_t>(duckdb_vector_size(), bind.end - begin);
+            for (idx_t i = 0; i < scan.columns.size(); i++) {
+                auto vector = duckdb_data_chunk_get_vector(output, i);
+                if (scan.columns[i] == 0) {
+                    auto indexes = static_cast<uint64_t *>(duckdb_vector_get_data(vector));
+                    for (uint64_t row = 0; row < rows; row++) {
+                        indexes[row] = begin + row;
+                    }
+                } else {
+                    auto width = derivedColumnElementSize(bind.column->type());
+                    std::memcpy(duckdb_vector_get_data(vector), static_cast<const uint8_t *>(bind.column->data()) + begin * width, rows * width);
+                }
+            }
+            duckdb_data_chunk_set_size(output, rows);
+        }
+
+        // Addresses
+
+        struct AddressBind {
+            DataAccess *access;
+            AddressType::Enum type;
+            size_t width;
+            uint32_t count;
+        };
+
+        /** Address strings of the addresses a thread is emitting */
+        struct AddressLocalScan {
+            std::vector<char> strings;
+            uint32_t start = 0;
+            uint32_t end = 0;
+            uint32_t offset = 0;
+        };
+
+        void bindAddresses(duckdb_bind_info info) {
+            try {
+                auto function = static_cast<FunctionInfo *>(duckdb_bind_get_extra_info(info));
+                auto &chain = *function->chain;
+                auto typeName = stringParameter(duckdb_bind_get_parameter(info, 0));
+                for (size_t i = 0; i < AddressType::size; i++) {
+                    auto type = static_cast<AddressType::Enum>(i);
+                    if (addressName(type) == typeName) {
+                        auto width = addressStringLength(type, chain.getAccess());
+                        addColumn(info, "address_num", DUCKDB_TYPE_UINTEGER);
+                        addColumn(info, "address", DUCKDB_TYPE_VARCHAR);
+                        auto count = chain.addressCount(type);
+                        duckdb_bind_set_cardinality(info, count, true);
+                        duckdb_bind_set_bind_data(info, new AddressBind{&chain.getAccess(), type, width, count}, destroy<AddressBind>);
+                        return;
+                    }
+                }
+                throw std::invalid_argument("Unknown address type " + typeName);
+            } catch (const std::exception &e) {
+                duckdb_bind_set_error(info, e.what());
+            }
+        }
+
+        void initAddresses(duckdb_init_info info) {
+            auto &bind = *static_cast<AddressBind *>(duckdb_init_get_bind_data(info));
+            duckdb_init_set_max_threads(info, std::max<idx_t>(bind.count / claimRows, 1));
+            // Address numbers start at 1
+            duckdb_init_set_init_data(info, new RowScan{info, 1}, destroy<RowScan>);
+        }
+
+        void initAddressesLocal(duckdb_init_info info) {
+            duckdb_init_set_init_data(info, new AddressLocalScan, destroy<AddressLocalScan>);
+        }
+
+        void scanAddresses(duckdb_function_info info, duckdb_data_chunk output) {
+            try {
+                auto &bind = *static_cast<AddressBind *>(duckdb_function_get_bind_data(info));
+                auto &scan = *static_cast<RowScan *>(duckdb_function_get_init_data(info));
+                auto &local = *static_cast<AddressLocalScan *>(duckdb_function_get_local_init_data(info));
+                auto stop = uint64_t{bind.count} + 1;
+                if (local.offset >= local.end) {
+                    auto start = std::min(scan.next.fetch_add(claimRows), stop);
+                    local.start = static_cast<uint32_t>(start);
+                    local.end = static_cast<uint32_t>(std::min(start + claimRows, stop));
+                    local.offset = local.start;
+                    if (local.start == local.end) {
+                        duckdb_data_chunk_set_size(output, 0);
+                        return;
+                    }
+                    // DuckDB runs one scan per thread, so each encodes its addresses on its own thread
+                    local.strings.assign((local.end - local.start) * bind.width, '\0');
+                    addressStrings(bind.type, local.start, local.end, local.strings.data(), bind.width, *bind.access, 1);
+                }
+                auto rows = std::min<uint32_t>(static_cast<uint32_t>(duckdb_vector_size()), local.end - local.offset);
+                for (idx_t i = 0; i < scan.columns.size(); i++) {
+                    auto vector = duckdb_data_chunk_get_vector(output, i);
+                    if (scan.columns[i] == 0) {
+                        auto addressNums = static_cast<uint32_t *>(duckdb_vector_get_data(vector));
+                        for (uint32_t row = 0; row < rows; row++) {
+                            addressNums[row] = local.offset + row;
+                        }
+                    } else {
+                        for (uint32_t row = 0; row < rows; row++) {
+                            auto string = local.strings.data() + (local.offset - local.start + row) * bind.width;
+                            duckdb_vector_assign_string_element_len(vector, row, string, strnlen(string, bind.width));
+                        }
+                    }
+                }
+                local.offset += rows;
+                duckdb_data_chunk_set_size(output, rows);
+            } catch (const std::exception &e) {
+                duckdb_function_set_error(info, e.what());
+            }
+        }
+
+        void registerFunction(duckdb_connection connection, const char *name, FunctionInfo info, bool nameParameter, duckdb_table_function_bind_t bind, duckdb_table_function_init_t init, duckdb_table_function_init_t localInit, duckdb_table_function_t scan) {
+            auto function = duckdb_create_table_function();
+            duckdb_table_function_set_name(function, name);
+            if (nameParameter) {
+                auto varchar = duckdb_create_logical_type(DUCKDB_TYPE_VARCHAR);
+                duckdb_table_function_add_parameter(function, varchar);
+                duckdb_destroy_logical_type(&varchar);
+            }
+            if (info.kind != TableKind::Addresses) {
+                auto bigint = duckdb_create_logical_type(DUCKDB_TYPE_BIGINT);
+                duckdb_table_function_add_named_parameter(function, "start", bigint);
+                duckdb_table_function_add_named_parameter(function, "stop", bigint);
+                duckdb_destroy_logical_type(&bigint);
+            }
+            duckdb_table_function_set_extra_info(function, new FunctionInfo(info), destroy<FunctionInfo>);
+            duckdb_table_function_set_bind(function, bind);
+            duckdb_table_function_set_init(function, init);
+            if (localInit != nullptr) {
+                duckdb_table_function_set_local_init(function, localInit);
+            }
+            duckdb_table_function_set_function(function, scan);
+            duckdb_table_function_supports_projection_pushdown(function, true);
+            auto state = duckdb_register_table_function(connection, function);
+            duckdb_destroy_table_function(&function);
+            if (state == DuckDBError) {
+                throw std::runtime_error(std::string{"Failed to register table function "} + name);
+            }
+        }
+    } // namespace
+
+    void registerBlockSciTables(duckdb_connection connection, Blockchain &chain) {
+        const std::pair<const char *, ChainTable> chainTables[] = {
+            {"blocksci_blocks", ChainTable::Blocks},
+            {"blocksci_txs", ChainTable::Transactions},
+            {"blocksci_inputs", ChainTable::Inputs},
+            {"blocksci_outputs", ChainTable::Outputs}
+        };
+        for (auto &table : chainTables) {
+            registerFunction(connection, table.first, FunctionInfo{&chain, TableKind::Chain, table.second}, false, bindChain, initChain, initChainLocal, scanChain);
+        }
+        registerFunction(connection, "blocksci_derived", FunctionInfo{&chain, TableKind::Derived, ChainTable::Blocks}, true, bindDerived, initDerived, nullptr, scanDerived);
+        registerFunction(connection, "blocksci_addresses", FunctionInfo{&chain, TableKind::Addresses, ChainTable::Blocks}, true, bindAddresses, initAddresses, initAddressesLocal, scanAddresses);
+    }
+} // namespace blocksci
@@ -0,0 +1,37 @@
+//
+//  duckdb_tables.hpp
+//  blocksci
+//
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#ifndef blocksci_sql_duckdb_tables_hpp
+#define blocksci_sql_duckdb_tables_hpp
+
+#include <duckdb.h>
+
+namespace blocksci {
+    class Blockchain;
+
+    /** Register table functions scanning the chain on a DuckDB connection
+     *
+     *     blocksci_blocks(start := 0, stop := <height>)
+     *     blocksci_txs(start := 0, stop := <height>)
+     *     blocksci_inputs(start := 0, stop := <height>)
+     *     blocksci_outputs(start := 0, stop := <height>)
+     *     blocksci_derived('<derived column>', start := 0, stop := <height>)
+     *     blocksci_addresses('<address type>')
+     *
+     * The first four have the columns of buildChainTable and only fill the columns a query reads. start and stop
+     * restrict the scan to the blocks [start, stop), which is resolved through the tx ranges of block.dat before
+     * anything is read. The blocks are split into the chunks of BlockRange::segment, which DuckDB's threads claim one at
+     * a time, so scans run in parallel and joins and aggregations run on DuckDB's vectorized engine. blocksci_derived has
+     * the columns index, the height, tx number or input or output number of the row, and value, and blocksci_addresses
+     * the columns address_num and address.
+     *
+     * The chain must outlive the connection. Throws std::runtime_error if DuckDB rejects a function.
+     */
+    void registerBlockSciTables(duckdb_connection connection, Blockchain &chain);
+} // namespace blocksci
+
+#endif /* blocksci_sql_duckdb_tables_hpp */
@@ -0,0 +1,108 @@
+//
+//  main.cpp
+//
+//  blocksci_sql
+//  Created by Harry Kalodner on 10/15/26.
+//
+
+#include "duckdb_tables.hpp"
+
+#include <blocksci/chain/blockchain.hpp>
+
+#include <clipp.h>
+
+#include <iostream>
+#include <string>
+
+using namespace blocksci;
+
+/**
+ Run the statement and print its result as tab separated values with a header line. Returns false on errors.
+ */
+bool runQuery(duckdb_connection connection, const std::string &sql) {
+    duckdb_result result;
+    if (duckdb_query(connection, sql.c_str(), &result) == DuckDBError) {
+        std::cerr << "Error: " << duckdb_result_error(&result) << std::endl;
+        duckdb_destroy_result(&result);
+        return false;
+    }
+    auto columnCount = duckdb_column_count(&result);
+    for (idx_t column = 0; column < columnCount; column++) {
+        std::cout << (column > 0 ? "\t" : "") << duckdb_column_name(&result, column);
+    }
+    std::cout << "\n";
+    auto rowCount = duckdb_row_count(&result);
+    for (idx_t row = 0; row < rowCount; row++) {
+        for (idx_t column = 0; column < columnCount; column++) {
+            std::cout << (column > 0 ? "\t" : "");
+            if (duckdb_value_is_null(&result, column, row)) {
+                std::cout << "NULL";
+            } else {
+                auto value = duckdb_value_varchar(&result, column, row);
+                std::cout << value;
+                duckdb_free(value);
+            }
+        }
+        std::cout << "\n";
+    }
+    std::cout.flush();
+    duckdb_destroy_result(&result);
+    return true;
+}
+
+int main(int argc, char * argv[]) {
+    std::string configLocation;
+    std::string databasePath;
+    std::string statement;
+
+    auto cli = (
+        clipp::value("config file location", configLocation) % "Path to config file",
+        (clipp::option("--database", "-d") & clipp::value("database file", databasePath)) % "DuckDB database for tables created by the queries (default: in memory)",
+        (clipp::option("--execute", "-e") & clipp::value("sql", statement)) % "Run the statement and exit instead of reading statements from stdin"
+    );
+
+    auto res = parse(argc, argv, cli);
+    if (res.any_error()) {
+        std::cout << "Invalid command line parameter\n" << clipp::make_man_page(cli, argv[0]);
+        return 0;
+    }
+
+    Blockchain chain{configLocation};
+
+    duckdb_database database;
+    duckdb_connection connection;
+    if (duckdb_open(databasePath.empty() ? nullptr : databasePath.c_str(), &database) == DuckDBError) {
+        std::cerr << "Failed to open the database " << databasePath << std::endl;
+        return 1;
+    }
+    if (duckdb_connect(database, &connection) == DuckDBError) {
+        std::cerr << "Failed to connect to the database" << std::endl;
+        duckdb_close(&database);
+        return 1;
+    }
+    registerBlockSciTables(connection, chain);
+
+    int status = 0;
+    if (!statement.empty()) {
+        status = runQuery(connection, statement) ? 0 : 1;
+    } else {
+        // Statements end with a semicolon at the end of a line and may span several lines
+        std::string line;
+        std::string pending;
+        while (std::getline(std::cin, line)) {
+            pending += line + "\n";
+            auto end = line.find_last_not_of(" \t\r");
+            if (end != std::string::npos && line[end] == ';') {
+                runQuery(connection, pending);
+                pending.clear();
+            }
+        }
+        if (pending.find_first_not_of(" \t\r\n") != std::string::npos) {
+            runQuery(connection, pending);
+        }
+    }
+
+    duckdb_disconnect(&connection);
+    duckdb_close(&database);
+    return status;
+}